@@ -25,6 +25,7 @@
 #define PMULL_MIN_LEN		64L	/* minimum size of buffer
 					 * for crc32_pmull_le_16 */
 #define SCALE_F			16L	/* size of NEON register */
+#define CRC32_3WAY_STRIDE	192	/* bytes per crc32_le_3way stride */
 
 asmlinkage u32 crc32_pmull_le(const u8 buf[], u64 len, u32 init_crc);
 asmlinkage u32 crc32_armv8_le(u32 init_crc, const u8 buf[], size_t len);
@@ -32,6 +33,14 @@ asmlinkage u32 crc32_armv8_le(u32 init_crc, const u8 buf[], size_t len);
 asmlinkage u32 crc32c_pmull_le(const u8 buf[], u64 len, u32 init_crc);
 asmlinkage u32 crc32c_armv8_le(u32 init_crc, const u8 buf[], size_t len);
 
+asmlinkage u32 crc32_le_3way(u32 init_crc, const u8 buf[], size_t len);
+asmlinkage u32 crc32c_le_3way(u32 init_crc, const u8 buf[], size_t len);
+
+asmlinkage void crc32_armv8_le_3buf(u32 crc[3], const u8 a[], const u8 b[],
+				    const u8 c[], size_t len);
+asmlinkage void crc32c_armv8_le_3buf(u32 crc[3], const u8 a[], const u8 b[],
+				     const u8 c[], size_t len);
+
 static u32 (*fallback_crc32)(u32 init_crc, const u8 buf[], size_t len);
 static u32 (*fallback_crc32c)(u32 init_crc, const u8 buf[], size_t len);
 
@@ -156,6 +165,95 @@ static int crc32c_pmull_update(struct shash_desc *desc, const u8 *data,
 	return 0;
 }
 
+static int crc32_3way_update(struct shash_desc *desc, const u8 *data,
+			     unsigned int length)
+{
+	u32 *crc = shash_desc_ctx(desc);
+	unsigned int l;
+
+	if (length >= CRC32_3WAY_STRIDE && may_use_simd()) {
+		l = round_down(length, CRC32_3WAY_STRIDE);
+
+		kernel_neon_begin();
+		*crc = crc32_le_3way(*crc, data, l);
+		kernel_neon_end();
+
+		data += l;
+		length -= l;
+	}
+
+	if (length > 0)
+		*crc = crc32_armv8_le(*crc, data, length);
+
+	return 0;
+}
+
+static int crc32c_3way_update(struct shash_desc *desc, const u8 *data,
+			      unsigned int length)
+{
+	u32 *crc = shash_desc_ctx(desc);
+	unsigned int l;
+
+	if (length >= CRC32_3WAY_STRIDE && may_use_simd()) {
+		l = round_down(length, CRC32_3WAY_STRIDE);
+
+		kernel_neon_begin();
+		*crc = crc32c_le_3way(*crc, data, l);
+		kernel_neon_end();
+
+		data += l;
+		length -= l;
+	}
+
+	if (length > 0)
+		*crc = crc32c_armv8_le(*crc, data, length);
+
+	return 0;
+}
+
+/*
+ * Checksums of up to three equal length buffers at once, e.g. the blocks
+ * of a range, with their CRC32X chains interleaved. No NEON is involved,
+ * so this is usable in any context.
+ */
+static int crc32_finup_mb(struct shash_desc *desc, const u8 * const data[],
+			  unsigned int len, u8 * const outs[],
+			  unsigned int num_msgs)
+{
+	u32 *mctx = shash_desc_ctx(desc);
+	u32 crc[3] = { *mctx, *mctx, *mctx };
+	unsigned int l = round_down(len, 8);
+	unsigned int i;
+
+	crc32_armv8_le_3buf(crc, data[0], data[1], data[num_msgs - 1], l);
+
+	for (i = 0; i < num_msgs; i++) {
+		if (len > l)
+			crc[i] = crc32_armv8_le(crc[i], data[i] + l, len - l);
+		put_unaligned_le32(crc[i], outs[i]);
+	}
+	return 0;
+}
+
+static int crc32c_finup_mb(struct shash_desc *desc, const u8 * const data[],
+			   unsigned int len, u8 * const outs[],
+			   unsigned int num_msgs)
+{
+	u32 *mctx = shash_desc_ctx(desc);
+	u32 crc[3] = { *mctx, *mctx, *mctx };
+	unsigned int l = round_down(len, 8);
+	unsigned int i;
+
+	crc32c_armv8_le_3buf(crc, data[0], data[1], data[num_msgs - 1], l);
+
+	for (i = 0; i < num_msgs; i++) {
+		if (len > l)
+			crc[i] = crc32c_armv8_le(crc[i], data[i] + l, len - l);
+		put_unaligned_le32(~crc[i], outs[i]);
+	}
+	return 0;
+}
+
 static int crc32_pmull_final(struct shash_desc *desc, u8 *out)
 {
 	u32 *crc = shash_desc_ctx(desc);
@@ -208,14 +306,25 @@ static struct shash_alg crc32_pmull_algs[] = { {
 
 static int __init crc32_pmull_mod_init(void)
 {
-	if (IS_ENABLED(CONFIG_KERNEL_MODE_NEON) && (elf_hwcap & HWCAP_PMULL)) {
-		crc32_pmull_algs[0].update = crc32_pmull_update;
-		crc32_pmull_algs[1].update = crc32c_pmull_update;
+	if (elf_hwcap & HWCAP_CRC32) {
+		crc32_pmull_algs[0].finup_mb = crc32_finup_mb;
+		crc32_pmull_algs[0].mb_max_msgs = 3;
+		crc32_pmull_algs[1].finup_mb = crc32c_finup_mb;
+		crc32_pmull_algs[1].mb_max_msgs = 3;
+	}
 
+	if (IS_ENABLED(CONFIG_KERNEL_MODE_NEON) && (elf_hwcap & HWCAP_PMULL)) {
+		/*
+		 * With the CRC32 instructions available, interleaving them
+		 * beats the PMULL folding, which leaves PMULL to merge the
+		 * interleaved chains only.
+		 */
 		if (elf_hwcap & HWCAP_CRC32) {
-			fallback_crc32 = crc32_armv8_le;
-			fallback_crc32c = crc32c_armv8_le;
+			crc32_pmull_algs[0].update = crc32_3way_update;
+			crc32_pmull_algs[1].update = crc32c_3way_update;
 		} else {
+			crc32_pmull_algs[0].update = crc32_pmull_update;
+			crc32_pmull_algs[1].update = crc32c_pmull_update;
 			fallback_crc32 = crc32_le;
 			fallback_crc32c = __crc32c_le;
 		}
@@ -0,0 +1,137 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Kernel mode NEON in softirq benchmark
+ *
+ * Encrypts packet sized buffers with ChaCha20 from a tasklet and from task
+ * context, the way IPsec and other network code use the NEON ciphers, and
+ * reports the time taken per packet. The cost of kernel_neon_begin() and
+ * kernel_neon_end() themselves is measured with empty pairs.
+ */
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <crypto/skcipher.h>
+#include <linux/completion.h>
+#include <linux/interrupt.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/module.h>
+#include <linux/scatterlist.h>
+#include <linux/slab.h>
+
+#include <asm/neon.h>
+#include <asm/simd.h>
+
+#define BENCH_PKT_SIZE	1420
+
+static unsigned int iterations = 10000;
+module_param(iterations, uint, 0444);
+MODULE_PARM_DESC(iterations, "Number of packets or begin/end pairs per run");
+
+struct neon_bench {
+	struct crypto_skcipher	*tfm;
+	u8			*buf;
+	bool			pairs;
+	u64			ns;
+	int			err;
+	struct completion	done;
+};
+
+static void neon_bench_run(struct neon_bench *b)
+{
+	SKCIPHER_REQUEST_ON_STACK(req, b->tfm);
+	u8 iv[16] = { 0 };
+	struct scatterlist sg;
+	unsigned int i;
+	ktime_t t;
+
+	sg_init_one(&sg, b->buf, BENCH_PKT_SIZE);
+	skcipher_request_set_tfm(req, b->tfm);
+	skcipher_request_set_callback(req, 0, NULL, NULL);
+	skcipher_request_set_crypt(req, &sg, &sg, BENCH_PKT_SIZE, iv);
+
+	b->err = 0;
+	t = ktime_get();
+	for (i = 0; i < iterations && !b->err; i++) {
+		if (b->pairs) {
+			if (!may_use_simd()) {
+				b->err = -EBUSY;
+				break;
+			}
+			kernel_neon_begin();
+			kernel_neon_end();
+		} else {
+			b->err = crypto_skcipher_encrypt(req);
+		}
+	}
+	b->ns = ktime_to_ns(ktime_sub(ktime_get(), t));
+	skcipher_request_zero(req);
+}
+
+static void neon_bench_tasklet(unsigned long data)
+{
+	struct neon_bench *b = (struct neon_bench *)data;
+
+	neon_bench_run(b);
+	complete(&b->done);
+}
+
+static int neon_bench_one(struct neon_bench *b, bool pairs, bool softirq)
+{
+	struct tasklet_struct tasklet;
+
+	b->pairs = pairs;
+	if (softirq) {
+		init_completion(&b->done);
+		tasklet_init(&tasklet, neon_bench_tasklet, (unsigned long)b);
+		tasklet_schedule(&tasklet);
+		wait_for_completion(&b->done);
+		tasklet_kill(&tasklet);
+	} else {
+		neon_bench_run(b);
+	}
+	if (b->err)
+		return b->err;
+
+	pr_info("%-8s %-7s: %llu ns per %s\n",
+		pairs ? "begin/end" : "chacha20", softirq ? "softirq" : "task",
+		div_u64(b->ns, max(iterations, 1U)),
+		pairs ? "pair" : "packet");
+	return 0;
+}
+
+static int __init neon_bench_init(void)
+{
+	struct neon_bench b = { };
+	int ret;
+
+	b.tfm = crypto_alloc_skcipher("chacha20", 0, CRYPTO_ALG_ASYNC);
+	if (IS_ERR(b.tfm))
+		return PTR_ERR(b.tfm);
+	pr_info("using %s\n",
+		crypto_tfm_alg_driver_name(crypto_skcipher_tfm(b.tfm)));
+
+	ret = -ENOMEM;
+	b.buf = kzalloc(BENCH_PKT_SIZE, GFP_KERNEL);
+	if (!b.buf)
+		goto out;
+
+	ret = crypto_skcipher_setkey(b.tfm, b.buf, 32);
+	if (ret)
+		goto out;
+
+	ret = neon_bench_one(&b, true, false) ?:
+	      neon_bench_one(&b, true, true) ?:
+	      neon_bench_one(&b, false, false) ?:
+	      neon_bench_one(&b, false, true);
+
+out:
+	kfree(b.buf);
+	crypto_free_skcipher(b.tfm);
+	/* Nothing to keep around once the results are printed */
+	return ret ? ret : -EAGAIN;
+}
+module_init(neon_bench_init);
+
+MODULE_DESCRIPTION("Kernel mode NEON in softirq benchmark");
+MODULE_LICENSE("GPL v2");
@@ -29,6 +29,9 @@ struct sha256_ce_state {
 
 asmlinkage void sha2_ce_transform(struct sha256_ce_state *sst, u8 const *src,
 				  int blocks);
+asmlinkage void sha2_ce_transform2x(u32 *state_a, u32 *state_b,
+				    u8 const *src_a, u8 const *src_b,
+				    int blocks);
 
 const u32 sha256_ce_offsetof_count = offsetof(struct sha256_ce_state,
 					      sst.count);
@@ -103,11 +106,81 @@ static int sha256_ce_final(struct shash_desc *desc, u8 *out)
 	return sha256_base_finish(desc, out);
 }
 
+/*
+ * Finishes two messages of the same length from a common block aligned
+ * state, with their blocks interleaved in the 2-way transform.
+ */
+static void sha256_ce_finup2x(struct shash_desc *desc,
+			      const u8 * const data[], unsigned int len,
+			      u8 * const outs[])
+{
+	struct sha256_ce_state *sctx = shash_desc_ctx(desc);
+	unsigned int digestsize = crypto_shash_digestsize(desc->tfm);
+	u64 bitcount = (sctx->sst.count + len) << 3;
+	unsigned int blocks = len / SHA256_BLOCK_SIZE;
+	unsigned int partial = len % SHA256_BLOCK_SIZE;
+	u8 tail[2][2 * SHA256_BLOCK_SIZE];
+	u32 state[2][SHA256_DIGEST_SIZE / 4];
+	const u8 *src[2] = { data[0], data[1] };
+	unsigned int i, j, n;
+
+	memcpy(state[0], sctx->sst.state, sizeof(state[0]));
+	memcpy(state[1], sctx->sst.state, sizeof(state[1]));
+
+	/* bound the time spent with preemption disabled */
+	while (blocks) {
+		n = min_t(unsigned int, blocks, PAGE_SIZE / SHA256_BLOCK_SIZE);
+		kernel_neon_begin();
+		sha2_ce_transform2x(state[0], state[1], src[0], src[1], n);
+		kernel_neon_end();
+		src[0] += n * SHA256_BLOCK_SIZE;
+		src[1] += n * SHA256_BLOCK_SIZE;
+		blocks -= n;
+	}
+
+	n = partial < SHA256_BLOCK_SIZE - sizeof(__be64) ? 1 : 2;
+	for (i = 0; i < 2; i++) {
+		u8 *end = tail[i] + n * SHA256_BLOCK_SIZE - sizeof(__be64);
+
+		memcpy(tail[i], src[i], partial);
+		tail[i][partial] = 0x80;
+		memset(tail[i] + partial + 1, 0, end - tail[i] - partial - 1);
+		put_unaligned_be64(bitcount, end);
+	}
+	kernel_neon_begin();
+	sha2_ce_transform2x(state[0], state[1], tail[0], tail[1], n);
+	kernel_neon_end();
+
+	for (i = 0; i < 2; i++)
+		for (j = 0; j < digestsize / 4; j++)
+			put_unaligned_be32(state[i][j], outs[i] + 4 * j);
+
+	memzero_explicit(tail, sizeof(tail));
+	memzero_explicit(state, sizeof(state));
+}
+
+static int sha256_ce_finup_mb(struct shash_desc *desc,
+			      const u8 * const data[], unsigned int len,
+			      u8 * const outs[], unsigned int num_msgs)
+{
+	struct sha256_ce_state *sctx = shash_desc_ctx(desc);
+
+	/* buffered partial data would have to be prepended to each lane */
+	if (!may_use_simd() || sctx->sst.count % SHA256_BLOCK_SIZE)
+		return crypto_shash_finup_mb_fallback(desc, data, len, outs,
+						      num_msgs);
+
+	sha256_ce_finup2x(desc, data, len, outs);
+	return 0;
+}
+
 static struct shash_alg algs[] = { {
 	.init			= sha224_base_init,
 	.update			= sha256_ce_update,
 	.final			= sha256_ce_final,
 	.finup			= sha256_ce_finup,
+	.finup_mb		= sha256_ce_finup_mb,
+	.mb_max_msgs		= 2,
 	.descsize		= sizeof(struct sha256_ce_state),
 	.digestsize		= SHA224_DIGEST_SIZE,
 	.base			= {
@@ -122,6 +195,8 @@ static struct shash_alg algs[] = { {
 	.update			= sha256_ce_update,
 	.final			= sha256_ce_final,
 	.finup			= sha256_ce_finup,
+	.finup_mb		= sha256_ce_finup_mb,
+	.mb_max_msgs		= 2,
 	.descsize		= sizeof(struct sha256_ce_state),
 	.digestsize		= SHA256_DIGEST_SIZE,
 	.base			= {
@@ -51,7 +51,9 @@
 #define ARM64_SSBD				30
 #define ARM64_MISMATCHED_CACHE_TYPE		31
 #define ARM64_HAS_STAGE2_FWB			32
+#define ARM64_HAS_INORDER_AES			33
+#define ARM64_HAS_STREAMING_COPY		34
 
-#define ARM64_NCAPS				33
+#define ARM64_NCAPS				35
 
 #endif /* __ASM_CPUCAPS_H */
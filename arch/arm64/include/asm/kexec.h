@@ -30,6 +30,11 @@
 
 #ifndef __ASSEMBLY__
 
+struct resource;
+
+/* Memory preserved across kexec, from "kexec_keep=size@base" */
+extern struct resource kexec_keep_res;
+
 /**
  * crash_setup_regs() - save registers for the panic kernel
  *
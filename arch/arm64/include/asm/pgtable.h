@@ -77,7 +77,11 @@ extern unsigned long empty_zero_page[PAGE_SIZE / sizeof(unsigned long)];
 	__pte(__phys_to_pte_val((phys_addr_t)(pfn) << PAGE_SHIFT) | pgprot_val(prot))
 
 #define pte_none(pte)		(!pte_val(pte))
-#define pte_clear(mm,addr,ptep)	set_pte(ptep, __pte(0))
+#define pte_clear(mm,addr,ptep)					\
+	do {							\
+		contpte_try_unfold(mm, addr, ptep);		\
+		set_pte(ptep, __pte(0));			\
+	} while (0)
 #define pte_page(pte)		(pfn_to_page(pte_pfn(pte)))
 
 /*
@@ -105,6 +109,8 @@ extern unsigned long empty_zero_page[PAGE_SIZE / sizeof(unsigned long)];
 #define pte_dirty(pte)		(pte_sw_dirty(pte) || pte_hw_dirty(pte))
 
 #define pte_valid(pte)		(!!(pte_val(pte) & PTE_VALID))
+#define pte_contpte(pte) \
+	((pte_val(pte) & (PTE_VALID | PTE_CONTPTE)) == (PTE_VALID | PTE_CONTPTE))
 /*
  * Execute-only user mappings do not have the PTE_USER bit set. All valid
  * kernel mappings have the PTE_UXN bit set.
@@ -230,6 +236,24 @@ static inline void set_pte(pte_t *ptep, pte_t pte)
 
 extern void __sync_icache_dcache(pte_t pteval);
 
+/*
+ * Naturally aligned groups of CONT_PTES user ptes mapping physically
+ * contiguous pages with the same attributes are folded into a contiguous
+ * range by update_mmu_cache(). The ptes of such a range must all change at
+ * once, so any update of one of them first unfolds the whole range.
+ */
+extern void __contpte_unfold(struct mm_struct *mm, unsigned long addr,
+			     pte_t *ptep);
+extern void contpte_try_fold(struct vm_area_struct *vma, unsigned long addr,
+			     pte_t *ptep);
+
+static inline void contpte_try_unfold(struct mm_struct *mm, unsigned long addr,
+				      pte_t *ptep)
+{
+	if (unlikely(pte_contpte(READ_ONCE(*ptep))))
+		__contpte_unfold(mm, addr, ptep);
+}
+
 /*
  * PTE bits configuration in the presence of hardware Dirty Bit Management
  * (PTE_WRITE == PTE_DBM):
@@ -250,6 +274,11 @@ static inline void set_pte_at(struct mm_struct *mm, unsigned long addr,
 {
 	pte_t old_pte;
 
+	/* A pte copied from a folded range is not part of one any more */
+	if (pte_contpte(pte))
+		pte = __pte(pte_val(pte) & ~(PTE_CONT | PTE_CONTPTE));
+	contpte_try_unfold(mm, addr, ptep);
+
 	if (pte_present(pte) && pte_user_exec(pte) && !pte_special(pte))
 		__sync_icache_dcache(pte);
 
@@ -643,6 +672,7 @@ static inline int ptep_test_and_clear_young(struct vm_area_struct *vma,
 					    unsigned long address,
 					    pte_t *ptep)
 {
+	contpte_try_unfold(vma->vm_mm, address, ptep);
 	return __ptep_test_and_clear_young(ptep);
 }
 
@@ -660,6 +690,7 @@ static inline int pmdp_test_and_clear_young(struct vm_area_struct *vma,
 static inline pte_t ptep_get_and_clear(struct mm_struct *mm,
 				       unsigned long address, pte_t *ptep)
 {
+	contpte_try_unfold(mm, address, ptep);
 	return __pte(xchg_relaxed(&pte_val(*ptep), 0));
 }
 
@@ -681,6 +712,7 @@ static inline void ptep_set_wrprotect(struct mm_struct *mm, unsigned long addres
 {
 	pte_t old_pte, pte;
 
+	contpte_try_unfold(mm, address, ptep);
 	pte = READ_ONCE(*ptep);
 	do {
 		old_pte = pte;
@@ -753,15 +785,17 @@ void pgd_cache_init(void);
 
 /*
  * On AArch64, the cache coherency is handled via the set_pte_at() function.
+ * The only thing left to do is to try to fold the range the pte is part of.
  */
 static inline void update_mmu_cache(struct vm_area_struct *vma,
 				    unsigned long addr, pte_t *ptep)
 {
 	/*
-	 * We don't do anything here, so there's a very small chance of
+	 * There is no barrier here, so there's a very small chance of
 	 * us retaking a user fault which we just fixed up. The alternative
 	 * is doing a dsb(ishst), but that penalises the fastpath.
 	 */
+	contpte_try_fold(vma, addr, ptep);
 }
 
 #define update_mmu_cache_pmd(vma, address, pmd) do { } while (0)
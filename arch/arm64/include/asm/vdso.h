@@ -18,6 +18,8 @@
 
 #ifdef __KERNEL__
 
+#include <linux/const.h>
+
 /*
  * Default link address for the vDSO.
  * Since we randomise the VDSO mapping, there's little point in trying
@@ -25,8 +27,18 @@
  */
 #define VDSO_LBASE	0x0
 
+/*
+ * Native tasks find the CPU and NUMA node they run on in TPIDRRO_EL0, for
+ * __kernel_getcpu(). The value is only valid when VDSO_CPU_VALID is set.
+ */
+#define VDSO_CPU_VALID_BIT	63
+#define VDSO_CPU_VALID		(_AC(1, UL) << VDSO_CPU_VALID_BIT)
+#define VDSO_CPU_NODE_SHIFT	32
+
 #ifndef __ASSEMBLY__
 
+#include <linux/percpu.h>
+
 #include <generated/vdso-offsets.h>
 
 #define VDSO_SYMBOL(base, name)						   \
@@ -34,6 +46,8 @@
 	(void *)(vdso_offset_##name - VDSO_LBASE + (unsigned long)(base)); \
 })
 
+DECLARE_PER_CPU_READ_MOSTLY(u64, vdso_cpu_id);
+
 #endif /* !__ASSEMBLY__ */
 
 #endif /* __KERNEL__ */
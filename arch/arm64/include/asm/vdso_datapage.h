@@ -38,6 +38,9 @@ struct vdso_data {
 	__u32 tz_minuteswest;	/* Whacky timezone stuff */
 	__u32 tz_dsttime;
 	__u32 use_syscall;
+	__u32 tai_offset;	/* Realtime to TAI offset, in seconds */
+	__u64 btm_clock_sec;	/* Wall to boottime */
+	__u64 btm_clock_nsec;
 };
 
 #endif /* !__ASSEMBLY__ */
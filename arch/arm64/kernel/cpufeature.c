@@ -839,6 +839,18 @@ static bool has_no_hw_prefetch(const struct arm64_cpu_capabilities *entry, int _
 		MIDR_CPU_VAR_REV(1, MIDR_REVISION_MASK));
 }
 
+/*
+ * Cortex-A53: in-order, no AESE/AESMC fusion, and a small shared L2 that
+ * large copies should stream through rather than fill.
+ */
+static bool is_cortex_a53(const struct arm64_cpu_capabilities *entry,
+			  int __unused)
+{
+	u32 model = read_cpuid_id() & MIDR_CPU_MODEL_MASK;
+
+	return model == MIDR_CORTEX_A53;
+}
+
 static bool has_no_fpsimd(const struct arm64_cpu_capabilities *entry, int __unused)
 {
 	u64 pfr0 = read_sanitised_ftr_reg(SYS_ID_AA64PFR0_EL1);
@@ -1091,6 +1103,18 @@ static const struct arm64_cpu_capabilities arm64_features[] = {
 		.type = ARM64_CPUCAP_WEAK_LOCAL_CPU_FEATURE,
 		.matches = has_no_hw_prefetch,
 	},
+	{
+		.desc = "In-order AES instruction scheduling",
+		.capability = ARM64_HAS_INORDER_AES,
+		.type = ARM64_CPUCAP_WEAK_LOCAL_CPU_FEATURE,
+		.matches = is_cortex_a53,
+	},
+	{
+		.desc = "Streaming prefetch and non-temporal stores for copies",
+		.capability = ARM64_HAS_STREAMING_COPY,
+		.type = ARM64_CPUCAP_WEAK_LOCAL_CPU_FEATURE,
+		.matches = is_cortex_a53,
+	},
 #ifdef CONFIG_ARM64_UAO
 	{
 		.desc = "User Access Override",
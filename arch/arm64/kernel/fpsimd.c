@@ -1088,9 +1088,27 @@ void kernel_neon_begin(void)
 
 	BUG_ON(!may_use_simd());
 
-	local_bh_disable();
+	preempt_disable();
 
+	/*
+	 * Once kernel_neon_busy is set, softirqs don't touch the registers,
+	 * so they can be inspected with softirqs enabled.
+	 */
 	__this_cpu_write(kernel_neon_busy, true);
+	barrier();
+
+	/*
+	 * If the registers hold no task state, an earlier kernel_neon_begin()
+	 * since the last return to userspace already saved and invalidated
+	 * it, and nothing can load it back before we return there. This is
+	 * the common case for back to back NEON users, in softirqs and
+	 * kernel threads in particular.
+	 */
+	if (test_thread_flag(TIF_FOREIGN_FPSTATE) &&
+	    !__this_cpu_read(fpsimd_last_state.st))
+		return;
+
+	local_bh_disable();
 
 	/* Save unsaved fpsimd state, if any: */
 	fpsimd_save();
@@ -1098,8 +1116,6 @@ void kernel_neon_begin(void)
 	/* Invalidate any task state remaining in the fpsimd regs: */
 	fpsimd_flush_cpu_state();
 
-	preempt_disable();
-
 	local_bh_enable();
 }
 EXPORT_SYMBOL(kernel_neon_begin);
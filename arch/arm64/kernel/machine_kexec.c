@@ -70,6 +70,8 @@ void machine_kexec_cleanup(struct kimage *kimage)
  */
 int machine_kexec_prepare(struct kimage *kimage)
 {
+	unsigned long i;
+
 	kexec_image_info(kimage);
 
 	if (kimage->type != KEXEC_TYPE_CRASH && cpus_are_stuck_in_kernel()) {
@@ -77,6 +79,17 @@ int machine_kexec_prepare(struct kimage *kimage)
 		return -EBUSY;
 	}
 
+	for (i = 0; i < kimage->nr_segments; i++) {
+		struct kexec_segment *seg = &kimage->segment[i];
+
+		if (kexec_keep_res.end && seg->mem <= kexec_keep_res.end &&
+		    seg->mem + seg->memsz > kexec_keep_res.start) {
+			pr_err("Can't kexec: segment %lu overlaps the kexec_keep region.\n",
+			       i);
+			return -EINVAL;
+		}
+	}
+
 	return 0;
 }
 
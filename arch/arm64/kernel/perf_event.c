@@ -174,7 +174,22 @@
 #define ARMV8_IMPDEF_PERFCTR_L3D_CACHE_INVAL			0xA8
 
 /* ARMv8 Cortex-A53 specific event types. */
+#define ARMV8_A53_PERFCTR_EXT_MEM_REQ				0xC0
+#define ARMV8_A53_PERFCTR_EXT_MEM_REQ_NC			0xC1
 #define ARMV8_A53_PERFCTR_PREF_LINEFILL				0xC2
+#define ARMV8_A53_PERFCTR_PREF_LINEFILL_DROP			0xC3
+#define ARMV8_A53_PERFCTR_READ_ALLOC_ENTER			0xC4
+#define ARMV8_A53_PERFCTR_READ_ALLOC				0xC5
+#define ARMV8_A53_PERFCTR_EXT_SNOOP				0xC8
+#define ARMV8_A53_PERFCTR_OTHER_IQ_DEP_STALL			0xE0
+#define ARMV8_A53_PERFCTR_IC_DEP_STALL				0xE1
+#define ARMV8_A53_PERFCTR_IUTLB_DEP_STALL			0xE2
+#define ARMV8_A53_PERFCTR_DECODE_DEP_STALL			0xE3
+#define ARMV8_A53_PERFCTR_OTHER_INTERLOCK_STALL			0xE4
+#define ARMV8_A53_PERFCTR_AGU_DEP_STALL				0xE5
+#define ARMV8_A53_PERFCTR_SIMD_DEP_STALL			0xE6
+#define ARMV8_A53_PERFCTR_LD_DEP_STALL				0xE7
+#define ARMV8_A53_PERFCTR_ST_DEP_STALL				0xE8
 
 /* ARMv8 Cavium ThunderX specific event types. */
 #define ARMV8_THUNDER_PERFCTR_L1D_CACHE_MISS_ST			0xE9
@@ -434,7 +449,9 @@ armv8pmu_event_attr_is_visible(struct kobject *kobj,
 
 	pmu_attr = container_of(attr, struct perf_pmu_events_attr, attr.attr);
 
-	if (test_bit(pmu_attr->id, cpu_pmu->pmceid_bitmap))
+	/* IMPDEF events are only listed for the cores implementing them */
+	if (pmu_attr->id >= ARMV8_PMUV3_MAX_COMMON_EVENTS ||
+	    test_bit(pmu_attr->id, cpu_pmu->pmceid_bitmap))
 		return attr->mode;
 
 	return 0;
@@ -446,6 +463,64 @@ static struct attribute_group armv8_pmuv3_events_attr_group = {
 	.is_visible = armv8pmu_event_attr_is_visible,
 };
 
+/*
+ * Cortex-A53 IMPDEF events. The A53 implements neither STALL_FRONTEND nor
+ * STALL_BACKEND: the *_iq_dep_stall, ic_dep_stall, iutlb_dep_stall and
+ * decode_dep_stall events break down the cycles the core is starved of
+ * instructions, the *_interlock_stall and *_dep_stall ones the cycles it
+ * waits for operands or memory.
+ */
+ARMV8_EVENT_ATTR(bus_access_ld, ARMV8_IMPDEF_PERFCTR_BUS_ACCESS_RD);
+ARMV8_EVENT_ATTR(bus_access_st, ARMV8_IMPDEF_PERFCTR_BUS_ACCESS_WR);
+ARMV8_EVENT_ATTR(ext_mem_req, ARMV8_A53_PERFCTR_EXT_MEM_REQ);
+ARMV8_EVENT_ATTR(ext_mem_req_nc, ARMV8_A53_PERFCTR_EXT_MEM_REQ_NC);
+ARMV8_EVENT_ATTR(prefetch_linefill, ARMV8_A53_PERFCTR_PREF_LINEFILL);
+ARMV8_EVENT_ATTR(prefetch_linefill_drop, ARMV8_A53_PERFCTR_PREF_LINEFILL_DROP);
+ARMV8_EVENT_ATTR(read_alloc_enter, ARMV8_A53_PERFCTR_READ_ALLOC_ENTER);
+ARMV8_EVENT_ATTR(read_alloc, ARMV8_A53_PERFCTR_READ_ALLOC);
+ARMV8_EVENT_ATTR(ext_snoop, ARMV8_A53_PERFCTR_EXT_SNOOP);
+ARMV8_EVENT_ATTR(other_iq_dep_stall, ARMV8_A53_PERFCTR_OTHER_IQ_DEP_STALL);
+ARMV8_EVENT_ATTR(ic_dep_stall, ARMV8_A53_PERFCTR_IC_DEP_STALL);
+ARMV8_EVENT_ATTR(iutlb_dep_stall, ARMV8_A53_PERFCTR_IUTLB_DEP_STALL);
+ARMV8_EVENT_ATTR(decode_dep_stall, ARMV8_A53_PERFCTR_DECODE_DEP_STALL);
+ARMV8_EVENT_ATTR(other_interlock_stall, ARMV8_A53_PERFCTR_OTHER_INTERLOCK_STALL);
+ARMV8_EVENT_ATTR(agu_dep_stall, ARMV8_A53_PERFCTR_AGU_DEP_STALL);
+ARMV8_EVENT_ATTR(simd_dep_stall, ARMV8_A53_PERFCTR_SIMD_DEP_STALL);
+ARMV8_EVENT_ATTR(ld_dep_stall, ARMV8_A53_PERFCTR_LD_DEP_STALL);
+ARMV8_EVENT_ATTR(st_dep_stall, ARMV8_A53_PERFCTR_ST_DEP_STALL);
+
+static struct attribute *armv8_a53_impdef_event_attrs[] = {
+	&armv8_event_attr_bus_access_ld.attr.attr,
+	&armv8_event_attr_bus_access_st.attr.attr,
+	&armv8_event_attr_ext_mem_req.attr.attr,
+	&armv8_event_attr_ext_mem_req_nc.attr.attr,
+	&armv8_event_attr_prefetch_linefill.attr.attr,
+	&armv8_event_attr_prefetch_linefill_drop.attr.attr,
+	&armv8_event_attr_read_alloc_enter.attr.attr,
+	&armv8_event_attr_read_alloc.attr.attr,
+	&armv8_event_attr_ext_snoop.attr.attr,
+	&armv8_event_attr_other_iq_dep_stall.attr.attr,
+	&armv8_event_attr_ic_dep_stall.attr.attr,
+	&armv8_event_attr_iutlb_dep_stall.attr.attr,
+	&armv8_event_attr_decode_dep_stall.attr.attr,
+	&armv8_event_attr_other_interlock_stall.attr.attr,
+	&armv8_event_attr_agu_dep_stall.attr.attr,
+	&armv8_event_attr_simd_dep_stall.attr.attr,
+	&armv8_event_attr_ld_dep_stall.attr.attr,
+	&armv8_event_attr_st_dep_stall.attr.attr,
+	NULL,
+};
+
+/* The common events followed by the A53 ones, see armv8_a53_pmu_init() */
+static struct attribute *armv8_a53_event_attrs[ARRAY_SIZE(armv8_pmuv3_event_attrs) +
+					       ARRAY_SIZE(armv8_a53_impdef_event_attrs) - 1];
+
+static struct attribute_group armv8_a53_events_attr_group = {
+	.name = "events",
+	.attrs = armv8_a53_event_attrs,
+	.is_visible = armv8pmu_event_attr_is_visible,
+};
+
 PMU_FORMAT_ATTR(event, "config:0-15");
 PMU_FORMAT_ATTR(long, "config1:0");
 
@@ -1163,10 +1238,16 @@ static int armv8_a53_pmu_init(struct arm_pmu *cpu_pmu)
 	if (ret)
 		return ret;
 
+	memcpy(armv8_a53_event_attrs, armv8_pmuv3_event_attrs,
+	       sizeof(armv8_pmuv3_event_attrs) - sizeof(struct attribute *));
+	memcpy(armv8_a53_event_attrs + ARRAY_SIZE(armv8_pmuv3_event_attrs) - 1,
+	       armv8_a53_impdef_event_attrs,
+	       sizeof(armv8_a53_impdef_event_attrs));
+
 	cpu_pmu->name			= "armv8_cortex_a53";
 	cpu_pmu->map_event		= armv8_a53_map_event;
 	cpu_pmu->attr_groups[ARMPMU_ATTR_GROUP_EVENTS] =
-		&armv8_pmuv3_events_attr_group;
+		&armv8_a53_events_attr_group;
 	cpu_pmu->attr_groups[ARMPMU_ATTR_GROUP_FORMATS] =
 		&armv8_pmuv3_format_attr_group;
 
@@ -245,6 +245,9 @@ static void __init request_standard_resources(void)
 		if (crashk_res.end && crashk_res.start >= res->start &&
 		    crashk_res.end <= res->end)
 			request_resource(res, &crashk_res);
+		if (kexec_keep_res.end && kexec_keep_res.start >= res->start &&
+		    kexec_keep_res.end <= res->end)
+			request_resource(res, &kexec_keep_res);
 #endif
 	}
 }
@@ -134,12 +134,22 @@ static struct vm_special_mapping vdso_spec[2] __ro_after_init = {
 	},
 };
 
+/*
+ * The value seen in TPIDRRO_EL0 by native tasks on each CPU, read by
+ * __kernel_getcpu().
+ */
+DEFINE_PER_CPU_READ_MOSTLY(u64, vdso_cpu_id);
+
 static int __init vdso_init(void)
 {
 	int i;
 	struct page **vdso_pagelist;
 	unsigned long pfn;
 
+	for_each_possible_cpu(i)
+		per_cpu(vdso_cpu_id, i) = VDSO_CPU_VALID | i |
+			((u64)cpu_to_node(i) << VDSO_CPU_NODE_SHIFT);
+
 	if (memcmp(vdso_start, "\177ELF", 4)) {
 		pr_err("vDSO is not a valid ELF object!\n");
 		return -EINVAL;
@@ -221,6 +231,10 @@ up_fail:
 void update_vsyscall(struct timekeeper *tk)
 {
 	u32 use_syscall = !tk->tkr_mono.clock->archdata.vdso_direct;
+	struct timespec64 btm;
+
+	btm = timespec64_add(tk->wall_to_monotonic,
+			     ktime_to_timespec64(tk->offs_boot));
 
 	++vdso_data->tb_seq_count;
 	smp_wmb();
@@ -231,6 +245,9 @@ void update_vsyscall(struct timekeeper *tk)
 							tk->tkr_mono.shift;
 	vdso_data->wtm_clock_sec		= tk->wall_to_monotonic.tv_sec;
 	vdso_data->wtm_clock_nsec		= tk->wall_to_monotonic.tv_nsec;
+	vdso_data->btm_clock_sec		= btm.tv_sec;
+	vdso_data->btm_clock_nsec		= btm.tv_nsec;
+	vdso_data->tai_offset			= tk->tai_offset;
 
 	if (!use_syscall) {
 		/* tkr_mono.cycle_last == tkr_raw.cycle_last */
@@ -18,7 +18,9 @@
  */
 
 #include <linux/bitops.h>
+#include <linux/debugfs.h>
 #include <linux/sched.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/mm.h>
 
@@ -37,6 +39,32 @@ static DEFINE_PER_CPU(atomic64_t, active_asids);
 static DEFINE_PER_CPU(u64, reserved_asids);
 static cpumask_t tlb_flush_pending;
 
+/*
+ * The ASIDs of freed mms are invalidated and kept in a small per-CPU cache,
+ * from which the next new mm scheduled on the CPU gets its ASID without
+ * taking cpu_asid_lock. Cached ASIDs are only valid for the generation they
+ * were freed in, and the cache is simply dropped after a rollover. Besides
+ * the lock, this makes rollovers rarer, as ASIDs no longer stay allocated
+ * until the next one once their mm is gone.
+ */
+#define ASID_CACHE_SIZE		16
+
+struct asid_cache {
+	u64		generation;
+	unsigned int	nr;
+	u64		asids[ASID_CACHE_SIZE];
+};
+
+struct asid_stats {
+	unsigned long	rollovers;
+	unsigned long	slow_allocs;
+	unsigned long	cache_allocs;
+	unsigned long	recycled;
+};
+
+static DEFINE_PER_CPU(struct asid_cache, asid_cache);
+static DEFINE_PER_CPU(struct asid_stats, asid_stats);
+
 #define ASID_MASK		(~GENMASK(asid_bits - 1, 0))
 #define ASID_FIRST_VERSION	(1UL << asid_bits)
 
@@ -177,10 +205,16 @@ static u64 new_context(struct mm_struct *mm, unsigned int cpu)
 	if (asid != NUM_USER_ASIDS)
 		goto set_asid;
 
+	/* ASIDs released by release_context() may be free behind us */
+	asid = find_next_zero_bit(asid_map, cur_idx, 1);
+	if (asid != cur_idx)
+		goto set_asid;
+
 	/* We're out of ASIDs, so increment the global generation count */
 	generation = atomic64_add_return_relaxed(ASID_FIRST_VERSION,
 						 &asid_generation);
 	flush_context(cpu);
+	this_cpu_inc(asid_stats.rollovers);
 
 	/* We have more ASIDs than CPUs, so this will always succeed */
 	asid = find_next_zero_bit(asid_map, NUM_USER_ASIDS, 1);
@@ -191,6 +225,78 @@ set_asid:
 	return idx2asid(asid) | generation;
 }
 
+static bool asid_is_reserved(u64 asid)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		if (per_cpu(reserved_asids, cpu) == asid)
+			return true;
+
+	return false;
+}
+
+/* Called with interrupts disabled */
+static u64 asid_cache_get(u64 generation)
+{
+	struct asid_cache *c = this_cpu_ptr(&asid_cache);
+
+	if (c->generation != generation || !c->nr)
+		return 0;
+
+	return c->asids[--c->nr];
+}
+
+/* Called with interrupts disabled */
+static bool asid_cache_put(u64 asid, u64 generation)
+{
+	struct asid_cache *c = this_cpu_ptr(&asid_cache);
+
+	if (c->generation != generation) {
+		c->generation = generation;
+		c->nr = 0;
+	}
+	if (c->nr == ASID_CACHE_SIZE)
+		return false;
+
+	c->asids[c->nr++] = asid;
+	return true;
+}
+
+/*
+ * Give a new mm an ASID from the local cache. This is only correct for an
+ * mm without any ASID yet, which cannot be reserved or found in any TLB.
+ * Installing it in active_asids follows the same rules as the fast path of
+ * check_and_switch_context(), so that a concurrent rollover either sees it
+ * as active or makes us take the slow path.
+ */
+static bool new_context_cached(struct mm_struct *mm, unsigned int cpu)
+{
+	u64 generation = atomic64_read(&asid_generation);
+	u64 old_active_asid, asid;
+
+	old_active_asid = atomic64_read(&per_cpu(active_asids, cpu));
+	if (!old_active_asid)
+		return false;
+
+	asid = asid_cache_get(generation);
+	if (!asid)
+		return false;
+
+	if (atomic64_cmpxchg_relaxed(&mm->context.id, 0, asid)) {
+		/* Another thread of the mm got there first */
+		asid_cache_put(asid, generation);
+		return false;
+	}
+
+	if (!atomic64_cmpxchg_relaxed(&per_cpu(active_asids, cpu),
+				      old_active_asid, asid))
+		return false;
+
+	this_cpu_inc(asid_stats.cache_allocs);
+	return true;
+}
+
 void check_and_switch_context(struct mm_struct *mm, unsigned int cpu)
 {
 	unsigned long flags;
@@ -198,6 +304,9 @@ void check_and_switch_context(struct mm_struct *mm, unsigned int cpu)
 
 	asid = atomic64_read(&mm->context.id);
 
+	if (!asid && new_context_cached(mm, cpu))
+		goto switch_mm_fastpath;
+
 	/*
 	 * The memory ordering here is subtle.
 	 * If our active_asids is non-zero and the ASID matches the current
@@ -225,6 +334,7 @@ void check_and_switch_context(struct mm_struct *mm, unsigned int cpu)
 	if ((asid ^ atomic64_read(&asid_generation)) >> asid_bits) {
 		asid = new_context(mm, cpu);
 		atomic64_set(&mm->context.id, asid);
+		this_cpu_inc(asid_stats.slow_allocs);
 	}
 
 	if (cpumask_test_and_clear_cpu(cpu, &tlb_flush_pending))
@@ -245,6 +355,78 @@ switch_mm_fastpath:
 		cpu_switch_mm(mm->pgd, mm);
 }
 
+/*
+ * Called when the last reference to mm is dropped, so no CPU has it in TTBR0
+ * any more. Once its TLB entries are invalidated everywhere, its ASID can be
+ * given to another mm in the same generation.
+ */
+void release_context(struct mm_struct *mm)
+{
+	u64 asid = atomic64_read(&mm->context.id);
+	u64 generation = asid & ASID_MASK;
+	unsigned long flags;
+	bool cached;
+
+	if (!asid || generation != atomic64_read(&asid_generation) ||
+	    asid_is_reserved(asid))
+		return;
+
+	flush_tlb_mm(mm);
+
+	local_irq_save(flags);
+	cached = asid_cache_put(asid, generation);
+	if (cached)
+		this_cpu_inc(asid_stats.recycled);
+	local_irq_restore(flags);
+	if (cached)
+		return;
+
+	raw_spin_lock_irqsave(&cpu_asid_lock, flags);
+	if (generation == atomic64_read(&asid_generation) &&
+	    !asid_is_reserved(asid)) {
+		__clear_bit(asid2idx(asid), asid_map);
+		this_cpu_inc(asid_stats.recycled);
+	}
+	raw_spin_unlock_irqrestore(&cpu_asid_lock, flags);
+}
+
+#ifdef CONFIG_DEBUG_FS
+static int asid_stats_show(struct seq_file *m, void *v)
+{
+	struct asid_stats *st;
+	int cpu;
+
+	seq_puts(m, "cpu  rollovers slow_allocs cache_allocs   recycled\n");
+	for_each_possible_cpu(cpu) {
+		st = per_cpu_ptr(&asid_stats, cpu);
+		seq_printf(m, "%3d %10lu %11lu %12lu %10lu\n", cpu,
+			   READ_ONCE(st->rollovers), READ_ONCE(st->slow_allocs),
+			   READ_ONCE(st->cache_allocs), READ_ONCE(st->recycled));
+	}
+
+	return 0;
+}
+
+static int asid_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, asid_stats_show, NULL);
+}
+
+static const struct file_operations asid_stats_fops = {
+	.open		= asid_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init asid_stats_init(void)
+{
+	debugfs_create_file("asid_stats", 0400, NULL, NULL, &asid_stats_fops);
+	return 0;
+}
+late_initcall(asid_stats_init);
+#endif
+
 /* Errata workaround post TTBRx_EL1 update. */
 asmlinkage void post_ttbr_update_workaround(void)
 {
@@ -21,6 +21,7 @@
 #include <linux/acpi.h>
 #include <linux/bootmem.h>
 #include <linux/cache.h>
+#include <linux/debugfs.h>
 #include <linux/export.h>
 #include <linux/slab.h>
 #include <linux/genalloc.h>
@@ -29,9 +30,14 @@
 #include <linux/vmalloc.h>
 #include <linux/swiotlb.h>
 #include <linux/pci.h>
+#include <linux/seq_file.h>
+#include <linux/timex.h>
 
 #include <asm/cacheflush.h>
 
+#define CREATE_TRACE_POINTS
+#include "trace-events-dma.h"
+
 static int swiotlb __ro_after_init;
 
 static pgprot_t __get_dma_pgprot(unsigned long attrs, pgprot_t prot,
@@ -54,6 +60,99 @@ static int __init early_coherent_pool(char *p)
 }
 early_param("coherent_pool", early_coherent_pool);
 
+/*
+ * Allocations of up to 64K are rounded up to a power of two number of pages,
+ * and the blocks of each size are recycled through small per-CPU caches in
+ * front of the gen_pool. Freeing and reallocating the same sizes over and
+ * over then neither searches nor fragments the pool. Each cache holds at
+ * most an eighth of the pool divided by the number of CPUs.
+ */
+#define ATOMIC_POOL_NR_CLASSES	(PAGE_SHIFT < 16 ? 16 - PAGE_SHIFT + 1 : 1)
+#define ATOMIC_POOL_CACHE_MAX	16
+
+struct atomic_pool_cache {
+	unsigned int	count;
+	unsigned long	objs[ATOMIC_POOL_CACHE_MAX];
+	unsigned long	allocs;
+	unsigned long	hits;
+	unsigned long	fails;
+};
+
+static DEFINE_PER_CPU(struct atomic_pool_cache,
+		      atomic_pool_cache[ATOMIC_POOL_NR_CLASSES]);
+static unsigned int atomic_pool_cache_limit[ATOMIC_POOL_NR_CLASSES] __ro_after_init;
+
+static void __atomic_pool_drain_local(void)
+{
+	struct atomic_pool_cache *c;
+	unsigned long flags;
+	unsigned int order;
+
+	local_irq_save(flags);
+	for (order = 0; order < ATOMIC_POOL_NR_CLASSES; order++) {
+		c = this_cpu_ptr(&atomic_pool_cache[order]);
+		while (c->count)
+			gen_pool_free(atomic_pool, c->objs[--c->count],
+				      PAGE_SIZE << order);
+	}
+	local_irq_restore(flags);
+}
+
+static unsigned long __atomic_pool_get(size_t size)
+{
+	unsigned int order = get_order(size);
+	struct atomic_pool_cache *c;
+	unsigned long flags, val = 0;
+
+	if (order >= ATOMIC_POOL_NR_CLASSES)
+		return gen_pool_alloc(atomic_pool, size);
+
+	local_irq_save(flags);
+	c = this_cpu_ptr(&atomic_pool_cache[order]);
+	c->allocs++;
+	if (c->count) {
+		val = c->objs[--c->count];
+		c->hits++;
+	}
+	local_irq_restore(flags);
+	if (val)
+		return val;
+
+	val = gen_pool_alloc(atomic_pool, PAGE_SIZE << order);
+	if (!val) {
+		/* What this CPU holds may be enough to satisfy the request */
+		__atomic_pool_drain_local();
+		val = gen_pool_alloc(atomic_pool, PAGE_SIZE << order);
+	}
+	if (!val)
+		this_cpu_inc(atomic_pool_cache[order].fails);
+
+	return val;
+}
+
+static void __atomic_pool_put(unsigned long val, size_t size)
+{
+	unsigned int order = get_order(size);
+	struct atomic_pool_cache *c;
+	unsigned long flags;
+
+	if (order >= ATOMIC_POOL_NR_CLASSES) {
+		gen_pool_free(atomic_pool, val, size);
+		return;
+	}
+
+	local_irq_save(flags);
+	c = this_cpu_ptr(&atomic_pool_cache[order]);
+	if (c->count < atomic_pool_cache_limit[order]) {
+		c->objs[c->count++] = val;
+		val = 0;
+	}
+	local_irq_restore(flags);
+
+	if (val)
+		gen_pool_free(atomic_pool, val, PAGE_SIZE << order);
+}
+
 static void *__alloc_from_pool(size_t size, struct page **ret_page, gfp_t flags)
 {
 	unsigned long val;
@@ -64,7 +163,7 @@ static void *__alloc_from_pool(size_t size, struct page **ret_page, gfp_t flags)
 		return NULL;
 	}
 
-	val = gen_pool_alloc(atomic_pool, size);
+	val = __atomic_pool_get(size);
 	if (val) {
 		phys_addr_t phys = gen_pool_virt_to_phys(atomic_pool, val);
 
@@ -86,7 +185,7 @@ static int __free_from_pool(void *start, size_t size)
 	if (!__in_atomic_pool(start, size))
 		return 0;
 
-	gen_pool_free(atomic_pool, (unsigned long)start, size);
+	__atomic_pool_put((unsigned long)start, size);
 
 	return 1;
 }
@@ -154,6 +253,54 @@ static void __dma_free(struct device *dev, size_t size,
 	swiotlb_free(dev, size, swiotlb_addr, dma_handle, attrs);
 }
 
+static void __dma_maint_range(phys_addr_t start, size_t len,
+			      enum dma_data_direction dir, bool for_device)
+{
+	if (for_device)
+		__dma_map_area(phys_to_virt(start), len, dir);
+	else
+		__dma_unmap_area(phys_to_virt(start), len, dir);
+}
+
+/*
+ * Do the cache maintenance of a scatterlist, merging the entries which are
+ * physically contiguous so that each range is walked in a single call. This
+ * avoids the call overhead for each entry, and the cache lines shared by two
+ * entries being cleaned or invalidated twice.
+ */
+static void __dma_sg_maint(struct device *dev, struct scatterlist *sgl,
+			   int nelems, enum dma_data_direction dir,
+			   bool for_device)
+{
+	struct scatterlist *sg;
+	phys_addr_t start = 0, phys;
+	size_t len = 0, total = 0;
+	int i, ranges = 0;
+	u64 t = get_cycles();
+
+	for_each_sg(sgl, sg, nelems, i) {
+		phys = dma_to_phys(dev, sg->dma_address);
+		total += sg->length;
+		if (len && phys == start + len) {
+			len += sg->length;
+			continue;
+		}
+		if (len) {
+			__dma_maint_range(start, len, dir, for_device);
+			ranges++;
+		}
+		start = phys;
+		len = sg->length;
+	}
+	if (len) {
+		__dma_maint_range(start, len, dir, for_device);
+		ranges++;
+	}
+
+	trace_dma_cache_maint(dev, dir, for_device, nelems, ranges, total,
+			      get_cycles() - t);
+}
+
 static dma_addr_t __swiotlb_map_page(struct device *dev, struct page *page,
 				     unsigned long offset, size_t size,
 				     enum dma_data_direction dir,
@@ -184,15 +331,12 @@ static int __swiotlb_map_sg_attrs(struct device *dev, struct scatterlist *sgl,
 				  int nelems, enum dma_data_direction dir,
 				  unsigned long attrs)
 {
-	struct scatterlist *sg;
-	int i, ret;
+	int ret;
 
 	ret = swiotlb_map_sg_attrs(dev, sgl, nelems, dir, attrs);
 	if (!is_device_dma_coherent(dev) &&
 	    (attrs & DMA_ATTR_SKIP_CPU_SYNC) == 0)
-		for_each_sg(sgl, sg, ret, i)
-			__dma_map_area(phys_to_virt(dma_to_phys(dev, sg->dma_address)),
-				       sg->length, dir);
+		__dma_sg_maint(dev, sgl, ret, dir, true);
 
 	return ret;
 }
@@ -202,14 +346,9 @@ static void __swiotlb_unmap_sg_attrs(struct device *dev,
 				     enum dma_data_direction dir,
 				     unsigned long attrs)
 {
-	struct scatterlist *sg;
-	int i;
-
 	if (!is_device_dma_coherent(dev) &&
 	    (attrs & DMA_ATTR_SKIP_CPU_SYNC) == 0)
-		for_each_sg(sgl, sg, nelems, i)
-			__dma_unmap_area(phys_to_virt(dma_to_phys(dev, sg->dma_address)),
-					 sg->length, dir);
+		__dma_sg_maint(dev, sgl, nelems, dir, false);
 	swiotlb_unmap_sg_attrs(dev, sgl, nelems, dir, attrs);
 }
 
@@ -235,13 +374,8 @@ static void __swiotlb_sync_sg_for_cpu(struct device *dev,
 				      struct scatterlist *sgl, int nelems,
 				      enum dma_data_direction dir)
 {
-	struct scatterlist *sg;
-	int i;
-
 	if (!is_device_dma_coherent(dev))
-		for_each_sg(sgl, sg, nelems, i)
-			__dma_unmap_area(phys_to_virt(dma_to_phys(dev, sg->dma_address)),
-					 sg->length, dir);
+		__dma_sg_maint(dev, sgl, nelems, dir, false);
 	swiotlb_sync_sg_for_cpu(dev, sgl, nelems, dir);
 }
 
@@ -249,14 +383,9 @@ static void __swiotlb_sync_sg_for_device(struct device *dev,
 					 struct scatterlist *sgl, int nelems,
 					 enum dma_data_direction dir)
 {
-	struct scatterlist *sg;
-	int i;
-
 	swiotlb_sync_sg_for_device(dev, sgl, nelems, dir);
 	if (!is_device_dma_coherent(dev))
-		for_each_sg(sgl, sg, nelems, i)
-			__dma_map_area(phys_to_virt(dma_to_phys(dev, sg->dma_address)),
-				       sg->length, dir);
+		__dma_sg_maint(dev, sgl, nelems, dir, true);
 }
 
 static int __swiotlb_mmap_pfn(struct vm_area_struct *vma,
@@ -360,7 +489,7 @@ static int __init atomic_pool_init(void)
 		page = alloc_pages(GFP_DMA32, pool_size_order);
 
 	if (page) {
-		int ret;
+		int i, ret;
 		void *page_addr = page_address(page);
 
 		memset(page_addr, 0, atomic_pool_size);
@@ -386,6 +515,12 @@ static int __init atomic_pool_init(void)
 				  gen_pool_first_fit_order_align,
 				  NULL);
 
+		for (i = 0; i < ATOMIC_POOL_NR_CLASSES; i++)
+			atomic_pool_cache_limit[i] =
+				min_t(size_t, ATOMIC_POOL_CACHE_MAX,
+				      atomic_pool_size / 8 / num_possible_cpus() >>
+				      (PAGE_SHIFT + i));
+
 		pr_info("DMA: preallocated %zu KiB pool for atomic allocations\n",
 			atomic_pool_size / 1024);
 		return 0;
@@ -406,6 +541,87 @@ out:
 	return -ENOMEM;
 }
 
+#ifdef CONFIG_DEBUG_FS
+struct atomic_pool_frag {
+	size_t	largest;
+	size_t	nr_free;
+};
+
+static void atomic_pool_frag_chunk(struct gen_pool *pool,
+				   struct gen_pool_chunk *chunk, void *data)
+{
+	struct atomic_pool_frag *frag = data;
+	int order = pool->min_alloc_order;
+	unsigned long nbits = (chunk->end_addr - chunk->start_addr + 1) >> order;
+	unsigned long start, end;
+
+	start = find_next_zero_bit(chunk->bits, nbits, 0);
+	while (start < nbits) {
+		end = find_next_bit(chunk->bits, nbits, start);
+		frag->largest = max_t(size_t, frag->largest,
+				      (end - start) << order);
+		frag->nr_free++;
+		start = find_next_zero_bit(chunk->bits, nbits, end);
+	}
+}
+
+static int atomic_pool_show(struct seq_file *m, void *v)
+{
+	struct atomic_pool_frag frag = { 0 };
+	unsigned int order;
+	int cpu;
+
+	if (!atomic_pool)
+		return 0;
+
+	gen_pool_for_each_chunk(atomic_pool, atomic_pool_frag_chunk, &frag);
+	seq_printf(m, "size %zu avail %zu largest_free %zu free_ranges %zu\n",
+		   gen_pool_size(atomic_pool), gen_pool_avail(atomic_pool),
+		   frag.largest, frag.nr_free);
+
+	seq_puts(m, "class      limit     cached     allocs       hits      fails\n");
+	for (order = 0; order < ATOMIC_POOL_NR_CLASSES; order++) {
+		unsigned long cached = 0, allocs = 0, hits = 0, fails = 0;
+
+		for_each_possible_cpu(cpu) {
+			struct atomic_pool_cache *c;
+
+			c = per_cpu_ptr(&atomic_pool_cache[order], cpu);
+			cached += READ_ONCE(c->count);
+			allocs += READ_ONCE(c->allocs);
+			hits += READ_ONCE(c->hits);
+			fails += READ_ONCE(c->fails);
+		}
+		seq_printf(m, "%5luK %10u %10lu %10lu %10lu %10lu\n",
+			   (PAGE_SIZE << order) >> 10,
+			   atomic_pool_cache_limit[order], cached, allocs, hits,
+			   fails);
+	}
+
+	return 0;
+}
+
+static int atomic_pool_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, atomic_pool_show, NULL);
+}
+
+static const struct file_operations atomic_pool_fops = {
+	.open		= atomic_pool_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init atomic_pool_debugfs_init(void)
+{
+	debugfs_create_file("dma_atomic_pool", 0400, NULL, NULL,
+			    &atomic_pool_fops);
+	return 0;
+}
+late_initcall(atomic_pool_debugfs_init);
+#endif
+
 /********************************************
  * The following APIs are for dummy DMA ops *
  ********************************************/
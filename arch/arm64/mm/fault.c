@@ -187,6 +187,78 @@ void show_pte(unsigned long addr)
 	pr_cont("\n");
 }
 
+/*
+ * Fold the CONT_PTES aligned range around a user pte which was just set up
+ * by a fault, when all of its ptes map consecutive pages of a naturally
+ * aligned block with the same attributes. A single TLB entry then covers
+ * the whole range. Only young ptes are folded, and not on CPUs updating the
+ * dirty state in hardware, as it could be recorded in any pte of the range.
+ * With the access flag already set, nothing else is written by the
+ * hardware, so all the ptes of a folded range keep the same attributes
+ * until it is unfolded.
+ */
+void contpte_try_fold(struct vm_area_struct *vma, unsigned long addr,
+		      pte_t *ptep)
+{
+	struct vm_area_struct flush_vma = TLB_FLUSH_VMA(vma->vm_mm, 0);
+	unsigned long saddr = addr & CONT_PTE_MASK;
+	pte_t *start = ptep - CONT_RANGE_OFFSET(addr);
+	unsigned long pfn, i;
+	pgprot_t prot;
+	pte_t pte;
+
+	if (cpus_have_const_cap(ARM64_HW_DBM) || is_vm_hugetlb_page(vma) ||
+	    (vma->vm_flags & (VM_PFNMAP | VM_MIXEDMAP | VM_IO)))
+		return;
+	if (saddr < vma->vm_start || saddr + CONT_PTE_SIZE > vma->vm_end)
+		return;
+
+	pte = READ_ONCE(*start);
+	if (!pte_valid_young(pte) || pte_cont(pte) || pte_special(pte))
+		return;
+	pfn = pte_pfn(pte);
+	if (!IS_ALIGNED(pfn, CONT_PTES))
+		return;
+	prot = __pgprot(pte_val(pte) & ~PTE_ADDR_MASK);
+
+	for (i = 1; i < CONT_PTES; i++)
+		if (pte_val(READ_ONCE(start[i])) !=
+		    pte_val(pfn_pte(pfn + i, prot)))
+			return;
+
+	/* Changing the contiguous bit of valid ptes needs break-before-make */
+	for (i = 0; i < CONT_PTES; i++)
+		set_pte(start + i, __pte(0));
+	flush_tlb_range(&flush_vma, saddr, saddr + CONT_PTE_SIZE);
+
+	prot = __pgprot(pgprot_val(prot) | PTE_CONT | PTE_CONTPTE);
+	for (i = 0; i < CONT_PTES; i++)
+		set_pte(start + i, pfn_pte(pfn + i, prot));
+}
+
+/*
+ * Turn the folded range containing addr back into independent ptes, with the
+ * attributes they all share.
+ */
+void __contpte_unfold(struct mm_struct *mm, unsigned long addr, pte_t *ptep)
+{
+	struct vm_area_struct flush_vma = TLB_FLUSH_VMA(mm, 0);
+	unsigned long saddr = addr & CONT_PTE_MASK;
+	pte_t *start = ptep - CONT_RANGE_OFFSET(addr);
+	pte_t pte = READ_ONCE(*start);
+	unsigned long pfn = pte_pfn(pte), i;
+	pgprot_t prot;
+
+	prot = __pgprot(pte_val(pte) & ~(PTE_ADDR_MASK | PTE_CONT | PTE_CONTPTE));
+
+	for (i = 0; i < CONT_PTES; i++)
+		set_pte(start + i, __pte(0));
+	flush_tlb_range(&flush_vma, saddr, saddr + CONT_PTE_SIZE);
+
+	for (i = 0; i < CONT_PTES; i++)
+		set_pte(start + i, pfn_pte(pfn + i, prot));
+}
+
 /*
  * This function sets the access flags (dirty, accessed), as well as write
  * permission, and only to a more permissive setting.
@@ -207,6 +279,11 @@ int ptep_set_access_flags(struct vm_area_struct *vma,
 	if (pte_same(pte, entry))
 		return 0;
 
+	if (pte_contpte(pte)) {
+		__contpte_unfold(vma->vm_mm, address, ptep);
+		pte = READ_ONCE(*ptep);
+	}
+
 	/* only preserve the access flags and write permission */
 	pte_val(entry) &= PTE_RDONLY | PTE_AF | PTE_WRITE | PTE_DIRTY;
 
@@ -136,6 +136,64 @@ static void __init reserve_crashkernel(void)
 	crashk_res.end = crash_base + crash_size - 1;
 }
 
+struct resource kexec_keep_res = {
+	.name  = "Kexec keep",
+	.start = 0,
+	.end   = 0,
+	.flags = IORESOURCE_BUSY | IORESOURCE_SYSTEM_RAM,
+	.desc  = IORES_DESC_NONE,
+};
+
+/*
+ * reserve_kexec_keep() - reserves memory preserved across kexec reboots
+ *
+ * This function reserves the memory area given in the "kexec_keep=size@base"
+ * kernel command line parameter. It is never handed to the page allocator
+ * and kexec refuses to load segments into it, so that its contents survive
+ * a kexec into a kernel booted with the same parameter. Drivers find it
+ * through kexec_keep_res, or userspace as "Kexec keep" in /proc/iomem.
+ */
+static void __init reserve_kexec_keep(void)
+{
+	unsigned long long keep_base, keep_size;
+	char *p, *cmdline;
+
+	cmdline = strstr(boot_command_line, "kexec_keep=");
+	if (!cmdline)
+		return;
+
+	keep_size = memparse(cmdline + strlen("kexec_keep="), &p);
+	if (*p != '@' || !keep_size) {
+		pr_warn("cannot reserve kexec_keep: size@base expected\n");
+		return;
+	}
+	keep_base = memparse(p + 1, &p);
+	keep_size = PAGE_ALIGN(keep_size);
+
+	/* The base is fixed, as the next kernel must find the same region */
+	if (!IS_ALIGNED(keep_base, SZ_2M)) {
+		pr_warn("cannot reserve kexec_keep: base address is not 2MB aligned\n");
+		return;
+	}
+
+	if (!memblock_is_region_memory(keep_base, keep_size)) {
+		pr_warn("cannot reserve kexec_keep: region is not memory\n");
+		return;
+	}
+
+	if (memblock_is_region_reserved(keep_base, keep_size)) {
+		pr_warn("cannot reserve kexec_keep: region overlaps reserved memory\n");
+		return;
+	}
+	memblock_reserve(keep_base, keep_size);
+
+	pr_info("kexec_keep reserved: 0x%016llx - 0x%016llx (%lld MB)\n",
+		keep_base, keep_base + keep_size, keep_size >> 20);
+
+	kexec_keep_res.start = keep_base;
+	kexec_keep_res.end = keep_base + keep_size - 1;
+}
+
 static void __init kexec_reserve_crashkres_pages(void)
 {
 #ifdef CONFIG_HIBERNATION
@@ -161,6 +219,10 @@ static void __init reserve_crashkernel(void)
 {
 }
 
+static void __init reserve_kexec_keep(void)
+{
+}
+
 static void __init kexec_reserve_crashkres_pages(void)
 {
 }
@@ -481,6 +543,8 @@ void __init arm64_memblock_init(void)
 
 	reserve_crashkernel();
 
+	reserve_kexec_keep();
+
 	reserve_elfcorehdr();
 
 	high_memory = __va(memblock_end_of_DRAM() - 1) + 1;
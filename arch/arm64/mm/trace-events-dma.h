@@ -0,0 +1,51 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM arm64_dma
+
+#if !defined(_TRACE_ARM64_DMA_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_ARM64_DMA_H
+
+#include <linux/device.h>
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(dma_cache_maint,
+
+	TP_PROTO(struct device *dev, int dir, bool for_device, int nents,
+		 int ranges, size_t size, u64 cycles),
+	TP_ARGS(dev, dir, for_device, nents, ranges, size, cycles),
+
+	TP_STRUCT__entry(
+		__string(dev_name, dev_name(dev))
+		__field(int, dir)
+		__field(bool, for_device)
+		__field(int, nents)
+		__field(int, ranges)
+		__field(size_t, size)
+		__field(u64, cycles)
+	),
+
+	TP_fast_assign(
+		__assign_str(dev_name, dev_name(dev));
+		__entry->dir = dir;
+		__entry->for_device = for_device;
+		__entry->nents = nents;
+		__entry->ranges = ranges;
+		__entry->size = size;
+		__entry->cycles = cycles;
+	),
+
+	TP_printk("%s %s dir=%d nents=%d ranges=%d size=%zu cycles=%llu",
+		  __get_str(dev_name), __entry->for_device ? "device" : "cpu",
+		  __entry->dir, __entry->nents, __entry->ranges,
+		  __entry->size, __entry->cycles)
+);
+
+#endif /* _TRACE_ARM64_DMA_H */
+
+/* This part must be outside protection */
+#undef TRACE_INCLUDE_PATH
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_PATH .
+
+#define TRACE_INCLUDE_FILE trace-events-dma
+#include <trace/define_trace.h>
@@ -271,6 +271,34 @@ static void dpm_wait_for_superior(struct device *dev, bool async)
 	dpm_wait_for_suppliers(dev, async);
 }
 
+/*
+ * Of the parent and suppliers of @dev, the one which completed its resume
+ * last, that is the one @dev ended up waiting for.
+ */
+static struct device *dpm_timeline_gate(struct device *dev)
+{
+	struct device *gate = dev->parent;
+	ktime_t end = gate ? pm_timeline_end(gate) : 0;
+	struct device_link *link;
+	int idx;
+
+	if (!IS_ENABLED(CONFIG_PM_SLEEP_DEBUG))
+		return NULL;
+
+	idx = device_links_read_lock();
+	list_for_each_entry_rcu(link, &dev->links.suppliers, c_node) {
+		ktime_t t = pm_timeline_end(link->supplier);
+
+		if (ktime_after(t, end)) {
+			end = t;
+			gate = link->supplier;
+		}
+	}
+	device_links_read_unlock(idx);
+
+	return end ? gate : NULL;
+}
+
 static void dpm_wait_for_consumers(struct device *dev, bool async)
 {
 	struct device_link *link;
@@ -934,6 +962,8 @@ static int device_resume(struct device *dev, pm_message_t state, bool async)
 {
 	pm_callback_t callback = NULL;
 	const char *info = NULL;
+	ktime_t start = ktime_get();
+	ktime_t cb_start = start;
 	int error = 0;
 	DECLARE_DPM_WATCHDOG_ON_STACK(wd);
 
@@ -950,6 +980,7 @@ static int device_resume(struct device *dev, pm_message_t state, bool async)
 	}
 
 	dpm_wait_for_superior(dev, async);
+	cb_start = ktime_get();
 	dpm_watchdog_set(&wd, dev);
 	device_lock(dev);
 
@@ -1006,6 +1037,8 @@ static int device_resume(struct device *dev, pm_message_t state, bool async)
 	dpm_watchdog_clear(&wd);
 
  Complete:
+	/* Before the completion, so that the consumers find it */
+	pm_timeline_record(dev, dpm_timeline_gate(dev), start, cb_start, async);
 	complete_all(&dev->power.completion);
 
 	TRACE_RESUME(error);
@@ -1039,6 +1072,8 @@ void dpm_resume(pm_message_t state)
 	trace_suspend_resume(TPS("dpm_resume"), state.event, true);
 	might_sleep();
 
+	pm_timeline_start();
+
 	mutex_lock(&dpm_list_mtx);
 	pm_transition = state;
 	async_error = 0;
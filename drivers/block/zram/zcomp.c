@@ -15,6 +15,7 @@
 #include <linux/sched.h>
 #include <linux/cpu.h>
 #include <linux/crypto.h>
+#include <linux/ktime.h>
 
 #include "zcomp.h"
 
@@ -49,7 +50,7 @@ static void zcomp_strm_free(struct zcomp_strm *zstrm)
  */
 static struct zcomp_strm *zcomp_strm_alloc(struct zcomp *comp)
 {
-	struct zcomp_strm *zstrm = kmalloc(sizeof(*zstrm), GFP_KERNEL);
+	struct zcomp_strm *zstrm = kzalloc(sizeof(*zstrm), GFP_KERNEL);
 	if (!zstrm)
 		return NULL;
 
@@ -114,6 +115,28 @@ ssize_t zcomp_available_show(const char *comp, char *buf)
 	return sz;
 }
 
+/* show per-CPU stream throughput: cpu, pages, compressed bytes, time */
+ssize_t zcomp_stream_stat_show(struct zcomp *comp, char *buf)
+{
+	ssize_t sz = 0;
+	int cpu;
+
+	cpus_read_lock();
+	for_each_online_cpu(cpu) {
+		struct zcomp_strm *zstrm = *per_cpu_ptr(comp->stream, cpu);
+
+		if (!zstrm)
+			continue;
+		sz += scnprintf(buf + sz, PAGE_SIZE - sz,
+				"%4d %8llu %8llu %8llu\n", cpu,
+				READ_ONCE(zstrm->nr_compressed),
+				READ_ONCE(zstrm->compr_bytes),
+				READ_ONCE(zstrm->compr_ns));
+	}
+	cpus_read_unlock();
+	return sz;
+}
+
 struct zcomp_strm *zcomp_stream_get(struct zcomp *comp)
 {
 	return *get_cpu_ptr(comp->stream);
@@ -127,6 +150,9 @@ void zcomp_stream_put(struct zcomp *comp)
 int zcomp_compress(struct zcomp_strm *zstrm,
 		const void *src, unsigned int *dst_len)
 {
+	u64 start = ktime_get_ns();
+	int ret;
+
 	/*
 	 * Our dst memory (zstrm->buffer) is always `2 * PAGE_SIZE' sized
 	 * because sometimes we can endup having a bigger compressed data
@@ -143,9 +169,15 @@ int zcomp_compress(struct zcomp_strm *zstrm,
 	 */
 	*dst_len = PAGE_SIZE * 2;
 
-	return crypto_comp_compress(zstrm->tfm,
+	ret = crypto_comp_compress(zstrm->tfm,
 			src, PAGE_SIZE,
 			zstrm->buffer, dst_len);
+	if (!ret) {
+		zstrm->nr_compressed++;
+		zstrm->compr_bytes += *dst_len;
+		zstrm->compr_ns += ktime_get_ns() - start;
+	}
+	return ret;
 }
 
 int zcomp_decompress(struct zcomp_strm *zstrm,
@@ -14,6 +14,10 @@ struct zcomp_strm {
 	/* compression/decompression buffer */
 	void *buffer;
 	struct crypto_comp *tfm;
+	/* throughput counters, only updated by the owning CPU */
+	u64 nr_compressed;	/* no. of successful compressions */
+	u64 compr_bytes;	/* compressed bytes produced */
+	u64 compr_ns;		/* time spent compressing */
 };
 
 /* dynamic per-device compression frontend */
@@ -26,6 +30,7 @@ struct zcomp {
 int zcomp_cpu_up_prepare(unsigned int cpu, struct hlist_node *node);
 int zcomp_cpu_dead(unsigned int cpu, struct hlist_node *node);
 ssize_t zcomp_available_show(const char *comp, char *buf);
+ssize_t zcomp_stream_stat_show(struct zcomp *comp, char *buf);
 bool zcomp_available_algorithm(const char *comp);
 
 struct zcomp *zcomp_create(const char *comp);
@@ -33,6 +33,7 @@
 #include <linux/sysfs.h>
 #include <linux/debugfs.h>
 #include <linux/cpuhotplug.h>
+#include <linux/workqueue.h>
 
 #include "zram_drv.h"
 
@@ -50,6 +51,8 @@ static unsigned int num_devices = 1;
  * uncompressed in memory.
  */
 static size_t huge_class_size;
+/* Compresses the pages of large write bios in parallel */
+static struct workqueue_struct *zram_wq;
 
 static void zram_free_page(struct zram *zram, size_t index);
 
@@ -70,9 +73,9 @@ static inline bool init_done(struct zram *zram)
 
 static inline bool zram_allocated(struct zram *zram, u32 index)
 {
-
-	return (zram->table[index].value >> (ZRAM_FLAG_SHIFT + 1)) ||
-					zram->table[index].handle;
+	return zram->table[index].entry ||
+		zram_test_flag(zram, index, ZRAM_SAME) ||
+		zram_test_flag(zram, index, ZRAM_WB);
 }
 
 static inline struct zram *dev_to_zram(struct device *dev)
@@ -80,14 +83,15 @@ static inline struct zram *dev_to_zram(struct device *dev)
 	return (struct zram *)dev_to_disk(dev)->private_data;
 }
 
-static unsigned long zram_get_handle(struct zram *zram, u32 index)
+static struct zram_entry *zram_get_entry(struct zram *zram, u32 index)
 {
-	return zram->table[index].handle;
+	return zram->table[index].entry;
 }
 
-static void zram_set_handle(struct zram *zram, u32 index, unsigned long handle)
+static void zram_set_entry(struct zram *zram, u32 index,
+			struct zram_entry *entry)
 {
-	zram->table[index].handle = handle;
+	zram->table[index].entry = entry;
 }
 
 /* flag operations require table entry bit_spin_lock() being held */
@@ -459,6 +463,39 @@ static unsigned long get_entry_bdev(struct zram *zram)
 	return entry;
 }
 
+/*
+ * Allocates a run of up to nr contiguous blocks, so that a batch can go
+ * out in a single bio. Returns the first block and the length of the
+ * run in *len, or 0 if the backing device is full.
+ */
+static unsigned long get_entry_bdev_range(struct zram *zram,
+				unsigned int nr, unsigned int *len)
+{
+	unsigned long entry, end;
+
+	spin_lock(&zram->bitmap_lock);
+	/* skip 0 bit to confuse zram.handle = 0 */
+	entry = bitmap_find_next_zero_area(zram->bitmap, zram->nr_pages,
+					   1, nr, 0);
+	if (entry + nr > zram->nr_pages) {
+		/* No room for the whole run, use the first hole */
+		entry = find_next_zero_bit(zram->bitmap, zram->nr_pages, 1);
+		if (entry == zram->nr_pages) {
+			spin_unlock(&zram->bitmap_lock);
+			return 0;
+		}
+	}
+
+	end = find_next_bit(zram->bitmap,
+			    min_t(unsigned long, entry + nr, zram->nr_pages),
+			    entry);
+	bitmap_set(zram->bitmap, entry, end - entry);
+	spin_unlock(&zram->bitmap_lock);
+
+	*len = end - entry;
+	return entry;
+}
+
 static void put_entry_bdev(struct zram *zram, unsigned long entry)
 {
 	int was_set;
@@ -469,6 +506,103 @@ static void put_entry_bdev(struct zram *zram, unsigned long entry)
 	WARN_ON_ONCE(!was_set);
 }
 
+/* Takes up to nr pages off the writeback budget, returns how many */
+static unsigned int zram_wb_limit_take(struct zram *zram, unsigned int nr)
+{
+	spin_lock(&zram->wb_limit_lock);
+	if (zram->wb_limit_enable) {
+		nr = min_t(u64, nr, zram->bd_wb_limit);
+		zram->bd_wb_limit -= nr;
+	}
+	spin_unlock(&zram->wb_limit_lock);
+
+	return nr;
+}
+
+static void zram_wb_limit_return(struct zram *zram, unsigned int nr)
+{
+	spin_lock(&zram->wb_limit_lock);
+	if (zram->wb_limit_enable)
+		zram->bd_wb_limit += nr;
+	spin_unlock(&zram->wb_limit_lock);
+}
+
+static ssize_t writeback_limit_enable_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	bool val;
+
+	if (kstrtobool(buf, &val))
+		return -EINVAL;
+
+	spin_lock(&zram->wb_limit_lock);
+	zram->wb_limit_enable = val;
+	spin_unlock(&zram->wb_limit_lock);
+
+	return len;
+}
+
+static ssize_t writeback_limit_enable_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+	bool val;
+
+	spin_lock(&zram->wb_limit_lock);
+	val = zram->wb_limit_enable;
+	spin_unlock(&zram->wb_limit_lock);
+
+	return scnprintf(buf, PAGE_SIZE, "%d\n", val);
+}
+
+/* The budget is in pages, and counts down as pages get written back */
+static ssize_t writeback_limit_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	u64 val;
+
+	if (kstrtoull(buf, 10, &val))
+		return -EINVAL;
+
+	spin_lock(&zram->wb_limit_lock);
+	zram->bd_wb_limit = val;
+	spin_unlock(&zram->wb_limit_lock);
+
+	return len;
+}
+
+static ssize_t writeback_limit_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+	u64 val;
+
+	spin_lock(&zram->wb_limit_lock);
+	val = zram->bd_wb_limit;
+	spin_unlock(&zram->wb_limit_lock);
+
+	return scnprintf(buf, PAGE_SIZE, "%llu\n", val);
+}
+
+static ssize_t bd_stat_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+	ssize_t ret;
+
+	down_read(&zram->init_lock);
+	ret = scnprintf(buf, PAGE_SIZE,
+			"%8llu %8llu %8llu\n",
+			(u64)atomic64_read(&zram->stats.bd_count),
+			(u64)atomic64_read(&zram->stats.bd_reads),
+			(u64)atomic64_read(&zram->stats.bd_writes));
+	up_read(&zram->init_lock);
+
+	return ret;
+}
+
 static void zram_page_end_io(struct bio *bio)
 {
 	struct page *page = bio_first_page_all(bio);
@@ -561,6 +695,7 @@ static int read_from_bdev_sync(struct zram *zram, struct bio_vec *bvec,
 static int read_from_bdev(struct zram *zram, struct bio_vec *bvec,
 			unsigned long entry, struct bio *parent, bool sync)
 {
+	atomic64_inc(&zram->stats.bd_reads);
 	if (sync)
 		return read_from_bdev_sync(zram, bvec, entry, parent);
 	else
@@ -604,6 +739,8 @@ static int write_to_bdev(struct zram *zram, struct bio_vec *bvec,
 	submit_bio(bio);
 	*pentry = entry;
 
+	atomic64_inc(&zram->stats.bd_count);
+	atomic64_inc(&zram->stats.bd_writes);
 	return 0;
 }
 
@@ -615,6 +752,7 @@ static void zram_wb_clear(struct zram *zram, u32 index)
 	entry = zram_get_element(zram, index);
 	zram_set_element(zram, index, 0);
 	put_entry_bdev(zram, entry);
+	atomic64_dec(&zram->stats.bd_count);
 }
 
 #else
@@ -634,6 +772,11 @@ static int read_from_bdev(struct zram *zram, struct bio_vec *bvec,
 	return -EIO;
 }
 static void zram_wb_clear(struct zram *zram, u32 index) {}
+static unsigned int zram_wb_limit_take(struct zram *zram, unsigned int nr)
+{
+	return 0;
+}
+static void zram_wb_limit_return(struct zram *zram, unsigned int nr) {}
 #endif
 
 #ifdef CONFIG_ZRAM_MEMORY_TRACKING
@@ -652,6 +795,7 @@ static void zram_debugfs_destroy(void)
 
 static void zram_accessed(struct zram *zram, u32 index)
 {
+	zram_clear_flag(zram, index, ZRAM_IDLE);
 	zram->table[index].ac_time = ktime_get_boottime();
 }
 
@@ -689,12 +833,13 @@ static ssize_t read_block_state(struct file *file, char __user *buf,
 
 		ts = ktime_to_timespec64(zram->table[index].ac_time);
 		copied = snprintf(kbuf + written, count,
-			"%12zd %12lld.%06lu %c%c%c\n",
+			"%12zd %12lld.%06lu %c%c%c%c\n",
 			index, (s64)ts.tv_sec,
 			ts.tv_nsec / NSEC_PER_USEC,
 			zram_test_flag(zram, index, ZRAM_SAME) ? 's' : '.',
 			zram_test_flag(zram, index, ZRAM_WB) ? 'w' : '.',
-			zram_test_flag(zram, index, ZRAM_HUGE) ? 'h' : '.');
+			zram_test_flag(zram, index, ZRAM_HUGE) ? 'h' : '.',
+			zram_test_flag(zram, index, ZRAM_IDLE) ? 'i' : '.');
 
 		if (count < copied) {
 			zram_slot_unlock(zram, index);
@@ -739,7 +884,10 @@ static void zram_debugfs_unregister(struct zram *zram)
 #else
 static void zram_debugfs_create(void) {};
 static void zram_debugfs_destroy(void) {};
-static void zram_accessed(struct zram *zram, u32 index) {};
+static void zram_accessed(struct zram *zram, u32 index)
+{
+	zram_clear_flag(zram, index, ZRAM_IDLE);
+};
 static void zram_reset_access(struct zram *zram, u32 index) {};
 static void zram_debugfs_register(struct zram *zram) {};
 static void zram_debugfs_unregister(struct zram *zram) {};
@@ -807,6 +955,122 @@ static ssize_t comp_algorithm_store(struct device *dev,
 	return len;
 }
 
+#ifdef CONFIG_ZRAM_MULTI_COMP
+static ssize_t recomp_algorithm_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	size_t sz;
+	struct zram *zram = dev_to_zram(dev);
+
+	down_read(&zram->init_lock);
+	sz = zcomp_available_show(zram->recomp_algorithm, buf);
+	up_read(&zram->init_lock);
+
+	return sz;
+}
+
+static ssize_t recomp_algorithm_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	char compressor[ARRAY_SIZE(zram->recomp_algorithm)];
+	size_t sz;
+
+	strlcpy(compressor, buf, sizeof(compressor));
+	/* ignore trailing newline */
+	sz = strlen(compressor);
+	if (sz > 0 && compressor[sz - 1] == '\n')
+		compressor[sz - 1] = 0x00;
+
+	if (!zcomp_available_algorithm(compressor))
+		return -EINVAL;
+
+	down_write(&zram->init_lock);
+	if (init_done(zram)) {
+		up_write(&zram->init_lock);
+		pr_info("Can't change algorithm for initialized device\n");
+		return -EBUSY;
+	}
+
+	strcpy(zram->recomp_algorithm, compressor);
+	up_write(&zram->init_lock);
+	return len;
+}
+#endif
+
+#ifdef CONFIG_ZRAM_DEDUP
+static ssize_t use_dedup_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	bool val;
+	struct zram *zram = dev_to_zram(dev);
+
+	down_read(&zram->init_lock);
+	val = zram->use_dedup;
+	up_read(&zram->init_lock);
+
+	return scnprintf(buf, PAGE_SIZE, "%d\n", (int)val);
+}
+
+static ssize_t use_dedup_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	int val;
+	struct zram *zram = dev_to_zram(dev);
+
+	if (kstrtoint(buf, 10, &val) || (val != 0 && val != 1))
+		return -EINVAL;
+
+	down_write(&zram->init_lock);
+	if (init_done(zram)) {
+		up_write(&zram->init_lock);
+		pr_info("Can't change dedup usage for initialized device\n");
+		return -EBUSY;
+	}
+	zram->use_dedup = val;
+	up_write(&zram->init_lock);
+	return len;
+}
+#endif
+
+static ssize_t idle_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	unsigned long nr_pages = zram->disksize >> PAGE_SHIFT;
+	unsigned long index;
+	char mode_buf[8];
+	ssize_t sz;
+
+	sz = strscpy(mode_buf, buf, sizeof(mode_buf));
+	if (sz <= 0)
+		return -EINVAL;
+
+	/* ignore trailing new line */
+	if (mode_buf[sz - 1] == '\n')
+		mode_buf[sz - 1] = 0x00;
+
+	if (strcmp(mode_buf, "all"))
+		return -EINVAL;
+
+	down_read(&zram->init_lock);
+	if (!init_done(zram)) {
+		up_read(&zram->init_lock);
+		return -EINVAL;
+	}
+
+	for (index = 0; index < nr_pages; index++) {
+		zram_slot_lock(zram, index);
+		if (zram_allocated(zram, index))
+			zram_set_flag(zram, index, ZRAM_IDLE);
+		zram_slot_unlock(zram, index);
+	}
+
+	up_read(&zram->init_lock);
+
+	return len;
+}
+
 static ssize_t compact_store(struct device *dev,
 		struct device_attribute *attr, const char *buf, size_t len)
 {
@@ -863,7 +1127,8 @@ static ssize_t mm_stat_show(struct device *dev,
 	max_used = atomic_long_read(&zram->stats.max_used_pages);
 
 	ret = scnprintf(buf, PAGE_SIZE,
-			"%8llu %8llu %8llu %8lu %8ld %8llu %8lu %8llu\n",
+			"%8llu %8llu %8llu %8lu %8ld %8llu %8lu %8llu"
+			" %8llu %8llu\n",
 			orig_size << PAGE_SHIFT,
 			(u64)atomic64_read(&zram->stats.compr_data_size),
 			mem_used << PAGE_SHIFT,
@@ -871,7 +1136,9 @@ static ssize_t mm_stat_show(struct device *dev,
 			max_used << PAGE_SHIFT,
 			(u64)atomic64_read(&zram->stats.same_pages),
 			pool_stats.pages_compacted,
-			(u64)atomic64_read(&zram->stats.huge_pages));
+			(u64)atomic64_read(&zram->stats.huge_pages),
+			(u64)atomic64_read(&zram->stats.dup_data_size),
+			(u64)atomic64_read(&zram->stats.meta_data_size));
 	up_read(&zram->init_lock);
 
 	return ret;
@@ -894,9 +1161,24 @@ static ssize_t debug_stat_show(struct device *dev,
 	return ret;
 }
 
+static ssize_t stream_stat_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+	ssize_t ret = 0;
+
+	down_read(&zram->init_lock);
+	if (init_done(zram))
+		ret = zcomp_stream_stat_show(zram->comp, buf);
+	up_read(&zram->init_lock);
+
+	return ret;
+}
+
 static DEVICE_ATTR_RO(io_stat);
 static DEVICE_ATTR_RO(mm_stat);
 static DEVICE_ATTR_RO(debug_stat);
+static DEVICE_ATTR_RO(stream_stat);
 
 static void zram_meta_free(struct zram *zram, u64 disksize)
 {
@@ -908,6 +1190,7 @@ static void zram_meta_free(struct zram *zram, u64 disksize)
 		zram_free_page(zram, index);
 
 	zs_destroy_pool(zram->mem_pool);
+	zram_dedup_fini(zram);
 	vfree(zram->table);
 }
 
@@ -926,11 +1209,69 @@ static bool zram_meta_alloc(struct zram *zram, u64 disksize)
 		return false;
 	}
 
+	if (zram_dedup_init(zram, num_pages)) {
+		zs_destroy_pool(zram->mem_pool);
+		vfree(zram->table);
+		return false;
+	}
+
 	if (!huge_class_size)
 		huge_class_size = zs_huge_class_size(zram->mem_pool);
 	return true;
 }
 
+static unsigned long zram_entry_handle(struct zram *zram,
+				struct zram_entry *entry)
+{
+	if (zram_dedup_enabled(zram))
+		return entry->handle;
+
+	return (unsigned long)entry;
+}
+
+static struct zram_entry *zram_entry_alloc(struct zram *zram,
+				unsigned int len, gfp_t flags)
+{
+	struct zram_entry *entry;
+	unsigned long handle;
+
+	handle = zs_malloc(zram->mem_pool, len, flags);
+	if (!handle)
+		return NULL;
+
+	if (!zram_dedup_enabled(zram))
+		return (struct zram_entry *)handle;
+
+	entry = kzalloc(sizeof(*entry),
+			flags & ~(__GFP_HIGHMEM | __GFP_MOVABLE));
+	if (!entry) {
+		zs_free(zram->mem_pool, handle);
+		return NULL;
+	}
+
+	zram_dedup_init_entry(zram, entry, handle, len);
+	atomic64_add(sizeof(*entry), &zram->stats.meta_data_size);
+
+	return entry;
+}
+
+/* Drops a reference, returns true if the object itself was freed */
+static bool zram_entry_free(struct zram *zram, struct zram_entry *entry)
+{
+	if (!zram_dedup_put_entry(zram, entry))
+		return false;
+
+	zs_free(zram->mem_pool, zram_entry_handle(zram, entry));
+
+	if (!zram_dedup_enabled(zram))
+		return true;
+
+	kfree(entry);
+	atomic64_sub(sizeof(*entry), &zram->stats.meta_data_size);
+
+	return true;
+}
+
 /*
  * To protect concurrent access to the same index entry,
  * caller should hold this table index entry's bit_spinlock to
@@ -938,9 +1279,12 @@ static bool zram_meta_alloc(struct zram *zram, u64 disksize)
  */
 static void zram_free_page(struct zram *zram, size_t index)
 {
-	unsigned long handle;
+	struct zram_entry *entry;
 
 	zram_reset_access(zram, index);
+	zram_clear_flag(zram, index, ZRAM_IDLE);
+	zram_clear_flag(zram, index, ZRAM_RECOMP);
+	zram_clear_flag(zram, index, ZRAM_UNDER_WB);
 
 	if (zram_test_flag(zram, index, ZRAM_HUGE)) {
 		zram_clear_flag(zram, index, ZRAM_HUGE);
@@ -965,60 +1309,56 @@ static void zram_free_page(struct zram *zram, size_t index)
 		return;
 	}
 
-	handle = zram_get_handle(zram, index);
-	if (!handle)
+	entry = zram_get_entry(zram, index);
+	if (!entry)
 		return;
 
-	zs_free(zram->mem_pool, handle);
-
-	atomic64_sub(zram_get_obj_size(zram, index),
-			&zram->stats.compr_data_size);
+	if (zram_entry_free(zram, entry))
+		atomic64_sub(zram_get_obj_size(zram, index),
+				&zram->stats.compr_data_size);
+	else
+		atomic64_sub(zram_get_obj_size(zram, index),
+				&zram->stats.dup_data_size);
 	atomic64_dec(&zram->stats.pages_stored);
 
-	zram_set_handle(zram, index, 0);
+	zram_set_entry(zram, index, NULL);
 	zram_set_obj_size(zram, index, 0);
 }
 
-static int __zram_bvec_read(struct zram *zram, struct page *page, u32 index,
-				struct bio *bio, bool partial_io)
+/* The backend that the object of index was compressed with */
+static struct zcomp *zram_slot_comp(struct zram *zram, u32 index)
+{
+#ifdef CONFIG_ZRAM_MULTI_COMP
+	if (zram_test_flag(zram, index, ZRAM_RECOMP))
+		return zram->recomp;
+#endif
+	return zram->comp;
+}
+
+/* Caller should hold the slot lock of index */
+static int zram_read_from_zspool(struct zram *zram, struct page *page,
+				u32 index)
 {
 	int ret;
+	struct zram_entry *entry;
 	unsigned long handle;
 	unsigned int size;
 	void *src, *dst;
 
-	if (zram_wb_enabled(zram)) {
-		zram_slot_lock(zram, index);
-		if (zram_test_flag(zram, index, ZRAM_WB)) {
-			struct bio_vec bvec;
-
-			zram_slot_unlock(zram, index);
-
-			bvec.bv_page = page;
-			bvec.bv_len = PAGE_SIZE;
-			bvec.bv_offset = 0;
-			return read_from_bdev(zram, &bvec,
-					zram_get_element(zram, index),
-					bio, partial_io);
-		}
-		zram_slot_unlock(zram, index);
-	}
-
-	zram_slot_lock(zram, index);
-	handle = zram_get_handle(zram, index);
-	if (!handle || zram_test_flag(zram, index, ZRAM_SAME)) {
+	entry = zram_get_entry(zram, index);
+	if (!entry || zram_test_flag(zram, index, ZRAM_SAME)) {
 		unsigned long value;
 		void *mem;
 
-		value = handle ? zram_get_element(zram, index) : 0;
+		value = entry ? zram_get_element(zram, index) : 0;
 		mem = kmap_atomic(page);
 		zram_fill_page(mem, PAGE_SIZE, value);
 		kunmap_atomic(mem);
-		zram_slot_unlock(zram, index);
 		return 0;
 	}
 
 	size = zram_get_obj_size(zram, index);
+	handle = zram_entry_handle(zram, entry);
 
 	src = zs_map_object(zram->mem_pool, handle, ZS_MM_RO);
 	if (size == PAGE_SIZE) {
@@ -1027,36 +1367,458 @@ static int __zram_bvec_read(struct zram *zram, struct page *page, u32 index,
 		kunmap_atomic(dst);
 		ret = 0;
 	} else {
-		struct zcomp_strm *zstrm = zcomp_stream_get(zram->comp);
+		struct zcomp *comp = zram_slot_comp(zram, index);
+		struct zcomp_strm *zstrm = zcomp_stream_get(comp);
 
 		dst = kmap_atomic(page);
 		ret = zcomp_decompress(zstrm, src, size, dst);
 		kunmap_atomic(dst);
-		zcomp_stream_put(zram->comp);
+		zcomp_stream_put(comp);
 	}
 	zs_unmap_object(zram->mem_pool, handle);
-	zram_slot_unlock(zram, index);
-
-	/* Should NEVER happen. Return bio error if it does. */
-	if (unlikely(ret))
-		pr_err("Decompression failed! err=%d, page=%u\n", ret, index);
 
 	return ret;
 }
 
-static int zram_bvec_read(struct zram *zram, struct bio_vec *bvec,
-				u32 index, int offset, struct bio *bio)
+#ifdef CONFIG_ZRAM_WRITEBACK
+/* Pages written back per bio, and read back around a fault */
+#define ZRAM_WB_BATCH_PAGES	32
+#define ZRAM_WB_RA_PAGES	8
+
+struct zram_wb_batch {
+	struct page *pages[ZRAM_WB_BATCH_PAGES];
+	u32 index[ZRAM_WB_BATCH_PAGES];
+	unsigned int nr;
+};
+
+static void zram_wb_abort(struct zram *zram, u32 index)
 {
-	int ret;
-	struct page *page;
+	zram_slot_lock(zram, index);
+	zram_clear_flag(zram, index, ZRAM_UNDER_WB);
+	zram_clear_flag(zram, index, ZRAM_IDLE);
+	zram_slot_unlock(zram, index);
+}
 
-	page = bvec->bv_page;
-	if (is_partial_io(bvec)) {
-		/* Use a temporary buffer to decompress the page */
-		page = alloc_page(GFP_NOIO|__GFP_HIGHMEM);
-		if (!page)
-			return -ENOMEM;
-	}
+/*
+ * Moves the slots of one run of blocks to the backing device once its
+ * write has completed, unless they were accessed or rewritten meanwhile.
+ * Returns the number of slots moved.
+ */
+static unsigned int zram_wb_commit(struct zram *zram,
+				struct zram_wb_batch *batch, unsigned int first,
+				unsigned int len, unsigned long blk)
+{
+	unsigned int i, done = 0;
+
+	for (i = 0; i < len; i++) {
+		u32 index = batch->index[first + i];
+
+		zram_slot_lock(zram, index);
+		if (!zram_test_flag(zram, index, ZRAM_UNDER_WB) ||
+		    !zram_test_flag(zram, index, ZRAM_IDLE)) {
+			zram_clear_flag(zram, index, ZRAM_UNDER_WB);
+			zram_slot_unlock(zram, index);
+			put_entry_bdev(zram, blk + i);
+			continue;
+		}
+
+		zram_free_page(zram, index);
+		zram_set_flag(zram, index, ZRAM_WB);
+		zram_set_element(zram, index, blk + i);
+		zram_slot_unlock(zram, index);
+
+		atomic64_inc(&zram->stats.pages_stored);
+		atomic64_inc(&zram->stats.bd_count);
+		atomic64_inc(&zram->stats.bd_writes);
+		done++;
+	}
+
+	return done;
+}
+
+/*
+ * Writes the gathered pages out in as few bios as the free space of the
+ * backing device allows, and within the writeback budget.
+ */
+static int zram_wb_flush(struct zram *zram, struct zram_wb_batch *batch)
+{
+	unsigned int i = 0, granted, len, j;
+	unsigned long blk;
+	struct bio *bio;
+	int ret = 0;
+
+	granted = zram_wb_limit_take(zram, batch->nr);
+	if (granted < batch->nr)
+		ret = -EIO;
+
+	while (i < granted) {
+		blk = get_entry_bdev_range(zram, granted - i, &len);
+		if (!blk) {
+			ret = -ENOSPC;
+			break;
+		}
+
+		bio = bio_alloc(GFP_KERNEL, len);
+		bio->bi_iter.bi_sector = blk * (PAGE_SIZE >> 9);
+		bio_set_dev(bio, zram->bdev);
+		bio->bi_opf = REQ_OP_WRITE | REQ_SYNC;
+		for (j = 0; j < len; j++)
+			bio_add_page(bio, batch->pages[i + j], PAGE_SIZE, 0);
+
+		if (submit_bio_wait(bio)) {
+			for (j = 0; j < len; j++) {
+				zram_wb_abort(zram, batch->index[i + j]);
+				put_entry_bdev(zram, blk + j);
+			}
+			zram_wb_limit_return(zram, len);
+			ret = -EIO;
+		} else {
+			j = zram_wb_commit(zram, batch, i, len, blk);
+			zram_wb_limit_return(zram, len - j);
+		}
+		bio_put(bio);
+		i += len;
+	}
+
+	zram_wb_limit_return(zram, granted - i);
+	for (; i < batch->nr; i++)
+		zram_wb_abort(zram, batch->index[i]);
+	batch->nr = 0;
+
+	return ret;
+}
+
+/*
+ * Writes back idle ("idle") or incompressible ("huge") pages, gathering
+ * them into multi-page bios over contiguous blocks of the backing
+ * device instead of writing them one page at a time.
+ */
+static ssize_t writeback_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	unsigned long nr_pages = zram->disksize >> PAGE_SHIFT;
+	struct zram_wb_batch *batch;
+	unsigned long index;
+	ssize_t ret = len;
+	bool huge;
+	int i;
+
+	if (sysfs_streq(buf, "idle"))
+		huge = false;
+	else if (sysfs_streq(buf, "huge"))
+		huge = true;
+	else
+		return -EINVAL;
+
+	batch = kzalloc(sizeof(*batch), GFP_KERNEL);
+	if (!batch)
+		return -ENOMEM;
+
+	for (i = 0; i < ZRAM_WB_BATCH_PAGES; i++) {
+		batch->pages[i] = alloc_page(GFP_KERNEL);
+		if (!batch->pages[i]) {
+			ret = -ENOMEM;
+			goto out_free;
+		}
+	}
+
+	down_read(&zram->init_lock);
+	if (!init_done(zram) || !zram_wb_enabled(zram)) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	for (index = 0; index < nr_pages; index++) {
+		struct page *page = batch->pages[batch->nr];
+		int err;
+
+		zram_slot_lock(zram, index);
+		if (!zram_get_entry(zram, index) ||
+		    zram_test_flag(zram, index, ZRAM_SAME) ||
+		    zram_test_flag(zram, index, ZRAM_WB) ||
+		    zram_test_flag(zram, index, ZRAM_UNDER_WB))
+			goto next;
+
+		if (huge ? !zram_test_flag(zram, index, ZRAM_HUGE) :
+			   !zram_test_flag(zram, index, ZRAM_IDLE))
+			goto next;
+
+		/* Other slots would keep the shared object in memory */
+		if (zram_dedup_enabled(zram) &&
+		    zram_get_entry(zram, index)->refcount > 1)
+			goto next;
+
+		if (zram_read_from_zspool(zram, page, index))
+			goto next;
+
+		/*
+		 * Any access clears ZRAM_IDLE and any rewrite clears
+		 * ZRAM_UNDER_WB, which tells the commit to leave the slot.
+		 */
+		zram_set_flag(zram, index, ZRAM_UNDER_WB);
+		zram_set_flag(zram, index, ZRAM_IDLE);
+		batch->index[batch->nr++] = index;
+next:
+		zram_slot_unlock(zram, index);
+
+		if (batch->nr == ZRAM_WB_BATCH_PAGES) {
+			err = zram_wb_flush(zram, batch);
+			if (err) {
+				ret = err;
+				break;
+			}
+		}
+
+		cond_resched();
+	}
+
+	if (batch->nr) {
+		int err = zram_wb_flush(zram, batch);
+
+		if (err)
+			ret = err;
+	}
+out:
+	up_read(&zram->init_lock);
+out_free:
+	for (i = 0; i < ZRAM_WB_BATCH_PAGES && batch->pages[i]; i++)
+		__free_page(batch->pages[i]);
+	kfree(batch);
+
+	return ret;
+}
+
+struct zram_ra_work {
+	struct work_struct work;
+	struct zram *zram;
+	u32 index;
+	unsigned long entry;
+};
+
+/*
+ * Readahead marks the slots it reads ZRAM_UNDER_WB. Any free or rewrite
+ * of a slot clears that, so a slot still marked and still pointing at
+ * blk holds exactly the data that was read.
+ */
+static bool zram_wb_ra_slot(struct zram *zram, u32 index, unsigned long blk)
+{
+	return zram_test_flag(zram, index, ZRAM_WB) &&
+	       zram_test_flag(zram, index, ZRAM_UNDER_WB) &&
+	       zram_get_element(zram, index) == blk;
+}
+
+static void zram_wb_ra_abort(struct zram *zram, u32 index, unsigned long blk)
+{
+	zram_slot_lock(zram, index);
+	if (zram_wb_ra_slot(zram, index, blk))
+		zram_clear_flag(zram, index, ZRAM_UNDER_WB);
+	zram_slot_unlock(zram, index);
+}
+
+/* Brings a page read back by readahead into memory again */
+static void zram_wb_readmit(struct zram *zram, u32 index,
+				unsigned long blk, struct page *page)
+{
+	struct zram_entry *entry = NULL;
+	struct zcomp_strm *zstrm;
+	unsigned int comp_len;
+	unsigned long handle;
+	void *src, *dst;
+	int ret;
+
+	zstrm = zcomp_stream_get(zram->comp);
+	src = kmap_atomic(page);
+	ret = zcomp_compress(zstrm, src, &comp_len);
+	kunmap_atomic(src);
+
+	/* Incompressible pages are better off staying where they are */
+	if (!ret && comp_len < huge_class_size)
+		entry = zram_entry_alloc(zram, comp_len,
+				__GFP_KSWAPD_RECLAIM |
+				__GFP_NOWARN |
+				__GFP_HIGHMEM |
+				__GFP_MOVABLE);
+	if (entry) {
+		handle = zram_entry_handle(zram, entry);
+		dst = zs_map_object(zram->mem_pool, handle, ZS_MM_WO);
+		memcpy(dst, zstrm->buffer, comp_len);
+		zs_unmap_object(zram->mem_pool, handle);
+	}
+	zcomp_stream_put(zram->comp);
+
+	zram_slot_lock(zram, index);
+	if (!zram_wb_ra_slot(zram, index, blk)) {
+		zram_slot_unlock(zram, index);
+		if (entry)
+			zram_entry_free(zram, entry);
+		return;
+	}
+
+	if (!entry) {
+		zram_clear_flag(zram, index, ZRAM_UNDER_WB);
+		zram_slot_unlock(zram, index);
+		return;
+	}
+
+	zram_free_page(zram, index);
+	zram_set_entry(zram, index, entry);
+	zram_set_obj_size(zram, index, comp_len);
+	zram_slot_unlock(zram, index);
+
+	atomic64_add(comp_len, &zram->stats.compr_data_size);
+	atomic64_inc(&zram->stats.pages_stored);
+}
+
+static bool zram_wb_ra_next(struct zram *zram, u32 index, unsigned long blk)
+{
+	return zram_test_flag(zram, index, ZRAM_WB) &&
+	       !zram_test_flag(zram, index, ZRAM_UNDER_WB) &&
+	       zram_get_element(zram, index) == blk;
+}
+
+static void zram_wb_readahead_work(struct work_struct *work)
+{
+	struct zram_ra_work *ra = container_of(work, struct zram_ra_work,
+					       work);
+	struct page *pages[ZRAM_WB_RA_PAGES];
+	struct zram *zram = ra->zram;
+	unsigned long blk = ra->entry + 1;
+	u32 index = ra->index + 1;
+	unsigned int i, got, done = 0, nr = 0;
+	struct bio *bio;
+
+	down_read(&zram->init_lock);
+	if (!init_done(zram) || !zram_wb_enabled(zram))
+		goto out;
+
+	/* The following slots that went out next to this one */
+	while (nr < ZRAM_WB_RA_PAGES &&
+	       index + nr < zram->disksize >> PAGE_SHIFT) {
+		bool next;
+
+		zram_slot_lock(zram, index + nr);
+		next = zram_wb_ra_next(zram, index + nr, blk + nr);
+		if (next)
+			zram_set_flag(zram, index + nr, ZRAM_UNDER_WB);
+		zram_slot_unlock(zram, index + nr);
+		if (!next)
+			break;
+		nr++;
+	}
+	if (!nr)
+		goto out;
+
+	bio = bio_alloc(GFP_NOIO, nr);
+	bio->bi_iter.bi_sector = blk * (PAGE_SIZE >> 9);
+	bio_set_dev(bio, zram->bdev);
+	bio->bi_opf = REQ_OP_READ;
+	for (i = 0; i < nr; i++) {
+		pages[i] = alloc_page(GFP_NOIO | __GFP_NOWARN);
+		if (!pages[i])
+			break;
+		bio_add_page(bio, pages[i], PAGE_SIZE, 0);
+	}
+	got = i;
+
+	if (got && !submit_bio_wait(bio)) {
+		atomic64_add(got, &zram->stats.bd_reads);
+		for (i = 0; i < got; i++)
+			zram_wb_readmit(zram, index + i, blk + i, pages[i]);
+		done = got;
+	}
+	bio_put(bio);
+
+	for (i = 0; i < got; i++)
+		__free_page(pages[i]);
+	for (i = done; i < nr; i++)
+		zram_wb_ra_abort(zram, index + i, blk + i);
+out:
+	up_read(&zram->init_lock);
+	kfree(ra);
+}
+
+/*
+ * Pages written back together tend to be faulted in together, so read
+ * the blocks following a faulting one back into memory in one bio.
+ */
+static void zram_wb_readahead(struct zram *zram, u32 index,
+				unsigned long entry)
+{
+	struct zram_ra_work *ra;
+	bool next = false;
+
+	if (index + 1 < zram->disksize >> PAGE_SHIFT) {
+		zram_slot_lock(zram, index + 1);
+		next = zram_wb_ra_next(zram, index + 1, entry + 1);
+		zram_slot_unlock(zram, index + 1);
+	}
+	if (!next)
+		return;
+
+	ra = kmalloc(sizeof(*ra), GFP_NOIO | __GFP_NOWARN);
+	if (!ra)
+		return;
+
+	INIT_WORK(&ra->work, zram_wb_readahead_work);
+	ra->zram = zram;
+	ra->index = index;
+	ra->entry = entry;
+	queue_work(zram_wq, &ra->work);
+}
+#else
+static void zram_wb_readahead(struct zram *zram, u32 index,
+				unsigned long entry) {}
+#endif
+
+static int __zram_bvec_read(struct zram *zram, struct page *page, u32 index,
+				struct bio *bio, bool partial_io)
+{
+	int ret;
+
+	if (zram_wb_enabled(zram)) {
+		zram_slot_lock(zram, index);
+		if (zram_test_flag(zram, index, ZRAM_WB)) {
+			unsigned long entry = zram_get_element(zram, index);
+			struct bio_vec bvec;
+
+			zram_slot_unlock(zram, index);
+
+			bvec.bv_page = page;
+			bvec.bv_len = PAGE_SIZE;
+			bvec.bv_offset = 0;
+			ret = read_from_bdev(zram, &bvec, entry,
+					bio, partial_io);
+			zram_wb_readahead(zram, index, entry);
+			return ret;
+		}
+		zram_slot_unlock(zram, index);
+	}
+
+	zram_slot_lock(zram, index);
+	ret = zram_read_from_zspool(zram, page, index);
+	zram_slot_unlock(zram, index);
+
+	/* Should NEVER happen. Return bio error if it does. */
+	if (unlikely(ret))
+		pr_err("Decompression failed! err=%d, page=%u\n", ret, index);
+
+	return ret;
+}
+
+static int zram_bvec_read(struct zram *zram, struct bio_vec *bvec,
+				u32 index, int offset, struct bio *bio)
+{
+	int ret;
+	struct page *page;
+
+	page = bvec->bv_page;
+	if (is_partial_io(bvec)) {
+		/* Use a temporary buffer to decompress the page */
+		page = alloc_page(GFP_NOIO|__GFP_HIGHMEM);
+		if (!page)
+			return -ENOMEM;
+	}
 
 	ret = __zram_bvec_read(zram, page, index, bio, is_partial_io(bvec));
 	if (unlikely(ret))
@@ -1082,7 +1844,8 @@ static int __zram_bvec_write(struct zram *zram, struct bio_vec *bvec,
 {
 	int ret = 0;
 	unsigned long alloced_pages;
-	unsigned long handle = 0;
+	struct zram_entry *entry = NULL;
+	unsigned long handle;
 	unsigned int comp_len = 0;
 	void *src, *dst, *mem;
 	struct zcomp_strm *zstrm;
@@ -1090,6 +1853,7 @@ static int __zram_bvec_write(struct zram *zram, struct bio_vec *bvec,
 	unsigned long element = 0;
 	enum zram_pageflags flags = 0;
 	bool allow_wb = true;
+	u32 checksum = 0;
 
 	mem = kmap_atomic(page);
 	if (page_same_filled(mem, &element)) {
@@ -1101,6 +1865,13 @@ static int __zram_bvec_write(struct zram *zram, struct bio_vec *bvec,
 	}
 	kunmap_atomic(mem);
 
+	entry = zram_dedup_find(zram, page, &checksum);
+	if (entry) {
+		comp_len = entry->len;
+		atomic64_add(comp_len, &zram->stats.dup_data_size);
+		goto out;
+	}
+
 compress_again:
 	zstrm = zcomp_stream_get(zram->comp);
 	src = kmap_atomic(page);
@@ -1110,13 +1881,15 @@ compress_again:
 	if (unlikely(ret)) {
 		zcomp_stream_put(zram->comp);
 		pr_err("Compression failed! err=%d\n", ret);
-		zs_free(zram->mem_pool, handle);
+		if (entry)
+			zram_entry_free(zram, entry);
 		return ret;
 	}
 
 	if (unlikely(comp_len >= huge_class_size)) {
 		comp_len = PAGE_SIZE;
-		if (zram_wb_enabled(zram) && allow_wb) {
+		if (zram_wb_enabled(zram) && allow_wb &&
+		    zram_wb_limit_take(zram, 1)) {
 			zcomp_stream_put(zram->comp);
 			ret = write_to_bdev(zram, bvec, index, bio, &element);
 			if (!ret) {
@@ -1124,6 +1897,7 @@ compress_again:
 				ret = 1;
 				goto out;
 			}
+			zram_wb_limit_return(zram, 1);
 			allow_wb = false;
 			goto compress_again;
 		}
@@ -1142,19 +1916,19 @@ compress_again:
 	 * if we have a 'non-null' handle here then we are coming
 	 * from the slow path and handle has already been allocated.
 	 */
-	if (!handle)
-		handle = zs_malloc(zram->mem_pool, comp_len,
+	if (!entry)
+		entry = zram_entry_alloc(zram, comp_len,
 				__GFP_KSWAPD_RECLAIM |
 				__GFP_NOWARN |
 				__GFP_HIGHMEM |
 				__GFP_MOVABLE);
-	if (!handle) {
+	if (!entry) {
 		zcomp_stream_put(zram->comp);
 		atomic64_inc(&zram->stats.writestall);
-		handle = zs_malloc(zram->mem_pool, comp_len,
+		entry = zram_entry_alloc(zram, comp_len,
 				GFP_NOIO | __GFP_HIGHMEM |
 				__GFP_MOVABLE);
-		if (handle)
+		if (entry)
 			goto compress_again;
 		return -ENOMEM;
 	}
@@ -1164,10 +1938,11 @@ compress_again:
 
 	if (zram->limit_pages && alloced_pages > zram->limit_pages) {
 		zcomp_stream_put(zram->comp);
-		zs_free(zram->mem_pool, handle);
+		zram_entry_free(zram, entry);
 		return -ENOMEM;
 	}
 
+	handle = zram_entry_handle(zram, entry);
 	dst = zs_map_object(zram->mem_pool, handle, ZS_MM_WO);
 
 	src = zstrm->buffer;
@@ -1180,6 +1955,7 @@ compress_again:
 	zcomp_stream_put(zram->comp);
 	zs_unmap_object(zram->mem_pool, handle);
 	atomic64_add(comp_len, &zram->stats.compr_data_size);
+	zram_dedup_insert(zram, entry, checksum);
 out:
 	/*
 	 * Free memory associated with this sector
@@ -1197,7 +1973,7 @@ out:
 		zram_set_flag(zram, index, flags);
 		zram_set_element(zram, index, element);
 	}  else {
-		zram_set_handle(zram, index, handle);
+		zram_set_entry(zram, index, entry);
 		zram_set_obj_size(zram, index, comp_len);
 	}
 	zram_slot_unlock(zram, index);
@@ -1248,6 +2024,155 @@ out:
 	return ret;
 }
 
+#ifdef CONFIG_ZRAM_MULTI_COMP
+/*
+ * Recompresses the object of index with the secondary algorithm, and
+ * replaces it if the result is smaller. Caller should hold the slot
+ * lock of index, so nothing in here may sleep.
+ */
+static int zram_recompress(struct zram *zram, u32 index, struct page *page)
+{
+	unsigned int size = zram_get_obj_size(zram, index);
+	unsigned int comp_len;
+	struct zram_entry *entry;
+	struct zcomp_strm *zstrm;
+	unsigned long handle;
+	void *src, *dst;
+	int ret;
+
+	ret = zram_read_from_zspool(zram, page, index);
+	if (ret)
+		return ret;
+
+	zstrm = zcomp_stream_get(zram->recomp);
+	src = kmap_atomic(page);
+	ret = zcomp_compress(zstrm, src, &comp_len);
+	kunmap_atomic(src);
+
+	if (ret || comp_len >= size || comp_len >= huge_class_size) {
+		zcomp_stream_put(zram->recomp);
+		return ret;
+	}
+
+	entry = zram_entry_alloc(zram, comp_len,
+			__GFP_KSWAPD_RECLAIM |
+			__GFP_NOWARN |
+			__GFP_HIGHMEM |
+			__GFP_MOVABLE);
+	if (!entry) {
+		zcomp_stream_put(zram->recomp);
+		return -ENOMEM;
+	}
+
+	handle = zram_entry_handle(zram, entry);
+	dst = zs_map_object(zram->mem_pool, handle, ZS_MM_WO);
+	memcpy(dst, zstrm->buffer, comp_len);
+	zcomp_stream_put(zram->recomp);
+	zs_unmap_object(zram->mem_pool, handle);
+
+	zram_free_page(zram, index);
+	zram_set_entry(zram, index, entry);
+	zram_set_obj_size(zram, index, comp_len);
+	zram_set_flag(zram, index, ZRAM_RECOMP);
+	/* Still as cold as it was */
+	zram_set_flag(zram, index, ZRAM_IDLE);
+
+	atomic64_add(comp_len, &zram->stats.compr_data_size);
+	atomic64_inc(&zram->stats.pages_stored);
+	return 0;
+}
+
+/*
+ * Takes "type=idle" to only recompress pages that stayed idle since the
+ * last idle marking, and "threshold=<bytes>" to only recompress objects
+ * at least that large.
+ */
+static ssize_t recompress_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	char *args, *param, *val, *tmp;
+	unsigned int threshold = 0;
+	unsigned long nr_pages;
+	unsigned long index;
+	struct page *page;
+	bool idle = false;
+	ssize_t ret = len;
+
+	tmp = kstrndup(buf, len, GFP_KERNEL);
+	if (!tmp)
+		return -ENOMEM;
+
+	args = skip_spaces(tmp);
+	while (*args) {
+		args = next_arg(args, &param, &val);
+
+		if (!strcmp(param, "type") && val && !strcmp(val, "idle")) {
+			idle = true;
+			continue;
+		}
+
+		if (!strcmp(param, "threshold") && val &&
+		    !kstrtouint(val, 10, &threshold))
+			continue;
+
+		kfree(tmp);
+		return -EINVAL;
+	}
+	kfree(tmp);
+
+	page = alloc_page(GFP_KERNEL);
+	if (!page)
+		return -ENOMEM;
+
+	down_read(&zram->init_lock);
+	if (!init_done(zram) || !zram->recomp) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	nr_pages = zram->disksize >> PAGE_SHIFT;
+	for (index = 0; index < nr_pages; index++) {
+		struct zram_entry *entry;
+		int err = 0;
+
+		zram_slot_lock(zram, index);
+		entry = zram_get_entry(zram, index);
+
+		if (!entry || zram_test_flag(zram, index, ZRAM_SAME) ||
+		    zram_test_flag(zram, index, ZRAM_WB) ||
+		    zram_test_flag(zram, index, ZRAM_RECOMP))
+			goto next;
+
+		if (idle && !zram_test_flag(zram, index, ZRAM_IDLE))
+			goto next;
+
+		if (zram_get_obj_size(zram, index) < threshold)
+			goto next;
+
+		/* A private copy of a shared object would cost memory */
+		if (zram_dedup_enabled(zram) && entry->refcount > 1)
+			goto next;
+
+		err = zram_recompress(zram, index, page);
+next:
+		zram_slot_unlock(zram, index);
+
+		if (err) {
+			ret = err;
+			break;
+		}
+
+		cond_resched();
+	}
+
+out:
+	up_read(&zram->init_lock);
+	__free_page(page);
+	return ret;
+}
+#endif
+
 /*
  * zram_bio_discard - handler on discard request
  * @index: physical block index in PAGE_SIZE units
@@ -1326,6 +2251,124 @@ static int zram_bvec_rw(struct zram *zram, struct bio_vec *bvec, u32 index,
 	return ret;
 }
 
+/* Write bios of at least this many pages are compressed in parallel */
+#define ZRAM_PARALLEL_MIN_PAGES	4
+
+/* A write bio whose pages are stored by zram_wq workers */
+struct zram_bio_batch {
+	struct bio *bio;
+	atomic_t pending;
+	bool failed;
+};
+
+struct zram_page_work {
+	struct work_struct work;
+	struct zram *zram;
+	struct zram_bio_batch *batch;
+	struct bio_vec bvec;
+	u32 index;
+};
+
+static void zram_batch_put(struct zram_bio_batch *batch)
+{
+	if (!atomic_dec_and_test(&batch->pending))
+		return;
+
+	if (READ_ONCE(batch->failed))
+		bio_io_error(batch->bio);
+	else
+		bio_endio(batch->bio);
+	kfree(batch);
+}
+
+static void zram_page_write_work(struct work_struct *work)
+{
+	struct zram_page_work *pw = container_of(work, struct zram_page_work,
+						 work);
+	struct zram_bio_batch *batch = pw->batch;
+
+	if (zram_bvec_rw(pw->zram, &pw->bvec, pw->index, 0,
+			 REQ_OP_WRITE, batch->bio) < 0)
+		WRITE_ONCE(batch->failed, true);
+
+	kfree(pw);
+	zram_batch_put(batch);
+}
+
+/*
+ * Only page aligned writes made of whole pages are split, so that no
+ * two workers ever touch the same slot and no partial IO is needed.
+ */
+static bool zram_can_write_parallel(struct bio *bio)
+{
+	struct bio_vec bvec;
+	struct bvec_iter iter;
+
+	if (bio_op(bio) != REQ_OP_WRITE || num_online_cpus() < 2)
+		return false;
+
+	if (bio->bi_iter.bi_size < ZRAM_PARALLEL_MIN_PAGES * PAGE_SIZE ||
+	    bio->bi_iter.bi_sector & (SECTORS_PER_PAGE - 1))
+		return false;
+
+	bio_for_each_segment(bvec, bio, iter) {
+		if (bvec.bv_offset || bvec.bv_len != PAGE_SIZE)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Queues one work item per page on the unbound zram_wq, so that the
+ * scheduler spreads them over idle CPUs and each page is compressed
+ * with the per-CPU stream of the CPU it lands on. The bio completes
+ * when the last page is stored.
+ */
+static bool zram_write_parallel(struct zram *zram, struct bio *bio)
+{
+	struct zram_bio_batch *batch;
+	struct bio_vec bvec;
+	struct bvec_iter iter;
+	u32 index;
+
+	batch = kmalloc(sizeof(*batch), GFP_NOIO | __GFP_NOWARN);
+	if (!batch)
+		return false;
+
+	batch->bio = bio;
+	batch->failed = false;
+	/* Dropped once every page has been handed out */
+	atomic_set(&batch->pending, 1);
+
+	index = bio->bi_iter.bi_sector >> SECTORS_PER_PAGE_SHIFT;
+	bio_for_each_segment(bvec, bio, iter) {
+		struct zram_page_work *pw;
+
+		pw = kmalloc(sizeof(*pw), GFP_NOIO | __GFP_NOWARN);
+		if (!pw) {
+			/* Short of memory, store this page from here */
+			if (zram_bvec_rw(zram, &bvec, index, 0,
+					 REQ_OP_WRITE, bio) < 0)
+				WRITE_ONCE(batch->failed, true);
+			index++;
+			continue;
+		}
+
+		INIT_WORK(&pw->work, zram_page_write_work);
+		pw->zram = zram;
+		pw->batch = batch;
+		pw->bvec = bvec;
+		pw->index = index++;
+
+		atomic_inc(&batch->pending);
+		queue_work(zram_wq, &pw->work);
+	}
+
+	zram_batch_put(batch);
+	return true;
+}
+
 static void __zram_make_request(struct zram *zram, struct bio *bio)
 {
 	int offset;
@@ -1347,6 +2390,9 @@ static void __zram_make_request(struct zram *zram, struct bio *bio)
 		break;
 	}
 
+	if (zram_can_write_parallel(bio) && zram_write_parallel(zram, bio))
+		return;
+
 	bio_for_each_segment(bvec, bio, iter) {
 		struct bio_vec bv = bvec;
 		unsigned int unwritten = bvec.bv_len;
@@ -1460,6 +2506,9 @@ out:
 static void zram_reset_device(struct zram *zram)
 {
 	struct zcomp *comp;
+#ifdef CONFIG_ZRAM_MULTI_COMP
+	struct zcomp *recomp;
+#endif
 	u64 disksize;
 
 	down_write(&zram->init_lock);
@@ -1472,6 +2521,10 @@ static void zram_reset_device(struct zram *zram)
 	}
 
 	comp = zram->comp;
+#ifdef CONFIG_ZRAM_MULTI_COMP
+	recomp = zram->recomp;
+	zram->recomp = NULL;
+#endif
 	disksize = zram->disksize;
 	zram->disksize = 0;
 
@@ -1479,10 +2532,16 @@ static void zram_reset_device(struct zram *zram)
 	part_stat_set_all(&zram->disk->part0, 0);
 
 	up_write(&zram->init_lock);
+	/* Wait for the pages of parallel writes still being stored */
+	flush_workqueue(zram_wq);
 	/* I/O operation under all of CPU are done so let's free */
 	zram_meta_free(zram, disksize);
 	memset(&zram->stats, 0, sizeof(zram->stats));
 	zcomp_destroy(comp);
+#ifdef CONFIG_ZRAM_MULTI_COMP
+	if (recomp)
+		zcomp_destroy(recomp);
+#endif
 	reset_bdev(zram);
 }
 
@@ -1519,6 +2578,21 @@ static ssize_t disksize_store(struct device *dev,
 		goto out_free_meta;
 	}
 
+#ifdef CONFIG_ZRAM_MULTI_COMP
+	if (zram->recomp_algorithm[0]) {
+		struct zcomp *recomp = zcomp_create(zram->recomp_algorithm);
+
+		if (IS_ERR(recomp)) {
+			pr_err("Cannot initialise %s compressing backend\n",
+					zram->recomp_algorithm);
+			err = PTR_ERR(recomp);
+			zcomp_destroy(comp);
+			goto out_free_meta;
+		}
+		zram->recomp = recomp;
+	}
+#endif
+
 	zram->comp = comp;
 	zram->disksize = disksize;
 	set_capacity(zram->disk, zram->disksize >> SECTOR_SHIFT);
@@ -1603,6 +2677,7 @@ static const struct block_device_operations zram_devops = {
 };
 
 static DEVICE_ATTR_WO(compact);
+static DEVICE_ATTR_WO(idle);
 static DEVICE_ATTR_RW(disksize);
 static DEVICE_ATTR_RO(initstate);
 static DEVICE_ATTR_WO(reset);
@@ -1610,8 +2685,19 @@ static DEVICE_ATTR_WO(mem_limit);
 static DEVICE_ATTR_WO(mem_used_max);
 static DEVICE_ATTR_RW(max_comp_streams);
 static DEVICE_ATTR_RW(comp_algorithm);
+#ifdef CONFIG_ZRAM_MULTI_COMP
+static DEVICE_ATTR_RW(recomp_algorithm);
+static DEVICE_ATTR_WO(recompress);
+#endif
+#ifdef CONFIG_ZRAM_DEDUP
+static DEVICE_ATTR_RW(use_dedup);
+#endif
 #ifdef CONFIG_ZRAM_WRITEBACK
 static DEVICE_ATTR_RW(backing_dev);
+static DEVICE_ATTR_WO(writeback);
+static DEVICE_ATTR_RW(writeback_limit);
+static DEVICE_ATTR_RW(writeback_limit_enable);
+static DEVICE_ATTR_RO(bd_stat);
 #endif
 
 static struct attribute *zram_disk_attrs[] = {
@@ -1619,16 +2705,29 @@ static struct attribute *zram_disk_attrs[] = {
 	&dev_attr_initstate.attr,
 	&dev_attr_reset.attr,
 	&dev_attr_compact.attr,
+	&dev_attr_idle.attr,
 	&dev_attr_mem_limit.attr,
 	&dev_attr_mem_used_max.attr,
 	&dev_attr_max_comp_streams.attr,
 	&dev_attr_comp_algorithm.attr,
+#ifdef CONFIG_ZRAM_MULTI_COMP
+	&dev_attr_recomp_algorithm.attr,
+	&dev_attr_recompress.attr,
+#endif
+#ifdef CONFIG_ZRAM_DEDUP
+	&dev_attr_use_dedup.attr,
+#endif
 #ifdef CONFIG_ZRAM_WRITEBACK
 	&dev_attr_backing_dev.attr,
+	&dev_attr_writeback.attr,
+	&dev_attr_writeback_limit.attr,
+	&dev_attr_writeback_limit_enable.attr,
+	&dev_attr_bd_stat.attr,
 #endif
 	&dev_attr_io_stat.attr,
 	&dev_attr_mm_stat.attr,
 	&dev_attr_debug_stat.attr,
+	&dev_attr_stream_stat.attr,
 	NULL,
 };
 
@@ -1661,6 +2760,9 @@ static int zram_add(void)
 	device_id = ret;
 
 	init_rwsem(&zram->init_lock);
+#ifdef CONFIG_ZRAM_WRITEBACK
+	spin_lock_init(&zram->wb_limit_lock);
+#endif
 
 	queue = blk_alloc_queue(GFP_KERNEL);
 	if (!queue) {
@@ -1854,21 +2956,31 @@ static void destroy_devices(void)
 	idr_destroy(&zram_index_idr);
 	unregister_blkdev(zram_major, "zram");
 	cpuhp_remove_multi_state(CPUHP_ZCOMP_PREPARE);
+	destroy_workqueue(zram_wq);
 }
 
 static int __init zram_init(void)
 {
 	int ret;
 
+	/* Swap-out depends on it, so it must make progress under reclaim */
+	zram_wq = alloc_workqueue("zram", WQ_UNBOUND | WQ_HIGHPRI |
+				  WQ_MEM_RECLAIM, 0);
+	if (!zram_wq)
+		return -ENOMEM;
+
 	ret = cpuhp_setup_state_multi(CPUHP_ZCOMP_PREPARE, "block/zram:prepare",
 				      zcomp_cpu_up_prepare, zcomp_cpu_dead);
-	if (ret < 0)
+	if (ret < 0) {
+		destroy_workqueue(zram_wq);
 		return ret;
+	}
 
 	ret = class_register(&zram_control_class);
 	if (ret) {
 		pr_err("Unable to register zram-control class\n");
 		cpuhp_remove_multi_state(CPUHP_ZCOMP_PREPARE);
+		destroy_workqueue(zram_wq);
 		return ret;
 	}
 
@@ -1878,6 +2990,7 @@ static int __init zram_init(void)
 		pr_err("Unable to get major number\n");
 		class_unregister(&zram_control_class);
 		cpuhp_remove_multi_state(CPUHP_ZCOMP_PREPARE);
+		destroy_workqueue(zram_wq);
 		return -EBUSY;
 	}
 
@@ -63,24 +63,81 @@
 #include <linux/types.h>
 #include <linux/of.h>
 #include <linux/clk.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
 
 #define RNG_DATA 0x00
 
+/* Words prefetched in the background, served first on the next read */
+#define RNG_POOL_WORDS 64
+
+static unsigned short quality = 512;
+module_param(quality, ushort, 0444);
+MODULE_PARM_DESC(quality,
+		 "Estimated entropy per 1024 bits of RNG output (default 512)");
+
 struct meson_rng_data {
 	void __iomem *base;
 	struct platform_device *pdev;
 	struct hwrng rng;
 	struct clk *core_clk;
+	struct work_struct refill_work;
+	spinlock_t lock;
+	unsigned int pool_avail;
+	u32 pool[RNG_POOL_WORDS];
 };
 
+static void meson_rng_refill(struct work_struct *work)
+{
+	struct meson_rng_data *data =
+			container_of(work, struct meson_rng_data, refill_work);
+	unsigned int avail;
+
+	spin_lock_bh(&data->lock);
+	avail = data->pool_avail;
+	readsl(data->base + RNG_DATA, data->pool + avail,
+	       RNG_POOL_WORDS - avail);
+	data->pool_avail = RNG_POOL_WORDS;
+	spin_unlock_bh(&data->lock);
+}
+
 static int meson_rng_read(struct hwrng *rng, void *buf, size_t max, bool wait)
 {
 	struct meson_rng_data *data =
 			container_of(rng, struct meson_rng_data, rng);
+	size_t words = max / sizeof(u32);
+	size_t tail = max % sizeof(u32);
+	unsigned int n;
+	u32 val;
+
+	/* Take the most recently prefetched words from the top of the pool */
+	spin_lock_bh(&data->lock);
+	n = min_t(size_t, words, data->pool_avail);
+	data->pool_avail -= n;
+	memcpy(buf, data->pool + data->pool_avail, n * sizeof(u32));
+	memzero_explicit(data->pool + data->pool_avail, n * sizeof(u32));
+	spin_unlock_bh(&data->lock);
+
+	/* Everything else comes straight from the data register */
+	if (words > n)
+		readsl(data->base + RNG_DATA, (u32 *)buf + n, words - n);
+
+	if (tail) {
+		val = readl_relaxed(data->base + RNG_DATA);
+		memcpy((u32 *)buf + words, &val, tail);
+	}
 
-	*(u32 *)buf = readl_relaxed(data->base + RNG_DATA);
+	if (n)
+		schedule_work(&data->refill_work);
 
-	return sizeof(u32);
+	return max;
+}
+
+static void meson_rng_cancel_refill(void *data)
+{
+	struct meson_rng_data *rng_data = data;
+
+	cancel_work_sync(&rng_data->refill_work);
 }
 
 static void meson_rng_clk_disable(void *data)
@@ -120,8 +177,18 @@ static int meson_rng_probe(struct platform_device *pdev)
 			return ret;
 	}
 
+	spin_lock_init(&data->lock);
+	INIT_WORK(&data->refill_work, meson_rng_refill);
+	ret = devm_add_action(dev, meson_rng_cancel_refill, data);
+	if (ret)
+		return ret;
+
+	/* Have a full pool for the first request of the hwrng core */
+	meson_rng_refill(&data->refill_work);
+
 	data->rng.name = pdev->name;
 	data->rng.read = meson_rng_read;
+	data->rng.quality = quality;
 
 	platform_set_drvdata(pdev, data);
 
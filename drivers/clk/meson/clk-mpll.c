@@ -101,30 +101,33 @@ static int mpll_set_rate(struct clk_hw *hw,
 {
 	struct clk_regmap *clk = to_clk_regmap(hw);
 	struct meson_clk_mpll_data *mpll = meson_clk_mpll_data(clk);
+	struct meson_parm_batch batch = { 0 };
 	unsigned int sdm, n2;
 	unsigned long flags = 0;
 
 	params_from_rate(rate, parent_rate, &sdm, &n2, mpll->flags);
 
-	if (mpll->lock)
-		spin_lock_irqsave(mpll->lock, flags);
-	else
-		__acquire(mpll->lock);
-
 	/* Enable and set the fractional part */
-	meson_parm_write(clk->map, &mpll->sdm, sdm);
-	meson_parm_write(clk->map, &mpll->sdm_en, 1);
+	meson_parm_batch_add(&batch, &mpll->sdm, sdm);
+	meson_parm_batch_add(&batch, &mpll->sdm_en, 1);
 
 	/* Set additional fractional part enable if required */
 	if (MESON_PARM_APPLICABLE(&mpll->ssen))
-		meson_parm_write(clk->map, &mpll->ssen, 1);
+		meson_parm_batch_add(&batch, &mpll->ssen, 1);
 
 	/* Set the integer divider part */
-	meson_parm_write(clk->map, &mpll->n2, n2);
+	meson_parm_batch_add(&batch, &mpll->n2, n2);
 
 	/* Set the magic misc bit if required */
 	if (MESON_PARM_APPLICABLE(&mpll->misc))
-		meson_parm_write(clk->map, &mpll->misc, 1);
+		meson_parm_batch_add(&batch, &mpll->misc, 1);
+
+	if (mpll->lock)
+		spin_lock_irqsave(mpll->lock, flags);
+	else
+		__acquire(mpll->lock);
+
+	meson_parm_batch_write(clk->map, &batch);
 
 	if (mpll->lock)
 		spin_unlock_irqrestore(mpll->lock, flags);
@@ -0,0 +1,44 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM meson_clk
+
+#if !defined(__MESON_CLK_PLL_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define __MESON_CLK_PLL_TRACE_H
+
+#include <linux/clk-provider.h>
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(meson_clk_pll_set_rate,
+	TP_PROTO(struct clk_hw *hw, unsigned long rate, u64 duration,
+		 int ret),
+
+	TP_ARGS(hw, rate, duration, ret),
+
+	TP_STRUCT__entry(
+		__string(name, clk_hw_get_name(hw))
+		__field(unsigned long, rate)
+		__field(u64, duration)
+		__field(int, ret)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, clk_hw_get_name(hw));
+		__entry->rate = rate;
+		__entry->duration = duration;
+		__entry->ret = ret;
+	),
+
+	TP_printk("%s: rate = %lu, reprogrammed in %llu ns, ret = %d",
+		  __get_str(name), __entry->rate, __entry->duration,
+		  __entry->ret)
+);
+
+#endif /* __MESON_CLK_PLL_TRACE_H */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE clk-pll-trace
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -26,6 +26,7 @@
 #include <linux/delay.h>
 #include <linux/err.h>
 #include <linux/io.h>
+#include <linux/ktime.h>
 #include <linux/math64.h>
 #include <linux/module.h>
 #include <linux/of_address.h>
@@ -34,6 +35,16 @@
 
 #include "clkc.h"
 
+#define CREATE_TRACE_POINTS
+#include "clk-pll-trace.h"
+
+#define MESON_PLL_LOCK_TIMEOUT_US	24000
+
+static unsigned int lock_poll_us = 10;
+module_param(lock_poll_us, uint, 0644);
+MODULE_PARM_DESC(lock_poll_us,
+		 "Delay between two polls of the PLL lock bit in us (0: spin)");
+
 static inline struct meson_clk_pll_data *
 meson_clk_pll_data(struct clk_regmap *clk)
 {
@@ -110,14 +121,24 @@ meson_clk_get_pll_settings(unsigned long rate,
 			   struct meson_clk_pll_data *pll)
 {
 	const struct pll_rate_table *table = pll->table;
-	unsigned int i = 0;
+	unsigned int lo = 0, hi = pll->table_count, i;
 
 	if (!table)
 		return NULL;
 
-	/* Find the first table element exceeding rate */
-	while (table[i].rate && table[i].rate <= rate)
-		i++;
+	/*
+	 * Find the first table element exceeding rate. The tables are
+	 * sorted by increasing rate, and end with a zero rate sentinel.
+	 */
+	while (lo < hi) {
+		unsigned int mid = lo + (hi - lo) / 2;
+
+		if (table[mid].rate <= rate)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	i = lo;
 
 	if (i != 0) {
 		if (MESON_PARM_APPLICABLE(&pll->frac) ||
@@ -159,17 +180,14 @@ static int meson_clk_pll_wait_lock(struct clk_hw *hw)
 {
 	struct clk_regmap *clk = to_clk_regmap(hw);
 	struct meson_clk_pll_data *pll = meson_clk_pll_data(clk);
-	int delay = 24000000;
-
-	do {
-		/* Is the clock locked now ? */
-		if (meson_parm_read(clk->map, &pll->l))
-			return 0;
-
-		delay--;
-	} while (delay > 0);
-
-	return -ETIMEDOUT;
+	unsigned int val;
+
+	/* Is the clock locked now ? */
+	return regmap_read_poll_timeout(clk->map, pll->l.reg_off, val,
+					PARM_GET(pll->l.width, pll->l.shift,
+						 val),
+					READ_ONCE(lock_poll_us),
+					MESON_PLL_LOCK_TIMEOUT_US);
 }
 
 static void meson_clk_pll_init(struct clk_hw *hw)
@@ -177,6 +195,10 @@ static void meson_clk_pll_init(struct clk_hw *hw)
 	struct clk_regmap *clk = to_clk_regmap(hw);
 	struct meson_clk_pll_data *pll = meson_clk_pll_data(clk);
 
+	if (pll->table && !pll->table_count)
+		while (pll->table[pll->table_count].rate)
+			pll->table_count++;
+
 	if (pll->init_count) {
 		meson_parm_write(clk->map, &pll->rst, 1);
 		regmap_multi_reg_write(clk->map, pll->init_regs,
@@ -190,9 +212,12 @@ static int meson_clk_pll_set_rate(struct clk_hw *hw, unsigned long rate,
 {
 	struct clk_regmap *clk = to_clk_regmap(hw);
 	struct meson_clk_pll_data *pll = meson_clk_pll_data(clk);
+	struct meson_parm_batch batch = { 0 };
 	const struct pll_rate_table *pllt;
 	unsigned long old_rate;
+	ktime_t start;
 	u16 frac = 0;
+	int ret;
 
 	if (parent_rate == 0 || rate == 0)
 		return -EINVAL;
@@ -203,28 +228,38 @@ static int meson_clk_pll_set_rate(struct clk_hw *hw, unsigned long rate,
 	if (!pllt)
 		return -EINVAL;
 
-	/* Put the pll in reset to write the params */
-	meson_parm_write(clk->map, &pll->rst, 1);
-
-	meson_parm_write(clk->map, &pll->n, pllt->n);
-	meson_parm_write(clk->map, &pll->m, pllt->m);
-	meson_parm_write(clk->map, &pll->od, pllt->od);
+	meson_parm_batch_add(&batch, &pll->n, pllt->n);
+	meson_parm_batch_add(&batch, &pll->m, pllt->m);
+	meson_parm_batch_add(&batch, &pll->od, pllt->od);
 
 	if (MESON_PARM_APPLICABLE(&pll->od2))
-		meson_parm_write(clk->map, &pll->od2, pllt->od2);
+		meson_parm_batch_add(&batch, &pll->od2, pllt->od2);
 
 	if (MESON_PARM_APPLICABLE(&pll->od3))
-		meson_parm_write(clk->map, &pll->od3, pllt->od3);
+		meson_parm_batch_add(&batch, &pll->od3, pllt->od3);
 
 	if (MESON_PARM_APPLICABLE(&pll->frac)) {
 		frac = __pll_params_with_frac(rate, parent_rate, pllt, pll);
-		meson_parm_write(clk->map, &pll->frac, frac);
+		meson_parm_batch_add(&batch, &pll->frac, frac);
 	}
 
+	start = ktime_get();
+
+	/* Put the pll in reset to write the params */
+	meson_parm_write(clk->map, &pll->rst, 1);
+
+	meson_parm_batch_write(clk->map, &batch);
+
 	/* make sure the reset is cleared at this point */
 	meson_parm_write(clk->map, &pll->rst, 0);
 
-	if (meson_clk_pll_wait_lock(hw)) {
+	ret = meson_clk_pll_wait_lock(hw);
+
+	trace_meson_clk_pll_set_rate(hw, rate,
+				     ktime_to_ns(ktime_sub(ktime_get(), start)),
+				     ret);
+
+	if (ret) {
 		pr_warn("%s: pll did not lock, trying to restore old rate %lu\n",
 			__func__, old_rate);
 		/*
@@ -42,6 +42,57 @@ static inline void meson_parm_write(struct regmap *map, struct parm *p,
 			   val << p->shift);
 }
 
+/*
+ * Parameter writes gathered per register, so that reprogramming a
+ * clock costs one regmap_update_bits() per register instead of one per
+ * field.
+ */
+#define MESON_PARM_BATCH_MAX		8
+
+struct meson_parm_batch {
+	unsigned int count;
+	struct {
+		unsigned int reg;
+		unsigned int mask;
+		unsigned int val;
+	} upd[MESON_PARM_BATCH_MAX];
+};
+
+static inline void meson_parm_batch_add(struct meson_parm_batch *batch,
+					struct parm *p, unsigned int val)
+{
+	unsigned int mask = SETPMASK(p->width, p->shift);
+	unsigned int i;
+
+	for (i = 0; i < batch->count; i++)
+		if (batch->upd[i].reg == p->reg_off)
+			break;
+
+	if (WARN_ON(i == MESON_PARM_BATCH_MAX))
+		return;
+
+	if (i == batch->count) {
+		batch->upd[i].reg = p->reg_off;
+		batch->upd[i].mask = 0;
+		batch->upd[i].val = 0;
+		batch->count++;
+	}
+
+	batch->upd[i].mask |= mask;
+	batch->upd[i].val = (batch->upd[i].val & ~mask) |
+			    ((val << p->shift) & mask);
+}
+
+static inline void meson_parm_batch_write(struct regmap *map,
+					  struct meson_parm_batch *batch)
+{
+	unsigned int i;
+
+	for (i = 0; i < batch->count; i++)
+		regmap_update_bits(map, batch->upd[i].reg, batch->upd[i].mask,
+				   batch->upd[i].val);
+}
+
 
 struct pll_rate_table {
 	unsigned long	rate;
@@ -74,6 +125,7 @@ struct meson_clk_pll_data {
 	const struct reg_sequence *init_regs;
 	unsigned int init_count;
 	const struct pll_rate_table *table;
+	unsigned int table_count;
 	u8 flags;
 };
 
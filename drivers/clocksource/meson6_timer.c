@@ -5,11 +5,17 @@
  *
  * Based on code from Amlogic, Inc
  *
+ * On the GX SoCs, the same timer block sits in the EE power domain, which
+ * stays up when the CPU cluster is powered off. The per-core arch timers
+ * are stopped in that state, so timer A is registered as the tick
+ * broadcast device there, and the arch timer remains the clocksource.
+ *
  * This file is licensed under the terms of the GNU General Public
  * License version 2.  This program is licensed "as is" without any
  * warranty of any kind, whether express or implied.
  */
 
+#include <linux/bitops.h>
 #include <linux/clk.h>
 #include <linux/clockchips.h>
 #include <linux/interrupt.h>
@@ -27,8 +33,8 @@
 #define TIMER_ISA_VAL(t)	(((t) + 1) << 2)
 
 #define TIMER_INPUT_BIT(t)	(2 * (t))
-#define TIMER_ENABLE_BIT(t)	(16 + (t))
-#define TIMER_PERIODIC_BIT(t)	(12 + (t))
+#define TIMER_ENABLE_BIT(t)	BIT(16 + (t))
+#define TIMER_PERIODIC_BIT(t)	BIT(12 + (t))
 
 #define TIMER_CED_INPUT_MASK	(3UL << TIMER_INPUT_BIT(CED_ID))
 #define TIMER_CSD_INPUT_MASK	(7UL << TIMER_INPUT_BIT(CSD_ID))
@@ -126,7 +132,7 @@ static struct irqaction meson6_timer_irq = {
 	.dev_id		= &meson6_clockevent,
 };
 
-static int __init meson6_timer_init(struct device_node *node)
+static int __init meson_timer_init(struct device_node *node, bool broadcast)
 {
 	u32 val;
 	int ret, irq;
@@ -149,9 +155,13 @@ static int __init meson6_timer_init(struct device_node *node)
 	val |= TIMER_CSD_UNIT_1US << TIMER_INPUT_BIT(CSD_ID);
 	writel(val, timer_base + TIMER_ISA_MUX);
 
-	sched_clock_register(meson6_timer_sched_read, 32, USEC_PER_SEC);
-	clocksource_mmio_init(timer_base + TIMER_ISA_VAL(CSD_ID), node->name,
-			      1000 * 1000, 300, 32, clocksource_mmio_readl_up);
+	/* The arch timer is a better clocksource and sched_clock */
+	if (!broadcast) {
+		sched_clock_register(meson6_timer_sched_read, 32, USEC_PER_SEC);
+		clocksource_mmio_init(timer_base + TIMER_ISA_VAL(CSD_ID),
+				      node->name, 1000 * 1000, 300, 32,
+				      clocksource_mmio_readl_up);
+	}
 
 	/* Timer A base 1us */
 	val &= ~TIMER_CED_INPUT_MASK;
@@ -170,9 +180,31 @@ static int __init meson6_timer_init(struct device_node *node)
 	meson6_clockevent.cpumask = cpu_possible_mask;
 	meson6_clockevent.irq = irq;
 
+	/*
+	 * Rated below the arch timer, so that it is only used as the
+	 * broadcast device, and follows the CPU with the earliest event.
+	 */
+	if (broadcast) {
+		meson6_clockevent.name = "meson_gx_bc";
+		meson6_clockevent.rating = 300;
+		meson6_clockevent.features |= CLOCK_EVT_FEAT_DYNIRQ;
+	}
+
 	clockevents_config_and_register(&meson6_clockevent, USEC_PER_SEC,
 					1, 0xfffe);
 	return 0;
 }
+
+static int __init meson6_timer_init(struct device_node *node)
+{
+	return meson_timer_init(node, false);
+}
 TIMER_OF_DECLARE(meson6, "amlogic,meson6-timer",
 		       meson6_timer_init);
+
+static int __init meson_gx_timer_init(struct device_node *node)
+{
+	return meson_timer_init(node, true);
+}
+TIMER_OF_DECLARE(meson_gx, "amlogic,meson-gx-timer",
+		       meson_gx_timer_init);
@@ -0,0 +1,122 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Boost the schedutil frequency floor on user input.
+ *
+ * Key presses and touch/pointer events request a SCHED_CPUFREQ_BOOST_INPUT
+ * boost, so that the frames rendered in response do not start at the lowest
+ * OPP while the utilization ramps up. The floor itself is the boost_freq_pct
+ * tunable of the schedutil governor.
+ */
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/input.h>
+#include <linux/module.h>
+#include <linux/sched/cpufreq.h>
+#include <linux/slab.h>
+
+static unsigned int duration_us = 100000;
+module_param(duration_us, uint, 0644);
+MODULE_PARM_DESC(duration_us, "Length of the boost requested by an input event");
+
+static void input_boost_event(struct input_handle *handle, unsigned int type,
+			      unsigned int code, int value)
+{
+	/* Key releases and autorepeat don't start new work */
+	if (type == EV_KEY && value != 1)
+		return;
+
+	if (type != EV_KEY && type != EV_ABS && type != EV_REL)
+		return;
+
+	if (duration_us)
+		schedutil_boost(SCHED_CPUFREQ_BOOST_INPUT, duration_us);
+}
+
+static int input_boost_connect(struct input_handler *handler,
+			       struct input_dev *dev,
+			       const struct input_device_id *id)
+{
+	struct input_handle *handle;
+	int error;
+
+	handle = kzalloc(sizeof(*handle), GFP_KERNEL);
+	if (!handle)
+		return -ENOMEM;
+
+	handle->dev = dev;
+	handle->handler = handler;
+	handle->name = "cpufreq_input_boost";
+
+	error = input_register_handle(handle);
+	if (error)
+		goto err_free_handle;
+
+	error = input_open_device(handle);
+	if (error)
+		goto err_unregister_handle;
+
+	return 0;
+
+err_unregister_handle:
+	input_unregister_handle(handle);
+err_free_handle:
+	kfree(handle);
+	return error;
+}
+
+static void input_boost_disconnect(struct input_handle *handle)
+{
+	input_close_device(handle);
+	input_unregister_handle(handle);
+	kfree(handle);
+}
+
+static const struct input_device_id input_boost_ids[] = {
+	/* Touchscreens */
+	{
+		.flags = INPUT_DEVICE_ID_MATCH_EVBIT |
+			 INPUT_DEVICE_ID_MATCH_ABSBIT,
+		.evbit = { BIT_MASK(EV_ABS) },
+		.absbit = { [BIT_WORD(ABS_MT_POSITION_X)] =
+			    BIT_MASK(ABS_MT_POSITION_X) |
+			    BIT_MASK(ABS_MT_POSITION_Y) },
+	},
+	/* Touchpads and mice */
+	{
+		.flags = INPUT_DEVICE_ID_MATCH_EVBIT |
+			 INPUT_DEVICE_ID_MATCH_RELBIT,
+		.evbit = { BIT_MASK(EV_REL) },
+		.relbit = { BIT_MASK(REL_X) | BIT_MASK(REL_Y) },
+	},
+	/* Keyboards, keypads and remote controls */
+	{
+		.flags = INPUT_DEVICE_ID_MATCH_EVBIT,
+		.evbit = { BIT_MASK(EV_KEY) },
+	},
+	{ },
+};
+MODULE_DEVICE_TABLE(input, input_boost_ids);
+
+static struct input_handler input_boost_handler = {
+	.event		= input_boost_event,
+	.connect	= input_boost_connect,
+	.disconnect	= input_boost_disconnect,
+	.name		= "cpufreq_input_boost",
+	.id_table	= input_boost_ids,
+};
+
+static int __init input_boost_init(void)
+{
+	return input_register_handler(&input_boost_handler);
+}
+module_init(input_boost_init);
+
+static void __exit input_boost_exit(void)
+{
+	input_unregister_handler(&input_boost_handler);
+}
+module_exit(input_boost_exit);
+
+MODULE_DESCRIPTION("schedutil frequency boost on input events");
+MODULE_LICENSE("GPL v2");
@@ -18,7 +18,6 @@
 
 #define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
 
-#include <linux/clk.h>
 #include <linux/cpu.h>
 #include <linux/cpufreq.h>
 #include <linux/cpumask.h>
@@ -32,20 +31,40 @@
 #include <linux/types.h>
 
 struct scpi_data {
-	struct clk *clk;
+	int domain;
+	struct scpi_dvfs_info *info;
 	struct device *cpu_dev;
 	struct thermal_cooling_device *cdev;
 };
 
 static struct scpi_ops *scpi_ops;
 
+/*
+ * The frequency is programmed with the SCPI DVFS commands rather than
+ * through the DVFS clock, so that the clock framework does not hold a
+ * stale rate after a fast switch.
+ */
+static int scpi_cpufreq_find_opp(struct scpi_data *priv, unsigned int freq)
+{
+	int idx;
+
+	for (idx = 0; idx < priv->info->count; idx++)
+		if (priv->info->opps[idx].freq == freq * 1000)
+			return idx;
+
+	return -EINVAL;
+}
+
 static unsigned int scpi_cpufreq_get_rate(unsigned int cpu)
 {
 	struct cpufreq_policy *policy = cpufreq_cpu_get_raw(cpu);
 	struct scpi_data *priv = policy->driver_data;
-	unsigned long rate = clk_get_rate(priv->clk);
+	int idx = scpi_ops->dvfs_get_idx(priv->domain);
 
-	return rate / 1000;
+	if (idx < 0 || idx >= priv->info->count)
+		return 0;
+
+	return priv->info->opps[idx].freq / 1000;
 }
 
 static int
@@ -53,23 +72,46 @@ scpi_cpufreq_set_target(struct cpufreq_policy *policy, unsigned int index)
 {
 	unsigned long freq = policy->freq_table[index].frequency;
 	struct scpi_data *priv = policy->driver_data;
-	u64 rate = freq * 1000;
-	int ret;
+	int idx, ret;
 
-	ret = clk_set_rate(priv->clk, rate);
+	idx = scpi_cpufreq_find_opp(priv, freq);
+	if (idx < 0)
+		return idx;
 
+	ret = scpi_ops->dvfs_set_idx(priv->domain, idx);
 	if (ret)
 		return ret;
 
-	if (clk_get_rate(priv->clk) != rate)
-		return -EIO;
-
 	arch_set_freq_scale(policy->related_cpus, freq,
 			    policy->cpuinfo.max_freq);
 
 	return 0;
 }
 
+static unsigned int scpi_cpufreq_fast_switch(struct cpufreq_policy *policy,
+					     unsigned int target_freq)
+{
+	struct scpi_data *priv = policy->driver_data;
+	unsigned int index, freq;
+	int idx;
+
+	index = cpufreq_table_find_index_l(policy, target_freq);
+	freq = policy->freq_table[index].frequency;
+
+	idx = scpi_cpufreq_find_opp(priv, freq);
+	if (idx < 0)
+		return 0;
+
+	/* The SCP acknowledges asynchronously, a failure is only logged */
+	if (scpi_ops->dvfs_set_idx_async(priv->domain, idx))
+		return 0;
+
+	arch_set_freq_scale(policy->related_cpus, freq,
+			    policy->cpuinfo.max_freq);
+
+	return freq;
+}
+
 static int
 scpi_get_sharing_cpus(struct device *cpu_dev, struct cpumask *cpumask)
 {
@@ -98,10 +140,11 @@ scpi_get_sharing_cpus(struct device *cpu_dev, struct cpumask *cpumask)
 
 static int scpi_cpufreq_init(struct cpufreq_policy *policy)
 {
-	int ret;
+	int ret, domain;
 	unsigned int latency;
 	struct device *cpu_dev;
 	struct scpi_data *priv;
+	struct scpi_dvfs_info *info;
 	struct cpufreq_frequency_table *freq_table;
 
 	cpu_dev = get_cpu_device(policy->cpu);
@@ -110,6 +153,14 @@ static int scpi_cpufreq_init(struct cpufreq_policy *policy)
 		return -ENODEV;
 	}
 
+	domain = scpi_ops->device_domain_id(cpu_dev);
+	if (domain < 0)
+		return domain;
+
+	info = scpi_ops->dvfs_get_info(domain);
+	if (IS_ERR(info))
+		return PTR_ERR(info);
+
 	ret = scpi_ops->add_opps_to_device(cpu_dev);
 	if (ret) {
 		dev_warn(cpu_dev, "failed to add opps to the device\n");
@@ -149,13 +200,8 @@ static int scpi_cpufreq_init(struct cpufreq_policy *policy)
 	}
 
 	priv->cpu_dev = cpu_dev;
-	priv->clk = clk_get(cpu_dev, NULL);
-	if (IS_ERR(priv->clk)) {
-		dev_err(cpu_dev, "%s: Failed to get clk for cpu: %d\n",
-			__func__, cpu_dev->id);
-		ret = PTR_ERR(priv->clk);
-		goto out_free_cpufreq_table;
-	}
+	priv->domain = domain;
+	priv->info = info;
 
 	policy->driver_data = priv;
 	policy->freq_table = freq_table;
@@ -169,11 +215,18 @@ static int scpi_cpufreq_init(struct cpufreq_policy *policy)
 
 	policy->cpuinfo.transition_latency = latency;
 
-	policy->fast_switch_possible = false;
+	/*
+	 * The transition latency reported by the SCP is the actual DVFS
+	 * time, use it as is for the governor rate limit rather than the
+	 * 1000 times worst case margin the core applies by default.
+	 */
+	if (latency != CPUFREQ_ETERNAL)
+		policy->transition_delay_us = DIV_ROUND_UP(latency,
+							   NSEC_PER_USEC);
+
+	policy->fast_switch_possible = !!scpi_ops->dvfs_set_idx_async;
 	return 0;
 
-out_free_cpufreq_table:
-	dev_pm_opp_free_cpufreq_table(cpu_dev, &freq_table);
 out_free_priv:
 	kfree(priv);
 out_free_opp:
@@ -187,7 +240,6 @@ static int scpi_cpufreq_exit(struct cpufreq_policy *policy)
 	struct scpi_data *priv = policy->driver_data;
 
 	cpufreq_cooling_unregister(priv->cdev);
-	clk_put(priv->clk);
 	dev_pm_opp_free_cpufreq_table(priv->cpu_dev, &policy->freq_table);
 	kfree(priv);
 	dev_pm_opp_cpumask_remove_table(policy->related_cpus);
@@ -195,11 +247,23 @@ static int scpi_cpufreq_exit(struct cpufreq_policy *policy)
 	return 0;
 }
 
+/*
+ * The SCP provides the voltage of each OPP, which is all the power model of
+ * the cooling device needs besides the dynamic power coefficient. Default
+ * to a typical Cortex-A53 one, in mW/MHz/uV^2, so that power_allocator can
+ * be used when the device tree does not provide it.
+ */
+static unsigned int dynamic_power_coefficient = 100;
+module_param(dynamic_power_coefficient, uint, 0444);
+MODULE_PARM_DESC(dynamic_power_coefficient,
+		 "CPU dynamic power coefficient when DT has none, 0 for none");
+
 static void scpi_cpufreq_ready(struct cpufreq_policy *policy)
 {
 	struct scpi_data *priv = policy->driver_data;
 
-	priv->cdev = of_cpufreq_cooling_register(policy);
+	priv->cdev = of_cpufreq_power_cooling_register(policy,
+						dynamic_power_coefficient);
 }
 
 static struct cpufreq_driver scpi_cpufreq_driver = {
@@ -213,6 +277,7 @@ static struct cpufreq_driver scpi_cpufreq_driver = {
 	.exit	= scpi_cpufreq_exit,
 	.ready	= scpi_cpufreq_ready,
 	.target_index	= scpi_cpufreq_set_target,
+	.fast_switch	= scpi_cpufreq_fast_switch,
 };
 
 static int scpi_cpufreq_probe(struct platform_device *pdev)
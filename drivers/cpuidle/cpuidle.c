@@ -203,6 +203,7 @@ int cpuidle_enter_state(struct cpuidle_device *dev, struct cpuidle_driver *drv,
 	bool broadcast = !!(target_state->flags & CPUIDLE_FLAG_TIMER_STOP);
 	ktime_t time_start, time_end;
 	s64 diff;
+	int i;
 
 	/*
 	 * Tell the time framework to switch to a broadcast timer because our
@@ -260,6 +261,34 @@ int cpuidle_enter_state(struct cpuidle_device *dev, struct cpuidle_driver *drv,
 		 */
 		dev->states_usage[entered_state].time += dev->last_residency;
 		dev->states_usage[entered_state].usage++;
+
+		/*
+		 * Count the wakeups which happened before the target residency
+		 * of the state while a shallower one was available, and the
+		 * ones late enough for the next deeper state, so that the
+		 * choices of the governors can be compared.
+		 */
+		if (diff < drv->states[entered_state].target_residency) {
+			for (i = entered_state - 1; i >= 0; i--) {
+				if (drv->states[i].disabled ||
+				    dev->states_usage[i].disable)
+					continue;
+
+				dev->states_usage[entered_state].above++;
+				break;
+			}
+		} else {
+			diff -= drv->states[entered_state].exit_latency;
+			for (i = entered_state + 1; i < drv->state_count; i++) {
+				if (drv->states[i].disabled ||
+				    dev->states_usage[i].disable)
+					continue;
+
+				if (diff >= drv->states[i].target_residency)
+					dev->states_usage[entered_state].below++;
+				break;
+			}
+		}
 	} else {
 		dev->last_residency = 0;
 	}
@@ -0,0 +1,191 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * irqt.c - the interrupt timings idle governor
+ *
+ * The menu governor guesses the idle duration from the next timer event,
+ * corrected by the recent idle history of the CPU. Device interrupts with a
+ * regular period, like the coalescing timer of a NIC or the period interrupt
+ * of an audio FIFO, are then only seen through that history and a CPU often
+ * enters a cluster off state just before one of them fires.
+ *
+ * This governor instead bounds the idle duration with the next interrupt
+ * predicted by the irq timings (kernel/irq/timings.c), in addition to the
+ * next timer event. Interrupts which are not predictable are not accounted
+ * by the irq timings, so each state also keeps a short history of wakeups
+ * happening before its target residency, and a state which was left too
+ * early most of the recent times is avoided.
+ */
+
+#include <linux/cpuidle.h>
+#include <linux/interrupt.h>
+#include <linux/kernel.h>
+#include <linux/sched/clock.h>
+#include <linux/tick.h>
+
+/* Number of recent wakeups from each state used to detect early ones */
+#define IRQT_HISTORY	8
+
+struct irqt_device {
+	u8	early[CPUIDLE_STATE_MAX];	/* bitmap of the last wakeups */
+	int	last_state_idx;
+	bool	needs_update;
+};
+
+static DEFINE_PER_CPU(struct irqt_device, irqt_devices);
+
+static bool irqt_state_enabled(struct cpuidle_driver *drv,
+			       struct cpuidle_device *dev, int i)
+{
+	return !drv->states[i].disabled && !dev->states_usage[i].disable;
+}
+
+/**
+ * irqt_update - record whether the last idle period ended too early
+ * @drv: cpuidle driver
+ * @dev: the CPU
+ */
+static void irqt_update(struct cpuidle_driver *drv, struct cpuidle_device *dev)
+{
+	struct irqt_device *data = this_cpu_ptr(&irqt_devices);
+	int idx = data->last_state_idx;
+	u8 early = dev->last_residency < drv->states[idx].target_residency;
+
+	data->early[idx] = (data->early[idx] << 1) | early;
+}
+
+/**
+ * irqt_select - selects the next idle state to enter
+ * @drv: cpuidle driver containing state data
+ * @dev: the CPU
+ * @stop_tick: indication on whether or not to stop the tick
+ */
+static int irqt_select(struct cpuidle_driver *drv, struct cpuidle_device *dev,
+		       bool *stop_tick)
+{
+	struct irqt_device *data = this_cpu_ptr(&irqt_devices);
+	int latency_req = cpuidle_governor_latency_req(dev->cpu);
+	unsigned int predicted_us;
+	ktime_t delta_next;
+	u64 now, next_irq;
+	s64 sleep_ns;
+	int i, idx;
+
+	if (data->needs_update) {
+		irqt_update(drv, dev);
+		data->needs_update = false;
+	}
+
+	/* Special case when user has set very strict latency requirement */
+	if (unlikely(latency_req == 0)) {
+		*stop_tick = false;
+		return 0;
+	}
+
+	sleep_ns = ktime_to_ns(tick_nohz_get_sleep_length(&delta_next));
+
+	now = local_clock();
+	next_irq = irq_timings_next_event(now);
+	if (next_irq != U64_MAX)
+		sleep_ns = min_t(s64, sleep_ns, next_irq - now);
+
+	predicted_us = div_u64(max_t(s64, sleep_ns, 0), NSEC_PER_USEC);
+
+	idx = -1;
+	for (i = 0; i < drv->state_count; i++) {
+		struct cpuidle_state *s = &drv->states[i];
+
+		if (!irqt_state_enabled(drv, dev, i))
+			continue;
+		if (idx == -1) {
+			idx = i; /* first enabled state */
+			continue;
+		}
+		if (s->target_residency > predicted_us ||
+		    s->exit_latency > latency_req)
+			break;
+		/*
+		 * Mostly left before paying off recently. Age the history so
+		 * that the state is tried again after a few idle periods.
+		 */
+		if (hweight8(data->early[i]) > IRQT_HISTORY / 2) {
+			data->early[i] <<= 1;
+			break;
+		}
+		idx = i;
+	}
+
+	if (idx == -1)
+		idx = 0; /* No states enabled. Must use 0. */
+
+	/*
+	 * Keep the tick if the next wakeup is expected before it anyway, as
+	 * a misprediction would otherwise leave the CPU in a shallow state
+	 * for a long time.
+	 */
+	if (predicted_us < TICK_USEC && !tick_nohz_tick_stopped()) {
+		*stop_tick = false;
+
+		/* The tick is going to wake the CPU up before delta_next */
+		while (idx > 0 && drv->states[idx].target_residency >
+				  ktime_to_us(delta_next))
+			idx--;
+	}
+
+	data->last_state_idx = idx;
+
+	return idx;
+}
+
+/**
+ * irqt_reflect - records that data structures need update
+ * @dev: the CPU
+ * @index: the index of actual entered state
+ *
+ * The measured residency is only known after the interrupts are enabled
+ * again, so the history is updated at the next selection.
+ */
+static void irqt_reflect(struct cpuidle_device *dev, int index)
+{
+	struct irqt_device *data = this_cpu_ptr(&irqt_devices);
+
+	data->last_state_idx = index;
+	data->needs_update = index >= 0;
+}
+
+/**
+ * irqt_enable_device - scans a CPU's states and does setup
+ * @drv: cpuidle driver
+ * @dev: the CPU
+ */
+static int irqt_enable_device(struct cpuidle_driver *drv,
+			      struct cpuidle_device *dev)
+{
+	struct irqt_device *data = &per_cpu(irqt_devices, dev->cpu);
+
+	memset(data, 0, sizeof(*data));
+
+	return 0;
+}
+
+static struct cpuidle_governor irqt_governor = {
+	.name =		"irqt",
+	.rating =	15,
+	.enable =	irqt_enable_device,
+	.select =	irqt_select,
+	.reflect =	irqt_reflect,
+};
+
+/**
+ * init_irqt - initializes the governor
+ *
+ * It is rated below menu, and is selected through current_governor when
+ * booting with cpuidle_sysfs_switch.
+ */
+static int __init init_irqt(void)
+{
+	irq_timings_enable();
+
+	return cpuidle_register_governor(&irqt_governor);
+}
+
+postcore_initcall(init_irqt);
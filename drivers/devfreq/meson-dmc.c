@@ -0,0 +1,308 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * DDR frequency scaling for the Amlogic Meson GX memory controller
+ *
+ * The DDR clock of the GX SoCs is owned by the SCP firmware, which exposes
+ * it as a SCPI DVFS domain. The load is read from the bandwidth monitor of
+ * the DMC, which counts the DMC clock cycles in which a request of any port
+ * was granted.
+ *
+ * Other devfreq devices, e.g. the video decoder, can follow this one with
+ * the passive governor by pointing their "devfreq" property at its node.
+ */
+
+#include <linux/devfreq.h>
+#include <linux/io.h>
+#include <linux/ktime.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/of.h>
+#include <linux/platform_device.h>
+#include <linux/pm_opp.h>
+#include <linux/scpi_protocol.h>
+
+/* DMC bandwidth monitor registers */
+#define DMC_MON_CTRL2		(0x22 << 2)
+#define DMC_MON_ALL_GRANT_CNT	(0x24 << 2)
+
+#define DMC_MON_CTRL2_ENABLE	BIT(31)
+#define DMC_MON_CTRL2_CLEAR	BIT(30)
+
+struct meson_dmcfreq {
+	struct device *dev;
+	struct devfreq *devfreq;
+	struct devfreq_simple_ondemand_data ondemand_data;
+	struct scpi_ops *scpi;
+	struct scpi_dvfs_info *info;
+	void __iomem *base;
+	struct mutex lock;
+	unsigned long rate;
+	ktime_t last;
+	u8 domain;
+};
+
+static void meson_dmcfreq_start_monitor(struct meson_dmcfreq *dmcfreq)
+{
+	writel(DMC_MON_CTRL2_CLEAR, dmcfreq->base + DMC_MON_CTRL2);
+	writel(DMC_MON_CTRL2_ENABLE, dmcfreq->base + DMC_MON_CTRL2);
+	dmcfreq->last = ktime_get();
+}
+
+static void meson_dmcfreq_stop_monitor(struct meson_dmcfreq *dmcfreq)
+{
+	writel(0, dmcfreq->base + DMC_MON_CTRL2);
+}
+
+static int meson_dmcfreq_target(struct device *dev, unsigned long *freq,
+				u32 flags)
+{
+	struct meson_dmcfreq *dmcfreq = dev_get_drvdata(dev);
+	struct dev_pm_opp *opp;
+	unsigned long target_rate;
+	int err, idx;
+
+	opp = devfreq_recommended_opp(dev, freq, flags);
+	if (IS_ERR(opp))
+		return PTR_ERR(opp);
+
+	target_rate = dev_pm_opp_get_freq(opp);
+	dev_pm_opp_put(opp);
+
+	if (dmcfreq->rate == target_rate)
+		return 0;
+
+	for (idx = 0; idx < dmcfreq->info->count; idx++)
+		if (dmcfreq->info->opps[idx].freq == target_rate)
+			break;
+	if (idx == dmcfreq->info->count)
+		return -EINVAL;
+
+	mutex_lock(&dmcfreq->lock);
+
+	/* The SCP sets the voltage of the domain along with the frequency */
+	err = dmcfreq->scpi->dvfs_set_idx(dmcfreq->domain, idx);
+	if (err) {
+		dev_err(dev, "Cannot set frequency %lu (%d)\n", target_rate,
+			err);
+		goto out;
+	}
+
+	dmcfreq->rate = target_rate;
+	*freq = target_rate;
+
+out:
+	mutex_unlock(&dmcfreq->lock);
+	return err;
+}
+
+static int meson_dmcfreq_get_dev_status(struct device *dev,
+					struct devfreq_dev_status *stat)
+{
+	struct meson_dmcfreq *dmcfreq = dev_get_drvdata(dev);
+	ktime_t last = dmcfreq->last;
+	u32 busy;
+
+	meson_dmcfreq_stop_monitor(dmcfreq);
+	busy = readl(dmcfreq->base + DMC_MON_ALL_GRANT_CNT);
+	meson_dmcfreq_start_monitor(dmcfreq);
+
+	/* Both in DMC clock cycles */
+	stat->current_frequency = dmcfreq->rate;
+	stat->busy_time = busy;
+	stat->total_time = div_u64((u64)ktime_us_delta(dmcfreq->last, last) *
+				   (dmcfreq->rate / USEC_PER_MSEC),
+				   USEC_PER_MSEC);
+
+	return 0;
+}
+
+static int meson_dmcfreq_get_cur_freq(struct device *dev, unsigned long *freq)
+{
+	struct meson_dmcfreq *dmcfreq = dev_get_drvdata(dev);
+
+	*freq = dmcfreq->rate;
+
+	return 0;
+}
+
+static struct devfreq_dev_profile meson_devfreq_dmc_profile = {
+	.polling_ms	= 100,
+	.target		= meson_dmcfreq_target,
+	.get_dev_status	= meson_dmcfreq_get_dev_status,
+	.get_cur_freq	= meson_dmcfreq_get_cur_freq,
+};
+
+static __maybe_unused int meson_dmcfreq_suspend(struct device *dev)
+{
+	struct meson_dmcfreq *dmcfreq = dev_get_drvdata(dev);
+	int ret;
+
+	ret = devfreq_suspend_device(dmcfreq->devfreq);
+	if (ret < 0) {
+		dev_err(dev, "failed to suspend the devfreq devices\n");
+		return ret;
+	}
+
+	meson_dmcfreq_stop_monitor(dmcfreq);
+
+	return 0;
+}
+
+static __maybe_unused int meson_dmcfreq_resume(struct device *dev)
+{
+	struct meson_dmcfreq *dmcfreq = dev_get_drvdata(dev);
+	int ret;
+
+	meson_dmcfreq_start_monitor(dmcfreq);
+
+	ret = devfreq_resume_device(dmcfreq->devfreq);
+	if (ret < 0) {
+		dev_err(dev, "failed to resume the devfreq devices\n");
+		return ret;
+	}
+
+	return 0;
+}
+
+static SIMPLE_DEV_PM_OPS(meson_dmcfreq_pm, meson_dmcfreq_suspend,
+			 meson_dmcfreq_resume);
+
+static void meson_dmcfreq_remove_opps(struct meson_dmcfreq *dmcfreq)
+{
+	int i;
+
+	for (i = 0; i < dmcfreq->info->count; i++)
+		dev_pm_opp_remove(dmcfreq->dev, dmcfreq->info->opps[i].freq);
+}
+
+static int meson_dmcfreq_add_opps(struct meson_dmcfreq *dmcfreq)
+{
+	struct scpi_opp *opp;
+	int i, ret;
+
+	for (i = 0, opp = dmcfreq->info->opps; i < dmcfreq->info->count;
+	     i++, opp++) {
+		ret = dev_pm_opp_add(dmcfreq->dev, opp->freq,
+				     opp->m_volt * 1000);
+		if (ret) {
+			dev_err(dmcfreq->dev, "failed to add opp %uHz %umV\n",
+				opp->freq, opp->m_volt);
+			while (i-- > 0)
+				dev_pm_opp_remove(dmcfreq->dev, (--opp)->freq);
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+static int meson_dmcfreq_probe(struct platform_device *pdev)
+{
+	struct device *dev = &pdev->dev;
+	struct device_node *np = pdev->dev.of_node;
+	struct meson_dmcfreq *data;
+	struct resource *res;
+	u32 domain;
+	int ret, idx;
+
+	data = devm_kzalloc(dev, sizeof(struct meson_dmcfreq), GFP_KERNEL);
+	if (!data)
+		return -ENOMEM;
+
+	mutex_init(&data->lock);
+	data->dev = dev;
+
+	data->scpi = get_scpi_ops();
+	if (!data->scpi)
+		return -EPROBE_DEFER;
+
+	if (of_property_read_u32(np, "amlogic,scpi-domain", &domain)) {
+		dev_err(dev, "missing amlogic,scpi-domain\n");
+		return -EINVAL;
+	}
+	data->domain = domain;
+
+	res = platform_get_resource(pdev, IORESOURCE_MEM, 0);
+	data->base = devm_ioremap_resource(dev, res);
+	if (IS_ERR(data->base))
+		return PTR_ERR(data->base);
+
+	data->info = data->scpi->dvfs_get_info(data->domain);
+	if (IS_ERR(data->info)) {
+		dev_err(dev, "failed to get DVFS info of domain %u\n", domain);
+		return PTR_ERR(data->info);
+	}
+
+	idx = data->scpi->dvfs_get_idx(data->domain);
+	if (idx < 0 || idx >= data->info->count) {
+		dev_err(dev, "invalid current DVFS index %d\n", idx);
+		return idx < 0 ? idx : -EINVAL;
+	}
+	data->rate = data->info->opps[idx].freq;
+
+	ret = meson_dmcfreq_add_opps(data);
+	if (ret)
+		return ret;
+
+	of_property_read_u32(np, "upthreshold",
+			     &data->ondemand_data.upthreshold);
+	of_property_read_u32(np, "downdifferential",
+			     &data->ondemand_data.downdifferential);
+
+	platform_set_drvdata(pdev, data);
+	meson_dmcfreq_start_monitor(data);
+
+	meson_devfreq_dmc_profile.initial_freq = data->rate;
+
+	data->devfreq = devm_devfreq_add_device(dev,
+					   &meson_devfreq_dmc_profile,
+					   DEVFREQ_GOV_SIMPLE_ONDEMAND,
+					   &data->ondemand_data);
+	if (IS_ERR(data->devfreq)) {
+		ret = PTR_ERR(data->devfreq);
+		goto err_free_opp;
+	}
+
+	devm_devfreq_register_opp_notifier(dev, data->devfreq);
+
+	return 0;
+
+err_free_opp:
+	meson_dmcfreq_stop_monitor(data);
+	meson_dmcfreq_remove_opps(data);
+	return ret;
+}
+
+static int meson_dmcfreq_remove(struct platform_device *pdev)
+{
+	struct meson_dmcfreq *dmcfreq = dev_get_drvdata(&pdev->dev);
+
+	/*
+	 * Before remove the opp table we need to unregister the opp notifier.
+	 */
+	devm_devfreq_unregister_opp_notifier(dmcfreq->dev, dmcfreq->devfreq);
+	meson_dmcfreq_stop_monitor(dmcfreq);
+	meson_dmcfreq_remove_opps(dmcfreq);
+
+	return 0;
+}
+
+static const struct of_device_id meson_dmc_devfreq_of_match[] = {
+	{ .compatible = "amlogic,meson-gx-dmc" },
+	{ },
+};
+MODULE_DEVICE_TABLE(of, meson_dmc_devfreq_of_match);
+
+static struct platform_driver meson_dmcfreq_driver = {
+	.probe	= meson_dmcfreq_probe,
+	.remove = meson_dmcfreq_remove,
+	.driver = {
+		.name	= "meson-dmc-freq",
+		.pm	= &meson_dmcfreq_pm,
+		.of_match_table = meson_dmc_devfreq_of_match,
+	},
+};
+module_platform_driver(meson_dmcfreq_driver);
+
+MODULE_LICENSE("GPL v2");
+MODULE_DESCRIPTION("Amlogic Meson GX dmcfreq driver with devfreq framework");
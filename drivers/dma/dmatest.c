@@ -10,6 +10,7 @@
  */
 #define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
 
+#include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/dma-mapping.h>
 #include <linux/dmaengine.h>
@@ -20,6 +21,7 @@
 #include <linux/module.h>
 #include <linux/moduleparam.h>
 #include <linux/random.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/wait.h>
 
@@ -80,6 +82,11 @@ static bool norandom;
 module_param(norandom, bool, 0644);
 MODULE_PARM_DESC(norandom, "Disable random offset setup (default: random)");
 
+static unsigned int chunks = 1;
+module_param(chunks, uint, 0644);
+MODULE_PARM_DESC(chunks,
+		 "Number of descriptors each memcpy test is split in (default: 1)");
+
 static bool verbose;
 module_param(verbose, bool, S_IRUGO | S_IWUSR);
 MODULE_PARM_DESC(verbose, "Enable \"success\" result messages (default: off)");
@@ -95,6 +102,7 @@ MODULE_PARM_DESC(verbose, "Enable \"success\" result messages (default: off)");
  * @xor_sources:	number of xor source buffers
  * @pq_sources:		number of p+q source buffers
  * @timeout:		transfer timeout in msec, -1 for infinite timeout
+ * @chunks:		number of descriptors a memcpy test is split in
  */
 struct dmatest_params {
 	unsigned int	buf_size;
@@ -108,12 +116,52 @@ struct dmatest_params {
 	int		timeout;
 	bool		noverify;
 	bool		norandom;
+	unsigned int	chunks;
+};
+
+/* log2 buckets of durations in ns: bucket n counts [2^n, 2^(n+1)) */
+#define DMATEST_HIST_BUCKETS	32
+
+struct dmatest_hist {
+	u64		count;
+	u64		sum;
+	u64		min;
+	u64		max;
+	unsigned int	buckets[DMATEST_HIST_BUCKETS];
+};
+
+enum dmatest_stat {
+	DMATEST_STAT_MAP,	/* mapping, i.e. cache maintenance, of the buffers */
+	DMATEST_STAT_XFER,	/* issue_pending to completion callback */
+	DMATEST_STAT_UNMAP,	/* unmapping of the buffers */
+	DMATEST_STAT_NR,
+};
+
+static const char * const dmatest_stat_names[DMATEST_STAT_NR] = {
+	[DMATEST_STAT_MAP]	= "map",
+	[DMATEST_STAT_XFER]	= "xfer",
+	[DMATEST_STAT_UNMAP]	= "unmap",
+};
+
+/* Measurements of one thread, kept until the next run */
+struct dmatest_result {
+	struct list_head	node;
+	char			name[TASK_COMM_LEN];
+	unsigned int		buf_size;
+	unsigned int		chunks;
+	unsigned int		total_tests;
+	unsigned int		failed_tests;
+	unsigned long long	iops;
+	unsigned long long	kbs;
+	struct dmatest_hist	hist[DMATEST_STAT_NR];
 };
 
 /**
  * struct dmatest_info - test information.
  * @params:		test parameters
  * @lock:		access protection to the fields of this structure
+ * @results:		measurements of the threads of the last run
+ * @results_lock:	access protection to @results
  */
 static struct dmatest_info {
 	/* Test parameters */
@@ -124,9 +172,15 @@ static struct dmatest_info {
 	unsigned int		nr_channels;
 	struct mutex		lock;
 	bool			did_init;
+
+	struct list_head	results;
+	struct mutex		results_lock;
+	struct dentry		*debugfs;
 } test_info = {
 	.channels = LIST_HEAD_INIT(test_info.channels),
 	.lock = __MUTEX_INITIALIZER(test_info.lock),
+	.results = LIST_HEAD_INIT(test_info.results),
+	.results_lock = __MUTEX_INITIALIZER(test_info.results_lock),
 };
 
 static int dmatest_run_set(const char *val, const struct kernel_param *kp);
@@ -163,6 +217,7 @@ MODULE_PARM_DESC(run, "Run the test (default: false)");
 /* poor man's completion - we want to use wait_event_freezable() on it */
 struct dmatest_done {
 	bool			done;
+	ktime_t			end;
 	wait_queue_head_t	*wait;
 };
 
@@ -362,6 +417,7 @@ static void dmatest_callback(void *arg)
 	struct dmatest_thread *thread =
 		container_of(done, struct dmatest_thread, test_done);
 	if (!thread->done) {
+		done->end = ktime_get();
 		done->done = true;
 		wake_up_all(done->wait);
 	} else {
@@ -428,6 +484,59 @@ static unsigned long long dmatest_KBs(s64 runtime, unsigned long long len)
 	return dmatest_persec(runtime, len >> 10);
 }
 
+static void dmatest_hist_add(struct dmatest_result *res, enum dmatest_stat stat,
+			     ktime_t start, ktime_t end)
+{
+	struct dmatest_hist *h;
+	s64 ns = ktime_to_ns(ktime_sub(end, start));
+
+	if (!res)
+		return;
+
+	h = &res->hist[stat];
+	ns = max_t(s64, ns, 1);
+	if (!h->count || ns < h->min)
+		h->min = ns;
+	if (ns > h->max)
+		h->max = ns;
+	h->sum += ns;
+	h->count++;
+	h->buckets[min_t(unsigned int, ilog2(ns), DMATEST_HIST_BUCKETS - 1)]++;
+}
+
+/*
+ * Split a memcpy in up to chunks descriptors, to compare scatter-gather like
+ * transfers with a single contiguous one. All but the last one are submitted
+ * here without interrupt; the last one is returned for the caller to submit.
+ */
+static struct dma_async_tx_descriptor *
+dmatest_prep_memcpy(struct dma_chan *chan, dma_addr_t dst, dma_addr_t src,
+		    unsigned int len, u8 align, unsigned int chunks,
+		    enum dma_ctrl_flags flags)
+{
+	struct dma_device *dev = chan->device;
+	struct dma_async_tx_descriptor *tx;
+	unsigned int clen = len;
+
+	if (chunks > 1)
+		clen = ALIGN(DIV_ROUND_UP(len, chunks), 1 << align);
+
+	while (len > clen) {
+		tx = dev->device_prep_dma_memcpy(chan, dst, src, clen,
+						 DMA_CTRL_ACK);
+		if (!tx || dma_submit_error(tx->tx_submit(tx))) {
+			dmaengine_terminate_all(chan);
+			return NULL;
+		}
+
+		dst += clen;
+		src += clen;
+		len -= clen;
+	}
+
+	return dev->device_prep_dma_memcpy(chan, dst, src, len, flags);
+}
+
 /*
  * This function repeatedly tests DMA transfers of various lengths and
  * offsets for a given operation type until it is told to exit by
@@ -470,6 +579,8 @@ static int dmatest_func(void *data)
 	bool			is_memset = false;
 	dma_addr_t		*srcs;
 	dma_addr_t		*dma_pq;
+	struct dmatest_result	*res;
+	ktime_t			xfer_start;
 
 	set_freezable();
 
@@ -480,6 +591,9 @@ static int dmatest_func(void *data)
 	params = &info->params;
 	chan = thread->chan;
 	dev = chan->device;
+
+	/* Measurements are optional, the test runs without them */
+	res = kzalloc(sizeof(*res), GFP_KERNEL);
 	if (thread->type == DMA_MEMCPY) {
 		align = dev->copy_align;
 		src_cnt = dst_cnt = 1;
@@ -632,6 +746,7 @@ static int dmatest_func(void *data)
 		}
 
 		um->len = params->buf_size;
+		start = ktime_get();
 		for (i = 0; i < src_cnt; i++) {
 			void *buf = thread->srcs[i];
 			struct page *pg = virt_to_page(buf);
@@ -669,11 +784,12 @@ static int dmatest_func(void *data)
 			}
 			um->bidi_cnt++;
 		}
+		dmatest_hist_add(res, DMATEST_STAT_MAP, start, ktime_get());
 
 		if (thread->type == DMA_MEMCPY)
-			tx = dev->device_prep_dma_memcpy(chan,
-							 dsts[0] + dst_off,
-							 srcs[0], len, flags);
+			tx = dmatest_prep_memcpy(chan, dsts[0] + dst_off,
+						 srcs[0], len, align,
+						 params->chunks, flags);
 		else if (thread->type == DMA_MEMSET)
 			tx = dev->device_prep_dma_memset(chan,
 						dsts[0] + dst_off,
@@ -714,6 +830,7 @@ static int dmatest_func(void *data)
 			failed_tests++;
 			continue;
 		}
+		xfer_start = ktime_get();
 		dma_async_issue_pending(chan);
 
 		wait_event_freezable_timeout(thread->done_wait, done->done,
@@ -737,7 +854,11 @@ static int dmatest_func(void *data)
 			continue;
 		}
 
+		dmatest_hist_add(res, DMATEST_STAT_XFER, xfer_start, done->end);
+
+		start = ktime_get();
 		dmaengine_unmap_put(um);
+		dmatest_hist_add(res, DMATEST_STAT_UNMAP, start, ktime_get());
 
 		if (params->noverify) {
 			verbose_result("test passed", total_tests, src_off,
@@ -810,6 +931,20 @@ err_thread_type:
 		dmatest_persec(runtime, total_tests),
 		dmatest_KBs(runtime, total_len), ret);
 
+	if (res) {
+		strlcpy(res->name, current->comm, sizeof(res->name));
+		res->buf_size = params->buf_size;
+		res->chunks = thread->type == DMA_MEMCPY ? params->chunks : 1;
+		res->total_tests = total_tests;
+		res->failed_tests = failed_tests;
+		res->iops = dmatest_persec(runtime, total_tests);
+		res->kbs = dmatest_KBs(runtime, total_len);
+
+		mutex_lock(&info->results_lock);
+		list_add_tail(&res->node, &info->results);
+		mutex_unlock(&info->results_lock);
+	}
+
 	/* terminate all transfers on specified channels */
 	if (ret || failed_tests)
 		dmaengine_terminate_all(chan);
@@ -977,6 +1112,18 @@ static void request_channels(struct dmatest_info *info,
 	}
 }
 
+static void dmatest_free_results(struct dmatest_info *info)
+{
+	struct dmatest_result *res, *_res;
+
+	mutex_lock(&info->results_lock);
+	list_for_each_entry_safe(res, _res, &info->results, node) {
+		list_del(&res->node);
+		kfree(res);
+	}
+	mutex_unlock(&info->results_lock);
+}
+
 static void run_threaded_test(struct dmatest_info *info)
 {
 	struct dmatest_params *params = &info->params;
@@ -993,6 +1140,9 @@ static void run_threaded_test(struct dmatest_info *info)
 	params->timeout = timeout;
 	params->noverify = noverify;
 	params->norandom = norandom;
+	params->chunks = max(chunks, 1U);
+
+	dmatest_free_results(info);
 
 	request_channels(info, DMA_MEMCPY);
 	request_channels(info, DMA_MEMSET);
@@ -1069,11 +1219,65 @@ static int dmatest_run_set(const char *val, const struct kernel_param *kp)
 	return ret;
 }
 
+/*
+ * One block per thread of the last run, with the distribution of the time
+ * spent mapping the buffers, transferring and unmapping them.
+ */
+static int dmatest_results_show(struct seq_file *s, void *data)
+{
+	struct dmatest_info *info = s->private;
+	struct dmatest_result *res;
+	struct dmatest_hist *h;
+	int i, b;
+
+	mutex_lock(&info->results_lock);
+	list_for_each_entry(res, &info->results, node) {
+		seq_printf(s, "%s: buf_size %u chunks %u: %u tests, %u failures %llu iops %llu KB/s\n",
+			   res->name, res->buf_size, res->chunks,
+			   res->total_tests, res->failed_tests, res->iops,
+			   res->kbs);
+
+		for (i = 0; i < DMATEST_STAT_NR; i++) {
+			h = &res->hist[i];
+			if (!h->count)
+				continue;
+
+			seq_printf(s, "  %-5s min %llu avg %llu max %llu ns\n",
+				   dmatest_stat_names[i], h->min,
+				   div64_u64(h->sum, h->count), h->max);
+			for (b = 0; b < DMATEST_HIST_BUCKETS; b++) {
+				if (h->buckets[b])
+					seq_printf(s, "    >= %llu ns: %u\n",
+						   1ULL << b, h->buckets[b]);
+			}
+		}
+	}
+	mutex_unlock(&info->results_lock);
+
+	return 0;
+}
+
+static int dmatest_results_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, dmatest_results_show, inode->i_private);
+}
+
+static const struct file_operations dmatest_results_fops = {
+	.open		= dmatest_results_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static int __init dmatest_init(void)
 {
 	struct dmatest_info *info = &test_info;
 	struct dmatest_params *params = &info->params;
 
+	info->debugfs = debugfs_create_dir("dmatest", NULL);
+	debugfs_create_file("results", 0444, info->debugfs, info,
+			    &dmatest_results_fops);
+
 	if (dmatest_run) {
 		mutex_lock(&info->lock);
 		run_threaded_test(info);
@@ -1097,9 +1301,13 @@ static void __exit dmatest_exit(void)
 {
 	struct dmatest_info *info = &test_info;
 
+	debugfs_remove_recursive(info->debugfs);
+
 	mutex_lock(&info->lock);
 	stop_threaded_test(info);
 	mutex_unlock(&info->lock);
+
+	dmatest_free_results(info);
 }
 module_exit(dmatest_exit);
 
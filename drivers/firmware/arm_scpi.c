@@ -34,8 +34,10 @@
 #include <linux/export.h>
 #include <linux/io.h>
 #include <linux/kernel.h>
+#include <linux/ktime.h>
 #include <linux/list.h>
 #include <linux/mailbox_client.h>
+#include <linux/mailbox_controller.h>
 #include <linux/module.h>
 #include <linux/of_address.h>
 #include <linux/of_platform.h>
@@ -74,6 +76,8 @@
 #define FW_REV_PATCH_MASK	GENMASK(15, 0)
 
 #define MAX_RX_TIMEOUT		(msecs_to_jiffies(30))
+/* Replies the SCP answers without delay, polled for before sleeping */
+#define RX_POLL_US		20
 
 enum scpi_error_codes {
 	SCPI_SUCCESS = 0, /* Success */
@@ -238,6 +242,13 @@ struct scpi_xfer {
 	unsigned int rx_len;
 	struct list_head node;
 	struct completion done;
+	/* handed over to the mailbox, accessed under the rx_lock */
+	bool sent;
+	/* nobody waits for the reply, the xfer is freed when it arrives */
+	bool async;
+	u8 async_buf[8];
+	scpi_sensor_cb sensor_cb;
+	void *cb_data;
 };
 
 struct scpi_chan {
@@ -249,8 +260,10 @@ struct scpi_chan {
 	struct list_head xfers_list;
 	struct scpi_xfer *xfers;
 	spinlock_t rx_lock; /* locking for the rx pending list */
-	struct mutex xfers_lock;
+	spinlock_t xfers_lock;
+	wait_queue_head_t xfers_wait;
 	u8 token;
+	bool can_poll; /* controller supports mbox_client_peek_data */
 };
 
 struct scpi_drvinfo {
@@ -361,10 +374,35 @@ static inline int scpi_to_linux_errno(int errno)
 	return -EIO;
 }
 
+static void put_scpi_xfer(struct scpi_xfer *t, struct scpi_chan *ch);
+
+static u64 scpi_sensor_value(const void *buf)
+{
+	if (scpi_info->is_legacy)
+		/* only 32-bits supported, upper 32 bits can be junk */
+		return le32_to_cpup(buf);
+
+	return le64_to_cpup(buf);
+}
+
+static void scpi_async_done(struct scpi_xfer *t, struct scpi_chan *ch)
+{
+	/* SCPI error codes > 0, translate them to Linux scale*/
+	int ret = t->status ? scpi_to_linux_errno(t->status) : 0;
+
+	if (t->sensor_cb)
+		t->sensor_cb(t->cb_data, ret,
+			     ret ? 0 : scpi_sensor_value(t->async_buf));
+	else if (ret)
+		pr_warn_ratelimited("command 0x%x failed: %d\n", t->cmd, ret);
+
+	put_scpi_xfer(t, ch);
+}
+
 static void scpi_process_cmd(struct scpi_chan *ch, u32 cmd)
 {
 	unsigned long flags;
-	struct scpi_xfer *t, *match = NULL;
+	struct scpi_xfer *t, *match = NULL, *async = NULL;
 
 	spin_lock_irqsave(&ch->rx_lock, flags);
 	if (list_empty(&ch->rx_pending)) {
@@ -413,8 +451,14 @@ static void scpi_process_cmd(struct scpi_chan *ch, u32 cmd)
 		if (match->rx_len > len)
 			memset(match->rx_buf + len, 0, match->rx_len - len);
 		complete(&match->done);
+
+		if (match->async)
+			async = match;
 	}
 	spin_unlock_irqrestore(&ch->rx_lock, flags);
+
+	if (async)
+		scpi_async_done(async, ch);
 }
 
 static void scpi_handle_remote_msg(struct mbox_client *c, void *msg)
@@ -449,6 +493,7 @@ static void scpi_tx_prepare(struct mbox_client *c, void *msg)
 		t->cmd |= FIELD_PREP(CMD_TOKEN_ID_MASK, ch->token);
 		spin_lock_irqsave(&ch->rx_lock, flags);
 		list_add_tail(&t->node, &ch->rx_pending);
+		t->sent = true;
 		spin_unlock_irqrestore(&ch->rx_lock, flags);
 	}
 
@@ -459,36 +504,42 @@ static void scpi_tx_prepare(struct mbox_client *c, void *msg)
 static struct scpi_xfer *get_scpi_xfer(struct scpi_chan *ch)
 {
 	struct scpi_xfer *t;
+	unsigned long flags;
 
-	mutex_lock(&ch->xfers_lock);
+	spin_lock_irqsave(&ch->xfers_lock, flags);
 	if (list_empty(&ch->xfers_list)) {
-		mutex_unlock(&ch->xfers_lock);
+		spin_unlock_irqrestore(&ch->xfers_lock, flags);
 		return NULL;
 	}
 	t = list_first_entry(&ch->xfers_list, struct scpi_xfer, node);
 	list_del(&t->node);
-	mutex_unlock(&ch->xfers_lock);
+	spin_unlock_irqrestore(&ch->xfers_lock, flags);
 	return t;
 }
 
 static void put_scpi_xfer(struct scpi_xfer *t, struct scpi_chan *ch)
 {
-	mutex_lock(&ch->xfers_lock);
+	unsigned long flags;
+
+	spin_lock_irqsave(&ch->xfers_lock, flags);
 	list_add_tail(&t->node, &ch->xfers_list);
-	mutex_unlock(&ch->xfers_lock);
+	spin_unlock_irqrestore(&ch->xfers_lock, flags);
+
+	wake_up(&ch->xfers_wait);
 }
 
-static int scpi_send_message(u8 idx, void *tx_buf, unsigned int tx_len,
-			     void *rx_buf, unsigned int rx_len)
+static struct scpi_xfer *scpi_prepare_xfer(u8 idx, void *tx_buf,
+					   unsigned int tx_len, void *rx_buf,
+					   unsigned int rx_len, bool atomic,
+					   struct scpi_chan **pchan)
 {
-	int ret;
 	u8 chan;
 	u8 cmd;
 	struct scpi_xfer *msg;
 	struct scpi_chan *scpi_chan;
 
 	if (scpi_info->commands[idx] < 0)
-		return -EOPNOTSUPP;
+		return ERR_PTR(-EOPNOTSUPP);
 
 	cmd = scpi_info->commands[idx];
 
@@ -499,9 +550,17 @@ static int scpi_send_message(u8 idx, void *tx_buf, unsigned int tx_len,
 			scpi_info->num_chans;
 	scpi_chan = scpi_info->channels + chan;
 
+	/*
+	 * All the xfers of the channel may be in flight, only wait for one
+	 * to be released if we can sleep.
+	 */
 	msg = get_scpi_xfer(scpi_chan);
+	if (!msg && !atomic)
+		wait_event_timeout(scpi_chan->xfers_wait,
+				   (msg = get_scpi_xfer(scpi_chan)),
+				   MAX_RX_TIMEOUT);
 	if (!msg)
-		return -ENOMEM;
+		return ERR_PTR(atomic ? -EBUSY : -ENOMEM);
 
 	if (scpi_info->is_legacy) {
 		msg->cmd = PACK_LEGACY_SCPI_CMD(cmd, tx_len);
@@ -514,17 +573,68 @@ static int scpi_send_message(u8 idx, void *tx_buf, unsigned int tx_len,
 	msg->tx_len = tx_len;
 	msg->rx_buf = rx_buf;
 	msg->rx_len = rx_len;
+	msg->sent = false;
+	msg->async = false;
+	msg->sensor_cb = NULL;
 	reinit_completion(&msg->done);
 
+	*pchan = scpi_chan;
+
+	return msg;
+}
+
+static int scpi_send_message(u8 idx, void *tx_buf, unsigned int tx_len,
+			     void *rx_buf, unsigned int rx_len)
+{
+	int ret;
+	bool orphan = false;
+	unsigned long flags;
+	struct scpi_xfer *msg;
+	struct scpi_chan *scpi_chan;
+
+	msg = scpi_prepare_xfer(idx, tx_buf, tx_len, rx_buf, rx_len, false,
+				&scpi_chan);
+	if (IS_ERR(msg))
+		return PTR_ERR(msg);
+
 	ret = mbox_send_message(scpi_chan->chan, msg);
 	if (ret < 0 || !rx_buf)
 		goto out;
 
+	if (scpi_chan->can_poll) {
+		ktime_t end = ktime_add_us(ktime_get(), RX_POLL_US);
+
+		while (!completion_done(&msg->done) &&
+		       ktime_before(ktime_get(), end))
+			if (!mbox_client_peek_data(scpi_chan->chan))
+				cpu_relax();
+	}
+
 	if (!wait_for_completion_timeout(&msg->done, MAX_RX_TIMEOUT))
 		ret = -ETIMEDOUT;
 	else
 		/* first status word */
 		ret = msg->status;
+
+	if (ret == -ETIMEDOUT && tx_len <= sizeof(msg->async_buf)) {
+		/*
+		 * Still queued in the mailbox behind other messages: make
+		 * it self contained, the reply will free it.
+		 */
+		spin_lock_irqsave(&scpi_chan->rx_lock, flags);
+		if (!msg->sent) {
+			if (tx_buf)
+				memcpy(msg->async_buf, tx_buf, tx_len);
+			msg->tx_buf = msg->async_buf;
+			msg->rx_buf = msg->async_buf;
+			msg->rx_len = sizeof(msg->async_buf);
+			msg->async = true;
+			orphan = true;
+		}
+		spin_unlock_irqrestore(&scpi_chan->rx_lock, flags);
+		if (orphan)
+			return ret;
+	}
 out:
 	if (ret < 0 && rx_buf) /* remove entry from the list if timed-out */
 		scpi_process_cmd(scpi_chan, msg->cmd);
@@ -534,6 +644,43 @@ out:
 	return ret > 0 ? scpi_to_linux_errno(ret) : ret;
 }
 
+/*
+ * Post a command without waiting for its reply, usable from atomic
+ * context. The reply is handed to the sensor callback if there is one,
+ * otherwise its status is only logged on failure.
+ */
+static int scpi_send_message_async(u8 idx, void *tx_buf, unsigned int tx_len,
+				   scpi_sensor_cb sensor_cb, void *cb_data)
+{
+	int ret;
+	struct scpi_xfer *msg;
+	struct scpi_chan *scpi_chan;
+
+	/* The tx buffer is copied in tx_prepare, which may run later */
+	if (tx_len > sizeof(msg->async_buf))
+		return -EINVAL;
+
+	msg = scpi_prepare_xfer(idx, NULL, tx_len, NULL, 0, true, &scpi_chan);
+	if (IS_ERR(msg))
+		return PTR_ERR(msg);
+
+	memcpy(msg->async_buf, tx_buf, tx_len);
+	msg->tx_buf = msg->async_buf;
+	msg->rx_buf = msg->async_buf;
+	msg->rx_len = sizeof(msg->async_buf);
+	msg->async = true;
+	msg->sensor_cb = sensor_cb;
+	msg->cb_data = cb_data;
+
+	ret = mbox_send_message(scpi_chan->chan, msg);
+	if (ret < 0) {
+		put_scpi_xfer(msg, scpi_chan);
+		return ret;
+	}
+
+	return 0;
+}
+
 static u32 scpi_get_version(void)
 {
 	return scpi_info->protocol_version;
@@ -611,6 +758,14 @@ static int scpi_dvfs_set_idx(u8 domain, u8 index)
 				 &stat, sizeof(stat));
 }
 
+static int scpi_dvfs_set_idx_async(u8 domain, u8 index)
+{
+	struct dvfs_set dvfs = {domain, index};
+
+	return scpi_send_message_async(CMD_SET_DVFS, &dvfs, sizeof(dvfs),
+				       NULL, NULL);
+}
+
 static int opp_cmp_func(const void *opp1, const void *opp2)
 {
 	const struct scpi_opp *t1 = opp1, *t2 = opp2;
@@ -756,15 +911,20 @@ static int scpi_sensor_get_value(u16 sensor, u64 *val)
 	if (ret)
 		return ret;
 
-	if (scpi_info->is_legacy)
-		/* only 32-bits supported, upper 32 bits can be junk */
-		*val = le32_to_cpup((__le32 *)&value);
-	else
-		*val = le64_to_cpu(value);
+	*val = scpi_sensor_value(&value);
 
 	return 0;
 }
 
+static int scpi_sensor_get_value_async(u16 sensor, scpi_sensor_cb cb,
+				       void *data)
+{
+	__le16 id = cpu_to_le16(sensor);
+
+	return scpi_send_message_async(CMD_SENSOR_VALUE, &id, sizeof(id),
+				       cb, data);
+}
+
 static int scpi_device_get_power_state(u16 dev_id)
 {
 	int ret;
@@ -795,6 +955,7 @@ static struct scpi_ops scpi_ops = {
 	.clk_set_val = scpi_clk_set_val,
 	.dvfs_get_idx = scpi_dvfs_get_idx,
 	.dvfs_set_idx = scpi_dvfs_set_idx,
+	.dvfs_set_idx_async = scpi_dvfs_set_idx_async,
 	.dvfs_get_info = scpi_dvfs_get_info,
 	.device_domain_id = scpi_dev_domain_id,
 	.get_transition_latency = scpi_dvfs_get_transition_latency,
@@ -802,6 +963,7 @@ static struct scpi_ops scpi_ops = {
 	.sensor_get_capability = scpi_sensor_get_capability,
 	.sensor_get_info = scpi_sensor_get_info,
 	.sensor_get_value = scpi_sensor_get_value,
+	.sensor_get_value_async = scpi_sensor_get_value_async,
 	.device_get_power_state = scpi_device_get_power_state,
 	.device_set_power_state = scpi_device_set_power_state,
 };
@@ -962,20 +1124,27 @@ static int scpi_probe(struct platform_device *pdev)
 		cl->dev = dev;
 		cl->rx_callback = scpi_handle_remote_msg;
 		cl->tx_prepare = scpi_tx_prepare;
-		cl->tx_block = true;
-		cl->tx_tout = 20;
+		/*
+		 * Every command waits for its reply instead, which lets
+		 * asynchronous commands be posted from atomic context.
+		 */
+		cl->tx_block = false;
 		cl->knows_txdone = false; /* controller can't ack */
 
 		INIT_LIST_HEAD(&pchan->rx_pending);
 		INIT_LIST_HEAD(&pchan->xfers_list);
 		spin_lock_init(&pchan->rx_lock);
-		mutex_init(&pchan->xfers_lock);
+		spin_lock_init(&pchan->xfers_lock);
+		init_waitqueue_head(&pchan->xfers_wait);
 
 		ret = scpi_alloc_xfer_list(dev, pchan);
 		if (!ret) {
 			pchan->chan = mbox_request_channel(cl, idx);
-			if (!IS_ERR(pchan->chan))
+			if (!IS_ERR(pchan->chan)) {
+				pchan->can_poll =
+					!!pchan->chan->mbox->ops->peek_data;
 				continue;
+			}
 			ret = PTR_ERR(pchan->chan);
 			if (ret != -EPROBE_DEFER)
 				dev_err(dev, "failed to get channel%d err %d\n",
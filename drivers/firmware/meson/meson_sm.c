@@ -18,6 +18,7 @@
 #include <linux/bug.h>
 #include <linux/io.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
 #include <linux/of.h>
 #include <linux/of_device.h>
 #include <linux/platform_device.h>
@@ -54,13 +55,23 @@ struct meson_sm_chip gxbb_chip = {
 	},
 };
 
+#define SM_SERIAL_ID_LENGTH	119
+#define SM_SERIAL_ID_OFFSET	4
+#define SM_SERIAL_ID_SIZE	12
+
 struct meson_sm_firmware {
 	const struct meson_sm_chip *chip;
 	void __iomem *sm_shmem_in_base;
 	void __iomem *sm_shmem_out_base;
+	/* The firmware has a single buffer per direction */
+	struct mutex shmem_lock;
+	u8 serial[SM_SERIAL_ID_SIZE];
+	bool serial_valid;
 };
 
-static struct meson_sm_firmware fw;
+static struct meson_sm_firmware fw = {
+	.shmem_lock = __MUTEX_INITIALIZER(fw.shmem_lock),
+};
 
 static u32 meson_sm_get_cmd(const struct meson_sm_chip *chip,
 			    unsigned int cmd_index)
@@ -158,11 +169,17 @@ int meson_sm_call_read(void *buffer, unsigned int bsize, unsigned int cmd_index,
 	if (bsize > fw.chip->shmem_size)
 		return -EINVAL;
 
-	if (meson_sm_call(cmd_index, &size, arg0, arg1, arg2, arg3, arg4) < 0)
-		return -EINVAL;
+	mutex_lock(&fw.shmem_lock);
 
-	if (size > bsize)
-		return -EINVAL;
+	if (meson_sm_call(cmd_index, &size, arg0, arg1, arg2, arg3, arg4) < 0) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	if (size > bsize) {
+		ret = -EINVAL;
+		goto out;
+	}
 
 	ret = size;
 
@@ -172,6 +189,9 @@ int meson_sm_call_read(void *buffer, unsigned int bsize, unsigned int cmd_index,
 	if (buffer)
 		memcpy(buffer, fw.sm_shmem_out_base, size);
 
+out:
+	mutex_unlock(&fw.shmem_lock);
+
 	return ret;
 }
 EXPORT_SYMBOL(meson_sm_call_read);
@@ -194,6 +214,7 @@ int meson_sm_call_write(void *buffer, unsigned int size, unsigned int cmd_index,
 			u32 arg0, u32 arg1, u32 arg2, u32 arg3, u32 arg4)
 {
 	u32 written;
+	int ret;
 
 	if (!fw.chip)
 		return -ENOENT;
@@ -204,24 +225,26 @@ int meson_sm_call_write(void *buffer, unsigned int size, unsigned int cmd_index,
 	if (!fw.chip->cmd_shmem_in_base)
 		return -EINVAL;
 
+	mutex_lock(&fw.shmem_lock);
+
 	memcpy(fw.sm_shmem_in_base, buffer, size);
 
-	if (meson_sm_call(cmd_index, &written, arg0, arg1, arg2, arg3, arg4) < 0)
-		return -EINVAL;
+	ret = meson_sm_call(cmd_index, &written, arg0, arg1, arg2, arg3, arg4);
+
+	mutex_unlock(&fw.shmem_lock);
 
-	if (!written)
+	if (ret < 0 || !written)
 		return -EINVAL;
 
 	return written;
 }
 EXPORT_SYMBOL(meson_sm_call_write);
 
-#define SM_SERIAL_ID_LENGTH	119
-#define SM_SERIAL_ID_OFFSET	4
-#define SM_SERIAL_ID_SIZE	12
-
-static ssize_t serial_show(struct device *dev, struct device_attribute *attr,
-			 char *buf)
+/*
+ * The serial never changes, so it is read once at probe and then served
+ * without going through the secure monitor and its shared memory again.
+ */
+static int meson_sm_read_serial(void)
 {
 	uint8_t *id_buf;
 	int ret;
@@ -232,28 +255,29 @@ static ssize_t serial_show(struct device *dev, struct device_attribute *attr,
 
 	ret = meson_sm_call_read(id_buf, SM_SERIAL_ID_LENGTH, SM_SERIAL_ID,
 				 0, 0, 0, 0, 0);
-	if (ret < 0) {
-		kfree(id_buf);
-		return ret;
+	if (ret >= 0) {
+		memcpy(fw.serial, &id_buf[SM_SERIAL_ID_OFFSET],
+		       SM_SERIAL_ID_SIZE);
+		fw.serial_valid = true;
 	}
 
-	ret = sprintf(buf, "%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x\n",
-			id_buf[SM_SERIAL_ID_OFFSET + 0],
-			id_buf[SM_SERIAL_ID_OFFSET + 1],
-			id_buf[SM_SERIAL_ID_OFFSET + 2],
-			id_buf[SM_SERIAL_ID_OFFSET + 3],
-			id_buf[SM_SERIAL_ID_OFFSET + 4],
-			id_buf[SM_SERIAL_ID_OFFSET + 5],
-			id_buf[SM_SERIAL_ID_OFFSET + 6],
-			id_buf[SM_SERIAL_ID_OFFSET + 7],
-			id_buf[SM_SERIAL_ID_OFFSET + 8],
-			id_buf[SM_SERIAL_ID_OFFSET + 9],
-			id_buf[SM_SERIAL_ID_OFFSET + 10],
-			id_buf[SM_SERIAL_ID_OFFSET + 11]);
-
 	kfree(id_buf);
 
-	return ret;
+	return ret < 0 ? ret : 0;
+}
+
+static ssize_t serial_show(struct device *dev, struct device_attribute *attr,
+			 char *buf)
+{
+	int ret;
+
+	if (!fw.serial_valid) {
+		ret = meson_sm_read_serial();
+		if (ret)
+			return ret;
+	}
+
+	return sprintf(buf, "%*phN\n", SM_SERIAL_ID_SIZE, fw.serial);
 }
 
 static DEVICE_ATTR_RO(serial);
@@ -295,6 +319,9 @@ static int __init meson_sm_probe(struct platform_device *pdev)
 	fw.chip = chip;
 	pr_info("secure-monitor enabled\n");
 
+	if (meson_sm_read_serial())
+		pr_warn("failed to read the chip serial\n");
+
 	if (sysfs_create_group(&pdev->dev.kobj, &meson_sm_sysfs_attr_group))
 		goto out_in_base;
 
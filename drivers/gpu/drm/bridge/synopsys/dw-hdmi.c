@@ -148,7 +148,9 @@ struct dw_hdmi {
 
 	int vic;
 
-	u8 edid[HDMI_EDID_LEN];
+	u8 edid[HDMI_EDID_LEN];		/* last EDID read from the sink */
+	unsigned int edid_len;		/* 0 if not cached */
+	bool edid_hit;			/* base block matches the cache */
 
 	struct {
 		const struct dw_hdmi_phy_ops *ops;
@@ -1996,6 +1998,95 @@ static void dw_hdmi_update_phy_mask(struct dw_hdmi *hdmi)
 					  hdmi->rxsense);
 }
 
+#define DDC_ADDR		0x50
+#define DDC_SEGMENT_ADDR	0x30
+
+static int dw_hdmi_ddc_read_block(struct i2c_adapter *ddc, u8 *buf,
+				  unsigned int block, size_t len)
+{
+	u8 start = block * EDID_LENGTH;
+	u8 segment = block >> 1;
+	unsigned int xfers = segment ? 3 : 2;
+	struct i2c_msg msgs[] = {
+		{
+			.addr	= DDC_SEGMENT_ADDR,
+			.flags	= 0,
+			.len	= 1,
+			.buf	= &segment,
+		}, {
+			.addr	= DDC_ADDR,
+			.flags	= 0,
+			.len	= 1,
+			.buf	= &start,
+		}, {
+			.addr	= DDC_ADDR,
+			.flags	= I2C_M_RD,
+			.len	= len,
+			.buf	= buf,
+		}
+	};
+
+	if (i2c_transfer(ddc, &msgs[3 - xfers], xfers) != xfers)
+		return -EIO;
+
+	return 0;
+}
+
+/*
+ * The base block is always read from the sink. When it is identical to
+ * the cached one, checksum included, the extension blocks are served
+ * from the cache instead of going through the slow DDC bus.
+ */
+static int dw_hdmi_get_edid_block(void *data, u8 *buf, unsigned int block,
+				  size_t len)
+{
+	struct dw_hdmi *hdmi = data;
+	size_t offset = block * EDID_LENGTH;
+	int ret;
+
+	if (block && hdmi->edid_hit && offset + len <= hdmi->edid_len) {
+		memcpy(buf, hdmi->edid + offset, len);
+		return 0;
+	}
+
+	ret = dw_hdmi_ddc_read_block(hdmi->ddc, buf, block, len);
+	if (ret)
+		return ret;
+
+	if (!block)
+		hdmi->edid_hit = hdmi->edid_len &&
+				 !memcmp(buf, hdmi->edid, len);
+
+	return 0;
+}
+
+static struct edid *dw_hdmi_get_edid(struct dw_hdmi *hdmi,
+				     struct drm_connector *connector)
+{
+	struct edid *edid;
+	size_t size;
+
+	if (!drm_probe_ddc(hdmi->ddc))
+		return NULL;
+
+	edid = drm_do_get_edid(connector, dw_hdmi_get_edid_block, hdmi);
+	if (!edid) {
+		hdmi->edid_len = 0;
+		hdmi->edid_hit = false;
+		return NULL;
+	}
+
+	size = (edid->extensions + 1) * EDID_LENGTH;
+	if (size <= HDMI_EDID_LEN) {
+		memcpy(hdmi->edid, edid, size);
+		hdmi->edid_len = size;
+	} else {
+		hdmi->edid_len = 0;
+	}
+
+	return edid;
+}
+
 static int dw_hdmi_connector_update_edid(struct drm_connector *connector,
 					  bool add_modes)
 {
@@ -2007,9 +2098,10 @@ static int dw_hdmi_connector_update_edid(struct drm_connector *connector,
 	if (!hdmi->ddc)
 		return 0;
 
-	edid = drm_get_edid(connector, hdmi->ddc);
+	edid = dw_hdmi_get_edid(hdmi, connector);
 	if (edid) {
-		dev_dbg(hdmi->dev, "got edid: width[%d] x height[%d]\n",
+		dev_dbg(hdmi->dev, "got %s edid: width[%d] x height[%d]\n",
+			hdmi->edid_hit ? "cached" : "new",
 			edid->width_cm, edid->height_cm);
 
 		hdmi->sink_is_hdmi = drm_detect_hdmi_monitor(edid);
@@ -23,9 +23,15 @@
 #define __MESON_CANVAS_H
 
 #define MESON_CANVAS_ID_OSD1	0x4e
+#define MESON_CANVAS_ID_OSD2	0x4f
 #define MESON_CANVAS_ID_VD1_0	0x60
 #define MESON_CANVAS_ID_VD1_1	0x61
 #define MESON_CANVAS_ID_VD1_2	0x62
+#define MESON_CANVAS_ID_WB_0	0x63
+#define MESON_CANVAS_ID_WB_1	0x64
+
+/* Canvases reserved from the canvas provider */
+#define MESON_NUM_CANVAS	7
 
 /* Canvas configuration. */
 #define MESON_CANVAS_WRAP_NONE	0x00
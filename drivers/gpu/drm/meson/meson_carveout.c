@@ -0,0 +1,287 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Copyright (C) 2018 BayLibre, SAS
+ *
+ * Optional scanout carveout, backed by the VPU "memory-region" reserved
+ * memory. Dumb buffers are served from a few size classes matching the
+ * common framebuffer sizes. A class slot is carved from the region the
+ * first time it is needed, and goes back to the free list of its class
+ * when the buffer is freed, so allocations never go through CMA
+ * compaction and are O(1) once the slots exist.
+ * Buffers larger than the biggest class, or allocated when the region is
+ * exhausted, fall back to the CMA helpers.
+ */
+
+#include <linux/kernel.h>
+#include <linux/list.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/vmalloc.h>
+#include <linux/of_reserved_mem.h>
+#include <drm/drmP.h>
+#include <drm/drm_gem_cma_helper.h>
+
+#include "meson_carveout.h"
+
+/* Cursors, 720p, 1080p and 2160p XRGB8888 framebuffers */
+static const size_t meson_carveout_class_size[] = {
+	SZ_1M, SZ_4M, SZ_8M, SZ_32M,
+};
+
+#define MESON_CARVEOUT_NUM_CLASSES	ARRAY_SIZE(meson_carveout_class_size)
+
+struct meson_carveout_slot {
+	struct list_head node;
+	phys_addr_t paddr;
+	void *vaddr;
+	unsigned int class;
+};
+
+struct meson_carveout {
+	spinlock_t lock;
+	phys_addr_t base;
+	phys_addr_t size;
+	phys_addr_t next;
+	void *vaddr;
+	struct list_head free[MESON_CARVEOUT_NUM_CLASSES];
+	struct list_head used;
+};
+
+struct meson_gem_object {
+	struct drm_gem_cma_object base;
+	struct meson_carveout_slot *slot;
+};
+#define to_meson_gem_object(x) \
+	container_of(x, struct meson_gem_object, base)
+
+static int meson_carveout_class(size_t size)
+{
+	int i;
+
+	for (i = 0; i < MESON_CARVEOUT_NUM_CLASSES; i++)
+		if (size <= meson_carveout_class_size[i])
+			return i;
+
+	return -EINVAL;
+}
+
+static struct meson_carveout_slot *
+meson_carveout_alloc(struct meson_carveout *carveout, size_t size)
+{
+	struct meson_carveout_slot *slot, *new;
+	int class = meson_carveout_class(size);
+	size_t class_size;
+
+	if (class < 0)
+		return NULL;
+
+	class_size = meson_carveout_class_size[class];
+
+	new = kzalloc(sizeof(*new), GFP_KERNEL);
+	if (!new)
+		return NULL;
+
+	spin_lock(&carveout->lock);
+
+	slot = list_first_entry_or_null(&carveout->free[class],
+					struct meson_carveout_slot, node);
+	if (slot) {
+		list_move(&slot->node, &carveout->used);
+	} else if (carveout->next + class_size <=
+		   carveout->base + carveout->size) {
+		slot = new;
+		new = NULL;
+		slot->class = class;
+		slot->paddr = carveout->next;
+		slot->vaddr = carveout->vaddr +
+			      (slot->paddr - carveout->base);
+		carveout->next += class_size;
+		list_add(&slot->node, &carveout->used);
+	}
+
+	spin_unlock(&carveout->lock);
+
+	kfree(new);
+
+	return slot;
+}
+
+static void meson_carveout_free(struct meson_carveout *carveout,
+				struct meson_carveout_slot *slot)
+{
+	spin_lock(&carveout->lock);
+	list_move(&slot->node, &carveout->free[slot->class]);
+	spin_unlock(&carveout->lock);
+}
+
+static int meson_gem_carveout_create(struct drm_file *file,
+				     struct drm_device *dev,
+				     struct drm_mode_create_dumb *args)
+{
+	struct meson_drm *priv = dev->dev_private;
+	struct meson_carveout_slot *slot;
+	struct meson_gem_object *obj;
+	struct drm_gem_object *gem;
+	size_t size = PAGE_ALIGN(args->size);
+	int ret;
+
+	slot = meson_carveout_alloc(priv->carveout, size);
+	if (!slot)
+		return -ENOMEM;
+
+	obj = kzalloc(sizeof(*obj), GFP_KERNEL);
+	if (!obj) {
+		ret = -ENOMEM;
+		goto free_slot;
+	}
+
+	gem = &obj->base.base;
+	ret = drm_gem_object_init(dev, gem, size);
+	if (ret) {
+		kfree(obj);
+		goto free_slot;
+	}
+
+	ret = drm_gem_create_mmap_offset(gem);
+	if (ret) {
+		drm_gem_object_release(gem);
+		kfree(obj);
+		goto free_slot;
+	}
+
+	obj->slot = slot;
+	obj->base.paddr = slot->paddr;
+	obj->base.vaddr = slot->vaddr;
+
+	/* Dumb buffers are expected to be cleared */
+	memset(obj->base.vaddr, 0, size);
+
+	/* On success, the handle holds the only reference */
+	ret = drm_gem_handle_create(file, gem, &args->handle);
+	drm_gem_object_put_unlocked(gem);
+
+	return ret;
+
+free_slot:
+	meson_carveout_free(priv->carveout, slot);
+
+	return ret;
+}
+
+int meson_gem_dumb_create(struct drm_file *file, struct drm_device *dev,
+			  struct drm_mode_create_dumb *args)
+{
+	struct meson_drm *priv = dev->dev_private;
+
+	/* The canvas needs 64 bytes aligned strides */
+	args->pitch = ALIGN(DIV_ROUND_UP(args->width * args->bpp, 8), SZ_64);
+	args->size = args->pitch * args->height;
+
+	if (priv->carveout &&
+	    !meson_gem_carveout_create(file, dev, args))
+		return 0;
+
+	return drm_gem_cma_dumb_create_internal(file, dev, args);
+}
+
+void meson_gem_free_object(struct drm_gem_object *gem)
+{
+	struct meson_drm *priv = gem->dev->dev_private;
+	struct drm_gem_cma_object *cma_obj = to_drm_gem_cma_obj(gem);
+	struct meson_carveout *carveout = priv->carveout;
+	struct meson_gem_object *obj;
+
+	if (!carveout || gem->import_attach ||
+	    cma_obj->paddr < carveout->base ||
+	    cma_obj->paddr >= carveout->base + carveout->size) {
+		drm_gem_cma_free_object(gem);
+		return;
+	}
+
+	obj = to_meson_gem_object(cma_obj);
+
+	meson_carveout_free(carveout, obj->slot);
+	drm_gem_object_release(gem);
+	kfree(obj);
+}
+
+int meson_carveout_create(struct meson_drm *priv)
+{
+	struct meson_carveout *carveout;
+	struct reserved_mem *rmem;
+	struct device_node *np;
+	struct page **pages;
+	unsigned int i, npages;
+
+	np = of_parse_phandle(priv->dev->of_node, "memory-region", 0);
+	if (!np)
+		return 0;
+
+	rmem = of_reserved_mem_lookup(np);
+	of_node_put(np);
+	if (!rmem) {
+		dev_warn(priv->dev, "Scanout memory-region is not reserved\n");
+		return 0;
+	}
+
+	/* The GEM CMA helpers need the pages for mmap and PRIME export */
+	if (!pfn_valid(PHYS_PFN(rmem->base))) {
+		dev_warn(priv->dev, "Scanout memory-region must be mapped\n");
+		return 0;
+	}
+
+	carveout = devm_kzalloc(priv->dev, sizeof(*carveout), GFP_KERNEL);
+	if (!carveout)
+		return -ENOMEM;
+
+	npages = rmem->size >> PAGE_SHIFT;
+	pages = kvmalloc_array(npages, sizeof(*pages), GFP_KERNEL);
+	if (!pages)
+		return -ENOMEM;
+
+	for (i = 0; i < npages; i++)
+		pages[i] = pfn_to_page(PHYS_PFN(rmem->base) + i);
+
+	/* Matches the write-combine mappings of the CMA helpers */
+	carveout->vaddr = vmap(pages, npages, VM_MAP,
+			       pgprot_writecombine(PAGE_KERNEL));
+	kvfree(pages);
+	if (!carveout->vaddr)
+		return -ENOMEM;
+
+	spin_lock_init(&carveout->lock);
+	carveout->base = rmem->base;
+	carveout->size = (phys_addr_t)npages << PAGE_SHIFT;
+	carveout->next = carveout->base;
+	for (i = 0; i < MESON_CARVEOUT_NUM_CLASSES; i++)
+		INIT_LIST_HEAD(&carveout->free[i]);
+	INIT_LIST_HEAD(&carveout->used);
+
+	priv->carveout = carveout;
+
+	dev_info(priv->dev, "Using %pa bytes of scanout carveout at %pa\n",
+		 &carveout->size, &carveout->base);
+
+	return 0;
+}
+
+void meson_carveout_destroy(struct meson_drm *priv)
+{
+	struct meson_carveout *carveout = priv->carveout;
+	struct meson_carveout_slot *slot, *tmp;
+	unsigned int i;
+
+	if (!carveout)
+		return;
+
+	/* Keep the mapping if a GEM object is still alive */
+	if (WARN_ON(!list_empty(&carveout->used)))
+		return;
+
+	for (i = 0; i < MESON_CARVEOUT_NUM_CLASSES; i++)
+		list_for_each_entry_safe(slot, tmp, &carveout->free[i], node)
+			kfree(slot);
+
+	vunmap(carveout->vaddr);
+	priv->carveout = NULL;
+}
@@ -0,0 +1,18 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Copyright (C) 2018 BayLibre, SAS
+ */
+
+#ifndef __MESON_CARVEOUT_H
+#define __MESON_CARVEOUT_H
+
+#include "meson_drv.h"
+
+int meson_carveout_create(struct meson_drm *priv);
+void meson_carveout_destroy(struct meson_drm *priv);
+
+int meson_gem_dumb_create(struct drm_file *file, struct drm_device *dev,
+			  struct drm_mode_create_dumb *args);
+void meson_gem_free_object(struct drm_gem_object *gem);
+
+#endif /* __MESON_CARVEOUT_H */
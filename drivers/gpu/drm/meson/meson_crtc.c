@@ -26,9 +26,12 @@
 #include <linux/mutex.h>
 #include <linux/platform_device.h>
 #include <linux/bitfield.h>
+#include <linux/sched/cpufreq.h>
+#include <linux/soc/amlogic/meson-tunnel.h>
 #include <drm/drmP.h>
 #include <drm/drm_atomic.h>
 #include <drm/drm_atomic_helper.h>
+#include <drm/drm_color_mgmt.h>
 #include <drm/drm_flip_work.h>
 #include <drm/drm_crtc_helper.h>
 
@@ -38,8 +41,14 @@
 #include "meson_vpp.h"
 #include "meson_viu.h"
 #include "meson_canvas.h"
+#include "meson_writeback.h"
 #include "meson_registers.h"
 
+static unsigned int flip_boost_us;
+module_param(flip_boost_us, uint, 0644);
+MODULE_PARM_DESC(flip_boost_us,
+		 "Request a schedutil boost of this length after each page flip (0 = off)");
+
 /* CRTC definition */
 
 struct meson_crtc {
@@ -50,6 +59,13 @@ struct meson_crtc {
 };
 #define to_meson_crtc(x) container_of(x, struct meson_crtc, base)
 
+struct meson_crtc_state {
+	struct drm_crtc_state base;
+	/* Set for DRM_MODE_PAGE_FLIP_ASYNC flips, never duplicated */
+	bool async_flip;
+};
+#define to_meson_crtc_state(x) container_of(x, struct meson_crtc_state, base)
+
 /* CRTC */
 
 static int meson_crtc_enable_vblank(struct drm_crtc *crtc)
@@ -70,15 +86,119 @@ static void meson_crtc_disable_vblank(struct drm_crtc *crtc)
 	meson_venc_disable_vsync(priv);
 }
 
+static void meson_crtc_destroy_state(struct drm_crtc *crtc,
+				     struct drm_crtc_state *state)
+{
+	__drm_atomic_helper_crtc_destroy_state(state);
+	kfree(to_meson_crtc_state(state));
+}
+
+static struct drm_crtc_state *meson_crtc_duplicate_state(struct drm_crtc *crtc)
+{
+	struct meson_crtc_state *state;
+
+	if (WARN_ON(!crtc->state))
+		return NULL;
+
+	state = kzalloc(sizeof(*state), GFP_KERNEL);
+	if (!state)
+		return NULL;
+
+	__drm_atomic_helper_crtc_duplicate_state(crtc, &state->base);
+
+	return &state->base;
+}
+
+static void meson_crtc_reset(struct drm_crtc *crtc)
+{
+	struct meson_crtc_state *state;
+
+	if (crtc->state)
+		meson_crtc_destroy_state(crtc, crtc->state);
+	crtc->state = NULL;
+
+	state = kzalloc(sizeof(*state), GFP_KERNEL);
+	if (!state)
+		return;
+
+	state->base.crtc = crtc;
+	crtc->state = &state->base;
+}
+
+/*
+ * Same as drm_atomic_helper_page_flip(), but tags asynchronous flips in
+ * the CRTC state so the new OSD1 buffer is latched without waiting for
+ * the vsync.
+ */
+static int meson_crtc_page_flip(struct drm_crtc *crtc,
+				struct drm_framebuffer *fb,
+				struct drm_pending_vblank_event *event,
+				uint32_t flags,
+				struct drm_modeset_acquire_ctx *ctx)
+{
+	struct drm_plane *plane = crtc->primary;
+	struct drm_plane_state *plane_state;
+	struct drm_crtc_state *crtc_state;
+	struct drm_atomic_state *state;
+	int ret;
+
+	if (!(flags & DRM_MODE_PAGE_FLIP_ASYNC))
+		return drm_atomic_helper_page_flip(crtc, fb, event, flags, ctx);
+
+	/* The AFBC decoder can only be reprogrammed at vsync */
+	if (fb->modifier != DRM_FORMAT_MOD_LINEAR)
+		return -EINVAL;
+
+	state = drm_atomic_state_alloc(plane->dev);
+	if (!state)
+		return -ENOMEM;
+
+	state->acquire_ctx = ctx;
+
+	crtc_state = drm_atomic_get_crtc_state(state, crtc);
+	if (IS_ERR(crtc_state)) {
+		ret = PTR_ERR(crtc_state);
+		goto out;
+	}
+
+	crtc_state->event = event;
+	to_meson_crtc_state(crtc_state)->async_flip = true;
+
+	plane_state = drm_atomic_get_plane_state(state, plane);
+	if (IS_ERR(plane_state)) {
+		ret = PTR_ERR(plane_state);
+		goto out;
+	}
+
+	ret = drm_atomic_set_crtc_for_plane(plane_state, crtc);
+	if (ret)
+		goto out;
+
+	drm_atomic_set_fb_for_plane(plane_state, fb);
+
+	/* Make sure we don't accidentally do a full modeset. */
+	state->allow_modeset = false;
+	if (!crtc_state->active) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	ret = drm_atomic_nonblocking_commit(state);
+out:
+	drm_atomic_state_put(state);
+	return ret;
+}
+
 static const struct drm_crtc_funcs meson_crtc_funcs = {
-	.atomic_destroy_state	= drm_atomic_helper_crtc_destroy_state,
-	.atomic_duplicate_state = drm_atomic_helper_crtc_duplicate_state,
+	.atomic_destroy_state	= meson_crtc_destroy_state,
+	.atomic_duplicate_state = meson_crtc_duplicate_state,
 	.destroy		= drm_crtc_cleanup,
-	.page_flip		= drm_atomic_helper_page_flip,
-	.reset			= drm_atomic_helper_crtc_reset,
+	.page_flip		= meson_crtc_page_flip,
+	.reset			= meson_crtc_reset,
 	.set_config             = drm_atomic_helper_set_config,
 	.enable_vblank		= meson_crtc_enable_vblank,
 	.disable_vblank		= meson_crtc_disable_vblank,
+	.gamma_set		= drm_atomic_helper_legacy_gamma_set,
 
 };
 
@@ -138,11 +258,17 @@ static void meson_crtc_atomic_disable(struct drm_crtc *crtc,
 	priv->viu.osd1_enabled = false;
 	priv->viu.osd1_commit = false;
 
+	priv->viu.osd2_enabled = false;
+	priv->viu.osd2_commit = false;
+
 	priv->viu.vd1_enabled = false;
 	priv->viu.vd1_commit = false;
 
+	meson_writeback_disable(priv);
+
 	/* Disable VPP Postblend */
-	writel_bits_relaxed(VPP_OSD1_POSTBLEND | VPP_VD1_POSTBLEND |
+	writel_bits_relaxed(VPP_OSD1_POSTBLEND | VPP_OSD2_POSTBLEND |
+			    VPP_VD1_POSTBLEND |
 			    VPP_VD1_PREBLEND | VPP_POSTBLEND_ENABLE, 0,
 			    priv->io_base + _REG(VPP_MISC));
 
@@ -161,19 +287,23 @@ static void meson_crtc_atomic_begin(struct drm_crtc *crtc,
 				    struct drm_crtc_state *state)
 {
 	struct meson_crtc *meson_crtc = to_meson_crtc(crtc);
-	unsigned long flags;
 
 	if (crtc->state->enable && !meson_crtc->enabled)
 		meson_crtc_enable(crtc);
+}
 
-	if (crtc->state->event) {
-		WARN_ON(drm_crtc_vblank_get(crtc) != 0);
-
-		spin_lock_irqsave(&crtc->dev->event_lock, flags);
-		meson_crtc->event = crtc->state->event;
-		spin_unlock_irqrestore(&crtc->dev->event_lock, flags);
-		crtc->state->event = NULL;
-	}
+static void meson_crtc_osd1_canvas(struct meson_drm *priv)
+{
+	if (priv->canvas)
+		meson_canvas_config(priv->canvas, priv->canvas_id_osd1,
+			priv->viu.osd1_addr, priv->viu.osd1_stride,
+			priv->viu.osd1_height, MESON_CANVAS_WRAP_NONE,
+			MESON_CANVAS_BLKMODE_LINEAR, 0);
+	else
+		meson_canvas_setup(priv, MESON_CANVAS_ID_OSD1,
+			priv->viu.osd1_addr, priv->viu.osd1_stride,
+			priv->viu.osd1_height, MESON_CANVAS_WRAP_NONE,
+			MESON_CANVAS_BLKMODE_LINEAR, 0);
 }
 
 static void meson_crtc_atomic_flush(struct drm_crtc *crtc,
@@ -181,9 +311,39 @@ static void meson_crtc_atomic_flush(struct drm_crtc *crtc,
 {
 	struct meson_crtc *meson_crtc = to_meson_crtc(crtc);
 	struct meson_drm *priv = meson_crtc->priv;
+	struct drm_pending_vblank_event *event = crtc->state->event;
+	unsigned long flags;
+
+	/*
+	 * Arm the event along with the commit flags, a vsync between
+	 * atomic_begin and here would otherwise signal the flip (and its
+	 * out-fence) before the new registers are applied.
+	 */
+	spin_lock_irqsave(&crtc->dev->event_lock, flags);
 
 	priv->viu.osd1_commit = true;
+	priv->viu.osd2_commit = true;
 	priv->viu.vd1_commit = true;
+
+	if (crtc->state->color_mgmt_changed)
+		meson_viu_set_color_mgmt(priv, crtc->state);
+
+	meson_writeback_atomic_flush(priv, old_crtc_state->state);
+
+	if (event) {
+		crtc->state->event = NULL;
+
+		if (to_meson_crtc_state(crtc->state)->async_flip) {
+			/* Swap the buffer now, tearing is expected */
+			meson_crtc_osd1_canvas(priv);
+			drm_crtc_send_vblank_event(crtc, event);
+		} else {
+			WARN_ON(drm_crtc_vblank_get(crtc) != 0);
+			meson_crtc->event = event;
+		}
+	}
+
+	spin_unlock_irqrestore(&crtc->dev->event_lock, flags);
 }
 
 static const struct drm_crtc_helper_funcs meson_crtc_helper_funcs = {
@@ -193,11 +353,134 @@ static const struct drm_crtc_helper_funcs meson_crtc_helper_funcs = {
 	.atomic_disable	= meson_crtc_atomic_disable,
 };
 
+/*
+ * Bob deinterlacing: every vsync, the VD1 MIF fetches every other line of
+ * the interlaced frame starting at the current field, and the vertical
+ * scaler stretches that field to the full picture height. The two fields
+ * are offset by half a field line so that the picture doesn't bounce.
+ */
+static void meson_crtc_vd1_field(struct meson_drm *priv)
+{
+	struct meson_vd1_scaler *sc = &priv->viu.vd1_scaler;
+	bool bot = priv->viu.vd1_field_bot;
+	u32 luma_y0 = bot ? sc->vd1_if0_luma_y0_bot : sc->vd1_if0_luma_y0;
+	u32 chroma_y0 = bot ? sc->vd1_if0_chroma_y0_bot :
+			      sc->vd1_if0_chroma_y0;
+
+	writel_relaxed(luma_y0, priv->io_base + _REG(VD1_IF0_LUMA_Y0));
+	writel_relaxed(luma_y0, priv->io_base + _REG(VD1_IF0_LUMA_Y1));
+	writel_relaxed(chroma_y0, priv->io_base + _REG(VD1_IF0_CHROMA_Y0));
+	writel_relaxed(chroma_y0, priv->io_base + _REG(VD1_IF0_CHROMA_Y1));
+	writel_relaxed(bot ? sc->vpp_vsc_ini_phase_bot : sc->vpp_vsc_ini_phase,
+		       priv->io_base + _REG(VPP_VSC_INI_PHASE));
+	writel_relaxed(bot ? sc->vpp_vsc_phase_ctrl_bot :
+			     sc->vpp_vsc_phase_ctrl,
+		       priv->io_base + _REG(VPP_VSC_PHASE_CTRL));
+}
+
+static void meson_crtc_vd1_canvas(struct meson_drm *priv)
+{
+	struct meson_canvas_entry entries[3] = {
+		{
+			.index = priv->canvas_id_vd1_0,
+			.addr = priv->viu.vd1_addr0,
+			.stride = priv->viu.vd1_stride0,
+			.height = priv->viu.vd1_height0,
+		}, {
+			.index = priv->canvas_id_vd1_1,
+			.addr = priv->viu.vd1_addr1,
+			.stride = priv->viu.vd1_stride1,
+			.height = priv->viu.vd1_height1,
+		}, {
+			.index = priv->canvas_id_vd1_2,
+			.addr = priv->viu.vd1_addr2,
+			.stride = priv->viu.vd1_stride2,
+			.height = priv->viu.vd1_height2,
+		},
+	};
+	unsigned int num = min_t(unsigned int, priv->viu.vd1_planes, 3);
+	unsigned int i;
+
+	for (i = 0; i < num; ++i) {
+		entries[i].wrap = MESON_CANVAS_WRAP_NONE;
+		entries[i].blkmode = MESON_CANVAS_BLKMODE_LINEAR;
+		entries[i].endian = MESON_CANVAS_ENDIAN_SWAP64;
+	}
+
+	/* All the planes are flushed at once */
+	if (priv->canvas) {
+		meson_canvas_config_batch(priv->canvas, entries, num);
+		return;
+	}
+
+	for (i = 0; i < num; ++i)
+		meson_canvas_setup(priv, entries[i].index, entries[i].addr,
+				   entries[i].stride, entries[i].height,
+				   entries[i].wrap, entries[i].blkmode,
+				   entries[i].endian);
+}
+
+/*
+ * Decoded frames from the tunnel replace the buffer of the last VD1 commit,
+ * which is expected to be NV12 of the same size: only the canvases change,
+ * the geometry and the scaler stay. The committed buffer is shown again
+ * once the tunnel is unbound.
+ */
+static void meson_crtc_vd1_tunnel(struct meson_drm *priv, bool committed)
+{
+	struct meson_tunnel_frame *frame;
+	struct meson_canvas_entry entries[2];
+	bool changed;
+	unsigned int i;
+
+	frame = meson_tunnel_vsync(ktime_get_ns(), &changed);
+	if (!priv->viu.vd1_enabled || priv->viu.vd1_afbc ||
+	    priv->viu.vd1_planes != 2)
+		return;
+
+	if (!frame) {
+		if (changed)
+			meson_crtc_vd1_canvas(priv);
+		return;
+	}
+
+	/* Still on screen, unless a commit just put its own buffer back */
+	if (!changed && !committed)
+		return;
+
+	for (i = 0; i < 2; ++i) {
+		entries[i].index = i ? priv->canvas_id_vd1_1 :
+				       priv->canvas_id_vd1_0;
+		entries[i].addr = frame->addr[i];
+		entries[i].stride = frame->stride;
+		entries[i].height = i ? frame->height / 2 : frame->height;
+		entries[i].wrap = MESON_CANVAS_WRAP_NONE;
+		entries[i].blkmode = MESON_CANVAS_BLKMODE_LINEAR;
+		entries[i].endian = MESON_CANVAS_ENDIAN_SWAP64;
+	}
+
+	if (priv->canvas) {
+		meson_canvas_config_batch(priv->canvas, entries, 2);
+		return;
+	}
+
+	for (i = 0; i < 2; ++i)
+		meson_canvas_setup(priv, entries[i].index, entries[i].addr,
+				   entries[i].stride, entries[i].height,
+				   entries[i].wrap, entries[i].blkmode,
+				   entries[i].endian);
+}
+
 void meson_crtc_irq(struct meson_drm *priv)
 {
 	struct meson_crtc *meson_crtc = to_meson_crtc(priv->crtc);
+	bool vd1_committed = priv->viu.vd1_enabled && priv->viu.vd1_commit;
 	unsigned long flags;
 
+	/* Update the OSD1 EOTF/OETF tables */
+	if (priv->viu.color_commit)
+		meson_viu_commit_color_mgmt(priv);
+
 	/* Update the OSD registers */
 	if (priv->viu.osd1_enabled && priv->viu.osd1_commit) {
 
@@ -234,85 +517,96 @@ void meson_crtc_irq(struct meson_drm *priv)
 		writel_relaxed(priv->viu.osd_sc_v_ctrl0,
 				priv->io_base + _REG(VPP_OSD_VSC_CTRL0));
 
+		if (priv->viu.osd1_afbcd) {
+			meson_viu_osd1_afbcd_setup(priv);
+		} else {
+			meson_viu_osd1_afbcd_disable(priv);
+			meson_crtc_osd1_canvas(priv);
+		}
+
+		/* Enable OSD1 */
+		writel_bits_relaxed(VPP_OSD1_POSTBLEND, VPP_OSD1_POSTBLEND,
+				    priv->io_base + _REG(VPP_MISC));
+
+		priv->viu.osd1_commit = false;
+	}
+
+	/* Update the OSD2 registers, no scaler */
+	if (priv->viu.osd2_enabled && priv->viu.osd2_commit) {
+		writel_relaxed(priv->viu.osd2_ctrl_stat,
+				priv->io_base + _REG(VIU_OSD2_CTRL_STAT));
+		writel_relaxed(priv->viu.osd2_blk0_cfg[0],
+				priv->io_base + _REG(VIU_OSD2_BLK0_CFG_W0));
+		writel_relaxed(priv->viu.osd2_blk0_cfg[1],
+				priv->io_base + _REG(VIU_OSD2_BLK0_CFG_W1));
+		writel_relaxed(priv->viu.osd2_blk0_cfg[2],
+				priv->io_base + _REG(VIU_OSD2_BLK0_CFG_W2));
+		writel_relaxed(priv->viu.osd2_blk0_cfg[3],
+				priv->io_base + _REG(VIU_OSD2_BLK0_CFG_W3));
+		writel_relaxed(priv->viu.osd2_blk0_cfg[4],
+				priv->io_base + _REG(VIU_OSD2_BLK0_CFG_W4));
+
 		if (priv->canvas)
-			meson_canvas_config(priv->canvas, priv->canvas_id_osd1,
-				priv->viu.osd1_addr, priv->viu.osd1_stride,
-				priv->viu.osd1_height, MESON_CANVAS_WRAP_NONE,
+			meson_canvas_config(priv->canvas, priv->canvas_id_osd2,
+				priv->viu.osd2_addr, priv->viu.osd2_stride,
+				priv->viu.osd2_height, MESON_CANVAS_WRAP_NONE,
 				MESON_CANVAS_BLKMODE_LINEAR, 0);
 		else
-			meson_canvas_setup(priv, MESON_CANVAS_ID_OSD1,
-				priv->viu.osd1_addr, priv->viu.osd1_stride,
-				priv->viu.osd1_height, MESON_CANVAS_WRAP_NONE,
+			meson_canvas_setup(priv, MESON_CANVAS_ID_OSD2,
+				priv->viu.osd2_addr, priv->viu.osd2_stride,
+				priv->viu.osd2_height, MESON_CANVAS_WRAP_NONE,
 				MESON_CANVAS_BLKMODE_LINEAR, 0);
 
-		/* Enable OSD1 */
-		writel_bits_relaxed(VPP_OSD1_POSTBLEND, VPP_OSD1_POSTBLEND,
+		/* Enable OSD2, above OSD1 */
+		writel_bits_relaxed(VPP_OSD2_POSTBLEND | VPP_POST_FG_OSD2,
+				    VPP_OSD2_POSTBLEND | VPP_POST_FG_OSD2,
 				    priv->io_base + _REG(VPP_MISC));
 
-		priv->viu.osd1_commit = false;
+		priv->viu.osd2_commit = false;
 	}
 
 	/* Update the VD1 registers */
 	if (priv->viu.vd1_enabled && priv->viu.vd1_commit) {
-
-		switch (priv->viu.vd1_planes) {
-		case 3:
-			if (priv->canvas)
-				meson_canvas_config(priv->canvas,
-						    priv->canvas_id_vd1_2,
-						    priv->viu.vd1_addr2,
-						    priv->viu.vd1_stride2,
-						    priv->viu.vd1_height2,
-						    MESON_CANVAS_WRAP_NONE,
-						    MESON_CANVAS_BLKMODE_LINEAR,
-						    MESON_CANVAS_ENDIAN_SWAP64);
-			else
-				meson_canvas_setup(priv, MESON_CANVAS_ID_VD1_2,
-						   priv->viu.vd1_addr2,
-						   priv->viu.vd1_stride2,
-						   priv->viu.vd1_height2,
-						   MESON_CANVAS_WRAP_NONE,
-						   MESON_CANVAS_BLKMODE_LINEAR,
-						   MESON_CANVAS_ENDIAN_SWAP64);
-		/* fallthrough */
-		case 2:
-			if (priv->canvas)
-				meson_canvas_config(priv->canvas,
-						    priv->canvas_id_vd1_1,
-						    priv->viu.vd1_addr1,
-						    priv->viu.vd1_stride1,
-						    priv->viu.vd1_height1,
-						    MESON_CANVAS_WRAP_NONE,
-						    MESON_CANVAS_BLKMODE_LINEAR,
-						    MESON_CANVAS_ENDIAN_SWAP64);
-			else
-				meson_canvas_setup(priv, MESON_CANVAS_ID_VD1_1,
-						   priv->viu.vd1_addr2,
-						   priv->viu.vd1_stride2,
-						   priv->viu.vd1_height2,
-						   MESON_CANVAS_WRAP_NONE,
-						   MESON_CANVAS_BLKMODE_LINEAR,
-						   MESON_CANVAS_ENDIAN_SWAP64);
-		/* fallthrough */
-		case 1:
-			if (priv->canvas)
-				meson_canvas_config(priv->canvas,
-						    priv->canvas_id_vd1_0,
-						    priv->viu.vd1_addr0,
-						    priv->viu.vd1_stride0,
-						    priv->viu.vd1_height0,
-						    MESON_CANVAS_WRAP_NONE,
-						    MESON_CANVAS_BLKMODE_LINEAR,
-						    MESON_CANVAS_ENDIAN_SWAP64);
-			else
-				meson_canvas_setup(priv, MESON_CANVAS_ID_VD1_0,
-						   priv->viu.vd1_addr2,
-						   priv->viu.vd1_stride2,
-						   priv->viu.vd1_height2,
-						   MESON_CANVAS_WRAP_NONE,
-						   MESON_CANVAS_BLKMODE_LINEAR,
-						   MESON_CANVAS_ENDIAN_SWAP64);
-		};
+		struct meson_vd1_scaler *sc = &priv->viu.vd1_scaler;
+
+		if (priv->viu.vd1_afbc) {
+			writel_relaxed(priv->viu.vd1_afbc_head_addr,
+				priv->io_base + _REG(AFBC_HEAD_BADDR));
+			writel_relaxed(priv->viu.vd1_afbc_body_addr,
+				priv->io_base + _REG(AFBC_BODY_BADDR));
+			writel_relaxed(priv->viu.vd1_afbc_en,
+				priv->io_base + _REG(AFBC_ENABLE));
+			writel_relaxed(priv->viu.vd1_afbc_mode,
+				priv->io_base + _REG(AFBC_MODE));
+			writel_relaxed(sc->vd1_afbc_size_in,
+				priv->io_base + _REG(AFBC_SIZE_IN));
+			writel_relaxed(priv->viu.vd1_afbc_dec_def_color,
+				priv->io_base + _REG(AFBC_DEC_DEF_COLOR));
+			writel_relaxed(priv->viu.vd1_afbc_conv_ctrl,
+				priv->io_base + _REG(AFBC_CONV_CTRL));
+			writel_relaxed(sc->vd1_afbc_size_out,
+				priv->io_base + _REG(AFBC_SIZE_OUT));
+			writel_relaxed(priv->viu.vd1_afbc_vd_cfmt_ctrl,
+				priv->io_base + _REG(AFBC_VD_CFMT_CTRL));
+			writel_relaxed(sc->vd1_afbc_vd_cfmt_w,
+				priv->io_base + _REG(AFBC_VD_CFMT_W));
+			writel_relaxed(sc->vd1_afbc_vd_cfmt_h,
+				priv->io_base + _REG(AFBC_VD_CFMT_H));
+			writel_relaxed(sc->vd1_afbc_mif_hor_scope,
+				priv->io_base + _REG(AFBC_MIF_HOR_SCOPE));
+			writel_relaxed(sc->vd1_afbc_mif_ver_scope,
+				priv->io_base + _REG(AFBC_MIF_VER_SCOPE));
+			writel_relaxed(sc->vd1_afbc_pixel_hor_scope,
+				priv->io_base + _REG(AFBC_PIXEL_HOR_SCOPE));
+			writel_relaxed(sc->vd1_afbc_pixel_ver_scope,
+				priv->io_base + _REG(AFBC_PIXEL_VER_SCOPE));
+		} else {
+			writel_relaxed(0, priv->io_base + _REG(AFBC_ENABLE));
+		}
+
+		/* The AFBC decoder fetches the frame itself, no canvas */
+		if (!priv->viu.vd1_afbc)
+			meson_crtc_vd1_canvas(priv);
 
 		writel_relaxed(priv->viu.vd1_if0_gen_reg,
 				priv->io_base + _REG(VD1_IF0_GEN_REG));
@@ -324,9 +618,9 @@ void meson_crtc_irq(struct meson_drm *priv)
 				priv->io_base + _REG(VIU_VD1_FMT_CTRL));
 		writel_relaxed(priv->viu.viu_vd1_fmt_ctrl,
 				priv->io_base + _REG(VIU_VD2_FMT_CTRL));
-		writel_relaxed(priv->viu.viu_vd1_fmt_w,
+		writel_relaxed(sc->viu_vd1_fmt_w,
 				priv->io_base + _REG(VIU_VD1_FMT_W));
-		writel_relaxed(priv->viu.viu_vd1_fmt_w,
+		writel_relaxed(sc->viu_vd1_fmt_w,
 				priv->io_base + _REG(VIU_VD2_FMT_W));
 		writel_relaxed(priv->viu.vd1_if0_canvas0,
 				priv->io_base + _REG(VD1_IF0_CANVAS0));
@@ -336,37 +630,37 @@ void meson_crtc_irq(struct meson_drm *priv)
 				priv->io_base + _REG(VD2_IF0_CANVAS0));
 		writel_relaxed(priv->viu.vd1_if0_canvas0,
 				priv->io_base + _REG(VD2_IF0_CANVAS1));
-		writel_relaxed(priv->viu.vd1_if0_luma_x0,
+		writel_relaxed(sc->vd1_if0_luma_x0,
 				priv->io_base + _REG(VD1_IF0_LUMA_X0));
-		writel_relaxed(priv->viu.vd1_if0_luma_x0,
+		writel_relaxed(sc->vd1_if0_luma_x0,
 				priv->io_base + _REG(VD1_IF0_LUMA_X1));
-		writel_relaxed(priv->viu.vd1_if0_luma_x0,
+		writel_relaxed(sc->vd1_if0_luma_x0,
 				priv->io_base + _REG(VD2_IF0_LUMA_X0));
-		writel_relaxed(priv->viu.vd1_if0_luma_x0,
+		writel_relaxed(sc->vd1_if0_luma_x0,
 				priv->io_base + _REG(VD2_IF0_LUMA_X1));
-		writel_relaxed(priv->viu.vd1_if0_luma_y0,
+		writel_relaxed(sc->vd1_if0_luma_y0,
 				priv->io_base + _REG(VD1_IF0_LUMA_Y0));
-		writel_relaxed(priv->viu.vd1_if0_luma_y0,
+		writel_relaxed(sc->vd1_if0_luma_y0,
 				priv->io_base + _REG(VD1_IF0_LUMA_Y1));
-		writel_relaxed(priv->viu.vd1_if0_luma_y0,
+		writel_relaxed(sc->vd1_if0_luma_y0,
 				priv->io_base + _REG(VD2_IF0_LUMA_Y0));
-		writel_relaxed(priv->viu.vd1_if0_luma_y0,
+		writel_relaxed(sc->vd1_if0_luma_y0,
 				priv->io_base + _REG(VD2_IF0_LUMA_Y1));
-		writel_relaxed(priv->viu.vd1_if0_chroma_x0,
+		writel_relaxed(sc->vd1_if0_chroma_x0,
 				priv->io_base + _REG(VD1_IF0_CHROMA_X0));
-		writel_relaxed(priv->viu.vd1_if0_chroma_x0,
+		writel_relaxed(sc->vd1_if0_chroma_x0,
 				priv->io_base + _REG(VD1_IF0_CHROMA_X1));
-		writel_relaxed(priv->viu.vd1_if0_chroma_x0,
+		writel_relaxed(sc->vd1_if0_chroma_x0,
 				priv->io_base + _REG(VD2_IF0_CHROMA_X0));
-		writel_relaxed(priv->viu.vd1_if0_chroma_x0,
+		writel_relaxed(sc->vd1_if0_chroma_x0,
 				priv->io_base + _REG(VD2_IF0_CHROMA_X1));
-		writel_relaxed(priv->viu.vd1_if0_chroma_y0,
+		writel_relaxed(sc->vd1_if0_chroma_y0,
 				priv->io_base + _REG(VD1_IF0_CHROMA_Y0));
-		writel_relaxed(priv->viu.vd1_if0_chroma_y0,
+		writel_relaxed(sc->vd1_if0_chroma_y0,
 				priv->io_base + _REG(VD1_IF0_CHROMA_Y1));
-		writel_relaxed(priv->viu.vd1_if0_chroma_y0,
+		writel_relaxed(sc->vd1_if0_chroma_y0,
 				priv->io_base + _REG(VD2_IF0_CHROMA_Y0));
-		writel_relaxed(priv->viu.vd1_if0_chroma_y0,
+		writel_relaxed(sc->vd1_if0_chroma_y0,
 				priv->io_base + _REG(VD2_IF0_CHROMA_Y1));
 		writel_relaxed(priv->viu.vd1_if0_repeat_loop,
 				priv->io_base + _REG(VD1_IF0_RPT_LOOP));
@@ -400,48 +694,57 @@ void meson_crtc_irq(struct meson_drm *priv)
 				priv->io_base + _REG(VD1_IF0_RANGE_MAP_CR));
 		writel_relaxed(0x78404,
 				priv->io_base + _REG(VPP_SC_MISC));
-		writel_relaxed(priv->viu.vpp_pic_in_height,
+		writel_relaxed(sc->vpp_pic_in_height,
 				priv->io_base + _REG(VPP_PIC_IN_HEIGHT));
-		writel_relaxed(priv->viu.vpp_postblend_vd1_h_start_end,
+		writel_relaxed(sc->vpp_postblend_vd1_h_start_end,
 			priv->io_base + _REG(VPP_POSTBLEND_VD1_H_START_END));
-		writel_relaxed(priv->viu.vpp_blend_vd2_h_start_end,
+		writel_relaxed(sc->vpp_blend_vd2_h_start_end,
 			priv->io_base + _REG(VPP_BLEND_VD2_H_START_END));
-		writel_relaxed(priv->viu.vpp_postblend_vd1_v_start_end,
+		writel_relaxed(sc->vpp_postblend_vd1_v_start_end,
 			priv->io_base + _REG(VPP_POSTBLEND_VD1_V_START_END));
-		writel_relaxed(priv->viu.vpp_blend_vd2_v_start_end,
+		writel_relaxed(sc->vpp_blend_vd2_v_start_end,
 			priv->io_base + _REG(VPP_BLEND_VD2_V_START_END));
-		writel_relaxed(priv->viu.vpp_hsc_region12_startp,
+		writel_relaxed(sc->vpp_hsc_region12_startp,
 				priv->io_base + _REG(VPP_HSC_REGION12_STARTP));
-		writel_relaxed(priv->viu.vpp_hsc_region34_startp,
+		writel_relaxed(sc->vpp_hsc_region34_startp,
 				priv->io_base + _REG(VPP_HSC_REGION34_STARTP));
-		writel_relaxed(priv->viu.vpp_hsc_region4_endp,
+		writel_relaxed(sc->vpp_hsc_region4_endp,
 				priv->io_base + _REG(VPP_HSC_REGION4_ENDP));
-		writel_relaxed(priv->viu.vpp_hsc_start_phase_step,
+		writel_relaxed(sc->vpp_hsc_start_phase_step,
 				priv->io_base + _REG(VPP_HSC_START_PHASE_STEP));
-		writel_relaxed(priv->viu.vpp_hsc_region1_phase_slope,
+		writel_relaxed(sc->vpp_hsc_region1_phase_slope,
 			priv->io_base + _REG(VPP_HSC_REGION1_PHASE_SLOPE));
-		writel_relaxed(priv->viu.vpp_hsc_region3_phase_slope,
+		writel_relaxed(sc->vpp_hsc_region3_phase_slope,
 			priv->io_base + _REG(VPP_HSC_REGION3_PHASE_SLOPE));
-		writel_relaxed(priv->viu.vpp_line_in_length,
+		writel_relaxed(sc->vpp_line_in_length,
 				priv->io_base + _REG(VPP_LINE_IN_LENGTH));
-		writel_relaxed(priv->viu.vpp_preblend_h_size,
+		writel_relaxed(sc->vpp_preblend_h_size,
 				priv->io_base + _REG(VPP_PREBLEND_H_SIZE));
-		writel_relaxed(priv->viu.vpp_vsc_region12_startp,
+		writel_relaxed(sc->vpp_vsc_region12_startp,
 				priv->io_base + _REG(VPP_VSC_REGION12_STARTP));
-		writel_relaxed(priv->viu.vpp_vsc_region34_startp,
+		writel_relaxed(sc->vpp_vsc_region34_startp,
 				priv->io_base + _REG(VPP_VSC_REGION34_STARTP));
-		writel_relaxed(priv->viu.vpp_vsc_region4_endp,
+		writel_relaxed(sc->vpp_vsc_region4_endp,
 				priv->io_base + _REG(VPP_VSC_REGION4_ENDP));
-		writel_relaxed(priv->viu.vpp_vsc_start_phase_step,
+		writel_relaxed(sc->vpp_vsc_start_phase_step,
 				priv->io_base + _REG(VPP_VSC_START_PHASE_STEP));
-		writel_relaxed(priv->viu.vpp_vsc_ini_phase,
+		writel_relaxed(sc->vpp_vsc_ini_phase,
 				priv->io_base + _REG(VPP_VSC_INI_PHASE));
-		writel_relaxed(priv->viu.vpp_vsc_phase_ctrl,
+		writel_relaxed(sc->vpp_vsc_phase_ctrl,
 				priv->io_base + _REG(VPP_VSC_PHASE_CTRL));
-		writel_relaxed(priv->viu.vpp_hsc_phase_ctrl,
+		writel_relaxed(sc->vpp_hsc_phase_ctrl,
 				priv->io_base + _REG(VPP_HSC_PHASE_CTRL));
+
+		/* Reload the coefficients only when the filter changes */
+		meson_vpp_set_vd_scaling_filter(priv, sc->hsc_filter,
+						sc->vsc_filter);
 		writel_relaxed(0x42, priv->io_base + _REG(VPP_SCALE_COEF_IDX));
 
+		/* Feed VD1 from the AFBC decoder instead of the VD1 MIF */
+		writel_bits_relaxed(VIU_CTRL0_AFBC_TO_VD1,
+				    priv->viu.vd1_afbc ? VIU_CTRL0_AFBC_TO_VD1 : 0,
+				    priv->io_base + _REG(VIU_MISC_CTRL0));
+
 		/* Enable VD1 */
 		writel_bits_relaxed(VPP_VD1_PREBLEND | VPP_VD1_POSTBLEND |
 				    VPP_COLOR_MNG_ENABLE,
@@ -449,9 +752,24 @@ void meson_crtc_irq(struct meson_drm *priv)
 				    VPP_COLOR_MNG_ENABLE,
 				    priv->io_base + _REG(VPP_MISC));
 
+		/* Start the new frame from its first field */
+		priv->viu.vd1_field_bot = priv->viu.vd1_deint_bff;
+		if (priv->viu.vd1_deint)
+			meson_crtc_vd1_field(priv);
+
 		priv->viu.vd1_commit = false;
+	} else if (priv->viu.vd1_enabled && priv->viu.vd1_deint) {
+		/* Show the other field of the frame, until a new one comes */
+		priv->viu.vd1_field_bot = !priv->viu.vd1_field_bot;
+		meson_crtc_vd1_field(priv);
 	}
 
+	if (priv->vd1_tunnel)
+		meson_crtc_vd1_tunnel(priv, vd1_committed);
+
+	/* Complete the previous capture and start the queued one */
+	meson_writeback_irq(priv);
+
 	drm_crtc_handle_vblank(priv->crtc);
 
 	spin_lock_irqsave(&priv->drm->event_lock, flags);
@@ -459,6 +777,11 @@ void meson_crtc_irq(struct meson_drm *priv)
 		drm_crtc_send_vblank_event(priv->crtc, meson_crtc->event);
 		drm_crtc_vblank_put(priv->crtc);
 		meson_crtc->event = NULL;
+
+		/* A frame was just flipped in, the next one is being rendered */
+		if (flip_boost_us)
+			schedutil_boost(SCHED_CPUFREQ_BOOST_DISPLAY,
+					flip_boost_us);
 	}
 	spin_unlock_irqrestore(&priv->drm->event_lock, flags);
 }
@@ -477,7 +800,8 @@ int meson_crtc_create(struct meson_drm *priv)
 	meson_crtc->priv = priv;
 	crtc = &meson_crtc->base;
 	ret = drm_crtc_init_with_planes(priv->drm, crtc,
-					priv->primary_plane, NULL,
+					priv->primary_plane,
+					priv->cursor_plane,
 					&meson_crtc_funcs, "meson_crtc");
 	if (ret) {
 		dev_err(priv->drm->dev, "Failed to init CRTC\n");
@@ -486,6 +810,14 @@ int meson_crtc_create(struct meson_drm *priv)
 
 	drm_crtc_helper_add(crtc, &meson_crtc_helper_funcs);
 
+	/* The OSD1 EOTF LUT, EOTF matrix and OETF LUT only exist on GXL/GXM */
+	if (meson_vpu_is_compatible(priv, "amlogic,meson-gxm-vpu") ||
+	    meson_vpu_is_compatible(priv, "amlogic,meson-gxl-vpu")) {
+		drm_mode_crtc_set_gamma_size(crtc, MESON_VIU_EOTF_LUT_SIZE);
+		drm_crtc_enable_color_mgmt(crtc, MESON_VIU_EOTF_LUT_SIZE, true,
+					   MESON_VIU_EOTF_LUT_SIZE);
+	}
+
 	priv->crtc = crtc;
 
 	return 0;
@@ -26,6 +26,7 @@
 #include <linux/platform_device.h>
 #include <linux/component.h>
 #include <linux/of_graph.h>
+#include <linux/soc/amlogic/meson-tunnel.h>
 
 #include <drm/drmP.h>
 #include <drm/drm_atomic.h>
@@ -42,6 +43,9 @@
 #include "meson_drv.h"
 #include "meson_plane.h"
 #include "meson_overlay.h"
+#include "meson_cursor.h"
+#include "meson_writeback.h"
+#include "meson_carveout.h"
 #include "meson_crtc.h"
 #include "meson_venc_cvbs.h"
 
@@ -75,6 +79,27 @@ static const struct drm_mode_config_funcs meson_mode_config_funcs = {
 	.fb_create           = drm_gem_fb_create,
 };
 
+/*
+ * Same as drm_atomic_helper_commit_tail(), but waits for the flip events
+ * instead of a full vblank: asynchronous flips then complete right away,
+ * and buffers are released as soon as they are off the screen.
+ */
+static void meson_atomic_commit_tail(struct drm_atomic_state *old_state)
+{
+	struct drm_device *dev = old_state->dev;
+
+	drm_atomic_helper_commit_modeset_disables(dev, old_state);
+	drm_atomic_helper_commit_planes(dev, old_state, 0);
+	drm_atomic_helper_commit_modeset_enables(dev, old_state);
+	drm_atomic_helper_commit_hw_done(old_state);
+	drm_atomic_helper_wait_for_flip_done(dev, old_state);
+	drm_atomic_helper_cleanup_planes(dev, old_state);
+}
+
+static const struct drm_mode_config_helper_funcs meson_mode_config_helpers = {
+	.atomic_commit_tail = meson_atomic_commit_tail,
+};
+
 static irqreturn_t meson_irq(int irq, void *arg)
 {
 	struct drm_device *dev = arg;
@@ -109,8 +134,8 @@ static struct drm_driver meson_driver = {
 	.gem_prime_mmap		= drm_gem_cma_prime_mmap,
 
 	/* GEM Ops */
-	.dumb_create		= drm_gem_cma_dumb_create,
-	.gem_free_object_unlocked = drm_gem_cma_free_object,
+	.dumb_create		= meson_gem_dumb_create,
+	.gem_free_object_unlocked = meson_gem_free_object,
 	.gem_vm_ops		= &drm_gem_cma_vm_ops,
 
 	/* Misc */
@@ -173,8 +198,8 @@ static int meson_drv_bind_master(struct device *dev, bool has_components)
 
 	priv = devm_kzalloc(dev, sizeof(*priv), GFP_KERNEL);
 	if (!priv) {
-		ret = -ENOMEM;
-		goto free_drm;
+		drm_dev_put(drm);
+		return -ENOMEM;
 	}
 	drm->dev_private = priv;
 	priv->drm = drm;
@@ -211,27 +236,21 @@ static int meson_drv_bind_master(struct device *dev, bool has_components)
 
 	priv->canvas = meson_canvas_get(dev);
 	if (!IS_ERR(priv->canvas)) {
-		ret = meson_canvas_alloc(priv->canvas, &priv->canvas_id_osd1);
+		/*
+		 * OSD1, VD1 planes 0 to 2, OSD2 and the writeback planes
+		 * 0 and 1, in this order
+		 */
+		ret = meson_canvas_alloc_range(priv->canvas,
+					       &priv->canvas_id_osd1,
+					       MESON_NUM_CANVAS);
 		if (ret)
 			goto free_drm;
-		ret = meson_canvas_alloc(priv->canvas, &priv->canvas_id_vd1_0);
-		if (ret) {
-			meson_canvas_free(priv->canvas, priv->canvas_id_osd1);
-			goto free_drm;
-		}
-		ret = meson_canvas_alloc(priv->canvas, &priv->canvas_id_vd1_1);
-		if (ret) {
-			meson_canvas_free(priv->canvas, priv->canvas_id_osd1);
-			meson_canvas_free(priv->canvas, priv->canvas_id_vd1_0);
-			goto free_drm;
-		}
-		ret = meson_canvas_alloc(priv->canvas, &priv->canvas_id_vd1_2);
-		if (ret) {
-			meson_canvas_free(priv->canvas, priv->canvas_id_osd1);
-			meson_canvas_free(priv->canvas, priv->canvas_id_vd1_0);
-			meson_canvas_free(priv->canvas, priv->canvas_id_vd1_1);
-			goto free_drm;
-		}
+		priv->canvas_id_vd1_0 = priv->canvas_id_osd1 + 1;
+		priv->canvas_id_vd1_1 = priv->canvas_id_osd1 + 2;
+		priv->canvas_id_vd1_2 = priv->canvas_id_osd1 + 3;
+		priv->canvas_id_osd2 = priv->canvas_id_osd1 + 4;
+		priv->canvas_id_wb_0 = priv->canvas_id_osd1 + 5;
+		priv->canvas_id_wb_1 = priv->canvas_id_osd1 + 6;
 	} else {
 		priv->canvas = NULL;
 
@@ -256,6 +275,10 @@ static int meson_drv_bind_master(struct device *dev, bool has_components)
 		}
 	}
 
+	ret = meson_carveout_create(priv);
+	if (ret)
+		goto free_drm;
+
 	priv->vsync_irq = platform_get_irq(pdev, 0);
 
 	ret = drm_vblank_init(drm, 1);
@@ -266,10 +289,14 @@ static int meson_drv_bind_master(struct device *dev, bool has_components)
 	drm->mode_config.max_width = 3840;
 	drm->mode_config.max_height = 2160;
 	drm->mode_config.funcs = &meson_mode_config_funcs;
+	drm->mode_config.helper_private = &meson_mode_config_helpers;
+	drm->mode_config.allow_fb_modifiers = true;
+	drm->mode_config.async_page_flip = true;
 
 	/* Hardware Initialization */
 
 	meson_vpu_init(priv);
+	meson_vclk_init(priv);
 	meson_venc_init(priv);
 	meson_vpp_init(priv);
 	meson_viu_init(priv);
@@ -296,14 +323,25 @@ static int meson_drv_bind_master(struct device *dev, bool has_components)
 	if (ret)
 		goto free_drm;
 
+	ret = meson_cursor_create(priv);
+	if (ret)
+		goto free_drm;
+
 	ret = meson_crtc_create(priv);
 	if (ret)
 		goto free_drm;
 
+	ret = meson_writeback_create(priv);
+	if (ret)
+		goto free_drm;
+
 	ret = drm_irq_install(drm, priv->vsync_irq);
 	if (ret)
 		goto free_drm;
 
+	/* Optional, only one display can take decoded frames directly */
+	priv->vd1_tunnel = !meson_tunnel_sink_register();
+
 	drm_mode_config_reset(drm);
 
 	drm_kms_helper_poll_init(drm);
@@ -319,7 +357,10 @@ static int meson_drv_bind_master(struct device *dev, bool has_components)
 	return 0;
 
 free_drm:
+	if (priv->vd1_tunnel)
+		meson_tunnel_sink_unregister();
 	drm_dev_put(drm);
+	meson_carveout_destroy(priv);
 
 	return ret;
 }
@@ -334,17 +375,18 @@ static void meson_drv_unbind(struct device *dev)
 	struct drm_device *drm = dev_get_drvdata(dev);
 	struct meson_drm *priv = drm->dev_private;
 
-	if (priv->canvas) {
-		meson_canvas_free(priv->canvas, priv->canvas_id_osd1);
-		meson_canvas_free(priv->canvas, priv->canvas_id_vd1_0);
-		meson_canvas_free(priv->canvas, priv->canvas_id_vd1_1);
-		meson_canvas_free(priv->canvas, priv->canvas_id_vd1_2);
-	}
+	if (priv->canvas)
+		meson_canvas_free_range(priv->canvas, priv->canvas_id_osd1,
+					MESON_NUM_CANVAS);
+
+	if (priv->vd1_tunnel)
+		meson_tunnel_sink_unregister();
 
 	drm_dev_unregister(drm);
 	drm_kms_helper_poll_fini(drm);
 	drm_mode_config_cleanup(drm);
 	drm_dev_put(drm);
+	meson_carveout_destroy(priv);
 
 }
 
@@ -406,6 +448,8 @@ static int meson_drv_probe(struct platform_device *pdev)
 	struct device_node *ep, *remote;
 	int count = 0;
 
+	device_enable_async_suspend(&pdev->dev);
+
 	for_each_endpoint_of_node(np, ep) {
 		remote = of_graph_get_remote_port_parent(ep);
 		if (!remote || !of_device_is_available(remote))
@@ -443,6 +487,7 @@ static struct platform_driver meson_drm_platform_driver = {
 	.driver     = {
 		.name	= "meson-drm",
 		.of_match_table = dt_match,
+		.probe_type = PROBE_PREFER_ASYNCHRONOUS,
 	},
 };
 
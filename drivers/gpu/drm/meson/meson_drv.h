@@ -25,6 +25,62 @@
 #include <linux/soc/amlogic/meson-canvas.h>
 #include <drm/drmP.h>
 
+/*
+ * VD1 geometry and scaler registers, only depending on the plane and
+ * mode geometry. Computed at atomic_check time and cached in the
+ * overlay plane state.
+ */
+struct meson_vd1_scaler {
+	uint32_t vd1_if0_luma_x0;
+	uint32_t vd1_if0_luma_y0;
+	uint32_t vd1_if0_chroma_x0;
+	uint32_t vd1_if0_chroma_y0;
+	uint32_t viu_vd1_fmt_w;
+	uint32_t vpp_pic_in_height;
+	uint32_t vpp_postblend_vd1_h_start_end;
+	uint32_t vpp_postblend_vd1_v_start_end;
+	uint32_t vpp_hsc_region12_startp;
+	uint32_t vpp_hsc_region34_startp;
+	uint32_t vpp_hsc_region4_endp;
+	uint32_t vpp_hsc_start_phase_step;
+	uint32_t vpp_hsc_region1_phase_slope;
+	uint32_t vpp_hsc_region3_phase_slope;
+	uint32_t vpp_line_in_length;
+	uint32_t vpp_preblend_h_size;
+	uint32_t vpp_vsc_region12_startp;
+	uint32_t vpp_vsc_region34_startp;
+	uint32_t vpp_vsc_region4_endp;
+	uint32_t vpp_vsc_start_phase_step;
+	uint32_t vpp_vsc_ini_phase;
+	uint32_t vpp_vsc_phase_ctrl;
+	uint32_t vpp_hsc_phase_ctrl;
+	/* Bottom field values when deinterlacing, the above are the top's */
+	uint32_t vd1_if0_luma_y0_bot;
+	uint32_t vd1_if0_chroma_y0_bot;
+	uint32_t vpp_vsc_ini_phase_bot;
+	uint32_t vpp_vsc_phase_ctrl_bot;
+	uint32_t vpp_blend_vd2_h_start_end;
+	uint32_t vpp_blend_vd2_v_start_end;
+	uint32_t vd1_afbc_size_in;
+	uint32_t vd1_afbc_size_out;
+	uint32_t vd1_afbc_vd_cfmt_w;
+	uint32_t vd1_afbc_vd_cfmt_h;
+	uint32_t vd1_afbc_mif_hor_scope;
+	uint32_t vd1_afbc_mif_ver_scope;
+	uint32_t vd1_afbc_pixel_hor_scope;
+	uint32_t vd1_afbc_pixel_ver_scope;
+	unsigned int hsc_filter;
+	unsigned int vsc_filter;
+};
+
+#define MESON_VIU_EOTF_LUT_SIZE		33
+#define MESON_VIU_OETF_LUT_SIZE		41
+#define MESON_VIU_EOTF_COEFF_SIZE	10
+
+#define MESON_VCLK_PLL_CACHE_SIZE	16
+
+struct meson_carveout;
+
 struct meson_drm {
 	struct device *dev;
 	void __iomem *io_base;
@@ -34,25 +90,38 @@ struct meson_drm {
 
 	struct meson_canvas *canvas;
 	u8 canvas_id_osd1;
+	u8 canvas_id_osd2;
 	u8 canvas_id_vd1_0;
 	u8 canvas_id_vd1_1;
 	u8 canvas_id_vd1_2;
+	u8 canvas_id_wb_0;
+	u8 canvas_id_wb_1;
+
+	struct meson_carveout *carveout;
 
 	struct drm_device *drm;
 	struct drm_crtc *crtc;
 	struct drm_plane *primary_plane;
 	struct drm_plane *overlay_plane;
+	struct drm_plane *cursor_plane;
+	struct drm_writeback_connector *writeback;
+
+	/* Registered as the sink of the decoder tunnel */
+	bool vd1_tunnel;
 
 	/* Components Data */
 	struct {
 		bool osd1_enabled;
 		bool osd1_interlace;
 		bool osd1_commit;
+		bool osd1_afbcd;
 		uint32_t osd1_ctrl_stat;
 		uint32_t osd1_blk0_cfg[5];
 		uint32_t osd1_addr;
 		uint32_t osd1_stride;
 		uint32_t osd1_height;
+		uint32_t osd1_width;
+		uint64_t osd1_afbcd_modifier;
 		uint32_t osd_sc_ctrl0;
 		uint32_t osd_sc_i_wh_m1;
 		uint32_t osd_sc_o_h_start_end;
@@ -64,21 +133,28 @@ struct meson_drm {
 		uint32_t osd_sc_h_ctrl0;
 		uint32_t osd_sc_v_ctrl0;
 
+		bool osd2_enabled;
+		bool osd2_commit;
+		uint32_t osd2_ctrl_stat;
+		uint32_t osd2_blk0_cfg[5];
+		uint32_t osd2_addr;
+		uint32_t osd2_stride;
+		uint32_t osd2_height;
+
 		bool vd1_enabled;
 		bool vd1_commit;
+		bool vd1_afbc;
+		bool vd1_deint;
+		bool vd1_deint_bff;
+		bool vd1_field_bot;
 		unsigned int vd1_planes;
 		uint32_t vd1_if0_gen_reg;
-		uint32_t vd1_if0_luma_x0;
-		uint32_t vd1_if0_luma_y0;
-		uint32_t vd1_if0_chroma_x0;
-		uint32_t vd1_if0_chroma_y0;
 		uint32_t vd1_if0_repeat_loop;
 		uint32_t vd1_if0_luma0_rpt_pat;
 		uint32_t vd1_if0_chroma0_rpt_pat;
 		uint32_t vd1_range_map_y;
 		uint32_t vd1_range_map_cb;
 		uint32_t vd1_range_map_cr;
-		uint32_t viu_vd1_fmt_w;
 		uint32_t vd1_if0_canvas0;
 		uint32_t vd1_if0_gen_reg2;
 		uint32_t viu_vd1_fmt_ctrl;
@@ -91,28 +167,68 @@ struct meson_drm {
 		uint32_t vd1_height0;
 		uint32_t vd1_height1;
 		uint32_t vd1_height2;
-		uint32_t vpp_pic_in_height;
-		uint32_t vpp_postblend_vd1_h_start_end;
-		uint32_t vpp_postblend_vd1_v_start_end;
-		uint32_t vpp_hsc_region12_startp;
-		uint32_t vpp_hsc_region34_startp;
-		uint32_t vpp_hsc_region4_endp;
-		uint32_t vpp_hsc_start_phase_step;
-		uint32_t vpp_hsc_region1_phase_slope;
-		uint32_t vpp_hsc_region3_phase_slope;
-		uint32_t vpp_line_in_length;
-		uint32_t vpp_preblend_h_size;
-		uint32_t vpp_vsc_region12_startp;
-		uint32_t vpp_vsc_region34_startp;
-		uint32_t vpp_vsc_region4_endp;
-		uint32_t vpp_vsc_start_phase_step;
-		uint32_t vpp_vsc_ini_phase;
-		uint32_t vpp_vsc_phase_ctrl;
-		uint32_t vpp_hsc_phase_ctrl;
-		uint32_t vpp_blend_vd2_h_start_end;
-		uint32_t vpp_blend_vd2_v_start_end;
+		struct meson_vd1_scaler vd1_scaler;
+		uint32_t vd1_afbc_en;
+		uint32_t vd1_afbc_mode;
+		uint32_t vd1_afbc_dec_def_color;
+		uint32_t vd1_afbc_conv_ctrl;
+		uint32_t vd1_afbc_head_addr;
+		uint32_t vd1_afbc_body_addr;
+		uint32_t vd1_afbc_vd_cfmt_ctrl;
+
+		bool color_commit;
+		bool eotf_lut_en;
+		bool eotf_matrix_en;
+		bool oetf_lut_en;
+		unsigned int eotf_lut[3][MESON_VIU_EOTF_LUT_SIZE];
+		int eotf_matrix[MESON_VIU_EOTF_COEFF_SIZE];
+		unsigned int oetf_lut[3][MESON_VIU_OETF_LUT_SIZE];
 	} viu;
 
+	struct {
+		bool commit;
+		bool active;
+		bool rgb;
+		uint32_t width;
+		uint32_t height;
+		uint32_t addr0;
+		uint32_t addr1;
+		uint32_t stride0;
+		uint32_t stride1;
+	} wb;
+
+	struct {
+		unsigned int vd_hsc_filter;
+		unsigned int vd_vsc_filter;
+	} vpp;
+
+	struct {
+		spinlock_t lock;
+		/* HDMI PLL parameters search results, per DMT frequency */
+		struct {
+			unsigned int freq;
+			unsigned int m;
+			unsigned int frac;
+			unsigned int od;
+			bool found;
+		} pll_cache[MESON_VCLK_PLL_CACHE_SIZE];
+		unsigned int pll_cache_next;
+
+		/* Currently programmed HDMI clock tree */
+		bool valid;
+		unsigned int pll_base_freq;
+		unsigned int m;
+		unsigned int frac;
+		unsigned int od1;
+		unsigned int od2;
+		unsigned int od3;
+		unsigned int vid_pll_div;
+		unsigned int vclk_div;
+		unsigned int hdmi_tx_div;
+		unsigned int venc_div;
+		bool hdmi_use_enci;
+	} vclk;
+
 	struct {
 		unsigned int current_mode;
 		bool hdmi_repeat;
@@ -24,6 +24,7 @@
 #include <linux/reset.h>
 #include <linux/clk.h>
 #include <linux/regulator/consumer.h>
+#include <linux/workqueue.h>
 
 #include <drm/drmP.h>
 #include <drm/drm_edid.h>
@@ -87,7 +88,7 @@
  *
  * We handle the following features :
  *
- * - HPD Rise & Fall interrupt
+ * - HPD Rise & Fall interrupt, debounced
  * - HDMI Controller Interrupt
  * - HDMI PHY Init for 480i to 1080p60
  * - VENC & HDMI Clock setup for 480i to 1080p60
@@ -140,7 +141,9 @@ struct meson_dw_hdmi {
 	struct clk *venci_clk;
 	struct regulator *hdmi_supply;
 	u32 irq_stat;
+	struct delayed_work hpd_work;
 	struct dw_hdmi *hdmi;
+	struct device_link *link;
 	unsigned long input_bus_format;
 	unsigned long output_bus_format;
 };
@@ -547,24 +550,36 @@ static irqreturn_t dw_hdmi_top_irq(int irq, void *dev_id)
 	return IRQ_HANDLED;
 }
 
+/*
+ * Some sinks, AV receivers in particular, toggle HPD several times when
+ * powering up. Only act on the HPD level once it stayed stable for this
+ * long, so a burst results in a single probe and EDID read.
+ */
+#define HPD_DEBOUNCE_MS		300
+
+static void dw_hdmi_hpd_work(struct work_struct *work)
+{
+	struct meson_dw_hdmi *dw_hdmi = container_of(to_delayed_work(work),
+						     struct meson_dw_hdmi,
+						     hpd_work);
+	bool hpd_connected = !!dw_hdmi_top_read(dw_hdmi, HDMITX_TOP_STAT0);
+
+	dw_hdmi_setup_rx_sense(dw_hdmi->hdmi, hpd_connected, hpd_connected);
+
+	/* Probes the connector, the EDID is read and cached from here */
+	drm_helper_hpd_irq_event(dw_hdmi->encoder.dev);
+}
+
 /* Threaded interrupt handler to manage HPD events */
 static irqreturn_t dw_hdmi_top_thread_irq(int irq, void *dev_id)
 {
 	struct meson_dw_hdmi *dw_hdmi = dev_id;
 	u32 stat = dw_hdmi->irq_stat;
 
-	/* HPD Events */
-	if (stat & (HDMITX_TOP_INTR_HPD_RISE | HDMITX_TOP_INTR_HPD_FALL)) {
-		bool hpd_connected = false;
-
-		if (stat & HDMITX_TOP_INTR_HPD_RISE)
-			hpd_connected = true;
-
-		dw_hdmi_setup_rx_sense(dw_hdmi->hdmi, hpd_connected,
-				       hpd_connected);
-
-		drm_helper_hpd_irq_event(dw_hdmi->encoder.dev);
-	}
+	/* HPD Events, restart the debounce period at each edge */
+	if (stat & (HDMITX_TOP_INTR_HPD_RISE | HDMITX_TOP_INTR_HPD_FALL))
+		mod_delayed_work(system_wq, &dw_hdmi->hpd_work,
+				 msecs_to_jiffies(HPD_DEBOUNCE_MS));
 
 	return IRQ_HANDLED;
 }
@@ -903,6 +918,8 @@ static int meson_dw_hdmi_bind(struct device *dev, struct device *master,
 		return irq;
 	}
 
+	INIT_DELAYED_WORK(&meson_dw_hdmi->hpd_work, dw_hdmi_hpd_work);
+
 	ret = devm_request_threaded_irq(dev, irq, dw_hdmi_top_irq,
 					dw_hdmi_top_thread_irq, IRQF_SHARED,
 					"dw_hdmi_top_irq", meson_dw_hdmi);
@@ -976,6 +993,9 @@ static int meson_dw_hdmi_bind(struct device *dev, struct device *master,
 	if (IS_ERR(meson_dw_hdmi->hdmi))
 		return PTR_ERR(meson_dw_hdmi->hdmi);
 
+	/* The VPU restores its outputs on resume, the encoder must be up */
+	meson_dw_hdmi->link = device_link_add(master, dev, DL_FLAG_STATELESS);
+
 	DRM_DEBUG_DRIVER("HDMI controller initialized\n");
 
 	return 0;
@@ -986,6 +1006,13 @@ static void meson_dw_hdmi_unbind(struct device *dev, struct device *master,
 {
 	struct meson_dw_hdmi *meson_dw_hdmi = dev_get_drvdata(dev);
 
+	/* Mask the HPD interrupts before flushing the pending event */
+	dw_hdmi_top_write_bits(meson_dw_hdmi, HDMITX_TOP_INTR_MASKN,
+			HDMITX_TOP_INTR_HPD_RISE | HDMITX_TOP_INTR_HPD_FALL, 0);
+	cancel_delayed_work_sync(&meson_dw_hdmi->hpd_work);
+
+	if (meson_dw_hdmi->link)
+		device_link_del(meson_dw_hdmi->link);
 	dw_hdmi_unbind(meson_dw_hdmi->hdmi);
 }
 
@@ -996,6 +1023,8 @@ static const struct component_ops meson_dw_hdmi_ops = {
 
 static int meson_dw_hdmi_probe(struct platform_device *pdev)
 {
+	device_enable_async_suspend(&pdev->dev);
+
 	return component_add(&pdev->dev, &meson_dw_hdmi_ops);
 }
 
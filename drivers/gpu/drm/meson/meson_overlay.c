@@ -80,31 +80,110 @@
 #define VD_REGION24_START(value)	FIELD_PREP(GENMASK(11, 0), value)
 #define VD_REGION13_END(value)		FIELD_PREP(GENMASK(27, 16), value)
 
+/* AFBC_ENABLE */
+#define AFBC_DEC_ENABLE			BIT(8)
+
+/* AFBC_MODE */
+#define AFBC_COMPBITS_YUV(val)		FIELD_PREP(GENMASK(13, 8), val)
+#define AFBC_COMPBITS_8BIT		0
+#define AFBC_COMPBITS_10BIT		(2 | (2 << 2) | (2 << 4))
+#define AFBC_BURST_LEN(val)		FIELD_PREP(GENMASK(15, 14), val)
+#define AFBC_HOLD_LINE_NUM(val)		FIELD_PREP(GENMASK(22, 16), val)
+#define AFBC_MIF_URGENT(val)		FIELD_PREP(GENMASK(25, 24), val)
+
+/* AFBC_SIZE_IN AFBC_SIZE_OUT */
+#define AFBC_HSIZE(val)			FIELD_PREP(GENMASK(28, 16), val)
+#define AFBC_VSIZE(val)			FIELD_PREP(GENMASK(12, 0), val)
+
+/* AFBC_DEC_DEF_COLOR */
+#define AFBC_DEF_COLOR_Y(val)		FIELD_PREP(GENMASK(29, 20), val)
+#define AFBC_DEF_COLOR_U(val)		FIELD_PREP(GENMASK(19, 10), val)
+#define AFBC_DEF_COLOR_V(val)		FIELD_PREP(GENMASK(9, 0), val)
+
+/* AFBC_CONV_CTRL */
+#define AFBC_CONV_LBUF_LEN(val)		FIELD_PREP(GENMASK(11, 0), val)
+
+/* AFBC_VD_CFMT_CTRL */
+#define AFBC_HORZ_RPT_PIXEL0		BIT(23)
+#define AFBC_HORZ_Y_C_RATIO(val)	FIELD_PREP(GENMASK(22, 21), val)
+#define AFBC_HORZ_FMT_EN		BIT(20)
+#define AFBC_VERT_RPT_LINE0		BIT(16)
+#define AFBC_VERT_INITIAL_PHASE(val)	FIELD_PREP(GENMASK(11, 8), val)
+#define AFBC_VERT_PHASE_STEP(val)	FIELD_PREP(GENMASK(7, 1), val)
+#define AFBC_VERT_FMT_EN		BIT(0)
+
+/* AFBC_VD_CFMT_W */
+#define AFBC_VD_V_WIDTH(val)		FIELD_PREP(GENMASK(11, 0), val)
+#define AFBC_VD_H_WIDTH(val)		FIELD_PREP(GENMASK(27, 16), val)
+
+/* AFBC_VD_CFMT_H */
+#define AFBC_VD_HEIGHT(val)		FIELD_PREP(GENMASK(12, 0), val)
+
+/* AFBC_MIF_HOR_SCOPE */
+#define AFBC_MIF_BLK_BGN_H(val)		FIELD_PREP(GENMASK(25, 16), val)
+#define AFBC_MIF_BLK_END_H(val)		FIELD_PREP(GENMASK(9, 0), val)
+
+/* AFBC_MIF_VER_SCOPE */
+#define AFBC_MIF_BLK_BGN_V(val)		FIELD_PREP(GENMASK(27, 16), val)
+#define AFBC_MIF_BLK_END_V(val)		FIELD_PREP(GENMASK(11, 0), val)
+
+/* AFBC_PIXEL_HOR_SCOPE AFBC_PIXEL_VER_SCOPE */
+#define AFBC_DEC_PIXEL_BGN(val)		FIELD_PREP(GENMASK(28, 16), val)
+#define AFBC_DEC_PIXEL_END(val)		FIELD_PREP(GENMASK(12, 0), val)
+
+/* Basic layout: 4KiB per 64x32 body superblock, the header follows */
+#define AFBC_BODY_BLOCK_SIZE		4096
+
+#define DRM_FORMAT_MOD_MESON_FBC \
+	DRM_FORMAT_MOD_AMLOGIC_FBC(AMLOGIC_FBC_LAYOUT_BASIC, 0)
+
+/* Values of the "deinterlace" plane property */
+enum {
+	MESON_DEINTERLACE_OFF,
+	MESON_DEINTERLACE_BOB_TFF,
+	MESON_DEINTERLACE_BOB_BFF,
+};
+
+static const struct drm_prop_enum_list meson_deinterlace_names[] = {
+	{ MESON_DEINTERLACE_OFF, "Off" },
+	{ MESON_DEINTERLACE_BOB_TFF, "Bob, top field first" },
+	{ MESON_DEINTERLACE_BOB_BFF, "Bob, bottom field first" },
+};
+
 struct meson_overlay {
 	struct drm_plane base;
 	struct meson_drm *priv;
+	struct drm_property *deinterlace_prop;
 };
 #define to_meson_overlay(x) container_of(x, struct meson_overlay, base)
 
-#define FRAC_16_16(mult, div)    (((mult) << 16) / (div))
+/* Everything the scaler registers are computed from */
+struct meson_overlay_scaler_key {
+	uint32_t src_x, src_y, src_w, src_h;
+	int32_t crtc_x, crtc_y;
+	uint32_t crtc_w, crtc_h;
+	uint16_t hdisplay, vdisplay;
+	uint32_t format;
+	uint64_t modifier;
+	bool interlace;
+	bool deint;
+};
 
-static int meson_overlay_atomic_check(struct drm_plane *plane,
-				      struct drm_plane_state *state)
-{
-	struct drm_crtc_state *crtc_state;
+struct meson_overlay_state {
+	struct drm_plane_state base;
 
-	if (!state->crtc)
-		return 0;
+	/* MESON_DEINTERLACE_*, for interlaced frames shown progressively */
+	unsigned int deinterlace;
 
-	crtc_state = drm_atomic_get_crtc_state(state->state, state->crtc);
-	if (IS_ERR(crtc_state))
-		return PTR_ERR(crtc_state);
+	/* Carried over by duplicate_state, recomputed when the key changes */
+	struct meson_overlay_scaler_key key;
+	struct meson_vd1_scaler scaler;
+	bool scaler_valid;
+};
+#define to_meson_overlay_state(x) \
+	container_of(x, struct meson_overlay_state, base)
 
-	return drm_atomic_helper_check_plane_state(state, crtc_state,
-						   FRAC_16_16(1, 5),
-						   FRAC_16_16(5, 1),
-						   true, true);
-}
+#define FRAC_16_16(mult, div)    (((mult) << 16) / (div))
 
 /* Takes a fixed 16.16 number and converts it to integer. */
 static inline int64_t fixed16_to_int(int64_t value)
@@ -144,13 +223,13 @@ static void meson_overlay_get_vertical_phase(unsigned int ratio_y, int *phase,
 	*repeat = skip_tab[repeat_skip];
 }
 
-static void meson_overlay_setup_scaler_params(struct meson_drm *priv,
-					      struct drm_plane *plane,
-					      bool interlace_mode)
+static void meson_overlay_setup_scaler_params(struct meson_vd1_scaler *sc,
+					      struct drm_plane_state *state,
+					      struct drm_crtc_state *crtc_state,
+					      bool interlace_mode, bool afbc,
+					      bool deint)
 {
-	struct drm_crtc_state *crtc_state = priv->crtc->state;
 	int video_top, video_left, video_width, video_height;
-	struct drm_plane_state *state = plane->state;
 	unsigned int vd_start_lines, vd_end_lines;
 	unsigned int hd_start_lines, hd_end_lines;
 	unsigned int crtc_height, crtc_width;
@@ -163,11 +242,6 @@ static void meson_overlay_setup_scaler_params(struct meson_drm *priv,
 	unsigned int w_in, h_in;
 	int temp, start, end;
 
-	if (!crtc_state) {
-		DRM_ERROR("Invalid crtc_state\n");
-		return;
-	}
-
 	crtc_height = crtc_state->mode.vdisplay;
 	crtc_width = crtc_state->mode.hdisplay;
 
@@ -176,6 +250,10 @@ static void meson_overlay_setup_scaler_params(struct meson_drm *priv,
 	crop_top = fixed16_to_int(state->src_x);
 	crop_left = fixed16_to_int(state->src_x);
 
+	/* Each field is scaled to the full height, see meson_crtc_vd1_field() */
+	if (deint)
+		h_in /= 2;
+
 	video_top = state->crtc_y;
 	video_left = state->crtc_x;
 	video_width = state->crtc_w;
@@ -196,6 +274,9 @@ static void meson_overlay_setup_scaler_params(struct meson_drm *priv,
 
 	DRM_DEBUG("ratio x 0x%x y 0x%x\n", ratio_x, ratio_y);
 
+	sc->hsc_filter = meson_vpp_vd_scaling_filter(ratio_x);
+	sc->vsc_filter = meson_vpp_vd_scaling_filter(ratio_y);
+
 	meson_overlay_get_vertical_phase(ratio_y, &vphase, &vphase_repeat_skip,
 					 interlace_mode);
 
@@ -229,9 +310,9 @@ static void meson_overlay_setup_scaler_params(struct meson_drm *priv,
 	vd_end_lines += crop_left;
 
 	/*
-	 * TOFIX: Input frames are handled and scaled like progressive frames,
-	 * proper handling of interlaced field input frames need to be figured
-	 * out using the proper framebuffer flags set by userspace.
+	 * Input frames are scaled like progressive frames unless the
+	 * "deinterlace" plane property is set, the framebuffer doesn't tell
+	 * whether it holds two fields.
 	 */
 	if (interlace_mode) {
 		start >>= 1;
@@ -271,7 +352,7 @@ static void meson_overlay_setup_scaler_params(struct meson_drm *priv,
 	temp = hd_start_lines + (temp_width * ratio_x >> 18);
 	hd_end_lines = (temp <= (w_in - 1)) ? temp : (w_in - 1);
 
-	priv->viu.vpp_line_in_length = hd_end_lines - hd_start_lines + 1;
+	sc->vpp_line_in_length = hd_end_lines - hd_start_lines + 1;
 	hsc_startp = max_t(int, start, max_t(int, 0, video_left));
 	hsc_endp = min_t(int, end, min_t(int, crtc_width - 1,
 					 video_left + video_width - 1));
@@ -282,59 +363,197 @@ static void meson_overlay_setup_scaler_params(struct meson_drm *priv,
 	DRM_DEBUG("hsc startp %d endp %d start_lines %d end_lines %d\n",
 		 hsc_startp, hsc_endp, hd_start_lines, hd_end_lines);
 
-	priv->viu.vpp_vsc_start_phase_step = ratio_y << 6;
+	sc->vpp_vsc_start_phase_step = ratio_y << 6;
 
-	priv->viu.vpp_vsc_ini_phase = vphase << 8;
-	priv->viu.vpp_vsc_phase_ctrl = (1 << 13) | (4 << 8) |
-				       vphase_repeat_skip;
+	sc->vpp_vsc_ini_phase = vphase << 8;
+	sc->vpp_vsc_phase_ctrl = (1 << 13) | (4 << 8) |
+				 vphase_repeat_skip;
 
-	priv->viu.vd1_if0_luma_x0 = VD_X_START(hd_start_lines) |
-				    VD_X_END(hd_end_lines);
-	priv->viu.vd1_if0_chroma_x0 = VD_X_START(hd_start_lines >> 1) |
-				      VD_X_END(hd_end_lines >> 1);
+	sc->vd1_if0_luma_x0 = VD_X_START(hd_start_lines) |
+			      VD_X_END(hd_end_lines);
+	sc->vd1_if0_chroma_x0 = VD_X_START(hd_start_lines >> 1) |
+				VD_X_END(hd_end_lines >> 1);
 
-	priv->viu.viu_vd1_fmt_w =
+	sc->viu_vd1_fmt_w =
 			VD_H_WIDTH(hd_end_lines - hd_start_lines + 1) |
 			VD_V_WIDTH(hd_end_lines/2 - hd_start_lines/2 + 1);
 
-	priv->viu.vd1_if0_luma_y0 = VD_Y_START(vd_start_lines) |
-				    VD_Y_END(vd_end_lines);
-
-	priv->viu.vd1_if0_chroma_y0 = VD_Y_START(vd_start_lines >> 1) |
-				      VD_Y_END(vd_end_lines >> 1);
+	sc->vd1_if0_luma_y0 = VD_Y_START(vd_start_lines) |
+			      VD_Y_END(vd_end_lines);
+
+	sc->vd1_if0_chroma_y0 = VD_Y_START(vd_start_lines >> 1) |
+				VD_Y_END(vd_end_lines >> 1);
+
+	if (deint) {
+		unsigned int phase = vphase << 8;
+
+		/*
+		 * The line numbers above count field lines, the fields are
+		 * interleaved in the frame, chroma lines included for NV12.
+		 */
+		sc->vd1_if0_luma_y0 = VD_Y_START(vd_start_lines * 2) |
+				      VD_Y_END(vd_end_lines * 2);
+		sc->vd1_if0_luma_y0_bot = VD_Y_START(vd_start_lines * 2 + 1) |
+					  VD_Y_END(vd_end_lines * 2 + 1);
+		sc->vd1_if0_chroma_y0 =
+			VD_Y_START((vd_start_lines >> 1) * 2) |
+			VD_Y_END((vd_end_lines >> 1) * 2);
+		sc->vd1_if0_chroma_y0_bot =
+			VD_Y_START((vd_start_lines >> 1) * 2 + 1) |
+			VD_Y_END((vd_end_lines >> 1) * 2 + 1);
+
+		/*
+		 * The bottom field sits half a field line below the top one:
+		 * start the top field a quarter line down and the bottom
+		 * field a quarter line up, by repeating its first line once
+		 * more.
+		 */
+		sc->vpp_vsc_ini_phase = min(phase + 0x4000, 0xffffu);
+		if (phase + 0xc000 > 0xffff) {
+			sc->vpp_vsc_ini_phase_bot = phase + 0xc000 - 0x10000;
+			sc->vpp_vsc_phase_ctrl_bot = sc->vpp_vsc_phase_ctrl;
+		} else {
+			sc->vpp_vsc_ini_phase_bot = phase + 0xc000;
+			sc->vpp_vsc_phase_ctrl_bot = (2 << 13) | (4 << 8) |
+						     vphase_repeat_skip;
+		}
+	}
 
-	priv->viu.vpp_pic_in_height = h_in;
+	sc->vpp_pic_in_height = h_in;
 
-	priv->viu.vpp_postblend_vd1_h_start_end = VD_H_START(hsc_startp) |
-						  VD_H_END(hsc_endp);
-	priv->viu.vpp_blend_vd2_h_start_end = VD_H_START(hd_start_lines) |
-					      VD_H_END(hd_end_lines);
-	priv->viu.vpp_hsc_region12_startp = VD_REGION13_END(0) |
-					    VD_REGION24_START(hsc_startp);
-	priv->viu.vpp_hsc_region34_startp =
+	sc->vpp_postblend_vd1_h_start_end = VD_H_START(hsc_startp) |
+					    VD_H_END(hsc_endp);
+	sc->vpp_blend_vd2_h_start_end = VD_H_START(hd_start_lines) |
+					VD_H_END(hd_end_lines);
+	sc->vpp_hsc_region12_startp = VD_REGION13_END(0) |
+				      VD_REGION24_START(hsc_startp);
+	sc->vpp_hsc_region34_startp =
 				VD_REGION13_END(hsc_startp) |
 				VD_REGION24_START(hsc_endp - hsc_startp);
-	priv->viu.vpp_hsc_region4_endp = hsc_endp - hsc_startp;
-	priv->viu.vpp_hsc_start_phase_step = ratio_x << 6;
-	priv->viu.vpp_hsc_region1_phase_slope = 0;
-	priv->viu.vpp_hsc_region3_phase_slope = 0;
-	priv->viu.vpp_hsc_phase_ctrl = (1 << 21) | (4 << 16);
-
-	priv->viu.vpp_line_in_length = hd_end_lines - hd_start_lines + 1;
-	priv->viu.vpp_preblend_h_size = hd_end_lines - hd_start_lines + 1;
-
-	priv->viu.vpp_postblend_vd1_v_start_end = VD_V_START(vsc_startp) |
-						  VD_V_END(vsc_endp);
-	priv->viu.vpp_blend_vd2_v_start_end =
+	sc->vpp_hsc_region4_endp = hsc_endp - hsc_startp;
+	sc->vpp_hsc_start_phase_step = ratio_x << 6;
+	sc->vpp_hsc_region1_phase_slope = 0;
+	sc->vpp_hsc_region3_phase_slope = 0;
+	sc->vpp_hsc_phase_ctrl = (1 << 21) | (4 << 16);
+
+	sc->vpp_line_in_length = hd_end_lines - hd_start_lines + 1;
+	sc->vpp_preblend_h_size = hd_end_lines - hd_start_lines + 1;
+
+	sc->vpp_postblend_vd1_v_start_end = VD_V_START(vsc_startp) |
+					    VD_V_END(vsc_endp);
+	sc->vpp_blend_vd2_v_start_end =
 				VD2_V_START((vd_end_lines + 1) >> 1) |
 				VD2_V_END(vd_end_lines);
 
-	priv->viu.vpp_vsc_region12_startp = 0;
-	priv->viu.vpp_vsc_region34_startp =
+	sc->vpp_vsc_region12_startp = 0;
+	sc->vpp_vsc_region34_startp =
 				VD_REGION13_END(vsc_endp - vsc_startp) |
 				VD_REGION24_START(vsc_endp - vsc_startp);
-	priv->viu.vpp_vsc_region4_endp = vsc_endp - vsc_startp;
-	priv->viu.vpp_vsc_start_phase_step = ratio_y << 6;
+	sc->vpp_vsc_region4_endp = vsc_endp - vsc_startp;
+	sc->vpp_vsc_start_phase_step = ratio_y << 6;
+
+	if (afbc) {
+		/*
+		 * The AFBC decoder works on 32x4 blocks, decode the
+		 * enclosing area then crop to the displayed pixels.
+		 */
+		unsigned int afbc_left = round_down(hd_start_lines, 32);
+		unsigned int afbc_right = round_up(hd_end_lines + 1, 32);
+		unsigned int afbc_top = round_down(vd_start_lines, 4);
+		unsigned int afbc_bottom = round_up(vd_end_lines + 1, 4);
+
+		sc->vd1_afbc_size_in =
+				AFBC_HSIZE(afbc_right - afbc_left) |
+				AFBC_VSIZE(afbc_bottom - afbc_top);
+		sc->vd1_afbc_size_out =
+				AFBC_HSIZE(hd_end_lines - hd_start_lines + 1) |
+				AFBC_VSIZE(vd_end_lines - vd_start_lines + 1);
+		sc->vd1_afbc_mif_hor_scope =
+				AFBC_MIF_BLK_BGN_H(afbc_left / 32) |
+				AFBC_MIF_BLK_END_H(afbc_right / 32 - 1);
+		sc->vd1_afbc_mif_ver_scope =
+				AFBC_MIF_BLK_BGN_V(afbc_top / 4) |
+				AFBC_MIF_BLK_END_V(afbc_bottom / 4 - 1);
+		sc->vd1_afbc_pixel_hor_scope =
+				AFBC_DEC_PIXEL_BGN(hd_start_lines - afbc_left) |
+				AFBC_DEC_PIXEL_END(hd_end_lines - afbc_left);
+		sc->vd1_afbc_pixel_ver_scope =
+				AFBC_DEC_PIXEL_BGN(vd_start_lines - afbc_top) |
+				AFBC_DEC_PIXEL_END(vd_end_lines - afbc_top);
+		sc->vd1_afbc_vd_cfmt_w =
+			AFBC_VD_H_WIDTH(hd_end_lines - hd_start_lines + 1) |
+			AFBC_VD_V_WIDTH(hd_end_lines / 2 - hd_start_lines / 2 + 1);
+		sc->vd1_afbc_vd_cfmt_h =
+			AFBC_VD_HEIGHT((vd_end_lines - vd_start_lines + 1) / 2);
+	}
+}
+
+static void meson_overlay_scaler_key(struct meson_overlay_scaler_key *key,
+				     struct drm_plane_state *state,
+				     struct drm_crtc_state *crtc_state)
+{
+	memset(key, 0, sizeof(*key));
+	key->src_x = state->src_x;
+	key->src_y = state->src_y;
+	key->src_w = state->src_w;
+	key->src_h = state->src_h;
+	key->crtc_x = state->crtc_x;
+	key->crtc_y = state->crtc_y;
+	key->crtc_w = state->crtc_w;
+	key->crtc_h = state->crtc_h;
+	key->hdisplay = crtc_state->mode.hdisplay;
+	key->vdisplay = crtc_state->mode.vdisplay;
+	key->format = state->fb->format->format;
+	key->modifier = state->fb->modifier;
+	key->interlace = crtc_state->mode.flags & DRM_MODE_FLAG_INTERLACE;
+
+	/* An interlaced mode shows the fields as they are */
+	key->deint = !key->interlace &&
+		     to_meson_overlay_state(state)->deinterlace !=
+		     MESON_DEINTERLACE_OFF;
+}
+
+static int meson_overlay_atomic_check(struct drm_plane *plane,
+				      struct drm_plane_state *state)
+{
+	struct meson_overlay_state *ostate = to_meson_overlay_state(state);
+	struct meson_overlay_scaler_key key;
+	struct drm_crtc_state *crtc_state;
+	int ret;
+
+	if (!state->crtc)
+		return 0;
+
+	crtc_state = drm_atomic_get_crtc_state(state->state, state->crtc);
+	if (IS_ERR(crtc_state))
+		return PTR_ERR(crtc_state);
+
+	ret = drm_atomic_helper_check_plane_state(state, crtc_state,
+						  FRAC_16_16(1, 5),
+						  FRAC_16_16(5, 1),
+						  true, true);
+	if (ret || !state->fb)
+		return ret;
+
+	/* Animated resizes mostly flip buffers on an unchanged geometry */
+	meson_overlay_scaler_key(&key, state, crtc_state);
+
+	/* The field lines are picked by the VD1 MIF, in NV12/NV21 only */
+	if (key.deint && key.format != DRM_FORMAT_NV12 &&
+	    key.format != DRM_FORMAT_NV21)
+		return -EINVAL;
+
+	if (ostate->scaler_valid && !memcmp(&key, &ostate->key, sizeof(key)))
+		return 0;
+
+	meson_overlay_setup_scaler_params(&ostate->scaler, state, crtc_state,
+				key.interlace,
+				key.modifier == DRM_FORMAT_MOD_MESON_FBC,
+				key.deint);
+	ostate->key = key;
+	ostate->scaler_valid = true;
+
+	return 0;
 }
 
 static void meson_overlay_atomic_update(struct drm_plane *plane,
@@ -344,6 +563,7 @@ static void meson_overlay_atomic_update(struct drm_plane *plane,
 	struct drm_plane_state *state = plane->state;
 	struct drm_framebuffer *fb = state->fb;
 	struct meson_drm *priv = meson_overlay->priv;
+	struct meson_overlay_state *ostate = to_meson_overlay_state(state);
 	struct drm_gem_cma_object *gem;
 	unsigned long flags;
 	bool interlace_mode;
@@ -361,18 +581,28 @@ static void meson_overlay_atomic_update(struct drm_plane *plane,
 
 	spin_lock_irqsave(&priv->drm->event_lock, flags);
 
+	priv->viu.vd1_afbc = fb->modifier == DRM_FORMAT_MOD_MESON_FBC;
+
 	priv->viu.vd1_if0_gen_reg = VD_URGENT_CHROMA |
 				    VD_URGENT_LUMA |
 				    VD_HOLD_LINES(9) |
 				    VD_CHRO_RPT_LASTL_CTRL |
 				    VD_ENABLE;
 
-	/* Setup scaler params */
-	meson_overlay_setup_scaler_params(priv, plane, interlace_mode);
+	/* Scaler params were computed by atomic_check */
+	priv->viu.vd1_scaler = ostate->scaler;
+
+	/* The vsync irq alternates the fields, starting from the first one */
+	priv->viu.vd1_deint = ostate->key.deint;
+	priv->viu.vd1_deint_bff =
+			ostate->deinterlace == MESON_DEINTERLACE_BOB_BFF;
 
+	/* Both skip every other line */
 	priv->viu.vd1_if0_repeat_loop = 0;
-	priv->viu.vd1_if0_luma0_rpt_pat = interlace_mode ? 8 : 0;
-	priv->viu.vd1_if0_chroma0_rpt_pat = interlace_mode ? 8 : 0;
+	priv->viu.vd1_if0_luma0_rpt_pat =
+			interlace_mode || priv->viu.vd1_deint ? 8 : 0;
+	priv->viu.vd1_if0_chroma0_rpt_pat =
+			interlace_mode || priv->viu.vd1_deint ? 8 : 0;
 	priv->viu.vd1_range_map_y = 0;
 	priv->viu.vd1_range_map_cb = 0;
 	priv->viu.vd1_range_map_cr = 0;
@@ -381,7 +611,39 @@ static void meson_overlay_atomic_update(struct drm_plane *plane,
 	priv->viu.vd1_if0_gen_reg2 = 0;
 	priv->viu.viu_vd1_fmt_ctrl = 0;
 
-	switch (fb->format->format) {
+	if (priv->viu.vd1_afbc) {
+		priv->viu.vd1_afbc_en = 0x1600 | AFBC_DEC_ENABLE;
+		priv->viu.vd1_afbc_mode = AFBC_MIF_URGENT(3) |
+					  AFBC_HOLD_LINE_NUM(8) |
+					  AFBC_BURST_LEN(2);
+		priv->viu.vd1_afbc_conv_ctrl = AFBC_CONV_LBUF_LEN(256);
+		priv->viu.vd1_afbc_dec_def_color = AFBC_DEF_COLOR_Y(1023);
+		priv->viu.vd1_afbc_vd_cfmt_ctrl = AFBC_HORZ_RPT_PIXEL0 |
+						  AFBC_HORZ_Y_C_RATIO(1) | /* /2 */
+						  AFBC_HORZ_FMT_EN |
+						  AFBC_VERT_RPT_LINE0 |
+						  AFBC_VERT_INITIAL_PHASE(12) |
+						  AFBC_VERT_PHASE_STEP(8) | /* /4 */
+						  AFBC_VERT_FMT_EN;
+
+		if (fb->format->format == DRM_FORMAT_YUV420_10BIT) {
+			priv->viu.vd1_afbc_mode |=
+				AFBC_COMPBITS_YUV(AFBC_COMPBITS_10BIT);
+			priv->viu.vd1_afbc_dec_def_color |=
+				AFBC_DEF_COLOR_U(512) | AFBC_DEF_COLOR_V(512);
+		} else {
+			priv->viu.vd1_afbc_mode |=
+				AFBC_COMPBITS_YUV(AFBC_COMPBITS_8BIT);
+			priv->viu.vd1_afbc_dec_def_color |=
+				AFBC_DEF_COLOR_U(128) | AFBC_DEF_COLOR_V(128);
+		}
+
+		/* The VD1 MIF is bypassed */
+		priv->viu.vd1_if0_gen_reg = 0;
+		priv->viu.vd1_if0_canvas0 = 0;
+	}
+
+	switch (priv->viu.vd1_afbc ? 0 : fb->format->format) {
 	/* TOFIX DRM_FORMAT_RGB888 should be supported */
 	case DRM_FORMAT_YUYV:
 		priv->viu.vd1_if0_gen_reg |= VD_BYTES_PER_PIXEL(1);
@@ -506,6 +768,17 @@ static void meson_overlay_atomic_update(struct drm_plane *plane,
 			 priv->viu.vd1_height0);
 	}
 
+	if (priv->viu.vd1_afbc) {
+		u32 body_size = AFBC_BODY_BLOCK_SIZE *
+				(ALIGN(fb->width, 64) / 64) *
+				(ALIGN(fb->height, 32) / 32);
+
+		/* Addresses are in 16 bytes units, the header follows the body */
+		priv->viu.vd1_afbc_body_addr = priv->viu.vd1_addr0 >> 4;
+		priv->viu.vd1_afbc_head_addr =
+			(priv->viu.vd1_addr0 + body_size) >> 4;
+	}
+
 	priv->viu.vd1_enabled = true;
 
 	spin_unlock_irqrestore(&priv->drm->event_lock, flags);
@@ -522,10 +795,12 @@ static void meson_overlay_atomic_disable(struct drm_plane *plane,
 	DRM_DEBUG_DRIVER("\n");
 
 	priv->viu.vd1_enabled = false;
+	priv->viu.vd1_deint = false;
 
 	/* Disable VD1 */
 	writel_bits_relaxed(VPP_VD1_POSTBLEND | VPP_VD1_PREBLEND, 0,
 			    priv->io_base + _REG(VPP_MISC));
+	writel_relaxed(0, priv->io_base + _REG(AFBC_ENABLE));
 
 }
 
@@ -536,13 +811,112 @@ static const struct drm_plane_helper_funcs meson_overlay_helper_funcs = {
 	.prepare_fb	= drm_gem_fb_prepare_fb,
 };
 
+static const uint64_t format_modifiers[] = {
+	DRM_FORMAT_MOD_MESON_FBC,
+	DRM_FORMAT_MOD_LINEAR,
+	DRM_FORMAT_MOD_INVALID,
+};
+
+static bool meson_overlay_format_mod_supported(struct drm_plane *plane,
+					       u32 format, u64 modifier)
+{
+	bool compressed = format == DRM_FORMAT_YUV420_8BIT ||
+			  format == DRM_FORMAT_YUV420_10BIT;
+
+	if (modifier == DRM_FORMAT_MOD_MESON_FBC)
+		return compressed;
+
+	if (modifier == DRM_FORMAT_MOD_LINEAR)
+		return !compressed;
+
+	return false;
+}
+
+static void meson_overlay_destroy_state(struct drm_plane *plane,
+					struct drm_plane_state *state)
+{
+	__drm_atomic_helper_plane_destroy_state(state);
+	kfree(to_meson_overlay_state(state));
+}
+
+static void meson_overlay_reset(struct drm_plane *plane)
+{
+	struct meson_overlay_state *state;
+
+	if (plane->state)
+		meson_overlay_destroy_state(plane, plane->state);
+	plane->state = NULL;
+
+	state = kzalloc(sizeof(*state), GFP_KERNEL);
+	if (!state)
+		return;
+
+	state->base.plane = plane;
+	state->base.rotation = DRM_MODE_ROTATE_0;
+	state->base.alpha = DRM_BLEND_ALPHA_OPAQUE;
+	plane->state = &state->base;
+}
+
+static struct drm_plane_state *
+meson_overlay_duplicate_state(struct drm_plane *plane)
+{
+	struct meson_overlay_state *state;
+
+	if (WARN_ON(!plane->state))
+		return NULL;
+
+	/* Also copies the cached scaler config */
+	state = kmemdup(to_meson_overlay_state(plane->state), sizeof(*state),
+			GFP_KERNEL);
+	if (!state)
+		return NULL;
+
+	__drm_atomic_helper_plane_duplicate_state(plane, &state->base);
+
+	return &state->base;
+}
+
+static int meson_overlay_atomic_set_property(struct drm_plane *plane,
+					     struct drm_plane_state *state,
+					     struct drm_property *property,
+					     uint64_t val)
+{
+	struct meson_overlay *meson_overlay = to_meson_overlay(plane);
+
+	if (property != meson_overlay->deinterlace_prop)
+		return -EINVAL;
+
+	to_meson_overlay_state(state)->deinterlace = val;
+
+	return 0;
+}
+
+static int meson_overlay_atomic_get_property(struct drm_plane *plane,
+					     const struct drm_plane_state *state,
+					     struct drm_property *property,
+					     uint64_t *val)
+{
+	struct meson_overlay *meson_overlay = to_meson_overlay(plane);
+
+	if (property != meson_overlay->deinterlace_prop)
+		return -EINVAL;
+
+	*val = container_of(state, struct meson_overlay_state,
+			    base)->deinterlace;
+
+	return 0;
+}
+
 static const struct drm_plane_funcs meson_overlay_funcs = {
 	.update_plane		= drm_atomic_helper_update_plane,
 	.disable_plane		= drm_atomic_helper_disable_plane,
 	.destroy		= drm_plane_cleanup,
-	.reset			= drm_atomic_helper_plane_reset,
-	.atomic_duplicate_state = drm_atomic_helper_plane_duplicate_state,
-	.atomic_destroy_state	= drm_atomic_helper_plane_destroy_state,
+	.reset			= meson_overlay_reset,
+	.atomic_duplicate_state = meson_overlay_duplicate_state,
+	.atomic_destroy_state	= meson_overlay_destroy_state,
+	.format_mod_supported	= meson_overlay_format_mod_supported,
+	.atomic_set_property	= meson_overlay_atomic_set_property,
+	.atomic_get_property	= meson_overlay_atomic_get_property,
 };
 
 static const uint32_t supported_drm_formats[] = {
@@ -554,6 +928,9 @@ static const uint32_t supported_drm_formats[] = {
 	DRM_FORMAT_YUV420,
 	DRM_FORMAT_YUV411,
 	DRM_FORMAT_YUV410,
+	/* Compressed frames from the HEVC decoder, AFBC modifier only */
+	DRM_FORMAT_YUV420_8BIT,
+	DRM_FORMAT_YUV420_10BIT,
 };
 
 int meson_overlay_create(struct meson_drm *priv)
@@ -575,11 +952,21 @@ int meson_overlay_create(struct meson_drm *priv)
 				 &meson_overlay_funcs,
 				 supported_drm_formats,
 				 ARRAY_SIZE(supported_drm_formats),
-				 NULL,
+				 format_modifiers,
 				 DRM_PLANE_TYPE_OVERLAY, "meson_overlay_plane");
 
 	drm_plane_helper_add(plane, &meson_overlay_helper_funcs);
 
+	meson_overlay->deinterlace_prop =
+		drm_property_create_enum(priv->drm, 0, "deinterlace",
+					 meson_deinterlace_names,
+					 ARRAY_SIZE(meson_deinterlace_names));
+	if (!meson_overlay->deinterlace_prop)
+		return -ENOMEM;
+	drm_object_attach_property(&plane->base,
+				   meson_overlay->deinterlace_prop,
+				   MESON_DEINTERLACE_OFF);
+
 	priv->overlay_plane = plane;
 
 	DRM_DEBUG_DRIVER("\n");
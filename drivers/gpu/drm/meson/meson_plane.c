@@ -77,6 +77,11 @@
 /* VPP_OSD_HSC_PHASE_STEP */
 #define SC_PHASE_STEP(value)		FIELD_PREP(GENMASK(27, 0), value)
 
+/* Only the 32bit RGBA layouts can be fed to the GXM AFBC decoder */
+#define MESON_MOD_AFBC_FLAGS	(AFBC_FORMAT_MOD_BLOCK_SIZE_16x16 | \
+				 AFBC_FORMAT_MOD_YTR | \
+				 AFBC_FORMAT_MOD_SPARSE)
+
 struct meson_plane {
 	struct drm_plane base;
 	struct meson_drm *priv;
@@ -161,7 +166,29 @@ static void meson_plane_atomic_update(struct drm_plane *plane,
 	if (meson_vpu_is_compatible(priv, "amlogic,meson-gxbb-vpu"))
 		priv->viu.osd1_blk0_cfg[0] |= OSD_OUTPUT_COLOR_RGB;
 
+	priv->viu.osd1_afbcd = fb->modifier != DRM_FORMAT_MOD_LINEAR;
+	priv->viu.osd1_afbcd_modifier = fb->modifier;
+
+	/* The AFBC decoder outputs RGBA8888 pixels in the Mali layout */
+	if (priv->viu.osd1_afbcd)
+		priv->viu.osd1_blk0_cfg[0] |= OSD_MALI_SRC_EN |
+					      OSD_MALI_COLOR_MODE_RGBA8888;
+
 	switch (fb->format->format) {
+	case DRM_FORMAT_XBGR8888:
+		/* For XBGR, replace the pixel's alpha by 0xFF */
+		writel_bits_relaxed(OSD_REPLACE_EN, OSD_REPLACE_EN,
+				    priv->io_base + _REG(VIU_OSD1_CTRL_STAT2));
+		priv->viu.osd1_blk0_cfg[0] |= OSD_BLK_MODE_32 |
+					      OSD_COLOR_MATRIX_32_ABGR;
+		break;
+	case DRM_FORMAT_ABGR8888:
+		/* For ABGR, use the pixel's alpha */
+		writel_bits_relaxed(OSD_REPLACE_EN, 0,
+				    priv->io_base + _REG(VIU_OSD1_CTRL_STAT2));
+		priv->viu.osd1_blk0_cfg[0] |= OSD_BLK_MODE_32 |
+					      OSD_COLOR_MATRIX_32_ABGR;
+		break;
 	case DRM_FORMAT_XRGB8888:
 		/* For XRGB, replace the pixel's alpha by 0xFF */
 		writel_bits_relaxed(OSD_REPLACE_EN, OSD_REPLACE_EN,
@@ -304,6 +331,7 @@ static void meson_plane_atomic_update(struct drm_plane *plane,
 	priv->viu.osd1_addr = gem->paddr;
 	priv->viu.osd1_stride = fb->pitches[0];
 	priv->viu.osd1_height = fb->height;
+	priv->viu.osd1_width = fb->width;
 
 	if (!meson_plane->enabled) {
 		/* Reset OSD1 at updates on GXL+ SoCs */
@@ -327,6 +355,11 @@ static void meson_plane_atomic_disable(struct drm_plane *plane,
 	writel_bits_relaxed(VPP_OSD1_POSTBLEND, 0,
 			    priv->io_base + _REG(VPP_MISC));
 
+	if (priv->viu.osd1_afbcd) {
+		meson_viu_osd1_afbcd_disable(priv);
+		priv->viu.osd1_afbcd = false;
+	}
+
 	meson_plane->enabled = false;
 
 }
@@ -338,6 +371,20 @@ static const struct drm_plane_helper_funcs meson_plane_helper_funcs = {
 	.prepare_fb	= drm_gem_fb_prepare_fb,
 };
 
+static bool meson_plane_format_mod_supported(struct drm_plane *plane,
+					     u32 format, u64 modifier)
+{
+	if (modifier == DRM_FORMAT_MOD_LINEAR)
+		return true;
+
+	if ((modifier & ~AFBC_FORMAT_MOD_SPLIT) !=
+	    DRM_FORMAT_MOD_ARM_AFBC(MESON_MOD_AFBC_FLAGS))
+		return false;
+
+	return format == DRM_FORMAT_XBGR8888 ||
+	       format == DRM_FORMAT_ABGR8888;
+}
+
 static const struct drm_plane_funcs meson_plane_funcs = {
 	.update_plane		= drm_atomic_helper_update_plane,
 	.disable_plane		= drm_atomic_helper_disable_plane,
@@ -345,17 +392,28 @@ static const struct drm_plane_funcs meson_plane_funcs = {
 	.reset			= drm_atomic_helper_plane_reset,
 	.atomic_duplicate_state = drm_atomic_helper_plane_duplicate_state,
 	.atomic_destroy_state	= drm_atomic_helper_plane_destroy_state,
+	.format_mod_supported	= meson_plane_format_mod_supported,
 };
 
 static const uint32_t supported_drm_formats[] = {
 	DRM_FORMAT_ARGB8888,
 	DRM_FORMAT_XRGB8888,
+	DRM_FORMAT_ABGR8888,
+	DRM_FORMAT_XBGR8888,
 	DRM_FORMAT_RGB888,
 	DRM_FORMAT_RGB565,
 };
 
+static const uint64_t format_modifiers_afbc_gxm[] = {
+	DRM_FORMAT_MOD_ARM_AFBC(MESON_MOD_AFBC_FLAGS),
+	DRM_FORMAT_MOD_ARM_AFBC(MESON_MOD_AFBC_FLAGS | AFBC_FORMAT_MOD_SPLIT),
+	DRM_FORMAT_MOD_LINEAR,
+	DRM_FORMAT_MOD_INVALID,
+};
+
 int meson_plane_create(struct meson_drm *priv)
 {
+	const uint64_t *format_modifiers = NULL;
 	struct meson_plane *meson_plane;
 	struct drm_plane *plane;
 
@@ -367,11 +425,15 @@ int meson_plane_create(struct meson_drm *priv)
 	meson_plane->priv = priv;
 	plane = &meson_plane->base;
 
+	/* Only the GXM VPU has an AFBC decoder in front of OSD1 */
+	if (meson_vpu_is_compatible(priv, "amlogic,meson-gxm-vpu"))
+		format_modifiers = format_modifiers_afbc_gxm;
+
 	drm_universal_plane_init(priv->drm, plane, 0xFF,
 				 &meson_plane_funcs,
 				 supported_drm_formats,
 				 ARRAY_SIZE(supported_drm_formats),
-				 NULL,
+				 format_modifiers,
 				 DRM_PLANE_TYPE_PRIMARY, "meson_primary_plane");
 
 	drm_plane_helper_add(plane, &meson_plane_helper_funcs);
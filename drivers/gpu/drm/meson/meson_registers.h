@@ -146,7 +146,9 @@
 #define VIU_ADDR_START 0x1a00
 #define VIU_ADDR_END 0x1aff
 #define VIU_SW_RESET 0x1a01
+#define		VIU_SW_RESET_OSD1_AFBCD	BIT(31)
 #define VIU_MISC_CTRL0 0x1a06
+#define		VIU_CTRL0_AFBC_TO_VD1	BIT(20)
 #define VIU_MISC_CTRL1 0x1a07
 #define D2D3_INTF_LENGTH 0x1a08
 #define D2D3_INTF_CTRL0 0x1a09
@@ -299,6 +301,23 @@
 #define VIU_OSD1_OETF_LUT_ADDR_PORT 0x1add
 #define VIU_OSD1_OETF_LUT_DATA_PORT 0x1ade
 #define AFBC_ENABLE 0x1ae0
+#define AFBC_MODE 0x1ae1
+#define AFBC_SIZE_IN 0x1ae2
+#define AFBC_DEC_DEF_COLOR 0x1ae3
+#define AFBC_CONV_CTRL 0x1ae4
+#define AFBC_LBUF_DEPTH 0x1ae5
+#define AFBC_HEAD_BADDR 0x1ae6
+#define AFBC_BODY_BADDR 0x1ae7
+#define AFBC_SIZE_OUT 0x1ae8
+#define AFBC_OUT_YSCOPE 0x1ae9
+#define AFBC_STAT 0x1aea
+#define AFBC_VD_CFMT_CTRL 0x1aeb
+#define AFBC_VD_CFMT_W 0x1aec
+#define AFBC_MIF_HOR_SCOPE 0x1aed
+#define AFBC_MIF_VER_SCOPE 0x1aee
+#define AFBC_PIXEL_HOR_SCOPE 0x1aef
+#define AFBC_PIXEL_VER_SCOPE 0x1af0
+#define AFBC_VD_CFMT_H 0x1af1
 
 /* vpp */
 #define VPP_DUMMY_DATA 0x1d00
@@ -339,6 +358,7 @@
 #define VPP_PREBLEND_CURRENT_XY 0x1d24
 #define VPP_POSTBLEND_CURRENT_XY 0x1d25
 #define VPP_MISC 0x1d26
+#define		VPP_POST_FG_OSD2	BIT(4)
 #define		VPP_PREBLEND_ENABLE	BIT(6)
 #define		VPP_POSTBLEND_ENABLE	BIT(7)
 #define		VPP_OSD2_ALPHA_PREMULT	BIT(8)
@@ -1022,6 +1042,36 @@
 #define RDMA_STATUS 0x1115
 #define RDMA_STATUS2 0x1116
 #define RDMA_STATUS3 0x1117
+
+/* vdin1, looped back on the viu output for the writeback */
+#define VDIN1_COM_CTRL0 0x1302
+#define		VDIN_SEL_MASK		0xf
+#define		VDIN_SEL_VIU		7
+#define		VDIN_COMMON_INPUT_EN	BIT(4)
+#define VDIN1_COM_GCLK_CTRL 0x131b
+#define VDIN1_INTF_WIDTHM1 0x131c
+#define VDIN1_MATRIX_CTRL 0x1310
+#define		VDIN_MATRIX_EN		BIT(0)
+#define VDIN1_MATRIX_COEF00_01 0x1311
+#define VDIN1_MATRIX_COEF02_10 0x1312
+#define VDIN1_MATRIX_COEF11_12 0x1313
+#define VDIN1_MATRIX_COEF20_21 0x1314
+#define VDIN1_MATRIX_COEF22 0x1315
+#define VDIN1_MATRIX_OFFSET0_1 0x1316
+#define VDIN1_MATRIX_OFFSET2 0x1317
+#define VDIN1_MATRIX_PRE_OFFSET0_1 0x1318
+#define VDIN1_MATRIX_PRE_OFFSET2 0x1319
+#define VDIN1_WR_CTRL2 0x131f
+#define		VDIN_WR_CHROMA_CANVAS(c)	((c) & 0xff)
+#define VDIN1_WR_CTRL 0x1320
+#define		VDIN_WR_CANVAS(c)	((c) & 0xff)
+#define		VDIN_WR_REQ_EN		BIT(8)
+#define		VDIN_WR_REQ_URGENT	BIT(9)
+#define		VDIN_WR_FMT_444		(1 << 12)
+#define		VDIN_WR_FMT_420		(2 << 12)
+#define		VDIN_WR_SWAP_CBCR	BIT(18)
+#define VDIN1_WR_H_START_END 0x1321
+#define VDIN1_WR_V_START_END 0x1322
 #define L_GAMMA_CNTL_PORT 0x1400
 #define L_GAMMA_DATA_PORT 0x1401
 #define L_GAMMA_ADDR_PORT 0x1402
@@ -1288,6 +1338,10 @@
 #define		VIU1_SEL_VENC_ENCI	1
 #define		VIU1_SEL_VENC_ENCP	2
 #define		VIU1_SEL_VENC_ENCT	3
+#define		VIU_VDIN_SEL_DATA_SHIFT	8
+#define		VIU_VDIN_SEL_HS_SHIFT	12
+#define		VIU_VDIN_SEL_ENCI	1
+#define		VIU_VDIN_SEL_ENCP	2
 #define		VIU2_SEL_VENC_MASK	0xc
 #define		VIU2_SEL_VENC_ENCL	0
 #define		VIU2_SEL_VENC_ENCI	(1 << 2)
@@ -1400,4 +1454,16 @@
 #define OSDSR_YBIC_VCOEF0 0x3149
 #define OSDSR_CBIC_VCOEF0 0x314a
 
+/* osd1 afbc decoder, gxm only */
+#define OSD1_AFBCD_ENABLE 0x31a0
+#define OSD1_AFBCD_MODE 0x31a1
+#define OSD1_AFBCD_SIZE_IN 0x31a2
+#define OSD1_AFBCD_HDR_PTR 0x31a3
+#define OSD1_AFBCD_FRAME_PTR 0x31a4
+#define OSD1_AFBCD_CHROMA_PTR 0x31a5
+#define OSD1_AFBCD_CONV_CTRL 0x31a6
+#define OSD1_AFBCD_STATUS 0x31a8
+#define OSD1_AFBCD_PIXEL_HSCOPE 0x31a9
+#define OSD1_AFBCD_PIXEL_VSCOPE 0x31aa
+
 #endif /* __MESON_REGISTERS_H */
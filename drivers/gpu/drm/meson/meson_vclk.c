@@ -248,6 +248,9 @@ static void meson_venci_cvbs_clock_config(struct meson_drm *priv)
 {
 	unsigned int val;
 
+	/* The HDMI PLL and ENCI source are shared with the HDMI path */
+	priv->vclk.valid = false;
+
 	/* Setup PLL to output 1.485GHz */
 	if (meson_vpu_is_compatible(priv, "amlogic,meson-gxbb-vpu")) {
 		regmap_write(priv->hhi, HHI_HDMI_PLL_CNTL, 0x5800023d);
@@ -608,11 +611,11 @@ static bool meson_hdmi_pll_validate_params(struct meson_drm *priv,
 	return true;
 }
 
-static bool meson_hdmi_pll_find_params(struct meson_drm *priv,
-				       unsigned int freq,
-				       unsigned int *m,
-				       unsigned int *frac,
-				       unsigned int *od)
+static bool meson_hdmi_pll_search_params(struct meson_drm *priv,
+					 unsigned int freq,
+					 unsigned int *m,
+					 unsigned int *frac,
+					 unsigned int *od)
 {
 	/* Cycle from /16 to /2 */
 	for (*od = 16 ; *od > 1 ; *od >>= 1) {
@@ -631,6 +634,50 @@ static bool meson_hdmi_pll_find_params(struct meson_drm *priv,
 	return false;
 }
 
+/*
+ * The search is run for each DMT mode of the EDID at each probe, then
+ * again at modeset, keep the validated results around.
+ */
+static bool meson_hdmi_pll_find_params(struct meson_drm *priv,
+				       unsigned int freq,
+				       unsigned int *m,
+				       unsigned int *frac,
+				       unsigned int *od)
+{
+	unsigned long flags;
+	unsigned int i;
+	bool found;
+
+	spin_lock_irqsave(&priv->vclk.lock, flags);
+	for (i = 0 ; i < MESON_VCLK_PLL_CACHE_SIZE ; ++i) {
+		if (priv->vclk.pll_cache[i].freq != freq)
+			continue;
+
+		*m = priv->vclk.pll_cache[i].m;
+		*frac = priv->vclk.pll_cache[i].frac;
+		*od = priv->vclk.pll_cache[i].od;
+		found = priv->vclk.pll_cache[i].found;
+		spin_unlock_irqrestore(&priv->vclk.lock, flags);
+
+		return found;
+	}
+	spin_unlock_irqrestore(&priv->vclk.lock, flags);
+
+	found = meson_hdmi_pll_search_params(priv, freq, m, frac, od);
+
+	spin_lock_irqsave(&priv->vclk.lock, flags);
+	i = priv->vclk.pll_cache_next;
+	priv->vclk.pll_cache[i].freq = freq;
+	priv->vclk.pll_cache[i].m = *m;
+	priv->vclk.pll_cache[i].frac = *frac;
+	priv->vclk.pll_cache[i].od = *od;
+	priv->vclk.pll_cache[i].found = found;
+	priv->vclk.pll_cache_next = (i + 1) % MESON_VCLK_PLL_CACHE_SIZE;
+	spin_unlock_irqrestore(&priv->vclk.lock, flags);
+
+	return found;
+}
+
 /* pll_freq is the frequency after the OD dividers */
 enum drm_mode_status
 meson_vclk_dmt_supported_freq(struct meson_drm *priv, unsigned int freq)
@@ -648,32 +695,58 @@ meson_vclk_dmt_supported_freq(struct meson_drm *priv, unsigned int freq)
 EXPORT_SYMBOL_GPL(meson_vclk_dmt_supported_freq);
 
 /* pll_freq is the frequency after the OD dividers */
-static void meson_hdmi_pll_generic_set(struct meson_drm *priv,
-				       unsigned int pll_freq)
+static bool meson_hdmi_pll_generic_params(struct meson_drm *priv,
+					  unsigned int pll_freq,
+					  unsigned int *m, unsigned int *frac,
+					  unsigned int *od1, unsigned int *od2,
+					  unsigned int *od3)
 {
-	unsigned int od, m, frac, od1, od2, od3;
+	unsigned int od;
 
-	if (meson_hdmi_pll_find_params(priv, pll_freq, &m, &frac, &od)) {
+	if (meson_hdmi_pll_find_params(priv, pll_freq, m, frac, &od)) {
 		/* OD2 goes to the PHY, and needs to be *10, so keep OD3=1 */
-		od3 = 1;
+		*od3 = 1;
 		if (od < 4) {
-			od1 = 2;
-			od2 = 1;
+			*od1 = 2;
+			*od2 = 1;
 		} else {
-			od2 = od / 4;
-			od1 = od / od2;
+			*od2 = od / 4;
+			*od1 = od / *od2;
 		}
 
 		DRM_DEBUG_DRIVER("PLL params for %dkHz: m=%x frac=%x od=%d/%d/%d\n",
-				 pll_freq, m, frac, od1, od2, od3);
-
-		meson_hdmi_pll_set_params(priv, m, frac, od1, od2, od3);
+				 pll_freq, *m, *frac, *od1, *od2, *od3);
 
-		return;
+		return true;
 	}
 
 	DRM_ERROR("Fatal, unable to find parameters for PLL freq %d\n",
 		  pll_freq);
+
+	return false;
+}
+
+/*
+ * Only update the HDMI PLL fractional part, keeping it enabled and the
+ * whole clock tree untouched. The PLL stays locked while the frequency
+ * slews, which is used for the 1000/1001 rate variants.
+ */
+static void meson_hdmi_pll_set_frac(struct meson_drm *priv,
+				    unsigned int frac)
+{
+	unsigned int val;
+
+	if (meson_vpu_is_compatible(priv, "amlogic,meson-gxbb-vpu"))
+		regmap_update_bits(priv->hhi, HHI_HDMI_PLL_CNTL2,
+				   0x00004fff, frac ? 0x00004000 | frac : 0);
+	else if (meson_vpu_is_compatible(priv, "amlogic,meson-gxm-vpu") ||
+		 meson_vpu_is_compatible(priv, "amlogic,meson-gxl-vpu"))
+		regmap_update_bits(priv->hhi, HHI_HDMI_PLL_CNTL2,
+				   0x000003ff, frac);
+
+	if (regmap_read_poll_timeout(priv->hhi, HHI_HDMI_PLL_CNTL, val,
+				     (val & HDMI_PLL_LOCK), 10, 10000))
+		DRM_ERROR("HDMI PLL failed to lock on frac %x\n", frac);
 }
 
 enum drm_mode_status
@@ -714,17 +787,12 @@ static void meson_vclk_set(struct meson_drm *priv, unsigned int pll_base_freq,
 {
 	unsigned int m = 0, frac = 0;
 
-	/* Set HDMI-TX sys clock */
-	regmap_update_bits(priv->hhi, HHI_HDMI_CLK_CNTL,
-			   CTS_HDMI_SYS_SEL_MASK, 0);
-	regmap_update_bits(priv->hhi, HHI_HDMI_CLK_CNTL,
-			   CTS_HDMI_SYS_DIV_MASK, 0);
-	regmap_update_bits(priv->hhi, HHI_HDMI_CLK_CNTL,
-			   CTS_HDMI_SYS_EN, CTS_HDMI_SYS_EN);
-
 	/* Set HDMI PLL rate */
 	if (!od1 && !od2 && !od3) {
-		meson_hdmi_pll_generic_set(priv, pll_base_freq);
+		if (!meson_hdmi_pll_generic_params(priv, pll_base_freq,
+						   &m, &frac,
+						   &od1, &od2, &od3))
+			return;
 	} else if (meson_vpu_is_compatible(priv, "amlogic,meson-gxbb-vpu")) {
 		switch (pll_base_freq) {
 		case 2970000:
@@ -740,8 +808,6 @@ static void meson_vclk_set(struct meson_drm *priv, unsigned int pll_base_freq,
 			frac = vic_alternate_clock ? 0xa05 : 0xc00;
 			break;
 		}
-
-		meson_hdmi_pll_set_params(priv, m, frac, od1, od2, od3);
 	} else if (meson_vpu_is_compatible(priv, "amlogic,meson-gxm-vpu") ||
 		   meson_vpu_is_compatible(priv, "amlogic,meson-gxl-vpu")) {
 		switch (pll_base_freq) {
@@ -758,10 +824,45 @@ static void meson_vclk_set(struct meson_drm *priv, unsigned int pll_base_freq,
 			frac = vic_alternate_clock ? 0x102 : 0x200;
 			break;
 		}
+	}
 
-		meson_hdmi_pll_set_params(priv, m, frac, od1, od2, od3);
+	/*
+	 * When switching between rates sharing the same dividers, like
+	 * 60Hz and 59.94Hz, only the PLL fractional part changes: skip the
+	 * PLL reset and the dividers reprogramming.
+	 */
+	if (priv->vclk.valid &&
+	    priv->vclk.m == m &&
+	    priv->vclk.od1 == od1 &&
+	    priv->vclk.od2 == od2 &&
+	    priv->vclk.od3 == od3 &&
+	    priv->vclk.vid_pll_div == vid_pll_div &&
+	    priv->vclk.vclk_div == vclk_div &&
+	    priv->vclk.hdmi_tx_div == hdmi_tx_div &&
+	    priv->vclk.venc_div == venc_div &&
+	    priv->vclk.hdmi_use_enci == hdmi_use_enci) {
+		DRM_DEBUG_DRIVER("PLL frac %x -> %x, dividers kept\n",
+				 priv->vclk.frac, frac);
+
+		if (priv->vclk.frac != frac)
+			meson_hdmi_pll_set_frac(priv, frac);
+
+		priv->vclk.pll_base_freq = pll_base_freq;
+		priv->vclk.frac = frac;
+		return;
 	}
 
+	/* Set HDMI-TX sys clock */
+	regmap_update_bits(priv->hhi, HHI_HDMI_CLK_CNTL,
+			   CTS_HDMI_SYS_SEL_MASK, 0);
+	regmap_update_bits(priv->hhi, HHI_HDMI_CLK_CNTL,
+			   CTS_HDMI_SYS_DIV_MASK, 0);
+	regmap_update_bits(priv->hhi, HHI_HDMI_CLK_CNTL,
+			   CTS_HDMI_SYS_EN, CTS_HDMI_SYS_EN);
+
+	/* Set HDMI PLL rate */
+	meson_hdmi_pll_set_params(priv, m, frac, od1, od2, od3);
+
 	/* Setup vid_pll divider */
 	meson_vid_pll_set(priv, vid_pll_div);
 
@@ -906,6 +1007,19 @@ static void meson_vclk_set(struct meson_drm *priv, unsigned int pll_base_freq,
 				   CTS_ENCP_EN, CTS_ENCP_EN);
 
 	regmap_update_bits(priv->hhi, HHI_VID_CLK_CNTL, VCLK_EN, VCLK_EN);
+
+	priv->vclk.valid = true;
+	priv->vclk.pll_base_freq = pll_base_freq;
+	priv->vclk.m = m;
+	priv->vclk.frac = frac;
+	priv->vclk.od1 = od1;
+	priv->vclk.od2 = od2;
+	priv->vclk.od3 = od3;
+	priv->vclk.vid_pll_div = vid_pll_div;
+	priv->vclk.vclk_div = vclk_div;
+	priv->vclk.hdmi_tx_div = hdmi_tx_div;
+	priv->vclk.venc_div = venc_div;
+	priv->vclk.hdmi_use_enci = hdmi_use_enci;
 }
 
 void meson_vclk_setup(struct meson_drm *priv, unsigned int target,
@@ -992,3 +1106,11 @@ void meson_vclk_setup(struct meson_drm *priv, unsigned int target,
 		       hdmi_use_enci, vic_alternate_clock);
 }
 EXPORT_SYMBOL_GPL(meson_vclk_setup);
+
+void meson_vclk_init(struct meson_drm *priv)
+{
+	spin_lock_init(&priv->vclk.lock);
+
+	/* The bootloader clock configuration is unknown */
+	priv->vclk.valid = false;
+}
@@ -35,6 +35,7 @@ meson_vclk_dmt_supported_freq(struct meson_drm *priv, unsigned int freq);
 enum drm_mode_status
 meson_vclk_vic_supported_freq(unsigned int phy_freq, unsigned int vclk_freq);
 
+void meson_vclk_init(struct meson_drm *priv);
 void meson_vclk_setup(struct meson_drm *priv, unsigned int target,
 		      unsigned int phy_freq, unsigned int vclk_freq,
 		      unsigned int venc_freq, unsigned int dac_freq,
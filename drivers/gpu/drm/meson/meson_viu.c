@@ -20,7 +20,9 @@
 
 #include <linux/kernel.h>
 #include <linux/module.h>
+#include <linux/bitfield.h>
 #include <drm/drmP.h>
+#include <drm/drm_color_mgmt.h>
 #include "meson_drv.h"
 #include "meson_viu.h"
 #include "meson_vpp.h"
@@ -39,10 +41,12 @@
  * - Progressive or Interlace buffer scanout
  * - OSD1 Commit on Vsync
  * - HDR OSD matrix for GXL/GXM
+ * - OSD1 AFBC xBGR8888 scanout on GXM
+ * - OSD1 DEGAMMA_LUT/CTM/GAMMA_LUT through the GXL/GXM EOTF/OETF stages
  *
  * What is missing :
  *
- * - BGR888/xBGR8888/BGRx8888/BGRx8888 modes
+ * - BGR888/BGRx8888 modes
  * - YUV4:2:2 Y0CbY1Cr scanout
  * - Conversion to YUV 4:4:4 from 4:2:2 input
  * - Colorkey Alpha matching
@@ -69,7 +73,7 @@ enum viu_lut_sel_e {
 #define MATRIX_5X3_COEF_SIZE 24
 
 #define EOTF_COEFF_NORM(a) ((int)((((a) * 4096.0) + 1) / 2))
-#define EOTF_COEFF_SIZE 10
+#define EOTF_COEFF_SIZE MESON_VIU_EOTF_COEFF_SIZE
 #define EOTF_COEFF_RIGHTSHIFT 1
 
 static int RGB709_to_YUV709l_coeff[MATRIX_5X3_COEF_SIZE] = {
@@ -157,8 +161,8 @@ void meson_viu_set_osd_matrix(struct meson_drm *priv,
 	}
 }
 
-#define OSD_EOTF_LUT_SIZE 33
-#define OSD_OETF_LUT_SIZE 41
+#define OSD_EOTF_LUT_SIZE MESON_VIU_EOTF_LUT_SIZE
+#define OSD_OETF_LUT_SIZE MESON_VIU_OETF_LUT_SIZE
 
 void meson_viu_set_osd_lut(struct meson_drm *priv, enum viu_lut_sel_e lut_sel,
 			   unsigned int *r_map, unsigned int *g_map,
@@ -269,26 +273,30 @@ static unsigned int oetf_41_linear_mapping[OSD_OETF_LUT_SIZE] = {
 	1023
 };
 
+/* First and last OETF LUT entries of the evenly spaced [0, 1] range */
+#define OSD_OETF_LUT_FIRST	4
+#define OSD_OETF_LUT_LAST	36
+
 static void meson_viu_load_matrix(struct meson_drm *priv)
 {
-	/* eotf lut bypass */
+	/* eotf lut, linear unless a DEGAMMA_LUT is set */
 	meson_viu_set_osd_lut(priv, VIU_LUT_OSD_EOTF,
-			      eotf_33_linear_mapping, /* R */
-			      eotf_33_linear_mapping, /* G */
-			      eotf_33_linear_mapping, /* B */
-			      false);
+			      priv->viu.eotf_lut[0], /* R */
+			      priv->viu.eotf_lut[1], /* G */
+			      priv->viu.eotf_lut[2], /* B */
+			      priv->viu.eotf_lut_en);
 
-	/* eotf matrix bypass */
+	/* eotf matrix, bypass unless a CTM is set */
 	meson_viu_set_osd_matrix(priv, VIU_MATRIX_OSD_EOTF,
-				 eotf_bypass_coeff,
-				 false);
+				 priv->viu.eotf_matrix,
+				 priv->viu.eotf_matrix_en);
 
-	/* oetf lut bypass */
+	/* oetf lut, linear unless a GAMMA_LUT is set */
 	meson_viu_set_osd_lut(priv, VIU_LUT_OSD_OETF,
-			      oetf_41_linear_mapping, /* R */
-			      oetf_41_linear_mapping, /* G */
-			      oetf_41_linear_mapping, /* B */
-			      false);
+			      priv->viu.oetf_lut[0], /* R */
+			      priv->viu.oetf_lut[1], /* G */
+			      priv->viu.oetf_lut[2], /* B */
+			      priv->viu.oetf_lut_en);
 
 	/* osd matrix RGB709 to YUV709 limit */
 	meson_viu_set_osd_matrix(priv, VIU_MATRIX_OSD,
@@ -296,6 +304,145 @@ static void meson_viu_load_matrix(struct meson_drm *priv)
 				 true);
 }
 
+static unsigned int meson_viu_lut_chan(struct drm_color_lut *entry,
+				       unsigned int chan)
+{
+	if (chan == 0)
+		return entry->red;
+	if (chan == 1)
+		return entry->green;
+	return entry->blue;
+}
+
+/* Linearly interpolate channel chan of a DRM LUT at point k of n */
+static unsigned int meson_viu_lut_sample(struct drm_color_lut *lut,
+					 unsigned int size, unsigned int chan,
+					 unsigned int k, unsigned int n)
+{
+	unsigned int pos = k * (size - 1);
+	unsigned int idx = pos / (n - 1);
+	int frac = pos % (n - 1);
+	int v0, v1;
+
+	v0 = meson_viu_lut_chan(&lut[idx], chan);
+	if (!frac || idx >= size - 1)
+		return v0;
+
+	v1 = meson_viu_lut_chan(&lut[idx + 1], chan);
+
+	return v0 + (v1 - v0) * frac / (int)(n - 1);
+}
+
+/* CTM S31.32 sign-magnitude to the EOTF matrix signed 2.11 format */
+static int meson_viu_ctm_coeff(u64 v)
+{
+	int c = min_t(u64, (v & ~BIT_ULL(63)) >> 21, 0xfff);
+
+	return (v & BIT_ULL(63)) ? -c : c;
+}
+
+static void meson_viu_set_eotf_lut(struct meson_drm *priv,
+				   struct drm_property_blob *blob)
+{
+	struct drm_color_lut *lut;
+	unsigned int size, c, i;
+
+	priv->viu.eotf_lut_en = !!blob;
+
+	for (c = 0; c < 3; c++) {
+		if (!blob) {
+			memcpy(priv->viu.eotf_lut[c], eotf_33_linear_mapping,
+			       sizeof(eotf_33_linear_mapping));
+			continue;
+		}
+
+		lut = blob->data;
+		size = drm_color_lut_size(blob);
+
+		/* 16bit DRM values to the 0..0x4000 EOTF range */
+		for (i = 0; i < OSD_EOTF_LUT_SIZE; i++)
+			priv->viu.eotf_lut[c][i] = DIV_ROUND_CLOSEST(
+				meson_viu_lut_sample(lut, size, c, i,
+						     OSD_EOTF_LUT_SIZE) * 0x4000,
+				0xffff);
+	}
+}
+
+static void meson_viu_set_eotf_matrix(struct meson_drm *priv,
+				      struct drm_property_blob *blob)
+{
+	struct drm_color_ctm *ctm;
+	int i;
+
+	priv->viu.eotf_matrix_en = !!blob;
+
+	if (!blob) {
+		memcpy(priv->viu.eotf_matrix, eotf_bypass_coeff,
+		       sizeof(eotf_bypass_coeff));
+		return;
+	}
+
+	ctm = blob->data;
+	for (i = 0; i < 9; i++)
+		priv->viu.eotf_matrix[i] = meson_viu_ctm_coeff(ctm->matrix[i]);
+	priv->viu.eotf_matrix[9] = EOTF_COEFF_RIGHTSHIFT;
+}
+
+static void meson_viu_set_oetf_lut(struct meson_drm *priv,
+				   struct drm_property_blob *blob)
+{
+	unsigned int n = OSD_OETF_LUT_LAST - OSD_OETF_LUT_FIRST + 1;
+	struct drm_color_lut *lut;
+	unsigned int size, c, i, k;
+
+	priv->viu.oetf_lut_en = !!blob;
+
+	for (c = 0; c < 3; c++) {
+		if (!blob) {
+			memcpy(priv->viu.oetf_lut[c], oetf_41_linear_mapping,
+			       sizeof(oetf_41_linear_mapping));
+			continue;
+		}
+
+		lut = blob->data;
+		size = drm_color_lut_size(blob);
+
+		/*
+		 * Only the OSD_OETF_LUT_FIRST..OSD_OETF_LUT_LAST entries are
+		 * evenly spaced, the others are clamped to the range ends as
+		 * in the linear table.
+		 */
+		for (i = 0; i < OSD_OETF_LUT_SIZE; i++) {
+			k = clamp_t(unsigned int, i, OSD_OETF_LUT_FIRST,
+				    OSD_OETF_LUT_LAST) - OSD_OETF_LUT_FIRST;
+			priv->viu.oetf_lut[c][i] = drm_color_lut_extract(
+				meson_viu_lut_sample(lut, size, c, k, n), 10);
+		}
+	}
+}
+
+/*
+ * Convert the CRTC DEGAMMA_LUT, CTM and GAMMA_LUT properties into the
+ * OSD1 EOTF LUT, EOTF matrix and OETF LUT shadow tables, they are written
+ * to the hardware at vsync time by meson_viu_commit_color_mgmt().
+ * Must be called with the event_lock held.
+ */
+void meson_viu_set_color_mgmt(struct meson_drm *priv,
+			      struct drm_crtc_state *state)
+{
+	meson_viu_set_eotf_lut(priv, state->degamma_lut);
+	meson_viu_set_eotf_matrix(priv, state->ctm);
+	meson_viu_set_oetf_lut(priv, state->gamma_lut);
+
+	priv->viu.color_commit = true;
+}
+
+void meson_viu_commit_color_mgmt(struct meson_drm *priv)
+{
+	meson_viu_load_matrix(priv);
+	priv->viu.color_commit = false;
+}
+
 /* VIU OSD1 Reset as workaround for GXL+ Alpha OSD Bug */
 void meson_viu_reset(struct meson_drm *priv)
 {
@@ -323,6 +470,92 @@ void meson_viu_reset(struct meson_drm *priv)
 	meson_viu_load_matrix(priv);
 }
 
+/* OSD1_AFBCD_ENABLE */
+#define OSD1_AFBCD_ID_FIFO_THRD(val)	FIELD_PREP(GENMASK(15, 9), val)
+#define OSD1_AFBCD_DEC_ENABLE		BIT(8)
+
+/* OSD1_AFBCD_MODE */
+#define OSD1_AFBCD_MIF_URGENT(val)	FIELD_PREP(GENMASK(25, 24), val)
+#define OSD1_AFBCD_HOLD_LINE_NUM(val)	FIELD_PREP(GENMASK(22, 16), val)
+#define OSD1_AFBCD_RGBA_EXCHAN(val)	FIELD_PREP(GENMASK(15, 8), val)
+#define OSD1_AFBCD_BLOCK_SPLIT		BIT(6)
+#define OSD1_AFBCD_HALF_BLOCK		BIT(5)
+#define OSD1_AFBCD_PIXEL_FMT(val)	FIELD_PREP(GENMASK(4, 0), val)
+#define OSD1_AFBCD_FMT_RGBA8888		0x15
+
+/* OSD1_AFBCD_SIZE_IN */
+#define OSD1_AFBCD_HSIZE_IN(val)	FIELD_PREP(GENMASK(31, 16), val)
+#define OSD1_AFBCD_VSIZE_IN(val)	FIELD_PREP(GENMASK(15, 0), val)
+
+/* OSD1_AFBCD_PIXEL_HSCOPE OSD1_AFBCD_PIXEL_VSCOPE */
+#define OSD1_AFBCD_PIXEL_BGN(val)	FIELD_PREP(GENMASK(31, 16), val)
+#define OSD1_AFBCD_PIXEL_END(val)	FIELD_PREP(GENMASK(15, 0), val)
+
+/*
+ * Program the GXM OSD1 AFBC decoder from the OSD1 shadow registers,
+ * must be called at vsync time.
+ */
+void meson_viu_osd1_afbcd_setup(struct meson_drm *priv)
+{
+	u64 modifier = priv->viu.osd1_afbcd_modifier;
+	u32 width = priv->viu.osd1_width;
+	u32 mode, conv_lbuf_len;
+
+	/* Reset the decoder state of the previous frame */
+	writel_relaxed(VIU_SW_RESET_OSD1_AFBCD,
+		       priv->io_base + _REG(VIU_SW_RESET));
+	writel_relaxed(0, priv->io_base + _REG(VIU_SW_RESET));
+
+	mode = OSD1_AFBCD_MIF_URGENT(3) |
+	       OSD1_AFBCD_HOLD_LINE_NUM(4) |
+	       OSD1_AFBCD_RGBA_EXCHAN(0x34) |
+	       OSD1_AFBCD_PIXEL_FMT(OSD1_AFBCD_FMT_RGBA8888);
+	if (modifier & AFBC_FORMAT_MOD_SPARSE)
+		mode |= OSD1_AFBCD_HALF_BLOCK;
+	if (modifier & AFBC_FORMAT_MOD_SPLIT)
+		mode |= OSD1_AFBCD_BLOCK_SPLIT;
+	writel_relaxed(mode, priv->io_base + _REG(OSD1_AFBCD_MODE));
+
+	writel_relaxed(OSD1_AFBCD_HSIZE_IN(width) |
+		       OSD1_AFBCD_VSIZE_IN(priv->viu.osd1_height),
+		       priv->io_base + _REG(OSD1_AFBCD_SIZE_IN));
+
+	/* The header is at the start of the buffer, in 16 bytes units */
+	writel_relaxed(priv->viu.osd1_addr >> 4,
+		       priv->io_base + _REG(OSD1_AFBCD_HDR_PTR));
+	writel_relaxed(priv->viu.osd1_addr >> 4,
+		       priv->io_base + _REG(OSD1_AFBCD_FRAME_PTR));
+	/* TOFIX: bits 31:24 are not documented, nor the meaning of 0xe4 */
+	writel_relaxed((0xe4 << 24) | (priv->viu.osd1_addr & 0xffffff),
+		       priv->io_base + _REG(OSD1_AFBCD_CHROMA_PTR));
+
+	/* Line buffer, in pixels */
+	conv_lbuf_len = clamp_t(u32, roundup_pow_of_two(width) / 4, 32, 1024);
+	writel_relaxed(conv_lbuf_len,
+		       priv->io_base + _REG(OSD1_AFBCD_CONV_CTRL));
+
+	writel_relaxed(OSD1_AFBCD_PIXEL_BGN(0) |
+		       OSD1_AFBCD_PIXEL_END(width - 1),
+		       priv->io_base + _REG(OSD1_AFBCD_PIXEL_HSCOPE));
+	writel_relaxed(OSD1_AFBCD_PIXEL_BGN(0) |
+		       OSD1_AFBCD_PIXEL_END(priv->viu.osd1_height - 1),
+		       priv->io_base + _REG(OSD1_AFBCD_PIXEL_VSCOPE));
+
+	writel_relaxed(OSD1_AFBCD_ID_FIFO_THRD(0x40) | OSD1_AFBCD_DEC_ENABLE,
+		       priv->io_base + _REG(OSD1_AFBCD_ENABLE));
+
+	/* Fetch OSD1 from the decoder */
+	writel_bits_relaxed(OSD_DPATH_MALI_AFBCD, OSD_DPATH_MALI_AFBCD,
+			    priv->io_base + _REG(VIU_OSD1_CTRL_STAT2));
+}
+
+void meson_viu_osd1_afbcd_disable(struct meson_drm *priv)
+{
+	writel_bits_relaxed(OSD_DPATH_MALI_AFBCD, 0,
+			    priv->io_base + _REG(VIU_OSD1_CTRL_STAT2));
+	writel_relaxed(0, priv->io_base + _REG(OSD1_AFBCD_ENABLE));
+}
+
 void meson_viu_init(struct meson_drm *priv)
 {
 	uint32_t reg;
@@ -335,8 +568,12 @@ void meson_viu_init(struct meson_drm *priv)
 
 	/* On GXL/GXM, Use the 10bit HDR conversion matrix */
 	if (meson_vpu_is_compatible(priv, "amlogic,meson-gxm-vpu") ||
-	    meson_vpu_is_compatible(priv, "amlogic,meson-gxl-vpu"))
+	    meson_vpu_is_compatible(priv, "amlogic,meson-gxl-vpu")) {
+		meson_viu_set_eotf_lut(priv, NULL);
+		meson_viu_set_eotf_matrix(priv, NULL);
+		meson_viu_set_oetf_lut(priv, NULL);
 		meson_viu_load_matrix(priv);
+	}
 
 	/* Initialize OSD1 fifo control register */
 	reg = BIT(0) |	/* Urgent DDR request priority */
@@ -361,7 +598,7 @@ void meson_viu_init(struct meson_drm *priv)
 	writel_bits_relaxed(0x7 << 16, 0,
 			priv->io_base + _REG(VIU_MISC_CTRL0));
 	/* afbc vd1 set=0 */
-	writel_bits_relaxed(BIT(20), 0,
+	writel_bits_relaxed(VIU_CTRL0_AFBC_TO_VD1, 0,
 			priv->io_base + _REG(VIU_MISC_CTRL0));
 	writel_relaxed(0, priv->io_base + _REG(AFBC_ENABLE));
 
@@ -45,6 +45,11 @@
 #define OSD_COLOR_MATRIX_16_RGB655	(0x00 << 2)
 #define OSD_COLOR_MATRIX_16_RGB565	(0x04 << 2)
 
+#define OSD_MALI_SRC_EN			BIT(30)
+#define OSD_MALI_COLOR_MODE_RGB565	(0x02 << 8)
+#define OSD_MALI_COLOR_MODE_RGBA8888	(0x05 << 8)
+#define OSD_MALI_COLOR_MODE_RGB888	(0x07 << 8)
+
 #define OSD_INTERLACE_ENABLED	BIT(1)
 #define OSD_INTERLACE_ODD	BIT(0)
 #define OSD_INTERLACE_EVEN	(0)
@@ -56,10 +61,16 @@
 #define OSD_GLOBAL_ALPHA_SHIFT	12
 
 /* OSDx_CTRL_STAT2 */
+#define OSD_DPATH_MALI_AFBCD	BIT(15)
 #define OSD_REPLACE_EN		BIT(14)
 #define OSD_REPLACE_SHIFT	6
 
 void meson_viu_reset(struct meson_drm *priv);
+void meson_viu_osd1_afbcd_setup(struct meson_drm *priv);
+void meson_viu_osd1_afbcd_disable(struct meson_drm *priv);
+void meson_viu_set_color_mgmt(struct meson_drm *priv,
+			      struct drm_crtc_state *state);
+void meson_viu_commit_color_mgmt(struct meson_drm *priv);
 void meson_viu_init(struct meson_drm *priv);
 
 #endif /* __MESON_VIU_H */
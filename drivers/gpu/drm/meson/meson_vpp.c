@@ -88,6 +88,38 @@ static const uint32_t vpp_filter_coefs_bicubic[] = {
 	0xf84848f8
 };
 
+/* Linear interpolation, used when downscaling */
+static const uint32_t vpp_filter_coefs_bilinear[] = {
+	0x00800000, 0x007e0200, 0x007c0400, 0x007a0600,
+	0x00780800, 0x00760a00, 0x00740c00, 0x00720e00,
+	0x00701000, 0x006e1200, 0x006c1400, 0x006a1600,
+	0x00681800, 0x00661a00, 0x00641c00, 0x00621e00,
+	0x00602000, 0x005e2200, 0x005c2400, 0x005a2600,
+	0x00582800, 0x00562a00, 0x00542c00, 0x00522e00,
+	0x00503000, 0x004e3200, 0x004c3400, 0x004a3600,
+	0x00483800, 0x00463a00, 0x00443c00, 0x00423e00,
+	0x00404000
+};
+
+/* Bicubic with a = -1, for large upscaling ratios */
+static const uint32_t vpp_filter_coefs_bicubic_sharp[] = {
+	0x00800000, 0xfe800200, 0xfc800400, 0xfb7f0600,
+	0xf97f0800, 0xf87e0bff, 0xf67e0dff, 0xf57d0fff,
+	0xf47c12fe, 0xf37b14fe, 0xf27a17fd, 0xf17919fd,
+	0xf0781cfc, 0xef771efc, 0xef7521fb, 0xee7423fb,
+	0xee7226fa, 0xee7029f9, 0xed6f2bf9, 0xed6d2ef8,
+	0xed6b31f7, 0xed6933f7, 0xed6736f6, 0xed6539f5,
+	0xed633bf5, 0xed613ef4, 0xee5e41f3, 0xee5c43f3,
+	0xee5a46f2, 0xef5748f2, 0xef554bf1, 0xf0524df1,
+	0xf05050f0
+};
+
+static const uint32_t *vpp_vd_filter_coefs[] = {
+	[MESON_VPP_VD_FILTER_BICUBIC] = vpp_filter_coefs_bicubic,
+	[MESON_VPP_VD_FILTER_BILINEAR] = vpp_filter_coefs_bilinear,
+	[MESON_VPP_VD_FILTER_SHARP] = vpp_filter_coefs_bicubic_sharp,
+};
+
 static void meson_vpp_write_vd_scaling_filter_coefs(struct meson_drm *priv,
 						    const unsigned int *coefs,
 						    bool is_horizontal)
@@ -101,6 +133,38 @@ static void meson_vpp_write_vd_scaling_filter_coefs(struct meson_drm *priv,
 				priv->io_base + _REG(VPP_SCALE_COEF));
 }
 
+/* Select a filter from its scaling ratio, in 4.18 fixed point */
+enum meson_vpp_vd_filter meson_vpp_vd_scaling_filter(unsigned int ratio)
+{
+	/* Downscaling */
+	if (ratio > (1 << 18))
+		return MESON_VPP_VD_FILTER_BILINEAR;
+
+	/* Upscaling by 2 or more */
+	if (ratio <= (1 << 17))
+		return MESON_VPP_VD_FILTER_SHARP;
+
+	return MESON_VPP_VD_FILTER_BICUBIC;
+}
+
+/* Must be called at vsync time, reloads the coefficients on change only */
+void meson_vpp_set_vd_scaling_filter(struct meson_drm *priv,
+				     unsigned int hsc_filter,
+				     unsigned int vsc_filter)
+{
+	if (priv->vpp.vd_vsc_filter != vsc_filter) {
+		meson_vpp_write_vd_scaling_filter_coefs(priv,
+				vpp_vd_filter_coefs[vsc_filter], false);
+		priv->vpp.vd_vsc_filter = vsc_filter;
+	}
+
+	if (priv->vpp.vd_hsc_filter != hsc_filter) {
+		meson_vpp_write_vd_scaling_filter_coefs(priv,
+				vpp_vd_filter_coefs[hsc_filter], true);
+		priv->vpp.vd_hsc_filter = hsc_filter;
+	}
+}
+
 void meson_vpp_init(struct meson_drm *priv)
 {
 	/* set dummy data default YUV black */
@@ -159,4 +223,6 @@ void meson_vpp_init(struct meson_drm *priv)
 						false);
 	meson_vpp_write_vd_scaling_filter_coefs(priv, vpp_filter_coefs_bicubic,
 						true);
+	priv->vpp.vd_vsc_filter = MESON_VPP_VD_FILTER_BICUBIC;
+	priv->vpp.vd_hsc_filter = MESON_VPP_VD_FILTER_BICUBIC;
 }
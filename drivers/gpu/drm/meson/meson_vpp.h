@@ -26,8 +26,20 @@
 /* Mux VIU/VPP to ENCP */
 #define MESON_VIU_VPP_MUX_ENCP	0xA
 
+/* VD scaler filter coefficient sets */
+enum meson_vpp_vd_filter {
+	MESON_VPP_VD_FILTER_BICUBIC = 0,
+	MESON_VPP_VD_FILTER_BILINEAR,
+	MESON_VPP_VD_FILTER_SHARP,
+};
+
 void meson_vpp_setup_mux(struct meson_drm *priv, unsigned int mux);
 
+enum meson_vpp_vd_filter meson_vpp_vd_scaling_filter(unsigned int ratio);
+void meson_vpp_set_vd_scaling_filter(struct meson_drm *priv,
+				     unsigned int hsc_filter,
+				     unsigned int vsc_filter);
+
 void meson_vpp_setup_interlace_vscaler_osd1(struct meson_drm *priv,
 					    struct drm_rect *input);
 void meson_vpp_disable_interlace_vscaler_osd1(struct meson_drm *priv);
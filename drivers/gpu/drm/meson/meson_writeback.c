@@ -0,0 +1,320 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Copyright (C) 2018 BayLibre, SAS
+ *
+ * The VIU output, after the VPP postblend, can be looped back into the
+ * VDIN1 capture block which writes it to memory. It is exposed as a
+ * writeback connector: each job captures the next frame, and completes
+ * at the following vsync.
+ */
+
+#include <linux/kernel.h>
+#include <drm/drmP.h>
+#include <drm/drm_atomic.h>
+#include <drm/drm_atomic_helper.h>
+#include <drm/drm_crtc_helper.h>
+#include <drm/drm_writeback.h>
+#include <drm/drm_gem_cma_helper.h>
+#include <drm/drm_fb_cma_helper.h>
+
+#include "meson_writeback.h"
+#include "meson_canvas.h"
+#include "meson_registers.h"
+
+#define COEFF_NORM(a) ((int)((((a) * 2048.0) + 1) / 2))
+
+/*
+ * The VPP output is YUV709 limited range, convert it to full range RGB.
+ * Rows are ordered so the 444 writer packs the pixels as RGB888.
+ */
+static const int yuv709l_to_rgb_coeff[15] = {
+	-64, -512, -512, /* pre offset */
+	COEFF_NORM(1.164384),	COEFF_NORM(2.112402),	COEFF_NORM(0.0),
+	COEFF_NORM(1.164384),	COEFF_NORM(-0.213249),	COEFF_NORM(-0.532909),
+	COEFF_NORM(1.164384),	COEFF_NORM(0.0),	COEFF_NORM(1.792741),
+	0, 0, 0, /* offset */
+};
+
+static const u32 meson_writeback_formats[] = {
+	DRM_FORMAT_NV12,
+	DRM_FORMAT_RGB888,
+};
+
+static void meson_writeback_set_matrix(struct meson_drm *priv, const int *m)
+{
+	writel(((m[0] & 0x7ff) << 16) | (m[1] & 0x7ff),
+		priv->io_base + _REG(VDIN1_MATRIX_PRE_OFFSET0_1));
+	writel(m[2] & 0x7ff,
+		priv->io_base + _REG(VDIN1_MATRIX_PRE_OFFSET2));
+	writel(((m[3] & 0x1fff) << 16) | (m[4] & 0x1fff),
+		priv->io_base + _REG(VDIN1_MATRIX_COEF00_01));
+	writel(((m[5] & 0x1fff) << 16) | (m[6] & 0x1fff),
+		priv->io_base + _REG(VDIN1_MATRIX_COEF02_10));
+	writel(((m[7] & 0x1fff) << 16) | (m[8] & 0x1fff),
+		priv->io_base + _REG(VDIN1_MATRIX_COEF11_12));
+	writel(((m[9] & 0x1fff) << 16) | (m[10] & 0x1fff),
+		priv->io_base + _REG(VDIN1_MATRIX_COEF20_21));
+	writel(m[11] & 0x1fff,
+		priv->io_base + _REG(VDIN1_MATRIX_COEF22));
+	writel(((m[12] & 0x7ff) << 16) | (m[13] & 0x7ff),
+		priv->io_base + _REG(VDIN1_MATRIX_OFFSET0_1));
+	writel(m[14] & 0x7ff,
+		priv->io_base + _REG(VDIN1_MATRIX_OFFSET2));
+}
+
+/* Program VDIN1 to capture the next frame, must be called at vsync */
+static void meson_writeback_setup(struct meson_drm *priv)
+{
+	u8 canvas_id_wb_0 = MESON_CANVAS_ID_WB_0;
+	u8 canvas_id_wb_1 = MESON_CANVAS_ID_WB_1;
+	unsigned int sel;
+	u32 wr_ctrl;
+
+	if (priv->canvas) {
+		canvas_id_wb_0 = priv->canvas_id_wb_0;
+		canvas_id_wb_1 = priv->canvas_id_wb_1;
+		meson_canvas_config(priv->canvas, canvas_id_wb_0,
+			priv->wb.addr0, priv->wb.stride0, priv->wb.height,
+			MESON_CANVAS_WRAP_NONE, MESON_CANVAS_BLKMODE_LINEAR,
+			MESON_CANVAS_ENDIAN_SWAP64);
+	} else {
+		meson_canvas_setup(priv, canvas_id_wb_0,
+			priv->wb.addr0, priv->wb.stride0, priv->wb.height,
+			MESON_CANVAS_WRAP_NONE, MESON_CANVAS_BLKMODE_LINEAR,
+			MESON_CANVAS_ENDIAN_SWAP64);
+	}
+
+	wr_ctrl = VDIN_WR_CANVAS(canvas_id_wb_0) |
+		  VDIN_WR_REQ_URGENT | VDIN_WR_REQ_EN;
+
+	if (priv->wb.rgb) {
+		meson_writeback_set_matrix(priv, yuv709l_to_rgb_coeff);
+		writel_relaxed(VDIN_MATRIX_EN,
+			       priv->io_base + _REG(VDIN1_MATRIX_CTRL));
+		wr_ctrl |= VDIN_WR_FMT_444;
+	} else {
+		if (priv->canvas)
+			meson_canvas_config(priv->canvas, canvas_id_wb_1,
+				priv->wb.addr1, priv->wb.stride1,
+				priv->wb.height / 2, MESON_CANVAS_WRAP_NONE,
+				MESON_CANVAS_BLKMODE_LINEAR,
+				MESON_CANVAS_ENDIAN_SWAP64);
+		else
+			meson_canvas_setup(priv, canvas_id_wb_1,
+				priv->wb.addr1, priv->wb.stride1,
+				priv->wb.height / 2, MESON_CANVAS_WRAP_NONE,
+				MESON_CANVAS_BLKMODE_LINEAR,
+				MESON_CANVAS_ENDIAN_SWAP64);
+
+		writel_relaxed(0, priv->io_base + _REG(VDIN1_MATRIX_CTRL));
+		writel_relaxed(VDIN_WR_CHROMA_CANVAS(canvas_id_wb_1),
+			       priv->io_base + _REG(VDIN1_WR_CTRL2));
+		/* NV12 has Cb first, the writer defaults to NV21 */
+		wr_ctrl |= VDIN_WR_FMT_420 | VDIN_WR_SWAP_CBCR;
+	}
+
+	/* Sample the encoder driving the VIU1 output, ENCI or ENCP */
+	sel = readl_relaxed(priv->io_base + _REG(VPU_VIU_VENC_MUX_CTRL)) &
+	      VIU1_SEL_VENC_MASK;
+	writel_bits_relaxed(0xff << VIU_VDIN_SEL_DATA_SHIFT,
+			    (sel << VIU_VDIN_SEL_DATA_SHIFT) |
+			    (sel << VIU_VDIN_SEL_HS_SHIFT),
+			    priv->io_base + _REG(VPU_VIU_VENC_MUX_CTRL));
+
+	writel_relaxed(priv->wb.width - 1,
+		       priv->io_base + _REG(VDIN1_INTF_WIDTHM1));
+	writel_relaxed(priv->wb.width - 1,
+		       priv->io_base + _REG(VDIN1_WR_H_START_END));
+	writel_relaxed(priv->wb.height - 1,
+		       priv->io_base + _REG(VDIN1_WR_V_START_END));
+	writel_relaxed(wr_ctrl, priv->io_base + _REG(VDIN1_WR_CTRL));
+
+	writel_relaxed(VDIN_SEL_VIU | VDIN_COMMON_INPUT_EN,
+		       priv->io_base + _REG(VDIN1_COM_CTRL0));
+}
+
+static void meson_writeback_stop(struct meson_drm *priv)
+{
+	writel_bits_relaxed(VDIN_WR_REQ_EN, 0,
+			    priv->io_base + _REG(VDIN1_WR_CTRL));
+	writel_relaxed(0, priv->io_base + _REG(VDIN1_COM_CTRL0));
+}
+
+/*
+ * Called at vsync: the frame captured since the previous vsync is now
+ * complete, and the next queued job, if any, starts with this frame.
+ */
+void meson_writeback_irq(struct meson_drm *priv)
+{
+	unsigned long flags;
+
+	if (!priv->writeback)
+		return;
+
+	spin_lock_irqsave(&priv->drm->event_lock, flags);
+
+	if (priv->wb.active) {
+		drm_writeback_signal_completion(priv->writeback, 0);
+		priv->wb.active = false;
+	}
+
+	if (priv->wb.commit) {
+		meson_writeback_setup(priv);
+		priv->wb.active = true;
+		priv->wb.commit = false;
+	} else {
+		meson_writeback_stop(priv);
+	}
+
+	spin_unlock_irqrestore(&priv->drm->event_lock, flags);
+}
+
+/* Called with the event_lock held, along with the planes commit flags */
+void meson_writeback_atomic_flush(struct meson_drm *priv,
+				  struct drm_atomic_state *state)
+{
+	struct drm_connector_state *conn_state;
+	struct drm_writeback_job *job;
+	struct drm_framebuffer *fb;
+	struct drm_gem_cma_object *gem;
+
+	if (!priv->writeback)
+		return;
+
+	conn_state = drm_atomic_get_new_connector_state(state,
+						&priv->writeback->base);
+	if (!conn_state || !conn_state->writeback_job ||
+	    !conn_state->writeback_job->fb)
+		return;
+
+	job = conn_state->writeback_job;
+	fb = job->fb;
+
+	gem = drm_fb_cma_get_gem_obj(fb, 0);
+	priv->wb.addr0 = gem->paddr + fb->offsets[0];
+	priv->wb.stride0 = fb->pitches[0];
+
+	if (fb->format->num_planes > 1) {
+		gem = drm_fb_cma_get_gem_obj(fb, 1);
+		priv->wb.addr1 = gem->paddr + fb->offsets[1];
+		priv->wb.stride1 = fb->pitches[1];
+	}
+
+	priv->wb.rgb = fb->format->format == DRM_FORMAT_RGB888;
+	priv->wb.width = fb->width;
+	priv->wb.height = fb->height;
+
+	drm_writeback_queue_job(priv->writeback, job);
+	conn_state->writeback_job = NULL;
+
+	/* A job armed before the previous vsync is still to be started */
+	WARN_ON(priv->wb.commit);
+	priv->wb.commit = true;
+}
+
+/* No vsync will come anymore, cancel the pending jobs */
+void meson_writeback_disable(struct meson_drm *priv)
+{
+	unsigned long flags;
+
+	if (!priv->writeback)
+		return;
+
+	spin_lock_irqsave(&priv->drm->event_lock, flags);
+
+	meson_writeback_stop(priv);
+
+	if (priv->wb.active)
+		drm_writeback_signal_completion(priv->writeback, -ECANCELED);
+	if (priv->wb.commit)
+		drm_writeback_signal_completion(priv->writeback, -ECANCELED);
+	priv->wb.active = false;
+	priv->wb.commit = false;
+
+	spin_unlock_irqrestore(&priv->drm->event_lock, flags);
+}
+
+static int meson_writeback_encoder_atomic_check(struct drm_encoder *encoder,
+					struct drm_crtc_state *crtc_state,
+					struct drm_connector_state *conn_state)
+{
+	struct drm_display_mode *mode = &crtc_state->mode;
+	struct drm_framebuffer *fb;
+
+	if (!conn_state->writeback_job || !conn_state->writeback_job->fb)
+		return 0;
+
+	fb = conn_state->writeback_job->fb;
+
+	/* VDIN1 captures the whole output, without scaling */
+	if (fb->width != mode->hdisplay || fb->height != mode->vdisplay) {
+		DRM_DEBUG_KMS("Invalid writeback size %dx%d\n",
+			      fb->width, fb->height);
+		return -EINVAL;
+	}
+
+	/* Each field would be captured as a frame */
+	if (mode->flags & DRM_MODE_FLAG_INTERLACE)
+		return -EINVAL;
+
+	return 0;
+}
+
+static const struct drm_encoder_helper_funcs meson_writeback_encoder_funcs = {
+	.atomic_check	= meson_writeback_encoder_atomic_check,
+};
+
+static int meson_writeback_get_modes(struct drm_connector *connector)
+{
+	struct drm_device *dev = connector->dev;
+
+	return drm_add_modes_noedid(connector, dev->mode_config.max_width,
+				    dev->mode_config.max_height);
+}
+
+static const struct drm_connector_helper_funcs meson_writeback_helper_funcs = {
+	.get_modes	= meson_writeback_get_modes,
+};
+
+static enum drm_connector_status
+meson_writeback_detect(struct drm_connector *connector, bool force)
+{
+	return connector_status_connected;
+}
+
+static const struct drm_connector_funcs meson_writeback_connector_funcs = {
+	.reset			= drm_atomic_helper_connector_reset,
+	.detect			= meson_writeback_detect,
+	.fill_modes		= drm_helper_probe_single_connector_modes,
+	.destroy		= drm_connector_cleanup,
+	.atomic_duplicate_state	= drm_atomic_helper_connector_duplicate_state,
+	.atomic_destroy_state	= drm_atomic_helper_connector_destroy_state,
+};
+
+int meson_writeback_create(struct meson_drm *priv)
+{
+	struct drm_writeback_connector *wb;
+	int ret;
+
+	wb = devm_kzalloc(priv->drm->dev, sizeof(*wb), GFP_KERNEL);
+	if (!wb)
+		return -ENOMEM;
+
+	wb->encoder.possible_crtcs = drm_crtc_mask(priv->crtc);
+
+	drm_connector_helper_add(&wb->base, &meson_writeback_helper_funcs);
+
+	ret = drm_writeback_connector_init(priv->drm, wb,
+					   &meson_writeback_connector_funcs,
+					   &meson_writeback_encoder_funcs,
+					   meson_writeback_formats,
+					   ARRAY_SIZE(meson_writeback_formats));
+	if (ret) {
+		dev_err(priv->drm->dev, "Failed to init writeback connector\n");
+		return ret;
+	}
+
+	priv->writeback = wb;
+
+	return 0;
+}
@@ -0,0 +1,17 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Copyright (C) 2018 BayLibre, SAS
+ */
+
+#ifndef __MESON_WRITEBACK_H
+#define __MESON_WRITEBACK_H
+
+#include "meson_drv.h"
+
+int meson_writeback_create(struct meson_drm *priv);
+void meson_writeback_atomic_flush(struct meson_drm *priv,
+				  struct drm_atomic_state *state);
+void meson_writeback_irq(struct meson_drm *priv);
+void meson_writeback_disable(struct meson_drm *priv);
+
+#endif /* __MESON_WRITEBACK_H */
@@ -19,9 +19,22 @@
 #include <linux/of_device.h>
 #include <linux/platform_device.h>
 #include <linux/scpi_protocol.h>
+#include <linux/seqlock.h>
 #include <linux/slab.h>
 #include <linux/sysfs.h>
 #include <linux/thermal.h>
+#include <linux/wait.h>
+#include <linux/workqueue.h>
+
+static unsigned int cache_ms = 100;
+module_param(cache_ms, uint, 0644);
+MODULE_PARM_DESC(cache_ms,
+		 "Max age of a cached sensor reading in ms (0: no caching)");
+
+static unsigned int refresh_ms;
+module_param(refresh_ms, uint, 0444);
+MODULE_PARM_DESC(refresh_ms,
+		 "Background refresh period of the readings in ms (0: off)");
 
 struct sensor_data {
 	unsigned int scale;
@@ -30,6 +43,13 @@ struct sensor_data {
 	struct device_attribute dev_attr_label;
 	char input[20];
 	char label[20];
+	/* last raw reading, read locklessly */
+	seqlock_t lock;
+	u64 value;
+	unsigned long stamp;
+	bool valid;
+	atomic_t *refreshing;
+	wait_queue_head_t *refresh_wait;
 };
 
 struct scpi_thermal_zone {
@@ -40,6 +60,10 @@ struct scpi_thermal_zone {
 struct scpi_sensors {
 	struct scpi_ops *scpi_ops;
 	struct sensor_data *data;
+	unsigned int nr_sensors;
+	struct delayed_work refresh_work;
+	atomic_t refreshing;
+	wait_queue_head_t refresh_wait;
 	struct list_head thermal_zones;
 	struct attribute **attrs;
 	struct attribute_group group;
@@ -70,16 +94,116 @@ static void scpi_scale_reading(u64 *value, struct sensor_data *sensor)
 	}
 }
 
+static void scpi_sensor_update(struct sensor_data *sensor, u64 value)
+{
+	unsigned long flags;
+
+	write_seqlock_irqsave(&sensor->lock, flags);
+	sensor->value = value;
+	sensor->stamp = jiffies;
+	sensor->valid = true;
+	write_sequnlock_irqrestore(&sensor->lock, flags);
+}
+
+/*
+ * Serve the reading from the cache while it is younger than cache_ms,
+ * and only ask the SCP for a new one once it is stale.
+ */
+static int scpi_sensor_get_value(struct scpi_sensors *scpi_sensors,
+				 struct sensor_data *sensor, u64 *value)
+{
+	unsigned long max_age = msecs_to_jiffies(READ_ONCE(cache_ms));
+	unsigned long stamp;
+	unsigned int seq;
+	bool valid;
+	u64 val;
+	int ret;
+
+	if (max_age) {
+		do {
+			seq = read_seqbegin(&sensor->lock);
+			val = sensor->value;
+			stamp = sensor->stamp;
+			valid = sensor->valid;
+		} while (read_seqretry(&sensor->lock, seq));
+
+		if (valid && time_before(jiffies, stamp + max_age)) {
+			*value = val;
+			return 0;
+		}
+	}
+
+	ret = scpi_sensors->scpi_ops->sensor_get_value(sensor->info.sensor_id,
+						       &val);
+	if (ret)
+		return ret;
+
+	scpi_sensor_update(sensor, val);
+	*value = val;
+
+	return 0;
+}
+
+static void scpi_sensor_refresh_done(void *data, int ret, u64 value)
+{
+	struct sensor_data *sensor = data;
+
+	if (!ret)
+		scpi_sensor_update(sensor, value);
+
+	if (atomic_dec_and_test(sensor->refreshing))
+		wake_up(sensor->refresh_wait);
+}
+
+static void scpi_sensor_refresh(struct work_struct *work)
+{
+	struct scpi_sensors *scpi_sensors =
+		container_of(to_delayed_work(work), struct scpi_sensors,
+			     refresh_work);
+	struct scpi_ops *scpi_ops = scpi_sensors->scpi_ops;
+	unsigned int i;
+
+	/* Skip a round while the SCP has not answered the previous one */
+	if (atomic_read(&scpi_sensors->refreshing))
+		goto out;
+
+	for (i = 0; i < scpi_sensors->nr_sensors; i++) {
+		struct sensor_data *sensor = &scpi_sensors->data[i];
+
+		atomic_inc(&scpi_sensors->refreshing);
+		if (scpi_ops->sensor_get_value_async(sensor->info.sensor_id,
+						     scpi_sensor_refresh_done,
+						     sensor))
+			atomic_dec(&scpi_sensors->refreshing);
+	}
+
+out:
+
+	schedule_delayed_work(&scpi_sensors->refresh_work,
+			      msecs_to_jiffies(refresh_ms));
+}
+
+static void scpi_sensor_refresh_stop(void *data)
+{
+	struct scpi_sensors *scpi_sensors = data;
+
+	cancel_delayed_work_sync(&scpi_sensors->refresh_work);
+
+	/* The replies of the last round still point to the sensors */
+	wait_event_timeout(scpi_sensors->refresh_wait,
+			   !atomic_read(&scpi_sensors->refreshing),
+			   msecs_to_jiffies(100));
+}
+
 static int scpi_read_temp(void *dev, int *temp)
 {
 	struct scpi_thermal_zone *zone = dev;
 	struct scpi_sensors *scpi_sensors = zone->scpi_sensors;
-	struct scpi_ops *scpi_ops = scpi_sensors->scpi_ops;
 	struct sensor_data *sensor = &scpi_sensors->data[zone->sensor_id];
 	u64 value;
 	int ret;
 
-	ret = scpi_ops->sensor_get_value(sensor->info.sensor_id, &value);
+	ret = scpi_sensor_get_value(scpi_sensors, sensor, &value);
 	if (ret)
 		return ret;
 
@@ -94,14 +218,13 @@ static ssize_t
 scpi_show_sensor(struct device *dev, struct device_attribute *attr, char *buf)
 {
 	struct scpi_sensors *scpi_sensors = dev_get_drvdata(dev);
-	struct scpi_ops *scpi_ops = scpi_sensors->scpi_ops;
 	struct sensor_data *sensor;
 	u64 value;
 	int ret;
 
 	sensor = container_of(attr, struct sensor_data, dev_attr_input);
 
-	ret = scpi_ops->sensor_get_value(sensor->info.sensor_id, &value);
+	ret = scpi_sensor_get_value(scpi_sensors, sensor, &value);
 	if (ret)
 		return ret;
 
@@ -226,6 +349,10 @@ static int scpi_hwmon_probe(struct platform_device *pdev)
 
 		sensor->scale = scale[sensor->info.class];
 
+		seqlock_init(&sensor->lock);
+		sensor->refreshing = &scpi_sensors->refreshing;
+		sensor->refresh_wait = &scpi_sensors->refresh_wait;
+
 		sensor->dev_attr_input.attr.mode = S_IRUGO;
 		sensor->dev_attr_input.show = scpi_show_sensor;
 		sensor->dev_attr_input.attr.name = sensor->input;
@@ -242,9 +369,22 @@ static int scpi_hwmon_probe(struct platform_device *pdev)
 		idx++;
 	}
 
+	scpi_sensors->nr_sensors = idx;
 	scpi_sensors->group.attrs = scpi_sensors->attrs;
 	scpi_sensors->groups[0] = &scpi_sensors->group;
 
+	INIT_DELAYED_WORK(&scpi_sensors->refresh_work, scpi_sensor_refresh);
+	atomic_set(&scpi_sensors->refreshing, 0);
+	init_waitqueue_head(&scpi_sensors->refresh_wait);
+	if (refresh_ms && scpi_ops->sensor_get_value_async) {
+		ret = devm_add_action(dev, scpi_sensor_refresh_stop,
+				      scpi_sensors);
+		if (ret)
+			return ret;
+
+		schedule_delayed_work(&scpi_sensors->refresh_work, 0);
+	}
+
 	platform_set_drvdata(pdev, scpi_sensors);
 
 	hwdev = devm_hwmon_device_register_with_groups(dev,
@@ -13,7 +13,9 @@
 #include <linux/i2c.h>
 #include <linux/interrupt.h>
 #include <linux/io.h>
+#include <linux/iopoll.h>
 #include <linux/kernel.h>
+#include <linux/lat_hist.h>
 #include <linux/module.h>
 #include <linux/of.h>
 #include <linux/of_device.h>
@@ -69,12 +71,16 @@ struct meson_i2c_data {
  * @dev:	Pointer to device structure
  * @regs:	Base address of the device memory mapped registers
  * @clk:	Pointer to clock structure
+ * @msgs:	Messages of the current transfer
+ * @num_msgs:	Number of messages of the current transfer
+ * @msg_idx:	Index of the current message
  * @msg:	Pointer to the current I2C message
  * @state:	Current state in the driver state machine
  * @last:	Flag set for the last message in the transfer
  * @count:	Number of bytes to be sent/received in current transfer
  * @pos:	Current position in the send/receive buffer
  * @error:	Flag set when an error is received
+ * @atomic:	Flag set when the transfer is polled, the irq handler backs off
  * @lock:	To avoid race conditions between irq handler and xfer code
  * @done:	Completion used to wait for transfer termination
  * @tokens:	Sequence of tokens to be written to the device
@@ -87,12 +93,16 @@ struct meson_i2c {
 	void __iomem		*regs;
 	struct clk		*clk;
 
+	struct i2c_msg		*msgs;
+	int			num_msgs;
+	int			msg_idx;
 	struct i2c_msg		*msg;
 	int			state;
 	bool			last;
 	int			count;
 	int			pos;
 	int			error;
+	bool			atomic;
 
 	spinlock_t		lock;
 	struct completion	done;
@@ -100,6 +110,9 @@ struct meson_i2c {
 	int			num_tokens;
 
 	const struct meson_i2c_data *data;
+
+	struct lat_hist		*irq_hist;
+	struct lat_hist		*xfer_hist;
 };
 
 static void meson_i2c_set_mask(struct meson_i2c *i2c, int reg, u32 mask,
@@ -216,12 +229,45 @@ static void meson_i2c_prepare_xfer(struct meson_i2c *i2c)
 	writel(i2c->tokens[1], i2c->regs + REG_TOK_LIST1);
 }
 
-static irqreturn_t meson_i2c_irq(int irqno, void *dev_id)
+static void meson_i2c_do_start(struct meson_i2c *i2c, struct i2c_msg *msg)
 {
-	struct meson_i2c *i2c = dev_id;
-	unsigned int ctrl;
+	int token;
 
-	spin_lock(&i2c->lock);
+	token = (msg->flags & I2C_M_RD) ? TOKEN_SLAVE_ADDR_READ :
+		TOKEN_SLAVE_ADDR_WRITE;
+
+	writel(msg->addr << 1, i2c->regs + REG_SLAVE_ADDR);
+	meson_i2c_add_token(i2c, TOKEN_START);
+	meson_i2c_add_token(i2c, token);
+}
+
+static void meson_i2c_start_msg(struct meson_i2c *i2c)
+{
+	struct i2c_msg *msg = &i2c->msgs[i2c->msg_idx];
+	unsigned long flags;
+
+	i2c->msg = msg;
+	i2c->last = i2c->msg_idx == i2c->num_msgs - 1;
+	i2c->pos = 0;
+	i2c->count = 0;
+
+	flags = (msg->flags & I2C_M_IGNORE_NAK) ? REG_CTRL_ACK_IGNORE : 0;
+	meson_i2c_set_mask(i2c, REG_CTRL, REG_CTRL_ACK_IGNORE, flags);
+
+	if (!(msg->flags & I2C_M_NOSTART))
+		meson_i2c_do_start(i2c, msg);
+
+	i2c->state = (msg->flags & I2C_M_RD) ? STATE_READ : STATE_WRITE;
+	meson_i2c_prepare_xfer(i2c);
+}
+
+/*
+ * Handle the end of a token list and program the next one, chaining the
+ * messages of the transfer. Returns true once the whole transfer is over.
+ */
+static bool meson_i2c_process(struct meson_i2c *i2c)
+{
+	unsigned int ctrl;
 
 	meson_i2c_reset_tokens(i2c);
 	meson_i2c_set_mask(i2c, REG_CTRL, REG_CTRL_START, 0);
@@ -230,11 +276,6 @@ static irqreturn_t meson_i2c_irq(int irqno, void *dev_id)
 	dev_dbg(i2c->dev, "irq: state %d, pos %d, count %d, ctrl %08x\n",
 		i2c->state, i2c->pos, i2c->count, ctrl);
 
-	if (i2c->state == STATE_IDLE) {
-		spin_unlock(&i2c->lock);
-		return IRQ_NONE;
-	}
-
 	if (ctrl & REG_CTRL_ERROR) {
 		/*
 		 * The bit is set when the IGNORE_NAK bit is cleared
@@ -245,8 +286,7 @@ static irqreturn_t meson_i2c_irq(int irqno, void *dev_id)
 		dev_dbg(i2c->dev, "error bit set\n");
 		i2c->error = -ENXIO;
 		i2c->state = STATE_IDLE;
-		complete(&i2c->done);
-		goto out;
+		return true;
 	}
 
 	if (i2c->state == STATE_READ && i2c->count)
@@ -255,61 +295,102 @@ static irqreturn_t meson_i2c_irq(int irqno, void *dev_id)
 	i2c->pos += i2c->count;
 
 	if (i2c->pos >= i2c->msg->len) {
-		i2c->state = STATE_IDLE;
-		complete(&i2c->done);
-		goto out;
+		if (++i2c->msg_idx >= i2c->num_msgs) {
+			i2c->state = STATE_IDLE;
+			return true;
+		}
+
+		/* Go on with the next message, no need to wake up the caller */
+		meson_i2c_start_msg(i2c);
+	} else {
+		meson_i2c_prepare_xfer(i2c);
 	}
 
 	/* Restart the processing */
-	meson_i2c_prepare_xfer(i2c);
 	meson_i2c_set_mask(i2c, REG_CTRL, REG_CTRL_START, REG_CTRL_START);
-out:
+
+	return false;
+}
+
+static irqreturn_t meson_i2c_irq(int irqno, void *dev_id)
+{
+	struct meson_i2c *i2c = dev_id;
+	u64 start = lat_hist_now();
+
+	spin_lock(&i2c->lock);
+
+	if (i2c->state == STATE_IDLE || i2c->atomic) {
+		spin_unlock(&i2c->lock);
+		return IRQ_NONE;
+	}
+
+	if (meson_i2c_process(i2c))
+		complete(&i2c->done);
+
 	spin_unlock(&i2c->lock);
 
+	lat_hist_record_since(i2c->irq_hist, start);
+
 	return IRQ_HANDLED;
 }
 
-static void meson_i2c_do_start(struct meson_i2c *i2c, struct i2c_msg *msg)
+/*
+ * Transfers from atomic context can't wait for the interrupt, poll for the
+ * end of each token list instead.
+ */
+static int meson_i2c_xfer_polled(struct meson_i2c *i2c)
 {
-	int token;
+	unsigned int ctrl;
+	int ret;
 
-	token = (msg->flags & I2C_M_RD) ? TOKEN_SLAVE_ADDR_READ :
-		TOKEN_SLAVE_ADDR_WRITE;
+	do {
+		ret = readl_poll_timeout_atomic(i2c->regs + REG_CTRL, ctrl,
+						!(ctrl & REG_CTRL_STATUS), 1,
+						I2C_TIMEOUT_MS * USEC_PER_MSEC);
+		if (ret)
+			return ret;
+	} while (!meson_i2c_process(i2c));
 
-	writel(msg->addr << 1, i2c->regs + REG_SLAVE_ADDR);
-	meson_i2c_add_token(i2c, TOKEN_START);
-	meson_i2c_add_token(i2c, token);
+	return 0;
 }
 
-static int meson_i2c_xfer_msg(struct meson_i2c *i2c, struct i2c_msg *msg,
-			      int last)
+static int meson_i2c_xfer(struct i2c_adapter *adap, struct i2c_msg *msgs,
+			  int num)
 {
+	struct meson_i2c *i2c = adap->algo_data;
 	unsigned long time_left, flags;
+	u64 start = lat_hist_now();
 	int ret = 0;
 
-	i2c->msg = msg;
-	i2c->last = last;
-	i2c->pos = 0;
-	i2c->count = 0;
-	i2c->error = 0;
-
-	meson_i2c_reset_tokens(i2c);
+	clk_enable(i2c->clk);
 
-	flags = (msg->flags & I2C_M_IGNORE_NAK) ? REG_CTRL_ACK_IGNORE : 0;
-	meson_i2c_set_mask(i2c, REG_CTRL, REG_CTRL_ACK_IGNORE, flags);
+	spin_lock_irqsave(&i2c->lock, flags);
 
-	if (!(msg->flags & I2C_M_NOSTART))
-		meson_i2c_do_start(i2c, msg);
+	i2c->msgs = msgs;
+	i2c->num_msgs = num;
+	i2c->msg_idx = 0;
+	i2c->error = 0;
+	i2c->atomic = in_atomic() || irqs_disabled();
 
-	i2c->state = (msg->flags & I2C_M_RD) ? STATE_READ : STATE_WRITE;
-	meson_i2c_prepare_xfer(i2c);
+	meson_i2c_reset_tokens(i2c);
+	meson_i2c_start_msg(i2c);
 	reinit_completion(&i2c->done);
 
 	/* Start the transfer */
 	meson_i2c_set_mask(i2c, REG_CTRL, REG_CTRL_START, REG_CTRL_START);
 
-	time_left = msecs_to_jiffies(I2C_TIMEOUT_MS);
-	time_left = wait_for_completion_timeout(&i2c->done, time_left);
+	spin_unlock_irqrestore(&i2c->lock, flags);
+
+	if (i2c->atomic) {
+		ret = meson_i2c_xfer_polled(i2c);
+	} else {
+		time_left = msecs_to_jiffies(I2C_TIMEOUT_MS * num);
+		time_left = wait_for_completion_timeout(&i2c->done, time_left);
+		if (!time_left)
+			ret = -ETIMEDOUT;
+		else
+			lat_hist_record_since(i2c->xfer_hist, start);
+	}
 
 	/*
 	 * Protect access to i2c struct and registers from interrupt
@@ -321,36 +402,19 @@ static int meson_i2c_xfer_msg(struct meson_i2c *i2c, struct i2c_msg *msg,
 	/* Abort any active operation */
 	meson_i2c_set_mask(i2c, REG_CTRL, REG_CTRL_START, 0);
 
-	if (!time_left) {
+	if (ret)
 		i2c->state = STATE_IDLE;
-		ret = -ETIMEDOUT;
-	}
 
 	if (i2c->error)
 		ret = i2c->error;
 
-	spin_unlock_irqrestore(&i2c->lock, flags);
+	i2c->atomic = false;
 
-	return ret;
-}
-
-static int meson_i2c_xfer(struct i2c_adapter *adap, struct i2c_msg *msgs,
-			  int num)
-{
-	struct meson_i2c *i2c = adap->algo_data;
-	int i, ret = 0;
-
-	clk_enable(i2c->clk);
-
-	for (i = 0; i < num; i++) {
-		ret = meson_i2c_xfer_msg(i2c, msgs + i, i == num - 1);
-		if (ret)
-			break;
-	}
+	spin_unlock_irqrestore(&i2c->lock, flags);
 
 	clk_disable(i2c->clk);
 
-	return ret ?: i;
+	return ret ?: num;
 }
 
 static u32 meson_i2c_func(struct i2c_adapter *adap)
@@ -403,6 +467,9 @@ static int meson_i2c_probe(struct platform_device *pdev)
 		return irq;
 	}
 
+	i2c->irq_hist = devm_lat_hist_add(&pdev->dev, "irq");
+	i2c->xfer_hist = devm_lat_hist_add(&pdev->dev, "transfer");
+
 	ret = devm_request_irq(&pdev->dev, irq, meson_i2c_irq, 0, NULL, i2c);
 	if (ret < 0) {
 		dev_err(&pdev->dev, "can't request IRQ\n");
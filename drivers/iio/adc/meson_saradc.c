@@ -16,7 +16,9 @@
 #include <linux/clk-provider.h>
 #include <linux/delay.h>
 #include <linux/io.h>
+#include <linux/iio/buffer.h>
 #include <linux/iio/iio.h>
+#include <linux/iio/kfifo_buf.h>
 #include <linux/module.h>
 #include <linux/interrupt.h>
 #include <linux/of.h>
@@ -165,6 +167,9 @@
 	#define MESON_SAR_ADC_REG13_12BIT_CALIBRATION_MASK	GENMASK(13, 8)
 
 #define MESON_SAR_ADC_MAX_FIFO_SIZE				32
+/* FIFO level raising the interrupt in buffered mode, half of the FIFO */
+#define MESON_SAR_ADC_BUFFER_FIFO_THRESHOLD			16
+#define MESON_SAR_ADC_NUM_CHANNELS				8
 #define MESON_SAR_ADC_TIMEOUT					100 /* ms */
 /* for use with IIO_VAL_INT_PLUS_MICRO */
 #define MILLION							1000000
@@ -178,6 +183,13 @@
 	.info_mask_shared_by_type = BIT(IIO_CHAN_INFO_SCALE) |		\
 				BIT(IIO_CHAN_INFO_CALIBBIAS) |		\
 				BIT(IIO_CHAN_INFO_CALIBSCALE),		\
+	.scan_index = _chan,						\
+	.scan_type = {							\
+		.sign = 'u',						\
+		.realbits = 12,						\
+		.storagebits = 16,					\
+		.endianness = IIO_CPU,					\
+	},								\
 	.datasheet_name = "SAR_ADC_CH"#_chan,				\
 }
 
@@ -246,6 +258,14 @@ struct meson_sar_adc_priv {
 	struct completion			done;
 	int					calibbias;
 	int					calibscale;
+	/* buffered mode */
+	unsigned int				scan_chans;
+	unsigned int				scan_pos;
+	u8				scan_ids[MESON_SAR_ADC_NUM_CHANNELS];
+	s64					scan_last_ts;
+	/* samples of a scan followed by the timestamp */
+	u16				scan_buf[MESON_SAR_ADC_NUM_CHANNELS + 4]
+						__aligned(8);
 };
 
 static const struct regmap_config meson_sar_adc_regmap_config_gxbb = {
@@ -444,13 +464,11 @@ static void meson_sar_adc_stop_sample_engine(struct iio_dev *indio_dev)
 			   MESON_SAR_ADC_REG0_SAMPLE_ENGINE_ENABLE, 0);
 }
 
-static int meson_sar_adc_lock(struct iio_dev *indio_dev)
+static int meson_sar_adc_bl30_lock(struct iio_dev *indio_dev)
 {
 	struct meson_sar_adc_priv *priv = iio_priv(indio_dev);
 	int val, timeout = 10000;
 
-	mutex_lock(&indio_dev->mlock);
-
 	if (priv->data->param->has_bl30_integration) {
 		/* prevent BL30 from using the SAR ADC while we are using it */
 		regmap_update_bits(priv->regmap, MESON_SAR_ADC_DELAY,
@@ -466,16 +484,14 @@ static int meson_sar_adc_lock(struct iio_dev *indio_dev)
 			regmap_read(priv->regmap, MESON_SAR_ADC_DELAY, &val);
 		} while (val & MESON_SAR_ADC_DELAY_BL30_BUSY && timeout--);
 
-		if (timeout < 0) {
-			mutex_unlock(&indio_dev->mlock);
+		if (timeout < 0)
 			return -ETIMEDOUT;
-		}
 	}
 
 	return 0;
 }
 
-static void meson_sar_adc_unlock(struct iio_dev *indio_dev)
+static void meson_sar_adc_bl30_unlock(struct iio_dev *indio_dev)
 {
 	struct meson_sar_adc_priv *priv = iio_priv(indio_dev);
 
@@ -483,6 +499,24 @@ static void meson_sar_adc_unlock(struct iio_dev *indio_dev)
 		/* allow BL30 to use the SAR ADC again */
 		regmap_update_bits(priv->regmap, MESON_SAR_ADC_DELAY,
 				MESON_SAR_ADC_DELAY_KERNEL_BUSY, 0);
+}
+
+static int meson_sar_adc_lock(struct iio_dev *indio_dev)
+{
+	int ret;
+
+	mutex_lock(&indio_dev->mlock);
+
+	ret = meson_sar_adc_bl30_lock(indio_dev);
+	if (ret)
+		mutex_unlock(&indio_dev->mlock);
+
+	return ret;
+}
+
+static void meson_sar_adc_unlock(struct iio_dev *indio_dev)
+{
+	meson_sar_adc_bl30_unlock(indio_dev);
 
 	mutex_unlock(&indio_dev->mlock);
 }
@@ -508,9 +542,18 @@ static int meson_sar_adc_get_sample(struct iio_dev *indio_dev,
 {
 	int ret;
 
-	ret = meson_sar_adc_lock(indio_dev);
-	if (ret)
+	/* the sample engine is owned by the buffer while it is enabled */
+	mutex_lock(&indio_dev->mlock);
+	if (iio_buffer_enabled(indio_dev)) {
+		mutex_unlock(&indio_dev->mlock);
+		return -EBUSY;
+	}
+
+	ret = meson_sar_adc_bl30_lock(indio_dev);
+	if (ret) {
+		mutex_unlock(&indio_dev->mlock);
 		return ret;
+	}
 
 	/* clear the FIFO to make sure we're not reading old values */
 	meson_sar_adc_clear_fifo(indio_dev);
@@ -824,6 +867,53 @@ static int meson_sar_adc_hw_disable(struct iio_dev *indio_dev)
 	return 0;
 }
 
+static void meson_sar_adc_buffer_drain(struct iio_dev *indio_dev,
+				       unsigned int cnt)
+{
+	struct meson_sar_adc_priv *priv = iio_priv(indio_dev);
+	unsigned int i, scans, scan = 0;
+	s64 now, period = 0;
+	int regval, val;
+
+	/*
+	 * All the scans of the batch are sampled at the same rate, spread
+	 * their timestamps over the time elapsed since the previous batch.
+	 */
+	now = iio_get_time_ns(indio_dev);
+	scans = max(cnt / priv->scan_chans, 1U);
+	if (priv->scan_last_ts)
+		period = div_s64(now - priv->scan_last_ts, scans);
+	priv->scan_last_ts = now;
+
+	for (i = 0; i < cnt; i++) {
+		regmap_read(priv->regmap, MESON_SAR_ADC_FIFO_RD, &regval);
+
+		if (FIELD_GET(MESON_SAR_ADC_FIFO_RD_CHAN_ID_MASK, regval) !=
+		    priv->scan_ids[priv->scan_pos]) {
+			/* out of sync, drop the partial scan */
+			dev_warn_ratelimited(indio_dev->dev.parent,
+					     "unexpected FIFO entry %08x\n",
+					     regval);
+			priv->scan_pos = 0;
+			continue;
+		}
+
+		val = FIELD_GET(MESON_SAR_ADC_FIFO_RD_SAMPLE_VALUE_MASK,
+				regval);
+		val &= GENMASK(priv->data->param->resolution - 1, 0);
+		priv->scan_buf[priv->scan_pos++] =
+			meson_sar_adc_calib_val(indio_dev, val);
+
+		if (priv->scan_pos < priv->scan_chans)
+			continue;
+
+		priv->scan_pos = 0;
+		scan++;
+		iio_push_to_buffers_with_timestamp(indio_dev, priv->scan_buf,
+				now - (s64)(scans - scan) * period);
+	}
+}
+
 static irqreturn_t meson_sar_adc_irq(int irq, void *data)
 {
 	struct iio_dev *indio_dev = data;
@@ -838,11 +928,105 @@ static irqreturn_t meson_sar_adc_irq(int irq, void *data)
 	if (cnt < threshold)
 		return IRQ_NONE;
 
-	complete(&priv->done);
+	if (iio_buffer_enabled(indio_dev))
+		meson_sar_adc_buffer_drain(indio_dev, cnt);
+	else
+		complete(&priv->done);
 
 	return IRQ_HANDLED;
 }
 
+static int meson_sar_adc_buffer_postenable(struct iio_dev *indio_dev)
+{
+	struct meson_sar_adc_priv *priv = iio_priv(indio_dev);
+	unsigned int bit, threshold, n = 0;
+	u32 regval;
+	int ret;
+
+	/* called with mlock held, so no direct read is in progress */
+	ret = meson_sar_adc_bl30_lock(indio_dev);
+	if (ret)
+		return ret;
+
+	meson_sar_adc_clear_fifo(indio_dev);
+
+	/* the sample engine goes through the channel list in a loop */
+	for_each_set_bit(bit, indio_dev->active_scan_mask,
+			 MESON_SAR_ADC_NUM_CHANNELS) {
+		const struct iio_chan_spec *chan =
+			&meson_sar_adc_iio_channels[bit];
+
+		meson_sar_adc_set_averaging(indio_dev, chan, NO_AVERAGING,
+					    ONE_SAMPLE);
+
+		regval = FIELD_PREP(MESON_SAR_ADC_CHAN_LIST_ENTRY_MASK(n),
+				    bit);
+		regmap_update_bits(priv->regmap, MESON_SAR_ADC_CHAN_LIST,
+				   MESON_SAR_ADC_CHAN_LIST_ENTRY_MASK(n),
+				   regval);
+
+		if (bit == 6)
+			regmap_update_bits(priv->regmap,
+					   MESON_SAR_ADC_DELTA_10,
+					   MESON_SAR_ADC_DELTA_10_TEMP_SEL, 0);
+
+		priv->scan_ids[n++] = bit;
+	}
+
+	if (!n) {
+		meson_sar_adc_bl30_unlock(indio_dev);
+		return -EINVAL;
+	}
+
+	regval = FIELD_PREP(MESON_SAR_ADC_CHAN_LIST_MAX_INDEX_MASK, n - 1);
+	regmap_update_bits(priv->regmap, MESON_SAR_ADC_CHAN_LIST,
+			   MESON_SAR_ADC_CHAN_LIST_MAX_INDEX_MASK, regval);
+
+	priv->scan_chans = n;
+	priv->scan_pos = 0;
+	priv->scan_last_ts = 0;
+
+	/* interrupt on whole scans only */
+	threshold = rounddown(MESON_SAR_ADC_BUFFER_FIFO_THRESHOLD, n);
+	regval = FIELD_PREP(MESON_SAR_ADC_REG0_FIFO_CNT_IRQ_MASK, threshold);
+	regmap_update_bits(priv->regmap, MESON_SAR_ADC_REG0,
+			   MESON_SAR_ADC_REG0_FIFO_CNT_IRQ_MASK, regval);
+
+	regmap_update_bits(priv->regmap, MESON_SAR_ADC_REG0,
+			   MESON_SAR_ADC_REG0_CONTINUOUS_EN,
+			   MESON_SAR_ADC_REG0_CONTINUOUS_EN);
+
+	meson_sar_adc_start_sample_engine(indio_dev);
+
+	return 0;
+}
+
+static int meson_sar_adc_buffer_predisable(struct iio_dev *indio_dev)
+{
+	struct meson_sar_adc_priv *priv = iio_priv(indio_dev);
+	u32 regval;
+
+	meson_sar_adc_stop_sample_engine(indio_dev);
+
+	regmap_update_bits(priv->regmap, MESON_SAR_ADC_REG0,
+			   MESON_SAR_ADC_REG0_CONTINUOUS_EN, 0);
+
+	regval = FIELD_PREP(MESON_SAR_ADC_REG0_FIFO_CNT_IRQ_MASK, 1);
+	regmap_update_bits(priv->regmap, MESON_SAR_ADC_REG0,
+			   MESON_SAR_ADC_REG0_FIFO_CNT_IRQ_MASK, regval);
+
+	meson_sar_adc_clear_fifo(indio_dev);
+
+	meson_sar_adc_bl30_unlock(indio_dev);
+
+	return 0;
+}
+
+static const struct iio_buffer_setup_ops meson_sar_adc_buffer_ops = {
+	.postenable = meson_sar_adc_buffer_postenable,
+	.predisable = meson_sar_adc_buffer_predisable,
+};
+
 static int meson_sar_adc_calib(struct iio_dev *indio_dev)
 {
 	struct meson_sar_adc_priv *priv = iio_priv(indio_dev);
@@ -981,6 +1165,7 @@ static int meson_sar_adc_probe(struct platform_device *pdev)
 {
 	struct meson_sar_adc_priv *priv;
 	struct iio_dev *indio_dev;
+	struct iio_buffer *buffer;
 	struct resource *res;
 	void __iomem *base;
 	const struct of_device_id *match;
@@ -993,6 +1178,7 @@ static int meson_sar_adc_probe(struct platform_device *pdev)
 	}
 
 	priv = iio_priv(indio_dev);
+	device_enable_async_suspend(&pdev->dev);
 	init_completion(&priv->done);
 
 	match = of_match_device(meson_sar_adc_of_match, &pdev->dev);
@@ -1012,6 +1198,14 @@ static int meson_sar_adc_probe(struct platform_device *pdev)
 	indio_dev->channels = meson_sar_adc_iio_channels;
 	indio_dev->num_channels = ARRAY_SIZE(meson_sar_adc_iio_channels);
 
+	buffer = devm_iio_kfifo_allocate(&pdev->dev);
+	if (!buffer)
+		return -ENOMEM;
+
+	iio_device_attach_buffer(indio_dev, buffer);
+	indio_dev->modes |= INDIO_BUFFER_SOFTWARE;
+	indio_dev->setup_ops = &meson_sar_adc_buffer_ops;
+
 	res = platform_get_resource(pdev, IORESOURCE_MEM, 0);
 	base = devm_ioremap_resource(&pdev->dev, res);
 	if (IS_ERR(base))
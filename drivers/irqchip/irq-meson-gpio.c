@@ -28,6 +28,7 @@
 #include <linux/irqchip.h>
 #include <linux/of.h>
 #include <linux/of_address.h>
+#include <linux/seq_file.h>
 
 #define NUM_CHANNEL 8
 #define MAX_INPUT_MUX 256
@@ -80,7 +81,11 @@ struct meson_gpio_irq_controller {
 	unsigned int nr_hwirq;
 	void __iomem *base;
 	u32 channel_irqs[NUM_CHANNEL];
+	/* pad routed to each used channel */
+	u32 channel_pins[NUM_CHANNEL];
 	DECLARE_BITMAP(channel_map, NUM_CHANNEL);
+	/* requests rejected because all the channels were used */
+	unsigned int channel_exhausted;
 	spinlock_t lock;
 };
 
@@ -112,13 +117,15 @@ meson_gpio_irq_request_channel(struct meson_gpio_irq_controller *ctl,
 	/* Find a free channel */
 	idx = find_first_zero_bit(ctl->channel_map, NUM_CHANNEL);
 	if (idx >= NUM_CHANNEL) {
+		ctl->channel_exhausted++;
 		spin_unlock(&ctl->lock);
-		pr_err("No channel available\n");
+		pr_err("No channel available for hwirq %lu\n", hwirq);
 		return -ENOSPC;
 	}
 
 	/* Mark the channel as used */
 	set_bit(idx, ctl->channel_map);
+	ctl->channel_pins[idx] = hwirq;
 
 	/*
 	 * Setup the mux of the channel to route the signal of the pad
@@ -330,10 +337,52 @@ static void meson_gpio_irq_domain_free(struct irq_domain *domain,
 	meson_gpio_irq_release_channel(ctl, channel_hwirq);
 }
 
+#ifdef CONFIG_GENERIC_IRQ_DEBUGFS
+static void meson_gpio_irq_debug_show(struct seq_file *m,
+				      struct irq_domain *domain,
+				      struct irq_data *data, int ind)
+{
+	struct meson_gpio_irq_controller *ctl;
+	unsigned int idx;
+
+	/* Per interrupt: show the channel routing it to the GIC */
+	if (data) {
+		ctl = data->domain->host_data;
+		idx = meson_gpio_irq_get_channel_idx(ctl,
+					irq_data_get_irq_chip_data(data));
+		seq_printf(m, "%*schannel: %u\n", ind, "", idx);
+		return;
+	}
+
+	/* Per domain: show the channel pressure */
+	ctl = domain->host_data;
+
+	spin_lock(&ctl->lock);
+
+	seq_printf(m, "%*schannels: %u/%d used, %u requests rejected\n",
+		   ind, "", bitmap_weight(ctl->channel_map, NUM_CHANNEL),
+		   NUM_CHANNEL, ctl->channel_exhausted);
+
+	for (idx = 0; idx < NUM_CHANNEL; idx++) {
+		if (test_bit(idx, ctl->channel_map))
+			seq_printf(m, "%*s%u: hwirq %u -> gic %u\n",
+				   ind + 1, "", idx, ctl->channel_pins[idx],
+				   ctl->channel_irqs[idx]);
+		else
+			seq_printf(m, "%*s%u: free\n", ind + 1, "", idx);
+	}
+
+	spin_unlock(&ctl->lock);
+}
+#endif
+
 static const struct irq_domain_ops meson_gpio_irq_domain_ops = {
 	.alloc		= meson_gpio_irq_domain_alloc,
 	.free		= meson_gpio_irq_domain_free,
 	.translate	= meson_gpio_irq_domain_translate,
+#ifdef CONFIG_GENERIC_IRQ_DEBUGFS
+	.debug_show	= meson_gpio_irq_debug_show,
+#endif
 };
 
 static int __init meson_gpio_irq_parse_dt(struct device_node *node,
@@ -16,7 +16,11 @@
  * GNU General Public License for more details.
  */
 
+#include <linux/debugfs.h>
 #include <linux/interrupt.h>
+#include <linux/iopoll.h>
+#include <linux/ktime.h>
+#include <linux/seq_file.h>
 #include <linux/spinlock.h>
 #include <linux/mutex.h>
 #include <linux/delay.h>
@@ -38,10 +42,22 @@
 
 #define MHU_CHANS	3
 
+/*
+ * The SCP usually picks a message up within a few microseconds, spin for
+ * that long before leaving it to the next tx done poll, 1ms later.
+ */
+#define MHU_TX_POLL_US	10
+
+/* Round trip latency buckets, in powers of two microseconds */
+#define MHU_LAT_BUCKETS	16
+
 struct platform_mhu_link {
 	int irq;
 	void __iomem *tx_reg;
 	void __iomem *rx_reg;
+	spinlock_t rx_lock; /* serializes the rx irq handler and peek_data */
+	ktime_t tx_time;
+	unsigned long lat_hist[MHU_LAT_BUCKETS];
 };
 
 struct platform_mhu {
@@ -49,31 +65,65 @@ struct platform_mhu {
 	struct platform_mhu_link mlink[MHU_CHANS];
 	struct mbox_chan chan[MHU_CHANS];
 	struct mbox_controller mbox;
+	struct dentry *debugfs;
 };
 
-static irqreturn_t platform_mhu_rx_interrupt(int irq, void *p)
+static void platform_mhu_account_latency(struct platform_mhu_link *mlink)
+{
+	s64 us;
+
+	if (!mlink->tx_time)
+		return;
+
+	us = ktime_us_delta(ktime_get(), mlink->tx_time);
+	mlink->lat_hist[min_t(int, fls64(us), MHU_LAT_BUCKETS - 1)]++;
+	mlink->tx_time = 0;
+}
+
+static bool platform_mhu_rx(struct mbox_chan *chan)
 {
-	struct mbox_chan *chan = p;
 	struct platform_mhu_link *mlink = chan->con_priv;
+	unsigned long flags;
 	u32 val;
 
+	spin_lock_irqsave(&mlink->rx_lock, flags);
+
 	val = readl_relaxed(mlink->rx_reg + INTR_STAT_OFS);
-	if (!val)
-		return IRQ_NONE;
+	if (val) {
+		platform_mhu_account_latency(mlink);
+
+		mbox_chan_received_data(chan, (void *)&val);
+
+		writel_relaxed(val, mlink->rx_reg + INTR_CLR_OFS);
+	}
+
+	spin_unlock_irqrestore(&mlink->rx_lock, flags);
 
-	mbox_chan_received_data(chan, (void *)&val);
+	return val != 0;
+}
 
-	writel_relaxed(val, mlink->rx_reg + INTR_CLR_OFS);
+static irqreturn_t platform_mhu_rx_interrupt(int irq, void *p)
+{
+	return platform_mhu_rx(p) ? IRQ_HANDLED : IRQ_NONE;
+}
 
-	return IRQ_HANDLED;
+/*
+ * Lets a client waiting for a reply expected within microseconds poll for
+ * it, instead of waiting for the interrupt to be delivered and handled.
+ */
+static bool platform_mhu_peek_data(struct mbox_chan *chan)
+{
+	return platform_mhu_rx(chan);
 }
 
 static bool platform_mhu_last_tx_done(struct mbox_chan *chan)
 {
 	struct platform_mhu_link *mlink = chan->con_priv;
-	u32 val = readl_relaxed(mlink->tx_reg + INTR_STAT_OFS);
+	u32 val;
 
-	return (val == 0);
+	return !readl_relaxed_poll_timeout_atomic(mlink->tx_reg + INTR_STAT_OFS,
+						  val, !val, 1,
+						  MHU_TX_POLL_US);
 }
 
 static int platform_mhu_send_data(struct mbox_chan *chan, void *data)
@@ -81,6 +131,7 @@ static int platform_mhu_send_data(struct mbox_chan *chan, void *data)
 	struct platform_mhu_link *mlink = chan->con_priv;
 	u32 *arg = data;
 
+	mlink->tx_time = ktime_get();
 	writel_relaxed(*arg, mlink->tx_reg + INTR_SET_OFS);
 
 	return 0;
@@ -118,8 +169,31 @@ static const struct mbox_chan_ops platform_mhu_ops = {
 	.startup = platform_mhu_startup,
 	.shutdown = platform_mhu_shutdown,
 	.last_tx_done = platform_mhu_last_tx_done,
+	.peek_data = platform_mhu_peek_data,
 };
 
+static int platform_mhu_latency_show(struct seq_file *s, void *unused)
+{
+	struct platform_mhu *mhu = s->private;
+	int i, b;
+
+	seq_puts(s, "usecs     ");
+	for (i = 0; i < MHU_CHANS; i++)
+		seq_printf(s, " %10s%d", "chan", i);
+	seq_putc(s, '\n');
+
+	for (b = 0; b < MHU_LAT_BUCKETS; b++) {
+		seq_printf(s, "%s%-8lu", b == MHU_LAT_BUCKETS - 1 ? ">=" : "< ",
+			   b == MHU_LAT_BUCKETS - 1 ? 1UL << (b - 1) : 1UL << b);
+		for (i = 0; i < MHU_CHANS; i++)
+			seq_printf(s, " %11lu", mhu->mlink[i].lat_hist[b]);
+		seq_putc(s, '\n');
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(platform_mhu_latency);
+
 static int platform_mhu_probe(struct platform_device *pdev)
 {
 	int i, err;
@@ -151,6 +225,7 @@ static int platform_mhu_probe(struct platform_device *pdev)
 		}
 		mhu->mlink[i].rx_reg = mhu->base + platform_mhu_reg[i];
 		mhu->mlink[i].tx_reg = mhu->mlink[i].rx_reg + TX_REG_OFFSET;
+		spin_lock_init(&mhu->mlink[i].rx_lock);
 	}
 
 	mhu->mbox.dev = dev;
@@ -169,6 +244,10 @@ static int platform_mhu_probe(struct platform_device *pdev)
 		return err;
 	}
 
+	mhu->debugfs = debugfs_create_dir(dev_name(dev), NULL);
+	debugfs_create_file("latency", 0444, mhu->debugfs, mhu,
+			    &platform_mhu_latency_fops);
+
 	dev_info(dev, "Platform MHU Mailbox registered\n");
 	return 0;
 }
@@ -177,6 +256,7 @@ static int platform_mhu_remove(struct platform_device *pdev)
 {
 	struct platform_mhu *mhu = platform_get_drvdata(pdev);
 
+	debugfs_remove_recursive(mhu->debugfs);
 	mbox_controller_unregister(&mhu->mbox);
 
 	return 0;
@@ -12,9 +12,11 @@
 #include <linux/clk.h>
 #include <linux/device.h>
 #include <linux/io.h>
+#include <linux/iopoll.h>
 #include <linux/delay.h>
 #include <linux/kernel.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
 #include <linux/of.h>
 #include <linux/of_platform.h>
 #include <linux/platform_device.h>
@@ -215,14 +217,26 @@
 
 #define CEC_CLK_RATE		32768
 
+/*
+ * Each indirect register access takes a few cycles of the 32kHz CEC
+ * clock, sleep between the polls of the busy bit instead of spinning.
+ */
+#define CEC_RW_POLL_US		40
+#define CEC_RW_TIMEOUT_US	5000
+
 struct meson_ao_cec_device {
 	struct platform_device		*pdev;
 	void __iomem			*base;
 	struct clk			*core;
-	spinlock_t			cec_reg_lock;
+	struct mutex			cec_reg_lock;
 	struct cec_notifier		*notify;
 	struct cec_adapter		*adap;
 	struct cec_msg			rx_msg;
+	/* transmit attempts left and failures of the current message */
+	u8				tx_attempts;
+	u8				tx_arb_lost_cnt;
+	u8				tx_nack_cnt;
+	u8				tx_low_drive_cnt;
 };
 
 #define writel_bits_relaxed(mask, val, addr) \
@@ -230,28 +244,24 @@ struct meson_ao_cec_device {
 
 static inline int meson_ao_cec_wait_busy(struct meson_ao_cec_device *ao_cec)
 {
-	ktime_t timeout = ktime_add_us(ktime_get(), 5000);
+	u32 val;
 
-	while (readl_relaxed(ao_cec->base + CEC_RW_REG) & CEC_RW_BUS_BUSY) {
-		if (ktime_compare(ktime_get(), timeout) > 0)
-			return -ETIMEDOUT;
-	}
-
-	return 0;
+	return readl_relaxed_poll_timeout(ao_cec->base + CEC_RW_REG, val,
+					  !(val & CEC_RW_BUS_BUSY),
+					  CEC_RW_POLL_US, CEC_RW_TIMEOUT_US);
 }
 
 static void meson_ao_cec_read(struct meson_ao_cec_device *ao_cec,
 			     unsigned long address, u8 *data,
 			     int *res)
 {
-	unsigned long flags;
 	u32 reg = FIELD_PREP(CEC_RW_ADDR, address);
 	int ret = 0;
 
 	if (res && *res)
 		return;
 
-	spin_lock_irqsave(&ao_cec->cec_reg_lock, flags);
+	mutex_lock(&ao_cec->cec_reg_lock);
 
 	ret = meson_ao_cec_wait_busy(ao_cec);
 	if (ret)
@@ -267,7 +277,7 @@ static void meson_ao_cec_read(struct meson_ao_cec_device *ao_cec,
 			  readl_relaxed(ao_cec->base + CEC_RW_REG));
 
 read_out:
-	spin_unlock_irqrestore(&ao_cec->cec_reg_lock, flags);
+	mutex_unlock(&ao_cec->cec_reg_lock);
 
 	if (res)
 		*res = ret;
@@ -277,7 +287,6 @@ static void meson_ao_cec_write(struct meson_ao_cec_device *ao_cec,
 			       unsigned long address, u8 data,
 			       int *res)
 {
-	unsigned long flags;
 	u32 reg = FIELD_PREP(CEC_RW_ADDR, address) |
 		  FIELD_PREP(CEC_RW_WR_DATA, data) |
 		  CEC_RW_WRITE_EN;
@@ -286,7 +295,7 @@ static void meson_ao_cec_write(struct meson_ao_cec_device *ao_cec,
 	if (res && *res)
 		return;
 
-	spin_lock_irqsave(&ao_cec->cec_reg_lock, flags);
+	mutex_lock(&ao_cec->cec_reg_lock);
 
 	ret = meson_ao_cec_wait_busy(ao_cec);
 	if (ret)
@@ -295,7 +304,7 @@ static void meson_ao_cec_write(struct meson_ao_cec_device *ao_cec,
 	writel_relaxed(reg, ao_cec->base + CEC_RW_REG);
 
 write_out:
-	spin_unlock_irqrestore(&ao_cec->cec_reg_lock, flags);
+	mutex_unlock(&ao_cec->cec_reg_lock);
 
 	if (res)
 		*res = ret;
@@ -321,14 +330,14 @@ static inline int meson_ao_cec_clear(struct meson_ao_cec_device *ao_cec)
 	if (ret)
 		return ret;
 
-	udelay(100);
+	usleep_range(100, 200);
 
 	meson_ao_cec_write(ao_cec, CEC_RX_CLEAR_BUF, 0, &ret);
 	meson_ao_cec_write(ao_cec, CEC_TX_CLEAR_BUF, 0, &ret);
 	if (ret)
 		return ret;
 
-	udelay(100);
+	usleep_range(100, 200);
 
 	meson_ao_cec_write(ao_cec, CEC_RX_MSG_CMD, RX_NO_OP, &ret);
 	meson_ao_cec_write(ao_cec, CEC_TX_MSG_CMD, TX_NO_OP, &ret);
@@ -396,15 +405,18 @@ static void meson_ao_cec_irq_tx(struct meson_ao_cec_device *ao_cec)
 
 	case TX_BUSY:
 		tx_status = CEC_TX_STATUS_ARB_LOST;
+		ao_cec->tx_arb_lost_cnt++;
 		break;
 
 	case TX_IDLE:
 		tx_status = CEC_TX_STATUS_LOW_DRIVE;
+		ao_cec->tx_low_drive_cnt++;
 		break;
 
 	case TX_ERROR:
 	default:
 		tx_status = CEC_TX_STATUS_NACK;
+		ao_cec->tx_nack_cnt++;
 		break;
 	}
 
@@ -416,11 +428,31 @@ static void meson_ao_cec_irq_tx(struct meson_ao_cec_device *ao_cec)
 	if (ret)
 		goto tx_reg_err;
 
-	cec_transmit_attempt_done(ao_cec->adap, tx_status);
+	/*
+	 * The message is still in the TX buffer, send it again from here
+	 * rather than having the CEC core rewrite it byte per byte. The
+	 * controller waits for the retry signal free time by itself.
+	 */
+	if (tx_status != CEC_TX_STATUS_OK && --ao_cec->tx_attempts) {
+		meson_ao_cec_write(ao_cec, CEC_TX_MSG_CMD, TX_REQ_CURRENT,
+				   &ret);
+		if (ret)
+			goto tx_reg_err;
+		return;
+	}
+
+	if (tx_status != CEC_TX_STATUS_OK)
+		tx_status |= CEC_TX_STATUS_MAX_RETRIES;
+
+	cec_transmit_done(ao_cec->adap, tx_status, ao_cec->tx_arb_lost_cnt,
+			  ao_cec->tx_nack_cnt, ao_cec->tx_low_drive_cnt, 0);
 	return;
 
 tx_reg_err:
-	cec_transmit_attempt_done(ao_cec->adap, CEC_TX_STATUS_ERROR);
+	cec_transmit_done(ao_cec->adap,
+			  CEC_TX_STATUS_ERROR | CEC_TX_STATUS_MAX_RETRIES,
+			  ao_cec->tx_arb_lost_cnt, ao_cec->tx_nack_cnt,
+			  ao_cec->tx_low_drive_cnt, 1);
 }
 
 static void meson_ao_cec_irq_rx(struct meson_ao_cec_device *ao_cec)
@@ -503,7 +535,7 @@ static int meson_ao_cec_set_log_addr(struct cec_adapter *adap, u8 logical_addr)
 	if (ret)
 		return ret;
 
-	udelay(100);
+	usleep_range(100, 200);
 
 	meson_ao_cec_write(ao_cec, CEC_LOGICAL_ADDR0,
 			   (logical_addr & LOGICAL_ADDR_MASK) |
@@ -535,6 +567,12 @@ static int meson_ao_cec_transmit(struct cec_adapter *adap, u8 attempts,
 	}
 
 	meson_ao_cec_write(ao_cec, CEC_TX_MSG_LENGTH, msg->len - 1, &ret);
+
+	ao_cec->tx_attempts = attempts;
+	ao_cec->tx_arb_lost_cnt = 0;
+	ao_cec->tx_nack_cnt = 0;
+	ao_cec->tx_low_drive_cnt = 0;
+
 	meson_ao_cec_write(ao_cec, CEC_TX_MSG_CMD, TX_REQ_CURRENT, &ret);
 
 	return ret;
@@ -559,7 +597,7 @@ static int meson_ao_cec_adap_enable(struct cec_adapter *adap, bool enable)
 				       CEC_GEN_CNTL_CLK_ENABLE),
 			    ao_cec->base + CEC_GEN_CNTL_REG);
 
-	udelay(100);
+	usleep_range(100, 200);
 
 	/* Release Reset */
 	writel_bits_relaxed(CEC_GEN_CNTL_RESET, 0,
@@ -620,7 +658,7 @@ static int meson_ao_cec_probe(struct platform_device *pdev)
 	if (!ao_cec)
 		return -ENOMEM;
 
-	spin_lock_init(&ao_cec->cec_reg_lock);
+	mutex_init(&ao_cec->cec_reg_lock);
 
 	ao_cec->notify = cec_notifier_get(&hdmi_dev->dev);
 	if (!ao_cec->notify)
@@ -0,0 +1,151 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Amlogic GE2D 2D graphics engine registers
+ */
+
+#ifndef __GE2D_REGS_H_
+#define __GE2D_REGS_H_
+
+#define GE2D_REG(x)			((x) << 2)
+
+#define GE2D_GEN_CTRL0			GE2D_REG(0xa0)
+#define GE2D_GEN_CTRL1			GE2D_REG(0xa1)
+#define GE2D_GEN_CTRL2			GE2D_REG(0xa2)
+#define GE2D_CMD_CTRL			GE2D_REG(0xa3)
+#define GE2D_STATUS0			GE2D_REG(0xa4)
+#define GE2D_STATUS1			GE2D_REG(0xa5)
+#define GE2D_SRC1_DEF_COLOR		GE2D_REG(0xa6)
+#define GE2D_SRC1_CLIPX_START_END	GE2D_REG(0xa7)
+#define GE2D_SRC1_CLIPY_START_END	GE2D_REG(0xa8)
+#define GE2D_SRC1_CANVAS		GE2D_REG(0xa9)
+#define GE2D_SRC1_X_START_END		GE2D_REG(0xaa)
+#define GE2D_SRC1_Y_START_END		GE2D_REG(0xab)
+#define GE2D_SRC2_DEF_COLOR		GE2D_REG(0xaf)
+#define GE2D_SRC2_CLIPX_START_END	GE2D_REG(0xb0)
+#define GE2D_SRC2_CLIPY_START_END	GE2D_REG(0xb1)
+#define GE2D_SRC2_X_START_END		GE2D_REG(0xb2)
+#define GE2D_SRC2_Y_START_END		GE2D_REG(0xb3)
+#define GE2D_DST_CLIPX_START_END	GE2D_REG(0xb4)
+#define GE2D_DST_CLIPY_START_END	GE2D_REG(0xb5)
+#define GE2D_DST_X_START_END		GE2D_REG(0xb6)
+#define GE2D_DST_Y_START_END		GE2D_REG(0xb7)
+#define GE2D_SRC2_DST_CANVAS		GE2D_REG(0xb8)
+#define GE2D_VSC_START_PHASE_STEP	GE2D_REG(0xb9)
+#define GE2D_VSC_PHASE_SLOPE		GE2D_REG(0xba)
+#define GE2D_VSC_INI_CTRL		GE2D_REG(0xbb)
+#define GE2D_HSC_START_PHASE_STEP	GE2D_REG(0xbc)
+#define GE2D_HSC_PHASE_SLOPE		GE2D_REG(0xbd)
+#define GE2D_HSC_INI_CTRL		GE2D_REG(0xbe)
+#define GE2D_HSC_ADV_CTRL		GE2D_REG(0xbf)
+#define GE2D_SC_MISC_CTRL		GE2D_REG(0xc0)
+#define GE2D_MATRIX_PRE_OFFSET		GE2D_REG(0xc5)
+#define GE2D_MATRIX_COEF00_01		GE2D_REG(0xc6)
+#define GE2D_MATRIX_COEF02_10		GE2D_REG(0xc7)
+#define GE2D_MATRIX_COEF11_12		GE2D_REG(0xc8)
+#define GE2D_MATRIX_COEF20_21		GE2D_REG(0xc9)
+#define GE2D_MATRIX_COEF22_CTRL		GE2D_REG(0xca)
+#define GE2D_MATRIX_OFFSET		GE2D_REG(0xcb)
+#define GE2D_ALU_OP_CTRL		GE2D_REG(0xcc)
+#define GE2D_ALU_CONST_COLOR		GE2D_REG(0xcd)
+#define GE2D_DST_BITMASK		GE2D_REG(0xd2)
+#define GE2D_DP_ONOFF_CTRL		GE2D_REG(0xd3)
+
+/* GE2D_GEN_CTRL0 */
+#define GE2D_SRC1_PIC_STRUCT		GENMASK(13, 12)
+#define GE2D_X_YC_RATIO			BIT(11)
+#define GE2D_Y_YC_RATIO			BIT(10)
+#define GE2D_SRC1_SEPARATE_EN		BIT(9)
+
+/* GE2D_GEN_CTRL1 */
+#define GE2D_SOFT_RST			BIT(31)
+#define GE2D_DST_WRITE_RESP		BIT(30)
+#define GE2D_INTERRUPT_CTRL		GENMASK(25, 24)
+#define GE2D_INTERRUPT_CMD_DONE		1
+
+/* GE2D_GEN_CTRL2 */
+#define GE2D_SRC1_LITTLE_ENDIAN		BIT(29)
+#define GE2D_SRC2_LITTLE_ENDIAN		BIT(28)
+#define GE2D_DST_LITTLE_ENDIAN		BIT(27)
+#define GE2D_DST1_COLOR_MAP		GENMASK(20, 17)
+#define GE2D_DST1_FORMAT		GENMASK(16, 15)
+#define GE2D_SRC1_COLOR_MAP		GENMASK(14, 11)
+#define GE2D_SRC1_FORMAT		GENMASK(10, 9)
+#define GE2D_SRC2_COLOR_MAP		GENMASK(8, 5)
+#define GE2D_SRC2_FORMAT		GENMASK(4, 3)
+
+#define GE2D_FORMAT_8BIT		0
+#define GE2D_FORMAT_16BIT		1
+#define GE2D_FORMAT_24BIT		2
+#define GE2D_FORMAT_32BIT		3
+
+/* 16 bit color maps */
+#define GE2D_COLOR_MAP_YUV422		0
+#define GE2D_COLOR_MAP_RGB565		5
+
+/* 24 bit color maps */
+#define GE2D_COLOR_MAP_RGB888		0
+#define GE2D_COLOR_MAP_BGR888		5
+
+/* 32 bit color maps */
+#define GE2D_COLOR_MAP_RGBA8888		0
+#define GE2D_COLOR_MAP_ARGB8888		1
+#define GE2D_COLOR_MAP_ABGR8888		2
+#define GE2D_COLOR_MAP_BGRA8888		3
+
+/* 8 bit color maps, with GE2D_SRC1_SEPARATE_EN */
+#define GE2D_COLOR_MAP_NV21		14
+#define GE2D_COLOR_MAP_NV12		15
+
+/* GE2D_CMD_CTRL */
+#define GE2D_DST_XY_SWAP		BIT(10)
+#define GE2D_DST_X_REV			BIT(9)
+#define GE2D_DST_Y_REV			BIT(8)
+#define GE2D_CBUS_CMD_WR		BIT(0)
+
+/* GE2D_STATUS0 */
+#define GE2D_GE2D_BUSY			BIT(0)
+
+/* GE2D_*_START_END */
+#define GE2D_START			GENMASK(28, 16)
+#define GE2D_END			GENMASK(12, 0)
+
+/* GE2D_SRC1_CANVAS */
+#define GE2D_SRC1_CANVAS_Y		GENMASK(31, 24)
+#define GE2D_SRC1_CANVAS_CB		GENMASK(23, 16)
+#define GE2D_SRC1_CANVAS_CR		GENMASK(15, 8)
+
+/* GE2D_SRC2_DST_CANVAS */
+#define GE2D_DST1_CANVAS		GENMASK(15, 8)
+#define GE2D_SRC2_CANVAS		GENMASK(7, 0)
+
+/* GE2D_*SC_START_PHASE_STEP, 5.24 fixed point */
+#define GE2D_SC_STEP			GENMASK(28, 0)
+#define GE2D_SC_STEP_SHIFT		24
+
+/* GE2D_SC_MISC_CTRL */
+#define GE2D_SC_HSC_EN			BIT(16)
+#define GE2D_SC_VSC_EN			BIT(15)
+
+/* GE2D_MATRIX_COEF*, 2.10 fixed point */
+#define GE2D_COEF_HI			GENMASK(28, 16)
+#define GE2D_COEF_LO			GENMASK(12, 0)
+
+/* GE2D_MATRIX_PRE_OFFSET and GE2D_MATRIX_OFFSET, 9 bit signed */
+#define GE2D_OFFSET_0			GENMASK(28, 20)
+#define GE2D_OFFSET_1			GENMASK(18, 10)
+#define GE2D_OFFSET_2			GENMASK(8, 0)
+
+/* GE2D_MATRIX_COEF22_CTRL */
+#define GE2D_MATRIX_SAT_EN		BIT(1)
+#define GE2D_MATRIX_EN			BIT(0)
+
+/* GE2D_ALU_OP_CTRL */
+#define GE2D_BLENDING_MODE		GENMASK(24, 22)
+#define GE2D_LOGIC_OPERATION		GENMASK(21, 18)
+#define GE2D_ALPHA_BLENDING_MODE	GENMASK(13, 11)
+#define GE2D_ALPHA_LOGIC_OPERATION	GENMASK(10, 7)
+
+#define GE2D_OPERATION_LOGIC		5
+#define GE2D_LOGIC_OPERATION_COPY	1
+
+#endif
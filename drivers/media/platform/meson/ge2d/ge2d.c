@@ -0,0 +1,891 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Amlogic GE2D 2D graphics engine, as a V4L2 mem2mem device
+ *
+ * Each job blits one OUTPUT buffer into one CAPTURE buffer, converting the
+ * pixel format, scaling to the CAPTURE size and optionally flipping or
+ * rotating by 90 degree steps. Buffers are accessed through canvases.
+ */
+
+#include <linux/bitfield.h>
+#include <linux/clk.h>
+#include <linux/interrupt.h>
+#include <linux/module.h>
+#include <linux/of_device.h>
+#include <linux/platform_device.h>
+#include <linux/regmap.h>
+#include <linux/reset.h>
+#include <linux/soc/amlogic/meson-canvas.h>
+#include <media/v4l2-ctrls.h>
+#include <media/v4l2-device.h>
+#include <media/v4l2-event.h>
+#include <media/v4l2-ioctl.h>
+#include <media/v4l2-mem2mem.h>
+#include <media/videobuf2-dma-contig.h>
+
+#include "ge2d-regs.h"
+
+#define GE2D_NAME	"meson-ge2d"
+
+#define MAX_WIDTH	8191
+#define MAX_HEIGHT	8191
+#define MIN_WIDTH	8
+#define MIN_HEIGHT	8
+
+/* Source Y or RGB, source CbCr and destination */
+#define NUM_CANVAS	3
+
+struct ge2d_fmt {
+	u32 fourcc;
+	u8 depth;	/* bits per pixel of the first plane */
+	u8 hw_fmt;
+	u8 hw_map;
+	bool yuv;
+	bool nv;	/* a CbCr plane follows the Y plane */
+	bool src_only;
+};
+
+static const struct ge2d_fmt formats[] = {
+	{
+		.fourcc = V4L2_PIX_FMT_ABGR32,
+		.depth = 32,
+		.hw_fmt = GE2D_FORMAT_32BIT,
+		.hw_map = GE2D_COLOR_MAP_BGRA8888,
+	}, {
+		.fourcc = V4L2_PIX_FMT_XBGR32,
+		.depth = 32,
+		.hw_fmt = GE2D_FORMAT_32BIT,
+		.hw_map = GE2D_COLOR_MAP_BGRA8888,
+	}, {
+		.fourcc = V4L2_PIX_FMT_RGB32,
+		.depth = 32,
+		.hw_fmt = GE2D_FORMAT_32BIT,
+		.hw_map = GE2D_COLOR_MAP_ARGB8888,
+	}, {
+		.fourcc = V4L2_PIX_FMT_RGB24,
+		.depth = 24,
+		.hw_fmt = GE2D_FORMAT_24BIT,
+		.hw_map = GE2D_COLOR_MAP_RGB888,
+	}, {
+		.fourcc = V4L2_PIX_FMT_BGR24,
+		.depth = 24,
+		.hw_fmt = GE2D_FORMAT_24BIT,
+		.hw_map = GE2D_COLOR_MAP_BGR888,
+	}, {
+		.fourcc = V4L2_PIX_FMT_RGB565,
+		.depth = 16,
+		.hw_fmt = GE2D_FORMAT_16BIT,
+		.hw_map = GE2D_COLOR_MAP_RGB565,
+	}, {
+		.fourcc = V4L2_PIX_FMT_YUYV,
+		.depth = 16,
+		.hw_fmt = GE2D_FORMAT_16BIT,
+		.hw_map = GE2D_COLOR_MAP_YUV422,
+		.yuv = true,
+		.src_only = true,
+	}, {
+		.fourcc = V4L2_PIX_FMT_NV12,
+		.depth = 8,
+		.hw_fmt = GE2D_FORMAT_8BIT,
+		.hw_map = GE2D_COLOR_MAP_NV12,
+		.yuv = true,
+		.nv = true,
+		.src_only = true,
+	}, {
+		.fourcc = V4L2_PIX_FMT_NV21,
+		.depth = 8,
+		.hw_fmt = GE2D_FORMAT_8BIT,
+		.hw_map = GE2D_COLOR_MAP_NV21,
+		.yuv = true,
+		.nv = true,
+		.src_only = true,
+	},
+};
+
+struct ge2d_frame {
+	const struct ge2d_fmt *fmt;
+	u32 width;
+	u32 height;
+	u32 bytesperline;
+	u32 sizeimage;
+	enum v4l2_colorspace colorspace;
+};
+
+struct meson_ge2d {
+	struct device *dev;
+	struct regmap *map;
+	struct clk *clk;
+	struct meson_canvas *canvas;
+	u8 canvas_idx;
+
+	struct v4l2_device v4l2_dev;
+	struct v4l2_m2m_dev *m2m_dev;
+	struct video_device *vfd;
+
+	/* Serializes the ioctls and the queues of all the contexts */
+	struct mutex mutex;
+
+	struct ge2d_ctx *curr;
+};
+
+struct ge2d_ctx {
+	struct v4l2_fh fh;
+	struct meson_ge2d *ge2d;
+	struct v4l2_ctrl_handler ctrl_handler;
+	struct ge2d_frame in;
+	struct ge2d_frame out;
+	bool hflip;
+	bool vflip;
+	u32 rotation;
+};
+
+static inline struct ge2d_ctx *file_to_ctx(struct file *file)
+{
+	return container_of(file->private_data, struct ge2d_ctx, fh);
+}
+
+static const struct ge2d_fmt *find_fmt(u32 fourcc, bool capture)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(formats); i++) {
+		if (capture && formats[i].src_only)
+			continue;
+		if (formats[i].fourcc == fourcc)
+			return &formats[i];
+	}
+
+	return NULL;
+}
+
+static struct ge2d_frame *get_frame(struct ge2d_ctx *ctx,
+				    enum v4l2_buf_type type)
+{
+	if (V4L2_TYPE_IS_OUTPUT(type))
+		return &ctx->in;
+
+	return &ctx->out;
+}
+
+static void ge2d_frame_set(struct ge2d_frame *frm, const struct ge2d_fmt *fmt,
+			   u32 width, u32 height)
+{
+	frm->fmt = fmt;
+	frm->width = clamp_t(u32, width, MIN_WIDTH, MAX_WIDTH);
+	frm->height = clamp_t(u32, height, MIN_HEIGHT, MAX_HEIGHT);
+
+	/* The canvas width is in units of 8 bytes */
+	frm->bytesperline = ALIGN(DIV_ROUND_UP(frm->width * fmt->depth, 8), 8);
+	if (fmt->nv) {
+		/* The CbCr plane is subsampled by two in both directions */
+		frm->height = ALIGN(frm->height, 2);
+		frm->sizeimage = frm->bytesperline * frm->height * 3 / 2;
+	} else {
+		frm->sizeimage = frm->bytesperline * frm->height;
+	}
+}
+
+/*
+ * BT.601 limited range YUV to RGB, coefficients in 2.10 fixed point and
+ * offsets as 9 bit two's complement
+ */
+static void ge2d_set_matrix(struct meson_ge2d *ge2d, bool enable)
+{
+	if (!enable) {
+		regmap_write(ge2d->map, GE2D_MATRIX_COEF22_CTRL, 0);
+		return;
+	}
+
+	regmap_write(ge2d->map, GE2D_MATRIX_PRE_OFFSET,
+		     FIELD_PREP(GE2D_OFFSET_0, 0x1f0) |
+		     FIELD_PREP(GE2D_OFFSET_1, 0x180) |
+		     FIELD_PREP(GE2D_OFFSET_2, 0x180));
+	regmap_write(ge2d->map, GE2D_MATRIX_COEF00_01,
+		     FIELD_PREP(GE2D_COEF_HI, 0x4a8) |
+		     FIELD_PREP(GE2D_COEF_LO, 0));
+	regmap_write(ge2d->map, GE2D_MATRIX_COEF02_10,
+		     FIELD_PREP(GE2D_COEF_HI, 0x662) |
+		     FIELD_PREP(GE2D_COEF_LO, 0x4a8));
+	regmap_write(ge2d->map, GE2D_MATRIX_COEF11_12,
+		     FIELD_PREP(GE2D_COEF_HI, 0x1e6f) |
+		     FIELD_PREP(GE2D_COEF_LO, 0x1cbf));
+	regmap_write(ge2d->map, GE2D_MATRIX_COEF20_21,
+		     FIELD_PREP(GE2D_COEF_HI, 0x4a8) |
+		     FIELD_PREP(GE2D_COEF_LO, 0x812));
+	regmap_write(ge2d->map, GE2D_MATRIX_OFFSET, 0);
+	regmap_write(ge2d->map, GE2D_MATRIX_COEF22_CTRL,
+		     GE2D_MATRIX_SAT_EN | GE2D_MATRIX_EN);
+}
+
+static u32 ge2d_scale_step(u32 in, u32 out)
+{
+	return min_t(u64, div_u64((u64)in << GE2D_SC_STEP_SHIFT, out),
+		     GE2D_SC_STEP);
+}
+
+static void ge2d_hw_start(struct meson_ge2d *ge2d, dma_addr_t src,
+			  dma_addr_t dst)
+{
+	struct ge2d_ctx *ctx = ge2d->curr;
+	const struct ge2d_fmt *in_fmt = ctx->in.fmt;
+	const struct ge2d_fmt *out_fmt = ctx->out.fmt;
+	struct meson_canvas_entry entries[NUM_CANVAS];
+	u8 src_y = ge2d->canvas_idx;
+	u8 src_c = ge2d->canvas_idx + 1;
+	u8 dst_c = ge2d->canvas_idx + 2;
+	bool swap = ctx->rotation == 90 || ctx->rotation == 270;
+	bool xrev = ctx->hflip, yrev = ctx->vflip;
+	u32 in_w = ctx->in.width, in_h = ctx->in.height;
+	u32 out_w = swap ? ctx->out.height : ctx->out.width;
+	u32 out_h = swap ? ctx->out.width : ctx->out.height;
+	unsigned int num = 0;
+	u32 reg, cmd;
+
+	entries[num++] = (struct meson_canvas_entry) {
+		.index = src_y,
+		.addr = src,
+		.stride = ctx->in.bytesperline,
+		.height = ctx->in.height,
+	};
+	if (in_fmt->nv)
+		entries[num++] = (struct meson_canvas_entry) {
+			.index = src_c,
+			.addr = src + ctx->in.bytesperline * ctx->in.height,
+			.stride = ctx->in.bytesperline,
+			.height = ctx->in.height / 2,
+		};
+	entries[num++] = (struct meson_canvas_entry) {
+		.index = dst_c,
+		.addr = dst,
+		.stride = ctx->out.bytesperline,
+		.height = ctx->out.height,
+	};
+	meson_canvas_config_batch(ge2d->canvas, entries, num);
+
+	reg = 0;
+	if (in_fmt->nv)
+		reg = GE2D_SRC1_SEPARATE_EN | GE2D_X_YC_RATIO |
+		      GE2D_Y_YC_RATIO;
+	regmap_write(ge2d->map, GE2D_GEN_CTRL0, reg);
+
+	regmap_write(ge2d->map, GE2D_GEN_CTRL2,
+		     GE2D_SRC1_LITTLE_ENDIAN | GE2D_DST_LITTLE_ENDIAN |
+		     FIELD_PREP(GE2D_SRC1_FORMAT, in_fmt->hw_fmt) |
+		     FIELD_PREP(GE2D_SRC1_COLOR_MAP, in_fmt->hw_map) |
+		     FIELD_PREP(GE2D_DST1_FORMAT, out_fmt->hw_fmt) |
+		     FIELD_PREP(GE2D_DST1_COLOR_MAP, out_fmt->hw_map));
+
+	regmap_write(ge2d->map, GE2D_SRC1_CANVAS,
+		     FIELD_PREP(GE2D_SRC1_CANVAS_Y, src_y) |
+		     FIELD_PREP(GE2D_SRC1_CANVAS_CB, src_c) |
+		     FIELD_PREP(GE2D_SRC1_CANVAS_CR, src_c));
+	regmap_write(ge2d->map, GE2D_SRC2_DST_CANVAS,
+		     FIELD_PREP(GE2D_DST1_CANVAS, dst_c));
+
+	/* The source rectangle, before rotation */
+	reg = FIELD_PREP(GE2D_START, 0) | FIELD_PREP(GE2D_END, in_w - 1);
+	regmap_write(ge2d->map, GE2D_SRC1_CLIPX_START_END, reg);
+	regmap_write(ge2d->map, GE2D_SRC1_X_START_END, reg);
+	reg = FIELD_PREP(GE2D_START, 0) | FIELD_PREP(GE2D_END, in_h - 1);
+	regmap_write(ge2d->map, GE2D_SRC1_CLIPY_START_END, reg);
+	regmap_write(ge2d->map, GE2D_SRC1_Y_START_END, reg);
+
+	/* The destination rectangle, in destination coordinates */
+	reg = FIELD_PREP(GE2D_START, 0) |
+	      FIELD_PREP(GE2D_END, ctx->out.width - 1);
+	regmap_write(ge2d->map, GE2D_DST_CLIPX_START_END, reg);
+	regmap_write(ge2d->map, GE2D_DST_X_START_END, reg);
+	reg = FIELD_PREP(GE2D_START, 0) |
+	      FIELD_PREP(GE2D_END, ctx->out.height - 1);
+	regmap_write(ge2d->map, GE2D_DST_CLIPY_START_END, reg);
+	regmap_write(ge2d->map, GE2D_DST_Y_START_END, reg);
+
+	/* Scaling is done before the rotation */
+	reg = 0;
+	if (in_w != out_w)
+		reg |= GE2D_SC_HSC_EN;
+	if (in_h != out_h)
+		reg |= GE2D_SC_VSC_EN;
+	regmap_write(ge2d->map, GE2D_HSC_START_PHASE_STEP,
+		     ge2d_scale_step(in_w, out_w));
+	regmap_write(ge2d->map, GE2D_VSC_START_PHASE_STEP,
+		     ge2d_scale_step(in_h, out_h));
+	regmap_write(ge2d->map, GE2D_SC_MISC_CTRL, reg);
+
+	ge2d_set_matrix(ge2d, in_fmt->yuv && !out_fmt->yuv);
+
+	regmap_write(ge2d->map, GE2D_ALU_OP_CTRL,
+		     FIELD_PREP(GE2D_BLENDING_MODE, GE2D_OPERATION_LOGIC) |
+		     FIELD_PREP(GE2D_LOGIC_OPERATION,
+				GE2D_LOGIC_OPERATION_COPY) |
+		     FIELD_PREP(GE2D_ALPHA_BLENDING_MODE,
+				GE2D_OPERATION_LOGIC) |
+		     FIELD_PREP(GE2D_ALPHA_LOGIC_OPERATION,
+				GE2D_LOGIC_OPERATION_COPY));
+
+	/* Rotations are a swap of the axes followed by a flip */
+	switch (ctx->rotation) {
+	case 90:
+		xrev = !xrev;
+		break;
+	case 180:
+		xrev = !xrev;
+		yrev = !yrev;
+		break;
+	case 270:
+		yrev = !yrev;
+		break;
+	}
+
+	cmd = GE2D_CBUS_CMD_WR;
+	if (swap)
+		cmd |= GE2D_DST_XY_SWAP;
+	if (xrev)
+		cmd |= GE2D_DST_X_REV;
+	if (yrev)
+		cmd |= GE2D_DST_Y_REV;
+	regmap_write(ge2d->map, GE2D_CMD_CTRL, cmd);
+}
+
+static void device_run(void *priv)
+{
+	struct ge2d_ctx *ctx = priv;
+	struct meson_ge2d *ge2d = ctx->ge2d;
+	struct vb2_v4l2_buffer *src, *dst;
+
+	src = v4l2_m2m_next_src_buf(ctx->fh.m2m_ctx);
+	dst = v4l2_m2m_next_dst_buf(ctx->fh.m2m_ctx);
+
+	ge2d->curr = ctx;
+	ge2d_hw_start(ge2d, vb2_dma_contig_plane_dma_addr(&src->vb2_buf, 0),
+		      vb2_dma_contig_plane_dma_addr(&dst->vb2_buf, 0));
+}
+
+static irqreturn_t ge2d_isr(int irq, void *priv)
+{
+	struct meson_ge2d *ge2d = priv;
+	struct ge2d_ctx *ctx = ge2d->curr;
+	struct vb2_v4l2_buffer *src, *dst;
+	u32 status;
+
+	regmap_read(ge2d->map, GE2D_STATUS0, &status);
+	if ((status & GE2D_GE2D_BUSY) || !ctx)
+		return IRQ_NONE;
+
+	ge2d->curr = NULL;
+
+	src = v4l2_m2m_src_buf_remove(ctx->fh.m2m_ctx);
+	dst = v4l2_m2m_dst_buf_remove(ctx->fh.m2m_ctx);
+
+	dst->vb2_buf.timestamp = src->vb2_buf.timestamp;
+	dst->timecode = src->timecode;
+	dst->flags &= ~V4L2_BUF_FLAG_TSTAMP_SRC_MASK;
+	dst->flags |= src->flags & (V4L2_BUF_FLAG_TSTAMP_SRC_MASK |
+				    V4L2_BUF_FLAG_TIMECODE |
+				    V4L2_BUF_FLAG_KEYFRAME);
+
+	v4l2_m2m_buf_done(src, VB2_BUF_STATE_DONE);
+	v4l2_m2m_buf_done(dst, VB2_BUF_STATE_DONE);
+
+	/* Starts the next queued job, possibly of another context, right away */
+	v4l2_m2m_job_finish(ge2d->m2m_dev, ctx->fh.m2m_ctx);
+
+	return IRQ_HANDLED;
+}
+
+static const struct v4l2_m2m_ops ge2d_m2m_ops = {
+	.device_run = device_run,
+};
+
+static int ge2d_queue_setup(struct vb2_queue *vq, unsigned int *nbuffers,
+			    unsigned int *nplanes, unsigned int sizes[],
+			    struct device *alloc_devs[])
+{
+	struct ge2d_ctx *ctx = vb2_get_drv_priv(vq);
+	struct ge2d_frame *frm = get_frame(ctx, vq->type);
+
+	if (*nplanes)
+		return sizes[0] < frm->sizeimage ? -EINVAL : 0;
+
+	*nplanes = 1;
+	sizes[0] = frm->sizeimage;
+
+	return 0;
+}
+
+static int ge2d_buf_prepare(struct vb2_buffer *vb)
+{
+	struct ge2d_ctx *ctx = vb2_get_drv_priv(vb->vb2_queue);
+	struct ge2d_frame *frm = get_frame(ctx, vb->vb2_queue->type);
+
+	if (vb2_plane_size(vb, 0) < frm->sizeimage)
+		return -EINVAL;
+
+	vb2_set_plane_payload(vb, 0, frm->sizeimage);
+
+	return 0;
+}
+
+static void ge2d_buf_queue(struct vb2_buffer *vb)
+{
+	struct vb2_v4l2_buffer *vbuf = to_vb2_v4l2_buffer(vb);
+	struct ge2d_ctx *ctx = vb2_get_drv_priv(vb->vb2_queue);
+
+	v4l2_m2m_buf_queue(ctx->fh.m2m_ctx, vbuf);
+}
+
+static void ge2d_stop_streaming(struct vb2_queue *vq)
+{
+	struct ge2d_ctx *ctx = vb2_get_drv_priv(vq);
+	struct vb2_v4l2_buffer *vbuf;
+
+	if (V4L2_TYPE_IS_OUTPUT(vq->type))
+		while ((vbuf = v4l2_m2m_src_buf_remove(ctx->fh.m2m_ctx)))
+			v4l2_m2m_buf_done(vbuf, VB2_BUF_STATE_ERROR);
+	else
+		while ((vbuf = v4l2_m2m_dst_buf_remove(ctx->fh.m2m_ctx)))
+			v4l2_m2m_buf_done(vbuf, VB2_BUF_STATE_ERROR);
+}
+
+static const struct vb2_ops ge2d_qops = {
+	.queue_setup = ge2d_queue_setup,
+	.buf_prepare = ge2d_buf_prepare,
+	.buf_queue = ge2d_buf_queue,
+	.stop_streaming = ge2d_stop_streaming,
+	.wait_prepare = vb2_ops_wait_prepare,
+	.wait_finish = vb2_ops_wait_finish,
+};
+
+static int queue_init(void *priv, struct vb2_queue *src_vq,
+		      struct vb2_queue *dst_vq)
+{
+	struct ge2d_ctx *ctx = priv;
+	int ret;
+
+	src_vq->type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+	src_vq->io_modes = VB2_MMAP | VB2_DMABUF;
+	src_vq->drv_priv = ctx;
+	src_vq->ops = &ge2d_qops;
+	src_vq->mem_ops = &vb2_dma_contig_memops;
+	src_vq->buf_struct_size = sizeof(struct v4l2_m2m_buffer);
+	src_vq->timestamp_flags = V4L2_BUF_FLAG_TIMESTAMP_COPY;
+	src_vq->lock = &ctx->ge2d->mutex;
+	src_vq->dev = ctx->ge2d->v4l2_dev.dev;
+
+	ret = vb2_queue_init(src_vq);
+	if (ret)
+		return ret;
+
+	dst_vq->type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	dst_vq->io_modes = VB2_MMAP | VB2_DMABUF;
+	dst_vq->drv_priv = ctx;
+	dst_vq->ops = &ge2d_qops;
+	dst_vq->mem_ops = &vb2_dma_contig_memops;
+	dst_vq->buf_struct_size = sizeof(struct v4l2_m2m_buffer);
+	dst_vq->timestamp_flags = V4L2_BUF_FLAG_TIMESTAMP_COPY;
+	dst_vq->lock = &ctx->ge2d->mutex;
+	dst_vq->dev = ctx->ge2d->v4l2_dev.dev;
+
+	return vb2_queue_init(dst_vq);
+}
+
+static int vidioc_querycap(struct file *file, void *priv,
+			   struct v4l2_capability *cap)
+{
+	strscpy(cap->driver, GE2D_NAME, sizeof(cap->driver));
+	strscpy(cap->card, "Amlogic GE2D", sizeof(cap->card));
+	strscpy(cap->bus_info, "platform:" GE2D_NAME, sizeof(cap->bus_info));
+
+	return 0;
+}
+
+static int vidioc_enum_fmt(struct file *file, void *priv,
+			   struct v4l2_fmtdesc *f)
+{
+	bool capture = !V4L2_TYPE_IS_OUTPUT(f->type);
+	int i, num = 0;
+
+	for (i = 0; i < ARRAY_SIZE(formats); i++) {
+		if (capture && formats[i].src_only)
+			continue;
+		if (num++ == f->index) {
+			f->pixelformat = formats[i].fourcc;
+			return 0;
+		}
+	}
+
+	return -EINVAL;
+}
+
+static int vidioc_g_fmt(struct file *file, void *priv, struct v4l2_format *f)
+{
+	struct ge2d_ctx *ctx = priv;
+	struct ge2d_frame *frm = get_frame(ctx, f->type);
+	struct v4l2_pix_format *pix = &f->fmt.pix;
+
+	pix->pixelformat = frm->fmt->fourcc;
+	pix->width = frm->width;
+	pix->height = frm->height;
+	pix->bytesperline = frm->bytesperline;
+	pix->sizeimage = frm->sizeimage;
+	pix->field = V4L2_FIELD_NONE;
+	pix->colorspace = frm->colorspace;
+
+	return 0;
+}
+
+static int vidioc_try_fmt(struct file *file, void *priv, struct v4l2_format *f)
+{
+	struct v4l2_pix_format *pix = &f->fmt.pix;
+	const struct ge2d_fmt *fmt;
+	struct ge2d_frame frm;
+
+	fmt = find_fmt(pix->pixelformat, !V4L2_TYPE_IS_OUTPUT(f->type));
+	if (!fmt)
+		fmt = &formats[0];
+
+	ge2d_frame_set(&frm, fmt, pix->width, pix->height);
+
+	pix->pixelformat = fmt->fourcc;
+	pix->width = frm.width;
+	pix->height = frm.height;
+	pix->bytesperline = frm.bytesperline;
+	pix->sizeimage = frm.sizeimage;
+	pix->field = V4L2_FIELD_NONE;
+	if (!pix->colorspace)
+		pix->colorspace = fmt->yuv ? V4L2_COLORSPACE_SMPTE170M :
+					     V4L2_COLORSPACE_SRGB;
+
+	return 0;
+}
+
+static int vidioc_s_fmt(struct file *file, void *priv, struct v4l2_format *f)
+{
+	struct ge2d_ctx *ctx = priv;
+	struct ge2d_frame *frm = get_frame(ctx, f->type);
+	struct vb2_queue *vq;
+	int ret;
+
+	vq = v4l2_m2m_get_vq(ctx->fh.m2m_ctx, f->type);
+	if (vb2_is_busy(vq))
+		return -EBUSY;
+
+	ret = vidioc_try_fmt(file, priv, f);
+	if (ret)
+		return ret;
+
+	ge2d_frame_set(frm, find_fmt(f->fmt.pix.pixelformat,
+				     !V4L2_TYPE_IS_OUTPUT(f->type)),
+		       f->fmt.pix.width, f->fmt.pix.height);
+	frm->colorspace = f->fmt.pix.colorspace;
+
+	return 0;
+}
+
+static const struct v4l2_ioctl_ops ge2d_ioctl_ops = {
+	.vidioc_querycap = vidioc_querycap,
+
+	.vidioc_enum_fmt_vid_cap = vidioc_enum_fmt,
+	.vidioc_g_fmt_vid_cap = vidioc_g_fmt,
+	.vidioc_try_fmt_vid_cap = vidioc_try_fmt,
+	.vidioc_s_fmt_vid_cap = vidioc_s_fmt,
+
+	.vidioc_enum_fmt_vid_out = vidioc_enum_fmt,
+	.vidioc_g_fmt_vid_out = vidioc_g_fmt,
+	.vidioc_try_fmt_vid_out = vidioc_try_fmt,
+	.vidioc_s_fmt_vid_out = vidioc_s_fmt,
+
+	.vidioc_reqbufs = v4l2_m2m_ioctl_reqbufs,
+	.vidioc_querybuf = v4l2_m2m_ioctl_querybuf,
+	.vidioc_qbuf = v4l2_m2m_ioctl_qbuf,
+	.vidioc_dqbuf = v4l2_m2m_ioctl_dqbuf,
+	.vidioc_prepare_buf = v4l2_m2m_ioctl_prepare_buf,
+	.vidioc_create_bufs = v4l2_m2m_ioctl_create_bufs,
+	.vidioc_expbuf = v4l2_m2m_ioctl_expbuf,
+
+	.vidioc_streamon = v4l2_m2m_ioctl_streamon,
+	.vidioc_streamoff = v4l2_m2m_ioctl_streamoff,
+
+	.vidioc_subscribe_event = v4l2_ctrl_subscribe_event,
+	.vidioc_unsubscribe_event = v4l2_event_unsubscribe,
+};
+
+static int ge2d_s_ctrl(struct v4l2_ctrl *ctrl)
+{
+	struct ge2d_ctx *ctx = container_of(ctrl->handler, struct ge2d_ctx,
+					    ctrl_handler);
+
+	switch (ctrl->id) {
+	case V4L2_CID_HFLIP:
+		ctx->hflip = ctrl->val;
+		break;
+	case V4L2_CID_VFLIP:
+		ctx->vflip = ctrl->val;
+		break;
+	case V4L2_CID_ROTATE:
+		ctx->rotation = ctrl->val;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static const struct v4l2_ctrl_ops ge2d_ctrl_ops = {
+	.s_ctrl = ge2d_s_ctrl,
+};
+
+static int ge2d_setup_ctrls(struct ge2d_ctx *ctx)
+{
+	struct v4l2_ctrl_handler *hdl = &ctx->ctrl_handler;
+
+	v4l2_ctrl_handler_init(hdl, 3);
+	v4l2_ctrl_new_std(hdl, &ge2d_ctrl_ops, V4L2_CID_HFLIP, 0, 1, 1, 0);
+	v4l2_ctrl_new_std(hdl, &ge2d_ctrl_ops, V4L2_CID_VFLIP, 0, 1, 1, 0);
+	v4l2_ctrl_new_std(hdl, &ge2d_ctrl_ops, V4L2_CID_ROTATE, 0, 270, 90, 0);
+	if (hdl->error) {
+		int err = hdl->error;
+
+		v4l2_ctrl_handler_free(hdl);
+		return err;
+	}
+
+	return v4l2_ctrl_handler_setup(hdl);
+}
+
+static int ge2d_open(struct file *file)
+{
+	struct meson_ge2d *ge2d = video_drvdata(file);
+	struct ge2d_ctx *ctx;
+	int ret;
+
+	ctx = kzalloc(sizeof(*ctx), GFP_KERNEL);
+	if (!ctx)
+		return -ENOMEM;
+	ctx->ge2d = ge2d;
+
+	ge2d_frame_set(&ctx->in, &formats[0], 640, 480);
+	ctx->in.colorspace = V4L2_COLORSPACE_SRGB;
+	ctx->out = ctx->in;
+
+	v4l2_fh_init(&ctx->fh, video_devdata(file));
+	file->private_data = &ctx->fh;
+
+	ctx->fh.m2m_ctx = v4l2_m2m_ctx_init(ge2d->m2m_dev, ctx, &queue_init);
+	if (IS_ERR(ctx->fh.m2m_ctx)) {
+		ret = PTR_ERR(ctx->fh.m2m_ctx);
+		goto err_free;
+	}
+
+	ret = ge2d_setup_ctrls(ctx);
+	if (ret)
+		goto err_m2m;
+	ctx->fh.ctrl_handler = &ctx->ctrl_handler;
+
+	v4l2_fh_add(&ctx->fh);
+
+	return 0;
+
+err_m2m:
+	v4l2_m2m_ctx_release(ctx->fh.m2m_ctx);
+err_free:
+	v4l2_fh_exit(&ctx->fh);
+	kfree(ctx);
+	return ret;
+}
+
+static int ge2d_release(struct file *file)
+{
+	struct ge2d_ctx *ctx = file_to_ctx(file);
+	struct meson_ge2d *ge2d = ctx->ge2d;
+
+	mutex_lock(&ge2d->mutex);
+	v4l2_m2m_ctx_release(ctx->fh.m2m_ctx);
+	mutex_unlock(&ge2d->mutex);
+
+	v4l2_ctrl_handler_free(&ctx->ctrl_handler);
+	v4l2_fh_del(&ctx->fh);
+	v4l2_fh_exit(&ctx->fh);
+	kfree(ctx);
+
+	return 0;
+}
+
+static const struct v4l2_file_operations ge2d_fops = {
+	.owner = THIS_MODULE,
+	.open = ge2d_open,
+	.release = ge2d_release,
+	.poll = v4l2_m2m_fop_poll,
+	.unlocked_ioctl = video_ioctl2,
+	.mmap = v4l2_m2m_fop_mmap,
+};
+
+static const struct regmap_config ge2d_regmap_conf = {
+	.reg_bits = 8,
+	.val_bits = 32,
+	.reg_stride = 4,
+	.max_register = GE2D_DP_ONOFF_CTRL,
+};
+
+static int ge2d_probe(struct platform_device *pdev)
+{
+	struct device *dev = &pdev->dev;
+	struct reset_control *rst;
+	struct video_device *vfd;
+	struct meson_ge2d *ge2d;
+	struct resource *res;
+	void __iomem *regs;
+	int ret, irq;
+
+	ge2d = devm_kzalloc(dev, sizeof(*ge2d), GFP_KERNEL);
+	if (!ge2d)
+		return -ENOMEM;
+
+	ge2d->dev = dev;
+	mutex_init(&ge2d->mutex);
+
+	res = platform_get_resource(pdev, IORESOURCE_MEM, 0);
+	regs = devm_ioremap_resource(dev, res);
+	if (IS_ERR(regs))
+		return PTR_ERR(regs);
+
+	ge2d->map = devm_regmap_init_mmio(dev, regs, &ge2d_regmap_conf);
+	if (IS_ERR(ge2d->map))
+		return PTR_ERR(ge2d->map);
+
+	irq = platform_get_irq(pdev, 0);
+	if (irq < 0)
+		return irq;
+
+	ret = devm_request_irq(dev, irq, ge2d_isr, 0, dev_name(dev), ge2d);
+	if (ret < 0) {
+		dev_err(dev, "failed to request irq\n");
+		return ret;
+	}
+
+	rst = devm_reset_control_get(dev, NULL);
+	if (IS_ERR(rst)) {
+		if (PTR_ERR(rst) != -EPROBE_DEFER)
+			dev_err(dev, "failed to get core reset\n");
+		return PTR_ERR(rst);
+	}
+
+	ge2d->clk = devm_clk_get(dev, NULL);
+	if (IS_ERR(ge2d->clk)) {
+		if (PTR_ERR(ge2d->clk) != -EPROBE_DEFER)
+			dev_err(dev, "failed to get clock\n");
+		return PTR_ERR(ge2d->clk);
+	}
+
+	ge2d->canvas = meson_canvas_get(dev);
+	if (IS_ERR(ge2d->canvas))
+		return PTR_ERR(ge2d->canvas);
+
+	ret = meson_canvas_alloc_range(ge2d->canvas, &ge2d->canvas_idx,
+				       NUM_CANVAS);
+	if (ret)
+		return ret;
+
+	reset_control_reset(rst);
+
+	ret = clk_prepare_enable(ge2d->clk);
+	if (ret) {
+		dev_err(dev, "Cannot enable ge2d sclk: %d\n", ret);
+		goto err_free_canvas;
+	}
+
+	regmap_update_bits(ge2d->map, GE2D_GEN_CTRL1, GE2D_SOFT_RST,
+			   GE2D_SOFT_RST);
+	regmap_update_bits(ge2d->map, GE2D_GEN_CTRL1, GE2D_SOFT_RST, 0);
+	regmap_update_bits(ge2d->map, GE2D_GEN_CTRL1, GE2D_INTERRUPT_CTRL,
+			   FIELD_PREP(GE2D_INTERRUPT_CTRL,
+				      GE2D_INTERRUPT_CMD_DONE));
+
+	ret = v4l2_device_register(dev, &ge2d->v4l2_dev);
+	if (ret)
+		goto err_disable_clk;
+
+	vfd = video_device_alloc();
+	if (!vfd) {
+		v4l2_err(&ge2d->v4l2_dev, "Failed to allocate video device\n");
+		ret = -ENOMEM;
+		goto err_unreg_v4l2_dev;
+	}
+
+	strscpy(vfd->name, GE2D_NAME, sizeof(vfd->name));
+	vfd->fops = &ge2d_fops;
+	vfd->ioctl_ops = &ge2d_ioctl_ops;
+	vfd->release = video_device_release;
+	vfd->lock = &ge2d->mutex;
+	vfd->vfl_dir = VFL_DIR_M2M;
+	vfd->v4l2_dev = &ge2d->v4l2_dev;
+	vfd->device_caps = V4L2_CAP_VIDEO_M2M | V4L2_CAP_STREAMING;
+	ge2d->vfd = vfd;
+
+	platform_set_drvdata(pdev, ge2d);
+	video_set_drvdata(vfd, ge2d);
+
+	ge2d->m2m_dev = v4l2_m2m_init(&ge2d_m2m_ops);
+	if (IS_ERR(ge2d->m2m_dev)) {
+		v4l2_err(&ge2d->v4l2_dev, "Failed to init mem2mem device\n");
+		ret = PTR_ERR(ge2d->m2m_dev);
+		goto err_release_vdev;
+	}
+
+	ret = video_register_device(vfd, VFL_TYPE_GRABBER, -1);
+	if (ret) {
+		v4l2_err(&ge2d->v4l2_dev, "Failed to register video device\n");
+		goto err_release_m2m;
+	}
+
+	v4l2_info(&ge2d->v4l2_dev, "Registered %s as /dev/%s\n",
+		  vfd->name, video_device_node_name(vfd));
+
+	return 0;
+
+err_release_m2m:
+	v4l2_m2m_release(ge2d->m2m_dev);
+err_release_vdev:
+	video_device_release(vfd);
+err_unreg_v4l2_dev:
+	v4l2_device_unregister(&ge2d->v4l2_dev);
+err_disable_clk:
+	clk_disable_unprepare(ge2d->clk);
+err_free_canvas:
+	meson_canvas_free_range(ge2d->canvas, ge2d->canvas_idx, NUM_CANVAS);
+
+	return ret;
+}
+
+static int ge2d_remove(struct platform_device *pdev)
+{
+	struct meson_ge2d *ge2d = platform_get_drvdata(pdev);
+
+	video_unregister_device(ge2d->vfd);
+	v4l2_m2m_release(ge2d->m2m_dev);
+	v4l2_device_unregister(&ge2d->v4l2_dev);
+	clk_disable_unprepare(ge2d->clk);
+	meson_canvas_free_range(ge2d->canvas, ge2d->canvas_idx, NUM_CANVAS);
+
+	return 0;
+}
+
+static const struct of_device_id meson_ge2d_match[] = {
+	{ .compatible = "amlogic,gxbb-ge2d", },
+	{},
+};
+MODULE_DEVICE_TABLE(of, meson_ge2d_match);
+
+static struct platform_driver ge2d_drv = {
+	.probe = ge2d_probe,
+	.remove = ge2d_remove,
+	.driver = {
+		.name = GE2D_NAME,
+		.of_match_table = meson_ge2d_match,
+	},
+};
+module_platform_driver(ge2d_drv);
+
+MODULE_DESCRIPTION("Amlogic 2D graphics engine driver");
+MODULE_LICENSE("GPL");
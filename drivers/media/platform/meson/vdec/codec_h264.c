@@ -163,8 +163,10 @@ static int codec_h264_start(struct amvdec_session *sess) {
 	struct codec_h264 *h264 = sess->priv;
 
 	/* Allocate some memory for the H.264 decoder's state */
-	h264->workspace_vaddr = dma_alloc_coherent(core->dev, SIZE_WORKSPACE,
-					   &h264->workspace_paddr, GFP_KERNEL);
+	h264->workspace_vaddr = amvdec_pool_alloc(core, AMVDEC_POOL_WORKSPACE,
+						  SIZE_WORKSPACE,
+						  &h264->workspace_paddr,
+						  true);
 	if (!h264->workspace_vaddr) {
 		dev_err(core->dev, "Failed to alloc H.264 Workspace\n");
 		return -ENOMEM;
@@ -201,16 +203,13 @@ static int codec_h264_stop(struct amvdec_session *sess)
 	struct amvdec_core *core = sess->core;
 
 	if (h264->ext_fw_vaddr)
-		dma_free_coherent(core->dev, SIZE_EXT_FW,
-				  h264->ext_fw_vaddr, h264->ext_fw_paddr);
+		amvdec_pool_free(core, AMVDEC_POOL_EXT_FW);
 
 	if (h264->workspace_vaddr)
-		dma_free_coherent(core->dev, SIZE_WORKSPACE,
-				 h264->workspace_vaddr, h264->workspace_paddr);
+		amvdec_pool_free(core, AMVDEC_POOL_WORKSPACE);
 
 	if (h264->ref_vaddr)
-		dma_free_coherent(core->dev, h264->ref_size,
-				  h264->ref_vaddr, h264->ref_paddr);
+		amvdec_pool_free(core, AMVDEC_POOL_MV);
 
 	if (h264->sei_vaddr)
 		dma_free_coherent(core->dev, SIZE_SEI,
@@ -232,8 +231,9 @@ static int codec_h264_load_extended_firmware(struct amvdec_session *sess,
 	if (!h264)
 		return -ENOMEM;
 
-	h264->ext_fw_vaddr = dma_alloc_coherent(core->dev, SIZE_EXT_FW,
-					      &h264->ext_fw_paddr, GFP_KERNEL);
+	h264->ext_fw_vaddr = amvdec_pool_alloc(core, AMVDEC_POOL_EXT_FW,
+					       SIZE_EXT_FW,
+					       &h264->ext_fw_paddr, false);
 	if (!h264->ext_fw_vaddr) {
 		dev_err(core->dev, "Failed to alloc H.264 extended fw\n");
 		kfree(h264);
@@ -294,9 +294,13 @@ static void codec_h264_resume(struct amvdec_session *sess)
 	mb_height = ALIGN(h264->mb_height, 4);
 	mb_total = mb_width * mb_height;
 
+	if (h264->ref_vaddr)
+		amvdec_pool_free(core, AMVDEC_POOL_MV);
+
 	h264->ref_size = mb_total * MB_MV_SIZE * h264->max_refs;
-	h264->ref_vaddr = dma_alloc_coherent(core->dev, h264->ref_size,
-					     &h264->ref_paddr, GFP_KERNEL);
+	h264->ref_vaddr = amvdec_pool_alloc(core, AMVDEC_POOL_MV,
+					    h264->ref_size,
+					    &h264->ref_paddr, true);
 	if (!h264->ref_vaddr) {
 		dev_err(core->dev, "Failed to alloc refs (%u)\n",
 			h264->ref_size);
@@ -0,0 +1,68 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Copyright (C) 2018 Maxime Jourdan <maxi.jourdan@wanadoo.fr>
+ */
+
+#ifndef __MESON_VDEC_HEVC_COMMON_H_
+#define __MESON_VDEC_HEVC_COMMON_H_
+
+#include "vdec.h"
+
+#define PARSER_CMD_SKIP_CFG_0 0x0000090b
+#define PARSER_CMD_SKIP_CFG_1 0x1b14140f
+#define PARSER_CMD_SKIP_CFG_2 0x001b1910
+
+#define MAX_REF_PIC_NUM	24
+
+/* Buffers shared by the HEVC and VP9 decoders, both running on VDEC_HEVC */
+struct codec_hevc_common {
+	/* In case of downsampling (decoding with FBC but outputting in NV12M),
+	 * we need to allocate additional buffers for FBC.
+	 */
+	void      *fbc_buffer_vaddr[MAX_REF_PIC_NUM];
+	dma_addr_t fbc_buffer_paddr[MAX_REF_PIC_NUM];
+
+	/* Motion vector buffers, one per CAPTURE buffer, sized to the stream */
+	void      *mv_vaddr;
+	dma_addr_t mv_paddr;
+	u32 mv_buf_size;
+	u32 mv_size;
+};
+
+/* Returns 1 if we must use framebuffer compression */
+static inline int codec_hevc_use_fbc(u32 pixfmt, int is_10bit)
+{
+	return pixfmt == V4L2_PIX_FMT_AM21C || is_10bit;
+}
+
+/* Returns 1 if we are decoding 10-bit but outputting 8-bit NV12 */
+static inline int codec_hevc_use_downsample(u32 pixfmt, int is_10bit)
+{
+	return pixfmt == V4L2_PIX_FMT_NV12M && is_10bit;
+}
+
+static inline dma_addr_t
+codec_hevc_get_mv_paddr(struct codec_hevc_common *comm, u32 buf_idx)
+{
+	return comm->mv_paddr + buf_idx * comm->mv_buf_size;
+}
+
+/* Write the parser command table used by both the HEVC and VP9 firmwares */
+void codec_hevc_setup_parser_cmd(struct amvdec_core *core);
+
+/* Configure decode head read mode */
+void codec_hevc_setup_decode_head(struct amvdec_session *sess, int is_10bit);
+
+/*
+ * Allocate the MV buffers (mv_buf_size bytes per CAPTURE buffer) and
+ * the FBC buffers if downsampling, then program the canvas table with
+ * the CAPTURE buffers
+ */
+int codec_hevc_setup_buffers(struct amvdec_session *sess,
+			     struct codec_hevc_common *comm,
+			     int is_10bit, u32 mv_buf_size);
+
+void codec_hevc_free_buffers(struct amvdec_session *sess,
+			     struct codec_hevc_common *comm);
+
+#endif
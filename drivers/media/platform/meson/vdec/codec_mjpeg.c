@@ -38,7 +38,28 @@ static const uint32_t filt_coef[] = {
 	0x10303010
 };
 
-static void codec_mjpeg_init_scaler(struct amvdec_core *core)
+/*
+ * The firmware sends the decoded blocks through PSCALE on their way to the
+ * CAPTURE buffer. Its steps are 16.16 input to output ratios, 1:1 unless
+ * userspace picked a smaller CAPTURE format than the coded picture.
+ */
+static u32 codec_mjpeg_scale_step(struct amvdec_session *sess)
+{
+	if (sess->width >= sess->coded_width)
+		return 1 << 16;
+
+	/* Same ratio in both directions */
+	if (abs((int)(sess->coded_height * sess->width) -
+		(int)(sess->height * sess->coded_width)) >= sess->coded_width)
+		dev_warn(sess->core->dev,
+			 "%ux%u isn't %ux%u scaled evenly, the picture will be distorted\n",
+			 sess->width, sess->height,
+			 sess->coded_width, sess->coded_height);
+
+	return DIV_ROUND_UP(sess->coded_width << 16, sess->width);
+}
+
+static void codec_mjpeg_init_scaler(struct amvdec_core *core, u32 step)
 {
 	int i;
 
@@ -68,14 +89,14 @@ static void codec_mjpeg_init_scaler(struct amvdec_core *core)
 	amvdec_write_dos(core, PSCALE_BMEM_DAT, 0x60000000);
 
 	amvdec_write_dos(core, PSCALE_BMEM_ADDR, 73);
-	amvdec_write_dos(core, PSCALE_BMEM_DAT, 0x10000);
+	amvdec_write_dos(core, PSCALE_BMEM_DAT, step);
 	amvdec_write_dos(core, PSCALE_BMEM_ADDR, 81);
-	amvdec_write_dos(core, PSCALE_BMEM_DAT, 0x10000);
+	amvdec_write_dos(core, PSCALE_BMEM_DAT, step);
 
 	amvdec_write_dos(core, PSCALE_BMEM_ADDR, 77);
-	amvdec_write_dos(core, PSCALE_BMEM_DAT, 0x10000);
+	amvdec_write_dos(core, PSCALE_BMEM_DAT, step);
 	amvdec_write_dos(core, PSCALE_BMEM_ADDR, 85);
-	amvdec_write_dos(core, PSCALE_BMEM_DAT, 0x10000);
+	amvdec_write_dos(core, PSCALE_BMEM_DAT, step);
 
 	amvdec_write_dos(core, PSCALE_RST, 0x7);
 	amvdec_write_dos(core, PSCALE_RST, 0);
@@ -90,7 +111,7 @@ static int codec_mjpeg_start(struct amvdec_session *sess)
 
 	amvdec_set_canvases(sess, (u32[]){ AV_SCRATCH_4, 0 },
 				    (u32[]){ 4, 0 });
-	codec_mjpeg_init_scaler(core);
+	codec_mjpeg_init_scaler(core, codec_mjpeg_scale_step(sess));
 
 	amvdec_write_dos(core, MREG_TO_AMRISC, 0);
 	amvdec_write_dos(core, MREG_FROM_AMRISC, 0);
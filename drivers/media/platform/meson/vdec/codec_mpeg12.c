@@ -70,9 +70,11 @@ static int codec_mpeg12_start(struct amvdec_session *sess)
 		return -ENOMEM;
 
 	/* Allocate some memory for the MPEG1/2 decoder's state */
-	mpeg12->workspace_vaddr = dma_alloc_coherent(core->dev, SIZE_WORKSPACE,
-						     &mpeg12->workspace_paddr,
-						     GFP_KERNEL);
+	mpeg12->workspace_vaddr = amvdec_pool_alloc(core,
+						    AMVDEC_POOL_WORKSPACE,
+						    SIZE_WORKSPACE,
+						    &mpeg12->workspace_paddr,
+						    true);
 	if (!mpeg12->workspace_vaddr) {
 		dev_err(core->dev, "Failed to request MPEG 1/2 Workspace\n");
 		ret = -ENOMEM;
@@ -105,8 +107,7 @@ static int codec_mpeg12_start(struct amvdec_session *sess)
 	return 0;
 
 free_workspace:
-	dma_free_coherent(core->dev, SIZE_WORKSPACE, mpeg12->workspace_vaddr,
-			  mpeg12->workspace_paddr);
+	amvdec_pool_free(core, AMVDEC_POOL_WORKSPACE);
 free_mpeg12:
 	kfree(mpeg12);
 
@@ -119,9 +120,7 @@ static int codec_mpeg12_stop(struct amvdec_session *sess)
 	struct amvdec_core *core = sess->core;
 
 	if (mpeg12->workspace_vaddr)
-		dma_free_coherent(core->dev, SIZE_WORKSPACE,
-				  mpeg12->workspace_vaddr,
-				  mpeg12->workspace_paddr);
+		amvdec_pool_free(core, AMVDEC_POOL_WORKSPACE);
 
 	return 0;
 }
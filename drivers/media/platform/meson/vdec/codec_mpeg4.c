@@ -51,9 +51,10 @@ static int codec_mpeg4_start(struct amvdec_session *sess) {
 		return -ENOMEM;
 
 	/* Allocate some memory for the MPEG4 decoder's state */
-	mpeg4->workspace_vaddr = dma_alloc_coherent(core->dev, SIZE_WORKSPACE,
-						    &mpeg4->workspace_paddr,
-						    GFP_KERNEL);
+	mpeg4->workspace_vaddr = amvdec_pool_alloc(core, AMVDEC_POOL_WORKSPACE,
+						   SIZE_WORKSPACE,
+						   &mpeg4->workspace_paddr,
+						   true);
 	if (!mpeg4->workspace_vaddr) {
 		dev_err(core->dev, "Failed to request MPEG4 Workspace\n");
 		ret = -ENOMEM;
@@ -89,9 +90,7 @@ static int codec_mpeg4_stop(struct amvdec_session *sess)
 	struct amvdec_core *core = sess->core;
 
 	if (mpeg4->workspace_vaddr) {
-		dma_free_coherent(core->dev, SIZE_WORKSPACE,
-				  mpeg4->workspace_vaddr,
-				  mpeg4->workspace_paddr);
+		amvdec_pool_free(core, AMVDEC_POOL_WORKSPACE);
 		mpeg4->workspace_vaddr = 0;
 	}
 
@@ -0,0 +1,1558 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Copyright (C) 2018 Maxime Jourdan <maxi.jourdan@wanadoo.fr>
+ * Copyright (C) 2015 Amlogic, Inc. All rights reserved.
+ */
+
+#include <media/v4l2-mem2mem.h>
+#include <media/videobuf2-dma-contig.h>
+
+#include "codec_vp9.h"
+#include "codec_hevc_common.h"
+#include "dos_regs.h"
+#include "hevc_regs.h"
+#include "vdec_helpers.h"
+
+/* HEVC reg mapping */
+#define VP9_DEC_STATUS_REG	HEVC_ASSIST_SCRATCH_0
+	#define VP9_10B_DECODE_SLICE	5
+	#define VP9_HEAD_PARSER_DONE	0xf0
+#define VP9_RPM_BUFFER		HEVC_ASSIST_SCRATCH_1
+#define VP9_SHORT_TERM_RPS	HEVC_ASSIST_SCRATCH_2
+#define VP9_ADAPT_PROB_REG	HEVC_ASSIST_SCRATCH_3
+	#define VP9_REQ_ADAPT_PROB	0xfd
+#define VP9_MMU_MAP_BUFFER	HEVC_ASSIST_SCRATCH_4
+#define VP9_PPS_BUFFER		HEVC_ASSIST_SCRATCH_5
+#define VP9_SAO_UP		HEVC_ASSIST_SCRATCH_6
+#define VP9_STREAM_SWAP_BUFFER	HEVC_ASSIST_SCRATCH_7
+#define VP9_STREAM_SWAP_BUFFER2	HEVC_ASSIST_SCRATCH_8
+#define VP9_PROB_SWAP_BUFFER	HEVC_ASSIST_SCRATCH_9
+#define VP9_COUNT_SWAP_BUFFER	HEVC_ASSIST_SCRATCH_A
+#define VP9_SEG_MAP_BUFFER	HEVC_ASSIST_SCRATCH_B
+#define VP9_SCALELUT		HEVC_ASSIST_SCRATCH_D
+#define VP9_WAIT_FLAG		HEVC_ASSIST_SCRATCH_E
+#define LMEM_DUMP_ADR		HEVC_ASSIST_SCRATCH_F
+#define NAL_SEARCH_CTL		HEVC_ASSIST_SCRATCH_I
+#define VP9_DECODE_MODE		HEVC_ASSIST_SCRATCH_J
+	#define DECODE_MODE_SINGLE 0
+#define DECODE_STOP_POS		HEVC_ASSIST_SCRATCH_K
+
+/* VP9 Constants */
+#define LCU_SIZE		64
+#define REFS_PER_FRAME		3
+#define REF_FRAMES		8
+#define MV_MEM_UNIT		0x240
+#define ADAPT_PROB_SIZE		0xf80
+
+enum FRAME_TYPE {
+	KEY_FRAME = 0,
+	INTER_FRAME = 1,
+	FRAME_TYPES,
+};
+
+/* VP9 Workspace layout */
+#define IPP_SIZE	0x4000
+#define SAO_ABV_SIZE	0x30000
+#define SAO_VB_SIZE	0x30000
+#define SH_TM_RPS_SIZE	0x800
+#define VPS_SIZE	0x800
+#define SPS_SIZE	0x800
+#define PPS_SIZE	0x2000
+#define SAO_UP_SIZE	0x2800
+#define SWAP_BUF_SIZE	0x800
+#define SWAP_BUF2_SIZE	0x800
+#define SCALELUT_SIZE	0x8000
+#define DBLK_PARA_SIZE	0x80000
+#define DBLK_DATA_SIZE	0x80000
+#define SEG_MAP_SIZE	0xd800
+#define PROB_SIZE	0x5000
+#define COUNT_SIZE	0x3000
+#define MMU_VBH_SIZE	0x5000
+#define MPRED_ABV_SIZE	0x10000
+#define RPM_BUF_SIZE	0x100
+#define LMEM_SIZE	0x800
+
+#define IPP_OFFSET       0x00
+#define SAO_ABV_OFFSET   (IPP_OFFSET + IPP_SIZE)
+#define SAO_VB_OFFSET    (SAO_ABV_OFFSET + SAO_ABV_SIZE)
+#define SH_TM_RPS_OFFSET (SAO_VB_OFFSET + SAO_VB_SIZE)
+#define VPS_OFFSET       (SH_TM_RPS_OFFSET + SH_TM_RPS_SIZE)
+#define SPS_OFFSET       (VPS_OFFSET + VPS_SIZE)
+#define PPS_OFFSET       (SPS_OFFSET + SPS_SIZE)
+#define SAO_UP_OFFSET    (PPS_OFFSET + PPS_SIZE)
+#define SWAP_BUF_OFFSET  (SAO_UP_OFFSET + SAO_UP_SIZE)
+#define SWAP_BUF2_OFFSET (SWAP_BUF_OFFSET + SWAP_BUF_SIZE)
+#define SCALELUT_OFFSET  (SWAP_BUF2_OFFSET + SWAP_BUF2_SIZE)
+#define DBLK_PARA_OFFSET (SCALELUT_OFFSET + SCALELUT_SIZE)
+#define DBLK_DATA_OFFSET (DBLK_PARA_OFFSET + DBLK_PARA_SIZE)
+#define SEG_MAP_OFFSET   (DBLK_DATA_OFFSET + DBLK_DATA_SIZE)
+#define PROB_OFFSET      (SEG_MAP_OFFSET + SEG_MAP_SIZE)
+#define COUNT_OFFSET     (PROB_OFFSET + PROB_SIZE)
+#define MMU_VBH_OFFSET   (COUNT_OFFSET + COUNT_SIZE)
+#define MPRED_ABV_OFFSET (MMU_VBH_OFFSET + MMU_VBH_SIZE)
+#define RPM_OFFSET       (MPRED_ABV_OFFSET + MPRED_ABV_SIZE)
+#define LMEM_OFFSET      (RPM_OFFSET + RPM_BUF_SIZE)
+
+#define SIZE_WORKSPACE	ALIGN(LMEM_OFFSET + LMEM_SIZE, 64 * SZ_1K)
+
+/* The probability context the firmware adapts into, within PROB_OFFSET */
+#define PROB_CUR_OFFSET	0x4000
+#define PROB_CTX_SIZE	0x1000
+
+#define NONE           -1
+#define INTRA_FRAME     0
+#define LAST_FRAME      1
+#define GOLDEN_FRAME    2
+#define ALTREF_FRAME    3
+#define MAX_REF_FRAMES  4
+
+/*
+ * Loop filter Thr/Lvl tables: vp9_loop_filter_init() runs once before
+ * decoding starts, vp9_loop_filter_frame_init() before every frame.
+ */
+#define MAX_LOOP_FILTER		63
+#define MAX_REF_LF_DELTAS	4
+#define MAX_MODE_LF_DELTAS	2
+#define SEGMENT_DELTADATA	0
+#define SEGMENT_ABSDATA		1
+#define MAX_SEGMENTS		8
+
+/*
+ * Probability buffer layout, in number of probabilities. The HW packs
+ * them 4 by 4 in the low half of 64-bit words.
+ */
+#define VP9_PARTITION_START      0
+#define VP9_PARTITION_SIZE_STEP  (3 * 4)
+#define VP9_PARTITION_ONE_SIZE   (4 * VP9_PARTITION_SIZE_STEP)
+#define VP9_PARTITION_KEY_START  0
+#define VP9_PARTITION_P_START    VP9_PARTITION_ONE_SIZE
+#define VP9_PARTITION_SIZE       (2 * VP9_PARTITION_ONE_SIZE)
+#define VP9_SKIP_START           (VP9_PARTITION_START + VP9_PARTITION_SIZE)
+#define VP9_SKIP_SIZE            4 /* only use 3 */
+#define VP9_TX_MODE_START        (VP9_SKIP_START + VP9_SKIP_SIZE)
+#define VP9_TX_MODE_SIZE         12
+#define VP9_COEF_START           (VP9_TX_MODE_START + VP9_TX_MODE_SIZE)
+#define VP9_COEF_SIZE_ONE_SET    100 /* ((3 + 5 * 6) * 3 + 1 padding) */
+#define VP9_COEF_SIZE            (4 * 2 * 2 * VP9_COEF_SIZE_ONE_SET)
+#define VP9_INTER_MODE_START     (VP9_COEF_START + VP9_COEF_SIZE)
+#define VP9_INTER_MODE_SIZE      24 /* only use 21 (# * 7) */
+#define VP9_INTERP_START         (VP9_INTER_MODE_START + VP9_INTER_MODE_SIZE)
+#define VP9_INTERP_SIZE          8
+#define VP9_INTRA_INTER_START    (VP9_INTERP_START + VP9_INTERP_SIZE)
+#define VP9_INTRA_INTER_SIZE     4
+#define VP9_COMP_INTER_START     (VP9_INTRA_INTER_START + VP9_INTRA_INTER_SIZE)
+#define VP9_COMP_INTER_SIZE      5
+#define VP9_COMP_REF_START       (VP9_COMP_INTER_START + VP9_COMP_INTER_SIZE)
+#define VP9_COMP_REF_SIZE        5
+#define VP9_SINGLE_REF_START     (VP9_COMP_REF_START + VP9_COMP_REF_SIZE)
+#define VP9_SINGLE_REF_SIZE      10
+#define VP9_IF_Y_MODE_START      (VP9_SINGLE_REF_START + VP9_SINGLE_REF_SIZE)
+#define VP9_IF_Y_MODE_SIZE       36
+#define VP9_IF_UV_MODE_START     (VP9_IF_Y_MODE_START + VP9_IF_Y_MODE_SIZE)
+#define VP9_IF_UV_MODE_SIZE      92 /* only use 90 */
+#define VP9_MV_JOINTS_START      (VP9_IF_UV_MODE_START + VP9_IF_UV_MODE_SIZE)
+#define VP9_MV_JOINTS_SIZE       3
+#define VP9_MV_SIGN_0_START      (VP9_MV_JOINTS_START + VP9_MV_JOINTS_SIZE)
+#define VP9_MV_SIGN_0_SIZE       1
+#define VP9_MV_CLASSES_0_START   (VP9_MV_SIGN_0_START + VP9_MV_SIGN_0_SIZE)
+#define VP9_MV_CLASSES_0_SIZE    10
+#define VP9_MV_CLASS0_0_START    (VP9_MV_CLASSES_0_START + VP9_MV_CLASSES_0_SIZE)
+#define VP9_MV_CLASS0_0_SIZE     1
+#define VP9_MV_BITS_0_START      (VP9_MV_CLASS0_0_START + VP9_MV_CLASS0_0_SIZE)
+#define VP9_MV_BITS_0_SIZE       10
+#define VP9_MV_SIGN_1_START      (VP9_MV_BITS_0_START + VP9_MV_BITS_0_SIZE)
+#define VP9_MV_SIGN_1_SIZE       1
+#define VP9_MV_CLASSES_1_START   (VP9_MV_SIGN_1_START + VP9_MV_SIGN_1_SIZE)
+#define VP9_MV_CLASSES_1_SIZE    10
+#define VP9_MV_CLASS0_1_START    (VP9_MV_CLASSES_1_START + VP9_MV_CLASSES_1_SIZE)
+#define VP9_MV_CLASS0_1_SIZE     1
+#define VP9_MV_BITS_1_START      (VP9_MV_CLASS0_1_START + VP9_MV_CLASS0_1_SIZE)
+#define VP9_MV_BITS_1_SIZE       10
+#define VP9_MV_CLASS0_FP_0_START (VP9_MV_BITS_1_START + VP9_MV_BITS_1_SIZE)
+#define VP9_MV_CLASS0_FP_0_SIZE  9
+#define VP9_MV_CLASS0_FP_1_START \
+	(VP9_MV_CLASS0_FP_0_START + VP9_MV_CLASS0_FP_0_SIZE)
+#define VP9_MV_CLASS0_FP_1_SIZE  9
+#define VP9_MV_CLASS0_HP_0_START \
+	(VP9_MV_CLASS0_FP_1_START + VP9_MV_CLASS0_FP_1_SIZE)
+#define VP9_MV_CLASS0_HP_0_SIZE  2
+#define VP9_MV_CLASS0_HP_1_START \
+	(VP9_MV_CLASS0_HP_0_START + VP9_MV_CLASS0_HP_0_SIZE)
+#define VP9_MV_CLASS0_HP_1_SIZE  2
+
+/* Symbol counts layout, in number of 32-bit counters */
+#define VP9_COEF_COUNT_START           0
+#define VP9_COEF_COUNT_SIZE_ONE_SET    165 /* ((3 + 5 * 6) * 5 */
+#define VP9_COEF_COUNT_SIZE            (4 * 2 * 2 * VP9_COEF_COUNT_SIZE_ONE_SET)
+#define VP9_INTRA_INTER_COUNT_START    \
+	(VP9_COEF_COUNT_START + VP9_COEF_COUNT_SIZE)
+#define VP9_INTRA_INTER_COUNT_SIZE     (4 * 2)
+#define VP9_COMP_INTER_COUNT_START     \
+	(VP9_INTRA_INTER_COUNT_START + VP9_INTRA_INTER_COUNT_SIZE)
+#define VP9_COMP_INTER_COUNT_SIZE      (5 * 2)
+#define VP9_COMP_REF_COUNT_START       \
+	(VP9_COMP_INTER_COUNT_START + VP9_COMP_INTER_COUNT_SIZE)
+#define VP9_COMP_REF_COUNT_SIZE        (5 * 2)
+#define VP9_SINGLE_REF_COUNT_START     \
+	(VP9_COMP_REF_COUNT_START + VP9_COMP_REF_COUNT_SIZE)
+#define VP9_SINGLE_REF_COUNT_SIZE      (10 * 2)
+#define VP9_TX_MODE_COUNT_START        \
+	(VP9_SINGLE_REF_COUNT_START + VP9_SINGLE_REF_COUNT_SIZE)
+#define VP9_TX_MODE_COUNT_SIZE         (12 * 2)
+#define VP9_SKIP_COUNT_START           \
+	(VP9_TX_MODE_COUNT_START + VP9_TX_MODE_COUNT_SIZE)
+#define VP9_SKIP_COUNT_SIZE            (3 * 2)
+#define VP9_MV_SIGN_0_COUNT_START      \
+	(VP9_SKIP_COUNT_START + VP9_SKIP_COUNT_SIZE)
+#define VP9_MV_SIGN_0_COUNT_SIZE       (1 * 2)
+#define VP9_MV_SIGN_1_COUNT_START      \
+	(VP9_MV_SIGN_0_COUNT_START + VP9_MV_SIGN_0_COUNT_SIZE)
+#define VP9_MV_SIGN_1_COUNT_SIZE       (1 * 2)
+#define VP9_MV_BITS_0_COUNT_START      \
+	(VP9_MV_SIGN_1_COUNT_START + VP9_MV_SIGN_1_COUNT_SIZE)
+#define VP9_MV_BITS_0_COUNT_SIZE       (10 * 2)
+#define VP9_MV_BITS_1_COUNT_START      \
+	(VP9_MV_BITS_0_COUNT_START + VP9_MV_BITS_0_COUNT_SIZE)
+#define VP9_MV_BITS_1_COUNT_SIZE       (10 * 2)
+#define VP9_MV_CLASS0_HP_0_COUNT_START \
+	(VP9_MV_BITS_1_COUNT_START + VP9_MV_BITS_1_COUNT_SIZE)
+#define VP9_MV_CLASS0_HP_0_COUNT_SIZE  (2 * 2)
+#define VP9_MV_CLASS0_HP_1_COUNT_START \
+	(VP9_MV_CLASS0_HP_0_COUNT_START + VP9_MV_CLASS0_HP_0_COUNT_SIZE)
+#define VP9_MV_CLASS0_HP_1_COUNT_SIZE  (2 * 2)
+#define VP9_INTER_MODE_COUNT_START     \
+	(VP9_MV_CLASS0_HP_1_COUNT_START + VP9_MV_CLASS0_HP_1_COUNT_SIZE)
+#define VP9_INTER_MODE_COUNT_SIZE      (7 * 4)
+#define VP9_IF_Y_MODE_COUNT_START      \
+	(VP9_INTER_MODE_COUNT_START + VP9_INTER_MODE_COUNT_SIZE)
+#define VP9_IF_Y_MODE_COUNT_SIZE       (10 * 4)
+#define VP9_IF_UV_MODE_COUNT_START     \
+	(VP9_IF_Y_MODE_COUNT_START + VP9_IF_Y_MODE_COUNT_SIZE)
+#define VP9_IF_UV_MODE_COUNT_SIZE      (10 * 10)
+#define VP9_PARTITION_P_COUNT_START    \
+	(VP9_IF_UV_MODE_COUNT_START + VP9_IF_UV_MODE_COUNT_SIZE)
+#define VP9_PARTITION_P_COUNT_SIZE     (4 * 4 * 4)
+#define VP9_INTERP_COUNT_START         \
+	(VP9_PARTITION_P_COUNT_START + VP9_PARTITION_P_COUNT_SIZE)
+#define VP9_INTERP_COUNT_SIZE          (4 * 3)
+#define VP9_MV_JOINTS_COUNT_START      \
+	(VP9_INTERP_COUNT_START + VP9_INTERP_COUNT_SIZE)
+#define VP9_MV_JOINTS_COUNT_SIZE       (1 * 4)
+#define VP9_MV_CLASSES_0_COUNT_START   \
+	(VP9_MV_JOINTS_COUNT_START + VP9_MV_JOINTS_COUNT_SIZE)
+#define VP9_MV_CLASSES_0_COUNT_SIZE    (1 * 11)
+#define VP9_MV_CLASS0_0_COUNT_START    \
+	(VP9_MV_CLASSES_0_COUNT_START + VP9_MV_CLASSES_0_COUNT_SIZE)
+#define VP9_MV_CLASS0_0_COUNT_SIZE     (1 * 2)
+#define VP9_MV_CLASSES_1_COUNT_START   \
+	(VP9_MV_CLASS0_0_COUNT_START + VP9_MV_CLASS0_0_COUNT_SIZE)
+#define VP9_MV_CLASSES_1_COUNT_SIZE    (1 * 11)
+#define VP9_MV_CLASS0_1_COUNT_START    \
+	(VP9_MV_CLASSES_1_COUNT_START + VP9_MV_CLASSES_1_COUNT_SIZE)
+#define VP9_MV_CLASS0_1_COUNT_SIZE     (1 * 2)
+#define VP9_MV_CLASS0_FP_0_COUNT_START \
+	(VP9_MV_CLASS0_1_COUNT_START + VP9_MV_CLASS0_1_COUNT_SIZE)
+#define VP9_MV_CLASS0_FP_0_COUNT_SIZE  (3 * 4)
+#define VP9_MV_CLASS0_FP_1_COUNT_START \
+	(VP9_MV_CLASS0_FP_0_COUNT_START + VP9_MV_CLASS0_FP_0_COUNT_SIZE)
+#define VP9_MV_CLASS0_FP_1_COUNT_SIZE  (3 * 4)
+
+#define DC_PRED    0	/* Average of above and left pixels */
+#define V_PRED     1	/* Vertical */
+#define H_PRED     2	/* Horizontal */
+#define D45_PRED   3	/* Directional 45  deg = round(arctan(1/1) * 180/pi) */
+#define D135_PRED  4	/* Directional 135 deg = 180 - 45 */
+#define D117_PRED  5	/* Directional 117 deg = 180 - 63 */
+#define D153_PRED  6	/* Directional 153 deg = 180 - 27 */
+#define D207_PRED  7	/* Directional 207 deg = 180 + 27 */
+#define D63_PRED   8	/* Directional 63  deg = round(arctan(2/1) * 180/pi) */
+#define TM_PRED    9	/* True-motion */
+
+#define COEF_MAX_UPDATE_FACTOR		112
+#define COEF_MAX_UPDATE_FACTOR_AFTER_KEY 128
+#define COEF_COUNT_SAT			24
+
+#define MODE_MV_COUNT_SAT 20
+static const u8 count_to_update_factor[MODE_MV_COUNT_SAT + 1] = {
+	0, 6, 12, 19, 25, 32, 38, 44, 51, 57, 64,
+	70, 76, 83, 89, 96, 102, 108, 115, 121, 128
+};
+
+/*
+ * Entropy coding trees, in the bitstream format: a positive entry is the
+ * index of the next node pair, a negative (or zero) one the opposite of
+ * the symbol it decodes to. Node i uses probability i / 2.
+ */
+static const s8 vp9_intra_mode_tree[] = {
+	-DC_PRED, 2,
+	-TM_PRED, 4,
+	-V_PRED, 6,
+	8, 12,
+	-H_PRED, 10,
+	-D135_PRED, -D117_PRED,
+	-D45_PRED, 14,
+	-D63_PRED, 16,
+	-D153_PRED, -D207_PRED
+};
+
+/* ZEROMV, then NEARESTMV, NEARMV and NEWMV, in counter order */
+static const s8 vp9_inter_mode_tree[] = {
+	-2, 2,
+	-0, 4,
+	-1, -3
+};
+
+/* Partition types, MV joints and MV fractional parts share this shape */
+static const s8 vp9_4_symbols_tree[] = {
+	-0, 2,
+	-1, 4,
+	-2, -3
+};
+
+static const s8 vp9_switchable_interp_tree[] = {
+	-0, 2,
+	-1, -2
+};
+
+static const s8 vp9_mv_class_tree[] = {
+	-0, 2,
+	-1, 4,
+	6, 8,
+	-2, -3,
+	10, 12,
+	-4, -5,
+	-6, 14,
+	16, 18,
+	-7, -8,
+	-9, -10
+};
+
+static const s8 vp9_mv_class0_tree[] = {
+	-0, -1
+};
+
+/* Trees adapted for inter frames */
+static const struct vp9_tree_adapt {
+	const s8 *tree;
+	u8 tree_len;
+	u8 num_trees;
+	u16 prob_start;
+	u16 count_start;
+} vp9_tree_adapts[] = {
+	{ vp9_inter_mode_tree, ARRAY_SIZE(vp9_inter_mode_tree), 7,
+	  VP9_INTER_MODE_START, VP9_INTER_MODE_COUNT_START },
+	/* 4 intra-frame Y mode trees then 10 UV mode trees */
+	{ vp9_intra_mode_tree, ARRAY_SIZE(vp9_intra_mode_tree), 14,
+	  VP9_IF_Y_MODE_START, VP9_IF_Y_MODE_COUNT_START },
+	{ vp9_4_symbols_tree, ARRAY_SIZE(vp9_4_symbols_tree), 16,
+	  VP9_PARTITION_P_START, VP9_PARTITION_P_COUNT_START },
+	{ vp9_switchable_interp_tree, ARRAY_SIZE(vp9_switchable_interp_tree),
+	  4, VP9_INTERP_START, VP9_INTERP_COUNT_START },
+	{ vp9_4_symbols_tree, ARRAY_SIZE(vp9_4_symbols_tree), 1,
+	  VP9_MV_JOINTS_START, VP9_MV_JOINTS_COUNT_START },
+	{ vp9_mv_class_tree, ARRAY_SIZE(vp9_mv_class_tree), 1,
+	  VP9_MV_CLASSES_0_START, VP9_MV_CLASSES_0_COUNT_START },
+	{ vp9_mv_class0_tree, ARRAY_SIZE(vp9_mv_class0_tree), 1,
+	  VP9_MV_CLASS0_0_START, VP9_MV_CLASS0_0_COUNT_START },
+	/* class0_fp[0], class0_fp[1] then fp */
+	{ vp9_4_symbols_tree, ARRAY_SIZE(vp9_4_symbols_tree), 3,
+	  VP9_MV_CLASS0_FP_0_START, VP9_MV_CLASS0_FP_0_COUNT_START },
+	{ vp9_mv_class_tree, ARRAY_SIZE(vp9_mv_class_tree), 1,
+	  VP9_MV_CLASSES_1_START, VP9_MV_CLASSES_1_COUNT_START },
+	{ vp9_mv_class0_tree, ARRAY_SIZE(vp9_mv_class0_tree), 1,
+	  VP9_MV_CLASS0_1_START, VP9_MV_CLASS0_1_COUNT_START },
+	{ vp9_4_symbols_tree, ARRAY_SIZE(vp9_4_symbols_tree), 3,
+	  VP9_MV_CLASS0_FP_1_START, VP9_MV_CLASS0_FP_1_COUNT_START },
+};
+
+/* Boolean probabilities adapted for inter frames, with 2 counters each */
+static const struct vp9_bool_adapt {
+	u16 prob_start;
+	u16 count_start;
+	u8 num_probs;
+} vp9_bool_adapts[] = {
+	{ VP9_INTRA_INTER_START, VP9_INTRA_INTER_COUNT_START,
+	  VP9_INTRA_INTER_SIZE },
+	/* comp_inter, comp_ref and single_ref are contiguous */
+	{ VP9_COMP_INTER_START, VP9_COMP_INTER_COUNT_START,
+	  VP9_COMP_INTER_SIZE + VP9_COMP_REF_SIZE + VP9_SINGLE_REF_SIZE },
+	{ VP9_TX_MODE_START, VP9_TX_MODE_COUNT_START, VP9_TX_MODE_SIZE },
+	{ VP9_SKIP_START, VP9_SKIP_COUNT_START, 3 },
+	{ VP9_MV_SIGN_0_START, VP9_MV_SIGN_0_COUNT_START, VP9_MV_SIGN_0_SIZE },
+	{ VP9_MV_SIGN_1_START, VP9_MV_SIGN_1_COUNT_START, VP9_MV_SIGN_1_SIZE },
+	{ VP9_MV_BITS_0_START, VP9_MV_BITS_0_COUNT_START, VP9_MV_BITS_0_SIZE },
+	{ VP9_MV_BITS_1_START, VP9_MV_BITS_1_COUNT_START, VP9_MV_BITS_1_SIZE },
+	/* class0_hp and hp, for both components */
+	{ VP9_MV_CLASS0_HP_0_START, VP9_MV_CLASS0_HP_0_COUNT_START,
+	  VP9_MV_CLASS0_HP_0_SIZE + VP9_MV_CLASS0_HP_1_SIZE },
+};
+
+/* Data received from the HW in this form, do not rearrange */
+union rpm_param {
+	struct {
+		u16 data[RPM_BUF_SIZE];
+	} l;
+	struct {
+		u16 profile;
+		u16 show_existing_frame;
+		u16 frame_to_show_idx;
+		u16 frame_type; /* 1 bit */
+		u16 show_frame; /* 1 bit */
+		u16 error_resilient_mode; /* 1 bit */
+		u16 intra_only; /* 1 bit */
+		u16 display_size_present; /* 1 bit */
+		u16 reset_frame_context;
+		u16 refresh_frame_flags;
+		u16 width;
+		u16 height;
+		u16 display_width;
+		u16 display_height;
+		u16 ref_info;
+		u16 same_frame_size;
+		u16 mode_ref_delta_enabled;
+		u16 ref_deltas[4];
+		u16 mode_deltas[2];
+		u16 filter_level;
+		u16 sharpness_level;
+		u16 bit_depth;
+		u16 seg_quant_info[8];
+		u16 seg_enabled;
+		u16 seg_abs_delta;
+		/* bit 15: feature enabled; bit 8, sign; bit[5:0], data */
+		u16 seg_lf_info[8];
+	} p;
+};
+
+enum SEG_LVL_FEATURES {
+	SEG_LVL_ALT_Q = 0,	/* Use alternate Quantizer */
+	SEG_LVL_ALT_LF = 1,	/* Use alternate loop filter value */
+	SEG_LVL_REF_FRAME = 2,	/* Optional Segment reference frame */
+	SEG_LVL_SKIP = 3,	/* Optional Segment (0,0) + skip mode */
+	SEG_LVL_MAX = 4		/* Number of features supported */
+};
+
+struct segmentation {
+	u8 enabled;
+	u8 abs_delta;
+	s16 feature_data[MAX_SEGMENTS][SEG_LVL_MAX];
+	unsigned int feature_mask[MAX_SEGMENTS];
+};
+
+struct loop_filter_thresh {
+	u8 mblim;
+	u8 lim;
+};
+
+struct loop_filter_info_n {
+	struct loop_filter_thresh lfthr[MAX_LOOP_FILTER + 1];
+	u8 lvl[MAX_SEGMENTS][MAX_REF_FRAMES][MAX_MODE_LF_DELTAS];
+};
+
+struct loopfilter {
+	int filter_level;
+
+	int sharpness_level;
+	int last_sharpness_level;
+
+	u8 mode_ref_delta_enabled;
+
+	/* 0 = Intra, Last, GF, ARF */
+	s8 ref_deltas[MAX_REF_LF_DELTAS];
+
+	/* 0 = ZERO_MV, MV */
+	s8 mode_deltas[MAX_MODE_LF_DELTAS];
+};
+
+/* A frame held by the decoder, either being decoded or as a reference */
+struct vp9_frame {
+	struct list_head list;
+	struct vb2_v4l2_buffer *vbuf;
+	int index;
+	int intra_only;
+	int show;
+	int type;
+	/* The buffer was handed to userspace */
+	int done;
+	unsigned int width;
+	unsigned int height;
+};
+
+struct codec_vp9 {
+	/* VP9 context lock */
+	struct mutex lock;
+
+	/* Common part with the HEVC decoder */
+	struct codec_hevc_common common;
+
+	/* Buffer for the VP9 Workspace */
+	void      *workspace_vaddr;
+	dma_addr_t workspace_paddr;
+
+	/* Contains many information parsed from the bitstream */
+	union rpm_param rpm_param;
+
+	/* Whether we detected the bitstream as 10-bit */
+	int is_10bit;
+
+	/* Coded resolution reported by the hardware */
+	u32 width, height;
+
+	/* All frames held by the HW at a given time */
+	struct list_head ref_frames_list;
+	/* Number of those not handed to userspace yet */
+	u32 frames_num;
+
+	/* Buffer indexes held by the 8 VP9 reference slots */
+	int ref_frame_map[REF_FRAMES];
+	/* Same, once the frame being decoded refreshed its slots */
+	int next_ref_frame_map[REF_FRAMES];
+	/* LAST, GOLDEN and ALTREF for the frame being decoded */
+	struct vp9_frame *frame_refs[REFS_PER_FRAME];
+
+	u32 lcu_total;
+
+	/* loop filter */
+	int default_filt_lvl;
+	struct loop_filter_info_n lfi;
+	struct loopfilter lf;
+	struct segmentation seg_4lf;
+
+	struct vp9_frame *cur_frame;
+	struct vp9_frame *prev_frame;
+};
+
+static int segfeature_active(struct segmentation *seg, int segment_id,
+			     enum SEG_LVL_FEATURES feature_id)
+{
+	return seg->enabled &&
+		(seg->feature_mask[segment_id] & (1 << feature_id));
+}
+
+static int get_segdata(struct segmentation *seg, int segment_id,
+		       enum SEG_LVL_FEATURES feature_id)
+{
+	return seg->feature_data[segment_id][feature_id];
+}
+
+static void vp9_update_sharpness(struct loop_filter_info_n *lfi,
+				 int sharpness_lvl)
+{
+	int lvl;
+
+	/* For each possible value for the loop filter fill out limits */
+	for (lvl = 0; lvl <= MAX_LOOP_FILTER; lvl++) {
+		/* Set loop filter parameters that control the filters */
+		int block_inside_limit =
+			lvl >> ((sharpness_lvl > 0) + (sharpness_lvl > 4));
+
+		if (sharpness_lvl > 0) {
+			if (block_inside_limit > (9 - sharpness_lvl))
+				block_inside_limit = (9 - sharpness_lvl);
+		}
+
+		if (block_inside_limit < 1)
+			block_inside_limit = 1;
+
+		lfi->lfthr[lvl].lim = (u8)block_inside_limit;
+		lfi->lfthr[lvl].mblim = (u8)((2 * (lvl + 2) +
+					      block_inside_limit));
+	}
+}
+
+static void vp9_write_lf_thresholds(struct amvdec_core *core,
+				    struct loop_filter_info_n *lfi)
+{
+	int i;
+
+	for (i = 0; i < 32; i++) {
+		unsigned int thr;
+
+		thr = ((lfi->lfthr[i * 2 + 1].lim & 0x3f) << 8) |
+		      (lfi->lfthr[i * 2 + 1].mblim & 0xff);
+		thr = (thr << 16) | ((lfi->lfthr[i * 2].lim & 0x3f) << 8) |
+		      (lfi->lfthr[i * 2].mblim & 0xff);
+
+		amvdec_write_dos(core, HEVC_DBLK_CFG9, thr);
+	}
+}
+
+static void vp9_loop_filter_init(struct amvdec_core *core,
+				 struct codec_vp9 *vp9)
+{
+	struct loop_filter_info_n *lfi = &vp9->lfi;
+	struct loopfilter *lf = &vp9->lf;
+	struct segmentation *seg_4lf = &vp9->seg_4lf;
+
+	memset(lfi, 0, sizeof(struct loop_filter_info_n));
+	memset(lf, 0, sizeof(struct loopfilter));
+	memset(seg_4lf, 0, sizeof(struct segmentation));
+	lf->sharpness_level = 0;
+	vp9_update_sharpness(lfi, lf->sharpness_level);
+	lf->last_sharpness_level = lf->sharpness_level;
+
+	vp9_write_lf_thresholds(core, lfi);
+
+	/* set video format to VP9 */
+	amvdec_write_dos(core, HEVC_DBLK_CFGB, 0x40400001);
+}
+
+static void vp9_loop_filter_frame_init(struct amvdec_core *core,
+				       struct segmentation *seg,
+				       struct loop_filter_info_n *lfi,
+				       struct loopfilter *lf,
+				       int default_filt_lvl)
+{
+	int i;
+	int seg_id;
+
+	/*
+	 * n_shift is the multiplier for lf_deltas
+	 * the multiplier is:
+	 * - 1 for when filter_lvl is between 0 and 31
+	 * - 2 when filter_lvl is between 32 and 63
+	 */
+	const int scale = 1 << (default_filt_lvl >> 5);
+
+	/* update limits if sharpness has changed */
+	if (lf->last_sharpness_level != lf->sharpness_level) {
+		vp9_update_sharpness(lfi, lf->sharpness_level);
+		lf->last_sharpness_level = lf->sharpness_level;
+		vp9_write_lf_thresholds(core, lfi);
+	}
+
+	for (seg_id = 0; seg_id < MAX_SEGMENTS; seg_id++) {
+		int lvl_seg = default_filt_lvl;
+
+		if (segfeature_active(seg, seg_id, SEG_LVL_ALT_LF)) {
+			const int data = get_segdata(seg, seg_id,
+						     SEG_LVL_ALT_LF);
+			lvl_seg = clamp_t(int,
+					  seg->abs_delta == SEGMENT_ABSDATA ?
+						data : default_filt_lvl + data,
+					  0, MAX_LOOP_FILTER);
+		}
+
+		if (!lf->mode_ref_delta_enabled) {
+			/*
+			 * We could get rid of this if we assume that deltas
+			 * are set to zero when not in use.
+			 * encoder always uses deltas
+			 */
+			memset(lfi->lvl[seg_id], lvl_seg,
+			       sizeof(lfi->lvl[seg_id]));
+		} else {
+			int ref, mode;
+			const int intra_lvl =
+				lvl_seg + lf->ref_deltas[INTRA_FRAME] * scale;
+
+			lfi->lvl[seg_id][INTRA_FRAME][0] =
+				clamp_val(intra_lvl, 0, MAX_LOOP_FILTER);
+
+			for (ref = LAST_FRAME; ref < MAX_REF_FRAMES; ++ref) {
+				for (mode = 0; mode < MAX_MODE_LF_DELTAS;
+				     ++mode) {
+					const int inter_lvl =
+						lvl_seg +
+						lf->ref_deltas[ref] * scale +
+						lf->mode_deltas[mode] * scale;
+
+					lfi->lvl[seg_id][ref][mode] =
+						clamp_val(inter_lvl, 0,
+							  MAX_LOOP_FILTER);
+				}
+			}
+		}
+	}
+
+	for (i = 0; i < 16; i++) {
+		unsigned int level;
+
+		level = ((lfi->lvl[i >> 1][3][i & 1] & 0x3f) << 24) |
+			((lfi->lvl[i >> 1][2][i & 1] & 0x3f) << 16) |
+			((lfi->lvl[i >> 1][1][i & 1] & 0x3f) << 8) |
+			(lfi->lvl[i >> 1][0][i & 1] & 0x3f);
+		if (!default_filt_lvl)
+			level = 0;
+
+		amvdec_write_dos(core, HEVC_DBLK_CFGA, level);
+	}
+}
+
+static u8 vp9_get_prob(const u32 *probs, int node)
+{
+	return probs[node / 4 * 2] >> ((node & 3) * 8);
+}
+
+static void vp9_set_prob(u32 *probs, int node, u8 prob)
+{
+	u32 *word = &probs[node / 4 * 2];
+	int shift = (node & 3) * 8;
+
+	*word = (*word & ~(0xffU << shift)) | ((u32)prob << shift);
+}
+
+static u8 vp9_get_binary_prob(u32 n0, u32 n1)
+{
+	u32 den = n0 + n1;
+
+	if (!den)
+		return 128;
+
+	return clamp_val(div_u64((u64)n0 * 256 + (den >> 1), den), 1, 255);
+}
+
+static u8 vp9_weighted_prob(u8 pre_prob, u8 prob, u32 factor)
+{
+	return (pre_prob * (256 - factor) + prob * factor + 128) >> 8;
+}
+
+/* Blend the counts of one boolean into the probability of the last frame */
+static void vp9_merge_prob(const u32 *pre_probs, u32 *probs, int node,
+			   u32 ct0, u32 ct1)
+{
+	u8 pre_prob = vp9_get_prob(pre_probs, node);
+	u32 den = ct0 + ct1;
+	u32 factor;
+
+	if (!den) {
+		vp9_set_prob(probs, node, pre_prob);
+		return;
+	}
+
+	factor = count_to_update_factor[min_t(u32, den, MODE_MV_COUNT_SAT)];
+	vp9_set_prob(probs, node,
+		     vp9_weighted_prob(pre_prob, vp9_get_binary_prob(ct0, ct1),
+				       factor));
+}
+
+/* Returns the number of symbols decoded through node i */
+static u32 vp9_tree_merge_probs(const s8 *tree, int i, const u32 *counts,
+				const u32 *pre_probs, u32 *probs,
+				int prob_start)
+{
+	const int l = tree[i];
+	const u32 left = l <= 0 ? counts[-l] :
+		vp9_tree_merge_probs(tree, l, counts, pre_probs, probs,
+				     prob_start);
+	const int r = tree[i + 1];
+	const u32 right = r <= 0 ? counts[-r] :
+		vp9_tree_merge_probs(tree, r, counts, pre_probs, probs,
+				     prob_start);
+
+	vp9_merge_prob(pre_probs, probs, prob_start + i / 2, left, right);
+
+	return left + right;
+}
+
+static void vp9_adapt_coef_probs(const u32 *pre_probs, u32 *probs,
+				 const u32 *counts, u32 update_factor)
+{
+	int set, band, cxt, node;
+
+	/* 4 transform sizes, 2 planes, intra and inter */
+	for (set = 0; set < 4 * 2 * 2; set++) {
+		int prob = VP9_COEF_START + set * VP9_COEF_SIZE_ONE_SET;
+		int count = VP9_COEF_COUNT_START +
+			    set * VP9_COEF_COUNT_SIZE_ONE_SET;
+
+		for (band = 0; band < 6; band++) {
+			int num_cxt = band ? 6 : 3;
+
+			for (cxt = 0; cxt < num_cxt; cxt++) {
+				const u32 *c = &counts[count];
+				/* ZERO, ONE, TWO+, EOB, !EOB */
+				const u32 branch_ct[3][2] = {
+					{ c[3], c[4] },
+					{ c[0], c[1] + c[2] },
+					{ c[1], c[2] },
+				};
+
+				for (node = 0; node < 3; node++) {
+					u32 den = branch_ct[node][0] +
+						  branch_ct[node][1];
+					u32 factor = update_factor *
+						     min_t(u32, den,
+							   COEF_COUNT_SAT) /
+						     COEF_COUNT_SAT;
+					u8 pre_prob =
+						vp9_get_prob(pre_probs,
+							     prob + node);
+					u8 new_prob =
+						vp9_get_binary_prob(branch_ct[node][0],
+								    branch_ct[node][1]);
+
+					vp9_set_prob(probs, prob + node,
+						     vp9_weighted_prob(pre_prob,
+								       new_prob,
+								       factor));
+				}
+
+				prob += 3;
+				count += 5;
+			}
+
+			/* Band 0 is padded to 10 probabilities */
+			if (!band)
+				prob++;
+		}
+	}
+}
+
+static void vp9_adapt_mode_probs(const u32 *pre_probs, u32 *probs,
+				 const u32 *counts)
+{
+	int i, j;
+
+	for (i = 0; i < ARRAY_SIZE(vp9_bool_adapts); i++) {
+		const struct vp9_bool_adapt *a = &vp9_bool_adapts[i];
+
+		for (j = 0; j < a->num_probs; j++) {
+			const u32 *c = &counts[a->count_start + j * 2];
+
+			vp9_merge_prob(pre_probs, probs, a->prob_start + j,
+				       c[0], c[1]);
+		}
+	}
+
+	for (i = 0; i < ARRAY_SIZE(vp9_tree_adapts); i++) {
+		const struct vp9_tree_adapt *a = &vp9_tree_adapts[i];
+		int num_nodes = a->tree_len / 2;
+
+		for (j = 0; j < a->num_trees; j++)
+			vp9_tree_merge_probs(a->tree, 0,
+					     &counts[a->count_start +
+						     j * (num_nodes + 1)],
+					     pre_probs, probs,
+					     a->prob_start + j * num_nodes);
+	}
+}
+
+/*
+ * Backward adaptation: blend the symbol counts of the frame that was just
+ * decoded into the probabilities it started from. The HW only does the
+ * counting.
+ */
+static void codec_vp9_adapt_probs(struct codec_vp9 *vp9, u32 prob_status)
+{
+	u8 *prob_base = vp9->workspace_vaddr + PROB_OFFSET;
+	u32 *pre_probs = (u32 *)(prob_base + (prob_status >> 8) * PROB_CTX_SIZE);
+	u32 *probs = (u32 *)(prob_base + PROB_CUR_OFFSET);
+	const u32 *counts = vp9->workspace_vaddr + COUNT_OFFSET;
+	struct vp9_frame *frame = vp9->cur_frame;
+	int intra_only = frame->type == KEY_FRAME || frame->intra_only;
+	int prev_kf = !vp9->prev_frame || vp9->prev_frame->type == KEY_FRAME;
+	u32 update_factor = COEF_MAX_UPDATE_FACTOR;
+
+	if (!intra_only && prev_kf)
+		update_factor = COEF_MAX_UPDATE_FACTOR_AFTER_KEY;
+
+	vp9_adapt_coef_probs(pre_probs, probs, counts, update_factor);
+	if (!intra_only)
+		vp9_adapt_mode_probs(pre_probs, probs, counts);
+
+	/* Save the adapted probabilities as the frame's context */
+	memcpy(pre_probs, probs, ADAPT_PROB_SIZE);
+}
+
+static u32 codec_vp9_num_pending_bufs(struct amvdec_session *sess)
+{
+	struct codec_vp9 *vp9 = sess->priv;
+	u32 ret;
+
+	if (!vp9)
+		return 0;
+
+	mutex_lock(&vp9->lock);
+	ret = vp9->frames_num;
+	mutex_unlock(&vp9->lock);
+
+	return ret;
+}
+
+/* Give back all the frames, shown ones to userspace */
+static void codec_vp9_release_frames(struct amvdec_session *sess)
+{
+	struct codec_vp9 *vp9 = sess->priv;
+	struct vp9_frame *tmp, *n;
+
+	list_for_each_entry_safe(tmp, n, &vp9->ref_frames_list, list) {
+		if (!tmp->done) {
+			if (tmp->show)
+				amvdec_dst_buf_done(sess, tmp->vbuf,
+						    V4L2_FIELD_NONE);
+			else
+				v4l2_m2m_buf_queue(sess->m2m_ctx, tmp->vbuf);
+
+			vp9->frames_num--;
+		}
+
+		list_del(&tmp->list);
+		kfree(tmp);
+	}
+
+	memset(vp9->ref_frame_map, -1, sizeof(vp9->ref_frame_map));
+	memset(vp9->next_ref_frame_map, -1, sizeof(vp9->next_ref_frame_map));
+	memset(vp9->frame_refs, 0, sizeof(vp9->frame_refs));
+	vp9->cur_frame = NULL;
+	vp9->prev_frame = NULL;
+}
+
+static void codec_vp9_flush_output(struct amvdec_session *sess)
+{
+	struct codec_vp9 *vp9 = sess->priv;
+
+	mutex_lock(&vp9->lock);
+	codec_vp9_release_frames(sess);
+	mutex_unlock(&vp9->lock);
+}
+
+static void codec_vp9_setup_workspace(struct amvdec_core *core,
+				      struct codec_vp9 *vp9)
+{
+	dma_addr_t wkaddr = vp9->workspace_paddr;
+
+	amvdec_write_dos(core, HEVCD_IPP_LINEBUFF_BASE, wkaddr + IPP_OFFSET);
+	amvdec_write_dos(core, VP9_RPM_BUFFER, wkaddr + RPM_OFFSET);
+	amvdec_write_dos(core, VP9_SHORT_TERM_RPS, wkaddr + SH_TM_RPS_OFFSET);
+	amvdec_write_dos(core, VP9_PPS_BUFFER, wkaddr + PPS_OFFSET);
+	amvdec_write_dos(core, VP9_SAO_UP, wkaddr + SAO_UP_OFFSET);
+
+	/* No MMU */
+	amvdec_write_dos(core, VP9_STREAM_SWAP_BUFFER,
+			 wkaddr + SWAP_BUF_OFFSET);
+	amvdec_write_dos(core, VP9_STREAM_SWAP_BUFFER2,
+			 wkaddr + SWAP_BUF2_OFFSET);
+	amvdec_write_dos(core, VP9_SCALELUT, wkaddr + SCALELUT_OFFSET);
+	amvdec_write_dos(core, HEVC_DBLK_CFG4, wkaddr + DBLK_PARA_OFFSET);
+	amvdec_write_dos(core, HEVC_DBLK_CFG5, wkaddr + DBLK_DATA_OFFSET);
+	amvdec_write_dos(core, VP9_SEG_MAP_BUFFER, wkaddr + SEG_MAP_OFFSET);
+	amvdec_write_dos(core, VP9_PROB_SWAP_BUFFER, wkaddr + PROB_OFFSET);
+	amvdec_write_dos(core, VP9_COUNT_SWAP_BUFFER, wkaddr + COUNT_OFFSET);
+	amvdec_write_dos(core, LMEM_DUMP_ADR, wkaddr + LMEM_OFFSET);
+}
+
+static int codec_vp9_start(struct amvdec_session *sess)
+{
+	struct amvdec_core *core = sess->core;
+	struct codec_vp9 *vp9;
+	u32 val;
+
+	vp9 = kzalloc(sizeof(*vp9), GFP_KERNEL);
+	if (!vp9)
+		return -ENOMEM;
+
+	/* Allocate some memory for the VP9 decoder's state */
+	vp9->workspace_vaddr = amvdec_pool_alloc(core, AMVDEC_POOL_WORKSPACE,
+						 SIZE_WORKSPACE,
+						 &vp9->workspace_paddr, true);
+	if (!vp9->workspace_vaddr) {
+		dev_err(core->dev, "Failed to allocate VP9 Workspace\n");
+		kfree(vp9);
+		return -ENOMEM;
+	}
+
+	codec_vp9_setup_workspace(core, vp9);
+	amvdec_write_dos_bits(core, HEVC_STREAM_CONTROL, BIT(0));
+
+	val = amvdec_read_dos(core, HEVC_PARSER_INT_CONTROL) & 0x7fffffff;
+	val |= (3 << 29) | BIT(24) | BIT(22) | BIT(7) | BIT(4) | BIT(0);
+	amvdec_write_dos(core, HEVC_PARSER_INT_CONTROL, val);
+	amvdec_write_dos_bits(core, HEVC_SHIFT_STATUS, BIT(0));
+	amvdec_write_dos(core, HEVC_SHIFT_CONTROL, BIT(10) | BIT(9) |
+			 (3 << 6) | BIT(5) | BIT(2) | BIT(1) | BIT(0));
+	amvdec_write_dos(core, HEVC_CABAC_CONTROL, BIT(0));
+	amvdec_write_dos(core, HEVC_PARSER_CORE_CONTROL, BIT(0));
+	amvdec_write_dos(core, HEVC_SHIFT_STARTCODE, 0x00000001);
+
+	amvdec_write_dos(core, VP9_DEC_STATUS_REG, 0);
+
+	codec_hevc_setup_parser_cmd(core);
+	amvdec_write_dos(core, HEVC_PARSER_IF_CONTROL,
+			 BIT(5) | BIT(2) | BIT(0));
+
+	amvdec_write_dos(core, HEVCD_IPP_TOP_CNTL, BIT(0));
+	amvdec_write_dos(core, HEVCD_IPP_TOP_CNTL, BIT(1));
+
+	amvdec_write_dos(core, VP9_WAIT_FLAG, 1);
+
+	/* clear mailbox interrupt */
+	amvdec_write_dos(core, HEVC_ASSIST_MBOX1_CLR_REG, 1);
+	/* enable mailbox interrupt */
+	amvdec_write_dos(core, HEVC_ASSIST_MBOX1_MASK, 1);
+	/* disable PSCALE for hardware sharing */
+	amvdec_write_dos(core, HEVC_PSCALE_CTRL, 0);
+	/* Let the uCode do all the parsing */
+	amvdec_write_dos(core, NAL_SEARCH_CTL, 0x8);
+
+	amvdec_write_dos(core, DECODE_STOP_POS, 0);
+	amvdec_write_dos(core, VP9_DECODE_MODE, DECODE_MODE_SINGLE);
+
+	vp9_loop_filter_init(core, vp9);
+
+	INIT_LIST_HEAD(&vp9->ref_frames_list);
+	mutex_init(&vp9->lock);
+	memset(vp9->ref_frame_map, -1, sizeof(vp9->ref_frame_map));
+	memset(vp9->next_ref_frame_map, -1, sizeof(vp9->next_ref_frame_map));
+	sess->priv = vp9;
+
+	return 0;
+}
+
+static int codec_vp9_stop(struct amvdec_session *sess)
+{
+	struct amvdec_core *core = sess->core;
+	struct codec_vp9 *vp9 = sess->priv;
+
+	mutex_lock(&vp9->lock);
+	codec_vp9_release_frames(sess);
+
+	if (vp9->workspace_vaddr)
+		amvdec_pool_free(core, AMVDEC_POOL_WORKSPACE);
+
+	codec_hevc_free_buffers(sess, &vp9->common);
+	mutex_unlock(&vp9->lock);
+	mutex_destroy(&vp9->lock);
+
+	return 0;
+}
+
+/*
+ * Program LAST & GOLDEN frames into the motion compensation reference cache
+ * controller
+ */
+static void codec_vp9_set_mcrcc(struct amvdec_session *sess)
+{
+	struct amvdec_core *core = sess->core;
+	struct codec_vp9 *vp9 = sess->priv;
+	u32 val;
+
+	/* Reset mcrcc */
+	amvdec_write_dos(core, HEVCD_MCRCC_CTL1, 0x2);
+	/* Disable on I-frame */
+	if (vp9->cur_frame->type == KEY_FRAME || vp9->cur_frame->intra_only) {
+		amvdec_write_dos(core, HEVCD_MCRCC_CTL1, 0x0);
+		return;
+	}
+
+	amvdec_write_dos(core, HEVCD_MPP_ANC_CANVAS_ACCCONFIG_ADDR, BIT(1));
+	val = amvdec_read_dos(core, HEVCD_MPP_ANC_CANVAS_DATA_ADDR) & 0xffff;
+	val |= (val << 16);
+	amvdec_write_dos(core, HEVCD_MCRCC_CTL2, val);
+	val = amvdec_read_dos(core, HEVCD_MPP_ANC_CANVAS_DATA_ADDR) & 0xffff;
+	val |= (val << 16);
+	amvdec_write_dos(core, HEVCD_MCRCC_CTL3, val);
+
+	/* Enable mcrcc progressive-mode */
+	amvdec_write_dos(core, HEVCD_MCRCC_CTL1, 0xff0);
+}
+
+static void codec_vp9_set_sao(struct amvdec_session *sess,
+			      struct vb2_buffer *vb)
+{
+	struct amvdec_core *core = sess->core;
+	struct codec_vp9 *vp9 = sess->priv;
+	dma_addr_t buf_y_paddr;
+	dma_addr_t buf_u_v_paddr;
+	u32 val;
+
+	if (codec_hevc_use_downsample(sess->pixfmt_cap, vp9->is_10bit))
+		buf_y_paddr = vp9->common.fbc_buffer_paddr[vb->index];
+	else
+		buf_y_paddr = vb2_dma_contig_plane_dma_addr(vb, 0);
+
+	if (codec_hevc_use_fbc(sess->pixfmt_cap, vp9->is_10bit)) {
+		val = amvdec_read_dos(core, HEVC_SAO_CTRL5) & ~0xff0200;
+		amvdec_write_dos(core, HEVC_SAO_CTRL5, val);
+		amvdec_write_dos(core, HEVC_CM_BODY_START_ADDR, buf_y_paddr);
+	}
+
+	if (sess->pixfmt_cap == V4L2_PIX_FMT_NV12M) {
+		buf_y_paddr = vb2_dma_contig_plane_dma_addr(vb, 0);
+		buf_u_v_paddr = vb2_dma_contig_plane_dma_addr(vb, 1);
+		amvdec_write_dos(core, HEVC_SAO_Y_START_ADDR, buf_y_paddr);
+		amvdec_write_dos(core, HEVC_SAO_C_START_ADDR, buf_u_v_paddr);
+		amvdec_write_dos(core, HEVC_SAO_Y_WPTR, buf_y_paddr);
+		amvdec_write_dos(core, HEVC_SAO_C_WPTR, buf_u_v_paddr);
+	}
+
+	amvdec_write_dos(core, HEVC_SAO_Y_LENGTH,
+			 amvdec_get_output_size(sess));
+	amvdec_write_dos(core, HEVC_SAO_C_LENGTH,
+			 (amvdec_get_output_size(sess) / 2));
+
+	val = amvdec_read_dos(core, HEVC_SAO_CTRL1) & ~0x3ff3;
+	val |= 0xff0; /* Set endianness for 2-bytes swaps (nv12) */
+	if (!codec_hevc_use_fbc(sess->pixfmt_cap, vp9->is_10bit))
+		val |= BIT(0); /* disable cm compression */
+	else if (sess->pixfmt_cap == V4L2_PIX_FMT_AM21C)
+		val |= BIT(1); /* Disable double write */
+
+	amvdec_write_dos(core, HEVC_SAO_CTRL1, val);
+
+	if (!codec_hevc_use_fbc(sess->pixfmt_cap, vp9->is_10bit)) {
+		/* no downscale for NV12 */
+		val = amvdec_read_dos(core, HEVC_SAO_CTRL5) & ~0xff0000;
+		amvdec_write_dos(core, HEVC_SAO_CTRL5, val);
+	}
+
+	val = amvdec_read_dos(core, HEVCD_IPP_AXIIF_CONFIG) & ~0x30;
+	val |= 0xf;
+	amvdec_write_dos(core, HEVCD_IPP_AXIIF_CONFIG, val);
+}
+
+static dma_addr_t codec_vp9_get_frame_mv_paddr(struct codec_vp9 *vp9,
+					       struct vp9_frame *frame)
+{
+	return codec_hevc_get_mv_paddr(&vp9->common, frame->index);
+}
+
+static void codec_vp9_set_mpred_mv(struct amvdec_core *core,
+				   struct codec_vp9 *vp9)
+{
+	struct vp9_frame *cur_frame = vp9->cur_frame;
+	struct vp9_frame *prev_frame = vp9->prev_frame ?: cur_frame;
+	dma_addr_t mpred_mv_rd_start_addr;
+	int use_prev_frame_mvs = prev_frame->width == cur_frame->width &&
+				 prev_frame->height == cur_frame->height &&
+				 !prev_frame->intra_only &&
+				 prev_frame->show &&
+				 prev_frame != cur_frame;
+
+	amvdec_write_dos(core, HEVC_MPRED_CTRL3, 0x24122412);
+	amvdec_write_dos(core, HEVC_MPRED_ABV_START_ADDR,
+			 vp9->workspace_paddr + MPRED_ABV_OFFSET);
+
+	amvdec_clear_dos_bits(core, HEVC_MPRED_CTRL4, BIT(6));
+	if (use_prev_frame_mvs)
+		amvdec_write_dos_bits(core, HEVC_MPRED_CTRL4, BIT(6));
+
+	amvdec_write_dos(core, HEVC_MPRED_MV_WR_START_ADDR,
+			 codec_vp9_get_frame_mv_paddr(vp9, cur_frame));
+	amvdec_write_dos(core, HEVC_MPRED_MV_WPTR,
+			 codec_vp9_get_frame_mv_paddr(vp9, cur_frame));
+
+	mpred_mv_rd_start_addr = codec_vp9_get_frame_mv_paddr(vp9, prev_frame);
+	amvdec_write_dos(core, HEVC_MPRED_MV_RD_START_ADDR,
+			 mpred_mv_rd_start_addr);
+	amvdec_write_dos(core, HEVC_MPRED_MV_RPTR, mpred_mv_rd_start_addr);
+	amvdec_write_dos(core, HEVC_MPRED_MV_RD_END_ADDR,
+			 mpred_mv_rd_start_addr +
+			 (vp9->lcu_total * MV_MEM_UNIT));
+}
+
+static void codec_vp9_update_next_ref(struct codec_vp9 *vp9)
+{
+	union rpm_param *param = &vp9->rpm_param;
+	u32 buf_idx = vp9->cur_frame->index;
+	int refresh_frame_flags;
+	int i;
+
+	refresh_frame_flags = vp9->cur_frame->type == KEY_FRAME ?
+			      0xff : param->p.refresh_frame_flags;
+
+	for (i = 0; i < REF_FRAMES; ++i) {
+		if (refresh_frame_flags & BIT(i))
+			vp9->next_ref_frame_map[i] = buf_idx;
+		else
+			vp9->next_ref_frame_map[i] = vp9->ref_frame_map[i];
+	}
+}
+
+static struct vp9_frame *codec_vp9_get_frame_by_idx(struct codec_vp9 *vp9,
+						    int idx)
+{
+	struct vp9_frame *frame;
+
+	list_for_each_entry(frame, &vp9->ref_frames_list, list) {
+		if (frame->index == idx)
+			return frame;
+	}
+
+	return NULL;
+}
+
+static void codec_vp9_sync_ref(struct codec_vp9 *vp9)
+{
+	union rpm_param *param = &vp9->rpm_param;
+	int i;
+
+	for (i = 0; i < REFS_PER_FRAME; ++i) {
+		const int ref = (param->p.ref_info >>
+				 (((REFS_PER_FRAME - i - 1) * 4) + 1)) & 0x7;
+		const int idx = vp9->ref_frame_map[ref];
+
+		vp9->frame_refs[i] = codec_vp9_get_frame_by_idx(vp9, idx);
+		if (!vp9->frame_refs[i])
+			pr_warn("%s: couldn't find VP9 ref %d\n",
+				__func__, idx);
+	}
+}
+
+static void codec_vp9_set_refs(struct amvdec_session *sess,
+			       struct codec_vp9 *vp9)
+{
+	struct amvdec_core *core = sess->core;
+	int i;
+
+	for (i = 0; i < REFS_PER_FRAME; ++i) {
+		struct vp9_frame *frame = vp9->frame_refs[i];
+		int id_y;
+		int id_u_v;
+
+		if (!frame)
+			continue;
+
+		if (codec_hevc_use_fbc(sess->pixfmt_cap, vp9->is_10bit)) {
+			id_y = frame->index;
+			id_u_v = id_y;
+		} else {
+			id_y = frame->index * 2;
+			id_u_v = id_y + 1;
+		}
+
+		amvdec_write_dos(core, HEVCD_MPP_ANC_CANVAS_DATA_ADDR,
+				 (id_u_v << 16) | (id_u_v << 8) | id_y);
+	}
+}
+
+static void codec_vp9_set_mc(struct amvdec_session *sess,
+			     struct codec_vp9 *vp9)
+{
+	struct amvdec_core *core = sess->core;
+	u32 scale = 0;
+	u32 sz;
+	int i;
+
+	amvdec_write_dos(core, HEVCD_MPP_ANC_CANVAS_ACCCONFIG_ADDR, 1);
+	codec_vp9_set_refs(sess, vp9);
+	amvdec_write_dos(core, HEVCD_MPP_ANC_CANVAS_ACCCONFIG_ADDR,
+			 (16 << 8) | 1);
+	codec_vp9_set_refs(sess, vp9);
+
+	amvdec_write_dos(core, VP9D_MPP_REFINFO_TBL_ACCCONFIG, BIT(2));
+	for (i = 0; i < REFS_PER_FRAME; ++i) {
+		struct vp9_frame *ref = vp9->frame_refs[i];
+
+		if (!ref)
+			continue;
+
+		if (ref->width != vp9->width || ref->height != vp9->height)
+			scale = 1;
+
+		sz = amvdec_am21c_body_size(ref->width, ref->height);
+
+		amvdec_write_dos(core, VP9D_MPP_REFINFO_DATA, ref->width);
+		amvdec_write_dos(core, VP9D_MPP_REFINFO_DATA, ref->height);
+		amvdec_write_dos(core, VP9D_MPP_REFINFO_DATA,
+				 (ref->width << 14) / vp9->width);
+		amvdec_write_dos(core, VP9D_MPP_REFINFO_DATA,
+				 (ref->height << 14) / vp9->height);
+		amvdec_write_dos(core, VP9D_MPP_REFINFO_DATA, sz >> 5);
+	}
+
+	amvdec_write_dos(core, VP9D_MPP_REF_SCALE_ENBL, scale);
+}
+
+static struct vp9_frame *codec_vp9_get_new_frame(struct amvdec_session *sess)
+{
+	struct codec_vp9 *vp9 = sess->priv;
+	union rpm_param *param = &vp9->rpm_param;
+	struct vb2_v4l2_buffer *vbuf = NULL;
+	struct vp9_frame *new_frame;
+	u32 num = v4l2_m2m_num_dst_bufs_ready(sess->m2m_ctx);
+
+	/*
+	 * Userspace may have queued back a shown frame that is still used as
+	 * a reference: skip those.
+	 */
+	while (num--) {
+		vbuf = v4l2_m2m_dst_buf_remove(sess->m2m_ctx);
+		if (!codec_vp9_get_frame_by_idx(vp9, vbuf->vb2_buf.index))
+			break;
+
+		v4l2_m2m_buf_queue(sess->m2m_ctx, vbuf);
+		vbuf = NULL;
+	}
+
+	if (!vbuf) {
+		dev_err(sess->core->dev, "No dst buffer available\n");
+		return NULL;
+	}
+
+	new_frame = kzalloc(sizeof(*new_frame), GFP_KERNEL);
+	if (!new_frame) {
+		v4l2_m2m_buf_queue(sess->m2m_ctx, vbuf);
+		return NULL;
+	}
+
+	new_frame->vbuf = vbuf;
+	new_frame->index = vbuf->vb2_buf.index;
+	/* intra_only is only coded for hidden frames */
+	new_frame->intra_only = param->p.show_frame ? 0 : param->p.intra_only;
+	new_frame->show = param->p.show_frame;
+	new_frame->type = param->p.frame_type;
+	new_frame->width = vp9->width;
+	new_frame->height = vp9->height;
+	list_add_tail(&new_frame->list, &vp9->ref_frames_list);
+	vp9->frames_num++;
+
+	return new_frame;
+}
+
+static int codec_vp9_process_frame(struct amvdec_session *sess)
+{
+	struct amvdec_core *core = sess->core;
+	struct codec_vp9 *vp9 = sess->priv;
+	struct vp9_frame *frame;
+
+	frame = codec_vp9_get_new_frame(sess);
+	if (!frame)
+		return -1;
+
+	vp9->cur_frame = frame;
+	dev_dbg(core->dev, "frame %u: type %u; show %u; intra_only %u\n",
+		frame->index, frame->type, frame->show, frame->intra_only);
+
+	codec_vp9_update_next_ref(vp9);
+
+	if (frame->type != KEY_FRAME && !frame->intra_only) {
+		codec_vp9_sync_ref(vp9);
+		codec_vp9_set_mc(sess, vp9);
+		codec_vp9_set_mpred_mv(core, vp9);
+	} else {
+		amvdec_clear_dos_bits(core, HEVC_MPRED_CTRL4, BIT(6));
+	}
+
+	amvdec_write_dos(core, HEVC_PARSER_PICTURE_SIZE,
+			 (vp9->height << 16) | vp9->width);
+	codec_vp9_set_mcrcc(sess);
+	codec_vp9_set_sao(sess, &frame->vbuf->vb2_buf);
+
+	vp9_loop_filter_frame_init(core, &vp9->seg_4lf, &vp9->lfi, &vp9->lf,
+				   vp9->default_filt_lvl);
+
+	/* ask uCode to start decoding */
+	amvdec_write_dos(core, VP9_DEC_STATUS_REG, VP9_10B_DECODE_SLICE);
+
+	return 0;
+}
+
+static void codec_vp9_process_lf(struct codec_vp9 *vp9)
+{
+	union rpm_param *param = &vp9->rpm_param;
+	int i;
+
+	vp9->lf.mode_ref_delta_enabled = param->p.mode_ref_delta_enabled;
+	vp9->lf.sharpness_level = param->p.sharpness_level;
+	vp9->default_filt_lvl = param->p.filter_level;
+	vp9->seg_4lf.enabled = param->p.seg_enabled;
+	vp9->seg_4lf.abs_delta = param->p.seg_abs_delta;
+
+	for (i = 0; i < MAX_REF_LF_DELTAS; i++)
+		vp9->lf.ref_deltas[i] = param->p.ref_deltas[i];
+
+	for (i = 0; i < MAX_MODE_LF_DELTAS; i++)
+		vp9->lf.mode_deltas[i] = param->p.mode_deltas[i];
+
+	for (i = 0; i < MAX_SEGMENTS; i++) {
+		u16 seg_lf_info = param->p.seg_lf_info[i];
+
+		vp9->seg_4lf.feature_mask[i] =
+			(seg_lf_info & 0x8000) ? BIT(SEG_LVL_ALT_LF) : 0;
+		vp9->seg_4lf.feature_data[i][SEG_LVL_ALT_LF] =
+			(seg_lf_info & 0x100 ? -1 : 1) * (seg_lf_info & 0x3f);
+	}
+}
+
+static void codec_vp9_resume(struct amvdec_session *sess)
+{
+	struct codec_vp9 *vp9 = sess->priv;
+
+	if (codec_hevc_setup_buffers(sess, &vp9->common, vp9->is_10bit,
+				     vp9->lcu_total * MV_MEM_UNIT)) {
+		amvdec_abort(sess);
+		return;
+	}
+
+	codec_vp9_setup_workspace(sess->core, vp9);
+	codec_hevc_setup_decode_head(sess, vp9->is_10bit);
+	codec_vp9_process_lf(vp9);
+	if (codec_vp9_process_frame(sess))
+		amvdec_abort(sess);
+}
+
+/*
+ * The RPM section within the workspace contains
+ * many information regarding the parsed bitstream
+ */
+static void codec_vp9_fetch_rpm(struct amvdec_session *sess)
+{
+	struct codec_vp9 *vp9 = sess->priv;
+	u16 *rpm_vaddr = vp9->workspace_vaddr + RPM_OFFSET;
+	int i, j;
+
+	for (i = 0; i < RPM_BUF_SIZE; i += 4)
+		for (j = 0; j < 4; j++)
+			vp9->rpm_param.l.data[i + j] = rpm_vaddr[i + 3 - j];
+}
+
+static int codec_vp9_process_rpm(struct codec_vp9 *vp9)
+{
+	union rpm_param *param = &vp9->rpm_param;
+	int src_changed = 0;
+	int is_10bit = 0;
+
+	if (param->p.bit_depth == 10)
+		is_10bit = 1;
+
+	vp9->lcu_total = DIV_ROUND_UP(param->p.width, LCU_SIZE) *
+			 DIV_ROUND_UP(param->p.height, LCU_SIZE);
+
+	if (vp9->width != param->p.width || vp9->height != param->p.height ||
+	    vp9->is_10bit != is_10bit)
+		src_changed = 1;
+
+	vp9->width = param->p.width;
+	vp9->height = param->p.height;
+	vp9->is_10bit = is_10bit;
+
+	return src_changed;
+}
+
+static bool codec_vp9_is_ref(struct codec_vp9 *vp9, struct vp9_frame *frame)
+{
+	int i;
+
+	for (i = 0; i < REF_FRAMES; ++i)
+		if (vp9->ref_frame_map[i] == frame->index)
+			return true;
+
+	return false;
+}
+
+/*
+ * Hand the shown frames to userspace, and drop the frames that can no
+ * longer be used as a reference. The last decoded frame is kept for its
+ * motion vectors.
+ */
+static void codec_vp9_output_frames(struct amvdec_session *sess)
+{
+	struct codec_vp9 *vp9 = sess->priv;
+	struct vp9_frame *tmp, *n;
+
+	list_for_each_entry_safe(tmp, n, &vp9->ref_frames_list, list) {
+		if (tmp->show && !tmp->done) {
+			amvdec_dst_buf_done(sess, tmp->vbuf, V4L2_FIELD_NONE);
+			tmp->done = 1;
+			vp9->frames_num--;
+		}
+
+		if (codec_vp9_is_ref(vp9, tmp) || tmp == vp9->prev_frame)
+			continue;
+
+		/* A hidden frame nobody refers to anymore */
+		if (!tmp->done) {
+			v4l2_m2m_buf_queue(sess->m2m_ctx, tmp->vbuf);
+			vp9->frames_num--;
+		}
+
+		list_del(&tmp->list);
+		kfree(tmp);
+	}
+}
+
+/* The frame only consists of showing a previously decoded one */
+static void codec_vp9_show_existing_frame(struct amvdec_session *sess)
+{
+	struct codec_vp9 *vp9 = sess->priv;
+	union rpm_param *param = &vp9->rpm_param;
+	int idx = vp9->ref_frame_map[param->p.frame_to_show_idx & 0x7];
+	struct vp9_frame *frame = codec_vp9_get_frame_by_idx(vp9, idx);
+
+	if (frame && !frame->done) {
+		amvdec_dst_buf_done(sess, frame->vbuf, V4L2_FIELD_NONE);
+		frame->show = 1;
+		frame->done = 1;
+		vp9->frames_num--;
+	}
+
+	/* Nothing to decode, let the uCode move on to the next frame */
+	amvdec_write_dos(sess->core, VP9_DEC_STATUS_REG, VP9_10B_DECODE_SLICE);
+}
+
+static irqreturn_t codec_vp9_threaded_isr(struct amvdec_session *sess)
+{
+	struct amvdec_core *core = sess->core;
+	struct codec_vp9 *vp9 = sess->priv;
+	u32 dec_status = amvdec_read_dos(core, VP9_DEC_STATUS_REG);
+	u32 prob_status = amvdec_read_dos(core, VP9_ADAPT_PROB_REG);
+
+	if (!vp9)
+		return IRQ_HANDLED;
+
+	mutex_lock(&vp9->lock);
+	if (dec_status != VP9_HEAD_PARSER_DONE) {
+		dev_err(core->dev_dec, "Unrecognized dec_status: %08X\n",
+			dec_status);
+		amvdec_abort(sess);
+		goto unlock;
+	}
+
+	sess->keyframe_found = 1;
+
+	/* The previous frame is fully decoded by now */
+	if (vp9->cur_frame) {
+		if ((prob_status & 0xff) == VP9_REQ_ADAPT_PROB) {
+			codec_vp9_adapt_probs(vp9, prob_status);
+			amvdec_write_dos(core, VP9_ADAPT_PROB_REG, 0);
+		}
+
+		memcpy(vp9->ref_frame_map, vp9->next_ref_frame_map,
+		       sizeof(vp9->ref_frame_map));
+		memset(vp9->frame_refs, 0, sizeof(vp9->frame_refs));
+		vp9->prev_frame = vp9->cur_frame;
+		vp9->cur_frame = NULL;
+	}
+
+	codec_vp9_output_frames(sess);
+
+	codec_vp9_fetch_rpm(sess);
+	if (codec_vp9_process_rpm(vp9)) {
+		/*
+		 * The CAPTURE buffers may get reallocated, so the references
+		 * cannot be kept around. Streams switch resolution on
+		 * keyframes in practice.
+		 */
+		codec_vp9_release_frames(sess);
+		amvdec_src_change(sess, vp9->width, vp9->height, 16);
+		goto unlock;
+	}
+
+	if (vp9->rpm_param.p.show_existing_frame) {
+		codec_vp9_show_existing_frame(sess);
+		goto unlock;
+	}
+
+	codec_vp9_process_lf(vp9);
+	if (codec_vp9_process_frame(sess))
+		amvdec_abort(sess);
+
+unlock:
+	mutex_unlock(&vp9->lock);
+	return IRQ_HANDLED;
+}
+
+static irqreturn_t codec_vp9_isr(struct amvdec_session *sess)
+{
+	return IRQ_WAKE_THREAD;
+}
+
+struct amvdec_codec_ops codec_vp9_ops = {
+	.start = codec_vp9_start,
+	.stop = codec_vp9_stop,
+	.isr = codec_vp9_isr,
+	.threaded_isr = codec_vp9_threaded_isr,
+	.num_pending_bufs = codec_vp9_num_pending_bufs,
+	.drain = codec_vp9_flush_output,
+	.resume = codec_vp9_resume,
+};
@@ -86,10 +86,62 @@
 
 #define DCAC_DMA_CTRL		0x3848
 
+/* HCODEC registers */
+#define HCODEC_ASSIST_MBOX2_IRQ_REG	0x41e0
+#define HCODEC_ASSIST_MBOX2_CLR_REG	0x41e4
+#define HCODEC_ASSIST_MBOX2_MASK	0x41e8
+
+#define HCODEC_MPSR		0x4c04
+#define HCODEC_CPSR		0x4c84
+
+#define HCODEC_IMEM_DMA_CTRL	0x4d00
+#define HCODEC_IMEM_DMA_ADR	0x4d04
+#define HCODEC_IMEM_DMA_COUNT	0x4d08
+
+#define HCODEC_MFDIN_REG1_CTRL	0x6c04
+	#define MFDIN_IFMT_NV12		(2 << 4)
+	#define MFDIN_IFMT_NV21		(3 << 4)
+	#define MFDIN_ENABLE		BIT(0)
+#define HCODEC_MFDIN_REG3_CANV	0x6c0c
+#define HCODEC_MFDIN_REG8_DMBL	0x6c20
+
+/* HCODEC firmware interface registers */
+#define HCODEC_HENC_SCRATCH_0	0x6b00
+#define HCODEC_HENC_SCRATCH_1	0x6b04
+#define HCODEC_HENC_SCRATCH_2	0x6b08
+#define HCODEC_HENC_SCRATCH_3	0x6b0c
+#define HCODEC_HENC_SCRATCH_4	0x6b10
+#define HCODEC_HENC_SCRATCH_5	0x6b14
+#define HCODEC_HENC_SCRATCH_6	0x6b18
+#define HCODEC_HENC_SCRATCH_7	0x6b1c
+#define HCODEC_HENC_SCRATCH_8	0x6b20
+#define HCODEC_HENC_SCRATCH_9	0x6b24
+#define HCODEC_HENC_SCRATCH_A	0x6b28
+#define HCODEC_HENC_SCRATCH_B	0x6b2c
+
+#define HCODEC_REC_CANVAS_ADDR	0x7640
+#define HCODEC_DBKR_CANVAS_ADDR	0x7644
+#define HCODEC_DBKW_CANVAS_ADDR	0x7648
+#define HCODEC_ANC0_CANVAS_ADDR	0x7650
+
+/* HCODEC bitstream output buffer */
+#define HCODEC_VLC_VB_START_PTR	0x7440
+#define HCODEC_VLC_VB_END_PTR	0x7444
+#define HCODEC_VLC_VB_WR_PTR	0x7448
+#define HCODEC_VLC_VB_RD_PTR	0x744c
+#define HCODEC_VLC_VB_SW_RD_PTR	0x7450
+#define HCODEC_VLC_VB_CONTROL	0x7458
+	#define VLC_VB_MEM_INIT		BIT(0)
+	#define VLC_VB_ENABLE		(BIT(3) | BIT(1))
+#define HCODEC_VLC_TOTAL_BYTES	0x7468
+
 #define DOS_SW_RESET0		0xfc00
 #define DOS_GCLK_EN0		0xfc04
+	#define DOS_GCLK_EN0_HCODEC	GENMASK(26, 12)
 #define DOS_GEN_CTRL0		0xfc08
+#define DOS_SW_RESET1		0xfc1c
 #define DOS_MEM_PD_VDEC		0xfcc0
+#define DOS_MEM_PD_HCODEC	0xfcc8
 #define DOS_MEM_PD_HEVC		0xfccc
 #define DOS_SW_RESET3		0xfcd0
 #define DOS_GCLK_EN3		0xfcd4
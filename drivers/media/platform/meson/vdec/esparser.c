@@ -10,15 +10,19 @@
 #include <linux/init.h>
 #include <linux/ioctl.h>
 #include <linux/list.h>
+#include <linux/log2.h>
+#include <linux/mm.h>
 #include <linux/module.h>
 #include <linux/of_device.h>
 #include <linux/reset.h>
+#include <asm/unaligned.h>
 #include <media/videobuf2-dma-contig.h>
 #include <media/v4l2-mem2mem.h>
 
 #include "dos_regs.h"
 #include "esparser.h"
 #include "vdec_helpers.h"
+#include "vdec_trace.h"
 
 /* PARSER REGS (CBUS) */
 #define PARSER_CONTROL 0x00
@@ -52,13 +56,11 @@
 
 #define SEARCH_PATTERN_LEN	512
 
-static DECLARE_WAIT_QUEUE_HEAD(wq);
-static int search_done;
-
 static irqreturn_t esparser_isr(int irq, void *dev)
 {
 	int int_status;
 	struct amvdec_core *core = dev;
+	struct amvdec_session *sess = core->cur_sess;
 
 	int_status = amvdec_read_parser(core, PARSER_INT_STATUS);
 	amvdec_write_parser(core, PARSER_INT_STATUS, int_status);
@@ -66,8 +68,8 @@ static irqreturn_t esparser_isr(int irq, void *dev)
 	if (int_status & PARSER_INTSTAT_SC_FOUND) {
 		amvdec_write_parser(core, PFIFO_RD_PTR, 0);
 		amvdec_write_parser(core, PFIFO_WR_PTR, 0);
-		search_done = 1;
-		wake_up_interruptible(&wq);
+		if (sess)
+			complete(&sess->esparser_done);
 	}
 
 	return IRQ_HANDLED;
@@ -98,9 +100,12 @@ static u32 esparser_pad_start_code(struct vb2_buffer *vb)
 	return pad_size;
 }
 
-static int
-esparser_write_data(struct amvdec_core *core, dma_addr_t addr, u32 size)
+static long
+esparser_write_data(struct amvdec_session *sess, dma_addr_t addr, u32 size)
 {
+	struct amvdec_core *core = sess->core;
+
+	reinit_completion(&sess->esparser_done);
 	amvdec_write_parser(core, PFIFO_RD_PTR, 0);
 	amvdec_write_parser(core, PFIFO_WR_PTR, 0);
 	amvdec_write_parser(core, PARSER_CONTROL,
@@ -114,8 +119,8 @@ esparser_write_data(struct amvdec_core *core, dma_addr_t addr, u32 size)
 			    (7 << FETCH_ENDIAN_BIT) |
 			    (size + SEARCH_PATTERN_LEN));
 
-	search_done = 0;
-	return wait_event_interruptible_timeout(wq, search_done, (HZ / 5));
+	return wait_for_completion_interruptible_timeout(&sess->esparser_done,
+							 HZ / 5);
 }
 
 static u32 esparser_vififo_get_free_space(struct amvdec_session *sess)
@@ -128,6 +133,9 @@ static u32 esparser_vififo_get_free_space(struct amvdec_session *sess)
 	vififo_usage += amvdec_read_parser(core, PARSER_VIDEO_HOLE);
 	vififo_usage += (6 * SZ_1K); // 6 KiB internal fifo
 
+	trace_vdec_vififo_level(sess, vififo_usage);
+	sess->vififo_usage_max = max(sess->vififo_usage_max, vififo_usage);
+
 	if (vififo_usage > sess->vififo_size) {
 		dev_warn(sess->core->dev,
 			 "VIFIFO usage (%u) > VIFIFO size (%u)\n",
@@ -138,12 +146,12 @@ static u32 esparser_vififo_get_free_space(struct amvdec_session *sess)
 	return sess->vififo_size - vififo_usage;
 }
 
-int esparser_queue_eos(struct amvdec_core *core, const u8 *data, u32 len)
+int esparser_queue_eos(struct amvdec_session *sess, const u8 *data, u32 len)
 {
-	struct device *dev = core->dev;
+	struct device *dev = sess->core->dev;
 	void *eos_vaddr;
 	dma_addr_t eos_paddr;
-	int ret;
+	long ret;
 
 	eos_vaddr = dma_zalloc_coherent(dev, len + SEARCH_PATTERN_LEN,
 					&eos_paddr, GFP_KERNEL);
@@ -151,7 +159,7 @@ int esparser_queue_eos(struct amvdec_core *core, const u8 *data, u32 len)
 		return -ENOMEM;
 
 	memcpy(eos_vaddr, data, len);
-	ret = esparser_write_data(core, eos_paddr, len);
+	ret = esparser_write_data(sess, eos_paddr, len);
 	dma_free_coherent(dev, len + SEARCH_PATTERN_LEN,
 			  eos_vaddr, eos_paddr);
 
@@ -173,27 +181,152 @@ static u32 esparser_get_offset(struct amvdec_session *sess)
 	return offset;
 }
 
+/* Every VP9 frame must be preceded by this header for the firmware */
+#define VP9_HEADER_SIZE		16
+
+/*
+ * Split VP9 superframes and insert a header in front of each frame.
+ * Returns the new payload size, or a negative value if the buffer is
+ * too small to hold the headers.
+ */
+static int vp9_update_header(struct amvdec_core *core, struct vb2_buffer *vb)
+{
+	u8 *dp = (u8 *)vb2_plane_vaddr(vb, 0);
+	u32 dsize = vb2_get_plane_payload(vb, 0);
+	u32 frame_size[8];
+	int num_frames = 1;
+	u32 total_datasize = 0;
+	u32 new_size;
+	u8 marker;
+	u8 *fdata;
+	u8 *old_header;
+	int cur_frame;
+	int i;
+
+	if (!dsize)
+		return -EINVAL;
+
+	marker = dp[dsize - 1];
+	if ((marker & 0xe0) == 0xc0) {
+		int frames = (marker & 0x7) + 1;
+		int mag = ((marker >> 3) & 0x3) + 1;
+		u32 index_sz = 2 + mag * frames;
+
+		if (dsize >= index_sz && dp[dsize - index_sz] == marker) {
+			u8 *idx = dp + dsize - index_sz + 1;
+
+			num_frames = frames;
+			for (i = 0; i < num_frames; i++) {
+				u32 this_sz = 0;
+				int j;
+
+				for (j = 0; j < mag; j++)
+					this_sz |= (*idx++) << (j * 8);
+
+				frame_size[i] = this_sz;
+				total_datasize += this_sz;
+			}
+
+			/* Corrupted index, send the data as a single frame */
+			if (total_datasize > dsize - index_sz) {
+				num_frames = 1;
+				total_datasize = 0;
+			}
+		}
+	}
+
+	if (num_frames == 1) {
+		frame_size[0] = dsize;
+		total_datasize = dsize;
+	}
+
+	new_size = total_datasize + num_frames * VP9_HEADER_SIZE;
+	if (max_t(u32, new_size, ESPARSER_MIN_PACKET_SIZE) +
+	    SEARCH_PATTERN_LEN > vb2_plane_size(vb, 0)) {
+		dev_warn(core->dev, "VP9: buffer too small for the headers\n");
+		return -ENOSPC;
+	}
+
+	/* Move the frames from the last one, so that they don't overlap */
+	fdata = dp + total_datasize;
+	for (cur_frame = num_frames - 1; cur_frame >= 0; cur_frame--) {
+		u32 framesize = frame_size[cur_frame];
+
+		fdata -= framesize;
+		memmove(fdata + (cur_frame + 1) * VP9_HEADER_SIZE, fdata,
+			framesize);
+
+		old_header = fdata + cur_frame * VP9_HEADER_SIZE;
+		put_unaligned_be32(framesize + 4, old_header);
+		put_unaligned_be32(~(framesize + 4), old_header + 4);
+		old_header[8] = 0;
+		old_header[9] = 0;
+		old_header[10] = 0;
+		old_header[11] = 1;
+		memcpy(old_header + 12, "AMLV", 4);
+	}
+
+	vb2_set_plane_payload(vb, 0, new_size);
+
+	return new_size;
+}
+
+/**
+ * struct esparser_budget - resources available to one esparser_queue_all_src()
+ * pass, sampled once instead of for every buffer
+ *
+ * @vififo_free: free space left in the VIFIFO
+ * @dst_bufs: number of dst buffers that can still receive a frame
+ */
+struct esparser_budget {
+	u32 vififo_free;
+	u32 dst_bufs;
+};
+
 static int
-esparser_queue(struct amvdec_session *sess, struct vb2_v4l2_buffer *vbuf)
+esparser_queue(struct amvdec_session *sess, struct vb2_v4l2_buffer *vbuf,
+	       struct esparser_budget *budget)
 {
-	int ret;
+	long ret;
 	struct vb2_buffer *vb = &vbuf->vb2_buf;
 	struct amvdec_core *core = sess->core;
-	struct amvdec_codec_ops *codec_ops = sess->fmt_out->codec_ops;
-	u32 num_dst_bufs = 0;
 	u32 payload_size = vb2_get_plane_payload(vb, 0);
 	dma_addr_t phy = vb2_dma_contig_plane_dma_addr(vb, 0);
 	u32 offset;
 	u32 pad_size;
 
-	if (codec_ops->num_pending_bufs)
-		num_dst_bufs = codec_ops->num_pending_bufs(sess);
-
-	num_dst_bufs += v4l2_m2m_num_dst_bufs_ready(sess->m2m_ctx);
+	/* Packets preceding the first keyframe never lead to a frame, so
+	 * they are not accounted against the dst buffers.
+	 */
+	if (budget->vififo_free < payload_size)
+		return -EAGAIN;
 
-	if (esparser_vififo_get_free_space(sess) < payload_size ||
-	    atomic_read(&sess->esparser_queued_bufs) >= num_dst_bufs)
+	if (sess->keyframe_found &&
+	    atomic_read(&sess->esparser_queued_bufs) >= budget->dst_bufs) {
+		if (!sess->cap_wait_start)
+			sess->cap_wait_start = ktime_get();
 		return -EAGAIN;
+	}
+
+	if (sess->cap_wait_start) {
+		u64 wait = ktime_to_ns(ktime_sub(ktime_get(),
+						 sess->cap_wait_start));
+
+		trace_vdec_cap_wait(sess, wait);
+		sess->cap_wait_time += wait;
+		sess->cap_wait_start = 0;
+	}
+
+	if (sess->fmt_out->pixfmt == V4L2_PIX_FMT_VP9) {
+		ret = vp9_update_header(core, vb);
+		if (ret < 0) {
+			v4l2_m2m_src_buf_remove_by_buf(sess->m2m_ctx, vbuf);
+			v4l2_m2m_buf_done(vbuf, VB2_BUF_STATE_ERROR);
+			return 0;
+		}
+
+		payload_size = ret;
+	}
 
 	v4l2_m2m_src_buf_remove_by_buf(sess->m2m_ctx, vbuf);
 
@@ -204,7 +337,8 @@ esparser_queue(struct amvdec_session *sess, struct vb2_v4l2_buffer *vbuf)
 		vb->timestamp, payload_size, offset);
 
 	pad_size = esparser_pad_start_code(vb);
-	ret = esparser_write_data(core, phy, payload_size + pad_size);
+	trace_vdec_esparser_queue(sess, vb, payload_size + pad_size, offset);
+	ret = esparser_write_data(sess, phy, payload_size + pad_size);
 
 	if (ret <= 0) {
 		dev_warn(core->dev, "esparser: input parsing error\n");
@@ -215,16 +349,7 @@ esparser_queue(struct amvdec_session *sess, struct vb2_v4l2_buffer *vbuf)
 		return 0;
 	}
 
-	/* We need to wait until we parse the first keyframe.
-	 * All buffers prior to the first keyframe must be dropped.
-	 */
-	if (!sess->keyframe_found)
-		usleep_range(1000, 2000);
-
-	if (sess->keyframe_found)
-		atomic_inc(&sess->esparser_queued_bufs);
-	else
-		amvdec_remove_ts(sess, vb->timestamp);
+	budget->vififo_free -= min(budget->vififo_free, payload_size + pad_size);
 
 	vbuf->flags = 0;
 	vbuf->field = V4L2_FIELD_NONE;
@@ -233,15 +358,224 @@ esparser_queue(struct amvdec_session *sess, struct vb2_v4l2_buffer *vbuf)
 	return 0;
 }
 
+/* Assume the VIFIFO gets consumed fast enough to be polled every 2ms */
+#define RING_POLL_INTERVAL_MS	2
+
+/* Push the userspace write pointer and timestamps to the VDEC, and report
+ * back how far the decoder got.
+ */
+static void esparser_ring_sync(struct amvdec_session *sess)
+{
+	struct amvdec_ring *ring = sess->ring;
+	struct meson_vdec_ring *ctrl = ring->ctrl;
+	struct amvdec_ops *vdec_ops = sess->fmt_out->vdec_ops;
+	u32 wp, ts_wp, rp;
+
+	wp = READ_ONCE(ctrl->wp);
+	ts_wp = READ_ONCE(ctrl->ts_wp);
+	/* Pairs with userspace updating wp last */
+	smp_rmb();
+
+	if (ts_wp - ring->ts_rp > MESON_VDEC_RING_NUM_TS) {
+		dev_warn(sess->core->dev, "ring: timestamp overrun\n");
+		ring->ts_rp = ts_wp - MESON_VDEC_RING_NUM_TS;
+	}
+
+	while (ring->ts_rp != ts_wp) {
+		struct meson_vdec_ring_ts *ts =
+			&ctrl->ts[ring->ts_rp % MESON_VDEC_RING_NUM_TS];
+
+		amvdec_add_ts_reorder(sess, ts->timestamp, ts->offset);
+		ring->ts_rp++;
+	}
+	WRITE_ONCE(ctrl->ts_rp, ring->ts_rp);
+
+	rp = ring->wp - vdec_ops->vififo_level(sess);
+	if (wp != ring->wp) {
+		if (wp - rp > ring->size) {
+			dev_warn(sess->core->dev,
+				 "ring: invalid write pointer %08X\n", wp);
+			goto out;
+		}
+
+		/* Make sure the ES data is visible before the VDEC fetches */
+		wmb();
+		vdec_ops->vififo_set_wp(sess, ring->paddr + (wp % ring->size));
+		ring->wp = wp;
+	}
+
+out:
+	WRITE_ONCE(ctrl->rp, rp);
+}
+
+static void esparser_ring_poll(struct work_struct *work)
+{
+	struct amvdec_ring *ring =
+		container_of(to_delayed_work(work), struct amvdec_ring,
+			     poll_work);
+
+	if (!READ_ONCE(ring->running))
+		return;
+
+	esparser_ring_sync(ring->sess);
+	schedule_delayed_work(&ring->poll_work,
+			      msecs_to_jiffies(RING_POLL_INTERVAL_MS));
+}
+
+int esparser_ring_alloc(struct amvdec_session *sess, u32 size)
+{
+	struct device *dev = sess->core->dev;
+	struct amvdec_ring *ring;
+
+	if (sess->ring)
+		return 0;
+
+	if (size > MESON_VDEC_RING_CTRL_OFFSET - MESON_VDEC_RING_DATA_OFFSET ||
+	    !is_power_of_2(size))
+		return -EINVAL;
+
+	ring = kzalloc(sizeof(*ring), GFP_KERNEL);
+	if (!ring)
+		return -ENOMEM;
+
+	ring->ctrl = dma_alloc_coherent(dev, PAGE_SIZE, &ring->ctrl_paddr,
+					GFP_KERNEL);
+	if (!ring->ctrl)
+		goto free_ring;
+
+	ring->vaddr = dma_alloc_coherent(dev, size, &ring->paddr, GFP_KERNEL);
+	if (!ring->vaddr)
+		goto free_ctrl;
+
+	ring->size = size;
+	ring->sess = sess;
+	INIT_DELAYED_WORK(&ring->poll_work, esparser_ring_poll);
+	sess->ring = ring;
+
+	return 0;
+
+free_ctrl:
+	dma_free_coherent(dev, PAGE_SIZE, ring->ctrl, ring->ctrl_paddr);
+free_ring:
+	kfree(ring);
+	return -ENOMEM;
+}
+
+/* Only called on release: every userspace mapping holds a file reference */
+void esparser_ring_free(struct amvdec_session *sess)
+{
+	struct device *dev = sess->core->dev;
+	struct amvdec_ring *ring = sess->ring;
+
+	if (!ring)
+		return;
+
+	dma_free_coherent(dev, ring->size, ring->vaddr, ring->paddr);
+	dma_free_coherent(dev, PAGE_SIZE, ring->ctrl, ring->ctrl_paddr);
+	kfree(ring);
+	sess->ring = NULL;
+}
+
+void esparser_ring_start(struct amvdec_session *sess)
+{
+	struct amvdec_ring *ring = sess->ring;
+
+	memset(ring->ctrl, 0, PAGE_SIZE);
+	ring->ctrl->size = ring->size;
+	ring->wp = 0;
+	ring->ts_rp = 0;
+	ring->running = true;
+
+	schedule_delayed_work(&ring->poll_work,
+			      msecs_to_jiffies(RING_POLL_INTERVAL_MS));
+}
+
+void esparser_ring_stop(struct amvdec_session *sess)
+{
+	WRITE_ONCE(sess->ring->running, false);
+	cancel_delayed_work_sync(&sess->ring->poll_work);
+}
+
+int esparser_ring_mmap(struct amvdec_session *sess, struct vm_area_struct *vma)
+{
+	struct device *dev = sess->core->dev;
+	struct amvdec_ring *ring = sess->ring;
+	unsigned long offset = vma->vm_pgoff << PAGE_SHIFT;
+	unsigned long len = vma->vm_end - vma->vm_start;
+
+	if (!ring)
+		return -EINVAL;
+
+	vma->vm_pgoff = 0;
+
+	if (offset == MESON_VDEC_RING_CTRL_OFFSET) {
+		if (len > PAGE_SIZE)
+			return -EINVAL;
+
+		return dma_mmap_coherent(dev, vma, ring->ctrl,
+					 ring->ctrl_paddr, PAGE_SIZE);
+	}
+
+	if (len > ring->size)
+		return -EINVAL;
+
+	return dma_mmap_coherent(dev, vma, ring->vaddr, ring->paddr,
+				 ring->size);
+}
+
+/* Userspace is done appending data, put the EOS sequence after it */
+int esparser_ring_queue_eos(struct amvdec_session *sess, const u8 *data,
+			    u32 len)
+{
+	struct amvdec_ring *ring = sess->ring;
+	u32 wp = READ_ONCE(ring->ctrl->wp);
+	u32 i;
+
+	for (i = 0; i < ESPARSER_MIN_PACKET_SIZE; i++) {
+		u8 c = i < len ? data[i] : 0;
+
+		((u8 *)ring->vaddr)[(wp + i) % ring->size] = c;
+	}
+
+	smp_wmb();
+	WRITE_ONCE(ring->ctrl->wp, wp + ESPARSER_MIN_PACKET_SIZE);
+	mod_delayed_work(system_wq, &ring->poll_work, 0);
+
+	return 0;
+}
+
 void esparser_queue_all_src(struct work_struct *work)
 {
 	struct v4l2_m2m_buffer *buf, *n;
 	struct amvdec_session *sess =
 		container_of(work, struct amvdec_session, esparser_queue_work);
+	struct amvdec_codec_ops *codec_ops = sess->fmt_out->codec_ops;
+	struct esparser_budget budget = { 0 };
+
+	if (sess->ring_mode) {
+		struct vb2_v4l2_buffer *vbuf;
+
+		/* There is no use for OUTPUT buffers in ring mode */
+		mutex_lock(&sess->lock);
+		while ((vbuf = v4l2_m2m_src_buf_remove(sess->m2m_ctx)))
+			v4l2_m2m_buf_done(vbuf, VB2_BUF_STATE_ERROR);
+		mutex_unlock(&sess->lock);
+
+		/* A frame got out, there might be new VIFIFO space to report */
+		if (READ_ONCE(sess->ring->running))
+			mod_delayed_work(system_wq, &sess->ring->poll_work, 0);
+		return;
+	}
 
 	mutex_lock(&sess->lock);
+	if (codec_ops->num_pending_bufs)
+		budget.dst_bufs = codec_ops->num_pending_bufs(sess);
+
+	budget.dst_bufs += v4l2_m2m_num_dst_bufs_ready(sess->m2m_ctx);
+	budget.vififo_free = esparser_vififo_get_free_space(sess);
+
 	v4l2_m2m_for_each_src_buf_safe(sess->m2m_ctx, buf, n) {
-		if (esparser_queue(sess, &buf->vb) < 0)
+		if (esparser_queue(sess, &buf->vb, &budget) < 0)
 			break;
 	}
 	mutex_unlock(&sess->lock);
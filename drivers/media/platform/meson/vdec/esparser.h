@@ -17,16 +17,32 @@ int esparser_power_up(struct amvdec_session *sess);
 /**
  * esparser_queue_eos() - write End Of Stream sequence to the ESPARSER
  *
- * @core vdec core struct
+ * @sess current session
  */
-int esparser_queue_eos(struct amvdec_core *core, const u8 *data, u32 len);
+int esparser_queue_eos(struct amvdec_session *sess, const u8 *data, u32 len);
 
 /**
  * esparser_queue_all_src() - work handler that writes as many src buffers
- * as possible to the ESPARSER
+ * as possible to the ESPARSER, within the VIFIFO space and capture buffers
+ * available at the start of the pass
  */
 void esparser_queue_all_src(struct work_struct *work);
 
+/**
+ * esparser_ring_alloc() - allocate the VIFIFO and control page used in
+ * ring input mode. They are kept until the session is released.
+ *
+ * @sess: current session
+ * @size: size of the VIFIFO, must be a power of 2
+ */
+int esparser_ring_alloc(struct amvdec_session *sess, u32 size);
+void esparser_ring_free(struct amvdec_session *sess);
+void esparser_ring_start(struct amvdec_session *sess);
+void esparser_ring_stop(struct amvdec_session *sess);
+int esparser_ring_mmap(struct amvdec_session *sess, struct vm_area_struct *vma);
+int esparser_ring_queue_eos(struct amvdec_session *sess, const u8 *data,
+			    u32 len);
+
 #define ESPARSER_MIN_PACKET_SIZE SZ_4K
 
 #endif
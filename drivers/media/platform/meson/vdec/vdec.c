@@ -6,10 +6,13 @@
 
 #include <linux/of_device.h>
 #include <linux/clk.h>
+#include <linux/debugfs.h>
+#include <linux/dma-contiguous.h>
 #include <linux/io.h>
 #include <linux/module.h>
 #include <linux/platform_device.h>
 #include <linux/mfd/syscon.h>
+#include <linux/perf_hotpath.h>
 #include <linux/slab.h>
 #include <media/v4l2-ioctl.h>
 #include <media/v4l2-event.h>
@@ -22,6 +25,10 @@
 #include "esparser.h"
 #include "vdec_helpers.h"
 #include "vdec_ctrls.h"
+#include "venc.h"
+
+#define CREATE_TRACE_POINTS
+#include "vdec_trace.h"
 
 struct dummy_buf {
 	struct vb2_v4l2_buffer vb;
@@ -36,6 +43,11 @@ static u32 get_output_size(u32 width, u32 height)
 	return ALIGN(width * height, SZ_64K);
 }
 
+/* Number of 2160p CAPTURE planes kept evacuated in CMA between streams */
+static unsigned int warm_planes;
+module_param(warm_planes, uint, 0444);
+MODULE_PARM_DESC(warm_planes, "CMA chunks to keep ready for decoded planes");
+
 u32 amvdec_get_output_size(struct amvdec_session *sess)
 {
 	return get_output_size(sess->width, sess->height);
@@ -49,29 +61,55 @@ static int vdec_codec_needs_recycle(struct amvdec_session *sess)
 	return codec_ops->can_recycle && codec_ops->recycle;
 }
 
-static int vdec_recycle_thread(void *data)
+/*
+ * Hand as many pending CAPTURE buffers back to the firmware as its recycle
+ * mailbox can take. Called when a buffer is queued and after each decoder
+ * interrupt, which is when the firmware usually frees a mailbox slot.
+ */
+static void vdec_recycle_bufs(struct amvdec_session *sess)
 {
-	struct amvdec_session *sess = data;
-	struct amvdec_core *core = sess->core;
 	struct amvdec_codec_ops *codec_ops = sess->fmt_out->codec_ops;
-	struct amvdec_buffer *tmp, *n;
-
-	while (!kthread_should_stop()) {
-		mutex_lock(&sess->bufs_recycle_lock);
-		list_for_each_entry_safe(tmp, n, &sess->bufs_recycle, list) {
-			if (!codec_ops->can_recycle(core))
-				break;
+	struct amvdec_core *core = sess->core;
+	bool pending;
+	u32 idx;
 
-			codec_ops->recycle(core, tmp->vb->index);
-			list_del(&tmp->list);
-			kfree(tmp);
-		}
-		mutex_unlock(&sess->bufs_recycle_lock);
+	spin_lock(&sess->bufs_recycle_lock);
+	if (!sess->recycle_enabled) {
+		spin_unlock(&sess->bufs_recycle_lock);
+		return;
+	}
 
-		usleep_range(5000, 10000);
+	while (!kfifo_is_empty(&sess->bufs_recycle) &&
+	       codec_ops->can_recycle(core)) {
+		if (kfifo_get(&sess->bufs_recycle, &idx))
+			codec_ops->recycle(core, idx);
 	}
 
-	return 0;
+	pending = !kfifo_is_empty(&sess->bufs_recycle);
+	spin_unlock(&sess->bufs_recycle_lock);
+
+	/* The firmware may empty its mailbox without raising an IRQ */
+	if (pending)
+		schedule_delayed_work(&sess->recycle_work, 1);
+}
+
+static void vdec_recycle_work(struct work_struct *work)
+{
+	struct amvdec_session *sess =
+		container_of(work, struct amvdec_session, recycle_work.work);
+
+	vdec_recycle_bufs(sess);
+}
+
+static void vdec_recycle_enable(struct amvdec_session *sess, bool enable)
+{
+	spin_lock(&sess->bufs_recycle_lock);
+	sess->recycle_enabled = enable;
+	kfifo_reset(&sess->bufs_recycle);
+	spin_unlock(&sess->bufs_recycle_lock);
+
+	if (!enable)
+		cancel_delayed_work_sync(&sess->recycle_work);
 }
 
 static int vdec_poweron(struct amvdec_session *sess)
@@ -91,7 +129,10 @@ static int vdec_poweron(struct amvdec_session *sess)
 	if (ret)
 		goto disable_dos;
 
-	esparser_power_up(sess);
+	if (sess->ring_mode)
+		esparser_ring_start(sess);
+	else
+		esparser_power_up(sess);
 
 	return 0;
 
@@ -116,6 +157,9 @@ static void vdec_poweroff(struct amvdec_session *sess)
 	struct amvdec_ops *vdec_ops = sess->fmt_out->vdec_ops;
 	struct amvdec_codec_ops *codec_ops = sess->fmt_out->codec_ops;
 
+	if (sess->ring_mode)
+		esparser_ring_stop(sess);
+
 	vdec_wait_inactive(sess);
 	if (codec_ops->drain)
 		codec_ops->drain(sess);
@@ -128,20 +172,24 @@ static void vdec_poweroff(struct amvdec_session *sess)
 static void
 vdec_queue_recycle(struct amvdec_session *sess, struct vb2_buffer *vb)
 {
-	struct amvdec_buffer *new_buf;
+	u32 idx = vb->index;
 
-	new_buf = kmalloc(sizeof(*new_buf), GFP_KERNEL);
-	new_buf->vb = vb;
+	/* Each buffer can only be queued once, so this never overflows */
+	spin_lock(&sess->bufs_recycle_lock);
+	if (!kfifo_put(&sess->bufs_recycle, idx))
+		dev_warn(sess->core->dev, "Recycle FIFO full\n");
+	spin_unlock(&sess->bufs_recycle_lock);
 
-	mutex_lock(&sess->bufs_recycle_lock);
-	list_add_tail(&new_buf->list, &sess->bufs_recycle);
-	mutex_unlock(&sess->bufs_recycle_lock);
+	vdec_recycle_bufs(sess);
 }
 
 static void vdec_m2m_device_run(void *priv)
 {
 	struct amvdec_session *sess = priv;
 
+	if (sess->status == STATUS_QUEUED)
+		return;
+
 	schedule_work(&sess->esparser_queue_work);
 }
 
@@ -256,7 +304,8 @@ static void vdec_vb2_buf_queue(struct vb2_buffer *vb)
 
 	v4l2_m2m_buf_queue(m2m_ctx, vbuf);
 
-	if (!sess->streamon_out || !sess->streamon_cap)
+	if (!sess->streamon_out || !sess->streamon_cap ||
+	    sess->status == STATUS_QUEUED)
 		return;
 
 	if (vb->type == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE &&
@@ -266,42 +315,77 @@ static void vdec_vb2_buf_queue(struct vb2_buffer *vb)
 	schedule_work(&sess->esparser_queue_work);
 }
 
-static int vdec_start_streaming(struct vb2_queue *q, unsigned int count)
+static void vdec_tunnel_release(void *data, struct meson_tunnel_frame *frame)
 {
-	struct amvdec_session *sess = vb2_get_drv_priv(q);
-	struct amvdec_codec_ops *codec_ops = sess->fmt_out->codec_ops;
-	struct amvdec_core *core = sess->core;
-	struct vb2_v4l2_buffer *buf;
-	int ret;
+	struct vb2_v4l2_buffer *vbuf = frame->priv;
 
-	if (core->cur_sess && core->cur_sess != sess) {
-		ret = -EBUSY;
-		goto bufs_done;
-	}
+	/* Back to the decoder, as if userspace had queued it again */
+	vdec_vb2_buf_queue(&vbuf->vb2_buf);
+}
 
-	if (q->type == V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE)
-		sess->streamon_out = 1;
-	else
-		sess->streamon_cap = 1;
+static const struct meson_tunnel_ops vdec_tunnel_ops = {
+	.release = vdec_tunnel_release,
+};
 
-	if (!sess->streamon_out || !sess->streamon_cap)
-		return 0;
+static int vdec_tunnel_bind(struct amvdec_session *sess)
+{
+	int ret;
 
-	if (sess->status == STATUS_NEEDS_RESUME &&
-	    q->type == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE) {
-		codec_ops->resume(sess);
-		sess->status = STATUS_RUNNING;
+	if (!sess->tunnel || sess->tunnel_bound)
 		return 0;
-	}
 
-	sess->vififo_size = SIZE_VIFIFO;
-	sess->vififo_vaddr =
-		dma_alloc_coherent(sess->core->dev, sess->vififo_size,
-				   &sess->vififo_paddr, GFP_KERNEL);
-	if (!sess->vififo_vaddr) {
-		dev_err(sess->core->dev, "Failed to request VIFIFO buffer\n");
-		ret = -ENOMEM;
-		goto bufs_done;
+	/* VD1 has no YUV420M or AM21C path for the tunnel */
+	if (sess->pixfmt_cap != V4L2_PIX_FMT_NV12M)
+		return -EINVAL;
+
+	ret = meson_tunnel_bind(&vdec_tunnel_ops, sess);
+	if (ret)
+		return ret;
+
+	meson_tunnel_set_paused(sess->tunnel_paused);
+	meson_tunnel_set_offset(sess->tunnel_offset);
+	sess->tunnel_bound = true;
+
+	return 0;
+}
+
+/* Returns once the display gave all the CAPTURE buffers back */
+static void vdec_tunnel_unbind(struct amvdec_session *sess)
+{
+	if (!sess->tunnel_bound)
+		return;
+
+	sess->tunnel_bound = false;
+	meson_tunnel_unbind();
+}
+
+/* Allocate the VIFIFO and start decoding. The caller owns core->lock. */
+static int vdec_session_run(struct amvdec_session *sess)
+{
+	struct amvdec_core *core = sess->core;
+	int ret;
+
+	if (sess->ring_mode) {
+		ret = esparser_ring_alloc(sess, SIZE_VIFIFO);
+		if (ret) {
+			dev_err(sess->core->dev, "Failed to allocate ring\n");
+			return ret;
+		}
+
+		sess->vififo_size = sess->ring->size;
+		sess->vififo_vaddr = sess->ring->vaddr;
+		sess->vififo_paddr = sess->ring->paddr;
+	} else {
+		sess->vififo_size = SIZE_VIFIFO;
+		sess->vififo_vaddr =
+			amvdec_pool_alloc(core, AMVDEC_POOL_VIFIFO,
+					  sess->vififo_size,
+					  &sess->vififo_paddr, false);
+		if (!sess->vififo_vaddr) {
+			dev_err(sess->core->dev,
+				"Failed to request VIFIFO buffer\n");
+			return -ENOMEM;
+		}
 	}
 
 	sess->should_stop = 0;
@@ -311,25 +395,109 @@ static int vdec_start_streaming(struct vb2_queue *q, unsigned int count)
 	sess->dpb_size = 0;
 	sess->pixelaspect.numerator = 1;
 	sess->pixelaspect.denominator = 1;
+	sess->cap_wait_start = 0;
 	atomic_set(&sess->esparser_queued_bufs, 0);
 
+	ret = vdec_tunnel_bind(sess);
+	if (ret) {
+		dev_err(sess->core->dev, "Failed to bind the display tunnel\n");
+		goto vififo_free;
+	}
+
+	/* The ISRs may fire as soon as the firmware is running */
+	core->cur_sess = sess;
 	ret = vdec_poweron(sess);
 	if (ret)
 		goto vififo_free;
 
 	sess->sequence_cap = 0;
 	if (vdec_codec_needs_recycle(sess))
-		sess->recycle_thread = kthread_run(vdec_recycle_thread, sess,
-						   "vdec_recycle");
+		vdec_recycle_enable(sess, true);
 
 	sess->status = STATUS_RUNNING;
-	core->cur_sess = sess;
+	sess->run_start = ktime_get();
+	v4l2_ctrl_grab(v4l2_ctrl_find(&sess->ctrl_handler,
+				      V4L2_CID_MESON_VDEC_RING_MODE), true);
+	v4l2_ctrl_grab(v4l2_ctrl_find(&sess->ctrl_handler,
+				      V4L2_CID_MESON_VDEC_TUNNEL), true);
 
 	return 0;
 
 vififo_free:
-	dma_free_coherent(sess->core->dev, sess->vififo_size,
-			  sess->vififo_vaddr, sess->vififo_paddr);
+	vdec_tunnel_unbind(sess);
+	core->cur_sess = NULL;
+	if (!sess->ring_mode)
+		amvdec_pool_free(core, AMVDEC_POOL_VIFIFO);
+	return ret;
+}
+
+/* Hand the decoder over to the sessions that were waiting for it */
+static void vdec_run_next_session(struct amvdec_core *core)
+{
+	struct amvdec_session *next;
+
+	while (!core->cur_sess && !list_empty(&core->sess_queue)) {
+		next = list_first_entry(&core->sess_queue,
+					struct amvdec_session, sched_list);
+		list_del_init(&next->sched_list);
+		next->status = STATUS_STOPPED;
+
+		if (vdec_session_run(next)) {
+			dev_err(core->dev, "Failed to start queued session %u\n",
+				next->id);
+			amvdec_abort(next);
+			continue;
+		}
+
+		dev_dbg(core->dev, "Session %u got the decoder\n", next->id);
+		schedule_work(&next->esparser_queue_work);
+	}
+}
+
+static int vdec_start_streaming(struct vb2_queue *q, unsigned int count)
+{
+	struct amvdec_session *sess = vb2_get_drv_priv(q);
+	struct amvdec_codec_ops *codec_ops = sess->fmt_out->codec_ops;
+	struct amvdec_core *core = sess->core;
+	struct vb2_v4l2_buffer *buf;
+	int ret;
+
+	if (q->type == V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE)
+		sess->streamon_out = 1;
+	else
+		sess->streamon_cap = 1;
+
+	if (!sess->streamon_out || !sess->streamon_cap)
+		return 0;
+
+	if (sess->status == STATUS_NEEDS_RESUME &&
+	    q->type == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE) {
+		ret = vdec_tunnel_bind(sess);
+		if (ret)
+			goto bufs_done;
+
+		codec_ops->resume(sess);
+		sess->status = STATUS_RUNNING;
+		return 0;
+	}
+
+	/* The firmwares keep the whole decoding context to themselves, so
+	 * the decoder can only be handed over between streams. Queue the
+	 * session until the current one stops.
+	 */
+	if (core->cur_sess && core->cur_sess != sess) {
+		dev_dbg(core->dev, "Session %u queued\n", sess->id);
+		sess->status = STATUS_QUEUED;
+		list_add_tail(&sess->sched_list, &core->sess_queue);
+		return 0;
+	}
+
+	ret = vdec_session_run(sess);
+	if (ret)
+		goto bufs_done;
+
+	return 0;
+
 bufs_done:
 	while ((buf = v4l2_m2m_src_buf_remove(sess->m2m_ctx)))
 		v4l2_m2m_buf_done(buf, VB2_BUF_STATE_QUEUED);
@@ -354,48 +522,50 @@ static void vdec_free_canvas(struct amvdec_session *sess)
 	sess->canvas_num = 0;
 }
 
-static void vdec_reset_timestamps(struct amvdec_session *sess)
-{
-	struct amvdec_timestamp *tmp, *n;
-
-	list_for_each_entry_safe(tmp, n, &sess->timestamps, list) {
-		list_del(&tmp->list);
-		kfree(tmp);
-	}
-}
-
-static void vdec_reset_bufs_recycle(struct amvdec_session *sess)
-{
-	struct amvdec_buffer *tmp, *n;
-
-	list_for_each_entry_safe(tmp, n, &sess->bufs_recycle, list) {
-		list_del(&tmp->list);
-		kfree(tmp);
-	}
-}
-
 static void vdec_stop_streaming(struct vb2_queue *q)
 {
 	struct amvdec_session *sess = vb2_get_drv_priv(q);
 	struct amvdec_core *core = sess->core;
 	struct vb2_v4l2_buffer *buf;
 
+	/*
+	 * The CAPTURE buffers held by the display must be back before they
+	 * are returned. Seeking only drops the frames not shown yet.
+	 */
+	if (q->type == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE)
+		vdec_tunnel_unbind(sess);
+	else if (sess->tunnel_bound)
+		meson_tunnel_flush();
+
+	if (sess->status == STATUS_QUEUED) {
+		list_del_init(&sess->sched_list);
+		sess->status = STATUS_STOPPED;
+	}
+
 	if (sess->status == STATUS_RUNNING ||
 	    (sess->status == STATUS_NEEDS_RESUME &&
 	     (!sess->streamon_out || !sess->streamon_cap))) {
 		if (vdec_codec_needs_recycle(sess))
-			kthread_stop(sess->recycle_thread);
+			vdec_recycle_enable(sess, false);
 
 		vdec_poweroff(sess);
 		vdec_free_canvas(sess);
-		dma_free_coherent(sess->core->dev, sess->vififo_size,
-				  sess->vififo_vaddr, sess->vififo_paddr);
-		vdec_reset_timestamps(sess);
-		vdec_reset_bufs_recycle(sess);
+		if (!sess->ring_mode)
+			amvdec_pool_free(core, AMVDEC_POOL_VIFIFO);
+		amvdec_reset_ts(sess);
 		kfree(sess->priv);
 		sess->priv = NULL;
+		sess->run_time += ktime_to_ns(ktime_sub(ktime_get(),
+							sess->run_start));
 		core->cur_sess = NULL;
 		sess->status = STATUS_STOPPED;
+		v4l2_ctrl_grab(v4l2_ctrl_find(&sess->ctrl_handler,
+					      V4L2_CID_MESON_VDEC_RING_MODE),
+			       false);
+		v4l2_ctrl_grab(v4l2_ctrl_find(&sess->ctrl_handler,
+					      V4L2_CID_MESON_VDEC_TUNNEL),
+			       false);
+		vdec_run_next_session(core);
 	}
 
 	if (q->type == V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE) {
@@ -553,8 +723,8 @@ static int vdec_g_fmt(struct file *file, void *fh, struct v4l2_format *f)
 		pixmp->quantization = sess->quantization;
 		pixmp->xfer_func = sess->xfer_func;
 	} else if (f->type == V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE) {
-		pixmp->width = sess->width;
-		pixmp->height = sess->height;
+		pixmp->width = sess->coded_width;
+		pixmp->height = sess->coded_height;
 	}
 
 	vdec_try_fmt_common(sess, sess->core->platform->num_formats, f);
@@ -594,8 +764,8 @@ static int vdec_s_fmt(struct file *file, void *fh, struct v4l2_format *f)
 	vdec_try_fmt_common(sess, num_formats, &format);
 
 	if (f->type == V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE) {
-		sess->width = format.fmt.pix_mp.width;
-		sess->height = format.fmt.pix_mp.height;
+		sess->coded_width = format.fmt.pix_mp.width;
+		sess->coded_height = format.fmt.pix_mp.height;
 		sess->colorspace = pixmp->colorspace;
 		sess->ycbcr_enc = pixmp->ycbcr_enc;
 		sess->quantization = pixmp->quantization;
@@ -717,7 +887,10 @@ vdec_decoder_cmd(struct file *file, void *fh, struct v4l2_decoder_cmd *cmd)
 		u32 len;
 		const u8 *data = codec_ops->eos_sequence(&len);
 
-		esparser_queue_eos(sess->core, data, len);
+		if (sess->ring_mode)
+			esparser_ring_queue_eos(sess, data, len);
+		else
+			esparser_queue_eos(sess, data, len);
 	}
 
 	return ret;
@@ -814,6 +987,61 @@ static int m2m_queue_init(void *priv, struct vb2_queue *src_vq,
 	return 0;
 }
 
+static const char * const vdec_status_names[] = {
+	[STATUS_STOPPED] = "stopped",
+	[STATUS_QUEUED] = "queued",
+	[STATUS_RUNNING] = "running",
+	[STATUS_NEEDS_RESUME] = "needs resume",
+};
+
+static int vdec_stats_show(struct seq_file *s, void *data)
+{
+	struct amvdec_session *sess = s->private;
+	u64 run_time = sess->run_time;
+	u64 frames = sess->frames;
+	int i;
+
+	if (sess->status == STATUS_RUNNING ||
+	    sess->status == STATUS_NEEDS_RESUME)
+		run_time += ktime_to_ns(ktime_sub(ktime_get(),
+						  sess->run_start));
+
+	seq_printf(s, "status: %s\n", vdec_status_names[sess->status]);
+	seq_printf(s, "format: %4.4s\n", (char *)&sess->fmt_out->pixfmt);
+	seq_printf(s, "resolution: %ux%u\n", sess->width, sess->height);
+	seq_printf(s, "frames: %llu\n", frames);
+	seq_printf(s, "decoder time (us): %llu\n", div_u64(run_time, 1000));
+	seq_printf(s, "irq time (us): %llu\n", div_u64(sess->irq_time, 1000));
+	seq_printf(s, "decoder time per frame (us): %llu\n",
+		   frames ? div64_u64(run_time, frames * 1000) : 0);
+	seq_printf(s, "capture wait time (us): %llu\n",
+		   div_u64(sess->cap_wait_time, 1000));
+	seq_printf(s, "vififo usage max: %u/%u\n",
+		   sess->vififo_usage_max, sess->vififo_size);
+	seq_printf(s, "timestamp misses: %llu\n", sess->ts_misses);
+
+	seq_puts(s, "latency histogram (ms):\n");
+	for (i = 0; i < VDEC_LATENCY_BUCKETS - 1; ++i)
+		seq_printf(s, "  <%u: %llu\n", 1 << i, sess->latency_hist[i]);
+	seq_printf(s, "  >=%u: %llu\n", 1 << i, sess->latency_hist[i]);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(vdec_stats);
+
+static void vdec_debugfs_init(struct amvdec_session *sess)
+{
+	char name[16];
+
+	if (IS_ERR_OR_NULL(sess->core->debugfs))
+		return;
+
+	snprintf(name, sizeof(name), "session%u", sess->id);
+	sess->debugfs = debugfs_create_dir(name, sess->core->debugfs);
+	debugfs_create_file("stats", 0444, sess->debugfs, sess,
+			    &vdec_stats_fops);
+}
+
 static int vdec_open(struct file *file)
 {
 	struct amvdec_core *core = video_drvdata(file);
@@ -826,7 +1054,15 @@ static int vdec_open(struct file *file)
 	if (!sess)
 		return -ENOMEM;
 
+	sess->timestamps = kcalloc(AMVDEC_MAX_TS, sizeof(*sess->timestamps),
+				   GFP_KERNEL);
+	if (!sess->timestamps) {
+		ret = -ENOMEM;
+		goto err_free_sess;
+	}
+
 	sess->core = core;
+	sess->id = atomic_inc_return(&core->sess_id);
 
 	sess->m2m_dev = v4l2_m2m_init(&vdec_m2m_ops);
 	if (IS_ERR(sess->m2m_dev)) {
@@ -850,14 +1086,18 @@ static int vdec_open(struct file *file)
 	sess->fmt_out = &formats[0];
 	sess->width = 1280;
 	sess->height = 720;
+	sess->coded_width = 1280;
+	sess->coded_height = 720;
 	sess->pixelaspect.numerator = 1;
 	sess->pixelaspect.denominator = 1;
 
-	INIT_LIST_HEAD(&sess->timestamps);
-	INIT_LIST_HEAD(&sess->bufs_recycle);
+	INIT_KFIFO(sess->bufs_recycle);
+	INIT_DELAYED_WORK(&sess->recycle_work, vdec_recycle_work);
+	INIT_LIST_HEAD(&sess->sched_list);
 	INIT_WORK(&sess->esparser_queue_work, esparser_queue_all_src);
+	init_completion(&sess->esparser_done);
 	mutex_init(&sess->lock);
-	mutex_init(&sess->bufs_recycle_lock);
+	spin_lock_init(&sess->bufs_recycle_lock);
 	spin_lock_init(&sess->ts_spinlock);
 
 	v4l2_fh_init(&sess->fh, core->vdev_dec);
@@ -866,11 +1106,14 @@ static int vdec_open(struct file *file)
 	sess->fh.m2m_ctx = sess->m2m_ctx;
 	file->private_data = &sess->fh;
 
+	vdec_debugfs_init(sess);
+
 	return 0;
 
 err_m2m_release:
 	v4l2_m2m_release(sess->m2m_dev);
 err_free_sess:
+	kfree(sess->timestamps);
 	kfree(sess);
 	return ret;
 }
@@ -879,45 +1122,102 @@ static int vdec_close(struct file *file)
 {
 	struct amvdec_session *sess =
 		container_of(file->private_data, struct amvdec_session, fh);
+	struct amvdec_core *core = sess->core;
+
+	debugfs_remove_recursive(sess->debugfs);
 
+	/* Streaming may stop here, serialize with the ioctls of the sessions
+	 * that could get the decoder next.
+	 */
+	mutex_lock(&core->lock);
 	v4l2_m2m_ctx_release(sess->m2m_ctx);
+	mutex_unlock(&core->lock);
 	v4l2_m2m_release(sess->m2m_dev);
 	v4l2_fh_del(&sess->fh);
 	v4l2_fh_exit(&sess->fh);
 
+	esparser_ring_free(sess);
+
 	mutex_destroy(&sess->lock);
-	mutex_destroy(&sess->bufs_recycle_lock);
 
+	kfree(sess->timestamps);
 	kfree(sess);
 
 	return 0;
 }
 
+static int vdec_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct amvdec_session *sess =
+		container_of(file->private_data, struct amvdec_session, fh);
+	unsigned long offset = vma->vm_pgoff << PAGE_SHIFT;
+	int ret;
+
+	if (offset != MESON_VDEC_RING_DATA_OFFSET &&
+	    offset != MESON_VDEC_RING_CTRL_OFFSET)
+		return v4l2_m2m_fop_mmap(file, vma);
+
+	if (mutex_lock_interruptible(&sess->lock))
+		return -ERESTARTSYS;
+
+	ret = esparser_ring_mmap(sess, vma);
+	mutex_unlock(&sess->lock);
+
+	return ret;
+}
+
 static const struct v4l2_file_operations vdec_fops = {
 	.owner = THIS_MODULE,
 	.open = vdec_open,
 	.release = vdec_close,
 	.unlocked_ioctl = video_ioctl2,
 	.poll = v4l2_m2m_fop_poll,
-	.mmap = v4l2_m2m_fop_mmap,
+	.mmap = vdec_mmap,
 };
 
+static DEFINE_PERF_HOTPATH(vdec_isr_hotpath, "vdec_isr");
+
 static irqreturn_t vdec_isr(int irq, void *data)
 {
 	struct amvdec_core *core = data;
 	struct amvdec_session *sess = core->cur_sess;
+	ktime_t start = ktime_get();
+	irqreturn_t ret;
+	u64 duration;
 
 	sess->last_irq_jiffies = get_jiffies_64();
 
-	return sess->fmt_out->codec_ops->isr(sess);
+	perf_hotpath_enter(&vdec_isr_hotpath);
+	ret = sess->fmt_out->codec_ops->isr(sess);
+	perf_hotpath_exit(&vdec_isr_hotpath);
+	duration = ktime_to_ns(ktime_sub(ktime_get(), start));
+	sess->irq_time += duration;
+	trace_vdec_isr(sess, false, duration);
+	lat_hist_record(core->isr_hist, duration);
+	core->isr_ns = lat_hist_now();
+
+	return ret;
 }
 
 static irqreturn_t vdec_threaded_isr(int irq, void *data)
 {
 	struct amvdec_core *core = data;
 	struct amvdec_session *sess = core->cur_sess;
+	ktime_t start = ktime_get();
+	irqreturn_t ret;
+	u64 duration;
 
-	return sess->fmt_out->codec_ops->threaded_isr(sess);
+	lat_hist_record_since(core->thread_hist, core->isr_ns);
+
+	ret = sess->fmt_out->codec_ops->threaded_isr(sess);
+	duration = ktime_to_ns(ktime_sub(ktime_get(), start));
+	sess->irq_time += duration;
+	trace_vdec_isr(sess, true, duration);
+
+	if (vdec_codec_needs_recycle(sess))
+		vdec_recycle_bufs(sess);
+
+	return ret;
 }
 
 static const struct of_device_id vdec_dt_match[] = {
@@ -947,6 +1247,7 @@ static int vdec_probe(struct platform_device *pdev)
 
 	core->dev = dev;
 	platform_set_drvdata(pdev, core);
+	device_enable_async_suspend(dev);
 
 	r = platform_get_resource_byname(pdev, IORESOURCE_MEM, "dos");
 	core->dos_base = devm_ioremap_resource(dev, r);
@@ -993,6 +1294,9 @@ static int vdec_probe(struct platform_device *pdev)
 	if (irq < 0)
 		return irq;
 
+	core->isr_hist = devm_lat_hist_add(dev, "isr");
+	core->thread_hist = devm_lat_hist_add(dev, "isr_thread");
+
 	ret = devm_request_threaded_irq(core->dev, irq, vdec_isr,
 					vdec_threaded_isr, IRQF_ONESHOT,
 					"vdec", core);
@@ -1020,6 +1324,10 @@ static int vdec_probe(struct platform_device *pdev)
 	core->vdev_dec = vdev;
 	core->dev_dec = dev;
 	mutex_init(&core->lock);
+	mutex_init(&core->pool_lock);
+	INIT_LIST_HEAD(&core->sess_queue);
+	INIT_LIST_HEAD(&core->fw_cache);
+	core->debugfs = debugfs_create_dir("meson-vdec", NULL);
 
 	strscpy(vdev->name, "meson-video-decoder", sizeof(vdev->name));
 	vdev->release = video_device_release;
@@ -1038,9 +1346,27 @@ static int vdec_probe(struct platform_device *pdev)
 		goto err_vdev_release;
 	}
 
+	ret = amvenc_probe(pdev, core);
+	if (ret) {
+		video_unregister_device(vdev);
+		debugfs_remove_recursive(core->debugfs);
+		return ret;
+	}
+
+	if (warm_planes) {
+		u32 size = get_output_size(3840, 2160);
+
+		if (dma_contiguous_set_warm_pool(dev, PAGE_ALIGN(size) >> PAGE_SHIFT,
+						 get_order(size), warm_planes))
+			dev_warn(dev, "Couldn't set up the CMA warm pool\n");
+	}
+
+	perf_hotpath_register(&vdec_isr_hotpath);
+
 	return 0;
 
 err_vdev_release:
+	debugfs_remove_recursive(core->debugfs);
 	video_device_release(vdev);
 	return ret;
 }
@@ -1049,7 +1375,12 @@ static int vdec_remove(struct platform_device *pdev)
 {
 	struct amvdec_core *core = platform_get_drvdata(pdev);
 
+	perf_hotpath_unregister(&vdec_isr_hotpath);
+	amvenc_remove(core);
 	video_unregister_device(core->vdev_dec);
+	debugfs_remove_recursive(core->debugfs);
+	amvdec_pool_release(core);
+	dma_contiguous_set_warm_pool(&pdev->dev, 0, 0, 0);
 
 	return 0;
 }
@@ -9,35 +9,109 @@
 
 #include <linux/regmap.h>
 #include <linux/list.h>
+#include <linux/kfifo.h>
+#include <linux/lat_hist.h>
 #include <media/videobuf2-v4l2.h>
 #include <media/v4l2-ctrls.h>
 #include <media/v4l2-device.h>
 #include <linux/soc/amlogic/meson-canvas.h>
+#include <linux/soc/amlogic/meson-tunnel.h>
+#include <linux/meson-vdec.h>
 
 #include "vdec_platform.h"
 
 /* 32 buffers in 3-plane YUV420 */
 #define MAX_CANVAS (32 * 3)
 
-struct amvdec_buffer {
-	struct list_head list;
-	struct vb2_buffer *vb;
-};
+/* Decode latency histogram: <1ms, <2ms, <4ms ... <256ms, >=256ms */
+#define VDEC_LATENCY_BUCKETS 10
+
+/* Number of timestamp ring entries, must be a power of 2 */
+#define AMVDEC_MAX_TS 256
 
 /**
  * struct amvdec_timestamp - stores a src timestamp along with a VIFIFO offset
  *
- * @list: used to make lists out of this struct
  * @ts: timestamp
  * @offset: offset in the VIFIFO where the associated packet was written
+ * @counted: whether this entry is accounted in esparser_queued_bufs
+ * @used: whether this entry is still waiting for a dst buffer
+ * @queued: time the packet was handed to the ESPARSER
  */
 struct amvdec_timestamp {
-	struct list_head list;
 	u64 ts;
 	u32 offset;
+	bool counted;
+	bool used;
+	ktime_t queued;
 };
 
 struct amvdec_session;
+struct amvenc_session;
+
+/**
+ * struct amvdec_ring - kernel side of the ring input mode
+ *
+ * @ctrl: shared control page, mapped by userspace
+ * @ctrl_paddr: physical address of @ctrl
+ * @vaddr: virtual address of the VIFIFO used in ring mode
+ * @paddr: physical address of the VIFIFO used in ring mode
+ * @size: size of the VIFIFO
+ * @wp: last write pointer pushed to the VDEC
+ * @ts_rp: next timestamp slot to consume
+ * @running: flag set while the VDEC is fed from the ring
+ * @poll_work: delayed work syncing @ctrl with the VDEC
+ * @sess: session owning this ring
+ */
+struct amvdec_ring {
+	struct meson_vdec_ring *ctrl;
+	dma_addr_t ctrl_paddr;
+	void *vaddr;
+	dma_addr_t paddr;
+	u32 size;
+	u32 wp;
+	u32 ts_rp;
+	bool running;
+	struct delayed_work poll_work;
+	struct amvdec_session *sess;
+};
+
+/**
+ * enum amvdec_pool_id - DMA buffers kept by the core across sessions
+ *
+ * Only one session owns the decoder at a time, so each kind of buffer
+ * gets a single slot.
+ *
+ * @AMVDEC_POOL_VIFIFO: the VIFIFO fed by the ESPARSER
+ * @AMVDEC_POOL_WORKSPACE: codec workspace
+ * @AMVDEC_POOL_MV: motion vector buffers, sized to the stream
+ * @AMVDEC_POOL_EXT_FW: extended firmware, for codecs that need one
+ * @AMVDEC_POOL_MC: firmware image, while it gets DMA'd to the decoder
+ * @AMVDEC_POOL_NUM: number of slots
+ */
+enum amvdec_pool_id {
+	AMVDEC_POOL_VIFIFO,
+	AMVDEC_POOL_WORKSPACE,
+	AMVDEC_POOL_MV,
+	AMVDEC_POOL_EXT_FW,
+	AMVDEC_POOL_MC,
+	AMVDEC_POOL_NUM,
+};
+
+/**
+ * struct amvdec_pool_buf - DMA buffer kept by the core
+ *
+ * @vaddr: virtual address
+ * @paddr: physical address
+ * @size: allocated size, never shrinks
+ * @busy: flag set while a session uses the buffer
+ */
+struct amvdec_pool_buf {
+	void *vaddr;
+	dma_addr_t paddr;
+	size_t size;
+	bool busy;
+};
 
 /**
  * struct amvdec_core - device parameters, singleton
@@ -53,11 +127,26 @@ struct amvdec_session;
  * @dos_clk: DOS clock
  * @vdec_1_clk: VDEC_1 clock
  * @vdec_hevc_clk: VDEC_HEVC clock
+ * @hcodec_clk: HCODEC clock, NULL if the encoder isn't described
  * @esparser_reset: RESET for the PARSER
  * @vdec_dec: video device for the decoder
+ * @vdev_enc: video device for the encoder
+ * @m2m_dev_enc: v4l2 m2m device of the encoder, shared by its sessions
+ * @enc_sess: encoding session owning HCODEC
+ * @enc_irq: HCODEC mailbox interrupt
+ * @enc_lock: lock for @enc_sess and the encoder video device
  * @v4l2_dev: v4l2 device
  * @cur_sess: current decoding session
+ * @sess_queue: sessions waiting for @cur_sess to stop, in FIFO order
+ * @sess_id: last session ID handed out
+ * @debugfs: debugfs directory of the device
+ * @pool: DMA buffers kept across sessions
+ * @fw_cache: list of the firmware images loaded so far
+ * @pool_lock: lock for @pool and @fw_cache
  * @lock: lock for this structure
+ * @isr_hist: latency histogram of the interrupt handler
+ * @thread_hist: latency histogram of the threaded handler wake up
+ * @isr_ns: time the interrupt handler returned at
  */
 struct amvdec_core {
 	void __iomem *dos_base;
@@ -74,14 +163,30 @@ struct amvdec_core {
 	struct clk *dos_clk;
 	struct clk *vdec_1_clk;
 	struct clk *vdec_hevc_clk;
+	struct clk *hcodec_clk;
 
 	struct reset_control *esparser_reset;
 
 	struct video_device *vdev_dec;
+	struct video_device *vdev_enc;
+	struct v4l2_m2m_dev *m2m_dev_enc;
+	struct amvenc_session *enc_sess;
+	int enc_irq;
+	struct mutex enc_lock;
 	struct v4l2_device v4l2_dev;
 
 	struct amvdec_session *cur_sess;
+	struct list_head sess_queue;
+	atomic_t sess_id;
+	struct dentry *debugfs;
+	struct amvdec_pool_buf pool[AMVDEC_POOL_NUM];
+	struct list_head fw_cache;
+	struct mutex pool_lock;
 	struct mutex lock;
+
+	struct lat_hist *isr_hist;
+	struct lat_hist *thread_hist;
+	u64 isr_ns;
 };
 
 /**
@@ -92,6 +197,8 @@ struct amvdec_core {
  * @conf_esparser: mandatory call to let the vdec configure the ESPARSER
  * @vififo_level: mandatory call to get the current amount of data
  *		  in the VIFIFO
+ * @vififo_set_wp: optional call to manually move the VIFIFO write pointer.
+ *		   Needed for the ring input mode.
  * @use_offsets: mandatory call. Returns 1 if the VDEC supports vififo offsets
  */
 struct amvdec_ops {
@@ -99,6 +206,7 @@ struct amvdec_ops {
 	int (*stop)(struct amvdec_session *sess);
 	void (*conf_esparser)(struct amvdec_session *sess);
 	u32 (*vififo_level)(struct amvdec_session *sess);
+	void (*vififo_set_wp)(struct amvdec_session *sess, dma_addr_t wp);
 };
 
 
@@ -165,6 +273,7 @@ struct amvdec_format {
 
 enum amvdec_status {
 	STATUS_STOPPED,
+	STATUS_QUEUED,
 	STATUS_RUNNING,
 	STATUS_NEEDS_RESUME,
 };
@@ -179,8 +288,10 @@ enum amvdec_status {
  * @lock: session lock
  * @fmt_out: vdec pixel format for the OUTPUT queue
  * @pixfmt_cap: V4L2 pixel format for the CAPTURE queue
- * @width: current picture width
- * @height: current picture height
+ * @width: current picture width, as written to the CAPTURE buffers
+ * @height: current picture height, as written to the CAPTURE buffers
+ * @coded_width: picture width in the bitstream
+ * @coded_height: picture height in the bitstream
  * @colorspace: current colorspace
  * @ycbcr_enc: current ycbcr_enc
  * @quantization: current quantization
@@ -188,24 +299,47 @@ enum amvdec_status {
  * @pixelaspect: Pixel Aspect Ratio reported by the decoder
  * @esparser_queued_bufs: number of buffers currently queued into ESPARSER
  * @esparser_queue_work: work struct for the ESPARSER to process src buffers
+ * @esparser_done: signaled by the ESPARSER ISR once a packet was parsed
  * @streamon_cap: stream on flag for capture queue
  * @streamon_out: stream on flag for output queue
  * @sequence_cap: capture sequence counter
  * @should_stop: flag set if userspace signaled EOS via command
  *		 or empty buffer
  * @keyframe_found: flag set once a keyframe has been parsed
+ * @ring_mode: flag set if userspace writes directly into the VIFIFO
+ * @ring: ring input mode state, allocated on first use
+ * @tunnel: flag set if decoded frames go to the display instead of userspace
+ * @tunnel_bound: flag set while the session feeds the display tunnel
+ * @tunnel_paused: presentation paused by userspace
+ * @tunnel_offset: presentation delay set by userspace, in ns
+ * @tunnel_frames: tunnel frame of each CAPTURE buffer
  * @canvas_alloc: array of all the canvas IDs allocated
  * @canvas_num: number of canvas IDs allocated
  * @vififo_vaddr: virtual address for the VIFIFO
  * @vififo_paddr: physical address for the VIFIFO
  * @vififo_size: size of the VIFIFO dma alloc
- * @bufs_recycle: list of buffers that need to be recycled
- * @bufs_recycle_lock: lock for the bufs_recycle list
- * @recycle_thread: task struct for the recycling thread
- * @timestamps: chronological list of src timestamps
- * @ts_spinlock: spinlock for the timestamps list
+ * @bufs_recycle: FIFO of CAPTURE buffer indexes to hand back to the firmware
+ * @bufs_recycle_lock: lock for bufs_recycle and the firmware recycle registers
+ * @recycle_work: retries recycling when the firmware mailbox was busy
+ * @recycle_enabled: flag set while the firmware can accept recycled buffers
+ * @timestamps: ring of AMVDEC_MAX_TS src timestamps, sorted by offset
+ * @ts_head: free-running index of the oldest entry in @timestamps
+ * @ts_tail: free-running index of the next free entry in @timestamps
+ * @ts_misses: number of dst buffers that couldn't be matched to a timestamp
+ * @ts_spinlock: spinlock for the timestamps ring
  * @last_irq_jiffies: tracks last time the vdec triggered an IRQ
  * @status: current decoding status
+ * @sched_list: entry in the core queue while waiting for the decoder
+ * @id: session ID, used to name the debugfs directory
+ * @debugfs: debugfs directory of the session
+ * @run_start: time the session last got the decoder
+ * @run_time: total time spent owning the decoder
+ * @irq_time: total time spent in the codec interrupt handlers
+ * @frames: total number of frames decoded
+ * @latency_hist: histogram of the ESPARSER to frame done latencies
+ * @cap_wait_start: time the ESPARSER started waiting on CAPTURE buffers
+ * @cap_wait_time: total time the ESPARSER waited on CAPTURE buffers
+ * @vififo_usage_max: highest VIFIFO usage seen
  * @priv: codec private data
  */
 struct amvdec_session {
@@ -222,6 +356,8 @@ struct amvdec_session {
 
 	u32 width;
 	u32 height;
+	u32 coded_width;
+	u32 coded_height;
 	u32 colorspace;
 	u8 ycbcr_enc;
 	u8 quantization;
@@ -231,11 +367,13 @@ struct amvdec_session {
 
 	atomic_t esparser_queued_bufs;
 	struct work_struct esparser_queue_work;
+	struct completion esparser_done;
 
 	unsigned int streamon_cap, streamon_out;
 	unsigned int sequence_cap;
 	unsigned int should_stop;
 	unsigned int keyframe_found;
+	unsigned int ring_mode;
 	unsigned int num_dst_bufs;
 
 	u8 canvas_alloc[MAX_CANVAS];
@@ -245,11 +383,23 @@ struct amvdec_session {
 	dma_addr_t vififo_paddr;
 	u32 vififo_size;
 
-	struct list_head bufs_recycle;
-	struct mutex bufs_recycle_lock;
-	struct task_struct *recycle_thread;
+	struct amvdec_ring *ring;
+
+	unsigned int tunnel;
+	bool tunnel_bound;
+	bool tunnel_paused;
+	s64 tunnel_offset;
+	struct meson_tunnel_frame tunnel_frames[VIDEO_MAX_FRAME];
+
+	DECLARE_KFIFO(bufs_recycle, u32, VIDEO_MAX_FRAME);
+	spinlock_t bufs_recycle_lock;
+	struct delayed_work recycle_work;
+	unsigned int recycle_enabled;
 
-	struct list_head timestamps;
+	struct amvdec_timestamp *timestamps;
+	u32 ts_head;
+	u32 ts_tail;
+	u64 ts_misses;
 	spinlock_t ts_spinlock;
 
 	u64 last_irq_jiffies;
@@ -258,6 +408,19 @@ struct amvdec_session {
 	u32 dpb_size;
 
 	enum amvdec_status status;
+
+	struct list_head sched_list;
+	u32 id;
+	struct dentry *debugfs;
+	ktime_t run_start;
+	u64 run_time;
+	u64 irq_time;
+	u64 frames;
+	u64 latency_hist[VDEC_LATENCY_BUCKETS];
+	ktime_t cap_wait_start;
+	u64 cap_wait_time;
+	u32 vififo_usage_max;
+
 	void *priv;
 };
 
@@ -28,29 +28,27 @@ vdec_1_load_firmware(struct amvdec_session *sess, const char *fwname)
 	struct amvdec_core *core = sess->core;
 	struct device *dev = core->dev_dec;
 	struct amvdec_codec_ops *codec_ops = sess->fmt_out->codec_ops;
-	static void *mc_addr;
-	static dma_addr_t mc_addr_map;
-	int ret;
+	void *mc_addr;
+	dma_addr_t mc_addr_map;
+	int ret = 0;
 	u32 i = 1000;
 
-	ret = request_firmware(&fw, fwname, dev);
-	if (ret < 0)
+	fw = amvdec_request_firmware(core, fwname);
+	if (!fw)
 		return -EINVAL;
 
 	if (fw->size < MC_SIZE) {
 		dev_err(dev, "Firmware size %zu is too small. Expected %u.\n",
 			fw->size, MC_SIZE);
-		ret = -EINVAL;
-		goto release_firmware;
+		return -EINVAL;
 	}
 
-	mc_addr = dma_alloc_coherent(core->dev, MC_SIZE,
-				     &mc_addr_map, GFP_KERNEL);
+	mc_addr = amvdec_pool_alloc(core, AMVDEC_POOL_MC, MC_SIZE,
+				    &mc_addr_map, false);
 	if (!mc_addr) {
 		dev_err(dev,
 			"Failed allocating memory for firmware loading\n");
-		ret = -ENOMEM;
-		goto release_firmware;
+		return -ENOMEM;
 	}
 
 	memcpy(mc_addr, fw->data, MC_SIZE);
@@ -78,9 +76,7 @@ vdec_1_load_firmware(struct amvdec_session *sess, const char *fwname)
 							fw->size - MC_SIZE);
 
 free_mc:
-	dma_free_coherent(core->dev, MC_SIZE, mc_addr, mc_addr_map);
-release_firmware:
-	release_firmware(fw);
+	amvdec_pool_free(core, AMVDEC_POOL_MC);
 	return ret;
 }
 
@@ -130,6 +126,12 @@ static u32 vdec_1_vififo_level(struct amvdec_session *sess)
 	return amvdec_read_dos(core, VLD_MEM_VIFIFO_LEVEL);
 }
 
+/* The VIFIFO is left in manual mode when the ESPARSER is not used */
+static void vdec_1_vififo_set_wp(struct amvdec_session *sess, dma_addr_t wp)
+{
+	amvdec_write_dos(sess->core, VLD_MEM_VIFIFO_WP, wp);
+}
+
 static int vdec_1_stop(struct amvdec_session *sess)
 {
 	struct amvdec_core *core = sess->core;
@@ -179,7 +181,10 @@ static int vdec_1_start(struct amvdec_session *sess)
 	amvdec_write_dos(core, DOS_SW_RESET0, 0xfffffffc);
 	amvdec_write_dos(core, DOS_SW_RESET0, 0x00000000);
 
-	amvdec_write_dos(core, DOS_GCLK_EN0, 0x3ff);
+	/* The HCODEC gates belong to the encoder, which may be running */
+	amvdec_write_dos(core, DOS_GCLK_EN0,
+			 (amvdec_read_dos(core, DOS_GCLK_EN0) &
+			  DOS_GCLK_EN0_HCODEC) | 0x3ff);
 
 	/* enable VDEC Memories */
 	amvdec_write_dos(core, DOS_MEM_PD_VDEC, 0);
@@ -228,4 +233,5 @@ struct amvdec_ops vdec_1_ops = {
 	.stop = vdec_1_stop,
 	.conf_esparser = vdec_1_conf_esparser,
 	.vififo_level = vdec_1_vififo_level,
+	.vififo_set_wp = vdec_1_vififo_set_wp,
 };
@@ -1,3 +1,5 @@
+#include <media/v4l2-mem2mem.h>
+
 #include "vdec_ctrls.h"
 
 static int vdec_op_g_volatile_ctrl(struct v4l2_ctrl *ctrl)
@@ -16,8 +18,84 @@ static int vdec_op_g_volatile_ctrl(struct v4l2_ctrl *ctrl)
 	return 0;
 }
 
+static int vdec_op_s_ctrl(struct v4l2_ctrl *ctrl)
+{
+	struct amvdec_session *sess =
+	      container_of(ctrl->handler, struct amvdec_session, ctrl_handler);
+
+	switch (ctrl->id) {
+	case V4L2_CID_MESON_VDEC_RING_MODE:
+		sess->ring_mode = ctrl->val;
+		/* Nothing goes through the OUTPUT queue in ring mode */
+		sess->m2m_ctx->out_q_ctx.q.min_buffers_needed = !ctrl->val;
+		break;
+	case V4L2_CID_MESON_VDEC_TUNNEL:
+		sess->tunnel = ctrl->val;
+		break;
+	case V4L2_CID_MESON_VDEC_TUNNEL_PAUSE:
+		sess->tunnel_paused = ctrl->val;
+		if (sess->tunnel_bound)
+			meson_tunnel_set_paused(ctrl->val);
+		break;
+	case V4L2_CID_MESON_VDEC_TUNNEL_AV_OFFSET:
+		sess->tunnel_offset = (s64)ctrl->val * NSEC_PER_USEC;
+		if (sess->tunnel_bound)
+			meson_tunnel_set_offset(sess->tunnel_offset);
+		break;
+	default:
+		return -EINVAL;
+	};
+
+	return 0;
+}
+
 static const struct v4l2_ctrl_ops vdec_ctrl_ops = {
 	.g_volatile_ctrl = vdec_op_g_volatile_ctrl,
+	.s_ctrl = vdec_op_s_ctrl,
+};
+
+static const struct v4l2_ctrl_config vdec_ctrl_ring_mode = {
+	.ops = &vdec_ctrl_ops,
+	.id = V4L2_CID_MESON_VDEC_RING_MODE,
+	.name = "Ring Input Mode",
+	.type = V4L2_CTRL_TYPE_BOOLEAN,
+	.min = 0,
+	.max = 1,
+	.step = 1,
+	.def = 0,
+};
+
+static const struct v4l2_ctrl_config vdec_ctrl_tunnel = {
+	.ops = &vdec_ctrl_ops,
+	.id = V4L2_CID_MESON_VDEC_TUNNEL,
+	.name = "Display Tunnel",
+	.type = V4L2_CTRL_TYPE_BOOLEAN,
+	.min = 0,
+	.max = 1,
+	.step = 1,
+	.def = 0,
+};
+
+static const struct v4l2_ctrl_config vdec_ctrl_tunnel_pause = {
+	.ops = &vdec_ctrl_ops,
+	.id = V4L2_CID_MESON_VDEC_TUNNEL_PAUSE,
+	.name = "Display Tunnel Pause",
+	.type = V4L2_CTRL_TYPE_BOOLEAN,
+	.min = 0,
+	.max = 1,
+	.step = 1,
+	.def = 0,
+};
+
+static const struct v4l2_ctrl_config vdec_ctrl_tunnel_av_offset = {
+	.ops = &vdec_ctrl_ops,
+	.id = V4L2_CID_MESON_VDEC_TUNNEL_AV_OFFSET,
+	.name = "Display Tunnel A/V Offset",
+	.type = V4L2_CTRL_TYPE_INTEGER,
+	.min = -1000000,
+	.max = 1000000,
+	.step = 1,
+	.def = 0,
 };
 
 int amvdec_init_ctrls(struct v4l2_ctrl_handler *ctrl_handler)
@@ -25,7 +103,7 @@ int amvdec_init_ctrls(struct v4l2_ctrl_handler *ctrl_handler)
 	int ret;
 	struct v4l2_ctrl *ctrl;
 
-	ret = v4l2_ctrl_handler_init(ctrl_handler, 1);
+	ret = v4l2_ctrl_handler_init(ctrl_handler, 5);
 	if (ret)
 		return ret;
 
@@ -34,6 +112,11 @@ int amvdec_init_ctrls(struct v4l2_ctrl_handler *ctrl_handler)
 	if (ctrl)
 		ctrl->flags |= V4L2_CTRL_FLAG_VOLATILE;
 
+	v4l2_ctrl_new_custom(ctrl_handler, &vdec_ctrl_ring_mode, NULL);
+	v4l2_ctrl_new_custom(ctrl_handler, &vdec_ctrl_tunnel, NULL);
+	v4l2_ctrl_new_custom(ctrl_handler, &vdec_ctrl_tunnel_pause, NULL);
+	v4l2_ctrl_new_custom(ctrl_handler, &vdec_ctrl_tunnel_av_offset, NULL);
+
 	ret = ctrl_handler->error;
 	if (ret) {
 		v4l2_ctrl_handler_free(ctrl_handler);
@@ -4,12 +4,14 @@
  * Author: Maxime Jourdan <mjourdan@baylibre.com>
  */
 
+#include <linux/firmware.h>
 #include <linux/gcd.h>
 #include <media/v4l2-mem2mem.h>
 #include <media/v4l2-event.h>
 #include <media/videobuf2-dma-contig.h>
 
 #include "vdec_helpers.h"
+#include "vdec_trace.h"
 
 #define NUM_CANVAS_NV12 2
 #define NUM_CANVAS_YUV420 3
@@ -51,6 +53,120 @@ void amvdec_write_parser(struct amvdec_core *core, u32 reg, u32 val)
 EXPORT_SYMBOL_GPL(amvdec_write_parser);
 
 /* 4 KiB per 64x32 block */
+struct amvdec_fw {
+	struct list_head list;
+	const char *name;
+	const struct firmware *fw;
+};
+
+void *amvdec_pool_alloc(struct amvdec_core *core, enum amvdec_pool_id id,
+			size_t size, dma_addr_t *paddr, bool zero)
+{
+	struct amvdec_pool_buf *buf = &core->pool[id];
+	void *vaddr = NULL;
+
+	mutex_lock(&core->pool_lock);
+	if (WARN_ON(buf->busy))
+		goto unlock;
+
+	if (buf->vaddr && buf->size < size) {
+		dma_free_coherent(core->dev, buf->size, buf->vaddr,
+				  buf->paddr);
+		buf->vaddr = NULL;
+	}
+
+	if (!buf->vaddr) {
+		buf->vaddr = dma_alloc_coherent(core->dev, size, &buf->paddr,
+						GFP_KERNEL);
+		if (!buf->vaddr)
+			goto unlock;
+
+		buf->size = size;
+	} else if (zero) {
+		memset(buf->vaddr, 0, size);
+	}
+
+	buf->busy = true;
+	vaddr = buf->vaddr;
+	*paddr = buf->paddr;
+
+unlock:
+	mutex_unlock(&core->pool_lock);
+	return vaddr;
+}
+EXPORT_SYMBOL_GPL(amvdec_pool_alloc);
+
+void amvdec_pool_free(struct amvdec_core *core, enum amvdec_pool_id id)
+{
+	mutex_lock(&core->pool_lock);
+	core->pool[id].busy = false;
+	mutex_unlock(&core->pool_lock);
+}
+EXPORT_SYMBOL_GPL(amvdec_pool_free);
+
+void amvdec_pool_release(struct amvdec_core *core)
+{
+	struct amvdec_fw *tmp, *n;
+	int i;
+
+	mutex_lock(&core->pool_lock);
+	for (i = 0; i < AMVDEC_POOL_NUM; ++i) {
+		struct amvdec_pool_buf *buf = &core->pool[i];
+
+		WARN_ON(buf->busy);
+		if (buf->vaddr)
+			dma_free_coherent(core->dev, buf->size, buf->vaddr,
+					  buf->paddr);
+		buf->vaddr = NULL;
+	}
+
+	list_for_each_entry_safe(tmp, n, &core->fw_cache, list) {
+		list_del(&tmp->list);
+		release_firmware(tmp->fw);
+		kfree(tmp);
+	}
+	mutex_unlock(&core->pool_lock);
+}
+EXPORT_SYMBOL_GPL(amvdec_pool_release);
+
+const struct firmware *amvdec_request_firmware(struct amvdec_core *core,
+					       const char *name)
+{
+	const struct firmware *fw = NULL;
+	struct amvdec_fw *tmp;
+	int ret;
+
+	mutex_lock(&core->pool_lock);
+	list_for_each_entry(tmp, &core->fw_cache, list) {
+		if (!strcmp(tmp->name, name)) {
+			fw = tmp->fw;
+			goto unlock;
+		}
+	}
+
+	tmp = kzalloc(sizeof(*tmp), GFP_KERNEL);
+	if (!tmp)
+		goto unlock;
+
+	ret = request_firmware(&tmp->fw, name, core->dev_dec);
+	if (ret < 0) {
+		dev_err(core->dev_dec, "Unable to request firmware %s\n",
+			name);
+		kfree(tmp);
+		goto unlock;
+	}
+
+	/* Firmware paths come from the static format tables */
+	tmp->name = name;
+	list_add_tail(&tmp->list, &core->fw_cache);
+	fw = tmp->fw;
+
+unlock:
+	mutex_unlock(&core->pool_lock);
+	return fw;
+}
+EXPORT_SYMBOL_GPL(amvdec_request_firmware);
+
 u32 amvdec_am21c_body_size(u32 width, u32 height)
 {
 	u32 width_64 = ALIGN(width, 64) / 64;
@@ -99,6 +215,7 @@ static int set_canvas_yuv420m(struct amvdec_session *sess,
 			      u32 height, u32 reg)
 {
 	struct amvdec_core *core = sess->core;
+	struct meson_canvas_entry entries[NUM_CANVAS_YUV420];
 	u8 canvas_id[NUM_CANVAS_YUV420]; /* Y U V */
 	dma_addr_t buf_paddr[NUM_CANVAS_YUV420]; /* Y U V */
 	int ret, i;
@@ -112,23 +229,18 @@ static int set_canvas_yuv420m(struct amvdec_session *sess,
 		    vb2_dma_contig_plane_dma_addr(vb, i);
 	}
 
-	/* Y plane */
-	meson_canvas_config(core->canvas, canvas_id[0], buf_paddr[0],
-			    width, height, MESON_CANVAS_WRAP_NONE,
-			    MESON_CANVAS_BLKMODE_LINEAR,
-			    MESON_CANVAS_ENDIAN_SWAP64);
-
-	/* U plane */
-	meson_canvas_config(core->canvas, canvas_id[1], buf_paddr[1],
-			    width / 2, height / 2, MESON_CANVAS_WRAP_NONE,
-			    MESON_CANVAS_BLKMODE_LINEAR,
-			    MESON_CANVAS_ENDIAN_SWAP64);
+	for (i = 0; i < NUM_CANVAS_YUV420; ++i) {
+		entries[i].index = canvas_id[i];
+		entries[i].addr = buf_paddr[i];
+		/* Y plane, then U and V subsampled by 2 in both directions */
+		entries[i].stride = i ? width / 2 : width;
+		entries[i].height = i ? height / 2 : height;
+		entries[i].wrap = MESON_CANVAS_WRAP_NONE;
+		entries[i].blkmode = MESON_CANVAS_BLKMODE_LINEAR;
+		entries[i].endian = MESON_CANVAS_ENDIAN_SWAP64;
+	}
 
-	/* V plane */
-	meson_canvas_config(core->canvas, canvas_id[2], buf_paddr[2],
-			    width / 2, height / 2, MESON_CANVAS_WRAP_NONE,
-			    MESON_CANVAS_BLKMODE_LINEAR,
-			    MESON_CANVAS_ENDIAN_SWAP64);
+	meson_canvas_config_batch(core->canvas, entries, NUM_CANVAS_YUV420);
 
 	amvdec_write_dos(core, reg,
 			 ((canvas_id[2]) << 16) |
@@ -143,6 +255,7 @@ static int set_canvas_nv12m(struct amvdec_session *sess,
 			    u32 height, u32 reg)
 {
 	struct amvdec_core *core = sess->core;
+	struct meson_canvas_entry entries[NUM_CANVAS_NV12];
 	u8 canvas_id[NUM_CANVAS_NV12]; /* Y U/V */
 	dma_addr_t buf_paddr[NUM_CANVAS_NV12]; /* Y U/V */
 	int ret, i;
@@ -156,17 +269,18 @@ static int set_canvas_nv12m(struct amvdec_session *sess,
 		    vb2_dma_contig_plane_dma_addr(vb, i);
 	}
 
-	/* Y plane */
-	meson_canvas_config(core->canvas, canvas_id[0], buf_paddr[0],
-			    width, height, MESON_CANVAS_WRAP_NONE,
-			    MESON_CANVAS_BLKMODE_LINEAR,
-			    MESON_CANVAS_ENDIAN_SWAP64);
+	for (i = 0; i < NUM_CANVAS_NV12; ++i) {
+		entries[i].index = canvas_id[i];
+		entries[i].addr = buf_paddr[i];
+		/* Y plane, then interleaved U/V subsampled vertically */
+		entries[i].stride = width;
+		entries[i].height = i ? height / 2 : height;
+		entries[i].wrap = MESON_CANVAS_WRAP_NONE;
+		entries[i].blkmode = MESON_CANVAS_BLKMODE_LINEAR;
+		entries[i].endian = MESON_CANVAS_ENDIAN_SWAP64;
+	}
 
-	/* U/V plane */
-	meson_canvas_config(core->canvas, canvas_id[1], buf_paddr[1],
-			    width, height / 2, MESON_CANVAS_WRAP_NONE,
-			    MESON_CANVAS_BLKMODE_LINEAR,
-			    MESON_CANVAS_ENDIAN_SWAP64);
+	meson_canvas_config_batch(core->canvas, entries, NUM_CANVAS_NV12);
 
 	amvdec_write_dos(core, reg,
 			 ((canvas_id[1]) << 16) |
@@ -224,44 +338,89 @@ int amvdec_set_canvases(struct amvdec_session *sess,
 }
 EXPORT_SYMBOL_GPL(amvdec_set_canvases);
 
+static struct amvdec_timestamp *ts_slot(struct amvdec_session *sess, u32 idx)
+{
+	return &sess->timestamps[idx & (AMVDEC_MAX_TS - 1)];
+}
+
+/* Signed distance between two VIFIFO offsets, robust to u32 wrapping */
+static s32 ts_offset_delta(u32 a, u32 b)
+{
+	return (s32)(a - b);
+}
+
+static void ts_drop(struct amvdec_session *sess, struct amvdec_timestamp *ts)
+{
+	if (!ts->used)
+		return;
+
+	if (ts->counted)
+		atomic_dec(&sess->esparser_queued_bufs);
+	ts->used = false;
+}
+
+/* Skip the consumed entries at the head of the ring */
+static void ts_advance_head(struct amvdec_session *sess)
+{
+	while (sess->ts_head != sess->ts_tail &&
+	       !ts_slot(sess, sess->ts_head)->used)
+		sess->ts_head++;
+}
+
 void amvdec_add_ts_reorder(struct amvdec_session *sess, u64 ts, u32 offset)
 {
-	struct amvdec_timestamp *new_ts, *tmp;
+	struct amvdec_timestamp *new_ts;
 	unsigned long flags;
-
-	new_ts = kmalloc(sizeof(*new_ts), GFP_KERNEL);
-	new_ts->ts = ts;
-	new_ts->offset = offset;
+	u32 idx;
 
 	spin_lock_irqsave(&sess->ts_spinlock, flags);
 
-	if (list_empty(&sess->timestamps))
-		goto add_tail;
+	if (sess->ts_tail - sess->ts_head == AMVDEC_MAX_TS) {
+		dev_warn_ratelimited(sess->core->dev_dec,
+				     "Timestamp ring full, dropping %llu\n",
+				     ts_slot(sess, sess->ts_head)->ts);
+		ts_drop(sess, ts_slot(sess, sess->ts_head));
+		sess->ts_head++;
+		ts_advance_head(sess);
+	}
+
+	/* Packets come in offset order, this loop almost never runs */
+	for (idx = sess->ts_tail; idx != sess->ts_head; idx--) {
+		struct amvdec_timestamp *prev = ts_slot(sess, idx - 1);
 
-	list_for_each_entry(tmp, &sess->timestamps, list) {
-		if (ts <= tmp->ts) {
-			list_add_tail(&new_ts->list, &tmp->list);
-			goto unlock;
-		}
+		if (ts_offset_delta(prev->offset, offset) <= 0)
+			break;
+
+		*ts_slot(sess, idx) = *prev;
 	}
 
-add_tail:
-	list_add_tail(&new_ts->list, &sess->timestamps);
-unlock:
+	new_ts = ts_slot(sess, idx);
+	new_ts->ts = ts;
+	new_ts->offset = offset;
+	new_ts->counted = sess->keyframe_found;
+	new_ts->used = true;
+	new_ts->queued = ktime_get();
+	if (new_ts->counted)
+		atomic_inc(&sess->esparser_queued_bufs);
+	sess->ts_tail++;
+
 	spin_unlock_irqrestore(&sess->ts_spinlock, flags);
 }
 EXPORT_SYMBOL_GPL(amvdec_add_ts_reorder);
 
 void amvdec_remove_ts(struct amvdec_session *sess, u64 ts)
 {
-	struct amvdec_timestamp *tmp;
 	unsigned long flags;
+	u32 idx;
 
 	spin_lock_irqsave(&sess->ts_spinlock, flags);
-	list_for_each_entry(tmp, &sess->timestamps, list) {
-		if (tmp->ts == ts) {
-			list_del(&tmp->list);
-			kfree(tmp);
+	/* This is for the last packet queued, look from the tail */
+	for (idx = sess->ts_tail; idx != sess->ts_head; idx--) {
+		struct amvdec_timestamp *tmp = ts_slot(sess, idx - 1);
+
+		if (tmp->used && tmp->ts == ts) {
+			ts_drop(sess, tmp);
+			ts_advance_head(sess);
 			goto unlock;
 		}
 	}
@@ -273,10 +432,38 @@ unlock:
 }
 EXPORT_SYMBOL_GPL(amvdec_remove_ts);
 
+void amvdec_reset_ts(struct amvdec_session *sess)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&sess->ts_spinlock, flags);
+	sess->ts_head = 0;
+	sess->ts_tail = 0;
+	spin_unlock_irqrestore(&sess->ts_spinlock, flags);
+}
+EXPORT_SYMBOL_GPL(amvdec_reset_ts);
+
+static void vdec_account_latency(struct amvdec_session *sess,
+				 struct vb2_v4l2_buffer *vbuf, ktime_t queued)
+{
+	u64 latency = 0;
+	u32 ms;
+
+	if (queued) {
+		latency = ktime_to_ns(ktime_sub(ktime_get(), queued));
+		ms = div_u64(latency, NSEC_PER_MSEC);
+		sess->latency_hist[min_t(u32, fls(ms),
+					 VDEC_LATENCY_BUCKETS - 1)]++;
+	}
+
+	trace_vdec_dst_buf_done(sess, vbuf, latency);
+}
+
 static void dst_buf_done(struct amvdec_session *sess,
 			 struct vb2_v4l2_buffer *vbuf,
 			 u32 field,
-			 u64 timestamp)
+			 u64 timestamp,
+			 ktime_t queued)
 {
 	struct device *dev = sess->core->dev_dec;
 	u32 output_size = amvdec_get_output_size(sess);
@@ -299,6 +486,7 @@ static void dst_buf_done(struct amvdec_session *sess,
 
 	vbuf->vb2_buf.timestamp = timestamp;
 	vbuf->sequence = sess->sequence_cap++;
+	sess->frames++;
 
 	if (sess->should_stop &&
 	    atomic_read(&sess->esparser_queued_bufs) <= 2) {
@@ -313,7 +501,24 @@ static void dst_buf_done(struct amvdec_session *sess,
 
 	dev_dbg(dev, "Buffer %u done\n", vbuf->vb2_buf.index);
 	vbuf->field = field;
-	v4l2_m2m_buf_done(vbuf, VB2_BUF_STATE_DONE);
+	vdec_account_latency(sess, vbuf, queued);
+
+	/* Straight to the display, which gives the buffer back once shown */
+	if (sess->tunnel_bound) {
+		struct vb2_buffer *vb = &vbuf->vb2_buf;
+		struct meson_tunnel_frame *frame =
+			&sess->tunnel_frames[vb->index];
+
+		frame->addr[0] = vb2_dma_contig_plane_dma_addr(vb, 0);
+		frame->addr[1] = vb2_dma_contig_plane_dma_addr(vb, 1);
+		frame->stride = ALIGN(sess->width, 64);
+		frame->height = output_size / frame->stride;
+		frame->timestamp = timestamp;
+		frame->priv = vbuf;
+		meson_tunnel_queue(frame);
+	} else {
+		v4l2_m2m_buf_done(vbuf, VB2_BUF_STATE_DONE);
+	}
 
 	/* Buffer done probably means the vififo got freed */
 	schedule_work(&sess->esparser_queue_work);
@@ -323,13 +528,26 @@ void amvdec_dst_buf_done(struct amvdec_session *sess,
 			 struct vb2_v4l2_buffer *vbuf, u32 field)
 {
 	struct device *dev = sess->core->dev_dec;
-	struct amvdec_timestamp *tmp;
-	struct list_head *timestamps = &sess->timestamps;
+	struct amvdec_timestamp *tmp, *min = NULL;
 	u64 timestamp;
+	ktime_t queued;
+	bool counted;
 	unsigned long flags;
+	u32 idx;
 
 	spin_lock_irqsave(&sess->ts_spinlock, flags);
-	if (list_empty(timestamps)) {
+	/*
+	 * Frames come out in presentation order: use the earliest timestamp.
+	 * Only the packets in flight are live, so the scan stays short.
+	 */
+	for (idx = sess->ts_head; idx != sess->ts_tail; idx++) {
+		tmp = ts_slot(sess, idx);
+		if (tmp->used && (!min || tmp->ts < min->ts))
+			min = tmp;
+	}
+
+	if (!min) {
+		sess->ts_misses++;
 		dev_err(dev, "Buffer %u done but list is empty\n",
 			vbuf->vb2_buf.index);
 
@@ -338,14 +556,16 @@ void amvdec_dst_buf_done(struct amvdec_session *sess,
 		return;
 	}
 
-	tmp = list_first_entry(timestamps, struct amvdec_timestamp, list);
-	timestamp = tmp->ts;
-	list_del(&tmp->list);
-	kfree(tmp);
+	timestamp = min->ts;
+	counted = min->counted;
+	queued = min->queued;
+	min->used = false;
+	ts_advance_head(sess);
 	spin_unlock_irqrestore(&sess->ts_spinlock, flags);
 
-	dst_buf_done(sess, vbuf, field, timestamp);
-	atomic_dec(&sess->esparser_queued_bufs);
+	dst_buf_done(sess, vbuf, field, timestamp, queued);
+	if (counted)
+		atomic_dec(&sess->esparser_queued_bufs);
 }
 EXPORT_SYMBOL_GPL(amvdec_dst_buf_done);
 
@@ -355,50 +575,82 @@ void amvdec_dst_buf_done_offset(struct amvdec_session *sess,
 {
 	struct device *dev = sess->core->dev_dec;
 	struct amvdec_timestamp *match = NULL;
-	struct amvdec_timestamp *tmp, *n;
 	u64 timestamp = 0;
+	ktime_t queued = 0;
+	bool counted = false;
 	unsigned long flags;
+	u32 lo, hi, idx;
 
 	spin_lock_irqsave(&sess->ts_spinlock, flags);
 
-	/* Look for our vififo offset to get the corresponding timestamp. */
-	list_for_each_entry_safe(tmp, n, &sess->timestamps, list) {
-		s64 delta = (s64)offset - tmp->offset;
+	/* Offsets reported by codecs usually differ slightly,
+	 * so we need some wiggle room.
+	 * 4KiB being the minimum packet size, there is no risk here.
+	 *
+	 * The ring is sorted by offset: look for the first entry within
+	 * that window.
+	 */
+	lo = sess->ts_head;
+	hi = sess->ts_tail;
+	while (lo != hi) {
+		u32 mid = lo + (hi - lo) / 2;
+
+		if (ts_offset_delta(offset, ts_slot(sess, mid)->offset) >=
+		    (s32)SZ_4K)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	for (idx = lo; idx != sess->ts_tail; idx++) {
+		struct amvdec_timestamp *tmp = ts_slot(sess, idx);
 
-		/* Offsets reported by codecs usually differ slightly,
-		 * so we need some wiggle room.
-		 * 4KiB being the minimum packet size, there is no risk here.
-		 */
-		if (delta > (-1 * (s32)SZ_4K) && delta < SZ_4K) {
+		if (ts_offset_delta(tmp->offset, offset) >= (s32)SZ_4K)
+			break;
+
+		if (tmp->used) {
 			match = tmp;
 			break;
 		}
+	}
 
-		if (!allow_drop)
-			continue;
-
+	if (allow_drop) {
 		/* Delete any timestamp entry that appears before our target
 		 * (not all src packets/timestamps lead to a frame)
 		 */
-		if (delta > 0 || delta < -1 * (s32)sess->vififo_size) {
-			atomic_dec(&sess->esparser_queued_bufs);
-			list_del(&tmp->list);
-			kfree(tmp);
+		for (idx = sess->ts_head; idx != lo; idx++)
+			ts_drop(sess, ts_slot(sess, idx));
+
+		/* Along with the bogus ones beyond the VIFIFO */
+		while (sess->ts_tail != lo) {
+			struct amvdec_timestamp *tmp =
+				ts_slot(sess, sess->ts_tail - 1);
+
+			if (tmp == match ||
+			    ts_offset_delta(tmp->offset, offset) <=
+			    (s32)sess->vififo_size)
+				break;
+
+			ts_drop(sess, tmp);
+			sess->ts_tail--;
 		}
 	}
 
 	if (!match) {
+		sess->ts_misses++;
 		dev_dbg(dev, "Buffer %u done but can't match offset (%08X)\n",
 			vbuf->vb2_buf.index, offset);
 	} else {
 		timestamp = match->ts;
-		list_del(&match->list);
-		kfree(match);
+		counted = match->counted;
+		queued = match->queued;
+		match->used = false;
 	}
+	ts_advance_head(sess);
 	spin_unlock_irqrestore(&sess->ts_spinlock, flags);
 
-	dst_buf_done(sess, vbuf, field, timestamp);
-	if (match)
+	dst_buf_done(sess, vbuf, field, timestamp, queued);
+	if (counted)
 		atomic_dec(&sess->esparser_queued_bufs);
 }
 EXPORT_SYMBOL_GPL(amvdec_dst_buf_done_offset);
@@ -462,6 +714,8 @@ void amvdec_src_change(struct amvdec_session *sess, u32 width, u32 height, u32 d
 
 	sess->width = width;
 	sess->height = height;
+	sess->coded_width = width;
+	sess->coded_height = height;
 	sess->status = STATUS_NEEDS_RESUME;
 
 	v4l2_event_queue_fh(&sess->fh, &ev);
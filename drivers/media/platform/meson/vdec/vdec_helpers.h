@@ -26,6 +26,34 @@ void amvdec_clear_dos_bits(struct amvdec_core *core, u32 reg, u32 val);
 u32 amvdec_read_parser(struct amvdec_core *core, u32 reg);
 void amvdec_write_parser(struct amvdec_core *core, u32 reg, u32 val);
 
+/**
+ * amvdec_pool_alloc() - Get a DMA buffer from the core pool
+ * The buffer is kept by the core once freed, and only reallocated when a
+ * later session needs it bigger.
+ *
+ * @core: vdec core
+ * @id: kind of buffer
+ * @size: minimum size of the buffer
+ * @paddr: returns the physical address of the buffer
+ * @zero: clear the buffer, as a fresh allocation would be
+ */
+void *amvdec_pool_alloc(struct amvdec_core *core, enum amvdec_pool_id id,
+			size_t size, dma_addr_t *paddr, bool zero);
+void amvdec_pool_free(struct amvdec_core *core, enum amvdec_pool_id id);
+
+/* Free all the pooled buffers and firmware images */
+void amvdec_pool_release(struct amvdec_core *core);
+
+/**
+ * amvdec_request_firmware() - Get a firmware image, cached by the core
+ * The image stays owned by the core and must not be released.
+ *
+ * @core: vdec core
+ * @name: firmware path
+ */
+const struct firmware *amvdec_request_firmware(struct amvdec_core *core,
+					       const char *name);
+
 u32 amvdec_am21c_body_size(u32 width, u32 height);
 u32 amvdec_am21c_head_size(u32 width, u32 height);
 u32 amvdec_am21c_size(u32 width, u32 height);
@@ -39,7 +67,10 @@ void amvdec_dst_buf_done_offset(struct amvdec_session *sess,
 				u32 offset, u32 field, bool allow_drop);
 
 /**
- * amvdec_add_ts_reorder() - Add a timestamp to the list in chronological order
+ * amvdec_add_ts_reorder() - Add a timestamp to the ring, in offset order
+ * Once the first keyframe was found, the entry is accounted in
+ * esparser_queued_bufs until it gets matched to a dst buffer.
+ * If the ring is full, the oldest entry is dropped.
  *
  * @sess: current session
  * @ts: timestamp to add
@@ -47,6 +78,7 @@ void amvdec_dst_buf_done_offset(struct amvdec_session *sess,
  */
 void amvdec_add_ts_reorder(struct amvdec_session *sess, u64 ts, u32 offset);
 void amvdec_remove_ts(struct amvdec_session *sess, u64 ts);
+void amvdec_reset_ts(struct amvdec_session *sess);
 
 void amvdec_set_par_from_dar(struct amvdec_session *sess,
 			     u32 dar_num, u32 dar_den);
@@ -26,30 +26,27 @@ static int vdec_hevc_load_firmware(struct amvdec_session *sess, const char* fwna
 	struct amvdec_core *core = sess->core;
 	struct device *dev = core->dev_dec;
 	const struct firmware *fw;
-	static void *mc_addr;
-	static dma_addr_t mc_addr_map;
-	int ret;
+	void *mc_addr;
+	dma_addr_t mc_addr_map;
+	int ret = 0;
 	u32 i = 100;
 
-	ret = request_firmware(&fw, fwname, dev);
-	if (ret < 0)  {
-		dev_err(dev, "Unable to request firmware %s\n", fwname);
-		return ret;
-	}
+	fw = amvdec_request_firmware(core, fwname);
+	if (!fw)
+		return -EINVAL;
 
 	if (fw->size < MC_SIZE) {
 		dev_err(dev, "Firmware size %zu is too small. Expected %u.\n",
 			fw->size, MC_SIZE);
-		ret = -EINVAL;
-		goto release_firmware;
+		return -EINVAL;
 	}
 
-	mc_addr = dma_alloc_coherent(core->dev, MC_SIZE, &mc_addr_map, GFP_KERNEL);
+	mc_addr = amvdec_pool_alloc(core, AMVDEC_POOL_MC, MC_SIZE,
+				    &mc_addr_map, false);
 	if (!mc_addr) {
 		dev_err(dev, "Failed allocating memory for firmware loading\n");
-		ret = -ENOMEM;
-		goto release_firmware;
-	 }
+		return -ENOMEM;
+	}
 
 	memcpy(mc_addr, fw->data, MC_SIZE);
 
@@ -67,9 +64,7 @@ static int vdec_hevc_load_firmware(struct amvdec_session *sess, const char* fwna
 		ret = -ENODEV;
 	}
 
-	dma_free_coherent(core->dev, MC_SIZE, mc_addr, mc_addr_map);
-release_firmware:
-	release_firmware(fw);
+	amvdec_pool_free(core, AMVDEC_POOL_MC);
 	return ret;
 }
 
@@ -82,6 +77,10 @@ static void vdec_hevc_stbuf_init(struct amvdec_session *sess)
 	amvdec_write_dos(core, HEVC_STREAM_END_ADDR, sess->vififo_paddr + sess->vififo_size);
 	amvdec_write_dos(core, HEVC_STREAM_RD_PTR, sess->vififo_paddr);
 	amvdec_write_dos(core, HEVC_STREAM_WR_PTR, sess->vififo_paddr);
+
+	/* Without the ESPARSER, stream fetching has to be enabled here */
+	if (sess->ring_mode)
+		amvdec_write_dos(core, HEVC_STREAM_CONTROL, amvdec_read_dos(core, HEVC_STREAM_CONTROL) | 1);
 }
 
 /* VDEC_HEVC specific ESPARSER configuration */
@@ -101,6 +100,11 @@ static u32 vdec_hevc_vififo_level(struct amvdec_session *sess)
 	return readl_relaxed(sess->core->dos_base + HEVC_STREAM_LEVEL);
 }
 
+static void vdec_hevc_vififo_set_wp(struct amvdec_session *sess, dma_addr_t wp)
+{
+	amvdec_write_dos(sess->core, HEVC_STREAM_WR_PTR, wp);
+}
+
 static int vdec_hevc_stop(struct amvdec_session *sess)
 {
 	struct amvdec_core *core = sess->core;
@@ -188,4 +192,5 @@ struct amvdec_ops vdec_hevc_ops = {
 	.stop = vdec_hevc_stop,
 	.conf_esparser = vdec_hevc_conf_esparser,
 	.vififo_level = vdec_hevc_vififo_level,
+	.vififo_set_wp = vdec_hevc_vififo_set_wp,
 };
\ No newline at end of file
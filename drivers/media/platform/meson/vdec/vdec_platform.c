@@ -14,6 +14,7 @@
 #include "codec_mpeg4.h"
 #include "codec_mjpeg.h"
 #include "codec_hevc.h"
+#include "codec_vp9.h"
 
 static const struct amvdec_format vdec_formats_gxbb[] = {
 	{
@@ -112,6 +113,16 @@ static const struct amvdec_format vdec_formats_gxl[] = {
 		.codec_ops = &codec_hevc_ops,
 		.firmware_path = "meson/gx/vh265_mc",
 		.pixfmts_cap = { V4L2_PIX_FMT_NV12M, V4L2_PIX_FMT_AM21C, 0 },
+	}, {
+		.pixfmt = V4L2_PIX_FMT_VP9,
+		.min_buffers = 16,
+		.max_buffers = 24,
+		.max_width = 3840,
+		.max_height = 2160,
+		.vdec_ops = &vdec_hevc_ops,
+		.codec_ops = &codec_vp9_ops,
+		.firmware_path = "meson/gx/vvp9_mc",
+		.pixfmts_cap = { V4L2_PIX_FMT_NV12M, V4L2_PIX_FMT_AM21C, 0 },
 	}, {
 		.pixfmt = V4L2_PIX_FMT_MJPEG,
 		.min_buffers = 4,
@@ -198,6 +209,16 @@ static const struct amvdec_format vdec_formats_gxm[] = {
 		.codec_ops = &codec_hevc_ops,
 		.firmware_path = "meson/gx/vh265_mc",
 		.pixfmts_cap = { V4L2_PIX_FMT_NV12M, V4L2_PIX_FMT_AM21C, 0 },
+	}, {
+		.pixfmt = V4L2_PIX_FMT_VP9,
+		.min_buffers = 16,
+		.max_buffers = 24,
+		.max_width = 3840,
+		.max_height = 2160,
+		.vdec_ops = &vdec_hevc_ops,
+		.codec_ops = &codec_vp9_ops,
+		.firmware_path = "meson/gx/vvp9_mc",
+		.pixfmts_cap = { V4L2_PIX_FMT_NV12M, V4L2_PIX_FMT_AM21C, 0 },
 	}, {
 		.pixfmt = V4L2_PIX_FMT_MJPEG,
 		.min_buffers = 4,
@@ -277,16 +298,19 @@ const struct vdec_platform vdec_platform_gxbb = {
 	.formats = vdec_formats_gxbb,
 	.num_formats = ARRAY_SIZE(vdec_formats_gxbb),
 	.revision = VDEC_REVISION_GXBB,
+	.enc_firmware_path = "meson/gxbb/h264_enc_mc",
 };
 
 const struct vdec_platform vdec_platform_gxl = {
 	.formats = vdec_formats_gxl,
 	.num_formats = ARRAY_SIZE(vdec_formats_gxl),
 	.revision = VDEC_REVISION_GXL,
+	.enc_firmware_path = "meson/gxl/h264_enc_mc",
 };
 
 const struct vdec_platform vdec_platform_gxm = {
 	.formats = vdec_formats_gxm,
 	.num_formats = ARRAY_SIZE(vdec_formats_gxm),
 	.revision = VDEC_REVISION_GXM,
+	.enc_firmware_path = "meson/gxl/h264_enc_mc",
 };
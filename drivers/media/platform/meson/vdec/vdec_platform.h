@@ -21,6 +21,7 @@ struct vdec_platform {
 	const struct amvdec_format *formats;
 	const u32 num_formats;
 	enum vdec_revision revision;
+	const char *enc_firmware_path;
 };
 
 extern const struct vdec_platform vdec_platform_gxbb;
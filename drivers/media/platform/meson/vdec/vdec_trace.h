@@ -0,0 +1,137 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM meson_vdec
+
+#if !defined(__MESON_VDEC_TRACE_H__) || defined(TRACE_HEADER_MULTI_READ)
+#define __MESON_VDEC_TRACE_H__
+
+#include <linux/tracepoint.h>
+#include <media/videobuf2-v4l2.h>
+
+#include "vdec.h"
+
+TRACE_EVENT(vdec_esparser_queue,
+	TP_PROTO(struct amvdec_session *sess, struct vb2_buffer *vb,
+		 u32 size, u32 offset),
+
+	TP_ARGS(sess, vb, size, offset),
+
+	TP_STRUCT__entry(
+		__field(u32, sess)
+		__field(u32, index)
+		__field(u32, size)
+		__field(u32, offset)
+		__field(u64, ts)
+	),
+
+	TP_fast_assign(
+		__entry->sess = sess->id;
+		__entry->index = vb->index;
+		__entry->size = size;
+		__entry->offset = offset;
+		__entry->ts = vb->timestamp;
+	),
+
+	TP_printk("sess = %u, index = %u, size = %u, offset = %08x, ts = %llu",
+		  __entry->sess, __entry->index, __entry->size,
+		  __entry->offset, __entry->ts)
+);
+
+TRACE_EVENT(vdec_vififo_level,
+	TP_PROTO(struct amvdec_session *sess, u32 usage),
+
+	TP_ARGS(sess, usage),
+
+	TP_STRUCT__entry(
+		__field(u32, sess)
+		__field(u32, usage)
+		__field(u32, size)
+	),
+
+	TP_fast_assign(
+		__entry->sess = sess->id;
+		__entry->usage = usage;
+		__entry->size = sess->vififo_size;
+	),
+
+	TP_printk("sess = %u, usage = %u/%u",
+		  __entry->sess, __entry->usage, __entry->size)
+);
+
+TRACE_EVENT(vdec_isr,
+	TP_PROTO(struct amvdec_session *sess, bool threaded, u64 duration),
+
+	TP_ARGS(sess, threaded, duration),
+
+	TP_STRUCT__entry(
+		__field(u32, sess)
+		__field(bool, threaded)
+		__field(u64, duration)
+	),
+
+	TP_fast_assign(
+		__entry->sess = sess->id;
+		__entry->threaded = threaded;
+		__entry->duration = duration;
+	),
+
+	TP_printk("sess = %u, %s, duration = %llu ns", __entry->sess,
+		  __entry->threaded ? "threaded" : "hardirq",
+		  __entry->duration)
+);
+
+TRACE_EVENT(vdec_dst_buf_done,
+	TP_PROTO(struct amvdec_session *sess, struct vb2_v4l2_buffer *vbuf,
+		 u64 latency),
+
+	TP_ARGS(sess, vbuf, latency),
+
+	TP_STRUCT__entry(
+		__field(u32, sess)
+		__field(u32, index)
+		__field(u32, sequence)
+		__field(u64, ts)
+		__field(u64, latency)
+	),
+
+	TP_fast_assign(
+		__entry->sess = sess->id;
+		__entry->index = vbuf->vb2_buf.index;
+		__entry->sequence = vbuf->sequence;
+		__entry->ts = vbuf->vb2_buf.timestamp;
+		__entry->latency = latency;
+	),
+
+	TP_printk("sess = %u, index = %u, sequence = %u, ts = %llu, latency = %llu ns",
+		  __entry->sess, __entry->index, __entry->sequence,
+		  __entry->ts, __entry->latency)
+);
+
+TRACE_EVENT(vdec_cap_wait,
+	TP_PROTO(struct amvdec_session *sess, u64 duration),
+
+	TP_ARGS(sess, duration),
+
+	TP_STRUCT__entry(
+		__field(u32, sess)
+		__field(u64, duration)
+	),
+
+	TP_fast_assign(
+		__entry->sess = sess->id;
+		__entry->duration = duration;
+	),
+
+	TP_printk("sess = %u, waited %llu ns for CAPTURE buffers",
+		  __entry->sess, __entry->duration)
+);
+
+#endif /* __MESON_VDEC_TRACE_H__ */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE vdec_trace
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
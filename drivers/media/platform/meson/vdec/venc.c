@@ -0,0 +1,1123 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * HCODEC is the H.264 encoding block of the DOS, next to VDEC_1 and
+ * VDEC_HEVC. Its firmware turns one NV12 frame into an access unit per
+ * command, writing the bitstream straight into the CAPTURE buffer. The
+ * driver picks the frame types and the QP of each frame.
+ */
+
+#include <linux/clk.h>
+#include <linux/delay.h>
+#include <linux/dma-mapping.h>
+#include <linux/firmware.h>
+#include <linux/interrupt.h>
+#include <linux/slab.h>
+#include <media/v4l2-event.h>
+#include <media/v4l2-ioctl.h>
+#include <media/videobuf2-dma-contig.h>
+
+#include "venc.h"
+#include "venc_ctrls.h"
+#include "vdec_helpers.h"
+#include "dos_regs.h"
+
+/* AO Registers */
+#define AO_RTI_GEN_PWR_SLEEP0	0xe8
+#define AO_RTI_GEN_PWR_ISO0	0xec
+	#define GEN_PWR_HCODEC	(BIT(1) | BIT(0))
+	#define GEN_ISO_HCODEC	(BIT(5) | BIT(4))
+
+#define MC_SIZE			(4096 * 4)
+
+/* Firmware interface */
+#define ENCODER_STATUS		HCODEC_HENC_SCRATCH_0
+#define MEM_OFFSET_REG		HCODEC_HENC_SCRATCH_1
+#define ENCODER_MB_SIZE		HCODEC_HENC_SCRATCH_2
+#define ENCODER_LEVEL		HCODEC_HENC_SCRATCH_3
+#define IDR_PIC_ID		HCODEC_HENC_SCRATCH_5
+#define FRAME_NUMBER		HCODEC_HENC_SCRATCH_6
+#define PIC_ORDER_CNT_LSB	HCODEC_HENC_SCRATCH_7
+#define LOG2_MAX_PIC_ORDER_CNT_LSB	HCODEC_HENC_SCRATCH_8
+#define LOG2_MAX_FRAME_NUM	HCODEC_HENC_SCRATCH_9
+#define QP_PICTURE		HCODEC_HENC_SCRATCH_B
+
+/* Commands, polled by the firmware from ENCODER_STATUS */
+#define ENCODER_IDLE		0
+#define ENCODER_SEQUENCE	1
+#define ENCODER_PICTURE		2
+#define ENCODER_IDR		3
+#define ENCODER_NON_IDR		4
+#define ENCODER_SEQUENCE_DONE	7
+#define ENCODER_PICTURE_DONE	8
+#define ENCODER_IDR_DONE	9
+#define ENCODER_NON_IDR_DONE	10
+#define ENCODER_ERROR		0xff
+
+#define VENC_LOG2_MAX_FRAME_NUM	8
+#define VENC_LOG2_MAX_POC_LSB	8
+
+#define VENC_MIN_SIZE		64
+#define VENC_MAX_WIDTH		1920
+#define VENC_MAX_HEIGHT		1088
+
+#define VENC_TIMEOUT_MS		1000
+
+static const u32 venc_pixfmts_out[] = {
+	V4L2_PIX_FMT_NV12,
+	V4L2_PIX_FMT_NV21,
+};
+
+/* level_idc of enum v4l2_mpeg_video_h264_level */
+static const u8 venc_level_idc[] = {
+	10, 9, 11, 12, 13, 20, 21, 22, 30, 31, 32, 40, 41,
+};
+
+static u32 venc_out_size(u32 width, u32 height)
+{
+	return width * height * 3 / 2;
+}
+
+/* Half of the raw frame is a lot more than the firmware ever produces */
+static u32 venc_cap_size(u32 width, u32 height)
+{
+	return ALIGN(venc_out_size(width, height) / 2, SZ_4K);
+}
+
+static int venc_load_firmware(struct amvenc_session *sess)
+{
+	struct amvdec_core *core = sess->core;
+	struct device *dev = core->dev_dec;
+	const struct firmware *fw;
+	dma_addr_t mc_addr_map;
+	void *mc_addr;
+	int ret = 0;
+	u32 i = 1000;
+
+	fw = amvdec_request_firmware(core, core->platform->enc_firmware_path);
+	if (!fw)
+		return -EINVAL;
+
+	if (fw->size < MC_SIZE) {
+		dev_err(dev, "Firmware size %zu is too small. Expected %u.\n",
+			fw->size, MC_SIZE);
+		return -EINVAL;
+	}
+
+	/* Not from the core pool, whose MC slot belongs to the decoder */
+	mc_addr = dma_alloc_coherent(core->dev, MC_SIZE, &mc_addr_map,
+				     GFP_KERNEL);
+	if (!mc_addr)
+		return -ENOMEM;
+
+	memcpy(mc_addr, fw->data, MC_SIZE);
+
+	amvdec_write_dos(core, HCODEC_MPSR, 0);
+	amvdec_write_dos(core, HCODEC_CPSR, 0);
+
+	amvdec_write_dos(core, HCODEC_IMEM_DMA_ADR, mc_addr_map);
+	amvdec_write_dos(core, HCODEC_IMEM_DMA_COUNT, MC_SIZE / 4);
+	amvdec_write_dos(core, HCODEC_IMEM_DMA_CTRL, (0x8000 | (7 << 16)));
+
+	while (--i && amvdec_read_dos(core, HCODEC_IMEM_DMA_CTRL) & 0x8000) { }
+
+	if (i == 0) {
+		dev_err(dev, "Encoder firmware load fail (DMA hang?)\n");
+		ret = -EINVAL;
+	}
+
+	dma_free_coherent(core->dev, MC_SIZE, mc_addr, mc_addr_map);
+	return ret;
+}
+
+static void venc_free_refs(struct amvenc_session *sess)
+{
+	struct amvdec_core *core = sess->core;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(sess->ref_vaddr); i++) {
+		if (!sess->ref_vaddr[i])
+			continue;
+
+		dma_free_coherent(core->dev, sess->ref_size,
+				  sess->ref_vaddr[i], sess->ref_paddr[i]);
+		sess->ref_vaddr[i] = NULL;
+	}
+
+	meson_canvas_free_range(core->canvas, sess->canvas[0],
+				AMVENC_NUM_CANVAS);
+}
+
+static int venc_alloc_refs(struct amvenc_session *sess)
+{
+	struct amvdec_core *core = sess->core;
+	int i, ret;
+
+	ret = meson_canvas_alloc_range(core->canvas, &sess->canvas[0],
+				       AMVENC_NUM_CANVAS);
+	if (ret)
+		return ret;
+
+	for (i = 1; i < AMVENC_NUM_CANVAS; i++)
+		sess->canvas[i] = sess->canvas[0] + i;
+
+	sess->ref_size = venc_out_size(sess->width, sess->height);
+	for (i = 0; i < ARRAY_SIZE(sess->ref_vaddr); i++) {
+		sess->ref_vaddr[i] = dma_alloc_coherent(core->dev,
+							sess->ref_size,
+							&sess->ref_paddr[i],
+							GFP_KERNEL);
+		if (!sess->ref_vaddr[i]) {
+			venc_free_refs(sess);
+			return -ENOMEM;
+		}
+	}
+
+	return 0;
+}
+
+static void venc_poweroff(struct amvenc_session *sess)
+{
+	struct amvdec_core *core = sess->core;
+
+	cancel_delayed_work_sync(&sess->watchdog);
+	amvdec_write_dos(core, HCODEC_ASSIST_MBOX2_MASK, 0);
+	synchronize_irq(core->enc_irq);
+
+	amvdec_write_dos(core, HCODEC_MPSR, 0);
+	amvdec_write_dos(core, HCODEC_CPSR, 0);
+
+	/* enable HCODEC isolation */
+	regmap_update_bits(core->regmap_ao, AO_RTI_GEN_PWR_ISO0,
+			   GEN_ISO_HCODEC, GEN_ISO_HCODEC);
+	/* power off HCODEC memories */
+	amvdec_write_dos(core, DOS_MEM_PD_HCODEC, 0xffffffff);
+	amvdec_clear_dos_bits(core, DOS_GCLK_EN0, DOS_GCLK_EN0_HCODEC);
+	/* power off HCODEC */
+	regmap_update_bits(core->regmap_ao, AO_RTI_GEN_PWR_SLEEP0,
+			   GEN_PWR_HCODEC, GEN_PWR_HCODEC);
+
+	clk_disable_unprepare(core->hcodec_clk);
+	clk_disable_unprepare(core->dos_clk);
+
+	venc_free_refs(sess);
+}
+
+static int venc_poweron(struct amvenc_session *sess)
+{
+	struct amvdec_core *core = sess->core;
+	int ret;
+
+	ret = venc_alloc_refs(sess);
+	if (ret)
+		return ret;
+
+	ret = clk_prepare_enable(core->dos_clk);
+	if (ret)
+		goto free_refs;
+
+	clk_set_rate(core->hcodec_clk, 666666666);
+	ret = clk_prepare_enable(core->hcodec_clk);
+	if (ret)
+		goto disable_dos;
+
+	regmap_update_bits(core->regmap_ao, AO_RTI_GEN_PWR_SLEEP0,
+			   GEN_PWR_HCODEC, 0);
+	udelay(10);
+
+	/* Reset HCODEC */
+	amvdec_write_dos(core, DOS_SW_RESET1, 0xffffffff);
+	amvdec_write_dos(core, DOS_SW_RESET1, 0);
+
+	amvdec_write_dos_bits(core, DOS_GCLK_EN0, DOS_GCLK_EN0_HCODEC);
+
+	/* enable HCODEC Memories */
+	amvdec_write_dos(core, DOS_MEM_PD_HCODEC, 0);
+	/* Remove HCODEC Isolation */
+	regmap_update_bits(core->regmap_ao, AO_RTI_GEN_PWR_ISO0,
+			   GEN_ISO_HCODEC, 0);
+
+	ret = venc_load_firmware(sess);
+	if (ret)
+		goto power_off;
+
+	amvdec_write_dos(core, ENCODER_STATUS, ENCODER_IDLE);
+	amvdec_write_dos(core, MEM_OFFSET_REG, 0);
+	amvdec_write_dos(core, ENCODER_MB_SIZE,
+			 ((sess->width / 16) << 16) | (sess->height / 16));
+	amvdec_write_dos(core, ENCODER_LEVEL,
+			 venc_level_idc[sess->params.level]);
+	amvdec_write_dos(core, LOG2_MAX_FRAME_NUM, VENC_LOG2_MAX_FRAME_NUM);
+	amvdec_write_dos(core, LOG2_MAX_PIC_ORDER_CNT_LSB,
+			 VENC_LOG2_MAX_POC_LSB);
+
+	/* Enable IRQ */
+	amvdec_write_dos(core, HCODEC_ASSIST_MBOX2_CLR_REG, 1);
+	amvdec_write_dos(core, HCODEC_ASSIST_MBOX2_MASK, 1);
+
+	/* Enable firmware processor */
+	amvdec_write_dos(core, HCODEC_MPSR, 1);
+	/* Let the firmware settle */
+	udelay(10);
+
+	return 0;
+
+power_off:
+	regmap_update_bits(core->regmap_ao, AO_RTI_GEN_PWR_ISO0,
+			   GEN_ISO_HCODEC, GEN_ISO_HCODEC);
+	amvdec_write_dos(core, DOS_MEM_PD_HCODEC, 0xffffffff);
+	amvdec_clear_dos_bits(core, DOS_GCLK_EN0, DOS_GCLK_EN0_HCODEC);
+	regmap_update_bits(core->regmap_ao, AO_RTI_GEN_PWR_SLEEP0,
+			   GEN_PWR_HCODEC, GEN_PWR_HCODEC);
+	clk_disable_unprepare(core->hcodec_clk);
+disable_dos:
+	clk_disable_unprepare(core->dos_clk);
+free_refs:
+	venc_free_refs(sess);
+	return ret;
+}
+
+/*
+ * Frame level rate control: compare the size of the last frame with its
+ * share of the bitrate, and move the QP of the next P frames by up to three
+ * steps. An IDR frame may take four times the share of a P frame.
+ */
+static void venc_rc_update(struct amvenc_session *sess, u32 bytes, bool idr)
+{
+	struct amvenc_params *params = &sess->params;
+	struct v4l2_fract *tpf = &sess->timeperframe;
+	u64 budget;
+	int delta = 0;
+	u32 ratio;
+
+	if (!params->rc_enable)
+		return;
+
+	budget = div_u64((u64)params->bitrate * tpf->numerator,
+			 8 * tpf->denominator);
+	if (idr)
+		budget *= 4;
+	if (!budget)
+		return;
+
+	ratio = div64_u64((u64)bytes * 100, budget);
+	if (ratio > 200)
+		delta = 3;
+	else if (ratio > 130)
+		delta = 2;
+	else if (ratio > 110)
+		delta = 1;
+	else if (ratio < 50)
+		delta = -2;
+	else if (ratio < 85)
+		delta = -1;
+
+	sess->qp = clamp_t(int, (int)sess->qp + delta, params->min_qp,
+			   params->max_qp);
+}
+
+static u32 venc_frame_qp(struct amvenc_session *sess, bool idr)
+{
+	struct amvenc_params *params = &sess->params;
+
+	if (!params->rc_enable)
+		return idr ? params->i_qp : params->p_qp;
+
+	if (idr)
+		return max_t(int, (int)sess->qp - 2, params->min_qp);
+
+	return sess->qp;
+}
+
+static void venc_issue(struct amvenc_session *sess, u32 cmd)
+{
+	sess->cmd = cmd;
+	amvdec_write_dos(sess->core, ENCODER_STATUS, cmd);
+}
+
+static void venc_job_done(struct amvenc_session *sess,
+			  enum vb2_buffer_state state)
+{
+	struct amvdec_core *core = sess->core;
+	struct vb2_v4l2_buffer *src, *dst;
+	u32 bytes = 0;
+
+	sess->cmd = ENCODER_IDLE;
+
+	src = v4l2_m2m_src_buf_remove(sess->fh.m2m_ctx);
+	dst = v4l2_m2m_dst_buf_remove(sess->fh.m2m_ctx);
+
+	if (state == VB2_BUF_STATE_DONE) {
+		bytes = amvdec_read_dos(core, HCODEC_VLC_TOTAL_BYTES);
+		venc_rc_update(sess, bytes, sess->idr);
+
+		/* The reconstructed frame is the next reference */
+		sess->ref_idx ^= 1;
+		sess->frame_num = (sess->frame_num + 1) &
+				  (BIT(VENC_LOG2_MAX_FRAME_NUM) - 1);
+		sess->gop_pos++;
+		sess->frames++;
+		sess->bytes += bytes;
+	} else {
+		/* Restart from an IDR frame, the reference may be garbage */
+		sess->gop_pos = 0;
+	}
+
+	vb2_set_plane_payload(&dst->vb2_buf, 0, bytes);
+	dst->vb2_buf.timestamp = src->vb2_buf.timestamp;
+	dst->timecode = src->timecode;
+	dst->field = V4L2_FIELD_NONE;
+	dst->sequence = sess->sequence_cap++;
+	dst->flags &= ~(V4L2_BUF_FLAG_KEYFRAME | V4L2_BUF_FLAG_PFRAME);
+	dst->flags |= sess->idr ? V4L2_BUF_FLAG_KEYFRAME :
+				  V4L2_BUF_FLAG_PFRAME;
+	dst->flags |= src->flags & V4L2_BUF_FLAG_TIMECODE;
+
+	if (sess->should_stop &&
+	    !v4l2_m2m_num_src_bufs_ready(sess->fh.m2m_ctx)) {
+		static const struct v4l2_event ev = { .type = V4L2_EVENT_EOS };
+
+		dst->flags |= V4L2_BUF_FLAG_LAST;
+		v4l2_event_queue_fh(&sess->fh, &ev);
+		sess->should_stop = 0;
+	}
+
+	v4l2_m2m_buf_done(src, state);
+	v4l2_m2m_buf_done(dst, state);
+
+	v4l2_m2m_job_finish(core->m2m_dev_enc, sess->fh.m2m_ctx);
+}
+
+static void venc_watchdog(struct work_struct *work)
+{
+	struct amvenc_session *sess =
+		container_of(work, struct amvenc_session, watchdog.work);
+	struct amvdec_core *core = sess->core;
+
+	/* Keep the ISR out while the job is taken back */
+	amvdec_write_dos(core, HCODEC_ASSIST_MBOX2_MASK, 0);
+	synchronize_irq(core->enc_irq);
+
+	if (sess->cmd != ENCODER_IDLE) {
+		dev_err(core->dev_dec, "Encoder timeout on command %u\n",
+			sess->cmd);
+		venc_job_done(sess, VB2_BUF_STATE_ERROR);
+	}
+
+	amvdec_write_dos(core, HCODEC_ASSIST_MBOX2_MASK, 1);
+}
+
+static void venc_device_run(void *priv)
+{
+	struct amvenc_session *sess = priv;
+	struct amvdec_core *core = sess->core;
+	struct amvenc_params *params = &sess->params;
+	struct meson_canvas_entry entries[AMVENC_NUM_CANVAS];
+	struct vb2_v4l2_buffer *src, *dst;
+	dma_addr_t src_paddr, dst_paddr, ref, rec;
+	u32 luma_size = sess->width * sess->height;
+	u32 mfdin, dst_size;
+	int i;
+
+	src = v4l2_m2m_next_src_buf(sess->fh.m2m_ctx);
+	dst = v4l2_m2m_next_dst_buf(sess->fh.m2m_ctx);
+	src_paddr = vb2_dma_contig_plane_dma_addr(&src->vb2_buf, 0);
+	dst_paddr = vb2_dma_contig_plane_dma_addr(&dst->vb2_buf, 0);
+	dst_size = vb2_plane_size(&dst->vb2_buf, 0);
+	ref = sess->ref_paddr[sess->ref_idx];
+	rec = sess->ref_paddr[sess->ref_idx ^ 1];
+
+	sess->idr = !sess->gop_pos || sess->gop_pos >= params->gop_size ||
+		    params->force_idr;
+	params->force_idr = false;
+	if (sess->idr) {
+		sess->gop_pos = 0;
+		sess->frame_num = 0;
+		sess->idr_pic_id = (sess->idr_pic_id + 1) & 0xffff;
+	}
+
+	/* Input, reference and reconstructed frames, Y then CbCr each */
+	for (i = 0; i < AMVENC_NUM_CANVAS; i += 2) {
+		dma_addr_t addr = i == 0 ? src_paddr : i == 2 ? ref : rec;
+
+		entries[i] = (struct meson_canvas_entry) {
+			.index = sess->canvas[i],
+			.addr = addr,
+			.stride = sess->width,
+			.height = sess->height,
+			.wrap = MESON_CANVAS_WRAP_NONE,
+			.blkmode = MESON_CANVAS_BLKMODE_LINEAR,
+			.endian = MESON_CANVAS_ENDIAN_SWAP64,
+		};
+		entries[i + 1] = entries[i];
+		entries[i + 1].index = sess->canvas[i + 1];
+		entries[i + 1].addr = addr + luma_size;
+		entries[i + 1].height = sess->height / 2;
+	}
+	meson_canvas_config_batch(core->canvas, entries, AMVENC_NUM_CANVAS);
+
+	mfdin = MFDIN_ENABLE;
+	mfdin |= sess->pixfmt_out == V4L2_PIX_FMT_NV21 ? MFDIN_IFMT_NV21 :
+							 MFDIN_IFMT_NV12;
+	amvdec_write_dos(core, HCODEC_MFDIN_REG1_CTRL, mfdin);
+	amvdec_write_dos(core, HCODEC_MFDIN_REG3_CANV,
+			 (sess->canvas[1] << 8) | sess->canvas[0]);
+	amvdec_write_dos(core, HCODEC_MFDIN_REG8_DMBL,
+			 ((sess->width / 16) << 16) | (sess->height / 16));
+
+	amvdec_write_dos(core, HCODEC_ANC0_CANVAS_ADDR,
+			 (sess->canvas[3] << 8) | sess->canvas[2]);
+	amvdec_write_dos(core, HCODEC_DBKR_CANVAS_ADDR,
+			 (sess->canvas[3] << 8) | sess->canvas[2]);
+	amvdec_write_dos(core, HCODEC_REC_CANVAS_ADDR,
+			 (sess->canvas[5] << 8) | sess->canvas[4]);
+	amvdec_write_dos(core, HCODEC_DBKW_CANVAS_ADDR,
+			 (sess->canvas[5] << 8) | sess->canvas[4]);
+
+	/* The bitstream goes straight into the CAPTURE buffer */
+	amvdec_write_dos(core, HCODEC_VLC_VB_CONTROL, 0);
+	amvdec_write_dos(core, HCODEC_VLC_VB_START_PTR, dst_paddr);
+	amvdec_write_dos(core, HCODEC_VLC_VB_END_PTR, dst_paddr + dst_size - 1);
+	amvdec_write_dos(core, HCODEC_VLC_VB_WR_PTR, dst_paddr);
+	amvdec_write_dos(core, HCODEC_VLC_VB_RD_PTR, dst_paddr);
+	amvdec_write_dos(core, HCODEC_VLC_VB_SW_RD_PTR, dst_paddr);
+	amvdec_write_dos(core, HCODEC_VLC_VB_CONTROL, VLC_VB_MEM_INIT);
+	amvdec_write_dos(core, HCODEC_VLC_VB_CONTROL, VLC_VB_ENABLE);
+
+	amvdec_write_dos(core, IDR_PIC_ID, sess->idr_pic_id);
+	amvdec_write_dos(core, FRAME_NUMBER, sess->frame_num);
+	amvdec_write_dos(core, PIC_ORDER_CNT_LSB,
+			 (sess->gop_pos * 2) &
+			 (BIT(VENC_LOG2_MAX_POC_LSB) - 1));
+	amvdec_write_dos(core, QP_PICTURE, venc_frame_qp(sess, sess->idr));
+
+	schedule_delayed_work(&sess->watchdog,
+			      msecs_to_jiffies(VENC_TIMEOUT_MS));
+
+	/* Every IDR frame carries the SPS and PPS, so streams can be joined */
+	venc_issue(sess, sess->idr ? ENCODER_SEQUENCE : ENCODER_NON_IDR);
+}
+
+static irqreturn_t venc_isr(int irq, void *data)
+{
+	struct amvdec_core *core = data;
+	struct amvenc_session *sess = core->enc_sess;
+	u32 status;
+
+	if (!sess)
+		return IRQ_NONE;
+
+	amvdec_write_dos(core, HCODEC_ASSIST_MBOX2_CLR_REG, 1);
+	status = amvdec_read_dos(core, ENCODER_STATUS);
+
+	/* Stale or spurious, the job was already given up */
+	if (sess->cmd == ENCODER_IDLE)
+		return IRQ_HANDLED;
+
+	switch (status) {
+	case ENCODER_SEQUENCE_DONE:
+		venc_issue(sess, ENCODER_PICTURE);
+		break;
+	case ENCODER_PICTURE_DONE:
+		venc_issue(sess, ENCODER_IDR);
+		break;
+	case ENCODER_IDR_DONE:
+	case ENCODER_NON_IDR_DONE:
+		cancel_delayed_work(&sess->watchdog);
+		venc_job_done(sess, VB2_BUF_STATE_DONE);
+		break;
+	default:
+		dev_err(core->dev_dec, "Encoder error %#x on command %u\n",
+			status, sess->cmd);
+		cancel_delayed_work(&sess->watchdog);
+		venc_job_done(sess, VB2_BUF_STATE_ERROR);
+		break;
+	}
+
+	return IRQ_HANDLED;
+}
+
+static const struct v4l2_m2m_ops venc_m2m_ops = {
+	.device_run = venc_device_run,
+};
+
+static int venc_queue_setup(struct vb2_queue *q, unsigned int *num_buffers,
+			    unsigned int *num_planes, unsigned int sizes[],
+			    struct device *alloc_devs[])
+{
+	struct amvenc_session *sess = vb2_get_drv_priv(q);
+	u32 size;
+
+	if (V4L2_TYPE_IS_OUTPUT(q->type))
+		size = venc_out_size(sess->width, sess->height);
+	else
+		size = venc_cap_size(sess->width, sess->height);
+
+	if (*num_planes)
+		return *num_planes != 1 || sizes[0] < size ? -EINVAL : 0;
+
+	*num_planes = 1;
+	sizes[0] = size;
+
+	return 0;
+}
+
+static int venc_buf_prepare(struct vb2_buffer *vb)
+{
+	struct amvenc_session *sess = vb2_get_drv_priv(vb->vb2_queue);
+
+	if (V4L2_TYPE_IS_OUTPUT(vb->vb2_queue->type) &&
+	    vb2_get_plane_payload(vb, 0) <
+	    venc_out_size(sess->width, sess->height))
+		return -EINVAL;
+
+	return 0;
+}
+
+static void venc_buf_queue(struct vb2_buffer *vb)
+{
+	struct vb2_v4l2_buffer *vbuf = to_vb2_v4l2_buffer(vb);
+	struct amvenc_session *sess = vb2_get_drv_priv(vb->vb2_queue);
+
+	v4l2_m2m_buf_queue(sess->fh.m2m_ctx, vbuf);
+}
+
+static int venc_start_streaming(struct vb2_queue *q, unsigned int count)
+{
+	struct amvenc_session *sess = vb2_get_drv_priv(q);
+	struct amvdec_core *core = sess->core;
+	struct vb2_queue *other;
+	struct vb2_v4l2_buffer *buf;
+	int ret = 0;
+
+	if (V4L2_TYPE_IS_OUTPUT(q->type))
+		other = v4l2_m2m_get_dst_vq(sess->fh.m2m_ctx);
+	else
+		other = v4l2_m2m_get_src_vq(sess->fh.m2m_ctx);
+
+	if (!vb2_is_streaming(other))
+		return 0;
+
+	/* HCODEC keeps the reference frame of a single stream */
+	mutex_lock(&core->enc_lock);
+	if (core->enc_sess) {
+		ret = -EBUSY;
+		goto unlock;
+	}
+
+	sess->qp = sess->params.p_qp;
+	sess->gop_pos = 0;
+	sess->ref_idx = 0;
+	sess->sequence_cap = 0;
+	sess->should_stop = 0;
+	sess->cmd = ENCODER_IDLE;
+	core->enc_sess = sess;
+
+	ret = venc_poweron(sess);
+	if (ret)
+		core->enc_sess = NULL;
+
+unlock:
+	mutex_unlock(&core->enc_lock);
+	if (!ret)
+		return 0;
+
+	if (V4L2_TYPE_IS_OUTPUT(q->type))
+		while ((buf = v4l2_m2m_src_buf_remove(sess->fh.m2m_ctx)))
+			v4l2_m2m_buf_done(buf, VB2_BUF_STATE_QUEUED);
+	else
+		while ((buf = v4l2_m2m_dst_buf_remove(sess->fh.m2m_ctx)))
+			v4l2_m2m_buf_done(buf, VB2_BUF_STATE_QUEUED);
+
+	return ret;
+}
+
+static void venc_stop_streaming(struct vb2_queue *q)
+{
+	struct amvenc_session *sess = vb2_get_drv_priv(q);
+	struct amvdec_core *core = sess->core;
+	struct vb2_v4l2_buffer *buf;
+
+	mutex_lock(&core->enc_lock);
+	if (core->enc_sess == sess) {
+		venc_poweroff(sess);
+		core->enc_sess = NULL;
+	}
+	mutex_unlock(&core->enc_lock);
+
+	/* A job cut short by the power off gives its buffers back here */
+	if (sess->cmd != ENCODER_IDLE)
+		venc_job_done(sess, VB2_BUF_STATE_ERROR);
+
+	if (V4L2_TYPE_IS_OUTPUT(q->type))
+		while ((buf = v4l2_m2m_src_buf_remove(sess->fh.m2m_ctx)))
+			v4l2_m2m_buf_done(buf, VB2_BUF_STATE_ERROR);
+	else
+		while ((buf = v4l2_m2m_dst_buf_remove(sess->fh.m2m_ctx)))
+			v4l2_m2m_buf_done(buf, VB2_BUF_STATE_ERROR);
+}
+
+static const struct vb2_ops venc_vb2_ops = {
+	.queue_setup = venc_queue_setup,
+	.buf_prepare = venc_buf_prepare,
+	.buf_queue = venc_buf_queue,
+	.start_streaming = venc_start_streaming,
+	.stop_streaming = venc_stop_streaming,
+	.wait_prepare = vb2_ops_wait_prepare,
+	.wait_finish = vb2_ops_wait_finish,
+};
+
+static int venc_queue_init(void *priv, struct vb2_queue *src_vq,
+			   struct vb2_queue *dst_vq)
+{
+	struct amvenc_session *sess = priv;
+	int ret;
+
+	src_vq->type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE;
+	src_vq->io_modes = VB2_MMAP | VB2_DMABUF;
+	src_vq->timestamp_flags = V4L2_BUF_FLAG_TIMESTAMP_COPY;
+	src_vq->ops = &venc_vb2_ops;
+	src_vq->mem_ops = &vb2_dma_contig_memops;
+	src_vq->drv_priv = sess;
+	src_vq->buf_struct_size = sizeof(struct v4l2_m2m_buffer);
+	src_vq->min_buffers_needed = 1;
+	src_vq->dev = sess->core->dev;
+	src_vq->lock = &sess->lock;
+	ret = vb2_queue_init(src_vq);
+	if (ret)
+		return ret;
+
+	dst_vq->type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+	dst_vq->io_modes = VB2_MMAP | VB2_DMABUF;
+	dst_vq->timestamp_flags = V4L2_BUF_FLAG_TIMESTAMP_COPY;
+	dst_vq->ops = &venc_vb2_ops;
+	dst_vq->mem_ops = &vb2_dma_contig_memops;
+	dst_vq->drv_priv = sess;
+	dst_vq->buf_struct_size = sizeof(struct v4l2_m2m_buffer);
+	dst_vq->min_buffers_needed = 1;
+	dst_vq->dev = sess->core->dev;
+	dst_vq->lock = &sess->lock;
+	ret = vb2_queue_init(dst_vq);
+	if (ret) {
+		vb2_queue_release(src_vq);
+		return ret;
+	}
+
+	return 0;
+}
+
+static inline struct amvenc_session *venc_fh(struct file *file)
+{
+	return container_of(file->private_data, struct amvenc_session, fh);
+}
+
+static int venc_querycap(struct file *file, void *fh,
+			 struct v4l2_capability *cap)
+{
+	strscpy(cap->driver, "meson-venc", sizeof(cap->driver));
+	strscpy(cap->card, "Amlogic Video Encoder", sizeof(cap->card));
+	strscpy(cap->bus_info, "platform:meson-venc", sizeof(cap->bus_info));
+
+	return 0;
+}
+
+static int venc_enum_fmt_out(struct file *file, void *fh,
+			     struct v4l2_fmtdesc *f)
+{
+	if (f->index >= ARRAY_SIZE(venc_pixfmts_out))
+		return -EINVAL;
+
+	f->pixelformat = venc_pixfmts_out[f->index];
+
+	return 0;
+}
+
+static int venc_enum_fmt_cap(struct file *file, void *fh,
+			     struct v4l2_fmtdesc *f)
+{
+	if (f->index)
+		return -EINVAL;
+
+	f->pixelformat = V4L2_PIX_FMT_H264;
+	f->flags = V4L2_FMT_FLAG_COMPRESSED;
+
+	return 0;
+}
+
+static void venc_fill_fmt(struct amvenc_session *sess,
+			  struct v4l2_pix_format_mplane *pixmp, bool output,
+			  u32 width, u32 height)
+{
+	struct v4l2_plane_pix_format *pfmt = pixmp->plane_fmt;
+
+	memset(pfmt[0].reserved, 0, sizeof(pfmt[0].reserved));
+	pixmp->width = width;
+	pixmp->height = height;
+	pixmp->num_planes = 1;
+	pixmp->field = V4L2_FIELD_NONE;
+	pixmp->colorspace = sess->colorspace;
+	if (output) {
+		pfmt[0].bytesperline = width;
+		pfmt[0].sizeimage = venc_out_size(width, height);
+	} else {
+		pixmp->pixelformat = V4L2_PIX_FMT_H264;
+		pfmt[0].bytesperline = 0;
+		pfmt[0].sizeimage = venc_cap_size(width, height);
+	}
+}
+
+static int venc_try_fmt_common(struct amvenc_session *sess,
+			       struct v4l2_format *f)
+{
+	struct v4l2_pix_format_mplane *pixmp = &f->fmt.pix_mp;
+	bool output = V4L2_TYPE_IS_OUTPUT(f->type);
+	u32 width, height;
+	int i;
+
+	if (output) {
+		for (i = 0; i < ARRAY_SIZE(venc_pixfmts_out); i++)
+			if (venc_pixfmts_out[i] == pixmp->pixelformat)
+				break;
+		if (i == ARRAY_SIZE(venc_pixfmts_out))
+			pixmp->pixelformat = V4L2_PIX_FMT_NV12;
+
+		/* The encoder works on whole macroblocks */
+		width = clamp_t(u32, ALIGN(pixmp->width, 16), VENC_MIN_SIZE,
+				VENC_MAX_WIDTH);
+		height = clamp_t(u32, ALIGN(pixmp->height, 16), VENC_MIN_SIZE,
+				 VENC_MAX_HEIGHT);
+	} else {
+		/* The CAPTURE size follows the OUTPUT one */
+		width = sess->width;
+		height = sess->height;
+	}
+
+	venc_fill_fmt(sess, pixmp, output, width, height);
+
+	return 0;
+}
+
+static int venc_try_fmt(struct file *file, void *fh, struct v4l2_format *f)
+{
+	return venc_try_fmt_common(venc_fh(file), f);
+}
+
+static int venc_g_fmt(struct file *file, void *fh, struct v4l2_format *f)
+{
+	struct amvenc_session *sess = venc_fh(file);
+	struct v4l2_pix_format_mplane *pixmp = &f->fmt.pix_mp;
+	bool output = V4L2_TYPE_IS_OUTPUT(f->type);
+
+	if (output)
+		pixmp->pixelformat = sess->pixfmt_out;
+	venc_fill_fmt(sess, pixmp, output, sess->width, sess->height);
+
+	return 0;
+}
+
+static int venc_s_fmt(struct file *file, void *fh, struct v4l2_format *f)
+{
+	struct amvenc_session *sess = venc_fh(file);
+	struct v4l2_pix_format_mplane *pixmp = &f->fmt.pix_mp;
+	struct vb2_queue *vq;
+
+	vq = v4l2_m2m_get_vq(sess->fh.m2m_ctx, f->type);
+	if (vb2_is_busy(vq))
+		return -EBUSY;
+
+	if (V4L2_TYPE_IS_OUTPUT(f->type) &&
+	    vb2_is_busy(v4l2_m2m_get_dst_vq(sess->fh.m2m_ctx)))
+		return -EBUSY;
+
+	venc_try_fmt_common(sess, f);
+
+	if (V4L2_TYPE_IS_OUTPUT(f->type)) {
+		sess->pixfmt_out = pixmp->pixelformat;
+		sess->width = pixmp->width;
+		sess->height = pixmp->height;
+		sess->colorspace = pixmp->colorspace;
+	}
+
+	return 0;
+}
+
+static int venc_g_parm(struct file *file, void *fh, struct v4l2_streamparm *a)
+{
+	struct amvenc_session *sess = venc_fh(file);
+
+	if (!V4L2_TYPE_IS_OUTPUT(a->type))
+		return -EINVAL;
+
+	a->parm.output.capability = V4L2_CAP_TIMEPERFRAME;
+	a->parm.output.timeperframe = sess->timeperframe;
+
+	return 0;
+}
+
+static int venc_s_parm(struct file *file, void *fh, struct v4l2_streamparm *a)
+{
+	struct amvenc_session *sess = venc_fh(file);
+	struct v4l2_fract *tpf = &a->parm.output.timeperframe;
+
+	if (!V4L2_TYPE_IS_OUTPUT(a->type))
+		return -EINVAL;
+
+	if (!tpf->numerator || !tpf->denominator) {
+		tpf->numerator = 1;
+		tpf->denominator = 30;
+	}
+
+	sess->timeperframe = *tpf;
+	a->parm.output.capability = V4L2_CAP_TIMEPERFRAME;
+
+	return 0;
+}
+
+static int venc_enum_framesizes(struct file *file, void *fh,
+				struct v4l2_frmsizeenum *fsize)
+{
+	if (fsize->index)
+		return -EINVAL;
+
+	fsize->type = V4L2_FRMSIZE_TYPE_STEPWISE;
+	fsize->stepwise.min_width = VENC_MIN_SIZE;
+	fsize->stepwise.max_width = VENC_MAX_WIDTH;
+	fsize->stepwise.step_width = 16;
+	fsize->stepwise.min_height = VENC_MIN_SIZE;
+	fsize->stepwise.max_height = VENC_MAX_HEIGHT;
+	fsize->stepwise.step_height = 16;
+
+	return 0;
+}
+
+static int venc_try_encoder_cmd(struct file *file, void *fh,
+				struct v4l2_encoder_cmd *cmd)
+{
+	if (cmd->cmd != V4L2_ENC_CMD_STOP)
+		return -EINVAL;
+
+	cmd->flags = 0;
+
+	return 0;
+}
+
+static int venc_encoder_cmd(struct file *file, void *fh,
+			    struct v4l2_encoder_cmd *cmd)
+{
+	struct amvenc_session *sess = venc_fh(file);
+	struct amvdec_core *core = sess->core;
+	int ret;
+
+	ret = venc_try_encoder_cmd(file, fh, cmd);
+	if (ret)
+		return ret;
+
+	/* Keep the ISR from completing a job while deciding */
+	disable_irq(core->enc_irq);
+	if (sess->cmd != ENCODER_IDLE ||
+	    v4l2_m2m_num_src_bufs_ready(sess->fh.m2m_ctx)) {
+		sess->should_stop = 1;
+	} else {
+		static const struct v4l2_event ev = { .type = V4L2_EVENT_EOS };
+		struct vb2_v4l2_buffer *dst;
+
+		/* Nothing in flight, flag an empty buffer as the last one */
+		dst = v4l2_m2m_dst_buf_remove(sess->fh.m2m_ctx);
+		if (dst) {
+			vb2_set_plane_payload(&dst->vb2_buf, 0, 0);
+			dst->flags |= V4L2_BUF_FLAG_LAST;
+			v4l2_m2m_buf_done(dst, VB2_BUF_STATE_DONE);
+		} else {
+			sess->should_stop = 1;
+		}
+		v4l2_event_queue_fh(&sess->fh, &ev);
+	}
+	enable_irq(core->enc_irq);
+
+	return 0;
+}
+
+static int venc_subscribe_event(struct v4l2_fh *fh,
+				const struct v4l2_event_subscription *sub)
+{
+	switch (sub->type) {
+	case V4L2_EVENT_EOS:
+		return v4l2_event_subscribe(fh, sub, 2, NULL);
+	case V4L2_EVENT_CTRL:
+		return v4l2_ctrl_subscribe_event(fh, sub);
+	default:
+		return -EINVAL;
+	}
+}
+
+static const struct v4l2_ioctl_ops venc_ioctl_ops = {
+	.vidioc_querycap = venc_querycap,
+	.vidioc_enum_fmt_vid_cap_mplane = venc_enum_fmt_cap,
+	.vidioc_enum_fmt_vid_out_mplane = venc_enum_fmt_out,
+	.vidioc_s_fmt_vid_cap_mplane = venc_s_fmt,
+	.vidioc_s_fmt_vid_out_mplane = venc_s_fmt,
+	.vidioc_g_fmt_vid_cap_mplane = venc_g_fmt,
+	.vidioc_g_fmt_vid_out_mplane = venc_g_fmt,
+	.vidioc_try_fmt_vid_cap_mplane = venc_try_fmt,
+	.vidioc_try_fmt_vid_out_mplane = venc_try_fmt,
+	.vidioc_g_parm = venc_g_parm,
+	.vidioc_s_parm = venc_s_parm,
+	.vidioc_enum_framesizes = venc_enum_framesizes,
+	.vidioc_reqbufs = v4l2_m2m_ioctl_reqbufs,
+	.vidioc_querybuf = v4l2_m2m_ioctl_querybuf,
+	.vidioc_prepare_buf = v4l2_m2m_ioctl_prepare_buf,
+	.vidioc_qbuf = v4l2_m2m_ioctl_qbuf,
+	.vidioc_expbuf = v4l2_m2m_ioctl_expbuf,
+	.vidioc_dqbuf = v4l2_m2m_ioctl_dqbuf,
+	.vidioc_create_bufs = v4l2_m2m_ioctl_create_bufs,
+	.vidioc_streamon = v4l2_m2m_ioctl_streamon,
+	.vidioc_streamoff = v4l2_m2m_ioctl_streamoff,
+	.vidioc_subscribe_event = venc_subscribe_event,
+	.vidioc_unsubscribe_event = v4l2_event_unsubscribe,
+	.vidioc_try_encoder_cmd = venc_try_encoder_cmd,
+	.vidioc_encoder_cmd = venc_encoder_cmd,
+};
+
+static int venc_open(struct file *file)
+{
+	struct amvdec_core *core = video_drvdata(file);
+	struct amvenc_session *sess;
+	int ret;
+
+	sess = kzalloc(sizeof(*sess), GFP_KERNEL);
+	if (!sess)
+		return -ENOMEM;
+
+	sess->core = core;
+	mutex_init(&sess->lock);
+	INIT_DELAYED_WORK(&sess->watchdog, venc_watchdog);
+
+	sess->pixfmt_out = V4L2_PIX_FMT_NV12;
+	sess->width = 1280;
+	sess->height = 720;
+	sess->colorspace = V4L2_COLORSPACE_REC709;
+	sess->timeperframe.numerator = 1;
+	sess->timeperframe.denominator = 30;
+
+	ret = amvenc_init_ctrls(sess);
+	if (ret)
+		goto err_free_sess;
+
+	sess->fh.m2m_ctx = v4l2_m2m_ctx_init(core->m2m_dev_enc, sess,
+					     venc_queue_init);
+	if (IS_ERR(sess->fh.m2m_ctx)) {
+		ret = PTR_ERR(sess->fh.m2m_ctx);
+		goto err_free_ctrls;
+	}
+
+	v4l2_fh_init(&sess->fh, core->vdev_enc);
+	sess->fh.ctrl_handler = &sess->ctrl_handler;
+	v4l2_fh_add(&sess->fh);
+	file->private_data = &sess->fh;
+
+	return 0;
+
+err_free_ctrls:
+	v4l2_ctrl_handler_free(&sess->ctrl_handler);
+err_free_sess:
+	mutex_destroy(&sess->lock);
+	kfree(sess);
+	return ret;
+}
+
+static int venc_close(struct file *file)
+{
+	struct amvenc_session *sess = venc_fh(file);
+
+	v4l2_m2m_ctx_release(sess->fh.m2m_ctx);
+	v4l2_ctrl_handler_free(&sess->ctrl_handler);
+	v4l2_fh_del(&sess->fh);
+	v4l2_fh_exit(&sess->fh);
+	mutex_destroy(&sess->lock);
+	kfree(sess);
+
+	return 0;
+}
+
+static const struct v4l2_file_operations venc_fops = {
+	.owner = THIS_MODULE,
+	.open = venc_open,
+	.release = venc_close,
+	.unlocked_ioctl = video_ioctl2,
+	.poll = v4l2_m2m_fop_poll,
+	.mmap = v4l2_m2m_fop_mmap,
+};
+
+int amvenc_probe(struct platform_device *pdev, struct amvdec_core *core)
+{
+	struct device *dev = &pdev->dev;
+	struct video_device *vdev;
+	int ret;
+
+	/* Older device trees only describe the decoder */
+	core->hcodec_clk = devm_clk_get(dev, "vdec_hcodec");
+	if (IS_ERR(core->hcodec_clk)) {
+		if (PTR_ERR(core->hcodec_clk) != -ENOENT)
+			return PTR_ERR(core->hcodec_clk);
+		core->hcodec_clk = NULL;
+		return 0;
+	}
+
+	core->enc_irq = platform_get_irq_byname(pdev, "hcodec");
+	if (core->enc_irq < 0)
+		return core->enc_irq;
+
+	ret = devm_request_irq(dev, core->enc_irq, venc_isr, 0, "hcodec",
+			       core);
+	if (ret)
+		return ret;
+
+	mutex_init(&core->enc_lock);
+
+	core->m2m_dev_enc = v4l2_m2m_init(&venc_m2m_ops);
+	if (IS_ERR(core->m2m_dev_enc)) {
+		dev_err(dev, "Failed to init encoder mem2mem device\n");
+		return PTR_ERR(core->m2m_dev_enc);
+	}
+
+	vdev = video_device_alloc();
+	if (!vdev) {
+		ret = -ENOMEM;
+		goto err_m2m_release;
+	}
+
+	strscpy(vdev->name, "meson-video-encoder", sizeof(vdev->name));
+	vdev->release = video_device_release;
+	vdev->fops = &venc_fops;
+	vdev->ioctl_ops = &venc_ioctl_ops;
+	vdev->vfl_dir = VFL_DIR_M2M;
+	vdev->v4l2_dev = &core->v4l2_dev;
+	vdev->lock = &core->enc_lock;
+	vdev->device_caps = V4L2_CAP_VIDEO_M2M_MPLANE | V4L2_CAP_STREAMING;
+	core->vdev_enc = vdev;
+
+	video_set_drvdata(vdev, core);
+
+	ret = video_register_device(vdev, VFL_TYPE_GRABBER, -1);
+	if (ret) {
+		dev_err(dev, "Failed registering encoder video device\n");
+		goto err_vdev_release;
+	}
+
+	return 0;
+
+err_vdev_release:
+	video_device_release(vdev);
+	core->vdev_enc = NULL;
+err_m2m_release:
+	v4l2_m2m_release(core->m2m_dev_enc);
+	return ret;
+}
+
+void amvenc_remove(struct amvdec_core *core)
+{
+	if (!core->vdev_enc)
+		return;
+
+	video_unregister_device(core->vdev_enc);
+	v4l2_m2m_release(core->m2m_dev_enc);
+}
@@ -0,0 +1,108 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+
+#ifndef __MESON_VENC_H_
+#define __MESON_VENC_H_
+
+#include <linux/platform_device.h>
+#include <media/v4l2-ctrls.h>
+#include <media/v4l2-mem2mem.h>
+
+#include "vdec.h"
+
+/* Input Y/CbCr, reference Y/CbCr and reconstructed Y/CbCr */
+#define AMVENC_NUM_CANVAS	6
+
+/**
+ * struct amvenc_params - encoding parameters, set through the controls
+ *
+ * @bitrate: target bitrate in bits per second
+ * @rc_enable: adapt the QP of each frame to reach @bitrate
+ * @i_qp: QP of the IDR frames when @rc_enable is not set
+ * @p_qp: QP of the P frames when @rc_enable is not set
+ * @min_qp: lowest QP the rate control may pick
+ * @max_qp: highest QP the rate control may pick
+ * @gop_size: number of frames between two IDR frames
+ * @level: H.264 level, as enum v4l2_mpeg_video_h264_level
+ * @force_idr: encode the next frame as an IDR frame
+ */
+struct amvenc_params {
+	u32 bitrate;
+	bool rc_enable;
+	u32 i_qp;
+	u32 p_qp;
+	u32 min_qp;
+	u32 max_qp;
+	u32 gop_size;
+	u32 level;
+	bool force_idr;
+};
+
+/**
+ * struct amvenc_session - encoding session parameters
+ *
+ * @core: reference to the vdec core struct
+ * @fh: v4l2 file handle
+ * @lock: session lock, serializes the queues
+ * @ctrl_handler: controls of the session
+ * @params: encoding parameters
+ * @width: picture width, a multiple of 16
+ * @height: picture height, a multiple of 16
+ * @pixfmt_out: V4L2 pixel format for the OUTPUT queue
+ * @colorspace: colorspace of the OUTPUT queue
+ * @timeperframe: frame interval set by userspace
+ * @qp: QP picked for the next P frame by the rate control
+ * @frame_num: frame_num of the next frame
+ * @idr_pic_id: idr_pic_id of the last IDR frame
+ * @gop_pos: number of frames since the last IDR frame
+ * @cmd: firmware command in progress, ENCODER_IDLE between jobs
+ * @idr: flag set while an IDR frame is being encoded
+ * @ref_vaddr: virtual address of the reference and reconstructed frames
+ * @ref_paddr: physical address of the reference and reconstructed frames
+ * @ref_size: size of each of the reference and reconstructed frames
+ * @ref_idx: index in @ref_paddr of the current reference frame
+ * @canvas: canvases used by the encoder, in the order of
+ *	    AMVENC_NUM_CANVAS
+ * @sequence_cap: capture sequence counter
+ * @should_stop: flag set by V4L2_ENC_CMD_STOP, until the last frame is out
+ * @frames: total number of frames encoded
+ * @bytes: total number of bytes produced
+ * @watchdog: aborts the job if the firmware doesn't answer
+ */
+struct amvenc_session {
+	struct amvdec_core *core;
+
+	struct v4l2_fh fh;
+	struct mutex lock;
+	struct v4l2_ctrl_handler ctrl_handler;
+	struct amvenc_params params;
+
+	u32 width;
+	u32 height;
+	u32 pixfmt_out;
+	u32 colorspace;
+	struct v4l2_fract timeperframe;
+
+	u32 qp;
+	u32 frame_num;
+	u32 idr_pic_id;
+	u32 gop_pos;
+	u32 cmd;
+	bool idr;
+
+	void *ref_vaddr[2];
+	dma_addr_t ref_paddr[2];
+	u32 ref_size;
+	u32 ref_idx;
+	u8 canvas[AMVENC_NUM_CANVAS];
+
+	unsigned int sequence_cap;
+	unsigned int should_stop;
+	u64 frames;
+	u64 bytes;
+	struct delayed_work watchdog;
+};
+
+int amvenc_probe(struct platform_device *pdev, struct amvdec_core *core);
+void amvenc_remove(struct amvdec_core *core);
+
+#endif
@@ -0,0 +1,100 @@
+#include <media/v4l2-mem2mem.h>
+
+#include "venc_ctrls.h"
+
+static int venc_op_s_ctrl(struct v4l2_ctrl *ctrl)
+{
+	struct amvenc_session *sess =
+	      container_of(ctrl->handler, struct amvenc_session, ctrl_handler);
+	struct amvenc_params *params = &sess->params;
+
+	switch (ctrl->id) {
+	case V4L2_CID_MPEG_VIDEO_BITRATE:
+		params->bitrate = ctrl->val;
+		break;
+	case V4L2_CID_MPEG_VIDEO_FRAME_RC_ENABLE:
+		params->rc_enable = ctrl->val;
+		break;
+	case V4L2_CID_MPEG_VIDEO_H264_I_FRAME_QP:
+		params->i_qp = ctrl->val;
+		break;
+	case V4L2_CID_MPEG_VIDEO_H264_P_FRAME_QP:
+		params->p_qp = ctrl->val;
+		break;
+	case V4L2_CID_MPEG_VIDEO_H264_MIN_QP:
+		params->min_qp = ctrl->val;
+		break;
+	case V4L2_CID_MPEG_VIDEO_H264_MAX_QP:
+		params->max_qp = ctrl->val;
+		break;
+	case V4L2_CID_MPEG_VIDEO_GOP_SIZE:
+		params->gop_size = ctrl->val;
+		break;
+	case V4L2_CID_MPEG_VIDEO_H264_LEVEL:
+		params->level = ctrl->val;
+		break;
+	case V4L2_CID_MPEG_VIDEO_FORCE_KEY_FRAME:
+		params->force_idr = true;
+		break;
+	case V4L2_CID_MPEG_VIDEO_H264_PROFILE:
+		break;
+	default:
+		return -EINVAL;
+	};
+
+	sess->qp = clamp(sess->qp, params->min_qp, params->max_qp);
+
+	return 0;
+}
+
+static const struct v4l2_ctrl_ops venc_ctrl_ops = {
+	.s_ctrl = venc_op_s_ctrl,
+};
+
+int amvenc_init_ctrls(struct amvenc_session *sess)
+{
+	struct v4l2_ctrl_handler *ctrl_handler = &sess->ctrl_handler;
+	const struct v4l2_ctrl_ops *ops = &venc_ctrl_ops;
+	int ret;
+
+	ret = v4l2_ctrl_handler_init(ctrl_handler, 10);
+	if (ret)
+		return ret;
+
+	v4l2_ctrl_new_std(ctrl_handler, ops, V4L2_CID_MPEG_VIDEO_BITRATE,
+			  64000, 20000000, 1, 4000000);
+	v4l2_ctrl_new_std(ctrl_handler, ops,
+			  V4L2_CID_MPEG_VIDEO_FRAME_RC_ENABLE, 0, 1, 1, 1);
+	v4l2_ctrl_new_std(ctrl_handler, ops,
+			  V4L2_CID_MPEG_VIDEO_H264_I_FRAME_QP, 0, 51, 1, 26);
+	v4l2_ctrl_new_std(ctrl_handler, ops,
+			  V4L2_CID_MPEG_VIDEO_H264_P_FRAME_QP, 0, 51, 1, 28);
+	v4l2_ctrl_new_std(ctrl_handler, ops,
+			  V4L2_CID_MPEG_VIDEO_H264_MIN_QP, 0, 51, 1, 10);
+	v4l2_ctrl_new_std(ctrl_handler, ops,
+			  V4L2_CID_MPEG_VIDEO_H264_MAX_QP, 0, 51, 1, 51);
+	v4l2_ctrl_new_std(ctrl_handler, ops, V4L2_CID_MPEG_VIDEO_GOP_SIZE,
+			  1, 1024, 1, 30);
+	v4l2_ctrl_new_std(ctrl_handler, ops,
+			  V4L2_CID_MPEG_VIDEO_FORCE_KEY_FRAME, 0, 0, 0, 0);
+
+	/* The firmware only produces CAVLC P slices */
+	v4l2_ctrl_new_std_menu(ctrl_handler, ops,
+		V4L2_CID_MPEG_VIDEO_H264_PROFILE,
+		V4L2_MPEG_VIDEO_H264_PROFILE_BASELINE,
+		~BIT(V4L2_MPEG_VIDEO_H264_PROFILE_BASELINE),
+		V4L2_MPEG_VIDEO_H264_PROFILE_BASELINE);
+	v4l2_ctrl_new_std_menu(ctrl_handler, ops,
+		V4L2_CID_MPEG_VIDEO_H264_LEVEL,
+		V4L2_MPEG_VIDEO_H264_LEVEL_4_1, 0,
+		V4L2_MPEG_VIDEO_H264_LEVEL_4_0);
+
+	ret = ctrl_handler->error;
+	if (ret) {
+		v4l2_ctrl_handler_free(ctrl_handler);
+		return ret;
+	}
+
+	return v4l2_ctrl_handler_setup(ctrl_handler);
+}
+EXPORT_SYMBOL_GPL(amvenc_init_ctrls);
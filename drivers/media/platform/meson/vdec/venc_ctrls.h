@@ -0,0 +1,8 @@
+#ifndef __MESON_VENC_CTRLS_H_
+#define __MESON_VENC_CTRLS_H_
+
+#include "venc.h"
+
+int amvenc_init_ctrls(struct amvenc_session *sess);
+
+#endif
@@ -16,6 +16,7 @@
 #include <linux/interrupt.h>
 #include <linux/io.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
 #include <linux/of_platform.h>
 #include <linux/platform_device.h>
 #include <linux/spinlock.h>
@@ -38,19 +39,23 @@
 #define IR_DEC_REG2		0x20
 
 #define REG0_RATE_MASK		GENMASK(11, 0)
+#define REG0_MAX_FRAME_MASK	GENMASK(27, 12)
+
+/* LDR_ACTIVE, LDR_IDLE, LDR_REPEAT and BIT_0 hold a time window */
+#define DEC_TIME_MAX_MASK	GENMASK(28, 16)
+#define DEC_TIME_MIN_MASK	GENMASK(12, 0)
 
 #define DECODE_MODE_NEC		0x0
 #define DECODE_MODE_RAW		0x2
 
 /* Meson 6b uses REG1 to configure the mode */
 #define REG1_MODE_MASK		GENMASK(8, 7)
-#define REG1_MODE_SHIFT		7
 
 /* Meson 8b / GXBB use REG2 to configure the mode */
 #define REG2_MODE_MASK		GENMASK(3, 0)
-#define REG2_MODE_SHIFT		0
 
 #define REG1_TIME_IV_MASK	GENMASK(28, 16)
+#define REG1_FRAME_LEN_MASK	GENMASK(13, 8)
 
 #define REG1_IRQSEL_MASK	GENMASK(3, 2)
 #define REG1_IRQSEL_NEC_MODE	0
@@ -61,16 +66,44 @@
 #define REG1_RESET		BIT(0)
 #define REG1_ENABLE		BIT(15)
 
+#define STATUS_BIT_1_MAX_MASK	GENMASK(29, 20)
+#define STATUS_BIT_1_MIN_MASK	GENMASK(19, 10)
 #define STATUS_IR_DEC_IN	BIT(8)
+#define STATUS_REPEAT		BIT(0)
 
 #define MESON_TRATE		10	/* us */
+#define MESON_HW_TRATE		20	/* us */
+
+/* NEC timings, as [min, max] windows of MESON_HW_TRATE ticks */
+#define NEC_LDR_ACTIVE_MIN	400	/* 9 ms */
+#define NEC_LDR_ACTIVE_MAX	500
+#define NEC_LDR_IDLE_MIN	200	/* 4.5 ms */
+#define NEC_LDR_IDLE_MAX	300
+#define NEC_LDR_REPEAT_MIN	80	/* 2.25 ms */
+#define NEC_LDR_REPEAT_MAX	150
+#define NEC_BIT_0_MIN		40	/* 1.125 ms */
+#define NEC_BIT_0_MAX		72
+#define NEC_BIT_1_MIN		90	/* 2.25 ms */
+#define NEC_BIT_1_MAX		134
+#define NEC_MAX_FRAME		4000	/* 80 ms */
+#define NEC_FRAME_BITS		32
 
 struct meson_ir {
 	void __iomem	*reg;
 	struct rc_dev	*rc;
 	spinlock_t	lock;
+	struct device	*dev;
+	struct mutex	mode_lock;
+	const char	*map_name;
+	int		irq;
+	bool		hw_decode;
 };
 
+static bool hw_decode;
+module_param(hw_decode, bool, 0444);
+MODULE_PARM_DESC(hw_decode,
+		 "Decode NEC frames in hardware (default: off)");
+
 static void meson_ir_set_mask(struct meson_ir *ir, unsigned int reg,
 			      u32 mask, u32 value)
 {
@@ -82,6 +115,34 @@ static void meson_ir_set_mask(struct meson_ir *ir, unsigned int reg,
 	writel(data, ir->reg + reg);
 }
 
+static void meson_ir_set_decode_mode(struct meson_ir *ir, u32 mode)
+{
+	if (of_device_is_compatible(ir->dev->of_node, "amlogic,meson6-ir"))
+		meson_ir_set_mask(ir, IR_DEC_REG1, REG1_MODE_MASK,
+				  FIELD_PREP(REG1_MODE_MASK, mode));
+	else
+		meson_ir_set_mask(ir, IR_DEC_REG2, REG2_MODE_MASK,
+				  FIELD_PREP(REG2_MODE_MASK, mode));
+}
+
+static void meson_ir_nec_irq(struct meson_ir *ir)
+{
+	enum rc_proto proto;
+	u32 status, frame, scancode;
+
+	status = readl_relaxed(ir->reg + IR_DEC_STATUS);
+	if (status & STATUS_REPEAT) {
+		rc_repeat(ir->rc);
+		return;
+	}
+
+	/* The frame is shifted in LSB first */
+	frame = readl_relaxed(ir->reg + IR_DEC_FRAME);
+	scancode = ir_nec_bytes_to_scancode(frame, frame >> 8, frame >> 16,
+					    frame >> 24, &proto);
+	rc_keydown(ir->rc, proto, scancode, 0);
+}
+
 static irqreturn_t meson_ir_irq(int irqno, void *dev_id)
 {
 	struct meson_ir *ir = dev_id;
@@ -90,6 +151,12 @@ static irqreturn_t meson_ir_irq(int irqno, void *dev_id)
 
 	spin_lock(&ir->lock);
 
+	if (ir->hw_decode) {
+		meson_ir_nec_irq(ir);
+		spin_unlock(&ir->lock);
+		return IRQ_HANDLED;
+	}
+
 	duration = readl_relaxed(ir->reg + IR_DEC_REG1);
 	duration = FIELD_GET(REG1_TIME_IV_MASK, duration);
 	rawir.duration = US_TO_NS(duration * MESON_TRATE);
@@ -105,6 +172,185 @@ static irqreturn_t meson_ir_irq(int irqno, void *dev_id)
 	return IRQ_HANDLED;
 }
 
+static void meson_ir_set_window(struct meson_ir *ir, unsigned int reg,
+				u32 min, u32 max)
+{
+	writel_relaxed(FIELD_PREP(DEC_TIME_MAX_MASK, max) |
+		       FIELD_PREP(DEC_TIME_MIN_MASK, min), ir->reg + reg);
+}
+
+static void meson_ir_hw_init(struct meson_ir *ir)
+{
+	unsigned long flags;
+	u32 regval;
+
+	spin_lock_irqsave(&ir->lock, flags);
+
+	/* Reset the decoder */
+	meson_ir_set_mask(ir, IR_DEC_REG1, REG1_RESET, REG1_RESET);
+	meson_ir_set_mask(ir, IR_DEC_REG1, REG1_RESET, 0);
+
+	if (ir->hw_decode) {
+		meson_ir_set_decode_mode(ir, DECODE_MODE_NEC);
+
+		meson_ir_set_window(ir, IR_DEC_LDR_ACTIVE,
+				    NEC_LDR_ACTIVE_MIN, NEC_LDR_ACTIVE_MAX);
+		meson_ir_set_window(ir, IR_DEC_LDR_IDLE,
+				    NEC_LDR_IDLE_MIN, NEC_LDR_IDLE_MAX);
+		meson_ir_set_window(ir, IR_DEC_LDR_REPEAT,
+				    NEC_LDR_REPEAT_MIN, NEC_LDR_REPEAT_MAX);
+		meson_ir_set_window(ir, IR_DEC_BIT_0,
+				    NEC_BIT_0_MIN, NEC_BIT_0_MAX);
+
+		regval = FIELD_PREP(STATUS_BIT_1_MAX_MASK, NEC_BIT_1_MAX) |
+			 FIELD_PREP(STATUS_BIT_1_MIN_MASK, NEC_BIT_1_MIN);
+		meson_ir_set_mask(ir, IR_DEC_STATUS,
+				  STATUS_BIT_1_MAX_MASK | STATUS_BIT_1_MIN_MASK,
+				  regval);
+
+		regval = FIELD_PREP(REG0_RATE_MASK, MESON_HW_TRATE - 1) |
+			 FIELD_PREP(REG0_MAX_FRAME_MASK, NEC_MAX_FRAME);
+		meson_ir_set_mask(ir, IR_DEC_REG0,
+				  REG0_RATE_MASK | REG0_MAX_FRAME_MASK, regval);
+		meson_ir_set_mask(ir, IR_DEC_REG1, REG1_FRAME_LEN_MASK,
+				  FIELD_PREP(REG1_FRAME_LEN_MASK,
+					     NEC_FRAME_BITS - 1));
+		/* IRQ once per decoded frame or repeat code */
+		meson_ir_set_mask(ir, IR_DEC_REG1, REG1_IRQSEL_MASK,
+				  FIELD_PREP(REG1_IRQSEL_MASK,
+					     REG1_IRQSEL_NEC_MODE));
+	} else {
+		/* Set general operation mode (= raw/software decoding) */
+		meson_ir_set_decode_mode(ir, DECODE_MODE_RAW);
+
+		/* Set rate */
+		meson_ir_set_mask(ir, IR_DEC_REG0, REG0_RATE_MASK,
+				  MESON_TRATE - 1);
+		/* IRQ on rising and falling edges */
+		meson_ir_set_mask(ir, IR_DEC_REG1, REG1_IRQSEL_MASK,
+				  FIELD_PREP(REG1_IRQSEL_MASK,
+					     REG1_IRQSEL_RISE_FALL));
+	}
+
+	/* Enable the decoder */
+	meson_ir_set_mask(ir, IR_DEC_REG1, REG1_ENABLE, REG1_ENABLE);
+
+	spin_unlock_irqrestore(&ir->lock, flags);
+}
+
+static int meson_ir_rc_register(struct meson_ir *ir)
+{
+	struct rc_dev *rc;
+	int ret;
+
+	rc = rc_allocate_device(ir->hw_decode ? RC_DRIVER_SCANCODE :
+						RC_DRIVER_IR_RAW);
+	if (!rc) {
+		dev_err(ir->dev, "failed to allocate rc device\n");
+		return -ENOMEM;
+	}
+
+	rc->priv = ir;
+	rc->dev.parent = ir->dev;
+	rc->device_name = DRIVER_NAME;
+	rc->input_phys = DRIVER_NAME "/input0";
+	rc->input_id.bustype = BUS_HOST;
+	rc->map_name = ir->map_name;
+	rc->driver_name = DRIVER_NAME;
+
+	if (ir->hw_decode) {
+		rc->allowed_protocols = RC_PROTO_BIT_NEC | RC_PROTO_BIT_NECX |
+					RC_PROTO_BIT_NEC32;
+	} else {
+		rc->allowed_protocols = RC_PROTO_BIT_ALL_IR_DECODER;
+		rc->rx_resolution = US_TO_NS(MESON_TRATE);
+		rc->min_timeout = 1;
+		rc->timeout = IR_DEFAULT_TIMEOUT;
+		rc->max_timeout = 10 * IR_DEFAULT_TIMEOUT;
+	}
+
+	ret = rc_register_device(rc);
+	if (ret) {
+		dev_err(ir->dev, "failed to register rc device\n");
+		rc_free_device(rc);
+		return ret;
+	}
+
+	ir->rc = rc;
+
+	return 0;
+}
+
+static void meson_ir_rc_unregister(void *data)
+{
+	struct meson_ir *ir = data;
+
+	rc_unregister_device(ir->rc);
+}
+
+static ssize_t hw_decode_show(struct device *dev,
+			      struct device_attribute *attr, char *buf)
+{
+	struct meson_ir *ir = dev_get_drvdata(dev);
+
+	return sprintf(buf, "%d\n", ir->hw_decode);
+}
+
+static ssize_t hw_decode_store(struct device *dev,
+			       struct device_attribute *attr,
+			       const char *buf, size_t count)
+{
+	struct meson_ir *ir = dev_get_drvdata(dev);
+	struct rc_dev *old_rc;
+	bool enable;
+	int ret;
+
+	ret = kstrtobool(buf, &enable);
+	if (ret)
+		return ret;
+
+	mutex_lock(&ir->mode_lock);
+
+	if (enable == ir->hw_decode)
+		goto out;
+
+	/*
+	 * The rc-core driver type is fixed at allocation, so switch to a
+	 * new rc device of the other type. The old one is only dropped
+	 * once its replacement is registered.
+	 */
+	disable_irq(ir->irq);
+
+	old_rc = ir->rc;
+	ir->hw_decode = enable;
+	ret = meson_ir_rc_register(ir);
+	if (ret) {
+		ir->hw_decode = !enable;
+		ir->rc = old_rc;
+	} else {
+		rc_unregister_device(old_rc);
+	}
+
+	meson_ir_hw_init(ir);
+
+	enable_irq(ir->irq);
+
+out:
+	mutex_unlock(&ir->mode_lock);
+
+	return ret ? ret : count;
+}
+static DEVICE_ATTR_RW(hw_decode);
+
+static struct attribute *meson_ir_attrs[] = {
+	&dev_attr_hw_decode.attr,
+	NULL,
+};
+
+static const struct attribute_group meson_ir_attr_group = {
+	.attrs = meson_ir_attrs,
+};
+
 static int meson_ir_probe(struct platform_device *pdev)
 {
 	struct device *dev = &pdev->dev;
@@ -131,33 +377,23 @@ static int meson_ir_probe(struct platform_device *pdev)
 		return irq;
 	}
 
-	ir->rc = devm_rc_allocate_device(dev, RC_DRIVER_IR_RAW);
-	if (!ir->rc) {
-		dev_err(dev, "failed to allocate rc device\n");
-		return -ENOMEM;
-	}
-
-	ir->rc->priv = ir;
-	ir->rc->device_name = DRIVER_NAME;
-	ir->rc->input_phys = DRIVER_NAME "/input0";
-	ir->rc->input_id.bustype = BUS_HOST;
+	ir->dev = dev;
+	ir->irq = irq;
+	ir->hw_decode = hw_decode;
 	map_name = of_get_property(node, "linux,rc-map-name", NULL);
-	ir->rc->map_name = map_name ? map_name : RC_MAP_EMPTY;
-	ir->rc->allowed_protocols = RC_PROTO_BIT_ALL_IR_DECODER;
-	ir->rc->rx_resolution = US_TO_NS(MESON_TRATE);
-	ir->rc->min_timeout = 1;
-	ir->rc->timeout = IR_DEFAULT_TIMEOUT;
-	ir->rc->max_timeout = 10 * IR_DEFAULT_TIMEOUT;
-	ir->rc->driver_name = DRIVER_NAME;
+	ir->map_name = map_name ? map_name : RC_MAP_EMPTY;
 
 	spin_lock_init(&ir->lock);
+	mutex_init(&ir->mode_lock);
 	platform_set_drvdata(pdev, ir);
 
-	ret = devm_rc_register_device(dev, ir->rc);
-	if (ret) {
-		dev_err(dev, "failed to register rc device\n");
+	ret = meson_ir_rc_register(ir);
+	if (ret)
+		return ret;
+
+	ret = devm_add_action_or_reset(dev, meson_ir_rc_unregister, ir);
+	if (ret)
 		return ret;
-	}
 
 	ret = devm_request_irq(dev, irq, meson_ir_irq, 0, NULL, ir);
 	if (ret) {
@@ -165,25 +401,11 @@ static int meson_ir_probe(struct platform_device *pdev)
 		return ret;
 	}
 
-	/* Reset the decoder */
-	meson_ir_set_mask(ir, IR_DEC_REG1, REG1_RESET, REG1_RESET);
-	meson_ir_set_mask(ir, IR_DEC_REG1, REG1_RESET, 0);
+	meson_ir_hw_init(ir);
 
-	/* Set general operation mode (= raw/software decoding) */
-	if (of_device_is_compatible(node, "amlogic,meson6-ir"))
-		meson_ir_set_mask(ir, IR_DEC_REG1, REG1_MODE_MASK,
-				  FIELD_PREP(REG1_MODE_MASK, DECODE_MODE_RAW));
-	else
-		meson_ir_set_mask(ir, IR_DEC_REG2, REG2_MODE_MASK,
-				  FIELD_PREP(REG2_MODE_MASK, DECODE_MODE_RAW));
-
-	/* Set rate */
-	meson_ir_set_mask(ir, IR_DEC_REG0, REG0_RATE_MASK, MESON_TRATE - 1);
-	/* IRQ on rising and falling edges */
-	meson_ir_set_mask(ir, IR_DEC_REG1, REG1_IRQSEL_MASK,
-			  FIELD_PREP(REG1_IRQSEL_MASK, REG1_IRQSEL_RISE_FALL));
-	/* Enable the decoder */
-	meson_ir_set_mask(ir, IR_DEC_REG1, REG1_ENABLE, REG1_ENABLE);
+	ret = devm_device_add_group(dev, &meson_ir_attr_group);
+	if (ret)
+		return ret;
 
 	dev_info(dev, "receiver initialized\n");
 
@@ -205,8 +427,6 @@ static int meson_ir_remove(struct platform_device *pdev)
 
 static void meson_ir_shutdown(struct platform_device *pdev)
 {
-	struct device *dev = &pdev->dev;
-	struct device_node *node = dev->of_node;
 	struct meson_ir *ir = platform_get_drvdata(pdev);
 	unsigned long flags;
 
@@ -216,12 +436,7 @@ static void meson_ir_shutdown(struct platform_device *pdev)
 	 * Set operation mode to NEC/hardware decoding to give
 	 * bootloader a chance to power the system back on
 	 */
-	if (of_device_is_compatible(node, "amlogic,meson6-ir"))
-		meson_ir_set_mask(ir, IR_DEC_REG1, REG1_MODE_MASK,
-				  DECODE_MODE_NEC << REG1_MODE_SHIFT);
-	else
-		meson_ir_set_mask(ir, IR_DEC_REG2, REG2_MODE_MASK,
-				  DECODE_MODE_NEC << REG2_MODE_SHIFT);
+	meson_ir_set_decode_mode(ir, DECODE_MODE_NEC);
 
 	/* Set rate to default value */
 	meson_ir_set_mask(ir, IR_DEC_REG0, REG0_RATE_MASK, 0x13);
@@ -943,6 +943,10 @@ size_t uvc_video_stats_dump(struct uvc_streaming *stream, char *buf,
 			   stream->stats.stream.min_sof,
 			   stream->stats.stream.max_sof,
 			   scr_sof_freq / 1000, scr_sof_freq % 1000);
+	count += scnprintf(buf + count, size - count,
+			   "copy: %llu bytes by worker, %u async urbs\n",
+			   stream->stats.stream.bytes_copied,
+			   stream->stats.stream.nb_urbs_async);
 
 	return count;
 }
@@ -980,8 +984,9 @@ static void uvc_video_stats_stop(struct uvc_streaming *stream)
  * made until the next payload. -ENODATA can be used to drop the current
  * payload if no other error code is appropriate.
  *
- * uvc_video_decode_data is called for every URB with URB data. It copies the
- * data to the video buffer.
+ * uvc_video_decode_data is called for every URB with URB data. It schedules
+ * the copy of the data to the video buffer, which is performed by the stream
+ * worker before the URB is resubmitted.
  *
  * uvc_video_decode_end is called with header data at the end of a bulk or
  * isochronous payload. It performs any additional header data processing and
@@ -1094,21 +1099,28 @@ static int uvc_video_decode_start(struct uvc_streaming *stream,
 	return data[0];
 }
 
-static void uvc_video_decode_data(struct uvc_streaming *stream,
+static void uvc_video_decode_data(struct uvc_urb *uvc_urb,
 		struct uvc_buffer *buf, const u8 *data, int len)
 {
-	unsigned int maxlen, nbytes;
-	void *mem;
+	struct uvc_copy_op *op;
+	unsigned int maxlen;
 
 	if (len <= 0)
 		return;
 
-	/* Copy the video data to the buffer. */
+	/* Schedule the copy of the video data to the buffer. */
 	maxlen = buf->length - buf->bytesused;
-	mem = buf->mem + buf->bytesused;
-	nbytes = min((unsigned int)len, maxlen);
-	memcpy(mem, data, nbytes);
-	buf->bytesused += nbytes;
+	op = &uvc_urb->copy_operations[uvc_urb->async_operations++];
+
+	/* The buffer is only completed once the copy is done. */
+	kref_get(&buf->ref);
+
+	op->buf = buf;
+	op->src = data;
+	op->dst = buf->mem + buf->bytesused;
+	op->len = min((unsigned int)len, maxlen);
+
+	buf->bytesused += op->len;
 
 	/* Complete the current frame if the buffer size was exceeded. */
 	if (len > maxlen) {
@@ -1322,7 +1334,7 @@ static void uvc_video_decode_isoc(struct urb *urb, struct uvc_streaming *stream,
 		uvc_video_decode_meta(stream, meta_buf, mem, ret);
 
 		/* Decode the payload data. */
-		uvc_video_decode_data(stream, buf, mem + ret,
+		uvc_video_decode_data(urb->context, buf, mem + ret,
 			urb->iso_frame_desc[i].actual_length - ret);
 
 		/* Process the header again. */
@@ -1382,7 +1394,7 @@ static void uvc_video_decode_bulk(struct urb *urb, struct uvc_streaming *stream,
 
 	/* Process video data. */
 	if (!stream->bulk.skip_payload && buf != NULL)
-		uvc_video_decode_data(stream, buf, mem, len);
+		uvc_video_decode_data(urb->context, buf, mem, len);
 
 	/* Detect the payload end by a URB smaller than the maximum size (or
 	 * a payload size equal to the maximum) and process the header again.
@@ -1445,9 +1457,33 @@ static void uvc_video_encode_bulk(struct urb *urb, struct uvc_streaming *stream,
 	urb->transfer_buffer_length = stream->urb_size - len;
 }
 
+static void uvc_video_copy_data_work(struct work_struct *work)
+{
+	struct uvc_urb *uvc_urb = container_of(work, struct uvc_urb, work);
+	struct uvc_streaming *stream = uvc_urb->stream;
+	unsigned int i;
+	int ret;
+
+	for (i = 0; i < uvc_urb->async_operations; ++i) {
+		struct uvc_copy_op *op = &uvc_urb->copy_operations[i];
+
+		memcpy(op->dst, op->src, op->len);
+		stream->stats.stream.bytes_copied += op->len;
+
+		/* Release the reference taken on the buffer by the decoder. */
+		uvc_queue_buffer_release(op->buf);
+	}
+
+	ret = usb_submit_urb(uvc_urb->urb, GFP_KERNEL);
+	if (ret < 0 && ret != -EPERM)
+		uvc_printk(KERN_ERR, "Failed to resubmit video URB (%d).\n",
+			   ret);
+}
+
 static void uvc_video_complete(struct urb *urb)
 {
-	struct uvc_streaming *stream = urb->context;
+	struct uvc_urb *uvc_urb = urb->context;
+	struct uvc_streaming *stream = uvc_urb->stream;
 	struct uvc_video_queue *queue = &stream->queue;
 	struct uvc_video_queue *qmeta = &stream->meta.queue;
 	struct vb2_queue *vb2_qmeta = stream->meta.vdev.queue;
@@ -1490,8 +1526,20 @@ static void uvc_video_complete(struct urb *urb)
 		spin_unlock_irqrestore(&qmeta->irqlock, flags);
 	}
 
+	uvc_urb->async_operations = 0;
 	stream->decode(urb, stream, buf, buf_meta);
 
+	/*
+	 * Copy the payload from the stream worker, which can run on another
+	 * CPU than the one handling the host controller interrupt. The URB is
+	 * resubmitted once its data has been consumed.
+	 */
+	if (uvc_urb->async_operations) {
+		stream->stats.stream.nb_urbs_async++;
+		queue_work(stream->async_wq, &uvc_urb->work);
+		return;
+	}
+
 	if ((ret = usb_submit_urb(urb, GFP_ATOMIC)) < 0) {
 		uvc_printk(KERN_ERR, "Failed to resubmit video URB (%d).\n",
 			ret);
@@ -1589,12 +1637,24 @@ static void uvc_uninit_video(struct uvc_streaming *stream, int free_buffers)
 
 	uvc_video_stats_stop(stream);
 
+	/*
+	 * Poison the URBs rather than kill them, the stream worker could
+	 * otherwise resubmit them once their pending copies are done.
+	 */
+	for (i = 0; i < UVC_URBS; ++i) {
+		urb = stream->urb[i];
+		if (urb != NULL)
+			usb_poison_urb(urb);
+	}
+
+	if (stream->async_wq)
+		flush_workqueue(stream->async_wq);
+
 	for (i = 0; i < UVC_URBS; ++i) {
 		urb = stream->urb[i];
 		if (urb == NULL)
 			continue;
 
-		usb_kill_urb(urb);
 		usb_free_urb(urb);
 		stream->urb[i] = NULL;
 	}
@@ -1603,6 +1663,19 @@ static void uvc_uninit_video(struct uvc_streaming *stream, int free_buffers)
 		uvc_free_urb_buffers(stream);
 }
 
+static void uvc_video_init_uvc_urb(struct uvc_streaming *stream,
+				   unsigned int i, struct urb *urb)
+{
+	struct uvc_urb *uvc_urb = &stream->uvc_urb[i];
+
+	uvc_urb->urb = urb;
+	uvc_urb->stream = stream;
+	uvc_urb->async_operations = 0;
+	INIT_WORK(&uvc_urb->work, uvc_video_copy_data_work);
+
+	stream->urb[i] = urb;
+}
+
 /*
  * Compute the maximum number of bytes per interval for an endpoint.
  */
@@ -1658,7 +1731,7 @@ static int uvc_init_video_isoc(struct uvc_streaming *stream,
 		}
 
 		urb->dev = stream->dev->udev;
-		urb->context = stream;
+		urb->context = &stream->uvc_urb[i];
 		urb->pipe = usb_rcvisocpipe(stream->dev->udev,
 				ep->desc.bEndpointAddress);
 #ifndef CONFIG_DMA_NONCOHERENT
@@ -1678,7 +1751,7 @@ static int uvc_init_video_isoc(struct uvc_streaming *stream,
 			urb->iso_frame_desc[j].length = psize;
 		}
 
-		stream->urb[i] = urb;
+		uvc_video_init_uvc_urb(stream, i, urb);
 	}
 
 	return 0;
@@ -1725,13 +1798,13 @@ static int uvc_init_video_bulk(struct uvc_streaming *stream,
 
 		usb_fill_bulk_urb(urb, stream->dev->udev, pipe,
 			stream->urb_buffer[i], size, uvc_video_complete,
-			stream);
+			&stream->uvc_urb[i]);
 #ifndef CONFIG_DMA_NONCOHERENT
 		urb->transfer_flags = URB_NO_TRANSFER_DMA_MAP;
 		urb->transfer_dma = stream->urb_dma[i];
 #endif
 
-		stream->urb[i] = urb;
+		uvc_video_init_uvc_urb(stream, i, urb);
 	}
 
 	return 0;
@@ -2032,12 +2105,21 @@ int uvc_video_enable(struct uvc_streaming *stream, int enable)
 		}
 
 		uvc_video_clock_cleanup(stream);
+		if (stream->async_wq) {
+			destroy_workqueue(stream->async_wq);
+			stream->async_wq = NULL;
+		}
 		return 0;
 	}
 
+	/* Payload copies are performed in order, off the URB completion. */
+	stream->async_wq = alloc_ordered_workqueue("uvcvideo", WQ_HIGHPRI);
+	if (!stream->async_wq)
+		return -ENOMEM;
+
 	ret = uvc_video_clock_init(stream);
 	if (ret < 0)
-		return ret;
+		goto error_clock;
 
 	/* Commit the streaming parameters. */
 	ret = uvc_commit_video(stream, &stream->ctrl);
@@ -2054,6 +2136,9 @@ error_video:
 	usb_set_interface(stream->dev->udev, stream->intfnum, 0);
 error_commit:
 	uvc_video_clock_cleanup(stream);
+error_clock:
+	destroy_workqueue(stream->async_wq);
+	stream->async_wq = NULL;
 
 	return ret;
 }
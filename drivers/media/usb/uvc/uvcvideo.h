@@ -7,6 +7,7 @@
 #endif /* __KERNEL__ */
 
 #include <linux/kernel.h>
+#include <linux/kref.h>
 #include <linux/poll.h>
 #include <linux/usb.h>
 #include <linux/usb/video.h>
@@ -410,6 +411,9 @@ struct uvc_buffer {
 	unsigned int bytesused;
 
 	u32 pts;
+
+	/* Asynchronous buffer handling. */
+	struct kref ref;
 };
 
 #define UVC_QUEUE_DISCONNECTED		(1 << 0)
@@ -483,6 +487,47 @@ struct uvc_stats_stream {
 	unsigned int scr_sof;		/* STC.SOF of the last packet */
 	unsigned int min_sof;		/* Minimum STC.SOF value */
 	unsigned int max_sof;		/* Maximum STC.SOF value */
+
+	u64 bytes_copied;		/* Payload bytes copied by the stream worker */
+	unsigned int nb_urbs_async;	/* URBs handed to the stream worker */
+};
+
+/**
+ * struct uvc_copy_op - context structure to schedule asynchronous memcpy
+ *
+ * @buf: active buf object for this operation
+ * @dst: copy destination address
+ * @src: copy source address
+ * @len: copy length
+ */
+struct uvc_copy_op {
+	struct uvc_buffer *buf;
+	void *dst;
+	const u8 *src;
+	size_t len;
+};
+
+/**
+ * struct uvc_urb - URB context management structure
+ *
+ * @urb: the URB described by this context structure
+ * @stream: UVC streaming context
+ * @async_operations: number of copy operations recorded for the URB
+ * @copy_operations: work descriptors for asynchronous copy operations
+ * @work: work queue entry for asynchronous decode
+ *
+ * The payload of a video URB is not copied to the video buffers from its
+ * completion handler, which runs in interrupt context on the CPU handling
+ * the host controller interrupt. The copies are recorded while decoding the
+ * headers, and performed by the stream worker, which resubmits the URB.
+ */
+struct uvc_urb {
+	struct urb *urb;
+	struct uvc_streaming *stream;
+
+	unsigned int async_operations;
+	struct uvc_copy_op copy_operations[UVC_MAX_PACKETS];
+	struct work_struct work;
 };
 
 #define UVC_METATADA_BUF_SIZE 1024
@@ -540,6 +585,9 @@ struct uvc_streaming {
 	dma_addr_t urb_dma[UVC_URBS];
 	unsigned int urb_size;
 
+	struct uvc_urb uvc_urb[UVC_URBS];
+	struct workqueue_struct *async_wq;
+
 	u32 sequence;
 	u8 last_fid;
 
@@ -702,6 +750,7 @@ int uvc_dequeue_buffer(struct uvc_video_queue *queue,
 int uvc_queue_streamon(struct uvc_video_queue *queue, enum v4l2_buf_type type);
 int uvc_queue_streamoff(struct uvc_video_queue *queue, enum v4l2_buf_type type);
 void uvc_queue_cancel(struct uvc_video_queue *queue, int disconnect);
+void uvc_queue_buffer_release(struct uvc_buffer *buf);
 struct uvc_buffer *uvc_queue_next_buffer(struct uvc_video_queue *queue,
 					 struct uvc_buffer *buf);
 int uvc_queue_mmap(struct uvc_video_queue *queue,
@@ -1095,12 +1095,17 @@ static int v4l_s_priority(const struct v4l2_ioctl_ops *ops,
 	struct video_device *vfd;
 	struct v4l2_fh *vfh;
 	u32 *p = arg;
+	int ret;
 
 	vfd = video_devdata(file);
 	if (!test_bit(V4L2_FL_USES_V4L2_FH, &vfd->flags))
 		return -ENOTTY;
 	vfh = file->private_data;
-	return v4l2_prio_change(vfd->prio, &vfh->prio, *p);
+	ret = v4l2_prio_change(vfd->prio, &vfh->prio, *p);
+	/* mem2mem jobs are scheduled by the priority of their file handle */
+	if (!ret && vfh->m2m_ctx)
+		WRITE_ONCE(vfh->m2m_ctx->priority, *p);
+	return ret;
 }
 
 static int v4l_enuminput(const struct v4l2_ioctl_ops *ops,
@@ -13,6 +13,7 @@
  * Free Software Foundation; either version 2 of the License, or (at your
  * option) any later version.
  */
+#include <linux/ktime.h>
 #include <linux/module.h>
 #include <linux/sched.h>
 #include <linux/slab.h>
@@ -84,8 +85,12 @@ static const char * const m2m_entity_name[] = {
  *			v4l2_m2m_unregister_media_controller().
  * @intf_devnode:	&struct media_intf devnode pointer with the interface
  *			with controls the M2M device.
- * @curr_ctx:		currently running instance
- * @job_queue:		instances queued to run
+ * @curr_ctx:		currently running instance, or first instance of the
+ *			running batch
+ * @running:		number of instances currently running
+ * @max_batch:		maximum number of instances run at once with
+ *			&v4l2_m2m_ops->device_run_batch
+ * @job_queue:		instances queued to run, by decreasing priority
  * @job_spinlock:	protects job_queue
  * @m2m_ops:		driver callbacks
  */
@@ -101,6 +106,8 @@ struct v4l2_m2m_dev {
 	struct media_intf_devnode *intf_devnode;
 #endif
 
+	unsigned int		running;
+	unsigned int		max_batch;
 	struct list_head	job_queue;
 	spinlock_t		job_spinlock;
 
@@ -239,18 +246,43 @@ void *v4l2_m2m_get_curr_priv(struct v4l2_m2m_dev *m2m_dev)
 }
 EXPORT_SYMBOL(v4l2_m2m_get_curr_priv);
 
+void v4l2_m2m_ctx_set_priority(struct v4l2_m2m_ctx *m2m_ctx,
+			       enum v4l2_priority prio)
+{
+	WRITE_ONCE(m2m_ctx->priority, prio);
+}
+EXPORT_SYMBOL_GPL(v4l2_m2m_ctx_set_priority);
+
+void v4l2_m2m_ctx_get_stats(struct v4l2_m2m_ctx *m2m_ctx,
+			    struct v4l2_m2m_ctx_stats *stats)
+{
+	struct v4l2_m2m_dev *m2m_dev = m2m_ctx->m2m_dev;
+	unsigned long flags;
+
+	spin_lock_irqsave(&m2m_dev->job_spinlock, flags);
+	*stats = m2m_ctx->stats;
+	spin_unlock_irqrestore(&m2m_dev->job_spinlock, flags);
+}
+EXPORT_SYMBOL_GPL(v4l2_m2m_ctx_get_stats);
+
 /**
- * v4l2_m2m_try_run() - select next job to perform and run it if possible
+ * v4l2_m2m_try_run() - select next jobs to perform and run them if possible
  * @m2m_dev: per-device context
  *
  * Get next transaction (if present) from the waiting jobs list and run it.
+ * If the driver provides &v4l2_m2m_ops->device_run_batch, the next
+ * transactions of up to &v4l2_m2m_dev->max_batch instances are run at once.
  */
 static void v4l2_m2m_try_run(struct v4l2_m2m_dev *m2m_dev)
 {
+	void *priv[V4L2_M2M_MAX_BATCH];
+	struct v4l2_m2m_ctx *m2m_ctx;
+	unsigned int n = 0, batch = 1;
 	unsigned long flags;
+	u64 now, latency;
 
 	spin_lock_irqsave(&m2m_dev->job_spinlock, flags);
-	if (NULL != m2m_dev->curr_ctx) {
+	if (m2m_dev->running) {
 		spin_unlock_irqrestore(&m2m_dev->job_spinlock, flags);
 		dprintk("Another instance is running, won't run now\n");
 		return;
@@ -262,13 +294,33 @@ static void v4l2_m2m_try_run(struct v4l2_m2m_dev *m2m_dev)
 		return;
 	}
 
+	if (m2m_dev->m2m_ops->device_run_batch)
+		batch = m2m_dev->max_batch;
+
+	now = ktime_get_ns();
+	list_for_each_entry(m2m_ctx, &m2m_dev->job_queue, queue) {
+		m2m_ctx->job_flags |= TRANS_RUNNING;
+
+		latency = now - m2m_ctx->queued_ns;
+		m2m_ctx->stats.jobs++;
+		m2m_ctx->stats.total_latency_ns += latency;
+		m2m_ctx->stats.max_latency_ns =
+			max(m2m_ctx->stats.max_latency_ns, latency);
+
+		priv[n++] = m2m_ctx->priv;
+		if (n == batch)
+			break;
+	}
 	m2m_dev->curr_ctx = list_first_entry(&m2m_dev->job_queue,
 				   struct v4l2_m2m_ctx, queue);
-	m2m_dev->curr_ctx->job_flags |= TRANS_RUNNING;
+	m2m_dev->running = n;
 	spin_unlock_irqrestore(&m2m_dev->job_spinlock, flags);
 
-	dprintk("Running job on m2m_ctx: %p\n", m2m_dev->curr_ctx);
-	m2m_dev->m2m_ops->device_run(m2m_dev->curr_ctx->priv);
+	dprintk("Running %u job(s) from m2m_ctx: %p\n", n, m2m_dev->curr_ctx);
+	if (m2m_dev->m2m_ops->device_run_batch)
+		m2m_dev->m2m_ops->device_run_batch(priv, n);
+	else
+		m2m_dev->m2m_ops->device_run(priv[0]);
 }
 
 /*
@@ -284,6 +336,8 @@ static void __v4l2_m2m_try_queue(struct v4l2_m2m_dev *m2m_dev,
 				 struct v4l2_m2m_ctx *m2m_ctx)
 {
 	unsigned long flags_job, flags_out, flags_cap;
+	struct v4l2_m2m_ctx *pos;
+	u32 prio;
 
 	dprintk("Trying to schedule a job for m2m_ctx: %p\n", m2m_ctx);
 
@@ -338,8 +392,19 @@ static void __v4l2_m2m_try_queue(struct v4l2_m2m_dev *m2m_dev,
 		return;
 	}
 
-	list_add_tail(&m2m_ctx->queue, &m2m_dev->job_queue);
+	/*
+	 * Behind the running instances and the queued ones of the same or a
+	 * higher priority.
+	 */
+	prio = READ_ONCE(m2m_ctx->priority);
+	list_for_each_entry(pos, &m2m_dev->job_queue, queue) {
+		if (!(pos->job_flags & TRANS_RUNNING) &&
+		    READ_ONCE(pos->priority) < prio)
+			break;
+	}
+	list_add_tail(&m2m_ctx->queue, &pos->queue);
 	m2m_ctx->job_flags |= TRANS_QUEUED;
+	m2m_ctx->queued_ns = ktime_get_ns();
 
 	spin_unlock_irqrestore(&m2m_dev->job_spinlock, flags_job);
 }
@@ -408,16 +473,18 @@ void v4l2_m2m_job_finish(struct v4l2_m2m_dev *m2m_dev,
 	unsigned long flags;
 
 	spin_lock_irqsave(&m2m_dev->job_spinlock, flags);
-	if (!m2m_dev->curr_ctx || m2m_dev->curr_ctx != m2m_ctx) {
+	if (!(m2m_ctx->job_flags & TRANS_RUNNING)) {
 		spin_unlock_irqrestore(&m2m_dev->job_spinlock, flags);
 		dprintk("Called by an instance not currently running\n");
 		return;
 	}
 
-	list_del(&m2m_dev->curr_ctx->queue);
-	m2m_dev->curr_ctx->job_flags &= ~(TRANS_QUEUED | TRANS_RUNNING);
-	wake_up(&m2m_dev->curr_ctx->finished);
-	m2m_dev->curr_ctx = NULL;
+	list_del(&m2m_ctx->queue);
+	m2m_ctx->job_flags &= ~(TRANS_QUEUED | TRANS_RUNNING);
+	wake_up(&m2m_ctx->finished);
+	m2m_dev->running--;
+	if (m2m_dev->curr_ctx == m2m_ctx)
+		m2m_dev->curr_ctx = NULL;
 
 	spin_unlock_irqrestore(&m2m_dev->job_spinlock, flags);
 
@@ -566,6 +633,10 @@ int v4l2_m2m_streamoff(struct file *file, struct v4l2_m2m_ctx *m2m_ctx,
 	/* We should not be scheduled anymore, since we're dropping a queue. */
 	if (m2m_ctx->job_flags & TRANS_QUEUED)
 		list_del(&m2m_ctx->queue);
+	if (m2m_ctx->job_flags & TRANS_RUNNING) {
+		m2m_dev->running--;
+		wake_up(&m2m_ctx->finished);
+	}
 	m2m_ctx->job_flags = 0;
 
 	spin_lock_irqsave(&q_ctx->rdy_spinlock, flags);
@@ -575,10 +646,8 @@ int v4l2_m2m_streamoff(struct file *file, struct v4l2_m2m_ctx *m2m_ctx,
 	q_ctx->num_rdy = 0;
 	spin_unlock_irqrestore(&q_ctx->rdy_spinlock, flags);
 
-	if (m2m_dev->curr_ctx == m2m_ctx) {
+	if (m2m_dev->curr_ctx == m2m_ctx)
 		m2m_dev->curr_ctx = NULL;
-		wake_up(&m2m_ctx->finished);
-	}
 	spin_unlock_irqrestore(&m2m_dev->job_spinlock, flags_job);
 
 	return 0;
@@ -852,7 +921,8 @@ struct v4l2_m2m_dev *v4l2_m2m_init(const struct v4l2_m2m_ops *m2m_ops)
 {
 	struct v4l2_m2m_dev *m2m_dev;
 
-	if (!m2m_ops || WARN_ON(!m2m_ops->device_run))
+	if (!m2m_ops ||
+	    WARN_ON(!m2m_ops->device_run && !m2m_ops->device_run_batch))
 		return ERR_PTR(-EINVAL);
 
 	m2m_dev = kzalloc(sizeof *m2m_dev, GFP_KERNEL);
@@ -861,6 +931,7 @@ struct v4l2_m2m_dev *v4l2_m2m_init(const struct v4l2_m2m_ops *m2m_ops)
 
 	m2m_dev->curr_ctx = NULL;
 	m2m_dev->m2m_ops = m2m_ops;
+	m2m_dev->max_batch = V4L2_M2M_MAX_BATCH;
 	INIT_LIST_HEAD(&m2m_dev->job_queue);
 	spin_lock_init(&m2m_dev->job_spinlock);
 
@@ -868,6 +939,18 @@ struct v4l2_m2m_dev *v4l2_m2m_init(const struct v4l2_m2m_ops *m2m_ops)
 }
 EXPORT_SYMBOL_GPL(v4l2_m2m_init);
 
+void v4l2_m2m_set_max_batch(struct v4l2_m2m_dev *m2m_dev,
+			    unsigned int max_batch)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&m2m_dev->job_spinlock, flags);
+	m2m_dev->max_batch = clamp_t(unsigned int, max_batch, 1,
+				     V4L2_M2M_MAX_BATCH);
+	spin_unlock_irqrestore(&m2m_dev->job_spinlock, flags);
+}
+EXPORT_SYMBOL_GPL(v4l2_m2m_set_max_batch);
+
 void v4l2_m2m_release(struct v4l2_m2m_dev *m2m_dev)
 {
 	kfree(m2m_dev);
@@ -888,6 +971,7 @@ struct v4l2_m2m_ctx *v4l2_m2m_ctx_init(struct v4l2_m2m_dev *m2m_dev,
 
 	m2m_ctx->priv = drv_priv;
 	m2m_ctx->m2m_dev = m2m_dev;
+	m2m_ctx->priority = V4L2_PRIORITY_DEFAULT;
 	init_waitqueue_head(&m2m_ctx->finished);
 
 	out_q_ctx = &m2m_ctx->out_q_ctx;
@@ -924,6 +1008,12 @@ void v4l2_m2m_ctx_release(struct v4l2_m2m_ctx *m2m_ctx)
 	/* wait until the current context is dequeued from job_queue */
 	v4l2_m2m_cancel_job(m2m_ctx);
 
+	dprintk("m2m_ctx %p: %llu jobs, queueing latency avg %llu max %llu ns\n",
+		m2m_ctx, m2m_ctx->stats.jobs,
+		m2m_ctx->stats.jobs ? div64_u64(m2m_ctx->stats.total_latency_ns,
+						m2m_ctx->stats.jobs) : 0,
+		m2m_ctx->stats.max_latency_ns);
+
 	vb2_queue_release(&m2m_ctx->cap_q_ctx.q);
 	vb2_queue_release(&m2m_ctx->out_q_ctx.q);
 
@@ -26,12 +26,16 @@
 #include <linux/platform_device.h>
 #include <linux/ioport.h>
 #include <linux/spinlock.h>
+#include <linux/mutex.h>
 #include <linux/dma-mapping.h>
 #include <linux/mmc/host.h>
+#include <linux/mmc/card.h>
 #include <linux/mmc/mmc.h>
 #include <linux/mmc/sdio.h>
 #include <linux/mmc/slot-gpio.h>
 #include <linux/io.h>
+#include <linux/lat_hist.h>
+#include <linux/perf_hotpath.h>
 #include <linux/clk.h>
 #include <linux/clk-provider.h>
 #include <linux/regulator/consumer.h>
@@ -39,6 +43,8 @@
 #include <linux/interrupt.h>
 #include <linux/bitfield.h>
 #include <linux/pinctrl/consumer.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #define DRIVER_NAME "meson-gx-mmc"
 
@@ -66,9 +72,12 @@
 
 #define SD_EMMC_DELAY 0x4
 #define SD_EMMC_ADJUST 0x8
+#define   ADJUST_DS_DELAY_MASK GENMASK(7, 4)
+#define   ADJUST_DS_EN BIT(15)
 
 #define SD_EMMC_DELAY1 0x4
 #define SD_EMMC_DELAY2 0x8
+#define   DELAY2_V3_DS_DELAY_MASK GENMASK(29, 24)
 #define SD_EMMC_V3_ADJUST 0xc
 
 #define SD_EMMC_CALOUT 0x10
@@ -130,17 +139,38 @@
 #define SD_EMMC_CMD_TIMEOUT 1024 /* in ms */
 #define SD_EMMC_CMD_TIMEOUT_DATA 4096 /* in ms */
 #define SD_EMMC_CFG_CMD_GAP 16 /* in clock cycles */
-#define SD_EMMC_DESC_BUF_LEN PAGE_SIZE
+#define SD_EMMC_DESC_BUF_LEN SZ_16K /* per chain */
 
 #define SD_EMMC_PRE_REQ_DONE BIT(0)
 #define SD_EMMC_DESC_CHAIN_MODE BIT(1)
+#define SD_EMMC_DESC_CHAIN_BUILT BIT(2)
+#define SD_EMMC_SELF_PRE_REQ BIT(3)
+#define SD_EMMC_DESC_CHAIN_MASK GENMASK(5, 4)
+#define SD_EMMC_DESC_CHAIN_SLAB BIT(6)
+#define SD_EMMC_DESC_CHAIN_STOP BIT(7)
+#define SD_EMMC_DESC_CHAIN_NUM 4 /* chains ready or in flight */
+#define SD_EMMC_SLAB_LEN SZ_16K /* per chain, for the unaligned segments */
 
 #define MUX_CLK_NUM_PARENTS 2
 
+#define SD_EMMC_TUNING_CACHE_NUM 4
+
 struct meson_mmc_data {
 	unsigned int tx_delay_mask;
 	unsigned int rx_delay_mask;
 	unsigned int always_on;
+	unsigned int adjust;
+	unsigned int ds_delay_reg;
+	unsigned int ds_delay_mask;
+};
+
+/* Rx phase tuning result of a card in a given timing */
+struct meson_mmc_tuning {
+	bool valid;
+	u32 cid[4];
+	unsigned char timing;
+	unsigned int point;
+	DECLARE_BITMAP(map, CLK_PHASE_POINT_NUM);
 };
 
 struct sd_emmc_desc {
@@ -150,6 +180,18 @@ struct sd_emmc_desc {
 	u32 cmd_resp;
 };
 
+#define SD_EMMC_DESC_CHAIN_LEN \
+	(SD_EMMC_DESC_BUF_LEN / sizeof(struct sd_emmc_desc))
+/*
+ * The last descriptor of each chain holds the responses of the CMD23
+ * and CMD12 issued from the chain, in its first and second words
+ */
+#define SD_EMMC_DESC_RESP (SD_EMMC_DESC_CHAIN_LEN - 1)
+#define SD_EMMC_DESC_SBC_RESP_OFFSET 0
+#define SD_EMMC_DESC_STOP_RESP_OFFSET 4
+/* Keep room for the CMD23 and CMD12 descriptors and their responses */
+#define SD_EMMC_DESC_MAX_SEGS (SD_EMMC_DESC_CHAIN_LEN - 3)
+
 struct meson_host {
 	struct	device		*dev;
 	struct	meson_mmc_data *data;
@@ -173,8 +215,26 @@ struct meson_host {
 	dma_addr_t bounce_dma_addr;
 	struct sd_emmc_desc *descs;
 	dma_addr_t descs_dma_addr;
+	unsigned long desc_chains_busy;
+	void *slabs;
+	dma_addr_t slabs_dma_addr;
+
+	atomic64_t bounce_bytes;
+	atomic64_t slab_bytes;
+
+	u32 ds_delay;
+
+	struct mutex tuning_lock;
+	struct meson_mmc_tuning tuning[SD_EMMC_TUNING_CACHE_NUM];
+	unsigned int tuning_next;
 
 	bool vqmmc_enabled;
+
+	struct lat_hist *irq_hist;
+	struct lat_hist *thread_hist;
+	struct lat_hist *req_hist;
+	u64 irq_ns;
+	u64 req_ns;
 };
 
 #define CMD_CFG_LENGTH_MASK GENMASK(8, 0)
@@ -296,24 +356,123 @@ static unsigned int meson_mmc_get_timeout_msecs(struct mmc_data *data)
 	return min(timeout, 32768U); /* max. 2^15 ms */
 }
 
+/* The CMD12 already went out from the descriptor chain */
+static bool meson_mmc_stop_in_chain(struct mmc_command *cmd)
+{
+	struct mmc_data *data = cmd->data;
+
+	return data && data->host_cookie & SD_EMMC_DESC_CHAIN_STOP &&
+	       !cmd->error && !data->error;
+}
+
 static struct mmc_command *meson_mmc_get_next_command(struct mmc_command *cmd)
 {
 	if (cmd->opcode == MMC_SET_BLOCK_COUNT && !cmd->error)
 		return cmd->mrq->cmd;
 	else if (mmc_op_multi(cmd->opcode) &&
-		 (!cmd->mrq->sbc || cmd->error || cmd->data->error))
+		 (!cmd->mrq->sbc || cmd->error || cmd->data->error) &&
+		 !meson_mmc_stop_in_chain(cmd))
 		return cmd->mrq->stop;
 	else
 		return NULL;
 }
 
+static int meson_mmc_get_desc_chain(struct meson_host *host)
+{
+	int idx;
+
+	do {
+		idx = find_first_zero_bit(&host->desc_chains_busy,
+					  SD_EMMC_DESC_CHAIN_NUM);
+		if (idx >= SD_EMMC_DESC_CHAIN_NUM)
+			return -EBUSY;
+	} while (test_and_set_bit(idx, &host->desc_chains_busy));
+
+	return idx;
+}
+
+static void meson_mmc_put_desc_chain(struct meson_host *host,
+				     struct mmc_data *data)
+{
+	clear_bit(FIELD_GET(SD_EMMC_DESC_CHAIN_MASK, data->host_cookie),
+		  &host->desc_chains_busy);
+	data->host_cookie &= ~(SD_EMMC_DESC_CHAIN_MODE |
+			       SD_EMMC_DESC_CHAIN_BUILT |
+			       SD_EMMC_DESC_CHAIN_SLAB |
+			       SD_EMMC_DESC_CHAIN_STOP |
+			       SD_EMMC_DESC_CHAIN_MASK);
+}
+
+static struct sd_emmc_desc *meson_mmc_desc_chain(struct meson_host *host,
+						 struct mmc_data *data,
+						 dma_addr_t *dma_addr)
+{
+	unsigned int idx = FIELD_GET(SD_EMMC_DESC_CHAIN_MASK,
+				     data->host_cookie);
+
+	if (dma_addr)
+		*dma_addr = host->descs_dma_addr + idx * SD_EMMC_DESC_BUF_LEN;
+
+	return host->descs + idx * SD_EMMC_DESC_CHAIN_LEN;
+}
+
+static void *meson_mmc_slab(struct meson_host *host, struct mmc_data *data,
+			    dma_addr_t *dma_addr)
+{
+	unsigned int idx = FIELD_GET(SD_EMMC_DESC_CHAIN_MASK,
+				     data->host_cookie);
+
+	if (dma_addr)
+		*dma_addr = host->slabs_dma_addr + idx * SD_EMMC_SLAB_LEN;
+
+	return host->slabs + idx * SD_EMMC_SLAB_LEN;
+}
+
+static inline bool meson_mmc_sg_unaligned(struct scatterlist *sg)
+{
+	/* check for 8 byte alignment */
+	return sg->offset & 7;
+}
+
+/*
+ * Copy the unaligned segments to or from the slab of the chain, each at
+ * an 8 bytes aligned offset in the slab
+ */
+static void meson_mmc_slab_copy(struct meson_host *host,
+				struct mmc_data *data, bool to_slab)
+{
+	void *slab = meson_mmc_slab(host, data, NULL);
+	unsigned int skip = 0, offset = 0, bytes = 0;
+	struct scatterlist *sg;
+	int i;
+
+	for_each_sg(data->sg, sg, data->sg_len, i) {
+		if (meson_mmc_sg_unaligned(sg)) {
+			if (to_slab)
+				sg_pcopy_to_buffer(data->sg, data->sg_len,
+						   slab + offset, sg->length,
+						   skip);
+			else
+				sg_pcopy_from_buffer(data->sg, data->sg_len,
+						     slab + offset, sg->length,
+						     skip);
+			offset += ALIGN(sg->length, 8);
+			bytes += sg->length;
+		}
+		skip += sg->length;
+	}
+
+	atomic64_add(bytes, &host->slab_bytes);
+}
+
 static void meson_mmc_get_transfer_mode(struct mmc_host *mmc,
 					struct mmc_request *mrq)
 {
+	struct meson_host *host = mmc_priv(mmc);
 	struct mmc_data *data = mrq->data;
 	struct scatterlist *sg;
-	int i;
-	bool use_desc_chain_mode = true;
+	unsigned int slab_len = 0;
+	int i, idx;
 
 	/*
 	 * Broken SDIO with AP6255-based WiFi on Khadas VIM Pro has been
@@ -324,16 +483,27 @@ static void meson_mmc_get_transfer_mode(struct mmc_host *mmc,
 	if (mrq->cmd->opcode == SD_IO_RW_EXTENDED)
 		return;
 
+	/*
+	 * Unaligned segments go through the slab of the chain, the others
+	 * are mapped directly. If they don't fit in the slab, use the
+	 * bounce buffer for the whole request.
+	 */
 	for_each_sg(data->sg, sg, data->sg_len, i)
-		/* check for 8 byte alignment */
-		if (sg->offset & 7) {
-			WARN_ONCE(1, "unaligned scatterlist buffer\n");
-			use_desc_chain_mode = false;
-			break;
-		}
+		if (meson_mmc_sg_unaligned(sg))
+			slab_len += ALIGN(sg->length, 8);
 
-	if (use_desc_chain_mode)
-		data->host_cookie |= SD_EMMC_DESC_CHAIN_MODE;
+	if (slab_len > SD_EMMC_SLAB_LEN)
+		return;
+
+	/* All the chains are busy, use the bounce buffer */
+	idx = meson_mmc_get_desc_chain(host);
+	if (idx < 0)
+		return;
+
+	data->host_cookie |= SD_EMMC_DESC_CHAIN_MODE;
+	data->host_cookie |= FIELD_PREP(SD_EMMC_DESC_CHAIN_MASK, idx);
+	if (slab_len)
+		data->host_cookie |= SD_EMMC_DESC_CHAIN_SLAB;
 }
 
 static inline bool meson_mmc_desc_chain_mode(const struct mmc_data *data)
@@ -347,8 +517,12 @@ static inline bool meson_mmc_bounce_buf_read(const struct mmc_data *data)
 	       !meson_mmc_desc_chain_mode(data);
 }
 
+static void meson_mmc_desc_chain_build(struct mmc_host *mmc,
+				       struct mmc_request *mrq);
+
 static void meson_mmc_pre_req(struct mmc_host *mmc, struct mmc_request *mrq)
 {
+	struct meson_host *host = mmc_priv(mmc);
 	struct mmc_data *data = mrq->data;
 
 	if (!data)
@@ -362,18 +536,51 @@ static void meson_mmc_pre_req(struct mmc_host *mmc, struct mmc_request *mrq)
 
 	data->sg_count = dma_map_sg(mmc_dev(mmc), data->sg, data->sg_len,
                                    mmc_get_dma_dir(data));
-	if (!data->sg_count)
+	if (!data->sg_count) {
 		dev_err(mmc_dev(mmc), "dma_map_sg failed");
+		meson_mmc_put_desc_chain(host, data);
+		return;
+	}
+
+	if (data->host_cookie & SD_EMMC_DESC_CHAIN_SLAB) {
+		/* Merged segments can't be matched with the CPU ones */
+		if (data->sg_count != data->sg_len) {
+			dma_unmap_sg(mmc_dev(mmc), data->sg, data->sg_len,
+				     mmc_get_dma_dir(data));
+			meson_mmc_put_desc_chain(host, data);
+			return;
+		}
+
+		if (data->flags & MMC_DATA_WRITE)
+			meson_mmc_slab_copy(host, data, true);
+	}
+
+	/*
+	 * Build the chain now, while the previous request is still in
+	 * flight, so it can be kicked as soon as the controller is idle
+	 */
+	meson_mmc_desc_chain_build(mmc, mrq);
 }
 
 static void meson_mmc_post_req(struct mmc_host *mmc, struct mmc_request *mrq,
 			       int err)
 {
+	struct meson_host *host = mmc_priv(mmc);
 	struct mmc_data *data = mrq->data;
 
-	if (data && meson_mmc_desc_chain_mode(data) && data->sg_count)
+	if (!data || !meson_mmc_desc_chain_mode(data))
+		return;
+
+	if (data->sg_count)
 		dma_unmap_sg(mmc_dev(mmc), data->sg, data->sg_len,
 			     mmc_get_dma_dir(data));
+
+	/* After the unmap, which would drop the copied cache lines */
+	if (data->host_cookie & SD_EMMC_DESC_CHAIN_SLAB &&
+	    data->flags & MMC_DATA_READ)
+		meson_mmc_slab_copy(host, data, false);
+
+	meson_mmc_put_desc_chain(host, data);
 }
 
 static bool meson_mmc_timing_is_ddr(struct mmc_ios *ios)
@@ -707,11 +914,11 @@ static int meson_mmc_find_tuning_point(unsigned long *test)
 	return offset;
 }
 
+/* Returns the tuning point, the map of the working ones is left in test */
 static int meson_mmc_clk_phase_tuning(struct mmc_host *mmc, u32 opcode,
-				      struct clk *clk)
+				      struct clk *clk, unsigned long *test)
 {
 	int point, ret;
-	DECLARE_BITMAP(test, CLK_PHASE_POINT_NUM);
 
 	dev_dbg(mmc_dev(mmc), "%s phase/delay tunning...\n",
 		__clk_get_name(clk));
@@ -733,14 +940,118 @@ static int meson_mmc_clk_phase_tuning(struct mmc_host *mmc, u32 opcode,
 	clk_set_phase(clk, point * CLK_PHASE_STEP);
 	dev_dbg(mmc_dev(mmc), "success with phase: %d\n",
 		clk_get_phase(clk));
-	return 0;
+	return point;
+}
+
+/* CID used before the card is attached to the host */
+static const u32 meson_mmc_no_cid[4];
+
+static struct meson_mmc_tuning *
+meson_mmc_tuning_lookup(struct meson_host *host, const u32 *cid,
+			unsigned char timing)
+{
+	struct meson_mmc_tuning *t;
+	int i;
+
+	for (i = 0; i < SD_EMMC_TUNING_CACHE_NUM; i++) {
+		t = &host->tuning[i];
+		if (t->valid && t->timing == timing &&
+		    !memcmp(t->cid, cid, sizeof(t->cid)))
+			return t;
+	}
+
+	/*
+	 * The initial tuning runs before the card is attached to the host,
+	 * give its result to the first card asking for the same timing. The
+	 * verification will catch a card swap.
+	 */
+	for (i = 0; i < SD_EMMC_TUNING_CACHE_NUM; i++) {
+		t = &host->tuning[i];
+		if (t->valid && t->timing == timing &&
+		    !memcmp(t->cid, meson_mmc_no_cid, sizeof(t->cid))) {
+			memcpy(t->cid, cid, sizeof(t->cid));
+			return t;
+		}
+	}
+
+	return NULL;
 }
 
 static int meson_mmc_execute_tuning(struct mmc_host *mmc, u32 opcode)
 {
 	struct meson_host *host = mmc_priv(mmc);
+	const u32 *cid = mmc->card ? mmc->card->raw_cid : meson_mmc_no_cid;
+	DECLARE_BITMAP(test, CLK_PHASE_POINT_NUM);
+	struct meson_mmc_tuning *t;
+	int point;
+
+	mutex_lock(&host->tuning_lock);
+
+	t = meson_mmc_tuning_lookup(host, cid, mmc->ios.timing);
+
+	/*
+	 * On resume, a single tuning block at the cached point is enough.
+	 * A retune is asked by the core after CRC errors, always sweep then.
+	 */
+	if (t && !mmc->doing_retune) {
+		clk_set_phase(host->rx_clk, t->point * CLK_PHASE_STEP);
+		if (!mmc_send_tuning(mmc, opcode, NULL)) {
+			mutex_unlock(&host->tuning_lock);
+			return 0;
+		}
+
+		dev_dbg(mmc_dev(mmc), "cached tuning point %u failed\n",
+			t->point);
+	}
+
+	point = meson_mmc_clk_phase_tuning(mmc, opcode, host->rx_clk, test);
+	if (point >= 0) {
+		if (!t) {
+			t = &host->tuning[host->tuning_next];
+			host->tuning_next = (host->tuning_next + 1) %
+					    SD_EMMC_TUNING_CACHE_NUM;
+		}
+
+		t->valid = true;
+		memcpy(t->cid, cid, sizeof(t->cid));
+		t->timing = mmc->ios.timing;
+		t->point = point;
+		bitmap_copy(t->map, test, CLK_PHASE_POINT_NUM);
+	} else if (t) {
+		t->valid = false;
+	}
+
+	mutex_unlock(&host->tuning_lock);
+
+	return point < 0 ? point : 0;
+}
+
+/*
+ * In HS400 the read data, and the responses with enhanced strobe, are
+ * sampled on the card data strobe. Its delay compensates the board
+ * routing and comes from the DT.
+ */
+static void meson_mmc_set_ds(struct meson_host *host, struct mmc_ios *ios)
+{
+	u32 val;
+
+	val = readl(host->regs + host->data->ds_delay_reg);
+	val &= ~host->data->ds_delay_mask;
+	val |= (host->ds_delay << __ffs(host->data->ds_delay_mask)) &
+	       host->data->ds_delay_mask;
+	writel(val, host->regs + host->data->ds_delay_reg);
+
+	val = readl(host->regs + host->data->adjust);
+	val &= ~ADJUST_DS_EN;
+	if (ios->timing == MMC_TIMING_MMC_HS400)
+		val |= ADJUST_DS_EN;
+	writel(val, host->regs + host->data->adjust);
+}
 
-	return meson_mmc_clk_phase_tuning(mmc, opcode, host->rx_clk);
+static void meson_mmc_hs400_enhanced_strobe(struct mmc_host *mmc,
+					    struct mmc_ios *ios)
+{
+	meson_mmc_set_ds(mmc_priv(mmc), ios);
 }
 
 static void meson_mmc_set_ios(struct mmc_host *mmc, struct mmc_ios *ios)
@@ -823,6 +1134,8 @@ static void meson_mmc_set_ios(struct mmc_host *mmc, struct mmc_ios *ios)
 
 	writel(val, host->regs + SD_EMMC_CFG);
 	dev_dbg(host->dev, "SD_EMMC_CFG:  0x%08x\n", val);
+
+	meson_mmc_set_ds(host, ios);
 }
 
 static void meson_mmc_request_done(struct mmc_host *mmc,
@@ -831,6 +1144,12 @@ static void meson_mmc_request_done(struct mmc_host *mmc,
 	struct meson_host *host = mmc_priv(mmc);
 
 	host->cmd = NULL;
+
+	/* Requests not prepared by the core are cleaned up here */
+	if (mrq->data && mrq->data->host_cookie & SD_EMMC_SELF_PRE_REQ)
+		meson_mmc_post_req(mmc, mrq, 0);
+
+	lat_hist_record_since(host->req_hist, host->req_ns);
 	mmc_request_done(host->mmc, mrq);
 }
 
@@ -876,22 +1195,69 @@ static void meson_mmc_set_response_bits(struct mmc_command *cmd, u32 *cmd_cfg)
 	}
 }
 
-static void meson_mmc_desc_chain_transfer(struct mmc_host *mmc, u32 cmd_cfg)
+static u32 meson_mmc_cmd_cfg(struct mmc_command *cmd)
+{
+	struct mmc_data *data = cmd->data;
+	u32 cmd_cfg = 0;
+
+	cmd_cfg |= FIELD_PREP(CMD_CFG_CMD_INDEX_MASK, cmd->opcode);
+	cmd_cfg |= CMD_CFG_OWNER;  /* owned by CPU */
+
+	meson_mmc_set_response_bits(cmd, &cmd_cfg);
+
+	if (data) {
+		cmd_cfg |= CMD_CFG_DATA_IO;
+		cmd_cfg |= FIELD_PREP(CMD_CFG_TIMEOUT_MASK,
+				      ilog2(meson_mmc_get_timeout_msecs(data)));
+	} else {
+		cmd_cfg |= FIELD_PREP(CMD_CFG_TIMEOUT_MASK,
+				      ilog2(SD_EMMC_CMD_TIMEOUT));
+	}
+
+	return cmd_cfg;
+}
+
+/*
+ * Fill the descriptor chain of a request. When there is a CMD23, or a
+ * CMD12 for an open ended transfer, it is issued by the chain itself
+ * instead of going through an interrupt and the irq thread. The request
+ * then completes from the hard irq, and the core can start the next
+ * one, already built by pre_req(), without any extra round trip.
+ */
+static void meson_mmc_desc_chain_build(struct mmc_host *mmc,
+				       struct mmc_request *mrq)
 {
 	struct meson_host *host = mmc_priv(mmc);
-	struct sd_emmc_desc *desc = host->descs;
-	struct mmc_data *data = host->cmd->data;
+	struct mmc_command *cmd = mrq->cmd;
+	struct mmc_data *data = mrq->data;
+	struct sd_emmc_desc *desc;
 	struct scatterlist *sg;
-	u32 start;
+	dma_addr_t desc_dma, resp_dma, slab_dma;
+	unsigned int slab_offset = 0;
+	u32 cmd_cfg;
 	int i;
 
+	desc = meson_mmc_desc_chain(host, data, &desc_dma);
+	resp_dma = desc_dma + SD_EMMC_DESC_RESP * sizeof(*desc);
+	meson_mmc_slab(host, data, &slab_dma);
+
+	if (mrq->sbc) {
+		/* Without RESP_NUM, the response is written to cmd_resp */
+		desc->cmd_cfg = meson_mmc_cmd_cfg(mrq->sbc) & ~CMD_CFG_RESP_NUM;
+		desc->cmd_arg = mrq->sbc->arg;
+		desc->cmd_data = 0;
+		desc->cmd_resp = (resp_dma + SD_EMMC_DESC_SBC_RESP_OFFSET) &
+				 CMD_RESP_MASK;
+		desc++;
+	}
+
+	cmd_cfg = meson_mmc_cmd_cfg(cmd);
+
 	if (data->flags & MMC_DATA_WRITE)
 		cmd_cfg |= CMD_CFG_DATA_WR;
 
-	if (data->blocks > 1) {
+	if (data->blocks > 1)
 		cmd_cfg |= CMD_CFG_BLOCK_MODE;
-		meson_mmc_set_blksz(mmc, data->blksz);
-	}
 
 	for_each_sg(data->sg, sg, data->sg_count, i) {
 		unsigned int len = sg_dma_len(sg);
@@ -903,14 +1269,57 @@ static void meson_mmc_desc_chain_transfer(struct mmc_host *mmc, u32 cmd_cfg)
 		desc[i].cmd_cfg |= FIELD_PREP(CMD_CFG_LENGTH_MASK, len);
 		if (i > 0)
 			desc[i].cmd_cfg |= CMD_CFG_NO_CMD;
-		desc[i].cmd_arg = host->cmd->arg;
+		desc[i].cmd_arg = cmd->arg;
 		desc[i].cmd_resp = 0;
-		desc[i].cmd_data = sg_dma_address(sg);
+
+		if (data->host_cookie & SD_EMMC_DESC_CHAIN_SLAB &&
+		    meson_mmc_sg_unaligned(sg)) {
+			desc[i].cmd_data = slab_dma + slab_offset;
+			slab_offset += ALIGN(sg->length, 8);
+		} else {
+			desc[i].cmd_data = sg_dma_address(sg);
+		}
 	}
-	desc[data->sg_count - 1].cmd_cfg |= CMD_CFG_END_OF_CHAIN;
+
+	data->host_cookie &= ~SD_EMMC_DESC_CHAIN_STOP;
+
+	if (!mrq->sbc && mrq->stop && mmc_op_multi(cmd->opcode)) {
+		desc += data->sg_count;
+		desc->cmd_cfg = meson_mmc_cmd_cfg(mrq->stop) & ~CMD_CFG_RESP_NUM;
+		desc->cmd_cfg |= CMD_CFG_END_OF_CHAIN;
+		desc->cmd_arg = mrq->stop->arg;
+		desc->cmd_data = 0;
+		desc->cmd_resp = (resp_dma + SD_EMMC_DESC_STOP_RESP_OFFSET) &
+				 CMD_RESP_MASK;
+		data->host_cookie |= SD_EMMC_DESC_CHAIN_STOP;
+	} else {
+		desc[data->sg_count - 1].cmd_cfg |= CMD_CFG_END_OF_CHAIN;
+	}
+
+	data->host_cookie |= SD_EMMC_DESC_CHAIN_BUILT;
+}
+
+static void meson_mmc_desc_chain_transfer(struct mmc_host *mmc,
+					  struct mmc_command *cmd)
+{
+	struct meson_host *host = mmc_priv(mmc);
+	struct mmc_data *data = cmd->data;
+	dma_addr_t desc_dma;
+	u32 start;
+
+	if (!(data->host_cookie & SD_EMMC_DESC_CHAIN_BUILT))
+		meson_mmc_desc_chain_build(mmc, cmd->mrq);
+
+	/* A retry of the same request gets a freshly built chain */
+	data->host_cookie &= ~SD_EMMC_DESC_CHAIN_BUILT;
+
+	if (data->blocks > 1)
+		meson_mmc_set_blksz(mmc, data->blksz);
+
+	meson_mmc_desc_chain(host, data, &desc_dma);
 
 	dma_wmb(); /* ensure descriptor is written before kicked */
-	start = host->descs_dma_addr | START_DESC_BUSY;
+	start = desc_dma | START_DESC_BUSY;
 	writel(start, host->regs + SD_EMMC_START);
 }
 
@@ -918,7 +1327,7 @@ static void meson_mmc_start_cmd(struct mmc_host *mmc, struct mmc_command *cmd)
 {
 	struct meson_host *host = mmc_priv(mmc);
 	struct mmc_data *data = cmd->data;
-	u32 cmd_cfg = 0, cmd_data = 0;
+	u32 cmd_cfg, cmd_data = 0;
 	unsigned int xfer_bytes = 0;
 
 	/* Setup descriptors */
@@ -926,20 +1335,14 @@ static void meson_mmc_start_cmd(struct mmc_host *mmc, struct mmc_command *cmd)
 
 	host->cmd = cmd;
 
-	cmd_cfg |= FIELD_PREP(CMD_CFG_CMD_INDEX_MASK, cmd->opcode);
-	cmd_cfg |= CMD_CFG_OWNER;  /* owned by CPU */
-
-	meson_mmc_set_response_bits(cmd, &cmd_cfg);
+	cmd_cfg = meson_mmc_cmd_cfg(cmd);
 
 	/* data? */
 	if (data) {
 		data->bytes_xfered = 0;
-		cmd_cfg |= CMD_CFG_DATA_IO;
-		cmd_cfg |= FIELD_PREP(CMD_CFG_TIMEOUT_MASK,
-				      ilog2(meson_mmc_get_timeout_msecs(data)));
 
 		if (meson_mmc_desc_chain_mode(data)) {
-			meson_mmc_desc_chain_transfer(mmc, cmd_cfg);
+			meson_mmc_desc_chain_transfer(mmc, cmd);
 			return;
 		}
 
@@ -953,6 +1356,7 @@ static void meson_mmc_start_cmd(struct mmc_host *mmc, struct mmc_command *cmd)
 		}
 
 		xfer_bytes = data->blksz * data->blocks;
+		atomic64_add(xfer_bytes, &host->bounce_bytes);
 		if (data->flags & MMC_DATA_WRITE) {
 			cmd_cfg |= CMD_CFG_DATA_WR;
 			WARN_ON(xfer_bytes > host->bounce_buf_size);
@@ -962,9 +1366,6 @@ static void meson_mmc_start_cmd(struct mmc_host *mmc, struct mmc_command *cmd)
 		}
 
 		cmd_data = host->bounce_dma_addr & CMD_DATA_MASK;
-	} else {
-		cmd_cfg |= FIELD_PREP(CMD_CFG_TIMEOUT_MASK,
-				      ilog2(SD_EMMC_CMD_TIMEOUT));
 	}
 
 	/* Last descriptor */
@@ -979,25 +1380,24 @@ static void meson_mmc_start_cmd(struct mmc_host *mmc, struct mmc_command *cmd)
 static void meson_mmc_request(struct mmc_host *mmc, struct mmc_request *mrq)
 {
 	struct meson_host *host = mmc_priv(mmc);
-	bool needs_pre_post_req = mrq->data &&
-			!(mrq->data->host_cookie & SD_EMMC_PRE_REQ_DONE);
+	struct mmc_data *data = mrq->data;
 
-	if (needs_pre_post_req) {
-		meson_mmc_get_transfer_mode(mmc, mrq);
-		if (!meson_mmc_desc_chain_mode(mrq->data))
-			needs_pre_post_req = false;
-	}
+	host->req_ns = lat_hist_now();
 
-	if (needs_pre_post_req)
+	/* Undone by meson_mmc_request_done() */
+	if (data && !(data->host_cookie & SD_EMMC_PRE_REQ_DONE)) {
 		meson_mmc_pre_req(mmc, mrq);
+		data->host_cookie |= SD_EMMC_SELF_PRE_REQ;
+	}
 
 	/* Stop execution */
 	writel(0, host->regs + SD_EMMC_START);
 
-	meson_mmc_start_cmd(mmc, mrq->sbc ?: mrq->cmd);
-
-	if (needs_pre_post_req)
-		meson_mmc_post_req(mmc, mrq, 0);
+	/* The descriptor chain issues the CMD23 itself */
+	if (data && meson_mmc_desc_chain_mode(data))
+		meson_mmc_start_cmd(mmc, mrq->cmd);
+	else
+		meson_mmc_start_cmd(mmc, mrq->sbc ?: mrq->cmd);
 }
 
 static void meson_mmc_read_resp(struct mmc_host *mmc, struct mmc_command *cmd)
@@ -1014,6 +1414,25 @@ static void meson_mmc_read_resp(struct mmc_host *mmc, struct mmc_command *cmd)
 	}
 }
 
+/* Fetch the responses of the CMD23 and CMD12 issued from the chain */
+static void meson_mmc_read_chain_resp(struct meson_host *host,
+				      struct mmc_command *cmd)
+{
+	struct mmc_request *mrq = cmd->mrq;
+	struct sd_emmc_desc *desc = meson_mmc_desc_chain(host, mrq->data, NULL);
+	void *resp = &desc[SD_EMMC_DESC_RESP];
+
+	if (mrq->sbc)
+		mrq->sbc->resp[0] = *(u32 *)(resp +
+					     SD_EMMC_DESC_SBC_RESP_OFFSET);
+
+	if (meson_mmc_stop_in_chain(cmd))
+		mrq->stop->resp[0] = *(u32 *)(resp +
+					      SD_EMMC_DESC_STOP_RESP_OFFSET);
+}
+
+static DEFINE_PERF_HOTPATH(meson_mmc_irq_hotpath, "meson_mmc_irq");
+
 static irqreturn_t meson_mmc_irq(int irq, void *dev_id)
 {
 	struct meson_host *host = dev_id;
@@ -1021,10 +1440,13 @@ static irqreturn_t meson_mmc_irq(int irq, void *dev_id)
 	struct mmc_data *data;
 	u32 irq_en, status, raw_status;
 	irqreturn_t ret = IRQ_NONE;
+	u64 start;
 
 	if (WARN_ON(!host) || WARN_ON(!host->cmd))
 		return IRQ_NONE;
 
+	start = lat_hist_now();
+	perf_hotpath_enter(&meson_mmc_irq_hotpath);
 	spin_lock(&host->lock);
 
 	cmd = host->cmd;
@@ -1058,6 +1480,8 @@ static irqreturn_t meson_mmc_irq(int irq, void *dev_id)
 	if (status & (IRQ_END_OF_CHAIN | IRQ_RESP_STATUS)) {
 		if (data && !cmd->error)
 			data->bytes_xfered = data->blksz * data->blocks;
+		if (data && meson_mmc_desc_chain_mode(data))
+			meson_mmc_read_chain_resp(host, cmd);
 		if (meson_mmc_bounce_buf_read(data) ||
 		    meson_mmc_get_next_command(cmd))
 			ret = IRQ_WAKE_THREAD;
@@ -1077,6 +1501,9 @@ out:
 			 raw_status, irq_en);
 
 	spin_unlock(&host->lock);
+	perf_hotpath_exit(&meson_mmc_irq_hotpath);
+	lat_hist_record_since(host->irq_hist, start);
+	host->irq_ns = lat_hist_now();
 	return ret;
 }
 
@@ -1090,6 +1517,8 @@ static irqreturn_t meson_mmc_irq_thread(int irq, void *dev_id)
 	if (WARN_ON(!cmd))
 		return IRQ_NONE;
 
+	lat_hist_record_since(host->thread_hist, host->irq_ns);
+
 	data = cmd->data;
 	if (meson_mmc_bounce_buf_read(data)) {
 		xfer_bytes = data->blksz * data->blocks;
@@ -1165,6 +1594,43 @@ static int meson_mmc_voltage_switch(struct mmc_host *mmc, struct mmc_ios *ios)
 	return -EINVAL;
 }
 
+static int meson_mmc_bounce_stats_show(struct seq_file *s, void *data)
+{
+	struct meson_host *host = s->private;
+
+	seq_printf(s, "bounce_buf_bytes: %lld\n",
+		   atomic64_read(&host->bounce_bytes));
+	seq_printf(s, "slab_bytes: %lld\n", atomic64_read(&host->slab_bytes));
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(meson_mmc_bounce_stats);
+
+static int meson_mmc_tuning_show(struct seq_file *s, void *data)
+{
+	struct meson_host *host = s->private;
+	struct meson_mmc_tuning *t;
+	int i;
+
+	mutex_lock(&host->tuning_lock);
+
+	for (i = 0; i < SD_EMMC_TUNING_CACHE_NUM; i++) {
+		t = &host->tuning[i];
+		if (!t->valid)
+			continue;
+
+		seq_printf(s, "cid %08x%08x%08x%08x timing %u window %*pbl phase %u\n",
+			   t->cid[0], t->cid[1], t->cid[2], t->cid[3],
+			   t->timing, CLK_PHASE_POINT_NUM, t->map,
+			   t->point * CLK_PHASE_STEP);
+	}
+
+	mutex_unlock(&host->tuning_lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(meson_mmc_tuning);
+
 static const struct mmc_host_ops meson_mmc_ops = {
 	.request	= meson_mmc_request,
 	.set_ios	= meson_mmc_set_ios,
@@ -1174,6 +1640,7 @@ static const struct mmc_host_ops meson_mmc_ops = {
 	.execute_tuning = meson_mmc_execute_tuning,
 	.card_busy	= meson_mmc_card_busy,
 	.start_signal_voltage_switch = meson_mmc_voltage_switch,
+	.hs400_enhanced_strobe = meson_mmc_hs400_enhanced_strobe,
 };
 
 static int meson_mmc_probe(struct platform_device *pdev)
@@ -1190,8 +1657,10 @@ static int meson_mmc_probe(struct platform_device *pdev)
 	host->mmc = mmc;
 	host->dev = &pdev->dev;
 	dev_set_drvdata(&pdev->dev, host);
+	device_enable_async_suspend(&pdev->dev);
 
 	spin_lock_init(&host->lock);
+	mutex_init(&host->tuning_lock);
 
 	/* Get regulators and the supported OCR mask */
 	host->vqmmc_enabled = false;
@@ -1213,6 +1682,10 @@ static int meson_mmc_probe(struct platform_device *pdev)
 		goto free_host;
 	}
 
+	/* HS400 data strobe delay, in controller delay steps */
+	of_property_read_u32(pdev->dev.of_node, "amlogic,hs400-ds-delay",
+			     &host->ds_delay);
+
 	ret = device_reset_optional(&pdev->dev);
 	if (ret) {
 		if (ret != -EPROBE_DEFER)
@@ -1283,6 +1756,10 @@ static int meson_mmc_probe(struct platform_device *pdev)
 	writel(IRQ_CRC_ERR | IRQ_TIMEOUTS | IRQ_END_OF_CHAIN,
 	       host->regs + SD_EMMC_IRQ_EN);
 
+	host->irq_hist = devm_lat_hist_add(&pdev->dev, "irq");
+	host->thread_hist = devm_lat_hist_add(&pdev->dev, "irq_thread");
+	host->req_hist = devm_lat_hist_add(&pdev->dev, "request");
+
 	ret = devm_request_threaded_irq(&pdev->dev, irq, meson_mmc_irq,
 					meson_mmc_irq_thread, IRQF_SHARED,
 					NULL, host);
@@ -1292,7 +1769,7 @@ static int meson_mmc_probe(struct platform_device *pdev)
 	mmc->caps |= MMC_CAP_CMD23;
 	mmc->max_blk_count = CMD_CFG_LENGTH_MASK;
 	mmc->max_req_size = mmc->max_blk_count * mmc->max_blk_size;
-	mmc->max_segs = SD_EMMC_DESC_BUF_LEN / sizeof(struct sd_emmc_desc);
+	mmc->max_segs = SD_EMMC_DESC_MAX_SEGS;
 	mmc->max_seg_size = mmc->max_req_size;
 
 	/* data bounce buffer */
@@ -1306,7 +1783,8 @@ static int meson_mmc_probe(struct platform_device *pdev)
 		goto err_init_clk;
 	}
 
-	host->descs = dma_alloc_coherent(host->dev, SD_EMMC_DESC_BUF_LEN,
+	host->descs = dma_alloc_coherent(host->dev,
+		      SD_EMMC_DESC_BUF_LEN * SD_EMMC_DESC_CHAIN_NUM,
 		      &host->descs_dma_addr, GFP_KERNEL);
 	if (!host->descs) {
 		dev_err(host->dev, "Allocating descriptor DMA buffer failed\n");
@@ -1314,11 +1792,31 @@ static int meson_mmc_probe(struct platform_device *pdev)
 		goto err_bounce_buf;
 	}
 
+	host->slabs = dma_alloc_coherent(host->dev,
+			      SD_EMMC_SLAB_LEN * SD_EMMC_DESC_CHAIN_NUM,
+			      &host->slabs_dma_addr, GFP_KERNEL);
+	if (!host->slabs) {
+		dev_err(host->dev, "Allocating slab DMA buffer failed\n");
+		ret = -ENOMEM;
+		goto err_descs;
+	}
+
 	mmc->ops = &meson_mmc_ops;
 	mmc_add_host(mmc);
 
+	debugfs_create_file("bounce_stats", 0444, mmc->debugfs_root, host,
+			    &meson_mmc_bounce_stats_fops);
+	debugfs_create_file("tuning", 0444, mmc->debugfs_root, host,
+			    &meson_mmc_tuning_fops);
+
+	perf_hotpath_register(&meson_mmc_irq_hotpath);
+
 	return 0;
 
+err_descs:
+	dma_free_coherent(host->dev,
+			  SD_EMMC_DESC_BUF_LEN * SD_EMMC_DESC_CHAIN_NUM,
+			  host->descs, host->descs_dma_addr);
 err_bounce_buf:
 	dma_free_coherent(host->dev, host->bounce_buf_size,
 			  host->bounce_buf, host->bounce_dma_addr);
@@ -1335,12 +1833,17 @@ static int meson_mmc_remove(struct platform_device *pdev)
 {
 	struct meson_host *host = dev_get_drvdata(&pdev->dev);
 
+	perf_hotpath_unregister(&meson_mmc_irq_hotpath);
 	mmc_remove_host(host->mmc);
 
 	/* disable interrupts */
 	writel(0, host->regs + SD_EMMC_IRQ_EN);
 
-	dma_free_coherent(host->dev, SD_EMMC_DESC_BUF_LEN,
+	dma_free_coherent(host->dev,
+			  SD_EMMC_SLAB_LEN * SD_EMMC_DESC_CHAIN_NUM,
+			  host->slabs, host->slabs_dma_addr);
+	dma_free_coherent(host->dev,
+			  SD_EMMC_DESC_BUF_LEN * SD_EMMC_DESC_CHAIN_NUM,
 			  host->descs, host->descs_dma_addr);
 	dma_free_coherent(host->dev, host->bounce_buf_size,
 			  host->bounce_buf, host->bounce_dma_addr);
@@ -1356,12 +1859,18 @@ static const struct meson_mmc_data meson_gx_data = {
 	.tx_delay_mask	= CLK_V2_TX_DELAY_MASK,
 	.rx_delay_mask	= CLK_V2_RX_DELAY_MASK,
 	.always_on	= CLK_V2_ALWAYS_ON,
+	.adjust		= SD_EMMC_ADJUST,
+	.ds_delay_reg	= SD_EMMC_ADJUST,
+	.ds_delay_mask	= ADJUST_DS_DELAY_MASK,
 };
 
 static const struct meson_mmc_data meson_axg_data = {
 	.tx_delay_mask	= CLK_V3_TX_DELAY_MASK,
 	.rx_delay_mask	= CLK_V3_RX_DELAY_MASK,
 	.always_on	= CLK_V3_ALWAYS_ON,
+	.adjust		= SD_EMMC_V3_ADJUST,
+	.ds_delay_reg	= SD_EMMC_DELAY2,
+	.ds_delay_mask	= DELAY2_V3_DS_DELAY_MASK,
 };
 
 static const struct of_device_id meson_mmc_of_match[] = {
@@ -1380,6 +1889,7 @@ static struct platform_driver meson_mmc_driver = {
 	.driver		= {
 		.name = DRIVER_NAME,
 		.of_match_table = of_match_ptr(meson_mmc_of_match),
+		.probe_type = PROBE_PREFER_ASYNCHRONOUS,
 	},
 };
 
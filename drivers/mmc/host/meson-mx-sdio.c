@@ -761,6 +761,7 @@ static struct platform_driver meson_mx_mmc_driver = {
 	.driver  = {
 		.name = "meson-mx-sdio",
 		.of_match_table = of_match_ptr(meson_mx_mmc_of_match),
+		.probe_type = PROBE_PREFER_ASYNCHRONOUS,
 	},
 };
 
@@ -85,12 +85,61 @@
 #include <linux/err.h>
 #include <linux/slab.h>
 #include <linux/crc32.h>
+#include <linux/ktime.h>
 #include <linux/math64.h>
+#include <linux/moduleparam.h>
 #include <linux/random.h>
+#include <linux/workqueue.h>
 #include "ubi.h"
 
 static int self_check_ai(struct ubi_device *ubi, struct ubi_attach_info *ai);
 
+/* Number of PEBs whose headers are read by the scan workers at a time */
+#define UBI_SCAN_BATCH	256
+
+static int scan_threads = 4;
+module_param(scan_threads, int, 0644);
+MODULE_PARM_DESC(scan_threads, "Number of workers reading the PEB headers when scanning the whole device (1 to scan sequentially)");
+
+/**
+ * struct ubi_scan_slot - UBI headers of a PEB read for scanning.
+ * @bad: return value of 'ubi_io_is_bad()'
+ * @ec_err: return value of 'ubi_io_read_ec_hdr()'
+ * @vid_err: return value of 'ubi_io_read_vid_hdr()'
+ * @ech: EC header buffer
+ * @vidb: VID header buffer
+ *
+ * The VID header is not read if the PEB is bad, or if reading the EC header
+ * failed or found an empty PEB.
+ */
+struct ubi_scan_slot {
+	int bad;
+	int ec_err;
+	int vid_err;
+	struct ubi_ec_hdr *ech;
+	struct ubi_vid_io_buf *vidb;
+};
+
+/**
+ * struct ubi_scan_worker - reads the headers of a part of a batch of PEBs.
+ * @work: the work item
+ * @ubi: UBI device description object
+ * @slots: the batch, slot @i is for PEB @start + @i
+ * @start: first PEB of the batch
+ * @count: number of PEBs in the batch
+ * @first: first slot read by this worker
+ * @step: distance between the slots read by this worker
+ */
+struct ubi_scan_worker {
+	struct work_struct work;
+	struct ubi_device *ubi;
+	struct ubi_scan_slot *slots;
+	int start;
+	int count;
+	int first;
+	int step;
+};
+
 #define AV_FIND		BIT(0)
 #define AV_ADD		BIT(1)
 #define AV_FIND_OR_ADD	(AV_FIND | AV_ADD)
@@ -940,22 +989,47 @@ static bool vol_ignored(int vol_id)
 }
 
 /**
- * scan_peb - scan and process UBI headers of a PEB.
+ * read_peb_hdrs - read UBI headers of a PEB.
+ * @ubi: UBI device description object
+ * @pnum: the physical eraseblock number
+ * @s: where to store the headers and the read results
+ *
+ * This function does not touch the attaching information, so it may be run
+ * for several PEBs in parallel.
+ */
+static void read_peb_hdrs(struct ubi_device *ubi, int pnum,
+			  struct ubi_scan_slot *s)
+{
+	s->bad = ubi_io_is_bad(ubi, pnum);
+	if (s->bad)
+		return;
+
+	s->ec_err = ubi_io_read_ec_hdr(ubi, pnum, s->ech, 0);
+	if (s->ec_err < 0 || s->ec_err == UBI_IO_FF ||
+	    s->ec_err == UBI_IO_FF_BITFLIPS)
+		return;
+
+	s->vid_err = ubi_io_read_vid_hdr(ubi, pnum, s->vidb, 0);
+}
+
+/**
+ * process_peb - process UBI headers of a PEB.
  * @ubi: UBI device description object
  * @ai: attaching information
  * @pnum: the physical eraseblock number
  * @fast: true if we're scanning for a Fastmap
+ * @s: headers of the PEB, as read by 'read_peb_hdrs()'
  *
- * This function reads UBI headers of PEB @pnum, checks them, and adds
- * information about this PEB to the corresponding list or RB-tree in the
- * "attaching info" structure. Returns zero if the physical eraseblock was
- * successfully handled and a negative error code in case of failure.
+ * This function checks UBI headers of PEB @pnum, and adds information about
+ * this PEB to the corresponding list or RB-tree in the "attaching info"
+ * structure. Returns zero if the physical eraseblock was successfully handled
+ * and a negative error code in case of failure.
  */
-static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
-		    int pnum, bool fast)
+static int process_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
+		       int pnum, bool fast, struct ubi_scan_slot *s)
 {
-	struct ubi_ec_hdr *ech = ai->ech;
-	struct ubi_vid_io_buf *vidb = ai->vidb;
+	struct ubi_ec_hdr *ech = s->ech;
+	struct ubi_vid_io_buf *vidb = s->vidb;
 	struct ubi_vid_hdr *vidh = ubi_get_vid_hdr(vidb);
 	long long ec;
 	int err, bitflips = 0, vol_id = -1, ec_err = 0;
@@ -963,7 +1037,7 @@ static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
 	dbg_bld("scan PEB %d", pnum);
 
 	/* Skip bad physical eraseblocks */
-	err = ubi_io_is_bad(ubi, pnum);
+	err = s->bad;
 	if (err < 0)
 		return err;
 	else if (err) {
@@ -971,7 +1045,7 @@ static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
 		return 0;
 	}
 
-	err = ubi_io_read_ec_hdr(ubi, pnum, ech, 0);
+	err = s->ec_err;
 	if (err < 0)
 		return err;
 	switch (err) {
@@ -1054,7 +1128,7 @@ static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
 
 	/* OK, we've done with the EC header, let's look at the VID header */
 
-	err = ubi_io_read_vid_hdr(ubi, pnum, vidb, 0);
+	err = s->vid_err;
 	if (err < 0)
 		return err;
 	switch (err) {
@@ -1205,6 +1279,115 @@ adjust_mean_ec:
 	return 0;
 }
 
+/**
+ * scan_peb - scan and process UBI headers of a PEB.
+ * @ubi: UBI device description object
+ * @ai: attaching information
+ * @pnum: the physical eraseblock number
+ * @fast: true if we're scanning for a Fastmap
+ *
+ * This function reads UBI headers of PEB @pnum, checks them, and adds
+ * information about this PEB to the corresponding list or RB-tree in the
+ * "attaching info" structure. Returns zero if the physical eraseblock was
+ * successfully handled and a negative error code in case of failure.
+ */
+static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
+		    int pnum, bool fast)
+{
+	struct ubi_scan_slot s = {
+		.ech = ai->ech,
+		.vidb = ai->vidb,
+	};
+
+	read_peb_hdrs(ubi, pnum, &s);
+	return process_peb(ubi, ai, pnum, fast, &s);
+}
+
+static void scan_worker(struct work_struct *work)
+{
+	struct ubi_scan_worker *w = container_of(work, struct ubi_scan_worker,
+						 work);
+	int i;
+
+	for (i = w->first; i < w->count; i += w->step) {
+		read_peb_hdrs(w->ubi, w->start + i, &w->slots[i]);
+		cond_resched();
+	}
+}
+
+/**
+ * scan_parallel - scan PEBs reading their headers with several workers.
+ * @ubi: UBI device description object
+ * @ai: attaching information
+ * @start: start scanning at this PEB
+ * @nr: number of workers
+ *
+ * The headers of %UBI_SCAN_BATCH PEBs at a time are read by @nr workers, then
+ * processed in PEB order by the caller, so that @ai ends up the same as with
+ * 'scan_peb()' called for each PEB. This helps when the MTD driver can have
+ * several reads in flight, or spends a lot of CPU time in the reads, e.g. for
+ * software ECC. Returns zero in case of success and a negative error code in
+ * case of failure.
+ */
+static int scan_parallel(struct ubi_device *ubi, struct ubi_attach_info *ai,
+			 int start, int nr)
+{
+	struct ubi_scan_worker *workers;
+	struct ubi_scan_slot *slots;
+	int i, pnum, count, err = -ENOMEM;
+
+	workers = kcalloc(nr, sizeof(*workers), GFP_KERNEL);
+	slots = kcalloc(UBI_SCAN_BATCH, sizeof(*slots), GFP_KERNEL);
+	if (!workers || !slots)
+		goto out;
+
+	for (i = 0; i < UBI_SCAN_BATCH; i++) {
+		slots[i].ech = kzalloc(ubi->ec_hdr_alsize, GFP_KERNEL);
+		slots[i].vidb = ubi_alloc_vid_buf(ubi, GFP_KERNEL);
+		if (!slots[i].ech || !slots[i].vidb)
+			goto out;
+	}
+
+	for (i = 0; i < nr; i++) {
+		INIT_WORK(&workers[i].work, scan_worker);
+		workers[i].ubi = ubi;
+		workers[i].slots = slots;
+		workers[i].first = i;
+		workers[i].step = nr;
+	}
+
+	for (pnum = start; pnum < ubi->peb_count; pnum += count) {
+		count = min(ubi->peb_count - pnum, UBI_SCAN_BATCH);
+
+		for (i = 0; i < nr; i++) {
+			workers[i].start = pnum;
+			workers[i].count = count;
+			queue_work(system_unbound_wq, &workers[i].work);
+		}
+		for (i = 0; i < nr; i++)
+			flush_work(&workers[i].work);
+
+		for (i = 0; i < count; i++) {
+			dbg_gen("process PEB %d", pnum + i);
+			err = process_peb(ubi, ai, pnum + i, false, &slots[i]);
+			if (err < 0)
+				goto out;
+		}
+	}
+	err = 0;
+
+out:
+	if (slots) {
+		for (i = 0; i < UBI_SCAN_BATCH; i++) {
+			ubi_free_vid_buf(slots[i].vidb);
+			kfree(slots[i].ech);
+		}
+	}
+	kfree(slots);
+	kfree(workers);
+	return err;
+}
+
 /**
  * late_analysis - analyze the overall situation with PEB.
  * @ubi: UBI device description object
@@ -1386,10 +1569,11 @@ static void destroy_ai(struct ubi_attach_info *ai)
 static int scan_all(struct ubi_device *ubi, struct ubi_attach_info *ai,
 		    int start)
 {
-	int err, pnum;
+	int err, pnum, nr = clamp(scan_threads, 1, UBI_SCAN_BATCH);
 	struct rb_node *rb1, *rb2;
 	struct ubi_ainf_volume *av;
 	struct ubi_ainf_peb *aeb;
+	ktime_t t = ktime_get();
 
 	err = -ENOMEM;
 
@@ -1401,16 +1585,23 @@ static int scan_all(struct ubi_device *ubi, struct ubi_attach_info *ai,
 	if (!ai->vidb)
 		goto out_ech;
 
-	for (pnum = start; pnum < ubi->peb_count; pnum++) {
-		cond_resched();
-
-		dbg_gen("process PEB %d", pnum);
-		err = scan_peb(ubi, ai, pnum, false);
+	if (nr > 1) {
+		err = scan_parallel(ubi, ai, start, nr);
 		if (err < 0)
 			goto out_vidh;
+	} else {
+		for (pnum = start; pnum < ubi->peb_count; pnum++) {
+			cond_resched();
+
+			dbg_gen("process PEB %d", pnum);
+			err = scan_peb(ubi, ai, pnum, false);
+			if (err < 0)
+				goto out_vidh;
+		}
 	}
 
-	ubi_msg(ubi, "scanning is finished");
+	ubi_msg(ubi, "scanning is finished, %d PEBs in %lld ms using %d thread(s)",
+		ubi->peb_count - start, ktime_ms_delta(ktime_get(), t), nr);
 
 	/* Calculate mean erase counter */
 	if (ai->ec_count)
@@ -1568,6 +1759,9 @@ int ubi_attach(struct ubi_device *ubi, int force_scan)
 {
 	int err;
 	struct ubi_attach_info *ai;
+	ktime_t t0, t1, t2, t3, t4;
+
+	t0 = ktime_get();
 
 	ai = alloc_ai();
 	if (!ai)
@@ -1610,18 +1804,27 @@ int ubi_attach(struct ubi_device *ubi, int force_scan)
 	ubi->mean_ec = ai->mean_ec;
 	dbg_gen("max. sequence number:       %llu", ai->max_sqnum);
 
+	t1 = ktime_get();
 	err = ubi_read_volume_table(ubi, ai);
 	if (err)
 		goto out_ai;
 
+	t2 = ktime_get();
 	err = ubi_wl_init(ubi, ai);
 	if (err)
 		goto out_vtbl;
 
+	t3 = ktime_get();
 	err = ubi_eba_init(ubi, ai);
 	if (err)
 		goto out_wl;
 
+	t4 = ktime_get();
+	ubi_msg(ubi, "attached in %lld ms: %s %lld ms, volume table %lld ms, WL %lld ms, EBA %lld ms",
+		ktime_ms_delta(t4, t0), ubi->fm ? "fastmap" : "scan",
+		ktime_ms_delta(t1, t0), ktime_ms_delta(t2, t1),
+		ktime_ms_delta(t3, t2), ktime_ms_delta(t4, t3));
+
 #ifdef CONFIG_MTD_UBI_FASTMAP
 	if (ubi->fm && ubi_dbg_chk_fastmap(ubi)) {
 		struct ubi_attach_info *scan_ai;
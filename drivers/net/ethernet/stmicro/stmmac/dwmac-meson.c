@@ -104,6 +104,7 @@ static struct platform_driver meson6_dwmac_driver = {
 		.name           = "meson6-dwmac",
 		.pm		= &stmmac_pltfr_pm_ops,
 		.of_match_table = meson6_dwmac_match,
+		.probe_type	= PROBE_PREFER_ASYNCHRONOUS,
 	},
 };
 module_platform_driver(meson6_dwmac_driver);
@@ -318,6 +318,8 @@ static int meson8b_dwmac_probe(struct platform_device *pdev)
 	struct meson8b_dwmac *dwmac;
 	int ret;
 
+	device_enable_async_suspend(&pdev->dev);
+
 	ret = stmmac_get_platform_resources(pdev, &stmmac_res);
 	if (ret)
 		return ret;
@@ -420,6 +422,7 @@ static struct platform_driver meson8b_dwmac_driver = {
 		.name           = "meson8b-dwmac",
 		.pm		= &stmmac_pltfr_pm_ops,
 		.of_match_table = meson8b_dwmac_match,
+		.probe_type	= PROBE_PREFER_ASYNCHRONOUS,
 	},
 };
 module_platform_driver(meson8b_dwmac_driver);
@@ -29,6 +29,8 @@
 #include "common.h"
 #include <linux/ptp_clock_kernel.h>
 #include <linux/reset.h>
+#include <linux/net_dim.h>
+#include <net/xdp.h>
 
 struct stmmac_resources {
 	void __iomem *addr;
@@ -44,6 +46,30 @@ struct stmmac_tx_info {
 	unsigned len;
 	bool last_segment;
 	bool is_jumbo;
+	struct xdp_frame *xdpf;
+};
+
+/* Latency histograms have power of two buckets in microseconds: bucket 0
+ * is below 1us, bucket n counts [2^(n-1), 2^n) and the last one is open.
+ */
+#define STMMAC_LAT_BUCKETS	16
+
+/* Per-queue ring statistics, each one only written from the NAPI context
+ * or under the xmit lock of its queue.
+ */
+struct stmmac_txq_stats {
+	unsigned long low_water;
+	unsigned long ring_full;
+	unsigned long poll_exhausted;
+	unsigned long irq_poll_lat[STMMAC_LAT_BUCKETS];
+};
+
+struct stmmac_rxq_stats {
+	unsigned long refill_fail;
+	unsigned long dirty_max;
+	unsigned long poll_exhausted;
+	unsigned long irq_poll_lat[STMMAC_LAT_BUCKETS];
+	unsigned long poll_gro_lat[STMMAC_LAT_BUCKETS];
 };
 
 /* Frequently used values are kept adjacent for cache effect */
@@ -61,6 +87,16 @@ struct stmmac_tx_queue {
 	dma_addr_t dma_tx_phy;
 	u32 tx_tail_addr;
 	u32 mss;
+	/* Software TSO headers, one TSO_HEADER_SIZE slot per descriptor */
+	char *tso_hdrs;
+	dma_addr_t tso_hdrs_dma;
+	struct stmmac_txq_stats stats;
+};
+
+struct stmmac_rx_buffer {
+	struct page *page;
+	dma_addr_t addr;
+	unsigned int page_offset;
 };
 
 struct stmmac_rx_queue {
@@ -68,21 +104,37 @@ struct stmmac_rx_queue {
 	struct stmmac_priv *priv_data;
 	struct dma_extended_desc *dma_erx;
 	struct dma_desc *dma_rx ____cacheline_aligned_in_smp;
-	struct sk_buff **rx_skbuff;
-	dma_addr_t *rx_skbuff_dma;
+	struct stmmac_rx_buffer *buf_pool;
 	unsigned int cur_rx;
 	unsigned int dirty_rx;
-	u32 rx_zeroc_thresh;
 	dma_addr_t dma_rx_phy;
 	u32 rx_tail_addr;
+	struct xdp_rxq_info xdp_rxq;
+	u64 poll_ns;
+	struct stmmac_rxq_stats stats;
 };
 
 struct stmmac_channel {
-	struct napi_struct napi ____cacheline_aligned_in_smp;
+	struct napi_struct rx_napi ____cacheline_aligned_in_smp;
+	struct napi_struct tx_napi ____cacheline_aligned_in_smp;
 	struct stmmac_priv *priv_data;
+	/* Serializes the RX and TX updates of the DMA interrupt mask */
+	spinlock_t lock;
 	u32 index;
 	int has_rx;
 	int has_tx;
+	/* Adaptive interrupt moderation */
+	struct net_dim rx_dim;
+	struct net_dim tx_dim;
+	u16 rx_events;
+	u16 tx_events;
+	u32 rx_packets;
+	u32 rx_bytes;
+	u32 tx_packets;
+	u32 tx_bytes;
+	/* Interrupt timestamps, for the IRQ to poll latency */
+	u64 rx_irq_ns;
+	u64 tx_irq_ns;
 };
 
 struct stmmac_tc_entry {
@@ -120,14 +172,19 @@ struct stmmac_priv {
 	/* Frequently used values are kept adjacent for cache effect */
 	u32 tx_coal_frames;
 	u32 tx_coal_timer;
+	bool rx_dim_enabled;
+	bool tx_dim_enabled;
 
 	int tx_coalesce;
 	int hwts_tx_en;
 	bool tx_path_in_lpi_mode;
 	bool tso;
+	bool sw_tso;
 
 	unsigned int dma_buf_sz;
+	unsigned int rx_headroom;
 	unsigned int rx_copybreak;
+	struct bpf_prog *xdp_prog;
 	u32 rx_riwt;
 	int hwts_rx_en;
 
@@ -190,6 +247,7 @@ struct stmmac_priv {
 	struct dentry *dbgfs_dir;
 	struct dentry *dbgfs_rings_status;
 	struct dentry *dbgfs_dma_cap;
+	struct dentry *dbgfs_queue_stats;
 #endif
 
 	unsigned long state;
@@ -216,6 +274,8 @@ int stmmac_mdio_unregister(struct net_device *ndev);
 int stmmac_mdio_register(struct net_device *ndev);
 int stmmac_mdio_reset(struct mii_bus *mii);
 void stmmac_set_ethtool_ops(struct net_device *netdev);
+u32 stmmac_usec2riwt(u32 usec, struct stmmac_priv *priv);
+void stmmac_set_dim(struct stmmac_priv *priv, bool rx, bool tx);
 
 void stmmac_ptp_register(struct stmmac_priv *priv);
 void stmmac_ptp_unregister(struct stmmac_priv *priv);
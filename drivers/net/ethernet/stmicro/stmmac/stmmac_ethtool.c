@@ -168,6 +168,31 @@ static const struct stmmac_stats stmmac_gstrings_stats[] = {
 };
 #define STMMAC_STATS_LEN ARRAY_SIZE(stmmac_gstrings_stats)
 
+/* Per-queue ring statistics, reported as rxq<N>_<name> and txq<N>_<name> */
+struct stmmac_q_stats {
+	char stat_string[ETH_GSTRING_LEN];
+	int stat_offset;
+};
+
+#define STMMAC_RXQ_STAT(m)	\
+	{ #m, offsetof(struct stmmac_rxq_stats, m) }
+#define STMMAC_TXQ_STAT(m)	\
+	{ #m, offsetof(struct stmmac_txq_stats, m) }
+
+static const struct stmmac_q_stats stmmac_rxq_stats[] = {
+	STMMAC_RXQ_STAT(refill_fail),
+	STMMAC_RXQ_STAT(dirty_max),
+	STMMAC_RXQ_STAT(poll_exhausted),
+};
+#define STMMAC_RXQ_STATS_LEN ARRAY_SIZE(stmmac_rxq_stats)
+
+static const struct stmmac_q_stats stmmac_txq_stats[] = {
+	STMMAC_TXQ_STAT(low_water),
+	STMMAC_TXQ_STAT(ring_full),
+	STMMAC_TXQ_STAT(poll_exhausted),
+};
+#define STMMAC_TXQ_STATS_LEN ARRAY_SIZE(stmmac_txq_stats)
+
 /* HW MAC Management counters (if supported) */
 #define STMMAC_MMC_STAT(m)	\
 	{ #m, FIELD_SIZEOF(struct stmmac_counters, m),	\
@@ -518,6 +543,7 @@ static void stmmac_get_ethtool_stats(struct net_device *dev,
 	u32 tx_queues_count = priv->plat->tx_queues_to_use;
 	unsigned long count;
 	int i, j = 0, ret;
+	u32 q;
 
 	if (priv->dma_cap.asp) {
 		for (i = 0; i < STMMAC_SAFETY_FEAT_SIZE; i++) {
@@ -560,6 +586,20 @@ static void stmmac_get_ethtool_stats(struct net_device *dev,
 		data[j++] = (stmmac_gstrings_stats[i].sizeof_stat ==
 			     sizeof(u64)) ? (*(u64 *)p) : (*(u32 *)p);
 	}
+	for (q = 0; q < rx_queues_count; q++) {
+		char *p = (char *)&priv->rx_queue[q].stats;
+
+		for (i = 0; i < STMMAC_RXQ_STATS_LEN; i++)
+			data[j++] = *(unsigned long *)(p +
+					stmmac_rxq_stats[i].stat_offset);
+	}
+	for (q = 0; q < tx_queues_count; q++) {
+		char *p = (char *)&priv->tx_queue[q].stats;
+
+		for (i = 0; i < STMMAC_TXQ_STATS_LEN; i++)
+			data[j++] = *(unsigned long *)(p +
+					stmmac_txq_stats[i].stat_offset);
+	}
 }
 
 static int stmmac_get_sset_count(struct net_device *netdev, int sset)
@@ -570,6 +610,8 @@ static int stmmac_get_sset_count(struct net_device *netdev, int sset)
 	switch (sset) {
 	case ETH_SS_STATS:
 		len = STMMAC_STATS_LEN;
+		len += priv->plat->rx_queues_to_use * STMMAC_RXQ_STATS_LEN;
+		len += priv->plat->tx_queues_to_use * STMMAC_TXQ_STATS_LEN;
 
 		if (priv->dma_cap.rmon)
 			len += STMMAC_MMC_STATS_LEN;
@@ -593,6 +635,7 @@ static int stmmac_get_sset_count(struct net_device *netdev, int sset)
 static void stmmac_get_strings(struct net_device *dev, u32 stringset, u8 *data)
 {
 	int i;
+	u32 q;
 	u8 *p = data;
 	struct stmmac_priv *priv = netdev_priv(dev);
 
@@ -620,6 +663,20 @@ static void stmmac_get_strings(struct net_device *dev, u32 stringset, u8 *data)
 				ETH_GSTRING_LEN);
 			p += ETH_GSTRING_LEN;
 		}
+		for (q = 0; q < priv->plat->rx_queues_to_use; q++)
+			for (i = 0; i < STMMAC_RXQ_STATS_LEN; i++) {
+				snprintf((char *)p, ETH_GSTRING_LEN,
+					 "rxq%u_%s", q,
+					 stmmac_rxq_stats[i].stat_string);
+				p += ETH_GSTRING_LEN;
+			}
+		for (q = 0; q < priv->plat->tx_queues_to_use; q++)
+			for (i = 0; i < STMMAC_TXQ_STATS_LEN; i++) {
+				snprintf((char *)p, ETH_GSTRING_LEN,
+					 "txq%u_%s", q,
+					 stmmac_txq_stats[i].stat_string);
+				p += ETH_GSTRING_LEN;
+			}
 		break;
 	default:
 		WARN_ON(1);
@@ -713,7 +770,7 @@ static int stmmac_ethtool_op_set_eee(struct net_device *dev,
 	return phy_ethtool_set_eee(dev->phydev, edata);
 }
 
-static u32 stmmac_usec2riwt(u32 usec, struct stmmac_priv *priv)
+u32 stmmac_usec2riwt(u32 usec, struct stmmac_priv *priv)
 {
 	unsigned long clk = clk_get_rate(priv->plat->stmmac_clk);
 
@@ -744,6 +801,9 @@ static int stmmac_get_coalesce(struct net_device *dev,
 	if (priv->use_riwt)
 		ec->rx_coalesce_usecs = stmmac_riwt2usec(priv->rx_riwt, priv);
 
+	ec->use_adaptive_rx_coalesce = priv->rx_dim_enabled;
+	ec->use_adaptive_tx_coalesce = priv->tx_dim_enabled;
+
 	return 0;
 }
 
@@ -757,7 +817,6 @@ static int stmmac_set_coalesce(struct net_device *dev,
 	/* Check not supported parameters  */
 	if ((ec->rx_max_coalesced_frames) || (ec->rx_coalesce_usecs_irq) ||
 	    (ec->rx_max_coalesced_frames_irq) || (ec->tx_coalesce_usecs_irq) ||
-	    (ec->use_adaptive_rx_coalesce) || (ec->use_adaptive_tx_coalesce) ||
 	    (ec->pkt_rate_low) || (ec->rx_coalesce_usecs_low) ||
 	    (ec->rx_max_coalesced_frames_low) || (ec->tx_coalesce_usecs_high) ||
 	    (ec->tx_max_coalesced_frames_low) || (ec->pkt_rate_high) ||
@@ -792,6 +851,10 @@ static int stmmac_set_coalesce(struct net_device *dev,
 	priv->rx_riwt = rx_riwt;
 	stmmac_rx_watchdog(priv, priv->ioaddr, priv->rx_riwt, rx_cnt);
 
+	/* The above values are the starting point of the adaptive mode */
+	stmmac_set_dim(priv, ec->use_adaptive_rx_coalesce,
+		       ec->use_adaptive_tx_coalesce);
+
 	return 0;
 }
 
@@ -39,6 +39,11 @@
 #include <linux/dma-mapping.h>
 #include <linux/slab.h>
 #include <linux/prefetch.h>
+#include <linux/bpf.h>
+#include <linux/bpf_trace.h>
+#include <linux/perf_hotpath.h>
+#include <net/busy_poll.h>
+#include <net/tso.h>
 #include <linux/pinctrl/consumer.h>
 #ifdef CONFIG_DEBUG_FS
 #include <linux/debugfs.h>
@@ -72,7 +77,6 @@ module_param(phyaddr, int, 0444);
 MODULE_PARM_DESC(phyaddr, "Physical device address");
 
 #define STMMAC_TX_THRESH	(DMA_TX_SIZE / 4)
-#define STMMAC_RX_THRESH	(DMA_RX_SIZE / 4)
 
 static int flow_ctrl = FLOW_OFF;
 module_param(flow_ctrl, int, 0644);
@@ -94,6 +98,18 @@ MODULE_PARM_DESC(buf_sz, "DMA buffer size");
 
 #define	STMMAC_RX_COPYBREAK	256
 
+/* Room left in front of the received frame for the skb built around it,
+ * or for the XDP program when one is attached.
+ */
+#define STMMAC_RX_HEADROOM	(NET_SKB_PAD + NET_IP_ALIGN)
+#define STMMAC_XDP_HEADROOM	(XDP_PACKET_HEADROOM + NET_IP_ALIGN)
+
+/* XDP verdicts of a frame, as seen by stmmac_rx() */
+#define STMMAC_XDP_PASS		0
+#define STMMAC_XDP_CONSUMED	BIT(0)
+#define STMMAC_XDP_TX		BIT(1)
+#define STMMAC_XDP_REDIRECT	BIT(2)
+
 static const u32 default_msg_level = (NETIF_MSG_DRV | NETIF_MSG_PROBE |
 				      NETIF_MSG_LINK | NETIF_MSG_IFUP |
 				      NETIF_MSG_IFDOWN | NETIF_MSG_TIMER);
@@ -113,6 +129,8 @@ MODULE_PARM_DESC(chain_mode, "To use chain instead of ring mode");
 
 static irqreturn_t stmmac_interrupt(int irq, void *dev_id);
 
+static DEFINE_PERF_HOTPATH(stmmac_dma_irq_hotpath, "stmmac_dma_irq");
+
 #ifdef CONFIG_DEBUG_FS
 static int stmmac_init_fs(struct net_device *dev);
 static void stmmac_exit_fs(struct net_device *dev);
@@ -155,7 +173,14 @@ static void stmmac_disable_all_queues(struct stmmac_priv *priv)
 	for (queue = 0; queue < maxq; queue++) {
 		struct stmmac_channel *ch = &priv->channel[queue];
 
-		napi_disable(&ch->napi);
+		if (ch->has_rx) {
+			napi_disable(&ch->rx_napi);
+			cancel_work_sync(&ch->rx_dim.work);
+		}
+		if (ch->has_tx) {
+			napi_disable(&ch->tx_napi);
+			cancel_work_sync(&ch->tx_dim.work);
+		}
 	}
 }
 
@@ -173,7 +198,10 @@ static void stmmac_enable_all_queues(struct stmmac_priv *priv)
 	for (queue = 0; queue < maxq; queue++) {
 		struct stmmac_channel *ch = &priv->channel[queue];
 
-		napi_enable(&ch->napi);
+		if (ch->has_rx)
+			napi_enable(&ch->rx_napi);
+		if (ch->has_tx)
+			napi_enable(&ch->tx_napi);
 	}
 }
 
@@ -321,6 +349,19 @@ static inline u32 stmmac_rx_dirty(struct stmmac_priv *priv, u32 queue)
 	return dirty;
 }
 
+/**
+ * stmmac_lat_record - account a latency sample
+ * @hist: histogram of STMMAC_LAT_BUCKETS entries
+ * @start: start of the interval in ns
+ * @end: end of the interval in ns
+ */
+static inline void stmmac_lat_record(unsigned long *hist, u64 start, u64 end)
+{
+	u64 usec = div_u64(end - start, NSEC_PER_USEC);
+
+	hist[min_t(int, fls64(usec), STMMAC_LAT_BUCKETS - 1)]++;
+}
+
 /**
  * stmmac_hw_fix_mac_speed - callback for speed selection
  * @priv: driver private structure
@@ -1161,6 +1202,107 @@ static void stmmac_clear_descriptors(struct stmmac_priv *priv)
 		stmmac_clear_tx_descriptors(priv, queue);
 }
 
+/* The RX buffers are carved from pages that stay DMA mapped for as long as
+ * the driver owns them, and the skb is built around the received frame.
+ * When a buffer fits in a page, pages twice that size are split in two
+ * halves that are used in turn, so that a page can go back to the DMA once
+ * the stack has released the other half. This keeps recycling working
+ * with the bigger headroom XDP needs.
+ */
+static inline unsigned int stmmac_rx_truesize(struct stmmac_priv *priv)
+{
+	return SKB_DATA_ALIGN(priv->rx_headroom + priv->dma_buf_sz) +
+	       SKB_DATA_ALIGN(sizeof(struct skb_shared_info));
+}
+
+static inline bool stmmac_rx_pg_split(struct stmmac_priv *priv)
+{
+	return stmmac_rx_truesize(priv) <= PAGE_SIZE;
+}
+
+static inline unsigned int stmmac_rx_pg_order(struct stmmac_priv *priv)
+{
+	if (stmmac_rx_pg_split(priv))
+		return get_order(2 * stmmac_rx_truesize(priv));
+
+	return get_order(stmmac_rx_truesize(priv));
+}
+
+static inline unsigned int stmmac_rx_buf_len(struct stmmac_priv *priv)
+{
+	unsigned int len = PAGE_SIZE << stmmac_rx_pg_order(priv);
+
+	if (stmmac_rx_pg_split(priv))
+		return len / 2;
+
+	return len;
+}
+
+static inline dma_addr_t stmmac_rx_buf_dma(struct stmmac_priv *priv,
+					   struct stmmac_rx_buffer *buf)
+{
+	return buf->addr + buf->page_offset + priv->rx_headroom;
+}
+
+static int stmmac_rx_alloc_page(struct stmmac_priv *priv,
+				struct stmmac_rx_buffer *buf, gfp_t flags)
+{
+	unsigned int order = stmmac_rx_pg_order(priv);
+	struct page *page;
+	dma_addr_t addr;
+
+	page = __dev_alloc_pages(flags, order);
+	if (!page)
+		return -ENOMEM;
+
+	/* The buffer is synced for the device each time it is handed over */
+	addr = dma_map_page_attrs(priv->device, page, 0, PAGE_SIZE << order,
+				  DMA_FROM_DEVICE, DMA_ATTR_SKIP_CPU_SYNC);
+	if (dma_mapping_error(priv->device, addr)) {
+		__free_pages(page, order);
+		return -EINVAL;
+	}
+
+	buf->page = page;
+	buf->addr = addr;
+	buf->page_offset = 0;
+
+	return 0;
+}
+
+static void stmmac_rx_unmap_page(struct stmmac_priv *priv,
+				 struct stmmac_rx_buffer *buf)
+{
+	dma_unmap_page_attrs(priv->device, buf->addr,
+			     PAGE_SIZE << stmmac_rx_pg_order(priv),
+			     DMA_FROM_DEVICE, DMA_ATTR_SKIP_CPU_SYNC);
+	buf->page = NULL;
+}
+
+/**
+ * stmmac_rx_reuse_page - try to keep the RX page of a buffer
+ * @priv: driver private structure
+ * @buf: RX buffer whose current half has just been given to the stack
+ * Description: the page is kept, and the other half of it handed to the
+ * DMA, if the stack does not hold a reference to that other half anymore.
+ * Otherwise the reference of the driver goes to the stack and a new page
+ * will be allocated on refill.
+ */
+static void stmmac_rx_reuse_page(struct stmmac_priv *priv,
+				 struct stmmac_rx_buffer *buf)
+{
+	struct page *page = buf->page;
+
+	if (stmmac_rx_pg_split(priv) && page_ref_count(page) == 1 &&
+	    !page_is_pfmemalloc(page) && page_to_nid(page) == numa_mem_id()) {
+		page_ref_inc(page);
+		buf->page_offset ^= stmmac_rx_buf_len(priv);
+		return;
+	}
+
+	stmmac_rx_unmap_page(priv, buf);
+}
+
 /**
  * stmmac_init_rx_buffers - init the RX descriptor buffer.
  * @priv: driver private structure
@@ -1175,25 +1317,21 @@ static int stmmac_init_rx_buffers(struct stmmac_priv *priv, struct dma_desc *p,
 				  int i, gfp_t flags, u32 queue)
 {
 	struct stmmac_rx_queue *rx_q = &priv->rx_queue[queue];
-	struct sk_buff *skb;
+	struct stmmac_rx_buffer *buf = &rx_q->buf_pool[i];
+	int ret;
 
-	skb = __netdev_alloc_skb_ip_align(priv->dev, priv->dma_buf_sz, flags);
-	if (!skb) {
-		netdev_err(priv->dev,
-			   "%s: Rx init fails; skb is NULL\n", __func__);
-		return -ENOMEM;
-	}
-	rx_q->rx_skbuff[i] = skb;
-	rx_q->rx_skbuff_dma[i] = dma_map_single(priv->device, skb->data,
-						priv->dma_buf_sz,
-						DMA_FROM_DEVICE);
-	if (dma_mapping_error(priv->device, rx_q->rx_skbuff_dma[i])) {
-		netdev_err(priv->dev, "%s: DMA mapping error\n", __func__);
-		dev_kfree_skb_any(skb);
-		return -EINVAL;
+	ret = stmmac_rx_alloc_page(priv, buf, flags);
+	if (ret) {
+		netdev_err(priv->dev, "%s: Rx init fails (%d)\n", __func__,
+			   ret);
+		return ret;
 	}
 
-	stmmac_set_desc_addr(priv, p, rx_q->rx_skbuff_dma[i]);
+	dma_sync_single_range_for_device(priv->device, buf->addr,
+					 buf->page_offset + priv->rx_headroom,
+					 priv->dma_buf_sz, DMA_FROM_DEVICE);
+
+	stmmac_set_desc_addr(priv, p, stmmac_rx_buf_dma(priv, buf));
 
 	if (priv->dma_buf_sz == BUF_SIZE_16KiB)
 		stmmac_init_desc3(priv, p);
@@ -1210,13 +1348,14 @@ static int stmmac_init_rx_buffers(struct stmmac_priv *priv, struct dma_desc *p,
 static void stmmac_free_rx_buffer(struct stmmac_priv *priv, u32 queue, int i)
 {
 	struct stmmac_rx_queue *rx_q = &priv->rx_queue[queue];
+	struct stmmac_rx_buffer *buf = &rx_q->buf_pool[i];
+	struct page *page = buf->page;
 
-	if (rx_q->rx_skbuff[i]) {
-		dma_unmap_single(priv->device, rx_q->rx_skbuff_dma[i],
-				 priv->dma_buf_sz, DMA_FROM_DEVICE);
-		dev_kfree_skb_any(rx_q->rx_skbuff[i]);
+	if (page) {
+		stmmac_rx_unmap_page(priv, buf);
+		/* The stack may still hold the other half of the page */
+		put_page(page);
 	}
-	rx_q->rx_skbuff[i] = NULL;
 }
 
 /**
@@ -1248,6 +1387,12 @@ static void stmmac_free_tx_buffer(struct stmmac_priv *priv, u32 queue, int i)
 		tx_q->tx_skbuff_dma[i].buf = 0;
 		tx_q->tx_skbuff_dma[i].map_as_page = false;
 	}
+
+	if (tx_q->tx_skbuff_dma[i].xdpf) {
+		xdp_return_frame(tx_q->tx_skbuff_dma[i].xdpf);
+		tx_q->tx_skbuff_dma[i].xdpf = NULL;
+		tx_q->tx_skbuff_dma[i].buf = 0;
+	}
 }
 
 /**
@@ -1275,10 +1420,12 @@ static int init_dma_rx_desc_rings(struct net_device *dev, gfp_t flags)
 		bfsize = stmmac_set_bfsize(dev->mtu, priv->dma_buf_sz);
 
 	priv->dma_buf_sz = bfsize;
+	priv->rx_headroom = priv->xdp_prog ? STMMAC_XDP_HEADROOM :
+					     STMMAC_RX_HEADROOM;
 
 	/* RX INITIALIZATION */
 	netif_dbg(priv, probe, priv->dev,
-		  "SKB addresses:\nskb\t\tskb data\tdma data\n");
+		  "RX buffer addresses:\npage\t\tdma data\n");
 
 	for (queue = 0; queue < rx_count; queue++) {
 		struct stmmac_rx_queue *rx_q = &priv->rx_queue[queue];
@@ -1300,9 +1447,9 @@ static int init_dma_rx_desc_rings(struct net_device *dev, gfp_t flags)
 			if (ret)
 				goto err_init_rx_buffers;
 
-			netif_dbg(priv, probe, priv->dev, "[%p]\t[%p]\t[%x]\n",
-				  rx_q->rx_skbuff[i], rx_q->rx_skbuff[i]->data,
-				  (unsigned int)rx_q->rx_skbuff_dma[i]);
+			netif_dbg(priv, probe, priv->dev, "[%p]\t[%x]\n",
+				  rx_q->buf_pool[i].page,
+				  (unsigned int)rx_q->buf_pool[i].addr);
 		}
 
 		rx_q->cur_rx = 0;
@@ -1384,6 +1531,7 @@ static int init_dma_tx_desc_rings(struct net_device *dev)
 			tx_q->tx_skbuff_dma[i].map_as_page = false;
 			tx_q->tx_skbuff_dma[i].len = 0;
 			tx_q->tx_skbuff_dma[i].last_segment = false;
+			tx_q->tx_skbuff_dma[i].xdpf = NULL;
 			tx_q->tx_skbuff[i] = NULL;
 		}
 
@@ -1476,8 +1624,10 @@ static void free_dma_rx_desc_resources(struct stmmac_priv *priv)
 					  sizeof(struct dma_extended_desc),
 					  rx_q->dma_erx, rx_q->dma_rx_phy);
 
-		kfree(rx_q->rx_skbuff_dma);
-		kfree(rx_q->rx_skbuff);
+		if (xdp_rxq_info_is_reg(&rx_q->xdp_rxq))
+			xdp_rxq_info_unreg(&rx_q->xdp_rxq);
+
+		kfree(rx_q->buf_pool);
 	}
 }
 
@@ -1507,6 +1657,13 @@ static void free_dma_tx_desc_resources(struct stmmac_priv *priv)
 					  sizeof(struct dma_extended_desc),
 					  tx_q->dma_etx, tx_q->dma_tx_phy);
 
+		if (tx_q->tso_hdrs) {
+			dma_free_coherent(priv->device,
+					  DMA_TX_SIZE * TSO_HEADER_SIZE,
+					  tx_q->tso_hdrs, tx_q->tso_hdrs_dma);
+			tx_q->tso_hdrs = NULL;
+		}
+
 		kfree(tx_q->tx_skbuff_dma);
 		kfree(tx_q->tx_skbuff);
 	}
@@ -1533,18 +1690,22 @@ static int alloc_dma_rx_desc_resources(struct stmmac_priv *priv)
 		rx_q->queue_index = queue;
 		rx_q->priv_data = priv;
 
-		rx_q->rx_skbuff_dma = kmalloc_array(DMA_RX_SIZE,
-						    sizeof(dma_addr_t),
-						    GFP_KERNEL);
-		if (!rx_q->rx_skbuff_dma)
+		rx_q->buf_pool = kcalloc(DMA_RX_SIZE, sizeof(*rx_q->buf_pool),
+					 GFP_KERNEL);
+		if (!rx_q->buf_pool)
 			goto err_dma;
 
-		rx_q->rx_skbuff = kmalloc_array(DMA_RX_SIZE,
-						sizeof(struct sk_buff *),
-						GFP_KERNEL);
-		if (!rx_q->rx_skbuff)
+		ret = xdp_rxq_info_reg(&rx_q->xdp_rxq, priv->dev, queue);
+		if (ret)
 			goto err_dma;
 
+		/* The RX pages are refcounted, and released with put_page() */
+		ret = xdp_rxq_info_reg_mem_model(&rx_q->xdp_rxq,
+						 MEM_TYPE_PAGE_SHARED, NULL);
+		if (ret)
+			goto err_dma;
+		ret = -ENOMEM;
+
 		if (priv->extend_desc) {
 			rx_q->dma_erx = dma_zalloc_coherent(priv->device,
 							    DMA_RX_SIZE *
@@ -1608,6 +1769,16 @@ static int alloc_dma_tx_desc_resources(struct stmmac_priv *priv)
 		if (!tx_q->tx_skbuff)
 			goto err_dma;
 
+		if (priv->sw_tso) {
+			tx_q->tso_hdrs = dma_alloc_coherent(priv->device,
+							    DMA_TX_SIZE *
+							    TSO_HEADER_SIZE,
+							    &tx_q->tso_hdrs_dma,
+							    GFP_KERNEL);
+			if (!tx_q->tso_hdrs)
+				goto err_dma;
+		}
+
 		if (priv->extend_desc) {
 			tx_q->dma_etx = dma_zalloc_coherent(priv->device,
 							    DMA_TX_SIZE *
@@ -1914,6 +2085,11 @@ static int stmmac_tx_clean(struct stmmac_priv *priv, int budget, u32 queue)
 		tx_q->tx_skbuff_dma[entry].last_segment = false;
 		tx_q->tx_skbuff_dma[entry].is_jumbo = false;
 
+		if (tx_q->tx_skbuff_dma[entry].xdpf) {
+			xdp_return_frame(tx_q->tx_skbuff_dma[entry].xdpf);
+			tx_q->tx_skbuff_dma[entry].xdpf = NULL;
+		}
+
 		if (likely(skb != NULL)) {
 			pkts_compl++;
 			bytes_compl += skb->len;
@@ -1930,6 +2106,9 @@ static int stmmac_tx_clean(struct stmmac_priv *priv, int budget, u32 queue)
 	netdev_tx_completed_queue(netdev_get_tx_queue(priv->dev, queue),
 				  pkts_compl, bytes_compl);
 
+	priv->channel[queue].tx_packets += pkts_compl;
+	priv->channel[queue].tx_bytes += bytes_compl;
+
 	if (unlikely(netif_tx_queue_stopped(netdev_get_tx_queue(priv->dev,
 								queue))) &&
 	    stmmac_tx_avail(priv, queue) > STMMAC_TX_THRESH) {
@@ -2034,25 +2213,46 @@ static int stmmac_napi_check(struct stmmac_priv *priv, u32 chan)
 	int status = stmmac_dma_interrupt_status(priv, priv->ioaddr,
 						 &priv->xstats, chan);
 	struct stmmac_channel *ch = &priv->channel[chan];
-	bool needs_work = false;
+	unsigned long flags;
 
+	/* RX and TX have their own NAPI, each one only masks its own
+	 * interrupt so that the other direction keeps being served.
+	 */
 	if ((status & handle_rx) && ch->has_rx) {
-		needs_work = true;
+		if (napi_schedule_prep(&ch->rx_napi)) {
+			ch->rx_irq_ns = ktime_get_ns();
+			spin_lock_irqsave(&ch->lock, flags);
+			stmmac_disable_dma_irq(priv, priv->ioaddr, chan,
+					       true, false);
+			spin_unlock_irqrestore(&ch->lock, flags);
+			__napi_schedule(&ch->rx_napi);
+		} else {
+			/* A busy polling socket owns the ring: defer the
+			 * interrupts until its poll completes the NAPI, which
+			 * napi_schedule_prep() just marked as missed.
+			 */
+			spin_lock_irqsave(&ch->lock, flags);
+			stmmac_disable_dma_irq(priv, priv->ioaddr, chan,
+					       true, false);
+			spin_unlock_irqrestore(&ch->lock, flags);
+		}
 	} else {
 		status &= ~handle_rx;
 	}
 
 	if ((status & handle_tx) && ch->has_tx) {
-		needs_work = true;
+		if (napi_schedule_prep(&ch->tx_napi)) {
+			ch->tx_irq_ns = ktime_get_ns();
+			spin_lock_irqsave(&ch->lock, flags);
+			stmmac_disable_dma_irq(priv, priv->ioaddr, chan,
+					       false, true);
+			spin_unlock_irqrestore(&ch->lock, flags);
+			__napi_schedule(&ch->tx_napi);
+		}
 	} else {
 		status &= ~handle_tx;
 	}
 
-	if (needs_work && napi_schedule_prep(&ch->napi)) {
-		stmmac_disable_dma_irq(priv, priv->ioaddr, chan);
-		__napi_schedule(&ch->napi);
-	}
-
 	return status;
 }
 
@@ -2229,7 +2429,9 @@ static void stmmac_tx_timer_arm(struct stmmac_priv *priv, u32 queue)
 {
 	struct stmmac_tx_queue *tx_q = &priv->tx_queue[queue];
 
-	mod_timer(&tx_q->txtimer, STMMAC_COAL_TIMER(priv->tx_coal_timer));
+	/* Cleaning up to one period late is fine, share the wakeup if we can */
+	mod_timer_slack(&tx_q->txtimer, STMMAC_COAL_TIMER(priv->tx_coal_timer),
+			usecs_to_jiffies(priv->tx_coal_timer));
 }
 
 /**
@@ -2246,8 +2448,8 @@ static void stmmac_tx_timer(struct timer_list *t)
 
 	ch = &priv->channel[tx_q->queue_index];
 
-	if (likely(napi_schedule_prep(&ch->napi)))
-		__napi_schedule(&ch->napi);
+	if (likely(napi_schedule_prep(&ch->tx_napi)))
+		__napi_schedule(&ch->tx_napi);
 }
 
 /**
@@ -2847,6 +3049,7 @@ static netdev_tx_t stmmac_tso_xmit(struct sk_buff *skb, struct net_device *dev)
 				   "%s: Tx Ring full when queue awake\n",
 				   __func__);
 		}
+		tx_q->stats.ring_full++;
 		return NETDEV_TX_BUSY;
 	}
 
@@ -2930,6 +3133,7 @@ static netdev_tx_t stmmac_tso_xmit(struct sk_buff *skb, struct net_device *dev)
 		netif_dbg(priv, hw, priv->dev, "%s: stop transmitted packets\n",
 			  __func__);
 		netif_tx_stop_queue(netdev_get_tx_queue(priv->dev, queue));
+		tx_q->stats.low_water++;
 	}
 
 	dev->stats.tx_bytes += skb->len;
@@ -3004,6 +3208,208 @@ dma_map_err:
 	return NETDEV_TX_OK;
 }
 
+/* Largest buffer of a normal descriptor */
+#define STMMAC_SW_TSO_MAX_BUF	(BUF_SIZE_2KiB - 1)
+
+static int stmmac_sw_tso_descs(struct sk_buff *skb)
+{
+	struct skb_shared_info *shinfo = skb_shinfo(skb);
+
+	/* One header and the payload pieces per segment, plus one more
+	 * piece each time the payload crosses a fragment boundary.
+	 */
+	return shinfo->gso_segs *
+	       (1 + DIV_ROUND_UP(shinfo->gso_size, STMMAC_SW_TSO_MAX_BUF)) +
+	       shinfo->nr_frags + 1;
+}
+
+/**
+ *  stmmac_sw_tso_xmit - Tx entry point for TSO on cores without TSO engine
+ *  @skb : the socket buffer
+ *  @dev : device pointer
+ *  Description: the skb is segmented while filling the descriptors. The
+ *  headers of each segment are built in the coherent header buffer of the
+ *  queue, in the slot of the descriptor pointing to them, and the payload
+ *  is mapped in place. The COE inserts the IP and TCP checksums, and the
+ *  DMA is kicked once for the whole skb.
+ */
+static netdev_tx_t stmmac_sw_tso_xmit(struct sk_buff *skb,
+				      struct net_device *dev)
+{
+	struct stmmac_priv *priv = netdev_priv(dev);
+	int hdr_len = skb_transport_offset(skb) + tcp_hdrlen(skb);
+	u32 queue = skb_get_queue_mapping(skb);
+	unsigned int first_entry, entry, last_entry;
+	struct stmmac_tx_queue *tx_q;
+	struct dma_desc *desc, *first;
+	int total_len, first_len;
+	unsigned int ndesc = 0;
+	struct tso_t tso;
+
+	tx_q = &priv->tx_queue[queue];
+
+	if (unlikely(stmmac_tx_avail(priv, queue) < stmmac_sw_tso_descs(skb))) {
+		netif_tx_stop_queue(netdev_get_tx_queue(dev, queue));
+		tx_q->stats.ring_full++;
+		return NETDEV_TX_BUSY;
+	}
+
+	if (priv->tx_path_in_lpi_mode)
+		stmmac_disable_eee_mode(priv);
+
+	entry = tx_q->cur_tx;
+	first_entry = entry;
+	last_entry = entry;
+	WARN_ON(tx_q->tx_skbuff[first_entry]);
+
+	if (likely(priv->extend_desc))
+		first = (struct dma_desc *)(tx_q->dma_etx + entry);
+	else
+		first = tx_q->dma_tx + entry;
+	desc = first;
+
+	tso_start(skb, &tso);
+
+	total_len = skb->len - hdr_len;
+	first_len = hdr_len + min_t(int, skb_shinfo(skb)->gso_size, total_len);
+
+	while (total_len > 0) {
+		int data_left = min_t(int, skb_shinfo(skb)->gso_size,
+				      total_len);
+		char *hdr = tx_q->tso_hdrs + entry * TSO_HEADER_SIZE;
+		int seg_len = hdr_len + data_left;
+
+		total_len -= data_left;
+
+		/* MAC, IP and TCP headers of the segment */
+		tso_build_hdr(skb, hdr, &tso, data_left, total_len == 0);
+
+		if (likely(priv->extend_desc))
+			desc = (struct dma_desc *)(tx_q->dma_etx + entry);
+		else
+			desc = tx_q->dma_tx + entry;
+
+		stmmac_set_desc_addr(priv, desc, tx_q->tso_hdrs_dma +
+				     entry * TSO_HEADER_SIZE);
+
+		/* The first descriptor is given to the DMA last */
+		if (desc != first)
+			stmmac_prepare_tx_desc(priv, desc, 1, hdr_len, 1,
+					       priv->mode, 1, false, seg_len);
+
+		last_entry = entry;
+		entry = STMMAC_GET_ENTRY(entry, DMA_TX_SIZE);
+		ndesc++;
+
+		while (data_left > 0) {
+			int size = min_t(int, tso.size, data_left);
+			bool last_segment;
+			unsigned int des;
+
+			size = min_t(int, size, STMMAC_SW_TSO_MAX_BUF);
+			last_segment = (size == data_left);
+
+			if (likely(priv->extend_desc))
+				desc = (struct dma_desc *)(tx_q->dma_etx +
+							   entry);
+			else
+				desc = tx_q->dma_tx + entry;
+
+			des = dma_map_single(priv->device, tso.data, size,
+					     DMA_TO_DEVICE);
+			if (dma_mapping_error(priv->device, des))
+				goto dma_map_err;
+
+			tx_q->tx_skbuff_dma[entry].buf = des;
+			tx_q->tx_skbuff_dma[entry].map_as_page = false;
+			tx_q->tx_skbuff_dma[entry].len = size;
+			tx_q->tx_skbuff_dma[entry].last_segment = last_segment;
+
+			stmmac_set_desc_addr(priv, desc, des);
+			stmmac_prepare_tx_desc(priv, desc, 0, size, 1,
+					       priv->mode, 1, last_segment,
+					       seg_len);
+
+			data_left -= size;
+			tso_build_data(skb, &tso, size);
+
+			last_entry = entry;
+			entry = STMMAC_GET_ENTRY(entry, DMA_TX_SIZE);
+			ndesc++;
+		}
+	}
+
+	/* Only the last descriptor gets to point to the skb. */
+	tx_q->tx_skbuff[last_entry] = skb;
+	tx_q->cur_tx = entry;
+
+	if (unlikely(stmmac_tx_avail(priv, queue) <= STMMAC_TX_THRESH)) {
+		netif_dbg(priv, hw, priv->dev, "%s: stop transmitted packets\n",
+			  __func__);
+		netif_tx_stop_queue(netdev_get_tx_queue(priv->dev, queue));
+		tx_q->stats.low_water++;
+	}
+
+	dev->stats.tx_bytes += skb->len;
+
+	tx_q->tx_count_frames += ndesc;
+	if (priv->tx_coal_frames <= tx_q->tx_count_frames) {
+		stmmac_set_tx_ic(priv, desc);
+		priv->xstats.tx_set_ic_bit++;
+		tx_q->tx_count_frames = 0;
+	} else {
+		stmmac_tx_timer_arm(priv, queue);
+	}
+
+	skb_tx_timestamp(skb);
+
+	stmmac_prepare_tx_desc(priv, first, 1, hdr_len, 1, priv->mode, 1,
+			       false, first_len);
+
+	/* The own bit must be the latest setting done when prepare the
+	 * descriptor and then barrier is needed to make sure that
+	 * all is coherent before granting the DMA engine.
+	 */
+	wmb();
+
+	netdev_tx_sent_queue(netdev_get_tx_queue(dev, queue), skb->len);
+
+	stmmac_enable_dma_transmission(priv, priv->ioaddr);
+
+	tx_q->tx_tail_addr = tx_q->dma_tx_phy + (tx_q->cur_tx * sizeof(*desc));
+	stmmac_set_tx_tail_ptr(priv, priv->ioaddr, tx_q->tx_tail_addr, queue);
+
+	return NETDEV_TX_OK;
+
+dma_map_err:
+	/* Nothing was given to the DMA as long as the first descriptor
+	 * is not owned by it.
+	 */
+	for (; first_entry != entry;
+	     first_entry = STMMAC_GET_ENTRY(first_entry, DMA_TX_SIZE)) {
+		struct stmmac_tx_info *info = &tx_q->tx_skbuff_dma[first_entry];
+
+		if (likely(priv->extend_desc))
+			desc = (struct dma_desc *)(tx_q->dma_etx + first_entry);
+		else
+			desc = tx_q->dma_tx + first_entry;
+
+		if (info->buf)
+			dma_unmap_single(priv->device, info->buf, info->len,
+					 DMA_TO_DEVICE);
+		info->buf = 0;
+		info->len = 0;
+		info->last_segment = false;
+
+		stmmac_release_tx_desc(priv, desc, priv->mode);
+	}
+
+	netdev_err(priv->dev, "Tx DMA map failed\n");
+	dev_kfree_skb(skb);
+	priv->dev->stats.tx_dropped++;
+	return NETDEV_TX_OK;
+}
+
 /**
  *  stmmac_xmit - Tx entry point of the driver
  *  @skb : the socket buffer
@@ -3034,6 +3440,12 @@ static netdev_tx_t stmmac_xmit(struct sk_buff *skb, struct net_device *dev)
 			return stmmac_tso_xmit(skb, dev);
 	}
 
+	/* Segment large TCP frames in the driver for the older cores */
+	if (skb_is_gso(skb) && priv->sw_tso) {
+		if (skb_shinfo(skb)->gso_type & (SKB_GSO_TCPV4 | SKB_GSO_TCPV6))
+			return stmmac_sw_tso_xmit(skb, dev);
+	}
+
 	if (unlikely(stmmac_tx_avail(priv, queue) < nfrags + 1)) {
 		if (!netif_tx_queue_stopped(netdev_get_tx_queue(dev, queue))) {
 			netif_tx_stop_queue(netdev_get_tx_queue(priv->dev,
@@ -3043,6 +3455,7 @@ static netdev_tx_t stmmac_xmit(struct sk_buff *skb, struct net_device *dev)
 				   "%s: Tx Ring full when queue awake\n",
 				   __func__);
 		}
+		tx_q->stats.ring_full++;
 		return NETDEV_TX_BUSY;
 	}
 
@@ -3138,6 +3551,7 @@ static netdev_tx_t stmmac_xmit(struct sk_buff *skb, struct net_device *dev)
 		netif_dbg(priv, hw, priv->dev, "%s: stop transmitted packets\n",
 			  __func__);
 		netif_tx_stop_queue(netdev_get_tx_queue(priv->dev, queue));
+		tx_q->stats.low_water++;
 	}
 
 	dev->stats.tx_bytes += skb->len;
@@ -3234,20 +3648,171 @@ static void stmmac_rx_vlan(struct net_device *dev, struct sk_buff *skb)
 }
 
 
-static inline int stmmac_rx_threshold_count(struct stmmac_rx_queue *rx_q)
+static inline u32 stmmac_xdp_tx_queue(struct stmmac_priv *priv, int cpu)
 {
-	if (rx_q->rx_zeroc_thresh < STMMAC_RX_THRESH)
-		return 0;
+	return cpu % priv->plat->tx_queues_to_use;
+}
+
+/**
+ * stmmac_xdp_xmit_frame - queue an XDP frame for transmission
+ * @priv: driver private structure
+ * @queue: TX queue index
+ * @xdpf: frame to transmit
+ * Description: the TX rings are shared with the stack, so this must be
+ * called with the lock of the TX queue held. The DMA is only kicked by
+ * stmmac_xdp_flush_tx().
+ */
+static int stmmac_xdp_xmit_frame(struct stmmac_priv *priv, u32 queue,
+				 struct xdp_frame *xdpf)
+{
+	struct stmmac_tx_queue *tx_q = &priv->tx_queue[queue];
+	unsigned int entry = tx_q->cur_tx;
+	struct dma_desc *desc;
+	unsigned int des;
+
+	/* Leave room for the stack so that it never finds the ring full */
+	if (stmmac_tx_avail(priv, queue) < STMMAC_TX_THRESH)
+		return -EBUSY;
+
+	/* Frames needing more than one descriptor are not supported */
+	if (unlikely(xdpf->len >= BUF_SIZE_2KiB))
+		return -EOPNOTSUPP;
+
+	if (priv->tx_path_in_lpi_mode)
+		stmmac_disable_eee_mode(priv);
+
+	if (likely(priv->extend_desc))
+		desc = (struct dma_desc *)(tx_q->dma_etx + entry);
+	else
+		desc = tx_q->dma_tx + entry;
+
+	des = dma_map_single(priv->device, xdpf->data, xdpf->len,
+			     DMA_TO_DEVICE);
+	if (dma_mapping_error(priv->device, des))
+		return -ENOMEM;
+
+	tx_q->tx_skbuff_dma[entry].buf = des;
+	tx_q->tx_skbuff_dma[entry].map_as_page = false;
+	tx_q->tx_skbuff_dma[entry].len = xdpf->len;
+	tx_q->tx_skbuff_dma[entry].last_segment = true;
+	tx_q->tx_skbuff_dma[entry].xdpf = xdpf;
+
+	stmmac_set_desc_addr(priv, desc, des);
 
-	return 1;
+	tx_q->tx_count_frames++;
+	if (priv->tx_coal_frames <= tx_q->tx_count_frames) {
+		stmmac_set_tx_ic(priv, desc);
+		priv->xstats.tx_set_ic_bit++;
+		tx_q->tx_count_frames = 0;
+	} else {
+		stmmac_tx_timer_arm(priv, queue);
+	}
+
+	stmmac_prepare_tx_desc(priv, desc, 1, xdpf->len, 0, priv->mode, 1,
+			       true, xdpf->len);
+
+	tx_q->cur_tx = STMMAC_GET_ENTRY(entry, DMA_TX_SIZE);
+
+	priv->dev->stats.tx_bytes += xdpf->len;
+
+	return 0;
+}
+
+static void stmmac_xdp_flush_tx(struct stmmac_priv *priv, u32 queue)
+{
+	struct stmmac_tx_queue *tx_q = &priv->tx_queue[queue];
+
+	/* The own bits must be visible before the DMA is kicked */
+	wmb();
+
+	stmmac_enable_dma_transmission(priv, priv->ioaddr);
+
+	tx_q->tx_tail_addr = tx_q->dma_tx_phy +
+			     (tx_q->cur_tx * sizeof(struct dma_desc));
+	stmmac_set_tx_tail_ptr(priv, priv->ioaddr, tx_q->tx_tail_addr, queue);
+}
+
+static int stmmac_xdp_xmit_back(struct stmmac_priv *priv,
+				struct xdp_buff *xdp)
+{
+	struct xdp_frame *xdpf = convert_to_xdp_frame(xdp);
+	int cpu = smp_processor_id();
+	struct netdev_queue *nq;
+	u32 queue;
+	int ret;
+
+	if (unlikely(!xdpf))
+		return STMMAC_XDP_CONSUMED;
+
+	queue = stmmac_xdp_tx_queue(priv, cpu);
+	nq = netdev_get_tx_queue(priv->dev, queue);
+
+	__netif_tx_lock(nq, cpu);
+	/* The stack may not transmit for a while on this queue */
+	txq_trans_update(nq);
+	ret = stmmac_xdp_xmit_frame(priv, queue, xdpf);
+	__netif_tx_unlock(nq);
+
+	return ret ? STMMAC_XDP_CONSUMED : STMMAC_XDP_TX;
 }
 
 /**
- * stmmac_rx_refill - refill used skb preallocated buffers
+ * stmmac_run_xdp - run the XDP program on a received frame
+ * @priv: driver private structure
+ * @xdp: the frame, still in its RX buffer
+ * Description: returns STMMAC_XDP_PASS if the frame has to go to the stack,
+ * STMMAC_XDP_TX or STMMAC_XDP_REDIRECT if the page of the buffer now
+ * belongs to the frame, STMMAC_XDP_CONSUMED if the buffer can be reused
+ * as is.
+ */
+static int stmmac_run_xdp(struct stmmac_priv *priv, struct xdp_buff *xdp)
+{
+	struct bpf_prog *prog;
+	int res = STMMAC_XDP_PASS;
+	u32 act;
+
+	rcu_read_lock();
+
+	prog = READ_ONCE(priv->xdp_prog);
+	if (!prog)
+		goto out;
+
+	act = bpf_prog_run_xdp(prog, xdp);
+	switch (act) {
+	case XDP_PASS:
+		break;
+	case XDP_TX:
+		res = stmmac_xdp_xmit_back(priv, xdp);
+		break;
+	case XDP_REDIRECT:
+		if (xdp_do_redirect(priv->dev, xdp, prog) < 0)
+			res = STMMAC_XDP_CONSUMED;
+		else
+			res = STMMAC_XDP_REDIRECT;
+		break;
+	default:
+		bpf_warn_invalid_xdp_action(act);
+		/* fall through */
+	case XDP_ABORTED:
+		trace_xdp_exception(priv->dev, prog, act);
+		/* fall through */
+	case XDP_DROP:
+		res = STMMAC_XDP_CONSUMED;
+		break;
+	}
+
+out:
+	rcu_read_unlock();
+
+	return res;
+}
+
+/**
+ * stmmac_rx_refill - refill the used RX buffers
  * @priv: driver private structure
  * @queue: RX queue index
- * Description : this is to reallocate the skb for the reception process
- * that is based on zero-copy.
+ * Description : this is to hand the RX buffers back to the DMA, allocating
+ * a new page for the ones whose page went to the stack.
  */
 static inline void stmmac_rx_refill(struct stmmac_priv *priv, u32 queue)
 {
@@ -3255,9 +3820,11 @@ static inline void stmmac_rx_refill(struct stmmac_priv *priv, u32 queue)
 	int dirty = stmmac_rx_dirty(priv, queue);
 	unsigned int entry = rx_q->dirty_rx;
 
-	int bfsize = priv->dma_buf_sz;
+	if (dirty > rx_q->stats.dirty_max)
+		rx_q->stats.dirty_max = dirty;
 
 	while (dirty-- > 0) {
+		struct stmmac_rx_buffer *buf = &rx_q->buf_pool[entry];
 		struct dma_desc *p;
 
 		if (priv->extend_desc)
@@ -3265,40 +3832,33 @@ static inline void stmmac_rx_refill(struct stmmac_priv *priv, u32 queue)
 		else
 			p = rx_q->dma_rx + entry;
 
-		if (likely(!rx_q->rx_skbuff[entry])) {
-			struct sk_buff *skb;
-
-			skb = netdev_alloc_skb_ip_align(priv->dev, bfsize);
-			if (unlikely(!skb)) {
-				/* so for a while no zero-copy! */
-				rx_q->rx_zeroc_thresh = STMMAC_RX_THRESH;
+		if (unlikely(!buf->page)) {
+			if (stmmac_rx_alloc_page(priv, buf, GFP_ATOMIC)) {
+				rx_q->stats.refill_fail++;
 				if (unlikely(net_ratelimit()))
 					dev_err(priv->device,
-						"fail to alloc skb entry %d\n",
+						"fail to alloc page entry %d\n",
 						entry);
 				break;
 			}
 
-			rx_q->rx_skbuff[entry] = skb;
-			rx_q->rx_skbuff_dma[entry] =
-			    dma_map_single(priv->device, skb->data, bfsize,
-					   DMA_FROM_DEVICE);
-			if (dma_mapping_error(priv->device,
-					      rx_q->rx_skbuff_dma[entry])) {
-				netdev_err(priv->dev, "Rx DMA map failed\n");
-				dev_kfree_skb(skb);
-				break;
-			}
-
-			stmmac_set_desc_addr(priv, p, rx_q->rx_skbuff_dma[entry]);
-			stmmac_refill_desc3(priv, rx_q, p);
-
-			if (rx_q->rx_zeroc_thresh > 0)
-				rx_q->rx_zeroc_thresh--;
-
 			netif_dbg(priv, rx_status, priv->dev,
 				  "refill entry #%d\n", entry);
 		}
+
+		dma_sync_single_range_for_device(priv->device, buf->addr,
+						 buf->page_offset +
+						 priv->rx_headroom,
+						 priv->dma_buf_sz,
+						 DMA_FROM_DEVICE);
+
+		/* Always rewritten: the buffer may have moved to the other
+		 * half of its page, and DESC2 & DESC3 may have been
+		 * overwritten by the device with a timestamp value.
+		 */
+		stmmac_set_desc_addr(priv, p, stmmac_rx_buf_dma(priv, buf));
+		stmmac_refill_desc3(priv, rx_q, p);
+
 		dma_wmb();
 
 		stmmac_set_rx_owner(priv, p, priv->use_riwt);
@@ -3326,9 +3886,11 @@ static int stmmac_rx(struct stmmac_priv *priv, int limit, u32 queue)
 	int coe = priv->hw->rx_csum;
 	unsigned int next_entry;
 	unsigned int count = 0;
-	bool xmac;
+	int xdp_status = 0;
+	struct xdp_buff xdp;
+	bool gro = false;
 
-	xmac = priv->plat->has_gmac4 || priv->plat->has_xgmac;
+	xdp.rxq = &rx_q->xdp_rxq;
 
 	if (netif_msg_rx_status(priv)) {
 		void *rx_head;
@@ -3374,24 +3936,17 @@ static int stmmac_rx(struct stmmac_priv *priv, int limit, u32 queue)
 			stmmac_rx_extended_status(priv, &priv->dev->stats,
 					&priv->xstats, rx_q->dma_erx + entry);
 		if (unlikely(status == discard_frame)) {
+			/* The buffer is kept, stmmac_rx_refill() gives it
+			 * back to the device.
+			 */
 			priv->dev->stats.rx_errors++;
-			if (priv->hwts_rx_en && !priv->extend_desc) {
-				/* DESC2 & DESC3 will be overwritten by device
-				 * with timestamp value, hence reinitialize
-				 * them in stmmac_rx_refill() function so that
-				 * device can reuse it.
-				 */
-				dev_kfree_skb_any(rx_q->rx_skbuff[entry]);
-				rx_q->rx_skbuff[entry] = NULL;
-				dma_unmap_single(priv->device,
-						 rx_q->rx_skbuff_dma[entry],
-						 priv->dma_buf_sz,
-						 DMA_FROM_DEVICE);
-			}
 		} else {
+			struct stmmac_rx_buffer *buf = &rx_q->buf_pool[entry];
 			struct sk_buff *skb;
 			int frame_len;
 			unsigned int des;
+			void *va, *data;
+			int res;
 
 			stmmac_get_desc_addr(priv, p, &des);
 			frame_len = stmmac_get_rx_frame_len(priv, p, coe);
@@ -3426,15 +3981,52 @@ static int stmmac_rx(struct stmmac_priv *priv, int limit, u32 queue)
 					   frame_len, status);
 			}
 
-			/* The zero-copy is always used for all the sizes
-			 * in case of GMAC4 because it needs
-			 * to refill the used descriptors, always.
+			if (unlikely(!buf->page)) {
+				netdev_err(priv->dev,
+					   "%s: Inconsistent Rx chain\n",
+					   priv->dev->name);
+				priv->dev->stats.rx_dropped++;
+				break;
+			}
+
+			dma_sync_single_range_for_cpu(priv->device, buf->addr,
+						      buf->page_offset +
+						      priv->rx_headroom,
+						      frame_len,
+						      DMA_FROM_DEVICE);
+
+			va = page_address(buf->page) + buf->page_offset;
+			data = va + priv->rx_headroom;
+			prefetch(data);
+
+			xdp.data_hard_start = va;
+			xdp.data = data;
+			xdp_set_data_meta_invalid(&xdp);
+			xdp.data_end = data + frame_len;
+
+			res = stmmac_run_xdp(priv, &xdp);
+			if (res) {
+				/* The frame now owns the page of the buffer */
+				if (res & (STMMAC_XDP_TX | STMMAC_XDP_REDIRECT))
+					stmmac_rx_reuse_page(priv, buf);
+
+				xdp_status |= res;
+				priv->dev->stats.rx_packets++;
+				priv->dev->stats.rx_bytes += frame_len;
+				entry = next_entry;
+				continue;
+			}
+
+			/* The program may have moved the frame boundaries */
+			data = xdp.data;
+			frame_len = xdp.data_end - xdp.data;
+
+			/* Small frames are copied so that the buffer stays
+			 * where it is, the others are given to the stack
+			 * without any copy.
 			 */
-			if (unlikely(!xmac &&
-				     ((frame_len < priv->rx_copybreak) ||
-				     stmmac_rx_threshold_count(rx_q)))) {
-				skb = netdev_alloc_skb_ip_align(priv->dev,
-								frame_len);
+			if (unlikely(frame_len < priv->rx_copybreak)) {
+				skb = napi_alloc_skb(&ch->rx_napi, frame_len);
 				if (unlikely(!skb)) {
 					if (net_ratelimit())
 						dev_warn(priv->device,
@@ -3443,38 +4035,22 @@ static int stmmac_rx(struct stmmac_priv *priv, int limit, u32 queue)
 					break;
 				}
 
-				dma_sync_single_for_cpu(priv->device,
-							rx_q->rx_skbuff_dma
-							[entry], frame_len,
-							DMA_FROM_DEVICE);
-				skb_copy_to_linear_data(skb,
-							rx_q->
-							rx_skbuff[entry]->data,
-							frame_len);
-
+				skb_copy_to_linear_data(skb, data, frame_len);
 				skb_put(skb, frame_len);
-				dma_sync_single_for_device(priv->device,
-							   rx_q->rx_skbuff_dma
-							   [entry], frame_len,
-							   DMA_FROM_DEVICE);
 			} else {
-				skb = rx_q->rx_skbuff[entry];
+				skb = build_skb(va, stmmac_rx_buf_len(priv));
 				if (unlikely(!skb)) {
-					netdev_err(priv->dev,
-						   "%s: Inconsistent Rx chain\n",
-						   priv->dev->name);
+					if (net_ratelimit())
+						dev_warn(priv->device,
+							 "packet dropped\n");
 					priv->dev->stats.rx_dropped++;
 					break;
 				}
-				prefetch(skb->data - NET_IP_ALIGN);
-				rx_q->rx_skbuff[entry] = NULL;
-				rx_q->rx_zeroc_thresh++;
 
+				skb_reserve(skb, data - va);
 				skb_put(skb, frame_len);
-				dma_unmap_single(priv->device,
-						 rx_q->rx_skbuff_dma[entry],
-						 priv->dma_buf_sz,
-						 DMA_FROM_DEVICE);
+
+				stmmac_rx_reuse_page(priv, buf);
 			}
 
 			if (netif_msg_pktdata(priv)) {
@@ -3494,55 +4070,210 @@ static int stmmac_rx(struct stmmac_priv *priv, int limit, u32 queue)
 			else
 				skb->ip_summed = CHECKSUM_UNNECESSARY;
 
-			napi_gro_receive(&ch->napi, skb);
+			/* Lets SO_BUSY_POLL sockets find this queue's NAPI */
+			skb_mark_napi_id(skb, &ch->rx_napi);
+			napi_gro_receive(&ch->rx_napi, skb);
+			gro = true;
 
 			priv->dev->stats.rx_packets++;
 			priv->dev->stats.rx_bytes += frame_len;
+			ch->rx_bytes += frame_len;
 		}
 		entry = next_entry;
 	}
 
+	if (xdp_status & STMMAC_XDP_TX) {
+		int cpu = smp_processor_id();
+		u32 tx_queue = stmmac_xdp_tx_queue(priv, cpu);
+		struct netdev_queue *nq = netdev_get_tx_queue(priv->dev,
+							      tx_queue);
+
+		__netif_tx_lock(nq, cpu);
+		stmmac_xdp_flush_tx(priv, tx_queue);
+		__netif_tx_unlock(nq);
+	}
+
+	if (xdp_status & STMMAC_XDP_REDIRECT)
+		xdp_do_flush_map();
+
+	/* Time for the last frame of the poll to reach the stack */
+	if (gro)
+		stmmac_lat_record(rx_q->stats.poll_gro_lat, rx_q->poll_ns,
+				  ktime_get_ns());
+
 	stmmac_rx_refill(priv, queue);
 
 	priv->xstats.rx_pkt_n += count;
+	ch->rx_packets += count;
 
 	return count;
 }
 
+/* TX completion interrupts are only coalesced by frame count: the TX
+ * coalescing timer runs on jiffies and cannot follow the DIM profiles.
+ */
+static const u32 stmmac_tx_dim_frames[NET_DIM_PARAMS_NUM_PROFILES] = {
+	1, 4, 8, 16, STMMAC_TX_FRAMES,
+};
+
+static void stmmac_rx_dim_work(struct work_struct *work)
+{
+	struct net_dim *dim = container_of(work, struct net_dim, work);
+	struct stmmac_channel *ch = container_of(dim, struct stmmac_channel,
+						 rx_dim);
+	struct stmmac_priv *priv = ch->priv_data;
+	struct net_dim_cq_moder moder;
+	u32 riwt;
+
+	moder = net_dim_get_rx_moderation(dim->mode, dim->profile_ix);
+	riwt = clamp_t(u32, stmmac_usec2riwt(moder.usec, priv),
+		       MIN_DMA_RIWT, MAX_DMA_RIWT);
+
+	/* The RX watchdog is shared by all the RX channels */
+	priv->rx_riwt = riwt;
+	stmmac_rx_watchdog(priv, priv->ioaddr, riwt,
+			   priv->plat->rx_queues_to_use);
+
+	dim->state = NET_DIM_START_MEASURE;
+}
+
+static void stmmac_tx_dim_work(struct work_struct *work)
+{
+	struct net_dim *dim = container_of(work, struct net_dim, work);
+	struct stmmac_channel *ch = container_of(dim, struct stmmac_channel,
+						 tx_dim);
+	struct stmmac_priv *priv = ch->priv_data;
+
+	priv->tx_coal_frames = stmmac_tx_dim_frames[dim->profile_ix];
+
+	dim->state = NET_DIM_START_MEASURE;
+}
+
+/**
+ * stmmac_set_dim - enable or disable the adaptive interrupt moderation
+ * @priv: driver private structure
+ * @rx: adapt the RX watchdog
+ * @tx: adapt the TX coalescing frame count
+ */
+void stmmac_set_dim(struct stmmac_priv *priv, bool rx, bool tx)
+{
+	u32 maxq = max(priv->plat->rx_queues_to_use,
+		       priv->plat->tx_queues_to_use);
+	u32 queue;
+
+	for (queue = 0; queue < maxq; queue++) {
+		struct stmmac_channel *ch = &priv->channel[queue];
+
+		if (rx && !priv->rx_dim_enabled) {
+			ch->rx_dim.mode = NET_DIM_CQ_PERIOD_MODE_START_FROM_EQE;
+			ch->rx_dim.profile_ix = NET_DIM_DEF_PROFILE_EQE;
+			ch->rx_dim.state = NET_DIM_START_MEASURE;
+		}
+
+		if (tx && !priv->tx_dim_enabled) {
+			ch->tx_dim.mode = NET_DIM_CQ_PERIOD_MODE_START_FROM_EQE;
+			ch->tx_dim.profile_ix = NET_DIM_DEF_PROFILE_EQE;
+			ch->tx_dim.state = NET_DIM_START_MEASURE;
+		}
+	}
+
+	priv->rx_dim_enabled = rx;
+	priv->tx_dim_enabled = tx;
+}
+
 /**
- *  stmmac_poll - stmmac poll method (NAPI)
+ *  stmmac_napi_poll_rx - stmmac RX poll method (NAPI)
  *  @napi : pointer to the napi structure.
  *  @budget : maximum number of packets that the current CPU can receive from
  *	      all interfaces.
  *  Description :
- *  To look at the incoming frames and clear the tx resources.
+ *  To look at the incoming frames. The packet and byte counts are sampled
+ *  for the adaptive moderation when the poll completes.
  */
-static int stmmac_napi_poll(struct napi_struct *napi, int budget)
+static int stmmac_napi_poll_rx(struct napi_struct *napi, int budget)
 {
 	struct stmmac_channel *ch =
-		container_of(napi, struct stmmac_channel, napi);
+		container_of(napi, struct stmmac_channel, rx_napi);
 	struct stmmac_priv *priv = ch->priv_data;
-	int work_done = 0, work_rem = budget;
+	struct stmmac_rx_queue *rx_q = &priv->rx_queue[ch->index];
 	u32 chan = ch->index;
+	unsigned long flags;
+	int work_done;
 
 	priv->xstats.napi_poll++;
+	ch->rx_events++;
+
+	rx_q->poll_ns = ktime_get_ns();
+	if (ch->rx_irq_ns) {
+		stmmac_lat_record(rx_q->stats.irq_poll_lat, ch->rx_irq_ns,
+				  rx_q->poll_ns);
+		ch->rx_irq_ns = 0;
+	}
 
-	if (ch->has_tx) {
-		int done = stmmac_tx_clean(priv, work_rem, chan);
+	work_done = stmmac_rx(priv, budget, chan);
+	if (work_done == budget)
+		rx_q->stats.poll_exhausted++;
+	if (work_done < budget && napi_complete_done(napi, work_done)) {
+		if (priv->rx_dim_enabled) {
+			struct net_dim_sample sample;
 
-		work_done += done;
-		work_rem -= done;
+			net_dim_sample(ch->rx_events, ch->rx_packets,
+				       ch->rx_bytes, &sample);
+			net_dim(&ch->rx_dim, sample);
+		}
+
+		spin_lock_irqsave(&ch->lock, flags);
+		stmmac_enable_dma_irq(priv, priv->ioaddr, chan, true, false);
+		spin_unlock_irqrestore(&ch->lock, flags);
 	}
 
-	if (ch->has_rx) {
-		int done = stmmac_rx(priv, work_rem, chan);
+	return work_done;
+}
+
+/**
+ *  stmmac_napi_poll_tx - stmmac TX poll method (NAPI)
+ *  @napi : pointer to the napi structure.
+ *  @budget : NAPI budget, the whole ring is cleaned regardless.
+ *  Description :
+ *  To clear the tx resources.
+ */
+static int stmmac_napi_poll_tx(struct napi_struct *napi, int budget)
+{
+	struct stmmac_channel *ch =
+		container_of(napi, struct stmmac_channel, tx_napi);
+	struct stmmac_priv *priv = ch->priv_data;
+	struct stmmac_tx_queue *tx_q = &priv->tx_queue[ch->index];
+	u32 chan = ch->index;
+	unsigned long flags;
+	int work_done;
+
+	priv->xstats.napi_poll++;
+	ch->tx_events++;
 
-		work_done += done;
-		work_rem -= done;
+	if (ch->tx_irq_ns) {
+		stmmac_lat_record(tx_q->stats.irq_poll_lat, ch->tx_irq_ns,
+				  ktime_get_ns());
+		ch->tx_irq_ns = 0;
 	}
 
-	if (work_done < budget && napi_complete_done(napi, work_done))
-		stmmac_enable_dma_irq(priv, priv->ioaddr, chan);
+	work_done = stmmac_tx_clean(priv, DMA_TX_SIZE, chan);
+	if (work_done >= budget)
+		tx_q->stats.poll_exhausted++;
+	work_done = min(work_done, budget);
+
+	if (work_done < budget && napi_complete_done(napi, work_done)) {
+		if (priv->tx_dim_enabled) {
+			struct net_dim_sample sample;
+
+			net_dim_sample(ch->tx_events, ch->tx_packets,
+				       ch->tx_bytes, &sample);
+			net_dim(&ch->tx_dim, sample);
+		}
+
+		spin_lock_irqsave(&ch->lock, flags);
+		stmmac_enable_dma_irq(priv, priv->ioaddr, chan, false, true);
+		spin_unlock_irqrestore(&ch->lock, flags);
+	}
 
 	return work_done;
 }
@@ -3729,7 +4460,9 @@ static irqreturn_t stmmac_interrupt(int irq, void *dev_id)
 	}
 
 	/* To handle DMA interrupts */
+	perf_hotpath_enter(&stmmac_dma_irq_hotpath);
 	stmmac_dma_interrupt(priv);
+	perf_hotpath_exit(&stmmac_dma_irq_hotpath);
 
 	return IRQ_HANDLED;
 }
@@ -3939,6 +4672,79 @@ static const struct file_operations stmmac_rings_status_fops = {
 	.release = single_release,
 };
 
+static void stmmac_display_lat(struct seq_file *seq, const char *name,
+			       const unsigned long *hist)
+{
+	int i;
+
+	seq_printf(seq, "\t%s latency (us):\n", name);
+	for (i = 0; i < STMMAC_LAT_BUCKETS; i++) {
+		if (!hist[i])
+			continue;
+		if (!i)
+			seq_printf(seq, "\t\t      < 1: %lu\n", hist[i]);
+		else if (i == STMMAC_LAT_BUCKETS - 1)
+			seq_printf(seq, "\t\t>= %6u: %lu\n", 1U << (i - 1),
+				   hist[i]);
+		else
+			seq_printf(seq, "\t\t<  %6u: %lu\n", 1U << i,
+				   hist[i]);
+	}
+}
+
+static int stmmac_sysfs_queue_stats_read(struct seq_file *seq, void *v)
+{
+	struct net_device *dev = seq->private;
+	struct stmmac_priv *priv = netdev_priv(dev);
+	u32 rx_count = priv->plat->rx_queues_to_use;
+	u32 tx_count = priv->plat->tx_queues_to_use;
+	u32 queue;
+
+	for (queue = 0; queue < rx_count; queue++) {
+		struct stmmac_rxq_stats *st = &priv->rx_queue[queue].stats;
+
+		seq_printf(seq, "RX Queue %d:\n", queue);
+		if (dev->flags & IFF_UP)
+			seq_printf(seq, "\tdirty: %u\n",
+				   stmmac_rx_dirty(priv, queue));
+		seq_printf(seq, "\tdirty_max: %lu\n", st->dirty_max);
+		seq_printf(seq, "\trefill_fail: %lu\n", st->refill_fail);
+		seq_printf(seq, "\tpoll_exhausted: %lu\n", st->poll_exhausted);
+		stmmac_display_lat(seq, "IRQ to poll", st->irq_poll_lat);
+		stmmac_display_lat(seq, "Poll to GRO", st->poll_gro_lat);
+	}
+
+	for (queue = 0; queue < tx_count; queue++) {
+		struct stmmac_txq_stats *st = &priv->tx_queue[queue].stats;
+
+		seq_printf(seq, "TX Queue %d:\n", queue);
+		if (dev->flags & IFF_UP)
+			seq_printf(seq, "\tavail: %u\n",
+				   stmmac_tx_avail(priv, queue));
+		seq_printf(seq, "\tlow_water: %lu\n", st->low_water);
+		seq_printf(seq, "\tring_full: %lu\n", st->ring_full);
+		seq_printf(seq, "\tpoll_exhausted: %lu\n", st->poll_exhausted);
+		stmmac_display_lat(seq, "IRQ to poll", st->irq_poll_lat);
+	}
+
+	return 0;
+}
+
+static int stmmac_sysfs_queue_stats_open(struct inode *inode,
+					 struct file *file)
+{
+	return single_open(file, stmmac_sysfs_queue_stats_read,
+			   inode->i_private);
+}
+
+static const struct file_operations stmmac_queue_stats_fops = {
+	.owner = THIS_MODULE,
+	.open = stmmac_sysfs_queue_stats_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 static int stmmac_sysfs_dma_cap_read(struct seq_file *seq, void *v)
 {
 	struct net_device *dev = seq->private;
@@ -4054,6 +4860,18 @@ static int stmmac_init_fs(struct net_device *dev)
 		return -ENOMEM;
 	}
 
+	/* Entry to report the per-queue ring statistics */
+	priv->dbgfs_queue_stats =
+		debugfs_create_file("queue_stats", 0444, priv->dbgfs_dir,
+				    dev, &stmmac_queue_stats_fops);
+
+	if (!priv->dbgfs_queue_stats || IS_ERR(priv->dbgfs_queue_stats)) {
+		netdev_err(priv->dev, "ERROR creating stmmac queue debugfs file\n");
+		debugfs_remove_recursive(priv->dbgfs_dir);
+
+		return -ENOMEM;
+	}
+
 	return 0;
 }
 
@@ -4065,9 +4883,100 @@ static void stmmac_exit_fs(struct net_device *dev)
 }
 #endif /* CONFIG_DEBUG_FS */
 
+static int stmmac_xdp_setup(struct net_device *dev, struct bpf_prog *prog)
+{
+	struct stmmac_priv *priv = netdev_priv(dev);
+	bool need_reset = !priv->xdp_prog != !prog;
+	bool running = netif_running(dev);
+	struct bpf_prog *old_prog;
+
+	/* The RX buffers are laid out with or without the XDP headroom, so
+	 * the rings are rebuilt when XDP gets enabled or disabled.
+	 */
+	if (need_reset && running)
+		stmmac_release(dev);
+
+	old_prog = xchg(&priv->xdp_prog, prog);
+	if (old_prog)
+		bpf_prog_put(old_prog);
+
+	if (need_reset && running)
+		return stmmac_open(dev);
+
+	return 0;
+}
+
+static int stmmac_bpf(struct net_device *dev, struct netdev_bpf *bpf)
+{
+	struct stmmac_priv *priv = netdev_priv(dev);
+
+	switch (bpf->command) {
+	case XDP_SETUP_PROG:
+		return stmmac_xdp_setup(dev, bpf->prog);
+	case XDP_QUERY_PROG:
+		bpf->prog_id = priv->xdp_prog ? priv->xdp_prog->aux->id : 0;
+		return 0;
+	default:
+		return -EINVAL;
+	}
+}
+
+static int stmmac_xdp_xmit(struct net_device *dev, int n,
+			   struct xdp_frame **frames, u32 flags)
+{
+	struct stmmac_priv *priv = netdev_priv(dev);
+	int cpu = smp_processor_id();
+	struct netdev_queue *nq;
+	int i, drops = 0;
+	u32 queue;
+
+	if (unlikely(flags & ~XDP_XMIT_FLAGS_MASK))
+		return -EINVAL;
+
+	if (unlikely(!netif_running(dev) ||
+		     test_bit(STMMAC_DOWN, &priv->state)))
+		return -ENETDOWN;
+
+	queue = stmmac_xdp_tx_queue(priv, cpu);
+	nq = netdev_get_tx_queue(dev, queue);
+
+	__netif_tx_lock(nq, cpu);
+	txq_trans_update(nq);
+
+	for (i = 0; i < n; i++) {
+		if (stmmac_xdp_xmit_frame(priv, queue, frames[i])) {
+			xdp_return_frame_rx_napi(frames[i]);
+			drops++;
+		}
+	}
+
+	if (flags & XDP_XMIT_FLUSH)
+		stmmac_xdp_flush_tx(priv, queue);
+
+	__netif_tx_unlock(nq);
+
+	return n - drops;
+}
+
+static netdev_features_t stmmac_features_check(struct sk_buff *skb,
+					       struct net_device *dev,
+					       netdev_features_t features)
+{
+	struct stmmac_priv *priv = netdev_priv(dev);
+
+	/* The software TSO headers must fit in their slot */
+	if (priv->sw_tso && skb_is_gso(skb) &&
+	    (skb_shinfo(skb)->gso_type & (SKB_GSO_TCPV4 | SKB_GSO_TCPV6)) &&
+	    skb_transport_offset(skb) + tcp_hdrlen(skb) > TSO_HEADER_SIZE)
+		features &= ~NETIF_F_GSO_MASK;
+
+	return vlan_features_check(skb, features);
+}
+
 static const struct net_device_ops stmmac_netdev_ops = {
 	.ndo_open = stmmac_open,
 	.ndo_start_xmit = stmmac_xmit,
+	.ndo_features_check = stmmac_features_check,
 	.ndo_stop = stmmac_release,
 	.ndo_change_mtu = stmmac_change_mtu,
 	.ndo_fix_features = stmmac_fix_features,
@@ -4080,6 +4989,8 @@ static const struct net_device_ops stmmac_netdev_ops = {
 	.ndo_poll_controller = stmmac_poll_controller,
 #endif
 	.ndo_set_mac_address = stmmac_set_mac_address,
+	.ndo_bpf = stmmac_bpf,
+	.ndo_xdp_xmit = stmmac_xdp_xmit,
 };
 
 static void stmmac_reset_subtask(struct stmmac_priv *priv)
@@ -4291,6 +5202,12 @@ int stmmac_dvr_probe(struct device *device,
 		ndev->hw_features |= NETIF_F_TSO | NETIF_F_TSO6;
 		priv->tso = true;
 		dev_info(priv->device, "TSO feature enabled\n");
+	} else if (!priv->plat->has_gmac4 && !priv->plat->has_xgmac &&
+		   priv->plat->tx_coe) {
+		/* The segments rely on the COE for their checksums */
+		ndev->hw_features |= NETIF_F_TSO | NETIF_F_TSO6;
+		priv->sw_tso = true;
+		dev_info(priv->device, "Software TSO feature enabled\n");
 	}
 	ndev->features |= ndev->hw_features | NETIF_F_HIGHDMA;
 	ndev->watchdog_timeo = msecs_to_jiffies(watchdog);
@@ -4348,8 +5265,18 @@ int stmmac_dvr_probe(struct device *device,
 		if (queue < priv->plat->tx_queues_to_use)
 			ch->has_tx = true;
 
-		netif_napi_add(ndev, &ch->napi, stmmac_napi_poll,
-			       NAPI_POLL_WEIGHT);
+		spin_lock_init(&ch->lock);
+
+		if (ch->has_rx)
+			netif_napi_add(ndev, &ch->rx_napi,
+				       stmmac_napi_poll_rx, NAPI_POLL_WEIGHT);
+		if (ch->has_tx)
+			netif_tx_napi_add(ndev, &ch->tx_napi,
+					  stmmac_napi_poll_tx,
+					  NAPI_POLL_WEIGHT);
+
+		INIT_WORK(&ch->rx_dim.work, stmmac_rx_dim_work);
+		INIT_WORK(&ch->tx_dim.work, stmmac_tx_dim_work);
 	}
 
 	mutex_init(&priv->lock);
@@ -4394,6 +5321,8 @@ int stmmac_dvr_probe(struct device *device,
 			    __func__);
 #endif
 
+	perf_hotpath_register(&stmmac_dma_irq_hotpath);
+
 	return ret;
 
 error_netdev_register:
@@ -4405,7 +5334,10 @@ error_mdio_register:
 	for (queue = 0; queue < maxq; queue++) {
 		struct stmmac_channel *ch = &priv->channel[queue];
 
-		netif_napi_del(&ch->napi);
+		if (ch->has_rx)
+			netif_napi_del(&ch->rx_napi);
+		if (ch->has_tx)
+			netif_napi_del(&ch->tx_napi);
 	}
 error_hw_init:
 	destroy_workqueue(priv->wq);
@@ -4429,6 +5361,8 @@ int stmmac_dvr_remove(struct device *dev)
 
 	netdev_info(priv->dev, "%s: removing driver", __func__);
 
+	perf_hotpath_unregister(&stmmac_dma_irq_hotpath);
+
 #ifdef CONFIG_DEBUG_FS
 	stmmac_exit_fs(ndev);
 #endif
@@ -292,6 +292,7 @@ brcmf_proto_bcdc_hdrpull(struct brcmf_pub *drvr, bool do_fws,
 {
 	struct brcmf_proto_bcdc_header *h;
 	struct brcmf_if *tmp_if;
+	uint offset;
 
 	brcmf_dbg(BCDC, "Enter\n");
 
@@ -302,6 +303,13 @@ brcmf_proto_bcdc_hdrpull(struct brcmf_pub *drvr, bool do_fws,
 		return -EBADE;
 	}
 
+	/* Bus may hand up the payload in page fragments */
+	h = (struct brcmf_proto_bcdc_header *)(pktbuf->data);
+	offset = h->data_offset << 2;
+	if (!pskb_may_pull(pktbuf, min_t(uint, pktbuf->len,
+					 BCDC_HEADER_LEN + offset + ETH_HLEN)))
+		return -ENOMEM;
+
 	trace_brcmf_bcdchdr(pktbuf->data);
 	h = (struct brcmf_proto_bcdc_header *)(pktbuf->data);
 
@@ -327,9 +335,9 @@ brcmf_proto_bcdc_hdrpull(struct brcmf_pub *drvr, bool do_fws,
 
 	skb_pull(pktbuf, BCDC_HEADER_LEN);
 	if (do_fws)
-		brcmf_fws_hdrpull(tmp_if, h->data_offset << 2, pktbuf);
+		brcmf_fws_hdrpull(tmp_if, offset, pktbuf);
 	else
-		skb_pull(pktbuf, h->data_offset << 2);
+		skb_pull(pktbuf, offset);
 
 	if (pktbuf->len == 0)
 		return -ENODATA;
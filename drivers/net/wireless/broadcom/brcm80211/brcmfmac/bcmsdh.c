@@ -292,24 +292,23 @@ out:
 		*ret = retval;
 }
 
-static int brcmf_sdiod_skbuff_read(struct brcmf_sdio_dev *sdiodev,
-				   struct sdio_func *func, u32 addr,
-				   struct sk_buff *skb)
+static int brcmf_sdiod_buff_read(struct brcmf_sdio_dev *sdiodev,
+				 struct sdio_func *func, u32 addr,
+				 u8 *data, uint len)
 {
 	unsigned int req_sz;
 	int err;
 
-	/* Single skb use the standard mmc interface */
-	req_sz = skb->len + 3;
+	/* Single buffer use the standard mmc interface */
+	req_sz = len + 3;
 	req_sz &= (uint)~3;
 
 	switch (func->num) {
 	case 1:
-		err = sdio_memcpy_fromio(func, ((u8 *)(skb->data)), addr,
-					 req_sz);
+		err = sdio_memcpy_fromio(func, data, addr, req_sz);
 		break;
 	case 2:
-		err = sdio_readsb(func, ((u8 *)(skb->data)), addr, req_sz);
+		err = sdio_readsb(func, data, addr, req_sz);
 		break;
 	default:
 		/* bail out as things are really fishy here */
@@ -323,6 +322,13 @@ static int brcmf_sdiod_skbuff_read(struct brcmf_sdio_dev *sdiodev,
 	return err;
 }
 
+static int brcmf_sdiod_skbuff_read(struct brcmf_sdio_dev *sdiodev,
+				   struct sdio_func *func, u32 addr,
+				   struct sk_buff *skb)
+{
+	return brcmf_sdiod_buff_read(sdiodev, func, addr, skb->data, skb->len);
+}
+
 static int brcmf_sdiod_skbuff_write(struct brcmf_sdio_dev *sdiodev,
 				    struct sdio_func *func, u32 addr,
 				    struct sk_buff *skb)
@@ -556,6 +562,29 @@ done:
 	return err;
 }
 
+/*
+ * Read straight into @buf, which must be DMA capable and hold nbytes
+ * rounded up to a multiple of 4.
+ */
+int brcmf_sdiod_recv_direct(struct brcmf_sdio_dev *sdiodev, u8 *buf,
+			    uint nbytes)
+{
+	u32 addr = sdiodev->cc_core->base;
+	int err;
+
+	brcmf_dbg(SDIO, "addr = 0x%x, size = %d\n", addr, nbytes);
+
+	err = brcmf_sdiod_set_backplane_window(sdiodev, addr);
+	if (err)
+		return err;
+
+	addr &= SBSDIO_SB_OFT_ADDR_MASK;
+	addr |= SBSDIO_SB_ACCESS_2_4B_FLAG;
+
+	return brcmf_sdiod_buff_read(sdiodev, sdiodev->func2, addr, buf,
+				     nbytes);
+}
+
 int brcmf_sdiod_recv_chain(struct brcmf_sdio_dev *sdiodev,
 			   struct sk_buff_head *pktq, uint totlen)
 {
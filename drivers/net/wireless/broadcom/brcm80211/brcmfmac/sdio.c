@@ -16,6 +16,7 @@
 
 #include <linux/types.h>
 #include <linux/atomic.h>
+#include <linux/average.h>
 #include <linux/kernel.h>
 #include <linux/kthread.h>
 #include <linux/printk.h>
@@ -33,6 +34,7 @@
 #include <linux/bcma/bcma.h>
 #include <linux/debugfs.h>
 #include <linux/vmalloc.h>
+#include <linux/sizes.h>
 #include <asm/unaligned.h>
 #include <defs.h>
 #include <brcmu_wifi.h>
@@ -116,7 +118,15 @@ struct rte_console {
 #define BRCMF_TXBOUND	20	/* Default for max tx frames in
 				 one scheduling */
 
-#define BRCMF_TXMINMAX	1	/* Max tx frames if rx still pending */
+#define BRCMF_TXGLOM_MIN	4	/* Min tx frames in an adaptive glom */
+
+#define BRCMF_TXGLOM_BUDGET_US	2000	/* Bus time an adaptive glom may
+					 take, rx waits meanwhile */
+
+#define BRCMF_RXPOOL_SIZE	4	/* Buffers to read superframes into */
+#define BRCMF_RXPOOL_BUFSZ	SZ_64K	/* Larger than any superframe */
+#define BRCMF_RXGLOM_MAX	64	/* Max subframes in a pooled read */
+#define BRCMF_RX_COPYBREAK	256	/* Subframe bytes copied to the skb */
 
 #define MEMBLOCK	2048	/* Block size used for downloading
 				 of dongle image */
@@ -431,6 +441,8 @@ struct brcmf_sdio_count {
 	ulong rx_readahead_cnt;	/* packets where header read-ahead was used */
 };
 
+DECLARE_EWMA(txrate, 4, 8)
+
 /* misc chip info needed by some of the routines */
 /* Private data for SDIO bus interaction */
 struct brcmf_sdio {
@@ -460,10 +472,13 @@ struct brcmf_sdio {
 
 	uint rxbound;		/* Rx frames to read before resched */
 	uint txbound;		/* Tx frames to send before resched */
-	uint txminmax;
+	u32 txglom_cur;		/* Current tx glom size limit */
+	struct ewma_txrate txrate; /* Tx bus throughput, bytes per ms */
 
 	struct sk_buff *glomd;	/* Packet containing glomming descriptor */
 	struct sk_buff_head glom; /* Packet list for glommed superframe */
+	struct page *rxpool[BRCMF_RXPOOL_SIZE];
+				/* Recycled superframe read buffers */
 
 	u8 *rxbuf;		/* Buffer for receiving control packets */
 	uint rxblen;		/* Allocated length of rxbuf */
@@ -514,6 +529,9 @@ struct brcmf_sdio {
 	bool dpc_triggered;
 	bool dpc_running;
 
+	struct workqueue_struct *brcmf_txwq;
+	struct work_struct txwork;
+
 	bool txoff;		/* Transmit flow-controlled */
 	struct brcmf_sdio_count sdcnt;
 	bool sr_enabled; /* SaveRestore enabled */
@@ -1455,6 +1473,178 @@ static void brcmf_sdio_hdpack(struct brcmf_sdio *bus, u8 *header,
 	trace_brcmf_sdpcm_hdr(SDPCM_TX + !!(bus->txglom), header);
 }
 
+/*
+ * A pool buffer is free again once the skbs referring to it are gone, only
+ * the pool holding a reference then.
+ */
+static struct page *brcmf_sdio_rxpool_get(struct brcmf_sdio *bus)
+{
+	struct page *page;
+	int i;
+
+	for (i = 0; i < BRCMF_RXPOOL_SIZE; i++) {
+		page = bus->rxpool[i];
+		if (!page) {
+			page = alloc_pages(GFP_ATOMIC | __GFP_COMP | __GFP_NOWARN,
+					   get_order(BRCMF_RXPOOL_BUFSZ));
+			bus->rxpool[i] = page;
+			return page;
+		}
+		if (page_ref_count(page) == 1)
+			return page;
+	}
+
+	return NULL;
+}
+
+static void brcmf_sdio_rxpool_free(struct brcmf_sdio *bus)
+{
+	int i;
+
+	for (i = 0; i < BRCMF_RXPOOL_SIZE; i++) {
+		if (bus->rxpool[i])
+			put_page(bus->rxpool[i]);
+		bus->rxpool[i] = NULL;
+	}
+}
+
+/*
+ * Subframe of a pooled superframe to skb: the headers, or all of a small
+ * frame or event, are copied and the rest refers to the pool buffer.
+ */
+static struct sk_buff *brcmf_sdio_rxpool_skb(struct page *page, uint offset,
+					     uint len, bool copy)
+{
+	uint hlen = copy ? len : min_t(uint, len, BRCMF_RX_COPYBREAK);
+	struct sk_buff *skb;
+
+	skb = brcmu_pkt_buf_get_skb(hlen);
+	if (!skb)
+		return NULL;
+
+	memcpy(skb->data, page_address(page) + offset, hlen);
+	if (len > hlen) {
+		get_page(page);
+		skb_add_rx_frag(skb, 0, page, offset + hlen, len - hlen,
+				len - hlen);
+	}
+
+	return skb;
+}
+
+/*
+ * Read the superframe described by bus->glomd into one pool buffer, in a
+ * single request, and hand the subframes up without copying their payload.
+ * Returns -EAGAIN, leaving the descriptor alone, if the superframe doesn't
+ * fit.
+ */
+static int brcmf_sdio_rxglom_pooled(struct brcmf_sdio *bus, u8 rxseq,
+				    struct page *page)
+{
+	u16 lens[BRCMF_RXGLOM_MAX];
+	struct brcmf_sdio_hdrinfo rd_new;
+	uint dlen, totlen, offset, sfdoff, len;
+	u8 *buf = page_address(page);
+	struct sk_buff *pkt;
+	u16 sublen;
+	int errcode, num, i;
+	u8 *dptr, doff;
+	bool event;
+
+	dlen = bus->glomd->len;
+	dptr = bus->glomd->data;
+	if (!dlen || (dlen & 1) || dlen / sizeof(u16) > BRCMF_RXGLOM_MAX)
+		return -EAGAIN;
+
+	for (totlen = num = 0; dlen; num++) {
+		sublen = get_unaligned_le16(dptr);
+		dlen -= sizeof(u16);
+		dptr += sizeof(u16);
+		if ((sublen < SDPCM_HDRLEN) ||
+		    ((num == 0) && (sublen < (2 * SDPCM_HDRLEN))))
+			return -EAGAIN;
+		totlen += sublen;
+
+		/* For last frame, adjust read len so total is a block multiple */
+		if (!dlen) {
+			sublen += roundup(totlen, bus->blocksize) - totlen;
+			totlen = roundup(totlen, bus->blocksize);
+		}
+		lens[num] = sublen;
+	}
+	if (totlen + 3 > BRCMF_RXPOOL_BUFSZ || totlen > U16_MAX)
+		return -EAGAIN;
+
+	/* Done with descriptor packet */
+	brcmu_pkt_buf_free_skb(bus->glomd);
+	bus->glomd = NULL;
+	bus->cur_read.len = 0;
+
+	sdio_claim_host(bus->sdiodev->func1);
+	errcode = brcmf_sdiod_recv_direct(bus->sdiodev, buf, totlen);
+	bus->sdcnt.f2rxdata++;
+	if (errcode < 0) {
+		brcmf_err("glom read of %d bytes failed: %d\n",
+			  totlen, errcode);
+		goto fail;
+	}
+
+	rd_new.seq_num = rxseq;
+	rd_new.len = totlen;
+	errcode = brcmf_sdio_hdparse(bus, buf, &rd_new, BRCMF_SDIO_FT_SUPER);
+	bus->cur_read.len = rd_new.len_nxtfrm << 4;
+	sfdoff = rd_new.dat_offset;
+
+	/* Validate all the subframe headers, the first one after the super */
+	for (i = 0, offset = sfdoff; i < num && !errcode; i++) {
+		len = lens[i] - (i ? 0 : sfdoff);
+		rd_new.len = len;
+		rd_new.seq_num = rxseq++;
+		errcode = brcmf_sdio_hdparse(bus, buf + offset, &rd_new,
+					     BRCMF_SDIO_FT_SUB);
+		offset += len;
+	}
+	if (errcode)
+		goto fail;
+	sdio_release_host(bus->sdiodev->func1);
+
+	for (i = 0, offset = sfdoff; i < num; i++) {
+		len = lens[i] - (i ? 0 : sfdoff);
+		dptr = buf + offset;
+		offset += len;
+
+		sublen = get_unaligned_le16(dptr);
+		doff = brcmf_sdio_getdatoffset(&dptr[SDPCM_HWHDR_LEN]);
+		if (sublen <= doff)
+			continue;
+
+		event = brcmf_sdio_fromevntchan(&dptr[SDPCM_HWHDR_LEN]);
+		pkt = brcmf_sdio_rxpool_skb(page, dptr + doff - buf,
+					    sublen - doff, event);
+		if (!pkt) {
+			brcmf_err("no skb for subframe %d\n", i);
+			continue;
+		}
+
+		if (event)
+			brcmf_rx_event(bus->sdiodev->dev, pkt);
+		else
+			brcmf_rx_frame(bus->sdiodev->dev, pkt, false);
+		bus->sdcnt.rxglompkts++;
+	}
+
+	bus->sdcnt.rxglomframes++;
+	return num;
+
+fail:
+	/* Terminate frame on error */
+	brcmf_sdio_rxfail(bus, true, false);
+	bus->sdcnt.rxglomfail++;
+	sdio_release_host(bus->sdiodev->func1);
+	bus->cur_read.len = 0;
+	return 0;
+}
+
 static u8 brcmf_sdio_rxglom(struct brcmf_sdio *bus, u8 rxseq)
 {
 	u16 dlen, totlen;
@@ -1473,6 +1663,17 @@ static u8 brcmf_sdio_rxglom(struct brcmf_sdio *bus, u8 rxseq)
 	brcmf_dbg(SDIO, "start: glomd %p glom %p\n",
 		  bus->glomd, skb_peek(&bus->glom));
 
+	/* Preferably read the superframe into a pool buffer */
+	if (bus->glomd) {
+		struct page *page = brcmf_sdio_rxpool_get(bus);
+
+		if (page) {
+			errcode = brcmf_sdio_rxglom_pooled(bus, rxseq, page);
+			if (errcode >= 0)
+				return errcode;
+		}
+	}
+
 	/* If there's a descriptor, generate the packet chain */
 	if (bus->glomd) {
 		pfirst = pnext = NULL;
@@ -2270,6 +2471,35 @@ done:
 	return ret;
 }
 
+/*
+ * Size the tx gloms after the bus throughput, so that sending one doesn't
+ * hold the bus for more than BRCMF_TXGLOM_BUDGET_US, unless the queue is
+ * backing up towards flow control.
+ */
+static void brcmf_sdio_txglom_adapt(struct brcmf_sdio *bus, uint frames,
+				    uint bytes, ktime_t elapsed)
+{
+	s64 us = ktime_to_us(elapsed);
+	uint limit = bus->sdiodev->txglomsz;
+	uint target;
+
+	if (us <= 0)
+		return;
+
+	ewma_txrate_add(&bus->txrate, div_u64((u64)bytes * USEC_PER_MSEC, us));
+
+	if (pktq_len(&bus->txq) >= TXLOW) {
+		target = limit;
+	} else {
+		target = ewma_txrate_read(&bus->txrate) *
+			 BRCMF_TXGLOM_BUDGET_US / USEC_PER_MSEC;
+		target /= max(bytes / frames, 1U);
+	}
+
+	bus->txglom_cur = clamp_t(uint, target, min(BRCMF_TXGLOM_MIN, limit),
+				  limit);
+}
+
 static uint brcmf_sdio_sendfromq(struct brcmf_sdio *bus, uint maxframes)
 {
 	struct sk_buff *pkt;
@@ -2277,8 +2507,9 @@ static uint brcmf_sdio_sendfromq(struct brcmf_sdio *bus, uint maxframes)
 	u32 intstat_addr = bus->sdio_core->base + SD_REG(intstatus);
 	u32 intstatus = 0;
 	int ret = 0, prec_out, i;
-	uint cnt = 0;
+	uint cnt = 0, bytes;
 	u8 tx_prec_map, pkt_num;
+	ktime_t start;
 
 	brcmf_dbg(TRACE, "Enter\n");
 
@@ -2286,26 +2517,47 @@ static uint brcmf_sdio_sendfromq(struct brcmf_sdio *bus, uint maxframes)
 
 	/* Send frames until the limit or some other event */
 	for (cnt = 0; (cnt < maxframes) && data_ok(bus);) {
+		/*
+		 * Hold the bus across header preparation and sending, so that
+		 * the sequence numbers stay consistent with the control frames
+		 * sent by the DPC, and check the clock wasn't turned off.
+		 */
+		sdio_claim_host(bus->sdiodev->func1);
+		if (bus->clkstate != CLK_AVAIL ||
+		    bus->sdiodev->state != BRCMF_SDIOD_DATA) {
+			sdio_release_host(bus->sdiodev->func1);
+			break;
+		}
+
 		pkt_num = 1;
 		if (bus->txglom)
 			pkt_num = min_t(u8, bus->tx_max - bus->tx_seq,
-					bus->sdiodev->txglomsz);
+					bus->txglom_cur);
 		pkt_num = min_t(u32, pkt_num,
 				brcmu_pktq_mlen(&bus->txq, ~bus->flowcontrol));
 		__skb_queue_head_init(&pktq);
+		bytes = 0;
 		spin_lock_bh(&bus->txq_lock);
 		for (i = 0; i < pkt_num; i++) {
 			pkt = brcmu_pktq_mdeq(&bus->txq, tx_prec_map,
 					      &prec_out);
 			if (pkt == NULL)
 				break;
+			bytes += pkt->len;
 			__skb_queue_tail(&pktq, pkt);
 		}
 		spin_unlock_bh(&bus->txq_lock);
-		if (i == 0)
+		if (i == 0) {
+			sdio_release_host(bus->sdiodev->func1);
 			break;
+		}
 
+		start = ktime_get();
 		ret = brcmf_sdio_txpkt(bus, &pktq, SDPCM_DATA_CHANNEL);
+		if (!ret && bus->txglom)
+			brcmf_sdio_txglom_adapt(bus, i, bytes,
+						ktime_sub(ktime_get(), start));
+		sdio_release_host(bus->sdiodev->func1);
 
 		cnt += i;
 
@@ -2509,14 +2761,45 @@ static int brcmf_sdio_intr_rstatus(struct brcmf_sdio *bus)
 	return ret;
 }
 
+static void brcmf_sdio_trigger_tx(struct brcmf_sdio *bus)
+{
+	queue_work(bus->brcmf_txwq, &bus->txwork);
+}
+
+static void brcmf_sdio_txworker(struct work_struct *work)
+{
+	struct brcmf_sdio *bus = container_of(work, struct brcmf_sdio,
+					      txwork);
+	uint cnt;
+
+	do {
+		if (bus->sdiodev->state != BRCMF_SDIOD_DATA ||
+		    atomic_read(&bus->fcstate))
+			return;
+
+		/* Bringing the clock up is left to the DPC */
+		if (bus->clkstate != CLK_AVAIL) {
+			brcmf_sdio_trigger_dpc(bus);
+			return;
+		}
+
+		cnt = brcmf_sdio_sendfromq(bus, bus->txbound);
+		bus->idlecount = 0;
+
+		/* Set by sendfromq in poll mode */
+		if (atomic_read(&bus->ipend) > 0)
+			brcmf_sdio_trigger_dpc(bus);
+
+		cond_resched();
+	} while (cnt);
+}
+
 static void brcmf_sdio_dpc(struct brcmf_sdio *bus)
 {
 	struct brcmf_sdio_dev *sdiod = bus->sdiodev;
 	u32 newstatus = 0;
 	u32 intstat_addr = bus->sdio_core->base + SD_REG(intstatus);
 	unsigned long intstatus;
-	uint txlimit = bus->txbound;	/* Tx frames to send before resched */
-	uint framecnt;			/* Temporary counter of tx/rx frames */
 	int err = 0;
 
 	brcmf_dbg(SDIO, "Enter\n");
@@ -2638,14 +2921,10 @@ static void brcmf_sdio_dpc(struct brcmf_sdio *bus)
 		sdio_release_host(bus->sdiodev->func1);
 		brcmf_sdio_wait_event_wakeup(bus);
 	}
-	/* Send queued frames (limit 1 if rx may still be pending) */
+	/* Queued frames are sent by the tx worker, next to rx processing */
 	if ((bus->clkstate == CLK_AVAIL) && !atomic_read(&bus->fcstate) &&
-	    brcmu_pktq_mlen(&bus->txq, ~bus->flowcontrol) && txlimit &&
-	    data_ok(bus)) {
-		framecnt = bus->rxpending ? min(txlimit, bus->txminmax) :
-					    txlimit;
-		brcmf_sdio_sendfromq(bus, framecnt);
-	}
+	    brcmu_pktq_mlen(&bus->txq, ~bus->flowcontrol) && data_ok(bus))
+		brcmf_sdio_trigger_tx(bus);
 
 	if ((bus->sdiodev->state != BRCMF_SDIOD_DATA) || (err != 0)) {
 		brcmf_err("failed backplane access over SDIO, halting operation\n");
@@ -2661,10 +2940,7 @@ static void brcmf_sdio_dpc(struct brcmf_sdio *bus)
 			sdio_release_host(bus->sdiodev->func1);
 		}
 	} else if (atomic_read(&bus->intstatus) ||
-		   atomic_read(&bus->ipend) > 0 ||
-		   (!atomic_read(&bus->fcstate) &&
-		    brcmu_pktq_mlen(&bus->txq, ~bus->flowcontrol) &&
-		    data_ok(bus))) {
+		   atomic_read(&bus->ipend) > 0) {
 		bus->dpc_triggered = true;
 	}
 }
@@ -2766,7 +3042,7 @@ static int brcmf_sdio_bus_txdata(struct device *dev, struct sk_buff *pkt)
 		qcount[prec] = pktq_plen(&bus->txq, prec);
 #endif
 
-	brcmf_sdio_trigger_dpc(bus);
+	brcmf_sdio_trigger_tx(bus);
 	return ret;
 }
 
@@ -3129,6 +3405,7 @@ static void brcmf_sdio_debugfs_create(struct brcmf_sdio *bus)
 				brcmf_debugfs_sdio_count_read);
 	debugfs_create_u32("console_interval", 0644, dentry,
 			   &bus->console_interval);
+	debugfs_create_u32("txglom_cur", 0444, dentry, &bus->txglom_cur);
 }
 #else
 static int brcmf_sdio_checkdied(struct brcmf_sdio *bus)
@@ -3640,8 +3917,11 @@ static void brcmf_sdio_dataworker(struct work_struct *work)
 	bus->dpc_running = false;
 	if (brcmf_sdiod_freezing(bus->sdiodev)) {
 		brcmf_sdiod_change_state(bus->sdiodev, BRCMF_SDIOD_DOWN);
+		/* The tx worker stops sending once the state isn't DATA */
+		flush_work(&bus->txwork);
 		brcmf_sdiod_try_freeze(bus->sdiodev);
 		brcmf_sdiod_change_state(bus->sdiodev, BRCMF_SDIOD_DATA);
+		brcmf_sdio_trigger_tx(bus);
 	}
 }
 
@@ -4200,7 +4480,8 @@ struct brcmf_sdio *brcmf_sdio_probe(struct brcmf_sdio_dev *sdiodev)
 	skb_queue_head_init(&bus->glom);
 	bus->txbound = BRCMF_TXBOUND;
 	bus->rxbound = BRCMF_RXBOUND;
-	bus->txminmax = BRCMF_TXMINMAX;
+	bus->txglom_cur = sdiodev->txglomsz;
+	ewma_txrate_init(&bus->txrate);
 	bus->tx_seq = SDPCM_SEQ_WRAP - 1;
 
 	/* single-threaded workqueue */
@@ -4214,6 +4495,17 @@ struct brcmf_sdio *brcmf_sdio_probe(struct brcmf_sdio_dev *sdiodev)
 	INIT_WORK(&bus->datawork, brcmf_sdio_dataworker);
 	bus->brcmf_wq = wq;
 
+	/* tx runs apart from the DPC, not to wait behind rx processing */
+	wq = alloc_ordered_workqueue("brcmf_txwq/%s",
+				     WQ_MEM_RECLAIM | WQ_HIGHPRI,
+				     dev_name(&sdiodev->func1->dev));
+	if (!wq) {
+		brcmf_err("insufficient memory to create txworkqueue\n");
+		goto fail;
+	}
+	INIT_WORK(&bus->txwork, brcmf_sdio_txworker);
+	bus->brcmf_txwq = wq;
+
 	/* attempt to attach to the dongle */
 	if (!(brcmf_sdio_probe_attach(bus))) {
 		brcmf_err("brcmf_sdio_probe_attach failed\n");
@@ -4311,6 +4603,11 @@ void brcmf_sdio_remove(struct brcmf_sdio *bus)
 		cancel_work_sync(&bus->datawork);
 		if (bus->brcmf_wq)
 			destroy_workqueue(bus->brcmf_wq);
+		brcmf_sdio_rxpool_free(bus);
+		if (bus->brcmf_txwq) {
+			cancel_work_sync(&bus->txwork);
+			destroy_workqueue(bus->brcmf_txwq);
+		}
 
 		if (bus->ci) {
 			if (bus->sdiodev->state != BRCMF_SDIOD_NOMEDIUM) {
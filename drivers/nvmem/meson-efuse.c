@@ -15,15 +15,34 @@
  */
 
 #include <linux/module.h>
+#include <linux/mutex.h>
 #include <linux/nvmem-provider.h>
 #include <linux/of.h>
 #include <linux/platform_device.h>
 
 #include <linux/firmware/meson/meson_sm.h>
 
+/*
+ * The eFuse content only changes when it is written through this driver,
+ * keep a copy of it so that the readers don't go through the secure monitor.
+ */
+struct meson_efuse {
+	u8 *cache;
+	bool cached;
+	struct mutex write_lock;
+	u8 *buf;
+};
+
 static int meson_efuse_read(void *context, unsigned int offset,
 			    void *val, size_t bytes)
 {
+	struct meson_efuse *efuse = context;
+
+	if (READ_ONCE(efuse->cached)) {
+		memcpy(val, efuse->cache + offset, bytes);
+		return 0;
+	}
+
 	return meson_sm_call_read((u8 *)val, bytes, SM_EFUSE_READ, offset,
 				  bytes, 0, 0, 0);
 }
@@ -31,8 +50,30 @@ static int meson_efuse_read(void *context, unsigned int offset,
 static int meson_efuse_write(void *context, unsigned int offset,
 			     void *val, size_t bytes)
 {
-	return meson_sm_call_write((u8 *)val, bytes, SM_EFUSE_WRITE, offset,
-				   bytes, 0, 0, 0);
+	struct meson_efuse *efuse = context;
+	int ret;
+
+	mutex_lock(&efuse->write_lock);
+
+	ret = meson_sm_call_write((u8 *)val, bytes, SM_EFUSE_WRITE, offset,
+				  bytes, 0, 0, 0);
+
+	/*
+	 * Only the bits set in val get burnt, read back what the fuses hold
+	 * now. Readers racing with the update see each byte either before or
+	 * after the write, as they would with the secure monitor.
+	 */
+	if (efuse->cached) {
+		if (meson_sm_call_read(efuse->buf, bytes, SM_EFUSE_READ,
+				       offset, bytes, 0, 0, 0) == bytes)
+			memcpy(efuse->cache + offset, efuse->buf, bytes);
+		else
+			WRITE_ONCE(efuse->cached, false);
+	}
+
+	mutex_unlock(&efuse->write_lock);
+
+	return ret;
 }
 
 static const struct of_device_id meson_efuse_match[] = {
@@ -46,11 +87,29 @@ static int meson_efuse_probe(struct platform_device *pdev)
 	struct device *dev = &pdev->dev;
 	struct nvmem_device *nvmem;
 	struct nvmem_config *econfig;
+	struct meson_efuse *efuse;
 	unsigned int size;
 
 	if (meson_sm_call(SM_EFUSE_USER_MAX, &size, 0, 0, 0, 0, 0) < 0)
 		return -EINVAL;
 
+	efuse = devm_kzalloc(dev, sizeof(*efuse), GFP_KERNEL);
+	if (!efuse)
+		return -ENOMEM;
+
+	mutex_init(&efuse->write_lock);
+	efuse->cache = devm_kzalloc(dev, size, GFP_KERNEL);
+	efuse->buf = devm_kzalloc(dev, size, GFP_KERNEL);
+	if (!efuse->cache || !efuse->buf)
+		return -ENOMEM;
+
+	/* Without a copy, every read goes to the secure monitor as before */
+	if (meson_sm_call_read(efuse->cache, size, SM_EFUSE_READ, 0, size,
+			       0, 0, 0) == size)
+		efuse->cached = true;
+	else
+		dev_warn(dev, "failed to read the eFuse, not caching it\n");
+
 	econfig = devm_kzalloc(dev, sizeof(*econfig), GFP_KERNEL);
 	if (!econfig)
 		return -ENOMEM;
@@ -62,6 +121,7 @@ static int meson_efuse_probe(struct platform_device *pdev)
 	econfig->reg_read = meson_efuse_read;
 	econfig->reg_write = meson_efuse_write;
 	econfig->size = size;
+	econfig->priv = efuse;
 
 	nvmem = devm_nvmem_register(&pdev->dev, econfig);
 
@@ -101,6 +101,10 @@ struct phy_meson_gxl_usb2_priv {
 	int			is_enabled;
 	struct clk		*clk;
 	struct reset_control	*reset;
+	/* register contents retained across power_off/power_on */
+	u32			r0;
+	u32			r1;
+	bool			regs_saved;
 };
 
 static const struct regmap_config phy_meson_gxl_usb2_regmap_conf = {
@@ -182,6 +186,7 @@ static int phy_meson_gxl_usb2_set_mode(struct phy *phy, enum phy_mode mode)
 	phy_meson_gxl_usb2_reset(phy);
 
 	priv->mode = mode;
+	priv->regs_saved = false;
 
 	return 0;
 }
@@ -190,6 +195,17 @@ static int phy_meson_gxl_usb2_power_off(struct phy *phy)
 {
 	struct phy_meson_gxl_usb2_priv *priv = phy_get_drvdata(phy);
 
+	/*
+	 * Keep the mode and tuning settings, so that they can be restored by
+	 * the next power_on without going through set_mode and its reset
+	 * cycle again.
+	 */
+	if (priv->is_enabled) {
+		regmap_read(priv->regmap, U2P_R0, &priv->r0);
+		regmap_read(priv->regmap, U2P_R1, &priv->r1);
+		priv->regs_saved = true;
+	}
+
 	priv->is_enabled = 0;
 
 	/* power off the PHY by putting it into reset mode */
@@ -206,6 +222,15 @@ static int phy_meson_gxl_usb2_power_on(struct phy *phy)
 
 	priv->is_enabled = 1;
 
+	if (priv->regs_saved) {
+		/* restore the settings and leave reset in a single step */
+		regmap_write(priv->regmap, U2P_R1, priv->r1);
+		regmap_write(priv->regmap, U2P_R0,
+			     priv->r0 & ~U2P_R0_POWER_ON_RESET);
+		usleep_range(RESET_COMPLETE_TIME, RESET_COMPLETE_TIME + 100);
+		return 0;
+	}
+
 	/* power on the PHY by taking it out of reset mode */
 	regmap_update_bits(priv->regmap, U2P_R0, U2P_R0_POWER_ON_RESET, 0);
 
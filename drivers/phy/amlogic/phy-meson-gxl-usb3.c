@@ -99,11 +99,10 @@ static int phy_meson_gxl_usb3_power_on(struct phy *phy)
 {
 	struct phy_meson_gxl_usb3_priv *priv = phy_get_drvdata(phy);
 
-	regmap_update_bits(priv->regmap, USB_R5, USB_R5_ID_DIG_EN_0,
-			   USB_R5_ID_DIG_EN_0);
-	regmap_update_bits(priv->regmap, USB_R5, USB_R5_ID_DIG_EN_1,
-			   USB_R5_ID_DIG_EN_1);
-	regmap_update_bits(priv->regmap, USB_R5, USB_R5_ID_DIG_TH_MASK,
+	regmap_update_bits(priv->regmap, USB_R5,
+			   USB_R5_ID_DIG_EN_0 | USB_R5_ID_DIG_EN_1 |
+			   USB_R5_ID_DIG_TH_MASK,
+			   USB_R5_ID_DIG_EN_0 | USB_R5_ID_DIG_EN_1 |
 			   FIELD_PREP(USB_R5_ID_DIG_TH_MASK, 0xff));
 
 	return 0;
@@ -113,8 +112,8 @@ static int phy_meson_gxl_usb3_power_off(struct phy *phy)
 {
 	struct phy_meson_gxl_usb3_priv *priv = phy_get_drvdata(phy);
 
-	regmap_update_bits(priv->regmap, USB_R5, USB_R5_ID_DIG_EN_0, 0);
-	regmap_update_bits(priv->regmap, USB_R5, USB_R5_ID_DIG_EN_1, 0);
+	regmap_update_bits(priv->regmap, USB_R5,
+			   USB_R5_ID_DIG_EN_0 | USB_R5_ID_DIG_EN_1, 0);
 
 	return 0;
 }
@@ -20,9 +20,13 @@
 #include <linux/of.h>
 #include <linux/phy/phy.h>
 #include <linux/idr.h>
+#include <linux/ktime.h>
 #include <linux/pm_runtime.h>
 #include <linux/regulator/consumer.h>
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/phy.h>
+
 static struct class *phy_class;
 static DEFINE_MUTEX(phy_provider_mutex);
 static LIST_HEAD(phy_provider_list);
@@ -247,7 +251,11 @@ int phy_init(struct phy *phy)
 
 	mutex_lock(&phy->mutex);
 	if (phy->init_count == 0 && phy->ops->init) {
+		ktime_t start = ktime_get();
+
 		ret = phy->ops->init(phy);
+		trace_phy_init(phy, ret, ktime_to_ns(ktime_sub(ktime_get(),
+							       start)));
 		if (ret < 0) {
 			dev_err(&phy->dev, "phy init failed --> %d\n", ret);
 			goto out;
@@ -312,7 +320,11 @@ int phy_power_on(struct phy *phy)
 
 	mutex_lock(&phy->mutex);
 	if (phy->power_count == 0 && phy->ops->power_on) {
+		ktime_t start = ktime_get();
+
 		ret = phy->ops->power_on(phy);
+		trace_phy_power_on(phy, ret, ktime_to_ns(ktime_sub(ktime_get(),
+								   start)));
 		if (ret < 0) {
 			dev_err(&phy->dev, "phy poweron failed --> %d\n", ret);
 			goto err_pwr_on;
@@ -400,6 +400,67 @@ static int meson_gpio_get(struct gpio_chip *chip, unsigned gpio)
 	return !!(val & BIT(bit));
 }
 
+/*
+ * The pins of a bank share a single register of each type, so the gpio
+ * array helpers only need one register access per bank involved
+ */
+static void meson_gpio_set_multiple(struct gpio_chip *chip,
+				    unsigned long *mask, unsigned long *bits)
+{
+	struct meson_pinctrl *pc = gpiochip_get_data(chip);
+	unsigned int reg, bit, gpio, i;
+	struct meson_bank *bank;
+	u32 bmask, bval;
+
+	for (i = 0; i < pc->data->num_banks; i++) {
+		bank = &pc->data->banks[i];
+		bmask = 0;
+		bval = 0;
+
+		for (gpio = find_next_bit(mask, bank->last + 1, bank->first);
+		     gpio <= bank->last;
+		     gpio = find_next_bit(mask, bank->last + 1, gpio + 1)) {
+			meson_calc_reg_and_bit(bank, gpio, REG_OUT, &reg, &bit);
+			bmask |= BIT(bit);
+			if (test_bit(gpio, bits))
+				bval |= BIT(bit);
+		}
+
+		if (bmask)
+			regmap_update_bits(pc->reg_gpio, reg, bmask, bval);
+	}
+}
+
+static int meson_gpio_get_multiple(struct gpio_chip *chip,
+				   unsigned long *mask, unsigned long *bits)
+{
+	struct meson_pinctrl *pc = gpiochip_get_data(chip);
+	unsigned int reg, bit, gpio, i, val;
+	struct meson_bank *bank;
+	int ret;
+
+	for (i = 0; i < pc->data->num_banks; i++) {
+		bank = &pc->data->banks[i];
+
+		gpio = find_next_bit(mask, bank->last + 1, bank->first);
+		if (gpio > bank->last)
+			continue;
+
+		meson_calc_reg_and_bit(bank, gpio, REG_IN, &reg, &bit);
+		ret = regmap_read(pc->reg_gpio, reg, &val);
+		if (ret)
+			return ret;
+
+		for (; gpio <= bank->last;
+		     gpio = find_next_bit(mask, bank->last + 1, gpio + 1)) {
+			meson_calc_reg_and_bit(bank, gpio, REG_IN, &reg, &bit);
+			__assign_bit(gpio, bits, val & BIT(bit));
+		}
+	}
+
+	return 0;
+}
+
 static int meson_gpiolib_register(struct meson_pinctrl *pc)
 {
 	int ret;
@@ -412,6 +473,8 @@ static int meson_gpiolib_register(struct meson_pinctrl *pc)
 	pc->chip.direction_output = meson_gpio_direction_output;
 	pc->chip.get = meson_gpio_get;
 	pc->chip.set = meson_gpio_set;
+	pc->chip.get_multiple = meson_gpio_get_multiple;
+	pc->chip.set_multiple = meson_gpio_set_multiple;
 	pc->chip.base = -1;
 	pc->chip.ngpio = pc->data->num_pins;
 	pc->chip.can_sleep = false;
@@ -6,6 +6,8 @@
  */
 
 #include <linux/kernel.h>
+#include <linux/bitmap.h>
+#include <linux/debugfs.h>
 #include <linux/mfd/syscon.h>
 #include <linux/module.h>
 #include <linux/regmap.h>
@@ -13,6 +15,7 @@
 #include <linux/of_address.h>
 #include <linux/of_platform.h>
 #include <linux/io.h>
+#include <linux/seq_file.h>
 
 #define NUM_CANVAS 256
 
@@ -33,8 +36,16 @@
 struct meson_canvas {
 	struct device *dev;
 	void __iomem *reg_base;
-	spinlock_t lock; /* canvas device lock */
-	u8 used[NUM_CANVAS];
+	spinlock_t lock; /* canvas LUT registers lock */
+	/* Allocation is lock-free, the LUT registers are not */
+	DECLARE_BITMAP(used, NUM_CANVAS);
+
+	atomic_t in_use;
+	unsigned int peak;
+	atomic_t alloc_failures;
+	atomic64_t configs;
+	atomic64_t config_batches;
+	struct dentry *debugfs;
 };
 
 static void canvas_write(struct meson_canvas *canvas, u32 reg, u32 val)
@@ -60,89 +71,209 @@ struct meson_canvas *meson_canvas_get(struct device *dev)
 	if (!canvas_pdev)
 		return ERR_PTR(-EPROBE_DEFER);
 
+	/*
+	 * Have the consumer suspend before and resume after the canvas
+	 * provider, also when they are both suspended asynchronously.
+	 */
+	if (!device_link_add(dev, &canvas_pdev->dev,
+			     DL_FLAG_AUTOREMOVE_CONSUMER))
+		dev_warn(dev, "Failed to link to the canvas provider\n");
+
 	return dev_get_drvdata(&canvas_pdev->dev);
 }
 EXPORT_SYMBOL_GPL(meson_canvas_get);
 
-int meson_canvas_config(struct meson_canvas *canvas, u8 canvas_index,
-			u32 addr, u32 stride, u32 height,
-			unsigned int wrap,
-			unsigned int blkmode,
-			unsigned int endian)
+/* Must be called with the canvas lock held */
+static void canvas_write_lut(struct meson_canvas *canvas,
+			     const struct meson_canvas_entry *entry)
 {
-	unsigned long flags;
-
-	spin_lock_irqsave(&canvas->lock, flags);
-	if (!canvas->used[canvas_index]) {
-		dev_err(canvas->dev,
-			"Trying to setup non allocated canvas %u\n",
-			canvas_index);
-		spin_unlock_irqrestore(&canvas->lock, flags);
-		return -EINVAL;
-	}
-
 	canvas_write(canvas, DMC_CAV_LUT_DATAL,
-		     ((addr + 7) >> 3) |
-		     (((stride + 7) >> 3) << CANVAS_WIDTH_LBIT));
+		     ((entry->addr + 7) >> 3) |
+		     (((entry->stride + 7) >> 3) << CANVAS_WIDTH_LBIT));
 
 	canvas_write(canvas, DMC_CAV_LUT_DATAH,
-		     ((((stride + 7) >> 3) >> CANVAS_WIDTH_LWID) <<
+		     ((((entry->stride + 7) >> 3) >> CANVAS_WIDTH_LWID) <<
 						CANVAS_WIDTH_HBIT) |
-		     (height << CANVAS_HEIGHT_BIT) |
-		     (wrap << CANVAS_WRAP_BIT) |
-		     (blkmode << CANVAS_BLKMODE_BIT) |
-		     (endian << CANVAS_ENDIAN_BIT));
+		     (entry->height << CANVAS_HEIGHT_BIT) |
+		     (entry->wrap << CANVAS_WRAP_BIT) |
+		     (entry->blkmode << CANVAS_BLKMODE_BIT) |
+		     (entry->endian << CANVAS_ENDIAN_BIT));
 
 	canvas_write(canvas, DMC_CAV_LUT_ADDR,
-		     CANVAS_LUT_WR_EN | canvas_index);
+		     CANVAS_LUT_WR_EN | entry->index);
+}
+
+int meson_canvas_config_batch(struct meson_canvas *canvas,
+			      const struct meson_canvas_entry *entries,
+			      unsigned int num)
+{
+	unsigned long flags;
+	unsigned int i;
+
+	for (i = 0; i < num; ++i) {
+		if (!test_bit(entries[i].index, canvas->used)) {
+			dev_err(canvas->dev,
+				"Trying to setup non allocated canvas %u\n",
+				entries[i].index);
+			return -EINVAL;
+		}
+	}
+
+	spin_lock_irqsave(&canvas->lock, flags);
+	for (i = 0; i < num; ++i)
+		canvas_write_lut(canvas, &entries[i]);
 
 	/* Force a read-back to make sure everything is flushed. */
 	canvas_read(canvas, DMC_CAV_LUT_DATAH);
 	spin_unlock_irqrestore(&canvas->lock, flags);
 
+	atomic64_add(num, &canvas->configs);
+	atomic64_inc(&canvas->config_batches);
+
 	return 0;
 }
+EXPORT_SYMBOL_GPL(meson_canvas_config_batch);
+
+int meson_canvas_config(struct meson_canvas *canvas, u8 canvas_index,
+			u32 addr, u32 stride, u32 height,
+			unsigned int wrap,
+			unsigned int blkmode,
+			unsigned int endian)
+{
+	struct meson_canvas_entry entry = {
+		.index = canvas_index,
+		.addr = addr,
+		.stride = stride,
+		.height = height,
+		.wrap = wrap,
+		.blkmode = blkmode,
+		.endian = endian,
+	};
+
+	return meson_canvas_config_batch(canvas, &entry, 1);
+}
 EXPORT_SYMBOL_GPL(meson_canvas_config);
 
+static void canvas_account_alloc(struct meson_canvas *canvas,
+				 unsigned int num)
+{
+	unsigned int in_use = atomic_add_return(num, &canvas->in_use);
+
+	/* Racy, but only used for reporting */
+	if (in_use > READ_ONCE(canvas->peak))
+		WRITE_ONCE(canvas->peak, in_use);
+}
+
 int meson_canvas_alloc(struct meson_canvas *canvas, u8 *canvas_index)
 {
-	int i;
-	unsigned long flags;
+	unsigned int i;
 
-	spin_lock_irqsave(&canvas->lock, flags);
-	for (i = 0; i < NUM_CANVAS; ++i) {
-		if (!canvas->used[i]) {
-			canvas->used[i] = 1;
-			spin_unlock_irqrestore(&canvas->lock, flags);
-			*canvas_index = i;
-			return 0;
+	do {
+		i = find_first_zero_bit(canvas->used, NUM_CANVAS);
+		if (i >= NUM_CANVAS) {
+			atomic_inc(&canvas->alloc_failures);
+			dev_err(canvas->dev, "No more canvas available\n");
+			return -ENODEV;
 		}
-	}
-	spin_unlock_irqrestore(&canvas->lock, flags);
+	} while (test_and_set_bit(i, canvas->used));
+
+	canvas_account_alloc(canvas, 1);
+	*canvas_index = i;
 
-	dev_err(canvas->dev, "No more canvas available\n");
-	return -ENODEV;
+	return 0;
 }
 EXPORT_SYMBOL_GPL(meson_canvas_alloc);
 
-int meson_canvas_free(struct meson_canvas *canvas, u8 canvas_index)
+int meson_canvas_alloc_range(struct meson_canvas *canvas, u8 *first,
+			     unsigned int num)
 {
-	unsigned long flags;
+	unsigned int start = 0;
+	unsigned int i, idx;
 
-	spin_lock_irqsave(&canvas->lock, flags);
-	if (!canvas->used[canvas_index]) {
+	if (!num || num > NUM_CANVAS)
+		return -EINVAL;
+
+retry:
+	idx = bitmap_find_next_zero_area(canvas->used, NUM_CANVAS, start,
+					 num, 0);
+	if (idx >= NUM_CANVAS) {
+		atomic_inc(&canvas->alloc_failures);
+		dev_err(canvas->dev, "No %u contiguous canvas available\n",
+			num);
+		return -ENODEV;
+	}
+
+	for (i = 0; i < num; ++i) {
+		if (test_and_set_bit(idx + i, canvas->used)) {
+			/* Lost a race with another consumer, roll back */
+			while (i--)
+				clear_bit(idx + i, canvas->used);
+			start = idx + 1;
+			goto retry;
+		}
+	}
+
+	canvas_account_alloc(canvas, num);
+	*first = idx;
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(meson_canvas_alloc_range);
+
+int meson_canvas_free(struct meson_canvas *canvas, u8 canvas_index)
+{
+	if (!test_and_clear_bit(canvas_index, canvas->used)) {
 		dev_err(canvas->dev,
 			"Trying to free unused canvas %u\n", canvas_index);
-		spin_unlock_irqrestore(&canvas->lock, flags);
 		return -EINVAL;
 	}
-	canvas->used[canvas_index] = 0;
-	spin_unlock_irqrestore(&canvas->lock, flags);
+
+	atomic_dec(&canvas->in_use);
 
 	return 0;
 }
 EXPORT_SYMBOL_GPL(meson_canvas_free);
 
+void meson_canvas_free_range(struct meson_canvas *canvas, u8 first,
+			     unsigned int num)
+{
+	unsigned int i;
+
+	for (i = 0; i < num; ++i)
+		meson_canvas_free(canvas, first + i);
+}
+EXPORT_SYMBOL_GPL(meson_canvas_free_range);
+
+static int canvas_debugfs_show(struct seq_file *s, void *data)
+{
+	struct meson_canvas *canvas = s->private;
+
+	seq_printf(s, "in use: %d/%u (peak %u)\n",
+		   atomic_read(&canvas->in_use), NUM_CANVAS,
+		   READ_ONCE(canvas->peak));
+	seq_printf(s, "allocated: %*pbl\n", NUM_CANVAS, canvas->used);
+	seq_printf(s, "allocation failures: %d\n",
+		   atomic_read(&canvas->alloc_failures));
+	seq_printf(s, "configs: %lld in %lld batches\n",
+		   (long long)atomic64_read(&canvas->configs),
+		   (long long)atomic64_read(&canvas->config_batches));
+
+	return 0;
+}
+
+static int canvas_debugfs_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, canvas_debugfs_show, inode->i_private);
+}
+
+static const struct file_operations canvas_debugfs_fops = {
+	.owner = THIS_MODULE,
+	.open = canvas_debugfs_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 static int meson_canvas_probe(struct platform_device *pdev)
 {
 	struct resource *res;
@@ -161,6 +292,20 @@ static int meson_canvas_probe(struct platform_device *pdev)
 	canvas->dev = dev;
 	spin_lock_init(&canvas->lock);
 	dev_set_drvdata(dev, canvas);
+	device_enable_async_suspend(dev);
+
+	canvas->debugfs = debugfs_create_dir("meson-canvas", NULL);
+	debugfs_create_file("status", 0444, canvas->debugfs, canvas,
+			    &canvas_debugfs_fops);
+
+	return 0;
+}
+
+static int meson_canvas_remove(struct platform_device *pdev)
+{
+	struct meson_canvas *canvas = platform_get_drvdata(pdev);
+
+	debugfs_remove_recursive(canvas->debugfs);
 
 	return 0;
 }
@@ -173,6 +318,7 @@ MODULE_DEVICE_TABLE(of, canvas_dt_match);
 
 static struct platform_driver meson_canvas_driver = {
 	.probe = meson_canvas_probe,
+	.remove = meson_canvas_remove,
 	.driver = {
 		.name = "amlogic-canvas",
 		.of_match_table = canvas_dt_match,
@@ -0,0 +1,287 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Copyright (C) 2018 BayLibre, SAS
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/soc/amlogic/meson-tunnel.h>
+#include <linux/spinlock.h>
+#include <linux/wait.h>
+#include <linux/workqueue.h>
+
+/* Beyond that, a frame is taken as a timestamp discontinuity */
+#define TUNNEL_MAX_WAIT_NS	(2 * NSEC_PER_SEC)
+#define TUNNEL_MAX_OFFSET_NS	NSEC_PER_SEC
+#define TUNNEL_UNBIND_TIMEOUT	msecs_to_jiffies(100)
+
+static void meson_tunnel_release_work(struct work_struct *work);
+
+static struct meson_tunnel {
+	spinlock_t lock; /* everything below */
+	bool registered;
+	const struct meson_tunnel_ops *ops;
+	void *data;
+	bool unbinding;
+
+	/* Frames waiting for presentation, and for release */
+	struct list_head queue;
+	struct list_head done;
+	struct meson_tunnel_frame *shown;
+
+	/* The timestamp base_ts is presented at base_ns + offset */
+	bool synced;
+	u64 base_ns;
+	u64 base_ts;
+	s64 offset;
+	bool paused;
+	u64 paused_ns;
+
+	u64 last_vsync;
+	u64 period;
+
+	struct work_struct release_work;
+	wait_queue_head_t wq;
+} tunnel = {
+	.lock = __SPIN_LOCK_UNLOCKED(tunnel.lock),
+	.queue = LIST_HEAD_INIT(tunnel.queue),
+	.done = LIST_HEAD_INIT(tunnel.done),
+	.release_work = __WORK_INITIALIZER(tunnel.release_work,
+					   meson_tunnel_release_work),
+	.wq = __WAIT_QUEUE_HEAD_INITIALIZER(tunnel.wq),
+};
+
+static void meson_tunnel_release_done(void)
+{
+	struct meson_tunnel_frame *frame, *tmp;
+	const struct meson_tunnel_ops *ops;
+	void *data;
+	LIST_HEAD(done);
+
+	spin_lock_irq(&tunnel.lock);
+	list_splice_init(&tunnel.done, &done);
+	ops = tunnel.ops;
+	data = tunnel.data;
+	spin_unlock_irq(&tunnel.lock);
+
+	/* The producer is only unbound once all of its frames are back */
+	list_for_each_entry_safe(frame, tmp, &done, list) {
+		list_del(&frame->list);
+		ops->release(data, frame);
+	}
+}
+
+static void meson_tunnel_release_work(struct work_struct *work)
+{
+	meson_tunnel_release_done();
+}
+
+int meson_tunnel_bind(const struct meson_tunnel_ops *ops, void *data)
+{
+	int ret = 0;
+
+	spin_lock_irq(&tunnel.lock);
+	if (!tunnel.registered) {
+		ret = -ENODEV;
+	} else if (tunnel.ops) {
+		ret = -EBUSY;
+	} else {
+		tunnel.ops = ops;
+		tunnel.data = data;
+		tunnel.synced = false;
+		tunnel.paused = false;
+		tunnel.offset = 0;
+	}
+	spin_unlock_irq(&tunnel.lock);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(meson_tunnel_bind);
+
+void meson_tunnel_unbind(void)
+{
+	spin_lock_irq(&tunnel.lock);
+	if (!tunnel.ops) {
+		spin_unlock_irq(&tunnel.lock);
+		return;
+	}
+	list_splice_tail_init(&tunnel.queue, &tunnel.done);
+	tunnel.unbinding = true;
+	spin_unlock_irq(&tunnel.lock);
+
+	/* The sink switches back to its own buffer at the next vsync */
+	if (!wait_event_timeout(tunnel.wq, !READ_ONCE(tunnel.shown),
+				TUNNEL_UNBIND_TIMEOUT)) {
+		/* No vsync, nothing is being scanned out */
+		spin_lock_irq(&tunnel.lock);
+		if (tunnel.shown)
+			list_add_tail(&tunnel.shown->list, &tunnel.done);
+		tunnel.shown = NULL;
+		spin_unlock_irq(&tunnel.lock);
+	}
+
+	flush_work(&tunnel.release_work);
+	meson_tunnel_release_done();
+
+	spin_lock_irq(&tunnel.lock);
+	tunnel.ops = NULL;
+	tunnel.data = NULL;
+	tunnel.unbinding = false;
+	spin_unlock_irq(&tunnel.lock);
+}
+EXPORT_SYMBOL_GPL(meson_tunnel_unbind);
+
+void meson_tunnel_queue(struct meson_tunnel_frame *frame)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&tunnel.lock, flags);
+	if (tunnel.registered && !tunnel.unbinding) {
+		list_add_tail(&frame->list, &tunnel.queue);
+	} else {
+		list_add_tail(&frame->list, &tunnel.done);
+		schedule_work(&tunnel.release_work);
+	}
+	spin_unlock_irqrestore(&tunnel.lock, flags);
+}
+EXPORT_SYMBOL_GPL(meson_tunnel_queue);
+
+void meson_tunnel_flush(void)
+{
+	spin_lock_irq(&tunnel.lock);
+	list_splice_tail_init(&tunnel.queue, &tunnel.done);
+	tunnel.synced = false;
+	spin_unlock_irq(&tunnel.lock);
+
+	schedule_work(&tunnel.release_work);
+}
+EXPORT_SYMBOL_GPL(meson_tunnel_flush);
+
+void meson_tunnel_set_paused(bool paused)
+{
+	u64 now = ktime_get_ns();
+
+	spin_lock_irq(&tunnel.lock);
+	if (paused && !tunnel.paused)
+		tunnel.paused_ns = now;
+	else if (!paused && tunnel.paused)
+		tunnel.base_ns += now - tunnel.paused_ns;
+	tunnel.paused = paused;
+	spin_unlock_irq(&tunnel.lock);
+}
+EXPORT_SYMBOL_GPL(meson_tunnel_set_paused);
+
+void meson_tunnel_set_offset(s64 offset)
+{
+	spin_lock_irq(&tunnel.lock);
+	tunnel.offset = clamp_t(s64, offset, -TUNNEL_MAX_OFFSET_NS,
+				TUNNEL_MAX_OFFSET_NS);
+	spin_unlock_irq(&tunnel.lock);
+}
+EXPORT_SYMBOL_GPL(meson_tunnel_set_offset);
+
+int meson_tunnel_sink_register(void)
+{
+	int ret = 0;
+
+	spin_lock_irq(&tunnel.lock);
+	if (tunnel.registered)
+		ret = -EBUSY;
+	tunnel.registered = true;
+	tunnel.last_vsync = 0;
+	tunnel.period = 0;
+	spin_unlock_irq(&tunnel.lock);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(meson_tunnel_sink_register);
+
+void meson_tunnel_sink_unregister(void)
+{
+	/* The producer gets all of its frames back, and no new one is shown */
+	spin_lock_irq(&tunnel.lock);
+	tunnel.registered = false;
+	list_splice_tail_init(&tunnel.queue, &tunnel.done);
+	if (tunnel.shown)
+		list_add_tail(&tunnel.shown->list, &tunnel.done);
+	tunnel.shown = NULL;
+	spin_unlock_irq(&tunnel.lock);
+
+	wake_up(&tunnel.wq);
+	schedule_work(&tunnel.release_work);
+}
+EXPORT_SYMBOL_GPL(meson_tunnel_sink_unregister);
+
+struct meson_tunnel_frame *meson_tunnel_vsync(u64 now, bool *changed)
+{
+	struct meson_tunnel_frame *frame, *next = NULL;
+	u64 deadline;
+	s64 due;
+
+	*changed = false;
+
+	spin_lock(&tunnel.lock);
+
+	if (tunnel.last_vsync)
+		tunnel.period = now - tunnel.last_vsync;
+	tunnel.last_vsync = now;
+
+	if (tunnel.unbinding) {
+		if (tunnel.shown) {
+			list_add_tail(&tunnel.shown->list, &tunnel.done);
+			tunnel.shown = NULL;
+			*changed = true;
+			wake_up(&tunnel.wq);
+		}
+		goto out;
+	}
+
+	if (tunnel.paused)
+		goto out;
+
+	/* Show the last frame due by the middle of the coming one */
+	deadline = now + tunnel.period / 2;
+	while ((frame = list_first_entry_or_null(&tunnel.queue,
+						 struct meson_tunnel_frame,
+						 list))) {
+		if (!tunnel.synced) {
+			tunnel.base_ns = now;
+			tunnel.base_ts = frame->timestamp;
+			tunnel.synced = true;
+		}
+
+		due = (s64)(tunnel.base_ns - deadline) + tunnel.offset +
+		      (s64)(frame->timestamp - tunnel.base_ts);
+		if (due > TUNNEL_MAX_WAIT_NS) {
+			tunnel.synced = false;
+			continue;
+		}
+		if (due > 0)
+			break;
+
+		/* The previous candidate is late, drop it */
+		list_del(&frame->list);
+		if (next)
+			list_add_tail(&next->list, &tunnel.done);
+		next = frame;
+	}
+
+	if (next) {
+		if (tunnel.shown)
+			list_add_tail(&tunnel.shown->list, &tunnel.done);
+		tunnel.shown = next;
+		*changed = true;
+	}
+
+out:
+	if (!list_empty(&tunnel.done))
+		schedule_work(&tunnel.release_work);
+	frame = tunnel.shown;
+	spin_unlock(&tunnel.lock);
+
+	return frame;
+}
+EXPORT_SYMBOL_GPL(meson_tunnel_vsync);
+
+MODULE_DESCRIPTION("Amlogic Meson decoder to display tunnel");
+MODULE_LICENSE("GPL");
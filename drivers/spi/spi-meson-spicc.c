@@ -10,8 +10,11 @@
 #include <linux/bitfield.h>
 #include <linux/clk.h>
 #include <linux/device.h>
+#include <linux/dma-mapping.h>
 #include <linux/io.h>
+#include <linux/iopoll.h>
 #include <linux/kernel.h>
+#include <linux/lat_hist.h>
 #include <linux/module.h>
 #include <linux/of.h>
 #include <linux/platform_device.h>
@@ -20,18 +23,25 @@
 #include <linux/interrupt.h>
 #include <linux/reset.h>
 #include <linux/gpio.h>
+#include <asm/unaligned.h>
 
 /*
- * The Meson SPICC controller could support DMA based transfers, but is not
- * implemented by the vendor code, and while having the registers documentation
- * it has never worked on the GXL Hardware.
- * The PIO mode is the only mode implemented, and due to badly designed HW :
+ * The Meson SPICC controller has a PIO mode and a DMA mode.
+ * In PIO mode, due to badly designed HW :
  * - all transfers are cutted in 16 words burst because the FIFO hangs on
  *   TX underflow, and there is no TX "Half-Empty" interrupt, so we go by
  *   FIFO max size chunk only
  * - CS management is dumb, and goes UP between every burst, so is really a
  *   "Data Valid" signal than a Chip Select, GPIO link should be used instead
  *   to have a CS go down over the full transfer
+ * In DMA mode, the FIFO is fed by the DMA engine so the bursts can be as
+ * long as the controller allows, but the engine only moves 64bit words :
+ * - the data goes through a pair of bounce buffers, mapped once at probe,
+ *   where the words of the transfer are reordered into 64bit words
+ * - bursts are a multiple of the DMA request size, the remaining tail of
+ *   a transfer is done in PIO mode
+ * Transfers fitting in a single short burst are polled for completion
+ * instead of waiting for the interrupt.
  */
 
 #define SPICC_MAX_FREQ	30000000
@@ -120,6 +130,15 @@
 #define SPICC_BURST_MAX	16
 #define SPICC_FIFO_HALF 10
 
+/* Transfers shorter than this are not worth the DMA setup */
+#define SPICC_DMA_MIN_LEN	256
+/* 64bit words moved per DMA request, FIFO thresholds match it */
+#define SPICC_DMA_BURST		8
+#define SPICC_DMA_BUF_SIZE	(SPICC_MAX_BURST * sizeof(u64))
+
+/* Longest single burst transfer completed by polling */
+#define SPICC_POLL_MAX_US	25
+
 struct meson_spicc_device {
 	struct spi_master		*master;
 	struct platform_device		*pdev;
@@ -137,6 +156,20 @@ struct meson_spicc_device {
 	unsigned long			xfer_remain;
 	bool				is_burst_end;
 	bool				is_last_burst;
+	bool				is_dma;
+	bool				is_hw_setup;
+	u32				mode_conf;
+	u32				speed_hz;
+	unsigned long			real_speed_hz;
+	unsigned int			datarate;
+	unsigned int			dma_words;
+	u8				*tx_dma_buf;
+	u8				*rx_dma_buf;
+	dma_addr_t			tx_dma;
+	dma_addr_t			rx_dma;
+	struct lat_hist			*irq_hist;
+	struct lat_hist			*xfer_hist;
+	u64				xfer_ns;
 };
 
 static inline bool meson_spicc_txfull(struct meson_spicc_device *spicc)
@@ -236,11 +269,166 @@ static inline void meson_spicc_setup_burst(struct meson_spicc_device *spicc,
 	meson_spicc_tx(spicc);
 }
 
-static irqreturn_t meson_spicc_irq(int irq, void *data)
+static bool meson_spicc_can_dma(struct meson_spicc_device *spicc,
+				struct spi_transfer *xfer)
 {
-	struct meson_spicc_device *spicc = (void *) data;
-	u32 ctrl = readl_relaxed(spicc->base + SPICC_INTREG);
-	u32 stat = readl_relaxed(spicc->base + SPICC_STATREG) & ctrl;
+	if (!spicc->tx_dma_buf || xfer->len < SPICC_DMA_MIN_LEN)
+		return false;
+
+	/* Words must be packed in 64bit DMA words */
+	return spicc->bytes_per_word != 3;
+}
+
+/*
+ * The 64bit DMA words are shifted out MSB first, reverse the order of
+ * the SPI words they hold so that they go on the wire in memory order.
+ * This is its own inverse and also applies to the received words.
+ */
+static inline u64 meson_spicc_dma_swap(struct meson_spicc_device *spicc,
+				       u64 data)
+{
+	switch (spicc->bytes_per_word) {
+	case 1:
+		return swab64(data);
+	case 2:
+		data = ror64(data, 32);
+		return ((data & 0x0000ffff0000ffffULL) << 16) |
+		       ((data >> 16) & 0x0000ffff0000ffffULL);
+	default:
+		return ror64(data, 32);
+	}
+}
+
+static void meson_spicc_setup_dma_burst(struct meson_spicc_device *spicc)
+{
+	struct device *dev = &spicc->pdev->dev;
+	unsigned int words, i;
+	size_t len;
+
+	words = min_t(unsigned int,
+		      rounddown(spicc->xfer_remain / sizeof(u64),
+				SPICC_DMA_BURST),
+		      SPICC_MAX_BURST);
+	len = words * sizeof(u64);
+
+	for (i = 0; i < words; i++) {
+		put_unaligned_le64(meson_spicc_dma_swap(spicc,
+					get_unaligned_le64(spicc->tx_buf)),
+				   spicc->tx_dma_buf + i * sizeof(u64));
+		spicc->tx_buf += sizeof(u64);
+	}
+
+	dma_sync_single_for_device(dev, spicc->tx_dma, len, DMA_TO_DEVICE);
+	dma_sync_single_for_device(dev, spicc->rx_dma, len, DMA_FROM_DEVICE);
+
+	spicc->dma_words = words;
+	spicc->xfer_remain -= len;
+
+	writel_relaxed(spicc->tx_dma, spicc->base + SPICC_DRADDR);
+	writel_relaxed(spicc->rx_dma, spicc->base + SPICC_DWADDR);
+
+	/* Burst length is the number of words minus one */
+	writel_bits_relaxed(SPICC_BURSTLENGTH_MASK,
+			FIELD_PREP(SPICC_BURSTLENGTH_MASK, words - 1),
+			spicc->base + SPICC_CONREG);
+
+	writel_relaxed(SPICC_DMA_ENABLE |
+		       FIELD_PREP(SPICC_TXFIFO_THRESHOLD_MASK,
+				  SPICC_DMA_BURST) |
+		       FIELD_PREP(SPICC_RXFIFO_THRESHOLD_MASK,
+				  SPICC_DMA_BURST - 1) |
+		       FIELD_PREP(SPICC_READ_BURST_MASK,
+				  SPICC_DMA_BURST - 1) |
+		       FIELD_PREP(SPICC_WRITE_BURST_MASK,
+				  SPICC_DMA_BURST - 1) |
+		       FIELD_PREP(SPICC_DMA_BURSTNUM_MASK,
+				  words / SPICC_DMA_BURST - 1),
+		       spicc->base + SPICC_DMAREG);
+}
+
+static void meson_spicc_dma_rx(struct meson_spicc_device *spicc)
+{
+	struct device *dev = &spicc->pdev->dev;
+	unsigned int i;
+
+	dma_sync_single_for_cpu(dev, spicc->rx_dma,
+				spicc->dma_words * sizeof(u64),
+				DMA_FROM_DEVICE);
+
+	for (i = 0; i < spicc->dma_words; i++) {
+		put_unaligned_le64(meson_spicc_dma_swap(spicc,
+					get_unaligned_le64(spicc->rx_dma_buf +
+							   i * sizeof(u64))),
+				   spicc->rx_buf);
+		spicc->rx_buf += sizeof(u64);
+	}
+}
+
+static void meson_spicc_setup_word_width(struct meson_spicc_device *spicc,
+					 unsigned int bits)
+{
+	writel_bits_relaxed(SPICC_BITLENGTH_MASK,
+			    FIELD_PREP(SPICC_BITLENGTH_MASK, bits - 1),
+			    spicc->base + SPICC_CONREG);
+}
+
+static irqreturn_t meson_spicc_dma_irq(struct meson_spicc_device *spicc)
+{
+	unsigned int burst_len;
+
+	if (!(readl_relaxed(spicc->base + SPICC_STATREG) & SPICC_TC))
+		return IRQ_NONE;
+
+	/* Clear TC bit */
+	writel_relaxed(SPICC_TC, spicc->base + SPICC_STATREG);
+
+	meson_spicc_dma_rx(spicc);
+
+	if (spicc->xfer_remain >= SPICC_DMA_BURST * sizeof(u64)) {
+		meson_spicc_setup_dma_burst(spicc);
+
+		/* Restart burst */
+		writel_bits_relaxed(SPICC_XCH, SPICC_XCH,
+				    spicc->base + SPICC_CONREG);
+
+		return IRQ_HANDLED;
+	}
+
+	writel_relaxed(0, spicc->base + SPICC_DMAREG);
+	spicc->is_dma = false;
+
+	if (!spicc->xfer_remain) {
+		/* Disable all IRQs */
+		writel(0, spicc->base + SPICC_INTREG);
+
+		lat_hist_record_since(spicc->xfer_hist, spicc->xfer_ns);
+		spi_finalize_current_transfer(spicc->master);
+
+		return IRQ_HANDLED;
+	}
+
+	/* Finish the tail of the transfer in PIO mode */
+	meson_spicc_setup_word_width(spicc, spicc->bytes_per_word << 3);
+
+	burst_len = min_t(unsigned int,
+			  spicc->xfer_remain / spicc->bytes_per_word,
+			  SPICC_BURST_MAX);
+
+	meson_spicc_setup_burst(spicc, burst_len);
+
+	writel_bits_relaxed(SPICC_XCH, SPICC_XCH, spicc->base + SPICC_CONREG);
+
+	writel(meson_spicc_setup_rx_irq(spicc, 0), spicc->base + SPICC_INTREG);
+
+	return IRQ_HANDLED;
+}
+
+static irqreturn_t meson_spicc_pio_irq(struct meson_spicc_device *spicc)
+{
+	u32 ctrl, stat;
+
+	ctrl = readl_relaxed(spicc->base + SPICC_INTREG);
+	stat = readl_relaxed(spicc->base + SPICC_STATREG) & ctrl;
 
 	ctrl &= ~(SPICC_RH_EN | SPICC_RR_EN);
 
@@ -272,6 +460,7 @@ static irqreturn_t meson_spicc_irq(int irq, void *data)
 			/* Disable all IRQs */
 			writel(0, spicc->base + SPICC_INTREG);
 
+			lat_hist_record_since(spicc->xfer_hist, spicc->xfer_ns);
 			spi_finalize_current_transfer(spicc->master);
 
 			return IRQ_HANDLED;
@@ -298,12 +487,32 @@ static irqreturn_t meson_spicc_irq(int irq, void *data)
 	return IRQ_HANDLED;
 }
 
+static irqreturn_t meson_spicc_irq(int irq, void *data)
+{
+	struct meson_spicc_device *spicc = (void *) data;
+	u64 start = lat_hist_now();
+	irqreturn_t ret;
+
+	if (spicc->is_dma)
+		ret = meson_spicc_dma_irq(spicc);
+	else
+		ret = meson_spicc_pio_irq(spicc);
+
+	lat_hist_record_since(spicc->irq_hist, start);
+
+	return ret;
+}
+
 static u32 meson_spicc_setup_speed(struct meson_spicc_device *spicc, u32 conf,
 				   u32 speed)
 {
 	unsigned long parent, value;
 	unsigned int i, div;
 
+	/* Avoid going through the clock framework for each transfer */
+	if (speed == spicc->speed_hz)
+		goto out;
+
 	parent = clk_get_rate(spicc->core);
 
 	/* Find closest inferior/equal possible speed */
@@ -326,8 +535,13 @@ static u32 meson_spicc_setup_speed(struct meson_spicc_device *spicc, u32 conf,
 	dev_dbg(&spicc->pdev->dev, "parent %lu, speed %u -> %lu (%u)\n",
 		parent, speed, value, div);
 
+	spicc->speed_hz = speed;
+	spicc->real_speed_hz = value;
+	spicc->datarate = div;
+
+out:
 	conf &= ~SPICC_DATARATE_MASK;
-	conf |= FIELD_PREP(SPICC_DATARATE_MASK, div);
+	conf |= FIELD_PREP(SPICC_DATARATE_MASK, spicc->datarate);
 
 	return conf;
 }
@@ -353,6 +567,46 @@ static void meson_spicc_setup_xfer(struct meson_spicc_device *spicc,
 		writel_relaxed(conf, spicc->base + SPICC_CONREG);
 }
 
+static bool meson_spicc_can_poll(struct meson_spicc_device *spicc,
+				 unsigned int burst_len)
+{
+	u64 bits = (u64)burst_len * (spicc->bytes_per_word << 3);
+
+	if (burst_len * spicc->bytes_per_word != spicc->xfer_remain)
+		return false;
+
+	return div64_ul(bits * USEC_PER_SEC, spicc->real_speed_hz) <=
+	       SPICC_POLL_MAX_US;
+}
+
+static int meson_spicc_transfer_polled(struct meson_spicc_device *spicc,
+				       unsigned int burst_len)
+{
+	u32 stat;
+	int ret;
+
+	meson_spicc_setup_burst(spicc, burst_len);
+
+	/* Start burst */
+	writel_bits_relaxed(SPICC_XCH, SPICC_XCH, spicc->base + SPICC_CONREG);
+
+	ret = readl_relaxed_poll_timeout_atomic(spicc->base + SPICC_STATREG,
+						stat, stat & SPICC_TC, 0,
+						10 * SPICC_POLL_MAX_US);
+	if (ret) {
+		dev_err(&spicc->pdev->dev, "polled transfer timed out\n");
+		return ret;
+	}
+
+	/* Clear TC bit */
+	writel_relaxed(SPICC_TC, spicc->base + SPICC_STATREG);
+
+	/* Empty RX FIFO */
+	meson_spicc_rx(spicc);
+
+	return 0;
+}
+
 static int meson_spicc_transfer_one(struct spi_master *master,
 				    struct spi_device *spi,
 				    struct spi_transfer *xfer)
@@ -363,6 +617,7 @@ static int meson_spicc_transfer_one(struct spi_master *master,
 
 	/* Store current transfer */
 	spicc->xfer = xfer;
+	spicc->xfer_ns = lat_hist_now();
 
 	/* Setup transfer parameters */
 	spicc->tx_buf = (u8 *)xfer->tx_buf;
@@ -376,10 +631,29 @@ static int meson_spicc_transfer_one(struct spi_master *master,
 	/* Setup transfer parameters */
 	meson_spicc_setup_xfer(spicc, xfer);
 
+	spicc->is_dma = meson_spicc_can_dma(spicc, xfer);
+	if (spicc->is_dma) {
+		meson_spicc_setup_word_width(spicc, 64);
+		meson_spicc_setup_dma_burst(spicc);
+
+		/* Start burst */
+		writel_bits_relaxed(SPICC_XCH, SPICC_XCH,
+				    spicc->base + SPICC_CONREG);
+
+		/* Only the transfer complete interrupt is needed */
+		writel_relaxed(SPICC_TC_EN, spicc->base + SPICC_INTREG);
+
+		return 1;
+	}
+
 	burst_len = min_t(unsigned int,
 			  spicc->xfer_remain / spicc->bytes_per_word,
 			  SPICC_BURST_MAX);
 
+	/* Short single burst, not worth an interrupt round-trip */
+	if (meson_spicc_can_poll(spicc, burst_len))
+		return meson_spicc_transfer_polled(spicc, burst_len);
+
 	meson_spicc_setup_burst(spicc, burst_len);
 
 	irq = meson_spicc_setup_rx_irq(spicc, irq);
@@ -437,6 +711,19 @@ static int meson_spicc_prepare_message(struct spi_master *master,
 
 	/* Default Clock rate core/4 */
 
+	/*
+	 * Keep the controller as left by the previous message of the same
+	 * device, the clock rate and word width are updated per transfer
+	 * only when they change.
+	 */
+	if (spicc->is_hw_setup && conf == spicc->mode_conf)
+		return 0;
+
+	spicc->mode_conf = conf;
+
+	/* Keep the last clock rate */
+	conf |= FIELD_PREP(SPICC_DATARATE_MASK, spicc->datarate);
+
 	/* Default 8bit word */
 	conf |= FIELD_PREP(SPICC_BITLENGTH_MASK, 8 - 1);
 
@@ -447,6 +734,8 @@ static int meson_spicc_prepare_message(struct spi_master *master,
 
 	writel_bits_relaxed(BIT(24), BIT(24), spicc->base + SPICC_TESTREG);
 
+	spicc->is_hw_setup = true;
+
 	return 0;
 }
 
@@ -457,6 +746,13 @@ static int meson_spicc_unprepare_transfer(struct spi_master *master)
 	/* Disable all IRQs */
 	writel(0, spicc->base + SPICC_INTREG);
 
+	/* Disable DMA */
+	writel_relaxed(0, spicc->base + SPICC_DMAREG);
+	spicc->is_dma = false;
+
+	/* The reset below loses the cached configuration */
+	spicc->is_hw_setup = false;
+
 	/* Disable controller */
 	writel_bits_relaxed(SPICC_ENABLE, 0, spicc->base + SPICC_CONREG);
 
@@ -499,6 +795,50 @@ static void meson_spicc_cleanup(struct spi_device *spi)
 	spi->controller_state = NULL;
 }
 
+static void meson_spicc_dma_init(struct meson_spicc_device *spicc)
+{
+	struct device *dev = &spicc->pdev->dev;
+	u8 *buf;
+
+	buf = devm_kzalloc(dev, 2 * SPICC_DMA_BUF_SIZE, GFP_KERNEL);
+	if (!buf)
+		goto out_pio;
+
+	spicc->tx_dma = dma_map_single(dev, buf, SPICC_DMA_BUF_SIZE,
+				       DMA_TO_DEVICE);
+	if (dma_mapping_error(dev, spicc->tx_dma))
+		goto out_pio;
+
+	spicc->rx_dma = dma_map_single(dev, buf + SPICC_DMA_BUF_SIZE,
+				       SPICC_DMA_BUF_SIZE, DMA_FROM_DEVICE);
+	if (dma_mapping_error(dev, spicc->rx_dma)) {
+		dma_unmap_single(dev, spicc->tx_dma, SPICC_DMA_BUF_SIZE,
+				 DMA_TO_DEVICE);
+		goto out_pio;
+	}
+
+	spicc->tx_dma_buf = buf;
+	spicc->rx_dma_buf = buf + SPICC_DMA_BUF_SIZE;
+
+	return;
+
+out_pio:
+	dev_warn(dev, "DMA setup failed, using PIO only\n");
+}
+
+static void meson_spicc_dma_exit(struct meson_spicc_device *spicc)
+{
+	struct device *dev = &spicc->pdev->dev;
+
+	if (!spicc->tx_dma_buf)
+		return;
+
+	dma_unmap_single(dev, spicc->tx_dma, SPICC_DMA_BUF_SIZE,
+			 DMA_TO_DEVICE);
+	dma_unmap_single(dev, spicc->rx_dma, SPICC_DMA_BUF_SIZE,
+			 DMA_FROM_DEVICE);
+}
+
 static int meson_spicc_probe(struct platform_device *pdev)
 {
 	struct spi_master *master;
@@ -525,8 +865,13 @@ static int meson_spicc_probe(struct platform_device *pdev)
 		goto out_master;
 	}
 
-	/* Disable all IRQs */
+	/* Disable all IRQs and DMA */
 	writel_relaxed(0, spicc->base + SPICC_INTREG);
+	writel_relaxed(0, spicc->base + SPICC_DMAREG);
+
+	/* Only the transfers completed from the interrupt are timed */
+	spicc->irq_hist = devm_lat_hist_add(&pdev->dev, "irq");
+	spicc->xfer_hist = devm_lat_hist_add(&pdev->dev, "transfer");
 
 	irq = platform_get_irq(pdev, 0);
 	ret = devm_request_irq(&pdev->dev, irq, meson_spicc_irq,
@@ -552,6 +897,8 @@ static int meson_spicc_probe(struct platform_device *pdev)
 
 	device_reset_optional(&pdev->dev);
 
+	meson_spicc_dma_init(spicc);
+
 	master->num_chipselect = 4;
 	master->dev.of_node = pdev->dev.of_node;
 	master->mode_bits = SPI_CPHA | SPI_CPOL | SPI_CS_HIGH;
@@ -582,6 +929,7 @@ static int meson_spicc_probe(struct platform_device *pdev)
 	return 0;
 
 out_clk:
+	meson_spicc_dma_exit(spicc);
 	clk_disable_unprepare(spicc->core);
 
 out_master:
@@ -597,6 +945,8 @@ static int meson_spicc_remove(struct platform_device *pdev)
 	/* Disable SPI */
 	writel(0, spicc->base + SPICC_CONREG);
 
+	meson_spicc_dma_exit(spicc);
+
 	clk_disable_unprepare(spicc->core);
 
 	return 0;
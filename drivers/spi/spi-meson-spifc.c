@@ -22,6 +22,7 @@
 #include <linux/pm_runtime.h>
 #include <linux/regmap.h>
 #include <linux/spi/spi.h>
+#include <linux/spi/spi-mem.h>
 #include <linux/types.h>
 
 /* register map */
@@ -47,7 +48,14 @@
 
 /* register fields */
 #define CMD_USER		BIT(18)
+#define CTRL_FAST_READ		BIT(13)
+#define CTRL_DUAL_OUT		BIT(14)
 #define CTRL_ENABLE_AHB		BIT(17)
+#define CTRL_QUAD_OUT		BIT(20)
+#define CTRL_DUAL_IO		BIT(23)
+#define CTRL_QUAD_IO		BIT(24)
+#define CTRL_READ_MASK		(CTRL_FAST_READ | CTRL_DUAL_OUT | \
+				 CTRL_QUAD_OUT | CTRL_DUAL_IO | CTRL_QUAD_IO)
 #define CLOCK_SOURCE		BIT(31)
 #define CLOCK_DIV_SHIFT		12
 #define CLOCK_DIV_MASK		(0x3f << CLOCK_DIV_SHIFT)
@@ -77,12 +85,41 @@
  * @regmap:	regmap for device registers
  * @clk:	input clock of the built-in baud rate generator
  * @device:	the device structure
+ * @ahb:	memory mapped read window of the flash, if any
+ * @ahb_size:	size of the memory mapped read window
  */
 struct meson_spifc {
 	struct spi_master *master;
 	struct regmap *regmap;
 	struct clk *clk;
 	struct device *dev;
+	void __iomem *ahb;
+	resource_size_t ahb_size;
+};
+
+/**
+ * struct meson_spifc_read_mode - read command of the AHB interface
+ * @opcode:	read opcode
+ * @addr_buswidth: bus width of the address and dummy cycles
+ * @data_buswidth: bus width of the data
+ * @dummy_nbytes: number of dummy bytes sent by the controller
+ * @ctrl:	read mode bits of the CTRL register
+ */
+struct meson_spifc_read_mode {
+	u8 opcode;
+	u8 addr_buswidth;
+	u8 data_buswidth;
+	u8 dummy_nbytes;
+	u32 ctrl;
+};
+
+static const struct meson_spifc_read_mode meson_spifc_read_modes[] = {
+	{ 0x03, 1, 1, 0, 0 },
+	{ 0x0b, 1, 1, 1, CTRL_FAST_READ },
+	{ 0x3b, 1, 2, 1, CTRL_DUAL_OUT },
+	{ 0x6b, 1, 4, 1, CTRL_QUAD_OUT },
+	{ 0xbb, 2, 2, 1, CTRL_DUAL_IO },
+	{ 0xeb, 4, 4, 3, CTRL_QUAD_IO },
 };
 
 static const struct regmap_config spifc_regmap_config = {
@@ -273,6 +310,98 @@ static int meson_spifc_transfer_one(struct spi_master *master,
 	return ret;
 }
 
+/**
+ * meson_spifc_get_read_mode() - find the AHB read mode matching an operation
+ * @spifc:	the Meson SPI device
+ * @op:		the memory operation
+ * Return:	the read mode, NULL if the operation can't go through the AHB
+ *		interface
+ */
+static const struct meson_spifc_read_mode *
+meson_spifc_get_read_mode(struct meson_spifc *spifc,
+			  const struct spi_mem_op *op)
+{
+	const struct meson_spifc_read_mode *mode;
+	int i;
+
+	if (!spifc->ahb || op->data.dir != SPI_MEM_DATA_IN ||
+	    op->cmd.buswidth != 1 || op->addr.nbytes != 3 ||
+	    op->addr.val + op->data.nbytes > spifc->ahb_size)
+		return NULL;
+
+	for (i = 0; i < ARRAY_SIZE(meson_spifc_read_modes); i++) {
+		mode = &meson_spifc_read_modes[i];
+
+		if (op->cmd.opcode == mode->opcode &&
+		    op->addr.buswidth == mode->addr_buswidth &&
+		    op->data.buswidth == mode->data_buswidth &&
+		    op->dummy.nbytes == mode->dummy_nbytes &&
+		    (!op->dummy.nbytes ||
+		     op->dummy.buswidth == mode->addr_buswidth))
+			return mode;
+	}
+
+	return NULL;
+}
+
+/**
+ * meson_spifc_supports_op() - check if an operation is supported
+ * @mem:	the SPI memory
+ * @op:		the memory operation
+ * Return:	true if the operation is supported
+ *
+ * Only the AHB interface handles dual and quad reads, every other operation
+ * goes through the single bit user command of transfer_one().
+ */
+static bool meson_spifc_supports_op(struct spi_mem *mem,
+				    const struct spi_mem_op *op)
+{
+	struct meson_spifc *spifc =
+		spi_master_get_devdata(mem->spi->master);
+
+	if (meson_spifc_get_read_mode(spifc, op))
+		return true;
+
+	return op->cmd.buswidth == 1 &&
+	       (!op->addr.nbytes || op->addr.buswidth == 1) &&
+	       (!op->dummy.nbytes || op->dummy.buswidth == 1) &&
+	       (!op->data.nbytes || op->data.buswidth == 1);
+}
+
+/**
+ * meson_spifc_exec_op() - read the flash through the AHB interface
+ * @mem:	the SPI memory
+ * @op:		the memory operation
+ * Return:	0 on success, -ENOTSUPP to let the core use transfer_one()
+ */
+static int meson_spifc_exec_op(struct spi_mem *mem,
+			       const struct spi_mem_op *op)
+{
+	struct meson_spifc *spifc =
+		spi_master_get_devdata(mem->spi->master);
+	const struct meson_spifc_read_mode *mode;
+
+	mode = meson_spifc_get_read_mode(spifc, op);
+	if (!mode)
+		return -ENOTSUPP;
+
+	meson_spifc_setup_speed(spifc, mem->spi->max_speed_hz);
+
+	regmap_update_bits(spifc->regmap, REG_CTRL,
+			   CTRL_READ_MASK | CTRL_ENABLE_AHB,
+			   mode->ctrl | CTRL_ENABLE_AHB);
+
+	memcpy_fromio(op->data.buf.in, spifc->ahb + op->addr.val,
+		      op->data.nbytes);
+
+	return 0;
+}
+
+static const struct spi_controller_mem_ops meson_spifc_mem_ops = {
+	.supports_op = meson_spifc_supports_op,
+	.exec_op = meson_spifc_exec_op,
+};
+
 /**
  * meson_spifc_hw_init() - reset and initialize the SPI controller
  * @spifc:	the Meson SPI device
@@ -320,6 +449,17 @@ static int meson_spifc_probe(struct platform_device *pdev)
 		goto out_err;
 	}
 
+	/* optional memory mapped read window */
+	res = platform_get_resource(pdev, IORESOURCE_MEM, 1);
+	if (res) {
+		spifc->ahb = devm_ioremap_resource(spifc->dev, res);
+		if (IS_ERR(spifc->ahb)) {
+			ret = PTR_ERR(spifc->ahb);
+			goto out_err;
+		}
+		spifc->ahb_size = resource_size(res);
+	}
+
 	spifc->clk = devm_clk_get(spifc->dev, NULL);
 	if (IS_ERR(spifc->clk)) {
 		dev_err(spifc->dev, "missing clock\n");
@@ -340,6 +480,9 @@ static int meson_spifc_probe(struct platform_device *pdev)
 	master->bits_per_word_mask = SPI_BPW_MASK(8);
 	master->auto_runtime_pm = true;
 	master->transfer_one = meson_spifc_transfer_one;
+	master->mem_ops = &meson_spifc_mem_ops;
+	if (spifc->ahb)
+		master->mode_bits = SPI_RX_DUAL | SPI_RX_QUAD;
 	master->min_speed_hz = rate >> 6;
 	master->max_speed_hz = rate >> 1;
 
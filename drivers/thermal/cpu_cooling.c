@@ -757,10 +757,31 @@ EXPORT_SYMBOL_GPL(cpufreq_cooling_register);
  */
 struct thermal_cooling_device *
 of_cpufreq_cooling_register(struct cpufreq_policy *policy)
+{
+	return of_cpufreq_power_cooling_register(policy, 0);
+}
+EXPORT_SYMBOL_GPL(of_cpufreq_cooling_register);
+
+/**
+ * of_cpufreq_power_cooling_register - create cpufreq cooling device with a
+ * default power model.
+ * @policy: cpufreq policy
+ * @capacitance: dynamic power coefficient used when the policy CPU node has
+ *	no "dynamic-power-coefficient" property
+ *
+ * Same as of_cpufreq_cooling_register(), for cpufreq drivers which can
+ * provide a power model of their own. The coefficient from the device tree
+ * takes precedence.
+ *
+ * Return: a valid struct thermal_cooling_device pointer on success,
+ * and NULL on failure.
+ */
+struct thermal_cooling_device *
+of_cpufreq_power_cooling_register(struct cpufreq_policy *policy,
+				  u32 capacitance)
 {
 	struct device_node *np = of_get_cpu_node(policy->cpu, NULL);
 	struct thermal_cooling_device *cdev = NULL;
-	u32 capacitance = 0;
 
 	if (!np) {
 		pr_err("cpu_cooling: OF node not available for cpu%d\n",
@@ -783,7 +804,7 @@ of_cpufreq_cooling_register(struct cpufreq_policy *policy)
 	of_node_put(np);
 	return cdev;
 }
-EXPORT_SYMBOL_GPL(of_cpufreq_cooling_register);
+EXPORT_SYMBOL_GPL(of_cpufreq_power_cooling_register);
 
 /**
  * cpufreq_cooling_unregister - function to remove cpufreq cooling device.
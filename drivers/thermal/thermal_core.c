@@ -289,9 +289,10 @@ static void thermal_unregister_governors(void)
 static void thermal_zone_device_set_polling(struct thermal_zone_device *tz,
 					    int delay)
 {
-	if (delay > 1000)
+	/* Polls of a second or more are batched on whole seconds */
+	if (delay >= 1000)
 		mod_delayed_work(system_freezable_wq, &tz->poll_queue,
-				 round_jiffies(msecs_to_jiffies(delay)));
+				 round_jiffies_relative(msecs_to_jiffies(delay)));
 	else if (delay)
 		mod_delayed_work(system_freezable_wq, &tz->poll_queue,
 				 msecs_to_jiffies(delay));
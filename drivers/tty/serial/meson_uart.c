@@ -12,6 +12,7 @@
 #include <linux/clk.h>
 #include <linux/console.h>
 #include <linux/delay.h>
+#include <linux/hrtimer.h>
 #include <linux/init.h>
 #include <linux/io.h>
 #include <linux/module.h>
@@ -75,6 +76,33 @@
 #define AML_UART_PORT_NUM		6
 #define AML_UART_DEV_NAME		"ttyAML"
 
+/* Characters of silence after which the RX FIFO is flushed */
+#define AML_UART_RX_IDLE_CHARS		4
+
+/**
+ * struct meson_uart_port - Meson UART port
+ * @port:	the UART port
+ * @rx_timer:	flushes the RX FIFO when the line goes idle
+ * @rx_trig:	RX FIFO interrupt threshold during bursts
+ * @rx_burst:	the RX FIFO threshold is raised to @rx_trig
+ * @rx_idle:	time after which a burst is over
+ * @char_ns:	time of a character on the line
+ *
+ * The UART has no RX timeout interrupt. The RX interrupt fires on the first
+ * character, the threshold is then raised to @rx_trig until the line stays
+ * idle for @rx_idle, when @rx_timer drains what is left in the FIFO and
+ * restores the single character threshold.
+ */
+struct meson_uart_port {
+	struct uart_port	port;
+	struct hrtimer		rx_timer;
+	unsigned int		rx_trig;
+	bool			rx_burst;
+	ktime_t			rx_idle;
+	unsigned int		char_ns;
+};
+
+#define to_meson_uart_port(p) container_of(p, struct meson_uart_port, port)
 
 static struct uart_driver meson_uart_driver;
 
@@ -116,12 +144,24 @@ static void meson_uart_stop_rx(struct uart_port *port)
 	writel(val, port->membase + AML_UART_CONTROL);
 }
 
+static void meson_uart_set_rx_irq(struct uart_port *port, unsigned int trig)
+{
+	u32 val;
+
+	val = readl(port->membase + AML_UART_MISC);
+	val &= ~AML_UART_RECV_IRQ(~0);
+	val |= AML_UART_RECV_IRQ(trig);
+	writel(val, port->membase + AML_UART_MISC);
+}
+
 static void meson_uart_shutdown(struct uart_port *port)
 {
+	struct meson_uart_port *mport = to_meson_uart_port(port);
 	unsigned long flags;
 	u32 val;
 
 	free_irq(port->irq, port);
+	hrtimer_cancel(&mport->rx_timer);
 
 	spin_lock_irqsave(&port->lock, flags);
 
@@ -231,14 +271,52 @@ static void meson_receive_chars(struct uart_port *port)
 	spin_lock(&port->lock);
 }
 
+static void meson_uart_rx_burst(struct uart_port *port)
+{
+	struct meson_uart_port *mport = to_meson_uart_port(port);
+
+	if (mport->rx_trig <= 1)
+		return;
+
+	if (!mport->rx_burst) {
+		meson_uart_set_rx_irq(port, mport->rx_trig);
+		mport->rx_burst = true;
+	}
+
+	hrtimer_start(&mport->rx_timer, mport->rx_idle, HRTIMER_MODE_REL);
+}
+
+static enum hrtimer_restart meson_uart_rx_timeout(struct hrtimer *timer)
+{
+	struct meson_uart_port *mport =
+		container_of(timer, struct meson_uart_port, rx_timer);
+	struct uart_port *port = &mport->port;
+	unsigned long flags;
+
+	spin_lock_irqsave(&port->lock, flags);
+
+	if (!(readl(port->membase + AML_UART_STATUS) & AML_UART_RX_EMPTY))
+		meson_receive_chars(port);
+
+	/* Interrupt again on the first character of the next burst */
+	meson_uart_set_rx_irq(port, 1);
+	mport->rx_burst = false;
+
+	spin_unlock_irqrestore(&port->lock, flags);
+
+	return HRTIMER_NORESTART;
+}
+
 static irqreturn_t meson_uart_interrupt(int irq, void *dev_id)
 {
 	struct uart_port *port = (struct uart_port *)dev_id;
 
 	spin_lock(&port->lock);
 
-	if (!(readl(port->membase + AML_UART_STATUS) & AML_UART_RX_EMPTY))
+	if (!(readl(port->membase + AML_UART_STATUS) & AML_UART_RX_EMPTY)) {
 		meson_receive_chars(port);
+		meson_uart_rx_burst(port);
+	}
 
 	if (!(readl(port->membase + AML_UART_STATUS) & AML_UART_TX_FULL)) {
 		if (readl(port->membase + AML_UART_CONTROL) & AML_UART_TX_INT_EN)
@@ -286,6 +364,7 @@ static int meson_uart_startup(struct uart_port *port)
 
 	val = (AML_UART_RECV_IRQ(1) | AML_UART_XMIT_IRQ(port->fifosize / 2));
 	writel(val, port->membase + AML_UART_MISC);
+	to_meson_uart_port(port)->rx_burst = false;
 
 	ret = request_irq(port->irq, meson_uart_interrupt, 0,
 			  port->name, port);
@@ -314,7 +393,8 @@ static void meson_uart_set_termios(struct uart_port *port,
 				   struct ktermios *termios,
 				   struct ktermios *old)
 {
-	unsigned int cflags, iflags, baud;
+	struct meson_uart_port *mport = to_meson_uart_port(port);
+	unsigned int cflags, iflags, baud, bits;
 	unsigned long flags;
 	u32 val;
 
@@ -378,6 +458,17 @@ static void meson_uart_set_termios(struct uart_port *port,
 					    AML_UART_FRAME_ERR;
 
 	uart_update_timeout(port, termios->c_cflag, baud);
+
+	/* start bit, data bits, parity and stop bits */
+	bits = 1 + 5 + ((cflags & CSIZE) >> 4) + 1;
+	if (cflags & PARENB)
+		bits++;
+	if (cflags & CSTOPB)
+		bits++;
+	mport->char_ns = DIV_ROUND_UP_ULL((u64)bits * NSEC_PER_SEC, baud);
+	mport->rx_idle = ns_to_ktime((u64)mport->char_ns *
+				     (mport->rx_trig + AML_UART_RX_IDLE_CHARS));
+
 	spin_unlock_irqrestore(&port->lock, flags);
 }
 
@@ -426,6 +517,55 @@ static void meson_uart_config_port(struct uart_port *port, int flags)
 	}
 }
 
+static ssize_t rx_trig_bytes_show(struct device *dev,
+				  struct device_attribute *attr, char *buf)
+{
+	struct tty_port *tport = dev_get_drvdata(dev);
+	struct uart_state *state = container_of(tport, struct uart_state, port);
+	struct meson_uart_port *mport = to_meson_uart_port(state->uart_port);
+
+	return sprintf(buf, "%u\n", mport->rx_trig);
+}
+
+static ssize_t rx_trig_bytes_store(struct device *dev,
+				   struct device_attribute *attr,
+				   const char *buf, size_t count)
+{
+	struct tty_port *tport = dev_get_drvdata(dev);
+	struct uart_state *state = container_of(tport, struct uart_state, port);
+	struct uart_port *port = state->uart_port;
+	struct meson_uart_port *mport = to_meson_uart_port(port);
+	unsigned long flags;
+	unsigned int trig;
+	int ret;
+
+	ret = kstrtouint(buf, 10, &trig);
+	if (ret)
+		return ret;
+
+	if (!trig || trig >= port->fifosize)
+		return -EINVAL;
+
+	spin_lock_irqsave(&port->lock, flags);
+	mport->rx_trig = trig;
+	mport->rx_idle = ns_to_ktime((u64)mport->char_ns *
+				     (trig + AML_UART_RX_IDLE_CHARS));
+	spin_unlock_irqrestore(&port->lock, flags);
+
+	return count;
+}
+
+static DEVICE_ATTR_RW(rx_trig_bytes);
+
+static struct attribute *meson_uart_attrs[] = {
+	&dev_attr_rx_trig_bytes.attr,
+	NULL,
+};
+
+static const struct attribute_group meson_uart_attr_group = {
+	.attrs = meson_uart_attrs,
+};
+
 static const struct uart_ops meson_uart_ops = {
 	.set_mctrl      = meson_uart_set_mctrl,
 	.get_mctrl      = meson_uart_get_mctrl,
@@ -652,6 +792,7 @@ static int meson_uart_probe_clocks(struct platform_device *pdev,
 static int meson_uart_probe(struct platform_device *pdev)
 {
 	struct resource *res_mem, *res_irq;
+	struct meson_uart_port *mport;
 	struct uart_port *port;
 	int ret = 0;
 
@@ -674,10 +815,12 @@ static int meson_uart_probe(struct platform_device *pdev)
 		return -EBUSY;
 	}
 
-	port = devm_kzalloc(&pdev->dev, sizeof(struct uart_port), GFP_KERNEL);
-	if (!port)
+	mport = devm_kzalloc(&pdev->dev, sizeof(*mport), GFP_KERNEL);
+	if (!mport)
 		return -ENOMEM;
 
+	port = &mport->port;
+
 	/* Use legacy way until all platforms switch to new bindings */
 	if (of_device_is_compatible(pdev->dev.of_node, "amlogic,meson-uart"))
 		ret = meson_uart_probe_clocks_legacy(pdev, port);
@@ -698,6 +841,12 @@ static int meson_uart_probe(struct platform_device *pdev)
 	port->x_char = 0;
 	port->ops = &meson_uart_ops;
 	port->fifosize = 64;
+	port->attr_group = &meson_uart_attr_group;
+
+	/* Interrupt on each character unless told otherwise */
+	mport->rx_trig = 1;
+	hrtimer_init(&mport->rx_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	mport->rx_timer.function = meson_uart_rx_timeout;
 
 	meson_ports[pdev->id] = port;
 	platform_set_drvdata(pdev, port);
@@ -125,6 +125,8 @@ struct dwc2_hsotg_req;
  * @desc_count: Count of entries within the DMA descriptor chain of EP.
  * @next_desc: index of next free descriptor in the ISOC chain under SW control.
  * @compl_desc: index of next descriptor to be completed by xFerComplete
+ * @chain_len: Number of requests in the non-ISOC DMA descriptor chain, when
+ *             more than one single descriptor request was chained.
  * @total_data: The total number of data bytes done.
  * @fifo_size: The size of the FIFO (for periodic IN endpoints)
  * @fifo_index: For Dedicated FIFO operation, only FIFO0 can be used for EP0.
@@ -179,6 +181,7 @@ struct dwc2_hsotg_ep {
 
 	unsigned int		next_desc;
 	unsigned int		compl_desc;
+	unsigned int		chain_len;
 
 	char                    name[10];
 };
@@ -323,6 +323,78 @@ static inline void dwc2_hsotg_create_debug(struct dwc2_hsotg *hsotg) {}
 
 /* dwc2_hsotg_delete_debug is removed as cleanup in done in dwc2_debugfs_exit */
 
+#if IS_ENABLED(CONFIG_USB_DWC2_HOST) || IS_ENABLED(CONFIG_USB_DWC2_DUAL_ROLE)
+
+static unsigned int dwc2_list_count(struct list_head *head)
+{
+	struct list_head *pos;
+	unsigned int count = 0;
+
+	list_for_each(pos, head)
+		count++;
+
+	return count;
+}
+
+/**
+ * periodic_show() - debugfs: show the host periodic schedule occupancy
+ * @seq: The seq file to write to.
+ * @v: Unused parameter.
+ *
+ * This debugfs entry shows the bandwidth claimed in each microframe of the
+ * high speed periodic schedule, along with the number of periodic QHs in
+ * each state and the host channels they use.
+ */
+static int periodic_show(struct seq_file *seq, void *v)
+{
+	struct dwc2_hsotg *hsotg = seq->private;
+	unsigned long flags;
+	int i, j;
+
+	spin_lock_irqsave(&hsotg->lock, flags);
+
+	seq_printf(seq, "descriptor dma: %s\n",
+		   hsotg->params.dma_desc_enable ? "enabled" : "disabled");
+	seq_printf(seq, "periodic_usecs: %u\n", hsotg->periodic_usecs);
+	seq_printf(seq, "periodic_qh_count: %u\n", hsotg->periodic_qh_count);
+	seq_printf(seq, "periodic_channels: %d\n", hsotg->periodic_channels);
+	seq_printf(seq, "non_periodic_channels: %d\n",
+		   hsotg->non_periodic_channels);
+	seq_printf(seq, "available_host_channels: %d\n",
+		   hsotg->available_host_channels);
+
+	seq_printf(seq, "qh inactive: %u ready: %u assigned: %u queued: %u\n",
+		   dwc2_list_count(&hsotg->periodic_sched_inactive),
+		   dwc2_list_count(&hsotg->periodic_sched_ready),
+		   dwc2_list_count(&hsotg->periodic_sched_assigned),
+		   dwc2_list_count(&hsotg->periodic_sched_queued));
+
+	for (i = 0; i < DWC2_HS_SCHEDULE_UFRAMES; i++) {
+		unsigned int start = i * DWC2_HS_PERIODIC_US_PER_UFRAME;
+		unsigned int used = 0;
+
+		for (j = 0; j < DWC2_HS_PERIODIC_US_PER_UFRAME; j++)
+			used += test_bit(start + j, hsotg->hs_periodic_bitmap);
+
+		seq_printf(seq, "uframe %d: %3u/%u us\n", i, used,
+			   DWC2_HS_PERIODIC_US_PER_UFRAME);
+	}
+
+	spin_unlock_irqrestore(&hsotg->lock, flags);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(periodic);
+
+static void dwc2_hcd_create_debug(struct dwc2_hsotg *hsotg)
+{
+	debugfs_create_file("periodic", 0444, hsotg->debug_root, hsotg,
+			    &periodic_fops);
+}
+#else
+static inline void dwc2_hcd_create_debug(struct dwc2_hsotg *hsotg) {}
+#endif
+
 #define dump_register(nm)	\
 {				\
 	.name	= #nm,		\
@@ -779,6 +851,9 @@ int dwc2_debugfs_init(struct dwc2_hsotg *hsotg)
 	/* Add gadget debugfs nodes */
 	dwc2_hsotg_create_debug(hsotg);
 
+	/* Add host debugfs nodes */
+	dwc2_hcd_create_debug(hsotg);
+
 	hsotg->regset = devm_kzalloc(hsotg->dev, sizeof(*hsotg->regset),
 								GFP_KERNEL);
 	if (!hsotg->regset) {
@@ -794,6 +794,58 @@ static void dwc2_gadget_config_nonisoc_xfer_ddma(struct dwc2_hsotg_ep *hs_ep,
 	}
 }
 
+/*
+ * dwc2_gadget_chain_nonisoc_ddma - chain queued requests after the first one.
+ * @hs_ep: The bulk or interrupt endpoint
+ * @hs_req: The request already programmed in the first descriptor
+ *
+ * Each following request which fits in one descriptor and needs no separate
+ * zero length packet gets the next descriptor, with IOC set, so that the core
+ * moves on to it without the endpoint being restarted from the interrupt
+ * handler. Requests queued once the chain is started wait for the next one.
+ */
+static void dwc2_gadget_chain_nonisoc_ddma(struct dwc2_hsotg_ep *hs_ep,
+					   struct dwc2_hsotg_req *hs_req)
+{
+	u32 mps = hs_ep->ep.maxpacket;
+	struct dwc2_dma_desc *desc;
+	u32 maxsize, len;
+	u32 mask = 0;
+
+	maxsize = dwc2_gadget_get_desc_params(hs_ep, &mask);
+
+	list_for_each_entry_continue(hs_req, &hs_ep->queue, queue) {
+		len = hs_req->req.length;
+
+		if (hs_ep->desc_count >= MAX_DMA_DESC_NUM_GENERIC || !len)
+			break;
+
+		/* Adjust length: OUT EPs - multiple of MPS */
+		if (!hs_ep->dir_in && (len % mps))
+			len += mps - (len % mps);
+		if (len > maxsize)
+			break;
+		if (hs_ep->dir_in && hs_req->req.zero && !(len % mps))
+			break;
+
+		desc = &hs_ep->desc_list[hs_ep->desc_count];
+		desc->buf = hs_req->req.dma;
+		desc->status = DEV_DMA_L | DEV_DMA_IOC |
+			       ((len << DEV_DMA_NBYTES_SHIFT) & mask) |
+			       (DEV_DMA_BUFF_STS_HREADY <<
+				DEV_DMA_BUFF_STS_SHIFT);
+		if (hs_ep->dir_in && (len % mps))
+			desc->status |= DEV_DMA_SHORT;
+
+		/* The chain isn't enabled yet, the core can't see this */
+		hs_ep->desc_list[hs_ep->desc_count - 1].status &= ~DEV_DMA_L;
+		hs_ep->desc_count++;
+	}
+
+	hs_ep->chain_len = hs_ep->desc_count > 1 ? hs_ep->desc_count : 0;
+	hs_ep->compl_desc = 0;
+}
+
 /*
  * dwc2_gadget_fill_isoc_desc - fills next isochronous descriptor in chain.
  * @hs_ep: The isochronous endpoint.
@@ -1064,6 +1116,11 @@ static void dwc2_hsotg_start_req(struct dwc2_hsotg *hsotg,
 		dwc2_gadget_config_nonisoc_xfer_ddma(hs_ep, ureq->dma + offset,
 						     length);
 
+		hs_ep->chain_len = 0;
+		if (index && !hs_ep->isochronous && !continuing &&
+		    hs_ep->desc_count == 1 && !hs_ep->send_zlp)
+			dwc2_gadget_chain_nonisoc_ddma(hs_ep, hs_req);
+
 		/* write descriptor chain address to control register */
 		dwc2_writel(hsotg, hs_ep->desc_list_dma, dma_reg);
 
@@ -2025,6 +2082,10 @@ static void dwc2_hsotg_complete_request(struct dwc2_hsotg *hsotg,
 	if (using_desc_dma(hsotg) && hs_ep->isochronous)
 		return;
 
+	/* Nor while the requests left in the chain are being transferred */
+	if (hs_ep->chain_len)
+		return;
+
 	/*
 	 * Look to see if there is anything else to do. Note, the completion
 	 * of the previous request may have caused a new request to be started
@@ -2035,6 +2096,57 @@ static void dwc2_hsotg_complete_request(struct dwc2_hsotg *hsotg,
 		dwc2_gadget_start_next_request(hs_ep);
 }
 
+/*
+ * dwc2_gadget_complete_chain_ddma - complete chained non-ISOC requests
+ * @hs_ep: The endpoint the requests are on.
+ *
+ * Give back the requests of the chain whose descriptor the core closed, in
+ * order. Completing the last one starts the next transfer.
+ *
+ * Return true if the whole chain was given back.
+ */
+static bool dwc2_gadget_complete_chain_ddma(struct dwc2_hsotg_ep *hs_ep)
+{
+	struct dwc2_hsotg *hsotg = hs_ep->parent;
+	u32 mps = hs_ep->ep.maxpacket;
+	struct dwc2_hsotg_req *hs_req;
+	struct dwc2_dma_desc *desc;
+	u32 desc_sts, len;
+
+	while (hs_ep->chain_len) {
+		desc = &hs_ep->desc_list[hs_ep->compl_desc];
+		desc_sts = desc->status;
+		if ((desc_sts & DEV_DMA_BUFF_STS_MASK) >> DEV_DMA_BUFF_STS_SHIFT !=
+		    DEV_DMA_BUFF_STS_DMADONE) {
+			hs_ep->req = get_ep_head(hs_ep);
+			return false;
+		}
+
+		hs_req = get_ep_head(hs_ep);
+		if (!hs_req) {
+			hs_ep->chain_len = 0;
+			break;
+		}
+
+		if (desc_sts & DEV_DMA_STS_MASK)
+			dev_err(hsotg->dev, "descriptor %d closed with %x\n",
+				hs_ep->compl_desc, desc_sts & DEV_DMA_STS_MASK);
+
+		len = hs_req->req.length;
+		if (!hs_ep->dir_in && (len % mps))
+			len += mps - (len % mps);
+		len -= desc_sts & DEV_DMA_NBYTES_MASK;
+		hs_req->req.actual = min(len, hs_req->req.length);
+
+		hs_ep->compl_desc++;
+		hs_ep->chain_len--;
+		hs_ep->req = hs_req;
+		dwc2_hsotg_complete_request(hsotg, hs_ep, hs_req, 0);
+	}
+
+	return true;
+}
+
 /*
  * dwc2_gadget_complete_isoc_request_ddma - complete an isoc request in DDMA
  * @hs_ep: The endpoint the request was on.
@@ -2232,6 +2344,7 @@ static unsigned int dwc2_gadget_get_xfersize_ddma(struct dwc2_hsotg_ep *hs_ep)
 		if (status & DEV_DMA_STS_MASK)
 			dev_err(hsotg->dev, "descriptor %d closed with %x\n",
 				i, status & DEV_DMA_STS_MASK);
+		desc++;
 	}
 
 	return bytes_rem;
@@ -2894,6 +3007,8 @@ static void dwc2_hsotg_epint(struct dwc2_hsotg *hsotg, unsigned int idx,
 			/* XferCompl set along with BNA */
 			if (!(ints & DXEPINT_BNAINTR))
 				dwc2_gadget_complete_isoc_request_ddma(hs_ep);
+		} else if (using_desc_dma(hsotg) && hs_ep->chain_len) {
+			dwc2_gadget_complete_chain_ddma(hs_ep);
 		} else if (dir_in) {
 			/*
 			 * We get OutDone from the FIFO, so we only
@@ -3097,6 +3212,7 @@ static void kill_all_requests(struct dwc2_hsotg *hsotg,
 	unsigned int size;
 
 	ep->req = NULL;
+	ep->chain_len = 0;
 
 	list_for_each_entry_safe(req, treq, &ep->queue, queue)
 		dwc2_hsotg_complete_request(hsotg, ep, req,
@@ -4074,6 +4190,30 @@ static int dwc2_hsotg_ep_dequeue(struct usb_ep *ep, struct usb_request *req)
 		return -EINVAL;
 	}
 
+	/*
+	 * A running descriptor chain can't be edited: stop it, give back what
+	 * the core already transferred and restart without the request.
+	 */
+	while (hs_ep->chain_len) {
+		dwc2_hsotg_ep_stop_xfr(hs, hs_ep);
+		if (dwc2_gadget_complete_chain_ddma(hs_ep))
+			continue;
+
+		hs_ep->chain_len = 0;
+		hs_ep->req = NULL;
+		if (on_list(hs_ep, hs_req))
+			dwc2_hsotg_complete_request(hs, hs_ep, hs_req,
+						    -ECONNRESET);
+		dwc2_gadget_start_next_request(hs_ep);
+		spin_unlock_irqrestore(&hs->lock, flags);
+		return 0;
+	}
+
+	if (!on_list(hs_ep, hs_req)) {
+		spin_unlock_irqrestore(&hs->lock, flags);
+		return 0;
+	}
+
 	/* Dequeue already started request */
 	if (req == &hs_ep->req->req)
 		dwc2_hsotg_ep_stop_xfr(hs, hs_ep);
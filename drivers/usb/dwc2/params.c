@@ -113,6 +113,30 @@ static void dwc2_set_amlogic_params(struct dwc2_hsotg *hsotg)
 	p->power_down = false;
 }
 
+static void dwc2_set_amlogic_gxbb_params(struct dwc2_hsotg *hsotg)
+{
+	struct dwc2_core_params *p = &hsotg->params;
+
+	dwc2_set_amlogic_params(hsotg);
+
+	/*
+	 * Descriptor DMA handles isochronous transfers as multi-frame lists,
+	 * with one interrupt per list instead of one per (micro)frame, but
+	 * it can't do split transactions. Only use it on boards where no
+	 * full/low speed device sits behind a high speed hub, typically a
+	 * port dedicated to high speed cameras.
+	 */
+	p->dma_desc_enable = device_property_read_bool(hsotg->dev,
+						"amlogic,host-desc-dma");
+
+	/*
+	 * In device mode, queued bulk requests are chained in the same
+	 * descriptor list instead of being restarted one by one from the
+	 * interrupt handler.
+	 */
+	p->g_dma_desc = true;
+}
+
 static void dwc2_set_amcc_params(struct dwc2_hsotg *hsotg)
 {
 	struct dwc2_core_params *p = &hsotg->params;
@@ -157,7 +181,7 @@ const struct of_device_id dwc2_of_match_table[] = {
 	{ .compatible = "amlogic,meson8b-usb",
 	  .data = dwc2_set_amlogic_params },
 	{ .compatible = "amlogic,meson-gxbb-usb",
-	  .data = dwc2_set_amlogic_params },
+	  .data = dwc2_set_amlogic_gxbb_params },
 	{ .compatible = "amcc,dwc-otg", .data = dwc2_set_amcc_params },
 	{ .compatible = "st,stm32f4x9-fsotg",
 	  .data = dwc2_set_stm32f4x9_fsotg_params },
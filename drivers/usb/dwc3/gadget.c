@@ -2259,7 +2259,11 @@ static int dwc3_gadget_ep_reclaim_completed_trb(struct dwc3_ep *dep,
 	if (event->status & DEPEVT_STATUS_SHORT && !chain)
 		return 1;
 
-	if (event->status & DEPEVT_STATUS_IOC)
+	/*
+	 * Requests queued with no_interrupt are completed along with the
+	 * next one raising the event, stop at the TRB which raised it.
+	 */
+	if (trb->ctrl & DWC3_TRB_CTRL_IOC)
 		return 1;
 
 	return 0;
@@ -2352,6 +2356,11 @@ static void dwc3_gadget_ep_cleanup_completed_requests(struct dwc3_ep *dep,
 	list_for_each_entry_safe(req, tmp, &dep->started_list, list) {
 		int ret;
 
+		/* The controller didn't get to this request yet */
+		if ((req->trb->ctrl & DWC3_TRB_CTRL_HWO) &&
+		    status != -ESHUTDOWN)
+			break;
+
 		ret = dwc3_gadget_ep_cleanup_completed_request(dep, event,
 				req, status);
 		if (ret)
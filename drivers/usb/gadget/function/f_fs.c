@@ -204,6 +204,12 @@ struct ffs_buffer {
 
 /*  ffs_io_data structure ***************************************************/
 
+/*
+ * Transfers of at least this size are done directly from the user buffer on
+ * UDCs supporting scatter-gather, smaller ones are cheaper to copy.
+ */
+#define FFS_ZEROCOPY_MIN	PAGE_SIZE
+
 struct ffs_io_data {
 	bool aio;
 	bool read;
@@ -213,6 +219,11 @@ struct ffs_io_data {
 	const void *to_free;
 	char *buf;
 
+	/* User pages the transfer is done from, instead of buf */
+	struct page **pages;
+	unsigned int npages;
+	struct sg_table sgt;
+
 	struct mm_struct *mm;
 	struct work_struct work;
 
@@ -749,6 +760,85 @@ static ssize_t ffs_copy_to_iter(void *data, int data_len, struct iov_iter *iter)
 	return ret;
 }
 
+/*
+ * Pin the user pages of the next len bytes of io_data->data and describe them
+ * in io_data->sgt. Only a single, DMA aligned iovec segment is handled, the
+ * caller falls back to a bounce buffer otherwise.
+ */
+static int ffs_epfile_pin_user(struct ffs_io_data *io_data, size_t len)
+{
+	struct iov_iter *iter = &io_data->data;
+	unsigned long addr;
+	size_t off;
+	ssize_t ret;
+	int i, n;
+
+	if (len < FFS_ZEROCOPY_MIN || !iter_is_iovec(iter) ||
+	    iov_iter_single_seg_count(iter) != len)
+		return -EINVAL;
+
+	addr = (unsigned long)iter->iov->iov_base + iter->iov_offset;
+	if (!IS_ALIGNED(addr | len, ARCH_KMALLOC_MINALIGN))
+		return -EINVAL;
+
+	ret = iov_iter_get_pages_alloc(iter, &io_data->pages, len, &off);
+	if (ret < 0)
+		return ret;
+
+	n = DIV_ROUND_UP(off + ret, PAGE_SIZE);
+	if (ret == len)
+		ret = sg_alloc_table_from_pages(&io_data->sgt, io_data->pages,
+						n, off, len, GFP_KERNEL);
+	else
+		ret = -EFAULT;
+
+	if (ret) {
+		for (i = 0; i < n; i++)
+			put_page(io_data->pages[i]);
+		kvfree(io_data->pages);
+		io_data->pages = NULL;
+		return ret;
+	}
+
+	io_data->npages = n;
+	/* Reads advance the iterator once the data has arrived */
+	if (!io_data->read)
+		iov_iter_advance(iter, len);
+	return 0;
+}
+
+static void ffs_epfile_unpin_user(struct ffs_io_data *io_data)
+{
+	unsigned int i;
+
+	if (!io_data->pages)
+		return;
+
+	sg_free_table(&io_data->sgt);
+	for (i = 0; i < io_data->npages; i++) {
+		if (io_data->read)
+			set_page_dirty_lock(io_data->pages[i]);
+		put_page(io_data->pages[i]);
+	}
+	kvfree(io_data->pages);
+	io_data->pages = NULL;
+}
+
+static void ffs_epfile_set_buf(struct usb_request *req,
+			       struct ffs_io_data *io_data,
+			       void *data, size_t len)
+{
+	req->buf = data;
+	req->length = len;
+	if (io_data->pages) {
+		req->sg = io_data->sgt.sgl;
+		req->num_sgs = io_data->sgt.nents;
+	} else {
+		req->sg = NULL;
+		req->num_sgs = 0;
+	}
+}
+
 static void ffs_user_copy_worker(struct work_struct *work)
 {
 	struct ffs_io_data *io_data = container_of(work, struct ffs_io_data,
@@ -757,7 +847,9 @@ static void ffs_user_copy_worker(struct work_struct *work)
 					 io_data->req->actual;
 	bool kiocb_has_eventfd = io_data->kiocb->ki_flags & IOCB_EVENTFD;
 
-	if (io_data->read && ret > 0) {
+	if (io_data->pages) {
+		ffs_epfile_unpin_user(io_data);
+	} else if (io_data->read && ret > 0) {
 		mm_segment_t oldfs = get_fs();
 
 		set_fs(USER_DS);
@@ -883,6 +975,8 @@ static ssize_t ffs_epfile_io(struct file *file, struct ffs_io_data *io_data)
 	ssize_t ret, data_len = -EINVAL;
 	int halt;
 
+	io_data->pages = NULL;
+
 	/* Are we still active? */
 	if (WARN_ON(epfile->ffs->state != FFS_ACTIVE))
 		return -ENODEV;
@@ -948,15 +1042,21 @@ static ssize_t ffs_epfile_io(struct file *file, struct ffs_io_data *io_data)
 			data_len = usb_ep_align_maybe(gadget, ep->ep, data_len);
 		spin_unlock_irq(&epfile->ffs->eps_lock);
 
-		data = kmalloc(data_len, GFP_KERNEL);
-		if (unlikely(!data)) {
-			ret = -ENOMEM;
-			goto error_mutex;
-		}
-		if (!io_data->read &&
-		    !copy_from_iter_full(data, data_len, &io_data->data)) {
-			ret = -EFAULT;
-			goto error_mutex;
+		/* Transfer from the user pages when possible, or copy */
+		if (!gadget->sg_supported ||
+		    data_len != iov_iter_count(&io_data->data) ||
+		    ffs_epfile_pin_user(io_data, data_len)) {
+			data = kmalloc(data_len, GFP_KERNEL);
+			if (unlikely(!data)) {
+				ret = -ENOMEM;
+				goto error_mutex;
+			}
+			if (!io_data->read &&
+			    !copy_from_iter_full(data, data_len,
+						 &io_data->data)) {
+				ret = -EFAULT;
+				goto error_mutex;
+			}
 		}
 	}
 
@@ -988,8 +1088,7 @@ static ssize_t ffs_epfile_io(struct file *file, struct ffs_io_data *io_data)
 		bool interrupted = false;
 
 		req = ep->req;
-		req->buf      = data;
-		req->length   = data_len;
+		ffs_epfile_set_buf(req, io_data, data, data_len);
 
 		req->context  = &done;
 		req->complete = ffs_epfile_io_complete;
@@ -1011,19 +1110,22 @@ static ssize_t ffs_epfile_io(struct file *file, struct ffs_io_data *io_data)
 			interrupted = ep->status < 0;
 		}
 
-		if (interrupted)
+		if (interrupted) {
 			ret = -EINTR;
-		else if (io_data->read && ep->status > 0)
+		} else if (io_data->read && ep->status > 0 && io_data->pages) {
+			iov_iter_advance(&io_data->data, ep->status);
+			ret = ep->status;
+		} else if (io_data->read && ep->status > 0) {
 			ret = __ffs_epfile_read_data(epfile, data, ep->status,
 						     &io_data->data);
-		else
+		} else {
 			ret = ep->status;
+		}
 		goto error_mutex;
 	} else if (!(req = usb_ep_alloc_request(ep->ep, GFP_ATOMIC))) {
 		ret = -ENOMEM;
 	} else {
-		req->buf      = data;
-		req->length   = data_len;
+		ffs_epfile_set_buf(req, io_data, data, data_len);
 
 		io_data->buf = data;
 		io_data->ep = ep->ep;
@@ -1051,6 +1153,9 @@ error_lock:
 	spin_unlock_irq(&epfile->ffs->eps_lock);
 error_mutex:
 	mutex_unlock(&epfile->mutex);
+	/* Queued AIO keeps its pages until ffs_user_copy_worker */
+	if (ret != -EIOCBQUEUED)
+		ffs_epfile_unpin_user(io_data);
 error:
 	kfree(data);
 	return ret;
@@ -116,6 +116,11 @@ static inline unsigned ncm_bitrate(struct usb_gadget *g)
 /* Delay for the transmit to wait before sending an unfilled NTB frame. */
 #define TX_TIMEOUT_NSECS	300000
 
+/* Received datagrams up to this size are copied, larger ones only have their
+ * headers copied and the rest of the payload attached as a page fragment.
+ */
+#define RX_COPYBREAK		256
+
 #define FORMATS_SUPPORTED	(USB_CDC_NCM_NTB16_SUPPORTED |	\
 				 USB_CDC_NCM_NTB32_SUPPORTED)
 
@@ -1123,6 +1128,16 @@ static struct sk_buff *ncm_wrap_ntb(struct gether *port,
 		dev_consume_skb_any(skb);
 		skb = NULL;
 
+		/* Nothing in flight: waiting for more datagrams only adds
+		 * latency, send the NTB now. While the IN endpoint is busy,
+		 * keep aggregating until the NTB is full or the timer fires.
+		 */
+		if (!skb2 && !gether_tx_qlen(port)) {
+			skb2 = package_for_tx(ncm);
+			if (!skb2)
+				goto err;
+		}
+
 	} else if (ncm->skb_tx_data && ncm->timer_force_tx) {
 		/* If the tx was requested because of a timeout then send */
 		skb2 = package_for_tx(ncm);
@@ -1152,6 +1167,7 @@ err:
 static enum hrtimer_restart ncm_tx_timeout(struct hrtimer *data)
 {
 	struct f_ncm *ncm = container_of(data, struct f_ncm, task_timer);
+	netdev_tx_t ret;
 
 	/* Only send if data is available. */
 	if (!ncm->timer_stopping && ncm->skb_tx_data) {
@@ -1163,13 +1179,52 @@ static enum hrtimer_restart ncm_tx_timeout(struct hrtimer *data)
 		 * XXX and performed in some way outside of the ndo_start_xmit
 		 * XXX interface.
 		 */
-		ncm->netdev->netdev_ops->ndo_start_xmit(NULL, ncm->netdev);
+		ret = ncm->netdev->netdev_ops->ndo_start_xmit(NULL, ncm->netdev);
 
 		ncm->timer_force_tx = false;
+
+		/* All requests are in flight, try again later */
+		if (ret == NETDEV_TX_BUSY && ncm->skb_tx_data) {
+			hrtimer_forward_now(data, TX_TIMEOUT_NSECS);
+			return HRTIMER_RESTART;
+		}
 	}
 	return HRTIMER_NORESTART;
 }
 
+/*
+ * Build the skb for one datagram of a received NTB. When the NTB is held in
+ * a page, only the headers of large datagrams are copied, the payload is
+ * referenced from that page. Otherwise, copy the data into a new skb, this
+ * ensures the truesize is correct.
+ */
+static struct sk_buff *ncm_rx_datagram(struct f_ncm *ncm, struct sk_buff *skb,
+				       unsigned int index, unsigned int len)
+{
+	void		*data = skb->data + index;
+	struct sk_buff	*skb2;
+	struct page	*page;
+	unsigned int	hlen = len;
+
+	if (skb->head_frag && len > RX_COPYBREAK)
+		hlen = eth_get_headlen(data, RX_COPYBREAK);
+
+	skb2 = netdev_alloc_skb_ip_align(ncm->netdev, hlen);
+	if (skb2 == NULL)
+		return NULL;
+	skb_put_data(skb2, data, hlen);
+
+	if (hlen < len) {
+		page = virt_to_head_page(skb->head);
+		get_page(page);
+		skb_add_rx_frag(skb2, 0, page,
+				data + hlen - page_address(page),
+				len - hlen, len - hlen);
+	}
+
+	return skb2;
+}
+
 static int ncm_unwrap_ntb(struct gether *port,
 			  struct sk_buff *skb,
 			  struct sk_buff_head *list)
@@ -1282,16 +1337,10 @@ static int ncm_unwrap_ntb(struct gether *port,
 			index2 = get_ncm(&tmp, opts->dgram_item_len);
 			dg_len2 = get_ncm(&tmp, opts->dgram_item_len);
 
-			/*
-			 * Copy the data into a new skb.
-			 * This ensures the truesize is correct
-			 */
-			skb2 = netdev_alloc_skb_ip_align(ncm->netdev,
-							 dg_len - crc_len);
+			skb2 = ncm_rx_datagram(ncm, skb, index,
+					       dg_len - crc_len);
 			if (skb2 == NULL)
 				goto err;
-			skb_put_data(skb2, skb->data + index,
-				     dg_len - crc_len);
 
 			skb_queue_tail(list, skb2);
 
@@ -13,6 +13,9 @@
  */
 
 #include <linux/module.h>
+#include <linux/wait_bit.h>
+#include <asm/unaligned.h>
+#include <sound/control.h>
 #include <sound/core.h>
 #include <sound/pcm.h>
 #include <sound/pcm_params.h>
@@ -23,9 +26,13 @@
 #define PRD_SIZE_MAX	PAGE_SIZE
 #define MIN_PERIODS	4
 
+/* Nominal rate for the feedback pitch, in ppm */
+#define FBACK_PITCH_NOMINAL	1000000
+
 struct uac_req {
 	struct uac_rtd_params *pp; /* parent param */
 	struct usb_request *req;
+	void *buf; /* own buffer, when not sending from the ALSA one */
 };
 
 /* Runtime data params for one stream */
@@ -43,6 +50,14 @@ struct uac_rtd_params {
 	unsigned max_psize;	/* MaxPacketSize of endpoint */
 	struct uac_req *ureq;
 
+	/* IN requests sending straight from the ALSA ring buffer */
+	atomic_t zc_pending;
+
+	/* Feedback endpoint of the asynchronous OUT endpoint */
+	bool fb_ep_enabled;
+	struct usb_request *req_fback;
+	unsigned int pitch;	/* capture rate trim, in ppm */
+
 	spinlock_t lock;
 };
 
@@ -88,6 +103,13 @@ static void u_audio_iso_complete(struct usb_ep *ep, struct usb_request *req)
 	struct uac_rtd_params *prm = ur->pp;
 	struct snd_uac_chip *uac = prm->uac;
 
+	/* The ALSA buffer may go away once no request sends from it */
+	if (req->buf != ur->buf) {
+		req->buf = ur->buf;
+		if (atomic_dec_and_test(&prm->zc_pending))
+			wake_up_var(&prm->zc_pending);
+	}
+
 	/* i/f shutting down */
 	if (!prm->ep_enabled || req->status == -ESHUTDOWN)
 		return;
@@ -153,8 +175,9 @@ static void u_audio_iso_complete(struct usb_ep *ep, struct usb_request *req)
 			memcpy(req->buf + pending, runtime->dma_area,
 			       req->actual - pending);
 		} else {
-			memcpy(req->buf, runtime->dma_area + hw_ptr,
-			       req->actual);
+			/* Send the packet straight from the ring buffer */
+			req->buf = runtime->dma_area + hw_ptr;
+			atomic_inc(&prm->zc_pending);
 		}
 	} else {
 		if (unlikely(pending < req->actual)) {
@@ -178,6 +201,48 @@ static void u_audio_iso_complete(struct usb_ep *ep, struct usb_request *req)
 		snd_pcm_period_elapsed(substream);
 
 exit:
+	if (usb_ep_queue(ep, req, GFP_ATOMIC)) {
+		dev_err(uac->card->dev, "%d Error!\n", __LINE__);
+		if (req->buf != ur->buf) {
+			req->buf = ur->buf;
+			if (atomic_dec_and_test(&prm->zc_pending))
+				wake_up_var(&prm->zc_pending);
+		}
+	}
+}
+
+/*
+ * Encode the capture rate trimmed by pitch, in ppm of the nominal rate, as
+ * samples per frame in 10.14 format at full speed, and samples per microframe
+ * in 16.16 format at high speed.
+ */
+static void u_audio_set_fback(enum usb_device_speed speed, unsigned int srate,
+			      unsigned int pitch, void *buf)
+{
+	u64 ff = (u64)srate * pitch;
+
+	if (speed == USB_SPEED_FULL)
+		ff = div64_u64(ff << 14, 1000ULL * FBACK_PITCH_NOMINAL);
+	else
+		ff = div64_u64(ff << 16, 8000ULL * FBACK_PITCH_NOMINAL);
+
+	put_unaligned_le32(ff, buf);
+}
+
+static void u_audio_iso_fback_complete(struct usb_ep *ep,
+				       struct usb_request *req)
+{
+	struct uac_rtd_params *prm = req->context;
+	struct snd_uac_chip *uac = prm->uac;
+	struct g_audio *audio_dev = uac->audio_dev;
+
+	/* i/f shutting down */
+	if (!prm->fb_ep_enabled || req->status == -ESHUTDOWN)
+		return;
+
+	u_audio_set_fback(audio_dev->gadget->speed, audio_dev->params.c_srate,
+			  READ_ONCE(prm->pitch), req->buf);
+
 	if (usb_ep_queue(ep, req, GFP_ATOMIC))
 		dev_err(uac->card->dev, "%d Error!\n", __LINE__);
 }
@@ -248,6 +313,14 @@ static int uac_pcm_hw_params(struct snd_pcm_substream *substream,
 
 static int uac_pcm_hw_free(struct snd_pcm_substream *substream)
 {
+	struct snd_uac_chip *uac = snd_pcm_substream_chip(substream);
+	atomic_t *pending = &uac->p_prm.zc_pending;
+
+	/* Requests still sending from the buffer complete within a few ms */
+	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
+		wait_var_event_timeout(pending, !atomic_read(pending),
+				       msecs_to_jiffies(100));
+
 	return snd_pcm_lib_free_pages(substream);
 }
 
@@ -334,6 +407,57 @@ static const struct snd_pcm_ops uac_pcm_ops = {
 	.prepare = uac_pcm_null,
 };
 
+static int u_audio_pitch_info(struct snd_kcontrol *kcontrol,
+			      struct snd_ctl_elem_info *uinfo)
+{
+	struct uac_rtd_params *prm = snd_kcontrol_chip(kcontrol);
+	unsigned int fb_max = prm->uac->audio_dev->params.fb_max;
+
+	uinfo->type = SNDRV_CTL_ELEM_TYPE_INTEGER;
+	uinfo->count = 1;
+	uinfo->value.integer.min = FBACK_PITCH_NOMINAL - fb_max;
+	uinfo->value.integer.max = FBACK_PITCH_NOMINAL + fb_max;
+	uinfo->value.integer.step = 1;
+
+	return 0;
+}
+
+static int u_audio_pitch_get(struct snd_kcontrol *kcontrol,
+			     struct snd_ctl_elem_value *ucontrol)
+{
+	struct uac_rtd_params *prm = snd_kcontrol_chip(kcontrol);
+
+	ucontrol->value.integer.value[0] = READ_ONCE(prm->pitch);
+
+	return 0;
+}
+
+static int u_audio_pitch_put(struct snd_kcontrol *kcontrol,
+			     struct snd_ctl_elem_value *ucontrol)
+{
+	struct uac_rtd_params *prm = snd_kcontrol_chip(kcontrol);
+	unsigned int fb_max = prm->uac->audio_dev->params.fb_max;
+	long val = ucontrol->value.integer.value[0];
+
+	val = clamp_t(long, val, FBACK_PITCH_NOMINAL - fb_max,
+		      FBACK_PITCH_NOMINAL + fb_max);
+	if (val == READ_ONCE(prm->pitch))
+		return 0;
+
+	/* Reported from the next feedback packet on */
+	WRITE_ONCE(prm->pitch, val);
+
+	return 1;
+}
+
+static const struct snd_kcontrol_new u_audio_pitch_ctl = {
+	.iface = SNDRV_CTL_ELEM_IFACE_PCM,
+	.name = "Capture Pitch 1000000",
+	.info = u_audio_pitch_info,
+	.get = u_audio_pitch_get,
+	.put = u_audio_pitch_put,
+};
+
 static inline void free_ep(struct uac_rtd_params *prm, struct usb_ep *ep)
 {
 	struct snd_uac_chip *uac = prm->uac;
@@ -361,6 +485,25 @@ static inline void free_ep(struct uac_rtd_params *prm, struct usb_ep *ep)
 		dev_err(uac->card->dev, "%s:%d Error!\n", __func__, __LINE__);
 }
 
+static inline void free_ep_fback(struct uac_rtd_params *prm, struct usb_ep *ep)
+{
+	struct snd_uac_chip *uac = prm->uac;
+
+	if (!prm->fb_ep_enabled)
+		return;
+
+	prm->fb_ep_enabled = false;
+
+	if (prm->req_fback) {
+		usb_ep_dequeue(ep, prm->req_fback);
+		kfree(prm->req_fback->buf);
+		usb_ep_free_request(ep, prm->req_fback);
+		prm->req_fback = NULL;
+	}
+
+	if (usb_ep_disable(ep))
+		dev_err(uac->card->dev, "%s:%d Error!\n", __func__, __LINE__);
+}
 
 int u_audio_start_capture(struct g_audio *audio_dev)
 {
@@ -395,12 +538,46 @@ int u_audio_start_capture(struct g_audio *audio_dev)
 			req->length = req_len;
 			req->complete = u_audio_iso_complete;
 			req->buf = prm->rbuf + i * prm->max_psize;
+			prm->ureq[i].buf = req->buf;
 		}
 
 		if (usb_ep_queue(ep, prm->ureq[i].req, GFP_ATOMIC))
 			dev_err(dev, "%s:%d Error!\n", __func__, __LINE__);
 	}
 
+	ep = audio_dev->in_ep_fback;
+	if (!ep)
+		return 0;
+
+	config_ep_by_speed(gadget, &audio_dev->func, ep);
+
+	prm->fb_ep_enabled = true;
+	usb_ep_enable(ep);
+
+	if (!prm->req_fback) {
+		req = usb_ep_alloc_request(ep, GFP_ATOMIC);
+		if (req == NULL)
+			return -ENOMEM;
+
+		req->buf = kzalloc(sizeof(u32), GFP_ATOMIC);
+		if (!req->buf) {
+			usb_ep_free_request(ep, req);
+			return -ENOMEM;
+		}
+
+		prm->req_fback = req;
+		req->zero = 0;
+		req->context = prm;
+		req->length = gadget->speed == USB_SPEED_FULL ? 3 : 4;
+		req->complete = u_audio_iso_fback_complete;
+	}
+
+	u_audio_set_fback(gadget->speed, params->c_srate,
+			  READ_ONCE(prm->pitch), prm->req_fback->buf);
+
+	if (usb_ep_queue(ep, prm->req_fback, GFP_ATOMIC))
+		dev_err(dev, "%s:%d Error!\n", __func__, __LINE__);
+
 	return 0;
 }
 EXPORT_SYMBOL_GPL(u_audio_start_capture);
@@ -409,6 +586,8 @@ void u_audio_stop_capture(struct g_audio *audio_dev)
 {
 	struct snd_uac_chip *uac = audio_dev->uac;
 
+	if (audio_dev->in_ep_fback)
+		free_ep_fback(&uac->c_prm, audio_dev->in_ep_fback);
 	free_ep(&uac->c_prm, audio_dev->out_ep);
 }
 EXPORT_SYMBOL_GPL(u_audio_stop_capture);
@@ -471,6 +650,7 @@ int u_audio_start_playback(struct g_audio *audio_dev)
 			req->length = req_len;
 			req->complete = u_audio_iso_complete;
 			req->buf = prm->rbuf + i * prm->max_psize;
+			prm->ureq[i].buf = req->buf;
 		}
 
 		if (usb_ep_queue(ep, prm->ureq[i].req, GFP_ATOMIC))
@@ -517,6 +697,7 @@ int g_audio_setup(struct g_audio *g_audio, const char *pcm_name,
 
 		uac->c_prm.uac = uac;
 		prm->max_psize = g_audio->out_ep_maxpsize;
+		prm->pitch = FBACK_PITCH_NOMINAL;
 
 		prm->ureq = kcalloc(params->req_number, sizeof(struct uac_req),
 				GFP_KERNEL);
@@ -587,6 +768,13 @@ int g_audio_setup(struct g_audio *g_audio, const char *pcm_name,
 	snd_pcm_lib_preallocate_pages_for_all(pcm, SNDRV_DMA_TYPE_CONTINUOUS,
 		snd_dma_continuous_data(GFP_KERNEL), 0, BUFF_SIZE_MAX);
 
+	if (c_chmask && g_audio->in_ep_fback) {
+		err = snd_ctl_add(card, snd_ctl_new1(&u_audio_pitch_ctl,
+						     &uac->c_prm));
+		if (err < 0)
+			goto snd_fail;
+	}
+
 	err = snd_card_register(card);
 
 	if (!err)
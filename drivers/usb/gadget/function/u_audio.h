@@ -23,6 +23,7 @@ struct uac_params {
 	int c_ssize;	/* sample size */
 
 	int req_number; /* number of preallocated requests */
+	int fb_max;	/* max capture rate trim from the feedback, in ppm */
 };
 
 struct g_audio {
@@ -31,6 +32,8 @@ struct g_audio {
 
 	struct usb_ep *in_ep;
 	struct usb_ep *out_ep;
+	/* Optional feedback endpoint for the asynchronous out_ep */
+	struct usb_ep *in_ep_fback;
 
 	/* Max packet size for all in_ep possible speeds */
 	unsigned int in_ep_maxpsize;
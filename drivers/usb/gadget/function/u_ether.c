@@ -93,7 +93,8 @@ struct eth_dev {
 static inline int qlen(struct usb_gadget *gadget, unsigned qmult)
 {
 	if (gadget_is_dualspeed(gadget) && (gadget->speed == USB_SPEED_HIGH ||
-					    gadget->speed == USB_SPEED_SUPER))
+					    gadget->speed == USB_SPEED_SUPER ||
+					    gadget->speed == USB_SPEED_SUPER_PLUS))
 		return qmult * DEFAULT_QLEN;
 	else
 		return DEFAULT_QLEN;
@@ -171,6 +172,38 @@ static void defer_kevent(struct eth_dev *dev, int flag)
 
 static void rx_complete(struct usb_ep *ep, struct usb_request *req);
 
+/*
+ * Multi frame protocols split the transfer into many datagrams, which can
+ * reference its pages instead of being copied out of it. Build the skb around
+ * pages of its own, rather than kmalloc() memory.
+ */
+static struct sk_buff *rx_alloc_frag_skb(struct eth_dev *dev, size_t size,
+					 gfp_t gfp_flags)
+{
+	unsigned int truesize;
+	struct sk_buff *skb;
+	struct page *page;
+	int order;
+
+	truesize = SKB_DATA_ALIGN(NET_SKB_PAD + NET_IP_ALIGN + size) +
+		   SKB_DATA_ALIGN(sizeof(struct skb_shared_info));
+	order = get_order(truesize);
+
+	page = alloc_pages(gfp_flags | __GFP_COMP | __GFP_NOWARN, order);
+	if (!page)
+		return NULL;
+
+	skb = build_skb(page_address(page), PAGE_SIZE << order);
+	if (!skb) {
+		__free_pages(page, order);
+		return NULL;
+	}
+
+	skb_reserve(skb, NET_SKB_PAD);
+	skb->dev = dev->net;
+	return skb;
+}
+
 static int
 rx_submit(struct eth_dev *dev, struct usb_request *req, gfp_t gfp_flags)
 {
@@ -215,7 +248,11 @@ rx_submit(struct eth_dev *dev, struct usb_request *req, gfp_t gfp_flags)
 	if (dev->port_usb->is_fixed)
 		size = max_t(size_t, size, dev->port_usb->fixed_out_len);
 
-	skb = __netdev_alloc_skb(dev->net, size + NET_IP_ALIGN, gfp_flags);
+	if (dev->port_usb->supports_multi_frame)
+		skb = rx_alloc_frag_skb(dev, size, gfp_flags);
+	else
+		skb = __netdev_alloc_skb(dev->net, size + NET_IP_ALIGN,
+					 gfp_flags);
 	if (skb == NULL) {
 		DBG(dev, "no rx skb\n");
 		goto enomem;
@@ -981,6 +1018,12 @@ void gether_get_host_addr_u8(struct net_device *net, u8 host_mac[ETH_ALEN])
 }
 EXPORT_SYMBOL_GPL(gether_get_host_addr_u8);
 
+int gether_tx_qlen(struct gether *link)
+{
+	return atomic_read(&link->ioport->tx_qlen);
+}
+EXPORT_SYMBOL_GPL(gether_tx_qlen);
+
 void gether_set_qmult(struct net_device *net, unsigned qmult)
 {
 	struct eth_dev *dev;
@@ -225,6 +225,16 @@ void gether_get_host_addr_u8(struct net_device *net, u8 host_mac[ETH_ALEN]);
  */
 void gether_set_qmult(struct net_device *net, unsigned qmult);
 
+/**
+ * gether_tx_qlen - number of transfers queued on the IN endpoint
+ * @link: the USB link, connected
+ *
+ * Multi frame protocols use it from their wrap() hook to decide whether to
+ * send a partially filled transfer now, or to keep aggregating while the
+ * endpoint is busy.
+ */
+int gether_tx_qlen(struct gether *link);
+
 /**
  * gether_get_qmult - get an ethernet-over-usb link multiplier
  * @net: device representing this link
@@ -124,6 +124,10 @@
 		ret = kstrtou8(page, 0, &val);				\
 		if (ret)						\
 			goto out;					\
+		if (!val) {						\
+			ret = -EINVAL;					\
+			goto out;					\
+		}							\
 									\
 		gether_set_qmult(opts->net, val);			\
 		ret = len;						\
@@ -22,6 +22,7 @@
 #define UAC2_DEF_CSRATE 64000
 #define UAC2_DEF_CSSIZE 2
 #define UAC2_DEF_REQ_NUM 2
+#define UAC2_DEF_FB_MAX 1000
 
 struct f_uac2_opts {
 	struct usb_function_instance	func_inst;
@@ -32,6 +33,7 @@ struct f_uac2_opts {
 	int				c_srate;
 	int				c_ssize;
 	int				req_number;
+	int				fb_max;
 	bool				bound;
 
 	struct mutex			lock;
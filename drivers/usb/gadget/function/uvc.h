@@ -64,7 +64,11 @@ extern unsigned int uvc_gadget_trace_param;
  * Driver specific constants
  */
 
-#define UVC_NUM_REQUESTS			4
+#define UVC_NUM_REQUESTS			16
+/* Requests copying the video data each need a req_size buffer */
+#define UVC_NUM_COPY_REQUESTS			4
+/* Payload header and up to 48kB of video data, with SG */
+#define UVC_MAX_SG_ENTRIES			16
 #define UVC_MAX_REQUEST_SIZE			64
 #define UVC_MAX_EVENTS				4
 
@@ -72,6 +76,15 @@ extern unsigned int uvc_gadget_trace_param;
  * Structures
  */
 
+struct uvc_request {
+	struct usb_request *req;
+	__u8 *req_buffer;
+	struct uvc_video *video;
+	struct scatterlist *sg;
+	/* Buffer to complete along with the request, with SG */
+	struct uvc_buffer *last_buf;
+};
+
 struct uvc_video {
 	struct usb_ep *ep;
 
@@ -85,10 +98,11 @@ struct uvc_video {
 
 	/* Requests */
 	unsigned int req_size;
-	struct usb_request *req[UVC_NUM_REQUESTS];
-	__u8 *req_buffer[UVC_NUM_REQUESTS];
+	unsigned int num_requests;
+	struct uvc_request ureq[UVC_NUM_REQUESTS];
 	struct list_head req_free;
 	spinlock_t req_lock;
+	unsigned int req_int_count;
 
 	void (*encode) (struct usb_request *req, struct uvc_video *video,
 			struct uvc_buffer *buf);
@@ -17,6 +17,7 @@
 #include <linux/wait.h>
 
 #include <media/v4l2-common.h>
+#include <media/videobuf2-dma-sg.h>
 #include <media/videobuf2-vmalloc.h>
 
 #include "uvc.h"
@@ -70,7 +71,13 @@ static int uvc_buffer_prepare(struct vb2_buffer *vb)
 		return -ENODEV;
 
 	buf->state = UVC_BUF_STATE_QUEUED;
-	buf->mem = vb2_plane_vaddr(vb, 0);
+	if (queue->use_sg) {
+		buf->sgt = vb2_dma_sg_plane_desc(vb, 0);
+		buf->sg = buf->sgt->sgl;
+		buf->offset = 0;
+	} else {
+		buf->mem = vb2_plane_vaddr(vb, 0);
+	}
 	buf->length = vb2_plane_size(vb, 0);
 	if (vb->type == V4L2_BUF_TYPE_VIDEO_CAPTURE)
 		buf->bytesused = 0;
@@ -110,8 +117,12 @@ static struct vb2_ops uvc_queue_qops = {
 	.wait_finish = vb2_ops_wait_finish,
 };
 
-int uvcg_queue_init(struct uvc_video_queue *queue, enum v4l2_buf_type type,
-		    struct mutex *lock)
+/*
+ * When dev is set, the buffers are allocated as scatter-gather lists for dev
+ * and the USB requests point to them, instead of copying their contents.
+ */
+int uvcg_queue_init(struct uvc_video_queue *queue, struct device *dev,
+		    enum v4l2_buf_type type, struct mutex *lock)
 {
 	int ret;
 
@@ -121,7 +132,14 @@ int uvcg_queue_init(struct uvc_video_queue *queue, enum v4l2_buf_type type,
 	queue->queue.buf_struct_size = sizeof(struct uvc_buffer);
 	queue->queue.ops = &uvc_queue_qops;
 	queue->queue.lock = lock;
-	queue->queue.mem_ops = &vb2_vmalloc_memops;
+	if (dev) {
+		queue->queue.mem_ops = &vb2_dma_sg_memops;
+		queue->queue.dev = dev;
+		queue->use_sg = true;
+	} else {
+		queue->queue.mem_ops = &vb2_vmalloc_memops;
+		queue->use_sg = false;
+	}
 	queue->queue.timestamp_flags = V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC
 				     | V4L2_BUF_FLAG_TSTAMP_SRC_EOF;
 	ret = vb2_queue_init(&queue->queue);
@@ -323,14 +341,28 @@ struct uvc_buffer *uvcg_queue_next_buffer(struct uvc_video_queue *queue,
 	else
 		nextbuf = NULL;
 
+	/*
+	 * With SG, the requests still point to the buffer: it's completed once
+	 * the last of them is done.
+	 */
+	if (!queue->use_sg)
+		uvcg_complete_buffer(queue, buf);
+
+	return nextbuf;
+}
+
+/* Give a buffer removed from the queue back to userspace. */
+void uvcg_complete_buffer(struct uvc_video_queue *queue,
+			  struct uvc_buffer *buf)
+{
 	buf->buf.field = V4L2_FIELD_NONE;
 	buf->buf.sequence = queue->sequence++;
 	buf->buf.vb2_buf.timestamp = ktime_get_ns();
 
 	vb2_set_plane_payload(&buf->buf.vb2_buf, 0, buf->bytesused);
-	vb2_buffer_done(&buf->buf.vb2_buf, VB2_BUF_STATE_DONE);
-
-	return nextbuf;
+	vb2_buffer_done(&buf->buf.vb2_buf,
+			buf->state == UVC_BUF_STATE_ERROR ?
+			VB2_BUF_STATE_ERROR : VB2_BUF_STATE_DONE);
 }
 
 struct uvc_buffer *uvcg_queue_head(struct uvc_video_queue *queue)
@@ -34,6 +34,9 @@ struct uvc_buffer {
 
 	enum uvc_buffer_state state;
 	void *mem;
+	struct sg_table *sgt;
+	struct scatterlist *sg;		/* next data to send, with SG */
+	unsigned int offset;		/* in sg */
 	unsigned int length;
 	unsigned int bytesused;
 };
@@ -49,6 +52,7 @@ struct uvc_video_queue {
 	__u32 sequence;
 
 	unsigned int buf_used;
+	bool use_sg;
 
 	spinlock_t irqlock;	/* Protects flags and irqqueue */
 	struct list_head irqqueue;
@@ -59,8 +63,8 @@ static inline int uvc_queue_streaming(struct uvc_video_queue *queue)
 	return vb2_is_streaming(&queue->queue);
 }
 
-int uvcg_queue_init(struct uvc_video_queue *queue, enum v4l2_buf_type type,
-		    struct mutex *lock);
+int uvcg_queue_init(struct uvc_video_queue *queue, struct device *dev,
+		    enum v4l2_buf_type type, struct mutex *lock);
 
 void uvcg_free_buffers(struct uvc_video_queue *queue);
 
@@ -91,6 +95,9 @@ int uvcg_queue_enable(struct uvc_video_queue *queue, int enable);
 struct uvc_buffer *uvcg_queue_next_buffer(struct uvc_video_queue *queue,
 					  struct uvc_buffer *buf);
 
+void uvcg_complete_buffer(struct uvc_video_queue *queue,
+			  struct uvc_buffer *buf);
+
 struct uvc_buffer *uvcg_queue_head(struct uvc_video_queue *queue);
 
 #endif /* _UVC_QUEUE_H_ */
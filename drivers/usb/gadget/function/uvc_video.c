@@ -9,6 +9,7 @@
 #include <linux/kernel.h>
 #include <linux/device.h>
 #include <linux/errno.h>
+#include <linux/scatterlist.h>
 #include <linux/usb/ch9.h>
 #include <linux/usb/gadget.h>
 #include <linux/usb/video.h>
@@ -121,10 +122,100 @@ uvc_video_encode_isoc(struct usb_request *req, struct uvc_video *video,
 	}
 }
 
+/*
+ * Point the request to the header and to the next part of the buffer, without
+ * copying the video data.
+ */
+static void
+uvc_video_encode_isoc_sg(struct usb_request *req, struct uvc_video *video,
+		struct uvc_buffer *buf)
+{
+	struct uvc_request *ureq = req->context;
+	struct uvc_video_queue *queue = &video->queue;
+	struct scatterlist *sg = ureq->sg;
+	unsigned int len = video->req_size;
+	unsigned int n = 1;
+	unsigned int part;
+	int ret;
+
+	sg_init_table(sg, UVC_MAX_SG_ENTRIES);
+
+	/* Add the header. */
+	ret = uvc_video_encode_header(video, buf, ureq->req_buffer, len);
+	sg_set_buf(&sg[0], ureq->req_buffer, ret);
+	req->length = ret;
+	len -= ret;
+
+	/* Reference the video data. */
+	while (len && queue->buf_used < buf->bytesused &&
+	       n < UVC_MAX_SG_ENTRIES) {
+		part = min3(len, buf->sg->length - buf->offset,
+			    buf->bytesused - queue->buf_used);
+		sg_set_page(&sg[n++], sg_page(buf->sg), part,
+			    buf->sg->offset + buf->offset);
+
+		buf->offset += part;
+		if (buf->offset == buf->sg->length) {
+			buf->sg = sg_next(buf->sg);
+			buf->offset = 0;
+		}
+		queue->buf_used += part;
+		req->length += part;
+		len -= part;
+	}
+
+	sg_mark_end(&sg[n - 1]);
+	req->buf = NULL;
+	req->sg = sg;
+	req->num_sgs = n;
+
+	if (buf->bytesused == video->queue.buf_used) {
+		video->queue.buf_used = 0;
+		buf->state = UVC_BUF_STATE_DONE;
+		if (uvcg_queue_next_buffer(&video->queue, buf) != buf)
+			ureq->last_buf = buf;
+		video->fid ^= UVC_STREAM_FID;
+	}
+}
+
 /* --------------------------------------------------------------------------
  * Request handling
  */
 
+/*
+ * Only ask for an interrupt every few requests, at the end of a buffer and
+ * when no request is left: the requests without one are completed along with
+ * the next one which has it.
+ */
+static void
+uvc_video_set_interrupt(struct uvc_video *video, struct usb_request *req,
+		struct uvc_buffer *buf)
+{
+	if (list_empty(&video->req_free) || buf->state == UVC_BUF_STATE_DONE ||
+	    !(video->req_int_count % DIV_ROUND_UP(video->num_requests, 4))) {
+		video->req_int_count = 0;
+		req->no_interrupt = 0;
+	} else {
+		req->no_interrupt = 1;
+	}
+	video->req_int_count++;
+}
+
+/*
+ * Give back the buffer the request was the last to send from, with SG.
+ */
+static void
+uvc_video_complete_last_buf(struct uvc_request *ureq, bool error)
+{
+	if (!ureq->last_buf)
+		return;
+
+	if (error)
+		ureq->last_buf->state = UVC_BUF_STATE_ERROR;
+	uvcg_complete_buffer(&ureq->video->queue, ureq->last_buf);
+	ureq->last_buf = NULL;
+}
+
 /*
  * I somehow feel that synchronisation won't be easy to achieve here. We have
  * three events that control USB requests submission:
@@ -158,12 +249,15 @@ uvc_video_encode_isoc(struct usb_request *req, struct uvc_video *video,
 static void
 uvc_video_complete(struct usb_ep *ep, struct usb_request *req)
 {
-	struct uvc_video *video = req->context;
+	struct uvc_request *ureq = req->context;
+	struct uvc_video *video = ureq->video;
 	struct uvc_video_queue *queue = &video->queue;
 	struct uvc_buffer *buf;
 	unsigned long flags;
 	int ret;
 
+	uvc_video_complete_last_buf(ureq, req->status);
+
 	switch (req->status) {
 	case 0:
 		break;
@@ -188,6 +282,7 @@ uvc_video_complete(struct usb_ep *ep, struct usb_request *req)
 	}
 
 	video->encode(req, video, buf);
+	uvc_video_set_interrupt(video, req, buf);
 
 	if ((ret = usb_ep_queue(ep, req, GFP_ATOMIC)) < 0) {
 		printk(KERN_INFO "Failed to queue request (%d).\n", ret);
@@ -201,6 +296,8 @@ uvc_video_complete(struct usb_ep *ep, struct usb_request *req)
 	return;
 
 requeue:
+	uvc_video_complete_last_buf(ureq, true);
+
 	spin_lock_irqsave(&video->req_lock, flags);
 	list_add_tail(&req->list, &video->req_free);
 	spin_unlock_irqrestore(&video->req_lock, flags);
@@ -209,18 +306,21 @@ requeue:
 static int
 uvc_video_free_requests(struct uvc_video *video)
 {
+	struct uvc_request *ureq;
 	unsigned int i;
 
 	for (i = 0; i < UVC_NUM_REQUESTS; ++i) {
-		if (video->req[i]) {
-			usb_ep_free_request(video->ep, video->req[i]);
-			video->req[i] = NULL;
-		}
+		ureq = &video->ureq[i];
 
-		if (video->req_buffer[i]) {
-			kfree(video->req_buffer[i]);
-			video->req_buffer[i] = NULL;
+		if (ureq->req) {
+			usb_ep_free_request(video->ep, ureq->req);
+			ureq->req = NULL;
 		}
+
+		kfree(ureq->req_buffer);
+		ureq->req_buffer = NULL;
+		kfree(ureq->sg);
+		ureq->sg = NULL;
 	}
 
 	INIT_LIST_HEAD(&video->req_free);
@@ -231,6 +331,7 @@ uvc_video_free_requests(struct uvc_video *video)
 static int
 uvc_video_alloc_requests(struct uvc_video *video)
 {
+	struct uvc_request *ureq;
 	unsigned int req_size;
 	unsigned int i;
 	int ret = -ENOMEM;
@@ -241,24 +342,44 @@ uvc_video_alloc_requests(struct uvc_video *video)
 		 * max_t(unsigned int, video->ep->maxburst, 1)
 		 * (video->ep->mult);
 
-	for (i = 0; i < UVC_NUM_REQUESTS; ++i) {
-		video->req_buffer[i] = kmalloc(req_size, GFP_KERNEL);
-		if (video->req_buffer[i] == NULL)
+	/* With SG, the request buffer only holds the payload header */
+	if (video->queue.use_sg)
+		video->num_requests = UVC_NUM_REQUESTS;
+	else
+		video->num_requests = UVC_NUM_COPY_REQUESTS;
+
+	for (i = 0; i < video->num_requests; ++i) {
+		ureq = &video->ureq[i];
+
+		ureq->req_buffer = kmalloc(video->queue.use_sg ? 2 : req_size,
+					   GFP_KERNEL);
+		if (ureq->req_buffer == NULL)
 			goto error;
 
-		video->req[i] = usb_ep_alloc_request(video->ep, GFP_KERNEL);
-		if (video->req[i] == NULL)
+		if (video->queue.use_sg) {
+			ureq->sg = kcalloc(UVC_MAX_SG_ENTRIES,
+					   sizeof(*ureq->sg), GFP_KERNEL);
+			if (ureq->sg == NULL)
+				goto error;
+		}
+
+		ureq->req = usb_ep_alloc_request(video->ep, GFP_KERNEL);
+		if (ureq->req == NULL)
 			goto error;
 
-		video->req[i]->buf = video->req_buffer[i];
-		video->req[i]->length = 0;
-		video->req[i]->complete = uvc_video_complete;
-		video->req[i]->context = video;
+		ureq->video = video;
+		ureq->last_buf = NULL;
 
-		list_add_tail(&video->req[i]->list, &video->req_free);
+		ureq->req->buf = ureq->req_buffer;
+		ureq->req->length = 0;
+		ureq->req->complete = uvc_video_complete;
+		ureq->req->context = ureq;
+
+		list_add_tail(&ureq->req->list, &video->req_free);
 	}
 
 	video->req_size = req_size;
+	video->req_int_count = 0;
 
 	return 0;
 
@@ -314,6 +435,7 @@ int uvcg_video_pump(struct uvc_video *video)
 		}
 
 		video->encode(req, video, buf);
+		uvc_video_set_interrupt(video, req, buf);
 
 		/* Queue the USB request */
 		ret = usb_ep_queue(video->ep, req, GFP_ATOMIC);
@@ -327,6 +449,8 @@ int uvcg_video_pump(struct uvc_video *video)
 		spin_unlock_irqrestore(&queue->irqlock, flags);
 	}
 
+	uvc_video_complete_last_buf(req->context, true);
+
 	spin_lock_irqsave(&video->req_lock, flags);
 	list_add_tail(&req->list, &video->req_free);
 	spin_unlock_irqrestore(&video->req_lock, flags);
@@ -349,8 +473,8 @@ int uvcg_video_enable(struct uvc_video *video, int enable)
 
 	if (!enable) {
 		for (i = 0; i < UVC_NUM_REQUESTS; ++i)
-			if (video->req[i])
-				usb_ep_dequeue(video->ep, video->req[i]);
+			if (video->ureq[i].req)
+				usb_ep_dequeue(video->ep, video->ureq[i].req);
 
 		uvc_video_free_requests(video);
 		uvcg_queue_enable(&video->queue, 0);
@@ -366,8 +490,11 @@ int uvcg_video_enable(struct uvc_video *video, int enable)
 	if (video->max_payload_size) {
 		video->encode = uvc_video_encode_bulk;
 		video->payload_size = 0;
-	} else
+	} else if (video->queue.use_sg) {
+		video->encode = uvc_video_encode_isoc_sg;
+	} else {
 		video->encode = uvc_video_encode_isoc;
+	}
 
 	return uvcg_video_pump(video);
 }
@@ -375,7 +502,7 @@ int uvcg_video_enable(struct uvc_video *video, int enable)
 /*
  * Initialize the UVC video stream.
  */
-int uvcg_video_init(struct uvc_video *video)
+int uvcg_video_init(struct uvc_video *video, struct usb_gadget *gadget)
 {
 	INIT_LIST_HEAD(&video->req_free);
 	spin_lock_init(&video->req_lock);
@@ -387,8 +514,9 @@ int uvcg_video_init(struct uvc_video *video)
 	video->imagesize = 320 * 240 * 2;
 
 	/* Initialize the video buffers queue. */
-	uvcg_queue_init(&video->queue, V4L2_BUF_TYPE_VIDEO_OUTPUT,
-			&video->mutex);
+	uvcg_queue_init(&video->queue,
+			gadget->sg_supported ? gadget->dev.parent : NULL,
+			V4L2_BUF_TYPE_VIDEO_OUTPUT, &video->mutex);
 	return 0;
 }
 
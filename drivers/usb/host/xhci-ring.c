@@ -2672,6 +2672,121 @@ static int xhci_handle_event(struct xhci_hcd *xhci)
 	return 1;
 }
 
+/*
+ * Ring the doorbells deferred by giveback_first_trb() while events were
+ * handled, e.g. for URBs resubmitted from their completion handler.
+ */
+static void xhci_ring_deferred_doorbells(struct xhci_hcd *xhci)
+{
+	unsigned int i, slot_id, ep_index;
+
+	for (i = 0; i < xhci->db_deferred_count; i++) {
+		slot_id = xhci->db_deferred[i] >> 5;
+		ep_index = xhci->db_deferred[i] & 0x1f;
+		if (!xhci->devs[slot_id])
+			continue;
+		xhci->devs[slot_id]->eps[ep_index].ep_state &= ~EP_DB_DEFERRED;
+		if (!(xhci->xhc_state & XHCI_STATE_DYING))
+			xhci_ring_ep_doorbell(xhci, slot_id, ep_index, 0);
+	}
+	xhci->db_deferred_count = 0;
+}
+
+/*
+ * Switch to a longer interrupt moderation interval while the event rate is
+ * high, and back once it dropped to half of that.
+ */
+static void xhci_update_imod(struct xhci_hcd *xhci, unsigned int events)
+{
+	unsigned long now = jiffies;
+	unsigned int elapsed;
+	u32 interval, temp;
+	u64 rate;
+
+	if (!xhci->imod_busy_rate || !xhci->imod_interval)
+		return;
+
+	xhci->imod_events += events;
+	elapsed = jiffies_to_msecs(now - xhci->imod_stamp);
+	if (elapsed < XHCI_IMOD_WINDOW_MS)
+		return;
+
+	rate = div_u64((u64)xhci->imod_events * MSEC_PER_SEC, elapsed);
+	if (rate > xhci->imod_busy_rate)
+		interval = xhci->imod_busy_interval;
+	else if (rate < xhci->imod_busy_rate / 2)
+		interval = xhci->imod_interval;
+	else
+		interval = xhci->imod_cur_interval;
+
+	if (interval != xhci->imod_cur_interval) {
+		temp = readl(&xhci->ir_set->irq_control);
+		temp &= ~ER_IRQ_INTERVAL_MASK;
+		temp |= (interval / 250) & ER_IRQ_INTERVAL_MASK;
+		writel(temp, &xhci->ir_set->irq_control);
+		xhci->imod_cur_interval = interval;
+	}
+
+	xhci->imod_events = 0;
+	xhci->imod_stamp = now;
+}
+
+/*
+ * Handle up to budget events and update the HW's event ring dequeue pointer.
+ * The event handler busy flag is only cleared once the event ring is empty:
+ * until then, the xHC doesn't interrupt and xhci_event_poll() goes on.
+ * Returns the number of events handled.
+ */
+static int xhci_handle_events(struct xhci_hcd *xhci, int budget)
+{
+	union xhci_trb *event_ring_deq = xhci->event_ring->dequeue;
+	dma_addr_t deq;
+	u64 temp_64;
+	int count = 0;
+
+	xhci->db_defer++;
+	while (count < budget && xhci_handle_event(xhci) > 0)
+		count++;
+	if (!--xhci->db_defer)
+		xhci_ring_deferred_doorbells(xhci);
+
+	temp_64 = xhci_read_64(xhci, &xhci->ir_set->erst_dequeue);
+	/* If necessary, update the HW's version of the event ring deq ptr. */
+	if (event_ring_deq != xhci->event_ring->dequeue) {
+		deq = xhci_trb_virt_to_dma(xhci->event_ring->deq_seg,
+				xhci->event_ring->dequeue);
+		if (deq == 0)
+			xhci_warn(xhci, "WARN something wrong with SW event "
+					"ring dequeue ptr.\n");
+		/* Update HC event ring dequeue pointer */
+		temp_64 &= ERST_PTR_MASK;
+		temp_64 |= ((u64) deq & (u64) ~ERST_PTR_MASK);
+	}
+
+	/* Clear the event handler busy flag (RW1C) once the ring is empty */
+	if (count < budget)
+		temp_64 |= ERST_EHB;
+	xhci_write_64(xhci, temp_64, &xhci->ir_set->erst_dequeue);
+
+	xhci_update_imod(xhci, count);
+
+	return count;
+}
+
+void xhci_event_poll(unsigned long data)
+{
+	struct xhci_hcd *xhci = (struct xhci_hcd *)data;
+	unsigned long flags;
+
+	spin_lock_irqsave(&xhci->lock, flags);
+	if ((xhci->xhc_state & (XHCI_STATE_DYING | XHCI_STATE_HALTED)) ||
+	    xhci_handle_events(xhci, XHCI_EVENT_BUDGET) < XHCI_EVENT_BUDGET)
+		xhci->event_polling = false;
+	else
+		tasklet_schedule(&xhci->event_poll);
+	spin_unlock_irqrestore(&xhci->lock, flags);
+}
+
 /*
  * xHCI spec says we can get an interrupt, and if the HC has an error condition,
  * we might get bad data out of the event ring.  Section 4.10.2.7 has a list of
@@ -2680,10 +2795,8 @@ static int xhci_handle_event(struct xhci_hcd *xhci)
 irqreturn_t xhci_irq(struct usb_hcd *hcd)
 {
 	struct xhci_hcd *xhci = hcd_to_xhci(hcd);
-	union xhci_trb *event_ring_deq;
 	irqreturn_t ret = IRQ_NONE;
 	unsigned long flags;
-	dma_addr_t deq;
 	u64 temp_64;
 	u32 status;
 
@@ -2735,28 +2848,16 @@ irqreturn_t xhci_irq(struct usb_hcd *hcd)
 		goto out;
 	}
 
-	event_ring_deq = xhci->event_ring->dequeue;
-	/* FIXME this should be a delayed service routine
-	 * that clears the EHB.
-	 */
-	while (xhci_handle_event(xhci) > 0) {}
-
-	temp_64 = xhci_read_64(xhci, &xhci->ir_set->erst_dequeue);
-	/* If necessary, update the HW's version of the event ring deq ptr. */
-	if (event_ring_deq != xhci->event_ring->dequeue) {
-		deq = xhci_trb_virt_to_dma(xhci->event_ring->deq_seg,
-				xhci->event_ring->dequeue);
-		if (deq == 0)
-			xhci_warn(xhci, "WARN something wrong with SW event "
-					"ring dequeue ptr.\n");
-		/* Update HC event ring dequeue pointer */
-		temp_64 &= ERST_PTR_MASK;
-		temp_64 |= ((u64) deq & (u64) ~ERST_PTR_MASK);
+	/* The event poll is still emptying the event ring */
+	if (xhci->event_polling) {
+		ret = IRQ_HANDLED;
+		goto out;
 	}
 
-	/* Clear the event handler busy flag (RW1C); event ring is empty. */
-	temp_64 |= ERST_EHB;
-	xhci_write_64(xhci, temp_64, &xhci->ir_set->erst_dequeue);
+	if (xhci_handle_events(xhci, XHCI_EVENT_BUDGET) == XHCI_EVENT_BUDGET) {
+		xhci->event_polling = true;
+		tasklet_schedule(&xhci->event_poll);
+	}
 	ret = IRQ_HANDLED;
 
 out:
@@ -2984,6 +3085,21 @@ static void check_trb_math(struct urb *urb, int running_total)
 				urb->transfer_buffer_length);
 }
 
+static bool xhci_defer_doorbell(struct xhci_hcd *xhci, int slot_id,
+		unsigned int ep_index)
+{
+	struct xhci_virt_ep *ep = &xhci->devs[slot_id]->eps[ep_index];
+
+	if (ep->ep_state & EP_DB_DEFERRED)
+		return true;
+	if (xhci->db_deferred_count == XHCI_DB_DEFER_MAX)
+		return false;
+
+	ep->ep_state |= EP_DB_DEFERRED;
+	xhci->db_deferred[xhci->db_deferred_count++] = slot_id << 5 | ep_index;
+	return true;
+}
+
 static void giveback_first_trb(struct xhci_hcd *xhci, int slot_id,
 		unsigned int ep_index, unsigned int stream_id, int start_cycle,
 		struct xhci_generic_trb *start_trb)
@@ -2997,6 +3113,11 @@ static void giveback_first_trb(struct xhci_hcd *xhci, int slot_id,
 		start_trb->field[3] |= cpu_to_le32(start_cycle);
 	else
 		start_trb->field[3] &= cpu_to_le32(~TRB_CYCLE);
+
+	/* Ring it with the others once the events being handled are done */
+	if (xhci->db_defer && !stream_id &&
+	    xhci_defer_doorbell(xhci, slot_id, ep_index))
+		return;
 	xhci_ring_ep_doorbell(xhci, slot_id, ep_index, stream_id);
 }
 
@@ -37,6 +37,14 @@ static unsigned long long quirks;
 module_param(quirks, ullong, S_IRUGO);
 MODULE_PARM_DESC(quirks, "Bit flags for quirks to be enabled as default");
 
+static unsigned int imod_busy_rate = 8000;
+module_param(imod_busy_rate, uint, S_IRUGO);
+MODULE_PARM_DESC(imod_busy_rate, "Events per second above which interrupts are moderated more, 0 to disable");
+
+static unsigned int imod_busy_factor = 4;
+module_param(imod_busy_factor, uint, S_IRUGO);
+MODULE_PARM_DESC(imod_busy_factor, "Multiplier of the interrupt moderation interval under load");
+
 static bool td_on_ring(struct xhci_td *td, struct xhci_ring *ring)
 {
 	struct xhci_segment *seg = ring->first_seg;
@@ -580,6 +588,7 @@ static int xhci_init(struct usb_hcd *hcd)
 
 	xhci_dbg_trace(xhci, trace_xhci_dbg_init, "xhci_init");
 	spin_lock_init(&xhci->lock);
+	tasklet_init(&xhci->event_poll, xhci_event_poll, (unsigned long)xhci);
 	if (xhci->hci_version == 0x95 && link_quirk) {
 		xhci_dbg_trace(xhci, trace_xhci_dbg_quirks,
 				"QUIRK: Not clearing Link TRB chain bits.");
@@ -664,6 +673,13 @@ int xhci_run(struct usb_hcd *hcd)
 	temp &= ~ER_IRQ_INTERVAL_MASK;
 	temp |= (xhci->imod_interval / 250) & ER_IRQ_INTERVAL_MASK;
 	writel(temp, &xhci->ir_set->irq_control);
+	xhci->imod_cur_interval = xhci->imod_interval;
+	xhci->imod_busy_interval = min_t(u32, xhci->imod_interval *
+					 imod_busy_factor,
+					 ER_IRQ_INTERVAL_MASK * 250);
+	xhci->imod_busy_rate = imod_busy_rate;
+	xhci->imod_events = 0;
+	xhci->imod_stamp = jiffies;
 
 	/* Set the HCD state before we enable the irqs */
 	temp = readl(&xhci->op_regs->command);
@@ -732,6 +748,7 @@ static void xhci_stop(struct usb_hcd *hcd)
 	xhci_reset(xhci);
 	spin_unlock_irq(&xhci->lock);
 
+	tasklet_kill(&xhci->event_poll);
 	xhci_cleanup_msix(xhci);
 
 	/* Deleting Compliance Mode Recovery Timer */
@@ -993,6 +1010,8 @@ int xhci_suspend(struct xhci_hcd *xhci, bool do_wakeup)
 	if (xhci->quirks & XHCI_SUSPEND_DELAY)
 		usleep_range(1000, 1500);
 
+	tasklet_kill(&xhci->event_poll);
+
 	spin_lock_irq(&xhci->lock);
 	clear_bit(HCD_FLAG_HW_ACCESSIBLE, &hcd->flags);
 	clear_bit(HCD_FLAG_HW_ACCESSIBLE, &xhci->shared_hcd->flags);
@@ -928,6 +928,8 @@ struct xhci_virt_ep {
 #define EP_GETTING_NO_STREAMS	(1 << 5)
 #define EP_HARD_CLEAR_TOGGLE	(1 << 6)
 #define EP_SOFT_CLEAR_TOGGLE	(1 << 7)
+/* Doorbell deferred until the events being handled are processed */
+#define EP_DB_DEFERRED		(1 << 8)
 	/* ----  Related to URB cancellation ---- */
 	struct list_head	cancelled_td_list;
 	/* Watchdog timer for stop endpoint command to cancel URBs */
@@ -1488,6 +1490,12 @@ static inline const char *xhci_trb_type_string(u8 type)
 #define TRBS_PER_SEGMENT	256
 /* Allow two commands + a link TRB, along with any reserved command TRBs */
 #define MAX_RSVD_CMD_TRBS	(TRBS_PER_SEGMENT - 3)
+/* Events handled per interrupt before the rest is left to the event poll */
+#define XHCI_EVENT_BUDGET	64
+/* Endpoints whose doorbell may be deferred while handling events */
+#define XHCI_DB_DEFER_MAX	16
+/* Period over which the event rate is measured for interrupt moderation */
+#define XHCI_IMOD_WINDOW_MS	20
 #define TRB_SEGMENT_SIZE	(TRBS_PER_SEGMENT*16)
 #define TRB_SEGMENT_SHIFT	(ilog2(TRB_SEGMENT_SIZE))
 /* TRB buffer pointers can't cross 64KB boundaries */
@@ -1736,6 +1744,12 @@ struct xhci_hcd {
 	u8		isoc_threshold;
 	/* imod_interval in ns (I * 250ns) */
 	u32		imod_interval;
+	/* used instead while more than imod_busy_rate events/s are handled */
+	u32		imod_busy_interval;
+	u32		imod_busy_rate;
+	u32		imod_cur_interval;
+	unsigned int	imod_events;
+	unsigned long	imod_stamp;
 	int		event_ring_max;
 	/* 4KB min, 128MB max */
 	int		page_size;
@@ -1760,6 +1774,13 @@ struct xhci_hcd {
 	struct xhci_command	*current_cmd;
 	struct xhci_ring	*event_ring;
 	struct xhci_erst	erst;
+	/* Handles the events left once XHCI_EVENT_BUDGET is used up */
+	struct tasklet_struct	event_poll;
+	bool			event_polling;
+	/* Doorbells deferred while handling events, slot_id << 5 | ep_index */
+	unsigned int		db_defer;
+	unsigned int		db_deferred_count;
+	u16			db_deferred[XHCI_DB_DEFER_MAX];
 	/* Scratchpad */
 	struct xhci_scratchpad  *scratchpad;
 	/* Store LPM test failed devices' information */
@@ -2044,6 +2065,7 @@ int xhci_suspend(struct xhci_hcd *xhci, bool do_wakeup);
 int xhci_resume(struct xhci_hcd *xhci, bool hibernated);
 
 irqreturn_t xhci_irq(struct usb_hcd *hcd);
+void xhci_event_poll(unsigned long data);
 irqreturn_t xhci_msi_irq(int irq, void *hcd);
 int xhci_alloc_dev(struct usb_hcd *hcd, struct usb_device *udev);
 int xhci_alloc_tt_info(struct xhci_hcd *xhci,
@@ -43,6 +43,9 @@ struct uas_dev_info {
 	unsigned use_streams:1;
 	unsigned shutdown:1;
 	struct scsi_cmnd *cmnd[MAX_CMNDS];
+	/* per uas-tag command urbs for CDBs up to 16 bytes, reused */
+	struct urb *cmd_urb_cache[MAX_CMNDS];
+	DECLARE_BITMAP(cmd_urb_busy, MAX_CMNDS);
 	spinlock_t lock;
 	struct work_struct work;
 };
@@ -196,6 +199,19 @@ static void uas_log_cmd_state(struct scsi_cmnd *cmnd, const char *prefix,
 	scsi_print_command(cmnd);
 }
 
+static void uas_free_cmd_urb(struct urb *urb)
+{
+	struct uas_dev_info *devinfo = urb->context;
+	struct command_iu *iu = urb->transfer_buffer;
+
+	/* A cached urb has the device as context, and is given back */
+	if (devinfo)
+		clear_bit_unlock(be16_to_cpu(iu->tag) - 1,
+				 devinfo->cmd_urb_busy);
+	else
+		usb_free_urb(urb);
+}
+
 static void uas_free_unsubmitted_urbs(struct scsi_cmnd *cmnd)
 {
 	struct uas_cmd_info *cmdinfo;
@@ -205,8 +221,8 @@ static void uas_free_unsubmitted_urbs(struct scsi_cmnd *cmnd)
 
 	cmdinfo = (void *)&cmnd->SCp;
 
-	if (cmdinfo->state & SUBMIT_CMD_URB)
-		usb_free_urb(cmdinfo->cmd_urb);
+	if ((cmdinfo->state & SUBMIT_CMD_URB) && cmdinfo->cmd_urb)
+		uas_free_cmd_urb(cmdinfo->cmd_urb);
 
 	/* data urbs may have never gotten their submit flag set */
 	if (!(cmdinfo->state & DATA_IN_URB_INFLIGHT))
@@ -416,7 +432,7 @@ static void uas_cmd_cmplt(struct urb *urb)
 	if (urb->status)
 		dev_err(&urb->dev->dev, "cmd cmplt err %d\n", urb->status);
 
-	usb_free_urb(urb);
+	uas_free_cmd_urb(urb);
 }
 
 static struct urb *uas_alloc_data_urb(struct uas_dev_info *devinfo, gfp_t gfp,
@@ -476,31 +492,46 @@ static struct urb *uas_alloc_cmd_urb(struct uas_dev_info *devinfo, gfp_t gfp,
 	struct usb_device *udev = devinfo->udev;
 	struct scsi_device *sdev = cmnd->device;
 	struct uas_cmd_info *cmdinfo = (void *)&cmnd->SCp;
-	struct urb *urb = usb_alloc_urb(0, gfp);
+	unsigned int idx = cmdinfo->uas_tag - 1;
+	struct urb *urb;
 	struct command_iu *iu;
 	int len;
 
-	if (!urb)
-		goto out;
-
 	len = cmnd->cmd_len - 16;
 	if (len < 0)
 		len = 0;
 	len = ALIGN(len, 4);
+
+	/*
+	 * The cached urb of the tag may still be waiting for its completion
+	 * from a previous command, which can complete before it.
+	 */
+	if (!len && devinfo->cmd_urb_cache[idx] &&
+	    !test_and_set_bit_lock(idx, devinfo->cmd_urb_busy)) {
+		urb = devinfo->cmd_urb_cache[idx];
+		iu = urb->transfer_buffer;
+		memset(iu, 0, sizeof(*iu));
+		goto fill;
+	}
+
+	urb = usb_alloc_urb(0, gfp);
+	if (!urb)
+		goto out;
+
 	iu = kzalloc(sizeof(*iu) + len, gfp);
 	if (!iu)
 		goto free;
 
+	usb_fill_bulk_urb(urb, udev, devinfo->cmd_pipe, iu, sizeof(*iu) + len,
+							uas_cmd_cmplt, NULL);
+	urb->transfer_flags |= URB_FREE_BUFFER;
+ fill:
 	iu->iu_id = IU_ID_COMMAND;
 	iu->tag = cpu_to_be16(cmdinfo->uas_tag);
 	iu->prio_attr = UAS_SIMPLE_TAG;
 	iu->len = len;
 	int_to_scsilun(sdev->lun, &iu->lun);
 	memcpy(iu->cdb, cmnd->cmnd, cmnd->cmd_len);
-
-	usb_fill_bulk_urb(urb, udev, devinfo->cmd_pipe, iu, sizeof(*iu) + len,
-							uas_cmd_cmplt, NULL);
-	urb->transfer_flags |= URB_FREE_BUFFER;
  out:
 	return urb;
  free:
@@ -943,6 +974,41 @@ static int uas_configure_endpoints(struct uas_dev_info *devinfo)
 	return 0;
 }
 
+/* Failing to allocate a cached urb only costs a per command allocation */
+static void uas_alloc_cmd_urb_cache(struct uas_dev_info *devinfo)
+{
+	struct command_iu *iu;
+	struct urb *urb;
+	int i;
+
+	for (i = 0; i < devinfo->qdepth; i++) {
+		urb = usb_alloc_urb(0, GFP_KERNEL);
+		if (!urb)
+			return;
+		iu = kzalloc(sizeof(*iu), GFP_KERNEL);
+		if (!iu) {
+			usb_free_urb(urb);
+			return;
+		}
+		usb_fill_bulk_urb(urb, devinfo->udev, devinfo->cmd_pipe, iu,
+				  sizeof(*iu), uas_cmd_cmplt, devinfo);
+		devinfo->cmd_urb_cache[i] = urb;
+	}
+}
+
+static void uas_free_cmd_urb_cache(struct uas_dev_info *devinfo)
+{
+	int i;
+
+	for (i = 0; i < MAX_CMNDS; i++) {
+		if (!devinfo->cmd_urb_cache[i])
+			continue;
+		kfree(devinfo->cmd_urb_cache[i]->transfer_buffer);
+		usb_free_urb(devinfo->cmd_urb_cache[i]);
+		devinfo->cmd_urb_cache[i] = NULL;
+	}
+}
+
 static void uas_free_streams(struct uas_dev_info *devinfo)
 {
 	struct usb_device *udev = devinfo->udev;
@@ -1001,6 +1067,8 @@ static int uas_probe(struct usb_interface *intf, const struct usb_device_id *id)
 	 */
 	shost->can_queue = devinfo->qdepth - 2;
 
+	uas_alloc_cmd_urb_cache(devinfo);
+
 	usb_set_intfdata(intf, shost);
 	result = scsi_add_host(shost, &intf->dev);
 	if (result)
@@ -1010,6 +1078,7 @@ static int uas_probe(struct usb_interface *intf, const struct usb_device_id *id)
 	return result;
 
 free_streams:
+	uas_free_cmd_urb_cache(devinfo);
 	uas_free_streams(devinfo);
 	usb_set_intfdata(intf, NULL);
 set_alt0:
@@ -1175,6 +1244,7 @@ static void uas_disconnect(struct usb_interface *intf)
 	uas_zap_pending(devinfo, DID_NO_CONNECT);
 
 	scsi_remove_host(shost);
+	uas_free_cmd_urb_cache(devinfo);
 	uas_free_streams(devinfo);
 	scsi_host_put(shost);
 }
@@ -1473,6 +1473,9 @@ int f2fs_write_checkpoint(struct f2fs_sb_info *sbi, struct cp_control *cpc)
 
 	f2fs_flush_merged_writes(sbi);
 
+	/* only the regular logs are recorded in the checkpoint */
+	f2fs_close_data_streams(sbi);
+
 	/* this is the case of multiple fstrims without any changes */
 	if (cpc->reason & CP_DISCARD) {
 		if (!f2fs_exist_trim_candidates(sbi, cpc)) {
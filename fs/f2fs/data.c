@@ -356,12 +356,12 @@ static bool has_merged_page(struct f2fs_sb_info *sbi, struct inode *inode,
 				nid_t ino, pgoff_t idx, enum page_type type)
 {
 	enum page_type btype = PAGE_TYPE_OF_BIO(type);
-	enum temp_type temp;
+	int i, n = (btype == DATA) ? NR_DATA_WRITE_IO : NR_TEMP_TYPE;
 	struct f2fs_bio_info *io;
 	bool ret = false;
 
-	for (temp = HOT; temp < NR_TEMP_TYPE; temp++) {
-		io = sbi->write_io[btype] + temp;
+	for (i = HOT; i < n; i++) {
+		io = sbi->write_io[btype] + i;
 
 		down_read(&io->io_rwsem);
 		ret = __has_merged_page(io, inode, ino, idx);
@@ -375,10 +375,10 @@ static bool has_merged_page(struct f2fs_sb_info *sbi, struct inode *inode,
 }
 
 static void __f2fs_submit_merged_write(struct f2fs_sb_info *sbi,
-				enum page_type type, enum temp_type temp)
+				enum page_type type, int i)
 {
 	enum page_type btype = PAGE_TYPE_OF_BIO(type);
-	struct f2fs_bio_info *io = sbi->write_io[btype] + temp;
+	struct f2fs_bio_info *io = sbi->write_io[btype] + i;
 
 	down_write(&io->io_rwsem);
 
@@ -398,14 +398,15 @@ static void __submit_merged_write_cond(struct f2fs_sb_info *sbi,
 				struct inode *inode, nid_t ino, pgoff_t idx,
 				enum page_type type, bool force)
 {
-	enum temp_type temp;
+	int i, n = (PAGE_TYPE_OF_BIO(type) == DATA) ?
+				NR_DATA_WRITE_IO : NR_TEMP_TYPE;
 
 	if (!force && !has_merged_page(sbi, inode, ino, idx, type))
 		return;
 
-	for (temp = HOT; temp < NR_TEMP_TYPE; temp++) {
+	for (i = HOT; i < n; i++) {
 
-		__f2fs_submit_merged_write(sbi, type, temp);
+		__f2fs_submit_merged_write(sbi, type, i);
 
 		/* TODO: use HOT temp only for meta pages now. */
 		if (type >= META)
@@ -474,7 +475,8 @@ void f2fs_submit_page_write(struct f2fs_io_info *fio)
 {
 	struct f2fs_sb_info *sbi = fio->sbi;
 	enum page_type btype = PAGE_TYPE_OF_BIO(fio->type);
-	struct f2fs_bio_info *io = sbi->write_io[btype] + fio->temp;
+	struct f2fs_bio_info *io = sbi->write_io[btype] +
+						__write_io_index(fio);
 	struct page *bio_page;
 
 	f2fs_bug_on(sbi, is_read_io(fio->op));
@@ -38,6 +38,8 @@ static void update_general_status(struct f2fs_sb_info *sbi)
 	si->hit_rbtree = atomic64_read(&sbi->read_hit_rbtree);
 	si->hit_total = si->hit_largest + si->hit_cached + si->hit_rbtree;
 	si->total_ext = atomic64_read(&sbi->total_hit_ext);
+	si->ext_top_nr = f2fs_extent_tree_top_stat(sbi, si->ext_top,
+						F2FS_EXT_TOP_INODES);
 	si->ext_tree = atomic_read(&sbi->total_ext_tree);
 	si->zombie_tree = atomic_read(&sbi->total_zombie_tree);
 	si->ext_node = atomic_read(&sbi->total_ext_node);
@@ -203,8 +205,8 @@ static void update_mem_info(struct f2fs_sb_info *sbi)
 	si->base_mem += f2fs_bitmap_size(MAIN_SECS(sbi));
 
 	/* build curseg */
-	si->base_mem += sizeof(struct curseg_info) * NR_CURSEG_TYPE;
-	si->base_mem += PAGE_SIZE * NR_CURSEG_TYPE;
+	si->base_mem += sizeof(struct curseg_info) * NR_CURSEG_ARRAY;
+	si->base_mem += PAGE_SIZE * NR_CURSEG_ARRAY;
 
 	/* build dirty segmap */
 	si->base_mem += sizeof(struct dirty_seglist_info);
@@ -359,6 +361,15 @@ static int stat_show(struct seq_file *s, void *v)
 				si->hit_total, si->total_ext);
 		seq_printf(s, "  - Inner Struct Count: tree: %d(%d), node: %d\n",
 				si->ext_tree, si->zombie_tree, si->ext_node);
+		if (si->ext_top_nr)
+			seq_puts(s, "  - Top Lookup Inodes:\n");
+		for (j = 0; j < si->ext_top_nr; j++)
+			seq_printf(s, "    ino %u: Hit Ratio: %llu%% (%llu / %llu)\n",
+				si->ext_top[j].ino,
+				div64_u64(si->ext_top[j].read_hit * 100,
+					si->ext_top[j].total_hit),
+				si->ext_top[j].read_hit,
+				si->ext_top[j].total_hit);
 		seq_puts(s, "\nBalancing F2FS Async:\n");
 		seq_printf(s, "  - IO (CP: %4d, Data: %4d, Flush: (%4d %4d %4d), "
 			"Discard: (%4d %4d)) cmd: %4d undiscard:%4u\n",
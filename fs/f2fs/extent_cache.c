@@ -191,9 +191,97 @@ bool f2fs_check_rb_tree_consistence(struct f2fs_sb_info *sbi,
 	return true;
 }
 
+#ifdef CONFIG_F2FS_STAT_FS
+#define EXT_TREE_VEC_SIZE	16
+
+/* fill @top with the @nr inodes doing the most extent cache lookups */
+int f2fs_extent_tree_top_stat(struct f2fs_sb_info *sbi,
+				struct f2fs_extent_stat *top, int nr)
+{
+	struct extent_tree *trees[EXT_TREE_VEC_SIZE];
+	unsigned int found, i;
+	nid_t ino = 0;
+	int n = 0, j;
+
+	mutex_lock(&sbi->extent_tree_lock);
+	while ((found = radix_tree_gang_lookup(&sbi->extent_tree_root,
+				(void **)trees, ino, EXT_TREE_VEC_SIZE))) {
+		for (i = 0; i < found; i++) {
+			struct extent_tree *et = trees[i];
+			u64 total = atomic64_read(&et->total_hit);
+
+			ino = et->ino + 1;
+			if (!total)
+				continue;
+			if (n == nr && top[nr - 1].total_hit >= total)
+				continue;
+
+			for (j = min(n, nr - 1);
+				j > 0 && top[j - 1].total_hit < total; j--)
+				top[j] = top[j - 1];
+
+			top[j].ino = et->ino;
+			top[j].total_hit = total;
+			top[j].read_hit = atomic64_read(&et->read_hit);
+			if (n < nr)
+				n++;
+		}
+	}
+	mutex_unlock(&sbi->extent_tree_lock);
+
+	return n;
+}
+#endif
+
 static struct kmem_cache *extent_tree_slab;
 static struct kmem_cache *extent_node_slab;
 
+/*
+ * Lookups walk the extent tree locklessly, and retry whenever et->seq tells
+ * them the tree was changed meanwhile.  Updates stay serialized by et->lock,
+ * and bump et->seq around every change of the tree, of its nodes or of
+ * et->largest.  Nodes come from a SLAB_TYPESAFE_BY_RCU cache, so a lookup
+ * racing with a removal reads stale data at worst, which the retry drops.
+ */
+static void __extent_tree_write_lock(struct extent_tree *et)
+{
+	write_lock(&et->lock);
+	write_seqcount_begin(&et->seq);
+}
+
+static bool __extent_tree_write_trylock(struct extent_tree *et)
+{
+	if (!write_trylock(&et->lock))
+		return false;
+	write_seqcount_begin(&et->seq);
+	return true;
+}
+
+static void __extent_tree_write_unlock(struct extent_tree *et)
+{
+	write_seqcount_end(&et->seq);
+	write_unlock(&et->lock);
+}
+
+static struct extent_node *__lookup_extent_node_lockless(
+				struct extent_tree *et, unsigned int ofs)
+{
+	struct rb_node *node = READ_ONCE(et->root.rb_node);
+	struct extent_node *en;
+
+	while (node) {
+		en = rb_entry(node, struct extent_node, rb_node);
+
+		if (ofs < en->ei.fofs)
+			node = READ_ONCE(node->rb_left);
+		else if (ofs >= en->ei.fofs + en->ei.len)
+			node = READ_ONCE(node->rb_right);
+		else
+			return en;
+	}
+	return NULL;
+}
+
 static struct extent_node *__attach_extent_node(struct f2fs_sb_info *sbi,
 				struct extent_tree *et, struct extent_info *ei,
 				struct rb_node *parent, struct rb_node **p)
@@ -208,7 +296,7 @@ static struct extent_node *__attach_extent_node(struct f2fs_sb_info *sbi,
 	INIT_LIST_HEAD(&en->list);
 	en->et = et;
 
-	rb_link_node(&en->rb_node, parent, p);
+	rb_link_node_rcu(&en->rb_node, parent, p);
 	rb_insert_color(&en->rb_node, &et->root);
 	atomic_inc(&et->node_cnt);
 	atomic_inc(&sbi->total_ext_node);
@@ -260,6 +348,7 @@ static struct extent_tree *__grab_extent_tree(struct inode *inode)
 		et->root = RB_ROOT;
 		et->cached_en = NULL;
 		rwlock_init(&et->lock);
+		seqcount_init(&et->seq);
 		INIT_LIST_HEAD(&et->list);
 		atomic_set(&et->node_cnt, 0);
 		atomic_inc(&sbi->total_ext_tree);
@@ -342,7 +431,7 @@ static bool __f2fs_init_extent_tree(struct inode *inode, struct f2fs_extent *i_e
 
 	get_extent_info(&ei, i_ext);
 
-	write_lock(&et->lock);
+	__extent_tree_write_lock(et);
 	if (atomic_read(&et->node_cnt))
 		goto out;
 
@@ -353,7 +442,7 @@ static bool __f2fs_init_extent_tree(struct inode *inode, struct f2fs_extent *i_e
 		spin_unlock(&sbi->extent_lock);
 	}
 out:
-	write_unlock(&et->lock);
+	__extent_tree_write_unlock(et);
 	return false;
 }
 
@@ -372,44 +461,75 @@ static bool f2fs_lookup_extent_tree(struct inode *inode, pgoff_t pgofs,
 {
 	struct f2fs_sb_info *sbi = F2FS_I_SB(inode);
 	struct extent_tree *et = F2FS_I(inode)->extent_tree;
-	struct extent_node *en;
-	bool ret = false;
+	struct extent_node *en, *cached_en;
+	unsigned int seq;
+	bool largest;
+	bool ret;
 
 	f2fs_bug_on(sbi, !et);
 
 	trace_f2fs_lookup_extent_tree_start(inode, pgofs);
 
-	read_lock(&et->lock);
+	rcu_read_lock();
+
+	do {
+		seq = read_seqcount_begin(&et->seq);
+		ret = largest = false;
+		en = NULL;
+
+		if (et->largest.fofs <= pgofs &&
+				et->largest.fofs + et->largest.len > pgofs) {
+			*ei = et->largest;
+			ret = largest = true;
+			continue;
+		}
+
+		cached_en = READ_ONCE(et->cached_en);
+		if (cached_en && cached_en->ei.fofs <= pgofs &&
+				cached_en->ei.fofs + cached_en->ei.len > pgofs)
+			en = cached_en;
+		else
+			en = __lookup_extent_node_lockless(et, pgofs);
+
+		if (en) {
+			*ei = en->ei;
+			ret = true;
+		}
+	} while (read_seqcount_retry(&et->seq, seq));
 
-	if (et->largest.fofs <= pgofs &&
-			et->largest.fofs + et->largest.len > pgofs) {
-		*ei = et->largest;
-		ret = true;
+	if (largest) {
 		stat_inc_largest_node_hit(sbi);
 		goto out;
 	}
 
-	en = (struct extent_node *)f2fs_lookup_rb_tree(&et->root,
-				(struct rb_entry *)et->cached_en, pgofs);
 	if (!en)
 		goto out;
 
-	if (en == et->cached_en)
+	if (en == cached_en) {
+		/* already at the tail of the LRU list the last time around */
 		stat_inc_cached_node_hit(sbi);
-	else
-		stat_inc_rbtree_node_hit(sbi);
+		goto out;
+	}
+
+	stat_inc_rbtree_node_hit(sbi);
 
-	*ei = en->ei;
+	/*
+	 * The node may have been freed, or even reused, since the lookup;
+	 * it is only moved if it is still on the list and in this tree.
+	 */
 	spin_lock(&sbi->extent_lock);
-	if (!list_empty(&en->list)) {
+	if (!list_empty(&en->list) && en->et == et) {
 		list_move_tail(&en->list, &sbi->extent_list);
-		et->cached_en = en;
+		WRITE_ONCE(et->cached_en, en);
 	}
 	spin_unlock(&sbi->extent_lock);
-	ret = true;
 out:
+	rcu_read_unlock();
+
 	stat_inc_total_hit(sbi);
-	read_unlock(&et->lock);
+	stat_inc_tree_total_hit(et);
+	if (ret)
+		stat_inc_tree_read_hit(et);
 
 	trace_f2fs_lookup_extent_tree_end(inode, pgofs, ei);
 	return ret;
@@ -501,10 +621,10 @@ static void f2fs_update_extent_tree_range(struct inode *inode,
 
 	trace_f2fs_update_extent_tree_range(inode, fofs, blkaddr, len);
 
-	write_lock(&et->lock);
+	__extent_tree_write_lock(et);
 
 	if (is_inode_flag_set(inode, FI_NO_EXTENT)) {
-		write_unlock(&et->lock);
+		__extent_tree_write_unlock(et);
 		return;
 	}
 
@@ -610,7 +730,7 @@ static void f2fs_update_extent_tree_range(struct inode *inode,
 		updated = true;
 	}
 
-	write_unlock(&et->lock);
+	__extent_tree_write_unlock(et);
 
 	if (updated)
 		f2fs_mark_inode_dirty_sync(inode, true);
@@ -635,9 +755,9 @@ unsigned int f2fs_shrink_extent_tree(struct f2fs_sb_info *sbi, int nr_shrink)
 	/* 1. remove unreferenced extent tree */
 	list_for_each_entry_safe(et, next, &sbi->zombie_list, list) {
 		if (atomic_read(&et->node_cnt)) {
-			write_lock(&et->lock);
+			__extent_tree_write_lock(et);
 			node_cnt += __free_extent_tree(sbi, et);
-			write_unlock(&et->lock);
+			__extent_tree_write_unlock(et);
 		}
 		f2fs_bug_on(sbi, atomic_read(&et->node_cnt));
 		list_del_init(&et->list);
@@ -667,7 +787,7 @@ free_node:
 		en = list_first_entry(&sbi->extent_list,
 					struct extent_node, list);
 		et = en->et;
-		if (!write_trylock(&et->lock)) {
+		if (!__extent_tree_write_trylock(et)) {
 			/* refresh this extent node's position in extent list */
 			list_move_tail(&en->list, &sbi->extent_list);
 			continue;
@@ -678,7 +798,7 @@ free_node:
 
 		__detach_extent_node(sbi, et, en);
 
-		write_unlock(&et->lock);
+		__extent_tree_write_unlock(et);
 		node_cnt++;
 		spin_lock(&sbi->extent_lock);
 	}
@@ -701,9 +821,9 @@ unsigned int f2fs_destroy_extent_node(struct inode *inode)
 	if (!et || !atomic_read(&et->node_cnt))
 		return 0;
 
-	write_lock(&et->lock);
+	__extent_tree_write_lock(et);
 	node_cnt = __free_extent_tree(sbi, et);
-	write_unlock(&et->lock);
+	__extent_tree_write_unlock(et);
 
 	return node_cnt;
 }
@@ -719,13 +839,13 @@ void f2fs_drop_extent_tree(struct inode *inode)
 
 	set_inode_flag(inode, FI_NO_EXTENT);
 
-	write_lock(&et->lock);
+	__extent_tree_write_lock(et);
 	__free_extent_tree(sbi, et);
 	if (et->largest.len) {
 		et->largest.len = 0;
 		updated = true;
 	}
-	write_unlock(&et->lock);
+	__extent_tree_write_unlock(et);
 	if (updated)
 		f2fs_mark_inode_dirty_sync(inode, true);
 }
@@ -819,8 +939,9 @@ int __init f2fs_create_extent_cache(void)
 			sizeof(struct extent_tree));
 	if (!extent_tree_slab)
 		return -ENOMEM;
-	extent_node_slab = f2fs_kmem_cache_create("f2fs_extent_node",
-			sizeof(struct extent_node));
+	extent_node_slab = kmem_cache_create("f2fs_extent_node",
+			sizeof(struct extent_node), 0,
+			SLAB_RECLAIM_ACCOUNT | SLAB_TYPESAFE_BY_RCU, NULL);
 	if (!extent_node_slab) {
 		kmem_cache_destroy(extent_tree_slab);
 		return -ENOMEM;
@@ -571,8 +571,13 @@ struct extent_tree {
 	struct extent_info largest;	/* largested extent info */
 	struct list_head list;		/* to be used by sbi->zombie_list */
 	rwlock_t lock;			/* protect extent info rb-tree */
+	seqcount_t seq;			/* lockless lookups, see lock */
 	atomic_t node_cnt;		/* # of extent node in rb-tree*/
 	bool largest_updated;		/* largest extent updated */
+#ifdef CONFIG_F2FS_STAT_FS
+	atomic64_t total_hit;		/* # of lookups in this tree */
+	atomic64_t read_hit;		/* # of lookups that hit */
+#endif
 };
 
 /*
@@ -917,6 +922,7 @@ struct f2fs_sm_info {
 	unsigned int min_seq_blocks;	/* threshold for sequential blocks */
 	unsigned int min_hot_blocks;	/* threshold for hot block allocation */
 	unsigned int min_ssr_sections;	/* threshold to trigger SSR allocation */
+	unsigned int nr_data_streams;	/* # of warm data logs in use */
 
 	/* for flush command control */
 	struct flush_cmd_control *fcc_info;
@@ -1022,6 +1028,7 @@ struct f2fs_io_info {
 	nid_t ino;		/* inode number */
 	enum page_type type;	/* contains DATA/NODE/META/META_FLUSH */
 	enum temp_type temp;	/* contains HOT/WARM/COLD */
+	unsigned int stream;	/* warm data stream, 0 for the regular log */
 	int op;			/* contains REQ_OP_ */
 	int op_flags;		/* req_flag_bits */
 	block_t new_blkaddr;	/* new block address to be written */
@@ -2919,6 +2926,7 @@ void f2fs_clear_prefree_segments(struct f2fs_sb_info *sbi,
 void f2fs_release_discard_addrs(struct f2fs_sb_info *sbi);
 int f2fs_npages_for_summary_flush(struct f2fs_sb_info *sbi, bool for_ra);
 void f2fs_allocate_new_segments(struct f2fs_sb_info *sbi);
+void f2fs_close_data_streams(struct f2fs_sb_info *sbi);
 int f2fs_trim_fs(struct f2fs_sb_info *sbi, struct fstrim_range *range);
 bool f2fs_exist_trim_candidates(struct f2fs_sb_info *sbi,
 					struct cp_control *cpc);
@@ -3063,6 +3071,14 @@ bool f2fs_space_for_roll_forward(struct f2fs_sb_info *sbi);
  * debug.c
  */
 #ifdef CONFIG_F2FS_STAT_FS
+#define F2FS_EXT_TOP_INODES	8
+
+/* extent cache lookups of one inode */
+struct f2fs_extent_stat {
+	nid_t ino;
+	unsigned long long total_hit, read_hit;
+};
+
 struct f2fs_stat_info {
 	struct list_head stat_list;
 	struct f2fs_sb_info *sbi;
@@ -3070,6 +3086,8 @@ struct f2fs_stat_info {
 	int main_area_segs, main_area_sections, main_area_zones;
 	unsigned long long hit_largest, hit_cached, hit_rbtree;
 	unsigned long long hit_total, total_ext;
+	struct f2fs_extent_stat ext_top[F2FS_EXT_TOP_INODES];
+	int ext_top_nr;
 	int ext_tree, zombie_tree, ext_node;
 	int ndirty_node, ndirty_dent, ndirty_meta, ndirty_imeta;
 	int ndirty_data, ndirty_qdata;
@@ -3121,6 +3139,8 @@ static inline struct f2fs_stat_info *F2FS_STAT(struct f2fs_sb_info *sbi)
 #define stat_inc_rbtree_node_hit(sbi)	(atomic64_inc(&(sbi)->read_hit_rbtree))
 #define stat_inc_largest_node_hit(sbi)	(atomic64_inc(&(sbi)->read_hit_largest))
 #define stat_inc_cached_node_hit(sbi)	(atomic64_inc(&(sbi)->read_hit_cached))
+#define stat_inc_tree_total_hit(et)	(atomic64_inc(&(et)->total_hit))
+#define stat_inc_tree_read_hit(et)	(atomic64_inc(&(et)->read_hit))
 #define stat_inc_inline_xattr(inode)					\
 	do {								\
 		if (f2fs_has_inline_xattr(inode))			\
@@ -3226,6 +3246,8 @@ void f2fs_destroy_root_stats(void);
 #define stat_inc_rbtree_node_hit(sb)			do { } while (0)
 #define stat_inc_largest_node_hit(sbi)			do { } while (0)
 #define stat_inc_cached_node_hit(sbi)			do { } while (0)
+#define stat_inc_tree_total_hit(et)			do { } while (0)
+#define stat_inc_tree_read_hit(et)			do { } while (0)
 #define stat_inc_inline_xattr(inode)			do { } while (0)
 #define stat_dec_inline_xattr(inode)			do { } while (0)
 #define stat_inc_inline_inode(inode)			do { } while (0)
@@ -3319,6 +3341,10 @@ struct rb_entry *f2fs_lookup_rb_tree_ret(struct rb_root *root,
 		bool force);
 bool f2fs_check_rb_tree_consistence(struct f2fs_sb_info *sbi,
 						struct rb_root *root);
+#ifdef CONFIG_F2FS_STAT_FS
+int f2fs_extent_tree_top_stat(struct f2fs_sb_info *sbi,
+				struct f2fs_extent_stat *top, int nr);
+#endif
 unsigned int f2fs_shrink_extent_tree(struct f2fs_sb_info *sbi, int nr_shrink);
 bool f2fs_init_extent_tree(struct inode *inode, struct f2fs_extent *i_ext);
 void f2fs_drop_extent_tree(struct inode *inode);
@@ -291,6 +291,46 @@ static unsigned int count_bits(const unsigned long *addr,
 	return sum;
 }
 
+/*
+ * Find an LFS victim in the buckets of dirty segments rather than scanning
+ * dirty_segmap.  Greedy takes the segment with the fewest valid blocks from
+ * the first bucket having a usable one, cost-benefit compares the least
+ * recently updated usable segment of every bucket.
+ */
+static void get_victim_from_index(struct f2fs_sb_info *sbi,
+			struct victim_sel_policy *p, int gc_type)
+{
+	struct dirty_seglist_info *dirty_i = DIRTY_I(sbi);
+	struct list_head *pos;
+	unsigned int segno, cost;
+	int i;
+
+	for (i = 0; i < NR_VICTIM_BUCKETS; i++) {
+		list_for_each(pos, &dirty_i->victim_bucket[i]) {
+			segno = pos - dirty_i->victim_entry;
+
+			if (sec_usage_check(sbi, segno))
+				continue;
+			if (gc_type == BG_GC &&
+					test_bit(segno, dirty_i->victim_secmap))
+				continue;
+
+			cost = get_gc_cost(sbi, segno, p);
+			if (p->min_cost > cost) {
+				p->min_segno = segno;
+				p->min_cost = cost;
+			}
+
+			if (p->gc_mode == GC_CB)
+				break;
+		}
+
+		/* the next buckets only have more valid blocks */
+		if (p->gc_mode == GC_GREEDY && p->min_segno != NULL_SEGNO)
+			break;
+	}
+}
+
 /*
  * This function is called from two paths.
  * One is garbage collection and the other is SSR segment selection.
@@ -335,6 +375,11 @@ static int get_victim_by_default(struct f2fs_sb_info *sbi,
 			goto got_it;
 	}
 
+	if (p.alloc_mode == LFS && dirty_i->victim_entry) {
+		get_victim_from_index(sbi, &p, gc_type);
+		goto search_done;
+	}
+
 	while (1) {
 		unsigned long cost;
 		unsigned int segno;
@@ -384,6 +429,7 @@ next:
 			break;
 		}
 	}
+search_done:
 	if (p.min_segno != NULL_SEGNO) {
 got_it:
 		if (p.alloc_mode == LFS) {
@@ -767,6 +767,12 @@ static void __locate_dirty_segment(struct f2fs_sb_info *sbi, unsigned int segno,
 		}
 		if (!test_and_set_bit(segno, dirty_i->dirty_segmap[t]))
 			dirty_i->nr_dirty[t]++;
+
+		/* valid blocks have changed, requeue it as the newest */
+		if (dirty_i->victim_entry)
+			list_move_tail(&dirty_i->victim_entry[segno],
+				&dirty_i->victim_bucket[victim_bucket(sbi,
+					get_valid_blocks(sbi, segno, false))]);
 	}
 }
 
@@ -785,6 +791,9 @@ static void __remove_dirty_segment(struct f2fs_sb_info *sbi, unsigned int segno,
 		if (test_and_clear_bit(segno, dirty_i->dirty_segmap[t]))
 			dirty_i->nr_dirty[t]--;
 
+		if (dirty_i->victim_entry)
+			list_del_init(&dirty_i->victim_entry[segno]);
+
 		if (get_valid_blocks(sbi, segno, true) == 0)
 			clear_bit(GET_SEC_FROM_SEG(sbi, segno),
 						dirty_i->victim_secmap);
@@ -2326,6 +2335,9 @@ static void reset_curseg(struct f2fs_sb_info *sbi, int type, int modified)
 		SET_SUM_TYPE(sum_footer, SUM_TYPE_DATA);
 	if (IS_NODESEG(type))
 		SET_SUM_TYPE(sum_footer, SUM_TYPE_NODE);
+	/* data streams are plain warm data segments on disk */
+	if (IS_DATA_STREAM(type))
+		type = CURSEG_WARM_DATA;
 	__set_sit_entry_type(sbi, type, curseg->segno, modified);
 }
 
@@ -2359,9 +2371,12 @@ static void new_curseg(struct f2fs_sb_info *sbi, int type, bool new_sec)
 	unsigned int segno = curseg->segno;
 	int dir = ALLOC_LEFT;
 
-	write_sum_page(sbi, curseg->sum_blk,
-				GET_SUM_BLOCK(sbi, segno));
-	if (type == CURSEG_WARM_DATA || type == CURSEG_COLD_DATA)
+	/* a data stream may not have opened a segment yet */
+	if (segno != NULL_SEGNO)
+		write_sum_page(sbi, curseg->sum_blk,
+					GET_SUM_BLOCK(sbi, segno));
+	if (type == CURSEG_WARM_DATA || type == CURSEG_COLD_DATA ||
+						IS_DATA_STREAM(type))
 		dir = ALLOC_RIGHT;
 
 	if (test_opt(sbi, NOHEAP))
@@ -2497,7 +2512,8 @@ static void allocate_segment_by_default(struct f2fs_sb_info *sbi,
 		new_curseg(sbi, type, false);
 	else if (curseg->alloc_type == LFS && is_next_segment_free(sbi, type))
 		new_curseg(sbi, type, false);
-	else if (f2fs_need_SSR(sbi) && get_ssr_segment(sbi, type))
+	else if (!IS_DATA_STREAM(type) && f2fs_need_SSR(sbi) &&
+					get_ssr_segment(sbi, type))
 		change_curseg(sbi, type);
 	else
 		new_curseg(sbi, type, false);
@@ -2505,6 +2521,59 @@ static void allocate_segment_by_default(struct f2fs_sb_info *sbi,
 	stat_inc_seg_type(sbi, curseg);
 }
 
+/*
+ * Close the segments of the data streams, so that the checkpoint only has to
+ * cover the regular logs: their summaries go to the SSA and they become
+ * ordinary dirty segments. Streams open a new segment on their next write.
+ */
+void f2fs_close_data_streams(struct f2fs_sb_info *sbi)
+{
+	struct sit_info *sit_i = SIT_I(sbi);
+	struct curseg_info *curseg;
+	unsigned int segno;
+	int i;
+
+	for (i = 1; i < F2FS_MAX_DATA_STREAMS; i++) {
+		curseg = CURSEG_I(sbi, CURSEG_DATA_STREAM(i));
+
+		mutex_lock(&curseg->curseg_mutex);
+		down_write(&sit_i->sentry_lock);
+
+		segno = curseg->segno;
+		if (segno != NULL_SEGNO) {
+			write_sum_page(sbi, curseg->sum_blk,
+					GET_SUM_BLOCK(sbi, segno));
+			curseg->segno = NULL_SEGNO;
+			curseg->next_blkoff = 0;
+			locate_dirty_segment(sbi, segno);
+		}
+
+		up_write(&sit_i->sentry_lock);
+		mutex_unlock(&curseg->curseg_mutex);
+	}
+}
+
+/*
+ * Spread warm data writers over the data streams by CPU. The streams only
+ * allocate free segments, so they are skipped once SSR is needed, as well as
+ * for large sections and zoned devices where an open segment is costly.
+ */
+static int __get_data_stream(struct f2fs_sb_info *sbi, int type)
+{
+	unsigned int nr = READ_ONCE(SM_I(sbi)->nr_data_streams);
+	unsigned int stream;
+
+	if (type != CURSEG_WARM_DATA || nr <= 1)
+		return 0;
+	if (sbi->segs_per_sec != 1 || f2fs_sb_has_blkzoned(sbi->sb))
+		return 0;
+	if (f2fs_need_SSR(sbi))
+		return 0;
+
+	stream = raw_smp_processor_id() % nr;
+	return stream;
+}
+
 void f2fs_allocate_new_segments(struct f2fs_sb_info *sbi)
 {
 	struct curseg_info *curseg;
@@ -2883,13 +2952,25 @@ void f2fs_allocate_data_block(struct f2fs_sb_info *sbi, struct page *page,
 		struct f2fs_io_info *fio, bool add_list)
 {
 	struct sit_info *sit_i = SIT_I(sbi);
-	struct curseg_info *curseg = CURSEG_I(sbi, type);
+	struct curseg_info *curseg;
+	int stream = __get_data_stream(sbi, type);
+
+	if (stream)
+		type = CURSEG_DATA_STREAM(stream);
+	if (fio)
+		fio->stream = stream;
+	curseg = CURSEG_I(sbi, type);
 
 	down_read(&SM_I(sbi)->curseg_lock);
 
 	mutex_lock(&curseg->curseg_mutex);
 	down_write(&sit_i->sentry_lock);
 
+	if (curseg->segno == NULL_SEGNO) {
+		new_curseg(sbi, type, false);
+		stat_inc_seg_type(sbi, curseg);
+	}
+
 	*new_blkaddr = NEXT_FREE_BLKADDR(sbi, curseg);
 
 	f2fs_wait_discard_bio(sbi, *new_blkaddr);
@@ -2938,7 +3019,7 @@ void f2fs_allocate_data_block(struct f2fs_sb_info *sbi, struct page *page,
 		INIT_LIST_HEAD(&fio->list);
 		fio->in_list = true;
 		fio->retry = false;
-		io = sbi->write_io[fio->type] + fio->temp;
+		io = sbi->write_io[fio->type] + __write_io_index(fio);
 		spin_lock(&io->io_lock);
 		list_add_tail(&fio->list, &io->io_list);
 		spin_unlock(&io->io_lock);
@@ -3855,14 +3936,14 @@ static int build_curseg(struct f2fs_sb_info *sbi)
 	struct curseg_info *array;
 	int i;
 
-	array = f2fs_kzalloc(sbi, array_size(NR_CURSEG_TYPE, sizeof(*array)),
+	array = f2fs_kzalloc(sbi, array_size(NR_CURSEG_ARRAY, sizeof(*array)),
 			     GFP_KERNEL);
 	if (!array)
 		return -ENOMEM;
 
 	SM_I(sbi)->curseg_array = array;
 
-	for (i = 0; i < NR_CURSEG_TYPE; i++) {
+	for (i = 0; i < NR_CURSEG_ARRAY; i++) {
 		mutex_init(&array[i].curseg_mutex);
 		array[i].sum_blk = f2fs_kzalloc(sbi, PAGE_SIZE, GFP_KERNEL);
 		if (!array[i].sum_blk)
@@ -4055,10 +4136,34 @@ static int init_victim_secmap(struct f2fs_sb_info *sbi)
 	return 0;
 }
 
+static int init_victim_index(struct f2fs_sb_info *sbi)
+{
+	struct dirty_seglist_info *dirty_i = DIRTY_I(sbi);
+	unsigned int i;
+
+	for (i = 0; i < NR_VICTIM_BUCKETS; i++)
+		INIT_LIST_HEAD(&dirty_i->victim_bucket[i]);
+
+	/* GC cost is per section, which the buckets don't track */
+	if (sbi->segs_per_sec > 1)
+		return 0;
+
+	dirty_i->victim_entry = f2fs_kvmalloc(sbi,
+			array_size(MAIN_SEGS(sbi), sizeof(struct list_head)),
+			GFP_KERNEL);
+	if (!dirty_i->victim_entry)
+		return -ENOMEM;
+
+	for (i = 0; i < MAIN_SEGS(sbi); i++)
+		INIT_LIST_HEAD(&dirty_i->victim_entry[i]);
+	return 0;
+}
+
 static int build_dirty_segmap(struct f2fs_sb_info *sbi)
 {
 	struct dirty_seglist_info *dirty_i;
 	unsigned int bitmap_size, i;
+	int err;
 
 	/* allocate memory for dirty segments list information */
 	dirty_i = f2fs_kzalloc(sbi, sizeof(struct dirty_seglist_info),
@@ -4078,6 +4183,10 @@ static int build_dirty_segmap(struct f2fs_sb_info *sbi)
 			return -ENOMEM;
 	}
 
+	err = init_victim_index(sbi);
+	if (err)
+		return err;
+
 	init_dirty_segmap(sbi);
 	return init_victim_secmap(sbi);
 }
@@ -4142,6 +4251,7 @@ int f2fs_build_segment_manager(struct f2fs_sb_info *sbi)
 	sm_info->min_seq_blocks = sbi->blocks_per_seg * sbi->segs_per_sec;
 	sm_info->min_hot_blocks = DEF_MIN_HOT_BLOCKS;
 	sm_info->min_ssr_sections = reserved_sections(sbi);
+	sm_info->nr_data_streams = 1;
 
 	INIT_LIST_HEAD(&sm_info->sit_entry_set);
 
@@ -4211,6 +4321,7 @@ static void destroy_dirty_segmap(struct f2fs_sb_info *sbi)
 		discard_dirty_segmap(sbi, i);
 
 	destroy_victim_secmap(sbi);
+	kvfree(dirty_i->victim_entry);
 	SM_I(sbi)->dirty_info = NULL;
 	kfree(dirty_i);
 }
@@ -4223,7 +4334,7 @@ static void destroy_curseg(struct f2fs_sb_info *sbi)
 	if (!array)
 		return;
 	SM_I(sbi)->curseg_array = NULL;
-	for (i = 0; i < NR_CURSEG_TYPE; i++) {
+	for (i = 0; i < NR_CURSEG_ARRAY; i++) {
 		kfree(array[i].sum_blk);
 		kfree(array[i].journal);
 	}
@@ -24,8 +24,19 @@
 #define GET_L2R_SEGNO(free_i, segno)	((segno) - (free_i)->start_segno)
 #define GET_R2L_SEGNO(free_i, segno)	((segno) + (free_i)->start_segno)
 
-#define IS_DATASEG(t)	((t) <= CURSEG_COLD_DATA)
-#define IS_NODESEG(t)	((t) >= CURSEG_HOT_NODE)
+/*
+ * Warm data can be spread over several logs, so that concurrent writers do
+ * not all serialize on one curseg_mutex. Stream 0 is CURSEG_WARM_DATA, the
+ * others are only kept in memory and closed at every checkpoint.
+ */
+#define F2FS_MAX_DATA_STREAMS	8
+#define CURSEG_DATA_STREAM(i)	(NO_CHECK_TYPE + (i))
+#define IS_DATA_STREAM(t)	((t) > NO_CHECK_TYPE)
+#define NR_CURSEG_ARRAY		(NR_CURSEG_TYPE + F2FS_MAX_DATA_STREAMS - 1)
+#define NR_DATA_WRITE_IO	(NR_TEMP_TYPE + F2FS_MAX_DATA_STREAMS - 1)
+
+#define IS_DATASEG(t)	((t) <= CURSEG_COLD_DATA || IS_DATA_STREAM(t))
+#define IS_NODESEG(t)	((t) >= CURSEG_HOT_NODE && !IS_DATA_STREAM(t))
 
 #define IS_HOT(t)	((t) == CURSEG_HOT_NODE || (t) == CURSEG_HOT_DATA)
 #define IS_WARM(t)	((t) == CURSEG_WARM_NODE || (t) == CURSEG_WARM_DATA)
@@ -37,7 +48,8 @@
 	 ((seg) == CURSEG_I(sbi, CURSEG_COLD_DATA)->segno) ||	\
 	 ((seg) == CURSEG_I(sbi, CURSEG_HOT_NODE)->segno) ||	\
 	 ((seg) == CURSEG_I(sbi, CURSEG_WARM_NODE)->segno) ||	\
-	 ((seg) == CURSEG_I(sbi, CURSEG_COLD_NODE)->segno))
+	 ((seg) == CURSEG_I(sbi, CURSEG_COLD_NODE)->segno) ||	\
+	 __is_stream_curseg(sbi, seg, 1))
 
 #define IS_CURSEC(sbi, secno)						\
 	(((secno) == CURSEG_I(sbi, CURSEG_HOT_DATA)->segno /		\
@@ -51,7 +63,8 @@
 	 ((secno) == CURSEG_I(sbi, CURSEG_WARM_NODE)->segno /		\
 	  (sbi)->segs_per_sec) ||	\
 	 ((secno) == CURSEG_I(sbi, CURSEG_COLD_NODE)->segno /		\
-	  (sbi)->segs_per_sec))	\
+	  (sbi)->segs_per_sec) ||	\
+	 __is_stream_curseg(sbi, secno, (sbi)->segs_per_sec))
 
 #define MAIN_BLKADDR(sbi)						\
 	(SM_I(sbi) ? SM_I(sbi)->main_blkaddr : 				\
@@ -274,12 +287,22 @@ enum dirty_type {
 	NR_DIRTY_TYPE
 };
 
+/*
+ * With one segment per section, the DIRTY segments are also kept in
+ * NR_VICTIM_BUCKETS lists by their number of valid blocks, each list in the
+ * order the segments were last updated, so GC victims are found without
+ * scanning dirty_segmap.
+ */
+#define NR_VICTIM_BUCKETS	64
+
 struct dirty_seglist_info {
 	const struct victim_selection *v_ops;	/* victim selction operation */
 	unsigned long *dirty_segmap[NR_DIRTY_TYPE];
 	struct mutex seglist_lock;		/* lock for segment bitmaps */
 	int nr_dirty[NR_DIRTY_TYPE];		/* # of dirty segments */
 	unsigned long *victim_secmap;		/* background GC victims */
+	struct list_head *victim_entry;		/* per segment, in a bucket */
+	struct list_head victim_bucket[NR_VICTIM_BUCKETS];
 };
 
 /* victim selection function for cleaning and SSR */
@@ -312,9 +335,33 @@ struct sit_entry_set {
  */
 static inline struct curseg_info *CURSEG_I(struct f2fs_sb_info *sbi, int type)
 {
+	/* streams are stored after the CURSEG_COLD_NODE log */
+	if (IS_DATA_STREAM(type))
+		type--;
 	return (struct curseg_info *)(SM_I(sbi)->curseg_array + type);
 }
 
+/* each data stream merges its bios apart from the others */
+static inline int __write_io_index(struct f2fs_io_info *fio)
+{
+	return fio->stream ? NR_TEMP_TYPE + fio->stream - 1 : fio->temp;
+}
+
+/* match @no against the segments (or sections) open in the data streams */
+static inline bool __is_stream_curseg(struct f2fs_sb_info *sbi,
+				unsigned int no, unsigned int segs_per_no)
+{
+	unsigned int segno;
+	int i;
+
+	for (i = 1; i < F2FS_MAX_DATA_STREAMS; i++) {
+		segno = CURSEG_I(sbi, CURSEG_DATA_STREAM(i))->segno;
+		if (segno != NULL_SEGNO && segno / segs_per_no == no)
+			return true;
+	}
+	return false;
+}
+
 static inline struct seg_entry *get_seg_entry(struct f2fs_sb_info *sbi,
 						unsigned int segno)
 {
@@ -785,6 +832,12 @@ static inline block_t sum_blk_addr(struct f2fs_sb_info *sbi, int base, int type)
 				- (base + 1) + type;
 }
 
+static inline unsigned int victim_bucket(struct f2fs_sb_info *sbi,
+						unsigned int valid_blocks)
+{
+	return (valid_blocks * NR_VICTIM_BUCKETS) >> sbi->log_blocks_per_seg;
+}
+
 static inline bool sec_usage_check(struct f2fs_sb_info *sbi, unsigned int secno)
 {
 	if (IS_CURSEC(sbi, secno) || (sbi->cur_victim_sec == secno))
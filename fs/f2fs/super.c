@@ -2872,6 +2872,9 @@ try_onemore:
 		int n = (i == META) ? 1: NR_TEMP_TYPE;
 		int j;
 
+		if (i == DATA)
+			n = NR_DATA_WRITE_IO;
+
 		sbi->write_io[i] =
 			f2fs_kmalloc(sbi,
 				     array_size(n,
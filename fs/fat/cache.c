@@ -13,7 +13,7 @@
 #include "fat.h"
 
 /* this must be > 0. */
-#define FAT_MAX_CACHE	8
+#define FAT_MAX_CACHE	32
 
 struct fat_cache {
 	struct list_head cache_list;
@@ -229,6 +229,7 @@ int fat_get_cluster(struct inode *inode, int cluster, int *fclus, int *dclus)
 	const int limit = sb->s_maxbytes >> sbi->cluster_bits;
 	struct fat_entry fatent;
 	struct fat_cache_id cid;
+	sector_t last_blocknr = 0;
 	int nr;
 
 	BUG_ON(MSDOS_I(inode)->i_start == 0);
@@ -266,7 +267,12 @@ int fat_get_cluster(struct inode *inode, int cluster, int *fclus, int *dclus)
 		nr = fat_ent_read(inode, &fatent, *dclus);
 		if (nr < 0)
 			goto out;
-		else if (nr == FAT_ENT_FREE) {
+		if (fatent.bhs[0]->b_blocknr != last_blocknr) {
+			last_blocknr = fatent.bhs[0]->b_blocknr;
+			if (cluster - *fclus > 1)
+				fat_ent_reada_chain(sb, &fatent);
+		}
+		if (nr == FAT_ENT_FREE) {
 			fat_fs_error_ratelimit(sb,
 				"%s: invalid cluster chain (i_pos %lld)",
 				__func__, MSDOS_I(inode)->i_pos);
@@ -89,6 +89,7 @@ struct msdos_sb_info {
 
 	int fatent_shift;
 	const struct fatent_operations *fatent_ops;
+	unsigned long *fat_full_map;	/* FAT blocks without free entries */
 	struct inode *fat_inode;
 	struct inode *fsinfo_inode;
 
@@ -362,6 +363,8 @@ extern int fat_alloc_clusters(struct inode *inode, int *cluster,
 			      int nr_cluster);
 extern int fat_free_clusters(struct inode *inode, int cluster);
 extern int fat_count_free_clusters(struct super_block *sb);
+extern void fat_ent_reada_chain(struct super_block *sb,
+				struct fat_entry *fatent);
 extern int fat_trim_fs(struct inode *inode, struct fstrim_range *range);
 
 /* fat/file.c */
@@ -304,6 +304,11 @@ void fat_ent_access_init(struct super_block *sb)
 		sbi->fatent_ops = &fat12_ops;
 		break;
 	}
+
+	/* Only FAT16/32 entries never cross a block boundary */
+	if (sbi->fatent_shift > 0)
+		sbi->fat_full_map = kvzalloc(BITS_TO_LONGS(sbi->fat_length) *
+					     sizeof(long), GFP_KERNEL);
 }
 
 static void mark_fsinfo_dirty(struct super_block *sb)
@@ -460,6 +465,39 @@ static void fat_collect_bhs(struct buffer_head **bhs, int *nr_bhs,
 	}
 }
 
+/*
+ * On FAT16/32, fat_full_map has a bit set for each FAT block which is known
+ * to have no free entry, so that fat_alloc_clusters() does not read all of
+ * them again on a nearly full volume. A bit is only set after the whole
+ * block was seen without a free entry, and cleared when one of its entries
+ * is freed. All of this is done under lock_fat().
+ */
+static inline int fat_ent_block_bits(struct super_block *sb)
+{
+	return sb->s_blocksize_bits - MSDOS_SB(sb)->fatent_shift;
+}
+
+static inline bool fat_ent_block_full(struct super_block *sb, int entry)
+{
+	struct msdos_sb_info *sbi = MSDOS_SB(sb);
+
+	return sbi->fat_full_map &&
+	       test_bit(entry >> fat_ent_block_bits(sb), sbi->fat_full_map);
+}
+
+static inline void fat_ent_set_block_full(struct super_block *sb, int entry,
+					  bool full)
+{
+	struct msdos_sb_info *sbi = MSDOS_SB(sb);
+
+	if (!sbi->fat_full_map)
+		return;
+	if (full)
+		__set_bit(entry >> fat_ent_block_bits(sb), sbi->fat_full_map);
+	else
+		__clear_bit(entry >> fat_ent_block_bits(sb), sbi->fat_full_map);
+}
+
 int fat_alloc_clusters(struct inode *inode, int *cluster, int nr_cluster)
 {
 	struct super_block *sb = inode->i_sb;
@@ -467,7 +505,7 @@ int fat_alloc_clusters(struct inode *inode, int *cluster, int nr_cluster)
 	const struct fatent_operations *ops = sbi->fatent_ops;
 	struct fat_entry fatent, prev_ent;
 	struct buffer_head *bhs[MAX_BUF_PER_PAGE];
-	int i, count, err, nr_bhs, idx_clus;
+	int i, count, err, nr_bhs, idx_clus, first;
 
 	BUG_ON(nr_cluster > (MAX_BUF_PER_PAGE / 2));	/* fixed limit */
 
@@ -486,10 +524,20 @@ int fat_alloc_clusters(struct inode *inode, int *cluster, int nr_cluster)
 	while (count < sbi->max_cluster) {
 		if (fatent.entry >= sbi->max_cluster)
 			fatent.entry = FAT_START_ENT;
+		if (fat_ent_block_full(sb, fatent.entry)) {
+			/* Skip to the first entry of the next block */
+			int bits = fat_ent_block_bits(sb);
+			int next = ((fatent.entry >> bits) + 1) << bits;
+
+			count += next - fatent.entry;
+			fatent.entry = next;
+			continue;
+		}
 		fatent_set_entry(&fatent, fatent.entry);
 		err = fat_ent_read_block(sb, &fatent);
 		if (err)
 			goto out;
+		first = fatent.entry;
 
 		/* Find the free entries in a block */
 		do {
@@ -520,10 +568,19 @@ int fat_alloc_clusters(struct inode *inode, int *cluster, int nr_cluster)
 			}
 			count++;
 			if (count == sbi->max_cluster)
-				break;
+				goto enospc;
 		} while (fat_ent_next(sbi, &fatent));
+
+		/*
+		 * Any free entry seen was taken above, so a block scanned from
+		 * its first entry has none left.
+		 */
+		if (!(first & ((1 << fat_ent_block_bits(sb)) - 1)))
+			fat_ent_set_block_full(sb, first, true);
 	}
 
+enospc:
+
 	/* Couldn't allocate the free entries */
 	sbi->free_clusters = 0;
 	sbi->free_clus_valid = 1;
@@ -592,6 +649,7 @@ int fat_free_clusters(struct inode *inode, int cluster)
 		}
 
 		ops->ent_put(&fatent, FAT_ENT_FREE);
+		fat_ent_set_block_full(sb, fatent.entry, false);
 		if (sbi->free_clusters != -1) {
 			sbi->free_clusters++;
 			dirty_fsinfo = 1;
@@ -647,13 +705,32 @@ static void fat_ent_reada(struct super_block *sb, struct fat_entry *fatent,
 		sb_breadahead(sb, blocknr + i);
 }
 
+/* Number of FAT blocks read ahead by a cluster chain walk */
+#define FAT_CHAIN_READA_BLOCKS	8
+
+/*
+ * Called by fat_get_cluster() when a chain walk moved to a new FAT block.
+ * Files on a large volume are mostly contiguous, so the rest of the chain is
+ * likely in the following FAT blocks.
+ */
+void fat_ent_reada_chain(struct super_block *sb, struct fat_entry *fatent)
+{
+	struct msdos_sb_info *sbi = MSDOS_SB(sb);
+	sector_t blocknr = fatent->bhs[fatent->nr_bhs - 1]->b_blocknr + 1;
+	sector_t end = sbi->fat_start + sbi->fat_length;
+	int i;
+
+	for (i = 0; i < FAT_CHAIN_READA_BLOCKS && blocknr + i < end; i++)
+		sb_breadahead(sb, blocknr + i);
+}
+
 int fat_count_free_clusters(struct super_block *sb)
 {
 	struct msdos_sb_info *sbi = MSDOS_SB(sb);
 	const struct fatent_operations *ops = sbi->fatent_ops;
 	struct fat_entry fatent;
 	unsigned long reada_blocks, reada_mask, cur_block;
-	int err = 0, free;
+	int err = 0, free, block_free, first;
 
 	lock_fat(sbi);
 	if (sbi->free_clusters != -1 && sbi->free_clus_valid)
@@ -678,10 +755,14 @@ int fat_count_free_clusters(struct super_block *sb)
 		if (err)
 			goto out;
 
+		first = fatent.entry;
+		block_free = 0;
 		do {
 			if (ops->ent_get(&fatent) == FAT_ENT_FREE)
-				free++;
+				block_free++;
 		} while (fat_ent_next(sbi, &fatent));
+		fat_ent_set_block_full(sb, first, !block_free);
+		free += block_free;
 		cond_resched();
 	}
 	sbi->free_clusters = free;
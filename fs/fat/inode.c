@@ -718,6 +718,7 @@ static void delayed_free(struct rcu_head *p)
 	unload_nls(sbi->nls_disk);
 	unload_nls(sbi->nls_io);
 	fat_reset_iocharset(&sbi->options);
+	kvfree(sbi->fat_full_map);
 	kfree(sbi);
 }
 
@@ -1881,6 +1882,7 @@ out_fail:
 	unload_nls(sbi->nls_io);
 	unload_nls(sbi->nls_disk);
 	fat_reset_iocharset(&sbi->options);
+	kvfree(sbi->fat_full_map);
 	sb->s_fs_info = NULL;
 	kfree(sbi);
 	return error;
@@ -326,10 +326,54 @@ static u64 fuse_get_unique(struct fuse_iqueue *fiq)
 	return ++fiq->reqctr;
 }
 
+/*
+ * Lock the input queue for a request sent from this CPU: the queue bound to
+ * the CPU by FUSE_DEV_IOC_BIND_QUEUE while a device reads it, else the main
+ * queue of the connection.
+ */
+static struct fuse_iqueue *fuse_lock_iqueue(struct fuse_conn *fc)
+{
+	struct fuse_iqueue **cpu_iq = READ_ONCE(fc->cpu_iq);
+	struct fuse_iqueue *fiq;
+
+	if (cpu_iq) {
+		fiq = READ_ONCE(cpu_iq[raw_smp_processor_id()]);
+		if (fiq) {
+			spin_lock(&fiq->waitq.lock);
+			if (fiq->nr_devs)
+				return fiq;
+			spin_unlock(&fiq->waitq.lock);
+		}
+	}
+	fiq = &fc->iq;
+	spin_lock(&fiq->waitq.lock);
+
+	return fiq;
+}
+
+/*
+ * Lock the input queue the request was queued on.  req->fiq only changes
+ * with both the old and the new queue locked, see fuse_dev_unbind_queue().
+ */
+static struct fuse_iqueue *fuse_lock_req_iqueue(struct fuse_conn *fc,
+						struct fuse_req *req)
+{
+	struct fuse_iqueue *fiq;
+
+	for (;;) {
+		fiq = READ_ONCE(req->fiq) ?: &fc->iq;
+		spin_lock(&fiq->waitq.lock);
+		if (fiq == (req->fiq ?: &fc->iq))
+			return fiq;
+		spin_unlock(&fiq->waitq.lock);
+	}
+}
+
 static void queue_request(struct fuse_iqueue *fiq, struct fuse_req *req)
 {
 	req->in.h.len = sizeof(struct fuse_in_header) +
 		len_args(req->in.numargs, (struct fuse_arg *) req->in.args);
+	req->fiq = fiq;
 	list_add_tail(&req->list, &fiq->pending);
 	wake_up_locked(&fiq->waitq);
 	kill_fasync(&fiq->fasync, SIGIO, POLL_IN);
@@ -338,12 +382,12 @@ static void queue_request(struct fuse_iqueue *fiq, struct fuse_req *req)
 void fuse_queue_forget(struct fuse_conn *fc, struct fuse_forget_link *forget,
 		       u64 nodeid, u64 nlookup)
 {
-	struct fuse_iqueue *fiq = &fc->iq;
+	struct fuse_iqueue *fiq;
 
 	forget->forget_one.nodeid = nodeid;
 	forget->forget_one.nlookup = nlookup;
 
-	spin_lock(&fiq->waitq.lock);
+	fiq = fuse_lock_iqueue(fc);
 	if (fiq->connected) {
 		fiq->forget_list_tail->next = forget;
 		fiq->forget_list_tail = forget;
@@ -360,12 +404,12 @@ static void flush_bg_queue(struct fuse_conn *fc)
 	while (fc->active_background < fc->max_background &&
 	       !list_empty(&fc->bg_queue)) {
 		struct fuse_req *req;
-		struct fuse_iqueue *fiq = &fc->iq;
+		struct fuse_iqueue *fiq;
 
 		req = list_entry(fc->bg_queue.next, struct fuse_req, list);
 		list_del(&req->list);
 		fc->active_background++;
-		spin_lock(&fiq->waitq.lock);
+		fiq = fuse_lock_iqueue(fc);
 		req->in.h.unique = fuse_get_unique(fiq);
 		queue_request(fiq, req);
 		spin_unlock(&fiq->waitq.lock);
@@ -382,12 +426,12 @@ static void flush_bg_queue(struct fuse_conn *fc)
  */
 static void request_end(struct fuse_conn *fc, struct fuse_req *req)
 {
-	struct fuse_iqueue *fiq = &fc->iq;
+	struct fuse_iqueue *fiq;
 
 	if (test_and_set_bit(FR_FINISHED, &req->flags))
 		goto put_request;
 
-	spin_lock(&fiq->waitq.lock);
+	fiq = fuse_lock_req_iqueue(fc, req);
 	list_del_init(&req->intr_entry);
 	spin_unlock(&fiq->waitq.lock);
 	WARN_ON(test_bit(FR_PENDING, &req->flags));
@@ -425,9 +469,10 @@ put_request:
 	fuse_put_request(fc, req);
 }
 
-static void queue_interrupt(struct fuse_iqueue *fiq, struct fuse_req *req)
+static void queue_interrupt(struct fuse_conn *fc, struct fuse_req *req)
 {
-	spin_lock(&fiq->waitq.lock);
+	struct fuse_iqueue *fiq = fuse_lock_req_iqueue(fc, req);
+
 	if (test_bit(FR_FINISHED, &req->flags)) {
 		spin_unlock(&fiq->waitq.lock);
 		return;
@@ -442,7 +487,7 @@ static void queue_interrupt(struct fuse_iqueue *fiq, struct fuse_req *req)
 
 static void request_wait_answer(struct fuse_conn *fc, struct fuse_req *req)
 {
-	struct fuse_iqueue *fiq = &fc->iq;
+	struct fuse_iqueue *fiq;
 	int err;
 
 	if (!fc->no_interrupt) {
@@ -456,7 +501,7 @@ static void request_wait_answer(struct fuse_conn *fc, struct fuse_req *req)
 		/* matches barrier in fuse_dev_do_read() */
 		smp_mb__after_atomic();
 		if (test_bit(FR_SENT, &req->flags))
-			queue_interrupt(fiq, req);
+			queue_interrupt(fc, req);
 	}
 
 	if (!test_bit(FR_FORCE, &req->flags)) {
@@ -466,7 +511,7 @@ static void request_wait_answer(struct fuse_conn *fc, struct fuse_req *req)
 		if (!err)
 			return;
 
-		spin_lock(&fiq->waitq.lock);
+		fiq = fuse_lock_req_iqueue(fc, req);
 		/* Request is not yet in userspace, bail out */
 		if (test_bit(FR_PENDING, &req->flags)) {
 			list_del(&req->list);
@@ -487,10 +532,10 @@ static void request_wait_answer(struct fuse_conn *fc, struct fuse_req *req)
 
 static void __fuse_request_send(struct fuse_conn *fc, struct fuse_req *req)
 {
-	struct fuse_iqueue *fiq = &fc->iq;
+	struct fuse_iqueue *fiq;
 
 	BUG_ON(test_bit(FR_BACKGROUND, &req->flags));
-	spin_lock(&fiq->waitq.lock);
+	fiq = fuse_lock_iqueue(fc);
 	if (!fiq->connected) {
 		spin_unlock(&fiq->waitq.lock);
 		req->out.h.error = -ENOTCONN;
@@ -629,11 +674,11 @@ static int fuse_request_send_notify_reply(struct fuse_conn *fc,
 					  struct fuse_req *req, u64 unique)
 {
 	int err = -ENODEV;
-	struct fuse_iqueue *fiq = &fc->iq;
+	struct fuse_iqueue *fiq;
 
 	__clear_bit(FR_ISREPLY, &req->flags);
 	req->in.h.unique = unique;
-	spin_lock(&fiq->waitq.lock);
+	fiq = fuse_lock_iqueue(fc);
 	if (fiq->connected) {
 		queue_request(fiq, req);
 		err = 0;
@@ -742,6 +787,16 @@ static void fuse_copy_finish(struct fuse_copy_state *cs)
 	cs->pg = NULL;
 }
 
+/*
+ * Number of buffers that can still be added to the pipe, which is locked by
+ * the caller of fuse_dev_splice_read().  Running out of them half way only
+ * fails the request, instead of losing it after it was read.
+ */
+static unsigned fuse_pipe_space(struct pipe_inode_info *pipe)
+{
+	return pipe->buffers - pipe->nrbufs;
+}
+
 /*
  * Get another pagefull of userspace buffer, and map it to kernel
  * address space, and lock request
@@ -772,7 +827,7 @@ static int fuse_copy_fill(struct fuse_copy_state *cs)
 			cs->pipebufs++;
 			cs->nr_segs--;
 		} else {
-			if (cs->nr_segs == cs->pipe->buffers)
+			if (cs->nr_segs == fuse_pipe_space(cs->pipe))
 				return -EIO;
 
 			page = alloc_page(GFP_HIGHUSER);
@@ -846,7 +901,13 @@ static int fuse_check_page(struct page *page)
 	return 0;
 }
 
-static int fuse_try_move_page(struct fuse_copy_state *cs, struct page **pagep)
+/*
+ * Replace the page cache page with the page donated by the server.  A short
+ * last page of the reply is taken as well when the request wants the rest of
+ * the page zeroed, so a whole READ reply can be moved.
+ */
+static int fuse_try_move_page(struct fuse_copy_state *cs, struct page **pagep,
+			      unsigned count)
 {
 	int err;
 	struct page *oldpage = *pagep;
@@ -869,7 +930,7 @@ static int fuse_try_move_page(struct fuse_copy_state *cs, struct page **pagep)
 	cs->pipebufs++;
 	cs->nr_segs--;
 
-	if (cs->len != PAGE_SIZE)
+	if (buf->offset != 0 || cs->len != count)
 		goto out_fallback;
 
 	if (pipe_buf_steal(cs->pipe, buf) != 0)
@@ -898,6 +959,9 @@ static int fuse_try_move_page(struct fuse_copy_state *cs, struct page **pagep)
 	if (WARN_ON(PageMlocked(oldpage)))
 		goto out_fallback_unlock;
 
+	if (count < PAGE_SIZE)
+		zero_user_segment(newpage, count, PAGE_SIZE);
+
 	err = replace_page_cache_page(oldpage, newpage, GFP_KERNEL);
 	if (err) {
 		unlock_page(newpage);
@@ -948,7 +1012,7 @@ static int fuse_ref_page(struct fuse_copy_state *cs, struct page *page,
 	struct pipe_buffer *buf;
 	int err;
 
-	if (cs->nr_segs == cs->pipe->buffers)
+	if (cs->nr_segs == fuse_pipe_space(cs->pipe))
 		return -EIO;
 
 	err = unlock_request(cs->req);
@@ -987,9 +1051,9 @@ static int fuse_copy_page(struct fuse_copy_state *cs, struct page **pagep,
 		if (cs->write && cs->pipebufs && page) {
 			return fuse_ref_page(cs, page, offset, count);
 		} else if (!cs->len) {
-			if (cs->move_pages && page &&
-			    offset == 0 && count == PAGE_SIZE) {
-				err = fuse_try_move_page(cs, pagep);
+			if (cs->move_pages && page && offset == 0 &&
+			    (count == PAGE_SIZE || zeroing)) {
+				err = fuse_try_move_page(cs, pagep, count);
 				if (err <= 0)
 					return err;
 			} else {
@@ -1244,7 +1308,7 @@ static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
 {
 	ssize_t err;
 	struct fuse_conn *fc = fud->fc;
-	struct fuse_iqueue *fiq = &fc->iq;
+	struct fuse_iqueue *fiq = READ_ONCE(fud->fiq);
 	struct fuse_pqueue *fpq = &fud->pq;
 	struct fuse_req *req;
 	struct fuse_in *in;
@@ -1328,7 +1392,7 @@ static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
 	/* matches barrier in request_wait_answer() */
 	smp_mb__after_atomic();
 	if (test_bit(FR_INTERRUPTED, &req->flags))
-		queue_interrupt(fiq, req);
+		queue_interrupt(fc, req);
 	fuse_put_request(fc, req);
 
 	return reqsize;
@@ -2049,7 +2113,7 @@ static __poll_t fuse_dev_poll(struct file *file, poll_table *wait)
 	if (!fud)
 		return EPOLLERR;
 
-	fiq = &fud->fc->iq;
+	fiq = READ_ONCE(fud->fiq);
 	poll_wait(file, &fiq->waitq, wait);
 
 	spin_lock(&fiq->waitq.lock);
@@ -2062,6 +2126,23 @@ static __poll_t fuse_dev_poll(struct file *file, poll_table *wait)
 	return mask;
 }
 
+static void fuse_abort_iqueue(struct fuse_iqueue *fiq,
+			      struct list_head *to_end)
+{
+	struct fuse_req *req;
+
+	spin_lock(&fiq->waitq.lock);
+	fiq->connected = 0;
+	list_for_each_entry(req, &fiq->pending, list)
+		clear_bit(FR_PENDING, &req->flags);
+	list_splice_tail_init(&fiq->pending, to_end);
+	while (forget_pending(fiq))
+		kfree(dequeue_forget(fiq, 1, NULL));
+	wake_up_all_locked(&fiq->waitq);
+	spin_unlock(&fiq->waitq.lock);
+	kill_fasync(&fiq->fasync, SIGIO, POLL_IN);
+}
+
 /*
  * Abort all requests on the given list (pending or processing)
  *
@@ -2114,8 +2195,6 @@ static void end_polls(struct fuse_conn *fc)
  */
 void fuse_abort_conn(struct fuse_conn *fc, bool is_abort)
 {
-	struct fuse_iqueue *fiq = &fc->iq;
-
 	spin_lock(&fc->lock);
 	if (fc->connected) {
 		struct fuse_dev *fud;
@@ -2148,16 +2227,16 @@ void fuse_abort_conn(struct fuse_conn *fc, bool is_abort)
 		fc->max_background = UINT_MAX;
 		flush_bg_queue(fc);
 
-		spin_lock(&fiq->waitq.lock);
-		fiq->connected = 0;
-		list_for_each_entry(req, &fiq->pending, list)
-			clear_bit(FR_PENDING, &req->flags);
-		list_splice_tail_init(&fiq->pending, &to_end);
-		while (forget_pending(fiq))
-			kfree(dequeue_forget(fiq, 1, NULL));
-		wake_up_all_locked(&fiq->waitq);
-		spin_unlock(&fiq->waitq.lock);
-		kill_fasync(&fiq->fasync, SIGIO, POLL_IN);
+		if (fc->cpu_iq) {
+			int cpu;
+
+			for_each_possible_cpu(cpu) {
+				if (fc->cpu_iq[cpu])
+					fuse_abort_iqueue(fc->cpu_iq[cpu],
+							  &to_end);
+			}
+		}
+		fuse_abort_iqueue(&fc->iq, &to_end);
 		end_polls(fc);
 		wake_up_all(&fc->blocked_waitq);
 		spin_unlock(&fc->lock);
@@ -2176,6 +2255,44 @@ void fuse_wait_aborted(struct fuse_conn *fc)
 	wait_event(fc->blocked_waitq, atomic_read(&fc->num_waiting) == 0);
 }
 
+/*
+ * Hand whatever is left on a per-CPU queue to the main queue when its last
+ * device goes away, so that the requests are not stranded.
+ */
+static void fuse_dev_unbind_queue(struct fuse_dev *fud)
+{
+	struct fuse_iqueue *fiq = fud->fiq;
+	struct fuse_iqueue *main_iq = &fud->fc->iq;
+	struct fuse_req *req;
+
+	if (fiq == main_iq)
+		return;
+
+	spin_lock(&fiq->waitq.lock);
+	if (--fiq->nr_devs) {
+		spin_unlock(&fiq->waitq.lock);
+		return;
+	}
+	spin_lock_nested(&main_iq->waitq.lock, SINGLE_DEPTH_NESTING);
+	list_for_each_entry(req, &fiq->pending, list)
+		req->fiq = main_iq;
+	list_for_each_entry(req, &fiq->interrupts, intr_entry)
+		req->fiq = main_iq;
+	list_splice_tail_init(&fiq->pending, &main_iq->pending);
+	list_splice_tail_init(&fiq->interrupts, &main_iq->interrupts);
+	if (forget_pending(fiq)) {
+		main_iq->forget_list_tail->next = fiq->forget_list_head.next;
+		main_iq->forget_list_tail = fiq->forget_list_tail;
+		fiq->forget_list_head.next = NULL;
+		fiq->forget_list_tail = &fiq->forget_list_head;
+	}
+	if (request_pending(main_iq))
+		wake_up_all_locked(&main_iq->waitq);
+	spin_unlock(&main_iq->waitq.lock);
+	spin_unlock(&fiq->waitq.lock);
+	kill_fasync(&main_iq->fasync, SIGIO, POLL_IN);
+}
+
 int fuse_dev_release(struct inode *inode, struct file *file)
 {
 	struct fuse_dev *fud = fuse_get_dev(file);
@@ -2192,6 +2309,8 @@ int fuse_dev_release(struct inode *inode, struct file *file)
 
 		end_requests(fc, &to_end);
 
+		fuse_dev_unbind_queue(fud);
+
 		/* Are we the last open device? */
 		if (atomic_dec_and_test(&fc->dev_count)) {
 			WARN_ON(fc->iq.fasync != NULL);
@@ -2211,7 +2330,7 @@ static int fuse_dev_fasync(int fd, struct file *file, int on)
 		return -EPERM;
 
 	/* No locking - fasync_helper does its own locking */
-	return fasync_helper(fd, file, on, &fud->fc->iq.fasync);
+	return fasync_helper(fd, file, on, &READ_ONCE(fud->fiq)->fasync);
 }
 
 static int fuse_device_clone(struct fuse_conn *fc, struct file *new)
@@ -2231,12 +2350,90 @@ static int fuse_device_clone(struct fuse_conn *fc, struct file *new)
 	return 0;
 }
 
+/*
+ * Make the device read the requests sent from @cpu, so that they are queued,
+ * read and answered without touching the main queue of the connection.
+ * Requests from CPUs without a bound device still go to the main queue, so
+ * unless all possible CPUs are bound, some device must keep reading that.
+ */
+static int fuse_dev_bind_queue(struct fuse_dev *fud, struct file *file,
+			       unsigned int cpu)
+{
+	struct fuse_conn *fc = fud->fc;
+	struct fuse_iqueue **cpu_iq;
+	struct fuse_iqueue *fiq;
+	int err;
+
+	if (cpu >= nr_cpu_ids || !cpu_possible(cpu))
+		return -EINVAL;
+
+	/* The fasync entry lives on the queue and would be left behind */
+	if (fud->fiq != &fc->iq || (file->f_flags & FASYNC))
+		return -EBUSY;
+
+	cpu_iq = fc->cpu_iq;
+	if (!cpu_iq) {
+		cpu_iq = kcalloc(nr_cpu_ids, sizeof(*cpu_iq), GFP_KERNEL);
+		if (!cpu_iq)
+			return -ENOMEM;
+	}
+	fiq = cpu_iq[cpu];
+	if (!fiq) {
+		fiq = kmalloc(sizeof(*fiq), GFP_KERNEL);
+		if (!fiq) {
+			err = -ENOMEM;
+			goto out_free;
+		}
+		fuse_iqueue_init(fiq);
+		/* Keep unique IDs apart from the other queues */
+		fiq->reqctr = (u64)(cpu + 1) << 48;
+	}
+
+	spin_lock(&fc->lock);
+	err = -ENODEV;
+	if (!fc->connected) {
+		spin_unlock(&fc->lock);
+		if (fiq != cpu_iq[cpu])
+			kfree(fiq);
+		goto out_free;
+	}
+	/* Pairs with READ_ONCE() in fuse_lock_iqueue() */
+	smp_store_release(&cpu_iq[cpu], fiq);
+	smp_store_release(&fc->cpu_iq, cpu_iq);
+	spin_lock(&fiq->waitq.lock);
+	fiq->nr_devs++;
+	WRITE_ONCE(fud->fiq, fiq);
+	spin_unlock(&fiq->waitq.lock);
+	spin_unlock(&fc->lock);
+
+	return 0;
+
+out_free:
+	if (cpu_iq != fc->cpu_iq)
+		kfree(cpu_iq);
+	return err;
+}
+
 static long fuse_dev_ioctl(struct file *file, unsigned int cmd,
 			   unsigned long arg)
 {
 	int err = -ENOTTY;
 
-	if (cmd == FUSE_DEV_IOC_CLONE) {
+	if (cmd == FUSE_DEV_IOC_BIND_QUEUE) {
+		struct fuse_dev *fud = fuse_get_dev(file);
+		__u32 cpu;
+
+		err = -EINVAL;
+		if (!fud)
+			return err;
+
+		err = -EFAULT;
+		if (!get_user(cpu, (__u32 __user *) arg)) {
+			mutex_lock(&fuse_mutex);
+			err = fuse_dev_bind_queue(fud, file, cpu);
+			mutex_unlock(&fuse_mutex);
+		}
+	} else if (cmd == FUSE_DEV_IOC_CLONE) {
 		int oldfd;
 
 		err = -EFAULT;
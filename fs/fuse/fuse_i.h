@@ -43,6 +43,12 @@
 /** Number of page pointers embedded in fuse_req */
 #define FUSE_REQ_INLINE_PAGES 1
 
+/**
+ * Bind a cloned device to the input queue of a CPU, next to
+ * FUSE_DEV_IOC_CLONE
+ */
+#define FUSE_DEV_IOC_BIND_QUEUE _IOW(229, 1, uint32_t)
+
 /** List of active connections */
 extern struct list_head fuse_conn_list;
 
@@ -382,6 +388,9 @@ struct fuse_req {
 
 	/** Request is stolen from fuse_file->reserved_req */
 	struct file *stolen_file;
+
+	/** Input queue the request was queued on, NULL means fc->iq */
+	struct fuse_iqueue *fiq;
 };
 
 struct fuse_iqueue {
@@ -409,6 +418,9 @@ struct fuse_iqueue {
 
 	/** O_ASYNC requests */
 	struct fasync_struct *fasync;
+
+	/** Number of devices reading a per-CPU queue */
+	unsigned nr_devs;
 };
 
 struct fuse_pqueue {
@@ -432,6 +444,9 @@ struct fuse_dev {
 	/** Fuse connection for this device */
 	struct fuse_conn *fc;
 
+	/** Input queue this device reads from */
+	struct fuse_iqueue *fiq;
+
 	/** Processing queue */
 	struct fuse_pqueue pq;
 
@@ -479,6 +494,9 @@ struct fuse_conn {
 	/** Input queue */
 	struct fuse_iqueue iq;
 
+	/** Per-CPU input queues, created by FUSE_DEV_IOC_BIND_QUEUE */
+	struct fuse_iqueue **cpu_iq;
+
 	/** The next unique kernel file handle */
 	u64 khctr;
 
@@ -891,6 +909,11 @@ void fuse_conn_put(struct fuse_conn *fc);
 struct fuse_dev *fuse_dev_alloc(struct fuse_conn *fc);
 void fuse_dev_free(struct fuse_dev *fud);
 
+/**
+ * Initialize an input queue
+ */
+void fuse_iqueue_init(struct fuse_iqueue *fiq);
+
 /**
  * Add connection to control filesystem
  */
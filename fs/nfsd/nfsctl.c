@@ -22,6 +22,7 @@
 #include "state.h"
 #include "netns.h"
 #include "pnfs.h"
+#include "vfs.h"
 
 /*
  *	We have a single directory with several nodes in it.
@@ -318,6 +319,7 @@ static ssize_t write_unlock_fs(struct file *file, char *buf, size_t size)
 	 * 3.  Is that directory the root of an exported file system?
 	 */
 	error = nlmsvc_unlock_all_by_sb(path.dentry->d_sb);
+	nfsd_fcache_purge();
 
 	path_put(&path);
 	return error;
@@ -243,6 +243,7 @@ static int nfsd_startup_generic(int nrservs)
 	ret = nfsd_racache_init(2*nrservs);
 	if (ret)
 		goto dec_users;
+	nfsd_fcache_init();
 
 	ret = nfs4_state_start();
 	if (ret)
@@ -250,6 +251,7 @@ static int nfsd_startup_generic(int nrservs)
 	return 0;
 
 out_racache:
+	nfsd_fcache_shutdown();
 	nfsd_racache_shutdown();
 dec_users:
 	nfsd_users--;
@@ -262,6 +264,7 @@ static void nfsd_shutdown_generic(void)
 		return;
 
 	nfs4_state_shutdown();
+	nfsd_fcache_shutdown();
 	nfsd_racache_shutdown();
 }
 
@@ -25,6 +25,7 @@
 #include <linux/posix_acl_xattr.h>
 #include <linux/xattr.h>
 #include <linux/jhash.h>
+#include <linux/hash.h>
 #include <linux/ima.h>
 #include <linux/slab.h>
 #include <linux/uaccess.h>
@@ -76,6 +77,36 @@ struct raparm_hbucket {
 #define RAPARM_HASH_MASK	(RAPARM_HASH_SIZE-1)
 static struct raparm_hbucket	raparm_hash[RAPARM_HASH_SIZE];
 
+/*
+ * Cache of the files opened by NFSv2/v3 READ and WRITE. These versions have
+ * no OPEN, so otherwise each request opens and closes the file, which is a
+ * large part of the cost of reading small files. A file is looked up by
+ * inode, mount and access mode, and is closed once it was not used for
+ * NFSD_FCACHE_TIMEOUT. Each request still goes through fh_verify() and
+ * breaks leases like nfsd_open() does.
+ */
+struct nfsd_fcache_entry {
+	struct list_head	fc_lru;
+	struct file		*fc_file;
+	int			fc_may;
+	unsigned long		fc_used;
+};
+
+struct nfsd_fcache_bucket {
+	struct list_head	fb_lru;		/* most recently used first */
+	unsigned int		fb_count;
+	spinlock_t		fb_lock;
+} ____cacheline_aligned_in_smp;
+
+#define NFSD_FCACHE_HASH_BITS	6
+#define NFSD_FCACHE_HASH_SIZE	(1<<NFSD_FCACHE_HASH_BITS)
+#define NFSD_FCACHE_BUCKET_MAX	8
+#define NFSD_FCACHE_TIMEOUT	(2*HZ)
+static struct nfsd_fcache_bucket	nfsd_fcache[NFSD_FCACHE_HASH_SIZE];
+
+static void nfsd_fcache_reap(struct work_struct *work);
+static DECLARE_DELAYED_WORK(nfsd_fcache_work, nfsd_fcache_reap);
+
 /* 
  * Called from nfsd_lookup and encode_dirent. Check if we have crossed 
  * a mount point.
@@ -783,6 +814,147 @@ out:
 	return err;
 }
 
+static struct file *
+nfsd_fcache_get(struct inode *inode, struct vfsmount *mnt, int may_flags)
+{
+	struct nfsd_fcache_bucket *b;
+	struct nfsd_fcache_entry *fc;
+	struct file *file = NULL;
+
+	b = &nfsd_fcache[hash_ptr(inode, NFSD_FCACHE_HASH_BITS)];
+	spin_lock(&b->fb_lock);
+	list_for_each_entry(fc, &b->fb_lru, fc_lru) {
+		if (file_inode(fc->fc_file) == inode &&
+		    fc->fc_file->f_path.mnt == mnt && fc->fc_may == may_flags) {
+			file = get_file(fc->fc_file);
+			fc->fc_used = jiffies;
+			list_move(&fc->fc_lru, &b->fb_lru);
+			break;
+		}
+	}
+	spin_unlock(&b->fb_lock);
+	return file;
+}
+
+static void nfsd_fcache_add(struct file *file, int may_flags)
+{
+	struct nfsd_fcache_bucket *b;
+	struct nfsd_fcache_entry *fc, *old = NULL;
+
+	fc = kmalloc(sizeof(*fc), GFP_KERNEL);
+	if (!fc)
+		return;
+	fc->fc_file = get_file(file);
+	fc->fc_may = may_flags;
+	fc->fc_used = jiffies;
+
+	b = &nfsd_fcache[hash_ptr(file_inode(file), NFSD_FCACHE_HASH_BITS)];
+	spin_lock(&b->fb_lock);
+	if (b->fb_count == NFSD_FCACHE_BUCKET_MAX) {
+		old = list_last_entry(&b->fb_lru, struct nfsd_fcache_entry,
+				      fc_lru);
+		list_del(&old->fc_lru);
+	} else
+		b->fb_count++;
+	list_add(&fc->fc_lru, &b->fb_lru);
+	spin_unlock(&b->fb_lock);
+
+	if (old) {
+		fput(old->fc_file);
+		kfree(old);
+	}
+	schedule_delayed_work(&nfsd_fcache_work, NFSD_FCACHE_TIMEOUT);
+}
+
+/* Close the files unused for NFSD_FCACHE_TIMEOUT, or all of them */
+static bool nfsd_fcache_prune(bool all)
+{
+	struct nfsd_fcache_entry *fc, *tmp;
+	LIST_HEAD(dispose);
+	bool busy = false;
+	int i;
+
+	for (i = 0; i < NFSD_FCACHE_HASH_SIZE; i++) {
+		struct nfsd_fcache_bucket *b = &nfsd_fcache[i];
+
+		if (list_empty(&b->fb_lru))
+			continue;
+		spin_lock(&b->fb_lock);
+		list_for_each_entry_safe_reverse(fc, tmp, &b->fb_lru, fc_lru) {
+			if (!all && time_before(jiffies,
+						fc->fc_used + NFSD_FCACHE_TIMEOUT))
+				break;
+			list_move(&fc->fc_lru, &dispose);
+			b->fb_count--;
+		}
+		busy |= b->fb_count != 0;
+		spin_unlock(&b->fb_lock);
+	}
+
+	list_for_each_entry_safe(fc, tmp, &dispose, fc_lru) {
+		fput(fc->fc_file);
+		kfree(fc);
+	}
+	return busy;
+}
+
+static void nfsd_fcache_reap(struct work_struct *work)
+{
+	if (nfsd_fcache_prune(false))
+		schedule_delayed_work(&nfsd_fcache_work, NFSD_FCACHE_TIMEOUT);
+}
+
+/*
+ * Close all the cached files, e.g. so that the file system they are on can
+ * be unmounted.
+ */
+void nfsd_fcache_purge(void)
+{
+	nfsd_fcache_prune(true);
+}
+
+/*
+ * Like nfsd_open() of a regular file, but the file is taken from, or added
+ * to, the open file cache.
+ * N.B. After this call fhp needs an fh_put
+ */
+static __be32
+nfsd_open_cached(struct svc_rqst *rqstp, struct svc_fh *fhp, int may_flags,
+		 struct file **filp)
+{
+	struct inode	*inode;
+	struct file	*file;
+	__be32		err;
+	int		host_err;
+
+	err = fh_verify(rqstp, fhp, S_IFREG,
+			may_flags | NFSD_MAY_OWNER_OVERRIDE);
+	if (err)
+		return err;
+
+	/* Let nfsd_open() refuse these */
+	inode = d_inode(fhp->fh_dentry);
+	if (mandatory_lock(inode) ||
+	    (IS_APPEND(inode) && (may_flags & NFSD_MAY_WRITE)))
+		return nfsd_open(rqstp, fhp, S_IFREG, may_flags, filp);
+
+	file = nfsd_fcache_get(inode, fhp->fh_export->ex_path.mnt, may_flags);
+	if (file) {
+		host_err = nfsd_open_break_lease(inode, may_flags);
+		if (host_err) {
+			fput(file);
+			return nfserrno(host_err);
+		}
+		*filp = file;
+		return nfs_ok;
+	}
+
+	err = nfsd_open(rqstp, fhp, S_IFREG, may_flags, filp);
+	if (!err)
+		nfsd_fcache_add(*filp, may_flags);
+	return err;
+}
+
 struct raparms *
 nfsd_init_raparms(struct file *file)
 {
@@ -1031,15 +1203,17 @@ __be32 nfsd_read(struct svc_rqst *rqstp, struct svc_fh *fhp,
 	loff_t offset, struct kvec *vec, int vlen, unsigned long *count)
 {
 	struct file *file;
-	struct raparms	*ra;
+	struct raparms	*ra = NULL;
 	__be32 err;
 
 	trace_nfsd_read_start(rqstp, fhp, offset, *count);
-	err = nfsd_open(rqstp, fhp, S_IFREG, NFSD_MAY_READ, &file);
+	err = nfsd_open_cached(rqstp, fhp, NFSD_MAY_READ, &file);
 	if (err)
 		return err;
 
-	ra = nfsd_init_raparms(file);
+	/* A cached file keeps its own readahead state */
+	if (file_count(file) == 1)
+		ra = nfsd_init_raparms(file);
 
 	if (file->f_op->splice_read && test_bit(RQ_SPLICE_OK, &rqstp->rq_flags))
 		err = nfsd_splice_read(rqstp, fhp, file, offset, count);
@@ -1069,7 +1243,11 @@ nfsd_write(struct svc_rqst *rqstp, struct svc_fh *fhp, loff_t offset,
 
 	trace_nfsd_write_start(rqstp, fhp, offset, *cnt);
 
-	err = nfsd_open(rqstp, fhp, S_IFREG, NFSD_MAY_WRITE, &file);
+	/* Write gathering relies on the number of writers of the inode */
+	if (rqstp->rq_vers == 2 && EX_WGATHER(fhp->fh_export))
+		err = nfsd_open(rqstp, fhp, S_IFREG, NFSD_MAY_WRITE, &file);
+	else
+		err = nfsd_open_cached(rqstp, fhp, NFSD_MAY_WRITE, &file);
 	if (err)
 		goto out;
 
@@ -2055,6 +2233,24 @@ nfsd_permission(struct svc_rqst *rqstp, struct svc_export *exp,
 	return err? nfserrno(err) : 0;
 }
 
+void
+nfsd_fcache_init(void)
+{
+	int i;
+
+	for (i = 0; i < NFSD_FCACHE_HASH_SIZE; i++) {
+		INIT_LIST_HEAD(&nfsd_fcache[i].fb_lru);
+		spin_lock_init(&nfsd_fcache[i].fb_lock);
+	}
+}
+
+void
+nfsd_fcache_shutdown(void)
+{
+	cancel_delayed_work_sync(&nfsd_fcache_work);
+	nfsd_fcache_prune(true);
+}
+
 void
 nfsd_racache_shutdown(void)
 {
@@ -42,6 +42,9 @@ typedef int (*nfsd_filldir_t)(void *, const char *, int, loff_t, u64, unsigned);
 /* nfsd/vfs.c */
 int		nfsd_racache_init(int);
 void		nfsd_racache_shutdown(void);
+void		nfsd_fcache_init(void);
+void		nfsd_fcache_shutdown(void);
+void		nfsd_fcache_purge(void);
 int		nfsd_cross_mnt(struct svc_rqst *rqstp, struct dentry **dpp,
 		                struct svc_export **expp);
 __be32		nfsd_lookup(struct svc_rqst *, struct svc_fh *,
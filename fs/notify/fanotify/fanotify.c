@@ -2,6 +2,7 @@
 #include <linux/fanotify.h>
 #include <linux/fdtable.h>
 #include <linux/fsnotify_backend.h>
+#include <linux/hash.h>
 #include <linux/init.h>
 #include <linux/jiffies.h>
 #include <linux/kernel.h> /* UINT_MAX */
@@ -33,9 +34,19 @@ static bool should_merge(struct fsnotify_event *old_fsn,
 }
 
 /* and the list better be locked by something too! */
+static struct hlist_head *fanotify_merge_bucket(struct fsnotify_group *group,
+						struct fsnotify_event *event)
+{
+	return &group->fanotify_data.merge_hash[hash_ptr(event->inode,
+							 FANOTIFY_HTABLE_BITS)];
+}
+
 static int fanotify_merge(struct list_head *list, struct fsnotify_event *event)
 {
-	struct fsnotify_event *test_event;
+	struct fsnotify_group *group = container_of(list, struct fsnotify_group,
+						    notification_list);
+	struct fanotify_event_info *test_event;
+	int i = 0;
 
 	pr_debug("%s: list=%p event=%p\n", __func__, list, event);
 
@@ -47,9 +58,13 @@ static int fanotify_merge(struct list_head *list, struct fsnotify_event *event)
 	if (fanotify_is_perm_event(event->mask))
 		return 0;
 
-	list_for_each_entry_reverse(test_event, list, list) {
-		if (should_merge(test_event, event)) {
-			test_event->mask |= event->mask;
+	/* Newest first, and only within a window of recent events */
+	hlist_for_each_entry(test_event, fanotify_merge_bucket(group, event),
+			     merge_list) {
+		if (++i > FANOTIFY_MAX_MERGE_EVENTS)
+			break;
+		if (should_merge(&test_event->fse, event)) {
+			test_event->fse.mask |= event->mask;
 			return 1;
 		}
 	}
@@ -57,6 +72,24 @@ static int fanotify_merge(struct list_head *list, struct fsnotify_event *event)
 	return 0;
 }
 
+/* Called with the notification lock held */
+static void fanotify_insert_event(struct fsnotify_group *group,
+				  struct fsnotify_event *event)
+{
+	if (fanotify_is_perm_event(event->mask))
+		return;
+
+	hlist_add_head(&FANOTIFY_E(event)->merge_list,
+		       fanotify_merge_bucket(group, event));
+}
+
+/* Called with the notification lock held, when the event gets dequeued */
+void fanotify_unhash_event(struct fsnotify_group *group,
+			   struct fsnotify_event *event)
+{
+	hlist_del_init(&FANOTIFY_E(event)->merge_list);
+}
+
 static int fanotify_get_response(struct fsnotify_group *group,
 				 struct fanotify_perm_event_info *event,
 				 struct fsnotify_iter_info *iter_info)
@@ -171,6 +204,7 @@ struct fanotify_event_info *fanotify_alloc_event(struct fsnotify_group *group,
 		goto out;
 init: __maybe_unused
 	fsnotify_init_event(&event->fse, inode, mask);
+	INIT_HLIST_NODE(&event->merge_list);
 	event->tgid = get_pid(task_tgid(current));
 	if (path) {
 		event->path = *path;
@@ -233,7 +267,8 @@ static int fanotify_handle_event(struct fsnotify_group *group,
 	}
 
 	fsn_event = &event->fse;
-	ret = fsnotify_add_event(group, fsn_event, fanotify_merge);
+	ret = fsnotify_add_event(group, fsn_event, fanotify_merge,
+				 fanotify_insert_event);
 	if (ret) {
 		/* Permission events shouldn't be merged */
 		BUG_ON(ret == 1 && mask & FAN_ALL_PERM_EVENTS);
@@ -257,6 +292,7 @@ static void fanotify_free_group_priv(struct fsnotify_group *group)
 {
 	struct user_struct *user;
 
+	kfree(group->fanotify_data.merge_hash);
 	user = group->fanotify_data.user;
 	atomic_dec(&user->fanotify_listeners);
 	free_uid(user);
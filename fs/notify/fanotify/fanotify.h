@@ -20,8 +20,18 @@ struct fanotify_event_info {
 	 */
 	struct path path;
 	struct pid *tgid;
+	/* in group->fanotify_data.merge_hash while queued */
+	struct hlist_node merge_list;
 };
 
+/*
+ * Queued events are hashed by inode, and a new event is only compared with
+ * the most recent ones of its bucket.
+ */
+#define FANOTIFY_HTABLE_BITS	7
+#define FANOTIFY_HTABLE_SIZE	(1 << FANOTIFY_HTABLE_BITS)
+#define FANOTIFY_MAX_MERGE_EVENTS	128
+
 /*
  * Structure for permission fanotify events. It gets allocated and freed in
  * fanotify_handle_event() since we wait there for user response. When the
@@ -52,6 +62,9 @@ static inline struct fanotify_event_info *FANOTIFY_E(struct fsnotify_event *fse)
 	return container_of(fse, struct fanotify_event_info, fse);
 }
 
+void fanotify_unhash_event(struct fsnotify_group *group,
+			   struct fsnotify_event *fsn_event);
+
 struct fanotify_event_info *fanotify_alloc_event(struct fsnotify_group *group,
 						 struct inode *inode, u32 mask,
 						 const struct path *path);
@@ -92,12 +92,15 @@ void fsnotify_destroy_event(struct fsnotify_group *group,
  * event off the queue to deal with.  The function returns 0 if the event was
  * added to the queue, 1 if the event was merged with some other queued event,
  * 2 if the event was not queued - either the queue of events has overflown
- * or the group is shutting down.
+ * or the group is shutting down. The insert callback, if any, is called under
+ * the notification lock when the event itself gets queued.
  */
 int fsnotify_add_event(struct fsnotify_group *group,
 		       struct fsnotify_event *event,
 		       int (*merge)(struct list_head *,
-				    struct fsnotify_event *))
+				    struct fsnotify_event *),
+		       void (*insert)(struct fsnotify_group *,
+				      struct fsnotify_event *))
 {
 	int ret = 0;
 	struct list_head *list = &group->notification_list;
@@ -131,6 +134,8 @@ int fsnotify_add_event(struct fsnotify_group *group,
 		}
 	}
 
+	if (insert)
+		insert(group, event);
 queue:
 	group->q_len++;
 	list_add_tail(&event->list, list);
@@ -21,10 +21,18 @@
 #include <linux/fdtable.h>
 #include <linux/ratelimit.h>
 #include <linux/exportfs.h>
+#include <linux/workqueue.h>
 #include "overlayfs.h"
 
 #define OVL_COPY_UP_CHUNK_SIZE (1 << 20)
 
+static struct workqueue_struct *ovl_copy_up_wq;
+
+struct ovl_copy_up_work {
+	struct work_struct work;
+	struct path path;
+};
+
 static int ovl_ccup_set(const char *buf, const struct kernel_param *param)
 {
 	pr_warn("overlayfs: \"check_copy_up\" module option is obsolete\n");
@@ -849,14 +857,88 @@ static bool ovl_open_need_copy_up(struct dentry *dentry, int flags)
 	return true;
 }
 
-int ovl_open_maybe_copy_up(struct dentry *dentry, unsigned int file_flags)
+/*
+ * With lazycopy=on, opening a lower file write only copies up its metadata
+ * and leaves the data to ovl_copy_up_wq. Until the data is up, the file is
+ * read from the lower layer, and anything that modifies the data waits for
+ * the copy in ovl_copy_up_with_data(), or does it if it wins oi->lock.
+ *
+ * Files opened for read and write still copy up their data on open: such a
+ * file may be mapped shared, and ->mmap() cannot wait for the copy.
+ */
+static bool ovl_open_need_lazy_copy_up(struct dentry *dentry, int flags)
+{
+	struct ovl_fs *ofs = dentry->d_sb->s_fs_info;
+
+	if (!ofs->config.lazycopy || !ofs->config.metacopy)
+		return false;
+
+	if (!d_is_reg(dentry) || (flags & O_TRUNC))
+		return false;
+
+	if ((flags & O_ACCMODE) != O_WRONLY)
+		return false;
+
+	return true;
+}
+
+static void ovl_copy_up_data_work(struct work_struct *work)
 {
+	struct ovl_copy_up_work *cw = container_of(work, typeof(*cw), work);
+	struct dentry *dentry = cw->path.dentry;
+	int err;
+
+	err = ovl_want_write(dentry);
+	if (!err) {
+		err = ovl_copy_up_with_data(dentry);
+		ovl_drop_write(dentry);
+	}
+	if (err)
+		pr_warn_ratelimited("overlayfs: lazy data copy up of %pd2 failed (%i)\n",
+				    dentry, err);
+
+	path_put(&cw->path);
+	kfree(cw);
+}
+
+static int ovl_lazy_copy_up(const struct path *path, int flags)
+{
+	struct dentry *dentry = path->dentry;
+	struct ovl_copy_up_work *cw;
+	int err;
+
+	cw = kmalloc(sizeof(*cw), GFP_KERNEL);
+	if (!cw)
+		return ovl_copy_up_flags(dentry, flags);
+
+	/* Metadata only, as for a file opened for read */
+	err = ovl_copy_up_flags(dentry, 0);
+	if (err || ovl_has_upperdata(d_inode(dentry))) {
+		kfree(cw);
+		return err;
+	}
+
+	/* The mount reference keeps the overlay alive until the copy is done */
+	INIT_WORK(&cw->work, ovl_copy_up_data_work);
+	cw->path = *path;
+	path_get(&cw->path);
+	queue_work(ovl_copy_up_wq, &cw->work);
+
+	return 0;
+}
+
+int ovl_open_maybe_copy_up(const struct path *path, unsigned int file_flags)
+{
+	struct dentry *dentry = path->dentry;
 	int err = 0;
 
 	if (ovl_open_need_copy_up(dentry, file_flags)) {
 		err = ovl_want_write(dentry);
 		if (!err) {
-			err = ovl_copy_up_flags(dentry, file_flags);
+			if (ovl_open_need_lazy_copy_up(dentry, file_flags))
+				err = ovl_lazy_copy_up(path, file_flags);
+			else
+				err = ovl_copy_up_flags(dentry, file_flags);
 			ovl_drop_write(dentry);
 		}
 	}
@@ -873,3 +955,17 @@ int ovl_copy_up(struct dentry *dentry)
 {
 	return ovl_copy_up_flags(dentry, 0);
 }
+
+int __init ovl_copy_up_init(void)
+{
+	ovl_copy_up_wq = alloc_workqueue("ovl_copy_up", WQ_UNBOUND, 0);
+	if (!ovl_copy_up_wq)
+		return -ENOMEM;
+
+	return 0;
+}
+
+void ovl_copy_up_exit(void)
+{
+	destroy_workqueue(ovl_copy_up_wq);
+}
@@ -29,9 +29,14 @@ static struct file *ovl_open_realfile(const struct file *file,
 	struct inode *inode = file_inode(file);
 	struct file *realfile;
 	const struct cred *old_cred;
+	int flags = file->f_flags | O_NOATIME;
+
+	/* A file opened for write before its lazy data copy up reads lower */
+	if (realinode != ovl_inode_upper(inode))
+		flags &= ~O_ACCMODE;
 
 	old_cred = ovl_override_creds(inode->i_sb);
-	realfile = open_with_fake_path(&file->f_path, file->f_flags | O_NOATIME,
+	realfile = open_with_fake_path(&file->f_path, flags,
 				       realinode, current_cred());
 	revert_creds(old_cred);
 
@@ -52,8 +57,11 @@ static int ovl_change_flags(struct file *file, unsigned int flags)
 	/* No atime modificaton on underlying */
 	flags |= O_NOATIME;
 
-	/* If some flag changed that cannot be changed then something's amiss */
-	if (WARN_ON((file->f_flags ^ flags) & ~OVL_SETFL_MASK))
+	/*
+	 * If some flag changed that cannot be changed then something's amiss.
+	 * The access mode of a lower file may differ, see ovl_open_realfile().
+	 */
+	if (WARN_ON((file->f_flags ^ flags) & ~(OVL_SETFL_MASK | O_ACCMODE)))
 		return -EIO;
 
 	flags &= OVL_SETFL_MASK;
@@ -103,7 +111,8 @@ static int ovl_real_fdget_meta(const struct file *file, struct fd *real,
 	}
 
 	/* Did the flags change since open? */
-	if (unlikely((file->f_flags ^ real->file->f_flags) & ~O_NOATIME))
+	if (unlikely((file->f_flags ^ real->file->f_flags) &
+		     ~(O_NOATIME | O_ACCMODE)))
 		return ovl_change_flags(real->file, file->f_flags);
 
 	return 0;
@@ -114,13 +123,30 @@ static int ovl_real_fdget(const struct file *file, struct fd *real)
 	return ovl_real_fdget_meta(file, real, false);
 }
 
-static int ovl_open(struct inode *inode, struct file *file)
+/* Wait for the data of a lazily copied up file before modifying it */
+static int ovl_copy_up_data_wait(struct file *file)
 {
 	struct dentry *dentry = file_dentry(file);
+	int err;
+
+	if (ovl_has_upperdata(file_inode(file)))
+		return 0;
+
+	err = ovl_want_write(dentry);
+	if (!err) {
+		err = ovl_copy_up_with_data(dentry);
+		ovl_drop_write(dentry);
+	}
+
+	return err;
+}
+
+static int ovl_open(struct inode *inode, struct file *file)
+{
 	struct file *realfile;
 	int err;
 
-	err = ovl_open_maybe_copy_up(dentry, file->f_flags);
+	err = ovl_open_maybe_copy_up(&file->f_path, file->f_flags);
 	if (err)
 		return err;
 
@@ -228,6 +254,10 @@ static ssize_t ovl_write_iter(struct kiocb *iocb, struct iov_iter *iter)
 	if (!iov_iter_count(iter))
 		return 0;
 
+	ret = ovl_copy_up_data_wait(file);
+	if (ret)
+		return ret;
+
 	inode_lock(inode);
 	/* Update mode */
 	ovl_copyattr(ovl_inode_real(inode), inode);
@@ -317,6 +347,10 @@ static long ovl_fallocate(struct file *file, int mode, loff_t offset, loff_t len
 	const struct cred *old_cred;
 	int ret;
 
+	ret = ovl_copy_up_data_wait(file);
+	if (ret)
+		return ret;
+
 	ret = ovl_real_fdget(file, &real);
 	if (ret)
 		return ret;
@@ -443,6 +477,12 @@ static ssize_t ovl_copyfile(struct file *file_in, loff_t pos_in,
 	const struct cred *old_cred;
 	ssize_t ret;
 
+	if (op != OVL_DEDUPE) {
+		ret = ovl_copy_up_data_wait(file_out);
+		if (ret)
+			return ret;
+	}
+
 	ret = ovl_real_fdget(file_out, &real_out);
 	if (ret)
 		return ret;
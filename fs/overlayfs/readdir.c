@@ -7,6 +7,7 @@
  * the Free Software Foundation.
  */
 
+#include <linux/module.h>
 #include <linux/fs.h>
 #include <linux/slab.h>
 #include <linux/namei.h>
@@ -34,6 +35,7 @@ struct ovl_cache_entry {
 struct ovl_dir_cache {
 	long refcount;
 	u64 version;
+	bool impure;
 	struct list_head entries;
 	struct rb_root root;
 };
@@ -52,6 +54,48 @@ struct ovl_readdir_data {
 	bool d_type_supported;
 };
 
+enum ovl_dir_cache_stat {
+	OVL_DCS_HIT,
+	OVL_DCS_BUILD,
+	OVL_DCS_UPDATE,
+	OVL_DCS_DROP,
+	OVL_DCS_NR,
+};
+
+static const char * const ovl_dir_cache_stat_names[OVL_DCS_NR] = {
+	[OVL_DCS_HIT]		= "hits",
+	[OVL_DCS_BUILD]		= "builds",
+	[OVL_DCS_UPDATE]	= "updates",
+	[OVL_DCS_DROP]		= "drops",
+};
+
+static atomic_long_t ovl_dir_cache_stats[OVL_DCS_NR];
+
+static inline void ovl_dir_cache_stat_inc(enum ovl_dir_cache_stat stat)
+{
+	atomic_long_inc(&ovl_dir_cache_stats[stat]);
+}
+
+static int ovl_dcs_set(const char *buf, const struct kernel_param *param)
+{
+	return -EPERM;
+}
+
+static int ovl_dcs_get(char *buf, const struct kernel_param *param)
+{
+	int i, len = 0;
+
+	for (i = 0; i < OVL_DCS_NR; i++)
+		len += sprintf(buf + len, "%s %ld\n",
+			       ovl_dir_cache_stat_names[i],
+			       atomic_long_read(&ovl_dir_cache_stats[i]));
+	return len;
+}
+
+module_param_call(dir_cache_stats, ovl_dcs_set, ovl_dcs_get, NULL, 0444);
+MODULE_PARM_DESC(ovl_dir_cache_stats,
+		 "Merged dir cache hits, builds, incremental updates and drops");
+
 struct ovl_dir_file {
 	bool is_real;
 	bool is_upper;
@@ -143,9 +187,9 @@ static bool ovl_calc_d_ino(struct ovl_readdir_data *rdd,
 	return false;
 }
 
-static struct ovl_cache_entry *ovl_cache_entry_new(struct ovl_readdir_data *rdd,
-						   const char *name, int len,
-						   u64 ino, unsigned int d_type)
+static struct ovl_cache_entry *ovl_cache_entry_alloc(const char *name, int len,
+						     u64 ino,
+						     unsigned int d_type)
 {
 	struct ovl_cache_entry *p;
 	size_t size = offsetof(struct ovl_cache_entry, name[len + 1]);
@@ -160,11 +204,27 @@ static struct ovl_cache_entry *ovl_cache_entry_new(struct ovl_readdir_data *rdd,
 	p->type = d_type;
 	p->real_ino = ino;
 	p->ino = ino;
+	p->next_maybe_whiteout = NULL;
+	p->is_upper = false;
+	p->is_whiteout = false;
+
+	return p;
+}
+
+static struct ovl_cache_entry *ovl_cache_entry_new(struct ovl_readdir_data *rdd,
+						   const char *name, int len,
+						   u64 ino, unsigned int d_type)
+{
+	struct ovl_cache_entry *p;
+
+	p = ovl_cache_entry_alloc(name, len, ino, d_type);
+	if (!p)
+		return NULL;
+
 	/* Defer setting d_ino for upper entry to ovl_iterate() */
 	if (ovl_calc_d_ino(rdd, p))
 		p->ino = 0;
 	p->is_upper = rdd->is_upper;
-	p->is_whiteout = false;
 
 	if (d_type == DT_CHR) {
 		p->next_maybe_whiteout = rdd->first_maybe_whiteout;
@@ -245,8 +305,16 @@ static void ovl_cache_put(struct ovl_dir_file *od, struct dentry *dentry)
 	WARN_ON(cache->refcount <= 0);
 	cache->refcount--;
 	if (!cache->refcount) {
-		if (ovl_dir_cache(d_inode(dentry)) == cache)
+		if (ovl_dir_cache(d_inode(dentry)) == cache) {
+			/*
+			 * Keep an up to date cache around for the next open,
+			 * changes to the dir are applied by
+			 * ovl_dir_cache_update() from now on.
+			 */
+			if (cache->version == ovl_dentry_version_get(dentry))
+				return;
 			ovl_set_dir_cache(d_inode(dentry), NULL);
+		}
 
 		ovl_cache_free(&cache->entries);
 		kfree(cache);
@@ -412,10 +480,20 @@ static struct ovl_dir_cache *ovl_cache_get(struct dentry *dentry)
 
 	cache = ovl_dir_cache(d_inode(dentry));
 	if (cache && ovl_dentry_version_get(dentry) == cache->version) {
-		WARN_ON(!cache->refcount);
+		if (!cache->refcount) {
+			struct ovl_cache_entry *p;
+
+			/* The dir may have been moved since last use */
+			p = ovl_cache_entry_find(&cache->root, "..", 2);
+			if (p)
+				p->ino = 0;
+		}
 		cache->refcount++;
+		ovl_dir_cache_stat_inc(OVL_DCS_HIT);
 		return cache;
 	}
+	if (cache && !cache->refcount)
+		ovl_dir_cache_free(d_inode(dentry));
 	ovl_set_dir_cache(d_inode(dentry), NULL);
 
 	cache = kzalloc(sizeof(struct ovl_dir_cache), GFP_KERNEL);
@@ -434,11 +512,91 @@ static struct ovl_dir_cache *ovl_cache_get(struct dentry *dentry)
 	}
 
 	cache->version = ovl_dentry_version_get(dentry);
+	ovl_dir_cache_stat_inc(OVL_DCS_BUILD);
 	ovl_set_dir_cache(d_inode(dentry), cache);
 
 	return cache;
 }
 
+static int ovl_cache_entry_update(struct ovl_dir_cache *cache,
+				  struct dentry *upper)
+{
+	const struct qstr *name = &upper->d_name;
+	struct rb_node **newp = &cache->root.rb_node;
+	struct rb_node *parent = NULL;
+	struct ovl_cache_entry *p = NULL;
+	struct inode *inode = d_inode(upper);
+
+	if (ovl_cache_entry_find_link(name->name, name->len, &newp, &parent))
+		p = ovl_cache_entry_from_node(*newp);
+
+	if (!inode || ovl_is_whiteout(upper)) {
+		/* Name is gone from upper, a lower entry shows unless hidden */
+		if (p && (p->is_upper || inode))
+			p->is_whiteout = true;
+		return 0;
+	}
+
+	if (!p) {
+		p = ovl_cache_entry_alloc(name->name, name->len, 0, DT_UNKNOWN);
+		if (!p)
+			return -ENOMEM;
+
+		list_add_tail(&p->l_node, &cache->entries);
+		rb_link_node(&p->node, parent, newp);
+		rb_insert_color(&p->node, &cache->root);
+	}
+	p->type = (inode->i_mode & S_IFMT) >> 12;
+	p->real_ino = inode->i_ino;
+	/* Let ovl_iterate() work out d_ino, the entry may be a copy up */
+	p->ino = 0;
+	p->is_upper = true;
+	p->is_whiteout = false;
+
+	return 0;
+}
+
+/*
+ * Called with @dentry and its upper dir locked, after @name in the upper dir
+ * was changed.  An unused merged cache is patched with the new state of the
+ * upper entry instead of being read again on next open.  A cache in use by
+ * an open dir is left alone, so readers keep a stable view and the cache is
+ * dropped when it is released.
+ */
+void ovl_dir_cache_update(struct dentry *dentry, const struct qstr *name)
+{
+	struct inode *inode = d_inode(dentry);
+	struct ovl_dir_cache *cache = ovl_dir_cache(inode);
+	u64 version = ovl_dentry_version_get(dentry);
+	struct dentry *upper;
+	int err;
+
+	if (!cache || cache->impure || cache->refcount ||
+	    cache->version == version)
+		return;
+
+	if (cache->version + 1 != version)
+		goto drop;
+
+	upper = lookup_one_len(name->name, ovl_dentry_upper(dentry), name->len);
+	if (IS_ERR(upper))
+		goto drop;
+
+	err = ovl_cache_entry_update(cache, upper);
+	dput(upper);
+	if (err)
+		goto drop;
+
+	cache->version = version;
+	ovl_dir_cache_stat_inc(OVL_DCS_UPDATE);
+	return;
+
+drop:
+	ovl_dir_cache_free(inode);
+	ovl_set_dir_cache(inode, NULL);
+	ovl_dir_cache_stat_inc(OVL_DCS_DROP);
+}
+
 /* Map inode number to lower fs unique range */
 static u64 ovl_remap_lower_ino(u64 ino, int xinobits, int fsid,
 			       const char *name, int namelen)
@@ -608,6 +766,7 @@ static struct ovl_dir_cache *ovl_cache_get_impure(struct path *path)
 	if (!cache)
 		return ERR_PTR(-ENOMEM);
 
+	cache->impure = true;
 	res = ovl_dir_read_impure(path, &cache->entries, &cache->root);
 	if (res) {
 		ovl_cache_free(&cache->entries);
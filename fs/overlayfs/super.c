@@ -69,6 +69,11 @@ module_param_named(metacopy, ovl_metacopy_def, bool, 0644);
 MODULE_PARM_DESC(ovl_metacopy_def,
 		 "Default to on or off for the metadata only copy up feature");
 
+static bool ovl_lazycopy_def;
+module_param_named(lazycopy, ovl_lazycopy_def, bool, 0644);
+MODULE_PARM_DESC(ovl_lazycopy_def,
+		 "Default to on or off for copying up data in the background");
+
 static void ovl_dentry_release(struct dentry *dentry)
 {
 	struct ovl_entry *oe = dentry->d_fsdata;
@@ -362,6 +367,9 @@ static int ovl_show_options(struct seq_file *m, struct dentry *dentry)
 	if (ofs->config.metacopy != ovl_metacopy_def)
 		seq_printf(m, ",metacopy=%s",
 			   ofs->config.metacopy ? "on" : "off");
+	if (ofs->config.lazycopy != ovl_lazycopy_def)
+		seq_printf(m, ",lazycopy=%s",
+			   ofs->config.lazycopy ? "on" : "off");
 	return 0;
 }
 
@@ -401,6 +409,8 @@ enum {
 	OPT_XINO_AUTO,
 	OPT_METACOPY_ON,
 	OPT_METACOPY_OFF,
+	OPT_LAZYCOPY_ON,
+	OPT_LAZYCOPY_OFF,
 	OPT_ERR,
 };
 
@@ -419,6 +429,8 @@ static const match_table_t ovl_tokens = {
 	{OPT_XINO_AUTO,			"xino=auto"},
 	{OPT_METACOPY_ON,		"metacopy=on"},
 	{OPT_METACOPY_OFF,		"metacopy=off"},
+	{OPT_LAZYCOPY_ON,		"lazycopy=on"},
+	{OPT_LAZYCOPY_OFF,		"lazycopy=off"},
 	{OPT_ERR,			NULL}
 };
 
@@ -473,6 +485,7 @@ static int ovl_parse_opt(char *opt, struct ovl_config *config)
 	char *p;
 	int err;
 	bool metacopy_opt = false, redirect_opt = false;
+	bool metacopy_off_opt = false, lazycopy_opt = false;
 
 	config->redirect_mode = kstrdup(ovl_redirect_mode_def(), GFP_KERNEL);
 	if (!config->redirect_mode)
@@ -555,6 +568,16 @@ static int ovl_parse_opt(char *opt, struct ovl_config *config)
 
 		case OPT_METACOPY_OFF:
 			config->metacopy = false;
+			metacopy_off_opt = true;
+			break;
+
+		case OPT_LAZYCOPY_ON:
+			config->lazycopy = true;
+			lazycopy_opt = true;
+			break;
+
+		case OPT_LAZYCOPY_OFF:
+			config->lazycopy = false;
 			break;
 
 		default:
@@ -582,6 +605,20 @@ static int ovl_parse_opt(char *opt, struct ovl_config *config)
 	if (!config->upperdir && config->redirect_follow)
 		config->redirect_dir = true;
 
+	/* Resolve lazycopy -> metacopy dependency */
+	if (config->lazycopy && !config->metacopy) {
+		if (lazycopy_opt && metacopy_off_opt) {
+			pr_err("overlayfs: conflicting options: lazycopy=on,metacopy=off\n");
+			return -EINVAL;
+		}
+		if (metacopy_off_opt) {
+			config->lazycopy = false;
+		} else {
+			/* Automatically enable metacopy otherwise. */
+			config->metacopy = true;
+		}
+	}
+
 	/* Resolve metacopy -> redirect_dir dependency */
 	if (config->metacopy && !config->redirect_dir) {
 		if (metacopy_opt && redirect_opt) {
@@ -597,6 +634,7 @@ static int ovl_parse_opt(char *opt, struct ovl_config *config)
 			pr_info("overlayfs: disabling metacopy due to redirect_dir=%s\n",
 				config->redirect_mode);
 			config->metacopy = false;
+			config->lazycopy = false;
 		} else {
 			/* Automatically enable redirect otherwise. */
 			config->redirect_follow = config->redirect_dir = true;
@@ -1078,6 +1116,7 @@ static int ovl_make_workdir(struct ovl_fs *ofs, struct path *workpath)
 		ofs->noxattr = true;
 		ofs->config.index = false;
 		ofs->config.metacopy = false;
+		ofs->config.lazycopy = false;
 		pr_warn("overlayfs: upper fs does not support xattr, falling back to index=off and metacopy=off.\n");
 		err = 0;
 	} else {
@@ -1412,6 +1451,7 @@ static int ovl_fill_super(struct super_block *sb, void *data, int silent)
 	ofs->config.nfs_export = ovl_nfs_export_def;
 	ofs->config.xino = ovl_xino_def();
 	ofs->config.metacopy = ovl_metacopy_def;
+	ofs->config.lazycopy = ovl_lazycopy_def;
 	err = ovl_parse_opt((char *) data, &ofs->config);
 	if (err)
 		goto out_err;
@@ -1567,9 +1607,20 @@ static int __init ovl_init(void)
 	if (ovl_inode_cachep == NULL)
 		return -ENOMEM;
 
+	err = ovl_copy_up_init();
+	if (err)
+		goto out_cache;
+
 	err = register_filesystem(&ovl_fs_type);
 	if (err)
-		kmem_cache_destroy(ovl_inode_cachep);
+		goto out_copy_up;
+
+	return 0;
+
+out_copy_up:
+	ovl_copy_up_exit();
+out_cache:
+	kmem_cache_destroy(ovl_inode_cachep);
 
 	return err;
 }
@@ -1577,6 +1628,7 @@ static int __init ovl_init(void)
 static void __exit ovl_exit(void)
 {
 	unregister_filesystem(&ovl_fs_type);
+	ovl_copy_up_exit();
 
 	/*
 	 * Make sure all delayed rcu free inodes are flushed before we
@@ -454,12 +454,14 @@ static void ovl_dentry_version_inc(struct dentry *dentry, bool impurity)
 		OVL_I(inode)->version++;
 }
 
-void ovl_dir_modified(struct dentry *dentry, bool impurity)
+void ovl_dir_modified(struct dentry *dentry, const struct qstr *name,
+		      bool impurity)
 {
 	/* Copy mtime/ctime */
 	ovl_copyattr(d_inode(ovl_dentry_upper(dentry)), d_inode(dentry));
 
 	ovl_dentry_version_inc(dentry, impurity);
+	ovl_dir_cache_update(dentry, name);
 }
 
 u64 ovl_dentry_version_get(struct dentry *dentry)
@@ -421,6 +421,18 @@ static int notrace ramoops_pstore_write(struct pstore_record *record)
 	if (record->reason == KMSG_DUMP_OOPS && !cxt->dump_oops)
 		return -EINVAL;
 
+	/*
+	 * Protect the trace leading to the crash. On panic, the other CPUs
+	 * are stopped by now and no longer write to the ftrace zones.
+	 */
+	if (record->reason == KMSG_DUMP_PANIC &&
+	    (cxt->flags & RAMOOPS_FLAG_FTRACE_ASYNC_ECC)) {
+		int i;
+
+		for (i = 0; cxt->fprzs && i < cxt->max_ftrace_cnt; i++)
+			persistent_ram_flush_ecc(cxt->fprzs[i]);
+	}
+
 	/*
 	 * Explicitly only take the first part of any new crash.
 	 * If our buffer is larger than kmsg_bytes, this can never happen,
@@ -794,8 +806,10 @@ static int ramoops_probe(struct platform_device *pdev)
 	err = ramoops_init_przs("ftrace", dev, cxt, &cxt->fprzs, &paddr,
 				cxt->ftrace_size, -1,
 				&cxt->max_ftrace_cnt, LINUX_VERSION_CODE,
-				(cxt->flags & RAMOOPS_FLAG_FTRACE_PER_CPU)
-					? PRZ_FLAG_NO_LOCK : 0);
+				((cxt->flags & RAMOOPS_FLAG_FTRACE_PER_CPU)
+					? PRZ_FLAG_NO_LOCK : 0) |
+				((cxt->flags & RAMOOPS_FLAG_FTRACE_ASYNC_ECC)
+					? PRZ_FLAG_ASYNC_ECC : 0));
 	if (err)
 		goto fail_init_fprz;
 
@@ -14,6 +14,7 @@
 
 #define pr_fmt(fmt) "persistent_ram: " fmt
 
+#include <linux/bitmap.h>
 #include <linux/device.h>
 #include <linux/err.h>
 #include <linux/errno.h>
@@ -118,6 +119,21 @@ static int persistent_ram_decode_rs8(struct persistent_ram_zone *prz,
 				NULL, 0, NULL, 0, NULL);
 }
 
+#define PERSISTENT_RAM_ECC_INTERVAL	HZ
+
+static void notrace persistent_ram_encode_block(struct persistent_ram_zone *prz,
+	unsigned int idx)
+{
+	struct persistent_ram_buffer *buffer = prz->buffer;
+	int ecc_block_size = prz->ecc_info.block_size;
+	uint8_t *block = buffer->data + idx * ecc_block_size;
+	int size = min_t(int, ecc_block_size,
+			 buffer->data + prz->buffer_size - block);
+
+	persistent_ram_encode_rs8(prz, block, size,
+				  prz->par_buffer + idx * prz->ecc_info.ecc_size);
+}
+
 static void notrace persistent_ram_update_ecc(struct persistent_ram_zone *prz,
 	unsigned int start, unsigned int count)
 {
@@ -132,6 +148,16 @@ static void notrace persistent_ram_update_ecc(struct persistent_ram_zone *prz,
 	if (!ecc_size)
 		return;
 
+	if (prz->ecc_dirty) {
+		unsigned int idx;
+
+		/* Marked after the data is written, see persistent_ram_flush_ecc */
+		for (idx = start / ecc_block_size;
+		     count && idx <= (start + count - 1) / ecc_block_size; idx++)
+			set_bit(idx, prz->ecc_dirty);
+		return;
+	}
+
 	block = buffer->data + (start & ~(ecc_block_size - 1));
 	par = prz->par_buffer + (start / ecc_block_size) * ecc_size;
 
@@ -151,10 +177,50 @@ static void persistent_ram_update_header_ecc(struct persistent_ram_zone *prz)
 	if (!prz->ecc_info.ecc_size)
 		return;
 
+	if (prz->ecc_dirty) {
+		set_bit(prz->ecc_info.ecc_blocks, prz->ecc_dirty);
+		return;
+	}
+
 	persistent_ram_encode_rs8(prz, (uint8_t *)buffer, sizeof(*buffer),
 				  prz->par_header);
 }
 
+/**
+ * persistent_ram_flush_ecc - compute the pending ECC of a zone
+ * @prz: zone created with PRZ_FLAG_ASYNC_ECC
+ *
+ * Must not run concurrently with itself on the same zone. Writes to the zone
+ * may go on, the blocks they touch are simply marked again.
+ */
+void notrace persistent_ram_flush_ecc(struct persistent_ram_zone *prz)
+{
+	int nblocks, idx;
+
+	if (!prz || !prz->ecc_dirty)
+		return;
+
+	nblocks = prz->ecc_info.ecc_blocks;
+	for_each_set_bit(idx, prz->ecc_dirty, nblocks)
+		if (test_and_clear_bit(idx, prz->ecc_dirty))
+			persistent_ram_encode_block(prz, idx);
+
+	if (test_and_clear_bit(nblocks, prz->ecc_dirty))
+		persistent_ram_encode_rs8(prz, (uint8_t *)prz->buffer,
+					  sizeof(*prz->buffer),
+					  prz->par_header);
+}
+
+static void persistent_ram_ecc_work(struct work_struct *work)
+{
+	struct persistent_ram_zone *prz =
+		container_of(to_delayed_work(work), struct persistent_ram_zone,
+			     ecc_work);
+
+	persistent_ram_flush_ecc(prz);
+	schedule_delayed_work(&prz->ecc_work, PERSISTENT_RAM_ECC_INTERVAL);
+}
+
 static void persistent_ram_ecc_old(struct persistent_ram_zone *prz)
 {
 	struct persistent_ram_buffer *buffer = prz->buffer;
@@ -212,6 +278,7 @@ static int persistent_ram_init_ecc(struct persistent_ram_zone *prz,
 	}
 
 	prz->buffer_size -= ecc_total;
+	prz->ecc_info.ecc_blocks = ecc_blocks;
 	prz->par_buffer = buffer->data + prz->buffer_size;
 	prz->par_header = prz->par_buffer +
 			  ecc_blocks * prz->ecc_info.ecc_size;
@@ -249,6 +316,18 @@ static int persistent_ram_init_ecc(struct persistent_ram_zone *prz,
 		prz->bad_blocks++;
 	}
 
+	if (prz->flags & PRZ_FLAG_ASYNC_ECC) {
+		/* One more bit for the header */
+		prz->ecc_dirty = bitmap_zalloc(ecc_blocks + 1, GFP_KERNEL);
+		if (!prz->ecc_dirty) {
+			pr_err("cannot allocate ECC dirty bitmap\n");
+			return -ENOMEM;
+		}
+		INIT_DELAYED_WORK(&prz->ecc_work, persistent_ram_ecc_work);
+		schedule_delayed_work(&prz->ecc_work,
+				      PERSISTENT_RAM_ECC_INTERVAL);
+	}
+
 	return 0;
 }
 
@@ -523,6 +602,12 @@ void persistent_ram_free(struct persistent_ram_zone *prz)
 	if (!prz)
 		return;
 
+	if (prz->ecc_dirty) {
+		cancel_delayed_work_sync(&prz->ecc_work);
+		bitmap_free(prz->ecc_dirty);
+		prz->ecc_dirty = NULL;
+	}
+
 	if (prz->vaddr) {
 		if (pfn_valid(prz->paddr >> PAGE_SHIFT)) {
 			/* We must vunmap() at page-granularity. */
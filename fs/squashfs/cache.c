@@ -23,25 +23,31 @@
 
 /*
  * Blocks in Squashfs are compressed.  To avoid repeatedly decompressing
- * recently accessed data Squashfs uses two small metadata and fragment caches.
+ * recently accessed data Squashfs uses a small metadata cache, and a data
+ * cache shared by fragment blocks and datablocks.
  *
  * This file implements a generic cache implementation used for both caches,
  * plus functions layered ontop of the generic cache implementation to
- * access the metadata and fragment caches.
+ * access the metadata and data caches.  Entries are found through a hash of
+ * their start block, and the least recently used unused entry is the one
+ * evicted.  The size of the data cache is set by the cache_size mount
+ * option, and can be changed at runtime through sysfs.
  *
  * To avoid out of memory and fragmentation issues with vmalloc the cache
  * uses sequences of kmalloced PAGE_SIZE buffers.
  *
- * It should be noted that the cache is not used for file datablocks, these
- * are decompressed and cached in the page-cache in the normal way.  The
- * cache is only used to temporarily cache fragment and metadata blocks
- * which have been read as as a result of a metadata (i.e. inode or
- * directory) or fragment access.  Because metadata and fragments are packed
- * together into blocks (to gain greater compression) the read of a particular
- * piece of metadata or fragment will retrieve other metadata/fragments which
- * have been packed with it, these because of locality-of-reference may be read
- * in the near future. Temporarily caching them ensures they are available for
- * near future access without requiring an additional read and decompress.
+ * File datablocks are decompressed and cached in the page-cache in the
+ * normal way, the data cache only keeps hold of the decompressed blocks
+ * read through it so that random reads, which the page-cache does not keep
+ * around, do not decompress the same blocks over and over again.
+ * Fragment and metadata blocks are read as as a result of a metadata (i.e.
+ * inode or directory) or fragment access.  Because metadata and fragments
+ * are packed together into blocks (to gain greater compression) the read of
+ * a particular piece of metadata or fragment will retrieve other
+ * metadata/fragments which have been packed with it, these because of
+ * locality-of-reference may be read in the near future. Temporarily caching
+ * them ensures they are available for near future access without requiring
+ * an additional read and decompress.
  */
 
 #include <linux/fs.h>
@@ -52,6 +58,8 @@
 #include <linux/spinlock.h>
 #include <linux/wait.h>
 #include <linux/pagemap.h>
+#include <linux/hash.h>
+#include <linux/mutex.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
@@ -65,21 +73,19 @@
 struct squashfs_cache_entry *squashfs_cache_get(struct super_block *sb,
 	struct squashfs_cache *cache, u64 block, int length)
 {
-	int i, n;
 	struct squashfs_cache_entry *entry;
+	struct hlist_head *head;
+
+	head = &cache->hash[hash_64(block, SQUASHFS_CACHE_HASH_BITS)];
 
 	spin_lock(&cache->lock);
 
 	while (1) {
-		for (i = cache->curr_blk, n = 0; n < cache->entries; n++) {
-			if (cache->entry[i].block == block) {
-				cache->curr_blk = i;
+		hlist_for_each_entry(entry, head, hash)
+			if (entry->block == block)
 				break;
-			}
-			i = (i + 1) % cache->entries;
-		}
 
-		if (n == cache->entries) {
+		if (entry == NULL) {
 			/*
 			 * Block not in cache, if all cache entries are used
 			 * go to sleep waiting for one to become available.
@@ -94,19 +100,15 @@ struct squashfs_cache_entry *squashfs_cache_get(struct super_block *sb,
 			}
 
 			/*
-			 * At least one unused cache entry.  A simple
-			 * round-robin strategy is used to choose the entry to
-			 * be evicted from the cache.
+			 * At least one unused cache entry.  The least
+			 * recently used one is evicted from the cache.
 			 */
-			i = cache->next_blk;
-			for (n = 0; n < cache->entries; n++) {
-				if (cache->entry[i].refcount == 0)
-					break;
-				i = (i + 1) % cache->entries;
-			}
-
-			cache->next_blk = (i + 1) % cache->entries;
-			entry = &cache->entry[i];
+			entry = list_first_entry(&cache->lru,
+					struct squashfs_cache_entry, lru);
+			list_del_init(&entry->lru);
+			hlist_del_init(&entry->hash);
+			hlist_add_head(&entry->hash, head);
+			cache->misses++;
 
 			/*
 			 * Initialise chosen cache entry, and fill it in from
@@ -150,9 +152,11 @@ struct squashfs_cache_entry *squashfs_cache_get(struct super_block *sb,
 		 * previously unused there's one less cache entry available
 		 * for reuse.
 		 */
-		entry = &cache->entry[i];
-		if (entry->refcount == 0)
+		cache->hits++;
+		if (entry->refcount == 0) {
+			list_del_init(&entry->lru);
 			cache->unused--;
+		}
 		entry->refcount++;
 
 		/*
@@ -170,8 +174,8 @@ struct squashfs_cache_entry *squashfs_cache_get(struct super_block *sb,
 	}
 
 out:
-	TRACE("Got %s %d, start block %lld, refcount %d, error %d\n",
-		cache->name, i, entry->block, entry->refcount, entry->error);
+	TRACE("Got %s, start block %lld, refcount %d, error %d\n",
+		cache->name, entry->block, entry->refcount, entry->error);
 
 	if (entry->error)
 		ERROR("Unable to read %s cache entry [%llx]\n", cache->name,
@@ -180,6 +184,20 @@ out:
 }
 
 
+static void squashfs_cache_entry_free(struct squashfs_cache_entry *entry)
+{
+	int i;
+
+	if (entry->data) {
+		for (i = 0; i < entry->cache->pages; i++)
+			kfree(entry->data[i]);
+		kfree(entry->data);
+	}
+	kfree(entry->actor);
+	kfree(entry);
+}
+
+
 /*
  * Release cache entry, once usage count is zero it can be reused.
  */
@@ -190,6 +208,29 @@ void squashfs_cache_put(struct squashfs_cache_entry *entry)
 	spin_lock(&cache->lock);
 	entry->refcount--;
 	if (entry->refcount == 0) {
+		/*
+		 * The cache has been shrunk while the entry was in use, drop
+		 * it rather than keeping it around.
+		 */
+		if (cache->allocated > cache->entries) {
+			hlist_del_init(&entry->hash);
+			cache->allocated--;
+			spin_unlock(&cache->lock);
+			squashfs_cache_entry_free(entry);
+			return;
+		}
+
+		/*
+		 * Failed reads are not cached, the next look-up retries
+		 * them.  Their entry is the first to be reused.
+		 */
+		if (entry->error) {
+			hlist_del_init(&entry->hash);
+			entry->block = SQUASHFS_INVALID_BLK;
+			list_add(&entry->lru, &cache->lru);
+		} else
+			list_add_tail(&entry->lru, &cache->lru);
+
 		cache->unused++;
 		/*
 		 * If there's any processes waiting for a block to become
@@ -204,39 +245,130 @@ void squashfs_cache_put(struct squashfs_cache_entry *entry)
 	spin_unlock(&cache->lock);
 }
 
+
+/*
+ * Allocate a cache entry of block_size.  To avoid vmalloc fragmentation
+ * issues each entry is allocated as a sequence of kmalloced PAGE_SIZE
+ * buffers.
+ */
+static struct squashfs_cache_entry *
+squashfs_cache_entry_alloc(struct squashfs_cache *cache)
+{
+	struct squashfs_cache_entry *entry;
+	int i;
+
+	entry = kzalloc(sizeof(*entry), GFP_KERNEL);
+	if (entry == NULL)
+		return NULL;
+
+	init_waitqueue_head(&entry->wait_queue);
+	INIT_HLIST_NODE(&entry->hash);
+	entry->cache = cache;
+	entry->block = SQUASHFS_INVALID_BLK;
+	entry->data = kcalloc(cache->pages, sizeof(void *), GFP_KERNEL);
+	if (entry->data == NULL)
+		goto cleanup;
+
+	for (i = 0; i < cache->pages; i++) {
+		entry->data[i] = kmalloc(PAGE_SIZE, GFP_KERNEL);
+		if (entry->data[i] == NULL)
+			goto cleanup;
+	}
+
+	entry->actor = squashfs_page_actor_init(entry->data, cache->pages, 0);
+	if (entry->actor == NULL)
+		goto cleanup;
+
+	return entry;
+
+cleanup:
+	squashfs_cache_entry_free(entry);
+	return NULL;
+}
+
+
+/*
+ * Change the number of entries of the cache.  Growing the cache allocates the
+ * new entries straight away, when shrinking it the unused entries are freed
+ * now and the ones in use once they are released.
+ */
+int squashfs_cache_resize(struct squashfs_cache *cache, int entries)
+{
+	struct squashfs_cache_entry *entry, *next;
+	LIST_HEAD(list);
+	int err = 0;
+
+	if (entries < 1)
+		return -EINVAL;
+
+	mutex_lock(&cache->resize_mutex);
+
+	while (cache->allocated < entries) {
+		entry = squashfs_cache_entry_alloc(cache);
+		if (entry == NULL) {
+			err = -ENOMEM;
+			break;
+		}
+
+		spin_lock(&cache->lock);
+		list_add(&entry->lru, &cache->lru);
+		cache->unused++;
+		cache->allocated++;
+		cache->entries = cache->allocated;
+		spin_unlock(&cache->lock);
+
+		if (cache->num_waiters)
+			wake_up(&cache->wait_queue);
+	}
+
+	spin_lock(&cache->lock);
+	if (!err)
+		cache->entries = entries;
+	while (cache->allocated > cache->entries && cache->unused) {
+		entry = list_first_entry(&cache->lru,
+				struct squashfs_cache_entry, lru);
+		list_move(&entry->lru, &list);
+		hlist_del_init(&entry->hash);
+		cache->unused--;
+		cache->allocated--;
+	}
+	spin_unlock(&cache->lock);
+
+	mutex_unlock(&cache->resize_mutex);
+
+	list_for_each_entry_safe(entry, next, &list, lru)
+		squashfs_cache_entry_free(entry);
+
+	return err;
+}
+
+
 /*
  * Delete cache reclaiming all kmalloced buffers.
  */
 void squashfs_cache_delete(struct squashfs_cache *cache)
 {
-	int i, j;
+	struct squashfs_cache_entry *entry, *next;
 
 	if (cache == NULL)
 		return;
 
-	for (i = 0; i < cache->entries; i++) {
-		if (cache->entry[i].data) {
-			for (j = 0; j < cache->pages; j++)
-				kfree(cache->entry[i].data[j]);
-			kfree(cache->entry[i].data);
-		}
-		kfree(cache->entry[i].actor);
-	}
+	list_for_each_entry_safe(entry, next, &cache->lru, lru)
+		squashfs_cache_entry_free(entry);
 
-	kfree(cache->entry);
+	kfree(cache->hash);
 	kfree(cache);
 }
 
 
 /*
  * Initialise cache allocating the specified number of entries, each of
- * size block_size.  To avoid vmalloc fragmentation issues each entry
- * is allocated as a sequence of kmalloced PAGE_SIZE buffers.
+ * size block_size.  Entries are looked up through a hash of their start
+ * block, and evicted in least recently used order.
  */
 struct squashfs_cache *squashfs_cache_init(char *name, int entries,
 	int block_size)
 {
-	int i, j;
 	struct squashfs_cache *cache = kzalloc(sizeof(*cache), GFP_KERNEL);
 
 	if (cache == NULL) {
@@ -244,50 +376,26 @@ struct squashfs_cache *squashfs_cache_init(char *name, int entries,
 		return NULL;
 	}
 
-	cache->entry = kcalloc(entries, sizeof(*(cache->entry)), GFP_KERNEL);
-	if (cache->entry == NULL) {
+	cache->hash = kcalloc(1 << SQUASHFS_CACHE_HASH_BITS,
+		sizeof(*cache->hash), GFP_KERNEL);
+	if (cache->hash == NULL) {
 		ERROR("Failed to allocate %s cache\n", name);
 		goto cleanup;
 	}
 
-	cache->curr_blk = 0;
-	cache->next_blk = 0;
-	cache->unused = entries;
-	cache->entries = entries;
 	cache->block_size = block_size;
 	cache->pages = block_size >> PAGE_SHIFT;
 	cache->pages = cache->pages ? cache->pages : 1;
 	cache->name = name;
 	cache->num_waiters = 0;
 	spin_lock_init(&cache->lock);
+	mutex_init(&cache->resize_mutex);
 	init_waitqueue_head(&cache->wait_queue);
+	INIT_LIST_HEAD(&cache->lru);
 
-	for (i = 0; i < entries; i++) {
-		struct squashfs_cache_entry *entry = &cache->entry[i];
-
-		init_waitqueue_head(&cache->entry[i].wait_queue);
-		entry->cache = cache;
-		entry->block = SQUASHFS_INVALID_BLK;
-		entry->data = kcalloc(cache->pages, sizeof(void *), GFP_KERNEL);
-		if (entry->data == NULL) {
-			ERROR("Failed to allocate %s cache entry\n", name);
-			goto cleanup;
-		}
-
-		for (j = 0; j < cache->pages; j++) {
-			entry->data[j] = kmalloc(PAGE_SIZE, GFP_KERNEL);
-			if (entry->data[j] == NULL) {
-				ERROR("Failed to allocate %s buffer\n", name);
-				goto cleanup;
-			}
-		}
-
-		entry->actor = squashfs_page_actor_init(entry->data,
-						cache->pages, 0);
-		if (entry->actor == NULL) {
-			ERROR("Failed to allocate %s cache entry\n", name);
-			goto cleanup;
-		}
+	if (squashfs_cache_resize(cache, entries)) {
+		ERROR("Failed to allocate %s cache entry\n", name);
+		goto cleanup;
 	}
 
 	return cache;
@@ -394,8 +502,7 @@ struct squashfs_cache_entry *squashfs_get_fragment(struct super_block *sb,
 {
 	struct squashfs_sb_info *msblk = sb->s_fs_info;
 
-	return squashfs_cache_get(sb, msblk->fragment_cache, start_block,
-		length);
+	return squashfs_cache_get(sb, msblk->data_cache, start_block, length);
 }
 
 
@@ -409,7 +516,7 @@ struct squashfs_cache_entry *squashfs_get_datablock(struct super_block *sb,
 {
 	struct squashfs_sb_info *msblk = sb->s_fs_info;
 
-	return squashfs_cache_get(sb, msblk->read_page, start_block, length);
+	return squashfs_cache_get(sb, msblk->data_cache, start_block, length);
 }
 
 
@@ -33,6 +33,7 @@ struct squashfs_decompressor {
 	int	id;
 	char	*name;
 	int	supported;
+	int	contig;
 };
 
 static inline void *squashfs_comp_opts(struct squashfs_sb_info *msblk,
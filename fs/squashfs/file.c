@@ -47,6 +47,7 @@
 #include <linux/string.h>
 #include <linux/pagemap.h>
 #include <linux/mutex.h>
+#include <linux/workqueue.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
@@ -507,7 +508,95 @@ out:
 	return 0;
 }
 
+/*
+ * Readahead. Each datablock of the readahead window is read by its own
+ * work item, so that the block I/O of the window is in flight at once
+ * and the blocks are decompressed in parallel, using the decompressor of
+ * whichever CPU the work item runs on. squashfs_readpage() of the first
+ * page of a block fills the whole block into the page cache, so only
+ * that page is added here and the others are left for it to grab.
+ */
+static struct workqueue_struct *squashfs_read_wq;
+
+struct squashfs_read_work {
+	struct work_struct work;
+	struct page *page;
+};
+
+static void squashfs_read_work_fn(struct work_struct *work)
+{
+	struct squashfs_read_work *rw = container_of(work,
+					struct squashfs_read_work, work);
+
+	squashfs_readpage(NULL, rw->page);
+	put_page(rw->page);
+	kfree(rw);
+}
+
+static int squashfs_readpages(struct file *file, struct address_space *mapping,
+	struct list_head *pages, unsigned int nr_pages)
+{
+	struct inode *inode = mapping->host;
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	int shift = msblk->block_log - PAGE_SHIFT;
+	bool parallel = squashfs_max_decompressors() > 1;
+
+	while (!list_empty(pages)) {
+		struct page *page = lru_to_page(pages);
+		struct squashfs_read_work *rw;
+
+		list_del(&page->lru);
+
+		/*
+		 * One page reads the whole block, so drop the other pages of
+		 * the block, but keep the one carrying the readahead marker.
+		 */
+		while (!list_empty(pages)) {
+			struct page *next = lru_to_page(pages);
+
+			if (next->index >> shift != page->index >> shift)
+				break;
+
+			list_del(&next->lru);
+			if (PageReadahead(next))
+				swap(page, next);
+			put_page(next);
+		}
+
+		if (add_to_page_cache_lru(page, mapping, page->index,
+				readahead_gfp_mask(mapping)))
+			goto next;
+
+		rw = parallel ? kmalloc(sizeof(*rw), GFP_NOFS) : NULL;
+		if (!rw) {
+			squashfs_readpage(file, page);
+			goto next;
+		}
+
+		INIT_WORK(&rw->work, squashfs_read_work_fn);
+		rw->page = page;
+		queue_work(squashfs_read_wq, &rw->work);
+		continue;
+next:
+		put_page(page);
+	}
+
+	return 0;
+}
+
+int __init squashfs_readahead_init(void)
+{
+	squashfs_read_wq = alloc_workqueue("squashfs_read", WQ_UNBOUND, 0);
+
+	return squashfs_read_wq ? 0 : -ENOMEM;
+}
+
+void squashfs_readahead_exit(void)
+{
+	destroy_workqueue(squashfs_read_wq);
+}
 
 const struct address_space_operations squashfs_aops = {
-	.readpage = squashfs_readpage
+	.readpage = squashfs_readpage,
+	.readpages = squashfs_readpages
 };
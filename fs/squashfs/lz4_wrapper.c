@@ -96,6 +96,7 @@ static int lz4_uncompress(struct squashfs_sb_info *msblk, void *strm,
 {
 	struct squashfs_lz4 *stream = strm;
 	void *buff = stream->input, *data;
+	void *contig = squashfs_actor_contig(output);
 	int avail, i, bytes = length, res;
 
 	for (i = 0; i < b; i++) {
@@ -107,12 +108,16 @@ static int lz4_uncompress(struct squashfs_sb_info *msblk, void *strm,
 		put_bh(bh[i]);
 	}
 
-	res = LZ4_decompress_safe(stream->input, stream->output,
+	/* Decompress straight into the mapped pages if possible */
+	res = LZ4_decompress_safe(stream->input, contig ? : stream->output,
 		length, output->length);
 
 	if (res < 0)
 		return -EIO;
 
+	if (contig)
+		return res;
+
 	bytes = res;
 	data = squashfs_first_page(output);
 	buff = stream->output;
@@ -138,5 +143,6 @@ const struct squashfs_decompressor squashfs_lz4_comp_ops = {
 	.decompress = lz4_uncompress,
 	.id = LZ4_COMPRESSION,
 	.name = "lz4",
-	.supported = 1
+	.supported = 1,
+	.contig = 1
 };
@@ -9,6 +9,8 @@
 #include <linux/kernel.h>
 #include <linux/slab.h>
 #include <linux/pagemap.h>
+#include <linux/vmalloc.h>
+#include <linux/highmem.h>
 #include "page_actor.h"
 
 /*
@@ -52,6 +54,7 @@ struct squashfs_page_actor *squashfs_page_actor_init(void **buffer,
 	actor->buffer = buffer;
 	actor->pages = pages;
 	actor->next_page = 0;
+	actor->contig = NULL;
 	actor->squashfs_first_page = cache_first_page;
 	actor->squashfs_next_page = cache_next_page;
 	actor->squashfs_finish_page = cache_finish_page;
@@ -93,8 +96,32 @@ struct squashfs_page_actor *squashfs_page_actor_init_special(struct page **page,
 	actor->pages = pages;
 	actor->next_page = 0;
 	actor->pageaddr = NULL;
+	actor->contig = NULL;
 	actor->squashfs_first_page = direct_first_page;
 	actor->squashfs_next_page = direct_next_page;
 	actor->squashfs_finish_page = direct_finish_page;
 	return actor;
 }
+
+/*
+ * Map the page cache pages of the actor virtually contiguously, so that
+ * decompressors which can write the whole block in one go, rather than
+ * page by page through a bounce buffer, do so.  This may sleep, and so
+ * must be done before squashfs_read_data().  Failing to map the pages is
+ * not an error, the page by page interface is used instead.
+ */
+void squashfs_page_actor_map(struct squashfs_page_actor *actor)
+{
+	actor->contig = vm_map_ram(actor->page, actor->pages, NUMA_NO_NODE,
+		PAGE_KERNEL);
+}
+
+void squashfs_page_actor_unmap(struct squashfs_page_actor *actor)
+{
+	if (actor->contig == NULL)
+		return;
+
+	flush_kernel_vmap_range(actor->contig, actor->pages * PAGE_SIZE);
+	vm_unmap_ram(actor->contig, actor->pages);
+	actor->contig = NULL;
+}
@@ -47,6 +47,11 @@ static inline void squashfs_finish_page(struct squashfs_page_actor *actor)
 {
 	/* empty */
 }
+
+static inline void *squashfs_actor_contig(struct squashfs_page_actor *actor)
+{
+	return NULL;
+}
 #else
 struct squashfs_page_actor {
 	union {
@@ -54,6 +59,7 @@ struct squashfs_page_actor {
 		struct page	**page;
 	};
 	void	*pageaddr;
+	void	*contig;
 	void    *(*squashfs_first_page)(struct squashfs_page_actor *);
 	void    *(*squashfs_next_page)(struct squashfs_page_actor *);
 	void    (*squashfs_finish_page)(struct squashfs_page_actor *);
@@ -65,6 +71,8 @@ struct squashfs_page_actor {
 extern struct squashfs_page_actor *squashfs_page_actor_init(void **, int, int);
 extern struct squashfs_page_actor *squashfs_page_actor_init_special(struct page
 							 **, int, int);
+extern void squashfs_page_actor_map(struct squashfs_page_actor *);
+extern void squashfs_page_actor_unmap(struct squashfs_page_actor *);
 static inline void *squashfs_first_page(struct squashfs_page_actor *actor)
 {
 	return actor->squashfs_first_page(actor);
@@ -77,5 +85,14 @@ static inline void squashfs_finish_page(struct squashfs_page_actor *actor)
 {
 	actor->squashfs_finish_page(actor);
 }
+
+/*
+ * Returns the whole output as one virtually contiguous buffer of
+ * actor->length bytes if it has been mapped that way, NULL otherwise.
+ */
+static inline void *squashfs_actor_contig(struct squashfs_page_actor *actor)
+{
+	return actor->contig;
+}
 #endif
 #endif
@@ -215,6 +215,8 @@ static inline int squashfs_block_size(__le32 raw)
 
 /* cached data constants for filesystem */
 #define SQUASHFS_CACHED_BLKS		8
+#define SQUASHFS_CACHE_HASH_BITS	8
+#define SQUASHFS_CACHE_MAX_BLKS		65536
 
 /* meta index cache */
 #define SQUASHFS_META_INDEXES	(SQUASHFS_METADATA_SIZE / sizeof(unsigned int))
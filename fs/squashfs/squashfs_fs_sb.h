@@ -23,23 +23,31 @@
  * squashfs_fs_sb.h
  */
 
+#include <linux/kobject.h>
+#include <linux/completion.h>
+
 #include "squashfs_fs.h"
 
 struct squashfs_cache {
 	char			*name;
 	int			entries;
-	int			curr_blk;
-	int			next_blk;
+	int			allocated;
 	int			num_waiters;
 	int			unused;
 	int			block_size;
 	int			pages;
+	unsigned long		hits;
+	unsigned long		misses;
 	spinlock_t		lock;
+	struct mutex		resize_mutex;
 	wait_queue_head_t	wait_queue;
-	struct squashfs_cache_entry *entry;
+	struct hlist_head	*hash;
+	struct list_head	lru;
 };
 
 struct squashfs_cache_entry {
+	struct hlist_node	hash;
+	struct list_head	lru;
 	u64			block;
 	int			length;
 	int			refcount;
@@ -58,8 +66,10 @@ struct squashfs_sb_info {
 	int					devblksize;
 	int					devblksize_log2;
 	struct squashfs_cache			*block_cache;
-	struct squashfs_cache			*fragment_cache;
-	struct squashfs_cache			*read_page;
+	struct squashfs_cache			*data_cache;
+	int					cache_size;
+	struct kobject				s_kobj;
+	struct completion			s_kobj_unregister;
 	int					next_meta_index;
 	__le64					*id_table;
 	__le64					*fragment_index;
@@ -38,6 +38,8 @@
 #include <linux/module.h>
 #include <linux/magic.h>
 #include <linux/xattr.h>
+#include <linux/parser.h>
+#include <linux/seq_file.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
@@ -49,6 +51,56 @@
 static struct file_system_type squashfs_fs_type;
 static const struct super_operations squashfs_super_ops;
 
+enum {
+	Opt_cache_size, Opt_err
+};
+
+static const match_table_t squashfs_tokens = {
+	{Opt_cache_size, "cache_size=%d"},
+	{Opt_err, NULL}
+};
+
+/*
+ * By default the data cache holds as many blocks as there are cached
+ * fragments, plus one per decompressor for datablocks.
+ */
+static int squashfs_default_cache_size(void)
+{
+	return SQUASHFS_CACHED_FRAGMENTS + squashfs_max_decompressors();
+}
+
+static int squashfs_parse_options(char *options, int *cache_size)
+{
+	substring_t args[MAX_OPT_ARGS];
+	char *p;
+	int option;
+
+	if (!options)
+		return 0;
+
+	while ((p = strsep(&options, ",")) != NULL) {
+		if (!*p)
+			continue;
+
+		switch (match_token(p, squashfs_tokens, args)) {
+		case Opt_cache_size:
+			if (match_int(&args[0], &option) || option < 1 ||
+					option > SQUASHFS_CACHE_MAX_BLKS) {
+				ERROR("Invalid cache_size \"%s\"\n", p);
+				return -EINVAL;
+			}
+			*cache_size = option;
+			break;
+		default:
+			ERROR("Unrecognized mount option \"%s\"\n", p);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+
 static const struct squashfs_decompressor *supported_squashfs_filesystem(short
 	major, short minor, short id)
 {
@@ -101,6 +153,11 @@ static int squashfs_fill_super(struct super_block *sb, void *data, int silent)
 
 	mutex_init(&msblk->meta_index_mutex);
 
+	msblk->cache_size = squashfs_default_cache_size();
+	err = squashfs_parse_options(data, &msblk->cache_size);
+	if (err)
+		goto failed_mount;
+
 	/*
 	 * msblk->bytes_used is checked in squashfs_read_table to ensure reads
 	 * are not beyond filesystem end.  But as we're using
@@ -206,11 +263,11 @@ static int squashfs_fill_super(struct super_block *sb, void *data, int silent)
 	if (msblk->block_cache == NULL)
 		goto failed_mount;
 
-	/* Allocate read_page block */
-	msblk->read_page = squashfs_cache_init("data",
-		squashfs_max_decompressors(), msblk->block_size);
-	if (msblk->read_page == NULL) {
-		ERROR("Failed to allocate read_page block\n");
+	/* Allocate the data cache, shared by fragments and datablocks */
+	msblk->data_cache = squashfs_cache_init("data", msblk->cache_size,
+		msblk->block_size);
+	if (msblk->data_cache == NULL) {
+		ERROR("Failed to allocate data cache\n");
 		goto failed_mount;
 	}
 
@@ -277,13 +334,6 @@ handle_fragments:
 	if (fragments == 0)
 		goto check_directory_table;
 
-	msblk->fragment_cache = squashfs_cache_init("fragment",
-		SQUASHFS_CACHED_FRAGMENTS, msblk->block_size);
-	if (msblk->fragment_cache == NULL) {
-		err = -ENOMEM;
-		goto failed_mount;
-	}
-
 	/* Allocate and read fragment index table */
 	msblk->fragment_index = squashfs_read_fragment_index_table(sb,
 		le64_to_cpu(sblk->fragment_table_start), next_table, fragments);
@@ -308,18 +358,22 @@ check_directory_table:
 		goto failed_mount;
 	}
 
+	err = squashfs_register_sysfs(sb);
+	if (err)
+		goto failed_mount;
+
 	/* allocate root */
 	root = new_inode(sb);
 	if (!root) {
 		err = -ENOMEM;
-		goto failed_mount;
+		goto failed_sysfs;
 	}
 
 	err = squashfs_read_inode(root, root_inode);
 	if (err) {
 		make_bad_inode(root);
 		iput(root);
-		goto failed_mount;
+		goto failed_sysfs;
 	}
 	insert_inode_hash(root);
 
@@ -327,17 +381,18 @@ check_directory_table:
 	if (sb->s_root == NULL) {
 		ERROR("Root inode create failed\n");
 		err = -ENOMEM;
-		goto failed_mount;
+		goto failed_sysfs;
 	}
 
 	TRACE("Leaving squashfs_fill_super\n");
 	kfree(sblk);
 	return 0;
 
+failed_sysfs:
+	squashfs_unregister_sysfs(sb);
 failed_mount:
 	squashfs_cache_delete(msblk->block_cache);
-	squashfs_cache_delete(msblk->fragment_cache);
-	squashfs_cache_delete(msblk->read_page);
+	squashfs_cache_delete(msblk->data_cache);
 	squashfs_decompressor_destroy(msblk);
 	kfree(msblk->inode_lookup_table);
 	kfree(msblk->fragment_index);
@@ -373,8 +428,35 @@ static int squashfs_statfs(struct dentry *dentry, struct kstatfs *buf)
 
 static int squashfs_remount(struct super_block *sb, int *flags, char *data)
 {
+	struct squashfs_sb_info *msblk = sb->s_fs_info;
+	int cache_size = msblk->cache_size;
+	int err;
+
 	sync_filesystem(sb);
 	*flags |= SB_RDONLY;
+
+	err = squashfs_parse_options(data, &cache_size);
+	if (err)
+		return err;
+
+	if (cache_size != msblk->cache_size) {
+		err = squashfs_cache_resize(msblk->data_cache, cache_size);
+		if (err)
+			return err;
+		msblk->cache_size = cache_size;
+	}
+
+	return 0;
+}
+
+
+static int squashfs_show_options(struct seq_file *s, struct dentry *root)
+{
+	struct squashfs_sb_info *msblk = root->d_sb->s_fs_info;
+
+	if (msblk->cache_size != squashfs_default_cache_size())
+		seq_printf(s, ",cache_size=%d", msblk->cache_size);
+
 	return 0;
 }
 
@@ -383,9 +465,9 @@ static void squashfs_put_super(struct super_block *sb)
 {
 	if (sb->s_fs_info) {
 		struct squashfs_sb_info *sbi = sb->s_fs_info;
+		squashfs_unregister_sysfs(sb);
 		squashfs_cache_delete(sbi->block_cache);
-		squashfs_cache_delete(sbi->fragment_cache);
-		squashfs_cache_delete(sbi->read_page);
+		squashfs_cache_delete(sbi->data_cache);
 		squashfs_decompressor_destroy(sbi);
 		kfree(sbi->id_table);
 		kfree(sbi->fragment_index);
@@ -445,8 +527,23 @@ static int __init init_squashfs_fs(void)
 	if (err)
 		return err;
 
+	err = squashfs_readahead_init();
+	if (err) {
+		destroy_inodecache();
+		return err;
+	}
+
+	err = squashfs_sysfs_init();
+	if (err) {
+		squashfs_readahead_exit();
+		destroy_inodecache();
+		return err;
+	}
+
 	err = register_filesystem(&squashfs_fs_type);
 	if (err) {
+		squashfs_sysfs_exit();
+		squashfs_readahead_exit();
 		destroy_inodecache();
 		return err;
 	}
@@ -460,6 +557,8 @@ static int __init init_squashfs_fs(void)
 static void __exit exit_squashfs_fs(void)
 {
 	unregister_filesystem(&squashfs_fs_type);
+	squashfs_sysfs_exit();
+	squashfs_readahead_exit();
 	destroy_inodecache();
 }
 
@@ -499,7 +598,8 @@ static const struct super_operations squashfs_super_ops = {
 	.destroy_inode = squashfs_destroy_inode,
 	.statfs = squashfs_statfs,
 	.put_super = squashfs_put_super,
-	.remount_fs = squashfs_remount
+	.remount_fs = squashfs_remount,
+	.show_options = squashfs_show_options
 };
 
 module_init(init_squashfs_fs);
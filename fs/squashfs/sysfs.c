@@ -0,0 +1,179 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Squashfs - a compressed read only filesystem for Linux
+ *
+ * sysfs.c
+ */
+
+/*
+ * This file implements the /sys/fs/squashfs/<disk> directory of each mounted
+ * filesystem, which reports the hit and miss counts of the caches and allows
+ * the data cache to be resized.
+ */
+
+#include <linux/fs.h>
+#include <linux/kobject.h>
+#include <linux/slab.h>
+#include <linux/sysfs.h>
+
+#include "squashfs_fs.h"
+#include "squashfs_fs_sb.h"
+#include "squashfs.h"
+
+struct squashfs_attr {
+	struct attribute attr;
+	ssize_t (*show)(struct squashfs_sb_info *, char *);
+	ssize_t (*store)(struct squashfs_sb_info *, const char *, size_t);
+};
+
+static struct kset *squashfs_kset;
+
+static ssize_t cache_stat_show(struct squashfs_cache *cache, char *buf)
+{
+	unsigned long hits, misses;
+
+	spin_lock(&cache->lock);
+	hits = cache->hits;
+	misses = cache->misses;
+	spin_unlock(&cache->lock);
+
+	return sprintf(buf, "%lu %lu\n", hits, misses);
+}
+
+static ssize_t cache_size_show(struct squashfs_sb_info *msblk, char *buf)
+{
+	return sprintf(buf, "%d\n", READ_ONCE(msblk->data_cache->entries));
+}
+
+static ssize_t cache_size_store(struct squashfs_sb_info *msblk,
+	const char *buf, size_t len)
+{
+	unsigned int entries;
+	int err;
+
+	err = kstrtouint(buf, 0, &entries);
+	if (err)
+		return err;
+
+	if (entries > SQUASHFS_CACHE_MAX_BLKS)
+		return -EINVAL;
+
+	err = squashfs_cache_resize(msblk->data_cache, entries);
+	if (err)
+		return err;
+
+	msblk->cache_size = entries;
+	return len;
+}
+
+static ssize_t cache_stat_data_show(struct squashfs_sb_info *msblk, char *buf)
+{
+	return cache_stat_show(msblk->data_cache, buf);
+}
+
+static ssize_t cache_stat_metadata_show(struct squashfs_sb_info *msblk,
+	char *buf)
+{
+	return cache_stat_show(msblk->block_cache, buf);
+}
+
+#define SQUASHFS_ATTR(_name, _mode, _show, _store)			\
+static struct squashfs_attr squashfs_attr_##_name = {			\
+	.attr = { .name = __stringify(_name), .mode = _mode },		\
+	.show = _show,							\
+	.store = _store,						\
+}
+
+SQUASHFS_ATTR(cache_size, 0644, cache_size_show, cache_size_store);
+SQUASHFS_ATTR(data_cache_stat, 0444, cache_stat_data_show, NULL);
+SQUASHFS_ATTR(metadata_cache_stat, 0444, cache_stat_metadata_show, NULL);
+
+static struct attribute *squashfs_attrs[] = {
+	&squashfs_attr_cache_size.attr,
+	&squashfs_attr_data_cache_stat.attr,
+	&squashfs_attr_metadata_cache_stat.attr,
+	NULL,
+};
+
+static ssize_t squashfs_attr_show(struct kobject *kobj,
+	struct attribute *attr, char *buf)
+{
+	struct squashfs_sb_info *msblk = container_of(kobj,
+					struct squashfs_sb_info, s_kobj);
+	struct squashfs_attr *a = container_of(attr, struct squashfs_attr,
+					attr);
+
+	return a->show ? a->show(msblk, buf) : 0;
+}
+
+static ssize_t squashfs_attr_store(struct kobject *kobj,
+	struct attribute *attr, const char *buf, size_t len)
+{
+	struct squashfs_sb_info *msblk = container_of(kobj,
+					struct squashfs_sb_info, s_kobj);
+	struct squashfs_attr *a = container_of(attr, struct squashfs_attr,
+					attr);
+
+	return a->store ? a->store(msblk, buf, len) : -EPERM;
+}
+
+static void squashfs_sb_release(struct kobject *kobj)
+{
+	struct squashfs_sb_info *msblk = container_of(kobj,
+					struct squashfs_sb_info, s_kobj);
+
+	complete(&msblk->s_kobj_unregister);
+}
+
+static const struct sysfs_ops squashfs_attr_ops = {
+	.show	= squashfs_attr_show,
+	.store	= squashfs_attr_store,
+};
+
+static struct kobj_type squashfs_sb_ktype = {
+	.default_attrs	= squashfs_attrs,
+	.sysfs_ops	= &squashfs_attr_ops,
+	.release	= squashfs_sb_release,
+};
+
+int squashfs_register_sysfs(struct super_block *sb)
+{
+	struct squashfs_sb_info *msblk = sb->s_fs_info;
+	int err;
+
+	msblk->s_kobj.kset = squashfs_kset;
+	init_completion(&msblk->s_kobj_unregister);
+	err = kobject_init_and_add(&msblk->s_kobj, &squashfs_sb_ktype, NULL,
+				"%s", sb->s_id);
+	if (err) {
+		kobject_put(&msblk->s_kobj);
+		wait_for_completion(&msblk->s_kobj_unregister);
+	}
+
+	return err;
+}
+
+/*
+ * Waits for the last reference to the kobject to go, so that the caches can
+ * be freed afterwards.
+ */
+void squashfs_unregister_sysfs(struct super_block *sb)
+{
+	struct squashfs_sb_info *msblk = sb->s_fs_info;
+
+	kobject_del(&msblk->s_kobj);
+	kobject_put(&msblk->s_kobj);
+	wait_for_completion(&msblk->s_kobj_unregister);
+}
+
+int __init squashfs_sysfs_init(void)
+{
+	squashfs_kset = kset_create_and_add("squashfs", NULL, fs_kobj);
+
+	return squashfs_kset ? 0 : -ENOMEM;
+}
+
+void squashfs_sysfs_exit(void)
+{
+	kset_unregister(squashfs_kset);
+}
@@ -33,25 +33,34 @@ struct workspace {
 	void *mem;
 	size_t mem_size;
 	size_t window_size;
+	void *input;
 };
 
 static void *zstd_init(struct squashfs_sb_info *msblk, void *buff)
 {
-	struct workspace *wksp = kmalloc(sizeof(*wksp), GFP_KERNEL);
+	struct workspace *wksp = kzalloc(sizeof(*wksp), GFP_KERNEL);
 
 	if (wksp == NULL)
 		goto failed;
 	wksp->window_size = max_t(size_t,
 			msblk->block_size, SQUASHFS_METADATA_SIZE);
-	wksp->mem_size = ZSTD_DStreamWorkspaceBound(wksp->window_size);
+	wksp->mem_size = max(ZSTD_DStreamWorkspaceBound(wksp->window_size),
+			ZSTD_DCtxWorkspaceBound());
 	wksp->mem = vmalloc(wksp->mem_size);
 	if (wksp->mem == NULL)
 		goto failed;
 
+	/* Contiguous copy of the compressed block for the one-shot path */
+	wksp->input = vmalloc(wksp->window_size);
+	if (wksp->input == NULL)
+		goto failed;
+
 	return wksp;
 
 failed:
 	ERROR("Failed to allocate zstd workspace\n");
+	if (wksp)
+		vfree(wksp->mem);
 	kfree(wksp);
 	return ERR_PTR(-ENOMEM);
 }
@@ -61,12 +70,55 @@ static void zstd_free(void *strm)
 {
 	struct workspace *wksp = strm;
 
-	if (wksp)
+	if (wksp) {
 		vfree(wksp->mem);
+		vfree(wksp->input);
+	}
 	kfree(wksp);
 }
 
 
+/*
+ * The output is one contiguous buffer, decompress the whole frame in one
+ * go.  Unlike the streaming interface this decodes straight into the output
+ * rather than through the window buffer of the stream.
+ */
+static int zstd_uncompress_contig(struct squashfs_sb_info *msblk,
+	struct workspace *wksp, struct buffer_head **bh, int b, int offset,
+	int length, void *contig, int size)
+{
+	ZSTD_DCtx *ctx;
+	void *buff = wksp->input;
+	size_t res;
+	int avail, i;
+
+	for (i = 0; i < b; i++) {
+		avail = min(length, msblk->devblksize - offset);
+		memcpy(buff, bh[i]->b_data + offset, avail);
+		buff += avail;
+		length -= avail;
+		offset = 0;
+		put_bh(bh[i]);
+	}
+
+	ctx = ZSTD_initDCtx(wksp->mem, wksp->mem_size);
+	if (!ctx) {
+		ERROR("Failed to initialize zstd decompressor\n");
+		return -EIO;
+	}
+
+	res = ZSTD_decompressDCtx(ctx, contig, size, wksp->input,
+		buff - wksp->input);
+	if (ZSTD_isError(res)) {
+		ERROR("zstd decompression error: %d\n",
+				(int)ZSTD_getErrorCode(res));
+		return -EIO;
+	}
+
+	return (int)res;
+}
+
+
 static int zstd_uncompress(struct squashfs_sb_info *msblk, void *strm,
 	struct buffer_head **bh, int b, int offset, int length,
 	struct squashfs_page_actor *output)
@@ -78,6 +130,11 @@ static int zstd_uncompress(struct squashfs_sb_info *msblk, void *strm,
 	int k = 0;
 	ZSTD_inBuffer in_buf = { NULL, 0, 0 };
 	ZSTD_outBuffer out_buf = { NULL, 0, 0 };
+	void *contig = squashfs_actor_contig(output);
+
+	if (contig)
+		return zstd_uncompress_contig(msblk, wksp, bh, b, offset,
+			length, contig, output->length);
 
 	stream = ZSTD_initDStream(wksp->window_size, wksp->mem, wksp->mem_size);
 
@@ -147,5 +204,6 @@ const struct squashfs_decompressor squashfs_zstd_comp_ops = {
 	.decompress = zstd_uncompress,
 	.id = ZSTD_COMPRESSION,
 	.name = "zstd",
-	.supported = 1
+	.supported = 1,
+	.contig = 1
 };
@@ -166,6 +166,13 @@ struct shash_desc {
  * @export: see struct ahash_alg
  * @import: see struct ahash_alg
  * @setkey: see struct ahash_alg
+ * @finup_mb: Optional. Finishes @num_msgs messages of @len bytes each, all
+ *	      continuing from the state in @desc, and stores their digests in
+ *	      @outs. The state in @desc is left untouched. Only called with
+ *	      1 < @num_msgs <= @mb_max_msgs. Implemented by drivers which can
+ *	      interleave the computations for a throughput gain.
+ * @mb_max_msgs: Maximum number of messages @finup_mb can take at once, or 0
+ *		 if @finup_mb is not implemented.
  * @digestsize: see struct ahash_alg
  * @statesize: see struct ahash_alg
  * @descsize: Size of the operational state for the message digest. This state
@@ -186,7 +193,11 @@ struct shash_alg {
 	int (*import)(struct shash_desc *desc, const void *in);
 	int (*setkey)(struct crypto_shash *tfm, const u8 *key,
 		      unsigned int keylen);
+	int (*finup_mb)(struct shash_desc *desc, const u8 * const data[],
+			unsigned int len, u8 * const outs[],
+			unsigned int num_msgs);
 
+	unsigned int mb_max_msgs;
 	unsigned int descsize;
 
 	/* These fields must match hash_alg_common. */
@@ -933,6 +944,82 @@ int crypto_shash_final(struct shash_desc *desc, u8 *out);
 int crypto_shash_finup(struct shash_desc *desc, const u8 *data,
 		       unsigned int len, u8 *out);
 
+/**
+ * crypto_shash_mb_max_msgs() - maximum number of messages for finup_mb
+ * @tfm: hash transformation object
+ *
+ * Return: the number of messages crypto_shash_finup_mb() can compute in one
+ *	   interleaved pass; 1 if the algorithm has no multibuffer support
+ */
+static inline unsigned int crypto_shash_mb_max_msgs(struct crypto_shash *tfm)
+{
+	return crypto_shash_alg(tfm)->mb_max_msgs ?: 1;
+}
+
+/**
+ * crypto_shash_finup_mb_fallback() - finish several messages one at a time
+ * @desc: see crypto_shash_finup_mb()
+ * @data: see crypto_shash_finup_mb()
+ * @len: see crypto_shash_finup_mb()
+ * @outs: see crypto_shash_finup_mb()
+ * @num_msgs: see crypto_shash_finup_mb()
+ *
+ * The sequential version of crypto_shash_finup_mb(), also meant for drivers
+ * whose finup_mb cannot handle the state or context they are called in.
+ *
+ * Return: 0 if all message digests were computed; < 0 on the first error
+ */
+static inline int crypto_shash_finup_mb_fallback(struct shash_desc *desc,
+						 const u8 * const data[],
+						 unsigned int len,
+						 u8 * const outs[],
+						 unsigned int num_msgs)
+{
+	struct crypto_shash *tfm = desc->tfm;
+	SHASH_DESC_ON_STACK(desc2, tfm);
+	unsigned int i;
+	int err = 0;
+
+	desc2->tfm = tfm;
+	desc2->flags = desc->flags;
+	for (i = 0; i < num_msgs && !err; i++) {
+		memcpy(shash_desc_ctx(desc2), shash_desc_ctx(desc),
+		       crypto_shash_descsize(tfm));
+		err = crypto_shash_finup(desc2, data[i], len, outs[i]);
+	}
+	shash_desc_zero(desc2);
+	return err;
+}
+
+/**
+ * crypto_shash_finup_mb() - finish several equal length messages at once
+ * @desc: operational state shared by all messages, as left by
+ *	  crypto_shash_init() and crypto_shash_update(); not modified
+ * @data: the final data of each message
+ * @len: length of each data buffer in @data
+ * @outs: the digest of each message is stored here
+ * @num_msgs: number of messages, at most crypto_shash_mb_max_msgs()
+ *
+ * This is meant for callers hashing many blocks of the same size behind a
+ * common salt, such as the data blocks of a verity hash tree. Algorithms
+ * that can interleave the messages compute them together, which is faster
+ * than finishing them one after the other. The others just do the latter.
+ *
+ * Return: 0 if all message digests were computed; < 0 if an error occurred
+ */
+static inline int crypto_shash_finup_mb(struct shash_desc *desc,
+					const u8 * const data[],
+					unsigned int len, u8 * const outs[],
+					unsigned int num_msgs)
+{
+	struct shash_alg *alg = crypto_shash_alg(desc->tfm);
+
+	if (num_msgs > 1 && num_msgs <= alg->mb_max_msgs)
+		return alg->finup_mb(desc, data, len, outs, num_msgs);
+
+	return crypto_shash_finup_mb_fallback(desc, data, len, outs, num_msgs);
+}
+
 static inline void shash_desc_zero(struct shash_desc *desc)
 {
 	memzero_explicit(desc,
@@ -51,6 +51,8 @@ struct bpf_map_ops {
 	int (*map_check_btf)(const struct bpf_map *map,
 			     const struct btf_type *key_type,
 			     const struct btf_type *value_type);
+	void (*map_show_fdinfo)(const struct bpf_map *map,
+				struct seq_file *m);
 };
 
 struct bpf_map {
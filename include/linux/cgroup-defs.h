@@ -418,6 +418,13 @@ struct cgroup {
 	struct cgroup_rstat_cpu __percpu *rstat_cpu;
 	struct list_head rstat_css_list;
 
+	/*
+	 * CPUs on which this cgroup or one of its descendants is on the
+	 * updated tree.  A flush only walks these CPUs.
+	 */
+	cpumask_var_t rstat_updated_cpus;
+	unsigned long rstat_flush_time;		/* jiffies of the last flush */
+
 	/* cgroup basic resource statistics */
 	struct cgroup_base_stat pending_bstat;	/* pending from children */
 	struct cgroup_base_stat bstat;
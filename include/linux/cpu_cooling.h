@@ -65,12 +65,29 @@ void cpufreq_cooling_unregister(struct thermal_cooling_device *cdev)
  */
 struct thermal_cooling_device *
 of_cpufreq_cooling_register(struct cpufreq_policy *policy);
+
+/**
+ * of_cpufreq_power_cooling_register - create cpufreq cooling device based
+ * on DT, with a default dynamic power coefficient.
+ * @policy: cpufreq policy.
+ * @capacitance: dynamic power coefficient if DT provides none.
+ */
+struct thermal_cooling_device *
+of_cpufreq_power_cooling_register(struct cpufreq_policy *policy,
+				  u32 capacitance);
 #else
 static inline struct thermal_cooling_device *
 of_cpufreq_cooling_register(struct cpufreq_policy *policy)
 {
 	return NULL;
 }
+
+static inline struct thermal_cooling_device *
+of_cpufreq_power_cooling_register(struct cpufreq_policy *policy,
+				  u32 capacitance)
+{
+	return NULL;
+}
 #endif /* defined(CONFIG_THERMAL_OF) && defined(CONFIG_CPU_THERMAL) */
 
 #endif /* __CPU_COOLING_H__ */
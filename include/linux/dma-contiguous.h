@@ -115,6 +115,8 @@ struct page *dma_alloc_from_contiguous(struct device *dev, size_t count,
 				       unsigned int order, bool no_warn);
 bool dma_release_from_contiguous(struct device *dev, struct page *pages,
 				 int count);
+int dma_contiguous_set_warm_pool(struct device *dev, size_t count,
+				 unsigned int align, unsigned int target);
 
 #else
 
@@ -157,6 +159,13 @@ bool dma_release_from_contiguous(struct device *dev, struct page *pages,
 	return false;
 }
 
+static inline
+int dma_contiguous_set_warm_pool(struct device *dev, size_t count,
+				 unsigned int align, unsigned int target)
+{
+	return target ? -ENOSYS : 0;
+}
+
 #endif
 
 #endif
@@ -426,6 +426,57 @@ dma_sync_sg_for_device(struct device *dev, struct scatterlist *sg,
 
 }
 
+/*
+ * Sync only the bytes [offset, offset + size) of a mapped scatterlist, the
+ * offset counting from the start of the DMA mapping. nents is the value
+ * returned by dma_map_sg(). This lets a driver which knows which part of a
+ * large buffer the device or the CPU touched skip the cache maintenance of
+ * the rest of it.
+ */
+static inline void
+__dma_sync_sg_range(struct device *dev, struct scatterlist *sgl, int nents,
+		    unsigned long offset, size_t size,
+		    enum dma_data_direction dir, bool for_device)
+{
+	struct scatterlist *sg;
+	unsigned long len;
+	int i;
+
+	for_each_sg(sgl, sg, nents, i) {
+		if (!size)
+			break;
+		if (offset >= sg_dma_len(sg)) {
+			offset -= sg_dma_len(sg);
+			continue;
+		}
+		len = min_t(unsigned long, sg_dma_len(sg) - offset, size);
+		if (for_device)
+			dma_sync_single_range_for_device(dev, sg_dma_address(sg),
+							 offset, len, dir);
+		else
+			dma_sync_single_range_for_cpu(dev, sg_dma_address(sg),
+						      offset, len, dir);
+		offset = 0;
+		size -= len;
+	}
+}
+
+static inline void
+dma_sync_sg_range_for_cpu(struct device *dev, struct scatterlist *sg,
+			  int nents, unsigned long offset, size_t size,
+			  enum dma_data_direction dir)
+{
+	__dma_sync_sg_range(dev, sg, nents, offset, size, dir, false);
+}
+
+static inline void
+dma_sync_sg_range_for_device(struct device *dev, struct scatterlist *sg,
+			     int nents, unsigned long offset, size_t size,
+			     enum dma_data_direction dir)
+{
+	__dma_sync_sg_range(dev, sg, nents, offset, size, dir, true);
+}
+
 #define dma_map_single(d, a, s, r) dma_map_single_attrs(d, a, s, r, 0)
 #define dma_unmap_single(d, a, s, r) dma_unmap_single_attrs(d, a, s, r, 0)
 #define dma_map_sg(d, s, n, r) dma_map_sg_attrs(d, s, n, r, 0)
@@ -198,6 +198,8 @@ struct fsnotify_group {
 			unsigned int max_marks;
 			struct user_struct *user;
 			bool audit;
+			/* queued events hashed by inode, for merging */
+			struct hlist_head *merge_hash;
 		} fanotify_data;
 #endif /* CONFIG_FANOTIFY */
 	};
@@ -394,11 +396,13 @@ extern void fsnotify_destroy_event(struct fsnotify_group *group,
 extern int fsnotify_add_event(struct fsnotify_group *group,
 			      struct fsnotify_event *event,
 			      int (*merge)(struct list_head *,
-					   struct fsnotify_event *));
+					   struct fsnotify_event *),
+			      void (*insert)(struct fsnotify_group *,
+					     struct fsnotify_event *));
 /* Queue overflow event to a notification group */
 static inline void fsnotify_queue_overflow(struct fsnotify_group *group)
 {
-	fsnotify_add_event(group, group->overflow_event, NULL);
+	fsnotify_add_event(group, group->overflow_event, NULL, NULL);
 }
 
 /* true if the group notification queue is empty */
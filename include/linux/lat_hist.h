@@ -0,0 +1,73 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _LINUX_LAT_HIST_H
+#define _LINUX_LAT_HIST_H
+
+/*
+ * Latency histograms: always-on counts of how long a hot path took, e.g. an
+ * interrupt handler or the wake up of its thread, in power-of-two nanosecond
+ * buckets. Recording a sample is a per-CPU increment, safe from any context.
+ * The per-CPU counts are summed when read from debugfs, in
+ * /sys/kernel/debug/lat_hist/<device>/<name>; writing to the file clears
+ * the histogram.
+ *
+ *	hist = devm_lat_hist_add(dev, "irq");
+ *	...
+ *	u64 start = lat_hist_now();
+ *	...
+ *	lat_hist_record_since(hist, start);
+ *
+ * A NULL histogram, as returned when it couldn't be allocated, ignores the
+ * samples.
+ */
+
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/percpu.h>
+
+struct device;
+
+/* Bucket n counts the samples in [2^(n-1), 2^n) ns, the last one is open */
+#define LAT_HIST_BUCKETS	32
+
+struct lat_hist_cpu {
+	u64 count[LAT_HIST_BUCKETS];
+};
+
+struct lat_hist {
+	struct lat_hist_cpu __percpu *cpu;
+	struct dentry *dentry;
+};
+
+#ifdef CONFIG_LAT_HIST
+struct lat_hist *devm_lat_hist_add(struct device *dev, const char *name);
+
+static inline u64 lat_hist_now(void)
+{
+	return ktime_get_ns();
+}
+
+static inline void lat_hist_record(struct lat_hist *hist, u64 ns)
+{
+	if (hist)
+		this_cpu_inc(hist->cpu->count[min_t(unsigned int, fls64(ns),
+						    LAT_HIST_BUCKETS - 1)]);
+}
+
+static inline void lat_hist_record_since(struct lat_hist *hist, u64 start)
+{
+	if (hist)
+		lat_hist_record(hist, ktime_get_ns() - start);
+}
+#else
+static inline struct lat_hist *devm_lat_hist_add(struct device *dev,
+						 const char *name)
+{
+	return NULL;
+}
+
+static inline u64 lat_hist_now(void) { return 0; }
+static inline void lat_hist_record(struct lat_hist *hist, u64 ns) { }
+static inline void lat_hist_record_since(struct lat_hist *hist, u64 start) { }
+#endif
+
+#endif /* _LINUX_LAT_HIST_H */
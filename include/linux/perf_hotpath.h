@@ -0,0 +1,54 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _LINUX_PERF_HOTPATH_H
+#define _LINUX_PERF_HOTPATH_H
+
+/*
+ * Hot-path regions: named stretches of kernel code, typically interrupt
+ * handlers, whose cycles or other hardware events can be counted on their
+ * own through the "hotpath" PMU, e.g.:
+ *
+ *   perf stat -a -e hotpath/region=1/,hotpath/region=1,event=0x17/
+ *
+ * The region ids are listed in /sys/bus/event_source/devices/hotpath/regions.
+ * A region must not be preempted or migrated between perf_hotpath_enter()
+ * and perf_hotpath_exit(), which a hard interrupt handler guarantees.
+ */
+
+#include <linux/jump_label.h>
+
+struct perf_hotpath {
+	const char	*name;
+	int		id;
+	unsigned int	users;
+};
+
+#define DEFINE_PERF_HOTPATH(_var, _name)			\
+	struct perf_hotpath _var = { .name = _name, .id = -1 }
+
+#ifdef CONFIG_PERF_HOTPATH
+DECLARE_STATIC_KEY_FALSE(perf_hotpath_key);
+
+int perf_hotpath_register(struct perf_hotpath *hp);
+void perf_hotpath_unregister(struct perf_hotpath *hp);
+void __perf_hotpath_enter(struct perf_hotpath *hp);
+void __perf_hotpath_exit(struct perf_hotpath *hp);
+
+static inline void perf_hotpath_enter(struct perf_hotpath *hp)
+{
+	if (static_branch_unlikely(&perf_hotpath_key))
+		__perf_hotpath_enter(hp);
+}
+
+static inline void perf_hotpath_exit(struct perf_hotpath *hp)
+{
+	if (static_branch_unlikely(&perf_hotpath_key))
+		__perf_hotpath_exit(hp);
+}
+#else
+static inline int perf_hotpath_register(struct perf_hotpath *hp) { return 0; }
+static inline void perf_hotpath_unregister(struct perf_hotpath *hp) { }
+static inline void perf_hotpath_enter(struct perf_hotpath *hp) { }
+static inline void perf_hotpath_exit(struct perf_hotpath *hp) { }
+#endif
+
+#endif /* _LINUX_PERF_HOTPATH_H */
@@ -23,6 +23,7 @@
 #include <linux/kernel.h>
 #include <linux/list.h>
 #include <linux/types.h>
+#include <linux/workqueue.h>
 
 /*
  * Choose whether access to the RAM zone requires locking or not.  If a zone
@@ -31,6 +32,14 @@
  */
 #define PRZ_FLAG_NO_LOCK	BIT(0)
 
+/*
+ * Only mark the ECC blocks written to, and compute their ECC from a work
+ * once a second, or when persistent_ram_flush_ecc() is called. Meant for
+ * zones with many small writes like ftrace, at the cost of the last second
+ * of writes not being protected if the system resets without a panic.
+ */
+#define PRZ_FLAG_ASYNC_ECC	BIT(1)
+
 struct persistent_ram_buffer;
 struct rs_control;
 
@@ -40,6 +49,7 @@ struct persistent_ram_ecc_info {
 	int symsize;
 	int poly;
 	uint16_t *par;
+	int ecc_blocks;
 };
 
 struct persistent_ram_zone {
@@ -58,6 +68,8 @@ struct persistent_ram_zone {
 	int corrected_bytes;
 	int bad_blocks;
 	struct persistent_ram_ecc_info ecc_info;
+	unsigned long *ecc_dirty;	/* PRZ_FLAG_ASYNC_ECC only */
+	struct delayed_work ecc_work;
 
 	char *old_log;
 	size_t old_log_size;
@@ -73,6 +85,7 @@ int persistent_ram_write(struct persistent_ram_zone *prz, const void *s,
 			 unsigned int count);
 int persistent_ram_write_user(struct persistent_ram_zone *prz,
 			      const void __user *s, unsigned int count);
+void persistent_ram_flush_ecc(struct persistent_ram_zone *prz);
 
 void persistent_ram_save_old(struct persistent_ram_zone *prz);
 size_t persistent_ram_old_size(struct persistent_ram_zone *prz);
@@ -88,6 +101,7 @@ ssize_t persistent_ram_ecc_string(struct persistent_ram_zone *prz,
  */
 
 #define RAMOOPS_FLAG_FTRACE_PER_CPU	BIT(0)
+#define RAMOOPS_FLAG_FTRACE_ASYNC_ECC	BIT(1)
 
 struct ramoops_platform_data {
 	unsigned long	mem_size;
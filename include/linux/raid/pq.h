@@ -130,6 +130,7 @@ extern const struct raid6_calls raid6_neonx1;
 extern const struct raid6_calls raid6_neonx2;
 extern const struct raid6_calls raid6_neonx4;
 extern const struct raid6_calls raid6_neonx8;
+extern const struct raid6_calls raid6_neonpx4;
 
 /* Algorithm list */
 extern const struct raid6_calls * const raid6_algos[];
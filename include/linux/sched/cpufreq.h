@@ -11,6 +11,13 @@
 #define SCHED_CPUFREQ_IOWAIT	(1U << 0)
 #define SCHED_CPUFREQ_MIGRATION	(1U << 1)
 
+/* Sources of schedutil frequency floor requests */
+enum sched_cpufreq_boost_src {
+	SCHED_CPUFREQ_BOOST_INPUT,	/* user input event */
+	SCHED_CPUFREQ_BOOST_DISPLAY,	/* display frame completion */
+	SCHED_CPUFREQ_BOOST_NR,
+};
+
 #ifdef CONFIG_CPU_FREQ
 struct update_util_data {
        void (*func)(struct update_util_data *data, u64 time, unsigned int flags);
@@ -22,4 +29,11 @@ void cpufreq_add_update_util_hook(int cpu, struct update_util_data *data,
 void cpufreq_remove_update_util_hook(int cpu);
 #endif /* CONFIG_CPU_FREQ */
 
+#ifdef CONFIG_CPU_FREQ_GOV_SCHEDUTIL
+void schedutil_boost(enum sched_cpufreq_boost_src src, unsigned int duration_us);
+#else
+static inline void schedutil_boost(enum sched_cpufreq_boost_src src,
+				   unsigned int duration_us) { }
+#endif /* CONFIG_CPU_FREQ_GOV_SCHEDUTIL */
+
 #endif /* _LINUX_SCHED_CPUFREQ_H */
@@ -43,6 +43,12 @@ struct scpi_sensor_info {
 	char name[20];
 } __packed;
 
+/*
+ * Called with the reading of an asynchronous sensor request, from the
+ * mailbox RX context. Never called if the SCP does not reply.
+ */
+typedef void (*scpi_sensor_cb)(void *data, int ret, u64 value);
+
 /**
  * struct scpi_ops - represents the various operations provided
  *	by SCP through SCPI message protocol
@@ -56,8 +62,13 @@ struct scpi_sensor_info {
  *	OPP is an index to the list return by @dvfs_get_info
  * @dvfs_set_idx: sets the Operating Point of the given power domain.
  *	OPP is an index to the list return by @dvfs_get_info
+ * @dvfs_set_idx_async: same as @dvfs_set_idx, but returns as soon as the
+ *	request is posted to the SCP, can be called from atomic context
  * @dvfs_get_info: returns the DVFS capabilities of the given power
  *	domain. It includes the OPP list and the latency information
+ * @sensor_get_value_async: requests the value of a sensor and returns
+ *	without waiting, the value is passed to the callback when the
+ *	SCP replies. Can be called from atomic context
  */
 struct scpi_ops {
 	u32 (*get_version)(void);
@@ -66,6 +77,7 @@ struct scpi_ops {
 	int (*clk_set_val)(u16, unsigned long);
 	int (*dvfs_get_idx)(u8);
 	int (*dvfs_set_idx)(u8, u8);
+	int (*dvfs_set_idx_async)(u8, u8);
 	struct scpi_dvfs_info *(*dvfs_get_info)(u8);
 	int (*device_domain_id)(struct device *);
 	int (*get_transition_latency)(struct device *);
@@ -73,6 +85,7 @@ struct scpi_ops {
 	int (*sensor_get_capability)(u16 *sensors);
 	int (*sensor_get_info)(u16 sensor_id, struct scpi_sensor_info *);
 	int (*sensor_get_value)(u16, u64 *);
+	int (*sensor_get_value_async)(u16, scpi_sensor_cb, void *);
 	int (*device_get_power_state)(u16);
 	int (*device_set_power_state)(u16, u8);
 };
@@ -22,6 +22,27 @@
 
 struct meson_canvas;
 
+/**
+ * struct meson_canvas_entry - canvas configuration for a batch update
+ *
+ * @index: canvas ID that was obtained via meson_canvas_alloc()
+ * @addr: physical address to the pixel buffer
+ * @stride: width of the buffer
+ * @height: height of the buffer
+ * @wrap: undocumented
+ * @blkmode: block mode (linear, 32x32, 64x64)
+ * @endian: byte swapping (swap16, swap32, swap64, swap128)
+ */
+struct meson_canvas_entry {
+	u8 index;
+	u32 addr;
+	u32 stride;
+	u32 height;
+	unsigned int wrap;
+	unsigned int blkmode;
+	unsigned int endian;
+};
+
 /**
  * meson_canvas_get() - get a canvas provider instance
  *
@@ -37,6 +58,16 @@ struct meson_canvas *meson_canvas_get(struct device *dev);
  */
 int meson_canvas_alloc(struct meson_canvas *canvas, u8 *canvas_index);
 
+/**
+ * meson_canvas_alloc_range() - take ownership of contiguous canvases
+ *
+ * @canvas: canvas provider instance retrieved from meson_canvas_get()
+ * @first: will be filled with the first canvas ID of the range
+ * @num: number of canvases to reserve
+ */
+int meson_canvas_alloc_range(struct meson_canvas *canvas, u8 *first,
+			     unsigned int num);
+
 /**
  * meson_canvas_free() - remove ownership from a canvas
  *
@@ -45,6 +76,16 @@ int meson_canvas_alloc(struct meson_canvas *canvas, u8 *canvas_index);
  */
 int meson_canvas_free(struct meson_canvas *canvas, u8 canvas_index);
 
+/**
+ * meson_canvas_free_range() - remove ownership from contiguous canvases
+ *
+ * @canvas: canvas provider instance retrieved from meson_canvas_get()
+ * @first: first canvas ID obtained via meson_canvas_alloc_range()
+ * @num: number of canvases in the range
+ */
+void meson_canvas_free_range(struct meson_canvas *canvas, u8 first,
+			     unsigned int num);
+
 /**
  * meson_canvas_config() - configure a canvas
  *
@@ -62,4 +103,17 @@ int meson_canvas_config(struct meson_canvas *canvas, u8 canvas_index,
 			unsigned int wrap, unsigned int blkmode,
 			unsigned int endian);
 
+/**
+ * meson_canvas_config_batch() - configure several canvases at once
+ *
+ * The LUT writes are flushed with a single read-back.
+ *
+ * @canvas: canvas provider instance retrieved from meson_canvas_get()
+ * @entries: canvas configurations
+ * @num: number of entries
+ */
+int meson_canvas_config_batch(struct meson_canvas *canvas,
+			      const struct meson_canvas_entry *entries,
+			      unsigned int num);
+
 #endif
@@ -0,0 +1,117 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Copyright (C) 2018 BayLibre, SAS
+ */
+#ifndef __SOC_MESON_TUNNEL_H
+#define __SOC_MESON_TUNNEL_H
+
+#include <linux/kernel.h>
+#include <linux/list.h>
+
+/*
+ * Frame queue from the video decoder straight to the VD1 plane of the
+ * display, without a round-trip through userspace for each frame.
+ *
+ * There is a single VD1 plane per SoC, so a single tunnel: the display
+ * registers as its sink and one decoding session at a time binds to it as
+ * the producer. Frames are presented at the first vsync at or after their
+ * timestamp, relative to the first frame shown, and handed back to the
+ * producer once replaced on screen or dropped for being late.
+ */
+
+/**
+ * struct meson_tunnel_frame - decoded NV12 frame
+ *
+ * @list: owned by the tunnel while the frame is queued
+ * @addr: physical addresses of the luma and chroma planes
+ * @stride: stride of both planes
+ * @height: height of the luma plane
+ * @timestamp: presentation timestamp in ns
+ * @priv: producer private data
+ */
+struct meson_tunnel_frame {
+	struct list_head list;
+	dma_addr_t addr[2];
+	u32 stride;
+	u32 height;
+	u64 timestamp;
+	void *priv;
+};
+
+/**
+ * struct meson_tunnel_ops - producer callbacks
+ *
+ * @release: give a frame back to the producer, called from process context
+ */
+struct meson_tunnel_ops {
+	void (*release)(void *data, struct meson_tunnel_frame *frame);
+};
+
+/**
+ * meson_tunnel_bind() - start feeding the sink
+ *
+ * @ops: producer callbacks
+ * @data: passed to the callbacks
+ *
+ * Return: -ENODEV without a sink, -EBUSY if another producer is bound.
+ */
+int meson_tunnel_bind(const struct meson_tunnel_ops *ops, void *data);
+
+/**
+ * meson_tunnel_unbind() - stop feeding the sink
+ *
+ * Returns once all the frames, including the one on screen, have been
+ * released.
+ */
+void meson_tunnel_unbind(void);
+
+/**
+ * meson_tunnel_queue() - queue a frame for presentation
+ *
+ * @frame: frame, owned by the tunnel until released
+ */
+void meson_tunnel_queue(struct meson_tunnel_frame *frame);
+
+/**
+ * meson_tunnel_flush() - drop the queued frames, e.g. on seek
+ *
+ * The frame on screen stays there until the next one is due, the
+ * timestamps of the next frames start a new timeline.
+ */
+void meson_tunnel_flush(void);
+
+/**
+ * meson_tunnel_set_paused() - freeze or resume the presentation
+ *
+ * @paused: keep the current frame on screen if true
+ */
+void meson_tunnel_set_paused(bool paused);
+
+/**
+ * meson_tunnel_set_offset() - delay the presentation, e.g. for A/V sync
+ *
+ * @offset: added to the presentation time of the frames, in ns
+ */
+void meson_tunnel_set_offset(s64 offset);
+
+/**
+ * meson_tunnel_sink_register() - make the display available to producers
+ */
+int meson_tunnel_sink_register(void);
+
+/**
+ * meson_tunnel_sink_unregister() - release all the frames and unbind
+ */
+void meson_tunnel_sink_unregister(void);
+
+/**
+ * meson_tunnel_vsync() - pick the frame to scan out, from the vsync IRQ
+ *
+ * @now: time of the vsync, CLOCK_MONOTONIC in ns
+ * @changed: set if the returned frame differs from the previous vsync
+ *
+ * Return: the frame to show, or NULL to show the sink's own buffer.
+ */
+struct meson_tunnel_frame *meson_tunnel_vsync(u64 now, bool *changed);
+
+#endif
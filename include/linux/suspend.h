@@ -478,10 +478,21 @@ static inline void unlock_system_sleep(void) {}
 extern bool pm_print_times_enabled;
 extern bool pm_debug_messages_on;
 extern __printf(2, 3) void __pm_pr_dbg(bool defer, const char *fmt, ...);
+extern void pm_timeline_start(void);
+extern ktime_t pm_timeline_end(const struct device *dev);
+extern void pm_timeline_record(const struct device *dev,
+			       const struct device *gate, ktime_t start,
+			       ktime_t cb_start, bool async);
 #else
 #define pm_print_times_enabled	(false)
 #define pm_debug_messages_on	(false)
 
+static inline void pm_timeline_start(void) {}
+static inline ktime_t pm_timeline_end(const struct device *dev) { return 0; }
+static inline void pm_timeline_record(const struct device *dev,
+				      const struct device *gate, ktime_t start,
+				      ktime_t cb_start, bool async) {}
+
 #include <linux/printk.h>
 
 #define __pm_pr_dbg(defer, fmt, ...) \
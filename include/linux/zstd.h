@@ -459,6 +459,64 @@ size_t ZSTD_decompress_usingDDict(ZSTD_DCtx *dctx, void *dst,
 	const ZSTD_DDict *ddict);
 
 
+/*-**************************
+ * Parallel compression
+ ***************************/
+
+/**
+ * ZSTD_CCtxParallelWorkspaceBound() - memory needed for ZSTD_compressParallel()
+ * @cParams:   The compression parameters to be used for compression.
+ * @nbWorkers: The number of contexts compressing at the same time.
+ *
+ * Return:     A lower bound on the size of the workspace that is passed to
+ *             ZSTD_compressParallel().
+ */
+size_t ZSTD_CCtxParallelWorkspaceBound(ZSTD_compressionParameters cParams,
+	unsigned int nbWorkers);
+
+/**
+ * ZSTD_compressParallelBound() - maximum compressed size of a parallel job
+ * @srcSize:   The size of the data to compress.
+ * @chunkSize: The size of the independently compressed chunks.
+ *
+ * Return:     The destination capacity ZSTD_compressParallel() needs to be
+ *             guaranteed to succeed. It is larger than
+ *             ZSTD_compressBound(srcSize), since every chunk is given room
+ *             for its worst case.
+ */
+size_t ZSTD_compressParallelBound(size_t srcSize, size_t chunkSize);
+
+/**
+ * ZSTD_compressParallel() - compress src into dst on several CPUs
+ * @workspace:     The workspace. Must be at least
+ *                 ZSTD_CCtxParallelWorkspaceBound(params.cParams, nbWorkers).
+ * @workspaceSize: The workspace size.
+ * @nbWorkers:     The number of contexts compressing at the same time. The
+ *                 caller compresses one share itself, the others are queued
+ *                 on system_unbound_wq.
+ * @dst:           The buffer to compress src into.
+ * @dstCapacity:   The size of the destination buffer. Must be at least
+ *                 ZSTD_compressParallelBound(srcSize, chunkSize).
+ * @src:           The data to compress.
+ * @srcSize:       The size of the data to compress.
+ * @chunkSize:     src is cut into chunks of this size, each compressed into
+ *                 its own frame. Larger chunks compress better, smaller ones
+ *                 spread better over the workers.
+ * @params:        The parameters to use for compression. See ZSTD_getParams().
+ *
+ * The frames are concatenated in order in dst, so the result can be
+ * decompressed with any of the decompression functions. Must be called from
+ * a context that can sleep.
+ *
+ * Return:         The compressed size or an error, which can be checked using
+ *                 ZSTD_isError().
+ */
+size_t ZSTD_compressParallel(void *workspace, size_t workspaceSize,
+	unsigned int nbWorkers, void *dst, size_t dstCapacity,
+	const void *src, size_t srcSize, size_t chunkSize,
+	ZSTD_parameters params);
+
+
 /*-**************************
  * Streaming
  ***************************/
@@ -19,13 +19,21 @@
 
 #include <media/videobuf2-v4l2.h>
 
+/* Maximum number of jobs handed to &v4l2_m2m_ops->device_run_batch at once */
+#define V4L2_M2M_MAX_BATCH	8
+
 /**
  * struct v4l2_m2m_ops - mem-to-mem device driver callbacks
- * @device_run:	required. Begin the actual job (transaction) inside this
- *		callback.
+ * @device_run:	required, unless @device_run_batch is provided. Begin the
+ *		actual job (transaction) inside this callback.
  *		The job does NOT have to end before this callback returns
  *		(and it will be the usual case). When the job finishes,
  *		v4l2_m2m_job_finish() has to be called.
+ * @device_run_batch: optional. Used instead of @device_run to begin the jobs
+ *		of up to v4l2_m2m_set_max_batch() instances at once, given in
+ *		the order they should be processed. v4l2_m2m_job_finish() has
+ *		to be called for each of them, and no other job is started
+ *		before all of them have finished.
  * @job_ready:	optional. Should return 0 if the driver does not have a job
  *		fully prepared to run yet (i.e. it will not be able to finish a
  *		transaction without sleeping). If not provided, it will be
@@ -43,6 +51,7 @@
  */
 struct v4l2_m2m_ops {
 	void (*device_run)(void *priv);
+	void (*device_run_batch)(void **priv, unsigned int count);
 	int (*job_ready)(void *priv);
 	void (*job_abort)(void *priv);
 };
@@ -73,6 +82,19 @@ struct v4l2_m2m_queue_ctx {
 	bool			buffered;
 };
 
+/**
+ * struct v4l2_m2m_ctx_stats - queueing latency statistics of a m2m context
+ *
+ * @jobs: number of jobs run
+ * @total_latency_ns: total time the jobs waited between being queued and run
+ * @max_latency_ns: longest time a job waited between being queued and run
+ */
+struct v4l2_m2m_ctx_stats {
+	u64	jobs;
+	u64	total_latency_ns;
+	u64	max_latency_ns;
+};
+
 /**
  * struct v4l2_m2m_ctx - Memory to memory context structure
  *
@@ -84,6 +106,10 @@ struct v4l2_m2m_queue_ctx {
  * @job_flags: Job queue flags, used internally by v4l2-mem2mem.c:
  *		%TRANS_QUEUED, %TRANS_RUNNING and %TRANS_ABORT.
  * @finished: Wait queue used to signalize when a job queue finished.
+ * @priority: Scheduling priority, an &enum v4l2_priority. Queued jobs of a
+ *		higher priority run first, in queueing order within a priority.
+ * @queued_ns: Time at which the pending job was queued
+ * @stats: Queueing latency statistics, see v4l2_m2m_ctx_get_stats()
  * @priv: Instance private data
  *
  * The memory to memory context is specific to a file handle, NOT to e.g.
@@ -104,6 +130,9 @@ struct v4l2_m2m_ctx {
 	struct list_head		queue;
 	unsigned long			job_flags;
 	wait_queue_head_t		finished;
+	u32				priority;
+	u64				queued_ns;
+	struct v4l2_m2m_ctx_stats	stats;
 
 	void				*priv;
 };
@@ -124,6 +153,9 @@ struct v4l2_m2m_buffer {
  * running instance or NULL if no instance is running
  *
  * @m2m_dev: opaque pointer to the internal data to handle M2M context
+ *
+ * With &v4l2_m2m_ops->device_run_batch, this is the first instance of the
+ * batch, until its job finishes.
  */
 void *v4l2_m2m_get_curr_priv(struct v4l2_m2m_dev *m2m_dev);
 
@@ -136,6 +168,31 @@ void *v4l2_m2m_get_curr_priv(struct v4l2_m2m_dev *m2m_dev);
 struct vb2_queue *v4l2_m2m_get_vq(struct v4l2_m2m_ctx *m2m_ctx,
 				       enum v4l2_buf_type type);
 
+/**
+ * v4l2_m2m_ctx_set_priority() - set the scheduling priority of an instance
+ *
+ * @m2m_ctx: m2m context assigned to the instance given by struct &v4l2_m2m_ctx
+ * @prio: priority, as defined by &enum v4l2_priority
+ *
+ * Jobs of a higher priority instance run before those of the instances
+ * already waiting, e.g. a live stream with %V4L2_PRIORITY_RECORD before
+ * transcodes with %V4L2_PRIORITY_BACKGROUND. A running job is never
+ * preempted. The priority set with VIDIOC_S_PRIORITY on a file handle is
+ * applied to its context. The default is %V4L2_PRIORITY_DEFAULT.
+ */
+void v4l2_m2m_ctx_set_priority(struct v4l2_m2m_ctx *m2m_ctx,
+			       enum v4l2_priority prio);
+
+/**
+ * v4l2_m2m_ctx_get_stats() - get the queueing latency statistics of an
+ * instance
+ *
+ * @m2m_ctx: m2m context assigned to the instance given by struct &v4l2_m2m_ctx
+ * @stats: pointer to struct &v4l2_m2m_ctx_stats filled with the statistics
+ */
+void v4l2_m2m_ctx_get_stats(struct v4l2_m2m_ctx *m2m_ctx,
+			    struct v4l2_m2m_ctx_stats *stats);
+
 /**
  * v4l2_m2m_try_schedule() - check whether an instance is ready to be added to
  * the pending job queue and add it if so.
@@ -323,6 +380,19 @@ int v4l2_m2m_mmap(struct file *file, struct v4l2_m2m_ctx *m2m_ctx,
  */
 struct v4l2_m2m_dev *v4l2_m2m_init(const struct v4l2_m2m_ops *m2m_ops);
 
+/**
+ * v4l2_m2m_set_max_batch() - set the number of jobs run at once
+ *
+ * @m2m_dev: opaque pointer to the internal data to handle M2M context
+ * @max_batch: maximum number of jobs given to
+ *	&v4l2_m2m_ops->device_run_batch, up to %V4L2_M2M_MAX_BATCH
+ *
+ * The default is %V4L2_M2M_MAX_BATCH. Only used with
+ * &v4l2_m2m_ops->device_run_batch.
+ */
+void v4l2_m2m_set_max_batch(struct v4l2_m2m_dev *m2m_dev,
+			    unsigned int max_batch);
+
 #if defined(CONFIG_MEDIA_CONTROLLER)
 void v4l2_m2m_unregister_media_controller(struct v4l2_m2m_dev *m2m_dev);
 int v4l2_m2m_register_media_controller(struct v4l2_m2m_dev *m2m_dev,
@@ -10,6 +10,7 @@
 
 struct can_dev_rcv_lists;
 struct s_stats;
+struct s_pcpu_stats;
 struct s_pstats;
 
 struct netns_can {
@@ -32,6 +33,7 @@ struct netns_can {
 	spinlock_t can_rcvlists_lock;
 	struct timer_list can_stattimer;/* timer for statistics update */
 	struct s_stats *can_stats;	/* packet statistics */
+	struct s_pcpu_stats __percpu *can_pcpu_stats; /* packet counters */
 	struct s_pstats *can_pstats;	/* receive list statistics */
 
 	/* CAN GW per-net gateway jobs */
@@ -5,6 +5,7 @@
 #if !defined(_TRACE_CMA_H) || defined(TRACE_HEADER_MULTI_READ)
 #define _TRACE_CMA_H
 
+#include <linux/device.h>
 #include <linux/types.h>
 #include <linux/tracepoint.h>
 
@@ -61,6 +62,40 @@ TRACE_EVENT(cma_release,
 		  __entry->count)
 );
 
+TRACE_EVENT(cma_alloc_cost,
+
+	TP_PROTO(struct device *dev, unsigned long pfn, unsigned int count,
+		 unsigned int align, u64 cost_ns, bool pooled),
+
+	TP_ARGS(dev, pfn, count, align, cost_ns, pooled),
+
+	TP_STRUCT__entry(
+		__string(dev, dev ? dev_name(dev) : "none")
+		__field(unsigned long, pfn)
+		__field(unsigned int, count)
+		__field(unsigned int, align)
+		__field(u64, cost_ns)
+		__field(bool, pooled)
+	),
+
+	TP_fast_assign(
+		__assign_str(dev, dev ? dev_name(dev) : "none");
+		__entry->pfn = pfn;
+		__entry->count = count;
+		__entry->align = align;
+		__entry->cost_ns = cost_ns;
+		__entry->pooled = pooled;
+	),
+
+	TP_printk("dev=%s pfn=%lx count=%u align=%u cost_ns=%llu pooled=%d",
+		  __get_str(dev),
+		  __entry->pfn,
+		  __entry->count,
+		  __entry->align,
+		  __entry->cost_ns,
+		  __entry->pooled)
+);
+
 #endif /* _TRACE_CMA_H */
 
 /* This part must be outside protection */
@@ -0,0 +1,55 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM phy
+
+#if !defined(_TRACE_PHY_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_PHY_H
+
+#include <linux/device.h>
+#include <linux/phy/phy.h>
+#include <linux/tracepoint.h>
+
+/*
+ * Time spent in the init and power_on callbacks of a PHY driver, which are
+ * on the resume path of the controllers using it.
+ */
+DECLARE_EVENT_CLASS(phy_op,
+
+	TP_PROTO(struct phy *phy, int ret, u64 duration_ns),
+
+	TP_ARGS(phy, ret, duration_ns),
+
+	TP_STRUCT__entry(
+		__string(name, dev_name(&phy->dev))
+		__field(int, ret)
+		__field(u64, duration_ns)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, dev_name(&phy->dev));
+		__entry->ret = ret;
+		__entry->duration_ns = duration_ns;
+	),
+
+	TP_printk("%s ret=%d duration=%lluns", __get_str(name), __entry->ret,
+		  __entry->duration_ns)
+);
+
+DEFINE_EVENT(phy_op, phy_init,
+
+	TP_PROTO(struct phy *phy, int ret, u64 duration_ns),
+
+	TP_ARGS(phy, ret, duration_ns)
+);
+
+DEFINE_EVENT(phy_op, phy_power_on,
+
+	TP_PROTO(struct phy *phy, int ret, u64 duration_ns),
+
+	TP_ARGS(phy, ret, duration_ns)
+);
+
+#endif /* _TRACE_PHY_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
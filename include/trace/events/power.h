@@ -129,6 +129,11 @@ TRACE_EVENT(pstate_sample,
 #define _PWR_EVENT_AVOID_DOUBLE_DEFINING
 
 #define PWR_EVENT_EXIT -1
+
+/* Why schedutil picked a frequency, see sugov_next_freq */
+#define SUGOV_FREQ_IOWAIT	(1U << 0)	/* util raised by IO boost */
+#define SUGOV_FREQ_BUSY		(1U << 1)	/* kept as the CPU is busy */
+#define SUGOV_FREQ_BOOST	(1U << 2)	/* raised to the boost floor */
 #endif
 
 #define pm_verb_symbolic(event) \
@@ -173,6 +178,43 @@ TRACE_EVENT(cpu_frequency_limits,
 		  (unsigned long)__entry->cpu_id)
 );
 
+TRACE_EVENT(sugov_next_freq,
+
+	TP_PROTO(unsigned int cpu_id, unsigned long util, unsigned long max,
+		 unsigned int reason, unsigned int boost, unsigned int freq),
+
+	TP_ARGS(cpu_id, util, max, reason, boost, freq),
+
+	TP_STRUCT__entry(
+		__field(u32, cpu_id)
+		__field(unsigned long, util)
+		__field(unsigned long, max)
+		__field(u32, reason)
+		__field(u32, boost)
+		__field(u32, freq)
+	),
+
+	TP_fast_assign(
+		__entry->cpu_id = cpu_id;
+		__entry->util = util;
+		__entry->max = max;
+		__entry->reason = reason;
+		__entry->boost = boost;
+		__entry->freq = freq;
+	),
+
+	TP_printk("cpu_id=%lu util=%lu max=%lu reason=%s boost=0x%lx freq=%lu",
+		  (unsigned long)__entry->cpu_id,
+		  __entry->util,
+		  __entry->max,
+		  __print_flags(__entry->reason, "|",
+			{ SUGOV_FREQ_IOWAIT, "iowait" },
+			{ SUGOV_FREQ_BUSY, "busy" },
+			{ SUGOV_FREQ_BOOST, "boost" }),
+		  (unsigned long)__entry->boost,
+		  (unsigned long)__entry->freq)
+);
+
 TRACE_EVENT(device_pm_callback_start,
 
 	TP_PROTO(struct device *dev, const char *pm_ops, int event),
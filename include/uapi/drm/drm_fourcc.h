@@ -161,6 +161,14 @@ extern "C" {
 #define DRM_FORMAT_YUV444	fourcc_code('Y', 'U', '2', '4') /* non-subsampled Cb (1) and Cr (2) planes */
 #define DRM_FORMAT_YVU444	fourcc_code('Y', 'V', '2', '4') /* non-subsampled Cr (1) and Cb (2) planes */
 
+/*
+ * 2x2 subsampled YCbCr 4:2:0 formats with an opaque layout, only usable
+ * together with a compression modifier describing the actual memory layout.
+ * A single buffer holds all the components.
+ */
+#define DRM_FORMAT_YUV420_8BIT	fourcc_code('Y', 'U', '0', '8')
+#define DRM_FORMAT_YUV420_10BIT	fourcc_code('Y', 'U', '1', '0')
+
 
 /*
  * Format Modifiers:
@@ -184,6 +192,7 @@ extern "C" {
 #define DRM_FORMAT_MOD_VENDOR_VIVANTE 0x06
 #define DRM_FORMAT_MOD_VENDOR_BROADCOM 0x07
 #define DRM_FORMAT_MOD_VENDOR_ARM     0x08
+#define DRM_FORMAT_MOD_VENDOR_AMLOGIC 0x0a
 /* add more to the end as needed */
 
 #define DRM_FORMAT_RESERVED	      ((1ULL << 56) - 1)
@@ -590,6 +599,36 @@ extern "C" {
  */
 #define DRM_FORMAT_MOD_ARM_TILED fourcc_mod_code(ARM, 1)
 
+/*
+ * Amlogic Video Framebuffer Compression modifiers
+ *
+ * Amlogic uses a proprietary lossless image compression protocol and format
+ * for their hardware video codec accelerators, either video decoders or
+ * video input encoders. It is produced by the HEVC decoder of the GX
+ * family (V4L2_PIX_FMT_AM21C) and can be scanned out by the VD1 video
+ * plane, which halves the memory traffic compared to an uncompressed
+ * write-back.
+ *
+ * The pixel format must be DRM_FORMAT_YUV420_8BIT or
+ * DRM_FORMAT_YUV420_10BIT, in a single plane.
+ *
+ * The lower 8 bits of the modifier describe the memory layout, the upper
+ * bits are reserved for options.
+ */
+#define DRM_FORMAT_MOD_AMLOGIC_FBC(__layout, __options) \
+	fourcc_mod_code(AMLOGIC, \
+			((__layout) & 0xff) | (((__u64)(__options) & 0xff) << 8))
+
+/*
+ * Amlogic FBC Basic Layout
+ *
+ * The body is made of 64x32 superblocks of 4096 bytes each, in raster
+ * order. It is followed by the header, made of 32 bytes per 128x64 block.
+ * The header thus starts at (ALIGN(width, 64) / 64) *
+ * (ALIGN(height, 32) / 32) * 4096 bytes from the start of the buffer.
+ */
+#define AMLOGIC_FBC_LAYOUT_BASIC		(1ULL)
+
 #if defined(__cplusplus)
 }
 #endif
@@ -0,0 +1,78 @@
+/* SPDX-License-Identifier: GPL-2.0+ WITH Linux-syscall-note */
+/*
+ * Amlogic Meson video decoder driver - userspace API
+ */
+
+#ifndef _UAPI_LINUX_MESON_VDEC_H
+#define _UAPI_LINUX_MESON_VDEC_H
+
+#include <linux/types.h>
+#include <linux/v4l2-controls.h>
+
+#define V4L2_CID_USER_MESON_VDEC_BASE	(V4L2_CID_USER_BASE + 0x1180)
+
+/*
+ * Ring input mode
+ *
+ * When V4L2_CID_MESON_VDEC_RING_MODE is set before streaming starts, the
+ * OUTPUT queue is bypassed and the VIFIFO the decoder reads from is exposed
+ * directly to userspace. Once both queues are streaming, userspace maps:
+ *
+ *  - MESON_VDEC_RING_DATA_OFFSET: the VIFIFO itself, meson_vdec_ring.size
+ *    bytes long
+ *  - MESON_VDEC_RING_CTRL_OFFSET: one page holding a struct meson_vdec_ring
+ *
+ * @wp and @rp are free-running byte counters: data is written at
+ * (wp % size), and at most (size - (wp - rp)) bytes may be appended before
+ * the decoder catches up. For each access unit, userspace stores a
+ * timestamp along with the value of @wp at the start of the unit in
+ * ts[ts_wp % MESON_VDEC_RING_NUM_TS], then increments @ts_wp. @wp must be
+ * updated last. The driver owns @rp and @ts_rp.
+ *
+ * All counters are reset to 0 on STREAMON. The OUTPUT queue still needs
+ * buffers allocated with VIDIOC_REQBUFS, but none have to be queued.
+ */
+#define V4L2_CID_MESON_VDEC_RING_MODE	(V4L2_CID_USER_MESON_VDEC_BASE + 0)
+
+#define MESON_VDEC_RING_DATA_OFFSET	0x7e000000
+#define MESON_VDEC_RING_CTRL_OFFSET	0x7f000000
+
+#define MESON_VDEC_RING_NUM_TS		128
+
+struct meson_vdec_ring_ts {
+	__u64 timestamp;
+	__u32 offset;
+	__u32 reserved;
+};
+
+struct meson_vdec_ring {
+	__u32 size;
+	__u32 wp;
+	__u32 rp;
+	__u32 ts_wp;
+	__u32 ts_rp;
+	__u32 reserved[3];
+	struct meson_vdec_ring_ts ts[MESON_VDEC_RING_NUM_TS];
+};
+
+/*
+ * Display tunnel
+ *
+ * When V4L2_CID_MESON_VDEC_TUNNEL is set before streaming starts, the
+ * decoded frames are shown on the VD1 plane of the display at their
+ * timestamp instead of being returned to userspace, then recycled to the
+ * decoder. The CAPTURE format must be NV12M, and userspace commits an NV12
+ * framebuffer of the same size to the VD1 plane beforehand: its geometry is
+ * used, its content shows once the session stops.
+ *
+ * The first frame is shown as soon as it is decoded and the next ones
+ * follow at the pace of their timestamps, delayed by
+ * V4L2_CID_MESON_VDEC_TUNNEL_AV_OFFSET microseconds.
+ * V4L2_CID_MESON_VDEC_TUNNEL_PAUSE freezes the picture. Seeking is the
+ * usual OUTPUT STREAMOFF/STREAMON, which drops the frames not shown yet.
+ */
+#define V4L2_CID_MESON_VDEC_TUNNEL		(V4L2_CID_USER_MESON_VDEC_BASE + 1)
+#define V4L2_CID_MESON_VDEC_TUNNEL_PAUSE	(V4L2_CID_USER_MESON_VDEC_BASE + 2)
+#define V4L2_CID_MESON_VDEC_TUNNEL_AV_OFFSET	(V4L2_CID_USER_MESON_VDEC_BASE + 3)
+
+#endif
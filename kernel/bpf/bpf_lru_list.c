@@ -12,6 +12,7 @@
 
 #define LOCAL_FREE_TARGET		(128)
 #define LOCAL_NR_SCANS			LOCAL_FREE_TARGET
+#define LOCAL_STEAL_TARGET		(LOCAL_FREE_TARGET / 8)
 
 #define PERCPU_FREE_TARGET		(4)
 #define PERCPU_NR_SCANS			PERCPU_FREE_TARGET
@@ -269,9 +270,13 @@ static unsigned int __bpf_lru_list_shrink(struct bpf_lru *lru,
 	nshrinked = __bpf_lru_list_shrink_inactive(lru, l, tgt_nshrink,
 						   free_list, tgt_free_type);
 	if (nshrinked)
-		return nshrinked;
+		goto out;
 
-	/* Do a force shrink by ignoring the reference bit */
+	/* Do a force shrink by ignoring the reference bit.  When every
+	 * node is referenced (e.g. a flood of new keys), shrinking only
+	 * one node would send each following pop back here, so take the
+	 * whole batch from the tail at once.
+	 */
 	if (!list_empty(&l->lists[BPF_LRU_LIST_T_INACTIVE]))
 		force_shrink_list = &l->lists[BPF_LRU_LIST_T_INACTIVE];
 	else
@@ -282,11 +287,15 @@ static unsigned int __bpf_lru_list_shrink(struct bpf_lru *lru,
 		if (lru->del_from_htab(lru->del_arg, node)) {
 			__bpf_lru_node_move_to_free(l, node, free_list,
 						    tgt_free_type);
-			return 1;
+			if (++nshrinked == tgt_nshrink)
+				break;
 		}
 	}
 
-	return 0;
+	this_cpu_add(lru->stats->forced, nshrinked);
+out:
+	this_cpu_add(lru->stats->evictions, nshrinked);
+	return nshrinked;
 }
 
 /* Flush the nodes from the local pending list to the LRU list */
@@ -325,7 +334,12 @@ static void bpf_lru_list_pop_free_to_local(struct bpf_lru *lru,
 	struct bpf_lru_node *node, *tmp_node;
 	unsigned int nfree = 0;
 
-	raw_spin_lock(&l->lock);
+	if (!raw_spin_trylock(&l->lock)) {
+		this_cpu_inc(lru->stats->contended);
+		raw_spin_lock(&l->lock);
+	}
+
+	this_cpu_inc(lru->stats->refills);
 
 	__local_list_flush(l, loc_l);
 
@@ -374,6 +388,23 @@ __local_list_pop_free(struct bpf_lru_locallist *loc_l)
 	return node;
 }
 
+/* Move up to LOCAL_STEAL_TARGET nodes from a local free list to @batch */
+static unsigned int __local_list_steal_free(struct bpf_lru_locallist *loc_l,
+					    struct list_head *batch)
+{
+	struct bpf_lru_node *node, *tmp_node;
+	unsigned int nstolen = 0;
+
+	list_for_each_entry_safe(node, tmp_node, local_free_list(loc_l),
+				 list) {
+		list_move(&node->list, batch);
+		if (++nstolen == LOCAL_STEAL_TARGET)
+			break;
+	}
+
+	return nstolen;
+}
+
 static struct bpf_lru_node *
 __local_list_pop_pending(struct bpf_lru *lru, struct bpf_lru_locallist *loc_l)
 {
@@ -437,9 +468,11 @@ static struct bpf_lru_node *bpf_common_lru_pop_free(struct bpf_lru *lru,
 	struct bpf_lru_locallist *loc_l, *steal_loc_l;
 	struct bpf_common_lru *clru = &lru->common_lru;
 	struct bpf_lru_node *node;
+	unsigned int nstolen = 0;
 	int steal, first_steal;
 	unsigned long flags;
 	int cpu = raw_smp_processor_id();
+	LIST_HEAD(stolen);
 
 	loc_l = per_cpu_ptr(clru->local_list, cpu);
 
@@ -464,7 +497,9 @@ static struct bpf_lru_node *bpf_common_lru_pop_free(struct bpf_lru *lru,
 	 *
 	 * Steal from the local free/pending list of the
 	 * current CPU and remote CPU in RR.  It starts
-	 * with the loc_l->next_steal CPU.
+	 * with the loc_l->next_steal CPU.  Free nodes are
+	 * stolen in a batch so that the next pops are
+	 * served from our own local free list again.
 	 */
 
 	first_steal = loc_l->next_steal;
@@ -472,24 +507,41 @@ static struct bpf_lru_node *bpf_common_lru_pop_free(struct bpf_lru *lru,
 	do {
 		steal_loc_l = per_cpu_ptr(clru->local_list, steal);
 
+		/* Racy peek, an empty CPU is not worth taking its lock */
+		if (list_empty(local_free_list(steal_loc_l)) &&
+		    list_empty(local_pending_list(steal_loc_l)))
+			goto next_steal;
+
 		raw_spin_lock_irqsave(&steal_loc_l->lock, flags);
 
-		node = __local_list_pop_free(steal_loc_l);
-		if (!node)
+		nstolen = __local_list_steal_free(steal_loc_l, &stolen);
+		if (!nstolen) {
 			node = __local_list_pop_pending(lru, steal_loc_l);
+			if (node) {
+				list_add(&node->list, &stolen);
+				nstolen = 1;
+			}
+		}
 
 		raw_spin_unlock_irqrestore(&steal_loc_l->lock, flags);
-
+next_steal:
 		steal = get_next_cpu(steal);
-	} while (!node && steal != first_steal);
+	} while (!nstolen && steal != first_steal);
 
 	loc_l->next_steal = steal;
 
-	if (node) {
-		raw_spin_lock_irqsave(&loc_l->lock, flags);
-		__local_list_add_pending(lru, loc_l, cpu, node, hash);
-		raw_spin_unlock_irqrestore(&loc_l->lock, flags);
-	}
+	if (!nstolen)
+		return NULL;
+
+	this_cpu_add(lru->stats->steals, nstolen);
+
+	node = list_first_entry(&stolen, struct bpf_lru_node, list);
+	list_del(&node->list);
+
+	raw_spin_lock_irqsave(&loc_l->lock, flags);
+	list_splice(&stolen, local_free_list(loc_l));
+	__local_list_add_pending(lru, loc_l, cpu, node, hash);
+	raw_spin_unlock_irqrestore(&loc_l->lock, flags);
 
 	return node;
 }
@@ -650,10 +702,14 @@ int bpf_lru_init(struct bpf_lru *lru, bool percpu, u32 hash_offset,
 {
 	int cpu;
 
+	lru->stats = alloc_percpu(struct bpf_lru_stats);
+	if (!lru->stats)
+		return -ENOMEM;
+
 	if (percpu) {
 		lru->percpu_lru = alloc_percpu(struct bpf_lru_list);
 		if (!lru->percpu_lru)
-			return -ENOMEM;
+			goto free_stats;
 
 		for_each_possible_cpu(cpu) {
 			struct bpf_lru_list *l;
@@ -667,7 +723,7 @@ int bpf_lru_init(struct bpf_lru *lru, bool percpu, u32 hash_offset,
 
 		clru->local_list = alloc_percpu(struct bpf_lru_locallist);
 		if (!clru->local_list)
-			return -ENOMEM;
+			goto free_stats;
 
 		for_each_possible_cpu(cpu) {
 			struct bpf_lru_locallist *loc_l;
@@ -686,6 +742,10 @@ int bpf_lru_init(struct bpf_lru *lru, bool percpu, u32 hash_offset,
 	lru->hash_offset = hash_offset;
 
 	return 0;
+
+free_stats:
+	free_percpu(lru->stats);
+	return -ENOMEM;
 }
 
 void bpf_lru_destroy(struct bpf_lru *lru)
@@ -694,4 +754,22 @@ void bpf_lru_destroy(struct bpf_lru *lru)
 		free_percpu(lru->percpu_lru);
 	else
 		free_percpu(lru->common_lru.local_list);
+	free_percpu(lru->stats);
+}
+
+void bpf_lru_stats(const struct bpf_lru *lru, struct bpf_lru_stats *sum)
+{
+	int cpu;
+
+	memset(sum, 0, sizeof(*sum));
+
+	for_each_possible_cpu(cpu) {
+		const struct bpf_lru_stats *s = per_cpu_ptr(lru->stats, cpu);
+
+		sum->refills += s->refills;
+		sum->evictions += s->evictions;
+		sum->forced += s->forced;
+		sum->steals += s->steals;
+		sum->contended += s->contended;
+	}
 }
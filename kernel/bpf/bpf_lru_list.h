@@ -50,6 +50,14 @@ struct bpf_common_lru {
 	struct bpf_lru_locallist __percpu *local_list;
 };
 
+struct bpf_lru_stats {
+	u64 refills;	/* local free list refills from the LRU list */
+	u64 evictions;	/* nodes shrunk from the active/inactive lists */
+	u64 forced;	/* evictions that ignored the ref bit */
+	u64 steals;	/* nodes taken from another CPU's local lists */
+	u64 contended;	/* LRU list lock found taken on refill */
+};
+
 typedef bool (*del_from_htab_func)(void *arg, struct bpf_lru_node *node);
 
 struct bpf_lru {
@@ -57,6 +65,7 @@ struct bpf_lru {
 		struct bpf_common_lru common_lru;
 		struct bpf_lru_list __percpu *percpu_lru;
 	};
+	struct bpf_lru_stats __percpu *stats;
 	del_from_htab_func del_from_htab;
 	void *del_arg;
 	unsigned int hash_offset;
@@ -81,5 +90,6 @@ void bpf_lru_destroy(struct bpf_lru *lru);
 struct bpf_lru_node *bpf_lru_pop_free(struct bpf_lru *lru, u32 hash);
 void bpf_lru_push_free(struct bpf_lru *lru, struct bpf_lru_node *node);
 void bpf_lru_promote(struct bpf_lru *lru, struct bpf_lru_node *node);
+void bpf_lru_stats(const struct bpf_lru *lru, struct bpf_lru_stats *sum);
 
 #endif
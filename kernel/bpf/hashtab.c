@@ -1188,6 +1188,24 @@ static void htab_map_seq_show_elem(struct bpf_map *map, void *key,
 	rcu_read_unlock();
 }
 
+static void htab_lru_map_show_fdinfo(const struct bpf_map *map,
+				     struct seq_file *m)
+{
+	struct bpf_htab *htab = container_of(map, struct bpf_htab, map);
+	struct bpf_lru_stats stats;
+
+	bpf_lru_stats(&htab->lru, &stats);
+
+	seq_printf(m,
+		   "lru_refills:\t%llu\n"
+		   "lru_evictions:\t%llu\n"
+		   "lru_forced:\t%llu\n"
+		   "lru_steals:\t%llu\n"
+		   "lru_contended:\t%llu\n",
+		   stats.refills, stats.evictions, stats.forced,
+		   stats.steals, stats.contended);
+}
+
 const struct bpf_map_ops htab_map_ops = {
 	.map_alloc_check = htab_map_alloc_check,
 	.map_alloc = htab_map_alloc,
@@ -1210,6 +1228,7 @@ const struct bpf_map_ops htab_lru_map_ops = {
 	.map_delete_elem = htab_lru_map_delete_elem,
 	.map_gen_lookup = htab_lru_map_gen_lookup,
 	.map_seq_show_elem = htab_map_seq_show_elem,
+	.map_show_fdinfo = htab_lru_map_show_fdinfo,
 };
 
 /* Called from eBPF program */
@@ -1303,6 +1322,7 @@ const struct bpf_map_ops htab_lru_percpu_map_ops = {
 	.map_lookup_elem = htab_lru_percpu_map_lookup_elem,
 	.map_update_elem = htab_lru_percpu_map_update_elem,
 	.map_delete_elem = htab_lru_map_delete_elem,
+	.map_show_fdinfo = htab_lru_map_show_fdinfo,
 };
 
 static int fd_htab_map_alloc_check(union bpf_attr *attr)
@@ -12,12 +12,16 @@
 #include <linux/elf.h>
 #include <linux/pagemap.h>
 #include <linux/irq_work.h>
+#include <linux/seq_file.h>
 #include "percpu_freelist.h"
 
 #define STACK_CREATE_FLAG_MASK					\
 	(BPF_F_NUMA_NODE | BPF_F_RDONLY | BPF_F_WRONLY |	\
 	 BPF_F_STACK_BUILD_ID)
 
+#define STACK_MAP_CACHE_SIZE		16
+#define STACK_MAP_VMA_CACHE_SIZE	8
+
 struct stack_map_bucket {
 	struct pcpu_freelist_node fnode;
 	u32 hash;
@@ -25,14 +29,64 @@ struct stack_map_bucket {
 	u64 data[];
 };
 
+/*
+ * Per-CPU cache of the build id stacks recently returned by
+ * bpf_get_stackid(). A profiler samples the same stacks over and over, and
+ * a hit returns the id without resolving the build ids again, which is what
+ * makes these maps expensive. The raw ips are identified by two independent
+ * hashes, and the address space by its mm and tgid, as the same ips resolve
+ * differently in another process.
+ */
+struct stack_map_cache_entry {
+	u32 hash;
+	u32 hash2;
+	u32 id;
+	pid_t tgid;
+	struct mm_struct *mm;
+	struct stack_map_bucket *bucket;
+};
+
+struct stack_map_cpu {
+	int busy;		/* entries are being accessed, e.g. before NMI */
+	u64 cache_hits;
+	u64 drops;		/* samples for which no stack id was returned */
+	struct stack_map_cache_entry cache[STACK_MAP_CACHE_SIZE];
+};
+
 struct bpf_stack_map {
 	struct bpf_map map;
 	void *elems;
 	struct pcpu_freelist freelist;
+	struct stack_map_cpu __percpu *cpu;
 	u32 n_buckets;
 	struct stack_map_bucket *buckets[];
 };
 
+/*
+ * Per-CPU cache of the file mappings whose build id was recently resolved,
+ * used before taking mmap_sem and instead of falling back to ips when it
+ * can't be taken. Entries are copies, never vma pointers, and are only
+ * trusted while the mm's vmacache_seqnum, which is bumped whenever a vma is
+ * unmapped or changed, hasn't moved.
+ */
+struct stack_map_vma {
+	struct mm_struct *mm;
+	pid_t tgid;
+	u64 seqnum;
+	unsigned long start;
+	unsigned long end;
+	unsigned long pgoff;
+	unsigned char build_id[BPF_BUILD_ID_SIZE];
+};
+
+struct stack_map_vma_cache {
+	int busy;
+	unsigned int next;
+	struct stack_map_vma vmas[STACK_MAP_VMA_CACHE_SIZE];
+};
+
+static DEFINE_PER_CPU(struct stack_map_vma_cache, stack_map_vma_cache);
+
 /* irq_work to run up_read() for build_id lookup in nmi context */
 struct stack_map_irq_work {
 	struct irq_work irq_work;
@@ -125,6 +179,7 @@ static struct bpf_map *stack_map_alloc(union bpf_attr *attr)
 
 	err = -E2BIG;
 	cost += n_buckets * (value_size + sizeof(struct stack_map_bucket));
+	cost += (u64)sizeof(struct stack_map_cpu) * num_possible_cpus();
 	if (cost >= U32_MAX - PAGE_SIZE)
 		goto free_smap;
 
@@ -137,9 +192,14 @@ static struct bpf_map *stack_map_alloc(union bpf_attr *attr)
 	if (err)
 		goto free_smap;
 
+	err = -ENOMEM;
+	smap->cpu = alloc_percpu(struct stack_map_cpu);
+	if (!smap->cpu)
+		goto free_smap;
+
 	err = get_callchain_buffers(sysctl_perf_event_max_stack);
 	if (err)
-		goto free_smap;
+		goto free_cpu;
 
 	err = prealloc_elems_and_freelist(smap);
 	if (err)
@@ -149,6 +209,8 @@ static struct bpf_map *stack_map_alloc(union bpf_attr *attr)
 
 put_buffers:
 	put_callchain_buffers();
+free_cpu:
+	free_percpu(smap->cpu);
 free_smap:
 	bpf_map_area_free(smap);
 	return ERR_PTR(err);
@@ -280,6 +342,83 @@ out:
 	return ret;
 }
 
+/*
+ * Resolve the ips found in the per-CPU vma cache, and set the others to
+ * fall back to ips. Returns the number of ips left unresolved.
+ */
+static u32 stack_map_build_id_cached(struct bpf_stack_build_id *id_offs,
+				     u64 *ips, u32 trace_nr)
+{
+	struct stack_map_vma_cache *vc = this_cpu_ptr(&stack_map_vma_cache);
+	struct mm_struct *mm = current->mm;
+	u64 seqnum = READ_ONCE(mm->vmacache_seqnum);
+	pid_t tgid = task_tgid_nr(current);
+	struct stack_map_vma *v;
+	u32 i, j, left = 0;
+
+	for (i = 0; i < trace_nr; i++) {
+		id_offs[i].status = BPF_STACK_BUILD_ID_IP;
+		id_offs[i].ip = ips[i];
+	}
+
+	/* interrupted an update of the cache */
+	if (this_cpu_inc_return(stack_map_vma_cache.busy) != 1) {
+		left = trace_nr;
+		goto out;
+	}
+
+	for (i = 0; i < trace_nr; i++) {
+		for (j = 0; j < STACK_MAP_VMA_CACHE_SIZE; j++) {
+			v = &vc->vmas[j];
+			if (v->mm == mm && v->tgid == tgid &&
+			    v->seqnum == seqnum &&
+			    ips[i] >= v->start && ips[i] < v->end)
+				break;
+		}
+		if (j == STACK_MAP_VMA_CACHE_SIZE) {
+			left++;
+			continue;
+		}
+		memcpy(id_offs[i].build_id, v->build_id, BPF_BUILD_ID_SIZE);
+		id_offs[i].offset = (v->pgoff << PAGE_SHIFT) + ips[i] - v->start;
+		id_offs[i].status = BPF_STACK_BUILD_ID_VALID;
+	}
+out:
+	this_cpu_dec(stack_map_vma_cache.busy);
+	return left;
+}
+
+/* Called with mmap_sem held, after resolving the build id of @vma */
+static void stack_map_build_id_cache_add(struct vm_area_struct *vma,
+					 const unsigned char *build_id)
+{
+	struct stack_map_vma_cache *vc = this_cpu_ptr(&stack_map_vma_cache);
+	struct stack_map_vma *v;
+	u32 j;
+
+	if (this_cpu_inc_return(stack_map_vma_cache.busy) != 1)
+		goto out;
+
+	/* the next ips are likely in a vma which was just added */
+	for (j = 0; j < STACK_MAP_VMA_CACHE_SIZE; j++) {
+		v = &vc->vmas[j];
+		if (v->mm == vma->vm_mm && v->start == vma->vm_start &&
+		    v->seqnum == vma->vm_mm->vmacache_seqnum)
+			goto out;
+	}
+
+	v = &vc->vmas[vc->next++ % STACK_MAP_VMA_CACHE_SIZE];
+	v->mm = vma->vm_mm;
+	v->tgid = task_tgid_nr(current);
+	v->seqnum = vma->vm_mm->vmacache_seqnum;
+	v->start = vma->vm_start;
+	v->end = vma->vm_end;
+	v->pgoff = vma->vm_pgoff;
+	memcpy(v->build_id, build_id, BPF_BUILD_ID_SIZE);
+out:
+	this_cpu_dec(stack_map_vma_cache.busy);
+}
+
 static void stack_map_get_build_id_offset(struct bpf_stack_build_id *id_offs,
 					  u64 *ips, u32 trace_nr, bool user)
 {
@@ -288,6 +427,23 @@ static void stack_map_get_build_id_offset(struct bpf_stack_build_id *id_offs,
 	bool irq_work_busy = false;
 	struct stack_map_irq_work *work = NULL;
 
+	/*
+	 * Kernel stacks (!user) on a stackmap with build_id fall back to
+	 * report ips.
+	 */
+	if (!user || !current || !current->mm) {
+		/* cannot access current->mm, fall back to ips */
+		for (i = 0; i < trace_nr; i++) {
+			id_offs[i].status = BPF_STACK_BUILD_ID_IP;
+			id_offs[i].ip = ips[i];
+		}
+		return;
+	}
+
+	/* most ips are in vmas resolved recently, which needs no lock */
+	if (!stack_map_build_id_cached(id_offs, ips, trace_nr))
+		return;
+
 	if (in_nmi()) {
 		work = this_cpu_ptr(&up_read_work);
 		if (work->irq_work.flags & IRQ_WORK_BUSY)
@@ -299,24 +455,18 @@ static void stack_map_get_build_id_offset(struct bpf_stack_build_id *id_offs,
 	 * We cannot do up_read() in nmi context. To do build_id lookup
 	 * in nmi context, we need to run up_read() in irq_work. We use
 	 * a percpu variable to do the irq_work. If the irq_work is
-	 * already used by another lookup, we fall back to report ips.
-	 *
-	 * Same fallback is used for kernel stack (!user) on a stackmap
-	 * with build_id.
+	 * already used by another lookup, the ips not found in the vma
+	 * cache keep reporting ips.
 	 */
-	if (!user || !current || !current->mm || irq_work_busy ||
-	    down_read_trylock(&current->mm->mmap_sem) == 0) {
-		/* cannot access current->mm, fall back to ips */
-		for (i = 0; i < trace_nr; i++) {
-			id_offs[i].status = BPF_STACK_BUILD_ID_IP;
-			id_offs[i].ip = ips[i];
-		}
+	if (irq_work_busy || down_read_trylock(&current->mm->mmap_sem) == 0)
 		return;
-	}
 
 	for (i = 0; i < trace_nr; i++) {
+		if (id_offs[i].status == BPF_STACK_BUILD_ID_VALID)
+			continue;
 		vma = find_vma(current->mm, ips[i]);
-		if (!vma || stack_map_get_build_id(vma, id_offs[i].build_id)) {
+		if (!vma || ips[i] < vma->vm_start ||
+		    stack_map_get_build_id(vma, id_offs[i].build_id)) {
 			/* per entry fall back to ips */
 			id_offs[i].status = BPF_STACK_BUILD_ID_IP;
 			id_offs[i].ip = ips[i];
@@ -325,6 +475,7 @@ static void stack_map_get_build_id_offset(struct bpf_stack_build_id *id_offs,
 		id_offs[i].offset = (vma->vm_pgoff << PAGE_SHIFT) + ips[i]
 			- vma->vm_start;
 		id_offs[i].status = BPF_STACK_BUILD_ID_VALID;
+		stack_map_build_id_cache_add(vma, id_offs[i].build_id);
 	}
 
 	if (!work) {
@@ -335,8 +486,48 @@ static void stack_map_get_build_id_offset(struct bpf_stack_build_id *id_offs,
 	}
 }
 
-BPF_CALL_3(bpf_get_stackid, struct pt_regs *, regs, struct bpf_map *, map,
-	   u64, flags)
+static bool stack_map_cache_find(struct bpf_stack_map *smap, u32 hash,
+				 u32 hash2, struct mm_struct *mm, pid_t tgid,
+				 u32 *id)
+{
+	struct stack_map_cpu *c = this_cpu_ptr(smap->cpu);
+	struct stack_map_cache_entry *e = &c->cache[hash % STACK_MAP_CACHE_SIZE];
+	bool found = false;
+
+	/* the bucket must not have been replaced since it was cached */
+	if (this_cpu_inc_return(smap->cpu->busy) == 1 &&
+	    e->bucket && e->hash == hash && e->hash2 == hash2 &&
+	    e->mm == mm && e->tgid == tgid &&
+	    READ_ONCE(smap->buckets[e->id]) == e->bucket &&
+	    e->bucket->hash == hash) {
+		*id = e->id;
+		c->cache_hits++;
+		found = true;
+	}
+	this_cpu_dec(smap->cpu->busy);
+	return found;
+}
+
+static void stack_map_cache_add(struct bpf_stack_map *smap, u32 hash,
+				u32 hash2, struct mm_struct *mm, pid_t tgid,
+				u32 id, struct stack_map_bucket *bucket)
+{
+	struct stack_map_cpu *c = this_cpu_ptr(smap->cpu);
+	struct stack_map_cache_entry *e = &c->cache[hash % STACK_MAP_CACHE_SIZE];
+
+	if (this_cpu_inc_return(smap->cpu->busy) == 1) {
+		e->hash = hash;
+		e->hash2 = hash2;
+		e->mm = mm;
+		e->tgid = tgid;
+		e->id = id;
+		e->bucket = bucket;
+	}
+	this_cpu_dec(smap->cpu->busy);
+}
+
+static long __bpf_get_stackid(struct pt_regs *regs, struct bpf_map *map,
+			      u64 flags)
 {
 	struct bpf_stack_map *smap = container_of(map, struct bpf_stack_map, map);
 	struct perf_callchain_entry *trace;
@@ -345,9 +536,11 @@ BPF_CALL_3(bpf_get_stackid, struct pt_regs *, regs, struct bpf_map *, map,
 	/* stack_map_alloc() checks that max_depth <= sysctl_perf_event_max_stack */
 	u32 init_nr = sysctl_perf_event_max_stack - max_depth;
 	u32 skip = flags & BPF_F_SKIP_FIELD_MASK;
-	u32 hash, id, trace_nr, trace_len;
+	u32 hash, hash2 = 0, id, trace_nr, trace_len;
 	bool user = flags & BPF_F_USER_STACK;
 	bool kernel = !user;
+	struct mm_struct *mm = NULL;
+	pid_t tgid = 0;
 	u64 *ips;
 	bool hash_matches;
 
@@ -384,6 +577,14 @@ BPF_CALL_3(bpf_get_stackid, struct pt_regs *, regs, struct bpf_map *, map,
 		return id;
 
 	if (stack_map_use_build_id(map)) {
+		if (user) {
+			mm = current->mm;
+			tgid = task_tgid_nr(current);
+		}
+		hash2 = jhash2((u32 *)ips, trace_len / sizeof(u32), 0x5bd1e995);
+		if (stack_map_cache_find(smap, hash, hash2, mm, tgid, &id))
+			return id;
+
 		/* for build_id+offset, pop a bucket before slow cmp */
 		new_bucket = (struct stack_map_bucket *)
 			pcpu_freelist_pop(&smap->freelist);
@@ -397,6 +598,7 @@ BPF_CALL_3(bpf_get_stackid, struct pt_regs *, regs, struct bpf_map *, map,
 		if (hash_matches && bucket->nr == trace_nr &&
 		    memcmp(bucket->data, new_bucket->data, trace_len) == 0) {
 			pcpu_freelist_push(&smap->freelist, &new_bucket->fnode);
+			stack_map_cache_add(smap, hash, hash2, mm, tgid, id, bucket);
 			return id;
 		}
 		if (bucket && !(flags & BPF_F_REUSE_STACKID)) {
@@ -423,9 +625,22 @@ BPF_CALL_3(bpf_get_stackid, struct pt_regs *, regs, struct bpf_map *, map,
 	old_bucket = xchg(&smap->buckets[id], new_bucket);
 	if (old_bucket)
 		pcpu_freelist_push(&smap->freelist, &old_bucket->fnode);
+	if (stack_map_use_build_id(map))
+		stack_map_cache_add(smap, hash, hash2, mm, tgid, id, new_bucket);
 	return id;
 }
 
+BPF_CALL_3(bpf_get_stackid, struct pt_regs *, regs, struct bpf_map *, map,
+	   u64, flags)
+{
+	struct bpf_stack_map *smap = container_of(map, struct bpf_stack_map, map);
+	long ret = __bpf_get_stackid(regs, map, flags);
+
+	if (ret < 0)
+		this_cpu_inc(smap->cpu->drops);
+	return ret;
+}
+
 const struct bpf_func_proto bpf_get_stackid_proto = {
 	.func		= bpf_get_stackid,
 	.gpl_only	= true,
@@ -596,10 +811,27 @@ static void stack_map_free(struct bpf_map *map)
 
 	bpf_map_area_free(smap->elems);
 	pcpu_freelist_destroy(&smap->freelist);
+	free_percpu(smap->cpu);
 	bpf_map_area_free(smap);
 	put_callchain_buffers();
 }
 
+static void stack_map_show_fdinfo(const struct bpf_map *map,
+				  struct seq_file *m)
+{
+	struct bpf_stack_map *smap = container_of(map, struct bpf_stack_map, map);
+	u64 drops = 0, hits = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		drops += per_cpu_ptr(smap->cpu, cpu)->drops;
+		hits += per_cpu_ptr(smap->cpu, cpu)->cache_hits;
+	}
+
+	seq_printf(m, "stack_drops:\t%llu\n", drops);
+	seq_printf(m, "stack_cache_hits:\t%llu\n", hits);
+}
+
 const struct bpf_map_ops stack_map_ops = {
 	.map_alloc = stack_map_alloc,
 	.map_free = stack_map_free,
@@ -608,6 +840,7 @@ const struct bpf_map_ops stack_map_ops = {
 	.map_update_elem = stack_map_update_elem,
 	.map_delete_elem = stack_map_delete_elem,
 	.map_check_btf = map_check_no_btf,
+	.map_show_fdinfo = stack_map_show_fdinfo,
 };
 
 static int __init stack_map_init(void)
@@ -3416,6 +3416,12 @@ static int cpu_stat_show(struct seq_file *seq, void *v)
 	return ret;
 }
 
+static int cpu_stat_children_show(struct seq_file *seq, void *v)
+{
+	cgroup_base_stat_children_show(seq);
+	return 0;
+}
+
 static int cgroup_file_open(struct kernfs_open_file *of)
 {
 	struct cftype *cft = of->kn->priv;
@@ -4546,6 +4552,10 @@ static struct cftype cgroup_base_files[] = {
 		.flags = CFTYPE_NOT_ON_ROOT,
 		.seq_show = cpu_stat_show,
 	},
+	{
+		.name = "cpu.stat.children",
+		.seq_show = cpu_stat_children_show,
+	},
 	{ }	/* terminate */
 };
 
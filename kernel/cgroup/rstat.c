@@ -2,6 +2,12 @@
 
 #include <linux/sched/cputime.h>
 
+/*
+ * Reads of the same cgroup's stats within this many jiffies reuse the
+ * previous flush instead of walking the updated trees again.
+ */
+#define CGROUP_RSTAT_READ_INTERVAL	max(HZ / 100, 1)
+
 static DEFINE_SPINLOCK(cgroup_rstat_lock);
 static DEFINE_PER_CPU(raw_spinlock_t, cgroup_rstat_cpu_lock);
 
@@ -62,6 +68,8 @@ void cgroup_rstat_updated(struct cgroup *cgrp, int cpu)
 
 		rstatc->updated_next = prstatc->updated_children;
 		prstatc->updated_children = cgrp;
+		cpumask_set_cpu(cpu, cgrp->rstat_updated_cpus);
+		cpumask_set_cpu(cpu, parent->rstat_updated_cpus);
 	}
 
 	raw_spin_unlock_irqrestore(cpu_lock, flags);
@@ -81,7 +89,9 @@ EXPORT_SYMBOL_GPL(cgroup_rstat_updated);
  *
  * The only ordering guarantee is that, for a parent and a child pair
  * covered by a given traversal, if a child is visited, its parent is
- * guaranteed to be visited afterwards.
+ * guaranteed to be visited afterwards.  As a cgroup is only returned once
+ * its whole subtree is off the tree, @cpu is cleared in its
+ * ->rstat_updated_cpus at that point.
  */
 static struct cgroup *cgroup_rstat_cpu_pop_updated(struct cgroup *pos,
 						   struct cgroup *root, int cpu)
@@ -142,6 +152,7 @@ static struct cgroup *cgroup_rstat_cpu_pop_updated(struct cgroup *pos,
 		smp_mb();
 	}
 
+	cpumask_clear_cpu(cpu, pos->rstat_updated_cpus);
 	return pos;
 }
 
@@ -153,7 +164,10 @@ static void cgroup_rstat_flush_locked(struct cgroup *cgrp, bool may_sleep)
 
 	lockdep_assert_held(&cgroup_rstat_lock);
 
-	for_each_possible_cpu(cpu) {
+	cgrp->rstat_flush_time = jiffies;
+
+	/* CPUs without updates in the subtree have nothing to flush */
+	for_each_cpu(cpu, cgrp->rstat_updated_cpus) {
 		raw_spinlock_t *cpu_lock = per_cpu_ptr(&cgroup_rstat_cpu_lock,
 						       cpu);
 		struct cgroup *pos = NULL;
@@ -246,17 +260,39 @@ void cgroup_rstat_flush_release(void)
 	spin_unlock_irq(&cgroup_rstat_lock);
 }
 
+/*
+ * Like cgroup_rstat_flush_hold() but skip the flush if @cgrp was flushed
+ * less than CGROUP_RSTAT_READ_INTERVAL ago, for the stat file readers.
+ */
+static void cgroup_rstat_flush_hold_ratelimited(struct cgroup *cgrp)
+	__acquires(&cgroup_rstat_lock)
+{
+	might_sleep();
+	spin_lock_irq(&cgroup_rstat_lock);
+	if (time_after_eq(jiffies, cgrp->rstat_flush_time +
+			  CGROUP_RSTAT_READ_INTERVAL))
+		cgroup_rstat_flush_locked(cgrp, true);
+}
+
 int cgroup_rstat_init(struct cgroup *cgrp)
 {
 	int cpu;
 
+	if (!zalloc_cpumask_var(&cgrp->rstat_updated_cpus, GFP_KERNEL))
+		return -ENOMEM;
+
 	/* the root cgrp has rstat_cpu preallocated */
 	if (!cgrp->rstat_cpu) {
 		cgrp->rstat_cpu = alloc_percpu(struct cgroup_rstat_cpu);
-		if (!cgrp->rstat_cpu)
+		if (!cgrp->rstat_cpu) {
+			free_cpumask_var(cgrp->rstat_updated_cpus);
 			return -ENOMEM;
+		}
 	}
 
+	/* never flushed, the first read must not be rate limited */
+	cgrp->rstat_flush_time = jiffies - CGROUP_RSTAT_READ_INTERVAL;
+
 	/* ->updated_children list is self terminated */
 	for_each_possible_cpu(cpu) {
 		struct cgroup_rstat_cpu *rstatc = cgroup_rstat_cpu(cgrp, cpu);
@@ -285,6 +321,7 @@ void cgroup_rstat_exit(struct cgroup *cgrp)
 
 	free_percpu(cgrp->rstat_cpu);
 	cgrp->rstat_cpu = NULL;
+	free_cpumask_var(cgrp->rstat_updated_cpus);
 }
 
 void __init cgroup_rstat_boot(void)
@@ -392,6 +429,20 @@ void __cgroup_account_cputime_field(struct cgroup *cgrp,
 	cgroup_base_stat_cputime_account_end(cgrp, rstatc);
 }
 
+/* must be called with cgroup_rstat_lock held, values are in usecs */
+static void cgroup_base_stat_cputime_read(struct cgroup *cgrp, u64 *usage,
+					  u64 *utime, u64 *stime)
+{
+	lockdep_assert_held(&cgroup_rstat_lock);
+
+	*usage = cgrp->bstat.cputime.sum_exec_runtime;
+	cputime_adjust(&cgrp->bstat.cputime, &cgrp->prev_cputime, utime, stime);
+
+	do_div(*usage, NSEC_PER_USEC);
+	do_div(*utime, NSEC_PER_USEC);
+	do_div(*stime, NSEC_PER_USEC);
+}
+
 void cgroup_base_stat_cputime_show(struct seq_file *seq)
 {
 	struct cgroup *cgrp = seq_css(seq)->cgroup;
@@ -400,17 +451,44 @@ void cgroup_base_stat_cputime_show(struct seq_file *seq)
 	if (!cgroup_parent(cgrp))
 		return;
 
-	cgroup_rstat_flush_hold(cgrp);
-	usage = cgrp->bstat.cputime.sum_exec_runtime;
-	cputime_adjust(&cgrp->bstat.cputime, &cgrp->prev_cputime, &utime, &stime);
+	cgroup_rstat_flush_hold_ratelimited(cgrp);
+	cgroup_base_stat_cputime_read(cgrp, &usage, &utime, &stime);
 	cgroup_rstat_flush_release();
 
-	do_div(usage, NSEC_PER_USEC);
-	do_div(utime, NSEC_PER_USEC);
-	do_div(stime, NSEC_PER_USEC);
-
 	seq_printf(seq, "usage_usec %llu\n"
 		   "user_usec %llu\n"
 		   "system_usec %llu\n",
 		   usage, utime, stime);
 }
+
+/*
+ * Show the base cputime stats of all the online children in nested keyed
+ * format, so that monitoring many cgroups takes a single read and a single
+ * flush of their parent's subtree.
+ */
+void cgroup_base_stat_children_show(struct seq_file *seq)
+{
+	struct cgroup *cgrp = seq_css(seq)->cgroup;
+	struct cgroup_subsys_state *css;
+	u64 usage, utime, stime;
+	char name[NAME_MAX + 1];
+
+	cgroup_rstat_flush_hold_ratelimited(cgrp);
+	cgroup_rstat_flush_release();
+
+	rcu_read_lock();
+	css_for_each_child(css, &cgrp->self) {
+		if (!(css->flags & CSS_ONLINE))
+			continue;
+
+		spin_lock_irq(&cgroup_rstat_lock);
+		cgroup_base_stat_cputime_read(css->cgroup, &usage, &utime,
+					      &stime);
+		spin_unlock_irq(&cgroup_rstat_lock);
+
+		cgroup_name(css->cgroup, name, sizeof(name));
+		seq_printf(seq, "%s usage_usec=%llu user_usec=%llu system_usec=%llu\n",
+			   name, usage, utime, stime);
+	}
+	rcu_read_unlock();
+}
@@ -23,6 +23,11 @@
 #include <linux/sizes.h>
 #include <linux/dma-contiguous.h>
 #include <linux/cma.h>
+#include <linux/ktime.h>
+#include <linux/slab.h>
+#include <linux/workqueue.h>
+
+#include <trace/events/cma.h>
 
 #ifdef CONFIG_CMA_SIZE_MBYTES
 #define CMA_SIZE_MBYTES CONFIG_CMA_SIZE_MBYTES
@@ -177,6 +182,215 @@ int __init dma_contiguous_reserve_area(phys_addr_t size, phys_addr_t base,
 	return 0;
 }
 
+/*
+ * Warm pools
+ *
+ * Allocating from CMA migrates the movable pages out of the range first,
+ * which takes tens to hundreds of milliseconds for buffers of several MiB.
+ * A device which allocates large buffers at a predictable time (typically
+ * when a stream starts) can ask for a few chunks to be kept allocated, and
+ * thus already evacuated, ahead of time. Requests which fit in a chunk are
+ * served from the pool, the unused tail of the chunk going straight back to
+ * CMA, and the pool is refilled once the device has stopped allocating.
+ */
+#define DMA_CONTIGUOUS_REFILL_DELAY	HZ
+
+struct dma_contiguous_pool {
+	struct list_head	list;
+	struct device		*dev;
+	struct cma		*cma;
+	size_t			count;
+	unsigned int		align;
+	unsigned int		target;
+	unsigned int		nr;
+	struct page		**pages;
+	struct mutex		lock;
+	struct delayed_work	refill;
+};
+
+static LIST_HEAD(dma_contiguous_pools);
+static DEFINE_MUTEX(dma_contiguous_pools_lock);
+
+static struct dma_contiguous_pool *dma_contiguous_find_pool(struct device *dev)
+{
+	struct dma_contiguous_pool *pool;
+
+	list_for_each_entry(pool, &dma_contiguous_pools, list)
+		if (pool->dev == dev)
+			return pool;
+
+	return NULL;
+}
+
+static struct page *dma_contiguous_alloc_traced(struct device *dev,
+						struct cma *cma, size_t count,
+						unsigned int align,
+						bool no_warn)
+{
+	ktime_t start = ktime_get();
+	struct page *page;
+
+	page = cma_alloc(cma, count, align, no_warn);
+	trace_cma_alloc_cost(dev, page ? page_to_pfn(page) : -1UL, count,
+			     align, ktime_to_ns(ktime_sub(ktime_get(), start)),
+			     false);
+
+	return page;
+}
+
+static void dma_contiguous_pool_refill(struct work_struct *work)
+{
+	struct dma_contiguous_pool *pool =
+		container_of(work, struct dma_contiguous_pool, refill.work);
+	struct page *page;
+
+	mutex_lock(&pool->lock);
+	while (pool->nr < pool->target) {
+		mutex_unlock(&pool->lock);
+
+		page = dma_contiguous_alloc_traced(pool->dev, pool->cma,
+						   pool->count, pool->align,
+						   true);
+		if (!page)
+			return;
+
+		mutex_lock(&pool->lock);
+		if (pool->nr < pool->target)
+			pool->pages[pool->nr++] = page;
+		else
+			cma_release(pool->cma, page, pool->count);
+	}
+	mutex_unlock(&pool->lock);
+}
+
+static void dma_contiguous_pool_destroy(struct dma_contiguous_pool *pool)
+{
+	cancel_delayed_work_sync(&pool->refill);
+	while (pool->nr)
+		cma_release(pool->cma, pool->pages[--pool->nr], pool->count);
+	kfree(pool->pages);
+	kfree(pool);
+}
+
+/**
+ * dma_contiguous_set_warm_pool() - keep evacuated chunks ready for a device
+ * @dev:    Pointer to device for which the chunks are kept.
+ * @count:  Size of a chunk (in pages).
+ * @align:  Alignment of the chunks (in PAGE_SIZE order).
+ * @target: Number of chunks to keep, 0 to drop the pool.
+ *
+ * Allocations of up to @count pages with an alignment of up to @align for
+ * @dev are then served from the pool when it is not empty. The chunks are
+ * taken from the contiguous area of @dev in the background. A driver setting
+ * a pool must drop it before being unbound.
+ */
+int dma_contiguous_set_warm_pool(struct device *dev, size_t count,
+				 unsigned int align, unsigned int target)
+{
+	struct cma *cma = dev_get_cma_area(dev);
+	struct dma_contiguous_pool *pool, *old;
+
+	if (target && (!cma || !count))
+		return -EINVAL;
+
+	if (align > CONFIG_CMA_ALIGNMENT)
+		align = CONFIG_CMA_ALIGNMENT;
+
+	pool = NULL;
+	if (target) {
+		pool = kzalloc(sizeof(*pool), GFP_KERNEL);
+		if (!pool)
+			return -ENOMEM;
+		pool->pages = kcalloc(target, sizeof(*pool->pages),
+				      GFP_KERNEL);
+		if (!pool->pages) {
+			kfree(pool);
+			return -ENOMEM;
+		}
+		pool->dev = dev;
+		pool->cma = cma;
+		pool->count = count;
+		pool->align = align;
+		pool->target = target;
+		mutex_init(&pool->lock);
+		INIT_DELAYED_WORK(&pool->refill, dma_contiguous_pool_refill);
+	}
+
+	mutex_lock(&dma_contiguous_pools_lock);
+	old = dma_contiguous_find_pool(dev);
+	if (old)
+		list_del(&old->list);
+	if (pool) {
+		list_add(&pool->list, &dma_contiguous_pools);
+		queue_delayed_work(system_long_wq, &pool->refill, 0);
+	}
+	mutex_unlock(&dma_contiguous_pools_lock);
+
+	if (old)
+		dma_contiguous_pool_destroy(old);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(dma_contiguous_set_warm_pool);
+
+static struct page *dma_contiguous_pool_get(struct device *dev, size_t count,
+					    unsigned int align)
+{
+	struct dma_contiguous_pool *pool;
+	struct page *page = NULL;
+
+	mutex_lock(&dma_contiguous_pools_lock);
+	pool = dma_contiguous_find_pool(dev);
+	if (!pool || count > pool->count || align > pool->align)
+		goto out;
+
+	mutex_lock(&pool->lock);
+	if (pool->nr)
+		page = pool->pages[--pool->nr];
+	mutex_unlock(&pool->lock);
+
+	/* Refill once the burst of allocations is over */
+	mod_delayed_work(system_long_wq, &pool->refill,
+			 DMA_CONTIGUOUS_REFILL_DELAY);
+	if (!page)
+		goto out;
+
+	if (count < pool->count)
+		cma_release(pool->cma, page + count, pool->count - count);
+	trace_cma_alloc_cost(dev, page_to_pfn(page), count, align, 0, true);
+out:
+	mutex_unlock(&dma_contiguous_pools_lock);
+	return page;
+}
+
+static bool dma_contiguous_pool_put(struct device *dev, struct page *pages,
+				    size_t count)
+{
+	struct dma_contiguous_pool *pool;
+	unsigned long pfn = page_to_pfn(pages);
+	bool kept = false;
+
+	mutex_lock(&dma_contiguous_pools_lock);
+	pool = dma_contiguous_find_pool(dev);
+	if (!pool || count != pool->count)
+		goto out;
+
+	if (pfn < PFN_DOWN(cma_get_base(pool->cma)) ||
+	    pfn + count > PFN_DOWN(cma_get_base(pool->cma) +
+				   cma_get_size(pool->cma)))
+		goto out;
+
+	mutex_lock(&pool->lock);
+	if (pool->nr < pool->target) {
+		pool->pages[pool->nr++] = pages;
+		kept = true;
+	}
+	mutex_unlock(&pool->lock);
+out:
+	mutex_unlock(&dma_contiguous_pools_lock);
+	return kept;
+}
+
 /**
  * dma_alloc_from_contiguous() - allocate pages from contiguous area
  * @dev:   Pointer to device for which the allocation is performed.
@@ -192,10 +406,19 @@ int __init dma_contiguous_reserve_area(phys_addr_t size, phys_addr_t base,
 struct page *dma_alloc_from_contiguous(struct device *dev, size_t count,
 				       unsigned int align, bool no_warn)
 {
+	struct page *page;
+
 	if (align > CONFIG_CMA_ALIGNMENT)
 		align = CONFIG_CMA_ALIGNMENT;
 
-	return cma_alloc(dev_get_cma_area(dev), count, align, no_warn);
+	if (!list_empty(&dma_contiguous_pools)) {
+		page = dma_contiguous_pool_get(dev, count, align);
+		if (page)
+			return page;
+	}
+
+	return dma_contiguous_alloc_traced(dev, dev_get_cma_area(dev), count,
+					   align, no_warn);
 }
 
 /**
@@ -211,6 +434,10 @@ struct page *dma_alloc_from_contiguous(struct device *dev, size_t count,
 bool dma_release_from_contiguous(struct device *dev, struct page *pages,
 				 int count)
 {
+	if (!list_empty(&dma_contiguous_pools) && pages &&
+	    dma_contiguous_pool_put(dev, pages, count))
+		return true;
+
 	return cma_release(dev_get_cma_area(dev), pages, count);
 }
 
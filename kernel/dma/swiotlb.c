@@ -20,6 +20,7 @@
 #define pr_fmt(fmt) "software IO TLB: " fmt
 
 #include <linux/cache.h>
+#include <linux/debugfs.h>
 #include <linux/dma-direct.h>
 #include <linux/mm.h>
 #include <linux/export.h>
@@ -32,6 +33,8 @@
 #include <linux/highmem.h>
 #include <linux/gfp.h>
 #include <linux/scatterlist.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
 #include <linux/mem_encrypt.h>
 #include <linux/set_memory.h>
 
@@ -84,7 +87,25 @@ static phys_addr_t io_tlb_overflow_buffer;
  * each index
  */
 static unsigned int *io_tlb_list;
-static unsigned int io_tlb_index;
+
+/*
+ * The slabs are split in areas of io_tlb_area_nslabs, the last one taking
+ * the remainder, each with its own lock and search hint. Mappings are
+ * allocated from the area of the current CPU and spill over to the next
+ * ones when it is full. Areas start on an IO_TLB_SEGSIZE boundary, which
+ * the free list never merges across, so an area lock covers all the
+ * io_tlb_list entries of its slabs.
+ */
+struct io_tlb_area {
+	spinlock_t	lock;
+	unsigned int	index;		/* where to start the next search */
+	unsigned int	used;		/* slabs currently mapped */
+	unsigned int	high;		/* highest value of used */
+} ____cacheline_aligned_in_smp;
+
+static struct io_tlb_area *io_tlb_areas;
+static unsigned int io_tlb_nareas;
+static unsigned long io_tlb_area_nslabs;
 
 /*
  * Max segment that we can provide which (if pages are contingous) will
@@ -99,11 +120,6 @@ unsigned int max_segment;
 #define INVALID_PHYS_ADDR (~(phys_addr_t)0)
 static phys_addr_t *io_tlb_orig_addr;
 
-/*
- * Protect the above data structures in the map and unmap calls
- */
-static DEFINE_SPINLOCK(io_tlb_lock);
-
 static int late_alloc;
 
 static int __init
@@ -128,6 +144,57 @@ setup_io_tlb_npages(char *str)
 early_param("swiotlb", setup_io_tlb_npages);
 /* make io_tlb_overflow tunable too? */
 
+/*
+ * One area per possible CPU, rounded to a power of two, as long as each
+ * area holds at least one IO_TLB_SEGSIZE segment.
+ */
+static unsigned int swiotlb_nareas(unsigned long nslabs)
+{
+	unsigned int nareas = roundup_pow_of_two(num_possible_cpus());
+
+	while (nareas > 1 && nslabs / nareas < IO_TLB_SEGSIZE)
+		nareas >>= 1;
+
+	return nareas;
+}
+
+static void swiotlb_init_areas(struct io_tlb_area *areas, unsigned int nareas)
+{
+	unsigned int i;
+
+	io_tlb_areas = areas;
+	io_tlb_nareas = nareas;
+	if (nareas > 1)
+		io_tlb_area_nslabs = rounddown(io_tlb_nslabs / nareas,
+					       IO_TLB_SEGSIZE);
+	else
+		io_tlb_area_nslabs = io_tlb_nslabs;
+
+	for (i = 0; i < nareas; i++) {
+		spin_lock_init(&areas[i].lock);
+		areas[i].index = i * io_tlb_area_nslabs;
+		areas[i].used = 0;
+		areas[i].high = 0;
+	}
+}
+
+static inline unsigned int swiotlb_area_start(unsigned int area)
+{
+	return area * io_tlb_area_nslabs;
+}
+
+static inline unsigned int swiotlb_area_end(unsigned int area)
+{
+	return area == io_tlb_nareas - 1 ? io_tlb_nslabs :
+	       (area + 1) * io_tlb_area_nslabs;
+}
+
+static inline unsigned int swiotlb_area_of(unsigned int index)
+{
+	return min_t(unsigned int, index / io_tlb_area_nslabs,
+		     io_tlb_nareas - 1);
+}
+
 unsigned long swiotlb_nr_tbl(void)
 {
 	return io_tlb_nslabs;
@@ -205,6 +272,7 @@ int __init swiotlb_init_with_tbl(char *tlb, unsigned long nslabs, int verbose)
 {
 	void *v_overflow_buffer;
 	unsigned long i, bytes;
+	unsigned int nareas;
 
 	bytes = nslabs << IO_TLB_SHIFT;
 
@@ -238,7 +306,11 @@ int __init swiotlb_init_with_tbl(char *tlb, unsigned long nslabs, int verbose)
 		io_tlb_list[i] = IO_TLB_SEGSIZE - OFFSET(i, IO_TLB_SEGSIZE);
 		io_tlb_orig_addr[i] = INVALID_PHYS_ADDR;
 	}
-	io_tlb_index = 0;
+
+	nareas = swiotlb_nareas(io_tlb_nslabs);
+	swiotlb_init_areas(memblock_virt_alloc(
+				PAGE_ALIGN(nareas * sizeof(struct io_tlb_area)),
+				PAGE_SIZE), nareas);
 
 	if (verbose)
 		swiotlb_print_info();
@@ -331,6 +403,8 @@ swiotlb_late_init_with_tbl(char *tlb, unsigned long nslabs)
 {
 	unsigned long i, bytes;
 	unsigned char *v_overflow_buffer;
+	struct io_tlb_area *areas;
+	unsigned int nareas;
 
 	bytes = nslabs << IO_TLB_SHIFT;
 
@@ -371,11 +445,16 @@ swiotlb_late_init_with_tbl(char *tlb, unsigned long nslabs)
 	if (!io_tlb_orig_addr)
 		goto cleanup4;
 
+	nareas = swiotlb_nareas(io_tlb_nslabs);
+	areas = kcalloc(nareas, sizeof(*areas), GFP_KERNEL);
+	if (!areas)
+		goto cleanup5;
+
 	for (i = 0; i < io_tlb_nslabs; i++) {
 		io_tlb_list[i] = IO_TLB_SEGSIZE - OFFSET(i, IO_TLB_SEGSIZE);
 		io_tlb_orig_addr[i] = INVALID_PHYS_ADDR;
 	}
-	io_tlb_index = 0;
+	swiotlb_init_areas(areas, nareas);
 
 	swiotlb_print_info();
 
@@ -385,6 +464,10 @@ swiotlb_late_init_with_tbl(char *tlb, unsigned long nslabs)
 
 	return 0;
 
+cleanup5:
+	free_pages((unsigned long)io_tlb_orig_addr,
+		   get_order(io_tlb_nslabs * sizeof(phys_addr_t)));
+	io_tlb_orig_addr = NULL;
 cleanup4:
 	free_pages((unsigned long)io_tlb_list, get_order(io_tlb_nslabs *
 	                                                 sizeof(int)));
@@ -407,6 +490,7 @@ void __init swiotlb_exit(void)
 		return;
 
 	if (late_alloc) {
+		kfree(io_tlb_areas);
 		free_pages((unsigned long)phys_to_virt(io_tlb_overflow_buffer),
 			   get_order(io_tlb_overflow));
 		free_pages((unsigned long)io_tlb_orig_addr,
@@ -416,6 +500,9 @@ void __init swiotlb_exit(void)
 		free_pages((unsigned long)phys_to_virt(io_tlb_start),
 			   get_order(io_tlb_nslabs << IO_TLB_SHIFT));
 	} else {
+		memblock_free_late(__pa(io_tlb_areas),
+				   PAGE_ALIGN(io_tlb_nareas *
+					      sizeof(struct io_tlb_area)));
 		memblock_free_late(io_tlb_overflow_buffer,
 				   PAGE_ALIGN(io_tlb_overflow));
 		memblock_free_late(__pa(io_tlb_orig_addr),
@@ -425,6 +512,8 @@ void __init swiotlb_exit(void)
 		memblock_free_late(io_tlb_start,
 				   PAGE_ALIGN(io_tlb_nslabs << IO_TLB_SHIFT));
 	}
+	io_tlb_areas = NULL;
+	io_tlb_nareas = 0;
 	io_tlb_nslabs = 0;
 	max_segment = 0;
 }
@@ -474,19 +563,86 @@ static void swiotlb_bounce(phys_addr_t orig_addr, phys_addr_t tlb_addr,
 	}
 }
 
+/*
+ * Find nslots free slabs in an area and mark them as used, returning the
+ * index of the first one or -1 if the area has no room for them.
+ */
+static int swiotlb_area_find_slots(unsigned int area, unsigned int nslots,
+				   unsigned int stride,
+				   unsigned long offset_slots,
+				   unsigned long max_slots)
+{
+	struct io_tlb_area *a = &io_tlb_areas[area];
+	unsigned int start = swiotlb_area_start(area);
+	unsigned int end = swiotlb_area_end(area);
+	unsigned int index, wrap;
+	unsigned long flags;
+	int i;
+
+	spin_lock_irqsave(&a->lock, flags);
+	index = ALIGN(a->index, stride);
+	if (index >= end)
+		index = start;
+	wrap = index;
+
+	do {
+		while (iommu_is_span_boundary(index, nslots, offset_slots,
+					      max_slots)) {
+			index += stride;
+			if (index >= end)
+				index = start;
+			if (index == wrap)
+				goto not_found;
+		}
+
+		/*
+		 * If we find a slot that indicates we have 'nslots' number of
+		 * contiguous buffers, we allocate the buffers from that slot
+		 * and mark the entries as '0' indicating unavailable.
+		 */
+		if (io_tlb_list[index] >= nslots) {
+			int count = 0;
+
+			for (i = index; i < (int) (index + nslots); i++)
+				io_tlb_list[i] = 0;
+			for (i = index - 1; (OFFSET(i, IO_TLB_SEGSIZE) != IO_TLB_SEGSIZE - 1) && io_tlb_list[i]; i--)
+				io_tlb_list[i] = ++count;
+
+			/*
+			 * Update the indices to avoid searching in the next
+			 * round.
+			 */
+			a->index = ((index + nslots) < end
+				    ? (index + nslots) : start);
+			a->used += nslots;
+			if (a->used > a->high)
+				a->high = a->used;
+
+			spin_unlock_irqrestore(&a->lock, flags);
+			return index;
+		}
+		index += stride;
+		if (index >= end)
+			index = start;
+	} while (index != wrap);
+
+not_found:
+	spin_unlock_irqrestore(&a->lock, flags);
+	return -1;
+}
+
 phys_addr_t swiotlb_tbl_map_single(struct device *hwdev,
 				   dma_addr_t tbl_dma_addr,
 				   phys_addr_t orig_addr, size_t size,
 				   enum dma_data_direction dir,
 				   unsigned long attrs)
 {
-	unsigned long flags;
 	phys_addr_t tlb_addr;
-	unsigned int nslots, stride, index, wrap;
-	int i;
+	unsigned int nslots, stride, area, i;
 	unsigned long mask;
 	unsigned long offset_slots;
 	unsigned long max_slots;
+	int index = -1;
 
 	if (no_iotlb_memory)
 		panic("Can not allocate SWIOTLB buffer earlier and can't now provide you with the DMA bounce buffer");
@@ -522,59 +678,22 @@ phys_addr_t swiotlb_tbl_map_single(struct device *hwdev,
 
 	/*
 	 * Find suitable number of IO TLB entries size that will fit this
-	 * request and allocate a buffer from that IO TLB pool.
+	 * request and allocate a buffer from that IO TLB pool, starting with
+	 * the area of this CPU.
 	 */
-	spin_lock_irqsave(&io_tlb_lock, flags);
-	index = ALIGN(io_tlb_index, stride);
-	if (index >= io_tlb_nslabs)
-		index = 0;
-	wrap = index;
-
-	do {
-		while (iommu_is_span_boundary(index, nslots, offset_slots,
-					      max_slots)) {
-			index += stride;
-			if (index >= io_tlb_nslabs)
-				index = 0;
-			if (index == wrap)
-				goto not_found;
-		}
-
-		/*
-		 * If we find a slot that indicates we have 'nslots' number of
-		 * contiguous buffers, we allocate the buffers from that slot
-		 * and mark the entries as '0' indicating unavailable.
-		 */
-		if (io_tlb_list[index] >= nslots) {
-			int count = 0;
-
-			for (i = index; i < (int) (index + nslots); i++)
-				io_tlb_list[i] = 0;
-			for (i = index - 1; (OFFSET(i, IO_TLB_SEGSIZE) != IO_TLB_SEGSIZE - 1) && io_tlb_list[i]; i--)
-				io_tlb_list[i] = ++count;
-			tlb_addr = io_tlb_start + (index << IO_TLB_SHIFT);
-
-			/*
-			 * Update the indices to avoid searching in the next
-			 * round.
-			 */
-			io_tlb_index = ((index + nslots) < io_tlb_nslabs
-					? (index + nslots) : 0);
-
-			goto found;
-		}
-		index += stride;
-		if (index >= io_tlb_nslabs)
-			index = 0;
-	} while (index != wrap);
+	area = raw_smp_processor_id() & (io_tlb_nareas - 1);
+	for (i = 0; i < io_tlb_nareas && index < 0; i++) {
+		index = swiotlb_area_find_slots(area, nslots, stride,
+						offset_slots, max_slots);
+		area = (area + 1) & (io_tlb_nareas - 1);
+	}
 
-not_found:
-	spin_unlock_irqrestore(&io_tlb_lock, flags);
-	if (!(attrs & DMA_ATTR_NO_WARN) && printk_ratelimit())
-		dev_warn(hwdev, "swiotlb buffer is full (sz: %zd bytes)\n", size);
-	return SWIOTLB_MAP_ERROR;
-found:
-	spin_unlock_irqrestore(&io_tlb_lock, flags);
+	if (index < 0) {
+		if (!(attrs & DMA_ATTR_NO_WARN) && printk_ratelimit())
+			dev_warn(hwdev, "swiotlb buffer is full (sz: %zd bytes)\n", size);
+		return SWIOTLB_MAP_ERROR;
+	}
+	tlb_addr = io_tlb_start + ((phys_addr_t)index << IO_TLB_SHIFT);
 
 	/*
 	 * Save away the mapping from the original address to the DMA address.
@@ -620,6 +739,7 @@ void swiotlb_tbl_unmap_single(struct device *hwdev, phys_addr_t tlb_addr,
 	unsigned long flags;
 	int i, count, nslots = ALIGN(size, 1 << IO_TLB_SHIFT) >> IO_TLB_SHIFT;
 	int index = (tlb_addr - io_tlb_start) >> IO_TLB_SHIFT;
+	struct io_tlb_area *a = &io_tlb_areas[swiotlb_area_of(index)];
 	phys_addr_t orig_addr = io_tlb_orig_addr[index];
 
 	/*
@@ -636,7 +756,7 @@ void swiotlb_tbl_unmap_single(struct device *hwdev, phys_addr_t tlb_addr,
 	 * While returning the entries to the free list, we merge the entries
 	 * with slots below and above the pool being returned.
 	 */
-	spin_lock_irqsave(&io_tlb_lock, flags);
+	spin_lock_irqsave(&a->lock, flags);
 	{
 		count = ((index + nslots) < ALIGN(index + 1, IO_TLB_SEGSIZE) ?
 			 io_tlb_list[index + nslots] : 0);
@@ -654,8 +774,9 @@ void swiotlb_tbl_unmap_single(struct device *hwdev, phys_addr_t tlb_addr,
 		 */
 		for (i = index - 1; (OFFSET(i, IO_TLB_SEGSIZE) != IO_TLB_SEGSIZE -1) && io_tlb_list[i]; i--)
 			io_tlb_list[i] = ++count;
+		a->used -= nslots;
 	}
-	spin_unlock_irqrestore(&io_tlb_lock, flags);
+	spin_unlock_irqrestore(&a->lock, flags);
 }
 
 void swiotlb_tbl_sync_single(struct device *hwdev, phys_addr_t tlb_addr,
@@ -1084,3 +1205,49 @@ const struct dma_map_ops swiotlb_dma_ops = {
 	.dma_supported		= dma_direct_supported,
 };
 EXPORT_SYMBOL(swiotlb_dma_ops);
+
+#ifdef CONFIG_DEBUG_FS
+static int swiotlb_areas_show(struct seq_file *m, void *v)
+{
+	unsigned int i;
+
+	seq_puts(m, "area      start     nslabs       used       high\n");
+	for (i = 0; i < io_tlb_nareas; i++)
+		seq_printf(m, "%4u %10u %10u %10u %10u\n", i,
+			   swiotlb_area_start(i),
+			   swiotlb_area_end(i) - swiotlb_area_start(i),
+			   READ_ONCE(io_tlb_areas[i].used),
+			   READ_ONCE(io_tlb_areas[i].high));
+
+	return 0;
+}
+
+static int swiotlb_areas_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, swiotlb_areas_show, NULL);
+}
+
+static const struct file_operations swiotlb_areas_fops = {
+	.open		= swiotlb_areas_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init swiotlb_create_debugfs(void)
+{
+	struct dentry *root;
+
+	if (!io_tlb_nareas)
+		return 0;
+
+	root = debugfs_create_dir("swiotlb", NULL);
+	if (!root)
+		return -ENOMEM;
+
+	debugfs_create_ulong("io_tlb_nslabs", 0400, root, &io_tlb_nslabs);
+	debugfs_create_file("areas", 0400, root, NULL, &swiotlb_areas_fops);
+	return 0;
+}
+late_initcall(swiotlb_create_debugfs);
+#endif
@@ -0,0 +1,251 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Per-region counting of hardware events
+ *
+ * A "hotpath" event counts, on one CPU, the occurrences of a hardware event
+ * (cycles by default, or the raw event given in config1) while that CPU runs
+ * the region selected by config. It is backed by a pinned kernel counter on
+ * the same CPU, which is read when the region is entered and left; the
+ * difference is added to the hotpath event.
+ *
+ * Regions only hold their id while registered. A region unregistered while
+ * events still select its id makes them stop counting; ids are allocated
+ * cyclically so that a new region doesn't immediately reuse it.
+ */
+
+#include <linux/idr.h>
+#include <linux/mutex.h>
+#include <linux/perf_event.h>
+#include <linux/perf_hotpath.h>
+#include <linux/percpu.h>
+
+#define HOTPATH_REGION_MAX	0xffff
+
+DEFINE_STATIC_KEY_FALSE(perf_hotpath_key);
+EXPORT_SYMBOL_GPL(perf_hotpath_key);
+
+static DEFINE_MUTEX(hotpath_lock);
+static DEFINE_IDR(hotpath_regions);
+static DEFINE_PER_CPU(struct list_head, hotpath_events);
+
+int perf_hotpath_register(struct perf_hotpath *hp)
+{
+	int id = 0;
+
+	mutex_lock(&hotpath_lock);
+	if (!hp->users) {
+		id = idr_alloc_cyclic(&hotpath_regions, hp, 1,
+				      HOTPATH_REGION_MAX + 1, GFP_KERNEL);
+		if (id < 0)
+			goto out;
+		WRITE_ONCE(hp->id, id);
+	}
+	hp->users++;
+out:
+	mutex_unlock(&hotpath_lock);
+
+	return id < 0 ? id : 0;
+}
+EXPORT_SYMBOL_GPL(perf_hotpath_register);
+
+void perf_hotpath_unregister(struct perf_hotpath *hp)
+{
+	mutex_lock(&hotpath_lock);
+	if (!WARN_ON(!hp->users) && !--hp->users) {
+		idr_remove(&hotpath_regions, hp->id);
+		WRITE_ONCE(hp->id, -1);
+	}
+	mutex_unlock(&hotpath_lock);
+}
+EXPORT_SYMBOL_GPL(perf_hotpath_unregister);
+
+void __perf_hotpath_enter(struct perf_hotpath *hp)
+{
+	struct perf_event *event;
+	unsigned long flags;
+	u64 value;
+
+	local_irq_save(flags);
+	list_for_each_entry(event, this_cpu_ptr(&hotpath_events), active_entry) {
+		if (event->hw.config != READ_ONCE(hp->id) || event->hw.state)
+			continue;
+		if (perf_event_read_local(event->pmu_private, &value, NULL, NULL))
+			continue;
+		local64_set(&event->hw.prev_count, value);
+		event->hw.flags = 1;
+	}
+	local_irq_restore(flags);
+}
+EXPORT_SYMBOL_GPL(__perf_hotpath_enter);
+
+void __perf_hotpath_exit(struct perf_hotpath *hp)
+{
+	struct perf_event *event;
+	unsigned long flags;
+	u64 value;
+
+	local_irq_save(flags);
+	list_for_each_entry(event, this_cpu_ptr(&hotpath_events), active_entry) {
+		/* Only count the regions which were entered with the event on */
+		if (event->hw.config != READ_ONCE(hp->id) || !event->hw.flags)
+			continue;
+		event->hw.flags = 0;
+		if (perf_event_read_local(event->pmu_private, &value, NULL, NULL))
+			continue;
+		local64_add(value - local64_read(&event->hw.prev_count),
+			    &event->count);
+	}
+	local_irq_restore(flags);
+}
+EXPORT_SYMBOL_GPL(__perf_hotpath_exit);
+
+static void hotpath_event_destroy(struct perf_event *event)
+{
+	perf_event_release_kernel(event->pmu_private);
+	static_branch_dec(&perf_hotpath_key);
+}
+
+static int hotpath_event_init(struct perf_event *event)
+{
+	struct perf_event_attr attr = {
+		.size		= sizeof(attr),
+		.pinned		= 1,
+		.exclude_user	= event->attr.exclude_user,
+		.exclude_kernel	= event->attr.exclude_kernel,
+		.exclude_hv	= event->attr.exclude_hv,
+	};
+	struct perf_event *counter;
+
+	if (event->attr.type != event->pmu->type)
+		return -ENOENT;
+
+	/* Only CPU-wide counting: the region reads have to be CPU local */
+	if (event->cpu < 0 || (event->attach_state & PERF_ATTACH_TASK) ||
+	    is_sampling_event(event))
+		return -EINVAL;
+
+	if (!event->attr.config || event->attr.config > HOTPATH_REGION_MAX)
+		return -EINVAL;
+
+	if (event->attr.config1) {
+		attr.type = PERF_TYPE_RAW;
+		attr.config = event->attr.config1;
+	} else {
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = PERF_COUNT_HW_CPU_CYCLES;
+	}
+
+	counter = perf_event_create_kernel_counter(&attr, event->cpu, NULL,
+						   NULL, NULL);
+	if (IS_ERR(counter))
+		return PTR_ERR(counter);
+
+	event->pmu_private = counter;
+	event->hw.config = event->attr.config;
+	event->hw.flags = 0;
+	event->destroy = hotpath_event_destroy;
+	static_branch_inc(&perf_hotpath_key);
+
+	return 0;
+}
+
+static void hotpath_event_start(struct perf_event *event, int flags)
+{
+	event->hw.state = 0;
+}
+
+static void hotpath_event_stop(struct perf_event *event, int flags)
+{
+	event->hw.state = PERF_HES_STOPPED | PERF_HES_UPTODATE;
+}
+
+static int hotpath_event_add(struct perf_event *event, int flags)
+{
+	event->hw.state = PERF_HES_STOPPED | PERF_HES_UPTODATE;
+	event->hw.flags = 0;
+	list_add_tail(&event->active_entry, this_cpu_ptr(&hotpath_events));
+
+	if (flags & PERF_EF_START)
+		hotpath_event_start(event, flags);
+
+	return 0;
+}
+
+static void hotpath_event_del(struct perf_event *event, int flags)
+{
+	hotpath_event_stop(event, flags);
+	list_del(&event->active_entry);
+}
+
+static void hotpath_event_read(struct perf_event *event)
+{
+	/* event->count is updated when the regions are left */
+}
+
+static ssize_t regions_show(struct device *dev, struct device_attribute *attr,
+			    char *buf)
+{
+	struct perf_hotpath *hp;
+	ssize_t len = 0;
+	int id;
+
+	mutex_lock(&hotpath_lock);
+	idr_for_each_entry(&hotpath_regions, hp, id)
+		len += scnprintf(buf + len, PAGE_SIZE - len, "%s region=%d\n",
+				 hp->name, id);
+	mutex_unlock(&hotpath_lock);
+
+	return len;
+}
+static DEVICE_ATTR_RO(regions);
+
+static struct attribute *hotpath_attrs[] = {
+	&dev_attr_regions.attr,
+	NULL,
+};
+
+static struct attribute_group hotpath_attr_group = {
+	.attrs = hotpath_attrs,
+};
+
+PMU_FORMAT_ATTR(region, "config:0-15");
+PMU_FORMAT_ATTR(event, "config1:0-63");
+
+static struct attribute *hotpath_format_attrs[] = {
+	&format_attr_region.attr,
+	&format_attr_event.attr,
+	NULL,
+};
+
+static struct attribute_group hotpath_format_group = {
+	.name = "format",
+	.attrs = hotpath_format_attrs,
+};
+
+static const struct attribute_group *hotpath_attr_groups[] = {
+	&hotpath_attr_group,
+	&hotpath_format_group,
+	NULL,
+};
+
+static struct pmu hotpath_pmu = {
+	.task_ctx_nr	= perf_invalid_context,
+	.attr_groups	= hotpath_attr_groups,
+	.event_init	= hotpath_event_init,
+	.add		= hotpath_event_add,
+	.del		= hotpath_event_del,
+	.start		= hotpath_event_start,
+	.stop		= hotpath_event_stop,
+	.read		= hotpath_event_read,
+};
+
+static int __init perf_hotpath_init(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		INIT_LIST_HEAD(per_cpu_ptr(&hotpath_events, cpu));
+
+	return perf_pmu_register(&hotpath_pmu, "hotpath", -1);
+}
+device_initcall(perf_hotpath_init);
@@ -14,8 +14,8 @@ struct ring_buffer {
 	struct rcu_head			rcu_head;
 #ifdef CONFIG_PERF_USE_VMALLOC
 	struct work_struct		work;
-	int				page_order;	/* allocation order  */
 #endif
+	int				page_order;	/* allocation order  */
 	int				nr_pages;	/* nr of data pages  */
 	int				overwrite;	/* can overwrite itself */
 	int				paused;		/* can write into ring buffer */
@@ -29,6 +29,10 @@ struct ring_buffer {
 	local_t				lost;		/* nr records lost   */
 
 	long				watermark;	/* wakeup watermark  */
+	/* adaptive wakeups: defer while less than wakeup_batch is unread */
+	int				adaptive_wakeup;
+	int				wakeup_deferred;
+	long				wakeup_batch;
 	long				aux_watermark;
 	/* poll crap */
 	spinlock_t			event_lock;
@@ -94,25 +98,21 @@ void perf_event_aux_event(struct perf_event *event, unsigned long head,
 extern struct page *
 perf_mmap_to_page(struct ring_buffer *rb, unsigned long pgoff);
 
-#ifdef CONFIG_PERF_USE_VMALLOC
 /*
- * Back perf_mmap() with vmalloc memory.
- *
- * Required for architectures that have d-cache aliasing issues.
+ * Each entry of data_pages[] covers 1 << page_order pages.  With
+ * CONFIG_PERF_USE_VMALLOC, required for architectures that have d-cache
+ * aliasing issues, the whole buffer is a single vmalloc() area.  Otherwise
+ * it is made of physically contiguous chunks when they can be allocated.
  */
-
 static inline int page_order(struct ring_buffer *rb)
 {
 	return rb->page_order;
 }
 
-#else
-
-static inline int page_order(struct ring_buffer *rb)
+static inline int data_page_nr(struct ring_buffer *rb)
 {
-	return 0;
+	return rb->nr_pages << page_order(rb);
 }
-#endif
 
 static inline unsigned long perf_data_size(struct ring_buffer *rb)
 {
@@ -15,9 +15,20 @@
 #include <linux/circ_buf.h>
 #include <linux/poll.h>
 #include <linux/nospec.h>
+#include <linux/sysctl.h>
 
 #include "internal.h"
 
+/*
+ * Highest order of the physically contiguous chunks backing the data pages:
+ * 2MB by default, which the linear map covers with a single TLB entry.
+ */
+#define PERF_RB_DEFAULT_ORDER	\
+	(21 - PAGE_SHIFT < MAX_ORDER ? 21 - PAGE_SHIFT : MAX_ORDER - 1)
+
+static int perf_rb_max_order __read_mostly = PERF_RB_DEFAULT_ORDER;
+static int perf_rb_adaptive_wakeup __read_mostly;
+
 static void perf_output_wakeup(struct perf_output_handle *handle)
 {
 	atomic_set(&handle->rb->poll, EPOLLIN);
@@ -26,6 +37,37 @@ static void perf_output_wakeup(struct perf_output_handle *handle)
 	irq_work_queue(&handle->event->pending);
 }
 
+/*
+ * With adaptive wakeups, a due wakeup is deferred for as long as less than
+ * ->wakeup_batch bytes are waiting to be read. The batch doubles every time
+ * the reader is woken without having lost records, up to the watermark, and
+ * is halved when records were lost. A reader which keeps up is thus woken
+ * for large chunks of data instead of for every wakeup_events samples.
+ *
+ * Returns true if the wakeup is deferred.
+ */
+static bool perf_output_defer_wakeup(struct ring_buffer *rb,
+				     unsigned long head)
+{
+	long batch = READ_ONCE(rb->wakeup_batch);
+	unsigned long unread;
+
+	unread = head - READ_ONCE(rb->user_page->data_tail);
+
+	if (local_read(&rb->lost)) {
+		WRITE_ONCE(rb->wakeup_batch, batch / 2);
+	} else if (unread < batch) {
+		WRITE_ONCE(rb->wakeup_deferred, 1);
+		return true;
+	} else {
+		batch = max_t(long, 2 * batch, PAGE_SIZE);
+		WRITE_ONCE(rb->wakeup_batch, min(batch, rb->watermark));
+	}
+
+	WRITE_ONCE(rb->wakeup_deferred, 0);
+	return false;
+}
+
 /*
  * We need to ensure a later event_id doesn't publish a head when a former
  * event isn't done writing. However since we need to deal with NMIs we
@@ -96,8 +138,12 @@ again:
 		goto again;
 	}
 
-	if (handle->wakeup != local_read(&rb->wakeup))
-		perf_output_wakeup(handle);
+	if (handle->wakeup != local_read(&rb->wakeup) ||
+	    unlikely(READ_ONCE(rb->wakeup_deferred))) {
+		if (!rb->adaptive_wakeup ||
+		    !perf_output_defer_wakeup(rb, head))
+			perf_output_wakeup(handle);
+	}
 
 out:
 	preempt_enable();
@@ -285,6 +331,10 @@ ring_buffer_init(struct ring_buffer *rb, long watermark, int flags)
 	else
 		rb->overwrite = 1;
 
+	/* deferring needs the reader's ->data_tail */
+	rb->adaptive_wakeup = READ_ONCE(perf_rb_adaptive_wakeup) &&
+			      !rb->overwrite;
+
 	atomic_set(&rb->refcount, 1);
 
 	INIT_LIST_HEAD(&rb->event_list);
@@ -687,19 +737,26 @@ void rb_free_aux(struct ring_buffer *rb)
 #ifndef CONFIG_PERF_USE_VMALLOC
 
 /*
- * Back perf_mmap() with regular GFP_KERNEL-0 pages.
+ * Back perf_mmap() with regular GFP_KERNEL pages. The data pages are
+ * allocated in physically contiguous chunks of the highest order up to
+ * perf_rb_max_order that can be had, split into order-0 pages so that
+ * they are mapped and refcounted one by one.
  */
 
 static struct page *
 __perf_mmap_to_page(struct ring_buffer *rb, unsigned long pgoff)
 {
-	if (pgoff > rb->nr_pages)
+	int order = page_order(rb);
+
+	if (pgoff > data_page_nr(rb))
 		return NULL;
 
 	if (pgoff == 0)
 		return virt_to_page(rb->user_page);
 
-	return virt_to_page(rb->data_pages[pgoff - 1]);
+	pgoff--;
+	return virt_to_page(rb->data_pages[pgoff >> order] +
+			    ((pgoff & ((1UL << order) - 1)) << PAGE_SHIFT));
 }
 
 static void *perf_mmap_alloc_page(int cpu)
@@ -715,11 +772,46 @@ static void *perf_mmap_alloc_page(int cpu)
 	return page_address(page);
 }
 
+static void *perf_mmap_alloc_chunk(int cpu, int order)
+{
+	struct page *page;
+	int node;
+
+	if (!order)
+		return perf_mmap_alloc_page(cpu);
+
+	/* don't try hard, smaller chunks will do */
+	node = (cpu == -1) ? cpu : cpu_to_node(cpu);
+	page = alloc_pages_node(node, GFP_KERNEL | __GFP_ZERO |
+				__GFP_NORETRY | __GFP_NOWARN, order);
+	if (!page)
+		return NULL;
+
+	split_page(page, order);
+	return page_address(page);
+}
+
+static void perf_mmap_free_page(unsigned long addr)
+{
+	struct page *page = virt_to_page((void *)addr);
+
+	page->mapping = NULL;
+	__free_page(page);
+}
+
+static void perf_mmap_free_chunk(void *addr, int order)
+{
+	int i;
+
+	for (i = 0; i < (1 << order); i++)
+		perf_mmap_free_page((unsigned long)addr + i * PAGE_SIZE);
+}
+
 struct ring_buffer *rb_alloc(int nr_pages, long watermark, int cpu, int flags)
 {
 	struct ring_buffer *rb;
 	unsigned long size;
-	int i;
+	int i, order = 0;
 
 	size = sizeof(struct ring_buffer);
 	size += nr_pages * sizeof(void *);
@@ -732,13 +824,18 @@ struct ring_buffer *rb_alloc(int nr_pages, long watermark, int cpu, int flags)
 	if (!rb->user_page)
 		goto fail_user_page;
 
-	for (i = 0; i < nr_pages; i++) {
-		rb->data_pages[i] = perf_mmap_alloc_page(cpu);
+	if (nr_pages)
+		order = min(READ_ONCE(perf_rb_max_order), ilog2(nr_pages));
+
+again:
+	for (i = 0; i < (nr_pages >> order); i++) {
+		rb->data_pages[i] = perf_mmap_alloc_chunk(cpu, order);
 		if (!rb->data_pages[i])
 			goto fail_data_pages;
 	}
 
-	rb->nr_pages = nr_pages;
+	rb->nr_pages = nr_pages >> order;
+	rb->page_order = order;
 
 	ring_buffer_init(rb, watermark, flags);
 
@@ -746,7 +843,10 @@ struct ring_buffer *rb_alloc(int nr_pages, long watermark, int cpu, int flags)
 
 fail_data_pages:
 	for (i--; i >= 0; i--)
-		free_page((unsigned long)rb->data_pages[i]);
+		perf_mmap_free_chunk(rb->data_pages[i], order);
+
+	if (order--)
+		goto again;
 
 	free_page((unsigned long)rb->user_page);
 
@@ -757,30 +857,17 @@ fail:
 	return NULL;
 }
 
-static void perf_mmap_free_page(unsigned long addr)
-{
-	struct page *page = virt_to_page((void *)addr);
-
-	page->mapping = NULL;
-	__free_page(page);
-}
-
 void rb_free(struct ring_buffer *rb)
 {
 	int i;
 
 	perf_mmap_free_page((unsigned long)rb->user_page);
 	for (i = 0; i < rb->nr_pages; i++)
-		perf_mmap_free_page((unsigned long)rb->data_pages[i]);
+		perf_mmap_free_chunk(rb->data_pages[i], page_order(rb));
 	kfree(rb);
 }
 
 #else
-static int data_page_nr(struct ring_buffer *rb)
-{
-	return rb->nr_pages << page_order(rb);
-}
-
 static struct page *
 __perf_mmap_to_page(struct ring_buffer *rb, unsigned long pgoff)
 {
@@ -877,3 +964,42 @@ perf_mmap_to_page(struct ring_buffer *rb, unsigned long pgoff)
 
 	return __perf_mmap_to_page(rb, pgoff);
 }
+
+#ifdef CONFIG_SYSCTL
+static int zero;
+static int one = 1;
+static int max_rb_order = MAX_ORDER - 1;
+
+static struct ctl_table perf_rb_sysctl_table[] = {
+#ifndef CONFIG_PERF_USE_VMALLOC
+	{
+		.procname	= "perf_event_max_rb_order",
+		.data		= &perf_rb_max_order,
+		.maxlen		= sizeof(perf_rb_max_order),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= &zero,
+		.extra2		= &max_rb_order,
+	},
+#endif
+	{
+		.procname	= "perf_event_adaptive_wakeup",
+		.data		= &perf_rb_adaptive_wakeup,
+		.maxlen		= sizeof(perf_rb_adaptive_wakeup),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= &zero,
+		.extra2		= &one,
+	},
+	{ }
+};
+
+static int __init perf_rb_sysctl_init(void)
+{
+	if (!register_sysctl("kernel", perf_rb_sysctl_table))
+		return -ENOMEM;
+
+	return 0;
+}
+core_initcall(perf_rb_sysctl_init);
+#endif
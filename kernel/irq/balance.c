@@ -0,0 +1,311 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * In-kernel interrupt affinity balancing
+ *
+ * Every interval_ms, the hard and soft interrupt time each online CPU spent
+ * during the last period is compared. When the busiest CPU spent more than
+ * threshold_pct of the period above the least busy one, one interrupt
+ * handled by the busiest CPU is moved to the least busy one. The cost of an
+ * interrupt is estimated as its share of the interrupts handled by its CPU
+ * during the period, applied to that CPU's interrupt time. The interrupt
+ * whose estimated cost is closest to half the imbalance, without reaching
+ * the full imbalance, is picked.
+ *
+ * Only interrupts with an action, which are neither per CPU, managed nor
+ * marked IRQ_NO_BALANCING are considered, and only while their affinity is
+ * the default one or the CPU the balancer itself gave them: an affinity set
+ * from userspace or by a driver is left alone. A moved interrupt stays
+ * where it is for hold periods.
+ */
+
+#include <linux/debugfs.h>
+#include <linux/idr.h>
+#include <linux/interrupt.h>
+#include <linux/irq.h>
+#include <linux/kernel_stat.h>
+#include <linux/sched/clock.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/workqueue.h>
+
+#include "internals.h"
+
+#define IRQB_LOG_SIZE	32
+
+struct irqb_stat {
+	unsigned int	last_count;	/* kstat_irqs() at the last period */
+	unsigned int	rate;		/* interrupts during the last period */
+	unsigned int	home;		/* CPU handling the interrupt */
+	unsigned int	cpu;		/* CPU given by the balancer */
+	unsigned int	hold;		/* periods left before the next move */
+};
+
+struct irqb_cpu {
+	u64		last_time;	/* hardirq + softirq time at the last period */
+	u64		load;		/* hardirq + softirq time during the last period */
+	unsigned int	rate;		/* interrupts handled during the last period */
+};
+
+struct irqb_decision {
+	u64		ts;
+	unsigned int	irq;
+	unsigned int	from;
+	unsigned int	to;
+	unsigned int	rate;
+	u64		est;
+	u64		from_load;
+	u64		to_load;
+};
+
+static u32 irqb_interval_ms = 200;
+static u32 irqb_threshold_pct = 10;
+static u32 irqb_hold = 10;
+
+static DEFINE_IDR(irqb_stats);
+static DEFINE_PER_CPU(struct irqb_cpu, irqb_cpu);
+
+static DEFINE_SPINLOCK(irqb_log_lock);
+static struct irqb_decision irqb_log[IRQB_LOG_SIZE];
+static unsigned int irqb_log_count;
+
+static void irq_balance_work_fn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(irqb_work, irq_balance_work_fn);
+
+static u64 irq_balance_cpu_time(int cpu)
+{
+	u64 *cpustat = kcpustat_cpu(cpu).cpustat;
+
+	return cpustat[CPUTIME_IRQ] + cpustat[CPUTIME_SOFTIRQ];
+}
+
+static struct irqb_stat *irq_balance_stat(unsigned int irq)
+{
+	struct irqb_stat *s;
+
+	s = idr_find(&irqb_stats, irq);
+	if (s)
+		return s;
+
+	s = kzalloc(sizeof(*s), GFP_KERNEL);
+	if (!s)
+		return NULL;
+	s->last_count = kstat_irqs(irq);
+	s->cpu = nr_cpu_ids;
+
+	if (idr_alloc(&irqb_stats, s, irq, irq + 1, GFP_KERNEL) < 0) {
+		kfree(s);
+		return NULL;
+	}
+
+	return s;
+}
+
+static bool irq_balance_eligible(unsigned int irq, struct irq_desc *desc,
+				 struct irqb_stat *s)
+{
+	struct irq_data *d = irq_desc_get_irq_data(desc);
+	const struct cpumask *m = irq_data_get_affinity_mask(d);
+
+	if (!desc->action || !irqd_can_balance(d) ||
+	    irqd_affinity_is_managed(d) || !irq_can_set_affinity_usr(irq))
+		return false;
+
+	if (cpumask_equal(m, irq_default_affinity))
+		return true;
+
+	return s->cpu < nr_cpu_ids && cpumask_equal(m, cpumask_of(s->cpu));
+}
+
+static void irq_balance_log(unsigned int irq, struct irqb_stat *s,
+			    unsigned int from, unsigned int to, u64 est)
+{
+	struct irqb_decision *e;
+
+	spin_lock(&irqb_log_lock);
+	e = &irqb_log[irqb_log_count++ % IRQB_LOG_SIZE];
+	e->ts = local_clock();
+	e->irq = irq;
+	e->from = from;
+	e->to = to;
+	e->rate = s->rate;
+	e->est = est;
+	e->from_load = per_cpu(irqb_cpu, from).load;
+	e->to_load = per_cpu(irqb_cpu, to).load;
+	spin_unlock(&irqb_log_lock);
+}
+
+static void irq_balance(u64 period)
+{
+	struct irqb_cpu *busy = NULL, *idle = NULL, *c;
+	unsigned int busiest = 0, idlest = 0, best_irq = 0;
+	struct irqb_stat *s, *best = NULL;
+	u64 diff, est, best_dist = U64_MAX;
+	struct irq_desc *desc;
+	unsigned int irq;
+	int cpu;
+
+	for_each_online_cpu(cpu) {
+		u64 time = irq_balance_cpu_time(cpu);
+
+		c = per_cpu_ptr(&irqb_cpu, cpu);
+		/* No reference yet for a CPU seen for the first time */
+		c->load = c->last_time ? time - c->last_time : 0;
+		c->last_time = time;
+		c->rate = 0;
+	}
+
+	/* Refresh the interrupt rates and find the CPU handling each one */
+	for_each_active_irq(irq) {
+		struct irq_data *d;
+
+		desc = irq_to_desc(irq);
+		s = irq_balance_stat(irq);
+		if (!desc || !s)
+			continue;
+
+		d = irq_desc_get_irq_data(desc);
+		s->rate = kstat_irqs(irq) - s->last_count;
+		s->last_count += s->rate;
+		if (s->hold)
+			s->hold--;
+
+		s->home = cpumask_first_and(irq_data_get_effective_affinity_mask(d),
+					    cpu_online_mask);
+		if (irqd_is_per_cpu(d) || s->home >= nr_cpu_ids)
+			continue;
+		per_cpu(irqb_cpu, s->home).rate += s->rate;
+	}
+
+	for_each_cpu_and(cpu, cpu_online_mask, irq_default_affinity) {
+		c = per_cpu_ptr(&irqb_cpu, cpu);
+		if (!busy || c->load > busy->load) {
+			busy = c;
+			busiest = cpu;
+		}
+		if (!idle || c->load < idle->load) {
+			idle = c;
+			idlest = cpu;
+		}
+	}
+
+	if (!busy || busy == idle || !busy->rate)
+		return;
+
+	diff = busy->load - idle->load;
+	if (diff * 100 < period * irqb_threshold_pct)
+		return;
+
+	/*
+	 * Moving an interrupt costing est leaves max(busy - est, idle + est),
+	 * which is below the current maximum as long as est < diff, and is
+	 * lowest for est = diff / 2.
+	 */
+	for_each_active_irq(irq) {
+		desc = irq_to_desc(irq);
+		s = idr_find(&irqb_stats, irq);
+		if (!desc || !s || s->home != busiest || !s->rate || s->hold)
+			continue;
+		if (!irq_balance_eligible(irq, desc, s))
+			continue;
+
+		est = div_u64(busy->load * s->rate, busy->rate);
+		if (est >= diff)
+			continue;
+
+		if (abs((s64)(diff / 2) - (s64)est) < best_dist) {
+			best_dist = abs((s64)(diff / 2) - (s64)est);
+			best = s;
+			best_irq = irq;
+		}
+	}
+
+	if (!best || irq_set_affinity(best_irq, cpumask_of(idlest)))
+		return;
+
+	best->cpu = idlest;
+	best->hold = irqb_hold;
+	irq_balance_log(best_irq, best, busiest, idlest,
+			div_u64(busy->load * best->rate, busy->rate));
+}
+
+static void irq_balance_work_fn(struct work_struct *work)
+{
+	struct irqb_stat *s;
+	unsigned int interval = READ_ONCE(irqb_interval_ms);
+	int irq;
+
+	if (interval) {
+		irq_lock_sparse();
+		irq_balance((u64)interval * NSEC_PER_MSEC);
+
+		/* Forget the interrupts which were freed */
+		idr_for_each_entry(&irqb_stats, s, irq) {
+			if (!irq_to_desc(irq)) {
+				idr_remove(&irqb_stats, irq);
+				kfree(s);
+			}
+		}
+		irq_unlock_sparse();
+	} else {
+		interval = MSEC_PER_SEC;
+	}
+
+	queue_delayed_work(system_power_efficient_wq, &irqb_work,
+			   msecs_to_jiffies(interval));
+}
+
+#ifdef CONFIG_GENERIC_IRQ_DEBUGFS
+static int irq_balance_log_show(struct seq_file *m, void *p)
+{
+	struct irqb_decision *e;
+	unsigned int i, n;
+
+	spin_lock(&irqb_log_lock);
+	n = min_t(unsigned int, irqb_log_count, IRQB_LOG_SIZE);
+	for (i = irqb_log_count - n; i != irqb_log_count; i++) {
+		e = &irqb_log[i % IRQB_LOG_SIZE];
+		seq_printf(m, "%llu: irq %u cpu%u -> cpu%u rate %u est %lluus load %lluus/%lluus\n",
+			   e->ts, e->irq, e->from, e->to, e->rate,
+			   div_u64(e->est, NSEC_PER_USEC),
+			   div_u64(e->from_load, NSEC_PER_USEC),
+			   div_u64(e->to_load, NSEC_PER_USEC));
+	}
+	spin_unlock(&irqb_log_lock);
+
+	return 0;
+}
+
+static int irq_balance_log_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, irq_balance_log_show, NULL);
+}
+
+static const struct file_operations irq_balance_log_fops = {
+	.open		= irq_balance_log_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+void irq_balance_debugfs_init(struct dentry *root)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir("balance", root);
+	if (!dir)
+		return;
+
+	debugfs_create_u32("interval_ms", 0644, dir, &irqb_interval_ms);
+	debugfs_create_u32("threshold_pct", 0644, dir, &irqb_threshold_pct);
+	debugfs_create_u32("hold", 0644, dir, &irqb_hold);
+	debugfs_create_file("decisions", 0444, dir, NULL, &irq_balance_log_fops);
+}
+#endif
+
+static int __init irq_balance_init(void)
+{
+	queue_delayed_work(system_power_efficient_wq, &irqb_work,
+			   msecs_to_jiffies(MSEC_PER_SEC));
+	return 0;
+}
+late_initcall(irq_balance_init);
@@ -468,6 +468,13 @@ static inline void irq_domain_debugfs_init(struct dentry *root)
 {
 }
 # endif
+# ifdef CONFIG_IRQ_BALANCER
+void irq_balance_debugfs_init(struct dentry *root);
+# else
+static inline void irq_balance_debugfs_init(struct dentry *root)
+{
+}
+# endif
 #else /* CONFIG_GENERIC_IRQ_DEBUGFS */
 static inline void irq_add_debugfs_entry(unsigned int irq, struct irq_desc *d)
 {
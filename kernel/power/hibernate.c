@@ -38,6 +38,8 @@
 
 
 static int nocompress;
+static int lz4_compress;
+static int keep_image;
 static int noresume;
 static int nohibernate;
 static int resume_wait;
@@ -736,6 +738,10 @@ int hibernate(void)
 			flags |= SF_NOCOMPRESS_MODE;
 		else
 		        flags |= SF_CRC32_MODE;
+		if (lz4_compress)
+			flags |= SF_LZ4_MODE;
+		if (keep_image)
+			flags |= SF_KEEP_IMAGE;
 
 		pm_pr_dbg("Writing image.\n");
 		error = swsusp_write(flags);
@@ -1187,6 +1193,10 @@ static int __init hibernate_setup(char *str)
 		noresume = 1;
 	} else if (!strncmp(str, "nocompress", 10)) {
 		nocompress = 1;
+	} else if (!strncmp(str, "lz4", 3)) {
+		lz4_compress = 1;
+	} else if (!strncmp(str, "keep", 4)) {
+		keep_image = 1;
 	} else if (!strncmp(str, "no", 2)) {
 		noresume = 1;
 		nohibernate = 1;
@@ -240,6 +240,162 @@ static ssize_t pm_test_store(struct kobject *kobj, struct kobj_attribute *attr,
 }
 
 power_attr(pm_test);
+
+/*
+ * Resume timeline: when each device started waiting for its parent and
+ * suppliers, when its resume callback started and when it completed, during
+ * the last dpm_resume(). The device it waited for last is recorded as well,
+ * which gives the chain of devices on the critical path of the resume.
+ */
+#define PM_TIMELINE_SIZE	512
+
+struct pm_timeline_entry {
+	const struct device	*dev;
+	char			name[32];
+	char			driver[24];
+	ktime_t			start;
+	ktime_t			cb_start;
+	ktime_t			end;
+	int			gate;
+	bool			async;
+};
+
+static DEFINE_SPINLOCK(pm_timeline_lock);
+static struct pm_timeline_entry pm_timeline[PM_TIMELINE_SIZE];
+static unsigned int pm_timeline_count;
+static unsigned int pm_timeline_dropped;
+static ktime_t pm_timeline_base;
+
+void pm_timeline_start(void)
+{
+	spin_lock(&pm_timeline_lock);
+	pm_timeline_count = 0;
+	pm_timeline_dropped = 0;
+	pm_timeline_base = ktime_get();
+	spin_unlock(&pm_timeline_lock);
+}
+
+static int pm_timeline_find(const struct device *dev)
+{
+	int i;
+
+	for (i = pm_timeline_count - 1; i >= 0; i--)
+		if (pm_timeline[i].dev == dev)
+			return i;
+
+	return -1;
+}
+
+/**
+ * pm_timeline_end - Tell when a device completed its resume.
+ * @dev: Device to look up.
+ *
+ * Return 0 if @dev has not been recorded in the current resume timeline.
+ */
+ktime_t pm_timeline_end(const struct device *dev)
+{
+	ktime_t end = 0;
+	int i;
+
+	spin_lock(&pm_timeline_lock);
+	i = pm_timeline_find(dev);
+	if (i >= 0)
+		end = pm_timeline[i].end;
+	spin_unlock(&pm_timeline_lock);
+
+	return end;
+}
+
+/**
+ * pm_timeline_record - Add a resumed device to the resume timeline.
+ * @dev: Device which just completed its resume.
+ * @gate: Parent or supplier @dev waited for last, if any.
+ * @start: Time @dev started waiting for its parent and suppliers.
+ * @cb_start: Time the resume callback of @dev was started.
+ * @async: Whether @dev was resumed asynchronously.
+ */
+void pm_timeline_record(const struct device *dev, const struct device *gate,
+			ktime_t start, ktime_t cb_start, bool async)
+{
+	struct pm_timeline_entry *e;
+	ktime_t end = ktime_get();
+
+	spin_lock(&pm_timeline_lock);
+	if (pm_timeline_count == PM_TIMELINE_SIZE) {
+		pm_timeline_dropped++;
+		goto out;
+	}
+
+	e = &pm_timeline[pm_timeline_count];
+	e->dev = dev;
+	strlcpy(e->name, dev_name(dev), sizeof(e->name));
+	strlcpy(e->driver, dev_driver_string(dev), sizeof(e->driver));
+	e->start = start;
+	e->cb_start = cb_start;
+	e->end = end;
+	e->gate = gate ? pm_timeline_find(gate) : -1;
+	e->async = async;
+	pm_timeline_count++;
+out:
+	spin_unlock(&pm_timeline_lock);
+}
+
+#ifdef CONFIG_DEBUG_FS
+static s64 pm_timeline_us(ktime_t t)
+{
+	return ktime_to_us(ktime_sub(t, pm_timeline_base));
+}
+
+static int pm_timeline_show(struct seq_file *s, void *unused)
+{
+	struct pm_timeline_entry *e;
+	unsigned int i;
+	int last = -1;
+
+	spin_lock(&pm_timeline_lock);
+	seq_printf(s, "%u devices, %u dropped\n", pm_timeline_count,
+		   pm_timeline_dropped);
+	seq_puts(s, "   start_us     wait_us  callback_us  mode   device (driver)\n");
+	for (i = 0; i < pm_timeline_count; i++) {
+		e = &pm_timeline[i];
+		seq_printf(s, "%11lld %11lld %12lld  %-5s  %s (%s)\n",
+			   pm_timeline_us(e->start),
+			   ktime_us_delta(e->cb_start, e->start),
+			   ktime_us_delta(e->end, e->cb_start),
+			   e->async ? "async" : "sync", e->name, e->driver);
+		if (last < 0 || ktime_after(e->end, pm_timeline[last].end))
+			last = i;
+	}
+
+	/* Walk back from the device which completed last */
+	if (last >= 0)
+		seq_printf(s, "critical path, %lld us:\n",
+			   pm_timeline_us(pm_timeline[last].end));
+	while (last >= 0) {
+		e = &pm_timeline[last];
+		seq_printf(s, "  %11lld us  %s (%s)\n",
+			   ktime_us_delta(e->end, e->cb_start), e->name,
+			   e->driver);
+		/* Entries only refer to earlier ones */
+		last = e->gate;
+	}
+	spin_unlock(&pm_timeline_lock);
+
+	return 0;
+}
+
+static int pm_timeline_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, pm_timeline_show, NULL);
+}
+
+static const struct file_operations pm_timeline_operations = {
+	.open           = pm_timeline_open,
+	.read           = seq_read,
+	.llseek         = seq_lseek,
+	.release        = single_release,
+};
+#endif /* CONFIG_DEBUG_FS */
 #endif /* CONFIG_PM_SLEEP_DEBUG */
 
 #ifdef CONFIG_DEBUG_FS
@@ -335,6 +491,10 @@ static int __init pm_debugfs_init(void)
 {
 	debugfs_create_file("suspend_stats", S_IFREG | S_IRUGO,
 			NULL, NULL, &suspend_stats_operations);
+#ifdef CONFIG_PM_SLEEP_DEBUG
+	debugfs_create_file("resume_timeline", S_IFREG | S_IRUGO,
+			NULL, NULL, &pm_timeline_operations);
+#endif
 	return 0;
 }
 
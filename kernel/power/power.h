@@ -170,6 +170,8 @@ extern int swsusp_swap_in_use(void);
 #define SF_PLATFORM_MODE	1
 #define SF_NOCOMPRESS_MODE	2
 #define SF_CRC32_MODE	        4
+#define SF_LZ4_MODE		8
+#define SF_KEEP_IMAGE		16
 
 /* kernel/power/hibernate.c */
 extern int swsusp_check(void);
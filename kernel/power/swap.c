@@ -26,6 +26,7 @@
 #include <linux/swapops.h>
 #include <linux/pm.h>
 #include <linux/slab.h>
+#include <linux/lz4.h>
 #include <linux/lzo.h>
 #include <linux/vmalloc.h>
 #include <linux/cpumask.h>
@@ -512,11 +513,18 @@ static int swap_writer_finish(struct swap_map_handle *handle,
 #define LZO_UNC_PAGES	32
 #define LZO_UNC_SIZE	(LZO_UNC_PAGES * PAGE_SIZE)
 
-/* Number of pages/bytes we need for compressed data (worst case). */
+/*
+ * Number of pages/bytes we need for compressed data (worst case). This is
+ * also enough for LZ4, whose worst case is smaller.
+ */
 #define LZO_CMP_PAGES	DIV_ROUND_UP(lzo1x_worst_compress(LZO_UNC_SIZE) + \
 			             LZO_HEADER, PAGE_SIZE)
 #define LZO_CMP_SIZE	(LZO_CMP_PAGES * PAGE_SIZE)
 
+/* Workspace for either LZO or LZ4 compression. */
+#define CMP_WRK_SIZE	(LZO1X_1_MEM_COMPRESS > LZ4_MEM_COMPRESS ? \
+			 LZO1X_1_MEM_COMPRESS : LZ4_MEM_COMPRESS)
+
 /* Maximum number of threads for compression/decompression. */
 #define LZO_THREADS	3
 
@@ -615,7 +623,7 @@ static int crc32_threadfn(void *data)
 	return 0;
 }
 /**
- * Structure used for LZO data compression.
+ * Structure used for LZO or LZ4 data compression.
  */
 struct cmp_data {
 	struct task_struct *thr;                  /* thread */
@@ -624,11 +632,12 @@ struct cmp_data {
 	int ret;                                  /* return code */
 	wait_queue_head_t go;                     /* start compression */
 	wait_queue_head_t done;                   /* compression done */
+	bool lz4;                                 /* LZ4 instead of LZO */
 	size_t unc_len;                           /* uncompressed length */
 	size_t cmp_len;                           /* compressed length */
 	unsigned char unc[LZO_UNC_SIZE];          /* uncompressed buffer */
 	unsigned char cmp[LZO_CMP_SIZE];          /* compressed buffer */
-	unsigned char wrk[LZO1X_1_MEM_COMPRESS];  /* compression workspace */
+	unsigned char wrk[CMP_WRK_SIZE];          /* compression workspace */
 };
 
 /**
@@ -650,9 +659,20 @@ static int lzo_compress_threadfn(void *data)
 		}
 		atomic_set(&d->ready, 0);
 
-		d->ret = lzo1x_1_compress(d->unc, d->unc_len,
-		                          d->cmp + LZO_HEADER, &d->cmp_len,
-		                          d->wrk);
+		if (d->lz4) {
+			int len = LZ4_compress_default(d->unc,
+						       d->cmp + LZO_HEADER,
+						       d->unc_len,
+						       LZO_CMP_SIZE - LZO_HEADER,
+						       d->wrk);
+
+			d->cmp_len = max(len, 0);
+			d->ret = len > 0 ? 0 : -1;
+		} else {
+			d->ret = lzo1x_1_compress(d->unc, d->unc_len,
+						  d->cmp + LZO_HEADER,
+						  &d->cmp_len, d->wrk);
+		}
 		atomic_set(&d->stop, 1);
 		wake_up(&d->done);
 	}
@@ -660,14 +680,15 @@ static int lzo_compress_threadfn(void *data)
 }
 
 /**
- * save_image_lzo - Save the suspend image data compressed with LZO.
+ * save_image_lzo - Save the suspend image data compressed with LZO or LZ4.
  * @handle: Swap map handle to use for saving the image.
  * @snapshot: Image to read data from.
  * @nr_to_write: Number of pages to save.
+ * @lz4: Compress with LZ4 instead of LZO.
  */
 static int save_image_lzo(struct swap_map_handle *handle,
                           struct snapshot_handle *snapshot,
-                          unsigned int nr_to_write)
+                          unsigned int nr_to_write, bool lz4)
 {
 	unsigned int m;
 	int ret = 0;
@@ -704,8 +725,10 @@ static int save_image_lzo(struct swap_map_handle *handle,
 		ret = -ENOMEM;
 		goto out_clean;
 	}
-	for (thr = 0; thr < nr_threads; thr++)
+	for (thr = 0; thr < nr_threads; thr++) {
 		memset(&data[thr], 0, offsetof(struct cmp_data, go));
+		data[thr].lz4 = lz4;
+	}
 
 	crc = kmalloc(sizeof(*crc), GFP_KERNEL);
 	if (!crc) {
@@ -934,7 +957,8 @@ int swsusp_write(unsigned int flags)
 	if (!error) {
 		error = (flags & SF_NOCOMPRESS_MODE) ?
 			save_image(&handle, &snapshot, pages - 1) :
-			save_image_lzo(&handle, &snapshot, pages - 1);
+			save_image_lzo(&handle, &snapshot, pages - 1,
+				       flags & SF_LZ4_MODE);
 	}
 out_finish:
 	error = swap_writer_finish(&handle, flags, error);
@@ -1110,6 +1134,7 @@ struct dec_data {
 	int ret;                                  /* return code */
 	wait_queue_head_t go;                     /* start decompression */
 	wait_queue_head_t done;                   /* decompression done */
+	bool lz4;                                 /* LZ4 instead of LZO */
 	size_t unc_len;                           /* uncompressed length */
 	size_t cmp_len;                           /* compressed length */
 	unsigned char unc[LZO_UNC_SIZE];          /* uncompressed buffer */
@@ -1135,9 +1160,19 @@ static int lzo_decompress_threadfn(void *data)
 		}
 		atomic_set(&d->ready, 0);
 
-		d->unc_len = LZO_UNC_SIZE;
-		d->ret = lzo1x_decompress_safe(d->cmp + LZO_HEADER, d->cmp_len,
-		                               d->unc, &d->unc_len);
+		if (d->lz4) {
+			int len = LZ4_decompress_safe(d->cmp + LZO_HEADER,
+						      d->unc, d->cmp_len,
+						      LZO_UNC_SIZE);
+
+			d->unc_len = max(len, 0);
+			d->ret = len < 0 ? -1 : 0;
+		} else {
+			d->unc_len = LZO_UNC_SIZE;
+			d->ret = lzo1x_decompress_safe(d->cmp + LZO_HEADER,
+						       d->cmp_len, d->unc,
+						       &d->unc_len);
+		}
 		if (clean_pages_on_decompress)
 			flush_icache_range((unsigned long)d->unc,
 					   (unsigned long)d->unc + d->unc_len);
@@ -1149,14 +1184,16 @@ static int lzo_decompress_threadfn(void *data)
 }
 
 /**
- * load_image_lzo - Load compressed image data and decompress them with LZO.
+ * load_image_lzo - Load compressed image data and decompress them with LZO
+ * or LZ4.
  * @handle: Swap map handle to use for loading data.
  * @snapshot: Image to copy uncompressed data into.
  * @nr_to_read: Number of pages to load.
+ * @lz4: The image was compressed with LZ4 instead of LZO.
  */
 static int load_image_lzo(struct swap_map_handle *handle,
                           struct snapshot_handle *snapshot,
-                          unsigned int nr_to_read)
+                          unsigned int nr_to_read, bool lz4)
 {
 	unsigned int m;
 	int ret = 0;
@@ -1196,8 +1233,10 @@ static int load_image_lzo(struct swap_map_handle *handle,
 		ret = -ENOMEM;
 		goto out_clean;
 	}
-	for (thr = 0; thr < nr_threads; thr++)
+	for (thr = 0; thr < nr_threads; thr++) {
 		memset(&data[thr], 0, offsetof(struct dec_data, go));
+		data[thr].lz4 = lz4;
+	}
 
 	crc = kmalloc(sizeof(*crc), GFP_KERNEL);
 	if (!crc) {
@@ -1468,6 +1507,17 @@ out_clean:
 	return ret;
 }
 
+/*
+ * Put the original swap signature back in the header read by swsusp_check(),
+ * so that the image isn't resumed from again.
+ */
+static int swsusp_reset_signature(void)
+{
+	memcpy(swsusp_header->sig, swsusp_header->orig_sig, 10);
+	return hib_submit_io(REQ_OP_WRITE, REQ_SYNC, swsusp_resume_block,
+			     swsusp_header, NULL);
+}
+
 /**
  *	swsusp_read - read the hibernation image.
  *	@flags_p: flags passed by the "frozen" kernel in the image header should
@@ -1494,14 +1544,19 @@ int swsusp_read(unsigned int *flags_p)
 	if (!error) {
 		error = (*flags_p & SF_NOCOMPRESS_MODE) ?
 			load_image(&handle, &snapshot, header->pages - 1) :
-			load_image_lzo(&handle, &snapshot, header->pages - 1);
+			load_image_lzo(&handle, &snapshot, header->pages - 1,
+				       *flags_p & SF_LZ4_MODE);
 	}
 	swap_reader_finish(&handle);
 end:
-	if (!error)
+	if (!error) {
 		pr_debug("Image successfully loaded\n");
-	else
+	} else {
 		pr_debug("Error %d resuming\n", error);
+		/* Don't try a kept image which can't be loaded again */
+		if (*flags_p & SF_KEEP_IMAGE)
+			swsusp_reset_signature();
+	}
 	return error;
 }
 
@@ -1525,11 +1580,12 @@ int swsusp_check(void)
 			goto put;
 
 		if (!memcmp(HIBERNATE_SIG, swsusp_header->sig, 10)) {
-			memcpy(swsusp_header->sig, swsusp_header->orig_sig, 10);
-			/* Reset swap signature now */
-			error = hib_submit_io(REQ_OP_WRITE, REQ_SYNC,
-						swsusp_resume_block,
-						swsusp_header, NULL);
+			/*
+			 * Reset swap signature now, unless the image is meant
+			 * to be restored on every boot.
+			 */
+			if (!(swsusp_header->flags & SF_KEEP_IMAGE))
+				error = swsusp_reset_signature();
 		} else {
 			error = -EINVAL;
 		}
@@ -41,6 +41,7 @@
 #include <linux/rculist.h>
 #include <linux/poll.h>
 #include <linux/irq_work.h>
+#include <linux/kthread.h>
 #include <linux/ctype.h>
 #include <linux/uio.h>
 #include <linux/sched/clock.h>
@@ -1889,6 +1890,68 @@ int vprintk_store(int facility, int level,
 			  dict, dictlen, text, text_len);
 }
 
+/*
+ * Once the printk kthread runs, printk() only stores the message and lets
+ * the kthread write it to the consoles, so that the caller does not wait
+ * for slow consoles to catch up. Oopses, panics and the final messages
+ * before a reboot or a suspend are still written synchronously, as is
+ * everything when printk.synchronous is set.
+ */
+static bool printk_synchronous;
+module_param_named(synchronous, printk_synchronous, bool, 0644);
+MODULE_PARM_DESC(synchronous, "write to the consoles from the printk() caller");
+
+static struct task_struct *printk_kthread __read_mostly;
+static DECLARE_WAIT_QUEUE_HEAD(printk_kthread_wait);
+static bool printk_kthread_pending;
+
+static bool printk_offload(void)
+{
+	if (!printk_kthread || READ_ONCE(printk_synchronous))
+		return false;
+
+	if (oops_in_progress || atomic_read(&panic_cpu) != PANIC_CPU_INVALID)
+		return false;
+
+	return system_state == SYSTEM_RUNNING;
+}
+
+static int printk_kthread_func(void *data)
+{
+	for (;;) {
+		wait_event_interruptible(printk_kthread_wait,
+					 READ_ONCE(printk_kthread_pending));
+		WRITE_ONCE(printk_kthread_pending, false);
+
+		/* console_lock() lets console_unlock() reschedule between records */
+		console_lock();
+		console_unlock();
+	}
+
+	return 0;
+}
+
+static void printk_kthread_wake(void)
+{
+	WRITE_ONCE(printk_kthread_pending, true);
+	wake_up_interruptible(&printk_kthread_wait);
+}
+
+static int __init printk_kthread_init(void)
+{
+	struct task_struct *t;
+
+	t = kthread_run(printk_kthread_func, NULL, "printk");
+	if (IS_ERR(t)) {
+		pr_warn("unable to start the printk kthread, consoles stay synchronous\n");
+		return PTR_ERR(t);
+	}
+	printk_kthread = t;
+
+	return 0;
+}
+late_initcall(printk_kthread_init);
+
 asmlinkage int vprintk_emit(int facility, int level,
 			    const char *dict, size_t dictlen,
 			    const char *fmt, va_list args)
@@ -1911,7 +1974,10 @@ asmlinkage int vprintk_emit(int facility, int level,
 	logbuf_unlock_irqrestore(flags);
 
 	/* If called from the scheduler, we can not call up(). */
-	if (!in_sched) {
+	if (!in_sched && printk_offload()) {
+		/* Wake the printk kthread from a context where that is safe */
+		defer_console_output();
+	} else if (!in_sched) {
 		/*
 		 * Disable preemption to avoid being preempted while holding
 		 * console_sem which would prevent anyone from printing to
@@ -2877,8 +2943,10 @@ static void wake_up_klogd_work_func(struct irq_work *irq_work)
 	int pending = __this_cpu_xchg(printk_pending, 0);
 
 	if (pending & PRINTK_PENDING_OUTPUT) {
+		if (printk_offload())
+			printk_kthread_wake();
 		/* If trylock fails, someone else is doing the printing */
-		if (console_trylock())
+		else if (console_trylock())
 			console_unlock();
 	}
 
@@ -61,6 +61,7 @@
 #include <linux/trace_events.h>
 #include <linux/suspend.h>
 #include <linux/ftrace.h>
+#include <linux/shrinker.h>
 
 #include "tree.h"
 #include "rcu.h"
@@ -501,6 +502,26 @@ module_param(blimit, long, 0444);
 module_param(qhimark, long, 0444);
 module_param(qlowmark, long, 0444);
 
+/*
+ * Memory-pressure mode: entered for RCU_PRESSURE_HOLD when more than
+ * qpressure callbacks are queued on a flavor, or when reclaim runs while
+ * callbacks are queued.  Quiescent states are then forced from the start
+ * of each grace period and rcu_do_batch() ignores blimit, so that the
+ * memory waiting on callbacks is given back sooner.  Zero disables the
+ * callback-count trigger.
+ */
+#define DEFAULT_RCU_QPRESSURE 20000
+static long qpressure = DEFAULT_RCU_QPRESSURE;
+module_param(qpressure, long, 0644);
+#define RCU_PRESSURE_HOLD (HZ / 2)
+#define RCU_PRESSURE_CHECK 256	/* Sum the queues every this many CBs. */
+
+static bool rcu_pressure(struct rcu_state *rsp)
+{
+	return READ_ONCE(rsp->n_pressure) &&
+	       time_before(jiffies, READ_ONCE(rsp->pressure_until));
+}
+
 static ulong jiffies_till_first_fqs = ULONG_MAX;
 static ulong jiffies_till_next_fqs = ULONG_MAX;
 static bool rcu_kick_kthreads;
@@ -2179,7 +2200,7 @@ static int __noreturn rcu_gp_kthread(void *arg)
 
 		/* Handle quiescent-state forcing. */
 		first_gp_fqs = true;
-		j = jiffies_till_first_fqs;
+		j = rcu_pressure(rsp) ? 1 : jiffies_till_first_fqs;
 		ret = 0;
 		for (;;) {
 			if (!ret) {
@@ -2563,7 +2584,7 @@ static void rcu_do_batch(struct rcu_state *rsp, struct rcu_data *rdp)
 	 */
 	local_irq_save(flags);
 	WARN_ON_ONCE(cpu_is_offline(smp_processor_id()));
-	bl = rdp->blimit;
+	bl = rcu_pressure(rsp) ? LONG_MAX : rdp->blimit;
 	trace_rcu_batch_start(rsp->name, rcu_segcblist_n_lazy_cbs(&rdp->cblist),
 			      rcu_segcblist_n_cbs(&rdp->cblist), bl);
 	rcu_segcblist_extract_done_cbs(&rdp->cblist, &rcl);
@@ -2898,12 +2919,45 @@ static void invoke_rcu_core(void)
 		raise_softirq(RCU_SOFTIRQ);
 }
 
+/*
+ * Return the number of callbacks queued on all CPUs for the specified
+ * flavor.  The result is approximate, as the queues are not locked.
+ */
+static long rcu_queued_cbs(struct rcu_state *rsp)
+{
+	long n = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		n += rcu_segcblist_n_cbs(&per_cpu_ptr(rsp->rda, cpu)->cblist);
+	return n;
+}
+
+/*
+ * Enter or extend memory-pressure mode for the specified flavor, and
+ * give the current grace period a kick.  Must be called with preemption
+ * disabled.
+ */
+static void rcu_pressure_start(struct rcu_state *rsp)
+{
+	if (!rcu_pressure(rsp))
+		WRITE_ONCE(rsp->n_pressure, rsp->n_pressure + 1);
+	WRITE_ONCE(rsp->pressure_until, jiffies + RCU_PRESSURE_HOLD);
+	if (rcu_gp_in_progress(rsp))
+		force_quiescent_state(rsp);
+}
+
 /*
  * Handle any core-RCU processing required by a call_rcu() invocation.
  */
 static void __call_rcu_core(struct rcu_state *rsp, struct rcu_data *rdp,
 			    struct rcu_head *head, unsigned long flags)
 {
+	long qlen = rcu_segcblist_n_cbs(&rdp->cblist);
+
+	if (qlen > rdp->qlen_max)
+		rdp->qlen_max = qlen;
+
 	/*
 	 * If called from an extended quiescent state, invoke the RCU
 	 * core in order to force a re-evaluation of RCU's idleness.
@@ -2915,6 +2969,11 @@ static void __call_rcu_core(struct rcu_state *rsp, struct rcu_data *rdp,
 	if (irqs_disabled_flags(flags) || cpu_is_offline(smp_processor_id()))
 		return;
 
+	/* Too much memory waiting on callbacks?  Speed things up. */
+	if (unlikely(!(qlen % RCU_PRESSURE_CHECK)) && READ_ONCE(qpressure) &&
+	    !rcu_pressure(rsp) && rcu_queued_cbs(rsp) > READ_ONCE(qpressure))
+		rcu_pressure_start(rsp);
+
 	/*
 	 * Force the grace period if too many callbacks or too long waiting.
 	 * Enforce hysteresis, and don't invoke force_quiescent_state()
@@ -2943,6 +3002,75 @@ static void __call_rcu_core(struct rcu_state *rsp, struct rcu_data *rdp,
 	}
 }
 
+/*
+ * Reclaim cannot free callback memory directly, but it can make sure
+ * that the pending grace periods complete as quickly as possible.
+ */
+static unsigned long rcu_pressure_count(struct shrinker *shrink,
+					struct shrink_control *sc)
+{
+	struct rcu_state *rsp;
+	unsigned long n = 0;
+
+	for_each_rcu_flavor(rsp)
+		n += rcu_queued_cbs(rsp);
+	return n;
+}
+
+static unsigned long rcu_pressure_scan(struct shrinker *shrink,
+				       struct shrink_control *sc)
+{
+	struct rcu_state *rsp;
+	unsigned long flags;
+
+	local_irq_save(flags);
+	for_each_rcu_flavor(rsp)
+		if (!rcu_pressure(rsp) && rcu_queued_cbs(rsp))
+			rcu_pressure_start(rsp);
+	local_irq_restore(flags);
+	return SHRINK_STOP;
+}
+
+static struct shrinker rcu_pressure_shrinker = {
+	.count_objects = rcu_pressure_count,
+	.scan_objects = rcu_pressure_scan,
+	.seeks = DEFAULT_SEEKS,
+};
+
+/*
+ * Queue-depth statistics, in /sys/module/rcutree/parameters/queue_stats.
+ */
+static int param_get_queue_stats(char *buf, const struct kernel_param *kp)
+{
+	struct rcu_state *rsp;
+	long qlen_max;
+	int cpu, len = 0;
+
+	for_each_rcu_flavor(rsp) {
+		qlen_max = 0;
+		for_each_possible_cpu(cpu)
+			qlen_max = max(qlen_max,
+				       per_cpu_ptr(rsp->rda, cpu)->qlen_max);
+		len += scnprintf(buf + len, PAGE_SIZE - len,
+				 "%s: queued=%ld max_per_cpu=%ld pressure=%lu%s\n",
+				 rsp->name, rcu_queued_cbs(rsp), qlen_max,
+				 READ_ONCE(rsp->n_pressure),
+				 rcu_pressure(rsp) ? " (active)" : "");
+	}
+	return len;
+}
+
+static const struct kernel_param_ops queue_stats_ops = {
+	.get = param_get_queue_stats,
+};
+module_param_cb(queue_stats, &queue_stats_ops, NULL, 0444);
+
+static int __init rcu_pressure_init(void)
+{
+	return register_shrinker(&rcu_pressure_shrinker);
+}
+core_initcall(rcu_pressure_init);
+
 /*
  * RCU callback function to leak a callback.
  */
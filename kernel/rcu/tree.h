@@ -211,6 +211,7 @@ struct rcu_data {
 	unsigned long	n_force_qs_snap;
 					/* did other CPU force QS recently? */
 	long		blimit;		/* Upper limit on a processed batch */
+	long		qlen_max;	/* Longest queue seen by call_rcu(). */
 
 	/* 3) dynticks interface. */
 	struct rcu_dynticks *dynticks;	/* Shared per-CPU dynticks state. */
@@ -350,6 +351,10 @@ struct rcu_state {
 						/*  kthreads, if configured. */
 	unsigned long n_force_qs;		/* Number of calls to */
 						/*  force_quiescent_state(). */
+	unsigned long pressure_until;		/* End of memory-pressure */
+						/*  mode, in jiffies. */
+	unsigned long n_pressure;		/* Number of times memory- */
+						/*  pressure mode was entered. */
 	unsigned long gp_start;			/* Time at which GP started, */
 						/*  but in jiffies. */
 	unsigned long gp_activity;		/* Time of last GP kthread */
@@ -18,6 +18,7 @@
 struct sugov_tunables {
 	struct gov_attr_set	attr_set;
 	unsigned int		rate_limit_us;
+	unsigned int		boost_freq_pct;
 };
 
 struct sugov_policy {
@@ -31,6 +32,7 @@ struct sugov_policy {
 	s64			freq_update_delay_ns;
 	unsigned int		next_freq;
 	unsigned int		cached_raw_freq;
+	int			boost_seq;
 
 	/* The next fields are only needed if fast switch cannot be used: */
 	struct			irq_work irq_work;
@@ -64,6 +66,40 @@ struct sugov_cpu {
 
 static DEFINE_PER_CPU(struct sugov_cpu, sugov_cpu);
 
+/*
+ * Boost requests: end of the boost window of each source, in sched_clock
+ * time, and a sequence count bumped on every request.
+ */
+static atomic64_t sugov_boost_until[SCHED_CPUFREQ_BOOST_NR];
+static atomic_t sugov_boost_seq;
+
+/**
+ * schedutil_boost() - Request a frequency floor for a bounded time.
+ * @src: the source of the request.
+ * @duration_us: how long the floor should be held, from now.
+ *
+ * While any source is boosted, schedutil does not select a frequency below
+ * the boost_freq_pct tunable of the policy (0, the default, disables it).
+ * The next utilization update of each policy ignores the rate limit, so the
+ * floor is applied on the following scheduler event. Can be called from any
+ * context, including hard interrupts.
+ */
+void schedutil_boost(enum sched_cpufreq_boost_src src, unsigned int duration_us)
+{
+	u64 until = local_clock() + (u64)duration_us * NSEC_PER_USEC;
+
+	if (WARN_ON_ONCE(src >= SCHED_CPUFREQ_BOOST_NR))
+		return;
+
+	/* Only ever extend the boost window of a source */
+	if ((s64)(until - atomic64_read(&sugov_boost_until[src])) <= 0)
+		return;
+
+	atomic64_set(&sugov_boost_until[src], until);
+	atomic_inc(&sugov_boost_seq);
+}
+EXPORT_SYMBOL_GPL(schedutil_boost);
+
 /************************ Governor internals ***********************/
 
 static bool sugov_should_update_freq(struct sugov_policy *sg_policy, u64 time)
@@ -93,6 +129,10 @@ static bool sugov_should_update_freq(struct sugov_policy *sg_policy, u64 time)
 	if (unlikely(sg_policy->need_freq_update))
 		return true;
 
+	/* Apply a new boost request right away */
+	if (unlikely(sg_policy->boost_seq != atomic_read(&sugov_boost_seq)))
+		return true;
+
 	delta_ns = time - sg_policy->last_freq_update_time;
 
 	return delta_ns >= sg_policy->freq_update_delay_ns;
@@ -352,19 +392,21 @@ static void sugov_iowait_boost(struct sugov_cpu *sg_cpu, u64 time,
  *
  * This mechanism is designed to boost high frequently IO waiting tasks, while
  * being more conservative on tasks which does sporadic IO operations.
+ *
+ * Returns true if the IO boost replaced @util and @max.
  */
-static void sugov_iowait_apply(struct sugov_cpu *sg_cpu, u64 time,
+static bool sugov_iowait_apply(struct sugov_cpu *sg_cpu, u64 time,
 			       unsigned long *util, unsigned long *max)
 {
 	unsigned int boost_util, boost_max;
 
 	/* No boost currently required */
 	if (!sg_cpu->iowait_boost)
-		return;
+		return false;
 
 	/* Reset boost if the CPU appears to have been idle enough */
 	if (sugov_iowait_reset(sg_cpu, time, false))
-		return;
+		return false;
 
 	/*
 	 * An IO waiting task has just woken up:
@@ -380,7 +422,7 @@ static void sugov_iowait_apply(struct sugov_cpu *sg_cpu, u64 time,
 		sg_cpu->iowait_boost >>= 1;
 		if (sg_cpu->iowait_boost < sg_cpu->sg_policy->policy->min) {
 			sg_cpu->iowait_boost = 0;
-			return;
+			return false;
 		}
 	}
 
@@ -393,7 +435,51 @@ static void sugov_iowait_apply(struct sugov_cpu *sg_cpu, u64 time,
 	if (*util * boost_max < *max * boost_util) {
 		*util = boost_util;
 		*max = boost_max;
+		return true;
 	}
+
+	return false;
+}
+
+/**
+ * sugov_boost_apply() - Apply the boost floor to a frequency.
+ * @sg_policy: schedutil policy object the frequency was computed for.
+ * @time: the update time from the caller.
+ * @freq: the frequency selected from the utilization.
+ * @sources: set to the mask of the boost sources active at @time.
+ *
+ * Returns @freq, or the boost floor of the policy if any boost source is
+ * active and the floor is above @freq.
+ */
+static unsigned int sugov_boost_apply(struct sugov_policy *sg_policy, u64 time,
+				      unsigned int freq, unsigned int *sources)
+{
+	struct cpufreq_policy *policy = sg_policy->policy;
+	unsigned int pct = sg_policy->tunables->boost_freq_pct;
+	unsigned int floor;
+	int i;
+
+	sg_policy->boost_seq = atomic_read(&sugov_boost_seq);
+	*sources = 0;
+
+	if (!pct)
+		return freq;
+
+	for (i = 0; i < SCHED_CPUFREQ_BOOST_NR; i++) {
+		if ((s64)(atomic64_read(&sugov_boost_until[i]) - time) > 0)
+			*sources |= BIT(i);
+	}
+	if (!*sources)
+		return freq;
+
+	floor = policy->cpuinfo.max_freq / 100 * pct;
+	if (freq >= floor)
+		return freq;
+
+	/* get_next_freq() must not return the boosted value from its cache */
+	sg_policy->cached_raw_freq = 0;
+
+	return cpufreq_driver_resolve_freq(policy, floor);
 }
 
 #ifdef CONFIG_NO_HZ_COMMON
@@ -425,7 +511,8 @@ static void sugov_update_single(struct update_util_data *hook, u64 time,
 	struct sugov_cpu *sg_cpu = container_of(hook, struct sugov_cpu, update_util);
 	struct sugov_policy *sg_policy = sg_cpu->sg_policy;
 	unsigned long util, max;
-	unsigned int next_f;
+	unsigned int next_f, boost_f, sources;
+	unsigned int reason = 0;
 	bool busy;
 
 	sugov_iowait_boost(sg_cpu, time, flags);
@@ -440,7 +527,8 @@ static void sugov_update_single(struct update_util_data *hook, u64 time,
 
 	util = sugov_get_util(sg_cpu);
 	max = sg_cpu->max;
-	sugov_iowait_apply(sg_cpu, time, &util, &max);
+	if (sugov_iowait_apply(sg_cpu, time, &util, &max))
+		reason |= SUGOV_FREQ_IOWAIT;
 	next_f = get_next_freq(sg_policy, util, max);
 	/*
 	 * Do not reduce the frequency if the CPU has not been idle
@@ -448,11 +536,20 @@ static void sugov_update_single(struct update_util_data *hook, u64 time,
 	 */
 	if (busy && next_f < sg_policy->next_freq) {
 		next_f = sg_policy->next_freq;
+		reason |= SUGOV_FREQ_BUSY;
 
 		/* Reset cached freq as next_freq has changed */
 		sg_policy->cached_raw_freq = 0;
 	}
 
+	boost_f = sugov_boost_apply(sg_policy, time, next_f, &sources);
+	if (boost_f != next_f) {
+		next_f = boost_f;
+		reason |= SUGOV_FREQ_BOOST;
+	}
+
+	trace_sugov_next_freq(sg_cpu->cpu, util, max, reason, sources, next_f);
+
 	/*
 	 * This code runs under rq->lock for the target CPU, so it won't run
 	 * concurrently on two different CPUs for the same target and it is not
@@ -472,23 +569,37 @@ static unsigned int sugov_next_freq_shared(struct sugov_cpu *sg_cpu, u64 time)
 	struct sugov_policy *sg_policy = sg_cpu->sg_policy;
 	struct cpufreq_policy *policy = sg_policy->policy;
 	unsigned long util = 0, max = 1;
+	unsigned int next_f, boost_f, sources;
+	unsigned int reason = 0;
 	unsigned int j;
 
 	for_each_cpu(j, policy->cpus) {
 		struct sugov_cpu *j_sg_cpu = &per_cpu(sugov_cpu, j);
 		unsigned long j_util, j_max;
+		bool iowait;
 
 		j_util = sugov_get_util(j_sg_cpu);
 		j_max = j_sg_cpu->max;
-		sugov_iowait_apply(j_sg_cpu, time, &j_util, &j_max);
+		iowait = sugov_iowait_apply(j_sg_cpu, time, &j_util, &j_max);
 
 		if (j_util * max > j_max * util) {
 			util = j_util;
 			max = j_max;
+			reason = iowait ? SUGOV_FREQ_IOWAIT : 0;
 		}
 	}
 
-	return get_next_freq(sg_policy, util, max);
+	next_f = get_next_freq(sg_policy, util, max);
+
+	boost_f = sugov_boost_apply(sg_policy, time, next_f, &sources);
+	if (boost_f != next_f) {
+		next_f = boost_f;
+		reason |= SUGOV_FREQ_BOOST;
+	}
+
+	trace_sugov_next_freq(policy->cpu, util, max, reason, sources, next_f);
+
+	return next_f;
 }
 
 static void
@@ -587,10 +698,33 @@ rate_limit_us_store(struct gov_attr_set *attr_set, const char *buf, size_t count
 	return count;
 }
 
+static ssize_t boost_freq_pct_show(struct gov_attr_set *attr_set, char *buf)
+{
+	struct sugov_tunables *tunables = to_sugov_tunables(attr_set);
+
+	return sprintf(buf, "%u\n", tunables->boost_freq_pct);
+}
+
+static ssize_t
+boost_freq_pct_store(struct gov_attr_set *attr_set, const char *buf, size_t count)
+{
+	struct sugov_tunables *tunables = to_sugov_tunables(attr_set);
+	unsigned int boost_freq_pct;
+
+	if (kstrtouint(buf, 10, &boost_freq_pct) || boost_freq_pct > 100)
+		return -EINVAL;
+
+	tunables->boost_freq_pct = boost_freq_pct;
+
+	return count;
+}
+
 static struct governor_attr rate_limit_us = __ATTR_RW(rate_limit_us);
+static struct governor_attr boost_freq_pct = __ATTR_RW(boost_freq_pct);
 
 static struct attribute *sugov_attributes[] = {
 	&rate_limit_us.attr,
+	&boost_freq_pct.attr,
 	NULL
 };
 
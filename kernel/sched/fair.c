@@ -6056,10 +6056,41 @@ static inline int select_idle_smt(struct task_struct *p, struct sched_domain *sd
 
 #endif /* CONFIG_SCHED_SMT */
 
+/*
+ * Idle states with an exit latency (in us) up to this are as good as an idle
+ * CPU that is not in any state: typically WFI, which keeps the caches and the
+ * cluster powered.
+ */
+#define SIS_SHALLOW_EXIT_LATENCY	1
+
+/*
+ * Exit latency of the idle state an idle CPU is in; 0 if it isn't in one or
+ * if SIS_SHALLOW is disabled. Must be called under rcu_read_lock().
+ */
+static inline unsigned int idle_exit_latency(int cpu)
+{
+	struct cpuidle_state *state;
+
+	if (!sched_feat(SIS_SHALLOW))
+		return 0;
+
+	state = idle_get_state(cpu_rq(cpu));
+
+	return state ? state->exit_latency : 0;
+}
+
+static inline bool idle_cpu_shallow(int cpu)
+{
+	return idle_exit_latency(cpu) <= SIS_SHALLOW_EXIT_LATENCY;
+}
+
 /*
  * Scan the LLC domain for idle CPUs; this is dynamically regulated by
  * comparing the average scan cost (tracked in sd->avg_scan_cost) against the
  * average idle time for this rq (as found in rq->avg_idle).
+ *
+ * The first idle CPU in a shallow idle state is taken. Otherwise the idle CPU
+ * with the lowest exit latency among the ones scanned is.
  */
 static int select_idle_cpu(struct task_struct *p, struct sched_domain *sd, int target)
 {
@@ -6067,7 +6098,8 @@ static int select_idle_cpu(struct task_struct *p, struct sched_domain *sd, int t
 	u64 avg_cost, avg_idle;
 	u64 time, cost;
 	s64 delta;
-	int cpu, nr = INT_MAX;
+	unsigned int latency, best_latency = UINT_MAX;
+	int cpu, best_cpu = -1, nr = INT_MAX;
 
 	this_sd = rcu_dereference(*this_cpu_ptr(&sd_llc));
 	if (!this_sd)
@@ -6095,10 +6127,18 @@ static int select_idle_cpu(struct task_struct *p, struct sched_domain *sd, int t
 
 	for_each_cpu_wrap(cpu, sched_domain_span(sd), target) {
 		if (!--nr)
-			return -1;
+			return best_cpu;
 		if (!cpumask_test_cpu(cpu, &p->cpus_allowed))
 			continue;
-		if (available_idle_cpu(cpu))
+		if (!available_idle_cpu(cpu))
+			continue;
+
+		latency = idle_exit_latency(cpu);
+		if (latency < best_latency) {
+			best_latency = latency;
+			best_cpu = cpu;
+		}
+		if (latency <= SIS_SHALLOW_EXIT_LATENCY)
 			break;
 	}
 
@@ -6107,25 +6147,36 @@ static int select_idle_cpu(struct task_struct *p, struct sched_domain *sd, int t
 	delta = (s64)(time - cost) / 8;
 	this_sd->avg_scan_cost += delta;
 
-	return cpu;
+	return best_cpu;
 }
 
 /*
  * Try and locate an idle core/thread in the LLC cache domain.
+ *
+ * An idle target or previous CPU in a deep idle state (e.g. with its cluster
+ * powered down) is only used if the LLC has no idle CPU with a lower exit
+ * latency.
  */
 static int select_idle_sibling(struct task_struct *p, int prev, int target)
 {
 	struct sched_domain *sd;
-	int i, recent_used_cpu;
+	int i, recent_used_cpu, deep = -1;
 
-	if (available_idle_cpu(target))
-		return target;
+	if (available_idle_cpu(target)) {
+		if (idle_cpu_shallow(target))
+			return target;
+		deep = target;
+	}
 
 	/*
 	 * If the previous CPU is cache affine and idle, don't be stupid:
 	 */
-	if (prev != target && cpus_share_cache(prev, target) && available_idle_cpu(prev))
-		return prev;
+	if (prev != target && cpus_share_cache(prev, target) && available_idle_cpu(prev)) {
+		if (idle_cpu_shallow(prev))
+			return prev;
+		if (deep < 0)
+			deep = prev;
+	}
 
 	/* Check a recently used CPU as a potential idle candidate: */
 	recent_used_cpu = p->recent_used_cpu;
@@ -6133,6 +6184,7 @@ static int select_idle_sibling(struct task_struct *p, int prev, int target)
 	    recent_used_cpu != target &&
 	    cpus_share_cache(recent_used_cpu, target) &&
 	    available_idle_cpu(recent_used_cpu) &&
+	    idle_cpu_shallow(recent_used_cpu) &&
 	    cpumask_test_cpu(p->recent_used_cpu, &p->cpus_allowed)) {
 		/*
 		 * Replace recent_used_cpu with prev as it is a potential
@@ -6142,23 +6194,31 @@ static int select_idle_sibling(struct task_struct *p, int prev, int target)
 		return recent_used_cpu;
 	}
 
+	if (deep < 0)
+		deep = target;
+
 	sd = rcu_dereference(per_cpu(sd_llc, target));
 	if (!sd)
-		return target;
+		return deep;
 
 	i = select_idle_core(p, sd, target);
 	if ((unsigned)i < nr_cpumask_bits)
 		return i;
 
 	i = select_idle_cpu(p, sd, target);
-	if ((unsigned)i < nr_cpumask_bits)
-		return i;
+	if ((unsigned)i < nr_cpumask_bits) {
+		/* Keep the cache affine CPU unless @i wakes up faster */
+		if (!available_idle_cpu(deep) ||
+		    idle_exit_latency(i) < idle_exit_latency(deep))
+			return i;
+		return deep;
+	}
 
 	i = select_idle_smt(p, sd, target);
 	if ((unsigned)i < nr_cpumask_bits)
 		return i;
 
-	return target;
+	return deep;
 }
 
 /**
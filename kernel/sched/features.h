@@ -58,6 +58,12 @@ SCHED_FEAT(TTWU_QUEUE, true)
 SCHED_FEAT(SIS_AVG_CPU, false)
 SCHED_FEAT(SIS_PROP, true)
 
+/*
+ * When doing wakeups, prefer idle CPUs in a shallow idle state over CPUs
+ * that went into a deeper one, using the cpuidle exit latency.
+ */
+SCHED_FEAT(SIS_SHALLOW, true)
+
 /*
  * Issue a WARN when we do multiple update_rq_clock() calls
  * in a single rq->lock section. Default disabled because the
@@ -1067,6 +1067,27 @@ hrtimer_update_softirq_timer(struct hrtimer_cpu_base *cpu_base, bool reprogram)
 	hrtimer_reprogram(cpu_base->softirq_next_timer, reprogram);
 }
 
+/*
+ * Move the hard expiry of a timer with slack to the time in its window with
+ * the most trailing zero bits. Timers expire when the earliest hard expiry
+ * is reached, together with all those whose soft expiry has passed, so
+ * timers with overlapping windows then share a single interrupt instead of
+ * each programming the event device close to the end of its own window.
+ */
+static void hrtimer_align_expires(struct hrtimer *timer)
+{
+	u64 soft = ktime_to_ns(hrtimer_get_softexpires(timer));
+	u64 hard = ktime_to_ns(hrtimer_get_expires(timer));
+	u64 mask;
+
+	if (hard <= soft || (s64)soft < 0)
+		return;
+
+	mask = (1ULL << (fls64(soft ^ hard) - 1)) - 1;
+	hrtimer_set_expires_range_ns(timer, ns_to_ktime(soft),
+				     (hard & ~mask) - soft);
+}
+
 static int __hrtimer_start_range_ns(struct hrtimer *timer, ktime_t tim,
 				    u64 delta_ns, const enum hrtimer_mode mode,
 				    struct hrtimer_clock_base *base)
@@ -1082,6 +1103,8 @@ static int __hrtimer_start_range_ns(struct hrtimer *timer, ktime_t tim,
 	tim = hrtimer_update_lowres(timer, tim, mode);
 
 	hrtimer_set_expires_range_ns(timer, tim, delta_ns);
+	if (delta_ns)
+		hrtimer_align_expires(timer);
 
 	/* Switch the timer base, if necessary: */
 	new_base = switch_hrtimer_base(timer, base, mode & HRTIMER_MODE_PINNED);
@@ -1394,6 +1417,7 @@ static void __run_hrtimer(struct hrtimer_cpu_base *cpu_base,
 	 * is dropped.
 	 */
 	raw_spin_unlock_irqrestore(&cpu_base->lock, flags);
+	timer_account_expiry(fn);
 	trace_hrtimer_expire_entry(timer, now);
 	restart = fn(timer);
 	trace_hrtimer_expire_exit(timer);
@@ -33,6 +33,8 @@ static cpumask_var_t tick_broadcast_mask __cpumask_var_read_mostly;
 static cpumask_var_t tick_broadcast_on __cpumask_var_read_mostly;
 static cpumask_var_t tmpmask __cpumask_var_read_mostly;
 static int tick_broadcast_forced;
+/* Number of times each CPU was sent a broadcast tick */
+static DEFINE_PER_CPU(unsigned long, tick_broadcast_wakeups);
 
 static __cacheline_aligned_in_smp DEFINE_RAW_SPINLOCK(tick_broadcast_lock);
 
@@ -59,6 +61,11 @@ struct cpumask *tick_get_broadcast_mask(void)
 	return tick_broadcast_mask;
 }
 
+unsigned long tick_get_broadcast_wakeups(int cpu)
+{
+	return per_cpu(tick_broadcast_wakeups, cpu);
+}
+
 /*
  * Start the device in periodic mode
  */
@@ -264,6 +271,10 @@ static bool tick_do_broadcast(struct cpumask *mask)
 	int cpu = smp_processor_id();
 	struct tick_device *td;
 	bool local = false;
+	int i;
+
+	for_each_cpu(i, mask)
+		per_cpu(tick_broadcast_wakeups, i)++;
 
 	/*
 	 * Check, if the current cpu is in the mask
@@ -3,6 +3,7 @@
  * tick internal variable and functions used by low/high res code
  */
 #include <linux/hrtimer.h>
+#include <linux/jump_label.h>
 #include <linux/tick.h>
 
 #include "timekeeping.h"
@@ -73,6 +74,7 @@ extern void tick_set_periodic_handler(struct clock_event_device *dev, int broadc
 extern int tick_broadcast_update_freq(struct clock_event_device *dev, u32 freq);
 extern struct tick_device *tick_get_broadcast_device(void);
 extern struct cpumask *tick_get_broadcast_mask(void);
+extern unsigned long tick_get_broadcast_wakeups(int cpu);
 # else /* !CONFIG_GENERIC_CLOCKEVENTS_BROADCAST: */
 static inline void tick_install_broadcast_device(struct clock_event_device *dev) { }
 static inline int tick_is_broadcast_device(struct clock_event_device *dev) { return 0; }
@@ -163,3 +165,13 @@ DECLARE_PER_CPU(struct hrtimer_cpu_base, hrtimer_bases);
 
 extern u64 get_next_timer_interrupt(unsigned long basej, u64 basem);
 void timer_clear_idle(void);
+
+/* Per callback expiry accounting, see /proc/timer_wakeups */
+DECLARE_STATIC_KEY_FALSE(timer_wakeups_enabled);
+extern void __timer_account_expiry(void *fn);
+
+static inline void timer_account_expiry(void *fn)
+{
+	if (static_branch_unlikely(&timer_wakeups_enabled))
+		__timer_account_expiry(fn);
+}
@@ -1103,6 +1103,44 @@ int mod_timer(struct timer_list *timer, unsigned long expires)
 }
 EXPORT_SYMBOL(mod_timer);
 
+/*
+ * Pick the expiry in [expires, expires + slack] with the most trailing zero
+ * bits, so that timers with overlapping windows end up on the same jiffy and
+ * a CPU leaving idle for one of them runs the others as well.
+ */
+static unsigned long apply_slack(unsigned long expires, unsigned long slack)
+{
+	unsigned long limit = expires + slack, mask;
+
+	if (!slack || time_before(limit, expires))
+		return expires;
+
+	mask = expires ^ limit;
+	if (!mask)
+		return expires;
+
+	mask = (1UL << __fls(mask)) - 1;
+	return limit & ~mask;
+}
+
+/**
+ * mod_timer_slack - modify a timer's timeout, allowing it to be delayed
+ * @timer:	The timer to be modified
+ * @expires:	Earliest timeout in jiffies
+ * @slack:	How many jiffies the timeout may be delayed by
+ *
+ * mod_timer_slack() is mod_timer() for timers which do not need to fire at
+ * a precise time: the timeout is moved within the allowed window to a jiffy
+ * shared with other timers armed the same way, which saves wakeups on idle
+ * CPUs.
+ */
+int mod_timer_slack(struct timer_list *timer, unsigned long expires,
+		    unsigned long slack)
+{
+	return __mod_timer(timer, apply_slack(expires, slack), 0);
+}
+EXPORT_SYMBOL(mod_timer_slack);
+
 /**
  * timer_reduce - Modify a timer's timeout if it would reduce the timeout
  * @timer:	The timer to be modified
@@ -1322,6 +1360,7 @@ static void call_timer_fn(struct timer_list *timer, void (*fn)(struct timer_list
 	 */
 	lock_map_acquire(&lockdep_map);
 
+	timer_account_expiry(fn);
 	trace_timer_expire_entry(timer);
 	fn(timer);
 	trace_timer_expire_exit(timer);
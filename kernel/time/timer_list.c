@@ -16,6 +16,7 @@
 #include <linux/sched.h>
 #include <linux/seq_file.h>
 #include <linux/kallsyms.h>
+#include <linux/hash.h>
 #include <linux/nmi.h>
 
 #include <linux/uaccess.h>
@@ -261,6 +262,11 @@ print_tickdevice(struct seq_file *m, struct tick_device *td, int cpu)
 	print_name_offset(m, dev->event_handler);
 	SEQ_printf(m, "\n");
 	SEQ_printf(m, " retries:        %lu\n", dev->retries);
+#ifdef CONFIG_GENERIC_CLOCKEVENTS_BROADCAST
+	if (cpu >= 0)
+		SEQ_printf(m, " broadcast wakeups: %lu\n",
+			   tick_get_broadcast_wakeups(cpu));
+#endif
 	SEQ_printf(m, "\n");
 }
 
@@ -281,7 +287,7 @@ static void timer_list_show_tickdevices_header(struct seq_file *m)
 
 static inline void timer_list_header(struct seq_file *m, u64 now)
 {
-	SEQ_printf(m, "Timer List Version: v0.8\n");
+	SEQ_printf(m, "Timer List Version: v0.9\n");
 	SEQ_printf(m, "HRTIMER_MAX_CLOCK_BASES: %d\n", HRTIMER_MAX_CLOCK_BASES);
 	SEQ_printf(m, "now at %Ld nsecs\n", (unsigned long long)now);
 	SEQ_printf(m, "\n");
@@ -381,3 +387,117 @@ static int __init init_timer_list_procfs(void)
 	return 0;
 }
 __initcall(init_timer_list_procfs);
+
+/*
+ * Expiry accounting per timer callback. An expiry handled by the idle task
+ * happened on a CPU which was idle, and is counted as a wakeup: either the
+ * timer woke the CPU up, or it was run in the same interrupt as the one
+ * which did.
+ */
+#define TIMER_WAKEUPS_BITS	7
+
+struct timer_wakeups_entry {
+	void		*fn;
+	unsigned long	expiries;
+	unsigned long	wakeups;
+};
+
+DEFINE_STATIC_KEY_FALSE(timer_wakeups_enabled);
+static DEFINE_RAW_SPINLOCK(timer_wakeups_lock);
+static struct timer_wakeups_entry timer_wakeups[1 << TIMER_WAKEUPS_BITS];
+static unsigned long timer_wakeups_dropped;
+
+void __timer_account_expiry(void *fn)
+{
+	unsigned int i, h = hash_ptr(fn, TIMER_WAKEUPS_BITS);
+	bool idle = is_idle_task(current);
+	struct timer_wakeups_entry *e;
+	unsigned long flags;
+
+	raw_spin_lock_irqsave(&timer_wakeups_lock, flags);
+	for (i = 0; i < ARRAY_SIZE(timer_wakeups); i++) {
+		e = &timer_wakeups[(h + i) & (ARRAY_SIZE(timer_wakeups) - 1)];
+		if (e->fn == fn || !e->fn)
+			break;
+	}
+
+	if (i == ARRAY_SIZE(timer_wakeups)) {
+		timer_wakeups_dropped++;
+	} else {
+		e->fn = fn;
+		e->expiries++;
+		e->wakeups += idle;
+	}
+	raw_spin_unlock_irqrestore(&timer_wakeups_lock, flags);
+}
+
+static int timer_wakeups_show(struct seq_file *m, void *v)
+{
+	struct timer_wakeups_entry *e;
+	unsigned int i;
+
+	if (!static_key_enabled(&timer_wakeups_enabled)) {
+		seq_puts(m, "disabled, write 1 to start accounting\n");
+		return 0;
+	}
+
+	seq_puts(m, "  expiries    wakeups  function\n");
+	for (i = 0; i < ARRAY_SIZE(timer_wakeups); i++) {
+		e = &timer_wakeups[i];
+		if (e->fn)
+			seq_printf(m, "%10lu %10lu  %ps\n",
+				   e->expiries, e->wakeups, e->fn);
+	}
+	if (timer_wakeups_dropped)
+		seq_printf(m, "%10lu expiries of other callbacks\n",
+			   timer_wakeups_dropped);
+
+	return 0;
+}
+
+static int timer_wakeups_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, timer_wakeups_show, NULL);
+}
+
+/* Writing 1 resets the counters and starts the accounting, 0 stops it */
+static ssize_t timer_wakeups_write(struct file *file, const char __user *buf,
+				   size_t count, loff_t *ppos)
+{
+	bool enable;
+	int ret;
+
+	ret = kstrtobool_from_user(buf, count, &enable);
+	if (ret)
+		return ret;
+
+	if (enable) {
+		static_branch_disable(&timer_wakeups_enabled);
+		raw_spin_lock_irq(&timer_wakeups_lock);
+		memset(timer_wakeups, 0, sizeof(timer_wakeups));
+		timer_wakeups_dropped = 0;
+		raw_spin_unlock_irq(&timer_wakeups_lock);
+		static_branch_enable(&timer_wakeups_enabled);
+	} else {
+		static_branch_disable(&timer_wakeups_enabled);
+	}
+
+	return count;
+}
+
+static const struct file_operations timer_wakeups_fops = {
+	.open		= timer_wakeups_open,
+	.read		= seq_read,
+	.write		= timer_wakeups_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init init_timer_wakeups_procfs(void)
+{
+	if (!proc_create("timer_wakeups", 0600, NULL, &timer_wakeups_fops))
+		return -ENOMEM;
+	return 0;
+}
+__initcall(init_timer_wakeups_procfs);
+
@@ -0,0 +1,158 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Per-CPU latency histograms of driver hot paths, see <linux/lat_hist.h>
+ */
+
+#include <linux/debugfs.h>
+#include <linux/device.h>
+#include <linux/export.h>
+#include <linux/lat_hist.h>
+#include <linux/mutex.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+
+static struct dentry *lat_hist_root;
+static DEFINE_MUTEX(lat_hist_lock);
+
+/* Permille of the samples each percentile line is printed for */
+static const unsigned int lat_hist_pcts[] = { 500, 900, 990, 999 };
+
+static void lat_hist_sum(struct lat_hist *hist, u64 *count)
+{
+	int cpu, i;
+
+	memset(count, 0, sizeof(u64) * LAT_HIST_BUCKETS);
+
+	for_each_possible_cpu(cpu) {
+		struct lat_hist_cpu *c = per_cpu_ptr(hist->cpu, cpu);
+
+		for (i = 0; i < LAT_HIST_BUCKETS; i++)
+			count[i] += READ_ONCE(c->count[i]);
+	}
+}
+
+static int lat_hist_show(struct seq_file *s, void *data)
+{
+	struct lat_hist *hist = s->private;
+	u64 count[LAT_HIST_BUCKETS];
+	u64 total = 0, sum, rank;
+	unsigned int i, p;
+
+	lat_hist_sum(hist, count);
+	for (i = 0; i < LAT_HIST_BUCKETS; i++)
+		total += count[i];
+
+	seq_printf(s, "samples: %llu\n", total);
+	if (!total)
+		return 0;
+
+	/* Percentiles are rounded up to the bound of their bucket */
+	for (p = 0; p < ARRAY_SIZE(lat_hist_pcts); p++) {
+		rank = DIV_ROUND_UP_ULL(total * lat_hist_pcts[p], 1000);
+		for (i = 0, sum = 0; i < LAT_HIST_BUCKETS - 1; i++) {
+			sum += count[i];
+			if (sum >= rank)
+				break;
+		}
+		seq_printf(s, "p%u.%u: %s%llu ns\n", lat_hist_pcts[p] / 10,
+			   lat_hist_pcts[p] % 10,
+			   i == LAT_HIST_BUCKETS - 1 ? ">= " : "< ",
+			   i == LAT_HIST_BUCKETS - 1 ? 1ULL << (i - 1) : 1ULL << i);
+	}
+
+	for (i = 0; i < LAT_HIST_BUCKETS; i++) {
+		if (!count[i])
+			continue;
+		seq_printf(s, "%12llu - %12llu ns: %llu\n",
+			   i ? 1ULL << (i - 1) : 0ULL,
+			   i == LAT_HIST_BUCKETS - 1 ? U64_MAX : (1ULL << i) - 1,
+			   count[i]);
+	}
+
+	return 0;
+}
+
+static int lat_hist_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, lat_hist_show, inode->i_private);
+}
+
+static ssize_t lat_hist_write(struct file *file, const char __user *buf,
+			      size_t len, loff_t *ppos)
+{
+	struct lat_hist *hist = file_inode(file)->i_private;
+	int cpu;
+
+	/* Samples recorded meanwhile may be lost, which doesn't matter here */
+	for_each_possible_cpu(cpu)
+		memset(per_cpu_ptr(hist->cpu, cpu), 0,
+		       sizeof(struct lat_hist_cpu));
+
+	return len;
+}
+
+static const struct file_operations lat_hist_fops = {
+	.owner = THIS_MODULE,
+	.open = lat_hist_open,
+	.read = seq_read,
+	.write = lat_hist_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static void devm_lat_hist_release(struct device *dev, void *res)
+{
+	struct lat_hist *hist = res;
+
+	debugfs_remove(hist->dentry);
+	free_percpu(hist->cpu);
+}
+
+/**
+ * devm_lat_hist_add() - add a latency histogram to a device
+ * @dev: device the histogram belongs to
+ * @name: name of the histogram in the debugfs directory of the device
+ *
+ * The histogram is removed when the device is unbound.
+ *
+ * Return: the histogram, or NULL if it couldn't be allocated, which the
+ * recording functions accept so that callers needn't care.
+ */
+struct lat_hist *devm_lat_hist_add(struct device *dev, const char *name)
+{
+	struct dentry *dir;
+	struct lat_hist *hist;
+
+	hist = devres_alloc(devm_lat_hist_release, sizeof(*hist), GFP_KERNEL);
+	if (!hist)
+		return NULL;
+
+	hist->cpu = alloc_percpu(struct lat_hist_cpu);
+	if (!hist->cpu) {
+		devres_free(hist);
+		return NULL;
+	}
+
+	mutex_lock(&lat_hist_lock);
+
+	if (!lat_hist_root)
+		lat_hist_root = debugfs_create_dir("lat_hist", NULL);
+
+	/* The directory of the device is shared by all of its histograms */
+	dir = debugfs_lookup(dev_name(dev), lat_hist_root);
+	if (dir)
+		dput(dir);
+	else
+		dir = debugfs_create_dir(dev_name(dev), lat_hist_root);
+
+	hist->dentry = debugfs_create_file(name, 0600, dir, hist,
+					   &lat_hist_fops);
+
+	mutex_unlock(&lat_hist_lock);
+
+	devres_add(dev, hist);
+
+	return hist;
+}
+EXPORT_SYMBOL_GPL(devm_lat_hist_add);
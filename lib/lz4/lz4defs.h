@@ -67,6 +67,16 @@ typedef uintptr_t uptrval;
 #define LZ4_LITTLE_ENDIAN 0
 #endif
 
+/*
+ * Decode short sequences with fixed size copies and long ones 16 bytes at
+ * a time, which arm64 does with a single LDP/STP pair.
+ */
+#if defined(CONFIG_ARM64)
+#define LZ4_FAST_DEC_LOOP 1
+#else
+#define LZ4_FAST_DEC_LOOP 0
+#endif
+
 /*-************************************
  *	Constants
  **************************************/
@@ -165,6 +175,33 @@ static FORCE_INLINE void LZ4_wildCopy(void *dstPtr,
 	} while (d < e);
 }
 
+static FORCE_INLINE void LZ4_copy16(void *dst, const void *src)
+{
+	U64 a = get_unaligned((const U64 *)src);
+	U64 b = get_unaligned((const U64 *)src + 1);
+
+	put_unaligned(a, (U64 *)dst);
+	put_unaligned(b, (U64 *)dst + 1);
+}
+
+/*
+ * LZ4_wildCopy() 16 bytes at a time,
+ * which can overwrite up to 15 bytes beyond dstEnd
+ */
+static FORCE_INLINE void LZ4_wildCopy16(void *dstPtr,
+	const void *srcPtr, void *dstEnd)
+{
+	BYTE *d = (BYTE *)dstPtr;
+	const BYTE *s = (const BYTE *)srcPtr;
+	BYTE *const e = (BYTE *)dstEnd;
+
+	do {
+		LZ4_copy16(d, s);
+		d += 16;
+		s += 16;
+	} while (d < e);
+}
+
 static FORCE_INLINE unsigned int LZ4_NbCommonBytes(register size_t val)
 {
 #if LZ4_LITTLE_ENDIAN
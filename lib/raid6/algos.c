@@ -91,6 +91,7 @@ const struct raid6_calls * const raid6_algos[] = {
 	&raid6_neonx2,
 	&raid6_neonx4,
 	&raid6_neonx8,
+	&raid6_neonpx4,
 #endif
 	NULL
 };
@@ -20,45 +20,48 @@
 
 /*
  * There are 2 reasons these wrappers are kept in a separate compilation unit
- * from the actual implementations in neonN.c (generated from neon.uc by
- * unroll.awk):
+ * from the actual implementations in neonN.c and neonpN.c (generated from
+ * neon.uc and neonp.uc by unroll.awk):
  * - the actual implementations use NEON intrinsics, and the GCC support header
  *   (arm_neon.h) is not fully compatible (type wise) with the kernel;
- * - the neonN.c files are compiled with -mfpu=neon and optimization enabled,
- *   and we have to make sure that we never use *any* NEON/VFP instructions
+ * - the neonN.c and neonpN.c files are compiled with -mfpu=neon and
+ *   optimization enabled, and we have to make sure that we never use *any* NEON/VFP instructions
  *   outside a kernel_neon_begin()/kernel_neon_end() pair.
  */
 
-#define RAID6_NEON_WRAPPER(_n)						\
-	static void raid6_neon ## _n ## _gen_syndrome(int disks,	\
+#define __RAID6_NEON_WRAPPER(_v, _n)					\
+	static void raid6_ ## _v ## _n ## _gen_syndrome(int disks,	\
 					size_t bytes, void **ptrs)	\
 	{								\
-		void raid6_neon ## _n  ## _gen_syndrome_real(int,	\
+		void raid6_ ## _v ## _n ## _gen_syndrome_real(int,	\
 						unsigned long, void**);	\
 		kernel_neon_begin();					\
-		raid6_neon ## _n ## _gen_syndrome_real(disks,		\
+		raid6_ ## _v ## _n ## _gen_syndrome_real(disks,		\
 					(unsigned long)bytes, ptrs);	\
 		kernel_neon_end();					\
 	}								\
-	static void raid6_neon ## _n ## _xor_syndrome(int disks,	\
+	static void raid6_ ## _v ## _n ## _xor_syndrome(int disks,	\
 					int start, int stop, 		\
 					size_t bytes, void **ptrs)	\
 	{								\
-		void raid6_neon ## _n  ## _xor_syndrome_real(int,	\
+		void raid6_ ## _v ## _n ## _xor_syndrome_real(int,	\
 				int, int, unsigned long, void**);	\
 		kernel_neon_begin();					\
-		raid6_neon ## _n ## _xor_syndrome_real(disks,		\
+		raid6_ ## _v ## _n ## _xor_syndrome_real(disks,		\
 			start, stop, (unsigned long)bytes, ptrs);	\
 		kernel_neon_end();					\
 	}								\
-	struct raid6_calls const raid6_neonx ## _n = {			\
-		raid6_neon ## _n ## _gen_syndrome,			\
-		raid6_neon ## _n ## _xor_syndrome,			\
+	struct raid6_calls const raid6_ ## _v ## x ## _n = {		\
+		raid6_ ## _v ## _n ## _gen_syndrome,			\
+		raid6_ ## _v ## _n ## _xor_syndrome,			\
 		raid6_have_neon,					\
-		"neonx" #_n,						\
+		#_v "x" #_n,						\
 		0							\
 	}
 
+#define RAID6_NEON_WRAPPER(_n)		__RAID6_NEON_WRAPPER(neon, _n)
+#define RAID6_NEONP_WRAPPER(_n)		__RAID6_NEON_WRAPPER(neonp, _n)
+
 static int raid6_have_neon(void)
 {
 	return cpu_has_neon();
@@ -68,3 +71,4 @@ RAID6_NEON_WRAPPER(1);
 RAID6_NEON_WRAPPER(2);
 RAID6_NEON_WRAPPER(4);
 RAID6_NEON_WRAPPER(8);
+RAID6_NEONP_WRAPPER(4);
@@ -0,0 +1,182 @@
+/* -----------------------------------------------------------------------
+ *
+ *   neonp.uc - RAID-6 syndrome calculation using ARM NEON instructions,
+ *              scheduled for in-order cores
+ *
+ *   Based on neon.uc:
+ *     Copyright (C) 2012 Rob Herring
+ *     Copyright (C) 2015 Linaro Ltd. <ard.biesheuvel@linaro.org>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, Inc., 53 Temple Place Ste 330,
+ *   Boston MA 02111-1307, USA; either version 2 of the License, or
+ *   (at your option) any later version; incorporated herein by reference.
+ *
+ * ----------------------------------------------------------------------- */
+
+/*
+ * neonp$#.c
+ *
+ * $#-way unrolled NEON intrinsics math RAID-6 instruction set, consuming
+ * the data disks in pairs
+ *
+ * In neon.uc, each Q accumulator goes through five dependent instructions
+ * per data disk, and the load of a disk is only issued in the iteration
+ * using it. Out-of-order cores hide this, but in-order ones like the
+ * Cortex-A53 stall on every step. Here, the even and odd disks of a pair
+ * are folded into two separate Q accumulators, each multiplied by {02}^2
+ * per pair, and the loads of both disks are issued before any arithmetic.
+ * This doubles the number of independent dependency chains and halves
+ * their length, at the cost of one more multiplication at the end:
+ *
+ *	Q = sum(g^z * D_z) = qa * g + qb
+ *
+ * where qa and qb accumulate the odd and even numbered disks respectively.
+ *
+ * This file is postprocessed using unroll.awk
+ */
+
+#include <arm_neon.h>
+
+typedef uint8x16_t unative_t;
+
+#define NBYTES(x) ((unative_t){x,x,x,x, x,x,x,x, x,x,x,x, x,x,x,x})
+#define NSIZE	sizeof(unative_t)
+
+/*
+ * The MASK() operation returns 0xFF in any byte for which the high
+ * bit is 1, 0x00 for any byte for which the high bit is 0.
+ */
+static inline unative_t MASK(unative_t v)
+{
+	return (unative_t)vshrq_n_s8((int8x16_t)v, 7);
+}
+
+static inline unative_t PMUL(unative_t v, unative_t u)
+{
+	return (unative_t)vmulq_p8((poly8x16_t)v, (poly8x16_t)u);
+}
+
+/* Multiply each byte by {02} */
+static inline unative_t MUL2(unative_t v, unative_t x1d)
+{
+	return veorq_u8(vshlq_n_u8(v, 1), vandq_u8(MASK(v), x1d));
+}
+
+/*
+ * Multiply each byte by {04}: the two bits shifted out are reduced with a
+ * single polynomial multiplication, as {1d} times a 2 bit value still fits
+ * in a byte.
+ */
+static inline unative_t MUL4(unative_t v, unative_t x1d)
+{
+	return veorq_u8(vshlq_n_u8(v, 2), PMUL(vshrq_n_u8(v, 6), x1d));
+}
+
+void raid6_neonp$#_gen_syndrome_real(int disks, unsigned long bytes, void **ptrs)
+{
+	uint8_t **dptr = (uint8_t **)ptrs;
+	uint8_t *p, *q;
+	int d, z, z0;
+
+	register unative_t wa$$, wb$$, wp$$, wqa$$, wqb$$;
+	const unative_t x1d = NBYTES(0x1d);
+
+	z0 = disks - 3;		/* Highest data disk */
+	p = dptr[z0+1];		/* XOR parity */
+	q = dptr[z0+2];		/* RS syndrome */
+
+	for ( d = 0 ; d < bytes ; d += NSIZE*$# ) {
+		if ( z0 & 1 ) {
+			/* Even number of data disks */
+			wqa$$ = vld1q_u8(&dptr[z0][d+$$*NSIZE]);
+			wqb$$ = vld1q_u8(&dptr[z0-1][d+$$*NSIZE]);
+			wp$$ = veorq_u8(wqa$$, wqb$$);
+			z = z0-2;
+		} else {
+			/* Pair the highest disk with an implicit zero one */
+			wqa$$ = NBYTES(0);
+			wqb$$ = wp$$ = vld1q_u8(&dptr[z0][d+$$*NSIZE]);
+			z = z0-1;
+		}
+		for ( ; z >= 1 ; z -= 2 ) {
+			wa$$ = vld1q_u8(&dptr[z][d+$$*NSIZE]);
+			wb$$ = vld1q_u8(&dptr[z-1][d+$$*NSIZE]);
+			wqa$$ = veorq_u8(MUL4(wqa$$, x1d), wa$$);
+			wqb$$ = veorq_u8(MUL4(wqb$$, x1d), wb$$);
+			wp$$ = veorq_u8(wp$$, veorq_u8(wa$$, wb$$));
+		}
+		wqa$$ = veorq_u8(MUL2(wqa$$, x1d), wqb$$);
+		vst1q_u8(&p[d+NSIZE*$$], wp$$);
+		vst1q_u8(&q[d+NSIZE*$$], wqa$$);
+	}
+}
+
+void raid6_neonp$#_xor_syndrome_real(int disks, int start, int stop,
+				     unsigned long bytes, void **ptrs)
+{
+	uint8_t **dptr = (uint8_t **)ptrs;
+	uint8_t *p, *q;
+	int d, z, z0;
+
+	register unative_t wa$$, wb$$, wp$$, wqa$$, wqb$$;
+	const unative_t x1d = NBYTES(0x1d);
+
+	z0 = stop;		/* P/Q right side optimization */
+	p = dptr[disks-2];	/* XOR parity */
+	q = dptr[disks-1];	/* RS syndrome */
+
+	for ( d = 0 ; d < bytes ; d += NSIZE*$# ) {
+		/* P/Q data pages, paired from the start disk up */
+		if ( (z0 - start) & 1 ) {
+			wqa$$ = vld1q_u8(&dptr[z0][d+$$*NSIZE]);
+			wqb$$ = vld1q_u8(&dptr[z0-1][d+$$*NSIZE]);
+			wp$$ = veorq_u8(vld1q_u8(&p[d+$$*NSIZE]), wqa$$);
+			wp$$ = veorq_u8(wp$$, wqb$$);
+			z = z0-2;
+		} else {
+			wqa$$ = NBYTES(0);
+			wqb$$ = vld1q_u8(&dptr[z0][d+$$*NSIZE]);
+			wp$$ = veorq_u8(vld1q_u8(&p[d+$$*NSIZE]), wqb$$);
+			z = z0-1;
+		}
+		for ( ; z >= start+1 ; z -= 2 ) {
+			wa$$ = vld1q_u8(&dptr[z][d+$$*NSIZE]);
+			wb$$ = vld1q_u8(&dptr[z-1][d+$$*NSIZE]);
+			wqa$$ = veorq_u8(MUL4(wqa$$, x1d), wa$$);
+			wqb$$ = veorq_u8(MUL4(wqb$$, x1d), wb$$);
+			wp$$ = veorq_u8(wp$$, veorq_u8(wa$$, wb$$));
+		}
+		wqa$$ = veorq_u8(MUL2(wqa$$, x1d), wqb$$);
+
+		/* P/Q left side optimization */
+		for ( z = start-1 ; z >= 3 ; z -= 4 ) {
+			wb$$ = vshrq_n_u8(wqa$$, 4);
+			wa$$ = vshlq_n_u8(wqa$$, 4);
+
+			wb$$ = PMUL(wb$$, x1d);
+			wqa$$ = veorq_u8(wa$$, wb$$);
+		}
+
+		switch (z) {
+		case 2:
+			wb$$ = vshrq_n_u8(wqa$$, 5);
+			wa$$ = vshlq_n_u8(wqa$$, 3);
+
+			wb$$ = PMUL(wb$$, x1d);
+			wqa$$ = veorq_u8(wa$$, wb$$);
+			break;
+		case 1:
+			wqa$$ = MUL4(wqa$$, x1d);
+			break;
+		case 0:
+			wqa$$ = MUL2(wqa$$, x1d);
+		}
+		wa$$ = vld1q_u8(&q[d+NSIZE*$$]);
+		wqa$$ = veorq_u8(wqa$$, wa$$);
+
+		vst1q_u8(&p[d+NSIZE*$$], wp$$);
+		vst1q_u8(&q[d+NSIZE*$$], wqa$$);
+	}
+}
@@ -33,6 +33,16 @@ static uint8x16_t vqtbl1q_u8(uint8x16_t a, uint8x16_t b)
 }
 #endif
 
+/*
+ * Multiply each byte by a constant using the 16 entry tables for its low and
+ * high nibble. A plain byte shift isolates the high nibble without masking.
+ */
+static inline uint8x16_t gfmul(uint8x16_t v, uint8x16_t lo, uint8x16_t hi)
+{
+	return veorq_u8(vqtbl1q_u8(lo, vandq_u8(v, x0f)),
+			vqtbl1q_u8(hi, vshrq_n_u8(v, 4)));
+}
+
 void __raid6_2data_recov_neon(int bytes, uint8_t *p, uint8_t *q, uint8_t *dp,
 			      uint8_t *dq, const uint8_t *pbmul,
 			      const uint8_t *qmul)
@@ -52,33 +62,34 @@ void __raid6_2data_recov_neon(int bytes, uint8_t *p, uint8_t *q, uint8_t *dp,
 	 *	*dp++ = db ^ px;
 	 *	p++; q++;
 	 * }
+	 *
+	 * Two independent 16 byte blocks are handled per iteration, so that
+	 * in-order cores have other work to issue while a lookup completes.
 	 */
 
 	while (bytes) {
-		uint8x16_t vx, vy, px, qx, db;
-
-		px = veorq_u8(vld1q_u8(p), vld1q_u8(dp));
-		vx = veorq_u8(vld1q_u8(q), vld1q_u8(dq));
-
-		vy = (uint8x16_t)vshrq_n_s16((int16x8_t)vx, 4);
-		vx = vqtbl1q_u8(qm0, vandq_u8(vx, x0f));
-		vy = vqtbl1q_u8(qm1, vandq_u8(vy, x0f));
-		qx = veorq_u8(vx, vy);
-
-		vy = (uint8x16_t)vshrq_n_s16((int16x8_t)px, 4);
-		vx = vqtbl1q_u8(pm0, vandq_u8(px, x0f));
-		vy = vqtbl1q_u8(pm1, vandq_u8(vy, x0f));
-		vx = veorq_u8(vx, vy);
-		db = veorq_u8(vx, qx);
-
-		vst1q_u8(dq, db);
-		vst1q_u8(dp, veorq_u8(db, px));
-
-		bytes -= 16;
-		p += 16;
-		q += 16;
-		dp += 16;
-		dq += 16;
+		uint8x16_t px0, px1, qx0, qx1, db0, db1;
+
+		px0 = veorq_u8(vld1q_u8(p), vld1q_u8(dp));
+		px1 = veorq_u8(vld1q_u8(p + 16), vld1q_u8(dp + 16));
+		qx0 = veorq_u8(vld1q_u8(q), vld1q_u8(dq));
+		qx1 = veorq_u8(vld1q_u8(q + 16), vld1q_u8(dq + 16));
+
+		qx0 = gfmul(qx0, qm0, qm1);
+		qx1 = gfmul(qx1, qm0, qm1);
+		db0 = veorq_u8(gfmul(px0, pm0, pm1), qx0);
+		db1 = veorq_u8(gfmul(px1, pm0, pm1), qx1);
+
+		vst1q_u8(dq, db0);
+		vst1q_u8(dq + 16, db1);
+		vst1q_u8(dp, veorq_u8(db0, px0));
+		vst1q_u8(dp + 16, veorq_u8(db1, px1));
+
+		bytes -= 32;
+		p += 32;
+		q += 32;
+		dp += 32;
+		dq += 32;
 	}
 }
 
@@ -96,22 +107,22 @@ void __raid6_datap_recov_neon(int bytes, uint8_t *p, uint8_t *q, uint8_t *dq,
 	 */
 
 	while (bytes) {
-		uint8x16_t vx, vy;
+		uint8x16_t vx0, vx1;
 
-		vx = veorq_u8(vld1q_u8(q), vld1q_u8(dq));
+		vx0 = veorq_u8(vld1q_u8(q), vld1q_u8(dq));
+		vx1 = veorq_u8(vld1q_u8(q + 16), vld1q_u8(dq + 16));
 
-		vy = (uint8x16_t)vshrq_n_s16((int16x8_t)vx, 4);
-		vx = vqtbl1q_u8(qm0, vandq_u8(vx, x0f));
-		vy = vqtbl1q_u8(qm1, vandq_u8(vy, x0f));
-		vx = veorq_u8(vx, vy);
-		vy = veorq_u8(vx, vld1q_u8(p));
+		vx0 = gfmul(vx0, qm0, qm1);
+		vx1 = gfmul(vx1, qm0, qm1);
 
-		vst1q_u8(dq, vx);
-		vst1q_u8(p, vy);
+		vst1q_u8(dq, vx0);
+		vst1q_u8(dq + 16, vx1);
+		vst1q_u8(p, veorq_u8(vx0, vld1q_u8(p)));
+		vst1q_u8(p + 16, veorq_u8(vx1, vld1q_u8(p + 16)));
 
-		bytes -= 16;
-		p += 16;
-		q += 16;
-		dq += 16;
+		bytes -= 32;
+		p += 32;
+		q += 32;
+		dq += 32;
 	}
 }
@@ -0,0 +1,173 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * LZ4 decompression benchmark
+ *
+ * Compresses a few kinds of page sized data, similar to what squashfs, zram
+ * and f2fs hand to the decompressor, and reports how fast it is decoded back.
+ */
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/lz4.h>
+#include <linux/module.h>
+#include <linux/random.h>
+#include <linux/vmalloc.h>
+
+#define LZ4_BENCH_SIZE	(1 << 20)	/* data decompressed per run */
+#define LZ4_BENCH_BLOCK	(128 << 10)	/* squashfs default block size */
+
+static unsigned int runs = 50;
+module_param(runs, uint, 0444);
+MODULE_PARM_DESC(runs, "Number of times the data is decompressed");
+
+/* Short and long repeats of recent data, with random literals in between */
+static void lz4_bench_fill_text(u8 *buf, size_t len)
+{
+	size_t i, n, off;
+
+	for (i = 0; i < len; ) {
+		if (i < 64 || prandom_u32_max(8) == 0) {
+			buf[i++] = 'a' + prandom_u32_max(26);
+			continue;
+		}
+		off = 1 + prandom_u32_max(min_t(size_t, i, 4096));
+		n = min_t(size_t, 4 + prandom_u32_max(28), len - i);
+		for (; n; n--, i++)
+			buf[i] = buf[i - off];
+	}
+}
+
+/* Executable and table like data: mostly aligned words, many zeroes */
+static void lz4_bench_fill_binary(u8 *buf, size_t len)
+{
+	u32 *p = (u32 *)buf;
+	size_t i;
+
+	for (i = 0; i < len / sizeof(u32); i++) {
+		switch (prandom_u32_max(4)) {
+		case 0:
+			p[i] = 0;
+			break;
+		case 1:
+			p[i] = i >= 16 ? p[i - 16] : 0;
+			break;
+		case 2:
+			p[i] = 0xd503201f;
+			break;
+		default:
+			p[i] = prandom_u32_max(1 << 12) << 5;
+			break;
+		}
+	}
+}
+
+/* Runs of a single byte, as in sparse and zero filled pages */
+static void lz4_bench_fill_runs(u8 *buf, size_t len)
+{
+	size_t i, n;
+	u8 c;
+
+	for (i = 0; i < len; ) {
+		c = prandom_u32_max(4) ? 0 : prandom_u32();
+		n = min_t(size_t, 1 + prandom_u32_max(512), len - i);
+		memset(buf + i, c, n);
+		i += n;
+	}
+}
+
+static const struct {
+	const char *name;
+	void (*fill)(u8 *buf, size_t len);
+} lz4_bench_data[] = {
+	{ "text", lz4_bench_fill_text },
+	{ "binary", lz4_bench_fill_binary },
+	{ "runs", lz4_bench_fill_runs },
+};
+
+static int lz4_bench_one(const char *name, char *src, char *comp, char *dst,
+			 size_t block, void *wrkmem)
+{
+	int clen[LZ4_BENCH_SIZE / PAGE_SIZE];
+	size_t nblocks = LZ4_BENCH_SIZE / block;
+	size_t i, csize = 0;
+	unsigned int r;
+	ktime_t t;
+	char *p;
+	u64 ns;
+	int ret;
+
+	for (i = 0; i < nblocks; i++) {
+		clen[i] = LZ4_compress_default(src + i * block,
+					       comp + csize, block,
+					       LZ4_COMPRESSBOUND(block),
+					       wrkmem);
+		if (clen[i] <= 0)
+			return -EINVAL;
+		csize += clen[i];
+	}
+
+	t = ktime_get();
+	for (r = 0; r < runs; r++) {
+		for (i = 0, p = comp; i < nblocks; p += clen[i++]) {
+			ret = LZ4_decompress_safe(p, dst + i * block,
+						  clen[i], block);
+			if (ret != block)
+				return -EINVAL;
+		}
+		cond_resched();
+	}
+	ns = ktime_to_ns(ktime_sub(ktime_get(), t));
+
+	if (memcmp(src, dst, LZ4_BENCH_SIZE)) {
+		pr_err("%s: decompressed data mismatch\n", name);
+		return -EINVAL;
+	}
+
+	pr_info("%-6s %6zuK blocks, ratio %3zu%%: %llu MB/s\n",
+		name, block >> 10, csize * 100 / LZ4_BENCH_SIZE,
+		div64_u64((u64)LZ4_BENCH_SIZE * runs * NSEC_PER_SEC,
+			  max_t(u64, ns, 1) << 20));
+	return 0;
+}
+
+static int __init test_lz4_init(void)
+{
+	static const size_t blocks[] = { PAGE_SIZE, LZ4_BENCH_BLOCK };
+	char *src, *comp, *dst;
+	void *wrkmem;
+	size_t i, j;
+	int ret = -ENOMEM;
+
+	src = vmalloc(LZ4_BENCH_SIZE);
+	dst = vmalloc(LZ4_BENCH_SIZE);
+	/* Page sized blocks have the most overhead */
+	comp = vmalloc(LZ4_BENCH_SIZE / PAGE_SIZE *
+		       LZ4_COMPRESSBOUND(PAGE_SIZE));
+	wrkmem = vmalloc(LZ4_MEM_COMPRESS);
+	if (!src || !dst || !comp || !wrkmem)
+		goto out;
+
+	for (i = 0; i < ARRAY_SIZE(lz4_bench_data); i++) {
+		lz4_bench_data[i].fill((u8 *)src, LZ4_BENCH_SIZE);
+		for (j = 0; j < ARRAY_SIZE(blocks); j++) {
+			ret = lz4_bench_one(lz4_bench_data[i].name, src, comp,
+					    dst, blocks[j], wrkmem);
+			if (ret)
+				goto out;
+		}
+	}
+
+out:
+	vfree(wrkmem);
+	vfree(comp);
+	vfree(dst);
+	vfree(src);
+	/* Nothing to keep around once the results are printed */
+	return ret ? ret : -EAGAIN;
+}
+module_init(test_lz4_init);
+
+MODULE_DESCRIPTION("LZ4 decompression benchmark");
+MODULE_LICENSE("GPL v2");
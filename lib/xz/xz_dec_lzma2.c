@@ -497,22 +497,24 @@ static __always_inline void rc_normalize(struct rc_dec *rc)
 static __always_inline int rc_bit(struct rc_dec *rc, uint16_t *prob)
 {
 	uint32_t bound;
-	int bit;
+	uint32_t mask;
+	uint32_t p = *prob;
 
 	rc_normalize(rc);
-	bound = (rc->range >> RC_BIT_MODEL_TOTAL_BITS) * *prob;
-	if (rc->code < bound) {
-		rc->range = bound;
-		*prob += (RC_BIT_MODEL_TOTAL - *prob) >> RC_MOVE_BITS;
-		bit = 0;
-	} else {
-		rc->range -= bound;
-		rc->code -= bound;
-		*prob -= *prob >> RC_MOVE_BITS;
-		bit = 1;
-	}
+	bound = (rc->range >> RC_BIT_MODEL_TOTAL_BITS) * p;
 
-	return bit;
+	/*
+	 * The decoded bit is as good as random, so select the new state
+	 * with a mask instead of branching on it: mask is all ones for 1.
+	 */
+	mask = 0U - (uint32_t)(rc->code >= bound);
+	rc->range = ((rc->range - bound) & mask) | (bound & ~mask);
+	rc->code -= bound & mask;
+	*prob = (uint16_t)(((p - (p >> RC_MOVE_BITS)) & mask)
+			| ((p + ((RC_BIT_MODEL_TOTAL - p) >> RC_MOVE_BITS))
+			   & ~mask));
+
+	return mask & 1;
 }
 
 /* Decode a bittree starting from the most significant bit. */
@@ -522,10 +524,7 @@ static __always_inline uint32_t rc_bittree(struct rc_dec *rc,
 	uint32_t symbol = 1;
 
 	do {
-		if (rc_bit(rc, &probs[symbol]))
-			symbol = (symbol << 1) + 1;
-		else
-			symbol <<= 1;
+		symbol = (symbol << 1) + rc_bit(rc, &probs[symbol]);
 	} while (symbol < limit);
 
 	return symbol;
@@ -538,14 +537,12 @@ static __always_inline void rc_bittree_reverse(struct rc_dec *rc,
 {
 	uint32_t symbol = 1;
 	uint32_t i = 0;
+	uint32_t bit;
 
 	do {
-		if (rc_bit(rc, &probs[symbol])) {
-			symbol = (symbol << 1) + 1;
-			*dest += 1 << i;
-		} else {
-			symbol <<= 1;
-		}
+		bit = rc_bit(rc, &probs[symbol]);
+		symbol = (symbol << 1) + bit;
+		*dest += bit << i;
 	} while (++i < limit);
 }
 
@@ -585,6 +582,7 @@ static void lzma_literal(struct xz_dec_lzma2 *s)
 	uint32_t match_byte;
 	uint32_t match_bit;
 	uint32_t offset;
+	uint32_t bit;
 	uint32_t i;
 
 	probs = lzma_literal_probs(s);
@@ -601,13 +599,10 @@ static void lzma_literal(struct xz_dec_lzma2 *s)
 			match_byte <<= 1;
 			i = offset + match_bit + symbol;
 
-			if (rc_bit(&s->rc, &probs[i])) {
-				symbol = (symbol << 1) + 1;
-				offset &= match_bit;
-			} else {
-				symbol <<= 1;
-				offset &= ~match_bit;
-			}
+			/* Keep match_bit in offset if bit is 1, clear it if 0 */
+			bit = rc_bit(&s->rc, &probs[i]);
+			symbol = (symbol << 1) + bit;
+			offset &= match_bit ^ (bit - 1);
 		} while (symbol < 0x100);
 	}
 
@@ -10,6 +10,7 @@
 #include <linux/kernel.h>
 #include <linux/module.h>
 #include <linux/fs.h>
+#include <linux/ktime.h>
 #include <linux/uaccess.h>
 #include <linux/crc32.h>
 #include <linux/xz.h>
@@ -61,6 +62,13 @@ static struct xz_buf buffers = {
  */
 static uint32_t crc;
 
+/*
+ * Time spent in xz_dec_run() and the amount of uncompressed data, to give
+ * the decoding speed at the end.
+ */
+static u64 decode_ns;
+static u64 decode_size;
+
 static int xz_dec_test_open(struct inode *i, struct file *f)
 {
 	if (device_is_open)
@@ -71,6 +79,8 @@ static int xz_dec_test_open(struct inode *i, struct file *f)
 	xz_dec_reset(state);
 	ret = XZ_OK;
 	crc = 0xFFFFFFFF;
+	decode_ns = 0;
+	decode_size = 0;
 
 	buffers.in_pos = 0;
 	buffers.in_size = 0;
@@ -103,6 +113,7 @@ static ssize_t xz_dec_test_write(struct file *file, const char __user *buf,
 				 size_t size, loff_t *pos)
 {
 	size_t remaining;
+	u64 start;
 
 	if (ret != XZ_OK) {
 		if (size > 0)
@@ -130,7 +141,10 @@ static ssize_t xz_dec_test_write(struct file *file, const char __user *buf,
 		}
 
 		buffers.out_pos = 0;
+		start = ktime_get_ns();
 		ret = xz_dec_run(state, &buffers);
+		decode_ns += ktime_get_ns() - start;
+		decode_size += buffers.out_pos;
 		crc = crc32(crc, buffer_out, buffers.out_pos);
 	}
 
@@ -142,6 +156,11 @@ static ssize_t xz_dec_test_write(struct file *file, const char __user *buf,
 	case XZ_STREAM_END:
 		printk(KERN_INFO DEVICE_NAME ": XZ_STREAM_END, "
 				"CRC32 = 0x%08X\n", ~crc);
+		printk(KERN_INFO DEVICE_NAME ": %llu bytes decoded in "
+				"%llu us, %llu KiB/s\n", decode_size,
+				div_u64(decode_ns, NSEC_PER_USEC),
+				div64_u64(decode_size * NSEC_PER_SEC,
+					  max_t(u64, decode_ns, 1) << 10));
 		return size - remaining - (buffers.in_size - buffers.in_pos);
 
 	case XZ_MEMLIMIT_ERROR:
@@ -4,6 +4,7 @@
  */
 
 #include <linux/zutil.h>
+#include <asm/unaligned.h>
 #include "inftrees.h"
 #include "inflate.h"
 #include "inffast.h"
@@ -38,6 +39,59 @@ get_unaligned16(const unsigned short *p)
 	return mm.us;
 }
 
+#ifdef CONFIG_HAVE_EFFICIENT_UNALIGNED_ACCESS
+/*
+   Copy matches within the output a machine word at a time. A copy may write
+   up to CHUNK_SLACK - 1 bytes past the end of the match, which are rewritten
+   by the following codes.
+ */
+#  define CHUNK_COPY
+#  define CHUNK_SLACK 16
+
+/* Bytes copied one at a time before a short distance is widened */
+static const unsigned char chunk_lead[8] = { 0, 7, 6, 6, 4, 5, 6, 7 };
+
+static inline void chunk_copy8(unsigned char *out, const unsigned char *from)
+{
+	put_unaligned(get_unaligned((const u64 *)from), (u64 *)out);
+}
+
+/*
+   Copy len bytes from dist bytes back. A pattern shorter than 8 bytes is
+   also periodic over the next multiple of its length, which is at least 8:
+   once that many bytes are there, the copy reads from that far back.
+ */
+static inline unsigned char *chunk_copy(unsigned char *out, unsigned dist,
+					unsigned len)
+{
+	unsigned char *end = out + len;
+	const unsigned char *from = out - dist;
+
+	if (dist < 8) {
+		unsigned lead = min(len, (unsigned)chunk_lead[dist]);
+
+		while (lead--)
+			*out++ = *from++;
+		from = out - (dist + chunk_lead[dist]);
+	}
+	if (dist >= 16) {
+		while (out < end) {
+			chunk_copy8(out, from);
+			chunk_copy8(out + 8, from + 8);
+			out += 16;
+			from += 16;
+		}
+	} else {
+		while (out < end) {
+			chunk_copy8(out, from);
+			out += 8;
+			from += 8;
+		}
+	}
+	return end;
+}
+#endif
+
 #ifdef POSTINC
 #  define OFF 0
 #  define PUP(a) *(a)++
@@ -93,6 +147,9 @@ void inflate_fast(z_streamp strm, unsigned start)
     unsigned char *out;         /* local strm->next_out */
     unsigned char *beg;         /* inflate()'s initial strm->next_out */
     unsigned char *end;         /* while out < end, enough space available */
+#ifdef CHUNK_COPY
+    unsigned char *limit;       /* end of the output buffer */
+#endif
 #ifdef INFLATE_STRICT
     unsigned dmax;              /* maximum distance from zlib header */
 #endif
@@ -120,6 +177,9 @@ void inflate_fast(z_streamp strm, unsigned start)
     out = strm->next_out - OFF;
     beg = out - (start - strm->avail_out);
     end = out + (strm->avail_out - 257);
+#ifdef CHUNK_COPY
+    limit = strm->next_out + strm->avail_out;
+#endif
 #ifdef INFLATE_STRICT
     dmax = state->dmax;
 #endif
@@ -257,6 +317,11 @@ void inflate_fast(z_streamp strm, unsigned start)
                             PUP(out) = PUP(from);
                     }
                 }
+#ifdef CHUNK_COPY
+                else if (limit - (out + OFF) >= len + CHUNK_SLACK) {
+                    out = chunk_copy(out + OFF, dist, len) - OFF;
+                }
+#endif
                 else {
 		    unsigned short *sout;
 		    unsigned long loops;
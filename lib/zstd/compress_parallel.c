@@ -0,0 +1,150 @@
+// SPDX-License-Identifier: (GPL-2.0 OR BSD-3-Clause)
+/*
+ * Parallel compression
+ *
+ * The source is cut into chunks which are compressed into independent
+ * frames. Each worker owns a context and a contiguous run of chunks, and
+ * writes its frames at the place the worst case of the preceding chunks
+ * would end. The runs are then packed together, which leaves the frames
+ * concatenated in order.
+ */
+
+#include "zstd_internal.h"
+#include <linux/kernel.h>
+#include <linux/workqueue.h>
+#include <linux/zstd.h>
+
+struct ZSTD_parallelJob {
+	struct work_struct work;
+	void *workspace;
+	size_t workspaceSize;
+	BYTE *dst;
+	size_t dstCapacity;
+	const BYTE *src;
+	size_t srcSize;
+	size_t chunkSize;
+	ZSTD_parameters params;
+	size_t result;
+};
+
+#define ZSTD_PARALLEL_JOB_SIZE ZSTD_ALIGN(sizeof(struct ZSTD_parallelJob))
+
+size_t ZSTD_CCtxParallelWorkspaceBound(ZSTD_compressionParameters cParams,
+	unsigned int nbWorkers)
+{
+	size_t const ctxSize = ZSTD_ALIGN(ZSTD_CCtxWorkspaceBound(cParams));
+
+	/* Room to align the start of the workspace */
+	return sizeof(size_t) +
+		(ZSTD_PARALLEL_JOB_SIZE + ctxSize) * max(nbWorkers, 1U);
+}
+
+size_t ZSTD_compressParallelBound(size_t srcSize, size_t chunkSize)
+{
+	size_t const nbChunks = chunkSize ? DIV_ROUND_UP(srcSize, chunkSize) : 0;
+
+	if (nbChunks <= 1)
+		return ZSTD_compressBound(srcSize);
+	return nbChunks * ZSTD_compressBound(chunkSize);
+}
+
+static void ZSTD_parallelJobRun(struct ZSTD_parallelJob *job)
+{
+	ZSTD_CCtx *const cctx = ZSTD_initCCtx(job->workspace, job->workspaceSize);
+	size_t pos = 0, out = 0;
+
+	if (!cctx) {
+		job->result = ERROR(memory_allocation);
+		return;
+	}
+
+	/* Even empty input gets its frame */
+	do {
+		size_t const n = min(job->chunkSize, job->srcSize - pos);
+		size_t const cSize = ZSTD_compressCCtx(cctx, job->dst + out,
+			job->dstCapacity - out, job->src + pos, n, job->params);
+
+		if (ZSTD_isError(cSize)) {
+			job->result = cSize;
+			return;
+		}
+		pos += n;
+		out += cSize;
+	} while (pos < job->srcSize);
+	job->result = out;
+}
+
+static void ZSTD_parallelJobWork(struct work_struct *work)
+{
+	ZSTD_parallelJobRun(container_of(work, struct ZSTD_parallelJob, work));
+}
+
+size_t ZSTD_compressParallel(void *workspace, size_t workspaceSize,
+	unsigned int nbWorkers, void *dst, size_t dstCapacity,
+	const void *src, size_t srcSize, size_t chunkSize,
+	ZSTD_parameters params)
+{
+	size_t const ctxSize = ZSTD_ALIGN(ZSTD_CCtxWorkspaceBound(params.cParams));
+	size_t const chunkBound = ZSTD_compressBound(chunkSize);
+	BYTE *const ws = ZSTD_PTR_ALIGN((BYTE *)workspace);
+	struct ZSTD_parallelJob *job;
+	size_t nbChunks, perJob, out = 0;
+	unsigned int nbJobs, i;
+
+	if (!chunkSize || !nbWorkers)
+		return ERROR(parameter_unknown);
+	if (workspaceSize < ZSTD_CCtxParallelWorkspaceBound(params.cParams, nbWorkers))
+		return ERROR(memory_allocation);
+
+	nbChunks = max_t(size_t, DIV_ROUND_UP(srcSize, chunkSize), 1);
+	perJob = DIV_ROUND_UP(nbChunks, nbWorkers);
+	nbJobs = DIV_ROUND_UP(nbChunks, perJob);
+
+	if (dstCapacity < ZSTD_compressParallelBound(srcSize, chunkSize))
+		return ERROR(dstSize_tooSmall);
+
+	for (i = 0; i < nbJobs; i++) {
+		size_t const first = i * perJob;
+
+		job = (struct ZSTD_parallelJob *)(ws +
+			i * (ZSTD_PARALLEL_JOB_SIZE + ctxSize));
+		job->workspace = (BYTE *)job + ZSTD_PARALLEL_JOB_SIZE;
+		job->workspaceSize = ctxSize;
+		job->dst = (BYTE *)dst + first * chunkBound;
+		job->dstCapacity = nbChunks == 1 ? dstCapacity :
+			min(perJob, nbChunks - first) * chunkBound;
+		job->src = (const BYTE *)src + first * chunkSize;
+		job->srcSize = min(perJob * chunkSize, srcSize - first * chunkSize);
+		job->chunkSize = chunkSize;
+		job->params = params;
+
+		/* The caller takes the first share */
+		if (i) {
+			INIT_WORK(&job->work, ZSTD_parallelJobWork);
+			queue_work(system_unbound_wq, &job->work);
+		}
+	}
+
+	ZSTD_parallelJobRun((struct ZSTD_parallelJob *)ws);
+
+	for (i = 0; i < nbJobs; i++) {
+		job = (struct ZSTD_parallelJob *)(ws +
+			i * (ZSTD_PARALLEL_JOB_SIZE + ctxSize));
+		if (i)
+			flush_work(&job->work);
+		if (ZSTD_isError(out))
+			continue;
+		if (ZSTD_isError(job->result)) {
+			out = job->result;
+			continue;
+		}
+		memmove((BYTE *)dst + out, job->dst, job->result);
+		out += job->result;
+	}
+
+	return out;
+}
+
+EXPORT_SYMBOL(ZSTD_CCtxParallelWorkspaceBound);
+EXPORT_SYMBOL(ZSTD_compressParallelBound);
+EXPORT_SYMBOL(ZSTD_compressParallel);
@@ -77,11 +77,15 @@ static inline unsigned long hold_time(const struct net_bridge *br)
 	return br->topology_change ? br->forward_delay : br->ageing_time;
 }
 
+/* Maximum number of entries aged out under one hash_lock hold */
+#define BR_FDB_GC_BATCH	32
+
 static inline int has_expired(const struct net_bridge *br,
 				  const struct net_bridge_fdb_entry *fdb)
 {
 	return !fdb->is_static && !fdb->added_by_external_learn &&
-		time_before_eq(fdb->updated + hold_time(br), jiffies);
+		time_before_eq(fdb->updated + hold_time(br) +
+			       BR_FDB_REFRESH_INTERVAL, jiffies);
 }
 
 static void fdb_rcu_free(struct rcu_head *head)
@@ -339,13 +343,16 @@ void br_fdb_cleanup(struct work_struct *work)
 	struct net_bridge *br = container_of(work, struct net_bridge,
 					     gc_work.work);
 	struct net_bridge_fdb_entry *f = NULL;
-	unsigned long delay = hold_time(br);
+	unsigned long delay = hold_time(br) + BR_FDB_REFRESH_INTERVAL;
 	unsigned long work_delay = delay;
 	unsigned long now = jiffies;
+	unsigned int batch = 0;
 
 	/* this part is tricky, in order to avoid blocking learning and
 	 * consequently forwarding, we rely on rcu to delete objects with
-	 * delayed freeing allowing us to continue traversing
+	 * delayed freeing allowing us to continue traversing.
+	 * Consecutive expired entries are deleted in batches under one
+	 * hash_lock hold, which is dropped at live entries.
 	 */
 	rcu_read_lock();
 	hlist_for_each_entry_rcu(f, &br->fdb_list, fdb_node) {
@@ -356,13 +363,23 @@ void br_fdb_cleanup(struct work_struct *work)
 		this_timer = f->updated + delay;
 		if (time_after(this_timer, now)) {
 			work_delay = min(work_delay, this_timer - now);
+			if (batch) {
+				spin_unlock_bh(&br->hash_lock);
+				batch = 0;
+			}
 		} else {
-			spin_lock_bh(&br->hash_lock);
+			if (!batch++)
+				spin_lock_bh(&br->hash_lock);
 			if (!hlist_unhashed(&f->fdb_node))
 				fdb_delete(br, f, true);
-			spin_unlock_bh(&br->hash_lock);
+			if (batch == BR_FDB_GC_BATCH) {
+				spin_unlock_bh(&br->hash_lock);
+				batch = 0;
+			}
 		}
 	}
+	if (batch)
+		spin_unlock_bh(&br->hash_lock);
 	rcu_read_unlock();
 
 	/* Cleanup minimum 10 milliseconds apart */
@@ -591,8 +608,7 @@ void br_fdb_update(struct net_bridge *br, struct net_bridge_port *source,
 				if (unlikely(fdb->added_by_external_learn))
 					fdb->added_by_external_learn = 0;
 			}
-			if (now != fdb->updated)
-				fdb->updated = now;
+			br_fdb_touch(&fdb->updated, now);
 			if (unlikely(added_by_user))
 				fdb->added_by_user = 1;
 			if (unlikely(fdb_modified)) {
@@ -28,6 +28,12 @@
 
 #define BR_HOLD_TIME (1*HZ)
 
+/* The updated and used stamps of FDB entries are only refreshed from the
+ * fast path once they are this stale, so that a host seen by several CPUs
+ * does not bounce its entry between their caches. Ageing allows for it.
+ */
+#define BR_FDB_REFRESH_INTERVAL	(HZ / 4)
+
 #define BR_PORT_BITS	10
 #define BR_MAX_PORTS	(1<<BR_PORT_BITS)
 
@@ -538,6 +544,12 @@ void br_fdb_change_mac_address(struct net_bridge *br, const u8 *newaddr);
 void br_fdb_cleanup(struct work_struct *work);
 void br_fdb_delete_by_port(struct net_bridge *br,
 			   const struct net_bridge_port *p, u16 vid, int do_all);
+static inline void br_fdb_touch(unsigned long *stamp, unsigned long now)
+{
+	if (time_after(now, READ_ONCE(*stamp) + BR_FDB_REFRESH_INTERVAL))
+		WRITE_ONCE(*stamp, now);
+}
+
 struct net_bridge_fdb_entry *br_fdb_find_rcu(struct net_bridge *br,
 					     const unsigned char *addr,
 					     __u16 vid);
@@ -217,7 +217,7 @@ int can_send(struct sk_buff *skb, int loop)
 {
 	struct sk_buff *newskb = NULL;
 	struct canfd_frame *cfd = (struct canfd_frame *)skb->data;
-	struct s_stats *can_stats = dev_net(skb->dev)->can.can_stats;
+	struct net *net = dev_net(skb->dev);
 	int err = -EINVAL;
 
 	if (skb->len == CAN_MTU) {
@@ -306,8 +306,7 @@ int can_send(struct sk_buff *skb, int loop)
 		netif_rx_ni(newskb);
 
 	/* update statistics */
-	can_stats->tx_frames++;
-	can_stats->tx_frames_delta++;
+	this_cpu_inc(net->can.can_pcpu_stats->tx_frames);
 
 	return 0;
 
@@ -684,12 +683,11 @@ static void can_receive(struct sk_buff *skb, struct net_device *dev)
 {
 	struct can_dev_rcv_lists *d;
 	struct net *net = dev_net(dev);
-	struct s_stats *can_stats = net->can.can_stats;
+	struct s_pcpu_stats *pcpu_stats = this_cpu_ptr(net->can.can_pcpu_stats);
 	int matches;
 
-	/* update statistics */
-	can_stats->rx_frames++;
-	can_stats->rx_frames_delta++;
+	/* update statistics, softirq context */
+	pcpu_stats->rx_frames++;
 
 	/* create non-zero unique skb identifier together with *skb */
 	while (!(can_skb_prv(skb)->skbcnt))
@@ -710,10 +708,8 @@ static void can_receive(struct sk_buff *skb, struct net_device *dev)
 	/* consume the skbuff allocated by the netdevice driver */
 	consume_skb(skb);
 
-	if (matches > 0) {
-		can_stats->matches++;
-		can_stats->matches_delta++;
-	}
+	if (matches > 0)
+		pcpu_stats->matches++;
 }
 
 static int can_rcv(struct sk_buff *skb, struct net_device *dev,
@@ -872,9 +868,12 @@ static int can_pernet_init(struct net *net)
 	net->can.can_stats = kzalloc(sizeof(struct s_stats), GFP_KERNEL);
 	if (!net->can.can_stats)
 		goto out_free_alldev_list;
+	net->can.can_pcpu_stats = alloc_percpu(struct s_pcpu_stats);
+	if (!net->can.can_pcpu_stats)
+		goto out_free_can_stats;
 	net->can.can_pstats = kzalloc(sizeof(struct s_pstats), GFP_KERNEL);
 	if (!net->can.can_pstats)
-		goto out_free_can_stats;
+		goto out_free_can_pcpu_stats;
 
 	if (IS_ENABLED(CONFIG_PROC_FS)) {
 		/* the statistics are updated every second (timer triggered) */
@@ -890,6 +889,8 @@ static int can_pernet_init(struct net *net)
 
 	return 0;
 
+ out_free_can_pcpu_stats:
+	free_percpu(net->can.can_pcpu_stats);
  out_free_can_stats:
 	kfree(net->can.can_stats);
  out_free_alldev_list:
@@ -923,6 +924,7 @@ static void can_pernet_exit(struct net *net)
 
 	kfree(net->can.can_rx_alldev_list);
 	kfree(net->can.can_stats);
+	free_percpu(net->can.can_pcpu_stats);
 	kfree(net->can.can_pstats);
 }
 
@@ -102,6 +102,13 @@ struct s_stats {
 	unsigned long matches_delta;
 };
 
+/* packet counters, updated per CPU and summed up by proc.c */
+struct s_pcpu_stats {
+	unsigned long rx_frames;
+	unsigned long tx_frames;
+	unsigned long matches;
+};
+
 /* persistent statistics */
 struct s_pstats {
 	unsigned long stats_reset;
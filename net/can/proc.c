@@ -75,16 +75,37 @@ static const char rx_list_name[][8] = {
  * af_can statistics stuff
  */
 
+static void can_stats_sum(struct net *net, struct s_pcpu_stats *sum)
+{
+	int cpu;
+
+	memset(sum, 0, sizeof(*sum));
+
+	for_each_possible_cpu(cpu) {
+		struct s_pcpu_stats *s = per_cpu_ptr(net->can.can_pcpu_stats,
+						     cpu);
+
+		sum->rx_frames += READ_ONCE(s->rx_frames);
+		sum->tx_frames += READ_ONCE(s->tx_frames);
+		sum->matches += READ_ONCE(s->matches);
+	}
+}
+
 static void can_init_stats(struct net *net)
 {
 	struct s_stats *can_stats = net->can.can_stats;
 	struct s_pstats *can_pstats = net->can.can_pstats;
+	int cpu;
 	/*
 	 * This memset function is called from a timer context (when
 	 * can_stattimer is active which is the default) OR in a process
 	 * context (reading the proc_fs when can_stattimer is disabled).
+	 * Frames counted concurrently on other CPUs may survive the reset.
 	 */
 	memset(can_stats, 0, sizeof(struct s_stats));
+	for_each_possible_cpu(cpu)
+		memset(per_cpu_ptr(net->can.can_pcpu_stats, cpu), 0,
+		       sizeof(struct s_pcpu_stats));
 	can_stats->jiffies_init = jiffies;
 
 	can_pstats->stats_reset++;
@@ -120,6 +141,7 @@ void can_stat_update(struct timer_list *t)
 	struct net *net = from_timer(net, t, can.can_stattimer);
 	struct s_stats *can_stats = net->can.can_stats;
 	unsigned long j = jiffies; /* snapshot */
+	struct s_pcpu_stats sum;
 
 	/* restart counting in timer context on user request */
 	if (user_reset)
@@ -129,6 +151,15 @@ void can_stat_update(struct timer_list *t)
 	if (j < can_stats->jiffies_init)
 		can_init_stats(net);
 
+	/* fold the per-CPU counters in */
+	can_stats_sum(net, &sum);
+	can_stats->rx_frames_delta = sum.rx_frames - can_stats->rx_frames;
+	can_stats->tx_frames_delta = sum.tx_frames - can_stats->tx_frames;
+	can_stats->matches_delta = sum.matches - can_stats->matches;
+	can_stats->rx_frames = sum.rx_frames;
+	can_stats->tx_frames = sum.tx_frames;
+	can_stats->matches = sum.matches;
+
 	/* prevent overflow in calc_rate() */
 	if (can_stats->rx_frames > (ULONG_MAX / HZ))
 		can_init_stats(net);
@@ -213,11 +244,14 @@ static int can_stats_proc_show(struct seq_file *m, void *v)
 	struct net *net = m->private;
 	struct s_stats *can_stats = net->can.can_stats;
 	struct s_pstats *can_pstats = net->can.can_pstats;
+	struct s_pcpu_stats sum;
+
+	can_stats_sum(net, &sum);
 
 	seq_putc(m, '\n');
-	seq_printf(m, " %8ld transmitted frames (TXF)\n", can_stats->tx_frames);
-	seq_printf(m, " %8ld received frames (RXF)\n", can_stats->rx_frames);
-	seq_printf(m, " %8ld matched frames (RXMF)\n", can_stats->matches);
+	seq_printf(m, " %8ld transmitted frames (TXF)\n", sum.tx_frames);
+	seq_printf(m, " %8ld received frames (RXF)\n", sum.rx_frames);
+	seq_printf(m, " %8ld matched frames (RXMF)\n", sum.matches);
 
 	seq_putc(m, '\n');
 
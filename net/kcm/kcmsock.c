@@ -188,7 +188,10 @@ static void kcm_rfree(struct sk_buff *skb)
 	}
 }
 
-static int kcm_queue_rcv_skb(struct sock *sk, struct sk_buff *skb)
+/* Queue a received message without waking up the reader. The caller is
+ * responsible for calling sk_data_ready.
+ */
+static int __kcm_queue_rcv_skb(struct sock *sk, struct sk_buff *skb)
 {
 	struct sk_buff_head *list = &sk->sk_receive_queue;
 
@@ -208,10 +211,17 @@ static int kcm_queue_rcv_skb(struct sock *sk, struct sk_buff *skb)
 
 	skb_queue_tail(list, skb);
 
-	if (!sock_flag(sk, SOCK_DEAD))
+	return 0;
+}
+
+static int kcm_queue_rcv_skb(struct sock *sk, struct sk_buff *skb)
+{
+	int err = __kcm_queue_rcv_skb(sk, skb);
+
+	if (!err && !sock_flag(sk, SOCK_DEAD))
 		sk->sk_data_ready(sk);
 
-	return 0;
+	return err;
 }
 
 /* Requeue received messages for a kcm socket to other kcm sockets. This is
@@ -309,6 +319,12 @@ static void unreserve_rx_kcm(struct kcm_psock *psock,
 	if (!kcm)
 		return;
 
+	/* Messages of the batch were queued without a wakeup, see
+	 * kcm_rcv_strparser.
+	 */
+	if (!sock_flag(&kcm->sk, SOCK_DEAD))
+		kcm->sk.sk_data_ready(&kcm->sk);
+
 	spin_lock_bh(&mux->rx_lock);
 
 	psock->rx_kcm = NULL;
@@ -370,7 +386,11 @@ try_queue:
 		return;
 	}
 
-	if (kcm_queue_rcv_skb(&kcm->sk, skb)) {
+	/* The KCM socket stays reserved for the rest of the receive batch
+	 * and is only woken up when it is unreserved, in kcm_read_sock_done,
+	 * rather than once per message.
+	 */
+	if (__kcm_queue_rcv_skb(&kcm->sk, skb)) {
 		/* Should mean socket buffer full */
 		unreserve_rx_kcm(psock, false);
 		goto try_queue;
@@ -27,9 +27,11 @@
  * Readers and resizing
  *
  * Resizing can be triggered by userspace command only, and those
- * are serialized by the nfnl mutex. During resizing the set is
- * read-locked, so the only possible concurrent operations are
- * the kernel side readers. Those must be protected by proper RCU locking.
+ * are serialized by the nfnl mutex. The new table is built without
+ * holding the set lock: kernel side readers keep using the old one
+ * under RCU, while kernel side adds and deletes are queued on a backlog
+ * and applied to the new table when it replaces the old one. Garbage
+ * collection is skipped while the old table is being copied.
  */
 
 /* Number of elements to store in an initial array block */
@@ -211,6 +213,9 @@ htable_bits(u32 hashsize)
 #undef mtype_uref
 #undef mtype_expire
 #undef mtype_resize
+#undef mtype_resize_ad
+#undef mtype_resize_defer
+#undef mtype_resize_backlog
 #undef mtype_head
 #undef mtype_list
 #undef mtype_gc
@@ -253,6 +258,9 @@ htable_bits(u32 hashsize)
 #define mtype_uref		IPSET_TOKEN(MTYPE, _uref)
 #define mtype_expire		IPSET_TOKEN(MTYPE, _expire)
 #define mtype_resize		IPSET_TOKEN(MTYPE, _resize)
+#define mtype_resize_ad		IPSET_TOKEN(MTYPE, _resize_ad)
+#define mtype_resize_defer	IPSET_TOKEN(MTYPE, _resize_defer)
+#define mtype_resize_backlog	IPSET_TOKEN(MTYPE, _resize_backlog)
 #define mtype_head		IPSET_TOKEN(MTYPE, _head)
 #define mtype_list		IPSET_TOKEN(MTYPE, _list)
 #define mtype_gc		IPSET_TOKEN(MTYPE, _gc)
@@ -293,11 +301,21 @@ struct htype {
 	u8 netmask;		/* netmask value for subnets to store */
 #endif
 	struct mtype_elem next; /* temporary storage for uadd */
+	struct list_head ad;	/* kernel side add/del queued during resize */
 #ifdef IP_SET_HASH_WITH_NETS
 	struct net_prefixes nets[NLEN]; /* book-keeping of prefixes */
 #endif
 };
 
+/* Kernel side add/del saved while the hash is being resized */
+struct mtype_resize_ad {
+	struct list_head list;
+	enum ipset_adt ad;	/* ADD|DEL element */
+	struct mtype_elem d;	/* element value */
+	struct ip_set_ext ext;	/* extensions for ADD */
+	u32 flags;		/* flags for ADD */
+};
+
 #ifdef IP_SET_HASH_WITH_NETS
 /* Network cidr size book keeping when the hash stores different
  * sized networks. cidr == real cidr + 1 to support /0.
@@ -534,16 +552,64 @@ mtype_gc(struct timer_list *t)
 
 	pr_debug("called\n");
 	spin_lock_bh(&set->lock);
-	mtype_expire(set, h);
+	/* The table is being copied by resize, try again next period */
+	if (!atomic_read(&ipset_dereference_protected(h->table, set)->ref))
+		mtype_expire(set, h);
 	spin_unlock_bh(&set->lock);
 
 	h->gc.expires = jiffies + IPSET_GC_PERIOD(set->timeout) * HZ;
 	add_timer(&h->gc);
 }
 
+static int
+mtype_add(struct ip_set *set, void *value, const struct ip_set_ext *ext,
+	  struct ip_set_ext *mext, u32 flags);
+static int
+mtype_del(struct ip_set *set, void *value, const struct ip_set_ext *ext,
+	  struct ip_set_ext *mext, u32 flags);
+
+/* Queue a kernel side add/del which arrived while the set is resized */
+static int
+mtype_resize_defer(struct htype *h, enum ipset_adt ad, const void *value,
+		   const struct ip_set_ext *ext, u32 flags)
+{
+	struct mtype_resize_ad *x;
+
+	x = kzalloc(sizeof(*x), GFP_ATOMIC);
+	if (!x)
+		return -ENOMEM;
+	x->ad = ad;
+	memcpy(&x->d, value, sizeof(struct mtype_elem));
+	memcpy(&x->ext, ext, sizeof(struct ip_set_ext));
+	x->flags = flags;
+	list_add_tail(&x->list, &h->ad);
+
+	return 0;
+}
+
+/* Apply the queued kernel side add/del operations to the current table */
+static void
+mtype_resize_backlog(struct ip_set *set, struct htype *h)
+{
+	struct mtype_resize_ad *x, *tmp;
+
+	list_for_each_entry_safe(x, tmp, &h->ad, list) {
+		if (x->ad == IPSET_ADD)
+			mtype_add(set, &x->d, &x->ext, &x->ext, x->flags);
+		else
+			mtype_del(set, &x->d, &x->ext, &x->ext, x->flags);
+		list_del(&x->list);
+		kfree(x);
+	}
+}
+
 /* Resize a hash: create a new hash table with doubling the hashsize
  * and inserting the elements to it. Repeat until we succeed or
  * fail due to memory pressures.
+ *
+ * The old table is copied without the set lock held: while its ref is
+ * set, kernel side adds and deletes are queued by mtype_resize_defer()
+ * and the garbage collector leaves it alone, so only readers access it.
  */
 static int
 mtype_resize(struct ip_set *set, bool retried)
@@ -594,6 +660,7 @@ retry:
 	/* There can't be another parallel resizing, but dumping is possible */
 	atomic_set(&orig->ref, 1);
 	atomic_inc(&orig->uref);
+	spin_unlock_bh(&set->lock);
 	extsize = 0;
 	pr_debug("attempt to resize set %s from %u to %u, t %p\n",
 		 set->name, orig->htable_bits, htable_bits, orig);
@@ -619,7 +686,7 @@ retry:
 			if (!m) {
 				m = kzalloc(sizeof(*m) +
 					    AHASH_INIT_SIZE * dsize,
-					    GFP_ATOMIC);
+					    GFP_KERNEL);
 				if (!m) {
 					ret = -ENOMEM;
 					goto cleanup;
@@ -636,7 +703,7 @@ retry:
 					ht = kzalloc(sizeof(*ht) +
 						(m->size + AHASH_INIT_SIZE)
 						* dsize,
-						GFP_ATOMIC);
+						GFP_KERNEL);
 					if (!ht)
 						ret = -ENOMEM;
 				}
@@ -657,10 +724,13 @@ retry:
 			mtype_data_reset_flags(d, &flags);
 #endif
 		}
+		cond_resched();
 	}
+
+	spin_lock_bh(&set->lock);
 	rcu_assign_pointer(h->table, t);
 	set->ext_size = extsize;
-
+	mtype_resize_backlog(set, h);
 	spin_unlock_bh(&set->lock);
 
 	/* Give time to other readers of the set */
@@ -681,8 +751,10 @@ out:
 	return ret;
 
 cleanup:
+	spin_lock_bh(&set->lock);
 	atomic_set(&orig->ref, 0);
 	atomic_dec(&orig->uref);
+	mtype_resize_backlog(set, h);
 	spin_unlock_bh(&set->lock);
 	mtype_ahash_destroy(set, t, false);
 	if (ret == -EAGAIN)
@@ -707,6 +779,11 @@ mtype_add(struct ip_set *set, void *value, const struct ip_set_ext *ext,
 	bool deleted = false, forceadd = false, reuse = false;
 	u32 key, multi = 0;
 
+	t = ipset_dereference_protected(h->table, set);
+	if (atomic_read(&t->ref) && ext->target)
+		/* Resize is in process and kernel side add, save values */
+		return mtype_resize_defer(h, IPSET_ADD, value, ext, flags);
+
 	if (set->elements >= h->maxelem) {
 		if (SET_WITH_TIMEOUT(set))
 			/* FIXME: when set is full, we slow down here */
@@ -715,7 +792,6 @@ mtype_add(struct ip_set *set, void *value, const struct ip_set_ext *ext,
 			forceadd = true;
 	}
 
-	t = ipset_dereference_protected(h->table, set);
 	key = HKEY(value, h->initval, t->htable_bits);
 	n = __ipset_dereference_protected(hbucket(t, key), 1);
 	if (!n) {
@@ -849,6 +925,10 @@ mtype_del(struct ip_set *set, void *value, const struct ip_set_ext *ext,
 	size_t dsize = set->dsize;
 
 	t = ipset_dereference_protected(h->table, set);
+	if (atomic_read(&t->ref) && ext->target)
+		/* Resize is in process and kernel side del, save values */
+		return mtype_resize_defer(h, IPSET_DEL, value, ext, flags);
+
 	key = HKEY(value, h->initval, t->htable_bits);
 	n = __ipset_dereference_protected(hbucket(t, key), 1);
 	if (!n)
@@ -1306,6 +1386,7 @@ IPSET_TOKEN(HTYPE, _create)(struct net *net, struct ip_set *set,
 	h->markmask = markmask;
 #endif
 	get_random_bytes(&h->initval, sizeof(h->initval));
+	INIT_LIST_HEAD(&h->ad);
 
 	t->htable_bits = hbits;
 	RCU_INIT_POINTER(h->table, t);
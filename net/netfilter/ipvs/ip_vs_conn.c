@@ -37,6 +37,7 @@
 #include <linux/seq_file.h>
 #include <linux/jhash.h>
 #include <linux/random.h>
+#include <linux/log2.h>
 
 #include <net/net_namespace.h>
 #include <net/ip_vs.h>
@@ -72,11 +73,15 @@ static atomic_t ip_vs_conn_no_cport_cnt = ATOMIC_INIT(0);
 static unsigned int ip_vs_conn_rnd __read_mostly;
 
 /*
- *  Fine locking granularity for big connection hash table
+ *  Fine locking granularity for big connection hash table: the buckets are
+ *  split in shards of one lock each, CT_LOCKS_PER_CPU per possible CPU and
+ *  at least CT_LOCKARRAY_MIN. Lookups only take the RCU read lock.
  */
-#define CT_LOCKARRAY_BITS  5
-#define CT_LOCKARRAY_SIZE  (1<<CT_LOCKARRAY_BITS)
-#define CT_LOCKARRAY_MASK  (CT_LOCKARRAY_SIZE-1)
+#define CT_LOCKARRAY_MIN	32
+#define CT_LOCKS_PER_CPU	16
+
+/* Connection timers are not rearmed for less than this share of timeout */
+#define IP_VS_CONN_TIMER_SLACK_SHIFT	4
 
 /* We need an addrstrlen that works with or without v6 */
 #ifdef CONFIG_IP_VS_IPV6
@@ -91,17 +96,19 @@ struct ip_vs_aligned_lock
 } __attribute__((__aligned__(SMP_CACHE_BYTES)));
 
 /* lock array for conn table */
-static struct ip_vs_aligned_lock
-__ip_vs_conntbl_lock_array[CT_LOCKARRAY_SIZE] __cacheline_aligned;
+static struct ip_vs_aligned_lock *ip_vs_conntbl_lock_array __read_mostly;
+static unsigned int ip_vs_conntbl_lock_mask __read_mostly;
 
 static inline void ct_write_lock_bh(unsigned int key)
 {
-	spin_lock_bh(&__ip_vs_conntbl_lock_array[key&CT_LOCKARRAY_MASK].l);
+	spin_lock_bh(&ip_vs_conntbl_lock_array[key &
+					       ip_vs_conntbl_lock_mask].l);
 }
 
 static inline void ct_write_unlock_bh(unsigned int key)
 {
-	spin_unlock_bh(&__ip_vs_conntbl_lock_array[key&CT_LOCKARRAY_MASK].l);
+	spin_unlock_bh(&ip_vs_conntbl_lock_array[key &
+						 ip_vs_conntbl_lock_mask].l);
 }
 
 static void ip_vs_conn_expire(struct timer_list *t);
@@ -462,7 +469,19 @@ static void __ip_vs_conn_put_timer(struct ip_vs_conn *cp)
 {
 	unsigned long t = (cp->flags & IP_VS_CONN_F_ONE_PACKET) ?
 		0 : cp->timeout;
-	mod_timer(&cp->timer, jiffies+t);
+	unsigned long expires = jiffies + t;
+	unsigned long slack = min_t(unsigned long, HZ,
+				    t >> IP_VS_CONN_TIMER_SLACK_SHIFT);
+
+	/*
+	 * Every packet of a busy connection pushes the expiry by a few
+	 * jiffies only: leave the timer alone while it is pending and not
+	 * more than the slack early, so that it is not requeued each time.
+	 * A shorter timeout, as on a state change, always rearms it.
+	 */
+	if (!slack || !timer_pending(&cp->timer) ||
+	    !time_in_range(cp->timer.expires, expires - slack, expires))
+		mod_timer(&cp->timer, expires);
 
 	__ip_vs_conn_put(cp);
 }
@@ -1396,12 +1415,25 @@ void __net_exit ip_vs_conn_net_cleanup(struct netns_ipvs *ipvs)
 
 int __init ip_vs_conn_init(void)
 {
+	unsigned int locks;
 	int idx;
 
+	/* The module parameter is not checked by Kconfig */
+	if (ip_vs_conn_tab_bits < 8 || ip_vs_conn_tab_bits > 20) {
+		pr_info("conn_tab_bits %d out of range, using %d\n",
+			ip_vs_conn_tab_bits, CONFIG_IP_VS_TAB_BITS);
+		ip_vs_conn_tab_bits = CONFIG_IP_VS_TAB_BITS;
+	}
+
 	/* Compute size and mask */
 	ip_vs_conn_tab_size = 1 << ip_vs_conn_tab_bits;
 	ip_vs_conn_tab_mask = ip_vs_conn_tab_size - 1;
 
+	locks = roundup_pow_of_two(num_possible_cpus() * CT_LOCKS_PER_CPU);
+	locks = clamp_t(unsigned int, locks, CT_LOCKARRAY_MIN,
+			ip_vs_conn_tab_size);
+	ip_vs_conntbl_lock_mask = locks - 1;
+
 	/*
 	 * Allocate the connection hash table and initialize its list heads
 	 */
@@ -1410,27 +1442,37 @@ int __init ip_vs_conn_init(void)
 	if (!ip_vs_conn_tab)
 		return -ENOMEM;
 
+	ip_vs_conntbl_lock_array = kvmalloc_array(locks,
+					sizeof(*ip_vs_conntbl_lock_array),
+					GFP_KERNEL);
+	if (!ip_vs_conntbl_lock_array) {
+		vfree(ip_vs_conn_tab);
+		return -ENOMEM;
+	}
+
 	/* Allocate ip_vs_conn slab cache */
 	ip_vs_conn_cachep = kmem_cache_create("ip_vs_conn",
 					      sizeof(struct ip_vs_conn), 0,
 					      SLAB_HWCACHE_ALIGN, NULL);
 	if (!ip_vs_conn_cachep) {
+		kvfree(ip_vs_conntbl_lock_array);
 		vfree(ip_vs_conn_tab);
 		return -ENOMEM;
 	}
 
 	pr_info("Connection hash table configured "
-		"(size=%d, memory=%ldKbytes)\n",
+		"(size=%d, memory=%ldKbytes, locks=%u)\n",
 		ip_vs_conn_tab_size,
-		(long)(ip_vs_conn_tab_size*sizeof(struct list_head))/1024);
+		(long)(ip_vs_conn_tab_size*sizeof(struct list_head))/1024,
+		locks);
 	IP_VS_DBG(0, "Each connection entry needs %zd bytes at least\n",
 		  sizeof(struct ip_vs_conn));
 
 	for (idx = 0; idx < ip_vs_conn_tab_size; idx++)
 		INIT_HLIST_HEAD(&ip_vs_conn_tab[idx]);
 
-	for (idx = 0; idx < CT_LOCKARRAY_SIZE; idx++)  {
-		spin_lock_init(&__ip_vs_conntbl_lock_array[idx].l);
+	for (idx = 0; idx < locks; idx++)  {
+		spin_lock_init(&ip_vs_conntbl_lock_array[idx].l);
 	}
 
 	/* calculate the random value for connection hash */
@@ -1445,5 +1487,6 @@ void ip_vs_conn_cleanup(void)
 	rcu_barrier();
 	/* Release the empty cache */
 	kmem_cache_destroy(ip_vs_conn_cachep);
+	kvfree(ip_vs_conntbl_lock_array);
 	vfree(ip_vs_conn_tab);
 }
@@ -1954,7 +1954,7 @@ static int netlink_recvmsg(struct socket *sock, struct msghdr *msg, size_t len,
 	/* Record the max length of recvmsg() calls for future allocations */
 	nlk->max_recvmsg_len = max(nlk->max_recvmsg_len, len);
 	nlk->max_recvmsg_len = min_t(size_t, nlk->max_recvmsg_len,
-				     SKB_WITH_OVERHEAD(32768));
+				     NETLINK_DUMP_MAX_SIZE);
 
 	copied = data_skb->len;
 	if (len < copied) {
@@ -2199,15 +2199,25 @@ static int netlink_dump(struct sock *sk)
 	 * required, but it makes sense to _attempt_ a 16K bytes allocation
 	 * to reduce number of system calls on dump operations, if user
 	 * ever provided a big enough buffer.
+	 *
+	 * Readers offering more than 32K get skbs of up to half their receive
+	 * buffer, vmalloc()ed if high order pages are not at hand, so that
+	 * large tables take fewer recvmsg() calls and dump callbacks.
 	 */
 	cb = &nlk->cb;
 	alloc_min_size = max_t(int, cb->min_dump_alloc, NLMSG_GOODSIZE);
 
 	if (alloc_min_size < nlk->max_recvmsg_len) {
 		alloc_size = nlk->max_recvmsg_len;
+		if (alloc_size > NETLINK_DUMP_HIGH_ORDER_SIZE)
+			alloc_size = max_t(int, NETLINK_DUMP_HIGH_ORDER_SIZE,
+					   min_t(int, alloc_size,
+						 sk->sk_rcvbuf >> 1));
 		skb = alloc_skb(alloc_size,
 				(GFP_KERNEL & ~__GFP_DIRECT_RECLAIM) |
 				__GFP_NOWARN | __GFP_NORETRY);
+		if (!skb && alloc_size > NETLINK_DUMP_HIGH_ORDER_SIZE)
+			skb = netlink_alloc_large_skb(alloc_size, 0);
 	}
 	if (!skb) {
 		alloc_size = alloc_min_size;
@@ -2218,7 +2228,7 @@ static int netlink_dump(struct sock *sk)
 
 	/* Trim skb to allocated size. User is expected to provide buffer as
 	 * large as max(min_dump_alloc, 16KiB (mac_recvmsg_len capped at
-	 * netlink_recvmsg())). dump will pack as many smaller messages as
+	 * netlink_recvmsg()), or larger as described above). dump will pack as many smaller messages as
 	 * could fit within the allocated skb. skb is typically allocated
 	 * with larger space than required (could be as much as near 2x the
 	 * requested size with align to next power of 2 approach). Allowing
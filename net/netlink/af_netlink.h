@@ -16,6 +16,11 @@
 #define NETLINK_F_CAP_ACK		0x20
 #define NETLINK_F_EXT_ACK		0x40
 
+/* Dump skbs up to this size may use high order pages */
+#define NETLINK_DUMP_HIGH_ORDER_SIZE	SKB_WITH_OVERHEAD(32768)
+/* Largest dump skb, for readers with a big enough buffer */
+#define NETLINK_DUMP_MAX_SIZE		SKB_WITH_OVERHEAD(1 << 20)
+
 #define NLGRPSZ(x)	(ALIGN(x, sizeof(unsigned long) * 8) / 8)
 #define NLGRPLONGS(x)	(NLGRPSZ(x)/sizeof(unsigned long))
 
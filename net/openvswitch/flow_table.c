@@ -42,12 +42,14 @@
 #include <linux/icmp.h>
 #include <linux/icmpv6.h>
 #include <linux/rculist.h>
+#include <linux/sort.h>
 #include <net/ip.h>
 #include <net/ipv6.h>
 #include <net/ndisc.h>
 
 #define TBL_MIN_BUCKETS		1024
 #define REHASH_INTERVAL		(10 * 60 * HZ)
+#define MASK_ARRAY_SIZE_MIN	16
 
 static struct kmem_cache *flow_cache;
 struct kmem_cache *flow_stats_cache __read_mostly;
@@ -201,14 +203,131 @@ static struct table_instance *table_instance_alloc(int new_size)
 	return ti;
 }
 
+static struct mask_array *tbl_mask_array_alloc(int size)
+{
+	struct mask_array *new;
+
+	size = max(MASK_ARRAY_SIZE_MIN, size);
+	new = kzalloc(sizeof(struct mask_array) +
+		      sizeof(struct sw_flow_mask *) * size, GFP_KERNEL);
+	if (!new)
+		return NULL;
+
+	new->usage = __alloc_percpu(sizeof(unsigned long) * size,
+				    __alignof__(unsigned long));
+	if (!new->usage) {
+		kfree(new);
+		return NULL;
+	}
+
+	new->max = size;
+	return new;
+}
+
+static void __mask_array_destroy(struct mask_array *ma)
+{
+	free_percpu(ma->usage);
+	kfree(ma);
+}
+
+static void mask_array_rcu_cb(struct rcu_head *rcu)
+{
+	struct mask_array *ma = container_of(rcu, struct mask_array, rcu);
+
+	__mask_array_destroy(ma);
+}
+
+/* Copy the masks of 'old' into a new array of 'size' slots, leaving out
+ * the holes of removed masks.
+ */
+static int tbl_mask_array_realloc(struct flow_table *tbl, int size)
+{
+	struct mask_array *old;
+	struct mask_array *new;
+	int i;
+
+	new = tbl_mask_array_alloc(size);
+	if (!new)
+		return -ENOMEM;
+
+	old = ovsl_dereference(tbl->mask_array);
+	for (i = 0; i < old->count; i++) {
+		struct sw_flow_mask *mask = ovsl_dereference(old->masks[i]);
+
+		if (mask)
+			RCU_INIT_POINTER(new->masks[new->count++], mask);
+	}
+
+	rcu_assign_pointer(tbl->mask_array, new);
+	call_rcu(&old->rcu, mask_array_rcu_cb);
+	return 0;
+}
+
+static int tbl_mask_array_add_mask(struct flow_table *tbl,
+				   struct sw_flow_mask *new)
+{
+	struct mask_array *ma = ovsl_dereference(tbl->mask_array);
+	int err, i, cpu;
+
+	/* Reuse the hole of a removed mask first */
+	for (i = 0; i < ma->count; i++)
+		if (!ovsl_dereference(ma->masks[i]))
+			break;
+
+	if (i == ma->max) {
+		err = tbl_mask_array_realloc(tbl, ma->max * 2);
+		if (err)
+			return err;
+
+		ma = ovsl_dereference(tbl->mask_array);
+		i = ma->count;
+	}
+
+	for_each_possible_cpu(cpu)
+		per_cpu_ptr(ma->usage, cpu)[i] = 0;
+
+	rcu_assign_pointer(ma->masks[i], new);
+	if (i == ma->count)
+		ma->count++;
+	return 0;
+}
+
+static void tbl_mask_array_del_mask(struct flow_table *tbl,
+				    struct sw_flow_mask *mask)
+{
+	struct mask_array *ma = ovsl_dereference(tbl->mask_array);
+	int i;
+
+	for (i = 0; i < ma->count; i++) {
+		if (ovsl_dereference(ma->masks[i]) == mask) {
+			RCU_INIT_POINTER(ma->masks[i], NULL);
+			break;
+		}
+	}
+
+	/* Cache entries for a hole are simply missed in flow_lookup(). */
+	while (ma->count && !ovsl_dereference(ma->masks[ma->count - 1]))
+		ma->count--;
+}
+
 int ovs_flow_tbl_init(struct flow_table *table)
 {
 	struct table_instance *ti, *ufid_ti;
+	struct mask_array *ma;
 
-	ti = table_instance_alloc(TBL_MIN_BUCKETS);
+	table->mask_cache = __alloc_percpu(sizeof(struct mask_cache_entry) *
+					   MC_HASH_ENTRIES,
+					   __alignof__(struct mask_cache_entry));
+	if (!table->mask_cache)
+		return -ENOMEM;
 
+	ma = tbl_mask_array_alloc(MASK_ARRAY_SIZE_MIN);
+	if (!ma)
+		goto free_mask_cache;
+
+	ti = table_instance_alloc(TBL_MIN_BUCKETS);
 	if (!ti)
-		return -ENOMEM;
+		goto free_mask_array;
 
 	ufid_ti = table_instance_alloc(TBL_MIN_BUCKETS);
 	if (!ufid_ti)
@@ -216,6 +335,7 @@ int ovs_flow_tbl_init(struct flow_table *table)
 
 	rcu_assign_pointer(table->ti, ti);
 	rcu_assign_pointer(table->ufid_ti, ufid_ti);
+	rcu_assign_pointer(table->mask_array, ma);
 	INIT_LIST_HEAD(&table->mask_list);
 	table->last_rehash = jiffies;
 	table->count = 0;
@@ -224,6 +344,10 @@ int ovs_flow_tbl_init(struct flow_table *table)
 
 free_ti:
 	__table_instance_destroy(ti);
+free_mask_array:
+	__mask_array_destroy(ma);
+free_mask_cache:
+	free_percpu(table->mask_cache);
 	return -ENOMEM;
 }
 
@@ -280,6 +404,8 @@ void ovs_flow_tbl_destroy(struct flow_table *table)
 	struct table_instance *ti = rcu_dereference_raw(table->ti);
 	struct table_instance *ufid_ti = rcu_dereference_raw(table->ufid_ti);
 
+	free_percpu(table->mask_cache);
+	__mask_array_destroy(rcu_dereference_raw(table->mask_array));
 	table_instance_destroy(ti, ufid_ti, false);
 }
 
@@ -483,30 +609,133 @@ static struct sw_flow *masked_flow_lookup(struct table_instance *ti,
 	return NULL;
 }
 
-struct sw_flow *ovs_flow_tbl_lookup_stats(struct flow_table *tbl,
-				    const struct sw_flow_key *key,
-				    u32 *n_mask_hit)
+/* Flow lookup does a full lookup on the flow table. It starts with the
+ * mask at '*index' and then tries the masks in array order. On a match,
+ * '*index' is set to the slot of the matching mask.
+ */
+static struct sw_flow *flow_lookup(struct flow_table *tbl,
+				   struct table_instance *ti,
+				   struct mask_array *ma,
+				   const struct sw_flow_key *key,
+				   u32 *n_mask_hit,
+				   u32 *index)
 {
-	struct table_instance *ti = rcu_dereference_ovsl(tbl->ti);
+	unsigned long *usage = this_cpu_ptr(ma->usage);
 	struct sw_flow_mask *mask;
 	struct sw_flow *flow;
+	int i;
+
+	if (likely(*index < ma->max)) {
+		mask = rcu_dereference_ovsl(ma->masks[*index]);
+		if (mask) {
+			(*n_mask_hit)++;
+			flow = masked_flow_lookup(ti, key, mask);
+			if (flow) {
+				usage[*index]++;
+				return flow;
+			}
+		}
+	}
+
+	for (i = 0; i < ma->count; i++) {
+		if (i == *index)
+			continue;
+
+		mask = rcu_dereference_ovsl(ma->masks[i]);
+		if (unlikely(!mask))
+			continue;
 
-	*n_mask_hit = 0;
-	list_for_each_entry_rcu(mask, &tbl->mask_list, list) {
 		(*n_mask_hit)++;
 		flow = masked_flow_lookup(ti, key, mask);
-		if (flow)  /* Found */
+		if (flow) { /* Found */
+			*index = i;
+			usage[i]++;
 			return flow;
+		}
 	}
+
 	return NULL;
 }
 
+/*
+ * mask_cache maps the skb hash to the index of the mask which matched the
+ * last packet with that hash, so that most packets only need one flow
+ * table lookup. The hash is split in MC_HASH_SEGS slices, each of them a
+ * candidate slot for the entry; a new entry replaces the candidate with the
+ * lowest hash. Must be called with BH disabled, the cache is per CPU.
+ */
+struct sw_flow *ovs_flow_tbl_lookup_stats(struct flow_table *tbl,
+					  const struct sw_flow_key *key,
+					  u32 skb_hash,
+					  u32 *n_mask_hit,
+					  u32 *n_cache_hit)
+{
+	struct mask_array *ma = rcu_dereference_ovsl(tbl->mask_array);
+	struct table_instance *ti = rcu_dereference_ovsl(tbl->ti);
+	struct mask_cache_entry *entries, *ce;
+	struct sw_flow *flow;
+	u32 hash;
+	int seg;
+
+	*n_mask_hit = 0;
+	*n_cache_hit = 0;
+	if (unlikely(!skb_hash)) {
+		u32 mask_index = 0;
+
+		return flow_lookup(tbl, ti, ma, key, n_mask_hit, &mask_index);
+	}
+
+	ce = NULL;
+	hash = skb_hash;
+	entries = this_cpu_ptr(tbl->mask_cache);
+
+	/* Find the cache entry 'ce' to operate on. */
+	for (seg = 0; seg < MC_HASH_SEGS; seg++) {
+		int index = hash & (MC_HASH_ENTRIES - 1);
+		struct mask_cache_entry *e;
+
+		e = &entries[index];
+		if (e->skb_hash == skb_hash) {
+			u32 mask_index = e->mask_index;
+
+			flow = flow_lookup(tbl, ti, ma, key, n_mask_hit,
+					   &e->mask_index);
+			if (!flow)
+				e->skb_hash = 0;
+			else if (e->mask_index == mask_index)
+				*n_cache_hit = 1;
+			return flow;
+		}
+
+		if (!ce || e->skb_hash < ce->skb_hash)
+			ce = e;  /* A better replacement cache candidate. */
+
+		hash >>= MC_HASH_SHIFT;
+	}
+
+	/* Cache miss, do full lookup. */
+	ce->mask_index = 0;
+	flow = flow_lookup(tbl, ti, ma, key, n_mask_hit, &ce->mask_index);
+	if (flow)
+		ce->skb_hash = skb_hash;
+
+	return flow;
+}
+
 struct sw_flow *ovs_flow_tbl_lookup(struct flow_table *tbl,
 				    const struct sw_flow_key *key)
 {
+	struct mask_array *ma = rcu_dereference_ovsl(tbl->mask_array);
+	struct table_instance *ti = rcu_dereference_ovsl(tbl->ti);
 	u32 __always_unused n_mask_hit;
+	u32 index = 0;
+	struct sw_flow *flow;
 
-	return ovs_flow_tbl_lookup_stats(tbl, key, &n_mask_hit);
+	/* flow_lookup() updates the per-CPU mask usage */
+	local_bh_disable();
+	flow = flow_lookup(tbl, ti, ma, key, &n_mask_hit, &index);
+	local_bh_enable();
+	return flow;
 }
 
 struct sw_flow *ovs_flow_tbl_lookup_exact(struct flow_table *tbl,
@@ -595,6 +824,7 @@ static void flow_mask_remove(struct flow_table *tbl, struct sw_flow_mask *mask)
 		mask->ref_count--;
 
 		if (!mask->ref_count) {
+			tbl_mask_array_del_mask(tbl, mask);
 			list_del_rcu(&mask->list);
 			kfree_rcu(mask, rcu);
 		}
@@ -671,6 +901,12 @@ static int flow_mask_insert(struct flow_table *tbl, struct sw_flow *flow,
 			return -ENOMEM;
 		mask->key = new->key;
 		mask->range = new->range;
+
+		/* Add mask to mask-array. */
+		if (tbl_mask_array_add_mask(tbl, mask)) {
+			kfree(mask);
+			return -ENOMEM;
+		}
 		list_add_rcu(&mask->list, &tbl->mask_list);
 	} else {
 		BUG_ON(!mask->ref_count);
@@ -745,6 +981,101 @@ int ovs_flow_tbl_insert(struct flow_table *table, struct sw_flow *flow,
 
 /* Initializes the flow module.
  * Returns zero if successful or a negative error code. */
+struct mask_count {
+	int index;
+	u64 counter;
+};
+
+static int compare_mask_and_count(const void *a, const void *b)
+{
+	const struct mask_count *mc_a = a;
+	const struct mask_count *mc_b = b;
+
+	/* Most used first */
+	if (mc_a->counter > mc_b->counter)
+		return -1;
+	if (mc_a->counter < mc_b->counter)
+		return 1;
+	return 0;
+}
+
+/**
+ * ovs_flow_masks_rebalance - order the mask array by recent hits
+ * @table: flow table
+ *
+ * Masks are tried in array order on a mask cache miss, so the array is
+ * rebuilt with the masks hit most since the last call first. Removed mask
+ * holes are squeezed out on the way. The array is replaced rather than
+ * sorted in place, as readers walk it under RCU only.
+ *
+ * Must be called with OVS mutex held.
+ */
+void ovs_flow_masks_rebalance(struct flow_table *table)
+{
+	struct mask_array *ma = ovsl_dereference(table->mask_array);
+	struct mask_count *masks_and_count;
+	struct mask_array *new;
+	int masks_entries = 0;
+	bool holes = false;
+	int i, cpu;
+
+	if (ma->count <= 1)
+		return;
+
+	masks_and_count = kmalloc_array(ma->count, sizeof(*masks_and_count),
+					GFP_KERNEL);
+	if (!masks_and_count)
+		return;
+
+	for (i = 0; i < ma->count; i++) {
+		if (!ovsl_dereference(ma->masks[i])) {
+			holes = true;
+			continue;
+		}
+
+		masks_and_count[masks_entries].index = i;
+		masks_and_count[masks_entries].counter = 0;
+		for_each_possible_cpu(cpu) {
+			unsigned long *usage = per_cpu_ptr(ma->usage, cpu);
+
+			masks_and_count[masks_entries].counter += usage[i];
+			usage[i] = 0;
+		}
+		masks_entries++;
+	}
+
+	sort(masks_and_count, masks_entries, sizeof(*masks_and_count),
+	     compare_mask_and_count, NULL);
+
+	if (!holes) {
+		for (i = 0; i < masks_entries; i++)
+			if (masks_and_count[i].index != i)
+				break;
+		if (i == masks_entries)
+			goto free_mask_entries; /* Already in order */
+	}
+
+	new = tbl_mask_array_alloc(ma->max);
+	if (!new)
+		goto free_mask_entries;
+
+	for (i = 0; i < masks_entries; i++) {
+		int index = masks_and_count[i].index;
+
+		RCU_INIT_POINTER(new->masks[new->count++],
+				 ovsl_dereference(ma->masks[index]));
+	}
+
+	/* Cached mask indexes are now stale, but are only used as a first
+	 * guess by flow_lookup(), which falls back to the full array walk.
+	 */
+	rcu_assign_pointer(table->mask_array, new);
+	call_rcu(&ma->rcu, mask_array_rcu_cb);
+
+free_mask_entries:
+	kfree(masks_and_count);
+}
+
 int ovs_flow_init(void)
 {
 	BUILD_BUG_ON(__alignof__(struct sw_flow_key) % __alignof__(long));
@@ -36,6 +36,28 @@
 
 #include "flow.h"
 
+/* Per-CPU cache of the mask which matched the last packets with a given
+ * skb hash, looked up with MC_HASH_SEGS slices of the hash.
+ */
+#define MC_HASH_SHIFT		8
+#define MC_HASH_ENTRIES		(1u << MC_HASH_SHIFT)
+#define MC_HASH_SEGS		((sizeof(u32) * 8) / MC_HASH_SHIFT)
+
+struct mask_cache_entry {
+	u32 skb_hash;
+	u32 mask_index;
+};
+
+/* Masks in lookup order. Deleted masks leave a NULL slot until the array
+ * is rebuilt by ovs_flow_masks_rebalance().
+ */
+struct mask_array {
+	struct rcu_head rcu;
+	int count, max;
+	unsigned long __percpu *usage;	/* hits of each slot, per CPU */
+	struct sw_flow_mask __rcu *masks[];
+};
+
 struct table_instance {
 	struct flex_array *buckets;
 	unsigned int n_buckets;
@@ -48,6 +70,8 @@ struct table_instance {
 struct flow_table {
 	struct table_instance __rcu *ti;
 	struct table_instance __rcu *ufid_ti;
+	struct mask_cache_entry __percpu *mask_cache;
+	struct mask_array __rcu *mask_array;
 	struct list_head mask_list;
 	unsigned long last_rehash;
 	unsigned int count;
@@ -75,7 +99,9 @@ struct sw_flow *ovs_flow_tbl_dump_next(struct table_instance *table,
 				       u32 *bucket, u32 *idx);
 struct sw_flow *ovs_flow_tbl_lookup_stats(struct flow_table *,
 				    const struct sw_flow_key *,
-				    u32 *n_mask_hit);
+				    u32 skb_hash,
+				    u32 *n_mask_hit,
+				    u32 *n_cache_hit);
 struct sw_flow *ovs_flow_tbl_lookup(struct flow_table *,
 				    const struct sw_flow_key *);
 struct sw_flow *ovs_flow_tbl_lookup_exact(struct flow_table *tbl,
@@ -85,6 +111,8 @@ struct sw_flow *ovs_flow_tbl_lookup_ufid(struct flow_table *,
 
 bool ovs_flow_cmp(const struct sw_flow *, const struct sw_flow_match *);
 
+void ovs_flow_masks_rebalance(struct flow_table *table);
+
 void ovs_flow_mask_key(struct sw_flow_key *dst, const struct sw_flow_key *src,
 		       bool full, const struct sw_flow_mask *mask);
 #endif /* flow_table.h */
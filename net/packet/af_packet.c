@@ -71,6 +71,7 @@
 #include <net/protocol.h>
 #include <linux/skbuff.h>
 #include <net/sock.h>
+#include <net/busy_poll.h>
 #include <linux/errno.h>
 #include <linux/timer.h>
 #include <linux/uaccess.h>
@@ -592,12 +593,15 @@ static void init_prb_bdqc(struct packet_sock *po,
 	p1->version = po->tp_version;
 	p1->last_kactive_blk_num = 0;
 	po->stats.stats3.tp_freeze_q_cnt = 0;
-	if (req_u->req3.tp_retire_blk_tov)
+	if (req_u->req3.tp_retire_blk_tov) {
 		p1->retire_blk_tov = req_u->req3.tp_retire_blk_tov;
-	else
+	} else {
 		p1->retire_blk_tov = prb_calc_retire_blk_tmo(po,
 						req_u->req3.tp_block_size);
+		p1->adaptive_tov = 1;
+	}
 	p1->tov_in_jiffies = msecs_to_jiffies(p1->retire_blk_tov);
+	p1->fill_ns_avg = (u64)p1->retire_blk_tov * NSEC_PER_MSEC;
 	p1->blk_sizeof_priv = req_u->req3.tp_sizeof_priv;
 
 	p1->max_frame_len = p1->kblk_size - BLK_PLUS_PRIV(p1->blk_sizeof_priv);
@@ -606,13 +610,48 @@ static void init_prb_bdqc(struct packet_sock *po,
 	prb_open_block(p1, pbd);
 }
 
+/*
+ * The timeout derived from the link speed assumes the link is saturated.
+ * At lower rates, packets wait up to that long in a partially filled
+ * block. Instead, retire a block after twice the average time blocks
+ * took to fill recently, so that a lull in the traffic is noticed
+ * early, bounded by the derived timeout.
+ */
+static unsigned long prb_retire_tmo(struct tpacket_kbdq_core *pkc)
+{
+	if (!pkc->adaptive_tov)
+		return pkc->tov_in_jiffies;
+
+	return clamp_t(unsigned long, nsecs_to_jiffies(2 * pkc->fill_ns_avg),
+		       1, pkc->tov_in_jiffies);
+}
+
+/* Exponential average of the fill time, with a weight of 1/8 */
+static void prb_update_fill_time(struct tpacket_kbdq_core *pkc,
+				 unsigned int stat)
+{
+	u64 fill_ns;
+
+	if (!pkc->adaptive_tov)
+		return;
+
+	/* A block retired by the timer took at least the derived timeout */
+	if (stat & TP_STATUS_BLK_TMO)
+		fill_ns = (u64)pkc->retire_blk_tov * NSEC_PER_MSEC;
+	else
+		fill_ns = ktime_get_ns() - pkc->blk_open_ns;
+
+	pkc->fill_ns_avg = pkc->fill_ns_avg - (pkc->fill_ns_avg >> 3) +
+			   (fill_ns >> 3);
+}
+
 /*  Do NOT update the last_blk_num first.
  *  Assumes sk_buff_head lock is held.
  */
 static void _prb_refresh_rx_retire_blk_timer(struct tpacket_kbdq_core *pkc)
 {
 	mod_timer(&pkc->retire_blk_timer,
-			jiffies + pkc->tov_in_jiffies);
+			jiffies + prb_retire_tmo(pkc));
 	pkc->last_kactive_blk_num = pkc->kactive_blk_num;
 }
 
@@ -790,6 +829,8 @@ static void prb_close_block(struct tpacket_kbdq_core *pkc1,
 
 	smp_wmb();
 
+	prb_update_fill_time(pkc1, stat);
+
 	/* Flush the block */
 	prb_flush_block(pkc1, pbd1, status);
 
@@ -830,6 +871,8 @@ static void prb_open_block(struct tpacket_kbdq_core *pkc1,
 
 	h1->ts_first_pkt.ts_sec = ts.tv_sec;
 	h1->ts_first_pkt.ts_nsec = ts.tv_nsec;
+	if (pkc1->adaptive_tov)
+		pkc1->blk_open_ns = ktime_get_ns();
 
 	pkc1->pkblk_start = (char *)pbd1;
 	pkc1->nxt_offset = pkc1->pkblk_start + BLK_PLUS_PRIV(pkc1->blk_sizeof_priv);
@@ -2114,6 +2157,9 @@ static int packet_rcv(struct sk_buff *skb, struct net_device *dev,
 	/* drop conntrack reference */
 	nf_reset(skb);
 
+	/* Lets SO_BUSY_POLL spin on the NAPI context of the device */
+	sk_mark_napi_id(sk, skb);
+
 	spin_lock(&sk->sk_receive_queue.lock);
 	po->stats.stats1.tp_packets++;
 	sock_skb_set_dropcount(sk, skb);
@@ -2248,6 +2294,7 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,
 			do_vnet = false;
 		}
 	}
+	sk_mark_napi_id(sk, skb);
 	spin_lock(&sk->sk_receive_queue.lock);
 	h.raw = packet_current_rx_frame(po, skb,
 					TP_STATUS_KERNEL, (macoff+snaplen));
@@ -48,6 +48,13 @@ struct tpacket_kbdq_core {
 	unsigned short  version;
 	unsigned long	tov_in_jiffies;
 
+	/* Retire timeout derived from the block fill time, when the
+	 * user did not set one: see prb_retire_tmo().
+	 */
+	unsigned char	adaptive_tov;
+	u64		blk_open_ns;
+	u64		fill_ns_avg;
+
 	/* timer to retire an outstanding block */
 	struct timer_list retire_blk_timer;
 };
@@ -511,6 +511,7 @@ static struct rpc_clnt *rpc_create_xprt(struct rpc_create_args *args,
  */
 struct rpc_clnt *rpc_create(struct rpc_create_args *args)
 {
+	struct rpc_clnt *clnt;
 	struct rpc_xprt *xprt;
 	struct xprt_create xprtargs = {
 		.net = args->net,
@@ -522,6 +523,7 @@ struct rpc_clnt *rpc_create(struct rpc_create_args *args)
 		.bc_xprt = args->bc_xprt,
 	};
 	char servername[48];
+	unsigned int i;
 
 	if (args->bc_xprt) {
 		WARN_ON_ONCE(!(args->protocol & XPRT_TRANSPORT_BC));
@@ -584,7 +586,20 @@ struct rpc_clnt *rpc_create(struct rpc_create_args *args)
 	if (args->flags & RPC_CLNT_CREATE_NONPRIVPORT)
 		xprt->resvport = 0;
 
-	return rpc_create_xprt(args, xprt);
+	clnt = rpc_create_xprt(args, xprt);
+	if (IS_ERR(clnt) || args->nconnect <= 1)
+		return clnt;
+
+	/*
+	 * Extra connections to the same server, which tasks are then spread
+	 * over by the round-robin iterator. The client works with fewer if
+	 * some cannot be set up.
+	 */
+	for (i = 0; i < args->nconnect - 1; i++) {
+		if (rpc_clnt_add_xprt(clnt, &xprtargs, NULL, NULL) < 0)
+			break;
+	}
+	return clnt;
 }
 EXPORT_SYMBOL_GPL(rpc_create);
 
@@ -971,6 +986,7 @@ void rpc_task_release_transport(struct rpc_task *task)
 
 	if (xprt) {
 		task->tk_xprt = NULL;
+		atomic_long_dec(&xprt->queuelen);
 		xprt_put(xprt);
 	}
 }
@@ -995,8 +1011,14 @@ void rpc_task_release_client(struct rpc_task *task)
 static
 void rpc_task_set_transport(struct rpc_task *task, struct rpc_clnt *clnt)
 {
-	if (!task->tk_xprt)
-		task->tk_xprt = xprt_iter_get_next(&clnt->cl_xpi);
+	struct rpc_xprt *xprt;
+
+	if (task->tk_xprt)
+		return;
+	xprt = xprt_iter_get_next(&clnt->cl_xpi);
+	if (xprt)
+		atomic_long_inc(&xprt->queuelen);
+	task->tk_xprt = xprt;
 }
 
 static
@@ -51,8 +51,11 @@ void rpc_xprt_switch_add_xprt(struct rpc_xprt_switch *xps,
 	if (xprt == NULL)
 		return;
 	spin_lock(&xps->xps_lock);
-	if ((xps->xps_net == xprt->xprt_net || xps->xps_net == NULL) &&
-	    !rpc_xprt_switch_has_addr(xps, (struct sockaddr *)&xprt->addr))
+	/*
+	 * Several transports to the same address are allowed, see nconnect
+	 * in rpc_create(). Callers adding trunks check the address first.
+	 */
+	if (xps->xps_net == xprt->xprt_net || xps->xps_net == NULL)
 		xprt_switch_add_xprt_locked(xps, xprt);
 	spin_unlock(&xps->xps_lock);
 }
@@ -314,11 +317,44 @@ struct rpc_xprt *xprt_switch_find_next_entry_roundrobin(struct list_head *head,
 	return xprt_switch_find_first_entry(head);
 }
 
+static
+unsigned long xprt_switch_queuelen(struct rpc_xprt_switch *xps)
+{
+	unsigned long queuelen = 0;
+	struct rpc_xprt *pos;
+
+	list_for_each_entry_rcu(pos, &xps->xps_xprt_list, xprt_switch)
+		queuelen += atomic_long_read(&pos->queuelen);
+	return queuelen;
+}
+
+/*
+ * Round robin over the transports, skipping those which have more tasks
+ * than the average, so that a stalled connection does not get its share
+ * of the new requests.
+ */
 static
 struct rpc_xprt *xprt_iter_next_entry_roundrobin(struct rpc_xprt_iter *xpi)
 {
-	return xprt_iter_next_entry_multiple(xpi,
-			xprt_switch_find_next_entry_roundrobin);
+	struct rpc_xprt_switch *xps = rcu_dereference(xpi->xpi_xpswitch);
+	struct rpc_xprt *xprt;
+	unsigned long queuelen;
+	unsigned int i;
+
+	if (xps == NULL)
+		return NULL;
+	queuelen = xprt_switch_queuelen(xps);
+
+	xprt = NULL;
+	for (i = 0; i < READ_ONCE(xps->xps_nxprts); i++) {
+		xprt = xprt_iter_next_entry_multiple(xpi,
+				xprt_switch_find_next_entry_roundrobin);
+		if (xprt == NULL ||
+		    atomic_long_read(&xprt->queuelen) * xps->xps_nxprts <=
+		    queuelen)
+			break;
+	}
+	return xprt;
 }
 
 static
@@ -43,12 +43,113 @@
 
 #define MAX_IV_SIZE	TLS_CIPHER_AES_GCM_128_IV_SIZE
 
+/* How the records read by tls_sw_recvmsg() were decrypted */
+enum tls_rx_stat {
+	TLS_RX_STAT_ZEROCOPY,
+	TLS_RX_STAT_ZEROCOPY_PARTIAL,
+	TLS_RX_STAT_COPY,
+	TLS_RX_STAT_ASYNC,
+	TLS_RX_STAT_NR,
+};
+
+static const char * const tls_rx_stat_names[TLS_RX_STAT_NR] = {
+	[TLS_RX_STAT_ZEROCOPY]		= "zerocopy",
+	[TLS_RX_STAT_ZEROCOPY_PARTIAL]	= "zerocopy_partial",
+	[TLS_RX_STAT_COPY]		= "copy",
+	[TLS_RX_STAT_ASYNC]		= "async",
+};
+
+static DEFINE_PER_CPU(unsigned long [TLS_RX_STAT_NR], tls_rx_stats);
+
+static inline void tls_rx_stat_inc(enum tls_rx_stat stat)
+{
+	this_cpu_inc(tls_rx_stats[stat]);
+}
+
+static int tls_rx_stats_set(const char *buf, const struct kernel_param *kp)
+{
+	return -EPERM;
+}
+
+static int tls_rx_stats_get(char *buf, const struct kernel_param *kp)
+{
+	int i, cpu, len = 0;
+
+	for (i = 0; i < TLS_RX_STAT_NR; i++) {
+		unsigned long sum = 0;
+
+		for_each_possible_cpu(cpu)
+			sum += per_cpu(tls_rx_stats, cpu)[i];
+		len += sprintf(buf + len, "%s %lu\n",
+			       tls_rx_stat_names[i], sum);
+	}
+	return len;
+}
+
+module_param_call(rx_stats, tls_rx_stats_set, tls_rx_stats_get, NULL, 0444);
+MODULE_PARM_DESC(rx_stats,
+		 "Records decrypted into user buffers, partly so, copied, async");
+
+/*
+ * Records decrypted asynchronously by one tls_sw_recvmsg() call.  Their
+ * skbs are kept on @skbs until all of them are done.
+ */
+struct tls_decrypt_batch {
+	atomic_t pending;
+	int err;
+	struct completion done;
+	struct sk_buff_head skbs;
+};
+
+static void tls_decrypt_batch_init(struct tls_decrypt_batch *batch)
+{
+	/* Biased by one, dropped in tls_decrypt_batch_wait() */
+	atomic_set(&batch->pending, 1);
+	batch->err = 0;
+	init_completion(&batch->done);
+	__skb_queue_head_init(&batch->skbs);
+}
+
+static int tls_decrypt_batch_wait(struct tls_decrypt_batch *batch)
+{
+	if (!atomic_dec_and_test(&batch->pending))
+		wait_for_completion(&batch->done);
+	__skb_queue_purge(&batch->skbs);
+
+	return READ_ONCE(batch->err);
+}
+
+static void tls_decrypt_done(struct crypto_async_request *req, int err)
+{
+	struct aead_request *aead_req = (struct aead_request *)req;
+	struct tls_decrypt_batch *batch = req->data;
+	struct scatterlist *sg;
+
+	/* Moved off the backlog, the real completion follows */
+	if (err == -EINPROGRESS)
+		return;
+
+	if (err)
+		WRITE_ONCE(batch->err, err);
+
+	/* Skip the first S/G entry as it points to AAD */
+	for (sg = sg_next(aead_req->dst); sg; sg = sg_next(sg))
+		put_page(sg_page(sg));
+
+	/* aead_req is the start of the block allocated by decrypt_internal */
+	kfree(aead_req);
+
+	if (atomic_dec_and_test(&batch->pending))
+		complete(&batch->done);
+}
+
 static int tls_do_decryption(struct sock *sk,
 			     struct scatterlist *sgin,
 			     struct scatterlist *sgout,
 			     char *iv_recv,
 			     size_t data_len,
-			     struct aead_request *aead_req)
+			     struct aead_request *aead_req,
+			     struct tls_decrypt_batch *batch)
 {
 	struct tls_context *tls_ctx = tls_get_ctx(sk);
 	struct tls_sw_context_rx *ctx = tls_sw_ctx_rx(tls_ctx);
@@ -59,6 +160,21 @@ static int tls_do_decryption(struct sock *sk,
 	aead_request_set_crypt(aead_req, sgin, sgout,
 			       data_len + tls_ctx->rx.tag_size,
 			       (u8 *)iv_recv);
+
+	if (batch) {
+		aead_request_set_callback(aead_req,
+					  CRYPTO_TFM_REQ_MAY_BACKLOG,
+					  tls_decrypt_done, batch);
+		atomic_inc(&batch->pending);
+		ret = crypto_aead_decrypt(aead_req);
+		if (ret == -EINPROGRESS || ret == -EBUSY)
+			return -EINPROGRESS;
+
+		/* Done synchronously, the callback is not called */
+		atomic_dec(&batch->pending);
+		return ret;
+	}
+
 	aead_request_set_callback(aead_req, CRYPTO_TFM_REQ_MAY_BACKLOG,
 				  crypto_req_done, &ctx->async_wait);
 
@@ -661,12 +777,17 @@ static struct sk_buff *tls_wait_data(struct sock *sk, int flags,
  * out_iov or out_sg must be non-NULL. In case both out_iov and out_sg are
  * NULL, then the decryption happens inside skb buffers itself, i.e.
  * zero-copy gets disabled and 'zc' is updated.
+ *
+ * A zero-copy decryption into out_iov is only submitted when 'batch' is
+ * given, and -EINPROGRESS is returned if it completes asynchronously.  The
+ * caller must then keep the skb until tls_decrypt_batch_wait().
  */
 
 static int decrypt_internal(struct sock *sk, struct sk_buff *skb,
 			    struct iov_iter *out_iov,
 			    struct scatterlist *out_sg,
-			    int *chunk, bool *zc)
+			    int *chunk, bool *zc,
+			    struct tls_decrypt_batch *batch)
 {
 	struct tls_context *tls_ctx = tls_get_ctx(sk);
 	struct tls_sw_context_rx *ctx = tls_sw_ctx_rx(tls_ctx);
@@ -678,12 +799,15 @@ static int decrypt_internal(struct sock *sk, struct sk_buff *skb,
 	struct scatterlist *sgin = NULL;
 	struct scatterlist *sgout = NULL;
 	const int data_len = rxm->full_len - tls_ctx->rx.overhead_size;
+	int out_len = data_len;
 
 	if (*zc && (out_iov || out_sg)) {
-		if (out_iov)
+		if (out_iov) {
+			out_len = min_t(int, data_len, iov_iter_count(out_iov));
 			n_sgout = iov_iter_npages(out_iov, INT_MAX) + 1;
-		else
+		} else {
 			n_sgout = sg_nents(out_sg);
+		}
 	} else {
 		n_sgout = 0;
 		*zc = false;
@@ -693,6 +817,10 @@ static int decrypt_internal(struct sock *sk, struct sk_buff *skb,
 	if (n_sgin < 1)
 		return -EBADMSG;
 
+	/* Room for the part of the record that does not fit in out_iov */
+	if (n_sgout && out_len < data_len)
+		n_sgout += n_sgin;
+
 	/* Increment to accommodate AAD */
 	n_sgin = n_sgin + 1;
 
@@ -750,17 +878,37 @@ static int decrypt_internal(struct sock *sk, struct sk_buff *skb,
 			sg_set_buf(&sgout[0], aad, TLS_AAD_SPACE_SIZE);
 
 			*chunk = 0;
-			err = zerocopy_from_iter(sk, out_iov, data_len, &pages,
+			err = zerocopy_from_iter(sk, out_iov, out_len, &pages,
 						 chunk, &sgout[1],
 						 (n_sgout - 1), false);
 			if (err < 0)
-				goto fallback_to_reg_recv;
+				goto fallback_put_pages;
+
+			/*
+			 * Decrypt the rest of a record larger than out_iov in
+			 * place, it is left in the skb for the next read.
+			 */
+			if (out_len < data_len) {
+				sg_unmark_end(&sgout[pages]);
+				err = skb_to_sgvec(skb, &sgout[pages + 1],
+						   rxm->offset +
+						   tls_ctx->rx.prepend_size +
+						   out_len,
+						   data_len - out_len);
+				if (err < 0) {
+					iov_iter_revert(out_iov, *chunk);
+					goto fallback_put_pages;
+				}
+			}
 		} else if (out_sg) {
 			memcpy(sgout, out_sg, n_sgout * sizeof(*sgout));
 		} else {
 			goto fallback_to_reg_recv;
 		}
 	} else {
+fallback_put_pages:
+		for (; pages > 0; pages--)
+			put_page(sg_page(&sgout[pages]));
 fallback_to_reg_recv:
 		sgout = sgin;
 		pages = 0;
@@ -768,8 +916,15 @@ fallback_to_reg_recv:
 		*zc = false;
 	}
 
+	/* Only records decrypted whole into user pages can complete later */
+	if (!*zc || !out_iov || out_len < data_len)
+		batch = NULL;
+
 	/* Prepare and submit AEAD request */
-	err = tls_do_decryption(sk, sgin, sgout, iv, data_len, aead_req);
+	err = tls_do_decryption(sk, sgin, sgout, iv, data_len, aead_req,
+				batch);
+	if (err == -EINPROGRESS)
+		return err;
 
 	/* Release the pages in case iov was mapped to pages */
 	for (; pages > 0; pages--)
@@ -780,7 +935,8 @@ fallback_to_reg_recv:
 }
 
 static int decrypt_skb_update(struct sock *sk, struct sk_buff *skb,
-			      struct iov_iter *dest, int *chunk, bool *zc)
+			      struct iov_iter *dest, int *chunk, bool *zc,
+			      struct tls_decrypt_batch *batch)
 {
 	struct tls_context *tls_ctx = tls_get_ctx(sk);
 	struct tls_sw_context_rx *ctx = tls_sw_ctx_rx(tls_ctx);
@@ -793,8 +949,8 @@ static int decrypt_skb_update(struct sock *sk, struct sk_buff *skb,
 		return err;
 #endif
 	if (!ctx->decrypted) {
-		err = decrypt_internal(sk, skb, dest, NULL, chunk, zc);
-		if (err < 0)
+		err = decrypt_internal(sk, skb, dest, NULL, chunk, zc, batch);
+		if (err < 0 && err != -EINPROGRESS)
 			return err;
 	} else {
 		*zc = false;
@@ -815,7 +971,7 @@ int decrypt_skb(struct sock *sk, struct sk_buff *skb,
 	bool zc = true;
 	int chunk;
 
-	return decrypt_internal(sk, skb, NULL, sgout, &chunk, &zc);
+	return decrypt_internal(sk, skb, NULL, sgout, &chunk, &zc, NULL);
 }
 
 static bool tls_sw_advance_skb(struct sock *sk, struct sk_buff *skb,
@@ -849,6 +1005,7 @@ int tls_sw_recvmsg(struct sock *sk,
 {
 	struct tls_context *tls_ctx = tls_get_ctx(sk);
 	struct tls_sw_context_rx *ctx = tls_sw_ctx_rx(tls_ctx);
+	struct tls_decrypt_batch batch;
 	unsigned char control;
 	struct strp_msg *rxm;
 	struct sk_buff *skb;
@@ -865,6 +1022,7 @@ int tls_sw_recvmsg(struct sock *sk,
 
 	lock_sock(sk);
 
+	tls_decrypt_batch_init(&batch);
 	target = sock_rcvlowat(sk, flags & MSG_WAITALL, len);
 	timeo = sock_rcvtimeo(sk, flags & MSG_DONTWAIT);
 	do {
@@ -896,17 +1054,29 @@ int tls_sw_recvmsg(struct sock *sk,
 		if (!ctx->decrypted) {
 			int to_copy = rxm->full_len - tls_ctx->rx.overhead_size;
 
-			if (!is_kvec && to_copy <= len &&
-			    likely(!(flags & MSG_PEEK)))
+			/* decrypt_internal() splits records larger than len */
+			if (!is_kvec && likely(!(flags & MSG_PEEK)))
 				zc = true;
 
 			err = decrypt_skb_update(sk, skb, &msg->msg_iter,
-						 &chunk, &zc);
-			if (err < 0) {
+						 &chunk, &zc, &batch);
+			if (err == -EINPROGRESS) {
+				/* Go on with the next record meanwhile */
+				__skb_queue_tail(&batch.skbs, skb_get(skb));
+				tls_rx_stat_inc(TLS_RX_STAT_ASYNC);
+				err = 0;
+			} else if (err < 0) {
 				tls_err_abort(sk, EBADMSG);
 				goto recv_end;
 			}
 			ctx->decrypted = true;
+
+			if (!zc)
+				tls_rx_stat_inc(TLS_RX_STAT_COPY);
+			else if (chunk < to_copy)
+				tls_rx_stat_inc(TLS_RX_STAT_ZEROCOPY_PARTIAL);
+			else
+				tls_rx_stat_inc(TLS_RX_STAT_ZEROCOPY);
 		}
 
 		if (!zc) {
@@ -946,6 +1116,12 @@ int tls_sw_recvmsg(struct sock *sk,
 	} while (len);
 
 recv_end:
+	/* Wait for the records still being decrypted into msg */
+	if (tls_decrypt_batch_wait(&batch)) {
+		tls_err_abort(sk, EBADMSG);
+		copied = 0;
+		err = -EBADMSG;
+	}
 	release_sock(sk);
 	return copied ? : err;
 }
@@ -980,7 +1156,7 @@ ssize_t tls_sw_splice_read(struct socket *sock,  loff_t *ppos,
 	}
 
 	if (!ctx->decrypted) {
-		err = decrypt_skb_update(sk, skb, NULL, &chunk, &zc);
+		err = decrypt_skb_update(sk, skb, NULL, &chunk, &zc, NULL);
 
 		if (err < 0) {
 			tls_err_abort(sk, EBADMSG);
@@ -491,6 +491,7 @@ static void unix_sock_destructor(struct sock *sk)
 	struct unix_sock *u = unix_sk(sk);
 
 	skb_queue_purge(&sk->sk_receive_queue);
+	skb_queue_purge(&sk->sk_error_queue);
 
 	WARN_ON(refcount_read(&sk->sk_wmem_alloc));
 	WARN_ON(!sk_unhashed(sk));
@@ -1824,6 +1825,36 @@ out:
  */
 #define UNIX_SKB_FRAGS_SZ (PAGE_SIZE << get_order(32768))
 
+/*
+ * Attach up to @size bytes of @msg to @skb by pinning the user pages instead
+ * of copying them, at most MAX_SKB_FRAGS pages. The receiver then copies the
+ * data once, straight from the sender's pages, and the sender is told when
+ * they are released through its error queue. Returns the number of bytes
+ * attached.
+ */
+static int unix_stream_zerocopy_from_iter(struct sk_buff *skb,
+					  struct msghdr *msg, int size,
+					  struct ubuf_info *uarg)
+{
+	struct iov_iter orig_iter = msg->msg_iter;
+	size_t left = iov_iter_count(&msg->msg_iter) - size;
+	int err;
+
+	iov_iter_truncate(&msg->msg_iter, size);
+	err = zerocopy_sg_from_iter(skb, &msg->msg_iter);
+	iov_iter_reexpand(&msg->msg_iter,
+			  iov_iter_count(&msg->msg_iter) + left);
+
+	/* Out of frags is fine, the rest goes in the next skb */
+	if (err && (err != -EMSGSIZE || !skb->len)) {
+		msg->msg_iter = orig_iter;
+		return err;
+	}
+
+	skb_zcopy_set(skb, uarg);
+	return skb->len;
+}
+
 static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 			       size_t len)
 {
@@ -1834,6 +1865,7 @@ static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 	int sent = 0;
 	struct scm_cookie scm;
 	bool fds_sent = false;
+	struct ubuf_info *uarg = NULL;
 	int data_len;
 
 	wait_for_unix_gc();
@@ -1858,12 +1890,46 @@ static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 	if (sk->sk_shutdown & SEND_SHUTDOWN)
 		goto pipe_err;
 
+	/* As for TCP, MSG_ZEROCOPY is ignored unless SO_ZEROCOPY is set */
+	if ((msg->msg_flags & MSG_ZEROCOPY) && len &&
+	    sock_flag(sk, SOCK_ZEROCOPY)) {
+		uarg = sock_zerocopy_alloc(sk, len);
+		if (!uarg) {
+			err = -ENOBUFS;
+			goto out_err;
+		}
+	}
+
 	while (sent < len) {
 		size = len - sent;
 
 		/* Keep two messages in the pipe so it schedules better */
 		size = min_t(int, size, (sk->sk_sndbuf >> 1) - 64);
 
+		if (uarg) {
+			skb = sock_alloc_send_pskb(sk, 0, 0,
+						   msg->msg_flags & MSG_DONTWAIT,
+						   &err, 0);
+			if (!skb)
+				goto out_err;
+
+			err = unix_scm_to_skb(&scm, skb, !fds_sent);
+			if (err < 0) {
+				kfree_skb(skb);
+				goto out_err;
+			}
+			fds_sent = true;
+
+			err = unix_stream_zerocopy_from_iter(skb, msg, size,
+							     uarg);
+			if (err < 0) {
+				kfree_skb(skb);
+				goto out_err;
+			}
+			size = err;
+			goto queue;
+		}
+
 		/* allow fallback to order-0 allocations */
 		size = min_t(int, size, SKB_MAX_HEAD(0) + UNIX_SKB_FRAGS_SZ);
 
@@ -1894,6 +1960,7 @@ static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 			goto out_err;
 		}
 
+queue:
 		unix_state_lock(other);
 
 		if (sock_flag(other, SOCK_DEAD) ||
@@ -1907,6 +1974,7 @@ static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 		sent += size;
 	}
 
+	sock_zerocopy_put(uarg);
 	scm_destroy(&scm);
 
 	return sent;
@@ -1919,6 +1987,10 @@ pipe_err:
 		send_sig(SIGPIPE, current, 0);
 	err = -EPIPE;
 out_err:
+	if (sent)
+		sock_zerocopy_put(uarg);
+	else
+		sock_zerocopy_put_abort(uarg);
 	scm_destroy(&scm);
 	return sent ? : err;
 }
@@ -2460,6 +2532,11 @@ static int unix_stream_recvmsg(struct socket *sock, struct msghdr *msg,
 		.flags = flags
 	};
 
+	/* MSG_ZEROCOPY completions of unix_stream_sendmsg() */
+	if (unlikely(flags & MSG_ERRQUEUE))
+		return sock_recv_errqueue(sock->sk, msg, size, SOL_SOCKET,
+					  SO_ZEROCOPY);
+
 	return unix_stream_read_generic(&state, true);
 }
 
@@ -2467,6 +2544,13 @@ static int unix_stream_splice_actor(struct sk_buff *skb,
 				    int skip, int chunk,
 				    struct unix_stream_read_state *state)
 {
+	/*
+	 * The pipe keeps references to the pages after the skb is freed, when
+	 * a zerocopy sender is told it may reuse them: give the pipe copies.
+	 */
+	if (skb_orphan_frags_rx(skb, GFP_KERNEL))
+		return -ENOMEM;
+
 	return skb_splice_bits(skb, state->socket->sk,
 			       UNIXCB(skb).consumed + skip,
 			       state->pipe, chunk, state->splice_flags);
@@ -2644,7 +2728,7 @@ static __poll_t unix_poll(struct file *file, struct socket *sock, poll_table *wa
 	mask = 0;
 
 	/* exceptional events? */
-	if (sk->sk_err)
+	if (sk->sk_err || !skb_queue_empty(&sk->sk_error_queue))
 		mask |= EPOLLERR;
 	if (sk->sk_shutdown == SHUTDOWN_MASK)
 		mask |= EPOLLHUP;
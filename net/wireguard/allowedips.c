@@ -6,18 +6,25 @@
 #include "allowedips.h"
 #include "peer.h"
 
+#include <linux/prefetch.h>
+
+/* Everything a lookup touches comes before the rcu head, and nodes are cache
+ * line aligned, so each step down the trie costs a single cache line.
+ */
 struct allowedips_node {
 	struct wg_peer __rcu *peer;
-	struct rcu_head rcu;
 	struct allowedips_node __rcu *bit[2];
+	u8 cidr, bit_at_a, bit_at_b;
 	/* While it may seem scandalous that we waste space for v4,
 	 * we're alloc'ing to the nearest power of 2 anyway, so this
 	 * doesn't actually make a difference.
 	 */
 	u8 bits[16] __aligned(__alignof(u64));
-	u8 cidr, bit_at_a, bit_at_b;
+	struct rcu_head rcu;
 };
 
+static struct kmem_cache *node_cache;
+
 static __always_inline void swap_endian(u8 *dst, const u8 *src, u8 bits)
 {
 	if (bits == 32) {
@@ -44,7 +51,8 @@ static void copy_and_assign_cidr(struct allowedips_node *node, const u8 *src,
 
 static void node_free_rcu(struct rcu_head *rcu)
 {
-	kfree(container_of(rcu, struct allowedips_node, rcu));
+	kmem_cache_free(node_cache, container_of(rcu, struct allowedips_node,
+						 rcu));
 }
 
 static void push_rcu(struct allowedips_node **stack,
@@ -65,7 +73,7 @@ static void root_free_rcu(struct rcu_head *rcu)
 	while (len > 0 && (node = stack[--len])) {
 		push_rcu(stack, node->bit[0], &len);
 		push_rcu(stack, node->bit[1], &len);
-		kfree(node);
+		kmem_cache_free(node_cache, node);
 	}
 }
 
@@ -193,14 +201,20 @@ static __always_inline bool prefix_matches(const struct allowedips_node *node,
 static __always_inline struct allowedips_node *
 find_node(struct allowedips_node *trie, u8 bits, const u8 *key)
 {
-	struct allowedips_node *node = trie, *found = NULL;
-
-	while (node && prefix_matches(node, key, bits)) {
+	struct allowedips_node *node = trie, *found = NULL, *next;
+
+	while (node) {
+		next = NULL;
+		if (node->cidr < bits) {
+			next = rcu_dereference_bh(CHOOSE_NODE(node, key));
+			/* Overlap the child's cache miss with the checks */
+			prefetch(next);
+		}
+		if (!prefix_matches(node, key, bits))
+			break;
 		if (rcu_access_pointer(node->peer))
 			found = node;
-		if (node->cidr == bits)
-			break;
-		node = rcu_dereference_bh(CHOOSE_NODE(node, key));
+		node = next;
 	}
 	return found;
 }
@@ -259,7 +273,7 @@ static int add(struct allowedips_node __rcu **trie, u8 bits, const u8 *key,
 		return -EINVAL;
 
 	if (!rcu_access_pointer(*trie)) {
-		node = kzalloc(sizeof(*node), GFP_KERNEL);
+		node = kmem_cache_zalloc(node_cache, GFP_KERNEL);
 		if (unlikely(!node))
 			return -ENOMEM;
 		RCU_INIT_POINTER(node->peer, peer);
@@ -272,7 +286,7 @@ static int add(struct allowedips_node __rcu **trie, u8 bits, const u8 *key,
 		return 0;
 	}
 
-	newnode = kzalloc(sizeof(*newnode), GFP_KERNEL);
+	newnode = kmem_cache_zalloc(node_cache, GFP_KERNEL);
 	if (unlikely(!newnode))
 		return -ENOMEM;
 	RCU_INIT_POINTER(newnode->peer, peer);
@@ -299,9 +313,9 @@ static int add(struct allowedips_node __rcu **trie, u8 bits, const u8 *key,
 			rcu_assign_pointer(CHOOSE_NODE(parent, newnode->bits),
 					   newnode);
 	} else {
-		node = kzalloc(sizeof(*node), GFP_KERNEL);
+		node = kmem_cache_zalloc(node_cache, GFP_KERNEL);
 		if (unlikely(!node)) {
-			kfree(newnode);
+			kmem_cache_free(node_cache, newnode);
 			return -ENOMEM;
 		}
 		copy_and_assign_cidr(node, newnode->bits, cidr, bits);
@@ -414,4 +428,19 @@ struct wg_peer *wg_allowedips_lookup_src(struct allowedips *table,
 	return NULL;
 }
 
+int __init wg_allowedips_slab_init(void)
+{
+	node_cache = kmem_cache_create("wg_allowedips_node",
+				       sizeof(struct allowedips_node),
+				       0, SLAB_HWCACHE_ALIGN, NULL);
+	return node_cache ? 0 : -ENOMEM;
+}
+
+void wg_allowedips_slab_uninit(void)
+{
+	/* Nodes may still be waiting for their grace period */
+	rcu_barrier_bh();
+	kmem_cache_destroy(node_cache);
+}
+
 #include "selftest/allowedips.c"
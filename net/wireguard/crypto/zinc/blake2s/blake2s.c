@@ -112,6 +112,8 @@ EXPORT_SYMBOL(blake2s_init_key);
 
 #if defined(CONFIG_ZINC_ARCH_X86_64)
 #include "blake2s-x86_64-glue.c"
+#elif defined(CONFIG_ZINC_ARCH_ARM64)
+#include "blake2s-arm64-glue.c"
 #else
 static bool *const blake2s_nobs[] __initconst = { };
 static void __init blake2s_fpu_init(void)
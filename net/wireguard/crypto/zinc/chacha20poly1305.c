@@ -16,10 +16,53 @@
 #include <linux/kernel.h>
 #include <linux/module.h>
 #include <linux/init.h>
+#include <linux/timex.h>
 #include <crypto/scatterwalk.h> // For blkcipher_walk.
 
 static const u8 pad0[16] = { 0 };
 
+/*
+ * Encryption and authentication are stitched together a few ChaCha20
+ * blocks at a time, so that Poly1305 consumes the ciphertext while it is
+ * still hot in the L1 cache of small cores rather than in a second pass
+ * over the whole packet. This is a multiple of the block size.
+ */
+enum { CHACHA20POLY1305_STITCH_LEN = 8 * CHACHA20_BLOCK_SIZE };
+
+static inline void
+chacha20poly1305_stitch_encrypt(struct chacha20_ctx *chacha20_state,
+				struct poly1305_ctx *poly1305_state, u8 *dst,
+				const u8 *src, size_t len,
+				simd_context_t *simd_context)
+{
+	while (len) {
+		size_t l = min_t(size_t, len, CHACHA20POLY1305_STITCH_LEN);
+
+		chacha20(chacha20_state, dst, src, l, simd_context);
+		poly1305_update(poly1305_state, dst, l, simd_context);
+		dst += l;
+		src += l;
+		len -= l;
+	}
+}
+
+static inline void
+chacha20poly1305_stitch_decrypt(struct chacha20_ctx *chacha20_state,
+				struct poly1305_ctx *poly1305_state, u8 *dst,
+				const u8 *src, size_t len,
+				simd_context_t *simd_context)
+{
+	while (len) {
+		size_t l = min_t(size_t, len, CHACHA20POLY1305_STITCH_LEN);
+
+		poly1305_update(poly1305_state, src, l, simd_context);
+		chacha20(chacha20_state, dst, src, l, simd_context);
+		dst += l;
+		src += l;
+		len -= l;
+	}
+}
+
 static struct crypto_alg chacha20_alg = {
 	.cra_blocksize = 1,
 	.cra_alignmask = sizeof(u32) - 1
@@ -55,9 +98,9 @@ __chacha20poly1305_encrypt(u8 *dst, const u8 *src, const size_t src_len,
 	poly1305_update(&poly1305_state, pad0, (0x10 - ad_len) & 0xf,
 			simd_context);
 
-	chacha20(&chacha20_state, dst, src, src_len, simd_context);
+	chacha20poly1305_stitch_encrypt(&chacha20_state, &poly1305_state, dst,
+					src, src_len, simd_context);
 
-	poly1305_update(&poly1305_state, dst, src_len, simd_context);
 	poly1305_update(&poly1305_state, pad0, (0x10 - src_len) & 0xf,
 			simd_context);
 
@@ -120,10 +163,10 @@ bool chacha20poly1305_encrypt_sg(struct scatterlist *dst,
 			size_t chunk_len =
 				rounddown(walk.nbytes, CHACHA20_BLOCK_SIZE);
 
-			chacha20(&chacha20_state, walk.dst.virt.addr,
-				 walk.src.virt.addr, chunk_len, simd_context);
-			poly1305_update(&poly1305_state, walk.dst.virt.addr,
-					chunk_len, simd_context);
+			chacha20poly1305_stitch_encrypt(&chacha20_state,
+					&poly1305_state, walk.dst.virt.addr,
+					walk.src.virt.addr, chunk_len,
+					simd_context);
 			simd_relax(simd_context);
 			ret = blkcipher_walk_done(&chacha20_desc, &walk,
 					walk.nbytes % CHACHA20_BLOCK_SIZE);
@@ -263,10 +306,10 @@ bool chacha20poly1305_decrypt_sg(struct scatterlist *dst,
 			size_t chunk_len =
 				rounddown(walk.nbytes, CHACHA20_BLOCK_SIZE);
 
-			poly1305_update(&poly1305_state, walk.src.virt.addr,
-					chunk_len, simd_context);
-			chacha20(&chacha20_state, walk.dst.virt.addr,
-				 walk.src.virt.addr, chunk_len, simd_context);
+			chacha20poly1305_stitch_decrypt(&chacha20_state,
+					&poly1305_state, walk.dst.virt.addr,
+					walk.src.virt.addr, chunk_len,
+					simd_context);
 			simd_relax(simd_context);
 			ret = blkcipher_walk_done(&chacha20_desc, &walk,
 					walk.nbytes % CHACHA20_BLOCK_SIZE);
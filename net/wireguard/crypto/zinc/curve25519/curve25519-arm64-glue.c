@@ -0,0 +1,261 @@
+// SPDX-License-Identifier: GPL-2.0 OR MIT
+/*
+ * Copyright (C) 2015-2018 Jason A. Donenfeld <Jason@zx2c4.com>. All Rights Reserved.
+ *
+ * Montgomery ladder over radix 2^64 field elements, with the multiplications
+ * and squarings done by curve25519-arm64.S. Compared to the radix 2^51 code
+ * of curve25519-hacl64.c, this needs 16 instead of 25 mul/umulh pairs per
+ * multiplication and no carry propagation between the limbs.
+ */
+
+#include <asm/unaligned.h>
+
+asmlinkage void curve25519_fe_mul_arm64(u64 out[4], const u64 a[4],
+					const u64 b[4]);
+asmlinkage void curve25519_fe_sqr_arm64(u64 out[4], const u64 a[4],
+					size_t n);
+
+static bool curve25519_use_arm64 __ro_after_init;
+static bool *const curve25519_nobs[] __initconst = { &curve25519_use_arm64 };
+static void __init curve25519_fpu_init(void)
+{
+	curve25519_use_arm64 = true;
+}
+
+typedef u64 fe64[4];
+
+static __always_inline void fe64_add(fe64 out, const fe64 a, const fe64 b)
+{
+	__uint128_t c = 0;
+	u64 t[4];
+	int i;
+
+	for (i = 0; i < 4; ++i) {
+		c += (__uint128_t)a[i] + b[i];
+		t[i] = c;
+		c >>= 64;
+	}
+	/* 2^256 = 38 (mod p), and a second carry leaves t[0] tiny */
+	c *= 38;
+	for (i = 0; i < 4; ++i) {
+		c += t[i];
+		t[i] = c;
+		c >>= 64;
+	}
+	out[0] = t[0] + 38 * (u64)c;
+	out[1] = t[1];
+	out[2] = t[2];
+	out[3] = t[3];
+}
+
+static __always_inline void fe64_sub(fe64 out, const fe64 a, const fe64 b)
+{
+	u64 borrow = 0;
+	u64 t[4];
+	int i;
+
+	for (i = 0; i < 4; ++i) {
+		__uint128_t d = (__uint128_t)a[i] - b[i] - borrow;
+
+		t[i] = d;
+		borrow = (d >> 64) & 1;
+	}
+	/* Wrapped around 2^256, take 38 off, once more if that wraps too */
+	borrow *= 38;
+	for (i = 0; i < 4; ++i) {
+		__uint128_t d = (__uint128_t)t[i] - borrow;
+
+		t[i] = d;
+		borrow = (d >> 64) & 1;
+	}
+	out[0] = t[0] - 38 * borrow;
+	out[1] = t[1];
+	out[2] = t[2];
+	out[3] = t[3];
+}
+
+/* out = a * 121665, the (A - 2) / 4 constant of the ladder */
+static __always_inline void fe64_mul_a24(fe64 out, const fe64 a)
+{
+	__uint128_t c = 0;
+	u64 t[4];
+	int i;
+
+	for (i = 0; i < 4; ++i) {
+		c += (__uint128_t)a[i] * 121665;
+		t[i] = c;
+		c >>= 64;
+	}
+	c *= 38;
+	for (i = 0; i < 4; ++i) {
+		c += t[i];
+		t[i] = c;
+		c >>= 64;
+	}
+	out[0] = t[0] + 38 * (u64)c;
+	out[1] = t[1];
+	out[2] = t[2];
+	out[3] = t[3];
+}
+
+static __always_inline void fe64_cswap(fe64 a, fe64 b, u64 swap)
+{
+	const u64 mask = 0 - swap;
+	int i;
+
+	for (i = 0; i < 4; ++i) {
+		const u64 x = (a[i] ^ b[i]) & mask;
+
+		a[i] ^= x;
+		b[i] ^= x;
+	}
+}
+
+/* out = z^(p - 2), with the usual 254 squarings and 11 multiplications */
+static void fe64_invert(fe64 out, const fe64 z)
+{
+	fe64 z2, z9, z11, z2_5_0, z2_10_0, z2_20_0, z2_50_0, z2_100_0, t;
+
+	curve25519_fe_sqr_arm64(z2, z, 1);
+	curve25519_fe_sqr_arm64(t, z2, 2);
+	curve25519_fe_mul_arm64(z9, t, z);
+	curve25519_fe_mul_arm64(z11, z9, z2);
+	curve25519_fe_sqr_arm64(t, z11, 1);
+	curve25519_fe_mul_arm64(z2_5_0, t, z9);
+	curve25519_fe_sqr_arm64(t, z2_5_0, 5);
+	curve25519_fe_mul_arm64(z2_10_0, t, z2_5_0);
+	curve25519_fe_sqr_arm64(t, z2_10_0, 10);
+	curve25519_fe_mul_arm64(z2_20_0, t, z2_10_0);
+	curve25519_fe_sqr_arm64(t, z2_20_0, 20);
+	curve25519_fe_mul_arm64(t, t, z2_20_0);
+	curve25519_fe_sqr_arm64(t, t, 10);
+	curve25519_fe_mul_arm64(z2_50_0, t, z2_10_0);
+	curve25519_fe_sqr_arm64(t, z2_50_0, 50);
+	curve25519_fe_mul_arm64(z2_100_0, t, z2_50_0);
+	curve25519_fe_sqr_arm64(t, z2_100_0, 100);
+	curve25519_fe_mul_arm64(t, t, z2_100_0);
+	curve25519_fe_sqr_arm64(t, t, 50);
+	curve25519_fe_mul_arm64(t, t, z2_50_0);
+	curve25519_fe_sqr_arm64(t, t, 5);
+	curve25519_fe_mul_arm64(out, t, z11);
+
+	memzero_explicit(z2, sizeof(z2));
+	memzero_explicit(z9, sizeof(z9));
+	memzero_explicit(z11, sizeof(z11));
+	memzero_explicit(z2_5_0, sizeof(z2_5_0));
+	memzero_explicit(z2_10_0, sizeof(z2_10_0));
+	memzero_explicit(z2_20_0, sizeof(z2_20_0));
+	memzero_explicit(z2_50_0, sizeof(z2_50_0));
+	memzero_explicit(z2_100_0, sizeof(z2_100_0));
+	memzero_explicit(t, sizeof(t));
+}
+
+/* Fully reduces a < 2^256 modulo p and stores it little endian */
+static void fe64_tobytes(u8 out[CURVE25519_KEY_SIZE], const fe64 a)
+{
+	u64 t[4], u[4], mask;
+	__uint128_t c;
+	int i;
+
+	/* Fold bit 255, leaving t < 2^255 + 19 */
+	c = (a[3] >> 63) * 19;
+	for (i = 0; i < 4; ++i) {
+		c += i == 3 ? a[3] & ~(1ULL << 63) : a[i];
+		t[i] = c;
+		c >>= 64;
+	}
+	/* t >= p exactly when t + 19 reaches bit 255 */
+	c = 19;
+	for (i = 0; i < 4; ++i) {
+		c += t[i];
+		u[i] = c;
+		c >>= 64;
+	}
+	mask = 0 - (u[3] >> 63);
+	u[3] &= ~(1ULL << 63);
+	for (i = 0; i < 4; ++i)
+		put_unaligned_le64((u[i] & mask) | (t[i] & ~mask), out + 8 * i);
+
+	memzero_explicit(t, sizeof(t));
+	memzero_explicit(u, sizeof(u));
+}
+
+static void curve25519_arm64(u8 mypublic[CURVE25519_KEY_SIZE],
+			     const u8 secret[CURVE25519_KEY_SIZE],
+			     const u8 basepoint[CURVE25519_KEY_SIZE])
+{
+	struct {
+		fe64 x1, x2, z2, x3, z3, a, b, c, d, aa, bb, e;
+		u8 scalar[CURVE25519_KEY_SIZE];
+	} m;
+	u64 swap = 0;
+	int i, pos;
+
+	memcpy(m.scalar, secret, sizeof(m.scalar));
+	m.scalar[0] &= 248;
+	m.scalar[31] &= 127;
+	m.scalar[31] |= 64;
+
+	for (i = 0; i < 4; ++i)
+		m.x1[i] = get_unaligned_le64(basepoint + 8 * i);
+	m.x1[3] &= ~(1ULL << 63);
+
+	memset(m.x2, 0, sizeof(m.x2));
+	m.x2[0] = 1;
+	memset(m.z2, 0, sizeof(m.z2));
+	memcpy(m.x3, m.x1, sizeof(m.x3));
+	memcpy(m.z3, m.x2, sizeof(m.z3));
+
+	for (pos = 254; pos >= 0; --pos) {
+		const u64 bit = (m.scalar[pos >> 3] >> (pos & 7)) & 1;
+
+		swap ^= bit;
+		fe64_cswap(m.x2, m.x3, swap);
+		fe64_cswap(m.z2, m.z3, swap);
+		swap = bit;
+
+		fe64_add(m.a, m.x2, m.z2);
+		fe64_sub(m.b, m.x2, m.z2);
+		fe64_add(m.c, m.x3, m.z3);
+		fe64_sub(m.d, m.x3, m.z3);
+		curve25519_fe_sqr_arm64(m.aa, m.a, 1);
+		curve25519_fe_sqr_arm64(m.bb, m.b, 1);
+		fe64_sub(m.e, m.aa, m.bb);
+		/* da = d * a, cb = c * b */
+		curve25519_fe_mul_arm64(m.d, m.d, m.a);
+		curve25519_fe_mul_arm64(m.c, m.c, m.b);
+		fe64_add(m.x3, m.d, m.c);
+		curve25519_fe_sqr_arm64(m.x3, m.x3, 1);
+		fe64_sub(m.z3, m.d, m.c);
+		curve25519_fe_sqr_arm64(m.z3, m.z3, 1);
+		curve25519_fe_mul_arm64(m.z3, m.z3, m.x1);
+		curve25519_fe_mul_arm64(m.x2, m.aa, m.bb);
+		fe64_mul_a24(m.a, m.e);
+		fe64_add(m.a, m.a, m.aa);
+		curve25519_fe_mul_arm64(m.z2, m.e, m.a);
+	}
+	fe64_cswap(m.x2, m.x3, swap);
+	fe64_cswap(m.z2, m.z3, swap);
+
+	fe64_invert(m.z2, m.z2);
+	curve25519_fe_mul_arm64(m.x2, m.x2, m.z2);
+	fe64_tobytes(mypublic, m.x2);
+
+	memzero_explicit(&m, sizeof(m));
+}
+
+static inline bool curve25519_arch(u8 mypublic[CURVE25519_KEY_SIZE],
+				   const u8 secret[CURVE25519_KEY_SIZE],
+				   const u8 basepoint[CURVE25519_KEY_SIZE])
+{
+	if (!curve25519_use_arm64)
+		return false;
+	curve25519_arm64(mypublic, secret, basepoint);
+	return true;
+}
+
+static inline bool curve25519_base_arch(u8 pub[CURVE25519_KEY_SIZE],
+					const u8 secret[CURVE25519_KEY_SIZE])
+{
+	return false;
+}
@@ -24,6 +24,8 @@
 #include "curve25519-x86_64-glue.c"
 #elif defined(CONFIG_ZINC_ARCH_ARM)
 #include "curve25519-arm-glue.c"
+#elif defined(CONFIG_ZINC_ARCH_ARM64)
+#include "curve25519-arm64-glue.c"
 #else
 static bool *const curve25519_nobs[] __initconst = { };
 static void __init curve25519_fpu_init(void)
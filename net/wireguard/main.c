@@ -27,10 +27,15 @@ static int __init mod_init(void)
 	    (ret = curve25519_mod_init()))
 		return ret;
 
+	ret = wg_allowedips_slab_init();
+	if (ret < 0)
+		goto err_allowedips;
+
 #ifdef DEBUG
+	ret = -ENOTRECOVERABLE;
 	if (!wg_allowedips_selftest() || !wg_packet_counter_selftest() ||
 	    !wg_ratelimiter_selftest())
-		return -ENOTRECOVERABLE;
+		goto err_selftest;
 #endif
 	wg_noise_init();
 
@@ -50,6 +55,11 @@ static int __init mod_init(void)
 err_netlink:
 	wg_device_uninit();
 err_device:
+#ifdef DEBUG
+err_selftest:
+#endif
+	wg_allowedips_slab_uninit();
+err_allowedips:
 	return ret;
 }
 
@@ -57,6 +67,7 @@ static void __exit mod_exit(void)
 {
 	wg_genetlink_uninit();
 	wg_device_uninit();
+	wg_allowedips_slab_uninit();
 }
 
 module_init(mod_init);
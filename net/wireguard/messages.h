@@ -50,7 +50,8 @@ enum limits {
 	MAX_TIMER_HANDSHAKES = 90 / REKEY_TIMEOUT,
 	MAX_QUEUED_INCOMING_HANDSHAKES = 4096, /* TODO: replace this with DQL */
 	MAX_STAGED_PACKETS = 128,
-	MAX_QUEUED_PACKETS = 1024 /* TODO: replace this with DQL */
+	MAX_QUEUED_PACKETS = 1024, /* TODO: replace this with DQL */
+	MIN_DECRYPT_CPUS_PER_PEER = 2
 };
 
 enum message_type {
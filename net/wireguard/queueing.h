@@ -138,12 +138,37 @@ static inline int wg_cpumask_next_online(int *next)
 	return cpu;
 }
 
-static inline int wg_queue_enqueue_per_device_and_peer(
-	struct crypt_queue *device_queue, struct crypt_queue *peer_queue,
-	struct sk_buff *skb, struct workqueue_struct *wq, int *next_cpu)
+/* Decryption of one peer's packets is spread over a window of consecutive
+ * online CPUs starting at a CPU picked from its id, rather than over all of
+ * them, so that its rx queue and napi context stay on a few CPUs. The window
+ * shrinks as peers are added, as there is then enough parallelism between
+ * peers, but never below MIN_DECRYPT_CPUS_PER_PEER, and a single peer still
+ * gets every CPU.
+ */
+static inline int wg_cpumask_next_online_peer(struct wg_peer *peer)
 {
+	unsigned int weight = cpumask_weight(cpu_online_mask);
+	unsigned int peers = max(READ_ONCE(peer->device->num_peers), 1U);
+	unsigned int span, turn;
 	int cpu;
 
+	span = clamp_t(unsigned int, weight / peers,
+		       min_t(unsigned int, weight, MIN_DECRYPT_CPUS_PER_PEER),
+		       weight);
+	cpu = wg_cpumask_choose_online(&peer->decrypt_cpu, peer->internal_id);
+	/* Racy like wg_cpumask_next_online(), which is just as harmless. */
+	for (turn = peer->decrypt_cpu_turn++ % span; turn; --turn) {
+		cpu = cpumask_next(cpu, cpu_online_mask);
+		if (cpu >= nr_cpu_ids)
+			cpu = cpumask_first(cpu_online_mask);
+	}
+	return cpu;
+}
+
+static inline int wg_queue_enqueue_per_device_and_peer(
+	struct crypt_queue *device_queue, struct crypt_queue *peer_queue,
+	struct sk_buff *skb, struct workqueue_struct *wq, int cpu)
+{
 	atomic_set_release(&PACKET_CB(skb)->state, PACKET_STATE_UNCRYPTED);
 	/* We first queue this up for the peer ingestion, but the consumer
 	 * will wait for the state to change to CRYPTED or DEAD before.
@@ -153,7 +178,6 @@ static inline int wg_queue_enqueue_per_device_and_peer(
 	/* Then we queue it up in the device queue, which consumes the
 	 * packet as soon as it can.
 	 */
-	cpu = wg_cpumask_next_online(next_cpu);
 	if (unlikely(ptr_ring_produce_bh(&device_queue->ring, skb)))
 		return -EPIPE;
 	queue_work_on(cpu, wq, &per_cpu_ptr(device_queue->worker, cpu)->work);
@@ -18,13 +18,14 @@
 #include <net/ip_tunnels.h>
 
 /* Must be called with bh disabled. */
-static void update_rx_stats(struct wg_peer *peer, size_t len)
+static void update_rx_stats(struct wg_peer *peer, unsigned int packets,
+			    size_t len)
 {
 	struct pcpu_sw_netstats *tstats =
 		get_cpu_ptr(peer->device->dev->tstats);
 
 	u64_stats_update_begin(&tstats->syncp);
-	++tstats->rx_packets;
+	tstats->rx_packets += packets;
 	tstats->rx_bytes += len;
 	peer->rx_bytes += len;
 	u64_stats_update_end(&tstats->syncp);
@@ -200,7 +201,7 @@ static void wg_receive_handshake_packet(struct wg_device *wg,
 	}
 
 	local_bh_disable();
-	update_rx_stats(peer, skb->len);
+	update_rx_stats(peer, 1, skb->len);
 	local_bh_enable();
 
 	wg_timers_any_authenticated_packet_received(peer);
@@ -338,9 +339,64 @@ out:
 
 #include "selftest/counter.c"
 
+/* What a napi poll received from its peer, so that the stats and the timers
+ * are updated once per poll rather than once per packet.
+ */
+struct rx_batch {
+	unsigned int authenticated, data, packets;
+	size_t bytes;
+	/* The last inner source address that was routed back to this peer.
+	 * Packets of a flow come in runs, so a run costs a single allowedips
+	 * lookup. The table may change during the poll, but that is no
+	 * different from the packets having arrived a little earlier.
+	 */
+	__be16 src_protocol;
+	union {
+		__be32 src4;
+		struct in6_addr src6;
+	};
+};
+
+static bool rx_batch_src_matches(const struct rx_batch *batch,
+				 struct sk_buff *skb)
+{
+	if (skb->protocol != batch->src_protocol)
+		return false;
+	if (skb->protocol == htons(ETH_P_IP))
+		return ip_hdr(skb)->saddr == batch->src4;
+	return ipv6_addr_equal(&ipv6_hdr(skb)->saddr, &batch->src6);
+}
+
+static void rx_batch_src_save(struct rx_batch *batch, struct sk_buff *skb)
+{
+	batch->src_protocol = skb->protocol;
+	if (skb->protocol == htons(ETH_P_IP))
+		batch->src4 = ip_hdr(skb)->saddr;
+	else
+		batch->src6 = ipv6_hdr(skb)->saddr;
+}
+
+static void wg_packet_rx_batch_done(struct wg_peer *peer,
+				    struct rx_batch *batch)
+{
+	if (!batch->authenticated)
+		return;
+
+	keep_key_fresh(peer);
+
+	wg_timers_any_authenticated_packet_received(peer);
+	wg_timers_any_authenticated_packet_traversal(peer);
+	if (batch->data)
+		wg_timers_data_received(peer);
+
+	if (batch->packets)
+		update_rx_stats(peer, batch->packets, batch->bytes);
+}
+
 static void wg_packet_consume_data_done(struct wg_peer *peer,
 					struct sk_buff *skb,
-					struct endpoint *endpoint)
+					struct endpoint *endpoint,
+					struct rx_batch *batch)
 {
 	struct net_device *dev = peer->device->dev;
 	unsigned int len, len_before_trim;
@@ -354,21 +410,19 @@ static void wg_packet_consume_data_done(struct wg_peer *peer,
 		wg_packet_send_staged_packets(peer);
 	}
 
-	keep_key_fresh(peer);
-
-	wg_timers_any_authenticated_packet_received(peer);
-	wg_timers_any_authenticated_packet_traversal(peer);
+	++batch->authenticated;
 
 	/* A packet with length 0 is a keepalive packet */
 	if (unlikely(!skb->len)) {
-		update_rx_stats(peer, message_data_len(0));
+		++batch->packets;
+		batch->bytes += message_data_len(0);
 		net_dbg_ratelimited("%s: Receiving keepalive packet from peer %llu (%pISpfsc)\n",
 				    dev->name, peer->internal_id,
 				    &peer->endpoint.addr);
 		goto packet_processed;
 	}
 
-	wg_timers_data_received(peer);
+	++batch->data;
 
 	if (unlikely(skb_network_header(skb) < skb->head))
 		goto dishonest_packet_size;
@@ -411,12 +465,16 @@ static void wg_packet_consume_data_done(struct wg_peer *peer,
 	if (unlikely(pskb_trim(skb, len)))
 		goto packet_processed;
 
-	routed_peer = wg_allowedips_lookup_src(&peer->device->peer_allowedips,
-					       skb);
-	wg_peer_put(routed_peer); /* We don't need the extra reference. */
+	if (!rx_batch_src_matches(batch, skb)) {
+		routed_peer = wg_allowedips_lookup_src(
+			&peer->device->peer_allowedips, skb);
+		/* We don't need the extra reference. */
+		wg_peer_put(routed_peer);
 
-	if (unlikely(routed_peer != peer))
-		goto dishonest_packet_peer;
+		if (unlikely(routed_peer != peer))
+			goto dishonest_packet_peer;
+		rx_batch_src_save(batch, skb);
+	}
 
 	if (unlikely(napi_gro_receive(&peer->napi, skb) == GRO_DROP)) {
 		++dev->stats.rx_dropped;
@@ -424,7 +482,8 @@ static void wg_packet_consume_data_done(struct wg_peer *peer,
 				    dev->name, peer->internal_id,
 				    &peer->endpoint.addr);
 	} else {
-		update_rx_stats(peer, message_data_len(len_before_trim));
+		++batch->packets;
+		batch->bytes += message_data_len(len_before_trim);
 	}
 	return;
 
@@ -455,6 +514,7 @@ int wg_packet_rx_poll(struct napi_struct *napi, int budget)
 {
 	struct wg_peer *peer = container_of(napi, struct wg_peer, napi);
 	struct crypt_queue *queue = &peer->rx_queue;
+	struct rx_batch batch = { 0 };
 	struct noise_keypair *keypair;
 	struct endpoint endpoint;
 	enum packet_state state;
@@ -489,7 +549,7 @@ int wg_packet_rx_poll(struct napi_struct *napi, int budget)
 			goto next;
 
 		wg_reset_packet(skb);
-		wg_packet_consume_data_done(peer, skb, &endpoint);
+		wg_packet_consume_data_done(peer, skb, &endpoint, &batch);
 		free = false;
 
 next:
@@ -502,6 +562,9 @@ next:
 			break;
 	}
 
+	wg_packet_rx_batch_done(container_of(napi, struct wg_peer, napi),
+				&batch);
+
 	if (work_done < budget)
 		napi_complete_done(napi, work_done);
 
@@ -533,7 +596,7 @@ static void wg_packet_consume_data(struct wg_device *wg, struct sk_buff *skb)
 {
 	__le32 idx = ((struct message_data *)skb->data)->key_idx;
 	struct wg_peer *peer = NULL;
-	int ret;
+	int ret, cpu;
 
 	rcu_read_lock_bh();
 	PACKET_CB(skb)->keypair =
@@ -546,10 +609,10 @@ static void wg_packet_consume_data(struct wg_device *wg, struct sk_buff *skb)
 	if (unlikely(READ_ONCE(peer->is_dead)))
 		goto err;
 
+	cpu = wg_cpumask_next_online_peer(peer);
 	ret = wg_queue_enqueue_per_device_and_peer(&wg->decrypt_queue,
 						   &peer->rx_queue, skb,
-						   wg->packet_crypt_wq,
-						   &wg->decrypt_queue.last_cpu);
+						   wg->packet_crypt_wq, cpu);
 	if (unlikely(ret == -EPIPE))
 		wg_queue_enqueue_per_peer(&peer->rx_queue, skb, PACKET_STATE_DEAD);
 	if (likely(!ret || ret == -EPIPE)) {
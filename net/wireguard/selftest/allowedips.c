@@ -10,9 +10,12 @@
  * to graphviz (the dot command) to visualize it. If you define the macro
  * DEBUG_RANDOM_TRIE to be 1, then there will be an extremely costly set of
  * randomized tests done against a trivial implementation, which may take
- * upwards of a half-hour to complete. There's no set of users who should be
- * enabling these, and the only developers that should go anywhere near these
- * nobs are the ones who are reading this comment.
+ * upwards of a half-hour to complete. If you define the macro
+ * DEBUG_BENCHMARK_TRIE to be 1, then a table of NUM_BENCH_ROUTES random
+ * routes per family will be built, and the average cost of a lookup printed.
+ * There's no set of users who should be enabling these, and the only
+ * developers that should go anywhere near these nobs are the ones who are
+ * reading this comment.
  */
 
 #ifdef DEBUG
@@ -428,6 +431,83 @@ free:
 	return ret;
 }
 
+enum {
+	NUM_BENCH_ROUTES = 50000,
+	NUM_BENCH_LOOKUPS = 1 << 20
+};
+
+static __init u64 benchmark_lookups(struct allowedips_node __rcu *root,
+				    u8 bits, u8 (*ips)[16])
+{
+	u64 start = ktime_get_ns();
+	unsigned int i;
+
+	for (i = 0; i < NUM_BENCH_LOOKUPS; ++i)
+		lookup(root, bits, ips[i % NUM_BENCH_ROUTES]);
+	return div_u64(ktime_get_ns() - start, NUM_BENCH_LOOKUPS);
+}
+
+static __init bool benchmark_test(void)
+{
+	struct wg_peer **peers;
+	unsigned int i, p;
+	u64 ns4, ns6;
+	DEFINE_MUTEX(mutex);
+	struct allowedips t;
+	bool ret = false;
+	u8 (*ips)[16];
+
+	mutex_init(&mutex);
+	wg_allowedips_init(&t);
+
+	peers = kcalloc(NUM_PEERS, sizeof(*peers), GFP_KERNEL);
+	ips = kvmalloc_array(NUM_BENCH_ROUTES, sizeof(*ips), GFP_KERNEL);
+	if (unlikely(!peers || !ips))
+		goto err;
+	for (p = 0; p < NUM_PEERS; ++p) {
+		peers[p] = kzalloc(sizeof(*peers[p]), GFP_KERNEL);
+		if (unlikely(!peers[p]))
+			goto err;
+		/* Lookups take references that nothing drops */
+		kref_init(&peers[p]->refcount);
+	}
+
+	mutex_lock(&mutex);
+	for (i = 0; i < NUM_BENCH_ROUTES; ++i) {
+		prandom_bytes(ips[i], sizeof(ips[i]));
+		p = prandom_u32_max(NUM_PEERS);
+		if (wg_allowedips_insert_v4(&t, (struct in_addr *)ips[i],
+					    prandom_u32_max(25) + 8, peers[p],
+					    &mutex) < 0 ||
+		    wg_allowedips_insert_v6(&t, (struct in6_addr *)ips[i],
+					    prandom_u32_max(113) + 16, peers[p],
+					    &mutex) < 0) {
+			mutex_unlock(&mutex);
+			goto err;
+		}
+	}
+	mutex_unlock(&mutex);
+
+	/* Each lookup is for a routed address, so it walks down to a leaf */
+	ns4 = benchmark_lookups(t.root4, 32, ips);
+	ns6 = benchmark_lookups(t.root6, 128, ips);
+	pr_info("allowedips benchmark: %u routes, %llu ns per v4 lookup, %llu ns per v6 lookup\n",
+		NUM_BENCH_ROUTES, ns4, ns6);
+	ret = true;
+
+err:
+	if (!ret)
+		pr_err("allowedips benchmark malloc: FAIL\n");
+	mutex_lock(&mutex);
+	wg_allowedips_free(&t, &mutex);
+	mutex_unlock(&mutex);
+	for (p = 0; peers && p < NUM_PEERS; ++p)
+		kfree(peers[p]);
+	kfree(peers);
+	kvfree(ips);
+	return ret;
+}
+
 static __init inline struct in_addr *ip4(u8 a, u8 b, u8 c, u8 d)
 {
 	static struct in_addr ip;
@@ -661,6 +741,9 @@ bool __init wg_allowedips_selftest(void)
 	if (IS_ENABLED(DEBUG_RANDOM_TRIE) && success)
 		success = randomized_test();
 
+	if (IS_ENABLED(DEBUG_BENCHMARK_TRIE) && success)
+		success = benchmark_test();
+
 	if (success)
 		pr_info("allowedips self-tests: pass\n");
 
@@ -324,16 +324,16 @@ static void wg_packet_create_data(struct sk_buff *first)
 {
 	struct wg_peer *peer = PACKET_PEER(first);
 	struct wg_device *wg = peer->device;
-	int ret = -EINVAL;
+	int ret = -EINVAL, cpu;
 
 	rcu_read_lock_bh();
 	if (unlikely(READ_ONCE(peer->is_dead)))
 		goto err;
 
+	cpu = wg_cpumask_next_online(&wg->encrypt_queue.last_cpu);
 	ret = wg_queue_enqueue_per_device_and_peer(&wg->encrypt_queue,
 						   &peer->tx_queue, first,
-						   wg->packet_crypt_wq,
-						   &wg->encrypt_queue.last_cpu);
+						   wg->packet_crypt_wq, cpu);
 	if (unlikely(ret == -EPIPE))
 		wg_queue_enqueue_per_peer(&peer->tx_queue, first,
 					  PACKET_STATE_DEAD);
@@ -206,72 +206,169 @@ static void xsk_destruct_skb(struct sk_buff *skb)
 	sock_wfree(skb);
 }
 
-static int xsk_generic_xmit(struct sock *sk, struct msghdr *m,
-			    size_t total_len)
+static struct sk_buff *xsk_build_skb(struct xdp_sock *xs,
+				     struct xdp_desc *desc, int *err)
 {
-	u32 max_batch = TX_BATCH_SIZE;
-	struct xdp_sock *xs = xdp_sk(sk);
-	bool sent_frame = false;
-	struct xdp_desc desc;
+	struct sock *sk = &xs->sk;
 	struct sk_buff *skb;
-	int err = 0;
+	char *buffer;
 
-	mutex_lock(&xs->mutex);
+	skb = sock_alloc_send_skb(sk, desc->len, 1, err);
+	if (unlikely(!skb)) {
+		*err = -EAGAIN;
+		return NULL;
+	}
 
-	while (xskq_peek_desc(xs->tx, &desc)) {
-		char *buffer;
-		u64 addr;
-		u32 len;
+	skb_put(skb, desc->len);
+	buffer = xdp_umem_get_data(xs->umem, desc->addr);
+	*err = skb_store_bits(skb, 0, buffer, desc->len);
+	if (unlikely(*err)) {
+		kfree_skb(skb);
+		return NULL;
+	}
 
-		if (max_batch-- == 0) {
-			err = -EAGAIN;
-			goto out;
-		}
+	skb->dev = xs->dev;
+	skb->priority = sk->sk_priority;
+	skb->mark = sk->sk_mark;
+	skb_set_queue_mapping(skb, xs->queue_id);
+	skb_shinfo(skb)->destructor_arg = (void *)(long)desc->addr;
+	skb->destructor = xsk_destruct_skb;
 
-		if (xskq_reserve_addr(xs->umem->cq))
-			goto out;
+	return skb;
+}
 
-		if (xs->queue_id >= xs->dev->real_num_tx_queues)
-			goto out;
+/* Frees an skb that never reached the device, leaving its descriptor in
+ * the TX ring and giving back its completion ring entry.
+ */
+static void xsk_cancel_skb(struct xdp_sock *xs, struct sk_buff *skb)
+{
+	skb->destructor = sock_wfree;
+	consume_skb(skb);
+	xskq_cancel_addr_n(xs->umem->cq, 1);
+}
 
-		len = desc.len;
-		skb = sock_alloc_send_skb(sk, len, 1, &err);
-		if (unlikely(!skb)) {
-			err = -EAGAIN;
-			goto out;
-		}
+/* Like dev_direct_xmit(), for a batch of skbs sent under one tx queue
+ * lock, with xmit_more set on all but the last. On success, all nb skbs
+ * were sent. Otherwise the first *done skbs were consumed, the last of
+ * them at least completed but not sent, and the others were cancelled.
+ */
+static int xsk_xmit_skbs(struct xdp_sock *xs, struct sk_buff **skbs, u32 nb,
+			 u32 *done)
+{
+	struct net_device *dev = xs->dev;
+	int ret = NETDEV_TX_BUSY;
+	struct netdev_queue *txq;
+	u32 i = 0, nb_valid;
+	bool again = false;
+
+	if (unlikely(!netif_running(dev) || !netif_carrier_ok(dev))) {
+		atomic_long_inc(&dev->tx_dropped);
+		kfree_skb(skbs[0]);
+		goto cancel;
+	}
 
-		skb_put(skb, len);
-		addr = desc.addr;
-		buffer = xdp_umem_get_data(xs->umem, addr);
-		err = skb_store_bits(skb, 0, buffer, len);
-		if (unlikely(err)) {
-			kfree_skb(skb);
-			goto out;
+	for (nb_valid = 0; nb_valid < nb; nb_valid++) {
+		struct sk_buff *skb;
+
+		/* A different skb back means the one passed in was freed */
+		skb = validate_xmit_skb_list(skbs[nb_valid], dev, &again);
+		if (unlikely(skb != skbs[nb_valid])) {
+			atomic_long_inc(&dev->tx_dropped);
+			kfree_skb_list(skb);
+			for (i = nb_valid + 1; i < nb; i++)
+				xsk_cancel_skb(xs, skbs[i]);
+			nb = nb_valid + 1;
+			break;
 		}
+	}
 
-		skb->dev = xs->dev;
-		skb->priority = sk->sk_priority;
-		skb->mark = sk->sk_mark;
-		skb_shinfo(skb)->destructor_arg = (void *)(long)addr;
-		skb->destructor = xsk_destruct_skb;
+	txq = netdev_get_tx_queue(dev, xs->queue_id);
 
-		err = dev_direct_xmit(skb, xs->queue_id);
-		xskq_discard_desc(xs->tx);
+	local_bh_disable();
+
+	HARD_TX_LOCK(dev, txq, smp_processor_id());
+	for (i = 0; i < nb_valid; i++) {
+		ret = NETDEV_TX_BUSY;
+		if (netif_xmit_frozen_or_drv_stopped(txq))
+			break;
+
+		ret = netdev_start_xmit(skbs[i], dev, txq, i + 1 < nb_valid);
 		/* Ignore NET_XMIT_CN as packet might have been sent */
-		if (err == NET_XMIT_DROP || err == NETDEV_TX_BUSY) {
-			/* SKB completed but not sent */
-			err = -EBUSY;
-			goto out;
-		}
+		if (ret == NET_XMIT_DROP || !dev_xmit_complete(ret))
+			break;
+	}
+	HARD_TX_UNLOCK(dev, txq);
+
+	local_bh_enable();
 
-		sent_frame = true;
+	if (i == nb) {
+		*done = nb;
+		return 0;
 	}
 
-out:
-	if (sent_frame)
-		sk->sk_write_space(sk);
+	/* SKB completed but not sent */
+	if (i < nb_valid && !dev_xmit_complete(ret))
+		kfree_skb(skbs[i]);
+
+	if (nb_valid < nb) {
+		/* The invalid skb is completed already, so complete the
+		 * unsent ones before it too.
+		 */
+		for (i++; i < nb_valid; i++)
+			kfree_skb(skbs[i]);
+		*done = nb;
+		return -EBUSY;
+	}
+
+cancel:
+	*done = i + 1;
+	for (i++; i < nb; i++)
+		xsk_cancel_skb(xs, skbs[i]);
+
+	return -EBUSY;
+}
+
+static int xsk_generic_xmit(struct sock *sk, struct msghdr *m,
+			    size_t total_len)
+{
+	struct xdp_desc descs[TX_BATCH_SIZE];
+	struct sk_buff *skbs[TX_BATCH_SIZE];
+	struct xdp_sock *xs = xdp_sk(sk);
+	u32 i, nb, done;
+	int err = 0;
+	int ret;
+
+	mutex_lock(&xs->mutex);
+
+	if (xs->queue_id >= xs->dev->real_num_tx_queues)
+		goto out;
+
+	/* Each descriptor needs room in the completion ring */
+	nb = xskq_peek_desc_n(xs->tx, descs, TX_BATCH_SIZE);
+	nb = xskq_reserve_addr_n(xs->umem->cq, nb);
 
+	for (i = 0; i < nb; i++) {
+		skbs[i] = xsk_build_skb(xs, &descs[i], &err);
+		if (unlikely(!skbs[i]))
+			break;
+	}
+	xskq_cancel_addr_n(xs->umem->cq, nb - i);
+	nb = i;
+
+	if (!nb)
+		goto out;
+
+	ret = xsk_xmit_skbs(xs, skbs, nb, &done);
+	xskq_discard_desc_n(xs->tx, done);
+	if (ret)
+		err = ret;
+	else if (!err && nb == TX_BATCH_SIZE &&
+		 xskq_peek_desc_n(xs->tx, descs, 1))
+		err = -EAGAIN;
+
+	sk->sk_write_space(sk);
+
+out:
 	mutex_unlock(&xs->mutex);
 	return err;
 }
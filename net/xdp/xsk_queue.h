@@ -166,6 +166,24 @@ static inline int xskq_reserve_addr(struct xsk_queue *q)
 	return 0;
 }
 
+/* Reserves up to nb entries and returns how many were reserved */
+static inline u32 xskq_reserve_addr_n(struct xsk_queue *q, u32 nb)
+{
+	u32 free_entries = xskq_nb_free(q, q->prod_head, nb);
+
+	if (nb > free_entries)
+		nb = free_entries;
+
+	q->prod_head += nb;
+	return nb;
+}
+
+/* Gives back reserved entries that will not be produced */
+static inline void xskq_cancel_addr_n(struct xsk_queue *q, u32 nb)
+{
+	q->prod_head -= nb;
+}
+
 /* Rx/Tx queue */
 
 static inline bool xskq_is_valid_desc(struct xsk_queue *q, struct xdp_desc *d)
@@ -218,6 +236,52 @@ static inline void xskq_discard_desc(struct xsk_queue *q)
 	q->cons_tail++;
 }
 
+/* Copies up to max valid descriptors to descs, without consuming them.
+ * Invalid descriptors at the head of the ring are skipped; one found
+ * after valid descriptors ends the batch and is skipped by the next
+ * call, so it is only accounted once.
+ */
+static inline u32 xskq_peek_desc_n(struct xsk_queue *q,
+				   struct xdp_desc *descs, u32 max)
+{
+	struct xdp_rxtx_ring *ring = (struct xdp_rxtx_ring *)q->ring;
+	u32 nb = 0;
+
+	if (q->cons_tail == q->cons_head) {
+		WRITE_ONCE(q->ring->consumer, q->cons_tail);
+		q->cons_head = q->cons_tail + xskq_nb_avail(q, max);
+
+		/* Order consumer and data */
+		smp_rmb();
+	}
+
+	while (nb < max && q->cons_tail + nb != q->cons_head) {
+		unsigned int idx = (q->cons_tail + nb) & q->ring_mask;
+		struct xdp_desc *d = &descs[nb];
+
+		*d = READ_ONCE(ring->desc[idx]);
+		if (d->addr < q->umem_props.size &&
+		    ((d->addr + d->len) & q->umem_props.chunk_mask) ==
+		    (d->addr & q->umem_props.chunk_mask)) {
+			nb++;
+			continue;
+		}
+
+		if (nb)
+			break;
+
+		q->invalid_descs++;
+		q->cons_tail++;
+	}
+
+	return nb;
+}
+
+static inline void xskq_discard_desc_n(struct xsk_queue *q, u32 nb)
+{
+	q->cons_tail += nb;
+}
+
 static inline int xskq_produce_batch_desc(struct xsk_queue *q,
 					  u64 addr, u32 len)
 {
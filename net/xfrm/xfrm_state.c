@@ -44,6 +44,33 @@ static unsigned int xfrm_state_hashmax __read_mostly = 1 * 1024 * 1024;
 static __read_mostly seqcount_t xfrm_state_hash_generation = SEQCNT_ZERO(xfrm_state_hash_generation);
 static struct kmem_cache *xfrm_state_cache __ro_after_init;
 
+/*
+ * Per-CPU cache of the last states found by spi, in front of the byspi
+ * hash which every inbound packet is looked up in. Entries are only used
+ * while xfrm_spi_cache_genid is unchanged, it is bumped whenever a state
+ * enters or leaves the byspi hash. The states are freed after an RCU grace
+ * period, so a cached state can be looked at under rcu_read_lock() as long
+ * as the generation still matches.
+ */
+#define XFRM_SPI_CACHE_SIZE	16
+
+struct xfrm_spi_cache_entry {
+	struct xfrm_state	*x;
+	unsigned int		genid;
+	u32			mark;
+};
+
+static DEFINE_PER_CPU(struct xfrm_spi_cache_entry [XFRM_SPI_CACHE_SIZE],
+		      xfrm_spi_cache);
+static atomic_t xfrm_spi_cache_genid = ATOMIC_INIT(1);
+
+static inline void xfrm_spi_cache_invalidate(void)
+{
+	/* Hash update first, see xfrm_state_lookup() */
+	smp_mb__before_atomic();
+	atomic_inc(&xfrm_spi_cache_genid);
+}
+
 static DECLARE_WORK(xfrm_state_gc_work, xfrm_state_gc_task);
 static HLIST_HEAD(xfrm_state_gc_list);
 
@@ -620,8 +647,10 @@ int __xfrm_state_delete(struct xfrm_state *x)
 		list_del(&x->km.all);
 		hlist_del_rcu(&x->bydst);
 		hlist_del_rcu(&x->bysrc);
-		if (x->id.spi)
+		if (x->id.spi) {
 			hlist_del_rcu(&x->byspi);
+			xfrm_spi_cache_invalidate();
+		}
 		net->xfrm.state_num--;
 		spin_unlock(&net->xfrm.xfrm_state_lock);
 
@@ -1037,6 +1066,7 @@ found:
 			if (x->id.spi) {
 				h = xfrm_spi_hash(net, &x->id.daddr, x->id.spi, x->id.proto, encap_family);
 				hlist_add_head_rcu(&x->byspi, net->xfrm.state_byspi + h);
+				xfrm_spi_cache_invalidate();
 			}
 			x->lft.hard_add_expires_seconds = net->xfrm.sysctl_acq_expires;
 			tasklet_hrtimer_start(&x->mtimer, ktime_set(net->xfrm.sysctl_acq_expires, 0), HRTIMER_MODE_REL);
@@ -1149,6 +1179,7 @@ static void __xfrm_state_insert(struct xfrm_state *x)
 				  x->props.family);
 
 		hlist_add_head_rcu(&x->byspi, net->xfrm.state_byspi + h);
+		xfrm_spi_cache_invalidate();
 	}
 
 	tasklet_hrtimer_start(&x->mtimer, ktime_set(1, 0), HRTIMER_MODE_REL);
@@ -1620,10 +1651,38 @@ struct xfrm_state *
 xfrm_state_lookup(struct net *net, u32 mark, const xfrm_address_t *daddr, __be32 spi,
 		  u8 proto, unsigned short family)
 {
+	struct xfrm_spi_cache_entry *e;
 	struct xfrm_state *x;
+	unsigned int genid;
 
 	rcu_read_lock();
+
+	/* Only from BH context, so that the entry is not updated under us */
+	if (!in_softirq()) {
+		x = __xfrm_state_lookup(net, mark, daddr, spi, proto, family);
+		goto out;
+	}
+
+	genid = atomic_read(&xfrm_spi_cache_genid);
+	/* Pairs with xfrm_spi_cache_invalidate() */
+	smp_rmb();
+	e = this_cpu_ptr(&xfrm_spi_cache[ntohl(spi) &
+					 (XFRM_SPI_CACHE_SIZE - 1)]);
+	x = e->x;
+	if (x && e->genid == genid && e->mark == mark &&
+	    x->id.spi == spi && x->id.proto == proto &&
+	    x->props.family == family && net_eq(xs_net(x), net) &&
+	    xfrm_addr_equal(&x->id.daddr, daddr, family) &&
+	    xfrm_state_hold_rcu(x))
+		goto out;
+
 	x = __xfrm_state_lookup(net, mark, daddr, spi, proto, family);
+	if (x) {
+		e->x = x;
+		e->genid = genid;
+		e->mark = mark;
+	}
+out:
 	rcu_read_unlock();
 	return x;
 }
@@ -1818,6 +1877,7 @@ int xfrm_alloc_spi(struct xfrm_state *x, u32 low, u32 high)
 		spin_lock_bh(&net->xfrm.xfrm_state_lock);
 		h = xfrm_spi_hash(net, &x->id.daddr, x->id.spi, x->id.proto, x->props.family);
 		hlist_add_head_rcu(&x->byspi, net->xfrm.state_byspi + h);
+		xfrm_spi_cache_invalidate();
 		spin_unlock_bh(&net->xfrm.xfrm_state_lock);
 
 		err = 0;
@@ -18,6 +18,7 @@ case $SRCARCH in
 	ia64)           BCJ=--ia64; LZMA2OPTS=pb=4 ;;
 	arm)            BCJ=--arm ;;
 	sparc)          BCJ=--sparc ;;
+	arm64)          xz --arm64 < /dev/null > /dev/null 2>&1 && BCJ=--arm64 ;;
 esac
 
 exec xz --check=crc32 $BCJ --lzma2=$LZMA2OPTS,dict=32MiB
@@ -36,6 +36,7 @@ struct aiu_i2s_dma {
 	struct meson_audio_core_data *core;
 	struct clk *fast;
 	int irq;
+	bool irq_disabled;
 };
 
 #define AIU_MEM_I2S_BUF_CNTL_INIT		BIT(0)
@@ -81,7 +82,8 @@ static struct snd_pcm_hardware aiu_i2s_dma_hw = {
 	.info = (SNDRV_PCM_INFO_INTERLEAVED |
 		 SNDRV_PCM_INFO_MMAP |
 		 SNDRV_PCM_INFO_MMAP_VALID |
-		 SNDRV_PCM_INFO_PAUSE),
+		 SNDRV_PCM_INFO_PAUSE |
+		 SNDRV_PCM_INFO_NO_PERIOD_WAKEUP),
 
 	.formats = (SNDRV_PCM_FMTBIT_S16_LE |
 		    SNDRV_PCM_FMTBIT_S24_LE |
@@ -186,6 +188,19 @@ static int aiu_i2s_dma_prepare(struct snd_pcm_substream *substream)
 	return 0;
 }
 
+static void aiu_i2s_dma_irq_disable(struct aiu_i2s_dma *priv, bool disable)
+{
+	if (disable == priv->irq_disabled)
+		return;
+
+	if (disable)
+		disable_irq(priv->irq);
+	else
+		enable_irq(priv->irq);
+
+	priv->irq_disabled = disable;
+}
+
 static int aiu_i2s_dma_hw_params(struct snd_pcm_substream *substream,
 				 struct snd_pcm_hw_params *params)
 {
@@ -224,11 +239,21 @@ static int aiu_i2s_dma_hw_params(struct snd_pcm_substream *substream,
 		     AIU_MEM_I2S_MASKS_CH_MEM(0xff) |
 		     AIU_MEM_I2S_MASKS_IRQ_BLOCK(burst_num));
 
+	/*
+	 * The block irq can't be masked in the AIU, so keep the line
+	 * disabled when the application does not want period wakeups
+	 */
+	aiu_i2s_dma_irq_disable(priv, runtime->no_period_wakeup);
+
 	return 0;
 }
 
 static int aiu_i2s_dma_hw_free(struct snd_pcm_substream *substream)
 {
+	struct aiu_i2s_dma *priv = aiu_i2s_dma_priv(substream);
+
+	aiu_i2s_dma_irq_disable(priv, false);
+
 	return snd_pcm_lib_free_pages(substream);
 }
 
@@ -65,7 +65,8 @@ static struct snd_pcm_hardware aiu_spdif_dma_hw = {
 	.info = (SNDRV_PCM_INFO_INTERLEAVED |
 		 SNDRV_PCM_INFO_MMAP |
 		 SNDRV_PCM_INFO_MMAP_VALID |
-		 SNDRV_PCM_INFO_PAUSE),
+		 SNDRV_PCM_INFO_PAUSE |
+		 SNDRV_PCM_INFO_NO_PERIOD_WAKEUP),
 
 	.formats = (SNDRV_PCM_FMTBIT_S16_LE |
 		    SNDRV_PCM_FMTBIT_S24_LE |
@@ -234,13 +235,16 @@ static int aiu_spdif_dma_hw_params(struct snd_pcm_substream *substream,
 
 	/*
 	 * AUTO_DISABLE and SYNC_HEAD are enabled by default but
-	 * this should be disabled in PCM (uncompressed) mode
+	 * this should be disabled in PCM (uncompressed) mode.
+	 * Leave the irq off when the application does not want to be woken
+	 * up on each period.
 	 */
 	regmap_update_bits(priv->core->aiu, AIU_958_DCU_FF_CTRL,
 			   AIU_958_DCU_FF_CTRL_AUTO_DISABLE |
 			   AIU_958_DCU_FF_CTRL_IRQ_MODE_MASK |
 			   AIU_958_DCU_FF_CTRL_SYNC_HEAD_EN,
-			   AIU_958_DCU_FF_CTRL_IRQ_FRAME_READ);
+			   runtime->no_period_wakeup ?
+			   0 : AIU_958_DCU_FF_CTRL_IRQ_FRAME_READ);
 
 	return 0;
 }
@@ -64,6 +64,78 @@ static int meson_acore_init_clocks(struct device *dev)
 	return 0;
 }
 
+/*
+ * The audio master clocks are muxes between the MPLLs, followed by a
+ * divider, and don't propagate rate changes to the MPLLs. When one PLL is
+ * dedicated to each audio rate family, switching between 44.1kHz and
+ * 48kHz content only reparents and divides the master clocks: nothing is
+ * retuned nor relocked, so the stream, or a bitstream passthrough, starts
+ * immediately and at the exact rate, without software resampling.
+ */
+struct meson_acore_pll {
+	const char *name;
+	unsigned long rate;
+};
+
+static const struct meson_acore_pll acore_plls[] = {
+	/* 1024 * 176.4kHz and 1024 * 192kHz */
+	{ .name = "pll_44k1",	.rate = 180633600, },
+	{ .name = "pll_48k",	.rate = 196608000, },
+};
+
+static void meson_acore_pll_release(void *data)
+{
+	struct clk *clock = data;
+
+	clk_rate_exclusive_put(clock);
+	clk_disable_unprepare(clock);
+}
+
+static int meson_acore_init_plls(struct device *dev)
+{
+	struct clk *clock;
+	int i, ret;
+
+	for (i = 0; i < ARRAY_SIZE(acore_plls); i++) {
+		/* The rate family PLLs are optional */
+		clock = devm_clk_get(dev, acore_plls[i].name);
+		if (IS_ERR(clock)) {
+			if (PTR_ERR(clock) == -ENOENT)
+				continue;
+			if (PTR_ERR(clock) != -EPROBE_DEFER)
+				dev_err(dev, "Failed to get %s clock
+",
+					acore_plls[i].name);
+			return PTR_ERR(clock);
+		}
+
+		ret = clk_set_rate_exclusive(clock, acore_plls[i].rate);
+		if (ret) {
+			dev_err(dev, "Failed to set %s clock rate
+",
+				acore_plls[i].name);
+			return ret;
+		}
+
+		/* Keep the PLL running so it is locked when a stream starts */
+		ret = clk_prepare_enable(clock);
+		if (ret) {
+			dev_err(dev, "Failed to enable %s clock
+",
+				acore_plls[i].name);
+			clk_rate_exclusive_put(clock);
+			return ret;
+		}
+
+		ret = devm_add_action_or_reset(dev, meson_acore_pll_release,
+					       clock);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
 static const char * const acore_reset_names[] = { "aiu",
 						  "audin" };
 
@@ -139,6 +211,10 @@ static int meson_acore_probe(struct platform_device *pdev)
 	if (ret)
 		return ret;
 
+	ret = meson_acore_init_plls(dev);
+	if (ret)
+		return ret;
+
 	res = platform_get_resource_byname(pdev, IORESOURCE_MEM, "aiu");
 	regs = devm_ioremap_resource(dev, res);
 	if (IS_ERR(regs))
@@ -27,14 +27,16 @@ static struct snd_pcm_hardware axg_fifo_hw = {
 		 SNDRV_PCM_INFO_MMAP |
 		 SNDRV_PCM_INFO_MMAP_VALID |
 		 SNDRV_PCM_INFO_BLOCK_TRANSFER |
-		 SNDRV_PCM_INFO_PAUSE),
+		 SNDRV_PCM_INFO_PAUSE |
+		 SNDRV_PCM_INFO_NO_PERIOD_WAKEUP |
+		 SNDRV_PCM_INFO_SYNC_START),
 
 	.formats = AXG_FIFO_FORMATS,
 	.rate_min = 5512,
 	.rate_max = 192000,
 	.channels_min = 1,
 	.channels_max = AXG_FIFO_CH_MAX,
-	.period_bytes_min = AXG_FIFO_MIN_DEPTH,
+	.period_bytes_min = AXG_FIFO_BURST,
 	.period_bytes_max = UINT_MAX,
 	.periods_min = 2,
 	.periods_max = UINT_MAX,
@@ -125,10 +127,14 @@ static int axg_fifo_pcm_hw_params(struct snd_pcm_substream *ss,
 	burst_num = params_period_bytes(params) / AXG_FIFO_BURST;
 	regmap_write(fifo->map, FIFO_INT_ADDR, burst_num);
 
-	/* Enable block count irq */
+	/*
+	 * Enable block count irq, unless the application relies only on
+	 * the pointer and does not want to be woken up on each period
+	 */
 	regmap_update_bits(fifo->map, FIFO_CTRL0,
 			   CTRL0_INT_EN(FIFO_INT_COUNT_REPEAT),
-			   CTRL0_INT_EN(FIFO_INT_COUNT_REPEAT));
+			   runtime->no_period_wakeup ?
+			   0 : CTRL0_INT_EN(FIFO_INT_COUNT_REPEAT));
 
 	return 0;
 }
@@ -186,8 +192,17 @@ static int axg_fifo_pcm_open(struct snd_pcm_substream *ss)
 	snd_soc_set_runtime_hwparams(ss, &axg_fifo_hw);
 
 	/*
-	 * Make sure the buffer and period size are multiple of the FIFO
-	 * minimum depth size
+	 * All the fifos are clocked by the same audio bus, so streams
+	 * linked together are triggered in the same atomic section and
+	 * start within a few bus cycles of each other
+	 */
+	snd_pcm_set_sync(ss);
+
+	/*
+	 * Make sure the buffer size is a multiple of the FIFO minimum depth
+	 * size. The block irq counts bursts, so periods only need to be a
+	 * multiple of the burst size, which allows small periods for low
+	 * latency use cases.
 	 */
 	ret = snd_pcm_hw_constraint_step(ss->runtime, 0,
 					 SNDRV_PCM_HW_PARAM_BUFFER_BYTES,
@@ -197,7 +212,7 @@ static int axg_fifo_pcm_open(struct snd_pcm_substream *ss)
 
 	ret = snd_pcm_hw_constraint_step(ss->runtime, 0,
 					 SNDRV_PCM_HW_PARAM_PERIOD_BYTES,
-					 AXG_FIFO_MIN_DEPTH);
+					 AXG_FIFO_BURST);
 	if (ret)
 		return ret;
 
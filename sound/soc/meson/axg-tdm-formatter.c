@@ -34,7 +34,10 @@ int axg_tdm_formatter_set_channel_masks(struct regmap *map,
 
 	/*
 	 * Distribute the channels of the stream over the available slots
-	 * of each TDM lane
+	 * of each TDM lane. On the capture side, the formatter interleaves
+	 * the slots of all the lanes into a single stream, so a multi-lane
+	 * device, such as a mic array, is delivered to one TODDR fifo as
+	 * one interleaved buffer.
 	 */
 	for (i = 0; i < AXG_TDM_NUM_LANES; i++) {
 		val = 0;
@@ -0,0 +1,56 @@
+#!/bin/sh
+# SPDX-License-Identifier: GPL-2.0
+#
+# Run dmatest over a set of scenarios and collect the per thread results
+# and latency histograms from debugfs, one file per scenario.
+#
+# Each scenario line is:
+#
+#	name buf_size chunks max_channels threads_per_chan iterations
+#
+# - buf_size and chunks compare one contiguous memcpy with the same amount
+#   of data split in several descriptors
+# - small buffers show the fixed cost per transfer, and on non-coherent
+#   devices the "map" and "unmap" histograms show the cache maintenance cost
+# - max_channels and threads_per_chan show how channels scale together
+#
+# Scenarios are read from the file given as first argument, or from stdin.
+# The channel or device to test can be set with CHANNEL= and DEVICE=.
+#
+
+PARAMS=/sys/module/dmatest/parameters
+RESULTS=/sys/kernel/debug/dmatest/results
+OUT=${OUT:-dmatest-results}
+
+modprobe dmatest || exit 1
+if [ ! -r $RESULTS ]; then
+	echo "$RESULTS not found, is debugfs mounted?" >&2
+	exit 1
+fi
+mkdir -p $OUT || exit 1
+
+echo "${CHANNEL:-}" > $PARAMS/channel
+echo "${DEVICE:-}" > $PARAMS/device
+echo 1 > $PARAMS/noverify
+echo 1 > $PARAMS/norandom
+echo 0 > $PARAMS/dmatest
+
+grep -v '^#' ${1:-/dev/stdin} |
+while read name buf_size chunks channels threads iterations; do
+	[ -n "$name" ] || continue
+
+	echo $buf_size > $PARAMS/test_buf_size
+	echo $chunks > $PARAMS/chunks
+	echo $channels > $PARAMS/max_channels
+	echo $threads > $PARAMS/threads_per_chan
+	echo $iterations > $PARAMS/iterations
+
+	echo "running $name"
+	echo 1 > $PARAMS/run
+	while [ "$(cat $PARAMS/run)" = "Y" ]; do
+		sleep 1
+	done
+
+	cat $RESULTS > $OUT/$name
+	grep -v '^ ' $OUT/$name
+done
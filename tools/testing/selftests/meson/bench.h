@@ -0,0 +1,62 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Helpers shared by the Meson benchmarks.
+ *
+ * Every result is printed on its own line as "<metric> <value> <unit>",
+ * metric names are stable so that meson_bench.sh can compare two runs.
+ */
+
+#ifndef __MESON_BENCH_H
+#define __MESON_BENCH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static inline long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static inline void bench_result(const char *metric, double value,
+				const char *unit)
+{
+	printf("%s %.3f %s\n", metric, value, unit);
+}
+
+static int cmp_ll(const void *a, const void *b)
+{
+	long long x = *(const long long *)a, y = *(const long long *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/* Prints the mean, median, 99th percentile and max of @n samples in ns */
+static inline void bench_latency(const char *metric, long long *samples,
+				 int n)
+{
+	char name[128];
+	double sum = 0;
+	int i;
+
+	if (!n)
+		return;
+
+	qsort(samples, n, sizeof(*samples), cmp_ll);
+	for (i = 0; i < n; i++)
+		sum += samples[i];
+
+	snprintf(name, sizeof(name), "%s.mean", metric);
+	bench_result(name, sum / n / 1000, "us");
+	snprintf(name, sizeof(name), "%s.p50", metric);
+	bench_result(name, samples[n / 2] / 1000.0, "us");
+	snprintf(name, sizeof(name), "%s.p99", metric);
+	bench_result(name, samples[n * 99 / 100] / 1000.0, "us");
+	snprintf(name, sizeof(name), "%s.max", metric);
+	bench_result(name, samples[n - 1] / 1000.0, "us");
+}
+
+#endif
@@ -0,0 +1,126 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Time single transfers through spidev or i2c-dev, from the ioctl to its
+ * return, which covers the controller driver setup, the transfer and its
+ * completion interrupt.
+ *
+ *   bus_latency -s /dev/spidev0.0 [-l len] [-n count]
+ *   bus_latency -i /dev/i2c-1 -a addr [-l len] [-n count]
+ *
+ * SPI transfers are full duplex, I2C ones are reads from the given address.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <error.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+#include <linux/spi/spidev.h>
+
+#include "bench.h"
+
+static int cfg_count = 1000;
+static int cfg_len = 4;
+
+static long long spi_transfer(int fd, uint8_t *tx, uint8_t *rx)
+{
+	struct spi_ioc_transfer xfer = {
+		.tx_buf = (uintptr_t)tx,
+		.rx_buf = (uintptr_t)rx,
+		.len = cfg_len,
+	};
+	long long t0 = now_ns();
+
+	if (ioctl(fd, SPI_IOC_MESSAGE(1), &xfer) < 0)
+		error(1, errno, "SPI_IOC_MESSAGE");
+
+	return now_ns() - t0;
+}
+
+static long long i2c_transfer(int fd, uint16_t addr, uint8_t *rx)
+{
+	struct i2c_msg msg = {
+		.addr = addr,
+		.flags = I2C_M_RD,
+		.len = cfg_len,
+		.buf = rx,
+	};
+	struct i2c_rdwr_ioctl_data data = {
+		.msgs = &msg,
+		.nmsgs = 1,
+	};
+	long long t0 = now_ns();
+
+	if (ioctl(fd, I2C_RDWR, &data) < 0)
+		error(1, errno, "I2C_RDWR");
+
+	return now_ns() - t0;
+}
+
+int main(int argc, char **argv)
+{
+	const char *spi_dev = NULL, *i2c_dev = NULL;
+	long long *samples;
+	uint8_t *tx, *rx;
+	int addr = -1;
+	char metric[64];
+	int fd, i, c;
+
+	while ((c = getopt(argc, argv, "s:i:a:l:n:")) != -1) {
+		switch (c) {
+		case 's':
+			spi_dev = optarg;
+			break;
+		case 'i':
+			i2c_dev = optarg;
+			break;
+		case 'a':
+			addr = strtol(optarg, NULL, 0);
+			break;
+		case 'l':
+			cfg_len = atoi(optarg);
+			break;
+		case 'n':
+			cfg_count = atoi(optarg);
+			break;
+		default:
+			goto usage;
+		}
+	}
+	if (!spi_dev == !i2c_dev || (i2c_dev && addr < 0) ||
+	    cfg_len <= 0 || cfg_count <= 0)
+		goto usage;
+
+	fd = open(spi_dev ? spi_dev : i2c_dev, O_RDWR);
+	if (fd < 0)
+		error(4, errno, "%s", spi_dev ? spi_dev : i2c_dev);
+
+	samples = calloc(cfg_count, sizeof(*samples));
+	tx = calloc(1, cfg_len);
+	rx = calloc(1, cfg_len);
+	if (!samples || !tx || !rx)
+		error(1, errno, "calloc");
+
+	for (i = 0; i < cfg_count; i++)
+		samples[i] = spi_dev ? spi_transfer(fd, tx, rx) :
+				       i2c_transfer(fd, addr, rx);
+
+	snprintf(metric, sizeof(metric), "meson.%s.xfer_%d",
+		 spi_dev ? "spi" : "i2c", cfg_len);
+	bench_latency(metric, samples, cfg_count);
+
+	return 0;
+
+usage:
+	fprintf(stderr,
+		"usage: %s -s spidev | -i i2cdev -a addr [-l len] [-n count]\n",
+		argv[0]);
+	return 1;
+}
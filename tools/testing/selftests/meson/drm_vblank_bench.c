@@ -0,0 +1,297 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Measure how long a frame takes from its commit to the vblank it is shown
+ * at, on the primary plane (OSD1) and on the first plane able to scan out
+ * NV12 (VD1 on Meson).
+ *
+ * The primary plane is flipped with DRM_MODE_PAGE_FLIP_EVENT and the vblank
+ * timestamp of the event is compared to the time of the ioctl. The overlay
+ * is updated with SETPLANE, which only returns once the new frame has been
+ * latched, so the ioctl itself is timed. Only dumb buffers are used.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <error.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <drm/drm.h>
+#include <drm/drm_mode.h>
+#include <drm/drm_fourcc.h>
+
+#include "bench.h"
+
+static const char *cfg_dev = "/dev/dri/card0";
+static int cfg_frames = 300;
+
+static int fd;
+
+struct fb {
+	uint32_t handle;
+	uint32_t fb_id;
+};
+
+static void xioctl(unsigned long req, void *arg, const char *name)
+{
+	int ret;
+
+	do {
+		ret = ioctl(fd, req, arg);
+	} while (ret && (errno == EINTR || errno == EAGAIN));
+
+	if (ret)
+		error(1, errno, "%s", name);
+}
+
+static void fb_create(struct fb *fb, uint32_t width, uint32_t height,
+		      uint32_t format)
+{
+	struct drm_mode_create_dumb dumb = {
+		.width = width,
+		.height = format == DRM_FORMAT_NV12 ? height * 3 / 2 : height,
+		.bpp = format == DRM_FORMAT_NV12 ? 8 : 32,
+	};
+	struct drm_mode_fb_cmd2 cmd = {
+		.width = width,
+		.height = height,
+		.pixel_format = format,
+	};
+
+	xioctl(DRM_IOCTL_MODE_CREATE_DUMB, &dumb, "DRM_IOCTL_MODE_CREATE_DUMB");
+	fb->handle = dumb.handle;
+
+	cmd.handles[0] = dumb.handle;
+	cmd.pitches[0] = dumb.pitch;
+	if (format == DRM_FORMAT_NV12) {
+		cmd.handles[1] = dumb.handle;
+		cmd.pitches[1] = dumb.pitch;
+		cmd.offsets[1] = dumb.pitch * height;
+	}
+	xioctl(DRM_IOCTL_MODE_ADDFB2, &cmd, "DRM_IOCTL_MODE_ADDFB2");
+	fb->fb_id = cmd.fb_id;
+}
+
+static void fb_destroy(struct fb *fb)
+{
+	struct drm_mode_destroy_dumb dumb = { .handle = fb->handle };
+
+	ioctl(fd, DRM_IOCTL_MODE_RMFB, &fb->fb_id);
+	ioctl(fd, DRM_IOCTL_MODE_DESTROY_DUMB, &dumb);
+}
+
+/* Finds a connected connector, its first mode and a CRTC to drive it */
+static void find_output(uint32_t *conn_id, uint32_t *crtc_id,
+			int *crtc_index, struct drm_mode_modeinfo *mode)
+{
+	uint32_t conns[32], crtcs[8];
+	struct drm_mode_card_res res = {
+		.connector_id_ptr = (uintptr_t)conns,
+		.count_connectors = 32,
+		.crtc_id_ptr = (uintptr_t)crtcs,
+		.count_crtcs = 8,
+	};
+	unsigned int i;
+
+	xioctl(DRM_IOCTL_MODE_GETRESOURCES, &res,
+	       "DRM_IOCTL_MODE_GETRESOURCES");
+	if (!res.count_crtcs)
+		error(4, 0, "no CRTC");
+
+	for (i = 0; i < res.count_connectors && i < 32; i++) {
+		struct drm_mode_modeinfo modes[64];
+		struct drm_mode_get_connector conn = {
+			.connector_id = conns[i],
+			.modes_ptr = (uintptr_t)modes,
+			.count_modes = 64,
+		};
+
+		xioctl(DRM_IOCTL_MODE_GETCONNECTOR, &conn,
+		       "DRM_IOCTL_MODE_GETCONNECTOR");
+		if (conn.connection != 1 || !conn.count_modes)
+			continue;
+
+		*conn_id = conns[i];
+		*mode = modes[0];
+		*crtc_id = crtcs[0];
+		*crtc_index = 0;
+		return;
+	}
+
+	error(4, 0, "no connected output");
+}
+
+/* Finds a plane of the CRTC that takes NV12, 0 if there isn't any */
+static uint32_t find_nv12_plane(int crtc_index)
+{
+	uint32_t planes[32];
+	struct drm_mode_get_plane_res res = {
+		.plane_id_ptr = (uintptr_t)planes,
+		.count_planes = 32,
+	};
+	unsigned int i, j;
+
+	xioctl(DRM_IOCTL_MODE_GETPLANERESOURCES, &res,
+	       "DRM_IOCTL_MODE_GETPLANERESOURCES");
+
+	for (i = 0; i < res.count_planes && i < 32; i++) {
+		uint32_t formats[64];
+		struct drm_mode_get_plane plane = {
+			.plane_id = planes[i],
+			.format_type_ptr = (uintptr_t)formats,
+			.count_format_types = 64,
+		};
+
+		xioctl(DRM_IOCTL_MODE_GETPLANE, &plane,
+		       "DRM_IOCTL_MODE_GETPLANE");
+		if (!(plane.possible_crtcs & (1 << crtc_index)))
+			continue;
+
+		for (j = 0; j < plane.count_format_types && j < 64; j++)
+			if (formats[j] == DRM_FORMAT_NV12)
+				return planes[i];
+	}
+
+	return 0;
+}
+
+static void bench_flip(uint32_t crtc_id, struct fb *fbs)
+{
+	long long *samples = calloc(cfg_frames, sizeof(*samples));
+	int i;
+
+	if (!samples)
+		error(1, errno, "calloc");
+
+	for (i = 0; i < cfg_frames; i++) {
+		struct drm_mode_crtc_page_flip flip = {
+			.crtc_id = crtc_id,
+			.fb_id = fbs[(i + 1) & 1].fb_id,
+			.flags = DRM_MODE_PAGE_FLIP_EVENT,
+		};
+		struct drm_event_vblank ev;
+		long long t0;
+
+		t0 = now_ns();
+		xioctl(DRM_IOCTL_MODE_PAGE_FLIP, &flip,
+		       "DRM_IOCTL_MODE_PAGE_FLIP");
+		if (read(fd, &ev, sizeof(ev)) != sizeof(ev))
+			error(1, errno, "read event");
+
+		/* Vblank timestamps are CLOCK_MONOTONIC */
+		samples[i] = ev.tv_sec * 1000000000LL + ev.tv_usec * 1000LL -
+			     t0;
+	}
+
+	bench_latency("meson.drm.osd1.commit_to_vblank", samples, cfg_frames);
+	free(samples);
+}
+
+static void bench_setplane(uint32_t plane_id, uint32_t crtc_id,
+			   struct fb *fbs, uint32_t width, uint32_t height)
+{
+	long long *samples = calloc(cfg_frames, sizeof(*samples));
+	struct drm_mode_set_plane off = {
+		.plane_id = plane_id,
+	};
+	int i;
+
+	if (!samples)
+		error(1, errno, "calloc");
+
+	for (i = 0; i < cfg_frames; i++) {
+		struct drm_mode_set_plane set = {
+			.plane_id = plane_id,
+			.crtc_id = crtc_id,
+			.fb_id = fbs[i & 1].fb_id,
+			.crtc_w = width,
+			.crtc_h = height,
+			.src_w = width << 16,
+			.src_h = height << 16,
+		};
+		long long t0;
+
+		t0 = now_ns();
+		xioctl(DRM_IOCTL_MODE_SETPLANE, &set,
+		       "DRM_IOCTL_MODE_SETPLANE");
+		samples[i] = now_ns() - t0;
+	}
+
+	ioctl(fd, DRM_IOCTL_MODE_SETPLANE, &off);
+
+	bench_latency("meson.drm.vd1.commit_to_vblank", samples, cfg_frames);
+	free(samples);
+}
+
+int main(int argc, char **argv)
+{
+	struct drm_set_client_cap cap = {
+		.capability = DRM_CLIENT_CAP_UNIVERSAL_PLANES,
+		.value = 1,
+	};
+	struct drm_mode_modeinfo mode;
+	struct drm_mode_crtc crtc;
+	uint32_t conn_id, crtc_id, plane_id;
+	struct fb fbs[2], nv12[2];
+	int crtc_index, c;
+
+	while ((c = getopt(argc, argv, "d:n:")) != -1) {
+		switch (c) {
+		case 'd':
+			cfg_dev = optarg;
+			break;
+		case 'n':
+			cfg_frames = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-d device] [-n frames]\n",
+				argv[0]);
+			return 1;
+		}
+	}
+	if (cfg_frames <= 0)
+		error(1, 0, "invalid number of frames");
+
+	fd = open(cfg_dev, O_RDWR | O_CLOEXEC);
+	if (fd < 0)
+		error(4, errno, "%s", cfg_dev);
+
+	/* Needs to be the DRM master, i.e. no display server running */
+	xioctl(DRM_IOCTL_SET_CLIENT_CAP, &cap, "DRM_IOCTL_SET_CLIENT_CAP");
+
+	find_output(&conn_id, &crtc_id, &crtc_index, &mode);
+	fb_create(&fbs[0], mode.hdisplay, mode.vdisplay, DRM_FORMAT_XRGB8888);
+	fb_create(&fbs[1], mode.hdisplay, mode.vdisplay, DRM_FORMAT_XRGB8888);
+
+	memset(&crtc, 0, sizeof(crtc));
+	crtc.crtc_id = crtc_id;
+	crtc.fb_id = fbs[0].fb_id;
+	crtc.set_connectors_ptr = (uintptr_t)&conn_id;
+	crtc.count_connectors = 1;
+	crtc.mode = mode;
+	crtc.mode_valid = 1;
+	xioctl(DRM_IOCTL_MODE_SETCRTC, &crtc, "DRM_IOCTL_MODE_SETCRTC");
+
+	bench_flip(crtc_id, fbs);
+
+	plane_id = find_nv12_plane(crtc_index);
+	if (plane_id) {
+		fb_create(&nv12[0], mode.hdisplay, mode.vdisplay,
+			  DRM_FORMAT_NV12);
+		fb_create(&nv12[1], mode.hdisplay, mode.vdisplay,
+			  DRM_FORMAT_NV12);
+		bench_setplane(plane_id, crtc_id, nv12, mode.hdisplay,
+			       mode.vdisplay);
+		fb_destroy(&nv12[0]);
+		fb_destroy(&nv12[1]);
+	}
+
+	fb_destroy(&fbs[0]);
+	fb_destroy(&fbs[1]);
+
+	return 0;
+}
@@ -0,0 +1,165 @@
+#!/bin/bash
+# SPDX-License-Identifier: GPL-2.0
+#
+# Benchmarks of the Amlogic Meson drivers hot paths.
+#
+# Prints one "<metric> <value> <unit>" line per result, after a header
+# naming the kernel, so that the output of two builds can be compared:
+#
+#   ./meson_bench.sh > before.txt
+#   ./meson_bench.sh > after.txt
+#   ./meson_bench.sh compare before.txt after.txt
+#
+# Each part is skipped when its device isn't there or isn't configured:
+#
+#   VDEC_DEV      V4L2 decoder node (/dev/video0)
+#   VDEC_STREAMS  directory of test streams named <FOURCC>.<anything>,
+#                 e.g. H264.1080p.h264, decoded at VDEC_WIDTH x VDEC_HEIGHT
+#   DRM_DEV       DRM card (/dev/dri/card0), needs DRM master
+#   MMC_DEV       block device read by fio, e.g. /dev/mmcblk1
+#   NET_IF        interface pktgen sends from, to NET_DST_IP/NET_DST_MAC
+#   SPI_DEV       spidev node
+#   I2C_DEV       i2c-dev node, read from I2C_ADDR
+
+readonly ksft_skip=4
+
+VDEC_DEV="${VDEC_DEV:-/dev/video0}"
+VDEC_WIDTH="${VDEC_WIDTH:-1920}"
+VDEC_HEIGHT="${VDEC_HEIGHT:-1080}"
+DRM_DEV="${DRM_DEV:-/dev/dri/card0}"
+NET_COUNT="${NET_COUNT:-1000000}"
+
+log() {
+	echo "# $*"
+}
+
+compare() {
+	# Relative change of each metric present in both files
+	awk '
+		FNR == NR && !/^#/ { old[$1] = $2; next }
+		!/^#/ && ($1 in old) {
+			d = old[$1] ? ($2 - old[$1]) * 100 / old[$1] : 0
+			printf "%-48s %12.3f %12.3f %+8.1f%% %s\n",
+			       $1, old[$1], $2, d, $3
+		}
+	' "$1" "$2"
+}
+
+bench_vdec() {
+	local stream codec
+
+	if [ ! -c "${VDEC_DEV}" ] || [ ! -d "${VDEC_STREAMS}" ]; then
+		log "vdec: skipped, set VDEC_STREAMS"
+		return
+	fi
+
+	for stream in "${VDEC_STREAMS}"/*; do
+		codec="$(basename "${stream}")"
+		codec="${codec%%.*}"
+		./vdec_bench -d "${VDEC_DEV}" -c "${codec}" \
+			-w "${VDEC_WIDTH}" -h "${VDEC_HEIGHT}" "${stream}" ||
+			log "vdec: ${codec} failed"
+	done
+}
+
+bench_drm() {
+	if [ ! -c "${DRM_DEV}" ]; then
+		log "drm: skipped, no ${DRM_DEV}"
+		return
+	fi
+
+	./drm_vblank_bench -d "${DRM_DEV}" || log "drm: failed"
+}
+
+bench_mmc() {
+	local rw bs
+
+	if [ ! -b "${MMC_DEV}" ] || ! command -v fio > /dev/null; then
+		log "mmc: skipped, set MMC_DEV and install fio"
+		return
+	fi
+
+	# Reads only, the device content is left alone
+	for rw in read randread; do
+		[ "${rw}" = read ] && bs=512k || bs=4k
+		fio --name=mmc --filename="${MMC_DEV}" --readonly \
+			--direct=1 --ioengine=libaio --iodepth=32 \
+			--rw="${rw}" --bs="${bs}" --runtime=20 --time_based \
+			--minimal |
+		# Terse format: read bandwidth in KiB/s and IOPS
+		awk -F';' -v rw="${rw}" '{
+			printf "meson.mmc.%s.bw %.3f MiB/s\n", rw, $7 / 1024
+			printf "meson.mmc.%s.iops %.3f iops\n", rw, $8
+		}'
+	done
+}
+
+bench_net() {
+	local pg=/proc/net/pktgen size
+
+	if [ -z "${NET_IF}" ] || [ -z "${NET_DST_IP}" ] ||
+	   [ -z "${NET_DST_MAC}" ]; then
+		log "net: skipped, set NET_IF, NET_DST_IP and NET_DST_MAC"
+		return
+	fi
+
+	if ! modprobe pktgen 2> /dev/null && [ ! -d "${pg}" ]; then
+		log "net: skipped, no pktgen"
+		return
+	fi
+
+	echo "rem_device_all" > "${pg}/kpktgend_0"
+	echo "add_device ${NET_IF}" > "${pg}/kpktgend_0"
+
+	# 64 bytes frames and 1500 bytes IP packets, pktgen doesn't count
+	# the FCS and counts the Ethernet header
+	for size in 64 1500; do
+		echo "count ${NET_COUNT}" > "${pg}/${NET_IF}"
+		echo "pkt_size $((size == 64 ? 60 : size + 14))" > \
+			"${pg}/${NET_IF}"
+		echo "dst ${NET_DST_IP}" > "${pg}/${NET_IF}"
+		echo "dst_mac ${NET_DST_MAC}" > "${pg}/${NET_IF}"
+		echo "start" > "${pg}/pgctrl"
+
+		grep -o '[0-9]\+pps' "${pg}/${NET_IF}" |
+			sed "s/\([0-9]*\)pps/meson.net.tx_${size}.pps \1 pps/"
+	done
+
+	echo "rem_device_all" > "${pg}/kpktgend_0"
+}
+
+bench_bus() {
+	if [ -c "${SPI_DEV}" ]; then
+		./bus_latency -s "${SPI_DEV}" -l 4 || log "spi: failed"
+		./bus_latency -s "${SPI_DEV}" -l 256 || log "spi: failed"
+	else
+		log "spi: skipped, set SPI_DEV"
+	fi
+
+	if [ -c "${I2C_DEV}" ] && [ -n "${I2C_ADDR}" ]; then
+		./bus_latency -i "${I2C_DEV}" -a "${I2C_ADDR}" -l 1 ||
+			log "i2c: failed"
+	else
+		log "i2c: skipped, set I2C_DEV and I2C_ADDR"
+	fi
+}
+
+if [ "$1" = compare ]; then
+	[ $# -eq 3 ] || { echo "usage: $0 compare old new"; exit 1; }
+	compare "$2" "$3"
+	exit 0
+fi
+
+if ! grep -qs "amlogic,meson" /proc/device-tree/compatible; then
+	echo "SKIP: not an Amlogic Meson system"
+	exit ${ksft_skip}
+fi
+
+log "kernel $(uname -r) $(uname -v)"
+log "machine $(tr -d '\0' < /proc/device-tree/model)"
+
+bench_vdec
+bench_drm
+bench_mmc
+bench_net
+bench_bus
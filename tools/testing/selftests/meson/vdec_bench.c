@@ -0,0 +1,333 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Decode an elementary stream with a V4L2 stateful decoder and report the
+ * decoding rate and the first frame latency.
+ *
+ * The stream is fed in fixed size chunks, the parser of the decoder finds
+ * the frames, except for MJPEG which is fed one JPEG picture per buffer.
+ * The decoded frames are not looked at.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <error.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <linux/videodev2.h>
+
+#include "bench.h"
+
+#define NUM_OUT_BUFS	4
+#define NUM_CAP_BUFS	16
+#define CHUNK_SIZE	(256 * 1024)
+#define OUT_BUF_SIZE	(2 * 1024 * 1024)
+
+static const char *cfg_dev = "/dev/video0";
+static const char *cfg_codec = "H264";
+static unsigned int cfg_width = 1920;
+static unsigned int cfg_height = 1080;
+
+struct out_buf {
+	void *addr;
+	size_t size;
+};
+
+static int fd;
+static struct out_buf out_bufs[NUM_OUT_BUFS];
+static unsigned int num_cap_bufs;
+
+static const unsigned char *stream;
+static size_t stream_size, stream_pos;
+static int is_mjpeg;
+
+static void xioctl(unsigned long req, void *arg, const char *name)
+{
+	if (ioctl(fd, req, arg))
+		error(1, errno, "%s", name);
+}
+
+/* Returns the size of the next chunk of the stream */
+static size_t next_chunk(void)
+{
+	size_t end;
+
+	if (!is_mjpeg)
+		return stream_size - stream_pos < CHUNK_SIZE ?
+		       stream_size - stream_pos : CHUNK_SIZE;
+
+	/* Up to the next SOI marker */
+	for (end = stream_pos + 2; end + 1 < stream_size; end++)
+		if (stream[end] == 0xff && stream[end + 1] == 0xd8)
+			return end - stream_pos;
+
+	return stream_size - stream_pos;
+}
+
+/* Fills and queues an OUTPUT buffer, returns 0 at the end of the stream */
+static int queue_out(unsigned int index)
+{
+	struct v4l2_plane plane = { 0 };
+	struct v4l2_buffer buf = {
+		.type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE,
+		.memory = V4L2_MEMORY_MMAP,
+		.index = index,
+		.m.planes = &plane,
+		.length = 1,
+	};
+	size_t len = next_chunk();
+
+	if (!len)
+		return 0;
+
+	if (len > out_bufs[index].size)
+		error(1, 0, "%zu bytes picture, larger than the buffers", len);
+
+	memcpy(out_bufs[index].addr, stream + stream_pos, len);
+	stream_pos += len;
+
+	plane.bytesused = len;
+	buf.timestamp.tv_usec = stream_pos;
+	xioctl(VIDIOC_QBUF, &buf, "VIDIOC_QBUF output");
+
+	return 1;
+}
+
+static void queue_cap(unsigned int index)
+{
+	struct v4l2_plane planes[VIDEO_MAX_PLANES] = { 0 };
+	struct v4l2_buffer buf = {
+		.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE,
+		.memory = V4L2_MEMORY_MMAP,
+		.index = index,
+		.m.planes = planes,
+		.length = VIDEO_MAX_PLANES,
+	};
+
+	xioctl(VIDIOC_QBUF, &buf, "VIDIOC_QBUF capture");
+}
+
+static void setup_output(void)
+{
+	struct v4l2_requestbuffers req = {
+		.count = NUM_OUT_BUFS,
+		.type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE,
+		.memory = V4L2_MEMORY_MMAP,
+	};
+	struct v4l2_format fmt = {
+		.type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE,
+	};
+	unsigned int i;
+
+	fmt.fmt.pix_mp.pixelformat = v4l2_fourcc(cfg_codec[0], cfg_codec[1],
+						 cfg_codec[2], cfg_codec[3]);
+	fmt.fmt.pix_mp.width = cfg_width;
+	fmt.fmt.pix_mp.height = cfg_height;
+	fmt.fmt.pix_mp.num_planes = 1;
+	fmt.fmt.pix_mp.plane_fmt[0].sizeimage = OUT_BUF_SIZE;
+	xioctl(VIDIOC_S_FMT, &fmt, "VIDIOC_S_FMT output");
+
+	if (fmt.fmt.pix_mp.pixelformat !=
+	    v4l2_fourcc(cfg_codec[0], cfg_codec[1], cfg_codec[2], cfg_codec[3]))
+		error(4, 0, "%s is not supported by %s", cfg_codec, cfg_dev);
+
+	xioctl(VIDIOC_REQBUFS, &req, "VIDIOC_REQBUFS output");
+
+	for (i = 0; i < req.count && i < NUM_OUT_BUFS; i++) {
+		struct v4l2_plane plane;
+		struct v4l2_buffer buf = {
+			.type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE,
+			.memory = V4L2_MEMORY_MMAP,
+			.index = i,
+			.m.planes = &plane,
+			.length = 1,
+		};
+
+		xioctl(VIDIOC_QUERYBUF, &buf, "VIDIOC_QUERYBUF");
+		out_bufs[i].size = plane.length;
+		out_bufs[i].addr = mmap(NULL, plane.length,
+					PROT_READ | PROT_WRITE, MAP_SHARED,
+					fd, plane.m.mem_offset);
+		if (out_bufs[i].addr == MAP_FAILED)
+			error(1, errno, "mmap");
+	}
+}
+
+/* (Re)allocates the CAPTURE buffers after the current CAPTURE format */
+static void setup_capture(void)
+{
+	struct v4l2_requestbuffers req = {
+		.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE,
+		.memory = V4L2_MEMORY_MMAP,
+	};
+	int type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+	unsigned int i;
+
+	if (num_cap_bufs) {
+		xioctl(VIDIOC_STREAMOFF, &type, "VIDIOC_STREAMOFF capture");
+		xioctl(VIDIOC_REQBUFS, &req, "VIDIOC_REQBUFS capture");
+	}
+
+	req.count = NUM_CAP_BUFS;
+	xioctl(VIDIOC_REQBUFS, &req, "VIDIOC_REQBUFS capture");
+	num_cap_bufs = req.count;
+
+	for (i = 0; i < num_cap_bufs; i++)
+		queue_cap(i);
+
+	xioctl(VIDIOC_STREAMON, &type, "VIDIOC_STREAMON capture");
+}
+
+static void subscribe(unsigned int type)
+{
+	struct v4l2_event_subscription sub = { .type = type };
+
+	xioctl(VIDIOC_SUBSCRIBE_EVENT, &sub, "VIDIOC_SUBSCRIBE_EVENT");
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-d device] [-c fourcc] [-w width] [-h height] stream\n",
+		prog);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	struct v4l2_decoder_cmd stop = { .cmd = V4L2_DEC_CMD_STOP };
+	int type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE;
+	long long t_start, t_first = 0, t_end;
+	unsigned int frames = 0, i;
+	int eos = 0, draining = 0;
+	char metric[64];
+	struct stat st;
+	int sfd, c;
+
+	while ((c = getopt(argc, argv, "d:c:w:h:")) != -1) {
+		switch (c) {
+		case 'd':
+			cfg_dev = optarg;
+			break;
+		case 'c':
+			if (strlen(optarg) != 4)
+				usage(argv[0]);
+			cfg_codec = optarg;
+			break;
+		case 'w':
+			cfg_width = strtoul(optarg, NULL, 0);
+			break;
+		case 'h':
+			cfg_height = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (optind != argc - 1)
+		usage(argv[0]);
+
+	sfd = open(argv[optind], O_RDONLY);
+	if (sfd < 0 || fstat(sfd, &st))
+		error(1, errno, "%s", argv[optind]);
+	stream_size = st.st_size;
+	stream = mmap(NULL, stream_size, PROT_READ, MAP_PRIVATE, sfd, 0);
+	if (stream == MAP_FAILED)
+		error(1, errno, "mmap %s", argv[optind]);
+	is_mjpeg = !strcmp(cfg_codec, "MJPG");
+
+	fd = open(cfg_dev, O_RDWR | O_NONBLOCK);
+	if (fd < 0)
+		error(4, errno, "%s", cfg_dev);
+
+	subscribe(V4L2_EVENT_EOS);
+	subscribe(V4L2_EVENT_SOURCE_CHANGE);
+	setup_output();
+	setup_capture();
+
+	t_start = now_ns();
+	for (i = 0; i < NUM_OUT_BUFS; i++)
+		if (!queue_out(i))
+			break;
+	xioctl(VIDIOC_STREAMON, &type, "VIDIOC_STREAMON output");
+
+	while (!eos) {
+		struct pollfd pfd = {
+			.fd = fd,
+			.events = POLLIN | POLLOUT | POLLPRI,
+		};
+
+		if (poll(&pfd, 1, 5000) <= 0)
+			error(1, 0, "decoder stalled after %u frames", frames);
+
+		if (pfd.revents & POLLPRI) {
+			struct v4l2_event ev;
+
+			xioctl(VIDIOC_DQEVENT, &ev, "VIDIOC_DQEVENT");
+			if (ev.type == V4L2_EVENT_EOS)
+				eos = 1;
+			else if (ev.type == V4L2_EVENT_SOURCE_CHANGE)
+				setup_capture();
+		}
+
+		if (pfd.revents & POLLOUT) {
+			struct v4l2_plane plane;
+			struct v4l2_buffer buf = {
+				.type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE,
+				.memory = V4L2_MEMORY_MMAP,
+				.m.planes = &plane,
+				.length = 1,
+			};
+
+			if (!ioctl(fd, VIDIOC_DQBUF, &buf) &&
+			    !queue_out(buf.index) && !draining) {
+				xioctl(VIDIOC_DECODER_CMD, &stop,
+				       "VIDIOC_DECODER_CMD");
+				draining = 1;
+			}
+		}
+
+		if (pfd.revents & POLLIN) {
+			struct v4l2_plane planes[VIDEO_MAX_PLANES];
+			struct v4l2_buffer buf = {
+				.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE,
+				.memory = V4L2_MEMORY_MMAP,
+				.m.planes = planes,
+				.length = VIDEO_MAX_PLANES,
+			};
+
+			if (ioctl(fd, VIDIOC_DQBUF, &buf))
+				continue;
+
+			if (planes[0].bytesused) {
+				if (!frames++)
+					t_first = now_ns();
+			}
+
+			if (buf.flags & V4L2_BUF_FLAG_LAST)
+				eos = 1;
+			else
+				queue_cap(buf.index);
+		}
+	}
+	t_end = now_ns();
+
+	if (!frames)
+		error(1, 0, "no frame decoded");
+
+	snprintf(metric, sizeof(metric), "meson.vdec.%s.frames", cfg_codec);
+	bench_result(metric, frames, "frames");
+	snprintf(metric, sizeof(metric), "meson.vdec.%s.fps", cfg_codec);
+	bench_result(metric, frames * 1e9 / (t_end - t_start), "fps");
+	snprintf(metric, sizeof(metric), "meson.vdec.%s.first_frame",
+		 cfg_codec);
+	bench_result(metric, (t_first - t_start) / 1e6, "ms");
+
+	return 0;
+}
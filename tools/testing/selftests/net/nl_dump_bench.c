@@ -0,0 +1,169 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Time a full rtnetlink dump with a given receive buffer size.
+ *
+ * The kernel sizes the dump skbs after the largest buffer passed to
+ * recvmsg(), so running this with -b 32768 and with -b 1048576 compares
+ * the number of system calls, and the time, a table dump takes.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <error.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+
+static int cfg_bufsize = 32768;
+static int cfg_family = AF_INET;
+static int cfg_repeat = 10;
+static int cfg_type = RTM_GETROUTE;
+
+struct dump_stats {
+	unsigned long calls;
+	unsigned long msgs;
+	unsigned long bytes;
+};
+
+static long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void dump_request(int fd, unsigned int seq)
+{
+	struct {
+		struct nlmsghdr nlh;
+		struct rtgenmsg g;
+	} req = {
+		.nlh.nlmsg_len = NLMSG_LENGTH(sizeof(struct rtgenmsg)),
+		.nlh.nlmsg_type = cfg_type,
+		.nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP,
+		.nlh.nlmsg_seq = seq,
+		.g.rtgen_family = cfg_family,
+	};
+
+	if (send(fd, &req, req.nlh.nlmsg_len, 0) != req.nlh.nlmsg_len)
+		error(1, errno, "send");
+}
+
+static void do_dump(int fd, char *buf, unsigned int seq,
+		    struct dump_stats *st)
+{
+	struct nlmsghdr *nlh;
+	ssize_t len;
+
+	dump_request(fd, seq);
+
+	for (;;) {
+		len = recv(fd, buf, cfg_bufsize, 0);
+		if (len < 0)
+			error(1, errno, "recv");
+		st->calls++;
+		st->bytes += len;
+
+		for (nlh = (struct nlmsghdr *)buf; NLMSG_OK(nlh, len);
+		     nlh = NLMSG_NEXT(nlh, len)) {
+			if (nlh->nlmsg_seq != seq)
+				continue;
+			if (nlh->nlmsg_type == NLMSG_DONE)
+				return;
+			if (nlh->nlmsg_type == NLMSG_ERROR)
+				error(1, 0, "dump failed");
+			st->msgs++;
+		}
+	}
+}
+
+static void usage(const char *name)
+{
+	error(1, 0, "usage: %s [-4|-6] [-b bufsize] [-r repeat] [-t route|link|addr|neigh]",
+	      name);
+}
+
+static void parse_opts(int argc, char **argv)
+{
+	int c;
+
+	while ((c = getopt(argc, argv, "46b:r:t:")) != -1) {
+		switch (c) {
+		case '4':
+			cfg_family = AF_INET;
+			break;
+		case '6':
+			cfg_family = AF_INET6;
+			break;
+		case 'b':
+			cfg_bufsize = strtoul(optarg, NULL, 0);
+			break;
+		case 'r':
+			cfg_repeat = strtoul(optarg, NULL, 0);
+			break;
+		case 't':
+			if (!strcmp(optarg, "route"))
+				cfg_type = RTM_GETROUTE;
+			else if (!strcmp(optarg, "link"))
+				cfg_type = RTM_GETLINK;
+			else if (!strcmp(optarg, "addr"))
+				cfg_type = RTM_GETADDR;
+			else if (!strcmp(optarg, "neigh"))
+				cfg_type = RTM_GETNEIGH;
+			else
+				usage(argv[0]);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	if (cfg_bufsize < 4096 || cfg_repeat < 1)
+		usage(argv[0]);
+}
+
+int main(int argc, char **argv)
+{
+	struct dump_stats st = {};
+	long long t;
+	char *buf;
+	int fd, i;
+
+	parse_opts(argc, argv);
+
+	buf = malloc(cfg_bufsize);
+	if (!buf)
+		error(1, errno, "malloc");
+
+	fd = socket(AF_NETLINK, SOCK_RAW, NETLINK_ROUTE);
+	if (fd < 0)
+		error(1, errno, "socket");
+	/* Leave room for a few skbs of the requested size */
+	i = cfg_bufsize * 4;
+	if (setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &i, sizeof(i)))
+		error(1, errno, "setsockopt SO_RCVBUF");
+
+	/* Warm up, and let the kernel learn the buffer size */
+	do_dump(fd, buf, 0, &st);
+	memset(&st, 0, sizeof(st));
+
+	t = now_ns();
+	for (i = 1; i <= cfg_repeat; i++)
+		do_dump(fd, buf, i, &st);
+	t = now_ns() - t;
+
+	printf("buf %7d: %lu msgs, %lu bytes in %lu recv calls per dump, %.3f ms per dump\n",
+	       cfg_bufsize, st.msgs / cfg_repeat, st.bytes / cfg_repeat,
+	       st.calls / cfg_repeat, t / 1e6 / cfg_repeat);
+
+	close(fd);
+	free(buf);
+	return 0;
+}
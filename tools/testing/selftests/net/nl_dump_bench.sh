@@ -0,0 +1,30 @@
+#!/bin/bash
+# SPDX-License-Identifier: GPL-2.0
+#
+# Dump a large routing table with small and large netlink buffers
+
+set -e
+
+readonly BIN="./nl_dump_bench"
+readonly NS="ns-$(mktemp -u XXXXXX)"
+readonly NROUTES="${1:-100000}"
+
+cleanup() {
+	ip netns del "${NS}"
+}
+
+trap cleanup EXIT
+
+ip netns add "${NS}"
+ip -netns "${NS}" link add dummy0 type dummy
+ip -netns "${NS}" link set dummy0 up
+ip -netns "${NS}" addr add 10.0.0.1/8 dev dummy0
+
+for ((i = 0; i < NROUTES; i++)); do
+	echo "route add 172.$((i >> 16 & 15 | 16)).$((i >> 8 & 255)).$((i & 255))/32 dev dummy0"
+done | ip -netns "${NS}" -batch -
+
+for bufsize in 32768 131072 1048576; do
+	ip netns exec "${NS}" "${BIN}" -4 -t route -b "${bufsize}"
+done
+echo ok
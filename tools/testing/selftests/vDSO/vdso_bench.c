@@ -0,0 +1,141 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * vdso_bench.c: compare the cost of the vDSO clock_gettime() and getcpu()
+ * with the corresponding syscalls.
+ *
+ * The vDSO symbols are looked up directly, so that what is measured does
+ * not depend on which of them the C library uses. A clock the vDSO does not
+ * handle falls back to the syscall, and then shows the same cost for both.
+ */
+
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "../kselftest.h"
+
+#define ITERATIONS	1000000
+
+typedef int (*vdso_clock_gettime_t)(clockid_t clk, struct timespec *ts);
+typedef int (*vdso_getcpu_t)(unsigned int *cpu, unsigned int *node,
+			     void *tcache);
+
+static vdso_clock_gettime_t vdso_clock_gettime;
+static vdso_getcpu_t vdso_getcpu;
+
+static const struct {
+	const char *name;
+	clockid_t id;
+} clocks[] = {
+	{ "CLOCK_REALTIME", CLOCK_REALTIME },
+	{ "CLOCK_MONOTONIC", CLOCK_MONOTONIC },
+	{ "CLOCK_MONOTONIC_RAW", CLOCK_MONOTONIC_RAW },
+	{ "CLOCK_BOOTTIME", CLOCK_BOOTTIME },
+	{ "CLOCK_TAI", CLOCK_TAI },
+};
+
+static long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void report(const char *what, const char *how, long long ns)
+{
+	printf("%-20s %-8s %6.1f ns/call\n", what, how,
+	       (double)ns / ITERATIONS);
+}
+
+static void bench_clock(const char *name, clockid_t id)
+{
+	struct timespec ts;
+	long long t;
+	int i;
+
+	t = now_ns();
+	for (i = 0; i < ITERATIONS; i++)
+		vdso_clock_gettime(id, &ts);
+	report(name, "vdso", now_ns() - t);
+
+	t = now_ns();
+	for (i = 0; i < ITERATIONS; i++)
+		syscall(SYS_clock_gettime, id, &ts);
+	report(name, "syscall", now_ns() - t);
+}
+
+static int bench_getcpu(void)
+{
+	unsigned int cpu, node, scpu, snode;
+	long long t;
+	int i;
+
+	/* Check the result against the syscall before timing it */
+	vdso_getcpu(&cpu, &node, NULL);
+	syscall(SYS_getcpu, &scpu, &snode, NULL);
+	if (cpu != scpu || node != snode) {
+		/* Possibly migrated in between, try again */
+		vdso_getcpu(&cpu, &node, NULL);
+		if (cpu != scpu || node != snode) {
+			printf("getcpu: vdso %u/%u, syscall %u/%u\n",
+			       cpu, node, scpu, snode);
+			return -1;
+		}
+	}
+
+	t = now_ns();
+	for (i = 0; i < ITERATIONS; i++)
+		vdso_getcpu(&cpu, &node, NULL);
+	report("getcpu", "vdso", now_ns() - t);
+
+	t = now_ns();
+	for (i = 0; i < ITERATIONS; i++)
+		syscall(SYS_getcpu, &cpu, &node, NULL);
+	report("getcpu", "syscall", now_ns() - t);
+
+	return 0;
+}
+
+int main(void)
+{
+	void *vdso;
+	int i;
+
+	vdso = dlopen("linux-vdso.so.1", RTLD_LAZY | RTLD_LOCAL | RTLD_NOLOAD);
+	if (!vdso) {
+		printf("[SKIP]\tvDSO not found: %s\n", dlerror());
+		return KSFT_SKIP;
+	}
+
+	vdso_clock_gettime = (vdso_clock_gettime_t)dlsym(vdso,
+						"__kernel_clock_gettime");
+	if (!vdso_clock_gettime)
+		vdso_clock_gettime = (vdso_clock_gettime_t)dlsym(vdso,
+						"__vdso_clock_gettime");
+	vdso_getcpu = (vdso_getcpu_t)dlsym(vdso, "__kernel_getcpu");
+	if (!vdso_getcpu)
+		vdso_getcpu = (vdso_getcpu_t)dlsym(vdso, "__vdso_getcpu");
+
+	if (vdso_clock_gettime) {
+		for (i = 0; i < sizeof(clocks) / sizeof(clocks[0]); i++)
+			bench_clock(clocks[i].name, clocks[i].id);
+	} else {
+		printf("[SKIP]\tclock_gettime not in the vDSO\n");
+	}
+
+	if (vdso_getcpu) {
+		if (bench_getcpu()) {
+			printf("[FAIL]\tgetcpu mismatch\n");
+			return KSFT_FAIL;
+		}
+	} else {
+		printf("[SKIP]\tgetcpu not in the vDSO\n");
+	}
+
+	return KSFT_PASS;
+}